@@ -201,6 +201,12 @@ def main(args):
         cmake_options.append("-DCMAKE_BUILD_TYPE=Release")
     if args["static"]:
         cmake_options.append("-DBUILD_SHARED_LIBS=OFF")
+    if args["allocator"]:
+        cmake_options.append("-DOCTOPUS_ALLOCATOR=" + args["allocator"])
+    if args["cuda"]:
+        cmake_options.append("-DBUILD_CUDA=ON")
+    if args["single_precision_likelihoods"]:
+        cmake_options.append("-DSINGLE_PRECISION_LIKELIHOODS=ON")
     if args["verbose"]:
         cmake_options.append("CMAKE_VERBOSE_MAKEFILE:BOOL=ON")
     if dependencies_dir is not None:
@@ -333,6 +339,18 @@ if __name__ == '__main__':
                         default=False,
                         help='Try to download pre-trained random forests for filtering',
                         action='store_true')
+    parser.add_argument('--allocator',
+                        required=False,
+                        type=str,
+                        help='Link a scalable malloc replacement library, e.g. jemalloc, tcmalloc or mimalloc')
+    parser.add_argument('--cuda',
+                        default=False,
+                        help='Offload batched pair HMM alignment to CUDA devices when present (requires the CUDA toolkit)',
+                        action='store_true')
+    parser.add_argument('--single-precision-likelihoods',
+                        default=False,
+                        help='Store read likelihoods in single precision, which halves their memory but may slightly change calls',
+                        action='store_true')
     parser.add_argument('--verbose',
                         default=False,
                         help='Ouput verbose make information',
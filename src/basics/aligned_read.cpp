@@ -8,6 +8,7 @@
 #include <boost/functional/hash.hpp>
 
 #include "utils/sequence_utils.hpp"
+#include "utils/quality_kernels.hpp"
 
 namespace octopus {
 
@@ -15,7 +16,7 @@ namespace octopus {
 
 const GenomicRegion::ContigName& AlignedRead::Segment::contig_name() const
 {
-    return contig_name_;
+    return *contig_name_;
 }
 
 GenomicRegion::Position AlignedRead::Segment::begin() const noexcept
@@ -62,6 +63,7 @@ const AlignedRead::NucleotideSequence& AlignedRead::sequence() const noexcept
 
 AlignedRead::NucleotideSequence& AlignedRead::sequence() noexcept
 {
+    reference_mismatches_ = boost::none;
     return sequence_;
 }
 
@@ -109,12 +111,23 @@ AlignedRead::Flags AlignedRead::flags() const noexcept
     return decompress(flags_);
 }
 
+const AlignedRead::MismatchVector* AlignedRead::reference_mismatches() const noexcept
+{
+    return reference_mismatches_ ? &(*reference_mismatches_) : nullptr;
+}
+
+void AlignedRead::set_reference_mismatches(MismatchVector mismatches) noexcept
+{
+    reference_mismatches_ = std::move(mismatches);
+}
+
 void AlignedRead::realign(GenomicRegion new_region, CigarString new_cigar) noexcept
 {
     assert(sequence_size(new_cigar) == sequence_.size());
     assert(reference_size(new_cigar) == size(new_region));
     region_ = std::move(new_region);
     cigar_ = std::move(new_cigar);
+    reference_mismatches_ = boost::none;
 }
 
 bool AlignedRead::is_marked_all_segments_in_read_aligned() const noexcept
@@ -197,7 +210,7 @@ AlignedRead::FlagBits AlignedRead::compress(const Flags& flags) const noexcept
 
 AlignedRead::Flags AlignedRead::decompress(const FlagBits& flags) const noexcept
 {
-    return {flags[0], flags[1], flags[2], flags[3], flags[4], flags[5], flags[6], flags[7], flags[8], flags[9]};
+    return {flags[1], flags[0], flags[2], flags[3], flags[4], flags[5], flags[6], flags[7], flags[8], flags[9]};
 }
 
 AlignedRead::Segment::FlagBits AlignedRead::Segment::compress(const Flags& flags)
@@ -221,16 +234,34 @@ std::size_t ReadHash::operator()(const octopus::AlignedRead &read) const
 
 // Non-member methods
 
+AlignedRead::Core extract_core(const AlignedRead& read) noexcept
+{
+    AlignedRead::Core result {};
+    result.mapping_quality = read.mapping_quality();
+    result.flags = read.flags();
+    result.has_other_segment = read.has_other_segment();
+    if (result.has_other_segment) {
+        const auto& segment = read.next_segment();
+        result.next_segment_flags.unmapped = segment.is_marked_unmapped();
+        result.next_segment_flags.reverse_mapped = segment.is_marked_reverse_mapped();
+        result.is_next_segment_on_same_contig = &segment.contig_name() == &contig_name(read); // names are interned
+    }
+    return result;
+}
+
 void capitalise_bases(AlignedRead& read) noexcept
 {
-    utils::capitalise(read.sequence());
+    auto& sequence = read.sequence();
+    // Decoded bases are nearly always upper case already
+    if (utils::has_lowercase(sequence.data(), sequence.size())) {
+        utils::capitalise(sequence);
+    }
 }
 
 void cap_qualities(AlignedRead& read, const AlignedRead::BaseQuality max) noexcept
 {
     auto& qualities = read.base_qualities();
-    std::transform(std::cbegin(qualities), std::cend(qualities), std::begin(qualities),
-                   [max] (const auto q) { return std::min(q, max); });
+    utils::cap_bytes(qualities.data(), qualities.size(), max);
 }
 
 void set_front_qualities(AlignedRead& read, std::size_t num_bases, const AlignedRead::BaseQuality value) noexcept
@@ -417,8 +448,8 @@ auto calculate_dynamic_bytes(const AlignedRead& read) noexcept
            + sequence_size(read) * sizeof(char)
            + sequence_size(read) * sizeof(AlignedRead::BaseQuality)
            + read.cigar().size() * sizeof(CigarOperation)
-           + contig_name(read).size() * sizeof(char)
-           + (read.has_other_segment() ? sizeof(AlignedRead::Segment) : 0);
+           + (read.has_other_segment() ? sizeof(AlignedRead::Segment) : 0)
+           + (read.reference_mismatches() ? read.reference_mismatches()->size() * sizeof(std::uint32_t) : 0);
 }
 
 } // namespace
@@ -430,7 +461,7 @@ MemoryFootprint footprint(const AlignedRead& read) noexcept
 
 bool operator==(const AlignedRead::Segment& lhs, const AlignedRead::Segment& rhs) noexcept
 {
-    return lhs.contig_name() == rhs.contig_name()
+    return lhs.contig_name_ == rhs.contig_name_ // names are interned
            && lhs.begin() == rhs.begin()
            && lhs.flags_ == rhs.flags_
            && lhs.inferred_template_length() == rhs.inferred_template_length();
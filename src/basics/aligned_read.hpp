@@ -35,6 +35,7 @@ public:
     using MappingQuality      = std::uint8_t;
     using BaseQuality         = std::uint8_t;
     using BaseQualityVector   = std::vector<BaseQuality>;
+    using MismatchVector      = std::vector<std::uint32_t>;
     
     enum class Direction { forward, reverse };
     
@@ -73,7 +74,7 @@ public:
     private:
         using FlagBits = std::bitset<2>;
         
-        GenomicRegion::ContigName contig_name_;
+        const GenomicRegion::ContigName* contig_name_ = detail::empty_contig_name();
         GenomicRegion::Position begin_;
         GenomicRegion::Size inferred_template_length_;
         FlagBits flags_;
@@ -82,6 +83,7 @@ public:
     };
     
     struct Flags;
+    struct Core;
     
     AlignedRead() = default;
     
@@ -119,6 +121,11 @@ public:
     const Segment& next_segment() const;
     Flags flags() const noexcept;
     
+    // Read indices of bases in alignment match operations that differ from the reference, ignoring Ns.
+    // Null unless set, and reset if the sequence or alignment is modified.
+    const MismatchVector* reference_mismatches() const noexcept;
+    void set_reference_mismatches(MismatchVector mismatches) noexcept;
+    
     void realign(GenomicRegion new_region, CigarString new_cigar) noexcept;
     
     bool is_marked_all_segments_in_read_aligned() const noexcept;
@@ -149,6 +156,7 @@ private:
     CigarString cigar_;
     std::string read_group_;
     boost::optional<Segment> next_segment_;
+    boost::optional<MismatchVector> reference_mismatches_;
     FlagBits flags_;
     MappingQuality mapping_quality_;
     
@@ -176,6 +184,16 @@ struct AlignedRead::Flags
     bool last_template_segment;
 };
 
+// The fields of a read that can be inspected without decoding the name, sequence, qualities or cigar
+struct AlignedRead::Core
+{
+    MappingQuality mapping_quality;
+    Flags flags;
+    bool has_other_segment;
+    Segment::Flags next_segment_flags;
+    bool is_next_segment_on_same_contig;
+};
+
 template <typename String_, typename GenomicRegion_, typename Seq, typename Qualities_, typename CigarString_,
           typename String2_>
 AlignedRead::AlignedRead(String_&& name, GenomicRegion_&& reference_region, Seq&& sequence, Qualities_&& qualities,
@@ -187,6 +205,7 @@ AlignedRead::AlignedRead(String_&& name, GenomicRegion_&& reference_region, Seq&
 , cigar_ {std::forward<CigarString_>(cigar)}
 , read_group_ {std::forward<String2_>(read_group)}
 , next_segment_ {}
+, reference_mismatches_ {}
 , flags_ {compress(flags)}
 , mapping_quality_ {mapping_quality}
 {}
@@ -207,6 +226,7 @@ AlignedRead::AlignedRead(String1_&& name, GenomicRegion_&& reference_region, Seq
     Segment {std::forward<String3_>(next_segment_contig_name), next_segment_begin,
     inferred_template_length, next_segment_flags}
   }
+, reference_mismatches_ {}
 , flags_ {compress(flags)}
 , mapping_quality_ {mapping_quality}
 {}
@@ -214,7 +234,7 @@ AlignedRead::AlignedRead(String1_&& name, GenomicRegion_&& reference_region, Seq
 template <typename String_>
 AlignedRead::Segment::Segment(String_&& contig_name, GenomicRegion::Position begin,
                               GenomicRegion::Size inferred_template_length, Flags data)
-: contig_name_ {std::forward<String_>(contig_name)}
+: contig_name_ {detail::intern_contig_name(contig_name)}
 , begin_ {begin}
 , inferred_template_length_ {inferred_template_length}
 , flags_ {compress(data)}
@@ -222,6 +242,8 @@ AlignedRead::Segment::Segment(String_&& contig_name, GenomicRegion::Position beg
 
 // Non-member methods
 
+AlignedRead::Core extract_core(const AlignedRead& read) noexcept;
+
 void capitalise_bases(AlignedRead& read) noexcept;
 
 void cap_qualities(AlignedRead& read, AlignedRead::BaseQuality max = 0) noexcept;
@@ -16,29 +16,69 @@
 
 namespace octopus {
 
+namespace {
+
+constexpr std::uint32_t opBits {4};
+constexpr std::uint32_t opMask {(1u << opBits) - 1};
+constexpr std::uint32_t invalidOpCode {opMask};
+
+// Indexed by BAM op code
+constexpr std::array<char, 16> flagChars {'M', 'I', 'D', 'N', 'S', 'H', 'P', '=', 'X',
+                                          '?', '?', '?', '?', '?', '?', '?'};
+
+std::uint32_t encode(const CigarOperation::Flag flag) noexcept
+{
+    using Flag = CigarOperation::Flag;
+    switch (flag) {
+        case Flag::alignmentMatch: return 0;
+        case Flag::insertion:      return 1;
+        case Flag::deletion:       return 2;
+        case Flag::skipped:        return 3;
+        case Flag::softClipped:    return 4;
+        case Flag::hardClipped:    return 5;
+        case Flag::padding:        return 6;
+        case Flag::sequenceMatch:  return 7;
+        case Flag::substitution:   return 8;
+        default: return invalidOpCode;
+    }
+}
+
+} // namespace
+
+CigarOperation CigarOperation::unpack(const std::uint32_t packed) noexcept
+{
+    CigarOperation result {};
+    result.packed_ = packed;
+    return result;
+}
+
 CigarOperation::CigarOperation(const Size size, const Flag flag) noexcept
-: size_ {size}
-, flag_ {flag}
+: packed_ {static_cast<std::uint32_t>(size) << opBits | encode(flag)}
 {}
 
 void CigarOperation::set_flag(Flag type) noexcept
 {
-    flag_ = type;
+    packed_ = (packed_ & ~opMask) | encode(type);
 }
 
 void CigarOperation::set_size(Size size) noexcept
 {
-    size_ = size;
+    packed_ = static_cast<std::uint32_t>(size) << opBits | (packed_ & opMask);
 }
 
 CigarOperation::Flag CigarOperation::flag() const noexcept
 {
-    return flag_;
+    return static_cast<Flag>(flagChars[packed_ & opMask]);
 }
 
 CigarOperation::Size CigarOperation::size() const noexcept
 {
-    return size_;
+    return packed_ >> opBits;
+}
+
+std::uint32_t CigarOperation::packed() const noexcept
+{
+    return packed_;
 }
 
 // non-member methods
@@ -412,8 +452,7 @@ std::size_t CigarHash::operator()(const CigarOperation& op) const noexcept
 {
     std::size_t result {};
     using boost::hash_combine;
-    hash_combine(result, op.flag());
-    hash_combine(result, op.size());
+    hash_combine(result, op.packed());
     return result;
 }
 
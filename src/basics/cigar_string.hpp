@@ -37,9 +37,14 @@ public:
     
     using Size = std::uint_fast32_t;
     
+    // Operations are packed as in BAM: size in the upper 28 bits, op code in the lower 4
+    static constexpr Size max_size() noexcept { return (Size {1} << 28) - 1; }
+    
+    static CigarOperation unpack(std::uint32_t packed) noexcept;
+    
     CigarOperation() = default;
     
-    explicit CigarOperation(Size size, Flag type) noexcept;
+    explicit CigarOperation(Size size, Flag type) noexcept; // requires size <= max_size()
     
     CigarOperation(const CigarOperation&)            = default;
     CigarOperation& operator=(const CigarOperation&) = default;
@@ -54,9 +59,10 @@ public:
     Flag flag() const noexcept;
     Size size() const noexcept;
     
+    std::uint32_t packed() const noexcept;
+    
 private:
-    Size size_;
-    Flag flag_;
+    std::uint32_t packed_;
 };
 
 void increment_size(CigarOperation& op, CigarOperation::Size n = 1) noexcept;
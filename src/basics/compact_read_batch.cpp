@@ -0,0 +1,314 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "compact_read_batch.hpp"
+
+#include <array>
+#include <limits>
+#include <stdexcept>
+
+#include "basics/contig_region.hpp"
+#include "utils/compression.hpp"
+
+namespace octopus {
+
+namespace {
+
+enum ExtraFlag : std::uint8_t
+{
+    has_next_segment              = 1,
+    next_segment_unmapped         = 2,
+    next_segment_reverse_mapped   = 4,
+    packed_sequence               = 8
+};
+
+// The BAM 4-bit base encoding
+constexpr std::array<char, 16> packed_bases {'=', 'A', 'C', 'M', 'G', 'R', 'S', 'V', 'T', 'W', 'Y', 'H', 'K', 'D', 'B', 'N'};
+
+constexpr std::uint8_t unpackable_base {16};
+
+// Large enough for zlib to find the redundancy in qualities, small enough that decoding a few reads is cheap
+constexpr std::size_t compressedBlockSize {512};
+
+auto make_base_codes() noexcept
+{
+    std::array<std::uint8_t, 256> result {};
+    result.fill(unpackable_base);
+    for (std::uint8_t code {0}; code < packed_bases.size(); ++code) {
+        result[static_cast<unsigned char>(packed_bases[code])] = code;
+    }
+    return result;
+}
+
+const auto base_codes = make_base_codes();
+
+bool is_packable(const AlignedRead::NucleotideSequence& sequence) noexcept
+{
+    return std::all_of(std::cbegin(sequence), std::cend(sequence),
+                       [] (const char base) noexcept { return base_codes[static_cast<unsigned char>(base)] != unpackable_base; });
+}
+
+auto packed_size(const std::size_t num_bases) noexcept
+{
+    return (num_bases + 1) / 2;
+}
+
+void pack(const AlignedRead::NucleotideSequence& sequence, char* result) noexcept
+{
+    for (std::size_t i {0}; i < sequence.size(); i += 2) {
+        auto codes = base_codes[static_cast<unsigned char>(sequence[i])] << 4;
+        if (i + 1 < sequence.size()) codes |= base_codes[static_cast<unsigned char>(sequence[i + 1])];
+        *result++ = static_cast<char>(codes);
+    }
+}
+
+void unpack(const char* packed, const std::size_t num_bases, AlignedRead::NucleotideSequence& result)
+{
+    result.resize(num_bases);
+    for (std::size_t i {0}; i < num_bases; ++i) {
+        const auto codes = static_cast<unsigned char>(packed[i / 2]);
+        result[i] = packed_bases[(i % 2 == 0) ? codes >> 4 : codes & 0xF];
+    }
+}
+
+
+template <typename T>
+std::uint32_t checked_narrow(const T value)
+{
+    if (value > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::length_error {"CompactReadBatch: value exceeds 32 bits"};
+    }
+    return static_cast<std::uint32_t>(value);
+}
+
+std::uint16_t compress(const AlignedRead::Flags& flags) noexcept
+{
+    std::uint16_t result {0};
+    const bool bits[] {flags.multiple_segment_template, flags.all_segments_in_read_aligned, flags.unmapped,
+                       flags.reverse_mapped, flags.secondary_alignment, flags.qc_fail, flags.duplicate,
+                       flags.supplementary_alignment, flags.first_template_segment, flags.last_template_segment};
+    for (unsigned i {0}; i < 10; ++i) {
+        if (bits[i]) result |= 1u << i;
+    }
+    return result;
+}
+
+AlignedRead::Flags decompress(const std::uint16_t flags) noexcept
+{
+    const auto bit = [flags] (const unsigned i) noexcept -> bool { return flags & (1u << i); };
+    return {bit(0), bit(1), bit(2), bit(3), bit(4), bit(5), bit(6), bit(7), bit(8), bit(9)};
+}
+
+} // namespace
+
+CompactReadBatch::CompactReadBatch(const bool compress) : compress_ {compress} {}
+
+bool CompactReadBatch::empty() const noexcept
+{
+    return records_.empty();
+}
+
+CompactReadBatch::size_type CompactReadBatch::size() const noexcept
+{
+    return records_.size();
+}
+
+void CompactReadBatch::reserve(const size_type n)
+{
+    records_.reserve(n);
+}
+
+void CompactReadBatch::push_back(const AlignedRead& read)
+{
+    Record record {};
+    record.begin = checked_narrow(mapped_begin(read));
+    record.end   = checked_narrow(mapped_end(read));
+    record.contig = intern(contig_name(read));
+    record.read_group = intern(read.read_group());
+    record.data_offset = data_.size();
+    record.name_size = checked_narrow(read.name().size());
+    record.sequence_size = checked_narrow(sequence_size(read));
+    record.cigar_offset = checked_narrow(cigars_.size());
+    record.cigar_size = checked_narrow(read.cigar().size());
+    record.flags = compress(read.flags());
+    record.mapping_quality = read.mapping_quality();
+    if (read.has_other_segment()) {
+        const auto& segment = read.next_segment();
+        record.next_segment_begin = checked_narrow(segment.begin());
+        record.next_segment_contig = intern(segment.contig_name());
+        record.inferred_template_length = segment.inferred_template_length();
+        record.extra_flags |= has_next_segment;
+        if (segment.is_marked_unmapped()) record.extra_flags |= next_segment_unmapped;
+        if (segment.is_marked_reverse_mapped()) record.extra_flags |= next_segment_reverse_mapped;
+    }
+    const bool packable {is_packable(read.sequence())};
+    if (packable) record.extra_flags |= packed_sequence;
+    const auto sequence_bytes = packable ? packed_size(record.sequence_size) : record.sequence_size;
+    data_.resize(data_.size() + record.name_size + (compress_ ? 0 : sequence_bytes + record.sequence_size));
+    char* data_itr {data_.data() + record.data_offset};
+    data_itr = std::copy(std::cbegin(read.name()), std::cend(read.name()), data_itr);
+    if (compress_) {
+        if (open_block_size_ == compressedBlockSize) compress_open_block();
+        record.block = checked_narrow(blocks_.size());
+        ++open_block_size_;
+        record.block_offset = checked_narrow(open_block_.size());
+        open_block_.resize(open_block_.size() + sequence_bytes + record.sequence_size);
+        data_itr = &open_block_[record.block_offset];
+    }
+    if (packable) {
+        pack(read.sequence(), data_itr);
+        data_itr += sequence_bytes;
+    } else {
+        data_itr = std::copy(std::cbegin(read.sequence()), std::cend(read.sequence()), data_itr);
+    }
+    std::transform(std::cbegin(read.base_qualities()), std::cend(read.base_qualities()), data_itr,
+                   [] (const AlignedRead::BaseQuality q) noexcept { return static_cast<char>(q); });
+    for (const auto& op : read.cigar()) {
+        cigars_.push_back(op.packed());
+    }
+    if (!records_.empty()) {
+        const auto& prev = records_.back();
+        is_sorted_ = is_sorted_ && prev.contig == record.contig && prev.begin <= record.begin;
+    }
+    max_read_size_ = std::max(max_read_size_, static_cast<GenomicRegion::Size>(record.end - record.begin));
+    records_.push_back(record);
+}
+
+void CompactReadBatch::clear() noexcept
+{
+    records_.clear();
+    data_.clear();
+    cigars_.clear();
+    names_.clear();
+    blocks_.clear();
+    open_block_.clear();
+    open_block_size_ = 0;
+    max_read_size_ = 0;
+    is_sorted_ = true;
+}
+
+void CompactReadBatch::shrink_to_fit()
+{
+    if (!open_block_.empty()) compress_open_block();
+    blocks_.shrink_to_fit();
+    open_block_.shrink_to_fit();
+    records_.shrink_to_fit();
+    data_.shrink_to_fit();
+    cigars_.shrink_to_fit();
+    names_.shrink_to_fit();
+}
+
+AlignedRead CompactReadBatch::decode(const size_type idx) const
+{
+    DecompressedBlock block {};
+    return decode(idx, block);
+}
+
+MemoryFootprint CompactReadBatch::footprint() const noexcept
+{
+    std::size_t bytes {sizeof(CompactReadBatch)};
+    bytes += records_.capacity() * sizeof(Record);
+    bytes += data_.capacity();
+    bytes += cigars_.capacity() * sizeof(std::uint32_t);
+    for (const auto& name : names_) bytes += sizeof(std::string) + name.size();
+    for (const auto& block : blocks_) bytes += sizeof(std::string) + block.capacity();
+    bytes += open_block_.capacity();
+    return bytes;
+}
+
+// private methods
+
+void CompactReadBatch::compress_open_block()
+{
+    blocks_.push_back(utils::compress(open_block_));
+    open_block_.clear();
+    open_block_size_ = 0;
+}
+
+AlignedRead CompactReadBatch::decode(const size_type idx, DecompressedBlock& block) const
+{
+    const auto& record = records_[idx];
+    const char* data_itr {data_.data() + record.data_offset};
+    std::string name(data_itr, std::next(data_itr, record.name_size));
+    data_itr += record.name_size;
+    if (compress_) {
+        if (record.block < blocks_.size()) {
+            if (block.index != record.block) {
+                block.data = utils::decompress(blocks_[record.block]);
+                block.index = record.block;
+            }
+            data_itr = block.data.data() + record.block_offset;
+        } else {
+            data_itr = open_block_.data() + record.block_offset;
+        }
+    }
+    AlignedRead::NucleotideSequence sequence {};
+    if (record.extra_flags & packed_sequence) {
+        unpack(data_itr, record.sequence_size, sequence);
+        data_itr += packed_size(record.sequence_size);
+    } else {
+        sequence.assign(data_itr, std::next(data_itr, record.sequence_size));
+        data_itr += record.sequence_size;
+    }
+    AlignedRead::BaseQualityVector qualities(record.sequence_size);
+    std::transform(data_itr, std::next(data_itr, record.sequence_size), std::begin(qualities),
+                   [] (const char q) noexcept { return static_cast<AlignedRead::BaseQuality>(q); });
+    CigarString cigar(record.cigar_size);
+    const auto cigar_itr = std::next(std::cbegin(cigars_), record.cigar_offset);
+    std::transform(cigar_itr, std::next(cigar_itr, record.cigar_size), std::begin(cigar),
+                   [] (const std::uint32_t op) noexcept { return CigarOperation::unpack(op); });
+    GenomicRegion region {names_[record.contig], record.begin, record.end};
+    if (record.extra_flags & has_next_segment) {
+        const auto next_unmapped = static_cast<bool>(record.extra_flags & next_segment_unmapped);
+        const auto next_reverse_mapped = static_cast<bool>(record.extra_flags & next_segment_reverse_mapped);
+        return AlignedRead {std::move(name), std::move(region), std::move(sequence), std::move(qualities),
+                            std::move(cigar), record.mapping_quality, decompress(record.flags),
+                            names_[record.read_group], names_[record.next_segment_contig],
+                            record.next_segment_begin, record.inferred_template_length,
+                            AlignedRead::Segment::Flags {next_unmapped, next_reverse_mapped}};
+    } else {
+        return AlignedRead {std::move(name), std::move(region), std::move(sequence), std::move(qualities),
+                            std::move(cigar), record.mapping_quality, decompress(record.flags),
+                            names_[record.read_group]};
+    }
+}
+
+CompactReadBatch::NameId CompactReadBatch::intern(const std::string& name)
+{
+    // Batches contain very few distinct contigs and read groups, so a linear search is fastest
+    NameId result;
+    if (!find_name(name, result)) {
+        result = checked_narrow(names_.size());
+        names_.push_back(name);
+    }
+    return result;
+}
+
+bool CompactReadBatch::find_name(const std::string& name, NameId& result) const noexcept
+{
+    const auto itr = std::find(std::crbegin(names_), std::crend(names_), name);
+    if (itr == std::crend(names_)) return false;
+    result = static_cast<NameId>(std::distance(itr, std::crend(names_)) - 1);
+    return true;
+}
+
+bool CompactReadBatch::overlaps(const Record& record, const NameId contig, const GenomicRegion& region) const noexcept
+{
+    return record.contig == contig && octopus::overlaps(ContigRegion {record.begin, record.end}, region.contig_region());
+}
+
+std::vector<CompactReadBatch::Record>::const_iterator
+CompactReadBatch::find_first_possible_overlap(const GenomicRegion& region) const noexcept
+{
+    const auto min_begin = region.begin() > max_read_size_ ? region.begin() - max_read_size_ : 0;
+    return std::lower_bound(std::cbegin(records_), std::cend(records_), min_begin,
+                            [] (const Record& record, const GenomicRegion::Position position) noexcept {
+                                return record.begin < position; });
+}
+
+MemoryFootprint footprint(const CompactReadBatch& reads) noexcept
+{
+    return reads.footprint();
+}
+
+} // namespace octopus
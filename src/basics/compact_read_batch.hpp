@@ -0,0 +1,141 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef compact_read_batch_hpp
+#define compact_read_batch_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <iterator>
+#include <algorithm>
+
+#include "basics/genomic_region.hpp"
+#include "utils/memory_footprint.hpp"
+#include "aligned_read.hpp"
+
+namespace octopus {
+
+/*
+    CompactReadBatch is a memory efficient store for a batch of AlignedReads that are held for a
+    long time but rarely accessed, such as buffered reads.
+
+    Contig and read group names are interned per batch, and read names, bases (4-bit packed when
+    possible), qualities and cigars are stored in per-batch arenas, so storing a read costs no heap
+    allocations beyond amortised arena growth. Reads are decoded back into AlignedReads on access.
+
+    Reads should be added in sorted order, in which case overlap queries are logarithmic.
+
+    Optionally, the sequences and qualities of each block of reads are zlib compressed once the block
+    is full, and decompressed a block at a time on access. shrink_to_fit compresses the last block.
+ */
+class CompactReadBatch
+{
+public:
+    using size_type = std::size_t;
+
+    CompactReadBatch() = default;
+    explicit CompactReadBatch(bool compress);
+
+    template <typename InputIt>
+    CompactReadBatch(InputIt first, InputIt last, bool compress = false);
+
+    CompactReadBatch(const CompactReadBatch&)            = default;
+    CompactReadBatch& operator=(const CompactReadBatch&) = default;
+    CompactReadBatch(CompactReadBatch&&)                 = default;
+    CompactReadBatch& operator=(CompactReadBatch&&)      = default;
+
+    ~CompactReadBatch() = default;
+
+    bool empty() const noexcept;
+    size_type size() const noexcept;
+
+    void reserve(size_type n);
+    void push_back(const AlignedRead& read);
+    void clear() noexcept;
+    void shrink_to_fit();
+
+    AlignedRead decode(size_type idx) const;
+
+    // Decodes all reads overlapping region in batch order
+    template <typename OutputIt>
+    OutputIt decode_overlapped(const GenomicRegion& region, OutputIt result) const;
+
+    MemoryFootprint footprint() const noexcept;
+
+private:
+    using NameId = std::uint32_t;
+    using Offset = std::uint64_t;
+
+    struct Record
+    {
+        std::uint32_t begin, end;
+        NameId contig, read_group;
+        Offset data_offset;
+        std::uint32_t block, block_offset; // of the sequence and qualities, if compressed
+        std::uint32_t name_size, sequence_size;
+        std::uint32_t cigar_offset, cigar_size;
+        std::uint32_t next_segment_begin;
+        NameId next_segment_contig;
+        GenomicRegion::Size inferred_template_length;
+        std::uint16_t flags;
+        AlignedRead::MappingQuality mapping_quality;
+        std::uint8_t extra_flags;
+    };
+
+    std::vector<Record> records_ = {};
+    std::vector<char> data_ = {};
+    std::vector<std::uint32_t> cigars_ = {};
+    std::vector<std::string> names_ = {};
+    std::vector<std::string> blocks_ = {};
+    std::string open_block_ = {};
+    size_type open_block_size_ = 0;
+    GenomicRegion::Size max_read_size_ = 0;
+    bool is_sorted_ = true;
+    bool compress_ = false;
+
+    struct DecompressedBlock
+    {
+        size_type index = -1;
+        std::string data = {};
+    };
+
+    void compress_open_block();
+    AlignedRead decode(size_type idx, DecompressedBlock& block) const;
+    NameId intern(const std::string& name);
+    bool find_name(const std::string& name, NameId& result) const noexcept;
+    bool overlaps(const Record& record, NameId contig, const GenomicRegion& region) const noexcept;
+    std::vector<Record>::const_iterator find_first_possible_overlap(const GenomicRegion& region) const noexcept;
+};
+
+template <typename InputIt>
+CompactReadBatch::CompactReadBatch(InputIt first, InputIt last, const bool compress)
+: compress_ {compress}
+{
+    reserve(std::distance(first, last));
+    std::for_each(first, last, [this] (const AlignedRead& read) { push_back(read); });
+    if (compress_) shrink_to_fit();
+}
+
+template <typename OutputIt>
+OutputIt CompactReadBatch::decode_overlapped(const GenomicRegion& region, OutputIt result) const
+{
+    NameId contig;
+    if (!find_name(region.contig_name(), contig)) return result;
+    auto itr = is_sorted_ ? find_first_possible_overlap(region) : std::cbegin(records_);
+    DecompressedBlock block {};
+    for (; itr != std::cend(records_); ++itr) {
+        if (is_sorted_ && itr->begin > region.end()) break;
+        if (overlaps(*itr, contig, region)) {
+            *result++ = decode(static_cast<size_type>(std::distance(std::cbegin(records_), itr)), block);
+        }
+    }
+    return result;
+}
+
+MemoryFootprint footprint(const CompactReadBatch& reads) noexcept;
+
+} // namespace octopus
+
+#endif
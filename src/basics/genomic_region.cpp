@@ -0,0 +1,70 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "genomic_region.hpp"
+
+#include <unordered_set>
+#include <mutex>
+
+namespace octopus {
+
+namespace {
+
+class ContigNameTable
+{
+public:
+    ContigNameTable() : names_ {std::string {}}, mutex_ {} {}
+
+    // Never destroyed, so interned names outlive any static regions
+    static ContigNameTable& instance()
+    {
+        static auto* result = new ContigNameTable {};
+        return *result;
+    }
+
+    const std::string* intern(const std::string& name)
+    {
+        std::lock_guard<std::mutex> lock {mutex_};
+        return &*names_.insert(name).first; // node based, so pointers are stable
+    }
+
+    const std::string* empty() noexcept
+    {
+        return empty_;
+    }
+
+private:
+    std::unordered_set<std::string> names_;
+    std::mutex mutex_;
+    const std::string* empty_ = &*names_.find(std::string {});
+};
+
+} // namespace
+
+namespace detail {
+
+const std::string* intern_contig_name(const std::string& name)
+{
+    // Consecutive regions are nearly always on the same contig
+    thread_local const std::string* last {nullptr};
+    if (last == nullptr || (&name != last && name != *last)) {
+        last = ContigNameTable::instance().intern(name);
+    }
+    return last;
+}
+
+const std::string* empty_contig_name() noexcept
+{
+    static const auto* result = ContigNameTable::instance().empty();
+    return result;
+}
+
+} // namespace detail
+
+void intern_contig_names(const std::vector<std::string>& names)
+{
+    auto& table = ContigNameTable::instance();
+    for (const auto& name : names) table.intern(name);
+}
+
+} // namespace octopus
@@ -5,6 +5,7 @@
 #define genomic_region_hpp
 
 #include <string>
+#include <vector>
 #include <functional>
 #include <stdexcept>
 #include <ostream>
@@ -25,7 +26,30 @@ namespace octopus {
  
     All comparison operations (<, ==, is_before, etc) throw exceptions if the arguements
     are not from the same contig.
+ 
+    Contig names are interned in a global table, so regions only hold a pointer to the name
+    and contig comparisons are pointer comparisons.
 */
+class GenomicRegion;
+
+namespace detail {
+
+// Returns the unique interned copy of name, which is valid for the lifetime of the program
+const std::string* intern_contig_name(const std::string& name);
+
+template <typename T>
+const std::string* intern_contig_name(const T& name)
+{
+    return intern_contig_name(std::string(name));
+}
+
+const std::string* empty_contig_name() noexcept;
+
+} // namespace detail
+
+// Interns contig names ahead of use, e.g. all the contigs of the reference genome
+void intern_contig_names(const std::vector<std::string>& names);
+
 class GenomicRegion : public Comparable<GenomicRegion>
 {
 public:
@@ -56,7 +80,7 @@ public:
     Position end() const noexcept;
 
 private:
-    ContigName contig_name_;
+    const ContigName* contig_name_ = detail::empty_contig_name();
     ContigRegion contig_region_;
 };
 
@@ -89,19 +113,19 @@ private:
 
 template <typename T>
 GenomicRegion::GenomicRegion(T&& contig_name, const Position begin, const Position end)
-: contig_name_ {std::forward<T>(contig_name)}
+: contig_name_ {detail::intern_contig_name(contig_name)}
 , contig_region_ {begin, end}
 {}
 
 template <typename T, typename R>
 GenomicRegion::GenomicRegion(T&& contig_name, R&& contig_region)
-: contig_name_ {std::forward<T>(contig_name)}
+: contig_name_ {detail::intern_contig_name(contig_name)}
 , contig_region_ {std::forward<R>(contig_region)}
 {}
 
 inline const GenomicRegion::ContigName& GenomicRegion::contig_name() const noexcept
 {
-    return contig_name_;
+    return *contig_name_;
 }
 
 inline const ContigRegion& GenomicRegion::contig_region() const noexcept
@@ -159,7 +183,7 @@ inline bool is_position(const GenomicRegion& region) noexcept
 
 inline bool is_same_contig(const GenomicRegion& lhs, const GenomicRegion& rhs) noexcept
 {
-    return lhs.contig_name() == rhs.contig_name();
+    return &lhs.contig_name() == &rhs.contig_name(); // names are interned
 }
 
 inline bool begins_equal(const GenomicRegion& lhs, const GenomicRegion& rhs)
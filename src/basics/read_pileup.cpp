@@ -6,6 +6,7 @@
 #include <iterator>
 #include <algorithm>
 #include <numeric>
+#include <cstddef>
 
 #include "utils/append.hpp"
 #include "utils/mappable_algorithms.hpp"
@@ -36,16 +37,35 @@ unsigned ReadPileup::depth(const NucleotideSequence& sequence) const noexcept
     return this->summaries(sequence).size();
 }
 
+namespace {
+
+bool is_single_match(const CigarString& cigar) noexcept
+{
+    return cigar.size() == 1 && is_match(cigar.front());
+}
+
+} // namespace
+
 void ReadPileup::add(const AlignedRead& read)
 {
-    const GenomicRegion region {contig_name(read), region_};
-    auto sequence = copy_sequence(read, region);
+    NucleotideSequence sequence {};
+    std::vector<BaseQuality> base_qualities {};
+    if (is_single_match(read.cigar())) {
+        // Read and reference positions coincide, so there is no need to walk the cigar
+        const auto offset = static_cast<std::size_t>(region_.begin() - mapped_begin(read));
+        sequence.assign(1, read.sequence()[offset]);
+        base_qualities.assign(1, read.base_qualities()[offset]);
+    } else {
+        const GenomicRegion region {contig_name(read), region_};
+        sequence = copy_sequence(read, region);
+        base_qualities = copy_base_qualities(read, region);
+    }
     auto itr = std::find_if(std::next(std::begin(summaries_)), std::end(summaries_), [&] (const auto& p) { return p.first == sequence; });
     if (itr == std::cend(summaries_)) {
         summaries_.emplace_back(std::move(sequence), ReadSummaries {});
         itr = std::prev(std::end(summaries_));
     }
-    itr->second.push_back({copy_base_qualities(read, region), read.mapping_quality()});
+    itr->second.push_back({std::move(base_qualities), read.mapping_quality()});
 }
 
 std::vector<ReadPileup::NucleotideSequence> ReadPileup::sequences() const
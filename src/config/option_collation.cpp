@@ -15,6 +15,7 @@
 #include <utility>
 #include <thread>
 #include <sstream>
+#include <memory>
 
 #include <boost/filesystem/path.hpp>
 #include <boost/filesystem/operations.hpp>
@@ -25,8 +26,11 @@
 #include "utils/mappable_algorithms.hpp"
 #include "utils/string_utils.hpp"
 #include "utils/repeat_finder.hpp"
+#include "utils/tandem_repeat_index.hpp"
 #include "utils/append.hpp"
 #include "utils/maths.hpp"
+#include "utils/thread_pool.hpp"
+#include "utils/system_utils.hpp"
 #include "basics/phred.hpp"
 #include "basics/genomic_region.hpp"
 #include "basics/aligned_read.hpp"
@@ -238,6 +242,16 @@ boost::optional<unsigned> get_num_threads(const OptionMap& options)
     return boost::none;
 }
 
+bool pin_threads(const OptionMap& options) noexcept
+{
+    return options.at("pin-threads").as<bool>();
+}
+
+bool cache_read_profile(const OptionMap& options) noexcept
+{
+    return options.at("cache-read-profile").as<bool>();
+}
+
 ExecutionPolicy get_thread_execution_policy(const OptionMap& options)
 {
     if (is_set("threads", options)) {
@@ -256,6 +270,20 @@ MemoryFootprint get_target_read_buffer_size(const OptionMap& options)
     return options.at("target-read-buffer-footprint").as<MemoryFootprint>();
 }
 
+bool compress_read_buffer(const OptionMap& options)
+{
+    return options.at("compress-read-buffer").as<bool>();
+}
+
+boost::optional<MemoryFootprint> get_total_working_memory(const OptionMap& options)
+{
+    if (is_set("target-working-memory", options)) {
+        return options.at("target-working-memory").as<MemoryFootprint>();
+    } else {
+        return boost::none;
+    }
+}
+
 boost::optional<fs::path> get_debug_log_file_name(const OptionMap& options)
 {
     if (is_debug_mode(options)) {
@@ -274,6 +302,38 @@ boost::optional<fs::path> get_trace_log_file_name(const OptionMap& options)
     }
 }
 
+double get_log_sample_rate(const OptionMap& options)
+{
+    return options.at("log-sample-rate").as<float>();
+}
+
+boost::optional<fs::path> get_profile_file_name(const OptionMap& options)
+{
+    if (is_set("profile", options)) {
+        return resolve_path(options.at("profile").as<fs::path>(), options);
+    } else {
+        return boost::none;
+    }
+}
+
+boost::optional<fs::path> get_perf_trace_file_name(const OptionMap& options)
+{
+    if (is_set("perf-trace", options)) {
+        return resolve_path(options.at("perf-trace").as<fs::path>(), options);
+    } else {
+        return boost::none;
+    }
+}
+
+boost::optional<fs::path> get_live_metrics_file_name(const OptionMap& options)
+{
+    if (is_set("live-metrics", options)) {
+        return resolve_path(options.at("live-metrics").as<fs::path>(), options);
+    } else {
+        return boost::none;
+    }
+}
+
 bool is_fast_mode(const OptionMap& options)
 {
     return options.at("fast").as<bool>() || options.at("very-fast").as<bool>();
@@ -284,6 +344,17 @@ bool is_very_fast_mode(const OptionMap& options)
     return options.at("very-fast").as<bool>();
 }
 
+boost::optional<double> get_target_throughput(const OptionMap& options, const InputRegionMap& regions)
+{
+    if (is_set("target-throughput", options)) {
+        return 1e6 * options.at("target-throughput").as<float>() / 3600;
+    } else if (is_set("time-budget", options)) {
+        return sum_region_sizes(regions) / (3600.0 * options.at("time-budget").as<float>());
+    } else {
+        return boost::none;
+    }
+}
+
 ReferenceGenome make_reference(const OptionMap& options)
 {
     const fs::path input_path {options.at("reference").as<fs::path>()};
@@ -311,7 +382,18 @@ ReferenceGenome make_reference(const OptionMap& options)
         }
     }
     try {
-        return octopus::make_reference(std::move(resolved_path), ref_cache_size, is_threading_allowed(options));
+        auto result = octopus::make_reference(std::move(resolved_path), ref_cache_size, is_threading_allowed(options),
+                                              true, true, options.at("memory-map-reference").as<bool>());
+        if (options.count("tandem-repeat-index") == 1) {
+            const auto index_path = resolve_path(options.at("tandem-repeat-index").as<fs::path>(), options);
+            if (!fs::exists(index_path)) {
+                logging::InfoLogger info_log {};
+                stream(info_log) << "Building tandem repeat index " << index_path;
+                build_tandem_repeat_index(result, index_path);
+            }
+            result.set_tandem_repeat_index(std::make_shared<const TandemRepeatIndex>(index_path));
+        }
+        return result;
     } catch (MissingFileError& e) {
         e.set_location_specified("the command line option --reference");
         throw;
@@ -492,6 +574,21 @@ auto transform_to_zero_based(std::vector<GenomicRegion>&& one_based_regions)
     return result;
 }
 
+std::vector<GenomicRegion> get_snapshot_regions(const OptionMap& options, const ReferenceGenome& reference)
+{
+    if (!is_set("snapshot-region", options)) return {};
+    auto result = parse_regions(options.at("snapshot-region").as<std::vector<std::string>>(), reference);
+    if (options.at("one-based-indexing").as<bool>()) {
+        return transform_to_zero_based(std::move(result));
+    }
+    return result;
+}
+
+fs::path get_snapshot_directory(const OptionMap& options)
+{
+    return resolve_path(options.at("snapshot-directory").as<fs::path>(), options);
+}
+
 auto transform_to_zero_based(InputRegionMap::mapped_type&& one_based_regions)
 {
     MappableFlatSet<GenomicRegion> result {};
@@ -520,6 +617,79 @@ public:
     MissingRegionPathFile(fs::path p) : MissingFileError {std::move(p), "region path"} {};
 };
 
+class MissingShardManifestFile : public MissingFileError
+{
+    std::string do_where() const override
+    {
+        return "get_search_regions";
+    }
+public:
+    MissingShardManifestFile(fs::path p) : MissingFileError {std::move(p), "shard manifest"} {};
+};
+
+class BadShardIndex : public UserError
+{
+    std::string do_where() const override
+    {
+        return "get_search_regions";
+    }
+    std::string do_why() const override
+    {
+        std::ostringstream ss {};
+        ss << "The shard " << shard_ << " is not in the shard manifest " << manifest_
+           << ", which has " << num_shards_ << " shards";
+        return ss.str();
+    }
+    std::string do_help() const override
+    {
+        return "Use a zero based shard index that is less than the number of shards in the manifest";
+    }
+    
+    unsigned shard_;
+    std::size_t num_shards_;
+    fs::path manifest_;
+public:
+    BadShardIndex(unsigned shard, std::size_t num_shards, fs::path manifest)
+    : shard_ {shard}, num_shards_ {num_shards}, manifest_ {std::move(manifest)} {}
+};
+
+// Shard regions are zero based as they are written by octopus
+InputRegionMap get_shard_search_regions(const OptionMap& options, const ReferenceGenome& reference,
+                                        std::vector<GenomicRegion>& skip_regions)
+{
+    const auto manifest_path = *get_shard_manifest(options);
+    if (!fs::exists(manifest_path)) {
+        MissingShardManifestFile e {manifest_path};
+        e.set_location_specified("the command line option '--shard-manifest'");
+        throw e;
+    }
+    const auto manifest = read_shard_manifest(manifest_path, reference);
+    const auto shard = as_unsigned("shard", options);
+    if (shard >= manifest.size()) {
+        throw BadShardIndex {shard, manifest.size(), manifest_path};
+    }
+    return extract_search_regions(manifest[shard].padded_regions, skip_regions);
+}
+
+// Sites closer than twice the padding are grouped into one region, so they are called together with shared reads
+std::vector<GenomicRegion> extract_regenotype_regions(const fs::path& regenotype_path, const ReferenceGenome& reference)
+{
+    constexpr GenomicRegion::Distance sitePadding {50};
+    const VcfReader regenotype_vcf {regenotype_path};
+    std::vector<GenomicRegion> result {};
+    auto p = regenotype_vcf.iterate(VcfReader::UnpackPolicy::minimal);
+    std::for_each(std::move(p.first), std::move(p.second), [&] (const VcfRecord& site) {
+        if (reference.has_contig(site.chrom())) {
+            const auto contig_region = reference.contig_region(site.chrom());
+            const auto site_region = expand(mapped_region(site), sitePadding);
+            if (overlaps(contig_region, site_region)) {
+                result.push_back(*overlapped_region(contig_region, site_region));
+            }
+        }
+    });
+    return result;
+}
+
 InputRegionMap get_search_regions(const OptionMap& options, const ReferenceGenome& reference)
 {
     using namespace utils;
@@ -547,9 +717,15 @@ InputRegionMap get_search_regions(const OptionMap& options, const ReferenceGenom
     if (options.at("one-based-indexing").as<bool>()) {
         skip_regions = transform_to_zero_based(std::move(skip_regions));
     }
+    if (is_set("shard", options)) {
+        return get_shard_search_regions(options, reference, skip_regions);
+    }
     if (!is_set("regions", options) && !is_set("regions-file", options)) {
         if (is_set("regenotype", options)) {
-            // TODO: only extract regions in the regenotype VCF
+            const auto regenotype_path = resolve_path(options.at("regenotype").as<fs::path>(), options);
+            if (fs::exists(regenotype_path)) {
+                return extract_search_regions(extract_regenotype_regions(regenotype_path, reference), skip_regions);
+            }
         }
         return extract_search_regions(reference, skip_regions);
     }
@@ -581,6 +757,11 @@ InputRegionMap get_search_regions(const OptionMap& options, const ReferenceGenom
     return result;
 }
 
+GenomicRegion::Size get_min_skipped_reference_gap(const OptionMap& options)
+{
+    return as_unsigned("min-skipped-reference-gap", options);
+}
+
 ContigOutputOrder get_contig_output_order(const OptionMap& options)
 {
     return options.at("contig-output-order").as<ContigOutputOrder>();
@@ -679,11 +860,82 @@ unsigned count_read_paths(const OptionMap& options)
     return get_read_paths(options, false).size();
 }
 
+unsigned get_num_decompression_threads(const OptionMap& options)
+{
+    auto num_threads = get_num_threads(options);
+    if (!num_threads) {
+        num_threads = std::thread::hardware_concurrency();
+    }
+    // A single threaded run decompresses on the calling thread
+    return *num_threads > 1 ? *num_threads : 0;
+}
+
+unsigned get_num_compression_threads(const OptionMap& options)
+{
+    // Output is only compressed by the htslib pool in multithreaded runs, as for read decompression
+    return get_num_decompression_threads(options);
+}
+
+unsigned get_num_read_fetch_threads(const OptionMap& options, const std::size_t num_read_files)
+{
+    auto num_threads = get_num_threads(options);
+    if (!num_threads) {
+        num_threads = std::thread::hardware_concurrency();
+    }
+    // More threads than files would just sit idle
+    const auto result = std::min(*num_threads, static_cast<unsigned>(num_read_files));
+    return result > 1 ? result : 0;
+}
+
 ReadManager make_read_manager(const OptionMap& options)
 {
     auto read_paths = get_read_paths(options);
     const auto max_open_files = as_unsigned("max-open-read-files", options);
-    return ReadManager {std::move(read_paths), max_open_files};
+    const auto num_fetch_threads = get_num_read_fetch_threads(options, read_paths.size());
+    boost::optional<fs::path> manifest {};
+    if (is_set("read-manifest", options)) {
+        manifest = resolve_path(options.at("read-manifest").as<fs::path>(), options);
+    }
+    auto reference = resolve_path(options.at("reference").as<fs::path>(), options);
+    return ReadManager {std::move(read_paths), max_open_files, get_num_decompression_threads(options),
+                        num_fetch_threads, std::move(manifest), std::move(reference)};
+}
+
+class MissingBatchFile : public MissingFileError
+{
+    std::string do_where() const override
+    {
+        return "get_batch_jobs";
+    }
+public:
+    MissingBatchFile(fs::path p) : MissingFileError {std::move(p), "batch"} {};
+};
+
+boost::optional<std::vector<BatchJob>> get_batch_jobs(const OptionMap& options)
+{
+    if (!is_set("batch", options)) return boost::none;
+    const auto batch_path = resolve_path(options.at("batch").as<fs::path>(), options);
+    std::ifstream file {batch_path.string()};
+    if (!file) {
+        MissingBatchFile e {batch_path};
+        e.set_location_specified("the command line option '--batch'");
+        throw e;
+    }
+    std::vector<BatchJob> result {};
+    std::string line {};
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line.front() == '#') continue;
+        result.push_back(boost::program_options::split_unix(line));
+    }
+    return result;
+}
+
+bool have_same_inputs(const OptionMap& lhs, const OptionMap& rhs)
+{
+    return resolve_path(lhs.at("reference").as<fs::path>(), lhs) == resolve_path(rhs.at("reference").as<fs::path>(), rhs)
+        && get_read_paths(lhs, false) == get_read_paths(rhs, false)
+        && get_user_samples(lhs) == get_user_samples(rhs);
 }
 
 bool allow_assembler_generation(const OptionMap& options)
@@ -745,9 +997,12 @@ auto make_read_transformers(const ReferenceGenome& reference, const OptionMap& o
         if (options.at("mask-3prime-shifted-soft-clipped-heads").as<bool>()) {
             prefilter_transformer.add(Mask3PrimeShiftedSoftClippedHeads {reference, 10, 500});
         }
-        prefilter_transformer.shrink_to_fit();
-        postfilter_transformer.shrink_to_fit();
     }
+    if (options.at("cache-read-mismatches").as<bool>()) {
+        postfilter_transformer.add(AnnotateReferenceMismatches {reference});
+    }
+    prefilter_transformer.shrink_to_fit();
+    postfilter_transformer.shrink_to_fit();
     return std::make_pair(std::move(prefilter_transformer), std::move(postfilter_transformer));
 }
 
@@ -840,15 +1095,38 @@ boost::optional<readpipe::Downsampler> make_downsampler(const OptionMap& options
     return boost::none;
 }
 
+unsigned get_num_read_transform_threads(const OptionMap& options, const std::size_t num_samples)
+{
+    auto num_threads = get_num_threads(options);
+    if (!num_threads) {
+        num_threads = std::thread::hardware_concurrency();
+    }
+    // Samples are transformed independently, so more threads than samples would sit idle
+    const auto result = std::min(*num_threads, static_cast<unsigned>(num_samples));
+    return result > 1 ? result : 0;
+}
+
 ReadPipe make_read_pipe(ReadManager& read_manager, const ReferenceGenome& reference, std::vector<SampleName> samples, const OptionMap& options)
 {
     auto transformers = make_read_transformers(reference, options);
+    const auto num_transform_threads = get_num_read_transform_threads(options, samples.size());
     if (transformers.second.num_transforms() > 0) {
-        return ReadPipe {read_manager, std::move(transformers.first), make_read_filterer(options),
+        ReadPipe result {read_manager, std::move(transformers.first), make_read_filterer(options),
                          std::move(transformers.second), make_downsampler(options), std::move(samples)};
+        result.set_num_transform_threads(num_transform_threads);
+        if (options.at("share-task-boundary-reads").as<bool>()) {
+            // Callers pad call regions by 100bp, so adjacent task fetches overlap by twice that
+            result.share_fetch_edges(200);
+        }
+        return result;
     } else {
-        return ReadPipe {read_manager, std::move(transformers.first), make_read_filterer(options),
+        ReadPipe result {read_manager, std::move(transformers.first), make_read_filterer(options),
                          make_downsampler(options), std::move(samples)};
+        result.set_num_transform_threads(num_transform_threads);
+        if (options.at("share-task-boundary-reads").as<bool>()) {
+            result.share_fetch_edges(200);
+        }
+        return result;
     }
 }
 
@@ -1017,7 +1295,78 @@ auto get_max_expected_heterozygosity(const OptionMap& options)
     return std::min(static_cast<double>(heterozygosity + 2 * heterozygosity_stdev), 0.9999);
 }
 
-auto make_variant_generator_builder(const OptionMap& options)
+std::vector<fs::path> get_source_candidate_paths(const OptionMap& options)
+{
+    const auto output_path = get_output_path(options);
+    std::vector<fs::path> source_paths {};
+    if (is_set("source-candidates", options)) {
+        source_paths = resolve_paths(options.at("source-candidates").as<std::vector<fs::path>>(), options);
+    }
+    if (is_set("source-candidates-file", options)) {
+        auto paths_to_source_paths = options.at("source-candidates-file").as<std::vector<fs::path>>();
+        for (auto& path_to_source_paths : paths_to_source_paths) {
+            path_to_source_paths = resolve_path(path_to_source_paths, options);
+            if (!fs::exists(path_to_source_paths)) {
+                throw MissingSourceVariantFileOfPaths {path_to_source_paths};
+            }
+            auto file_sources_paths = get_resolved_paths_from_file(path_to_source_paths, options);
+            if (file_sources_paths.empty()) {
+                logging::WarningLogger log {};
+                stream(log) << "The source candidate path file you specified " << path_to_source_paths
+                            << " in the command line option '--source-candidates-file' is empty";
+            }
+            utils::append(std::move(file_sources_paths), source_paths);
+        }
+    }
+    remove_duplicates(source_paths, "source variant");
+    for (const auto& source_path : source_paths) {
+        if (!fs::exists(source_path)) {
+            throw MissingSourceVariantFile {source_path};
+        }
+        if (output_path && source_path == *output_path) {
+            throw ConflictingSourceVariantFile {std::move(source_path), *output_path};
+        }
+    }
+    return source_paths;
+}
+
+coretools::VcfExtractor::Options get_source_candidate_options(const OptionMap& options)
+{
+    coretools::VcfExtractor::Options result {};
+    result.max_variant_size = as_unsigned("max-variant-size", options);
+    if (is_set("min-source-quality", options)) {
+        result.min_quality = options.at("min-source-quality").as<Phred<double>>().score();
+    }
+    result.extract_filtered = options.at("use-filtered-source-candidates").as<bool>();
+    return result;
+}
+
+bool is_usable_index(const fs::path& index_path, const fs::path& source_path, const coretools::VcfExtractor::Options& options)
+{
+    if (!fs::exists(index_path) || fs::last_write_time(index_path) < fs::last_write_time(source_path)) return false;
+    const VariantIndex index {index_path};
+    return index.options().extract_filtered == options.extract_filtered && index.options().min_quality == options.min_quality;
+}
+
+// Each source is indexed next to itself, and the index is rebuilt if the source is newer or was indexed with other options
+std::vector<std::shared_ptr<const VariantIndex>> get_source_candidate_indices(const OptionMap& options)
+{
+    const auto vcf_options = get_source_candidate_options(options);
+    std::vector<std::shared_ptr<const VariantIndex>> result {};
+    for (const auto& source_path : get_source_candidate_paths(options)) {
+        auto index_path = source_path;
+        index_path += ".ovi";
+        if (!is_usable_index(index_path, source_path, vcf_options)) {
+            logging::InfoLogger info_log {};
+            stream(info_log) << "Building variant index " << index_path;
+            coretools::build_variant_index(VcfReader {source_path}, index_path, vcf_options);
+        }
+        result.push_back(std::make_shared<const VariantIndex>(index_path));
+    }
+    return result;
+}
+
+auto make_variant_generator_builder(const OptionMap& options, std::shared_ptr<ThreadPool> workers)
 {
     using namespace coretools;
     
@@ -1025,9 +1374,11 @@ auto make_variant_generator_builder(const OptionMap& options)
     logging::ErrorLogger log {};
     
     VariantGeneratorBuilder result {};
-    const bool use_assembler {allow_assembler_generation(options)};
+    // Regenotyping only considers the given sites, so candidates are not discovered from reads
+    const bool discover_candidates {!is_set("regenotype", options)};
+    const bool use_assembler {discover_candidates && allow_assembler_generation(options)};
     
-    if (options.at("raw-cigar-candidate-generator").as<bool>()) {
+    if (discover_candidates && options.at("raw-cigar-candidate-generator").as<bool>()) {
         CigarScanner::Options scanner_options {};
         if (is_set("min-supporting-reads", options)) {
             auto min_support = as_unsigned("min-supporting-reads", options);
@@ -1050,9 +1401,10 @@ auto make_variant_generator_builder(const OptionMap& options)
             misalign_params.min_ln_prob_correctly_aligned = std::log(0.005);
         }
         scanner_options.misalignment_parameters = misalign_params;
+        scanner_options.workers = workers;
         result.set_cigar_scanner(std::move(scanner_options));
     }
-    if (options.at("repeat-candidate-generator").as<bool>()) {
+    if (discover_candidates && options.at("repeat-candidate-generator").as<bool>()) {
         result.set_repeat_scanner(RepeatScanner::Options {});
     }
     if (use_assembler) {
@@ -1062,54 +1414,30 @@ auto make_variant_generator_builder(const OptionMap& options)
         if (is_set("assembler-mask-base-quality", options)) {
             reassembler_options.mask_threshold = as_unsigned("assembler-mask-base-quality", options);
         }
-        reassembler_options.execution_policy = get_thread_execution_policy(options);
+        reassembler_options.workers = std::move(workers);
         reassembler_options.num_fallbacks = as_unsigned("num-fallback-kmers", options);
         reassembler_options.fallback_interval_size = as_unsigned("fallback-kmer-gap", options);
+        reassembler_options.stop_at_first_assembled_kmer = options.at("stop-at-first-assembled-kmer").as<bool>();
         reassembler_options.bin_size = as_unsigned("max-region-to-assemble", options);
         reassembler_options.bin_overlap = as_unsigned("max-assemble-region-overlap", options);
         reassembler_options.min_kmer_observations = as_unsigned("min-kmer-prune", options);
+        reassembler_options.mask_low_count_kmers = options.at("assembler-mask-low-count-kmers").as<bool>();
         reassembler_options.max_bubbles = as_unsigned("max-bubbles", options);
         reassembler_options.min_bubble_score = get_assembler_bubble_score_setter(options);
         reassembler_options.max_variant_size = as_unsigned("max-variant-size", options);
+        reassembler_options.min_sample_evidence = as_unsigned("assembler-min-sample-evidence", options);
         result.set_local_reassembler(std::move(reassembler_options));
     }
     if (is_set("source-candidates", options) || is_set("source-candidates-file", options)) {
-        const auto output_path = get_output_path(options);
-        std::vector<fs::path> source_paths {};
-        if (is_set("source-candidates", options)) {
-            source_paths = resolve_paths(options.at("source-candidates").as<std::vector<fs::path>>(), options);
-        }
-        if (is_set("source-candidates-file", options)) {
-            auto paths_to_source_paths = options.at("source-candidates-file").as<std::vector<fs::path>>();
-            for (auto& path_to_source_paths : paths_to_source_paths) {
-                path_to_source_paths = resolve_path(path_to_source_paths, options);
-                if (!fs::exists(path_to_source_paths)) {
-                    throw MissingSourceVariantFileOfPaths {path_to_source_paths};
-                }
-                auto file_sources_paths = get_resolved_paths_from_file(path_to_source_paths, options);
-                if (file_sources_paths.empty()) {
-                    logging::WarningLogger log {};
-                    stream(log) << "The source candidate path file you specified " << path_to_source_paths
-                                << " in the command line option '--source-candidates-file' is empty";
-                }
-                utils::append(std::move(file_sources_paths), source_paths);
-            }
-        }
-        remove_duplicates(source_paths, "source variant");
-        for (const auto& source_path : source_paths) {
-            if (!fs::exists(source_path)) {
-                throw MissingSourceVariantFile {source_path};
-            }
-            if (output_path && source_path == *output_path) {
-                throw ConflictingSourceVariantFile {std::move(source_path), *output_path};
+        if (options.at("index-source-candidates").as<bool>()) {
+            for (auto& index : get_source_candidate_indices(options)) {
+                result.add_vcf_extractor(std::move(index));
             }
-            VcfExtractor::Options vcf_options {};
-            vcf_options.max_variant_size = as_unsigned("max-variant-size", options);
-            if (is_set("min-source-quality", options)) {
-                vcf_options.min_quality = options.at("min-source-quality").as<Phred<double>>().score();
+        } else {
+            const auto vcf_options = get_source_candidate_options(options);
+            for (auto& source_path : get_source_candidate_paths(options)) {
+                result.add_vcf_extractor(std::move(source_path), vcf_options);
             }
-            vcf_options.extract_filtered = options.at("use-filtered-source-candidates").as<bool>();
-            result.add_vcf_extractor(std::move(source_path), vcf_options);
         }
     }
     if (is_set("regenotype", options)) {
@@ -1350,6 +1678,12 @@ auto get_min_flank_pad() noexcept
     return 2 * (2 * HaplotypeLikelihoodModel{}.pad_requirement() - 1);
 }
 
+auto get_haplotype_overflow_policy(const OptionMap& options) noexcept
+{
+    using OverflowPolicy = HaplotypeGenerator::Policies::Overflow;
+    return options.at("skip-overflow-regions").as<bool>() ? OverflowPolicy::skip : OverflowPolicy::prune;
+}
+
 auto make_haplotype_generator_builder(const OptionMap& options, const boost::optional<ReadSetProfile>& input_reads_profile)
 {
     const auto lagging_policy    = get_lagging_policy(options);
@@ -1357,12 +1691,16 @@ auto make_haplotype_generator_builder(const OptionMap& options, const boost::opt
     const auto holdout_limit     = as_unsigned("haplotype-holdout-threshold", options);
     const auto overflow_limit    = as_unsigned("haplotype-overflow", options);
     const auto max_holdout_depth = as_unsigned("max-holdout-depth", options);
-    return HaplotypeGenerator::Builder().set_extension_policy(get_extension_policy(options))
+    auto result = HaplotypeGenerator::Builder().set_extension_policy(get_extension_policy(options))
     .set_target_limit(max_haplotypes).set_holdout_limit(holdout_limit).set_overflow_limit(overflow_limit)
+    .set_overflow_policy(get_haplotype_overflow_policy(options))
     .set_lagging_policy(lagging_policy).set_max_holdout_depth(max_holdout_depth)
     .set_max_indicator_join_distance(get_max_indicator_join_distance())
     .set_dense_variation_detector(get_dense_variation_detector(options, input_reads_profile))
     .set_min_flank_pad(get_min_flank_pad());
+    const auto long_read_flank = as_unsigned("long-read-flank", options);
+    if (long_read_flank > 0) result.set_max_read_flank(long_read_flank);
+    return result;
 }
 
 boost::optional<Pedigree> read_ped_file(const OptionMap& options)
@@ -1648,6 +1986,7 @@ HaplotypeLikelihoodModel make_likelihood_model(const OptionMap& options, const b
     HaplotypeLikelihoodModel::Config config {};
     config.use_mapping_quality = options.at("model-mapping-quality").as<bool>();
     config.use_flank_state = allow_flank_scoring(options);
+    config.pair_hmm_band_size = options.at("pair-hmm-band-size").as<int>();
     if (config.use_mapping_quality) {
         config.mapping_quality_cap = calculate_mapping_quality_cap(options, read_profile);
         config.mapping_quality_cap_trigger = calculate_mapping_quality_cap_trigger(options, read_profile);
@@ -1686,6 +2025,20 @@ auto get_target_working_memory(const OptionMap& options)
     return result;
 }
 
+std::shared_ptr<ThreadPool> make_workers(const OptionMap& options)
+{
+    auto num_threads = get_num_threads(options);
+    if (!num_threads) {
+        num_threads = std::thread::hardware_concurrency();
+    }
+    if (*num_threads < 2) return nullptr;
+    // The calling thread also does work when the workers are used
+    if (pin_threads(options)) {
+        return std::make_shared<ThreadPool>(*num_threads - 1, assign_thread_cpus(*num_threads - 1));
+    }
+    return std::make_shared<ThreadPool>(*num_threads - 1);
+}
+
 bool is_experimental_caller(const std::string& caller) noexcept
 {
     return caller == "population" || caller == "polyclone" || caller == "cell";
@@ -1695,8 +2048,10 @@ CallerFactory make_caller_factory(const ReferenceGenome& reference, ReadPipe& re
                                   const InputRegionMap& regions, const OptionMap& options,
                                   const boost::optional<ReadSetProfile> read_profile)
 {
+    // Likelihood evaluation and local assembly share one pool so the thread count stays bounded
+    const auto workers = make_workers(options);
     CallerBuilder vc_builder {reference, read_pipe,
-                              make_variant_generator_builder(options),
+                              make_variant_generator_builder(options, workers),
                               make_haplotype_generator_builder(options, read_profile)};
 	const auto pedigree = read_ped_file(options);
     const auto caller = get_caller_type(options, read_pipe.samples(), pedigree);
@@ -1748,6 +2103,12 @@ CallerFactory make_caller_factory(const ReferenceGenome& reference, ReadPipe& re
     }
     vc_builder.set_model_based_haplotype_dedup(options.at("dedup-haplotypes-with-prior-model").as<bool>());
     vc_builder.set_independent_genotype_prior_flag(options.at("use-independent-genotype-priors").as<bool>());
+    if (options.at("source-candidate-frequencies").as<bool>()) {
+        auto indices = get_source_candidate_indices(options);
+        indices.erase(std::remove_if(std::begin(indices), std::end(indices), [] (const auto& index) { return !index->has_frequencies(); }),
+                      std::end(indices));
+        vc_builder.set_prior_variant_frequencies(std::move(indices));
+    }
     if (caller == "cancer") {
         if (is_set("normal-sample", options)) {
             vc_builder.set_normal_sample(options.at("normal-sample").as<std::string>());
@@ -1771,6 +2132,7 @@ CallerFactory make_caller_factory(const ReferenceGenome& reference, ReadPipe& re
         vc_builder.set_max_clones(as_unsigned("max-clones", options));
     } else if (caller == "cell") {
         vc_builder.set_dropout_concentration(options.at("dropout-concentration").as<float>());
+        vc_builder.set_max_phylogeny_size(as_unsigned("max-phylogeny-size", options));
         vc_builder.set_somatic_snv_mutation_rate(options.at("somatic-snv-mutation-rate").as<float>());
         vc_builder.set_somatic_indel_mutation_rate(options.at("somatic-indel-mutation-rate").as<float>());
     }
@@ -1789,6 +2151,14 @@ CallerFactory make_caller_factory(const ReferenceGenome& reference, ReadPipe& re
     const auto target_working_memory = get_target_working_memory(options);
     if (target_working_memory) vc_builder.set_target_memory_footprint(*target_working_memory);
     vc_builder.set_execution_policy(get_thread_execution_policy(options));
+    vc_builder.set_likelihood_workers(workers);
+    vc_builder.set_likelihood_cache_size(as_unsigned("likelihood-cache-size", options));
+    vc_builder.set_staged_likelihood_reads(as_unsigned("staged-likelihood-reads", options));
+    vc_builder.set_local_likelihood_reuse(options.at("reuse-local-likelihoods").as<bool>());
+    vc_builder.set_latent_warm_start(options.at("warm-start-genotype-models").as<bool>());
+    vc_builder.set_reference_triage(as_unsigned("reference-triage-min-support", options));
+    vc_builder.set_long_read_flank(as_unsigned("long-read-flank", options));
+    vc_builder.set_active_region_pipelining(options.at("pipeline-active-regions").as<bool>());
     return CallerFactory {std::move(vc_builder)};
 }
 
@@ -1963,6 +2333,11 @@ bool keep_unfiltered_calls(const OptionMap& options) noexcept
     return options.at("keep-unfiltered-calls").as<bool>();
 }
 
+bool fuse_call_filtering(const OptionMap& options) noexcept
+{
+    return options.at("fuse-call-filtering").as<bool>() && !keep_unfiltered_calls(options);
+}
+
 ReadPipe make_default_filter_read_pipe(ReadManager& read_manager, std::vector<SampleName> samples)
 {
     using std::make_unique;
@@ -2111,6 +2486,25 @@ fs::path create_temp_file_directory(const OptionMap& options)
     return result;
 }
 
+boost::optional<fs::path> get_checkpoint_directory(const OptionMap& options)
+{
+    if (is_set("checkpoint-directory", options)) {
+        auto result = resolve_path(options.at("checkpoint-directory").as<fs::path>(), options);
+        boost::system::error_code error_code {};
+        fs::create_directories(result, error_code);
+        if (error_code != boost::system::errc::success) {
+            throw UnwritableTempDirectory {result, error_code};
+        }
+        return result;
+    }
+    return boost::none;
+}
+
+bool resume_from_checkpoint(const OptionMap& options) noexcept
+{
+    return options.at("resume").as<bool>();
+}
+
 bool is_legacy_vcf_requested(const OptionMap& options)
 {
     return options.at("legacy").as<bool>();
@@ -2154,6 +2548,7 @@ unsigned estimate_max_open_files(const OptionMap& options)
     if (get_output_path(options)) result += 2;
     result += is_debug_mode(options);
     result += is_trace_mode(options);
+    result += is_set("perf-trace", options);
     result += is_call_filtering_requested(options);
     result += is_legacy_vcf_requested(options);
     return result;
@@ -2167,5 +2562,37 @@ boost::optional<fs::path> data_profile_request(const OptionMap& options)
     return boost::none;
 }
 
+double data_profile_fraction(const OptionMap& options)
+{
+    return options.at("data-profile-fraction").as<float>();
+}
+
+boost::optional<fs::path> get_shard_manifest(const OptionMap& options)
+{
+    if (is_set("shard-manifest", options)) {
+        return resolve_path(options.at("shard-manifest").as<fs::path>(), options);
+    }
+    return boost::none;
+}
+
+boost::optional<ShardingConfig> shard_manifest_request(const OptionMap& options)
+{
+    if (is_set("shards", options)) {
+        ShardingConfig result {};
+        result.num_shards = as_unsigned("shards", options);
+        result.padding = as_unsigned("shard-padding", options);
+        return result;
+    }
+    return boost::none;
+}
+
+std::vector<fs::path> merge_shards_request(const OptionMap& options)
+{
+    if (is_set("merge-shards", options)) {
+        return resolve_paths(options.at("merge-shards").as<std::vector<fs::path>>(), options);
+    }
+    return {};
+}
+
 } // namespace options
 } // namespace octopus
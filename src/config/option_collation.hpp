@@ -16,6 +16,7 @@
 #include "basics/ploidy_map.hpp"
 #include "core/callers/caller_factory.hpp"
 #include "core/csr/filters/variant_call_filter_factory.hpp"
+#include "core/tools/shard_manifest.hpp"
 #include "io/reference/reference_genome.hpp"
 #include "io/read/read_manager.hpp"
 #include "io/variant/vcf_writer.hpp"
@@ -34,15 +35,40 @@ bool is_trace_mode(const OptionMap& options);
 
 boost::optional<fs::path> get_debug_log_file_name(const OptionMap& options);
 boost::optional<fs::path> get_trace_log_file_name(const OptionMap& options);
+double get_log_sample_rate(const OptionMap& options);
+boost::optional<fs::path> get_profile_file_name(const OptionMap& options);
+boost::optional<fs::path> get_perf_trace_file_name(const OptionMap& options);
+std::vector<GenomicRegion> get_snapshot_regions(const OptionMap& options, const ReferenceGenome& reference);
+fs::path get_snapshot_directory(const OptionMap& options);
+
+// The extra command line arguments of each batch job
+using BatchJob = std::vector<std::string>;
+boost::optional<std::vector<BatchJob>> get_batch_jobs(const OptionMap& options);
+boost::optional<fs::path> get_live_metrics_file_name(const OptionMap& options);
 
 boost::optional<unsigned> get_num_threads(const OptionMap& options);
 
+unsigned get_num_compression_threads(const OptionMap& options);
+
+bool pin_threads(const OptionMap& options) noexcept;
+
+bool cache_read_profile(const OptionMap& options) noexcept;
+
 MemoryFootprint get_target_read_buffer_size(const OptionMap& options);
+bool compress_read_buffer(const OptionMap& options);
+
+boost::optional<MemoryFootprint> get_total_working_memory(const OptionMap& options);
 
 ReferenceGenome make_reference(const OptionMap& options);
 
 InputRegionMap get_search_regions(const OptionMap& options, const ReferenceGenome& reference);
 
+// In bases per second, if the user requested a throughput or time budget to tune for
+boost::optional<double> get_target_throughput(const OptionMap& options, const InputRegionMap& regions);
+
+// Zero if reference gaps should not be skipped
+GenomicRegion::Size get_min_skipped_reference_gap(const OptionMap& options);
+
 ContigOutputOrder get_contig_output_order(const OptionMap& options);
 
 bool ignore_unmapped_contigs(const OptionMap& options);
@@ -51,6 +77,9 @@ boost::optional<std::vector<SampleName>> get_user_samples(const OptionMap& optio
 
 ReadManager make_read_manager(const OptionMap& options);
 
+// True if the reference and read manager made for one set of options can be used for the other
+bool have_same_inputs(const OptionMap& lhs, const OptionMap& rhs);
+
 ReadPipe make_read_pipe(ReadManager& read_manager, const ReferenceGenome& reference, std::vector<SampleName> samples, const OptionMap& options);
 
 bool call_sites_only(const OptionMap& options);
@@ -73,12 +102,17 @@ bool use_calling_read_pipe_for_call_filtering(const OptionMap& options) noexcept
 
 bool keep_unfiltered_calls(const OptionMap& options) noexcept;
 
+bool fuse_call_filtering(const OptionMap& options) noexcept;
+
 ReadPipe make_call_filter_read_pipe(ReadManager& read_manager, const ReferenceGenome& reference, std::vector<SampleName> samples, const OptionMap& options);
 
 boost::optional<fs::path> get_output_path(const OptionMap& options);
 
 fs::path create_temp_file_directory(const OptionMap& options);
 
+boost::optional<fs::path> get_checkpoint_directory(const OptionMap& options);
+bool resume_from_checkpoint(const OptionMap& options) noexcept;
+
 bool is_legacy_vcf_requested(const OptionMap& options);
 
 bool is_filter_training_mode(const OptionMap& options);
@@ -92,6 +126,11 @@ bool full_bamouts_requested(const OptionMap& options);
 unsigned estimate_max_open_files(const OptionMap& options);
 
 boost::optional<fs::path> data_profile_request(const OptionMap& options);
+double data_profile_fraction(const OptionMap& options);
+
+boost::optional<fs::path> get_shard_manifest(const OptionMap& options);
+boost::optional<ShardingConfig> shard_manifest_request(const OptionMap& options);
+std::vector<fs::path> merge_shards_request(const OptionMap& options);
 
 } // namespace options
 } // namespace octopus
@@ -34,8 +34,10 @@ void conflicting_options(const OptionMap& vm, const std::string& opt1, const std
 void option_dependency(const OptionMap& vm, const std::string& for_what, const std::string& required_option);
 void check_positive(const std::string& option, const OptionMap& vm);
 void check_reads_present(const OptionMap& vm);
+void check_read_stream(const OptionMap& vm);
 void check_region_files_consistent(const OptionMap& vm);
 void check_trio_consistent(const OptionMap& vm);
+void check_pair_hmm_band_size(const OptionMap& vm);
 void validate_caller(const OptionMap& vm);
 void validate(const OptionMap& vm);
 
@@ -54,6 +56,12 @@ OptionMap parse_options(const int argc, const char** argv)
      po::value<fs::path>(),
      "A config file, used to populate command line options")
     
+    ("batch",
+     po::value<fs::path>(),
+     "File of calling jobs, one per line, each given as command line options added to the ones given"
+     " here (e.g. '--regions chr1:1000-2000 --output job1.vcf'). Jobs are run in order in this process,"
+     " and consecutive jobs with the same reference, reads and samples share the loaded reference and read files")
+    
     ("debug",
      po::value<fs::path>()->implicit_value("octopus_debug.log"),
      "Writes verbose debug information to debug.log in the working directory")
@@ -62,6 +70,28 @@ OptionMap parse_options(const int argc, const char** argv)
      po::value<fs::path>()->implicit_value("octopus_trace.log"),
      "Writes very verbose debug information to trace.log in the working directory")
     
+    ("log-sample-rate",
+     po::value<float>()->default_value(1.0),
+     "Fraction of calling regions for which debug and trace information is written")
+    
+    ("profile",
+     po::value<fs::path>()->implicit_value("octopus_profile.json"),
+     "Records the time spent in each calling stage and writes a JSON summary to profile.json in the working directory")
+    
+    ("perf-trace",
+     po::value<fs::path>(),
+     "Writes a TSV line for each completed calling task with its region, wall and CPU time, time in each"
+     " calling stage, read, candidate, haplotype and genotype counts, and an estimate of peak memory")
+    
+    ("snapshot-region",
+     po::value<std::vector<std::string>>()->multitoken(),
+     "Space-separated list of regions (chrom:begin-end). The processed reads, candidate variants and reference"
+     " window used for each calling region overlapping one are written to a snapshot file for replay")
+    
+    ("snapshot-directory",
+     po::value<fs::path>()->default_value("octopus_snapshots"),
+     "Directory to write region snapshots to, relative to the working directory")
+    
     ("fast",
      po::bool_switch()->default_value(false),
      "Turns off some features to improve runtime, at the cost of decreased calling accuracy."
@@ -70,6 +100,16 @@ OptionMap parse_options(const int argc, const char** argv)
     ("very-fast",
      po::bool_switch()->default_value(false),
      "The same as fast but also disables inactive flank scoring")
+    
+    ("target-throughput",
+     po::value<float>(),
+     "Calling throughput to aim for in megabases per hour. max-haplotypes, kmer-sizes, downsampling and"
+     " the read buffer are chosen from a profile of the input reads and a calibration of the pair HMM"
+     " on this host, unless they are given explicitly")
+    
+    ("time-budget",
+     po::value<float>(),
+     "As target-throughput, with the throughput needed to call all input regions in this many hours")
     ;
     
     po::options_description backend("Backend");
@@ -83,14 +123,33 @@ OptionMap parse_options(const int argc, const char** argv)
      "Maximum number of threads to be used, enabling this option with no argument lets the application"
      " decide the number of threads ands enables specific algorithm parallelisation")
     
+    ("pin-threads",
+     po::bool_switch()->default_value(false),
+     "Pin worker threads to CPUs, spreading them evenly over NUMA nodes, so memory allocated by a thread"
+     " stays local to it")
+    
     ("max-reference-cache-footprint,X",
      po::value<MemoryFootprint>()->default_value(*parse_footprint("500MB"), "500MB"),
      "Maximum memory footprint for cached reference sequence")
     
+    ("memory-map-reference",
+     po::bool_switch()->default_value(false),
+     "Read the reference directly from a memory mapping of the fasta, which allows lock free access from"
+     " all threads and one shared copy of the reference between processes. The reference cache is not used")
+    
+    ("tandem-repeat-index",
+     po::value<fs::path>(),
+     "Tandem repeat index for the reference, which is built (once) if the file does not exist. Repeat"
+     " finding on the reference then uses range lookups into the index rather than scanning sequence")
+    
     ("target-read-buffer-footprint,B",
      po::value<MemoryFootprint>()->default_value(*parse_footprint("6GB"), "6GB"),
      "None binding request to limit the memory footprint of buffered read data")
     
+    ("compress-read-buffer",
+     po::bool_switch()->default_value(false),
+     "Compress buffered reads so each buffer can cover more reads for the same footprint")
+    
     ("max-open-read-files",
      po::value<int>()->default_value(250),
      "Limits the number of read files that can be open simultaneously")
@@ -102,6 +161,26 @@ OptionMap parse_options(const int argc, const char** argv)
      ("temp-directory-prefix",
      po::value<fs::path>()->default_value("octopus-temp"),
      "File name prefix of temporary directory for calling")
+    
+    ("checkpoint-directory",
+     po::value<fs::path>(),
+     "Directory where the calls of completed regions are checkpointed, so an interrupted run can be resumed."
+     " Only multithreaded runs are checkpointed")
+    
+    ("resume",
+     po::bool_switch()->default_value(false),
+     "Resume an interrupted run from --checkpoint-directory, skipping regions that have already been called."
+     " All other options must be the same as for the interrupted run")
+    
+    ("live-metrics",
+     po::value<fs::path>(),
+     "File rewritten every 10 seconds with metrics of the running job (throughput, tasks, worker utilisation,"
+     " cache hit rates and memory) in Prometheus text format")
+    
+    ("cache-read-profile",
+     po::bool_switch()->default_value(false),
+     "Store the read profile made at startup next to the first input read file, and reuse it on later runs"
+     " with the same reads, samples, and regions")
     ;
     
     po::options_description input("I/O");
@@ -114,12 +193,19 @@ OptionMap parse_options(const int argc, const char** argv)
     ("reads,I",
      po::value<std::vector<fs::path>>()->multitoken(),
      "Space-separated list of BAM/CRAM files to be analysed."
-     " May be specified multiple times")
+     " May be specified multiple times. '-' reads a coordinate sorted stream on the standard input, which"
+     " is read once without an index, and must then be the only reads")
     
     ("reads-file,i",
      po::value<std::vector<fs::path>>()->multitoken(),
      "Files containing lists of BAM/CRAM files, one per line, to be analysed")
     
+    ("read-manifest",
+     po::value<fs::path>(),
+     "File caching the samples and mapped regions of each input read file, so later runs need not open"
+     " every read file at startup. Entries are checked against file size and modification time, and the"
+     " file is created or updated when needed")
+    
     ("one-based-indexing",
      po::bool_switch()->default_value(false),
      "Notifies that input regions are given using one based indexing rather than zero based")
@@ -142,6 +228,32 @@ OptionMap parse_options(const int argc, const char** argv)
      po::value<fs::path>(),
      "File of regions (chrom:begin-end), one per line, to skip")
     
+    ("min-skipped-reference-gap",
+     po::value<int>()->default_value(1000),
+     "Runs of N in the reference at least this long, such as assembly gaps, are removed from the search"
+     " regions. Zero disables")
+    
+    ("shard-manifest",
+     po::value<fs::path>(),
+     "Manifest of shards of the search regions that can be called by separate processes")
+    
+    ("shards",
+     po::value<int>(),
+     "Write a manifest of this many shards, balanced by estimated calling cost, to --shard-manifest"
+     " rather than calling")
+    
+    ("shard-padding",
+     po::value<int>()->default_value(10'000),
+     "Padding added to shard regions so calls near shard boundaries have the same context as a single run")
+    
+    ("shard",
+     po::value<int>(),
+     "Only call the padded regions of this (zero based) shard in --shard-manifest")
+    
+    ("merge-shards",
+     po::value<std::vector<fs::path>>()->multitoken(),
+     "Calls of each shard in --shard-manifest, in shard order, to merge into --output rather than calling")
+    
     ("samples,S",
      po::value<std::vector<std::string>>()->multitoken(),
      "Space-separated list of sample names to analyse")
@@ -191,6 +303,10 @@ OptionMap parse_options(const int argc, const char** argv)
     ("data-profile",
      po::value<fs::path>(),
      "Output a profile of polymorphisms and errors found in the data")
+    
+    ("data-profile-fraction",
+     po::value<float>()->default_value(1.0, "1.0"),
+     "Fraction of the calling regions, taken in evenly spaced chunks, used for the data profile")
     ;
     
     po::options_description transforms("Read transformations");
@@ -226,6 +342,11 @@ OptionMap parse_options(const int argc, const char** argv)
     ("overlap-masking",
      po::value<bool>()->default_value(true),
      "Enable read segment overlap masking")
+    
+    ("cache-read-mismatches",
+     po::value<bool>()->default_value(true),
+     "Find the reference mismatches of each read once after read transformations, rather than in"
+     " each candidate generator")
      
     ("mask-inverted-soft-clipping",
     po::value<bool>()->default_value(false),
@@ -345,6 +466,15 @@ OptionMap parse_options(const int argc, const char** argv)
      po::value<bool>()->default_value(false),
      "Use variants from source VCF records that have been filtered")
     
+    ("index-source-candidates",
+     po::bool_switch()->default_value(false),
+     "Convert each source candidate file into a memory mapped index (built next to the file on first use)"
+     " which all threads search directly, rather than parsing the VCF on every run")
+    
+    ("source-candidate-frequencies",
+     po::bool_switch()->default_value(false),
+     "Use the allele frequencies (INFO/AF) of indexed source candidates to initialise population haplotype frequencies")
+    
     ("min-base-quality",
      po::value<int>()->default_value(20),
      "Only bases with quality above this value are considered for candidate generation")
@@ -371,6 +501,10 @@ OptionMap parse_options(const int argc, const char** argv)
      po::value<int>()->default_value(10),
      "The gap size used to generate local assembly fallback kmers")
     
+    ("stop-at-first-assembled-kmer",
+     po::bool_switch()->default_value(false),
+     "Stop trying local assembly kmer sizes once one gives an acyclic graph with candidate variants")
+    
     ("max-region-to-assemble",
      po::value<int>()->default_value(400),
      "The maximum region size that can be used for local assembly")
@@ -392,10 +526,20 @@ OptionMap parse_options(const int argc, const char** argv)
      po::value<int>()->default_value(2),
      "Minimum number of read observations to keep a kmer in the assembly graph before bubble extraction")
     
+    ("assembler-mask-low-count-kmers",
+     po::bool_switch()->default_value(false),
+     "Count kmers in each assembly region before building the De Bruijn graph and leave out non-reference"
+     " kmers with fewer than min-kmer-prune observations, rather than pruning them from the graph afterwards")
+    
     ("max-bubbles",
      po::value<int>()->default_value(30),
      "Maximum number of bubbles to extract from the assembly graph")
     
+    ("assembler-min-sample-evidence",
+     po::value<int>()->default_value(0),
+     "Only assemble reads from samples with at least this many reads showing variation in the"
+     " assembly region, 0 assembles all samples")
+    
     ("min-bubble-score",
      po::value<double>()->default_value(2.0),
      "Minimum bubble score that will be extracted from the assembly graph")
@@ -415,7 +559,12 @@ OptionMap parse_options(const int argc, const char** argv)
     
     ("haplotype-overflow",
      po::value<int>()->default_value(200000),
-     "Regions with more haplotypes than this will be skipped")
+     "Regions with more haplotypes than this keep only the candidate alleles with most read support,"
+     " or are skipped if --skip-overflow-regions is set")
+    
+    ("skip-overflow-regions",
+     po::bool_switch()->default_value(false),
+     "Skip regions that exceed the haplotype-overflow limit rather than dropping their least supported alleles")
     
     ("max-holdout-depth",
      po::value<int>()->default_value(20),
@@ -522,6 +671,54 @@ OptionMap parse_options(const int argc, const char** argv)
      po::value<bool>()->default_value(true),
      "Include the read mapping quality in the haplotype likelihood calculation")
     
+    ("pair-hmm-band-size",
+     po::value<int>()->default_value(8),
+     "Band size (8, 16, or 32) of the pair HMM used to compute read likelihoods. Wider bands"
+     " can align longer indels relative to the read mapping, and use AVX2 or AVX-512 when available")
+    
+    ("likelihood-cache-size",
+     po::value<int>()->default_value(500'000),
+     "Maximum number of read likelihoods each calling thread keeps between active regions, so"
+     " haplotypes that are re-proposed are not re-evaluated against the same reads (0 disables)")
+    
+    ("staged-likelihood-reads",
+     po::value<int>()->default_value(0),
+     "When there are more haplotypes than max-haplotypes, first evaluate them on at most this many"
+     " informative reads per sample and drop poorly supported haplotypes before evaluating the"
+     " remainder on all reads (0 disables)")
+    
+    ("reuse-local-likelihoods",
+     po::bool_switch()->default_value(false),
+     "Evaluate each read once for all haplotypes with identical sequence around the read alignments,"
+     " rather than once per haplotype")
+    
+    ("warm-start-genotype-models",
+     po::bool_switch()->default_value(false),
+     "Initialise iterative genotype models (EM and variational Bayes) from the haplotype posteriors"
+     " of the previous overlapping active region")
+    
+    ("pipeline-active-regions",
+     po::bool_switch()->default_value(false),
+     "Call and phase each active region on a helper thread while the likelihoods and genotype models"
+     " of the next active region are evaluated. Not used with debug or trace logging")
+    
+    ("share-task-boundary-reads",
+     po::bool_switch()->default_value(false),
+     "Fetch and process the reads around each boundary between adjacent calling tasks once, rather than"
+     " once for each task. Not used with debug logging")
+    
+    ("reference-triage-min-support",
+     po::value<int>()->default_value(0),
+     "Before fetching reads for a calling region, scan the alignment records (CIGAR, NM, and MD) and skip"
+     " the region if no position is covered by this many reads with a mismatch, indel, or clip. Only used"
+     " when reference calls are not requested and all candidates come from reads (0 disables)")
+    
+    ("long-read-flank",
+     po::value<int>()->default_value(0),
+     "For long reads. Haplotypes extend at most this many bases beyond each active region, and reads are"
+     " clipped to the haplotypes and mapped with longer k-mers before computing likelihoods, rather than"
+     " padding haplotypes to cover whole reads (0 disables)")
+    
     ("sequence-error-model",
      po::value<std::string>()->default_value("PCR-free.HiSeq-2500"),
      "The sequencer error model to use")
@@ -668,6 +865,11 @@ OptionMap parse_options(const int argc, const char** argv)
     ("keep-unfiltered-calls",
      po::bool_switch()->default_value(false),
      "Keep a copy of unfiltered calls")
+    
+    ("fuse-call-filtering",
+     po::bool_switch()->default_value(false),
+     "Filter calls in memory as they are made, rather than in a second pass over the unfiltered calls."
+     " Only applies to multithreaded runs with single pass filters, and is ignored if unfiltered calls are kept")
      
     ("annotations",
      po::value<std::vector<std::string>>()->multitoken()->implicit_value(std::vector<std::string> {"active"}, "active")->composing(),
@@ -920,6 +1122,14 @@ public:
     }
 };
 
+class BadReadStream : public CommandLineError
+{
+public:
+    BadReadStream(std::string reason)
+    : CommandLineError {"Reads streamed on the standard input (--reads -) " + reason}
+    {}
+};
+
 class MissingDependentCommandLineOption : public CommandLineError
 {
 public:
@@ -976,6 +1186,16 @@ void check_strictly_positive(const std::string& option, const OptionMap& vm)
     }
 }
 
+void check_strictly_positive_float(const std::string& option, const OptionMap& vm)
+{
+    if (vm.count(option) == 1) {
+        const auto value = vm.at(option).as<float>();
+        if (value <= 0) {
+            throw InvalidCommandLineOptionValue {option, value, "must be greater than zero" };
+        }
+    }
+}
+
 void check_probability(const std::string& option, const OptionMap& vm)
 {
     if (vm.count(option) == 1) {
@@ -986,6 +1206,17 @@ void check_probability(const std::string& option, const OptionMap& vm)
     }
 }
 
+void check_pair_hmm_band_size(const OptionMap& vm)
+{
+    const std::string option {"pair-hmm-band-size"};
+    if (vm.count(option) == 1) {
+        const auto value = vm.at(option).as<int>();
+        if (value != 8 && value != 16 && value != 32) {
+            throw InvalidCommandLineOptionValue {option, value, "must be one of 8, 16, or 32"};
+        }
+    }
+}
+
 void conflicting_options(const OptionMap& vm, const std::string& opt1, const std::string& opt2)
 {
     if (vm.count(opt1) == 1 && !vm[opt1].defaulted() && vm.count(opt2) == 1 && !vm[opt2].defaulted()) {
@@ -1008,6 +1239,28 @@ void check_reads_present(const OptionMap& vm)
     }
 }
 
+// A read stream is read once, in order, so nothing may need the reads again or out of order
+void check_read_stream(const OptionMap& vm)
+{
+    if (vm.count("reads") == 0) return;
+    const auto& reads = vm.at("reads").as<std::vector<fs::path>>();
+    if (std::find(std::cbegin(reads), std::cend(reads), fs::path {"-"}) == std::cend(reads)) return;
+    if (reads.size() > 1 || vm.count("reads-file") == 1) {
+        throw BadReadStream {"must be the only reads"};
+    }
+    if (vm.at("call-filtering").as<bool>() || vm.count("annotations") == 1) {
+        throw BadReadStream {"can't be read again to filter calls, so require '--call-filtering false'"};
+    }
+    for (const std::string option : {"bamout", "data-profile", "target-throughput", "time-budget"}) {
+        if (vm.count(option) == 1 && !vm[option].defaulted()) {
+            throw BadReadStream {"can't be read again for the option '--" + option + "'"};
+        }
+    }
+    if (vm.at("contig-output-order").as<ContigOutputOrder>() != ContigOutputOrder::asInReferenceIndex) {
+        throw BadReadStream {"require contigs to be called in reference index order"};
+    }
+}
+
 void check_region_files_consistent(const OptionMap& vm)
 {
     if (vm.count("regions-file") == 1 && vm.count("skip-regions-file") == 1) {
@@ -1071,22 +1324,39 @@ void validate(const OptionMap& vm)
         "min-mapping-quality", "good-base-quality", "min-good-bases", "min-read-length",
         "max-read-length", "min-base-quality", "min-supporting-reads", "max-variant-size",
         "num-fallback-kmers", "max-assemble-region-overlap", "assembler-mask-base-quality",
-        "min-kmer-prune", "max-bubbles", "max-holdout-depth"
+        "min-kmer-prune", "max-bubbles", "max-holdout-depth", "likelihood-cache-size",
+        "staged-likelihood-reads", "reference-triage-min-support", "long-read-flank", "assembler-min-sample-evidence",
+        "shard-padding", "shard", "min-skipped-reference-gap"
     };
     const std::vector<std::string> strictly_positive_int_options {
         "max-open-read-files", "downsample-above", "downsample-target",
         "max-region-to-assemble", "fallback-kmer-gap", "organism-ploidy",
         "max-haplotypes", "haplotype-holdout-threshold", "haplotype-overflow",
         "max-genotypes", "max-joint-genotypes", "max-somatic-haplotypes", "max-clones",
-        "max-vb-seeds"
+        "max-vb-seeds", "max-phylogeny-size", "shards"
     };
     const std::vector<std::string> probability_options {
         "snp-heterozygosity", "snp-heterozygosity-stdev", "indel-heterozygosity",
         "somatic-mutation-rate", "min-expected-somatic-frequency", "min-credible-somatic-frequency", "credible-mass",
-        "denovo-snv-mutation-rate", "denovo-indel-mutation-rate"
+        "denovo-snv-mutation-rate", "denovo-indel-mutation-rate", "data-profile-fraction",
+        "log-sample-rate"
     };
     conflicting_options(vm, "maternal-sample", "normal-sample");
     conflicting_options(vm, "paternal-sample", "normal-sample");
+    conflicting_options(vm, "shards", "shard");
+    conflicting_options(vm, "shards", "merge-shards");
+    conflicting_options(vm, "shard", "merge-shards");
+    conflicting_options(vm, "target-throughput", "time-budget");
+    for (const std::string option : {"target-throughput", "time-budget"}) {
+        conflicting_options(vm, option, "fast");
+        conflicting_options(vm, option, "very-fast");
+        check_strictly_positive_float(option, vm);
+    }
+    option_dependency(vm, "shards", "shard-manifest");
+    option_dependency(vm, "source-candidate-frequencies", "index-source-candidates");
+    option_dependency(vm, "resume", "checkpoint-directory");
+    option_dependency(vm, "shard", "shard-manifest");
+    option_dependency(vm, "merge-shards", "shard-manifest");
     for (const auto& option : positive_int_options) {
         check_positive(option, vm);
     }
@@ -1097,8 +1367,10 @@ void validate(const OptionMap& vm)
         check_probability(option, vm);
     }
     check_reads_present(vm);
+    check_read_stream(vm);
     check_region_files_consistent(vm);
     check_trio_consistent(vm);
+    check_pair_hmm_band_size(vm);
     validate_caller(vm);
 }
 
@@ -0,0 +1,213 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "performance_tuning.hpp"
+
+#include <string>
+#include <array>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <cstdint>
+#include <ostream>
+
+#include <boost/any.hpp>
+
+#include "core/models/pairhmm/pair_hmm.hpp"
+
+namespace octopus { namespace options {
+
+namespace {
+
+std::string simulate_sequence(const std::size_t length, std::mt19937& generator)
+{
+    static constexpr std::array<char, 4> bases {'A', 'C', 'G', 'T'};
+    std::uniform_int_distribution<std::size_t> base_dist {0, bases.size() - 1};
+    std::string result(length, 'N');
+    std::generate(std::begin(result), std::end(result), [&] () { return bases[base_dist(generator)]; });
+    return result;
+}
+
+// Adds mismatches and a deletion so the read cannot be evaluated without the full DP
+std::string simulate_read(const std::string& truth, const std::size_t offset, const std::size_t length,
+                          std::mt19937& generator)
+{
+    auto result = truth.substr(offset, length + 1);
+    std::uniform_int_distribution<std::size_t> pos_dist {1, length - 1};
+    result.erase(pos_dist(generator), 1);
+    for (int i {0}; i < 3; ++i) {
+        auto& base = result[pos_dist(generator)];
+        base = base == 'A' ? 'C' : 'A';
+    }
+    return result;
+}
+
+} // namespace
+
+double calibrate_pair_hmm(const unsigned read_length)
+{
+    // Alignment time is linear in the read length, so long reads are timed on a prefix
+    static constexpr unsigned minReadLength {50}, maxReadLength {1'000};
+    static constexpr std::size_t numReads {200}, numRepeats {3};
+    const auto calibration_length = std::max(std::min(read_length, maxReadLength), minReadLength);
+    const std::size_t pad {hmm::min_flank_pad()};
+    std::mt19937 generator {42};
+    const auto truth = simulate_sequence(calibration_length + 2 * pad + 1, generator);
+    const std::vector<char> snv_mask(std::cbegin(truth), std::cend(truth));
+    const std::vector<hmm::MutationModel::Penalty> snv_priors(truth.size(), 40), gap_open(truth.size(), 45), gap_extend(truth.size(), 10);
+    const hmm::MutationModel model {snv_mask, snv_priors, gap_open, gap_extend};
+    std::vector<std::string> reads(numReads);
+    std::generate(std::begin(reads), std::end(reads), [&] () { return simulate_read(truth, pad, calibration_length, generator); });
+    const std::vector<std::uint8_t> qualities(calibration_length, 30);
+    std::vector<hmm::EvaluationRequest> requests {};
+    requests.reserve(numReads);
+    for (const auto& read : reads) requests.push_back({read, qualities, pad, model});
+    std::vector<double> likelihoods {};
+    hmm::evaluate(truth, requests, likelihoods); // warm up
+    using Clock = std::chrono::steady_clock;
+    std::chrono::duration<double> best {std::chrono::hours {1}};
+    for (std::size_t i {0}; i < numRepeats; ++i) {
+        const auto start = Clock::now();
+        hmm::evaluate(truth, requests, likelihoods);
+        best = std::min<std::chrono::duration<double>>(best, Clock::now() - start);
+    }
+    return best.count() / numReads * (static_cast<double>(std::max(read_length, 1u)) / calibration_length);
+}
+
+namespace {
+
+struct Preset
+{
+    unsigned max_haplotypes;
+    std::vector<int> kmer_sizes;
+    unsigned downsample_above, downsample_target;
+};
+
+// In order of decreasing accuracy and runtime. The first matches the option defaults.
+const std::vector<Preset>& get_presets()
+{
+    static const std::vector<Preset> result {
+        {200, {10, 15, 20}, 1000, 500},
+        {128, {10, 15, 20}, 500, 250},
+        {64, {10, 20}, 300, 150},
+        {50, {15}, 200, 100},
+        {32, {15}, 100, 60},
+        {16, {15}, 60, 40}
+    };
+    return result;
+}
+
+auto get_sample_depths(const ReadSetProfile& reads_profile)
+{
+    auto result = reads_profile.sample_mean_depth;
+    if (result.empty()) result.push_back(reads_profile.mean_depth);
+    return result;
+}
+
+double downsampled_depth(const std::vector<std::size_t>& sample_depths, const Preset& preset) noexcept
+{
+    return std::accumulate(std::cbegin(sample_depths), std::cend(sample_depths), 0.0,
+                           [&] (double total, std::size_t depth) {
+                               return total + (depth > preset.downsample_above ? preset.downsample_target : depth);
+                           });
+}
+
+// Most regions have far fewer haplotypes than the limit, which only dense regions reach
+double expected_num_haplotypes(const Preset& preset) noexcept
+{
+    return 2 * std::sqrt(preset.max_haplotypes);
+}
+
+// Single thread seconds to call one base. Only reads in active regions are evaluated, the pair HMM
+// is only part of the total runtime, and each assembler kmer adds some work on top of that.
+double estimate_seconds_per_base(const ReadSetProfile& reads_profile, const std::vector<std::size_t>& sample_depths,
+                                 const double pair_hmm_seconds, const Preset& preset) noexcept
+{
+    static constexpr double activeReadFraction {0.5}, pairHmmRuntimeFraction {0.2};
+    static constexpr double kmerOverhead {0.2}, lowMappingQualityOverhead {1.5};
+    static constexpr AlignedRead::MappingQuality lowMappingQuality {40};
+    const auto read_length = std::max(static_cast<double>(reads_profile.median_read_length), 1.0);
+    const auto reads_per_base = downsampled_depth(sample_depths, preset) / read_length;
+    auto result = reads_per_base * activeReadFraction * expected_num_haplotypes(preset) * pair_hmm_seconds / pairHmmRuntimeFraction;
+    result *= 1 + kmerOverhead * preset.kmer_sizes.size();
+    // Poorly mapped data tends to have more candidates and denser regions
+    if (reads_profile.rmq_mapping_quality < lowMappingQuality) result *= lowMappingQualityOverhead;
+    return result;
+}
+
+} // namespace
+
+PerformanceProfile
+tune_performance(const ReadSetProfile& reads_profile, const double pair_hmm_seconds, const PerformanceTuningConfig& config)
+{
+    static constexpr GenomicRegion::Size minTaskSize {10'000}, maxTaskSize {10'000'000};
+    const auto& presets = get_presets();
+    const auto sample_depths = get_sample_depths(reads_profile);
+    const auto num_threads = std::max(config.num_threads, 1u);
+    auto preset_itr = std::cbegin(presets);
+    double seconds_per_base {};
+    for (; preset_itr != std::cend(presets); ++preset_itr) {
+        seconds_per_base = estimate_seconds_per_base(reads_profile, sample_depths, pair_hmm_seconds, *preset_itr);
+        if (num_threads / seconds_per_base >= config.target_bases_per_second) break;
+    }
+    if (preset_itr == std::cend(presets)) --preset_itr;
+    const auto& preset = *preset_itr;
+    PerformanceProfile result {};
+    result.max_haplotypes = preset.max_haplotypes;
+    result.kmer_sizes = preset.kmer_sizes;
+    result.downsample_above = preset.downsample_above;
+    result.downsample_target = preset.downsample_target;
+    result.pair_hmm_seconds = pair_hmm_seconds;
+    result.predicted_bases_per_second = seconds_per_base > 0 ? num_threads / seconds_per_base : config.target_bases_per_second;
+    const auto task_size = seconds_per_base > 0 ? config.target_task_seconds / seconds_per_base : maxTaskSize;
+    result.task_size = std::max(minTaskSize, std::min(static_cast<GenomicRegion::Size>(task_size), maxTaskSize));
+    const auto read_length = std::max(static_cast<double>(reads_profile.median_read_length), 1.0);
+    const auto reads_per_task = result.task_size * downsampled_depth(sample_depths, preset) / read_length;
+    const auto read_bytes = reads_profile.mean_read_bytes + reads_profile.read_bytes_stdev;
+    const auto buffer_bytes = static_cast<std::size_t>(num_threads * reads_per_task * read_bytes);
+    result.read_buffer_footprint = std::min(MemoryFootprint {buffer_bytes}, config.max_read_buffer_footprint);
+    return result;
+}
+
+namespace {
+
+template <typename T>
+void set_if_defaulted(const std::string& option, T value, OptionMap& options)
+{
+    auto itr = options.find(option);
+    if (itr != std::end(options) && itr->second.defaulted()) {
+        itr->second.value() = boost::any {std::move(value)};
+    }
+}
+
+} // namespace
+
+void apply(const PerformanceProfile& profile, OptionMap& options)
+{
+    set_if_defaulted("max-haplotypes", static_cast<int>(profile.max_haplotypes), options);
+    set_if_defaulted("kmer-sizes", profile.kmer_sizes, options);
+    set_if_defaulted("downsample-above", static_cast<int>(profile.downsample_above), options);
+    set_if_defaulted("downsample-target", static_cast<int>(profile.downsample_target), options);
+    set_if_defaulted("target-read-buffer-footprint", profile.read_buffer_footprint, options);
+}
+
+std::ostream& operator<<(std::ostream& os, const PerformanceProfile& profile)
+{
+    os << "max-haplotypes=" << profile.max_haplotypes << " kmer-sizes=";
+    for (std::size_t i {0}; i < profile.kmer_sizes.size(); ++i) {
+        if (i > 0) os << ',';
+        os << profile.kmer_sizes[i];
+    }
+    os << " downsample-above=" << profile.downsample_above
+       << " downsample-target=" << profile.downsample_target
+       << " read-buffer=" << profile.read_buffer_footprint
+       << " task-size=" << profile.task_size << "bp"
+       << " (pair HMM " << 1e6 * profile.pair_hmm_seconds << "us/read, predicted "
+       << 3.6e-3 * profile.predicted_bases_per_second << "Mb/h)";
+    return os;
+}
+
+} // namespace options
+} // namespace octopus
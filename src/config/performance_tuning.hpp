@@ -0,0 +1,55 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef performance_tuning_hpp
+#define performance_tuning_hpp
+
+#include <vector>
+#include <iosfwd>
+
+#include "option_parser.hpp"
+#include "basics/genomic_region.hpp"
+#include "utils/input_reads_profiler.hpp"
+#include "utils/memory_footprint.hpp"
+
+namespace octopus { namespace options {
+
+// Parameters chosen to meet a throughput target. Tasks are sized by the number of reads buffered for
+// each thread, so task_size is the region size that buffer is expected to cover.
+struct PerformanceProfile
+{
+    unsigned max_haplotypes;
+    std::vector<int> kmer_sizes;
+    unsigned downsample_above, downsample_target;
+    MemoryFootprint read_buffer_footprint;
+    GenomicRegion::Size task_size;
+    double pair_hmm_seconds;
+    double predicted_bases_per_second;
+};
+
+struct PerformanceTuningConfig
+{
+    double target_bases_per_second;
+    unsigned num_threads = 1;
+    MemoryFootprint max_read_buffer_footprint = 6'000'000'000;
+    double target_task_seconds = 30;
+};
+
+// Seconds the pair HMM takes on this host to align a read of this length that needs the full DP,
+// measured by aligning a small batch of simulated reads
+double calibrate_pair_hmm(unsigned read_length);
+
+// Picks the least aggressive preset predicted to meet the target, or the most aggressive one if
+// none do. pair_hmm_seconds is as given by calibrate_pair_hmm.
+PerformanceProfile
+tune_performance(const ReadSetProfile& reads_profile, double pair_hmm_seconds, const PerformanceTuningConfig& config);
+
+// Overwrites the tuned options, which must already be present (i.e. defaulted)
+void apply(const PerformanceProfile& profile, OptionMap& options);
+
+std::ostream& operator<<(std::ostream& os, const PerformanceProfile& profile);
+
+} // namespace options
+} // namespace octopus
+
+#endif
@@ -19,6 +19,7 @@
 #include "concepts/mappable.hpp"
 #include "concepts/mappable_range.hpp"
 #include "utils/mappable_algorithms.hpp"
+#include "region_index.hpp"
 
 namespace octopus {
 
@@ -181,6 +182,7 @@ private:
     base_t elements_;
     bool is_bidirectionally_sorted_;
     typename RegionType<MappableType>::Position max_element_size_;
+    RegionIndex<MappableType> region_index_;
 };
 
 template <typename MappableType, typename Allocator>
@@ -188,6 +190,7 @@ MappableFlatMultiSet<MappableType, Allocator>::MappableFlatMultiSet()
 : elements_ {}
 , is_bidirectionally_sorted_ {true}
 , max_element_size_ {}
+, region_index_ {}
 {}
 
 template <typename MappableType, typename Allocator>
@@ -196,14 +199,20 @@ MappableFlatMultiSet<MappableType, Allocator>::MappableFlatMultiSet(InputIterato
 : elements_ {first, second}
 , is_bidirectionally_sorted_ {is_bidirectionally_sorted(elements_)}
 , max_element_size_ {(elements_.empty()) ? 0 : region_size(*largest_mappable(elements_))}
-{}
+, region_index_ {}
+{
+    region_index_.assign(elements_);
+}
 
 template <typename MappableType, typename Allocator>
 MappableFlatMultiSet<MappableType, Allocator>::MappableFlatMultiSet(std::initializer_list<MappableType> mappables)
 : elements_ {mappables}
 , is_bidirectionally_sorted_ {is_bidirectionally_sorted(elements_)}
 , max_element_size_ {(elements_.empty()) ? 0 : region_size(*largest_mappable(elements_))}
-{}
+, region_index_ {}
+{
+    region_index_.assign(elements_);
+}
 
 template <typename MappableType, typename Allocator>
 typename MappableFlatMultiSet<MappableType, Allocator>::iterator
@@ -359,6 +368,7 @@ typename MappableFlatMultiSet<MappableType, Allocator>::iterator
 MappableFlatMultiSet<MappableType, Allocator>::emplace(Args... args)
 {
     const auto it = elements_.emplace(std::forward<Args>(args)...);
+    region_index_.insert(elements_, std::distance(std::begin(elements_), it));
     if (is_bidirectionally_sorted_) {
         const auto overlapped = overlap_range(*it);
         is_bidirectionally_sorted_ = is_bidirectionally_sorted(overlapped);
@@ -372,6 +382,7 @@ typename MappableFlatMultiSet<MappableType, Allocator>::iterator
 MappableFlatMultiSet<MappableType, Allocator>::insert(const MappableType& m)
 {
     const auto it = elements_.insert(m);
+    region_index_.insert(elements_, std::distance(std::begin(elements_), it));
     if (is_bidirectionally_sorted_) {
         const auto overlapped = overlap_range(*it);
         is_bidirectionally_sorted_ = is_bidirectionally_sorted(overlapped);
@@ -385,6 +396,7 @@ typename MappableFlatMultiSet<MappableType, Allocator>::iterator
 MappableFlatMultiSet<MappableType, Allocator>::insert(MappableType&& m)
 {
     const auto it = elements_.insert(std::move(m));
+    region_index_.insert(elements_, std::distance(std::begin(elements_), it));
     if (is_bidirectionally_sorted_) {
         const auto overlapped = overlap_range(*it);
         is_bidirectionally_sorted_ = is_bidirectionally_sorted(overlapped);
@@ -398,6 +410,7 @@ typename MappableFlatMultiSet<MappableType, Allocator>::iterator
 MappableFlatMultiSet<MappableType, Allocator>::insert(const_iterator hint, const MappableType& m)
 {
     const auto it2 = elements_.insert(hint, m);
+    region_index_.insert(elements_, std::distance(std::begin(elements_), it2));
     if (is_bidirectionally_sorted_) {
         const auto overlapped = overlap_range(*it2);
         is_bidirectionally_sorted_ = is_bidirectionally_sorted(overlapped);
@@ -411,6 +424,7 @@ typename MappableFlatMultiSet<MappableType, Allocator>::iterator
 MappableFlatMultiSet<MappableType, Allocator>::insert(const_iterator hint, MappableType&& m)
 {
     const auto it2 = elements_.insert(hint, std::move(m));
+    region_index_.insert(elements_, std::distance(std::begin(elements_), it2));
     if (is_bidirectionally_sorted_) {
         const auto overlapped = overlap_range(*it2);
         is_bidirectionally_sorted_ = is_bidirectionally_sorted(overlapped);
@@ -427,6 +441,7 @@ MappableFlatMultiSet<MappableType, Allocator>::insert(InputIterator first, Input
     if (first != last) {
         max_element_size_ = std::max(max_element_size_, region_size(*largest_mappable(first, last)));
         elements_.insert(first, last);
+        region_index_.assign(elements_);
         if (is_bidirectionally_sorted_) {
             is_bidirectionally_sorted_ = is_bidirectionally_sorted(elements_);
         }
@@ -441,6 +456,7 @@ MappableFlatMultiSet<MappableType, Allocator>::insert(std::initializer_list<Mapp
         max_element_size_ = std::max(max_element_size_, region_size(*largest_element(il)));
     }
     const auto result = elements_.insert(std::move(il));
+    region_index_.assign(elements_);
     if (is_bidirectionally_sorted_ && !il.empty() ) {
         is_bidirectionally_sorted_ = is_bidirectionally_sorted(elements_);
     }
@@ -453,7 +469,9 @@ MappableFlatMultiSet<MappableType, Allocator>::erase(const_iterator p)
 {
     if (p == cend()) return elements_.erase(p);
     const auto erased_size = region_size(*p);
+    const auto pos = std::distance(std::cbegin(elements_), p);
     const auto result = elements_.erase(p);
+    region_index_.erase(elements_, pos);
     if (elements_.empty()) {
         max_element_size_ = 0;
         is_bidirectionally_sorted_ = true;
@@ -470,8 +488,10 @@ typename MappableFlatMultiSet<MappableType, Allocator>::size_type
 MappableFlatMultiSet<MappableType, Allocator>::erase(const MappableType& m)
 {
     const auto m_size = region_size(m);
+    const auto pos = std::distance(std::begin(elements_), elements_.lower_bound(m));
     const auto result = elements_.erase(m);
     if (result > 0) {
+        region_index_.erase(elements_, pos, result);
         if (elements_.empty()) {
             max_element_size_ = 0;
             is_bidirectionally_sorted_ = true;
@@ -491,7 +511,10 @@ MappableFlatMultiSet<MappableType, Allocator>::erase(const_iterator first, const
 {
     if (first == last) return elements_.erase(first, last);
     const auto max_erased_size = region_size(*largest_mappable(first, last));
+    const auto pos = std::distance(std::cbegin(elements_), first);
+    const auto count = std::distance(first, last);
     const auto result = elements_.erase(first, last);
+    region_index_.erase(elements_, pos, count);
     if (elements_.empty()) {
         max_element_size_ = 0;
         is_bidirectionally_sorted_ = true;
@@ -524,6 +547,7 @@ MappableFlatMultiSet<MappableType, Allocator>::erase_all(InputIt first, InputIt
         }
     });
     if (result > 0) {
+        region_index_.assign(elements_);
         if (!elements_.empty()) {
             if (!is_bidirectionally_sorted_) {
                 is_bidirectionally_sorted_ = is_bidirectionally_sorted(elements_);
@@ -545,6 +569,7 @@ void MappableFlatMultiSet<MappableType, Allocator>::clear()
     elements_.clear();
     is_bidirectionally_sorted_ = true;
     max_element_size_ = 0;
+    region_index_.clear();
 }
 
 template <typename MappableType, typename Allocator>
@@ -609,8 +634,7 @@ const MappableType& MappableFlatMultiSet<MappableType, Allocator>::rightmost() c
     if (is_bidirectionally_sorted_) {
         return last;
     } else {
-        using octopus::overlap_range;
-        const auto overlapped = overlap_range(cbegin(elements_), cend(elements_), last, max_element_size_);
+        const auto overlapped = overlap_range(last);
         return *rightmost_mappable(cbegin(overlapped), cend(overlapped));
     }
 }
@@ -620,11 +644,7 @@ template <typename MappableType_>
 bool
 MappableFlatMultiSet<MappableType, Allocator>::has_overlapped(const MappableType_& mappable) const
 {
-    using octopus::has_overlapped;
-    if (is_bidirectionally_sorted_) {
-        return has_overlapped(std::begin(elements_), std::end(elements_), mappable, BidirectionallySortedTag {});
-    }
-    return has_overlapped(std::begin(elements_), std::end(elements_), mappable);
+    return has_overlapped(std::cbegin(elements_), std::cend(elements_), mappable);
 }
 
 template <typename MappableType, typename Allocator>
@@ -637,7 +657,8 @@ MappableFlatMultiSet<MappableType, Allocator>::has_overlapped(const_iterator fir
     if (is_bidirectionally_sorted_) {
         return has_overlapped(first, last, mappable, BidirectionallySortedTag {});
     }
-    return has_overlapped(first, last, mappable);
+    const auto it = find_first_after(first, last, mappable);
+    return region_index_.find_first_overlapped(std::cbegin(elements_), first, it, mappable) != it;
 }
 
 template <typename MappableType, typename Allocator>
@@ -658,7 +679,7 @@ MappableFlatMultiSet<MappableType, Allocator>::count_overlapped(const_iterator f
     if (is_bidirectionally_sorted_) {
         return count_overlapped(first, last, mappable, BidirectionallySortedTag {});
     }
-    return count_overlapped(first, last, mappable, max_element_size_);
+    return region_index_.count_overlapped(std::cbegin(elements_), first, find_first_after(first, last, mappable), mappable);
 }
 
 template <typename MappableType, typename Allocator>
@@ -679,7 +700,9 @@ MappableFlatMultiSet<MappableType, Allocator>::overlap_range(const_iterator firs
     if (is_bidirectionally_sorted_) {
         return overlap_range(first, last, mappable, BidirectionallySortedTag {});
     }
-    return overlap_range(first, last, mappable, max_element_size_);
+    const auto it1 = find_first_after(first, last, mappable);
+    const auto it2 = region_index_.find_first_overlapped(std::cbegin(elements_), first, it1, mappable);
+    return make_overlap_range(it2, it1, mappable);
 }
 
 template <typename MappableType, typename Allocator>
@@ -865,6 +888,7 @@ void swap(MappableFlatMultiSet<MappableType, Allocator>& lhs,
     swap(lhs.elements_, rhs.elements_);
     swap(lhs.is_bidirectionally_sorted_, rhs.is_bidirectionally_sorted_);
     swap(lhs.max_element_size_, rhs.max_element_size_);
+    swap(lhs.region_index_, rhs.region_index_);
 }
 
 template <typename ForwardIterator, typename MappableType1, typename MappableType2, typename Allocator>
@@ -19,6 +19,7 @@
 #include "concepts/mappable_range.hpp"
 #include "utils/mappable_algorithms.hpp"
 #include "utils/type_tricks.hpp"
+#include "region_index.hpp"
 
 namespace octopus {
 
@@ -161,14 +162,14 @@ public:
 private:
     base_t elements_;
     bool is_bidirectionally_sorted_;
-    typename RegionType<MappableType>::Position max_element_size_;
+    RegionIndex<MappableType> region_index_;
 };
 
 template <typename MappableType, typename Allocator>
 MappableFlatSet<MappableType, Allocator>::MappableFlatSet()
 : elements_ {}
 , is_bidirectionally_sorted_ {true}
-, max_element_size_ {0}
+, region_index_ {}
 {}
 
 template <typename MappableType, typename Allocator>
@@ -176,13 +177,13 @@ template <typename InputIterator>
 MappableFlatSet<MappableType, Allocator>::MappableFlatSet(InputIterator first, InputIterator second)
 : elements_ {first, second}
 , is_bidirectionally_sorted_ {true}
-, max_element_size_ {0}
+, region_index_ {}
 {
     if (elements_.empty()) return;
     std::sort(std::begin(elements_), std::end(elements_));
     elements_.erase(std::unique(std::begin(elements_), std::end(elements_)), std::end(elements_));
     is_bidirectionally_sorted_ = is_bidirectionally_sorted(elements_);
-    max_element_size_ = region_size(*largest_mappable(elements_));
+    region_index_.assign(elements_);
 }
 
 template <typename MappableType, typename Allocator>
@@ -190,13 +191,13 @@ MappableFlatSet<MappableType, Allocator>::MappableFlatSet(std::initializer_list<
 :
 elements_ {mappables},
 is_bidirectionally_sorted_ {true},
-max_element_size_ {0}
+region_index_ {}
 {
     if (elements_.empty()) return;
     std::sort(std::begin(elements_), std::end(elements_));
     elements_.erase(std::unique(std::begin(elements_), std::end(elements_)), std::end(elements_));
     is_bidirectionally_sorted_ = is_bidirectionally_sorted(elements_);
-    max_element_size_ = region_size(*largest_mappable(elements_));
+    region_index_.assign(elements_);
 }
 
 template <typename MappableType, typename Allocator>
@@ -361,11 +362,11 @@ MappableFlatSet<MappableType, Allocator>::emplace(Args... args)
     }
     std::rotate(std::rbegin(elements_), std::next(std::rbegin(elements_)),
                 std::make_reverse_iterator(it));
+    region_index_.insert(elements_, std::distance(std::begin(elements_), it));
     if (is_bidirectionally_sorted_) {
         const auto overlapped = overlap_range(*it);
         is_bidirectionally_sorted_ = is_bidirectionally_sorted(overlapped);
     }
-    max_element_size_ = std::max(max_element_size_, region_size(*it));
     return std::make_pair(it, true);
 }
 
@@ -376,6 +377,7 @@ MappableFlatSet<MappableType, Allocator>::insert(const MappableType& m)
     auto it = std::lower_bound(std::begin(elements_), std::end(elements_), m);
     if (it == std::end(elements_) || *it != m) {
         it = elements_.insert(it, m);
+        region_index_.insert(elements_, std::distance(std::begin(elements_), it));
     } else {
         return std::make_pair(it, false);
     }
@@ -383,7 +385,6 @@ MappableFlatSet<MappableType, Allocator>::insert(const MappableType& m)
         const auto overlapped = overlap_range(*it);
         is_bidirectionally_sorted_ = is_bidirectionally_sorted(overlapped);
     }
-    max_element_size_ = std::max(max_element_size_, region_size(*it));
     return std::make_pair(it, true);
 }
 
@@ -394,6 +395,7 @@ MappableFlatSet<MappableType, Allocator>::insert(MappableType&& m)
     auto it = std::lower_bound(std::begin(elements_), std::end(elements_), m);
     if (it == std::end(elements_) || *it != m) {
         it = elements_.insert(it, std::move(m));
+        region_index_.insert(elements_, std::distance(std::begin(elements_), it));
     } else {
         return std::make_pair(it, false);
     }
@@ -401,7 +403,6 @@ MappableFlatSet<MappableType, Allocator>::insert(MappableType&& m)
         const auto overlapped = overlap_range(*it);
         is_bidirectionally_sorted_ = is_bidirectionally_sorted(overlapped);
     }
-    max_element_size_ = std::max(max_element_size_, region_size(*it));
     return std::make_pair(it, true);
 }
 
@@ -444,17 +445,17 @@ MappableFlatSet<MappableType, Allocator>::insert(const_iterator hint, const Mapp
     } else {
         if (empty() || elements_.back() < m) {
             elements_.push_back(m);
-            result = std::begin(elements_);
+            result = std::prev(std::end(elements_));
         } else {
             return insert(m).first; // bad hint
         }
     }
     // the element was inserted
+    region_index_.insert(elements_, std::distance(std::begin(elements_), result));
     if (is_bidirectionally_sorted_) {
         const auto overlapped = overlap_range(m);
         is_bidirectionally_sorted_ = is_bidirectionally_sorted(overlapped);
     }
-    max_element_size_ = std::max(max_element_size_, region_size(m));
     return result;
 }
 
@@ -496,17 +497,17 @@ MappableFlatSet<MappableType, Allocator>::insert(const_iterator hint, MappableTy
     } else {
         if (empty() || elements_.back() < m) {
             elements_.push_back(std::move(m));
-            result = std::begin(elements_);
+            result = std::prev(std::end(elements_));
         } else {
             return insert(std::move(m)).first; // bad hint
         }
     }
     // the element was inserted and result now points to it
+    region_index_.insert(elements_, std::distance(std::begin(elements_), result));
     if (is_bidirectionally_sorted_) {
         const auto overlapped = overlap_range(*result);
         is_bidirectionally_sorted_ = is_bidirectionally_sorted(overlapped);
     }
-    max_element_size_ = std::max(max_element_size_, region_size(*result));
     return result;
 }
 
@@ -515,7 +516,6 @@ template <typename InputIterator>
 void MappableFlatSet<MappableType, Allocator>::insert(InputIterator first, InputIterator last)
 {
     if (first == last) return;
-    max_element_size_ = std::max(max_element_size_, region_size(*largest_mappable(first, last)));
     for (auto it1 = first; it1 != last; ) {
         const auto it2 = std::is_sorted_until(it1, last);
         auto ub = std::upper_bound(std::begin(elements_), std::end(elements_), *std::prev(it2));
@@ -528,6 +528,7 @@ void MappableFlatSet<MappableType, Allocator>::insert(InputIterator first, Input
         elements_.erase(std::unique(lb, ub), ub);
         it1 = it2;
     }
+    region_index_.assign(elements_);
     if (is_bidirectionally_sorted_) {
         is_bidirectionally_sorted_ = is_bidirectionally_sorted(elements_);
     }
@@ -545,15 +546,11 @@ typename MappableFlatSet<MappableType, Allocator>::iterator
 MappableFlatSet<MappableType, Allocator>::erase(const_iterator p)
 {
     if (p == cend()) return elements_.erase(p);
-    const auto erased_size = region_size(*p);
+    const auto pos = std::distance(std::cbegin(elements_), p);
     const auto result = elements_.erase(p);
+    region_index_.erase(elements_, pos);
     if (elements_.empty()) {
-        max_element_size_ = 0;
         is_bidirectionally_sorted_ = true;
-    } else {
-        if (max_element_size_ == erased_size) {
-            max_element_size_ = region_size(*largest_mappable(elements_));
-        }
     }
     return result;
 }
@@ -564,15 +561,11 @@ MappableFlatSet<MappableType, Allocator>::erase(const MappableType& m)
 {
     const auto it = std::lower_bound(std::cbegin(elements_), std::cend(elements_), m);
     if (it != std::cend(elements_) && *it == m) {
-        const auto m_size = region_size(m);
+        const auto pos = std::distance(std::cbegin(elements_), it);
         elements_.erase(it);
+        region_index_.erase(elements_, pos);
         if (elements_.empty()) {
-            max_element_size_ = 0;
             is_bidirectionally_sorted_ = true;
-        } else {
-            if (max_element_size_ == m_size) {
-                max_element_size_ = region_size(*largest_mappable(elements_));
-            }
         }
         return 1;
     }
@@ -584,15 +577,12 @@ typename MappableFlatSet<MappableType, Allocator>::iterator
 MappableFlatSet<MappableType, Allocator>::erase(const_iterator first, const_iterator last)
 {
     if (first == last) return elements_.erase(first, last);
-    const auto max_erased_size = region_size(*largest_mappable(first, last));
+    const auto pos = std::distance(std::cbegin(elements_), first);
+    const auto count = std::distance(first, last);
     const auto result = elements_.erase(first, last);
+    region_index_.erase(elements_, pos, count);
     if (elements_.empty()) {
-        max_element_size_ = 0;
         is_bidirectionally_sorted_ = true;
-    } else {
-        if (max_element_size_ == max_erased_size) {
-            max_element_size_ = region_size(*largest_mappable(elements_));
-        }
     }
     return result;
 }
@@ -622,7 +612,6 @@ MappableFlatSet<MappableType, Allocator>::erase_all(BidirIt first, const BidirIt
     const auto region = encompassing_region(first, last);
     auto contained_elements = bases(contained_range(std::begin(elements_), std::end(elements_), region));
     if (contained_elements.empty()) return num_erased;
-    typename RegionType<MappableType>::Size max_erased_size {0};
     auto first_contained = std::begin(contained_elements);
     auto last_contained  = std::end(contained_elements);
     auto last_element = std::end(elements_);
@@ -635,7 +624,6 @@ MappableFlatSet<MappableType, Allocator>::erase_all(BidirIt first, const BidirIt
             last_element = std::rotate(it, p.first, last_element);
             first_contained = it;
             last_contained  = std::next(it, n);
-            max_erased_size = std::max(max_erased_size, region_size(*largest_mappable(first, p.second)));
             num_erased += std::distance(first, p.second);
             first = p.second;
         } else {
@@ -645,15 +633,12 @@ MappableFlatSet<MappableType, Allocator>::erase_all(BidirIt first, const BidirIt
     
     if (num_erased > 0) {
         elements_.erase(last_element, std::end(elements_));
+        region_index_.assign(elements_);
         if (!elements_.empty()) {
             if (!is_bidirectionally_sorted_) {
                 is_bidirectionally_sorted_ = is_bidirectionally_sorted(elements_);
             }
-            if (max_element_size_ == max_erased_size) {
-                max_element_size_ = region_size(*largest_mappable(elements_));
-            }
         } else {
-            max_element_size_ = 0;
             is_bidirectionally_sorted_ = true;
         }
     }
@@ -666,7 +651,7 @@ void MappableFlatSet<MappableType, Allocator>::clear()
 {
     elements_.clear();
     is_bidirectionally_sorted_ = true;
-    max_element_size_ = 0;
+    region_index_.clear();
 }
 
 template <typename MappableType, typename Allocator>
@@ -734,9 +719,7 @@ const MappableType& MappableFlatSet<MappableType, Allocator>::rightmost() const
     if (is_bidirectionally_sorted_) {
         return last;
     } else {
-        using octopus::overlap_range;
-        const auto overlapped = overlap_range(std::cbegin(elements_), std::cend(elements_), last,
-                                              max_element_size_);
+        const auto overlapped = overlap_range(last);
         return *rightmost_mappable(std::cbegin(overlapped), std::cend(overlapped));
     }
 }
@@ -746,10 +729,6 @@ template <typename MappableType_>
 bool
 MappableFlatSet<MappableType, Allocator>::has_overlapped(const MappableType_& mappable) const
 {
-    using octopus::has_overlapped;
-    if (is_bidirectionally_sorted_) {
-        return has_overlapped(std::cbegin(elements_), std::cend(elements_), mappable, BidirectionallySortedTag {});
-    }
     return has_overlapped(std::cbegin(elements_), std::cend(elements_), mappable);
 }
 
@@ -763,7 +742,8 @@ MappableFlatSet<MappableType, Allocator>::has_overlapped(const_iterator first, c
     if (is_bidirectionally_sorted_) {
         return has_overlapped(first, last, mappable, BidirectionallySortedTag {});
     }
-    return has_overlapped(first, last, mappable, max_element_size_);
+    const auto it = find_first_after(first, last, mappable);
+    return region_index_.find_first_overlapped(std::cbegin(elements_), first, it, mappable) != it;
 }
 
 template <typename MappableType, typename Allocator>
@@ -784,7 +764,7 @@ MappableFlatSet<MappableType, Allocator>::count_overlapped(const_iterator first,
     if (is_bidirectionally_sorted_) {
         return count_overlapped(first, last, mappable, BidirectionallySortedTag {});
     }
-    return count_overlapped(first, last, mappable, max_element_size_);
+    return region_index_.count_overlapped(std::cbegin(elements_), first, find_first_after(first, last, mappable), mappable);
 }
 
 template <typename MappableType, typename Allocator>
@@ -805,7 +785,9 @@ MappableFlatSet<MappableType, Allocator>::overlap_range(const_iterator first, co
     if (is_bidirectionally_sorted_) {
         return overlap_range(first, last, mappable, BidirectionallySortedTag {});
     }
-    return overlap_range(first, last, mappable, max_element_size_);
+    const auto it1 = find_first_after(first, last, mappable);
+    const auto it2 = region_index_.find_first_overlapped(std::cbegin(elements_), first, it1, mappable);
+    return make_overlap_range(it2, it1, mappable);
 }
 
 template <typename MappableType, typename Allocator>
@@ -920,7 +902,7 @@ void swap(MappableFlatSet<MappableType, Allocator>& lhs,
     using std::swap;
     swap(lhs.elements_, rhs.elements_);
     swap(lhs.is_bidirectionally_sorted_, rhs.is_bidirectionally_sorted_);
-    swap(lhs.max_element_size_, rhs.max_element_size_);
+    swap(lhs.region_index_, rhs.region_index_);
 }
 
 } // namespace octopus
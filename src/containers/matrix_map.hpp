@@ -13,7 +13,11 @@
 #include <type_traits>
 #include <algorithm>
 #include <memory>
+#include <stdexcept>
 
+// Values are stored densely, one contiguous row of size2() values per Key1, in the order the
+// Key1s were inserted. The keys map to row and column indices through side tables, so hot loops
+// can look up keys once and then work on indices.
 template <
 typename Key1,
 typename Key2,
@@ -24,6 +28,7 @@ typename KeyEqual1 = std::equal_to<Key1>,
 typename KeyEqual2 = std::equal_to<Key2>
 > class MatrixMap
 {
+    using Key1ContainerType = std::vector<Key1>;
     using Key2ContainerType = std::vector<Key2>;
     using ValueContainerType = std::vector<T>;
     
@@ -43,8 +48,8 @@ typename KeyEqual2 = std::equal_to<Key2>
         }
     };
     
-    using ValueMap = std::unordered_map<Key1, ValueContainerType, Hash1, KeyEqual1>;
-    using IndexSizeType = typename ValueMap::mapped_type::size_type;
+    using IndexSizeType = typename ValueContainerType::size_type;
+    using Key1IndiceMap = std::unordered_map<Key1, IndexSizeType, Hash1, KeyEqual1>;
     using IndiceMap = std::unordered_map<std::reference_wrapper<const Key2>, IndexSizeType, Key2RefHash, Key2RefEqual>;
     
     using Key2Iterator  = typename Key2ContainerType::const_iterator;
@@ -65,8 +70,10 @@ public:
     }
     
     MatrixMap(const MatrixMap& other)
-    : key2s_ {other.key2s_}
+    : key1s_ {other.key1s_}
+    , key2s_ {other.key2s_}
     , values_ {other.values_}
+    , key1_indices_ {other.key1_indices_}
     {
         this->generate_indice_map();
     }
@@ -77,8 +84,10 @@ public:
             return *this;
         }
         
+        key1s_  = other.key1s_;
         key2s_  = other.key2s_;
         values_ = other.values_;
+        key1_indices_ = other.key1_indices_;
         
         this->regenerate_indice_map();
         
@@ -86,8 +95,10 @@ public:
     }
     
     MatrixMap(MatrixMap&& other)
-    : key2s_ {std::move(other.key2s_)}
+    : key1s_ {std::move(other.key1s_)}
+    , key2s_ {std::move(other.key2s_)}
     , values_ {std::move(other.values_)}
+    , key1_indices_ {std::move(other.key1_indices_)}
     {
         this->generate_indice_map();
     }
@@ -98,8 +109,10 @@ public:
             return *this;
         }
         
+        key1s_  = std::move(other.key1s_);
         key2s_  = std::move(other.key2s_);
         values_ = std::move(other.values_);
+        key1_indices_ = std::move(other.key1_indices_);
         
         this->regenerate_indice_map();
         
@@ -110,28 +123,85 @@ public:
     
     T& operator()(const Key1& key1, const Key2& key2)
     {
-        return values_.at(key1)[key2_indices_.at(key2)];
+        return at(index1(key1), index2(key2));
     }
     
     const T& operator()(const Key1& key1, const Key2& key2) const
     {
-        return values_.at(key1)[key2_indices_.at(key2)];
+        return at(index1(key1), index2(key2));
     }
     
     InnerSlice operator()(const Key1& key) const
     {
-        const auto& key_values = values_.at(key);
-        return InnerSlice {std::cbegin(key_values), std::cend(key_values)};
+        return values(index1(key));
     }
     
     InnerMap operator[](const Key1& key) const
     {
-        return InnerMap {this->begin(key), this->end(key), key2_indices_};
+        return row(index1(key));
+    }
+    
+    // index access
+    
+    size_type index1(const Key1& key) const
+    {
+        return key1_indices_.at(key);
+    }
+    
+    size_type index2(const Key2& key) const
+    {
+        return key2_indices_.at(key);
+    }
+    
+    const Key1& key1(size_type i) const
+    {
+        return key1s_[i];
+    }
+    
+    const Key2& key2(size_type j) const
+    {
+        return key2s_[j];
+    }
+    
+    const Key1ContainerType& keys1() const noexcept
+    {
+        return key1s_;
+    }
+    
+    const Key2ContainerType& keys2() const noexcept
+    {
+        return key2s_;
+    }
+    
+    T& at(size_type i, size_type j)
+    {
+        return values_[i * size2() + j];
+    }
+    
+    const T& at(size_type i, size_type j) const
+    {
+        return values_[i * size2() + j];
+    }
+    
+    InnerSlice values(size_type i) const
+    {
+        const auto row_begin = row_begin_itr(i);
+        return InnerSlice {row_begin, std::next(row_begin, size2())};
+    }
+    
+    InnerMap row(size_type i) const
+    {
+        return InnerMap {this->begin(i), this->end(i), key2_indices_};
+    }
+    
+    const T* data() const noexcept
+    {
+        return values_.data();
     }
     
     bool empty1() const noexcept
     {
-        return values_.empty();
+        return key1s_.empty();
     }
     
     bool empty2() const noexcept
@@ -141,7 +211,7 @@ public:
     
     size_type size1() const noexcept
     {
-        return values_.size();
+        return key1s_.size();
     }
     
     size_type size2() const noexcept
@@ -151,7 +221,9 @@ public:
     
     void reserve1(size_type n)
     {
-        values_.reserve(n);
+        key1s_.reserve(n);
+        key1_indices_.reserve(n);
+        values_.reserve(n * size2());
     }
     
     void reserve2(size_type n)
@@ -162,15 +234,15 @@ public:
     
     void reserve(size_type n1, size_type n2)
     {
-        reserve1(n1);
         reserve2(n2);
+        reserve1(n1);
     }
     
     void clear() noexcept
     {
         key2s_.clear();
-        values_.clear();
         key2_indices_.clear();
+        clear1();
     }
     
     template <typename InputIt>
@@ -178,19 +250,19 @@ public:
     {
         key2s_.assign(first, last);
         this->regenerate_indice_map();
-        if (!values_.empty()) {
-            values_.clear();
+        if (!key1s_.empty()) {
+            clear1();
             return true;
         }
-        return false;;
+        return false;
     }
     
     template <typename K>
     bool push_back(K&& key)
     {
         this->push_back_reallocate(std::forward<K>(key));
-        if (!values_.empty()) {
-            values_.clear();
+        if (!key1s_.empty()) {
+            clear1();
             return true;
         }
         return false;
@@ -200,8 +272,8 @@ public:
     bool emplace_back(Args&&... args)
     {
         this->emplace_back_reallocate(std::forward<Args>(args)...);
-        if (!values_.empty()) {
-            values_.clear();
+        if (!key1s_.empty()) {
+            clear1();
             return true;
         }
         return false;
@@ -214,26 +286,26 @@ public:
             throw std::out_of_range {"MatrixMap::insert_at called with value range of different"
                 " length to Key2 range in this MatrixMap"};
         }
-        
-        return values_.emplace(std::piecewise_construct,
-                               std::forward_as_tuple<K>(std::forward<K>(key)),
-                               std::make_tuple(first, last)).second;
+        if (key1_indices_.count(key) != 0) {
+            return false;
+        }
+        key1_indices_.emplace(key, key1s_.size());
+        key1s_.push_back(std::forward<K>(key));
+        values_.insert(std::end(values_), first, last);
+        return true;
     }
     
     template <typename K, typename InputIt>
     bool insert_or_assign_at(K&& key, InputIt first, InputIt last)
     {
-        if (values_.count(key) == 0) {
+        if (key1_indices_.count(key) == 0) {
             return insert_at(std::forward<K>(key), first, last);
         }
-        
-        if (std::distance(first, last) != this->size2()) {
+        if (static_cast<std::size_t>(std::distance(first, last)) != this->size2()) {
             throw std::out_of_range {"MatrixMap::insert_at called with value range of different"
                 " length to Key2 range in this MatrixMap"};
         }
-        
-        values_[std::forward<K>(key)].assign(first, last);
-        
+        std::copy(first, last, row_begin_itr(index1(key)));
         return false;
     }
     
@@ -244,40 +316,25 @@ public:
             throw std::out_of_range {"MatrixMap::insert_each called with value range of different"
                 " length to Key1 range in this MatrixMap"};
         }
-        
-        // TODO: not working for all forwards
-        //        if (key2_indices_.count(key) != 0) {
-        //            return false;
-        //        }
-        
-        for (auto& p : values_) {
-            p.second.push_back(*first++);
-        }
-        
+        this->insert_column(size2(), first);
         this->push_back_reallocate(std::forward<K>(key));
-        
         return true;
     }
     
     template <typename K, typename InputIt>
     bool insert_or_assign_each(K&& key, InputIt first, InputIt last)
     {
-        if (std::distance(first, last) != this->size1()) {
+        if (key2_indices_.count(key) == 0) {
+            return insert_each(std::forward<K>(key), first, last);
+        }
+        if (static_cast<std::size_t>(std::distance(first, last)) != this->size1()) {
             throw std::out_of_range {"MatrixMap::insert_each called with value range of different"
                 " length to Key1 range in this MatrixMap"};
         }
-        if (key2_indices_.count(key) == 0) {
-            for (auto& p : values_) {
-                p.second.push_back(*first++);
-            }
-            this->push_back_reallocate(std::forward<K>(key));
-            return true;
-        }
-        const auto index = key2_indices_[key];
-        for (auto& p : values_) {
-            p.second[index] = *first++;
+        const auto index = index2(key);
+        for (size_type i {0}; i < size1(); ++i) {
+            at(i, index) = *first++;
         }
-        this->push_back_reallocate(std::forward<K>(key));
         return false;
     }
     
@@ -286,16 +343,25 @@ public:
         if (key2s_.empty()) {
             return;
         }
+        this->erase_column(size2() - 1);
         key2_indices_.erase(key2s_.back());
         key2s_.pop_back();
-        for (auto& p : values_) {
-            p.second.pop_back();
-        }
     }
     
     bool erase1(const Key1& key)
     {
-        return values_.erase(key) == 1;
+        if (key1_indices_.count(key) == 0) {
+            return false;
+        }
+        const auto key_index = index1(key);
+        const auto row_begin = std::next(std::begin(values_), key_index * size2());
+        values_.erase(row_begin, std::next(row_begin, size2()));
+        key1s_.erase(std::next(std::begin(key1s_), key_index));
+        key1_indices_.erase(key);
+        for (auto i = key_index; i < key1s_.size(); ++i) {
+            key1_indices_[key1s_[i]] = i;
+        }
+        return true;
     }
     
     bool erase2(const Key2& key)
@@ -303,44 +369,18 @@ public:
         if (key2_indices_.count(key) == 0) {
             return false;
         }
-        const auto key_index = key2_indices_[key];
-        for (auto& p : values_) {
-            p.second.erase(std::next(std::begin(p.second), key_index));
-        }
-        const auto it = key2s_.erase(std::next(std::begin(key2s_), key_index));
-        key2_indices_.erase(key);
-        std::for_each(it, std::end(key2s_), [this] (const auto& key) { --key2_indices_[key]; });
+        const auto key_index = index2(key);
+        this->erase_column(key_index);
+        key2s_.erase(std::next(std::begin(key2s_), key_index));
+        this->regenerate_indice_map();
         return true;
     }
     
-    // TODO
-    template <typename InputIt>
-    size_type remove_keys(InputIt first, InputIt last)
-    {
-        const auto key2_begin = std::begin(key2s_);
-        const auto key2_end   = std::end(key2s_);
-        const auto it = std::find_first_of(key2_begin, key2_end, first, last);
-        
-        if (it == key2_end) return 0;
-        
-        std::vector<IndexSizeType> indices_removed {};
-        indices_removed.reserve(std::distance(it, key2_end));
-        auto i = std::distance(key2_begin, it);
-        indices_removed.push_back(i++);
-        for (auto it2 = it; ++it != key2_end; ++i) {
-            if (std::find(first, last, *it) == last) {
-                *it++ = std::move(*it2);
-            } else {
-                indices_removed.push_back(i);
-            }
-        }
-        indices_removed.shrink_to_fit();
-        return 1;
-    }
-    
 private:
+    Key1ContainerType key1s_;
     Key2ContainerType key2s_;
-    ValueMap values_;
+    ValueContainerType values_;
+    Key1IndiceMap key1_indices_;
     IndiceMap key2_indices_;
     
     void generate_indice_map()
@@ -358,6 +398,50 @@ private:
         generate_indice_map();
     }
     
+    void clear1() noexcept
+    {
+        key1s_.clear();
+        values_.clear();
+        key1_indices_.clear();
+    }
+    
+    ValueIterator row_begin_itr(size_type i) const
+    {
+        return std::next(std::cbegin(values_), i * size2());
+    }
+    
+    typename ValueContainerType::iterator row_begin_itr(size_type i)
+    {
+        return std::next(std::begin(values_), i * size2());
+    }
+    
+    // Must be called before key2s_ is updated
+    template <typename InputIt>
+    void insert_column(size_type j, InputIt first)
+    {
+        ValueContainerType values {};
+        values.reserve(size1() * (size2() + 1));
+        for (size_type i {0}; i < size1(); ++i) {
+            const auto row_begin = row_begin_itr(i);
+            values.insert(std::end(values), row_begin, std::next(row_begin, j));
+            values.push_back(*first++);
+            values.insert(std::end(values), std::next(row_begin, j), std::next(row_begin, size2()));
+        }
+        values_ = std::move(values);
+    }
+    
+    // Must be called before key2s_ is updated
+    void erase_column(size_type j)
+    {
+        auto out = std::begin(values_);
+        for (size_type i {0}; i < size1(); ++i) {
+            for (size_type k {0}; k < size2(); ++k) {
+                if (k != j) *out++ = std::move(at(i, k));
+            }
+        }
+        values_.erase(out, std::end(values_));
+    }
+    
     template <typename K>
     void push_back_reallocate(K&& key)
     {
@@ -451,14 +535,24 @@ public:
         ValueIterator value_itr_;
     };
     
+    ZipIterator begin(size_type i) const
+    {
+        return ZipIterator {std::begin(key2s_), row_begin_itr(i)};
+    }
+    
+    ZipIterator end(size_type i) const
+    {
+        return ZipIterator {std::end(key2s_), row_begin_itr(i + 1)};
+    }
+    
     ZipIterator begin(const Key1& key) const
     {
-        return ZipIterator {std::begin(key2s_), std::begin(values_.at(key))};
+        return begin(index1(key));
     }
     
     ZipIterator end(const Key1& key) const
     {
-        return ZipIterator {std::end(key2s_), std::end(values_.at(key))};
+        return end(index1(key));
     }
     
     ZipIterator cbegin(const Key1& key) const
@@ -471,10 +565,6 @@ public:
         return end(key);
     }
     
-private:
-    using ValueMapIterator = typename ValueMap::const_iterator;
-    
-public:
     class InnerMap
     {
     public:
@@ -513,6 +603,16 @@ public:
             return *std::next(begin_.value_itr_, key2_indices_.get().at(key));
         }
         
+        const T& at(IndexSizeType j) const
+        {
+            return *std::next(begin_.value_itr_, j);
+        }
+        
+        InnerSlice values() const
+        {
+            return InnerSlice {begin_.value_itr_, end_.value_itr_};
+        }
+        
     private:
         ZipIterator begin_, end_;
         std::reference_wrapper<const IndiceMap> key2_indices_;
@@ -523,46 +623,38 @@ public:
     public:
         using iterator_category = std::forward_iterator_tag;
         using value_type        = std::pair<const Key1&, InnerMap>;
-        using difference_type   = typename std::iterator_traits<Key2Iterator>::difference_type;
+        using difference_type   = std::ptrdiff_t;
         using reference         = value_type;
         using pointer           = value_type*;
         
         Iterator() = delete;
         
-        explicit Iterator(ValueMapIterator map_itr, Key2Iterator key2_begin_itr,
-                          const IndiceMap& key2_indices)
-        : map_itr_ {map_itr}
-        , key2_begin_itr_ {key2_begin_itr}
-        , key2_indices_ {key2_indices}
+        explicit Iterator(const MatrixMap& map, size_type index)
+        : map_ {map}
+        , index_ {index}
         {}
         
         ~Iterator() = default;
         
         Iterator& operator++()
         {
-            map_itr_++;
+            ++index_;
             return *this;
         }
         
         value_type operator*() const
         {
-            const auto zip1 = ZipIterator {key2_begin_itr_, std::begin(map_itr_->second)};
-            const auto zip2 = ZipIterator {std::next(key2_begin_itr_, key2_indices_.get().size()),
-                std::end(map_itr_->second)};
-            return std::make_pair(std::ref(map_itr_->first), InnerMap {zip1, zip2, key2_indices_});
+            return std::make_pair(std::ref(map_.get().key1(index_)), map_.get().row(index_));
         }
         
         auto operator->() const
         {
-            const auto zip1 = ZipIterator {key2_begin_itr_, std::begin(map_itr_->second)};
-            const auto zip2 = ZipIterator {std::next(key2_begin_itr_, key2_indices_.get().size()),
-                std::end(map_itr_->second)};
-            return std::make_unique<value_type>(map_itr_->first, InnerMap {zip1, zip2, key2_indices_});
+            return std::make_unique<value_type>(map_.get().key1(index_), map_.get().row(index_));
         }
         
         friend bool operator==(const Iterator& lhs, const Iterator& rhs)
         {
-            return lhs.map_itr_ == rhs.map_itr_;
+            return lhs.index_ == rhs.index_;
         }
         
         friend bool operator!=(const Iterator& lhs, const Iterator& rhs)
@@ -571,13 +663,12 @@ public:
         }
         
     private:
-        ValueMapIterator map_itr_;
-        Key2Iterator key2_begin_itr_;
-        std::reference_wrapper<const IndiceMap> key2_indices_;
+        std::reference_wrapper<const MatrixMap> map_;
+        size_type index_;
     };
     
-    Iterator begin() const { return Iterator {std::cbegin(values_), std::begin(key2s_), key2_indices_}; }
-    Iterator end() const { return Iterator {std::cend(values_), std::begin(key2s_), key2_indices_}; }
+    Iterator begin() const { return Iterator {*this, 0}; }
+    Iterator end() const { return Iterator {*this, size1()}; }
     Iterator cbegin() const { return begin(); }
     Iterator cend() const { return end(); }
 };
@@ -18,7 +18,7 @@ template <typename T>
 using ProbabilityMatrix = MatrixMap<SampleName, T, double>;
 
 template <typename T>
-using SampleProbabilities = typename ProbabilityMatrix<T>::ZipSlice;
+using SampleProbabilities = typename ProbabilityMatrix<T>::InnerSlice;
 
 template <typename T>
 auto num_samples(const ProbabilityMatrix<T>& matrix)
@@ -33,13 +33,7 @@ auto extract_keys(const ProbabilityMatrix<T>& matrix)
     
     if (matrix.empty1()) return result;
     
-    result.reserve(matrix.size2());
-    
-    const auto& test_sample = matrix.begin()->first;
-    
-    for (const auto& p : matrix[test_sample]) {
-        result.emplace_back(p.first);
-    }
+    result = matrix.keys2();
     
     return result;
 }
@@ -51,13 +45,7 @@ auto extract_key_refs(const ProbabilityMatrix<T>& matrix)
     
     if (matrix.empty1()) return result;
     
-    result.reserve(matrix.size2());
-    
-    const auto& test_sample = matrix.begin()->first;
-    
-    for (const auto& p : matrix[test_sample]) {
-        result.emplace_back(p.first);
-    }
+    result.assign(std::cbegin(matrix.keys2()), std::cend(matrix.keys2()));
     
     return result;
 }
@@ -0,0 +1,204 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef region_index_hpp
+#define region_index_hpp
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "concepts/mappable.hpp"
+#include "utils/interval_kernels.hpp"
+
+namespace octopus {
+
+/*
+ RegionIndex keeps the running maximum end position of a sorted sequence of mappables. The running
+ maximum is monotonic, so the first element that can overlap a query is found by binary search no matter
+ how the element sizes are distributed. Bounding the search by the largest element size instead means a
+ single long element makes every query scan back over that length.
+ 
+ The element regions are also kept as packed int32 begins and ends, so the scan over the candidates
+ for overlap reads a few bytes per element rather than the elements themselves (e.g. whole reads).
+ */
+template <typename MappableType>
+class RegionIndex
+{
+public:
+    using Position = typename RegionType<MappableType>::Position;
+
+    RegionIndex() = default;
+
+    RegionIndex(const RegionIndex&)            = default;
+    RegionIndex& operator=(const RegionIndex&) = default;
+    RegionIndex(RegionIndex&&)                 = default;
+    RegionIndex& operator=(RegionIndex&&)      = default;
+
+    ~RegionIndex() = default;
+
+    template <typename Range>
+    void assign(const Range& elements);
+    // Call after count elements are inserted into elements at pos
+    template <typename Range>
+    void insert(const Range& elements, std::size_t pos, std::size_t count = 1);
+    // Call after count elements are erased from elements at pos
+    template <typename Range>
+    void erase(const Range& elements, std::size_t pos, std::size_t count = 1);
+    void clear() noexcept;
+
+    // Returns the first iterator in [first, last) that may overlap mappable, where
+    // elements_begin is the beginning of the indexed elements
+    template <typename RandomIt, typename MappableTp>
+    RandomIt lower_bound(RandomIt elements_begin, RandomIt first, RandomIt last, const MappableTp& mappable) const;
+    // Returns the first iterator in [first, last) that overlaps mappable, or last
+    template <typename RandomIt, typename MappableTp>
+    RandomIt find_first_overlapped(RandomIt elements_begin, RandomIt first, RandomIt last, const MappableTp& mappable) const;
+    template <typename RandomIt, typename MappableTp>
+    std::size_t count_overlapped(RandomIt elements_begin, RandomIt first, RandomIt last, const MappableTp& mappable) const;
+
+    template <typename M>
+    friend void swap(RegionIndex<M>& lhs, RegionIndex<M>& rhs) noexcept;
+
+private:
+    using PackedPosition = std::int32_t;
+
+    std::vector<Position> max_ends_;
+    std::vector<PackedPosition> begins_, ends_;
+
+    static PackedPosition pack(Position position) noexcept;
+
+    template <typename Range>
+    void update(const Range& elements, std::size_t pos, std::size_t first_unchanged);
+};
+
+template <typename MappableType>
+template <typename Range>
+void RegionIndex<MappableType>::assign(const Range& elements)
+{
+    max_ends_.resize(elements.size());
+    update(elements, 0, elements.size());
+    begins_.clear(); ends_.clear();
+    begins_.reserve(elements.size()); ends_.reserve(elements.size());
+    for (const auto& element : elements) {
+        begins_.push_back(pack(mapped_begin(element)));
+        ends_.push_back(pack(mapped_end(element)));
+    }
+}
+
+template <typename MappableType>
+template <typename Range>
+void RegionIndex<MappableType>::insert(const Range& elements, const std::size_t pos, const std::size_t count)
+{
+    max_ends_.insert(std::next(std::begin(max_ends_), pos), count, Position {});
+    update(elements, pos, pos + count);
+    begins_.insert(std::next(std::begin(begins_), pos), count, PackedPosition {});
+    ends_.insert(std::next(std::begin(ends_), pos), count, PackedPosition {});
+    auto element_itr = std::next(std::cbegin(elements), pos);
+    for (auto i = pos; i < pos + count; ++i, ++element_itr) {
+        begins_[i] = pack(mapped_begin(*element_itr));
+        ends_[i] = pack(mapped_end(*element_itr));
+    }
+}
+
+template <typename MappableType>
+template <typename Range>
+void RegionIndex<MappableType>::erase(const Range& elements, const std::size_t pos, const std::size_t count)
+{
+    const auto first = std::next(std::begin(max_ends_), pos);
+    max_ends_.erase(first, std::next(first, count));
+    update(elements, pos, pos);
+    const auto first_begin = std::next(std::begin(begins_), pos);
+    begins_.erase(first_begin, std::next(first_begin, count));
+    const auto first_end = std::next(std::begin(ends_), pos);
+    ends_.erase(first_end, std::next(first_end, count));
+}
+
+template <typename MappableType>
+void RegionIndex<MappableType>::clear() noexcept
+{
+    max_ends_.clear();
+    begins_.clear();
+    ends_.clear();
+}
+
+template <typename MappableType>
+template <typename RandomIt, typename MappableTp>
+RandomIt
+RegionIndex<MappableType>::lower_bound(const RandomIt elements_begin, const RandomIt first, const RandomIt last,
+                                       const MappableTp& mappable) const
+{
+    // Anything overlapping mappable must end at or after its begin
+    const auto query_begin = mapped_begin(mappable);
+    const auto index_first = std::next(std::cbegin(max_ends_), std::distance(elements_begin, first));
+    const auto index_last  = std::next(std::cbegin(max_ends_), std::distance(elements_begin, last));
+    const auto itr = std::partition_point(index_first, index_last,
+                                          [query_begin] (const auto end) { return end < query_begin; });
+    return std::next(first, std::distance(index_first, itr));
+}
+
+template <typename MappableType>
+template <typename RandomIt, typename MappableTp>
+RandomIt
+RegionIndex<MappableType>::find_first_overlapped(const RandomIt elements_begin, RandomIt first, const RandomIt last,
+                                                 const MappableTp& mappable) const
+{
+    first = lower_bound(elements_begin, first, last, mappable);
+    const auto pos = static_cast<std::size_t>(std::distance(elements_begin, first));
+    const auto n = static_cast<std::size_t>(std::distance(first, last));
+    return std::next(first, utils::find_first_overlapping(begins_.data() + pos, ends_.data() + pos, n,
+                                                          pack(mapped_begin(mappable)), pack(mapped_end(mappable))));
+}
+
+template <typename MappableType>
+template <typename RandomIt, typename MappableTp>
+std::size_t
+RegionIndex<MappableType>::count_overlapped(const RandomIt elements_begin, RandomIt first, const RandomIt last,
+                                            const MappableTp& mappable) const
+{
+    first = lower_bound(elements_begin, first, last, mappable);
+    const auto pos = static_cast<std::size_t>(std::distance(elements_begin, first));
+    const auto n = static_cast<std::size_t>(std::distance(first, last));
+    return utils::count_overlapping(begins_.data() + pos, ends_.data() + pos, n,
+                                    pack(mapped_begin(mappable)), pack(mapped_end(mappable)));
+}
+
+// Biased so signed comparisons order every 32-bit position; larger positions (i.e. unbounded
+// query ends) saturate.
+template <typename MappableType>
+typename RegionIndex<MappableType>::PackedPosition RegionIndex<MappableType>::pack(const Position position) noexcept
+{
+    const auto clamped = std::min<Position>(position, std::numeric_limits<std::uint32_t>::max());
+    return static_cast<PackedPosition>(static_cast<std::int64_t>(clamped) + std::numeric_limits<PackedPosition>::min());
+}
+
+// Recomputes the running maximum from pos, stopping early once it agrees with an entry that was
+// already valid as nothing past that point can change.
+template <typename MappableType>
+template <typename Range>
+void RegionIndex<MappableType>::update(const Range& elements, std::size_t pos, const std::size_t first_unchanged)
+{
+    auto element_itr = std::next(std::cbegin(elements), pos);
+    for (; pos < max_ends_.size(); ++pos, ++element_itr) {
+        auto max_end = mapped_end(*element_itr);
+        if (pos > 0) max_end = std::max(max_end, max_ends_[pos - 1]);
+        if (pos >= first_unchanged && max_ends_[pos] == max_end) break;
+        max_ends_[pos] = max_end;
+    }
+}
+
+template <typename MappableType>
+void swap(RegionIndex<MappableType>& lhs, RegionIndex<MappableType>& rhs) noexcept
+{
+    using std::swap;
+    swap(lhs.max_ends_, rhs.max_ends_);
+    swap(lhs.begins_, rhs.begins_);
+    swap(lhs.ends_, rhs.ends_);
+}
+
+} // namespace octopus
+
+#endif
@@ -6,10 +6,15 @@
 #include <algorithm>
 #include <utility>
 #include <tuple>
+#include <numeric>
+#include <unordered_map>
 #include <iterator>
 #include <stdexcept>
 #include <cassert>
 #include <iostream>
+#include <functional>
+#include <future>
+#include <memory>
 
 #include "concepts/mappable.hpp"
 #include "core/types/calls/call.hpp"
@@ -24,6 +29,10 @@
 #include "utils/read_stats.hpp"
 #include "utils/maths.hpp"
 #include "utils/append.hpp"
+#include "utils/stage_profiler.hpp"
+#include "utils/region_snapshot.hpp"
+#include "utils/monotonic_arena.hpp"
+#include "logging/live_metrics.hpp"
 
 namespace octopus {
 
@@ -39,6 +48,7 @@ Caller::Caller(Components&& components, Parameters parameters)
 , haplotype_generator_builder_ {std::move(components.haplotype_generator_builder)}
 , likelihood_model_ {std::move(components.likelihood_model)}
 , phaser_ {std::move(components.phaser)}
+, likelihood_workers_ {std::move(components.likelihood_workers)}
 , parameters_ {std::move(parameters)}
 {
     if (parameters_.max_haplotypes == 0) {
@@ -140,12 +150,101 @@ auto convert_to_vcf(std::deque<CallWrapper>&& calls, const VcfRecordFactory& fac
 
 } // namespace
 
-std::deque<VcfRecord> Caller::call(const GenomicRegion& call_region, ProgressMeter& progress_meter) const
+CallRegionSplitter::CallRegionSplitter(GenomicRegion call_region)
+: region_ {std::move(call_region)}
+, claimed_end_ {region_.begin()}
+, closed_ {false}
+{}
+
+GenomicRegion CallRegionSplitter::region() const
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    return region_;
+}
+
+GenomicRegion::Size CallRegionSplitter::unclaimed_size() const
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    return !closed_ && claimed_end_ < region_.end() ? region_.end() - claimed_end_ : 0;
+}
+
+boost::optional<GenomicRegion> CallRegionSplitter::split(const GenomicRegion::Size min_size)
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    if (closed_ || claimed_end_ >= region_.end()) return boost::none;
+    const auto split_position = claimed_end_ + (region_.end() - claimed_end_) / 2;
+    if (split_position - region_.begin() < min_size || region_.end() - split_position < min_size) return boost::none;
+    GenomicRegion result {region_.contig_name(), split_position, region_.end()};
+    region_ = GenomicRegion {region_.contig_name(), region_.begin(), split_position};
+    return result;
+}
+
+bool CallRegionSplitter::try_claim(const GenomicRegion& active_region)
 {
+    std::lock_guard<std::mutex> lock {mutex_};
+    if (closed_ || mapped_begin(active_region) >= region_.end()) return false;
+    claimed_end_ = std::max(claimed_end_, mapped_end(active_region));
+    return true;
+}
+
+GenomicRegion CallRegionSplitter::close()
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    closed_ = true;
+    return region_;
+}
+
+namespace {
+
+std::size_t estimate_memory(const ReadMap& reads)
+{
+    std::size_t result {0};
+    for (const auto& p : reads) result += footprint(p.second).bytes();
+    return result;
+}
+
+// Genotype posteriors hold a copy of each genotype, an index entry for it, and a probability per sample
+std::size_t estimate_genotype_posteriors_memory(const std::size_t num_genotypes, const unsigned ploidy,
+                                                const std::size_t num_samples) noexcept
+{
+    return estimate_genotypes_footprint(num_genotypes, ploidy).bytes()
+           + num_genotypes * (num_samples * sizeof(double) + sizeof(std::size_t) + 3 * sizeof(void*));
+}
+
+} // namespace
+
+MemoryFootprint Caller::Latents::footprint() const
+{
+    std::size_t bytes {0};
+    const auto genotypes = genotype_posteriors();
+    // The genotype ploidies are not visible through the posterior map
+    if (genotypes) bytes += estimate_genotype_posteriors_memory(genotypes->size2(), 0, genotypes->size1());
+    const auto haplotypes = haplotype_posteriors();
+    if (haplotypes) bytes += haplotypes->size() * (sizeof(HaplotypeReference) + sizeof(double) + 2 * sizeof(void*));
+    return bytes;
+}
+
+std::deque<VcfRecord> Caller::call(const GenomicRegion& call_region, ProgressMeter& progress_meter,
+                                   CallRegionSplitter* splitter) const
+{
+    TaskArenaScope arena_scope {};
+    profiling::RegionTrace trace {call_region};
+    const logging::LogSamplingScope log_sampling {std::hash<GenomicRegion> {}(call_region)};
+    // Unsampled regions skip building debug messages as well as writing them
+    debug_log_ = log_sampling.is_sampled() ? logging::get_debug_log() : boost::none;
+    trace_log_ = log_sampling.is_sampled() ? logging::get_trace_log() : boost::none;
     ReadPipe::Report reads_report {};
     ReadMap reads;
     if (candidate_generator_.requires_reads()) {
-        reads = read_pipe_.get().fetch_reads(expand(call_region, 100), reads_report);
+        const auto read_region = expand(call_region, 100);
+        if (can_skip_without_reads(read_region)) {
+            if (debug_log_) stream(*debug_log_) << "Skipping call region " << call_region << " as no reads show variation";
+            candidate_generator_.reset_read_window();
+            progress_meter.log_completed(call_region);
+            return {};
+        }
+        reads = read_pipe_.get().fetch_reads(read_region, reads_report);
+        candidate_generator_.slide_read_window(read_region);
         add_reads(reads, candidate_generator_);
         if (!refcalls_requested() && all_empty(reads)) {
             if (debug_log_) stream(*debug_log_) << "Stopping early as no reads found in call region " << call_region;
@@ -164,13 +263,30 @@ std::deque<VcfRecord> Caller::call(const GenomicRegion& call_region, ProgressMet
         // as we didn't fetch them earlier
         reads = read_pipe_.get().fetch_reads(call_region, reads_report);
     }
-    auto calls = call_variants(call_region, candidates, reads, reads_report, progress_meter);
-    candidates.clear();
-    candidates.shrink_to_fit();
-    progress_meter.log_completed(call_region);
-    const auto record_factory = make_record_factory(reads);
-    if (debug_log_) stream(*debug_log_) << "Converting " << calls.size() << " calls made in " << call_region << " to VCF";
-    return convert_to_vcf(std::move(calls), record_factory, call_region);
+    if (is_capturing_region_snapshots()) {
+        const auto snapshot_path = get_region_snapshot_path(call_region);
+        if (snapshot_path) {
+            write_region_snapshot(make_region_snapshot(call_region, reads, candidates, reference_,
+                                                       get_region_snapshot_command_line()), *snapshot_path);
+            if (debug_log_) stream(*debug_log_) << "Wrote snapshot of call region " << call_region << " to " << *snapshot_path;
+        }
+    }
+    return call_with_candidates(call_region, candidates, reads, reads_report, progress_meter, splitter, trace);
+}
+
+std::deque<VcfRecord> Caller::call(const GenomicRegion& call_region, MappableFlatSet<Variant> candidates,
+                                   const ReadMap& reads, ProgressMeter& progress_meter) const
+{
+    TaskArenaScope arena_scope {};
+    profiling::RegionTrace trace {call_region};
+    const logging::LogSamplingScope log_sampling {std::hash<GenomicRegion> {}(call_region)};
+    debug_log_ = log_sampling.is_sampled() ? logging::get_debug_log() : boost::none;
+    trace_log_ = log_sampling.is_sampled() ? logging::get_trace_log() : boost::none;
+    if (!refcalls_requested() && candidates.empty()) {
+        progress_meter.log_completed(call_region);
+        return {};
+    }
+    return call_with_candidates(call_region, candidates, reads, ReadPipe::Report {}, progress_meter, nullptr, trace);
 }
 
 std::vector<VcfRecord> Caller::regenotype(const std::vector<Variant>& variants, ProgressMeter& progress_meter) const
@@ -190,6 +306,27 @@ auto assign_and_realign(const std::vector<AlignedRead>& reads, const Genotype<Ha
 
 // private methods
 
+std::deque<VcfRecord>
+Caller::call_with_candidates(const GenomicRegion& call_region, MappableFlatSet<Variant>& candidates, const ReadMap& reads,
+                             const ReadPipe::Report& reads_report, ProgressMeter& progress_meter, CallRegionSplitter* splitter,
+                             profiling::RegionTrace& trace) const
+{
+    if (profiling::is_region_tracing()) {
+        profiling::count(profiling::RegionTrace::Counter::reads, count_reads(reads));
+        profiling::count(profiling::RegionTrace::Counter::candidates, candidates.size());
+        profiling::note_memory(estimate_memory(reads));
+    }
+    auto calls = call_variants(call_region, candidates, reads, reads_report, progress_meter, splitter);
+    candidates.clear();
+    candidates.shrink_to_fit();
+    const auto final_call_region = splitter ? splitter->close() : call_region;
+    trace.set_region(final_call_region);
+    progress_meter.log_completed(final_call_region);
+    const auto record_factory = make_record_factory(reads);
+    if (debug_log_) stream(*debug_log_) << "Converting " << calls.size() << " calls made in " << final_call_region << " to VCF";
+    return convert_to_vcf(std::move(calls), record_factory, final_call_region);
+}
+
 namespace debug {
 
 template <typename S>
@@ -294,12 +431,43 @@ bool has_reference(const Container& haplotypes)
     return find_reference(haplotypes) != std::cend(haplotypes);
 }
 
+bool is_informative(const AlignedRead& read, const MappableFlatSet<Variant>& candidates,
+                    const GenomicRegion& active_region)
+{
+    const auto overlapped = overlap_range(candidates, read);
+    return std::any_of(std::cbegin(overlapped), std::cend(overlapped),
+                       [&] (const Variant& candidate) { return contains(active_region, candidate); });
+}
+
+ReadMap sample_informative_reads(const ReadMap& active_reads, const MappableFlatSet<Variant>& candidates,
+                                 const GenomicRegion& active_region, const std::size_t max_reads_per_sample)
+{
+    ReadMap result {active_reads.size()};
+    for (const auto& p : active_reads) {
+        std::vector<AlignedRead> informative_reads {};
+        std::copy_if(std::cbegin(p.second), std::cend(p.second), std::back_inserter(informative_reads),
+                     [&] (const AlignedRead& read) { return is_informative(read, candidates, active_region); });
+        if (informative_reads.size() > max_reads_per_sample) {
+            // Evenly spaced so the sample covers the whole active region
+            std::vector<AlignedRead> sampled_reads {};
+            sampled_reads.reserve(max_reads_per_sample);
+            for (std::size_t i {0}; i < max_reads_per_sample; ++i) {
+                sampled_reads.push_back(std::move(informative_reads[i * informative_reads.size() / max_reads_per_sample]));
+            }
+            informative_reads = std::move(sampled_reads);
+        }
+        result.emplace(p.first, ReadContainer {std::make_move_iterator(std::begin(informative_reads)),
+                                               std::make_move_iterator(std::end(informative_reads))});
+    }
+    return result;
+}
+
 } // namespace
 
 std::deque<CallWrapper>
 Caller::call_variants(const GenomicRegion& call_region, const MappableFlatSet<Variant>& candidates,
                       const ReadMap& reads, const ReadPipe::Report& read_report,
-                      ProgressMeter& progress_meter) const
+                      ProgressMeter& progress_meter, CallRegionSplitter* splitter) const
 {
     std::deque<CallWrapper> result {};
     auto haplotype_likelihoods = make_haplotype_likelihood_cache();
@@ -311,21 +479,52 @@ Caller::call_variants(const GenomicRegion& call_region, const MappableFlatSet<Va
         return result;
     }
     auto haplotype_generator = make_haplotype_generator(candidates, reads, read_report);
+    const auto read_bytes = profiling::is_region_tracing() ? estimate_memory(reads) : 0;
     GeneratorStatus status;
     std::vector<Haplotype> haplotypes {}, next_haplotypes {};
     GenomicRegion active_region;
     boost::optional<GenomicRegion> next_active_region {}, prev_called_region {}, backtrack_region {};
     auto completed_region = head_region(call_region);
     std::deque<Haplotype> protected_haplotypes {};
+    HaplotypePosteriorVector previous_haplotype_posteriors {};
+    // When pipelining, an active region is called and phased on a helper thread while the next active
+    // region is populated and its latents inferred. The debug and trace loggers are not thread safe.
+    const bool pipeline_calls {parameters_.pipeline_active_regions && !debug_log_ && !trace_log_};
+    struct PendingCalls
+    {
+        GenomicRegion active_region;
+        boost::optional<GenomicRegion> next_active_region, backtrack_region;
+        std::vector<Haplotype> haplotypes;
+        HaplotypeLikelihoodArray haplotype_likelihoods;
+        std::unique_ptr<Latents> latents;
+    };
+    auto spare_haplotype_likelihoods = pipeline_calls ? make_haplotype_likelihood_cache() : HaplotypeLikelihoodArray {};
+    std::unique_ptr<PendingCalls> pending_calls {};
+    std::future<void> pending_calls_done {};
+    const auto finish_pending_calls = [&] () {
+        if (pending_calls) {
+            pending_calls_done.get();
+            progress_meter.log_completed(completed_region);
+            spare_haplotype_likelihoods = std::move(pending_calls->haplotype_likelihoods);
+            spare_haplotype_likelihoods.clear();
+            pending_calls.reset();
+        }
+    };
     while (true) {
         status = generate_active_haplotypes(call_region, haplotype_generator, active_region,
                                             next_active_region, haplotypes, next_haplotypes);
+        if (status != GeneratorStatus::done && splitter && !splitter->try_claim(active_region)) {
+            if (debug_log_) stream(*debug_log_) << "Stopping before active region " << active_region << " as the call region was split";
+            status = GeneratorStatus::done;
+        }
         if (status == GeneratorStatus::done) {
+            finish_pending_calls();
+            const auto final_call_region = splitter ? splitter->close() : call_region;
             if (refcalls_requested()) {
                 if (!prev_called_region) {
-                    utils::append(call_reference(call_region, reads), result);
-                } else if (ends_before(*prev_called_region, call_region)) {
-                    const auto final_refcall_region = right_overhang_region(call_region, *prev_called_region);
+                    utils::append(call_reference(final_call_region, reads), result);
+                } else if (ends_before(*prev_called_region, final_call_region)) {
+                    const auto final_refcall_region = right_overhang_region(final_call_region, *prev_called_region);
                     utils::append(call_reference(final_refcall_region, reads), result);
                 }
             }
@@ -343,7 +542,13 @@ Caller::call_variants(const GenomicRegion& call_region, const MappableFlatSet<Va
             continue;
         }
         if (debug_log_) stream(*debug_log_) << "There are " << count_reads(active_reads) << " active reads in " << active_region;
-        if (!populate(haplotype_likelihoods, active_region, haplotypes, candidates, active_reads)) {
+        boost::optional<ReadMap> staged_reads {};
+        if (use_staged_likelihoods(haplotypes, active_reads)) {
+            staged_reads = sample_informative_reads(active_reads, candidates, active_region,
+                                                    parameters_.staged_likelihood_reads);
+            if (debug_log_) stream(*debug_log_) << "Staging likelihoods with " << count_reads(*staged_reads) << " informative reads";
+        }
+        if (!populate(haplotype_likelihoods, active_region, haplotypes, candidates, staged_reads ? *staged_reads : active_reads)) {
             haplotype_generator.clear_progress();
             haplotype_likelihoods.clear();
             continue;
@@ -360,9 +565,37 @@ Caller::call_variants(const GenomicRegion& call_region, const MappableFlatSet<Va
                 insert_sorted(*reference_haplotype_itr, protected_haplotypes);
             }
         }
-        auto has_removal_impact = filter_haplotypes(haplotypes, haplotype_generator, haplotype_likelihoods, protected_haplotypes);
+        bool has_removal_impact {false};
+        if (staged_reads) {
+            // Keep a generous margin as the sampled reads only approximate the full likelihoods
+            has_removal_impact = filter_haplotypes(haplotypes, haplotype_generator, haplotype_likelihoods,
+                                                   protected_haplotypes, 2 * parameters_.max_haplotypes);
+            if (haplotypes.empty()) continue;
+            staged_reads = boost::none;
+            haplotype_likelihoods.clear();
+            if (!populate(haplotype_likelihoods, active_region, haplotypes, candidates, active_reads)) {
+                haplotype_generator.clear_progress();
+                haplotype_likelihoods.clear();
+                continue;
+            }
+        }
+        if (filter_haplotypes(haplotypes, haplotype_generator, haplotype_likelihoods, protected_haplotypes)) {
+            has_removal_impact = true;
+        }
         if (haplotypes.empty()) continue;
-        const auto caller_latents = infer_latents(haplotypes, haplotype_likelihoods);
+        auto caller_latents = timed_infer_latents(haplotypes, haplotype_likelihoods, previous_haplotype_posteriors);
+        if (parameters_.warm_start_latents) {
+            previous_haplotype_posteriors.clear();
+            for (const auto& p : *caller_latents->haplotype_posteriors()) {
+                previous_haplotype_posteriors.emplace_back(p.first.get(), p.second);
+            }
+        }
+        if (profiling::is_region_tracing()) {
+            using Counter = profiling::RegionTrace::Counter;
+            profiling::count(Counter::haplotypes, haplotypes.size());
+            profiling::count(Counter::genotypes, caller_latents->genotype_posteriors()->size2());
+            profiling::note_memory(read_bytes + footprint(haplotype_likelihoods).bytes() + caller_latents->footprint().bytes());
+        }
         if (trace_log_) {
             debug::print_haplotype_posteriors(stream(*trace_log_), *caller_latents->haplotype_posteriors(), -1);
         } else if (debug_log_) {
@@ -385,7 +618,20 @@ Caller::call_variants(const GenomicRegion& call_region, const MappableFlatSet<Va
         } else {
             protected_haplotypes.clear();
         }
+        finish_pending_calls();
         if (status != GeneratorStatus::skipped) {
+            if (pipeline_calls) {
+                pending_calls = std::make_unique<PendingCalls>(PendingCalls {
+                    active_region, next_active_region, backtrack_region, std::move(haplotypes),
+                    std::move(haplotype_likelihoods), std::move(caller_latents)});
+                haplotype_likelihoods = std::move(spare_haplotype_likelihoods);
+                pending_calls_done = std::async(std::launch::async, [&, calls = pending_calls.get()] () {
+                    call_variants(calls->active_region, call_region, calls->next_active_region, calls->backtrack_region,
+                                  candidates, calls->haplotypes, calls->haplotype_likelihoods, reads, *calls->latents,
+                                  result, prev_called_region, completed_region);
+                });
+                continue;
+            }
             call_variants(active_region, call_region, next_active_region, backtrack_region,
                           candidates, haplotypes, haplotype_likelihoods, reads, *caller_latents,
                           result, prev_called_region, completed_region);
@@ -393,6 +639,15 @@ Caller::call_variants(const GenomicRegion& call_region, const MappableFlatSet<Va
         haplotype_likelihoods.clear();
         progress_meter.log_completed(completed_region);
     }
+    metrics::add(metrics::Counter::likelihood_cache_hits, haplotype_likelihoods.num_cache_hits() + spare_haplotype_likelihoods.num_cache_hits());
+    metrics::add(metrics::Counter::likelihood_cache_misses, haplotype_likelihoods.num_cache_misses() + spare_haplotype_likelihoods.num_cache_misses());
+    if (debug_log_) {
+        stream(*debug_log_) << "Likelihood cache hits: " << haplotype_likelihoods.num_cache_hits()
+                            << ", misses: " << haplotype_likelihoods.num_cache_misses();
+        const auto& genotype_likelihoods = haplotype_likelihoods.genotype_likelihood_table();
+        stream(*debug_log_) << "Genotype likelihood table hits: " << genotype_likelihoods.hits()
+                            << ", misses: " << genotype_likelihoods.misses();
+    }
     return result;
 }
 
@@ -411,6 +666,11 @@ ExecutionPolicy Caller::exucution_policy() const noexcept
     return parameters_.execution_policy;
 }
 
+ThreadPool* Caller::workers() const noexcept
+{
+    return likelihood_workers_.get();
+}
+
 Caller::GeneratorStatus
 Caller::generate_active_haplotypes(const GenomicRegion& call_region,
                                    HaplotypeGenerator& haplotype_generator,
@@ -425,6 +685,7 @@ Caller::generate_active_haplotypes(const GenomicRegion& call_region,
         next_active_region = boost::none;
     } else {
         try {
+            profiling::StageTimer timer {profiling::Stage::haplotype_generation};
             std::tie(haplotypes, next_active_region, std::ignore) = haplotype_generator.generate();
             if (next_active_region) {
                 active_region = std::move(*next_active_region);
@@ -473,9 +734,19 @@ bool Caller::filter_haplotypes(std::vector<Haplotype>& haplotypes,
                                HaplotypeGenerator& haplotype_generator,
                                HaplotypeLikelihoodArray& haplotype_likelihoods,
                                const std::deque<Haplotype>& protected_haplotypes) const
+{
+    return filter_haplotypes(haplotypes, haplotype_generator, haplotype_likelihoods, protected_haplotypes,
+                             max_haplotypes_within_memory(haplotype_likelihoods));
+}
+
+bool Caller::filter_haplotypes(std::vector<Haplotype>& haplotypes,
+                               HaplotypeGenerator& haplotype_generator,
+                               HaplotypeLikelihoodArray& haplotype_likelihoods,
+                               const std::deque<Haplotype>& protected_haplotypes,
+                               const unsigned max_haplotypes) const
 {
     bool has_removal_impact {false};
-    auto removed_haplotypes = filter(haplotypes, haplotype_likelihoods, protected_haplotypes);
+    auto removed_haplotypes = filter(haplotypes, haplotype_likelihoods, protected_haplotypes, max_haplotypes);
     if (haplotypes.empty()) {
         // This can only happen if all haplotypes have equal likelihood
         haplotype_generator.clear_progress();
@@ -504,6 +775,7 @@ Caller::generate_next_active_haplotypes(std::vector<Haplotype>& next_haplotypes,
                                         HaplotypeGenerator& haplotype_generator) const
 {
     try {
+        profiling::StageTimer timer {profiling::Stage::haplotype_generation};
         std::tie(next_haplotypes, next_active_region, backtrack_region) = haplotype_generator.generate();
     } catch (const HaplotypeGenerator::HaplotypeOverflow& e) {
         logging::WarningLogger warn_log {};
@@ -514,6 +786,43 @@ Caller::generate_next_active_haplotypes(std::vector<Haplotype>& next_haplotypes,
     return GeneratorStatus::good;
 }
 
+bool Caller::use_staged_likelihoods(const std::vector<Haplotype>& haplotypes, const ReadMap& active_reads) const
+{
+    const auto max_staged_reads = parameters_.staged_likelihood_reads;
+    return max_staged_reads > 0 && haplotypes.size() > 2 * parameters_.max_haplotypes
+           && count_reads(active_reads) > max_staged_reads * active_reads.size();
+}
+
+unsigned Caller::max_haplotypes_within_memory(const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+{
+    const auto max_haplotypes = parameters_.max_haplotypes;
+    if (!parameters_.target_max_memory || max_haplotypes <= 2) return max_haplotypes;
+    std::size_t num_reads {0};
+    for (const auto& sample : samples_) num_reads += haplotype_likelihoods.num_likelihoods(sample);
+    // A lower bound, as models may consider more genotypes than there are at the minimum ploidy
+    const auto ploidy = min_callable_ploidy();
+    const auto estimate_bytes = [&] (const unsigned num_haplotypes) {
+        return HaplotypeLikelihoodArray::estimate_footprint(num_haplotypes, num_reads).bytes()
+               + estimate_genotype_posteriors_memory(num_genotypes(num_haplotypes, ploidy), ploidy, samples_.size());
+    };
+    const auto target_bytes = parameters_.target_max_memory->bytes();
+    if (estimate_bytes(max_haplotypes) <= target_bytes) return max_haplotypes;
+    unsigned lo {2}, hi {max_haplotypes};
+    while (hi - lo > 1) {
+        const auto mid = lo + (hi - lo) / 2;
+        if (estimate_bytes(mid) <= target_bytes) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    if (debug_log_) {
+        stream(*debug_log_) << "Reducing max haplotypes to " << lo << " to stay within the target memory of "
+                            << *parameters_.target_max_memory;
+    }
+    return lo;
+}
+
 bool Caller::is_saturated(const std::vector<Haplotype>& haplotypes, const Latents& latents) const
 {
     return haplotypes.size() == parameters_.max_haplotypes
@@ -695,7 +1004,10 @@ void Caller::call_variants(const GenomicRegion& active_region,
         std::vector<CallWrapper> calls {};
         if (!active_candidates.empty()) {
             if (debug_log_) stream(*debug_log_) << "Calling variants in region " << uncalled_region;
-            calls = wrap(call_variants(active_candidates, latents));
+            {
+                profiling::StageTimer timer {profiling::Stage::calling};
+                calls = wrap(call_variants(active_candidates, latents));
+            }
             if (!calls.empty()) {
                 set_model_posteriors(calls, latents, haplotypes, haplotype_likelihoods);
                 set_phasing(calls, latents, haplotypes, call_region);
@@ -805,12 +1117,83 @@ void set_phasing(std::vector<CallWrapper>& calls, const Phaser::PhaseSet& phase_
     }
 }
 
+boost::optional<std::unordered_map<std::reference_wrapper<const Haplotype>, double>>
+make_warm_start_priors(const std::vector<Haplotype>& haplotypes,
+                       const std::vector<std::pair<Haplotype, double>>& previous_haplotype_posteriors)
+{
+    static constexpr double minPrior {1e-3};
+    if (haplotypes.empty() || previous_haplotype_posteriors.empty()) return boost::none;
+    const auto shared_region = overlapped_region(haplotype_region(haplotypes), mapped_region(previous_haplotype_posteriors.front().first));
+    if (!shared_region || is_empty(*shared_region)) return boost::none;
+    // Haplotypes are matched on their sequence in the region shared by both active regions, as extension
+    // and removal change the haplotypes themselves
+    std::unordered_map<Haplotype, double> shared_posteriors {};
+    shared_posteriors.reserve(previous_haplotype_posteriors.size());
+    for (const auto& p : previous_haplotype_posteriors) {
+        shared_posteriors[copy<Haplotype>(p.first, *shared_region)] += p.second;
+    }
+    std::vector<Haplotype> shared_haplotypes {};
+    shared_haplotypes.reserve(haplotypes.size());
+    std::unordered_map<Haplotype, unsigned> shared_counts {};
+    for (const auto& haplotype : haplotypes) {
+        shared_haplotypes.push_back(copy<Haplotype>(haplotype, *shared_region));
+        ++shared_counts[shared_haplotypes.back()];
+    }
+    std::vector<double> priors(haplotypes.size());
+    for (std::size_t i {0}; i < haplotypes.size(); ++i) {
+        const auto itr = shared_posteriors.find(shared_haplotypes[i]);
+        if (itr != std::cend(shared_posteriors)) {
+            priors[i] = itr->second / shared_counts.at(shared_haplotypes[i]);
+        }
+    }
+    const auto norm = std::accumulate(std::cbegin(priors), std::cend(priors), 0.0);
+    if (norm <= 0.0) return boost::none;
+    for (auto& prior : priors) prior = std::max(prior / norm, minPrior);
+    const auto floored_norm = std::accumulate(std::cbegin(priors), std::cend(priors), 0.0);
+    std::unordered_map<std::reference_wrapper<const Haplotype>, double> result {haplotypes.size()};
+    for (std::size_t i {0}; i < haplotypes.size(); ++i) {
+        result.emplace(haplotypes[i], priors[i] / floored_norm);
+    }
+    return result;
+}
+
 } // namespace
 
+std::unique_ptr<Caller::Latents>
+Caller::timed_infer_latents(const std::vector<Haplotype>& haplotypes,
+                            const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+{
+    profiling::StageTimer timer {profiling::Stage::latents};
+    return infer_latents(haplotypes, haplotype_likelihoods);
+}
+
+std::unique_ptr<Caller::Latents>
+Caller::timed_infer_latents(const std::vector<Haplotype>& haplotypes,
+                            const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                            const HaplotypePosteriorVector& previous_haplotype_posteriors) const
+{
+    profiling::StageTimer timer {profiling::Stage::latents};
+    const auto haplotype_priors = make_warm_start_priors(haplotypes, previous_haplotype_posteriors);
+    if (haplotype_priors) {
+        return infer_latents_with_warm_start(haplotypes, haplotype_likelihoods, *haplotype_priors);
+    } else {
+        return infer_latents(haplotypes, haplotype_likelihoods);
+    }
+}
+
+std::unique_ptr<Caller::Latents>
+Caller::infer_latents_with_warm_start(const std::vector<Haplotype>& haplotypes,
+                                      const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                      const Latents::HaplotypeProbabilityMap& haplotype_priors) const
+{
+    return infer_latents(haplotypes, haplotype_likelihoods);
+}
+
 void Caller::set_phasing(std::vector<CallWrapper>& calls, const Latents& latents,
                          const std::vector<Haplotype>& haplotypes,
                          const GenomicRegion& call_region) const
 {
+    profiling::StageTimer timer {profiling::Stage::phasing};
     const auto phase = phaser_.force_phase(haplotypes, *latents.genotype_posteriors(),
                                            extract_regions(calls), get_genotype_calls(latents));
     if (debug_log_) debug::print_phase_sets(stream(*debug_log_), phase);
@@ -822,9 +1205,19 @@ bool Caller::refcalls_requested() const noexcept
     return parameters_.refcall_type != RefCallType::none;
 }
 
+bool Caller::can_skip_without_reads(const GenomicRegion& read_region) const
+{
+    if (parameters_.reference_triage_min_support == 0 || refcalls_requested() || !candidate_generator_.requires_only_reads()) {
+        return false;
+    }
+    const auto& read_pipe = read_pipe_.get();
+    return !read_pipe.read_manager().has_variation_evidence(read_pipe.samples(), read_region,
+                                                            parameters_.reference_triage_min_support);
+}
+
 bool check_reference(const Variant& v, const ReferenceGenome& reference)
 {
-    return ref_sequence(v) == reference.fetch_sequence(mapped_region(v));
+    return ref_sequence(v) == reference.fetch_sequence_view(mapped_region(v));
 }
 
 bool check_reference(const std::vector<Variant>& variants, const ReferenceGenome& reference)
@@ -834,6 +1227,7 @@ bool check_reference(const std::vector<Variant>& variants, const ReferenceGenome
 
 MappableFlatSet<Variant> Caller::generate_candidate_variants(const GenomicRegion& region) const
 {
+    profiling::StageTimer timer {profiling::Stage::candidate_generation};
     if (debug_log_) stream(*debug_log_) << "Generating candidate variants in region " << region;
     auto raw_candidates = candidate_generator_.generate(region);
     if (debug_log_) debug::print_left_aligned_candidates(stream(*debug_log_), raw_candidates, reference_);
@@ -852,12 +1246,19 @@ HaplotypeGenerator Caller::make_haplotype_generator(const MappableFlatSet<Varian
 
 HaplotypeLikelihoodArray Caller::make_haplotype_likelihood_cache() const
 {
-    return HaplotypeLikelihoodArray {likelihood_model_, parameters_.max_haplotypes, samples_};
+    HaplotypeLikelihoodArray result {likelihood_model_, parameters_.max_haplotypes, samples_};
+    if (likelihood_workers_) result.set_workers(*likelihood_workers_);
+    result.set_likelihood_cache(parameters_.likelihood_cache_size);
+    result.set_local_likelihood_reuse(parameters_.reuse_local_likelihoods);
+    result.set_long_read_mapping(parameters_.long_read_flank > 0);
+    result.set_genotype_likelihood_table();
+    result.set_read_compression(); // exact, only used by models that are additive over reads
+    return result;
 }
 
 VcfRecordFactory Caller::make_record_factory(const ReadMap& reads) const
 {
-    return VcfRecordFactory {reference_, reads, samples_, parameters_.call_sites_only};
+    return VcfRecordFactory {reference_, reads, samples_, parameters_.call_sites_only, workers()};
 }
 
 auto calculate_flank_regions(const GenomicRegion& haplotype_region,
@@ -899,6 +1300,35 @@ auto calculate_flank_state(const std::vector<Haplotype>& haplotypes,
     };
 }
 
+// Clips each read to the part that can be aligned within the padded haplotypes
+ReadMap clip_to_haplotypes(const ReadMap& reads, const std::vector<Haplotype>& haplotypes)
+{
+    const GenomicRegion::Distance pad {2 * HaplotypeLikelihoodModel::pad_requirement()};
+    auto clip_region = haplotype_region(haplotypes);
+    if (size(clip_region) > 2 * static_cast<GenomicRegion::Size>(pad)) clip_region = expand(clip_region, -pad);
+    ReadMap result {reads.size()};
+    for (const auto& p : reads) {
+        std::vector<AlignedRead> clipped_reads {};
+        clipped_reads.reserve(p.second.size());
+        for (const auto& read : p.second) {
+            if (contains(clip_region, read) || !overlaps(clip_region, read)) {
+                clipped_reads.push_back(read);
+            } else {
+                auto clipped_read = copy(read, clip_region);
+                if (sequence_size(clipped_read) > 0) {
+                    clipped_reads.push_back(std::move(clipped_read));
+                } else {
+                    clipped_reads.push_back(read);
+                }
+            }
+        }
+        result.emplace(std::piecewise_construct, std::forward_as_tuple(p.first),
+                       std::forward_as_tuple(std::make_move_iterator(std::begin(clipped_reads)),
+                                             std::make_move_iterator(std::end(clipped_reads))));
+    }
+    return result;
+}
+
 bool Caller::populate(HaplotypeLikelihoodArray& haplotype_likelihoods,
                       const GenomicRegion& active_region,
                       const std::vector<Haplotype>& haplotypes,
@@ -920,7 +1350,11 @@ bool Caller::populate(HaplotypeLikelihoodArray& haplotype_likelihoods,
         }
     }
     try {
-        haplotype_likelihoods.populate(active_reads, haplotypes, std::move(flank_state));
+        if (parameters_.long_read_flank > 0) {
+            haplotype_likelihoods.populate(clip_to_haplotypes(active_reads, haplotypes), haplotypes, std::move(flank_state));
+        } else {
+            haplotype_likelihoods.populate(active_reads, haplotypes, std::move(flank_state));
+        }
     } catch(const HaplotypeLikelihoodModel::ShortHaplotypeError& e) {
         if (debug_log_) {
             stream(*debug_log_) << "Skipping " << active_region << " as a haplotype was too short by "
@@ -937,11 +1371,11 @@ bool Caller::populate(HaplotypeLikelihoodArray& haplotype_likelihoods,
 
 std::vector<Haplotype>
 Caller::filter(std::vector<Haplotype>& haplotypes, const HaplotypeLikelihoodArray& haplotype_likelihoods,
-               const std::deque<Haplotype>& protected_haplotypes) const
+               const std::deque<Haplotype>& protected_haplotypes, const unsigned max_haplotypes) const
 {
     std::vector<Haplotype> removed_haplotypes {};
     if (protected_haplotypes.empty()) {
-        removed_haplotypes = filter_to_n(haplotypes, samples_, haplotype_likelihoods, parameters_.max_haplotypes);
+        removed_haplotypes = filter_to_n(haplotypes, samples_, haplotype_likelihoods, max_haplotypes);
     } else {
         if (debug_log_) {
             stream(*debug_log_) << "Protecting " << protected_haplotypes.size() << " haplotypes from filtering";
@@ -957,7 +1391,7 @@ Caller::filter(std::vector<Haplotype>& haplotypes, const HaplotypeLikelihoodArra
         std::set_intersection(std::cbegin(haplotypes), std::cend(haplotypes),
                               std::cbegin(protected_haplotypes), std::cend(protected_haplotypes),
                               std::back_inserter(protected_copies));
-        removed_haplotypes = filter_to_n(removable_haplotypes, samples_, haplotype_likelihoods, parameters_.max_haplotypes);
+        removed_haplotypes = filter_to_n(removable_haplotypes, samples_, haplotype_likelihoods, max_haplotypes);
         haplotypes = std::move(removable_haplotypes);
         std::sort(std::begin(haplotypes), std::end(haplotypes));
         merge_unique(std::move(protected_copies), haplotypes);
@@ -1052,7 +1486,7 @@ std::vector<CallWrapper> Caller::call_reference(const GenomicRegion& region, con
         haplotypes.emplace_back(region, reference_);
     }
     haplotype_likelihoods.populate(active_reads, haplotypes);
-    const auto latents = infer_latents(haplotypes, haplotype_likelihoods);
+    const auto latents = timed_infer_latents(haplotypes, haplotype_likelihoods);
     const auto pileups = make_pileups(active_reads, *latents, region);
     const auto alleles = generate_reference_alleles(region);
     return call_reference_helper(alleles, *latents, pileups);
@@ -1061,8 +1495,9 @@ std::vector<CallWrapper> Caller::call_reference(const GenomicRegion& region, con
 std::vector<CallWrapper>
 Caller::call_reference_helper(const std::vector<Allele>& alleles, const Latents& latents, const ReadPileupMap& pileups) const
 {
+    profiling::StageTimer timer {profiling::Stage::calling};
     if (is_merge_block_refcalling()) {
-        return wrap(squash_reference_calls(call_reference(alleles, latents, pileups)));
+        return wrap(call_merged_reference(alleles, latents, pileups));
     } else {
         return wrap(call_reference(alleles, latents, pileups));
     }
@@ -1210,59 +1645,79 @@ Caller::ReadPileupMap Caller::make_pileups(const ReadMap& reads, const Latents&
 
 namespace {
 
-auto get_min_quality(const std::vector<std::unique_ptr<ReferenceCall>>& refcalls)
+// A run of adjacent positional reference calls, folded in as they are made so the positional calls can be freed
+struct ReferenceBlock
+{
+    std::unique_ptr<ReferenceCall> front;
+    GenomicRegion region;
+    Allele::NucleotideSequence sequence;
+    Phred<double> min_quality;
+};
+
+bool are_similar_quality(const ReferenceCall& lhs, const ReferenceCall& rhs, const Phred<double> threshold) noexcept
+{
+    return std::abs(lhs.quality().score() - rhs.quality().score()) < threshold.score();
+}
+
+bool can_extend(const ReferenceBlock& block, const ReferenceCall& refcall, const Phred<double> threshold) noexcept
 {
-    auto itr = std::min_element(std::cbegin(refcalls), std::cend(refcalls),
-                                [] (const auto& lhs, const auto& rhs) { return lhs->quality() < rhs->quality(); });
-    return (*itr)->quality();
+    return are_adjacent(block.region, refcall.mapped_region()) && are_similar_quality(*block.front, refcall, threshold);
 }
 
-std::unique_ptr<ReferenceCall>
-concat(const std::vector<std::unique_ptr<ReferenceCall>>& refcalls, const std::vector<SampleName>& samples)
+void extend(ReferenceBlock& block, const ReferenceCall& refcall)
 {
-    assert(!refcalls.empty());
-    auto region = encompassing_region(refcalls.front()->mapped_region(), refcalls.back()->mapped_region());
-    Allele::NucleotideSequence sequence {};
-    sequence.reserve(size(region));
-    for (const auto& refcall : refcalls) {
-        sequence.insert(std::cend(sequence), std::cbegin(refcall->reference().sequence()), std::cend(refcall->reference().sequence()));
-    }
-    Allele reference {std::move(region), std::move(sequence)};
-    const auto quality = get_min_quality(refcalls);
+    block.region = encompassing_region(block.region, refcall.mapped_region());
+    const auto& sequence = refcall.reference().sequence();
+    block.sequence.insert(std::cend(block.sequence), std::cbegin(sequence), std::cend(sequence));
+    block.min_quality = std::min(block.min_quality, refcall.quality());
+}
+
+ReferenceBlock start_block(std::unique_ptr<ReferenceCall> refcall)
+{
+    ReferenceBlock result {nullptr, refcall->mapped_region(), refcall->reference().sequence(), refcall->quality()};
+    result.front = std::move(refcall);
+    return result;
+}
+
+std::unique_ptr<ReferenceCall> close_block(ReferenceBlock& block, const std::vector<SampleName>& samples)
+{
+    Allele reference {std::move(block.region), std::move(block.sequence)};
     std::map<SampleName, ReferenceCall::GenotypeCall> genotypes {};
     for (const auto& sample : samples) {
-        const auto& genotype_call = refcalls.front()->get_genotype_call(sample);
+        const auto& genotype_call = block.front->get_genotype_call(sample);
         genotypes.emplace(sample, ReferenceCall::GenotypeCall {genotype_call.genotype.ploidy(), genotype_call.posterior});
     }
-    return std::make_unique<ReferenceCall>(std::move(reference), quality, std::move(genotypes));
-}
-
-bool are_similar_quality(const ReferenceCall& lhs, const ReferenceCall& rhs, const Phred<double> threshold) noexcept
-{
-    return std::abs(lhs.quality().score() - rhs.quality().score()) < threshold.score();
+    return std::make_unique<ReferenceCall>(std::move(reference), block.min_quality, std::move(genotypes));
 }
 
 } // namespace
 
 std::vector<std::unique_ptr<ReferenceCall>>
-Caller::squash_reference_calls(std::vector<std::unique_ptr<ReferenceCall>> refcalls) const
+Caller::call_merged_reference(const std::vector<Allele>& alleles, const Latents& latents, const ReadPileupMap& pileups) const
 {
+    // Positions are called a chunk at a time, so only one chunk of positional calls exists at once
+    static constexpr std::size_t maxChunkSize {1000};
     assert(parameters_.refcall_block_merge_threshold);
-    std::vector<std::unique_ptr<ReferenceCall>> result {}, buffer {};
-    if (refcalls.empty()) return result;
-    result.reserve(refcalls.size());
-    buffer.reserve(refcalls.size());
-    for (auto& refcall : refcalls) {
-        if (buffer.empty() || (are_adjacent(*buffer.back(), *refcall)
-                && are_similar_quality(*buffer.front(), *refcall, *parameters_.refcall_block_merge_threshold))) {
-            buffer.push_back(std::move(refcall));
-        } else {
-            result.push_back(concat(buffer, samples_));
-            buffer.clear();
-            buffer.push_back(std::move(refcall));
+    const auto threshold = *parameters_.refcall_block_merge_threshold;
+    std::vector<std::unique_ptr<ReferenceCall>> result {};
+    boost::optional<ReferenceBlock> block {};
+    std::vector<Allele> chunk {};
+    chunk.reserve(std::min(maxChunkSize, alleles.size()));
+    for (auto first = std::cbegin(alleles), last = std::cend(alleles); first != last;) {
+        const auto chunk_size = std::min(maxChunkSize, static_cast<std::size_t>(std::distance(first, last)));
+        const auto chunk_last = std::next(first, chunk_size);
+        chunk.assign(first, chunk_last);
+        first = chunk_last;
+        for (auto& refcall : call_reference(chunk, latents, pileups)) {
+            if (block && can_extend(*block, *refcall, threshold)) {
+                extend(*block, *refcall);
+            } else {
+                if (block) result.push_back(close_block(*block, samples_));
+                block = start_block(std::move(refcall));
+            }
         }
     }
-    result.push_back(concat(buffer, samples_));
+    if (block) result.push_back(close_block(*block, samples_));
     return result;
 }
 
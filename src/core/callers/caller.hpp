@@ -11,6 +11,8 @@
 #include <deque>
 #include <typeindex>
 #include <set>
+#include <mutex>
+#include <utility>
 
 #include <boost/optional.hpp>
 
@@ -22,6 +24,7 @@
 #include "core/types/haplotype.hpp"
 #include "core/tools/coretools.hpp"
 #include "core/models/haplotype_likelihood_array.hpp"
+#include "utils/thread_pool.hpp"
 #include "containers/mappable_flat_set.hpp"
 #include "containers/probability_matrix.hpp"
 #include "logging/progress_meter.hpp"
@@ -38,6 +41,43 @@ struct CallWrapper;
 class VariantCall;
 class ReferenceCall;
 
+namespace profiling { class RegionTrace; }
+
+// Lets another thread shorten the region of a running call, so the uncalled right-hand part can be
+// called elsewhere. Active regions are claimed before they are called, and splits cannot cut a claim.
+class CallRegionSplitter
+{
+public:
+    CallRegionSplitter() = delete;
+    
+    CallRegionSplitter(GenomicRegion call_region);
+    
+    CallRegionSplitter(const CallRegionSplitter&)            = delete;
+    CallRegionSplitter& operator=(const CallRegionSplitter&) = delete;
+    CallRegionSplitter(CallRegionSplitter&&)                 = delete;
+    CallRegionSplitter& operator=(CallRegionSplitter&&)      = delete;
+    
+    ~CallRegionSplitter() = default;
+    
+    GenomicRegion region() const;
+    // Size of the part of the region not yet claimed, zero once closed
+    GenomicRegion::Size unclaimed_size() const;
+    
+    // Halves the unclaimed part of the region, returning the removed right-hand part, provided both
+    // halves are at least min_size
+    boost::optional<GenomicRegion> split(GenomicRegion::Size min_size);
+    // False if the active region begins after the (possibly split) call region
+    bool try_claim(const GenomicRegion& active_region);
+    // No more splits are possible once closed. Returns the final call region.
+    GenomicRegion close();
+    
+private:
+    mutable std::mutex mutex_;
+    GenomicRegion region_;
+    GenomicRegion::Position claimed_end_;
+    bool closed_;
+};
+
 class Caller
 {
 public:
@@ -68,7 +108,15 @@ public:
     unsigned min_callable_ploidy() const;
     unsigned max_callable_ploidy() const;
     
-    std::deque<VcfRecord> call(const GenomicRegion& call_region, ProgressMeter& progress_meter) const;
+    // If there is a splitter, the call region may be shortened by another thread during the call.
+    // Calls are only made in the final region of the splitter, which is closed on return.
+    std::deque<VcfRecord> call(const GenomicRegion& call_region, ProgressMeter& progress_meter,
+                               CallRegionSplitter* splitter = nullptr) const;
+    
+    // Calls the given candidates with the given processed reads, skipping read fetching and candidate
+    // generation. Used to replay region snapshots.
+    std::deque<VcfRecord> call(const GenomicRegion& call_region, MappableFlatSet<Variant> candidates,
+                               const ReadMap& reads, ProgressMeter& progress_meter) const;
     
     std::vector<VcfRecord> regenotype(const std::vector<Variant>& variants, ProgressMeter& progress_meter) const;
     
@@ -94,6 +142,9 @@ protected:
         // we avoid copying.
         virtual std::shared_ptr<HaplotypeProbabilityMap> haplotype_posteriors() const = 0;
         virtual std::shared_ptr<GenotypeProbabilityMap> genotype_posteriors() const = 0;
+        
+        // Defaults to the size of the posteriors; models with larger inference buffers should override
+        virtual MemoryFootprint footprint() const;
     };
     
 public:
@@ -105,6 +156,7 @@ public:
         HaplotypeGenerator::Builder haplotype_generator_builder;
         HaplotypeLikelihoodModel likelihood_model;
         Phaser phaser;
+        std::shared_ptr<ThreadPool> likelihood_workers = nullptr; // optional, may be shared between callers
     };
     
     struct Parameters
@@ -118,6 +170,13 @@ public:
         bool protect_reference_haplotype;
         boost::optional<MemoryFootprint> target_max_memory;
         ExecutionPolicy execution_policy;
+        std::size_t likelihood_cache_size;
+        std::size_t staged_likelihood_reads;
+        bool reuse_local_likelihoods;
+        bool warm_start_latents;
+        unsigned reference_triage_min_support;
+        unsigned long_read_flank; // reads are clipped to the haplotypes if non-zero
+        bool pipeline_active_regions;
     };
     
 private:
@@ -130,6 +189,7 @@ private:
     HaplotypeGenerator::Builder haplotype_generator_builder_;
     HaplotypeLikelihoodModel likelihood_model_;
     Phaser phaser_;
+    std::shared_ptr<ThreadPool> likelihood_workers_;
     Parameters parameters_;
     
     // virtual methods
@@ -146,11 +206,18 @@ protected:
     
     boost::optional<MemoryFootprint> target_max_memory() const noexcept;
     ExecutionPolicy exucution_policy() const noexcept;
+    ThreadPool* workers() const noexcept; // optional, idle outside likelihood computation
 
 private:
     virtual std::unique_ptr<Latents>
     infer_latents(const std::vector<Haplotype>& haplotypes,
                   const HaplotypeLikelihoodArray& haplotype_likelihoods) const = 0;
+    // haplotype_priors are normalised weights carried over from the previous overlapping region.
+    // Iterative models can use them to initialise rather than starting from scratch.
+    virtual std::unique_ptr<Latents>
+    infer_latents_with_warm_start(const std::vector<Haplotype>& haplotypes,
+                                  const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                  const Latents::HaplotypeProbabilityMap& haplotype_priors) const;
     
     virtual Genotype<Haplotype> call_genotype(const Latents& latents, const SampleName& sample) const;
     
@@ -168,10 +235,16 @@ private:
     
     // helper methods
     
+    std::deque<VcfRecord>
+    call_with_candidates(const GenomicRegion& call_region, MappableFlatSet<Variant>& candidates, const ReadMap& reads,
+                         const ReadPipe::Report& read_report, ProgressMeter& progress_meter, CallRegionSplitter* splitter,
+                         profiling::RegionTrace& trace) const;
     std::deque<CallWrapper>
     call_variants(const GenomicRegion& call_region,  const MappableFlatSet<Variant>& candidates,
-                  const ReadMap& reads, const ReadPipe::Report& read_report, ProgressMeter& progress_meter) const;
+                  const ReadMap& reads, const ReadPipe::Report& read_report, ProgressMeter& progress_meter,
+                  CallRegionSplitter* splitter) const;
     bool refcalls_requested() const noexcept;
+    bool can_skip_without_reads(const GenomicRegion& read_region) const;
     MappableFlatSet<Variant> generate_candidate_variants(const GenomicRegion& region) const;
     HaplotypeGenerator make_haplotype_generator(const MappableFlatSet<Variant>& candidates, const ReadMap& reads,
                                                 const ReadPipe::Report& read_report) const;
@@ -179,7 +252,7 @@ private:
     VcfRecordFactory make_record_factory(const ReadMap& reads) const;
     std::vector<Haplotype>
     filter(std::vector<Haplotype>& haplotypes, const HaplotypeLikelihoodArray& haplotype_likelihoods,
-           const std::deque<Haplotype>& protected_haplotypes) const;
+           const std::deque<Haplotype>& protected_haplotypes, unsigned max_haplotypes) const;
     bool populate(HaplotypeLikelihoodArray& haplotype_likelihoods, const GenomicRegion& active_region,
                   const std::vector<Haplotype>& haplotypes, const MappableFlatSet<Variant>& candidates,
                   const ReadMap& active_reads) const;
@@ -200,6 +273,11 @@ private:
     bool filter_haplotypes(std::vector<Haplotype>& haplotypes, HaplotypeGenerator& haplotype_generator,
                            HaplotypeLikelihoodArray& haplotype_likelihoods,
                            const std::deque<Haplotype>& protected_haplotypes) const;
+    bool filter_haplotypes(std::vector<Haplotype>& haplotypes, HaplotypeGenerator& haplotype_generator,
+                           HaplotypeLikelihoodArray& haplotype_likelihoods,
+                           const std::deque<Haplotype>& protected_haplotypes, unsigned max_haplotypes) const;
+    bool use_staged_likelihoods(const std::vector<Haplotype>& haplotypes, const ReadMap& active_reads) const;
+    unsigned max_haplotypes_within_memory(const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
     bool is_saturated(const std::vector<Haplotype>& haplotypes, const Latents& latents) const;
     unsigned count_probable_haplotypes(const Caller::Latents::HaplotypeProbabilityMap& haplotype_posteriors) const;
     void filter_haplotypes(bool prefilter_had_removal_impact, const std::vector<Haplotype>& haplotypes,
@@ -212,6 +290,15 @@ private:
                        const HaplotypeLikelihoodArray& haplotype_likelihoods, const ReadMap& reads,
                        const Latents& latents, std::deque<CallWrapper>& result,
                        boost::optional<GenomicRegion>& prev_called_region, GenomicRegion& completed_region) const;
+    using HaplotypePosteriorVector = std::vector<std::pair<Haplotype, double>>;
+    
+    std::unique_ptr<Latents>
+    timed_infer_latents(const std::vector<Haplotype>& haplotypes,
+                        const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
+    std::unique_ptr<Latents>
+    timed_infer_latents(const std::vector<Haplotype>& haplotypes,
+                        const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                        const HaplotypePosteriorVector& previous_haplotype_posteriors) const;
     GenotypeCallMap get_genotype_calls(const Latents& latents) const;
     std::deque<Haplotype> get_called_haplotypes(const Latents& latents) const;
     void set_model_posteriors(std::vector<CallWrapper>& calls, const Latents& latents,
@@ -231,7 +318,7 @@ private:
     std::vector<Allele> generate_reference_alleles(const GenomicRegion& region) const;
     ReadPileupMap make_pileups(const ReadMap& reads, const Latents& latents, const GenomicRegion& region) const;
     std::vector<std::unique_ptr<ReferenceCall>>
-    squash_reference_calls(std::vector<std::unique_ptr<ReferenceCall>> refcalls) const;
+    call_merged_reference(const std::vector<Allele>& alleles, const Latents& latents, const ReadPileupMap& pileups) const;
 };
 
 } // namespace octopus
@@ -16,7 +16,7 @@ namespace octopus {
 
 CallerBuilder::CallerBuilder(const ReferenceGenome& reference, const ReadPipe& read_pipe,
                              VariantGeneratorBuilder vgb, HaplotypeGenerator::Builder hgb)
-: components_ {reference, read_pipe, std::move(vgb), std::move(hgb), HaplotypeLikelihoodModel {}, Phaser {}}
+: components_ {reference, read_pipe, std::move(vgb), std::move(hgb), HaplotypeLikelihoodModel {}, Phaser {}, nullptr}
 , params_ {}
 , factory_ {}
 {
@@ -27,6 +27,14 @@ CallerBuilder::CallerBuilder(const ReferenceGenome& reference, const ReadPipe& r
     params_.general.haplotype_extension_threshold = Phred<> {150.0};
     params_.general.saturation_limit = Phred<> {10.0};
     params_.general.max_haplotypes = 200;
+    params_.general.likelihood_cache_size = 0;
+    params_.general.staged_likelihood_reads = 0;
+    params_.general.reuse_local_likelihoods = false;
+    params_.general.warm_start_latents = false;
+    params_.general.reference_triage_min_support = 0;
+    params_.general.long_read_flank = 0;
+    params_.general.pipeline_active_regions = false;
+    params_.max_phylogeny_size = 2;
     factory_ = generate_factory();
 }
 
@@ -195,6 +203,54 @@ CallerBuilder& CallerBuilder::set_likelihood_model(HaplotypeLikelihoodModel mode
     return *this;
 }
 
+CallerBuilder& CallerBuilder::set_likelihood_workers(std::shared_ptr<ThreadPool> workers) noexcept
+{
+    components_.likelihood_workers = std::move(workers);
+    return *this;
+}
+
+CallerBuilder& CallerBuilder::set_likelihood_cache_size(std::size_t max_likelihoods) noexcept
+{
+    params_.general.likelihood_cache_size = max_likelihoods;
+    return *this;
+}
+
+CallerBuilder& CallerBuilder::set_staged_likelihood_reads(std::size_t max_reads_per_sample) noexcept
+{
+    params_.general.staged_likelihood_reads = max_reads_per_sample;
+    return *this;
+}
+
+CallerBuilder& CallerBuilder::set_local_likelihood_reuse(bool reuse) noexcept
+{
+    params_.general.reuse_local_likelihoods = reuse;
+    return *this;
+}
+
+CallerBuilder& CallerBuilder::set_latent_warm_start(bool warm_start) noexcept
+{
+    params_.general.warm_start_latents = warm_start;
+    return *this;
+}
+
+CallerBuilder& CallerBuilder::set_reference_triage(unsigned min_support) noexcept
+{
+    params_.general.reference_triage_min_support = min_support;
+    return *this;
+}
+
+CallerBuilder& CallerBuilder::set_long_read_flank(unsigned flank) noexcept
+{
+    params_.general.long_read_flank = flank;
+    return *this;
+}
+
+CallerBuilder& CallerBuilder::set_active_region_pipelining(bool pipeline) noexcept
+{
+    params_.general.pipeline_active_regions = pipeline;
+    return *this;
+}
+
 CallerBuilder& CallerBuilder::set_model_based_haplotype_dedup(bool use) noexcept
 {
     params_.deduplicate_haplotypes_with_caller_model = use;
@@ -207,6 +263,12 @@ CallerBuilder& CallerBuilder::set_independent_genotype_prior_flag(bool use_indep
     return *this;
 }
 
+CallerBuilder& CallerBuilder::set_prior_variant_frequencies(std::vector<std::shared_ptr<const VariantIndex>> indices) noexcept
+{
+    params_.prior_variant_frequencies = std::move(indices);
+    return *this;
+}
+
 CallerBuilder& CallerBuilder::set_max_vb_seeds(unsigned n) noexcept
 {
     params_.max_vb_seeds = n;
@@ -311,6 +373,12 @@ CallerBuilder& CallerBuilder::set_dropout_concentration(double concentration) no
     return *this;
 }
 
+CallerBuilder& CallerBuilder::set_max_phylogeny_size(unsigned n) noexcept
+{
+    params_.max_phylogeny_size = n;
+    return *this;
+}
+
 std::unique_ptr<Caller> CallerBuilder::build(const ContigName& contig) const
 {
     if (factory_.count(caller_) == 0) {
@@ -330,7 +398,8 @@ Caller::Components CallerBuilder::make_components() const
         components_.variant_generator_builder.build(components_.reference),
         components_.haplotype_generator_builder,
         components_.likelihood_model,
-        Phaser {params_.min_phase_score}
+        Phaser {params_.min_phase_score},
+        components_.likelihood_workers
     };
 }
 
@@ -403,7 +472,8 @@ CallerBuilder::CallerFactoryMap CallerBuilder::generate_factory() const
                                                           make_population_prior_model(params_.snp_heterozygosity, params_.indel_heterozygosity),
                                                           params_.max_joint_genotypes,
                                                           params_.use_independent_genotype_priors,
-                                                          params_.deduplicate_haplotypes_with_caller_model
+                                                          params_.deduplicate_haplotypes_with_caller_model,
+                                                          params_.prior_variant_frequencies
                                                       });
         }},
         {"cancer", [this, &samples] () {
@@ -470,7 +540,8 @@ CallerBuilder::CallerFactoryMap CallerBuilder::generate_factory() const
                                                     params_.max_joint_genotypes,
                                                     params_.dropout_concentration,
                                                     {params_.somatic_snv_mutation_rate, params_.somatic_indel_mutation_rate},
-                                                    params_.max_vb_seeds});
+                                                    params_.max_vb_seeds,
+                                                    params_.max_phylogeny_size});
         }}
     };
 }
@@ -66,8 +66,17 @@ public:
     CallerBuilder& set_max_genotypes(unsigned max) noexcept;
     CallerBuilder& set_max_joint_genotypes(unsigned max) noexcept;
     CallerBuilder& set_likelihood_model(HaplotypeLikelihoodModel model) noexcept;
+    CallerBuilder& set_likelihood_workers(std::shared_ptr<ThreadPool> workers) noexcept;
+    CallerBuilder& set_likelihood_cache_size(std::size_t max_likelihoods) noexcept;
+    CallerBuilder& set_staged_likelihood_reads(std::size_t max_reads_per_sample) noexcept;
+    CallerBuilder& set_local_likelihood_reuse(bool reuse) noexcept;
+    CallerBuilder& set_latent_warm_start(bool warm_start) noexcept;
+    CallerBuilder& set_reference_triage(unsigned min_support) noexcept;
+    CallerBuilder& set_long_read_flank(unsigned flank) noexcept;
+    CallerBuilder& set_active_region_pipelining(bool pipeline) noexcept;
     CallerBuilder& set_model_based_haplotype_dedup(bool use) noexcept;
     CallerBuilder& set_independent_genotype_prior_flag(bool use_independent) noexcept;
+    CallerBuilder& set_prior_variant_frequencies(std::vector<std::shared_ptr<const VariantIndex>> indices) noexcept;
     CallerBuilder& set_max_vb_seeds(unsigned n) noexcept;
     
     // cancer
@@ -93,6 +102,7 @@ public:
     
     // cell
     CallerBuilder& set_dropout_concentration(double concentration) noexcept;
+    CallerBuilder& set_max_phylogeny_size(unsigned n) noexcept;
     
     // pedigree
     CallerBuilder& set_pedigree(Pedigree pedigree);
@@ -108,6 +118,7 @@ private:
         HaplotypeGenerator::Builder haplotype_generator_builder;
         HaplotypeLikelihoodModel likelihood_model;
         Phaser phaser;
+        std::shared_ptr<ThreadPool> likelihood_workers;
     };
     
     struct Parameters
@@ -121,6 +132,7 @@ private:
         unsigned max_genotypes, max_joint_genotypes;
         bool deduplicate_haplotypes_with_caller_model;
         bool use_independent_genotype_priors;
+        std::vector<std::shared_ptr<const VariantIndex>> prior_variant_frequencies;
         boost::optional<unsigned> max_vb_seeds;
         
         // cancer
@@ -145,6 +157,7 @@ private:
         
         // cell
         double dropout_concentration;
+        unsigned max_phylogeny_size;
         
         // pedigree
         boost::optional<Pedigree> pedigree;
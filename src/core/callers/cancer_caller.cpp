@@ -31,6 +31,7 @@
 #include "utils/merge_transform.hpp"
 #include "utils/mappable_algorithms.hpp"
 #include "utils/maths.hpp"
+#include "utils/thread_pool.hpp"
 #include "logging/logging.hpp"
 #include "core/types/calls/germline_variant_call.hpp"
 #include "core/types/calls/reference_call.hpp"
@@ -134,16 +135,23 @@ std::size_t CancerCaller::do_remove_duplicates(std::vector<Haplotype>& haplotype
 std::unique_ptr<CancerCaller::Caller::Latents>
 CancerCaller::infer_latents(const std::vector<Haplotype>& haplotypes,
                             const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+{
+    return infer_latents_with_warm_start(haplotypes, haplotype_likelihoods, {});
+}
+
+std::unique_ptr<CancerCaller::Caller::Latents>
+CancerCaller::infer_latents_with_warm_start(const std::vector<Haplotype>& haplotypes,
+                                            const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                            const Caller::Latents::HaplotypeProbabilityMap& haplotype_priors) const
 {
     // Store any intermediate results in Latents for reuse, so the order of model evaluation matters!
     auto result = std::make_unique<Latents>(haplotypes, samples_, parameters_);
     set_model_priors(*result);
     generate_germline_genotypes(*result, haplotypes);
     if (debug_log_) stream(*debug_log_) << "There are " << result->germline_genotypes_.size() << " candidate germline genotypes";
-    evaluate_germline_model(*result, haplotype_likelihoods);
-    evaluate_cnv_model(*result, haplotype_likelihoods);
+    evaluate_germline_and_cnv_models(*result, haplotype_likelihoods, haplotype_priors);
     if (haplotypes.size() > 1) {
-        fit_somatic_model(*result, haplotype_likelihoods);
+        fit_somatic_model(*result, haplotype_likelihoods, haplotype_priors);
         evaluate_noise_model(*result, haplotype_likelihoods);
         set_model_posteriors(*result);
     }
@@ -165,7 +173,8 @@ void CancerCaller::set_cancer_genotype_prior_model(Latents& latents) const
     latents.cancer_genotype_prior_model_ = CancerGenotypePriorModel {*latents.germline_prior_model_, std::move(mutation_model)};
 }
 
-void CancerCaller::fit_somatic_model(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+void CancerCaller::fit_somatic_model(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                     const model::HaplotypeWeightMap& seed_haplotype_weights) const
 {
     set_cancer_genotype_prior_model(latents);
     SomaticModel::InferredLatents prev_latents;
@@ -176,7 +185,7 @@ void CancerCaller::fit_somatic_model(Latents& latents, const HaplotypeLikelihood
         latents.somatic_ploidy_ = somatic_ploidy;
         generate_cancer_genotypes(latents, haplotype_likelihoods);
         if (debug_log_) stream(*debug_log_) << "There are " << latents.cancer_genotypes_.size() << " candidate cancer genotypes";
-        evaluate_somatic_model(latents, haplotype_likelihoods);
+        evaluate_somatic_model(latents, haplotype_likelihoods, seed_haplotype_weights);
         if (somatic_ploidy > 1) {
             if (latents.somatic_model_inferences_.approx_log_evidence <= prev_latents.approx_log_evidence) {
                 break;
@@ -276,16 +285,6 @@ CancerCaller::calculate_model_posterior(const std::vector<Haplotype>& haplotypes
     }
 }
 
-auto pool_likelihood(const std::vector<SampleName>& samples,
-                     const std::vector<Haplotype>& haplotypes,
-                     const HaplotypeLikelihoodArray& haplotype_likelihoods)
-{
-    static const SampleName pooled_sample {"pool"};
-    auto result = merge_samples(samples, pooled_sample, haplotypes, haplotype_likelihoods);
-    result.prime(pooled_sample);
-    return result;
-}
-
 void CancerCaller::generate_germline_genotypes(Latents& latents, const std::vector<Haplotype>& haplotypes) const
 {
     if (haplotypes.size() < 4) {
@@ -639,15 +638,24 @@ bool CancerCaller::has_high_normal_contamination_risk(const Latents& latents) co
     return parameters_.normal_contamination_risk == Parameters::NormalContaminationRisk::high;
 }
 
-void CancerCaller::evaluate_germline_model(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+void CancerCaller::set_germline_model(Latents& latents) const
 {
     assert(!(latents.haplotypes_.get().empty() || latents.germline_genotypes_.empty()));
     latents.germline_prior_model_ = make_germline_prior_model(latents.haplotypes_);
     latents.germline_model_ = std::make_unique<GermlineModel>(*latents.germline_prior_model_);
-    const auto pooled_likelihoods = pool_likelihood(samples_,  latents.haplotypes_, haplotype_likelihoods);
     if (latents.germline_genotype_indices_) {
         latents.germline_prior_model_->prime(latents.haplotypes_);
         latents.germline_model_->prime(latents.haplotypes_);
+    }
+}
+
+void CancerCaller::evaluate_germline_model(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+{
+    assert(latents.germline_model_);
+    // Only reads haplotype_likelihoods, the germline model is evaluated on a merged view of all samples
+    // which does not depend on the primed sample
+    const auto pooled_likelihoods = merge_samples(samples_, haplotype_likelihoods);
+    if (latents.germline_genotype_indices_) {
         latents.germline_model_inferences_ = latents.germline_model_->evaluate(latents.germline_genotypes_,
                                                                                *latents.germline_genotype_indices_,
                                                                                pooled_likelihoods);
@@ -656,13 +664,17 @@ void CancerCaller::evaluate_germline_model(Latents& latents, const HaplotypeLike
     }
 }
 
-void CancerCaller::evaluate_cnv_model(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+void CancerCaller::evaluate_cnv_model(Latents& latents, const GenotypePriorModel& prior_model,
+                                      const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                      const model::HaplotypeWeightMap& seed_haplotype_weights) const
 {
-    assert(!latents.germline_genotypes_.empty() && latents.germline_prior_model_);
-    auto cnv_model_priors = get_cnv_model_priors(*latents.germline_prior_model_);
+    assert(!latents.germline_genotypes_.empty());
+    auto cnv_model_priors = get_cnv_model_priors(prior_model);
     CNVModel::AlgorithmParameters params {};
     if (parameters_.max_vb_seeds) params.max_seeds = *parameters_.max_vb_seeds;
     params.target_max_memory = this->target_max_memory();
+    params.workers = this->workers();
+    params.seed_haplotype_weights = seed_haplotype_weights;
     CNVModel cnv_model {samples_, cnv_model_priors, params};
     if (latents.germline_genotype_indices_) {
         cnv_model.prime(latents.haplotypes_);
@@ -673,7 +685,32 @@ void CancerCaller::evaluate_cnv_model(Latents& latents, const HaplotypeLikelihoo
     }
 }
 
-void CancerCaller::evaluate_somatic_model(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+// The germline and CNV models are independent given the likelihoods, so are evaluated concurrently when
+// there are idle workers. The CNV model then gets its own prior model, as prior models cache evaluations.
+// The somatic model needs both model posteriors (and the germline genotype posteriors if there is no normal
+// sample), so is fitted afterwards.
+void CancerCaller::evaluate_germline_and_cnv_models(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                                    const model::HaplotypeWeightMap& seed_haplotype_weights) const
+{
+    set_germline_model(latents);
+    if (workers() && workers()->n_idle() > 0) {
+        const auto cnv_prior_model = make_germline_prior_model(latents.haplotypes_);
+        if (latents.germline_genotype_indices_) cnv_prior_model->prime(latents.haplotypes_);
+        parallel_for(workers(), 2, [&] (const std::size_t model_idx) {
+            if (model_idx == 0) {
+                evaluate_germline_model(latents, haplotype_likelihoods);
+            } else {
+                evaluate_cnv_model(latents, *cnv_prior_model, haplotype_likelihoods, seed_haplotype_weights);
+            }
+        });
+    } else {
+        evaluate_germline_model(latents, haplotype_likelihoods);
+        evaluate_cnv_model(latents, *latents.germline_prior_model_, haplotype_likelihoods, seed_haplotype_weights);
+    }
+}
+
+void CancerCaller::evaluate_somatic_model(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                          const model::HaplotypeWeightMap& seed_haplotype_weights) const
 {
     assert(latents.germline_prior_model_ && !latents.cancer_genotypes_.empty());
     assert(latents.cancer_genotype_prior_model_);
@@ -681,6 +718,8 @@ void CancerCaller::evaluate_somatic_model(Latents& latents, const HaplotypeLikel
     SomaticModel::AlgorithmParameters params {};
     if (parameters_.max_vb_seeds) params.max_seeds = *parameters_.max_vb_seeds;
     params.target_max_memory = this->target_max_memory();
+    params.workers = this->workers();
+    params.seed_haplotype_weights = seed_haplotype_weights;
     SomaticModel model {samples_, somatic_model_priors, params};
     if (latents.cancer_genotype_indices_) {
         assert(latents.cancer_genotype_prior_model_->germline_model().is_primed());
@@ -717,7 +756,9 @@ void CancerCaller::evaluate_noise_model(Latents& latents, const HaplotypeLikelih
         }
         assert(latents.cancer_genotype_prior_model_);
         auto noise_model_priors = get_noise_model_priors(*latents.cancer_genotype_prior_model_, latents.somatic_ploidy_);
-        const SomaticModel noise_model {{*parameters_.normal_sample}, noise_model_priors};
+        SomaticModel::AlgorithmParameters params {};
+        params.workers = this->workers();
+        const SomaticModel noise_model {{*parameters_.normal_sample}, noise_model_priors, params};
         auto noise_genotypes = get_high_posterior_genotypes(latents.cancer_genotypes_, latents.somatic_model_inferences_);
         latents.noise_model_inferences_ = noise_model.evaluate(noise_genotypes, haplotype_likelihoods);
     }
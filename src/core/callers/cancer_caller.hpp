@@ -112,6 +112,10 @@ private:
     std::unique_ptr<Caller::Latents>
     infer_latents(const std::vector<Haplotype>& haplotypes,
                   const HaplotypeLikelihoodArray& haplotype_likelihoods) const override;
+    std::unique_ptr<Caller::Latents>
+    infer_latents_with_warm_start(const std::vector<Haplotype>& haplotypes,
+                                  const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                  const Caller::Latents::HaplotypeProbabilityMap& haplotype_priors) const override;
     
     boost::optional<double>
     calculate_model_posterior(const std::vector<Haplotype>& haplotypes,
@@ -150,16 +154,23 @@ private:
     void generate_cancer_genotypes(Latents& latents, const std::vector<Genotype<Haplotype>>& germline_genotypes) const;
     bool has_high_normal_contamination_risk(const Latents& latents) const;
     
+    void set_germline_model(Latents& latents) const;
     void evaluate_germline_model(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
-    void evaluate_cnv_model(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
-    void evaluate_somatic_model(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
+    void evaluate_cnv_model(Latents& latents, const GenotypePriorModel& prior_model,
+                            const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                            const model::HaplotypeWeightMap& seed_haplotype_weights) const;
+    void evaluate_germline_and_cnv_models(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                          const model::HaplotypeWeightMap& seed_haplotype_weights) const;
+    void evaluate_somatic_model(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                const model::HaplotypeWeightMap& seed_haplotype_weights) const;
     void evaluate_noise_model(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
     
     void set_model_priors(Latents& latents) const;
     void set_model_posteriors(Latents& latents) const;
 
     void set_cancer_genotype_prior_model(Latents& latents) const;
-    void fit_somatic_model(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
+    void fit_somatic_model(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                           const model::HaplotypeWeightMap& seed_haplotype_weights) const;
     
     std::unique_ptr<GenotypePriorModel> make_germline_prior_model(const std::vector<Haplotype>& haplotypes) const;
     CNVModel::Priors get_cnv_model_priors(const GenotypePriorModel& prior_model) const;
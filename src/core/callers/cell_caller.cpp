@@ -145,14 +145,12 @@ auto calculate_haplotype_posteriors(const std::vector<Haplotype>& haplotypes,
                             std::cbegin(*itr), std::cend(*itr),
                             std::begin(noncontaining_genotype_indices));
         double prob_not_observed {1};
-        for (const auto& p : genotype_posteriors) {
-            const auto slice = genotype_posteriors(p.first);
-            std::vector<double> sample_genotype_posteriors {std::cbegin(slice), std::cend(slice)};
+        for (std::size_t s {0}; s < genotype_posteriors.size1(); ++s) {
             prob_not_observed *= std::accumulate(std::cbegin(noncontaining_genotype_indices),
                                                  std::cend(noncontaining_genotype_indices),
-                                                 0.0, [&sample_genotype_posteriors]
+                                                 0.0, [&genotype_posteriors, s]
                                                  (const auto curr, const auto i) {
-                return curr + sample_genotype_posteriors[i];
+                return curr + genotype_posteriors.at(s, i);
             });
         }
         result.emplace(haplotype, 1.0 - prob_not_observed);
@@ -278,23 +276,40 @@ CellCaller::infer_latents(const std::vector<Haplotype>& haplotypes, const Haplot
     model::SingleCellModel::AlgorithmParameters config {};
     config.max_genotype_combinations = parameters_.max_joint_genotypes;
     if (parameters_.max_vb_seeds) config.max_seeds = *parameters_.max_vb_seeds;
+    config.workers = workers();
     
     using CellPhylogeny =  model::SingleCellPriorModel::CellPhylogeny;
-    CellPhylogeny single_group_phylogeny {CellPhylogeny::Group {0}};
-    model::SingleCellPriorModel single_group_prior_model {std::move(single_group_phylogeny), *genotype_prior_model, mutation_model, cell_prior_params};
-    model::SingleCellModel single_group_model {samples_, std::move(single_group_prior_model), model_parameters, config};
-    auto single_group_inferences = single_group_model.evaluate(genotypes, haplotype_likelihoods);
-    
-    CellPhylogeny two_group_phylogeny {CellPhylogeny::Group {0}};
-    two_group_phylogeny.add_descendant(CellPhylogeny::Group {1}, 0);
-    model::SingleCellPriorModel two_group_prior_model {std::move(two_group_phylogeny), *genotype_prior_model, mutation_model, cell_prior_params};
-    model::SingleCellModel two_group_model {samples_, std::move(two_group_prior_model), model_parameters, config};
-    auto two_group_inferences = two_group_model.evaluate(genotypes, haplotype_likelihoods);
-    
-    log(single_group_inferences, samples_, genotypes, debug_log_);
-    log(two_group_inferences, samples_, genotypes, debug_log_);
-    
-    std::vector<model::SingleCellModel::Inferences> inferences {std::move(single_group_inferences), std::move(two_group_inferences)};
+    const auto evaluate = [&] (CellPhylogeny phylogeny) {
+        model::SingleCellPriorModel prior_model {std::move(phylogeny), *genotype_prior_model, mutation_model, cell_prior_params};
+        model::SingleCellModel model {samples_, std::move(prior_model), model_parameters, config};
+        auto result = model.evaluate(genotypes, haplotype_likelihoods);
+        log(result, samples_, genotypes, debug_log_);
+        return result;
+    };
+    CellPhylogeny phylogeny {CellPhylogeny::Group {0}};
+    std::vector<model::SingleCellModel::Inferences> inferences {};
+    inferences.push_back(evaluate(phylogeny));
+    // Groups must have distinct genotypes
+    const auto max_phylogeny_size = std::min(std::size_t {parameters_.max_phylogeny_size}, genotypes.size());
+    for (std::size_t size {2}; size <= max_phylogeny_size; ++size) {
+        // Rather than enumerating every tree of this size, the best tree of the previous size is grown by
+        // one group, and the search stops once a larger tree does not improve the evidence
+        boost::optional<model::SingleCellModel::Inferences> best_inferences {};
+        CellPhylogeny best_phylogeny {};
+        for (std::size_t ancestor {0}; ancestor < size - 1; ++ancestor) {
+            auto grown_phylogeny = phylogeny;
+            grown_phylogeny.add_descendant(CellPhylogeny::Group {size - 1}, ancestor);
+            auto grown_inferences = evaluate(grown_phylogeny);
+            if (!best_inferences || grown_inferences.log_evidence > best_inferences->log_evidence) {
+                best_inferences = std::move(grown_inferences);
+                best_phylogeny = std::move(grown_phylogeny);
+            }
+        }
+        const auto is_improvement = best_inferences->log_evidence > inferences.back().log_evidence;
+        inferences.push_back(std::move(*best_inferences));
+        if (!is_improvement) break;
+        phylogeny = std::move(best_phylogeny);
+    }
     return std::make_unique<Latents>(*this, haplotypes, std::move(genotypes), std::move(inferences));
 }
 
@@ -367,10 +382,11 @@ using GenotypePropertyBools = std::vector<AlleleBools>;
 auto marginalise(const GenotypeProbabilityMap& genotype_posteriors,
                  const AlleleBools& contained_alleles)
 {
-    auto p = std::inner_product(std::cbegin(genotype_posteriors), std::cend(genotype_posteriors),
+    const auto posteriors = genotype_posteriors.values();
+    auto p = std::inner_product(std::cbegin(posteriors), std::cend(posteriors),
                                 std::cbegin(contained_alleles), 0.0, std::plus<> {},
-                                [] (const auto& p, const bool is_contained) {
-                                    return is_contained ? 0.0 : p.second;
+                                [] (const double posterior, const bool is_contained) {
+                                    return is_contained ? 0.0 : posterior;
                                 });
     return probability_false_to_phred(p);
 }
@@ -395,13 +411,11 @@ auto get_contained_alleles(const PopulationGenotypeProbabilityMap& genotype_post
         return result;
     }
     result.reserve(alleles.size());
-    const auto& test_sample   = genotype_posteriors.begin()->first;
-    const auto genotype_begin = genotype_posteriors.begin(test_sample);
-    const auto genotype_end   = genotype_posteriors.end(test_sample);
+    const auto& genotypes = genotype_posteriors.keys2();
     for (const auto& allele : alleles) {
         result.emplace_back(num_genotypes);
-        std::transform(genotype_begin, genotype_end, std::begin(result.back()),
-                       [&] (const auto& p) { return contains(p.first, allele); });
+        std::transform(std::cbegin(genotypes), std::cend(genotypes), std::begin(result.back()),
+                       [&] (const auto& genotype) { return contains(genotype, allele); });
     }
     return result;
 }
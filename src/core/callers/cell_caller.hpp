@@ -44,6 +44,7 @@ public:
         double dropout_concentration;
         DeNovoModel::Parameters mutation_model_parameters;
         boost::optional<unsigned> max_vb_seeds = boost::none; // Use default if none
+        unsigned max_phylogeny_size = 2;
     };
     
     CellCaller() = delete;
@@ -161,12 +161,13 @@ IndividualCaller::calculate_model_posterior(const std::vector<Haplotype>& haplot
                                             const HaplotypeLikelihoodArray& haplotype_likelihoods,
                                             const Latents& latents) const
 {
-    const auto genotypes = generate_all_genotypes(haplotypes, parameters_.ploidy + 1);
     const auto prior_model = make_prior_model(haplotypes);
-    const model::IndividualModel model {*prior_model, debug_log_};
+    prior_model->prime(haplotypes);
+    model::IndividualModel model {*prior_model, debug_log_};
+    model.prime(haplotypes);
     haplotype_likelihoods.prime(sample());
-    const auto inferences = model.evaluate(genotypes, haplotype_likelihoods);
-    return octopus::calculate_model_posterior(latents.model_log_evidence_, inferences.log_evidence);
+    const auto log_evidence = model.evaluate_log_evidence(parameters_.ploidy + 1, haplotype_likelihoods);
+    return octopus::calculate_model_posterior(latents.model_log_evidence_, log_evidence);
 }
 
 namespace {
@@ -173,14 +173,32 @@ void reduce(std::vector<Genotype<Haplotype>>& genotypes, const GenotypePriorMode
                     std::end(genotypes));
 }
 
+auto compute_haplotype_posteriors(const std::vector<Genotype<Haplotype>>& genotypes,
+                                  const model::SubcloneModel::InferredLatents& inferences)
+{
+    model::HaplotypeWeightMap result {};
+    const auto& genotype_posteriors = inferences.posteriors.genotype_probabilities;
+    for (std::size_t g {0}; g < genotypes.size(); ++g) {
+        for (const auto& haplotype : genotypes[g].copy_unique_ref()) {
+            result[haplotype] += genotype_posteriors[g];
+        }
+    }
+    return result;
+}
+
+// Clone counts are tried in increasing order, and each fit is warm started from the haplotype posteriors of the
+// best fit with fewer clones. The VB seeds of each fit run concurrently on any idle workers.
 void fit_sublone_model(const std::vector<Haplotype>& haplotypes, const HaplotypeLikelihoodArray& haplotype_likelihoods,
                        const GenotypePriorModel& genotype_prior_model, const SampleName& sample, const unsigned max_clones,
                        const double haploid_model_evidence, const std::function<double(unsigned)>& clonality_prior,
-                       const std::size_t max_genotypes, std::vector<Genotype<Haplotype>>& polyploid_genotypes,
+                       const std::size_t max_genotypes, const model::HaplotypeWeightMap& seed_haplotype_weights,
+                       ThreadPool* workers, std::vector<Genotype<Haplotype>>& polyploid_genotypes,
                        model::SubcloneModel::InferredLatents& sublonal_inferences,
                        boost::optional<logging::DebugLogger>& debug_log)
 {
     const auto haploid_prior = std::log(clonality_prior(1));
+    // Keys refer to haplotypes in polyploid_genotypes once there is a fit
+    model::HaplotypeWeightMap best_haplotype_weights {seed_haplotype_weights};
     for (unsigned num_clones {2}; num_clones <= max_clones; ++num_clones) {
         const auto clonal_model_prior = clonality_prior(num_clones);
         if (clonal_model_prior == 0.0) break;
@@ -189,7 +207,10 @@ void fit_sublone_model(const std::vector<Haplotype>& haplotypes, const Haplotype
         if (debug_log) stream(*debug_log) << "Generated " << genotypes.size() << " genotypes with clonality " << num_clones;
         if (genotypes.empty()) break;
         model::SubcloneModel::Priors subclonal_model_priors {genotype_prior_model, make_sublone_model_mixture_prior_map(sample, num_clones)};
-        model::SubcloneModel subclonal_model {{sample}, subclonal_model_priors};
+        model::SubcloneModel::AlgorithmParameters subclonal_model_params {};
+        subclonal_model_params.seed_haplotype_weights = best_haplotype_weights;
+        subclonal_model_params.workers = workers;
+        model::SubcloneModel subclonal_model {{sample}, subclonal_model_priors, subclonal_model_params};
         auto inferences = subclonal_model.evaluate(genotypes, haplotype_likelihoods);
         if (debug_log) stream(*debug_log) << "Evidence for model with clonality " << num_clones << " is " << inferences.approx_log_evidence;
         if (num_clones == 2) {
@@ -203,6 +224,9 @@ void fit_sublone_model(const std::vector<Haplotype>& haplotypes, const Haplotype
             polyploid_genotypes = std::move(genotypes);
             sublonal_inferences = std::move(inferences);
         }
+        if (num_clones < max_clones) {
+            best_haplotype_weights = compute_haplotype_posteriors(polyploid_genotypes, sublonal_inferences);
+        }
     }
 }
 
@@ -210,6 +234,14 @@ void fit_sublone_model(const std::vector<Haplotype>& haplotypes, const Haplotype
 
 std::unique_ptr<PolycloneCaller::Caller::Latents>
 PolycloneCaller::infer_latents(const std::vector<Haplotype>& haplotypes, const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+{
+    return infer_latents_with_warm_start(haplotypes, haplotype_likelihoods, {});
+}
+
+std::unique_ptr<PolycloneCaller::Caller::Latents>
+PolycloneCaller::infer_latents_with_warm_start(const std::vector<Haplotype>& haplotypes,
+                                               const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                               const Caller::Latents::HaplotypeProbabilityMap& haplotype_priors) const
 {
     auto haploid_genotypes = generate_all_genotypes(haplotypes, 1);
     if (debug_log_) stream(*debug_log_) << "There are " << haploid_genotypes.size() << " candidate haploid genotypes";
@@ -220,7 +252,7 @@ PolycloneCaller::infer_latents(const std::vector<Haplotype>& haplotypes, const H
     if (debug_log_) stream(*debug_log_) << "Evidence for haploid model is " << haploid_inferences.log_evidence;
     std::vector<Genotype<Haplotype>> polyploid_genotypes; model::SubcloneModel::InferredLatents sublonal_inferences;
     fit_sublone_model(haplotypes, haplotype_likelihoods, *genotype_prior_model, sample(), parameters_.max_clones,
-                      haploid_inferences.log_evidence, parameters_.clonality_prior, parameters_.max_genotypes, polyploid_genotypes,
+                      haploid_inferences.log_evidence, parameters_.clonality_prior, parameters_.max_genotypes, haplotype_priors, workers(), polyploid_genotypes,
                       sublonal_inferences, debug_log_);
     if (debug_log_) stream(*debug_log_) << "There are " << polyploid_genotypes.size() << " candidate polyploid genotypes";
     using std::move;
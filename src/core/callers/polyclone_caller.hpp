@@ -78,6 +78,10 @@ private:
     std::unique_ptr<Caller::Latents>
     infer_latents(const std::vector<Haplotype>& haplotypes,
                   const HaplotypeLikelihoodArray& haplotype_likelihoods) const override;
+    std::unique_ptr<Caller::Latents>
+    infer_latents_with_warm_start(const std::vector<Haplotype>& haplotypes,
+                                  const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                  const Caller::Latents::HaplotypeProbabilityMap& haplotype_priors) const override;
     
     boost::optional<double>
     calculate_model_posterior(const std::vector<Haplotype>& haplotypes,
@@ -12,6 +12,7 @@
 #include <functional>
 #include <utility>
 #include <iostream>
+#include <cmath>
 
 #include "basics/genomic_region.hpp"
 #include "core/types/allele.hpp"
@@ -256,7 +257,22 @@ PopulationCaller::infer_latents(const std::vector<Haplotype>& haplotypes,
     if (use_independence_model()) {
         return infer_latents_with_independence_model(haplotypes, haplotype_likelihoods);
     } else {
-        return infer_latents_with_joint_model(haplotypes, haplotype_likelihoods);
+        return infer_latents_with_joint_model(haplotypes, haplotype_likelihoods, get_indexed_haplotype_frequencies(haplotypes));
+    }
+}
+
+std::unique_ptr<PopulationCaller::Caller::Latents>
+PopulationCaller::infer_latents_with_warm_start(const std::vector<Haplotype>& haplotypes,
+                                                const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                                const Caller::Latents::HaplotypeProbabilityMap& haplotype_priors) const
+{
+    if (use_independence_model()) {
+        return infer_latents_with_independence_model(haplotypes, haplotype_likelihoods);
+    } else {
+        std::vector<double> initial_haplotype_frequencies(haplotypes.size());
+        std::transform(std::cbegin(haplotypes), std::cend(haplotypes), std::begin(initial_haplotype_frequencies),
+                       [&] (const Haplotype& haplotype) { return haplotype_priors.at(haplotype); });
+        return infer_latents_with_joint_model(haplotypes, haplotype_likelihoods, std::move(initial_haplotype_frequencies));
     }
 }
 
@@ -343,10 +359,11 @@ using GenotypePropertyBools = std::vector<AlleleBools>;
 auto marginalise(const GenotypeProbabilityMap& genotype_posteriors,
                  const AlleleBools& contained_alleles)
 {
-    auto p = std::inner_product(std::cbegin(genotype_posteriors), std::cend(genotype_posteriors),
+    const auto posteriors = genotype_posteriors.values();
+    auto p = std::inner_product(std::cbegin(posteriors), std::cend(posteriors),
                                 std::cbegin(contained_alleles), 0.0, std::plus<> {},
-                                [] (const auto& p, const bool is_contained) {
-                                    return is_contained ? 0.0 : p.second;
+                                [] (const double posterior, const bool is_contained) {
+                                    return is_contained ? 0.0 : posterior;
                                 });
     return probability_false_to_phred(p);
 }
@@ -371,13 +388,11 @@ auto get_contained_alleles(const PopulationGenotypeProbabilityMap& genotype_post
         return result;
     }
     result.reserve(alleles.size());
-    const auto& test_sample   = genotype_posteriors.begin()->first;
-    const auto genotype_begin = genotype_posteriors.begin(test_sample);
-    const auto genotype_end   = genotype_posteriors.end(test_sample);
+    const auto& genotypes = genotype_posteriors.keys2();
     for (const auto& allele : alleles) {
         result.emplace_back(num_genotypes);
-        std::transform(genotype_begin, genotype_end, std::begin(result.back()),
-                       [&] (const auto& p) { return contains(p.first, allele); });
+        std::transform(std::cbegin(genotypes), std::cend(genotypes), std::begin(result.back()),
+                       [&] (const auto& genotype) { return contains(genotype, allele); });
     }
     return result;
 }
@@ -742,11 +757,15 @@ bool PopulationCaller::use_independence_model() const noexcept
 
 std::unique_ptr<Caller::Latents>
 PopulationCaller::infer_latents_with_joint_model(const std::vector<Haplotype>& haplotypes,
-                                                 const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+                                                 const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                                 std::vector<double> initial_haplotype_frequencies) const
 {
     const auto prior_model = make_joint_prior_model(haplotypes);
     prior_model->prime(haplotypes);
-    const model::PopulationModel model {*prior_model, {parameters_.max_joint_genotypes}, debug_log_};
+    model::PopulationModel::Options model_options {parameters_.max_joint_genotypes};
+    model_options.workers = workers();
+    model_options.initial_haplotype_frequencies = std::move(initial_haplotype_frequencies);
+    const model::PopulationModel model {*prior_model, model_options, debug_log_};
     if (parameters_.ploidies.size() == 1) {
         std::vector<GenotypeIndex> genotype_indices;
         auto genotypes = generate_all_genotypes(haplotypes, parameters_.ploidies.front(), genotype_indices);
@@ -761,16 +780,45 @@ PopulationCaller::infer_latents_with_joint_model(const std::vector<Haplotype>& h
     }
 }
 
+// Each haplotype's initial frequency is proportional to the product over indexed variants in the region
+// of the variant's frequency if the haplotype carries it, and one minus that otherwise
+std::vector<double> PopulationCaller::get_indexed_haplotype_frequencies(const std::vector<Haplotype>& haplotypes) const
+{
+    static constexpr double minFrequency {1e-6};
+    if (parameters_.prior_variant_frequencies.empty() || haplotypes.empty()) return {};
+    const auto& region = mapped_region(haplotypes.front());
+    std::vector<double> result(haplotypes.size(), 0.0);
+    bool found {false};
+    for (const auto& index : parameters_.prior_variant_frequencies) {
+        for (const auto& p : index->fetch_frequencies(region)) {
+            if (!p.second || !contains(region, p.first)) continue;
+            const auto frequency = std::max(std::min(static_cast<double>(*p.second), 1 - minFrequency), minFrequency);
+            const auto& allele = p.first.alt_allele();
+            for (std::size_t i {0}; i < haplotypes.size(); ++i) {
+                result[i] += std::log(haplotypes[i].includes(allele) ? frequency : 1 - frequency);
+            }
+            found = true;
+        }
+    }
+    if (!found) return {};
+    maths::normalise_exp(result);
+    return result;
+}
+
 std::unique_ptr<Caller::Latents>
 PopulationCaller::infer_latents_with_independence_model(const std::vector<Haplotype>& haplotypes,
                                                         const HaplotypeLikelihoodArray& haplotype_likelihoods) const
 {
     const auto prior_model = make_independent_prior_model(haplotypes);
-    const model::IndependentPopulationModel model {*prior_model, debug_log_};
+    model::IndependentPopulationModel::Options model_options {};
+    model_options.workers = workers();
+    const model::IndependentPopulationModel model {*prior_model, model_options, debug_log_};
     if (parameters_.ploidies.size() == 1) {
-        auto genotypes = generate_all_genotypes(haplotypes, parameters_.ploidies.front());
+        std::vector<GenotypeIndex> genotype_indices {};
+        auto genotypes = generate_all_genotypes(haplotypes, parameters_.ploidies.front(), genotype_indices);
         if (debug_log_) stream(*debug_log_) << "There are " << genotypes.size() << " candidate genotypes";
-        auto inferences = model.evaluate(samples_, genotypes, haplotype_likelihoods);
+        prior_model->prime(haplotypes);
+        auto inferences = model.evaluate(samples_, genotypes, genotype_indices, haplotypes, haplotype_likelihoods);
         return std::make_unique<Latents>(samples_, haplotypes, std::move(genotypes), std::move(inferences));
     } else {
         auto unique_genotypes = generate_unique_genotypes(haplotypes, parameters_.ploidies);
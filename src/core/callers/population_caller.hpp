@@ -17,6 +17,7 @@
 #include "core/models/genotype/population_prior_model.hpp"
 #include "core/models/genotype/independent_population_model.hpp"
 #include "core/models/genotype/population_model.hpp"
+#include "core/tools/vargen/variant_index.hpp"
 #include "caller.hpp"
 
 namespace octopus {
@@ -40,6 +41,8 @@ public:
         std::size_t max_joint_genotypes;
         bool use_independent_genotype_priors = false;
         bool deduplicate_haplotypes_with_germline_model = true;
+        // Indexed variant frequencies used to initialise the joint model's haplotype frequencies
+        std::vector<std::shared_ptr<const VariantIndex>> prior_variant_frequencies = {};
     };
     
     PopulationCaller() = delete;
@@ -70,6 +73,10 @@ private:
     std::unique_ptr<Caller::Latents>
     infer_latents(const std::vector<Haplotype>& haplotypes,
                   const HaplotypeLikelihoodArray& haplotype_likelihoods) const override;
+    std::unique_ptr<Caller::Latents>
+    infer_latents_with_warm_start(const std::vector<Haplotype>& haplotypes,
+                                  const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                  const Caller::Latents::HaplotypeProbabilityMap& haplotype_priors) const override;
     
     std::vector<std::unique_ptr<VariantCall>>
     call_variants(const std::vector<Variant>& candidates, const Caller::Latents& latents) const override;
@@ -84,7 +91,9 @@ private:
     bool use_independence_model() const noexcept;
     std::unique_ptr<Caller::Latents>
     infer_latents_with_joint_model(const std::vector<Haplotype>& haplotypes,
-                                   const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
+                                   const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                   std::vector<double> initial_haplotype_frequencies = {}) const;
+    std::vector<double> get_indexed_haplotype_frequencies(const std::vector<Haplotype>& haplotypes) const;
     std::unique_ptr<Caller::Latents>
     infer_latents_with_independence_model(const std::vector<Haplotype>& haplotypes,
                                           const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
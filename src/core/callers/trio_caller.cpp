@@ -412,6 +412,10 @@ TrioCaller::infer_latents(const std::vector<Haplotype>& haplotypes,
         germline_prior_model->prime(haplotypes);
         denovo_model.prime(haplotypes);
         auto latents = model.evaluate(maternal_genotypes, genotype_indices, haplotype_likelihoods);
+        if (debug_log_) {
+            const auto stats = denovo_model.index_cache_statistics();
+            stream(*debug_log_) << "De novo model cache had " << stats.hits << " hits and " << stats.misses << " misses";
+        }
         return std::make_unique<Latents>(haplotypes, std::move(maternal_genotypes),
                                          std::move(latents), parameters_.trio);
     } else {
@@ -9,9 +9,11 @@
 #include <algorithm>
 #include <functional>
 #include <exception>
+#include <thread>
 
 #include "config/config.hpp"
 #include "config/option_collation.hpp"
+#include "config/performance_tuning.hpp"
 #include "utils/map_utils.hpp"
 #include "logging/logging.hpp"
 #include "exceptions/user_error.hpp"
@@ -100,16 +102,46 @@ std::size_t GenomeCallingComponents::read_buffer_size() const noexcept
     return components_.read_buffer_size;
 }
 
+bool GenomeCallingComponents::compress_read_buffer() const noexcept
+{
+    return components_.compress_read_buffer;
+}
+
+boost::optional<MemoryFootprint> GenomeCallingComponents::working_memory_footprint() const noexcept
+{
+    return components_.working_memory_footprint;
+}
+
 const boost::optional<GenomeCallingComponents::Path>& GenomeCallingComponents::temp_directory() const noexcept
 {
     return components_.temp_directory;
 }
 
+const boost::optional<GenomeCallingComponents::Path>& GenomeCallingComponents::checkpoint_directory() const noexcept
+{
+    return components_.checkpoint_directory;
+}
+
+bool GenomeCallingComponents::resume() const noexcept
+{
+    return components_.resume;
+}
+
+const boost::optional<GenomeCallingComponents::Path>& GenomeCallingComponents::live_metrics_file() const noexcept
+{
+    return components_.live_metrics_file;
+}
+
 boost::optional<unsigned> GenomeCallingComponents::num_threads() const noexcept
 {
     return components_.num_threads;
 }
 
+bool GenomeCallingComponents::pin_threads() const noexcept
+{
+    return components_.pin_threads;
+}
+
 const CallerFactory& GenomeCallingComponents::caller_factory() const noexcept
 {
     return components_.caller_factory;
@@ -148,6 +180,11 @@ const ReadPipe& GenomeCallingComponents::filter_read_pipe() const noexcept
     return components_.filter_read_pipe ? *components_.filter_read_pipe : read_pipe();
 }
 
+bool GenomeCallingComponents::fuse_call_filtering() const noexcept
+{
+    return components_.fuse_call_filtering;
+}
+
 ProgressMeter& GenomeCallingComponents::progress_meter() noexcept
 {
     return components_.progress_meter;
@@ -183,6 +220,31 @@ boost::optional<GenomeCallingComponents::Path> GenomeCallingComponents::data_pro
     return components_.data_profile;
 }
 
+double GenomeCallingComponents::data_profile_fraction() const noexcept
+{
+    return components_.data_profile_fraction;
+}
+
+boost::optional<GenomeCallingComponents::Path> GenomeCallingComponents::shard_manifest() const
+{
+    return components_.shard_manifest;
+}
+
+boost::optional<ShardingConfig> GenomeCallingComponents::shard_manifest_request() const noexcept
+{
+    return components_.shard_manifest_request;
+}
+
+const std::vector<GenomeCallingComponents::Path>& GenomeCallingComponents::merge_shards_request() const noexcept
+{
+    return components_.merge_shards_request;
+}
+
+std::pair<ReferenceGenome, ReadManager> GenomeCallingComponents::release_inputs()
+{
+    return {std::move(components_.reference), std::move(components_.read_manager)};
+}
+
 bool GenomeCallingComponents::sites_only() const noexcept
 {
     return components_.sites_only;
@@ -222,9 +284,78 @@ std::vector<ContigName> get_unmapped_contigs(const ReadManager& rm, const Refere
     return copy_unmapped_contigs(rm, reference, reference.contig_names());
 }
 
+bool is_unknown_base(const char base) noexcept
+{
+    return base == 'N' || base == 'n';
+}
+
+// Nothing can be called in runs of N, and no reads align to long ones, so they are not worth scheduling.
+// The sequence is scanned in chunks to bound memory on whole genome runs.
+auto find_reference_gaps(const ReferenceGenome& reference, const GenomicRegion& region, const GenomicRegion::Size min_gap_size)
+{
+    static constexpr GenomicRegion::Size chunkSize {1'000'000};
+    std::vector<GenomicRegion> result {};
+    boost::optional<GenomicRegion::Position> gap_begin {};
+    for (auto chunk_begin = region.begin(); chunk_begin < region.end(); chunk_begin += chunkSize) {
+        const auto chunk_end = std::min(chunk_begin + chunkSize, region.end());
+        const auto sequence = reference.fetch_sequence(GenomicRegion {region.contig_name(), chunk_begin, chunk_end});
+        for (auto itr = std::cbegin(sequence); itr != std::cend(sequence);) {
+            if (gap_begin) {
+                itr = std::find_if_not(itr, std::cend(sequence), is_unknown_base);
+                if (itr == std::cend(sequence)) break;
+                const auto gap_end = chunk_begin + static_cast<GenomicRegion::Position>(std::distance(std::cbegin(sequence), itr));
+                if (gap_end - *gap_begin >= min_gap_size) result.emplace_back(region.contig_name(), *gap_begin, gap_end);
+                gap_begin = boost::none;
+            } else {
+                itr = std::find_if(itr, std::cend(sequence), is_unknown_base);
+                if (itr == std::cend(sequence)) break;
+                gap_begin = chunk_begin + static_cast<GenomicRegion::Position>(std::distance(std::cbegin(sequence), itr));
+            }
+        }
+    }
+    if (gap_begin && region.end() - *gap_begin >= min_gap_size) {
+        result.emplace_back(region.contig_name(), *gap_begin, region.end());
+    }
+    return result;
+}
+
+GenomicRegion::Size remove_reference_gaps(InputRegionMap& regions, const ReferenceGenome& reference,
+                                          const GenomicRegion::Size min_gap_size)
+{
+    GenomicRegion::Size result {0};
+    for (auto contig_itr = std::begin(regions); contig_itr != std::end(regions);) {
+        InputRegionMap::mapped_type ungapped_regions {};
+        for (const auto& region : contig_itr->second) {
+            auto begin = region.begin();
+            for (const auto& gap : find_reference_gaps(reference, region, min_gap_size)) {
+                if (begin < gap.begin()) ungapped_regions.emplace(region.contig_name(), begin, gap.begin());
+                begin = gap.end();
+                result += size(gap);
+            }
+            if (begin < region.end()) ungapped_regions.emplace(region.contig_name(), begin, region.end());
+        }
+        if (ungapped_regions.empty()) {
+            contig_itr = regions.erase(contig_itr);
+        } else {
+            ungapped_regions.shrink_to_fit();
+            contig_itr->second = std::move(ungapped_regions);
+            ++contig_itr;
+        }
+    }
+    return result;
+}
+
 auto get_search_regions(const options::OptionMap& options, const ReferenceGenome& reference, const ReadManager& rm)
 {
     auto result = options::get_search_regions(options, reference);
+    const auto min_reference_gap = options::get_min_skipped_reference_gap(options);
+    if (min_reference_gap > 0) {
+        const auto num_gap_bases = remove_reference_gaps(result, reference, min_reference_gap);
+        if (num_gap_bases > 0) {
+            logging::InfoLogger info_log {};
+            stream(info_log) << "Skipping " << num_gap_bases << "bp of reference gaps";
+        }
+    }
     if (options::ignore_unmapped_contigs(options)) {
         const auto unmapped_contigs = get_unmapped_contigs(rm, reference);
         if (!unmapped_contigs.empty()) {
@@ -450,6 +581,44 @@ auto generate_temp_output_path(const fs::path& temp_directory)
     return temp_directory / "octopus_unfiltered.bcf";
 }
 
+auto make_reads_profile(const std::vector<SampleName>& samples, const InputRegionMap& regions,
+                        const ReadManager& read_manager, const options::OptionMap& options)
+{
+    // Profiling samples reads from across the input regions, which a stream can't provide
+    if (read_manager.is_streaming()) return boost::optional<ReadSetProfile> {};
+    ReadSetProfileConfig config {};
+    const auto num_threads = options::get_num_threads(options);
+    config.max_threads = num_threads ? *num_threads : std::max(std::thread::hardware_concurrency(), 1u);
+    if (options::cache_read_profile(options) && !read_manager.paths().empty()) {
+        return profile_reads(samples, regions, read_manager, get_default_read_profile_cache(read_manager), config);
+    }
+    return profile_reads(samples, regions, read_manager, config);
+}
+
+boost::optional<options::OptionMap>
+make_tuned_options(const options::OptionMap& options, const InputRegionMap& regions,
+                   const boost::optional<ReadSetProfile>& reads_profile)
+{
+    const auto target_throughput = options::get_target_throughput(options, regions);
+    if (!target_throughput) return boost::none;
+    if (!reads_profile) {
+        logging::WarningLogger warn_log {};
+        warn_log << "Could not profile the input reads so cannot tune for the requested throughput";
+        return boost::none;
+    }
+    options::PerformanceTuningConfig config {*target_throughput};
+    const auto num_threads = options::get_num_threads(options);
+    config.num_threads = num_threads ? *num_threads : std::max(std::thread::hardware_concurrency(), 1u);
+    config.max_read_buffer_footprint = options::get_target_read_buffer_size(options);
+    const auto pair_hmm_seconds = options::calibrate_pair_hmm(reads_profile->median_read_length);
+    const auto profile = options::tune_performance(*reads_profile, pair_hmm_seconds, config);
+    logging::InfoLogger info_log {};
+    stream(info_log) << "Tuned for " << 3.6e-3 * *target_throughput << "Mb/h: " << profile;
+    auto result = options;
+    options::apply(profile, result);
+    return result;
+}
+
 bool all_samples_in_vcf(std::vector<SampleName> samples, const VcfReader& in)
 {
     std::sort(std::begin(samples), std::end(samples));
@@ -497,15 +666,19 @@ GenomeCallingComponents::Components::Components(ReferenceGenome&& reference, Rea
 , samples {extract_samples(options, this->read_manager)}
 , regions {get_search_regions(options, this->reference, this->read_manager)}
 , contigs {get_contigs(this->regions, this->reference, options::get_contig_output_order(options))}
-, reads_profile {profile_reads(this->samples, this->regions, this->read_manager)}
+, reads_profile {make_reads_profile(this->samples, this->regions, this->read_manager, options)}
 , read_pipe {options::make_read_pipe(this->read_manager, this->reference, this->samples, options)}
 , caller_factory {options::make_caller_factory(this->reference, this->read_pipe, this->regions, options, this->reads_profile)}
 , filter_read_pipe {}
+, fuse_call_filtering {options::fuse_call_filtering(options)}
 , output {std::move(output)}
 , filtered_output {}
 , num_threads {options::get_num_threads(options)}
+, pin_threads {options::pin_threads(options)}
 , read_buffer_footprint {options::get_target_read_buffer_size(options)}
 , read_buffer_size {}
+, compress_read_buffer {options::compress_read_buffer(options)}
+, working_memory_footprint {options::get_total_working_memory(options)}
 , progress_meter {regions}
 , ploidies {options::get_ploidy_map(options)}
 , pedigree {options::get_pedigree(options, samples)}
@@ -515,10 +688,24 @@ GenomeCallingComponents::Components::Components(ReferenceGenome&& reference, Rea
 , bamout {options::bamout_request(options)}
 , bamout_config {}
 , data_profile {options::data_profile_request(options)}
-{
+, data_profile_fraction {options::data_profile_fraction(options)}
+, shard_manifest {options::get_shard_manifest(options)}
+, shard_manifest_request {options::shard_manifest_request(options)}
+, merge_shards_request {options::merge_shards_request(options)}
+, checkpoint_directory {options::get_checkpoint_directory(options)}
+, resume {options::resume_from_checkpoint(options)}
+, live_metrics_file {options::get_live_metrics_file_name(options)}
+{
+    if (const auto tuned_options = make_tuned_options(options, this->regions, this->reads_profile)) {
+        read_pipe = options::make_read_pipe(this->read_manager, this->reference, this->samples, *tuned_options);
+        caller_factory = options::make_caller_factory(this->reference, this->read_pipe, this->regions, *tuned_options, this->reads_profile);
+        read_buffer_footprint = options::get_target_read_buffer_size(*tuned_options);
+        set_read_buffer_size(*tuned_options);
+    } else {
+        set_read_buffer_size(options);
+    }
     drop_unused_samples(this->samples, this->read_manager);
     setup_progress_meter(options);
-    set_read_buffer_size(options);
     setup_filter_read_pipe(options);
     filter_request = options::filter_request(options);
     if (filter_request && !all_samples_in_vcf(samples, *filter_request)) {
@@ -580,6 +767,9 @@ void GenomeCallingComponents::Components::setup_writers(const options::OptionMap
     } else if (options::is_legacy_vcf_requested(options) && output.path()) {
         legacy = get_legacy_path(*output.path());
     }
+    const auto num_compression_threads = options::get_num_compression_threads(options);
+    output.set_compression_threads(num_compression_threads);
+    if (filtered_output) filtered_output->set_compression_threads(num_compression_threads);
 }
 
 void GenomeCallingComponents::Components::setup_filter_read_pipe(const options::OptionMap& options)
@@ -656,6 +846,12 @@ GenomeCallingComponents collate_genome_calling_components(const options::OptionM
 {
     auto reference    = options::make_reference(options);
     auto read_manager = options::make_read_manager(options);
+    return collate_genome_calling_components(options, std::move(reference), std::move(read_manager));
+}
+
+GenomeCallingComponents collate_genome_calling_components(const options::OptionMap& options,
+                                                          ReferenceGenome&& reference, ReadManager&& read_manager)
+{
     // Check this here to avoid creating output file on error
     if (!options::ignore_unmapped_contigs(options) && !all_reference_contigs_mapped(read_manager, reference)) {
         throw UnmatchedReference {reference};
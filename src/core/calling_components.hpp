@@ -8,6 +8,7 @@
 #include <cstddef>
 #include <functional>
 #include <memory>
+#include <utility>
 
 #include <boost/optional.hpp>
 #include <boost/filesystem/path.hpp>
@@ -24,6 +25,7 @@
 #include "core/callers/caller_factory.hpp"
 #include "core/csr/filters/variant_call_filter_factory.hpp"
 #include "core/tools/bam_realigner.hpp"
+#include "core/tools/shard_manifest.hpp"
 #include "utils/memory_footprint.hpp"
 #include "utils/input_reads_profiler.hpp"
 #include "logging/progress_meter.hpp"
@@ -59,14 +61,21 @@ public:
     const VcfWriter& output() const noexcept;
     MemoryFootprint read_buffer_footprint() const noexcept;
     std::size_t read_buffer_size() const noexcept;
+    bool compress_read_buffer() const noexcept;
+    boost::optional<MemoryFootprint> working_memory_footprint() const noexcept;
     const boost::optional<Path>& temp_directory() const noexcept;
+    const boost::optional<Path>& checkpoint_directory() const noexcept;
+    bool resume() const noexcept;
+    const boost::optional<Path>& live_metrics_file() const noexcept;
     boost::optional<unsigned> num_threads() const noexcept;
+    bool pin_threads() const noexcept;
     const CallerFactory& caller_factory() const noexcept;
     boost::optional<VcfWriter&> filtered_output() noexcept;
     boost::optional<const VcfWriter&> filtered_output() const noexcept;
     const VariantCallFilterFactory& call_filter_factory() const;
     ReadPipe& filter_read_pipe() noexcept;
     const ReadPipe& filter_read_pipe() const noexcept;
+    bool fuse_call_filtering() const noexcept;
     ProgressMeter& progress_meter() noexcept;
     bool sites_only() const noexcept;
     const PloidyMap& ploidies() const noexcept;
@@ -77,6 +86,14 @@ public:
     BAMRealigner::Config bamout_config() const noexcept;
     boost::optional<ReadSetProfile> reads_profile() const noexcept;
     boost::optional<Path> data_profile() const;
+    double data_profile_fraction() const noexcept;
+    boost::optional<Path> shard_manifest() const;
+    boost::optional<ShardingConfig> shard_manifest_request() const noexcept;
+    const std::vector<Path>& merge_shards_request() const noexcept;
+    
+    // Moves out the reference and read manager so another run can reuse them. The components must not
+    // be used afterwards.
+    std::pair<ReferenceGenome, ReadManager> release_inputs();
     
 private:
     struct Components
@@ -102,11 +119,15 @@ private:
         ReadPipe read_pipe;
         CallerFactory caller_factory;
         boost::optional<ReadPipe> filter_read_pipe;
+        bool fuse_call_filtering;
         VcfWriter output;
         boost::optional<VcfWriter> filtered_output;
         boost::optional<unsigned> num_threads;
+        bool pin_threads;
         MemoryFootprint read_buffer_footprint;
         std::size_t read_buffer_size;
+        bool compress_read_buffer;
+        boost::optional<MemoryFootprint> working_memory_footprint;
         ProgressMeter progress_meter;
         PloidyMap ploidies;
         boost::optional<Pedigree> pedigree;
@@ -116,6 +137,13 @@ private:
         boost::optional<Path> bamout;
         BAMRealigner::Config bamout_config;
         boost::optional<Path> data_profile;
+        double data_profile_fraction;
+        boost::optional<Path> shard_manifest;
+        boost::optional<ShardingConfig> shard_manifest_request;
+        std::vector<Path> merge_shards_request;
+        boost::optional<Path> checkpoint_directory;
+        bool resume;
+        boost::optional<Path> live_metrics_file;
         // Components that require temporary directory during construction appear last to make
         // exception handling easier.
         boost::optional<Path> temp_directory;
@@ -133,6 +161,8 @@ private:
 };
 
 GenomeCallingComponents collate_genome_calling_components(const options::OptionMap& options);
+GenomeCallingComponents collate_genome_calling_components(const options::OptionMap& options,
+                                                          ReferenceGenome&& reference, ReadManager&& read_manager);
 
 bool validate(const GenomeCallingComponents& components);
 
@@ -8,13 +8,16 @@
 #include <functional>
 #include <memory>
 #include <unordered_map>
+#include <cstddef>
 
 #include <boost/variant.hpp>
 
 #include "concepts/equitable.hpp"
 #include "config/common.hpp"
+#include "basics/genomic_region.hpp"
 #include "basics/ploidy_map.hpp"
 #include "basics/pedigree.hpp"
+#include "basics/tandem_repeat.hpp"
 #include "core/types/allele.hpp"
 #include "core/types/haplotype.hpp"
 #include "core/types/genotype.hpp"
@@ -37,11 +40,28 @@ public:
         SampleAmbiguityMap ambiguous;
     };
     
+    // Statistics of the reads overlapping a call region
+    struct ReadSummary
+    {
+        std::unordered_map<SampleName, std::size_t> sample_depths;
+        std::size_t depth;
+        std::size_t num_significantly_clipped;
+        double rms_mapping_quality;
+    };
+    
+    struct ReadSummaries
+    {
+        std::unordered_map<GenomicRegion, ReadSummary> calls;
+        std::size_t num_mapq_zero; // in the whole block
+    };
+    
     using ResultType = boost::variant<std::reference_wrapper<const ReadMap>,
                                       std::reference_wrapper<const SupportMaps>,
+                                      std::reference_wrapper<const ReadSummaries>,
                                       std::reference_wrapper<const std::string>,
                                       std::reference_wrapper<const std::vector<std::string>>,
                                       std::reference_wrapper<const Haplotype>,
+                                      std::reference_wrapper<const std::vector<TandemRepeat>>,
                                       std::reference_wrapper<const GenotypeMap>,
                                       std::reference_wrapper<const AlleleMap>,
                                       std::reference_wrapper<const LocalPloidyMap>,
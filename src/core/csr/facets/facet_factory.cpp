@@ -9,12 +9,15 @@
 #include <iterator>
 #include <array>
 #include <future>
+#include <deque>
 #include <cassert>
 
 #include "exceptions/program_error.hpp"
 #include "overlapping_reads.hpp"
+#include "read_statistics.hpp"
 #include "read_assignments.hpp"
 #include "reference_context.hpp"
+#include "tandem_repeats.hpp"
 #include "samples.hpp"
 #include "genotypes.hpp"
 #include "alleles.hpp"
@@ -123,7 +126,7 @@ decltype(auto) name() noexcept
 
 bool requires_reference(const std::string& facet) noexcept
 {
-    const static std::array<std::string, 2> read_facets{name<ReferenceContext>(), name<ReadAssignments>()};
+    const static std::array<std::string, 3> read_facets{name<ReferenceContext>(), name<TandemRepeats>(), name<ReadAssignments>()};
     return std::find(std::cbegin(read_facets), std::cend(read_facets), facet) != std::cend(read_facets);
 }
 
@@ -132,9 +135,15 @@ bool requires_reference(const std::vector<std::string>& facets) noexcept
     return std::any_of(std::cbegin(facets), std::cend(facets), [](const auto& facet) { return requires_reference(facet); });
 }
 
+bool requires_reference_context(const std::vector<std::string>& facets) noexcept
+{
+    return std::any_of(std::cbegin(facets), std::cend(facets), [](const auto& facet) {
+        return facet == name<ReferenceContext>() || facet == name<TandemRepeats>(); });
+}
+
 bool requires_reads(const std::string& facet) noexcept
 {
-    const static std::array<std::string, 2> read_facets{name<OverlappingReads>(), name<ReadAssignments>()};
+    const static std::array<std::string, 3> read_facets{name<OverlappingReads>(), name<ReadStatistics>(), name<ReadAssignments>()};
     return std::find(std::cbegin(read_facets), std::cend(read_facets), facet) != std::cend(read_facets);
 }
 
@@ -204,11 +213,17 @@ FacetFactory::make(const std::vector<std::string>& names,
     std::vector<FacetBlock> result {};
     result.reserve(blocks.size());
     if (blocks.size() > 1 && !workers.empty()) {
-        std::vector<std::future<FacetBlock>> futures {};
-        futures.reserve(blocks.size());
+        std::deque<std::future<FacetBlock>> futures {};
         const auto fetch_reads = requires_reads(names);
         const auto fetch_genotypes = requires_genotypes(names);
+        // Enough blocks in flight to keep every worker busy while the next block's reads are fetched
+        const auto max_blocks_ahead = 2 * workers.size();
         for (const auto& block : blocks) {
+            if (fetch_reads && futures.size() >= max_blocks_ahead) {
+                // Bound the reads held in memory by collecting finished blocks before fetching more
+                result.push_back(futures.front().get());
+                futures.pop_front();
+            }
             // It's faster to fetch reads serially from left to right, so do this outside the thread pool
             BlockData data {};
             data.calls = std::addressof(block);
@@ -246,16 +261,28 @@ void FacetFactory::setup_facet_makers()
         assert(block.reads);
         return {std::make_unique<OverlappingReads>(*block.reads)};
     };
+    facet_makers_[name<ReadStatistics>()] = [] (const BlockData& block) -> FacetWrapper
+    {
+        assert(block.reads && block.calls);
+        return {std::make_unique<ReadStatistics>(*block.reads, *block.calls)};
+    };
     facet_makers_[name<ReadAssignments>()] = [this] (const BlockData& block) -> FacetWrapper
     {
         assert(block.reads && block.genotypes);
         return {std::make_unique<ReadAssignments>(*reference_, *block.genotypes, *block.reads)};
     };
-    facet_makers_[name<ReferenceContext>()] = [this] (const BlockData& block) -> FacetWrapper
+    facet_makers_[name<ReferenceContext>()] = [] (const BlockData& block) -> FacetWrapper
     {
-        if (block.region) {
-            constexpr GenomicRegion::Size context_size {50};
-            return {std::make_unique<ReferenceContext>(*reference_, expand(*block.region, context_size))};
+        if (block.reference_context) {
+            return {std::make_unique<ReferenceContext>(block.reference_context)};
+        } else {
+            return {nullptr};
+        }
+    };
+    facet_makers_[name<TandemRepeats>()] = [this] (const BlockData& block) -> FacetWrapper
+    {
+        if (block.reference_context) {
+            return {std::make_unique<TandemRepeats>(*reference_, *block.reference_context)};
         } else {
             return {nullptr};
         }
@@ -339,6 +366,10 @@ FacetFactory::BlockData FacetFactory::make_block_data(const std::vector<std::str
         if (requires_genotypes(names)) {
             result.genotypes = extract_genotypes(block, samples_, *reference_);
         }
+        if (requires_reference_context(names)) {
+            constexpr GenomicRegion::Size context_size {50};
+            result.reference_context = std::make_shared<Haplotype>(expand(*result.region, context_size), *reference_);
+        }
     }
     return result;
 }
@@ -44,6 +44,8 @@ public:
     
     ~FacetFactory() = default;
     
+    // Facets are made once per call block and are not cached. Blocks partition calls by phase region, and double
+    // pass filters classify from recorded measures, so no block is requested twice in a filtering run.
     FacetWrapper make(const std::string& name, const CallBlock& block) const;
     FacetBlock make(const std::vector<std::string>& names, const CallBlock& block) const;
     std::vector<FacetBlock> make(const std::vector<std::string>& names, const std::vector<CallBlock>& blocks, ThreadPool& workers) const;
@@ -55,6 +57,7 @@ private:
         boost::optional<GenomicRegion> region;
         boost::optional<ReadMap> reads;
         boost::optional<GenotypeMap> genotypes;
+        std::shared_ptr<const Haplotype> reference_context; // shared by the reference facets
     };
     
     VcfHeader input_header_;
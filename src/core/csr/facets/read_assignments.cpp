@@ -29,33 +29,50 @@ ReadAssignments::ReadAssignments(const ReferenceGenome& reference, const Genotyp
     for (const auto& p : genotypes) {
         const auto& sample = p.first;
         const auto& sample_genotypes = p.second;
-        result_.support[sample].reserve(sample_genotypes.size());
+        auto& sample_support = result_.support[sample];
+        sample_support.reserve(sample_genotypes.size());
+        // Genotypes needing read assignment are batched so they share one likelihood model
+        std::vector<Genotype<Haplotype>> assigned_genotypes {};
+        std::vector<std::vector<AlignedRead>> assigned_reads {};
         for (const auto& genotype : sample_genotypes) {
             auto local_reads = copy_overlapped_to_vector(reads.at(sample), genotype);
             for (const auto& haplotype : genotype) {
                 // So every called haplotype appears in support map, even if no read support
-                result_.support[sample][haplotype] = {};
+                sample_support[haplotype] = {};
             }
             if (!local_reads.empty()) {
-                HaplotypeSupportMap genotype_support {};
                 if (!genotype.is_homozygous()) {
-                    genotype_support = compute_haplotype_support(genotype, local_reads, result_.ambiguous[sample]);
+                    assigned_genotypes.push_back(genotype);
+                    assigned_reads.push_back(std::move(local_reads));
                 } else {
                     if (is_reference(genotype[0])) {
-                        genotype_support[genotype[0]] = std::move(local_reads);
+                        auto& genotype_support = sample_support[genotype[0]];
+                        genotype_support = std::move(local_reads);
+                        safe_realign_to_reference(genotype_support, genotype[0]);
+                        std::sort(std::begin(genotype_support), std::end(genotype_support));
                     } else {
                         auto augmented_genotype = genotype;
                         Haplotype ref {mapped_region(genotype), reference};
-                        result_.support[sample][ref] = {};
+                        sample_support[ref] = {};
                         augmented_genotype.emplace(std::move(ref));
-                        genotype_support = compute_haplotype_support(augmented_genotype, local_reads, result_.ambiguous[sample]);
+                        assigned_genotypes.push_back(std::move(augmented_genotype));
+                        assigned_reads.push_back(std::move(local_reads));
                     }
                 }
-                for (auto& s : genotype_support) {
+            }
+        }
+        std::vector<HaplotypeMappingMap> genotype_mappings {};
+        auto genotype_supports = compute_haplotype_support(assigned_genotypes, assigned_reads, result_.ambiguous[sample], genotype_mappings);
+        for (std::size_t i {0}; i < genotype_supports.size(); ++i) {
+            for (auto& s : genotype_supports[i]) {
+                const auto mappings_itr = genotype_mappings[i].find(s.first);
+                if (mappings_itr != std::cend(genotype_mappings[i]) && mappings_itr->second.size() == s.second.size()) {
+                    safe_realign_to_reference(s.second, s.first, mappings_itr->second);
+                } else {
                     safe_realign_to_reference(s.second, s.first);
-                    std::sort(std::begin(s.second), std::end(s.second));
-                    result_.support[sample][s.first] = std::move(s.second);
                 }
+                std::sort(std::begin(s.second), std::end(s.second));
+                sample_support[s.first] = std::move(s.second);
             }
         }
     }
@@ -0,0 +1,78 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "read_statistics.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <cmath>
+#include <cassert>
+
+namespace octopus { namespace csr {
+
+const std::string ReadStatistics::name_ {"ReadStatistics"};
+
+bool is_significantly_clipped(const AlignedRead& read) noexcept
+{
+    assert(sequence_size(read) > 0);
+    return is_soft_clipped(read) && static_cast<double>(total_clip_size(read)) / sequence_size(read) > 0.25;
+}
+
+namespace {
+
+struct RegionTotals
+{
+    std::size_t num_reads = 0, num_significantly_clipped = 0;
+    double sum_squared_mapping_quality = 0;
+};
+
+} // namespace
+
+ReadStatistics::ReadStatistics(const ReadMap& reads, const std::vector<VcfRecord>& calls)
+{
+    std::vector<GenomicRegion> regions {};
+    regions.reserve(calls.size());
+    std::transform(std::cbegin(calls), std::cend(calls), std::back_inserter(regions),
+                   [] (const VcfRecord& call) { return mapped_region(call); });
+    std::sort(std::begin(regions), std::end(regions));
+    regions.erase(std::unique(std::begin(regions), std::end(regions)), std::end(regions));
+    summaries_.calls.reserve(regions.size());
+    summaries_.num_mapq_zero = 0;
+    std::vector<RegionTotals> totals(regions.size());
+    std::vector<std::size_t> sample_depths(regions.size());
+    for (const auto& p : reads) {
+        std::fill(std::begin(sample_depths), std::end(sample_depths), 0);
+        // Reads and regions are both sorted by begin, so regions ending before a read can't overlap any later read
+        std::size_t first_region {0};
+        for (const AlignedRead& read : p.second) {
+            if (read.mapping_quality() == 0) ++summaries_.num_mapq_zero;
+            while (first_region < regions.size() && regions[first_region].end() < mapped_begin(read)) ++first_region;
+            for (auto i = first_region; i < regions.size() && regions[i].begin() <= mapped_end(read); ++i) {
+                if (overlaps(read, regions[i])) {
+                    ++sample_depths[i];
+                    ++totals[i].num_reads;
+                    if (is_significantly_clipped(read)) ++totals[i].num_significantly_clipped;
+                    const auto mapping_quality = static_cast<double>(read.mapping_quality());
+                    totals[i].sum_squared_mapping_quality += mapping_quality * mapping_quality;
+                }
+            }
+        }
+        for (std::size_t i {0}; i < regions.size(); ++i) {
+            summaries_.calls[regions[i]].sample_depths.emplace(p.first, sample_depths[i]);
+        }
+    }
+    for (std::size_t i {0}; i < regions.size(); ++i) {
+        auto& summary = summaries_.calls[regions[i]];
+        summary.depth = totals[i].num_reads;
+        summary.num_significantly_clipped = totals[i].num_significantly_clipped;
+        summary.rms_mapping_quality = totals[i].num_reads > 0 ? std::sqrt(totals[i].sum_squared_mapping_quality / totals[i].num_reads) : 0.0;
+    }
+}
+
+Facet::ResultType ReadStatistics::do_get() const
+{
+    return std::cref(summaries_);
+}
+
+} // namespace csr
+} // namespace octopus
@@ -0,0 +1,43 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef read_statistics_hpp
+#define read_statistics_hpp
+
+#include <vector>
+#include <string>
+#include <functional>
+
+#include "io/variant/vcf_record.hpp"
+#include "config/common.hpp"
+#include "facet.hpp"
+
+namespace octopus { namespace csr {
+
+// Summarises the reads overlapping every call in a block with a single sweep over the reads,
+// so measures sharing these statistics don't each need to search the reads
+class ReadStatistics : public Facet
+{
+public:
+    using ResultType = std::reference_wrapper<const ReadSummaries>;
+    
+    ReadStatistics() = default;
+    
+    ReadStatistics(const ReadMap& reads, const std::vector<VcfRecord>& calls);
+
+private:
+    static const std::string name_;
+    
+    ReadSummaries summaries_;
+    
+    const std::string& do_name() const noexcept override { return name_; }
+    Facet::ResultType do_get() const override;
+};
+
+// Reads with over a quarter of their bases soft clipped
+bool is_significantly_clipped(const AlignedRead& read) noexcept;
+
+} // namespace csr
+} // namespace octopus
+
+#endif
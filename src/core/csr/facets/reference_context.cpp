@@ -10,7 +10,11 @@ namespace octopus { namespace csr {
 const std::string ReferenceContext::name_ {"ReferenceContext"};
 
 ReferenceContext::ReferenceContext(const ReferenceGenome& reference, GenomicRegion region)
-: result_ {std::make_unique<Haplotype>(region, reference)}
+: result_ {std::make_shared<Haplotype>(region, reference)}
+{}
+
+ReferenceContext::ReferenceContext(std::shared_ptr<const Haplotype> context)
+: result_ {std::move(context)}
 {}
 
 Facet::ResultType ReferenceContext::do_get() const
@@ -25,11 +25,12 @@ public:
     ReferenceContext() = default;
     
     ReferenceContext(const ReferenceGenome& reference, GenomicRegion region);
+    ReferenceContext(std::shared_ptr<const Haplotype> context);
     
 private:
     static const std::string name_;
     
-    std::unique_ptr<Haplotype> result_;
+    std::shared_ptr<const Haplotype> result_;
     
     const std::string& do_name() const noexcept override { return name_; }
     Facet::ResultType do_get() const override;
@@ -0,0 +1,39 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "tandem_repeats.hpp"
+
+#include "utils/repeat_finder.hpp"
+#include "utils/tandem_repeat_index.hpp"
+
+namespace octopus { namespace csr {
+
+const std::string TandemRepeats::name_ {"TandemRepeats"};
+
+constexpr unsigned TandemRepeats::maxPeriod;
+
+namespace {
+
+std::vector<TandemRepeat> find_repeats(const ReferenceGenome& reference, const Haplotype& context)
+{
+    const auto& region = context.mapped_region();
+    const auto index = reference.tandem_repeat_index();
+    if (index && index->max_period() >= TandemRepeats::maxPeriod && index->has_contig(region.contig_name())) {
+        return index->fetch(reference, region, TandemRepeats::maxPeriod);
+    }
+    return find_exact_tandem_repeats(context.sequence(), region, 1, TandemRepeats::maxPeriod);
+}
+
+} // namespace
+
+TandemRepeats::TandemRepeats(const ReferenceGenome& reference, const Haplotype& context)
+: repeats_ {find_repeats(reference, context)}
+{}
+
+Facet::ResultType TandemRepeats::do_get() const
+{
+    return std::cref(repeats_);
+}
+
+} // namespace csr
+} // namespace octopus
@@ -0,0 +1,43 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef tandem_repeats_hpp
+#define tandem_repeats_hpp
+
+#include <vector>
+#include <string>
+#include <functional>
+
+#include "basics/tandem_repeat.hpp"
+#include "core/types/haplotype.hpp"
+#include "io/reference/reference_genome.hpp"
+#include "facet.hpp"
+
+namespace octopus { namespace csr {
+
+// The exact tandem repeats in a block's reference context, found once per block rather than per call.
+// Repeats are sorted and looked up in the reference's tandem repeat index when it has long enough periods.
+class TandemRepeats : public Facet
+{
+public:
+    using ResultType = std::reference_wrapper<const std::vector<TandemRepeat>>;
+    
+    static constexpr unsigned maxPeriod {20};
+    
+    TandemRepeats() = default;
+    
+    TandemRepeats(const ReferenceGenome& reference, const Haplotype& context);
+    
+private:
+    static const std::string name_;
+    
+    std::vector<TandemRepeat> repeats_;
+    
+    const std::string& do_name() const noexcept override { return name_; }
+    Facet::ResultType do_get() const override;
+};
+
+} // namespace csr
+} // namespace octopus
+
+#endif
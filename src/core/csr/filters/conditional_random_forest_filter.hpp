@@ -7,16 +7,16 @@
 #include <vector>
 #include <cstddef>
 #include <memory>
-#include <fstream>
+#include <deque>
+#include <utility>
 #include <functional>
 #include <cstddef>
 
 #include <boost/optional.hpp>
 #include <boost/filesystem.hpp>
 
-#include "ranger/Forest.h"
-
 #include "double_pass_variant_call_filter.hpp"
+#include "flat_random_forest.hpp"
 
 namespace octopus { namespace csr {
 
@@ -48,24 +48,19 @@ protected:
     virtual void annotate(VcfHeader::Builder& header) const override;
     
 private:
-    struct File
+    struct ForestData
     {
-        std::ofstream handle;
-        Path path;
-        template <typename F, typename P>
-        File(F&& handle, P&& path) : handle {std::forward<F>(handle)}, path {std::forward<P>(path)} {};
+        std::vector<double> rows; // row-major measures
+        std::vector<std::pair<std::size_t, std::size_t>> targets; // (call, sample) for each row
     };
     
-    std::vector<Path> forest_paths_;
-    Path temp_dir_;
-    std::vector<std::unique_ptr<ranger::Forest>> forests_;
+    std::vector<FlatRandomForest> forests_;
     std::function<std::int8_t(std::vector<Measure::ResultType>)> chooser_;
     std::size_t num_chooser_measures_;
     
-    mutable std::vector<std::vector<File>> data_;
-    mutable std::size_t num_records_;
-    mutable std::vector<std::vector<std::vector<double>>> data_buffer_;
-    mutable std::vector<std::deque<std::int8_t>> choices_;
+    mutable std::vector<ForestData> data_;
+    mutable std::size_t num_samples_, num_records_;
+    mutable std::vector<std::vector<double>> predictions_;
     mutable std::deque<std::size_t> hard_filtered_record_indices_;
     mutable std::vector<bool> hard_filtered_;
     
@@ -75,9 +70,7 @@ private:
     std::int8_t choose_forest(const MeasureVector& measures) const;
     void prepare_for_registration(const SampleList& samples) const override;
     void record(std::size_t call_idx, std::size_t sample_idx, MeasureVector measures) const override;
-    void close_data_files() const;
     void prepare_for_classification(boost::optional<Log>& log) const override;
-    std::size_t get_forest_choice(std::size_t call_idx, std::size_t sample_idx) const;
     Classification classify(std::size_t call_idx, std::size_t sample_idx) const override;
 };
 
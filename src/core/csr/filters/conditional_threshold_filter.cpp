@@ -46,6 +46,7 @@ ConditionalThresholdVariantCallFilter::ConditionalThresholdVariantCallFilter(Fac
 , num_chooser_measures_ {chooser_measures.size()}
 {
     measures_.shrink_to_fit();
+    facet_free_hard_conditions_.clear(); // the hard conditions that apply depend on the chosen filter
     hard_ranges_.reserve(conditions.size());
     soft_ranges_.reserve(conditions.size());
     unique_filter_keys_.reserve(conditions.size());
@@ -0,0 +1,174 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "flat_random_forest.hpp"
+
+#include <array>
+#include <deque>
+#include <iterator>
+#include <algorithm>
+#include <utility>
+#include <memory>
+#include <string>
+#include <stdexcept>
+#include <cassert>
+
+#include "ranger/ForestProbability.h"
+#include "ranger/DataDouble.h"
+
+namespace octopus { namespace csr {
+
+namespace {
+
+// Exposes forest loading so a pretrained forest can be read without a data file
+class LoadableForest : public ranger::ForestProbability
+{
+public:
+    using ranger::Forest::loadFromFile;
+};
+
+void load(LoadableForest& forest, const boost::filesystem::path& ranger_forest, const std::size_t num_features)
+{
+    std::vector<std::string> variable_names(num_features + 1);
+    for (std::size_t i {0}; i < num_features; ++i) variable_names[i] = std::to_string(i);
+    variable_names.back() = "TP";
+    const auto num_cols = variable_names.size();
+    auto data = std::make_unique<ranger::DataDouble>(std::vector<double>(num_cols), std::move(variable_names), 1, num_cols);
+    std::vector<std::string> cat_vars {};
+    std::vector<double> sample_fraction {1.0};
+    forest.init("TP", ranger::MemoryMode::MEM_DOUBLE, std::move(data), 0, "", 1, 12, 1,
+                ranger::ImportanceMode::IMP_GINI, 1, "", true, true, cat_vars, false, ranger::SplitRule::LOGRANK,
+                false, sample_fraction, ranger::DEFAULT_ALPHA, ranger::DEFAULT_MINPROP, false,
+                ranger::PredictionType::RESPONSE, ranger::DEFAULT_NUM_RANDOM_SPLITS, false);
+    forest.loadFromFile(ranger_forest.string());
+}
+
+} // namespace
+
+FlatRandomForest::FlatRandomForest(const Path& ranger_forest, const std::size_t num_features, const double positive_class)
+: features_ {}
+, lhs_children_ {}
+, rhs_children_ {}
+, thresholds_ {}
+, leaf_values_ {}
+, trees_ {}
+, num_features_ {num_features}
+{
+    LoadableForest forest {};
+    load(forest, ranger_forest, num_features);
+    const auto& is_ordered = forest.getIsOrderedVariable();
+    if (std::find(std::cbegin(is_ordered), std::cend(is_ordered), false) != std::cend(is_ordered)) {
+        throw std::runtime_error {"FlatRandomForest: unordered variables are not supported"};
+    }
+    const auto& class_values = forest.getClassValues();
+    const auto positive_itr = std::find(std::cbegin(class_values), std::cend(class_values), positive_class);
+    const auto positive_idx = static_cast<std::size_t>(std::distance(std::cbegin(class_values), positive_itr));
+    const auto child_ids = forest.getChildNodeIDs();
+    const auto split_var_ids = forest.getSplitVarIDs();
+    const auto split_values = forest.getSplitValues();
+    const auto terminal_class_counts = forest.getTerminalClassCounts();
+    const auto num_trees = child_ids.size();
+    std::size_t num_nodes {0};
+    for (const auto& tree : child_ids) num_nodes += tree[0].size();
+    features_.reserve(num_nodes);
+    lhs_children_.reserve(num_nodes);
+    rhs_children_.reserve(num_nodes);
+    thresholds_.reserve(num_nodes);
+    leaf_values_.reserve(num_nodes);
+    trees_.reserve(num_trees);
+    std::deque<std::pair<std::size_t, std::uint32_t>> queue {}; // (ranger node, level)
+    for (std::size_t tree_idx {0}; tree_idx < num_trees; ++tree_idx) {
+        const auto& lhs_children = child_ids[tree_idx][0];
+        const auto& rhs_children = child_ids[tree_idx][1];
+        Tree tree {static_cast<std::uint32_t>(features_.size()), 0};
+        // Breadth-first, so children are numbered in the order they are queued
+        std::uint32_t next_node {1};
+        queue.assign({{0, 0}});
+        while (!queue.empty()) {
+            const auto ranger_id = queue.front().first;
+            const auto level = queue.front().second;
+            queue.pop_front();
+            const auto node = static_cast<std::uint32_t>(features_.size() - tree.offset);
+            if (lhs_children[ranger_id] == 0 && rhs_children[ranger_id] == 0) {
+                const auto& counts = terminal_class_counts[tree_idx][ranger_id];
+                features_.push_back(0);
+                thresholds_.push_back(0);
+                lhs_children_.push_back(node);
+                rhs_children_.push_back(node);
+                leaf_values_.push_back(positive_idx < counts.size() ? 1.0 - counts[positive_idx] : 1.0);
+                tree.depth = std::max(tree.depth, level);
+            } else {
+                const auto feature = split_var_ids[tree_idx][ranger_id];
+                if (feature >= num_features_) {
+                    throw std::runtime_error {"FlatRandomForest: forest splits on unknown variable"};
+                }
+                features_.push_back(feature);
+                thresholds_.push_back(split_values[tree_idx][ranger_id]);
+                lhs_children_.push_back(next_node++);
+                rhs_children_.push_back(next_node++);
+                leaf_values_.push_back(0);
+                queue.emplace_back(lhs_children[ranger_id], level + 1);
+                queue.emplace_back(rhs_children[ranger_id], level + 1);
+            }
+        }
+        trees_.push_back(tree);
+    }
+}
+
+std::size_t FlatRandomForest::num_features() const noexcept
+{
+    return num_features_;
+}
+
+std::size_t FlatRandomForest::num_trees() const noexcept
+{
+    return trees_.size();
+}
+
+template <std::size_t N>
+void FlatRandomForest::score_lane(const Tree& tree, const double* rows, double* result) const noexcept
+{
+    const auto features = features_.data() + tree.offset;
+    const auto thresholds = thresholds_.data() + tree.offset;
+    const auto lhs_children = lhs_children_.data() + tree.offset;
+    const auto rhs_children = rhs_children_.data() + tree.offset;
+    std::array<std::uint32_t, N> nodes {};
+    // Leaves are their own children, so rows that reach a leaf early just stay there
+    for (std::uint32_t level {0}; level < tree.depth; ++level) {
+        for (std::size_t i {0}; i < N; ++i) {
+            const auto node = nodes[i];
+            const auto value = rows[i * num_features_ + features[node]];
+            nodes[i] = value <= thresholds[node] ? lhs_children[node] : rhs_children[node];
+        }
+    }
+    const auto leaf_values = leaf_values_.data() + tree.offset;
+    for (std::size_t i {0}; i < N; ++i) {
+        result[i] += leaf_values[nodes[i]];
+    }
+}
+
+std::vector<double> FlatRandomForest::predict_negative(const std::vector<double>& rows) const
+{
+    static constexpr std::size_t lane_size {8};
+    assert(num_features_ > 0 && rows.size() % num_features_ == 0);
+    const auto num_rows = rows.size() / num_features_;
+    std::vector<double> result(num_rows, 0.0);
+    if (trees_.empty()) return result;
+    const auto num_full_lane_rows = num_rows - num_rows % lane_size;
+    // Trees are the outer loop so each tree stays in cache while the whole batch is pushed through it
+    for (const auto& tree : trees_) {
+        std::size_t row_idx {0};
+        for (; row_idx < num_full_lane_rows; row_idx += lane_size) {
+            score_lane<lane_size>(tree, rows.data() + row_idx * num_features_, result.data() + row_idx);
+        }
+        for (; row_idx < num_rows; ++row_idx) {
+            score_lane<1>(tree, rows.data() + row_idx * num_features_, result.data() + row_idx);
+        }
+    }
+    const auto num_trees = static_cast<double>(trees_.size());
+    for (auto& p : result) p /= num_trees;
+    return result;
+}
+
+} // namespace csr
+} // namespace octopus
@@ -0,0 +1,62 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef flat_random_forest_hpp
+#define flat_random_forest_hpp
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include <boost/filesystem/path.hpp>
+
+namespace octopus { namespace csr {
+
+// A read-only copy of a trained ranger probability forest laid out for batch scoring. Each tree is stored
+// breadth-first in flat structure-of-arrays node tables, and leaves point back to themselves so every row
+// can be pushed through a tree for a fixed number of steps with no data dependent branches. Rows are scored
+// in lanes that advance through a tree in lockstep, which lets the compiler vectorise the traversal.
+class FlatRandomForest
+{
+public:
+    using Path = boost::filesystem::path;
+    
+    FlatRandomForest() = delete;
+    
+    // num_features is the number of independent variables the forest was trained on. The forest must have
+    // been trained with the dependent variable as the last column.
+    FlatRandomForest(const Path& ranger_forest, std::size_t num_features, double positive_class = 1);
+    
+    FlatRandomForest(const FlatRandomForest&)            = default;
+    FlatRandomForest& operator=(const FlatRandomForest&) = default;
+    FlatRandomForest(FlatRandomForest&&)                 = default;
+    FlatRandomForest& operator=(FlatRandomForest&&)      = default;
+    
+    ~FlatRandomForest() = default;
+    
+    std::size_t num_features() const noexcept;
+    std::size_t num_trees() const noexcept;
+    
+    // Returns the probability each row does not belong to the positive class. rows is row-major with
+    // num_features() columns.
+    std::vector<double> predict_negative(const std::vector<double>& rows) const;
+    
+private:
+    struct Tree
+    {
+        std::uint32_t offset, depth;
+    };
+    
+    std::vector<std::uint32_t> features_, lhs_children_, rhs_children_; // children are tree relative
+    std::vector<double> thresholds_, leaf_values_; // leaf values are negative class probabilities
+    std::vector<Tree> trees_;
+    std::size_t num_features_;
+    
+    template <std::size_t N>
+    void score_lane(const Tree& tree, const double* rows, double* result) const noexcept;
+};
+
+} // namespace csr
+} // namespace octopus
+
+#endif
@@ -5,23 +5,21 @@
 #define random_forest_filter_hpp
 
 #include <vector>
-#include <cstddef>
-#include <memory>
-#include <fstream>
+#include <string>
 
 #include <boost/optional.hpp>
-#include <boost/filesystem.hpp>
+#include <boost/filesystem/path.hpp>
 
-#include "ranger/Forest.h"
-
-#include "double_pass_variant_call_filter.hpp"
+#include "single_pass_variant_call_filter.hpp"
+#include "logging/progress_meter.hpp"
+#include "flat_random_forest.hpp"
 
 namespace octopus { namespace csr {
 
-class RandomForestFilter : public DoublePassVariantCallFilter
+class RandomForestFilter : public SinglePassVariantCallFilter
 {
 public:
-    using DoublePassVariantCallFilter::Path;
+    using Path = boost::filesystem::path;
     
     RandomForestFilter() = delete;
     
@@ -30,7 +28,6 @@ public:
                        OutputOptions output_config,
                        ConcurrencyPolicy threading,
                        Path ranger_forest,
-                       Path temp_directory = "/tmp",
                        boost::optional<ProgressMeter&> progress = boost::none);
     
     RandomForestFilter(const RandomForestFilter&)            = delete;
@@ -41,29 +38,16 @@ public:
     virtual ~RandomForestFilter() override = default;
 
 private:
-    struct File
-    {
-        std::ofstream handle;
-        Path path;
-        template <typename F, typename P>
-        File(F&& handle, P&& path) : handle {std::forward<F>(handle)}, path {std::forward<P>(path)} {};
-    };
-    
-    std::unique_ptr<ranger::Forest> forest_;
-    Path ranger_forest_, temp_dir_;
-    
-    mutable std::vector<File> data_;
-    mutable std::size_t num_records_;
-    mutable std::vector<std::vector<double>> data_buffer_;
+    FlatRandomForest forest_;
     
     const static std::string call_qual_name_;
     
     boost::optional<std::string> genotype_quality_name() const override;
     void annotate(VcfHeader::Builder& header) const override;
-    void prepare_for_registration(const SampleList& samples) const override;
-    void record(std::size_t call_idx, std::size_t sample_idx, MeasureVector measures) const override;
-    void prepare_for_classification(boost::optional<Log>& log) const override;
-    Classification classify(std::size_t call_idx, std::size_t sample_idx) const override;
+    Classification classify(const MeasureVector& measures) const override;
+    std::vector<ClassificationList> classify(const MeasureBlock& block_measures, const SampleList& samples) const override;
+    void add_row(const MeasureVector& measures, std::vector<double>& rows) const;
+    Classification make_classification(double prob_false) const;
 };
 
 } // namespace csr
@@ -76,7 +76,7 @@ RandomForestFilterFactory::do_make(FacetFactory facet_factory,
             case ForestType::germline:
             default:
                 return std::make_unique<RandomForestFilter>(std::move(facet_factory), measures_, output_config, threading,
-                                                            ranger_forests_[0], temp_directory_, progress);
+                                                            ranger_forests_[0], progress);
         }
     } else {
         assert(ranger_forests_.size() == 2);
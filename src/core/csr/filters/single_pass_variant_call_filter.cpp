@@ -7,6 +7,9 @@
 #include <utility>
 #include <iterator>
 #include <algorithm>
+#include <atomic>
+#include <future>
+#include <exception>
 #include <cassert>
 
 #include <boost/range/combine.hpp>
@@ -23,8 +26,15 @@ SinglePassVariantCallFilter::SinglePassVariantCallFilter(FacetFactory facet_fact
                                                          boost::optional<ProgressMeter&> progress)
 : VariantCallFilter {std::move(facet_factory), measures, std::move(output_config), threading}
 , progress_ {progress}
+, current_contig_ {}
+, filtering_contigs_ {false}
 {}
 
+bool SinglePassVariantCallFilter::can_filter_contigs_concurrently() const noexcept
+{
+    return can_measure_single_call() && max_concurrent_contigs() > 1;
+}
+
 void SinglePassVariantCallFilter::filter(const VcfReader& source, VcfWriter& dest, const VcfHeader& dest_header) const
 {
     assert(dest.is_header_written());
@@ -45,22 +55,115 @@ void SinglePassVariantCallFilter::filter(const VcfReader& source, VcfWriter& des
     if (progress_) progress_->stop();
 }
 
+void SinglePassVariantCallFilter::filter_in_memory(const CallBlock& calls, VcfWriter& dest, const VcfHeader& dest_header,
+                                                   const SampleList& samples) const
+{
+    assert(std::is_sorted(std::cbegin(calls), std::cend(calls)));
+    if (can_measure_multiple_blocks()) {
+        for (auto first = std::cbegin(calls); first != std::cend(calls);) {
+            filter(read_next_blocks(first, std::cend(calls), samples), dest, dest_header, samples);
+        }
+    } else if (can_measure_single_call()) {
+        for (const auto& call : calls) filter(call, dest, dest_header, samples);
+    } else {
+        for (auto first = std::cbegin(calls); first != std::cend(calls);) {
+            filter(read_next_block(first, std::cend(calls), samples), dest, dest_header, samples);
+        }
+    }
+}
+
+void SinglePassVariantCallFilter::filter_contigs(const VcfReader::Path& source, const std::vector<GenomicRegion::ContigName>& contigs,
+                                                 std::vector<VcfWriter>& dests, const VcfHeader& dest_header) const
+{
+    if (progress_) progress_->start();
+    const auto samples = dest_header.samples();
+    std::atomic<std::size_t> next_contig_idx {0};
+    const auto filter_remaining_contigs = [&] () {
+        for (auto idx = next_contig_idx++; idx < contigs.size(); idx = next_contig_idx++) {
+            const VcfReader reader {source};
+            filter(reader, contigs[idx], dests[idx], dest_header, samples);
+        }
+    };
+    const auto num_threads = std::min(static_cast<std::size_t>(max_concurrent_contigs()), contigs.size());
+    filtering_contigs_ = true;
+    std::vector<std::future<void>> threads {};
+    threads.reserve(num_threads);
+    for (std::size_t i {0}; i < num_threads; ++i) {
+        threads.push_back(std::async(std::launch::async, filter_remaining_contigs));
+    }
+    std::exception_ptr error {};
+    for (auto& thread : threads) {
+        try {
+            thread.get();
+        } catch (...) {
+            if (!error) error = std::current_exception();
+        }
+    }
+    filtering_contigs_ = false;
+    if (error) std::rethrow_exception(error);
+    if (progress_) progress_->stop();
+}
+
+void SinglePassVariantCallFilter::filter(const VcfReader& source, const GenomicRegion::ContigName& contig, VcfWriter& dest,
+                                         const VcfHeader& dest_header, const SampleList& samples) const
+{
+    auto p = source.iterate(contig);
+    std::for_each(std::move(p.first), std::move(p.second), [&] (const VcfRecord& call) { filter(call, dest, dest_header, samples); });
+    if (progress_) progress_->log_completed(contig);
+}
+
 void SinglePassVariantCallFilter::filter(const VcfRecord& call, VcfWriter& dest, const VcfHeader& dest_header, const SampleList& samples) const
 {
-    filter(call, measure(call), dest, dest_header, samples);
+    if (is_hard_filtered_without_facets(call, samples)) {
+        log_progress(mapped_region(call));
+    } else {
+        filter(call, measure(call), dest, dest_header, samples);
+    }
 }
 
 void SinglePassVariantCallFilter::filter(const CallBlock& block, VcfWriter& dest, const VcfHeader& dest_header, const SampleList& samples) const
 {
-    filter(block, measure(block), dest, dest_header, samples);
+    // Facets still come from the whole block so the remaining calls are measured exactly as before
+    const auto calls = remove_hard_filtered_without_facets(block, samples);
+    if (calls) {
+        filter(*calls, measure(block, *calls), dest, dest_header, samples);
+    } else {
+        filter(block, measure(block), dest, dest_header, samples);
+    }
 }
 
 void SinglePassVariantCallFilter::filter(const std::vector<CallBlock>& blocks, VcfWriter& dest, const VcfHeader& dest_header, const SampleList& samples) const
 {
-    const auto measures = measure(blocks);
-    assert(measures.size() == blocks.size());
-    for (auto tup : boost::combine(blocks, measures)) {
-        filter(tup.get<0>(), tup.get<1>(), dest, dest_header, samples);
+    std::vector<boost::optional<CallBlock>> block_calls {};
+    block_calls.reserve(blocks.size());
+    for (const auto& block : blocks) {
+        block_calls.push_back(remove_hard_filtered_without_facets(block, samples));
+    }
+    if (std::none_of(std::cbegin(block_calls), std::cend(block_calls), [] (const auto& calls) { return calls.is_initialized(); })) {
+        const auto measures = measure(blocks);
+        assert(measures.size() == blocks.size());
+        for (auto tup : boost::combine(blocks, measures)) {
+            filter(tup.get<0>(), tup.get<1>(), dest, dest_header, samples);
+        }
+    } else {
+        // Blocks with no remaining calls need no facets at all
+        std::vector<CallBlock> measured_blocks {}, measured_calls {};
+        measured_blocks.reserve(blocks.size());
+        measured_calls.reserve(blocks.size());
+        for (std::size_t block_idx {0}; block_idx < blocks.size(); ++block_idx) {
+            if (!block_calls[block_idx]) {
+                measured_blocks.push_back(blocks[block_idx]);
+                measured_calls.push_back(blocks[block_idx]);
+            } else if (!block_calls[block_idx]->empty()) {
+                measured_blocks.push_back(blocks[block_idx]);
+                measured_calls.push_back(std::move(*block_calls[block_idx]));
+            }
+        }
+        const auto measures = measure(measured_blocks, measured_calls);
+        assert(measures.size() == measured_calls.size());
+        for (auto tup : boost::combine(measured_calls, measures)) {
+            filter(tup.get<0>(), tup.get<1>(), dest, dest_header, samples);
+        }
     }
 }
 
@@ -68,15 +171,23 @@ void SinglePassVariantCallFilter::filter(const CallBlock& block, const MeasureBl
                                          const VcfHeader& dest_header, const SampleList& samples) const
 {
     assert(measures.size() == block.size());
-    for (auto tup : boost::combine(block, measures)) {
-        filter(tup.get<0>(), tup.get<1>(), dest, dest_header, samples);
+    const auto classifications = classify(measures, samples);
+    assert(classifications.size() == block.size());
+    for (std::size_t i {0}; i < block.size(); ++i) {
+        filter(block[i], measures[i], classifications[i], dest, dest_header, samples);
     }
 }
 
 void SinglePassVariantCallFilter::filter(const VcfRecord& call, const MeasureVector& measures, VcfWriter& dest,
                                          const VcfHeader& dest_header, const SampleList& samples) const
 {
-    const auto sample_classifications = classify(measures, samples);
+    filter(call, measures, classify(measures, samples), dest, dest_header, samples);
+}
+
+void SinglePassVariantCallFilter::filter(const VcfRecord& call, const MeasureVector& measures,
+                                         const ClassificationList& sample_classifications,
+                                         VcfWriter& dest, const VcfHeader& dest_header, const SampleList& samples) const
+{
     const auto call_classification = merge(sample_classifications, measures);
     if (measure_annotations_requested()) {
         VcfRecord::Builder annotation_builder {call};
@@ -98,6 +209,40 @@ SinglePassVariantCallFilter::classify(const MeasureVector& call_measures, const
     return result;
 }
 
+std::vector<VariantCallFilter::ClassificationList>
+SinglePassVariantCallFilter::classify(const MeasureBlock& block_measures, const SampleList& samples) const
+{
+    std::vector<ClassificationList> result {};
+    result.reserve(block_measures.size());
+    for (const auto& call_measures : block_measures) {
+        result.push_back(classify(call_measures, samples));
+    }
+    return result;
+}
+
+bool SinglePassVariantCallFilter::is_hard_filtered_without_facets(const VcfRecord& call, const SampleList& samples) const
+{
+    return false;
+}
+
+boost::optional<VariantCallFilter::CallBlock>
+SinglePassVariantCallFilter::remove_hard_filtered_without_facets(const CallBlock& block, const SampleList& samples) const
+{
+    const auto is_filtered = [&] (const VcfRecord& call) { return is_hard_filtered_without_facets(call, samples); };
+    auto first_filtered = std::find_if(std::cbegin(block), std::cend(block), is_filtered);
+    if (first_filtered == std::cend(block)) return boost::none;
+    CallBlock result {std::cbegin(block), first_filtered};
+    result.reserve(block.size());
+    for (auto itr = first_filtered; itr != std::cend(block); ++itr) {
+        if (itr == first_filtered || is_filtered(*itr)) {
+            log_progress(mapped_region(*itr));
+        } else {
+            result.push_back(*itr);
+        }
+    }
+    return result;
+}
+
 static auto expand_lhs_to_zero(const GenomicRegion& region)
 {
     return GenomicRegion {region.contig_name(), 0, region.end()};
@@ -106,6 +251,11 @@ static auto expand_lhs_to_zero(const GenomicRegion& region)
 void SinglePassVariantCallFilter::log_progress(const GenomicRegion& region) const
 {
     if (progress_) {
+        if (filtering_contigs_) {
+            // Each contig is marked completed when its thread finishes
+            progress_->log_completed(expand_lhs_to_zero(region));
+            return;
+        }
         if (current_contig_) {
             if (*current_contig_ != region.contig_name()) {
                 progress_->log_completed(*current_contig_);
@@ -32,22 +32,41 @@ public:
     
     virtual ~SinglePassVariantCallFilter() override = default;
     
+    bool can_filter_in_memory() const noexcept override { return true; }
+    // Only calls that need no facets can be filtered concurrently, as facets share one read pipe
+    bool can_filter_contigs_concurrently() const noexcept override;
+    
 protected:
     std::vector<std::string> measure_names_;
     
 private:
     boost::optional<ProgressMeter&> progress_;
     mutable boost::optional<GenomicRegion::ContigName> current_contig_;
+    mutable bool filtering_contigs_;
     
     virtual Classification classify(const MeasureVector& call_measures) const = 0;
+    // Classifies every sample of every call in a block at once. The default classifies each call separately.
+    virtual std::vector<ClassificationList> classify(const MeasureBlock& block_measures, const SampleList& samples) const;
+    // Returns true if the call is certain to be hard filtered using only measures that need no facets. Hard filtered
+    // calls are never written, so these calls can skip facet and measure evaluation. The default never skips calls.
+    virtual bool is_hard_filtered_without_facets(const VcfRecord& call, const SampleList& samples) const;
     
     void filter(const VcfReader& source, VcfWriter& dest, const VcfHeader& dest_header) const override;
+    void filter_in_memory(const CallBlock& calls, VcfWriter& dest, const VcfHeader& dest_header, const SampleList& samples) const override;
+    void filter_contigs(const VcfReader::Path& source, const std::vector<GenomicRegion::ContigName>& contigs,
+                        std::vector<VcfWriter>& dests, const VcfHeader& dest_header) const override;
+    void filter(const VcfReader& source, const GenomicRegion::ContigName& contig, VcfWriter& dest,
+                const VcfHeader& dest_header, const SampleList& samples) const;
     void filter(const VcfRecord& call, VcfWriter& dest, const VcfHeader& dest_header, const SampleList& samples) const;
     void filter(const CallBlock& block, VcfWriter& dest, const VcfHeader& dest_header, const SampleList& samples) const;
     void filter(const std::vector<CallBlock>& blocks, VcfWriter& dest, const VcfHeader& dest_header, const SampleList& samples) const;
     void filter(const CallBlock& block, const MeasureBlock & measures, VcfWriter& dest, const VcfHeader& dest_header, const SampleList& samples) const;
     void filter(const VcfRecord& call, const MeasureVector& measures, VcfWriter& dest, const VcfHeader& dest_header, const SampleList& samples) const;
+    void filter(const VcfRecord& call, const MeasureVector& measures, const ClassificationList& sample_classifications,
+                VcfWriter& dest, const VcfHeader& dest_header, const SampleList& samples) const;
     ClassificationList classify(const MeasureVector& call_measures, const SampleList& samples) const;
+    // Returns none if no calls are removed
+    boost::optional<CallBlock> remove_hard_filtered_without_facets(const CallBlock& block, const SampleList& samples) const;
     void log_progress(const GenomicRegion& region) const;
 };
 
@@ -4,7 +4,6 @@
 #include "threshold_filter.hpp"
 
 #include <utility>
-#include <numeric>
 #include <functional>
 #include <iterator>
 #include <algorithm>
@@ -62,6 +61,15 @@ bool are_all_unique(std::vector<std::string> keys)
     return std::adjacent_find(std::cbegin(keys), std::cend(keys)) == std::cend(keys);
 }
 
+auto find_facet_free_conditions(const std::vector<MeasureWrapper>& measures, const std::size_t num_conditions)
+{
+    std::vector<std::size_t> result {};
+    for (std::size_t i {0}; i < num_conditions; ++i) {
+        if (measures[i].requirements().empty()) result.push_back(i);
+    }
+    return result;
+}
+
 } // namespace
 
 ThresholdVariantCallFilter::ThresholdVariantCallFilter(FacetFactory facet_factory,
@@ -77,13 +85,16 @@ ThresholdVariantCallFilter::ThresholdVariantCallFilter(FacetFactory facet_factor
 , soft_thresholds_ {extract_thresholds(conditions.soft)}
 , vcf_filter_keys_ {extract_vcf_filter_keys(conditions.soft)}
 , all_unique_filter_keys_ {are_all_unique(vcf_filter_keys_)}
+, facet_free_hard_conditions_ {find_facet_free_conditions(measures_, hard_thresholds_.size())}
 {}
 
 bool ThresholdVariantCallFilter::passes_all_filters(MeasureIterator first_measure, MeasureIterator last_measure,
                                                     ThresholdIterator first_threshold) const
 {
-    return std::inner_product(first_measure, last_measure, first_threshold, true, std::multiplies<> {},
-                              [] (const auto& measure, const auto& threshold) -> bool { return threshold(measure); });
+    for (; first_measure != last_measure; ++first_measure, ++first_threshold) {
+        if (!(*first_threshold)(*first_measure)) return false;
+    }
+    return true;
 }
 
 void ThresholdVariantCallFilter::annotate(VcfHeader::Builder& header) const
@@ -96,16 +107,38 @@ void ThresholdVariantCallFilter::annotate(VcfHeader::Builder& header) const
 VariantCallFilter::Classification ThresholdVariantCallFilter::classify(const MeasureVector& measures) const
 {
     if (passes_all_hard_filters(measures)) {
-        if (passes_all_soft_filters(measures)) {
+        // Soft thresholds are evaluated once; a call passes them exactly when none of their keys fail
+        auto failing_keys = get_failing_vcf_filter_keys(measures);
+        if (failing_keys.empty()) {
             return Classification {Classification::Category::unfiltered};
         } else {
-            return Classification {Classification::Category::soft_filtered, get_failing_vcf_filter_keys(measures)};
+            return Classification {Classification::Category::soft_filtered, std::move(failing_keys)};
         }
     } else {
         return Classification {Classification::Category::hard_filtered};
     }
 }
 
+bool ThresholdVariantCallFilter::is_hard_filtered_without_facets(const VcfRecord& call, const SampleList& samples) const
+{
+    if (facet_free_hard_conditions_.empty() || samples.empty()) return false;
+    MeasureVector values {};
+    values.reserve(facet_free_hard_conditions_.size());
+    for (auto condition_idx : facet_free_hard_conditions_) {
+        values.push_back(measures_[condition_idx](call));
+    }
+    // A call is hard filtered only when every sample is
+    for (std::size_t sample_idx {0}; sample_idx < samples.size(); ++sample_idx) {
+        bool sample_passes {true};
+        for (std::size_t i {0}; i < values.size() && sample_passes; ++i) {
+            const auto condition_idx = facet_free_hard_conditions_[i];
+            sample_passes = hard_thresholds_[condition_idx](get_sample_value(values[i], measures_[condition_idx], sample_idx));
+        }
+        if (sample_passes) return false;
+    }
+    return true;
+}
+
 bool ThresholdVariantCallFilter::passes_all_hard_filters(const MeasureVector& measures) const
 {
     return passes_all_filters(std::cbegin(measures), std::next(std::cbegin(measures), hard_thresholds_.size()),
@@ -81,6 +81,8 @@ protected:
     ThresholdVector hard_thresholds_, soft_thresholds_;
     std::vector<std::string> vcf_filter_keys_;
     bool all_unique_filter_keys_;
+    // Indices of the hard conditions whose measures need no facets
+    std::vector<std::size_t> facet_free_hard_conditions_;
     
     bool passes_all_filters(MeasureIterator first_measure, MeasureIterator last_measure,
                             ThresholdIterator first_threshold) const;
@@ -88,6 +90,7 @@ protected:
 private:
     virtual void annotate(VcfHeader::Builder& header) const override;
     virtual Classification classify(const MeasureVector& measures) const override;
+    virtual bool is_hard_filtered_without_facets(const VcfRecord& call, const SampleList& samples) const override;
     
     virtual bool passes_all_hard_filters(const MeasureVector& measures) const;
     virtual bool passes_all_soft_filters(const MeasureVector& measures) const;
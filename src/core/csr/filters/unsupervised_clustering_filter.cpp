@@ -7,6 +7,16 @@
 #include <iterator>
 #include <algorithm>
 #include <numeric>
+#include <functional>
+#include <stdexcept>
+#include <cmath>
+#include <cassert>
+
+#include <boost/variant.hpp>
+#include <boost/any.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include "utils/k_medoids.hpp"
 
 namespace octopus { namespace csr {
 
@@ -16,6 +26,11 @@ UnsupervisedClusteringFilter::UnsupervisedClusteringFilter(FacetFactory facet_fa
                                                            ConcurrencyPolicy threading,
                                                            boost::optional<ProgressMeter&> progress)
 : DoublePassVariantCallFilter {std::move(facet_factory), std::move(measures), std::move(output_config), threading, "/tmp", progress}
+, data_ {}
+, num_features_ {measures_.size()}
+, present_features_(num_features_, false)
+, cluster_assignments_ {}
+, classifications_ {}
 {}
 
 void UnsupervisedClusteringFilter::annotate(VcfHeader::Builder& header) const
@@ -23,28 +38,83 @@ void UnsupervisedClusteringFilter::annotate(VcfHeader::Builder& header) const
     // TODO
 }
 
+namespace {
+
+static constexpr double missing_value {-1};
+
+template <typename T>
+double lexical_cast_to_double(const T& value)
+{
+    auto result = boost::lexical_cast<double>(value);
+    if (std::fpclassify(result) == FP_SUBNORMAL) {
+        result = 0;
+    }
+    return result;
+}
+
+struct MeasureDoubleVisitor : boost::static_visitor<>
+{
+    double result;
+    template <typename T> void operator()(const T& value)
+    {
+        result = lexical_cast_to_double(value);
+    }
+    template <typename T> void operator()(const boost::optional<T>& value)
+    {
+        if (value) {
+            (*this)(*value);
+        } else {
+            result = missing_value;
+        }
+    }
+    template <typename T> void operator()(const std::vector<T>& values)
+    {
+        throw std::runtime_error {"Vector cast not supported"};
+    }
+    void operator()(boost::any value)
+    {
+        throw std::runtime_error {"Any cast not supported"};
+    }
+};
+
+auto cast_to_double(const Measure::ResultType& value)
+{
+    MeasureDoubleVisitor vis {};
+    boost::apply_visitor(vis, value);
+    return vis.result;
+}
+
+} // namespace
+
 void UnsupervisedClusteringFilter::record(const std::size_t call_idx, std::size_t sample_idx, MeasureVector measures) const
 {
-    if (data_.size() == call_idx) {
-        data_.push_back(std::move(measures));
-    } else if (call_idx > data_.size()) {
-        data_.resize(call_idx + 1);
-        data_.back() = std::move(measures);
-    } else {
-        data_[call_idx] = std::move(measures);
+    assert(measures.size() == num_features_);
+    if (num_records() <= call_idx) {
+        data_.resize((call_idx + 1) * num_features_, missing_value);
+    }
+    auto row = std::next(std::begin(data_), call_idx * num_features_);
+    for (std::size_t feature_idx {0}; feature_idx < num_features_; ++feature_idx, ++row) {
+        if (is_missing(measures[feature_idx])) {
+            *row = missing_value;
+        } else {
+            *row = cast_to_double(measures[feature_idx]);
+            present_features_[feature_idx] = true;
+        }
     }
 }
 
 void UnsupervisedClusteringFilter::prepare_for_classification(boost::optional<Log>& log) const
 {
+    const auto num_calls = num_records();
     if (log) {
-        stream(*log) << "CSR: clustering " << data_.size() << " records";
+        stream(*log) << "CSR: clustering " << num_calls << " records";
     }
     remove_missing_features();
-    const auto num_calls = data_.size();
-    // TODO
+    standardise_features();
+    cluster();
     data_.clear();
     data_.shrink_to_fit();
+    // TODO: label clusters
     classifications_.resize(num_calls);
 }
 
@@ -53,44 +123,74 @@ VariantCallFilter::Classification UnsupervisedClusteringFilter::classify(std::si
     return classifications_[call_idx];
 }
 
-bool UnsupervisedClusteringFilter::all_missing(const MeasureVector& measures) const noexcept
+std::size_t UnsupervisedClusteringFilter::num_records() const noexcept
 {
-    return std::all_of(std::cbegin(measures), std::cend(measures),
-                       [] (const auto& measure) noexcept { return is_missing(measure); });
+    return num_features_ > 0 ? data_.size() / num_features_ : 0;
 }
 
 void UnsupervisedClusteringFilter::remove_missing_features() const
 {
-    if (!data_.empty()) {
-        const auto num_dimensions = data_.front().size();
-        std::vector<std::size_t> missing_columns(num_dimensions);
-        std::iota(std::begin(missing_columns), std::end(missing_columns), 0);
-        for (const auto& point : data_) {
-            for (auto itr = std::cbegin(missing_columns); itr != std::cend(missing_columns);) {
-                assert(*itr < point.size());
-                if (is_missing(point[*itr])) {
-                    ++itr;
-                } else {
-                    itr = missing_columns.erase(itr);
+    const auto num_present = static_cast<std::size_t>(std::count(std::cbegin(present_features_), std::cend(present_features_), true));
+    if (num_present == num_features_) return;
+    const auto num_calls = num_records();
+    if (num_present > 0) {
+        auto result_itr = std::begin(data_);
+        for (std::size_t call_idx {0}; call_idx < num_calls; ++call_idx) {
+            for (std::size_t feature_idx {0}; feature_idx < num_features_; ++feature_idx) {
+                if (present_features_[feature_idx]) {
+                    *result_itr++ = data_[call_idx * num_features_ + feature_idx];
                 }
             }
-            if (missing_columns.empty()) break;
         }
-        if (!missing_columns.empty()) {
-            if (missing_columns.size() != num_dimensions) {
-                assert(std::is_sorted(std::cbegin(missing_columns), std::cend(missing_columns)));
-                for (auto& point : data_) {
-                    std::for_each(std::crbegin(missing_columns), std::crend(missing_columns),
-                                  [&point] (auto idx) { point.erase(std::next(std::cbegin(point), idx)); });
-        
-                }
-            } else {
-                data_.clear();
-                data_.shrink_to_fit();
-            }
+        data_.erase(result_itr, std::end(data_));
+    } else {
+        data_.clear();
+        data_.shrink_to_fit();
+    }
+    num_features_ = num_present;
+    present_features_.assign(num_features_, true);
+}
+
+void UnsupervisedClusteringFilter::standardise_features() const
+{
+    const auto num_calls = num_records();
+    if (num_calls < 2) return;
+    for (std::size_t feature_idx {0}; feature_idx < num_features_; ++feature_idx) {
+        double mean {0}, sum_sq {0};
+        for (std::size_t call_idx {0}; call_idx < num_calls; ++call_idx) {
+            mean += data_[call_idx * num_features_ + feature_idx];
+        }
+        mean /= num_calls;
+        for (std::size_t call_idx {0}; call_idx < num_calls; ++call_idx) {
+            const auto delta = data_[call_idx * num_features_ + feature_idx] - mean;
+            sum_sq += delta * delta;
+        }
+        const auto stdev = std::sqrt(sum_sq / (num_calls - 1));
+        for (std::size_t call_idx {0}; call_idx < num_calls; ++call_idx) {
+            auto& value = data_[call_idx * num_features_ + feature_idx];
+            value -= mean;
+            if (stdev > 0) value /= stdev;
         }
     }
 }
 
+void UnsupervisedClusteringFilter::cluster() const
+{
+    static constexpr std::size_t num_clusters {2};
+    const auto num_calls = num_records();
+    cluster_assignments_.clear();
+    if (num_calls == 0 || num_features_ == 0) return;
+    // Points are record indices so only the compact feature table is ever stored
+    std::vector<std::size_t> points(num_calls);
+    std::iota(std::begin(points), std::end(points), 0);
+    const auto squared_distance = [this] (const std::size_t lhs, const std::size_t rhs) {
+        const auto lhs_row = std::next(std::cbegin(data_), lhs * num_features_);
+        const auto rhs_row = std::next(std::cbegin(data_), rhs * num_features_);
+        return std::inner_product(lhs_row, std::next(lhs_row, num_features_), rhs_row, 0.0, std::plus<> {},
+                                  [] (double a, double b) { return (a - b) * (a - b); });
+    };
+    clara(std::cbegin(points), std::cend(points), num_clusters, cluster_assignments_, squared_distance);
+}
+
 } // namespace csr
 } // namespace octopus
@@ -5,7 +5,6 @@
 #define unsupervised_clustering_filter_hpp
 
 #include <vector>
-#include <deque>
 #include <cstddef>
 
 #include <boost/optional.hpp>
@@ -33,7 +32,11 @@ public:
     virtual ~UnsupervisedClusteringFilter() override = default;
     
 private:
-    mutable std::deque<MeasureVector> data_;
+    // Records are stored as compact row-major numeric features rather than measure vectors
+    mutable std::vector<double> data_;
+    mutable std::size_t num_features_;
+    mutable std::vector<bool> present_features_;
+    mutable std::vector<std::size_t> cluster_assignments_;
     mutable std::vector<Classification> classifications_;
     
     void annotate(VcfHeader::Builder& header) const override;
@@ -41,8 +44,10 @@ private:
     void prepare_for_classification(boost::optional<Log>& log) const override;
     Classification classify(std::size_t call_idx, std::size_t sample_idx) const override;
     
-    bool all_missing(const MeasureVector& measures) const noexcept;
+    std::size_t num_records() const noexcept;
     void remove_missing_features() const;
+    void standardise_features() const;
+    void cluster() const;
 };
 
 } // namespace csr
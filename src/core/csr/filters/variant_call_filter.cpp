@@ -30,6 +30,7 @@
 #include "utils/parallel_transform.hpp"
 #include "io/variant/vcf_writer.hpp"
 #include "io/variant/vcf_spec.hpp"
+#include "exceptions/program_error.hpp"
 
 namespace octopus { namespace csr {
 
@@ -108,6 +109,37 @@ void VariantCallFilter::filter(const VcfReader& source, VcfWriter& dest) const
     }
 }
 
+class InMemoryFilteringNotSupported : public ProgramError
+{
+    std::string do_where() const override { return "VariantCallFilter::filter"; }
+    std::string do_why() const override { return "This filter cannot filter calls in memory"; }
+    std::string do_help() const override { return "submit an error report"; }
+};
+
+void VariantCallFilter::filter(const std::vector<VcfRecord>& calls, const std::vector<SampleName>& samples,
+                               VcfWriter& dest, const VcfHeader& dest_header) const
+{
+    if (!can_filter_in_memory()) throw InMemoryFilteringNotSupported {};
+    assert(dest.is_header_written());
+    if (!calls.empty()) filter_in_memory(calls, dest, dest_header, samples);
+}
+
+class ContigFilteringNotSupported : public ProgramError
+{
+    std::string do_where() const override { return "VariantCallFilter::filter"; }
+    std::string do_why() const override { return "This filter cannot filter contigs concurrently"; }
+    std::string do_help() const override { return "submit an error report"; }
+};
+
+void VariantCallFilter::filter(const VcfReader::Path& source, const std::vector<GenomicRegion::ContigName>& contigs,
+                               std::vector<VcfWriter>& dests, const VcfHeader& dest_header) const
+{
+    if (!can_filter_contigs_concurrently()) throw ContigFilteringNotSupported {};
+    assert(contigs.size() == dests.size());
+    assert(std::all_of(std::cbegin(dests), std::cend(dests), [] (const auto& dest) { return dest.is_header_written(); }));
+    if (!contigs.empty()) filter_contigs(source, contigs, dests, dest_header);
+}
+
 // protected methods
 
 namespace {
@@ -176,6 +208,11 @@ bool VariantCallFilter::can_measure_multiple_blocks() const noexcept
     return is_multithreaded();
 }
 
+unsigned VariantCallFilter::max_concurrent_contigs() const noexcept
+{
+    return std::max(static_cast<unsigned>(workers_.size()), 1u);
+}
+
 namespace {
 
 GenomicRegion get_phase_set(const VcfRecord& record, const SampleName& sample)
@@ -210,8 +247,9 @@ std::vector<T> copy_each_first(const std::vector<std::pair<T, _>>& items)
 
 } // namespace
 
+template <typename ForwardIterator>
 VariantCallFilter::CallBlock
-VariantCallFilter::read_next_block(VcfIterator& first, const VcfIterator& last, const SampleList& samples) const
+VariantCallFilter::read_next_block_helper(ForwardIterator& first, const ForwardIterator& last, const SampleList& samples) const
 {
     std::vector<std::pair<VcfRecord, GenomicRegion>> block {};
     for (; first != last; ++first) {
@@ -225,8 +263,21 @@ VariantCallFilter::read_next_block(VcfIterator& first, const VcfIterator& last,
     return copy_each_first(block);
 }
 
+VariantCallFilter::CallBlock
+VariantCallFilter::read_next_block(VcfIterator& first, const VcfIterator& last, const SampleList& samples) const
+{
+    return read_next_block_helper(first, last, samples);
+}
+
+VariantCallFilter::CallBlock
+VariantCallFilter::read_next_block(CallIterator& first, const CallIterator& last, const SampleList& samples) const
+{
+    return read_next_block_helper(first, last, samples);
+}
+
+template <typename ForwardIterator>
 std::vector<VariantCallFilter::CallBlock>
-VariantCallFilter::read_next_blocks(VcfIterator& first, const VcfIterator& last, const SampleList& samples) const
+VariantCallFilter::read_next_blocks_helper(ForwardIterator& first, const ForwardIterator& last, const SampleList& samples) const
 {
     std::vector<VariantCallFilter::CallBlock> result {};
     if (can_measure_multiple_blocks()) {
@@ -242,6 +293,18 @@ VariantCallFilter::read_next_blocks(VcfIterator& first, const VcfIterator& last,
     return result;
 }
 
+std::vector<VariantCallFilter::CallBlock>
+VariantCallFilter::read_next_blocks(VcfIterator& first, const VcfIterator& last, const SampleList& samples) const
+{
+    return read_next_blocks_helper(first, last, samples);
+}
+
+std::vector<VariantCallFilter::CallBlock>
+VariantCallFilter::read_next_blocks(CallIterator& first, const CallIterator& last, const SampleList& samples) const
+{
+    return read_next_blocks_helper(first, last, samples);
+}
+
 VariantCallFilter::MeasureVector VariantCallFilter::measure(const VcfRecord& call) const
 {
     MeasureVector result(measures_.size());
@@ -269,12 +332,25 @@ VariantCallFilter::MeasureVector VariantCallFilter::measure(const VcfRecord& cal
 
 VariantCallFilter::MeasureBlock VariantCallFilter::measure(const CallBlock& block) const
 {
-    const auto facets = compute_facets(block);
-    return measure(block, facets);
+    return measure(block, block);
 }
 
 std::vector<VariantCallFilter::MeasureBlock> VariantCallFilter::measure(const std::vector<CallBlock>& blocks) const
 {
+    return measure(blocks, blocks);
+}
+
+VariantCallFilter::MeasureBlock VariantCallFilter::measure(const CallBlock& block, const CallBlock& calls) const
+{
+    if (calls.empty()) return {};
+    const auto facets = compute_facets(block);
+    return measure(calls, facets);
+}
+
+std::vector<VariantCallFilter::MeasureBlock>
+VariantCallFilter::measure(const std::vector<CallBlock>& blocks, const std::vector<CallBlock>& calls) const
+{
+    assert(calls.size() == blocks.size());
     std::vector<MeasureBlock> result {};
     result.reserve(blocks.size());
     if (is_multithreaded()) {
@@ -282,13 +358,13 @@ std::vector<VariantCallFilter::MeasureBlock> VariantCallFilter::measure(const st
         if (debug_log_) {
             stream(*debug_log_) << "Measuring " << blocks.size() << " blocks with " << workers_.size() << " threads";
         }
-        transform(std::cbegin(blocks), std::cend(blocks), std::cbegin(facets), std::back_inserter(result),
-                  [this] (const auto& block, const auto& block_facets) {
-                      return this->measure(block, block_facets);
+        transform(std::cbegin(calls), std::cend(calls), std::cbegin(facets), std::back_inserter(result),
+                  [this] (const auto& block_calls, const auto& block_facets) {
+                      return this->measure(block_calls, block_facets);
                   }, workers_);
     } else {
-        for (const CallBlock& block : blocks) {
-            result.push_back(measure(block));
+        for (std::size_t block_idx {0}; block_idx < blocks.size(); ++block_idx) {
+            result.push_back(measure(blocks[block_idx], calls[block_idx]));
         }
     }
     return result;
@@ -364,9 +440,26 @@ Phred<double> VariantCallFilter::combine_sample_qualities(const std::vector<Phre
     return ln_probability_true_to_phred(std::accumulate(std::cbegin(log_probs), std::cend(log_probs), 0.0));
 }
 
+void VariantCallFilter::filter_in_memory(const CallBlock& calls, VcfWriter& dest, const VcfHeader& dest_header,
+                                         const SampleList& samples) const
+{
+    throw InMemoryFilteringNotSupported {};
+}
+
+void VariantCallFilter::filter_contigs(const VcfReader::Path& source, const std::vector<GenomicRegion::ContigName>& contigs,
+                                       std::vector<VcfWriter>& dests, const VcfHeader& dest_header) const
+{
+    throw ContigFilteringNotSupported {};
+}
+
 VcfHeader VariantCallFilter::make_header(const VcfReader& source) const
 {
-    VcfHeader::Builder builder {source.fetch_header()};
+    return make_header(source.fetch_header());
+}
+
+VcfHeader VariantCallFilter::make_header(const VcfHeader& source_header) const
+{
+    VcfHeader::Builder builder {source_header};
     if (output_config_.clear_info) {
         builder.clear_info();
     }
@@ -499,9 +592,35 @@ VariantCallFilter::MeasureBlock VariantCallFilter::measure(const CallBlock& bloc
     if (debug_log_ && !block.empty()) {
         stream(*debug_log_) << "Measuring block " << encompassing_region(block) << " containing " << block.size() << " calls";
     }
-    MeasureBlock result(block.size());
-    std::transform(std::cbegin(block), std::cend(block), std::begin(result),
-                   [&] (const VcfRecord& call) { return this->measure(call, facets); });
+    // Measures are evaluated a block column at a time, so each distinct measure is dispatched once per block
+    const auto num_measures = measures_.size();
+    std::vector<std::size_t> columns(num_measures);
+    std::iota(std::begin(columns), std::end(columns), 0);
+    if (!duplicate_measures_.empty()) {
+        std::unordered_map<MeasureWrapper, std::size_t> first_columns {};
+        for (std::size_t measure_idx {0}; measure_idx < num_measures; ++measure_idx) {
+            columns[measure_idx] = first_columns.emplace(measures_[measure_idx], measure_idx).first->second;
+        }
+    }
+    std::vector<std::vector<Measure::ResultType>> values(num_measures);
+    for (std::size_t measure_idx {0}; measure_idx < num_measures; ++measure_idx) {
+        if (columns[measure_idx] == measure_idx) {
+            values[measure_idx] = measures_[measure_idx](block, facets);
+            assert(values[measure_idx].size() == block.size());
+        }
+    }
+    MeasureBlock result(block.size(), MeasureVector(num_measures));
+    // Duplicates always refer to an earlier column, so fill backwards and move each column on its last use
+    for (auto measure_idx = num_measures; measure_idx-- > 0;) {
+        auto& column = values[columns[measure_idx]];
+        for (std::size_t call_idx {0}; call_idx < block.size(); ++call_idx) {
+            if (columns[measure_idx] == measure_idx) {
+                result[call_idx][measure_idx] = std::move(column[call_idx]);
+            } else {
+                result[call_idx][measure_idx] = column[call_idx];
+            }
+        }
+    }
     return result;
 }
 
@@ -67,10 +67,25 @@ public:
     
     void filter(const VcfReader& source, VcfWriter& dest) const;
     
+    // In memory filtering lets calls be filtered as they are made, without writing and reading them back.
+    // Only filters that classify calls in a single pass support this. The calls must be sorted, and dest must
+    // have a header made by make_header.
+    virtual bool can_filter_in_memory() const noexcept { return false; }
+    VcfHeader make_header(const VcfHeader& source_header) const;
+    void filter(const std::vector<VcfRecord>& calls, const std::vector<SampleName>& samples,
+                VcfWriter& dest, const VcfHeader& dest_header) const;
+    
+    // Contig filtering lets each contig be read and filtered by its own thread. The source must be indexed and
+    // the calls for contigs[i] are written to dests[i], which must have a header made by make_header.
+    virtual bool can_filter_contigs_concurrently() const noexcept { return false; }
+    void filter(const VcfReader::Path& source, const std::vector<GenomicRegion::ContigName>& contigs,
+                std::vector<VcfWriter>& dests, const VcfHeader& dest_header) const;
+    
 protected:
     using SampleList    = std::vector<SampleName>;
     using MeasureVector = std::vector<Measure::ResultType>;
     using VcfIterator   = VcfReader::RecordIterator;
+    using CallIterator  = std::vector<VcfRecord>::const_iterator;
     using CallBlock     = std::vector<VcfRecord>;
     using MeasureBlock  = std::vector<MeasureVector>;
     
@@ -90,11 +105,17 @@ protected:
     
     bool can_measure_single_call() const noexcept;
     bool can_measure_multiple_blocks() const noexcept;
+    unsigned max_concurrent_contigs() const noexcept;
     CallBlock read_next_block(VcfIterator& first, const VcfIterator& last, const SampleList& samples) const;
+    CallBlock read_next_block(CallIterator& first, const CallIterator& last, const SampleList& samples) const;
     std::vector<CallBlock> read_next_blocks(VcfIterator& first, const VcfIterator& last, const SampleList& samples) const;
+    std::vector<CallBlock> read_next_blocks(CallIterator& first, const CallIterator& last, const SampleList& samples) const;
     MeasureVector measure(const VcfRecord& call) const;
     MeasureBlock measure(const CallBlock& block) const;
     std::vector<MeasureBlock> measure(const std::vector<CallBlock>& blocks) const;
+    // Measures a subset of the calls in each block, using facets computed from the whole block
+    MeasureBlock measure(const CallBlock& block, const CallBlock& calls) const;
+    std::vector<MeasureBlock> measure(const std::vector<CallBlock>& blocks, const std::vector<CallBlock>& calls) const;
     void write(const VcfRecord& call, const Classification& classification, VcfWriter& dest) const;
     void write(const VcfRecord& call, const Classification& classification,
                const SampleList& samples, const ClassificationList& sample_classifications,
@@ -114,12 +135,20 @@ private:
     
     virtual void annotate(VcfHeader::Builder& header) const = 0;
     virtual void filter(const VcfReader& source, VcfWriter& dest, const VcfHeader& dest_header) const = 0;
+    virtual void filter_in_memory(const CallBlock& calls, VcfWriter& dest, const VcfHeader& dest_header,
+                                  const SampleList& samples) const;
+    virtual void filter_contigs(const VcfReader::Path& source, const std::vector<GenomicRegion::ContigName>& contigs,
+                                std::vector<VcfWriter>& dests, const VcfHeader& dest_header) const;
     virtual boost::optional<std::string> call_quality_name() const { return boost::none; }
     virtual boost::optional<std::string> genotype_quality_name() const { return boost::none; }
     virtual bool is_soft_filtered(const ClassificationList& sample_classifications, const MeasureVector& measures) const;
     virtual Phred<double> combine_sample_qualities(const std::vector<Phred<double>>& qualities) const;
     
     VcfHeader make_header(const VcfReader& source) const;
+    template <typename ForwardIterator>
+    CallBlock read_next_block_helper(ForwardIterator& first, const ForwardIterator& last, const SampleList& samples) const;
+    template <typename ForwardIterator>
+    std::vector<CallBlock> read_next_blocks_helper(ForwardIterator& first, const ForwardIterator& last, const SampleList& samples) const;
     Measure::FacetMap compute_facets(const CallBlock& block) const;
     std::vector<Measure::FacetMap> compute_facets(const std::vector<CallBlock>& blocks) const;
     MeasureBlock measure(const CallBlock& block, const Measure::FacetMap& facets) const;
@@ -8,7 +8,7 @@
 #include "io/variant/vcf_record.hpp"
 #include "io/variant/vcf_spec.hpp"
 #include "../facets/samples.hpp"
-#include "../facets/overlapping_reads.hpp"
+#include "../facets/read_statistics.hpp"
 
 namespace octopus { namespace csr {
 
@@ -30,8 +30,8 @@ Measure::ResultType Depth::do_evaluate(const VcfRecord& call, const FacetMap& fa
 {
     if (aggregate_) {
         if (recalculate_) {
-            const auto& reads = get_value<OverlappingReads>(facets.at("OverlappingReads"));
-            return static_cast<std::size_t>(count_overlapped(reads, call));
+            const auto& stats = get_value<ReadStatistics>(facets.at("ReadStatistics"));
+            return stats.calls.at(mapped_region(call)).depth;
         } else {
             return static_cast<std::size_t>(std::stoull(call.info_value(vcfspec::info::combinedReadDepth).front()));
         }
@@ -40,9 +40,10 @@ Measure::ResultType Depth::do_evaluate(const VcfRecord& call, const FacetMap& fa
         std::vector<std::size_t> result {};
         result.reserve(samples.size());
         if (recalculate_) {
-            const auto& reads = get_value<OverlappingReads>(facets.at("OverlappingReads"));
+            const auto& stats = get_value<ReadStatistics>(facets.at("ReadStatistics"));
+            const auto& sample_depths = stats.calls.at(mapped_region(call)).sample_depths;
             for (const auto& sample : samples) {
-                result.push_back(count_overlapped(reads.at(sample), call));
+                result.push_back(sample_depths.at(sample));
             }
         } else {
             for (const auto& sample : samples) {
@@ -76,7 +77,7 @@ std::vector<std::string> Depth::do_requirements() const
 {
     std::vector<std::string> result {};
     if (!aggregate_) result.push_back("Samples");
-    if (recalculate_) result.push_back("OverlappingReads");
+    if (recalculate_) result.push_back("ReadStatistics");
     return result;
 }
 
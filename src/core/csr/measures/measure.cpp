@@ -24,6 +24,16 @@ void Measure::do_set_parameters(std::vector<std::string> params)
     }
 }
 
+std::vector<Measure::ResultType> Measure::do_evaluate_block(const CallBlock& calls, const FacetMap& facets) const
+{
+    std::vector<ResultType> result {};
+    result.reserve(calls.size());
+    for (const auto& call : calls) {
+        result.push_back(do_evaluate(call, facets));
+    }
+    return result;
+}
+
 struct MeasureSerialiseVisitor : boost::static_visitor<>
 {
     std::string str;
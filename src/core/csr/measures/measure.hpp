@@ -26,6 +26,7 @@ class Measure : public Equitable<Measure>
 {
 public:
     using FacetMap = std::unordered_map<std::string, FacetWrapper>;
+    using CallBlock = std::vector<VcfRecord>;
     using ResultType = boost::variant<double, boost::optional<double>,
                                       std::vector<double>, std::vector<boost::optional<double>>,
                                       int, boost::optional<int>,
@@ -51,6 +52,8 @@ public:
     void set_parameters(std::vector<std::string> params) { do_set_parameters(std::move(params)); }
     std::vector<std::string> parameters() const { return do_parameters(); }
     ResultType evaluate(const VcfRecord& call, const FacetMap& facets) const { return do_evaluate(call, facets); }
+    // Evaluates every call in a block, returning one value per call in block order
+    std::vector<ResultType> evaluate(const CallBlock& calls, const FacetMap& facets) const { return do_evaluate_block(calls, facets); }
     ResultCardinality cardinality() const noexcept { return do_cardinality(); }
     const std::string& name() const { return do_name(); }
     std::string describe() const { return do_describe(); }
@@ -68,6 +71,7 @@ private:
     virtual void do_set_parameters(std::vector<std::string> params);
     virtual std::vector<std::string> do_parameters() const { return {}; }
     virtual ResultType do_evaluate(const VcfRecord& call, const FacetMap& facets) const = 0;
+    virtual std::vector<ResultType> do_evaluate_block(const CallBlock& calls, const FacetMap& facets) const;
     virtual ResultCardinality do_cardinality() const noexcept = 0;
     virtual const std::string& do_name() const = 0;
     virtual std::string do_describe() const = 0;
@@ -101,6 +105,7 @@ public:
     std::vector<std::string> parameters() const { return measure_->parameters(); }
     auto operator()(const VcfRecord& call) const { return measure_->evaluate(call, {}); }
     auto operator()(const VcfRecord& call, const Measure::FacetMap& facets) const { return measure_->evaluate(call, facets); }
+    auto operator()(const Measure::CallBlock& calls, const Measure::FacetMap& facets) const { return measure_->evaluate(calls, facets); }
     Measure::ResultCardinality cardinality() const noexcept { return measure_->cardinality(); }
     const std::string& name() const { return measure_->name(); }
     std::string describe() const { return measure_->describe(); }
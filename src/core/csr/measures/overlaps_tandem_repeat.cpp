@@ -3,11 +3,14 @@
 
 #include "overlaps_tandem_repeat.hpp"
 
+#include <algorithm>
+#include <iterator>
+
 #include <boost/variant.hpp>
 
 #include "io/variant/vcf_record.hpp"
-#include "utils/repeat_finder.hpp"
-#include "../facets/reference_context.hpp"
+#include "utils/mappable_algorithms.hpp"
+#include "../facets/tandem_repeats.hpp"
 
 namespace octopus { namespace csr {
 
@@ -20,9 +23,10 @@ std::unique_ptr<Measure> OverlapsTandemRepeat::do_clone() const
 
 Measure::ResultType OverlapsTandemRepeat::do_evaluate(const VcfRecord& call, const FacetMap& facets) const
 {
-    const auto& reference = get_value<ReferenceContext>(facets.at("ReferenceContext"));
-    const auto repeats = find_exact_tandem_repeats(reference.sequence(), reference.mapped_region(), 1, 6);
-    return has_overlapped(repeats, call);
+    const auto& repeats = get_value<TandemRepeats>(facets.at("TandemRepeats"));
+    const auto overlapped = overlap_range(repeats, call);
+    return std::any_of(std::cbegin(overlapped), std::cend(overlapped),
+                       [] (const TandemRepeat& repeat) { return repeat.period() <= 6; });
 }
 
 Measure::ResultCardinality OverlapsTandemRepeat::do_cardinality() const noexcept
@@ -42,7 +46,7 @@ std::string OverlapsTandemRepeat::do_describe() const
 
 std::vector<std::string> OverlapsTandemRepeat::do_requirements() const
 {
-    return {"ReferenceContext"};
+    return {"TandemRepeats"};
 }
 
 } // namespace csr
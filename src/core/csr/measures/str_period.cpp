@@ -11,8 +11,8 @@
 
 #include "basics/tandem_repeat.hpp"
 #include "io/variant/vcf_record.hpp"
-#include "utils/repeat_finder.hpp"
-#include "../facets/reference_context.hpp"
+#include "utils/mappable_algorithms.hpp"
+#include "../facets/tandem_repeats.hpp"
 
 namespace octopus { namespace csr {
 
@@ -47,9 +47,8 @@ bool could_contain(const TandemRepeat& repeat, const VcfRecord& call)
     return contains(expand(mapped_region(repeat), 1), call);
 }
 
-boost::optional<TandemRepeat> find_repeat_context(const VcfRecord& call, const Haplotype& reference)
+boost::optional<TandemRepeat> find_repeat_context(const VcfRecord& call, const std::vector<TandemRepeat>& repeats)
 {
-    const auto repeats = find_exact_tandem_repeats(reference.sequence(), reference.mapped_region(), 1, 20);
     const auto overlapping_repeats = overlap_range(repeats, expand(mapped_region(call), 1));
     boost::optional<TandemRepeat> result {};
     if (!empty(overlapping_repeats)) {
@@ -74,8 +73,8 @@ boost::optional<TandemRepeat> find_repeat_context(const VcfRecord& call, const H
 Measure::ResultType STRPeriod::do_evaluate(const VcfRecord& call, const FacetMap& facets) const
 {
     int result {0};
-    const auto& reference = get_value<ReferenceContext>(facets.at("ReferenceContext"));
-    const auto repeat_context = find_repeat_context(call, reference);
+    const auto& repeats = get_value<TandemRepeats>(facets.at("TandemRepeats"));
+    const auto repeat_context = find_repeat_context(call, repeats);
     if (repeat_context) result = repeat_context->period();
     return result;
 }
@@ -97,7 +96,7 @@ std::string STRPeriod::do_describe() const
 
 std::vector<std::string> STRPeriod::do_requirements() const
 {
-    return {"ReferenceContext"};
+    return {"TandemRepeats"};
 }
 
 } // namespace csr
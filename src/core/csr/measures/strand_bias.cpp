@@ -7,10 +7,14 @@
 #include <iterator>
 #include <random>
 #include <functional>
+#include <unordered_map>
+#include <tuple>
+#include <utility>
 #include <cmath>
 #include <cassert>
 
 #include <boost/variant.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/math/special_functions/gamma.hpp>
 #include <boost/math/special_functions/digamma.hpp>
 
@@ -126,16 +130,6 @@ auto sample_beta(const DirectionCounts& counts, const std::size_t n)
     return result;
 }
 
-auto generate_beta_samples(const DirectionCountVector& direction_counts, const std::size_t num_samples)
-{
-    std::vector<std::vector<double>> result {};
-    result.reserve(direction_counts.size());
-    for (const auto& counts : direction_counts) {
-        result.push_back(sample_beta(counts, num_samples));
-    }
-    return result;
-}
-
 double estimate_prob_different(const std::vector<double>& lhs, const std::vector<double>& rhs,
                                const double min_diff)
 {
@@ -146,16 +140,94 @@ double estimate_prob_different(const std::vector<double>& lhs, const std::vector
     return static_cast<double>(n_diffs) / diffs.size();
 }
 
+bool is_normal_approximable(const DirectionCounts& counts) noexcept
+{
+    static constexpr unsigned min_count {30};
+    return counts.forward >= min_count && counts.reverse >= min_count;
+}
+
+auto beta_moments(const DirectionCounts& counts) noexcept
+{
+    const double a {static_cast<double>(counts.forward)}, b {static_cast<double>(counts.reverse)};
+    return std::make_pair(a / (a + b), a * b / ((a + b) * (a + b) * (a + b + 1)));
+}
+
+double normal_cdf(const double x) noexcept
+{
+    return 0.5 * std::erfc(-x / std::sqrt(2.0));
+}
+
+// With large counts both Betas are close to normal, so their difference is too
+double approximate_prob_different(const DirectionCounts& lhs, const DirectionCounts& rhs, const double min_diff) noexcept
+{
+    const auto lhs_moments = beta_moments(lhs), rhs_moments = beta_moments(rhs);
+    const auto mean = lhs_moments.first - rhs_moments.first;
+    const auto stdev = std::sqrt(lhs_moments.second + rhs_moments.second);
+    return 1.0 - (normal_cdf((min_diff - mean) / stdev) - normal_cdf((-min_diff - mean) / stdev));
+}
+
+struct ProbDifferentKey
+{
+    DirectionCounts lhs, rhs;
+    std::size_t num_samples;
+    double min_diff;
+};
+
+bool operator==(const ProbDifferentKey& lhs, const ProbDifferentKey& rhs) noexcept
+{
+    return lhs.lhs.forward == rhs.lhs.forward && lhs.lhs.reverse == rhs.lhs.reverse
+        && lhs.rhs.forward == rhs.rhs.forward && lhs.rhs.reverse == rhs.rhs.reverse
+        && lhs.num_samples == rhs.num_samples && lhs.min_diff == rhs.min_diff;
+}
+
+struct ProbDifferentKeyHash
+{
+    std::size_t operator()(const ProbDifferentKey& key) const noexcept
+    {
+        std::size_t result {};
+        boost::hash_combine(result, key.lhs.forward);
+        boost::hash_combine(result, key.lhs.reverse);
+        boost::hash_combine(result, key.rhs.forward);
+        boost::hash_combine(result, key.rhs.reverse);
+        boost::hash_combine(result, key.num_samples);
+        boost::hash_combine(result, key.min_diff);
+        return result;
+    }
+};
+
+// Most calls have low depth, so the same count pairs come up again and again. Each thread keeps the
+// estimates it has already made; any previous estimate is as good as a fresh one.
+double estimate_prob_different(const DirectionCounts& lhs, const DirectionCounts& rhs, const std::size_t num_samples,
+                               const double min_diff)
+{
+    static constexpr std::size_t max_cache_size {100'000};
+    static thread_local std::unordered_map<ProbDifferentKey, double, ProbDifferentKeyHash> cache {};
+    // The difference is symmetric, so order the pair to share cache entries
+    const bool swap = std::tie(rhs.forward, rhs.reverse) < std::tie(lhs.forward, lhs.reverse);
+    const ProbDifferentKey key {swap ? rhs : lhs, swap ? lhs : rhs, num_samples, min_diff};
+    const auto itr = cache.find(key);
+    if (itr != std::cend(cache)) return itr->second;
+    if (cache.size() >= max_cache_size) cache.clear();
+    const auto result = estimate_prob_different(sample_beta(key.lhs, num_samples), sample_beta(key.rhs, num_samples), min_diff);
+    cache.emplace(key, result);
+    return result;
+}
+
 double calculate_max_prob_different(const DirectionCountVector& direction_counts, const std::size_t num_samples,
                                     const double min_diff)
 {
     const auto num_counts = direction_counts.size();
     if (num_counts < 2) return 0;
-    const auto samples = generate_beta_samples(direction_counts, num_samples);
     double result {0};
     for (std::size_t i {0}; i < num_counts - 1; ++i) {
         for (auto j = i + 1; j < num_counts; ++j) {
-            result = std::max(result, estimate_prob_different(samples[i], samples[j], min_diff));
+            const auto& lhs = direction_counts[i];
+            const auto& rhs = direction_counts[j];
+            if (is_normal_approximable(lhs) && is_normal_approximable(rhs)) {
+                result = std::max(result, approximate_prob_different(lhs, rhs, min_diff));
+            } else {
+                result = std::max(result, estimate_prob_different(lhs, rhs, num_samples, min_diff));
+            }
         }
     }
     return result;
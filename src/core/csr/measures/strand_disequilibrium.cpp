@@ -3,6 +3,9 @@
 
 #include "strand_disequilibrium.hpp"
 
+#include <vector>
+#include <cstddef>
+
 #include <boost/lexical_cast.hpp>
 
 #include "io/variant/vcf_record.hpp"
@@ -42,6 +45,32 @@ std::vector<std::string> StrandDisequilibrium::do_parameters() const
     return {utils::to_string(tail_mass_, 2)};
 }
 
+namespace {
+
+// Direction counts are mostly small, so tail probabilities are memoised per thread in a table indexed by the
+// counts, filled in as entries are needed. Larger counts are computed directly.
+double calculate_tail_probability(const std::size_t forward, const std::size_t reverse, const double tail_mass)
+{
+    static constexpr std::size_t table_size {64};
+    static constexpr double unset {-1};
+    static thread_local double table_tail_mass {unset};
+    static thread_local std::vector<double> table {};
+    if (forward >= table_size || reverse >= table_size) {
+        return maths::beta_tail_probability(forward + 0.5, reverse + 0.5, tail_mass);
+    }
+    if (tail_mass != table_tail_mass) {
+        table.assign(table_size * table_size, unset);
+        table_tail_mass = tail_mass;
+    }
+    auto& result = table[forward * table_size + reverse];
+    if (result == unset) {
+        result = maths::beta_tail_probability(forward + 0.5, reverse + 0.5, tail_mass);
+    }
+    return result;
+}
+
+} // namespace
+
 Measure::ResultType StrandDisequilibrium::do_evaluate(const VcfRecord& call, const FacetMap& facets) const
 {
     const auto& samples = get_value<Samples>(facets.at("Samples"));
@@ -50,7 +79,7 @@ Measure::ResultType StrandDisequilibrium::do_evaluate(const VcfRecord& call, con
     result.reserve(samples.size());
     for (const auto& sample : samples) {
         const auto direction_counts = count_directions(reads.at(sample), mapped_region(call));
-        const auto tail_probability = maths::beta_tail_probability(direction_counts.first + 0.5, direction_counts.second + 0.5, tail_mass_);
+        const auto tail_probability = calculate_tail_probability(direction_counts.first, direction_counts.second, tail_mass_);
         result.push_back(tail_probability);
     }
     return result;
@@ -6,20 +6,17 @@
 #include <algorithm>
 #include <iterator>
 
-#include "tandem/tandem.hpp"
+#include "utils/repeat_finder.hpp"
 
 namespace octopus {
 
 namespace {
 
-auto extract_repeats(const Haplotype& haplotype)
-{
-    return tandem::extract_exact_tandem_repeats(haplotype.sequence(), 1, 5);
-}
+constexpr unsigned maxRepeatPeriod {5};
 
 void sort_by_length(std::vector<tandem::Repeat>& repeats)
 {
-    std::sort(std::begin(repeats), std::end(repeats), [] (const auto& lhs, const auto& rhs) { return lhs.length < rhs.length; });
+    std::stable_sort(std::begin(repeats), std::end(repeats), [] (const auto& lhs, const auto& rhs) { return lhs.length < rhs.length; });
 }
 
 void set_motif(const Haplotype& haplotype, const tandem::Repeat& repeat, Haplotype::NucleotideSequence& result)
@@ -42,10 +39,20 @@ auto fill_n_if_less(FordwardIt first, std::size_t n, const Tp& value)
 
 } // namespace
 
+std::vector<tandem::Repeat> RepeatBasedIndelErrorModel::find_repeats(const Haplotype& haplotype) const
+{
+    if (!base_repeats_ || base_repeats_->region != haplotype.mapped_region() || is_reference(haplotype)) {
+        auto result = find_maximal_repetitions(haplotype.sequence(), maxRepeatPeriod);
+        base_repeats_ = BaseRepeats {haplotype.mapped_region(), haplotype.sequence(), result};
+        return result;
+    }
+    return update_maximal_repetitions(haplotype.sequence(), base_repeats_->sequence, base_repeats_->repeats, maxRepeatPeriod);
+}
+
 void RepeatBasedIndelErrorModel::do_set_penalties(const Haplotype& haplotype, PenaltyVector& gap_open_penalities, PenaltyType& gap_extend_penalty) const
 {
     gap_open_penalities.assign(sequence_size(haplotype), get_default_open_penalty());
-    const auto repeats = extract_repeats(haplotype);
+    const auto repeats = find_repeats(haplotype);
     if (!repeats.empty()) {
         tandem::Repeat max_repeat {};
         Sequence motif(3, 'N');
@@ -68,7 +75,7 @@ void RepeatBasedIndelErrorModel::do_set_penalties(const Haplotype& haplotype, Pe
 {
     gap_open_penalities.assign(sequence_size(haplotype), get_default_open_penalty());
     gap_extend_penalties.assign(sequence_size(haplotype), get_default_extension_penalty());
-    auto repeats = extract_repeats(haplotype);
+    auto repeats = find_repeats(haplotype);
     if (!repeats.empty()) {
         sort_by_length(repeats);
         Sequence motif(3, 'N');
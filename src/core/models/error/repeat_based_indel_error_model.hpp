@@ -4,8 +4,15 @@
 #ifndef repeat_based_indel_error_model_hpp
 #define repeat_based_indel_error_model_hpp
 
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include "tandem/tandem.hpp"
+
 #include "indel_error_model.hpp"
 
+#include "basics/genomic_region.hpp"
 #include "core/types/haplotype.hpp"
 
 namespace octopus {
@@ -29,6 +36,18 @@ protected:
     using Sequence = Haplotype::NucleotideSequence;
     
 private:
+    // The repeats of the last reference haplotype, which other haplotypes of the same region are patched from
+    struct BaseRepeats
+    {
+        GenomicRegion region;
+        Sequence sequence;
+        std::vector<tandem::Repeat> repeats;
+    };
+    
+    mutable boost::optional<BaseRepeats> base_repeats_;
+    
+    std::vector<tandem::Repeat> find_repeats(const Haplotype& haplotype) const;
+    
     void do_set_penalties(const Haplotype& haplotype, PenaltyVector& gap_open_penalties, PenaltyType& gap_extend_penalty) const override;
     void do_set_penalties(const Haplotype& haplotype, PenaltyVector& gap_open_penalties, PenaltyVector& gap_extend_penalties) const override;
     
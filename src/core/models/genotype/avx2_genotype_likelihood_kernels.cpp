@@ -0,0 +1,143 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "genotype_likelihood_kernels.hpp"
+
+#include <limits>
+#include <cstdint>
+
+#include <immintrin.h>
+
+namespace octopus { namespace model { namespace kernels { namespace avx2 {
+
+namespace {
+
+__m256d exp(__m256d x) noexcept
+{
+    // NaN (from -inf - -inf) is mapped to minExpArgument too
+    x = _mm256_max_pd(x, _mm256_set1_pd(detail::minExpArgument));
+    const auto n = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(detail::log2e)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    x = _mm256_sub_pd(x, _mm256_mul_pd(n, _mm256_set1_pd(detail::ln2Hi)));
+    x = _mm256_sub_pd(x, _mm256_mul_pd(n, _mm256_set1_pd(detail::ln2Lo)));
+    constexpr int numCoefficients {sizeof(detail::expCoefficients) / sizeof(double)};
+    auto p = _mm256_set1_pd(detail::expCoefficients[numCoefficients - 1]);
+    for (int j {numCoefficients - 2}; j >= 0; --j) {
+        p = _mm256_add_pd(_mm256_mul_pd(p, x), _mm256_set1_pd(detail::expCoefficients[j]));
+    }
+    auto exponent = _mm_add_epi32(_mm256_cvtpd_epi32(n), _mm_set1_epi32(1023));
+    const auto scale = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_cvtepi32_epi64(exponent), 52));
+    return _mm256_mul_pd(p, scale);
+}
+
+// x must be positive and normal
+__m256d log(const __m256d x) noexcept
+{
+    const auto bits = _mm256_castpd_si256(x);
+    const auto magic = _mm256_set1_epi64x(0x4330000000000000); // 2^52
+    auto e = _mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(bits, 52), magic));
+    e = _mm256_sub_pd(e, _mm256_set1_pd(4503599627370496.0 + 1023));
+    auto m = _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi64x(0x000fffffffffffff)),
+                                                 _mm256_set1_epi64x(0x3ff0000000000000)));
+    const auto is_large = _mm256_cmp_pd(m, _mm256_set1_pd(1.41421356237309504880), _CMP_GT_OQ);
+    m = _mm256_blendv_pd(m, _mm256_mul_pd(m, _mm256_set1_pd(0.5)), is_large);
+    e = _mm256_add_pd(e, _mm256_and_pd(is_large, _mm256_set1_pd(1.0)));
+    const auto one = _mm256_set1_pd(1.0);
+    const auto s = _mm256_div_pd(_mm256_sub_pd(m, one), _mm256_add_pd(m, one));
+    const auto z = _mm256_mul_pd(s, s);
+    constexpr int numCoefficients {sizeof(detail::logCoefficients) / sizeof(double)};
+    auto p = _mm256_set1_pd(detail::logCoefficients[numCoefficients - 1]);
+    for (int j {numCoefficients - 2}; j >= 0; --j) {
+        p = _mm256_add_pd(_mm256_mul_pd(p, z), _mm256_set1_pd(detail::logCoefficients[j]));
+    }
+    const auto ln_m = _mm256_mul_pd(_mm256_add_pd(s, s), p);
+    return _mm256_add_pd(_mm256_mul_pd(e, _mm256_set1_pd(detail::ln2)), ln_m);
+}
+
+__m256d load_weight(const double* weights, const std::size_t k) noexcept
+{
+    return _mm256_set1_pd(weights ? weights[k] : 0.0);
+}
+
+__m256d load(const double* values) noexcept
+{
+    return _mm256_loadu_pd(values);
+}
+
+__m256d load(const float* values) noexcept
+{
+    return _mm256_cvtps_pd(_mm_loadu_ps(values));
+}
+
+template <typename T>
+double sum_log_sum_exp_rows(const T* const* rows, const double* weights, const std::size_t num_rows,
+                            const std::size_t n, const double* read_weights) noexcept
+{
+    constexpr std::size_t stride {4};
+    const auto neg_inf = _mm256_set1_pd(-std::numeric_limits<double>::infinity());
+    auto result = _mm256_setzero_pd();
+    std::size_t i {0};
+    for (; i + stride <= n; i += stride) {
+        auto max = neg_inf;
+        for (std::size_t k {0}; k < num_rows; ++k) {
+            max = _mm256_max_pd(max, _mm256_add_pd(load(rows[k] + i), load_weight(weights, k)));
+        }
+        if (_mm256_movemask_pd(_mm256_cmp_pd(max, neg_inf, _CMP_EQ_OQ)) != 0) return -std::numeric_limits<double>::infinity();
+        auto sum = _mm256_setzero_pd();
+        for (std::size_t k {0}; k < num_rows; ++k) {
+            const auto x = _mm256_add_pd(load(rows[k] + i), load_weight(weights, k));
+            sum = _mm256_add_pd(sum, exp(_mm256_sub_pd(x, max)));
+        }
+        auto term = _mm256_add_pd(max, log(sum));
+        if (read_weights) term = _mm256_mul_pd(term, _mm256_loadu_pd(read_weights + i));
+        result = _mm256_add_pd(result, term);
+    }
+    alignas(32) double lanes[stride];
+    _mm256_store_pd(lanes, result);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + detail::sum_log_sum_exp(rows, weights, num_rows, i, n, read_weights);
+}
+
+} // namespace
+
+double sum_log_sum_exp(const double* const* rows, const double* weights, const std::size_t num_rows,
+                       const std::size_t n, const double* read_weights) noexcept
+{
+    return sum_log_sum_exp_rows(rows, weights, num_rows, n, read_weights);
+}
+
+double sum_log_sum_exp(const float* const* rows, const double* weights, const std::size_t num_rows,
+                       const std::size_t n, const double* read_weights) noexcept
+{
+    return sum_log_sum_exp_rows(rows, weights, num_rows, n, read_weights);
+}
+
+float inner_product(const float* lhs, const float* rhs, const std::size_t n) noexcept
+{
+    constexpr std::size_t stride {8};
+    auto result = _mm256_setzero_ps();
+    std::size_t i {0};
+    for (; i + stride <= n; i += stride) {
+        result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_loadu_ps(lhs + i), _mm256_loadu_ps(rhs + i)));
+    }
+    const auto half = _mm_add_ps(_mm256_castps256_ps128(result), _mm256_extractf128_ps(result, 1));
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, half);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + detail::inner_product(lhs, rhs, i, n);
+}
+
+double inner_product(const double* lhs, const double* rhs, const std::size_t n) noexcept
+{
+    constexpr std::size_t stride {4};
+    auto result = _mm256_setzero_pd();
+    std::size_t i {0};
+    for (; i + stride <= n; i += stride) {
+        result = _mm256_add_pd(result, _mm256_mul_pd(_mm256_loadu_pd(lhs + i), _mm256_loadu_pd(rhs + i)));
+    }
+    alignas(32) double lanes[stride];
+    _mm256_store_pd(lanes, result);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + detail::inner_product(lhs, rhs, i, n);
+}
+
+} // namespace avx2
+} // namespace kernels
+} // namespace model
+} // namespace octopus
@@ -0,0 +1,129 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "genotype_likelihood_kernels.hpp"
+
+#include <limits>
+
+#include <immintrin.h>
+
+namespace octopus { namespace model { namespace kernels { namespace avx512 {
+
+namespace {
+
+__m512d exp(__m512d x) noexcept
+{
+    // NaN (from -inf - -inf) is mapped to minExpArgument too
+    x = _mm512_max_pd(x, _mm512_set1_pd(detail::minExpArgument));
+    const auto n = _mm512_roundscale_pd(_mm512_mul_pd(x, _mm512_set1_pd(detail::log2e)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    x = _mm512_fnmadd_pd(n, _mm512_set1_pd(detail::ln2Hi), x);
+    x = _mm512_fnmadd_pd(n, _mm512_set1_pd(detail::ln2Lo), x);
+    constexpr int numCoefficients {sizeof(detail::expCoefficients) / sizeof(double)};
+    auto p = _mm512_set1_pd(detail::expCoefficients[numCoefficients - 1]);
+    for (int j {numCoefficients - 2}; j >= 0; --j) {
+        p = _mm512_fmadd_pd(p, x, _mm512_set1_pd(detail::expCoefficients[j]));
+    }
+    return _mm512_scalef_pd(p, n);
+}
+
+// x must be positive and normal
+__m512d log(const __m512d x) noexcept
+{
+    auto e = _mm512_getexp_pd(x);
+    auto m = _mm512_getmant_pd(x, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_src);
+    const auto is_large = _mm512_cmp_pd_mask(m, _mm512_set1_pd(1.41421356237309504880), _CMP_GT_OQ);
+    m = _mm512_mask_mul_pd(m, is_large, m, _mm512_set1_pd(0.5));
+    e = _mm512_mask_add_pd(e, is_large, e, _mm512_set1_pd(1.0));
+    const auto one = _mm512_set1_pd(1.0);
+    const auto s = _mm512_div_pd(_mm512_sub_pd(m, one), _mm512_add_pd(m, one));
+    const auto z = _mm512_mul_pd(s, s);
+    constexpr int numCoefficients {sizeof(detail::logCoefficients) / sizeof(double)};
+    auto p = _mm512_set1_pd(detail::logCoefficients[numCoefficients - 1]);
+    for (int j {numCoefficients - 2}; j >= 0; --j) {
+        p = _mm512_fmadd_pd(p, z, _mm512_set1_pd(detail::logCoefficients[j]));
+    }
+    const auto ln_m = _mm512_mul_pd(_mm512_add_pd(s, s), p);
+    return _mm512_fmadd_pd(e, _mm512_set1_pd(detail::ln2), ln_m);
+}
+
+__m512d load_weight(const double* weights, const std::size_t k) noexcept
+{
+    return _mm512_set1_pd(weights ? weights[k] : 0.0);
+}
+
+__m512d load(const double* values) noexcept
+{
+    return _mm512_loadu_pd(values);
+}
+
+__m512d load(const float* values) noexcept
+{
+    return _mm512_cvtps_pd(_mm256_loadu_ps(values));
+}
+
+template <typename T>
+double sum_log_sum_exp_rows(const T* const* rows, const double* weights, const std::size_t num_rows,
+                            const std::size_t n, const double* read_weights) noexcept
+{
+    constexpr std::size_t stride {8};
+    const auto neg_inf = _mm512_set1_pd(-std::numeric_limits<double>::infinity());
+    auto result = _mm512_setzero_pd();
+    std::size_t i {0};
+    for (; i + stride <= n; i += stride) {
+        auto max = neg_inf;
+        for (std::size_t k {0}; k < num_rows; ++k) {
+            max = _mm512_max_pd(max, _mm512_add_pd(load(rows[k] + i), load_weight(weights, k)));
+        }
+        if (_mm512_cmp_pd_mask(max, neg_inf, _CMP_EQ_OQ) != 0) return -std::numeric_limits<double>::infinity();
+        auto sum = _mm512_setzero_pd();
+        for (std::size_t k {0}; k < num_rows; ++k) {
+            const auto x = _mm512_add_pd(load(rows[k] + i), load_weight(weights, k));
+            sum = _mm512_add_pd(sum, exp(_mm512_sub_pd(x, max)));
+        }
+        auto term = _mm512_add_pd(max, log(sum));
+        if (read_weights) term = _mm512_mul_pd(term, _mm512_loadu_pd(read_weights + i));
+        result = _mm512_add_pd(result, term);
+    }
+    return _mm512_reduce_add_pd(result) + detail::sum_log_sum_exp(rows, weights, num_rows, i, n, read_weights);
+}
+
+} // namespace
+
+double sum_log_sum_exp(const double* const* rows, const double* weights, const std::size_t num_rows,
+                       const std::size_t n, const double* read_weights) noexcept
+{
+    return sum_log_sum_exp_rows(rows, weights, num_rows, n, read_weights);
+}
+
+double sum_log_sum_exp(const float* const* rows, const double* weights, const std::size_t num_rows,
+                       const std::size_t n, const double* read_weights) noexcept
+{
+    return sum_log_sum_exp_rows(rows, weights, num_rows, n, read_weights);
+}
+
+float inner_product(const float* lhs, const float* rhs, const std::size_t n) noexcept
+{
+    constexpr std::size_t stride {16};
+    auto result = _mm512_setzero_ps();
+    std::size_t i {0};
+    for (; i + stride <= n; i += stride) {
+        result = _mm512_fmadd_ps(_mm512_loadu_ps(lhs + i), _mm512_loadu_ps(rhs + i), result);
+    }
+    return _mm512_reduce_add_ps(result) + detail::inner_product(lhs, rhs, i, n);
+}
+
+double inner_product(const double* lhs, const double* rhs, const std::size_t n) noexcept
+{
+    constexpr std::size_t stride {8};
+    auto result = _mm512_setzero_pd();
+    std::size_t i {0};
+    for (; i + stride <= n; i += stride) {
+        result = _mm512_fmadd_pd(_mm512_loadu_pd(lhs + i), _mm512_loadu_pd(rhs + i), result);
+    }
+    return _mm512_reduce_add_pd(result) + detail::inner_product(lhs, rhs, i, n);
+}
+
+} // namespace avx512
+} // namespace kernels
+} // namespace model
+} // namespace octopus
@@ -12,6 +12,7 @@
 #include <cassert>
 
 #include "utils/maths.hpp"
+#include "genotype_likelihood_kernels.hpp"
 
 namespace octopus { namespace model {
 
@@ -26,24 +27,43 @@ ConstantMixtureGenotypeLikelihoodModel::ConstantMixtureGenotypeLikelihoodModel(c
     this->prime(haplotypes);
 }
 
+ConstantMixtureGenotypeLikelihoodModel::ConstantMixtureGenotypeLikelihoodModel(HaplotypeLikelihoodArray::MergedSampleLikelihoods likelihoods)
+: likelihoods_ {likelihoods.array()}
+, merged_likelihoods_ {std::move(likelihoods)}
+{}
+
 const HaplotypeLikelihoodArray& ConstantMixtureGenotypeLikelihoodModel::cache() const noexcept
 {
     return likelihoods_;
 }
 
-void ConstantMixtureGenotypeLikelihoodModel::prime(const std::vector<Haplotype>& haplotypes)
+void ConstantMixtureGenotypeLikelihoodModel::prime(const std::vector<Haplotype>& haplotypes, const bool memoise)
+{
+    assert(merged_likelihoods_ || likelihoods_.is_primed());
+    std::vector<std::size_t> haplotype_indices(haplotypes.size());
+    std::transform(std::cbegin(haplotypes), std::cend(haplotypes), std::begin(haplotype_indices),
+                   [this] (const auto& haplotype) { return likelihoods_.haplotype_index(haplotype); });
+    index(haplotype_indices, memoise);
+}
+
+void ConstantMixtureGenotypeLikelihoodModel::prime(const bool memoise)
 {
-    assert(likelihoods_.is_primed());
-    indexed_likelihoods_.reserve(haplotypes.size());
-    std::transform(std::cbegin(haplotypes), std::cend(haplotypes), std::back_inserter(indexed_likelihoods_),
-                   [this] (const auto& haplotype) -> const HaplotypeLikelihoodArray::LikelihoodVector& {
-                       return likelihoods_[haplotype]; });
+    assert(merged_likelihoods_ || likelihoods_.is_primed());
+    const auto num_haplotypes = merged_likelihoods_ ? merged_likelihoods_->num_haplotypes() : sample_likelihoods().num_haplotypes();
+    std::vector<std::size_t> haplotype_indices(num_haplotypes);
+    std::iota(std::begin(haplotype_indices), std::end(haplotype_indices), 0);
+    index(haplotype_indices, memoise);
 }
 
 void ConstantMixtureGenotypeLikelihoodModel::unprime() noexcept
 {
     indexed_likelihoods_.clear();
     indexed_likelihoods_.shrink_to_fit();
+    num_indexed_haplotypes_ = 0;
+    indexed_haplotype_indices_.clear();
+    indexed_haplotype_indices_.shrink_to_fit();
+    indexed_read_weights_ = nullptr;
+    indexed_uninformative_log_likelihood_ = 0;
 }
 
 bool ConstantMixtureGenotypeLikelihoodModel::is_primed() const noexcept
@@ -56,25 +76,90 @@ bool ConstantMixtureGenotypeLikelihoodModel::is_primed() const noexcept
 ConstantMixtureGenotypeLikelihoodModel::LogProbability
 ConstantMixtureGenotypeLikelihoodModel::evaluate(const Genotype<Haplotype>& genotype) const
 {
-    assert(likelihoods_.is_primed());
-    // These cases are just for optimisation
-    switch (genotype.ploidy()) {
-        case 0:
-            return 0.0;
-        case 1:
-            return evaluate_haploid(genotype);
-        case 2:
-            return evaluate_diploid(genotype);
-        case 3:
-            return evaluate_triploid(genotype);
-        case 4:
-            return evaluate_polyploid(genotype);
-            //return log_likelihood_tetraploid(sample, genotype);
-        default:
-            return evaluate_polyploid(genotype);
+    assert(merged_likelihoods_ || likelihoods_.is_primed());
+    if (genotype.ploidy() == 0) return 0.0;
+    // Each haplotype is looked up once, for both the memoisation key and the likelihoods
+    key_buffer_.clear();
+    for (const auto& haplotype : genotype) {
+        key_buffer_.push_back(static_cast<unsigned>(likelihoods_.haplotype_index(haplotype)));
+    }
+    if (merged_likelihoods_) {
+        // Reads are independent, so the merged likelihood is the sum over samples
+        LogProbability result {0};
+        for_each_sample([&] (const auto& sample_likelihoods) { result += evaluate_unmemoised(sample_likelihoods, key_buffer_); });
+        return result;
+    }
+    const auto sample_likelihoods = this->sample_likelihoods();
+    if (!likelihoods_.has_genotype_likelihood_table()) {
+        return evaluate_unmemoised(sample_likelihoods, key_buffer_);
+    }
+    return memoise([&] () { return evaluate_unmemoised(sample_likelihoods, key_buffer_); });
+}
+
+ConstantMixtureGenotypeLikelihoodModel::LogProbability
+ConstantMixtureGenotypeLikelihoodModel::evaluate(const GenotypeIndex& genotype) const
+{
+    assert(is_primed());
+    if (genotype.empty() || indexed_haplotype_indices_.empty()) {
+        return evaluate_unmemoised(genotype);
+    }
+    key_buffer_.clear();
+    for (const auto haplotype_idx : genotype) {
+        key_buffer_.push_back(indexed_haplotype_indices_[haplotype_idx]);
+    }
+    return memoise([&] () { return evaluate_unmemoised(genotype); });
+}
+
+// private methods
+
+HaplotypeLikelihoodArray::SampleLikelihoods ConstantMixtureGenotypeLikelihoodModel::sample_likelihoods() const noexcept
+{
+    return likelihoods_.is_read_compressed() ? likelihoods_.compressed_likelihoods() : likelihoods_.primed_likelihoods();
+}
+
+template <typename F>
+void ConstantMixtureGenotypeLikelihoodModel::for_each_sample(F&& f) const
+{
+    if (merged_likelihoods_) {
+        for (const auto& sample_likelihoods : *merged_likelihoods_) f(sample_likelihoods);
+    } else {
+        f(sample_likelihoods());
+    }
+}
+
+// Merged samples are never read compressed, so only unmerged samples have read weights
+void ConstantMixtureGenotypeLikelihoodModel::index(const std::vector<std::size_t>& haplotype_indices, const bool memoise)
+{
+    indexed_likelihoods_.clear();
+    indexed_haplotype_indices_.clear();
+    indexed_likelihoods_.reserve(haplotype_indices.size() * (merged_likelihoods_ ? merged_likelihoods_->num_samples() : 1));
+    for_each_sample([&] (const HaplotypeLikelihoodArray::SampleLikelihoods& sample_likelihoods) {
+        for (const auto haplotype_idx : haplotype_indices) {
+            indexed_likelihoods_.push_back(sample_likelihoods[haplotype_idx]);
+        }
+        indexed_read_weights_ = sample_likelihoods.read_weights();
+        indexed_uninformative_log_likelihood_ = sample_likelihoods.uninformative_log_likelihood();
+    });
+    num_indexed_haplotypes_ = haplotype_indices.size();
+    if (memoise && !merged_likelihoods_ && likelihoods_.has_genotype_likelihood_table()) {
+        for (const auto haplotype_idx : haplotype_indices) {
+            indexed_haplotype_indices_.push_back(static_cast<unsigned>(haplotype_idx));
+        }
     }
 }
 
+template <typename F>
+ConstantMixtureGenotypeLikelihoodModel::LogProbability
+ConstantMixtureGenotypeLikelihoodModel::memoise(F&& evaluate) const
+{
+    std::sort(std::begin(key_buffer_), std::end(key_buffer_));
+    const auto memoised = likelihoods_.find_genotype_likelihood(key_buffer_);
+    if (memoised) return *memoised;
+    const auto result = evaluate();
+    likelihoods_.memoise_genotype_likelihood(key_buffer_, result);
+    return result;
+}
+
 namespace {
 
 template <typename T = double>
@@ -96,147 +181,115 @@ static constexpr auto ln(const unsigned n)
     return lnLookup[n];
 }
 
-} // namespace
+template <typename T = double>
+T ln_count(const unsigned n)
+{
+    return n < 11 ? ln<T>(n) : static_cast<T>(std::log(n));
+}
 
-ConstantMixtureGenotypeLikelihoodModel::LogProbability
-ConstantMixtureGenotypeLikelihoodModel::evaluate(const GenotypeIndex& genotype) const
+template <typename T>
+T weighted_sum(const T* likelihoods, const T* read_weights, const std::size_t n) noexcept
 {
-    assert(is_primed());
-    const auto ploidy = static_cast<unsigned>(genotype.size());
-    buffer_.resize(ploidy);
-    LogProbability result {0};
-    const auto num_likelihoods = indexed_likelihoods_.front().get().size();
-    for (std::size_t read_idx {0}; read_idx < num_likelihoods; ++read_idx) {
-        std::transform(std::cbegin(genotype), std::cend(genotype), std::begin(buffer_),
-                       [=] (auto haplotype_idx) noexcept { return indexed_likelihoods_[haplotype_idx].get()[read_idx]; });
-        result += maths::log_sum_exp(buffer_) - ln<LogProbability>(ploidy);
-    }
-    return result;
+    return kernels::inner_product(likelihoods, read_weights, n);
 }
 
-// private methods
+// For single precision likelihoods, which are summed in double precision
+template <typename T, typename W>
+W weighted_sum(const T* likelihoods, const W* read_weights, const std::size_t n) noexcept
+{
+    return std::inner_product(likelihoods, likelihoods + n, read_weights, W {0});
+}
 
-ConstantMixtureGenotypeLikelihoodModel::LogProbability
-ConstantMixtureGenotypeLikelihoodModel::evaluate_haploid(const Genotype<Haplotype>& genotype) const
+template <typename T>
+double sum(const T* likelihoods, const std::size_t n, const double* read_weights) noexcept
 {
-    const auto& log_likelihoods = likelihoods_[genotype[0]];
-    return std::accumulate(std::cbegin(log_likelihoods), std::cend(log_likelihoods), LogProbability {0});
+    if (read_weights) return weighted_sum(likelihoods, read_weights, n);
+    return std::accumulate(likelihoods, likelihoods + n, 0.0);
 }
 
-ConstantMixtureGenotypeLikelihoodModel::LogProbability
-ConstantMixtureGenotypeLikelihoodModel::evaluate_diploid(const Genotype<Haplotype>& genotype) const
+template <typename T>
+T sum_weights(const std::size_t n, const T* read_weights) noexcept
 {
-    const auto& log_likelihoods1 = likelihoods_[genotype[0]];
-    if (genotype.is_homozygous()) {
-        return std::accumulate(std::cbegin(log_likelihoods1), std::cend(log_likelihoods1), LogProbability {0});
-    }
-    const auto& log_likelihoods2 = likelihoods_[genotype[1]];
-    return std::inner_product(std::cbegin(log_likelihoods1), std::cend(log_likelihoods1),
-                              std::cbegin(log_likelihoods2), LogProbability {0}, std::plus<> {},
-                              [] (const auto a, const auto b) -> LogProbability {
-                                  return maths::log_sum_exp(a, b) - ln<decltype(a)>(2);
-                              });
+    return read_weights ? std::accumulate(read_weights, read_weights + n, T {0}) : static_cast<T>(n);
 }
 
+} // namespace
+
 ConstantMixtureGenotypeLikelihoodModel::LogProbability
-ConstantMixtureGenotypeLikelihoodModel::evaluate_triploid(const Genotype<Haplotype>& genotype) const
+ConstantMixtureGenotypeLikelihoodModel::evaluate_unmemoised(const GenotypeIndex& genotype) const
 {
-    using std::cbegin; using std::cend;
-    const auto& log_likelihoods1 = likelihoods_[genotype[0]];
-    if (genotype.is_homozygous()) {
-        return std::accumulate(cbegin(log_likelihoods1), cend(log_likelihoods1), LogProbability {0});
-    }
-    if (genotype.zygosity() == 3) {
-        const auto& log_likelihoods2 = likelihoods_[genotype[1]];
-        const auto& log_likelihoods3 = likelihoods_[genotype[2]];
-        return maths::inner_product(cbegin(log_likelihoods1), cend(log_likelihoods1),
-                                    cbegin(log_likelihoods2), cbegin(log_likelihoods3),
-                                    LogProbability {0}, std::plus<> {},
-                                    [] (const auto a, const auto b, const auto c) -> LogProbability {
-                                        return maths::log_sum_exp(a, b, c) - ln<decltype(a)>(3);
-                                    });
-    }
-    if (genotype[0] != genotype[1]) {
-        const auto& log_likelihoods2 = likelihoods_[genotype[1]];
-        return std::inner_product(cbegin(log_likelihoods1), cend(log_likelihoods1),
-                                  cbegin(log_likelihoods2), LogProbability {0}, std::plus<> {},
-                                  [] (const auto a, const auto b) -> LogProbability {
-                                      return maths::log_sum_exp(a, ln<decltype(a)>(2) + b) - ln<decltype(a)>(3);
-                                  });
+    if (genotype.empty()) return 0.0;
+    LogProbability result {0};
+    // One block of indexed likelihoods per sample
+    for (auto first = std::cbegin(indexed_likelihoods_); first != std::cend(indexed_likelihoods_); first += num_indexed_haplotypes_) {
+        row_buffer_.clear();
+        weight_buffer_.clear();
+        for (std::size_t i {0}; i < genotype.size(); ++i) {
+            if (i > 0 && genotype[i] == genotype[i - 1]) {
+                ++weight_buffer_.back();
+            } else {
+                row_buffer_.push_back(first[genotype[i]].get().data());
+                weight_buffer_.push_back(1);
+            }
+        }
+        result += evaluate_mixture(genotype.size(), first->get().size(), indexed_read_weights_);
     }
-    const auto& log_likelihoods3 = likelihoods_[genotype[2]];
-    return std::inner_product(cbegin(log_likelihoods1), cend(log_likelihoods1),
-                              cbegin(log_likelihoods3), LogProbability {0}, std::plus<> {},
-                              [] (const auto a, const auto b) -> LogProbability {
-                                  return maths::log_sum_exp(ln<decltype(a)>(2) + a, b) - ln<decltype(a)>(3);
-                              });
+    return result + indexed_uninformative_log_likelihood_;
 }
 
+// genotype holds the array haplotype index of each haplotype in the genotype, with duplicates adjacent
 ConstantMixtureGenotypeLikelihoodModel::LogProbability
-ConstantMixtureGenotypeLikelihoodModel::evaluate_tetraploid(const Genotype<Haplotype>& genotype) const
+ConstantMixtureGenotypeLikelihoodModel::evaluate_unmemoised(const HaplotypeLikelihoodArray::SampleLikelihoods& likelihoods,
+                                                            const GenotypeLikelihoodTable::HaplotypeIndexTuple& genotype) const
 {
-    const auto z = genotype.zygosity();
-    const auto& log_likelihoods1 = likelihoods_[genotype[0]];
-    if (z == 1) {
-        return std::accumulate(std::cbegin(log_likelihoods1), std::cend(log_likelihoods1), LogProbability {0});
-    }
-    if (z == 4) {
-        const auto& log_likelihoods2 = likelihoods_[genotype[1]];
-        const auto& log_likelihoods3 = likelihoods_[genotype[2]];
-        const auto& log_likelihoods4 = likelihoods_[genotype[3]];
-        return maths::inner_product(std::cbegin(log_likelihoods1), std::cend(log_likelihoods1),
-                                    std::cbegin(log_likelihoods2), std::cbegin(log_likelihoods3),
-                                    std::cbegin(log_likelihoods4), LogProbability {0}, std::plus<> {},
-                                    [] (const auto a, const auto b, const auto c, const auto d) -> LogProbability {
-                                        return maths::log_sum_exp({a, b, c, d}) - ln<decltype(a)>(4);
-                                    });
+    row_buffer_.clear();
+    weight_buffer_.clear();
+    for (std::size_t i {0}; i < genotype.size(); ++i) {
+        if (i > 0 && genotype[i] == genotype[i - 1]) {
+            ++weight_buffer_.back();
+        } else {
+            row_buffer_.push_back(likelihoods[genotype[i]].data());
+            weight_buffer_.push_back(1);
+        }
     }
-    
-    // TODO
-    
-    return 0;
+    return evaluate_mixture(genotype.size(), likelihoods.num_likelihoods(), likelihoods.read_weights())
+           + likelihoods.uninformative_log_likelihood();
 }
 
+// Expects row_buffer_ to point to the likelihoods of each unique haplotype in the genotype,
+// and weight_buffer_ to hold the number of copies of each. read_weights is null unless the reads are compressed.
 ConstantMixtureGenotypeLikelihoodModel::LogProbability
-ConstantMixtureGenotypeLikelihoodModel::evaluate_polyploid(const Genotype<Haplotype>& genotype) const
+ConstantMixtureGenotypeLikelihoodModel::evaluate_mixture(const unsigned ploidy, const std::size_t num_likelihoods,
+                                                         const LogProbability* read_weights) const
 {
-    const auto ploidy = genotype.ploidy();
-    const auto z = genotype.zygosity();
-    const auto& log_likelihoods1 = likelihoods_[genotype[0]];
-    if (z == 1) {
-        return std::accumulate(std::cbegin(log_likelihoods1), std::cend(log_likelihoods1), LogProbability {0});
-    }
-    if (z == 2) {
-        const auto unique_haplotypes = genotype.copy_unique_ref();
-        const auto& log_likelihoods2 = likelihoods_[unique_haplotypes.back()];
-        const auto lnpm1 = static_cast<HaplotypeLikelihoodArray::LogProbability>(std::log(ploidy - 1));
-        if (genotype.count(unique_haplotypes.front()) == 1) {
-            return std::inner_product(std::cbegin(log_likelihoods1), std::cend(log_likelihoods1),
-                                      std::cbegin(log_likelihoods2), LogProbability {0}, std::plus<> {},
-                                      [ploidy, lnpm1] (const auto a, const auto b) -> LogProbability {
-                                          return maths::log_sum_exp(a, lnpm1 + b) - ln<decltype(a)>(ploidy);
-                                      });
-        }
-        return std::inner_product(std::cbegin(log_likelihoods1), std::cend(log_likelihoods1),
-                                  std::cbegin(log_likelihoods2), LogProbability {0}, std::plus<> {},
-                                  [ploidy, lnpm1] (const auto a, const auto b) -> LogProbability {
-                                      return maths::log_sum_exp(lnpm1 + a, b) - ln<decltype(a)>(ploidy);
-                                  });
+    assert(!row_buffer_.empty() && row_buffer_.size() == weight_buffer_.size());
+    if (row_buffer_.size() == 1) {
+        return sum(row_buffer_.front(), num_likelihoods, read_weights);
     }
-    likelihood_refs_.reserve(ploidy);
-    likelihood_refs_.push_back(log_likelihoods1);
-    std::transform(std::next(std::cbegin(genotype)), std::cend(genotype), std::back_inserter(likelihood_refs_),
-                   [this] (const auto& haplotype) -> const HaplotypeLikelihoodArray::LikelihoodVector& {
-                       return likelihoods_[haplotype]; });
-    LogProbability result {0};
-    const auto num_likelihoods = likelihood_refs_.front().get().size();
-    buffer_.resize(ploidy);
-    for (std::size_t read_idx {0}; read_idx < num_likelihoods; ++read_idx) {
-        std::transform(std::cbegin(likelihood_refs_), std::cend(likelihood_refs_), std::begin(buffer_),
-                       [read_idx] (const auto& likelihoods) noexcept { return likelihoods.get()[read_idx]; });
-        result += maths::log_sum_exp(buffer_) - ln<LogProbability>(ploidy);
+    std::transform(std::cbegin(weight_buffer_), std::cend(weight_buffer_), std::begin(weight_buffer_),
+                   [] (const auto count) { return ln_count<LogProbability>(count); });
+    return kernels::sum_log_sum_exp(row_buffer_.data(), weight_buffer_.data(), row_buffer_.size(), num_likelihoods, read_weights)
+           - sum_weights(num_likelihoods, read_weights) * ln_count<LogProbability>(ploidy);
+}
+
+// non-member methods
+
+GenotypeIndex index_genotype(const Genotype<Haplotype>& genotype, const HaplotypeLikelihoodArray& likelihoods)
+{
+    GenotypeIndex result {};
+    result.reserve(genotype.ploidy());
+    for (const auto& haplotype : genotype) {
+        result.push_back(static_cast<unsigned>(likelihoods.haplotype_index(haplotype)));
     }
-    likelihood_refs_.clear();
+    return result;
+}
+
+std::vector<GenotypeIndex> index_genotypes(const std::vector<Genotype<Haplotype>>& genotypes,
+                                           const HaplotypeLikelihoodArray& likelihoods)
+{
+    std::vector<GenotypeIndex> result(genotypes.size());
+    std::transform(std::cbegin(genotypes), std::cend(genotypes), std::begin(result),
+                   [&] (const auto& genotype) { return index_genotype(genotype, likelihoods); });
     return result;
 }
 
@@ -5,6 +5,9 @@
 #define constant_mixture_genotype_likelihood_model_hpp
 
 #include <vector>
+#include <cstddef>
+
+#include <boost/optional.hpp>
 
 #include "core/types/haplotype.hpp"
 #include "core/types/genotype.hpp"
@@ -22,6 +25,9 @@ public:
     ConstantMixtureGenotypeLikelihoodModel(const HaplotypeLikelihoodArray& likelihoods);
     ConstantMixtureGenotypeLikelihoodModel(const HaplotypeLikelihoodArray& likelihoods,
                                            const std::vector<Haplotype>& haplotypes);
+    // Evaluates the merged samples as if they were a single sample. The array need not be primed,
+    // and nothing is memoised.
+    ConstantMixtureGenotypeLikelihoodModel(HaplotypeLikelihoodArray::MergedSampleLikelihoods likelihoods);
     
     ConstantMixtureGenotypeLikelihoodModel(const ConstantMixtureGenotypeLikelihoodModel&)            = default;
     ConstantMixtureGenotypeLikelihoodModel& operator=(const ConstantMixtureGenotypeLikelihoodModel&) = delete;
@@ -32,7 +38,11 @@ public:
     
     const HaplotypeLikelihoodArray& cache() const noexcept;
     
-    void prime(const std::vector<Haplotype>& haplotypes);
+    // Models sharing a likelihood array may only be evaluated concurrently if primed without memoisation,
+    // as memoised likelihoods are stored in the array.
+    void prime(const std::vector<Haplotype>& haplotypes, bool memoise = true);
+    // Primes with every haplotype in the likelihood array, so genotypes are indexed by array haplotype index
+    void prime(bool memoise = true);
     void unprime() noexcept;
     bool is_primed() const noexcept;
     
@@ -41,18 +51,34 @@ public:
     
 private:
     const HaplotypeLikelihoodArray& likelihoods_;
+    boost::optional<HaplotypeLikelihoodArray::MergedSampleLikelihoods> merged_likelihoods_;
+    // Sample major if merged
     std::vector<HaplotypeLikelihoodArray::LikelihoodVectorRef> indexed_likelihoods_;
-    mutable std::vector<HaplotypeLikelihoodArray::LikelihoodVectorRef> likelihood_refs_;
-    mutable std::vector<HaplotypeLikelihoodArray::LogProbability> buffer_;
+    std::size_t num_indexed_haplotypes_ = 0;
+    std::vector<unsigned> indexed_haplotype_indices_; // indices in likelihoods_
+    mutable GenotypeLikelihoodTable::HaplotypeIndexTuple key_buffer_;
+    mutable std::vector<const HaplotypeLikelihoodArray::StoredLogProbability*> row_buffer_;
+    mutable std::vector<HaplotypeLikelihoodArray::LogProbability> weight_buffer_;
+    const LogProbability* indexed_read_weights_ = nullptr;
+    LogProbability indexed_uninformative_log_likelihood_ = 0;
+    
+    // The primed sample's likelihoods, compressed if the array uses read compression
+    HaplotypeLikelihoodArray::SampleLikelihoods sample_likelihoods() const noexcept;
+    template <typename F> void for_each_sample(F&& f) const;
+    void index(const std::vector<std::size_t>& haplotype_indices, bool memoise);
+    LogProbability evaluate_unmemoised(const HaplotypeLikelihoodArray::SampleLikelihoods& likelihoods,
+                                       const GenotypeLikelihoodTable::HaplotypeIndexTuple& genotype) const;
+    LogProbability evaluate_unmemoised(const GenotypeIndex& genotype) const;
+    template <typename F> LogProbability memoise(F&& evaluate) const;
     
-    // These are just for optimisation
-    LogProbability evaluate_haploid(const Genotype<Haplotype>& genotype) const;
-    LogProbability evaluate_diploid(const Genotype<Haplotype>& genotype) const;
-    LogProbability evaluate_triploid(const Genotype<Haplotype>& genotype) const;
-    LogProbability evaluate_tetraploid(const Genotype<Haplotype>& genotype) const;
-    LogProbability evaluate_polyploid(const Genotype<Haplotype>& genotype) const;
+    LogProbability evaluate_mixture(unsigned ploidy, std::size_t num_likelihoods, const LogProbability* read_weights) const;
 };
 
+// Indexes genotypes by likelihood array haplotype index, for models primed with every haplotype in the array
+GenotypeIndex index_genotype(const Genotype<Haplotype>& genotype, const HaplotypeLikelihoodArray& likelihoods);
+std::vector<GenotypeIndex> index_genotypes(const std::vector<Genotype<Haplotype>>& genotypes,
+                                           const HaplotypeLikelihoodArray& likelihoods);
+
 template <typename Container1, typename Container2>
 Container2&
 evaluate(const Container1& genotypes, const ConstantMixtureGenotypeLikelihoodModel& model, Container2& result)
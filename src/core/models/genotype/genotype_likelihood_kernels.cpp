@@ -0,0 +1,147 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "genotype_likelihood_kernels.hpp"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "core/models/pairhmm/simd_pair_hmm.hpp"
+
+namespace octopus { namespace model { namespace kernels {
+
+namespace detail {
+
+namespace {
+
+template <typename T>
+double scalar_sum_log_sum_exp(const T* const* rows, const double* weights, const std::size_t num_rows,
+                              const std::size_t first, const std::size_t last, const double* read_weights) noexcept
+{
+    const auto weight = [weights] (const std::size_t k) { return weights ? weights[k] : 0.0; };
+    double result {0};
+    for (auto i = first; i < last; ++i) {
+        auto max = -std::numeric_limits<double>::infinity();
+        for (std::size_t k {0}; k < num_rows; ++k) {
+            max = std::max(max, rows[k][i] + weight(k));
+        }
+        if (max == -std::numeric_limits<double>::infinity()) return max;
+        double sum {0};
+        for (std::size_t k {0}; k < num_rows; ++k) {
+            sum += std::exp(rows[k][i] + weight(k) - max);
+        }
+        result += (read_weights ? read_weights[i] : 1.0) * (max + std::log(sum));
+    }
+    return result;
+}
+
+template <typename T>
+T scalar_inner_product(const T* lhs, const T* rhs, const std::size_t first, const std::size_t last) noexcept
+{
+    T result {0};
+    for (auto i = first; i < last; ++i) result += lhs[i] * rhs[i];
+    return result;
+}
+
+} // namespace
+
+double sum_log_sum_exp(const double* const* rows, const double* weights, const std::size_t num_rows,
+                       const std::size_t first, const std::size_t last, const double* read_weights) noexcept
+{
+    return scalar_sum_log_sum_exp(rows, weights, num_rows, first, last, read_weights);
+}
+
+double sum_log_sum_exp(const float* const* rows, const double* weights, const std::size_t num_rows,
+                       const std::size_t first, const std::size_t last, const double* read_weights) noexcept
+{
+    return scalar_sum_log_sum_exp(rows, weights, num_rows, first, last, read_weights);
+}
+
+float inner_product(const float* lhs, const float* rhs, const std::size_t first, const std::size_t last) noexcept
+{
+    return scalar_inner_product(lhs, rhs, first, last);
+}
+
+double inner_product(const double* lhs, const double* rhs, const std::size_t first, const std::size_t last) noexcept
+{
+    return scalar_inner_product(lhs, rhs, first, last);
+}
+
+} // namespace detail
+
+namespace {
+
+template <typename T>
+double dispatch_sum_log_sum_exp(const T* const* rows, const double* weights, const std::size_t num_rows,
+                                const std::size_t n, const double* read_weights) noexcept
+{
+    using hmm::simd::InstructionSet;
+    switch (hmm::simd::get_instruction_set()) {
+#if defined(__x86_64__) || defined(__i386__)
+        case InstructionSet::avx512:
+            return avx512::sum_log_sum_exp(rows, weights, num_rows, n, read_weights);
+        case InstructionSet::avx2:
+            return avx2::sum_log_sum_exp(rows, weights, num_rows, n, read_weights);
+#elif defined(__aarch64__)
+        case InstructionSet::neon:
+            return neon::sum_log_sum_exp(rows, weights, num_rows, n, read_weights);
+#endif
+        default:
+            return detail::sum_log_sum_exp(rows, weights, num_rows, 0, n, read_weights);
+    }
+}
+
+} // namespace
+
+double sum_log_sum_exp(const double* const* rows, const double* weights, const std::size_t num_rows,
+                       const std::size_t n, const double* read_weights) noexcept
+{
+    return dispatch_sum_log_sum_exp(rows, weights, num_rows, n, read_weights);
+}
+
+double sum_log_sum_exp(const float* const* rows, const double* weights, const std::size_t num_rows,
+                       const std::size_t n, const double* read_weights) noexcept
+{
+    return dispatch_sum_log_sum_exp(rows, weights, num_rows, n, read_weights);
+}
+
+float inner_product(const float* lhs, const float* rhs, const std::size_t n) noexcept
+{
+    using hmm::simd::InstructionSet;
+    switch (hmm::simd::get_instruction_set()) {
+#if defined(__x86_64__) || defined(__i386__)
+        case InstructionSet::avx512:
+            return avx512::inner_product(lhs, rhs, n);
+        case InstructionSet::avx2:
+            return avx2::inner_product(lhs, rhs, n);
+#elif defined(__aarch64__)
+        case InstructionSet::neon:
+            return neon::inner_product(lhs, rhs, n);
+#endif
+        default:
+            return detail::inner_product(lhs, rhs, 0, n);
+    }
+}
+
+double inner_product(const double* lhs, const double* rhs, const std::size_t n) noexcept
+{
+    using hmm::simd::InstructionSet;
+    switch (hmm::simd::get_instruction_set()) {
+#if defined(__x86_64__) || defined(__i386__)
+        case InstructionSet::avx512:
+            return avx512::inner_product(lhs, rhs, n);
+        case InstructionSet::avx2:
+            return avx2::inner_product(lhs, rhs, n);
+#elif defined(__aarch64__)
+        case InstructionSet::neon:
+            return neon::inner_product(lhs, rhs, n);
+#endif
+        default:
+            return detail::inner_product(lhs, rhs, 0, n);
+    }
+}
+
+} // namespace kernels
+} // namespace model
+} // namespace octopus
@@ -0,0 +1,94 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef genotype_likelihood_kernels_hpp
+#define genotype_likelihood_kernels_hpp
+
+#include <cstddef>
+
+namespace octopus { namespace model { namespace kernels {
+
+// Returns sum {i < n} ln sum {k < num_rows} exp(rows[k][i] + weights[k]), i.e. the log likelihood of
+// n reads under a mixture of num_rows haplotypes with (unnormalised) log mixture weights. weights may be null
+// if all weights are zero. If read_weights is not null then each term i is multiplied by read_weights[i].
+//
+// The kernel is selected at runtime: AVX2, AVX-512, and AArch64 (NEON) hosts use vectorised exp/log
+// approximations (relative error around 1e-15 per read), otherwise a scalar log-sum-exp loop is used.
+double sum_log_sum_exp(const double* const* rows, const double* weights, std::size_t num_rows, std::size_t n,
+                       const double* read_weights = nullptr) noexcept;
+// As above for single precision likelihoods, which are widened so the sums are still in double precision
+double sum_log_sum_exp(const float* const* rows, const double* weights, std::size_t num_rows, std::size_t n,
+                       const double* read_weights = nullptr) noexcept;
+
+// Returns sum {i < n} lhs[i] * rhs[i]. The vectorised kernels accumulate in several lanes, so the summation
+// order (and hence rounding) differs from a sequential loop.
+float inner_product(const float* lhs, const float* rhs, std::size_t n) noexcept;
+double inner_product(const double* lhs, const double* rhs, std::size_t n) noexcept;
+
+namespace detail {
+
+// Taylor coefficients of exp(r), for |r| <= ln(2) / 2
+constexpr double expCoefficients[] {
+    1.0, 1.0, 1.0 / 2, 1.0 / 6, 1.0 / 24, 1.0 / 120, 1.0 / 720, 1.0 / 5040, 1.0 / 40320,
+    1.0 / 362880, 1.0 / 3628800, 1.0 / 39916800, 1.0 / 479001600
+};
+constexpr double ln2Hi {6.93145751953125e-1}, ln2Lo {1.42860682030941723212e-6};
+constexpr double log2e {1.4426950408889634074};
+// exp(x) is treated as zero below this
+constexpr double minExpArgument {-700.0};
+
+// ln(m) = 2 * atanh(s) where s = (m - 1) / (m + 1), for m in [0.7, 1.5)
+constexpr double logCoefficients[] {
+    1.0, 1.0 / 3, 1.0 / 5, 1.0 / 7, 1.0 / 9, 1.0 / 11, 1.0 / 13, 1.0 / 15, 1.0 / 17, 1.0 / 19, 1.0 / 21, 1.0 / 23
+};
+constexpr double ln2 {6.93147180559945309417e-1};
+
+// The scalar kernel for reads [first, last), used for the tails of the vectorised kernels
+double sum_log_sum_exp(const double* const* rows, const double* weights, std::size_t num_rows,
+                       std::size_t first, std::size_t last, const double* read_weights) noexcept;
+double sum_log_sum_exp(const float* const* rows, const double* weights, std::size_t num_rows,
+                       std::size_t first, std::size_t last, const double* read_weights) noexcept;
+
+float inner_product(const float* lhs, const float* rhs, std::size_t first, std::size_t last) noexcept;
+double inner_product(const double* lhs, const double* rhs, std::size_t first, std::size_t last) noexcept;
+
+} // namespace detail
+
+namespace avx2 {
+
+double sum_log_sum_exp(const double* const* rows, const double* weights, std::size_t num_rows, std::size_t n,
+                       const double* read_weights) noexcept;
+double sum_log_sum_exp(const float* const* rows, const double* weights, std::size_t num_rows, std::size_t n,
+                       const double* read_weights) noexcept;
+float inner_product(const float* lhs, const float* rhs, std::size_t n) noexcept;
+double inner_product(const double* lhs, const double* rhs, std::size_t n) noexcept;
+
+} // namespace avx2
+
+namespace avx512 {
+
+double sum_log_sum_exp(const double* const* rows, const double* weights, std::size_t num_rows, std::size_t n,
+                       const double* read_weights) noexcept;
+double sum_log_sum_exp(const float* const* rows, const double* weights, std::size_t num_rows, std::size_t n,
+                       const double* read_weights) noexcept;
+float inner_product(const float* lhs, const float* rhs, std::size_t n) noexcept;
+double inner_product(const double* lhs, const double* rhs, std::size_t n) noexcept;
+
+} // namespace avx512
+
+namespace neon {
+
+double sum_log_sum_exp(const double* const* rows, const double* weights, std::size_t num_rows, std::size_t n,
+                       const double* read_weights) noexcept;
+double sum_log_sum_exp(const float* const* rows, const double* weights, std::size_t num_rows, std::size_t n,
+                       const double* read_weights) noexcept;
+float inner_product(const float* lhs, const float* rhs, std::size_t n) noexcept;
+double inner_product(const double* lhs, const double* rhs, std::size_t n) noexcept;
+
+} // namespace neon
+
+} // namespace kernels
+} // namespace model
+} // namespace octopus
+
+#endif
@@ -8,11 +8,10 @@
 #include <algorithm>
 #include <iterator>
 #include <cmath>
+#include <cassert>
 
 #include "utils/maths.hpp"
 
-#include <iostream>
-
 namespace octopus {
 
 HardyWeinbergModel::HardyWeinbergModel(Haplotype reference)
@@ -20,6 +19,8 @@ HardyWeinbergModel::HardyWeinbergModel(Haplotype reference)
 , reference_idx_ {}
 , haplotype_frequencies_ {}
 , haplotype_idx_frequencies_ {}
+, log_frequencies_ {}
+, count_buffer_ {}
 , empirical_ {false}
 {}
 
@@ -28,6 +29,8 @@ HardyWeinbergModel::HardyWeinbergModel(unsigned reference_idx)
 , reference_idx_ {reference_idx}
 , haplotype_frequencies_ {}
 , haplotype_idx_frequencies_ {}
+, log_frequencies_ {}
+, count_buffer_ {}
 , empirical_ {false}
 {}
 
@@ -36,6 +39,8 @@ HardyWeinbergModel::HardyWeinbergModel(HaplotypeFrequencyMap haplotype_frequenci
 , reference_idx_ {}
 , haplotype_frequencies_ {std::move(haplotype_frequencies)}
 , haplotype_idx_frequencies_ {}
+, log_frequencies_ {}
+, count_buffer_ {}
 , empirical_ {true}
 {}
 
@@ -44,6 +49,8 @@ HardyWeinbergModel::HardyWeinbergModel(HaplotypeFrequencyVector haplotype_freque
 , reference_idx_ {}
 , haplotype_frequencies_ {}
 , haplotype_idx_frequencies_ {std::move(haplotype_frequencies)}
+, log_frequencies_ {}
+, count_buffer_ {}
 , empirical_ {true}
 {}
 
@@ -251,29 +258,60 @@ void fill_frequencies(const Range& genotypes, HardyWeinbergModel::HaplotypeFrequ
 }
 
 template <typename Range>
-void fill_frequencies(const Range& genotypes, HardyWeinbergModel::HaplotypeFrequencyVector& result)
+auto joint_evaluate(const Range& genotypes, const HardyWeinbergModel& model)
 {
-    unsigned max_haplotype_idx {0}, n {0};
-    for (const auto& genotype : genotypes) {
-        for (auto haplotype_idx : get(genotype)) {
-            max_haplotype_idx = std::max(max_haplotype_idx, haplotype_idx);
-            ++n;
-        }
-    }
-    result.resize(max_haplotype_idx + 1);
-    const auto weight = 1.0 / n;
-    for (const auto& genotype : genotypes) {
-        for (auto haplotype_idx : get(genotype)) {
-            result[haplotype_idx] += weight;
+    return std::accumulate(std::cbegin(genotypes), std::cend(genotypes), 0.0,
+                           [&model] (auto curr, const auto& genotype) { return curr + model.evaluate(get(genotype)); });
+}
+
+double ln(const unsigned n) noexcept
+{
+    static constexpr unsigned tableSize {1024};
+    static const auto table = [] () {
+        std::vector<double> result(tableSize);
+        for (unsigned i {1}; i < tableSize; ++i) result[i] = std::log(i);
+        return result;
+    }();
+    return n < tableSize ? table[n] : std::log(n);
+}
+
+HardyWeinbergModel::LogProbability log_genotype_coefficient(const GenotypeIndex& genotype)
+{
+    static const double ln2 {std::log(2.0)};
+    switch (genotype.size()) {
+        case 1: return 0;
+        case 2: return genotype[0] == genotype[1] ? 0 : ln2;
+        default: {
+            auto sorted_genotype = genotype;
+            std::sort(std::begin(sorted_genotype), std::end(sorted_genotype));
+            std::vector<unsigned> counts {};
+            counts.reserve(genotype.size());
+            unique_counts(sorted_genotype, counts);
+            return maths::log_multinomial_coefficient<double>(counts);
         }
     }
 }
 
+// As joint_evaluate with the frequencies of the genotypes themselves, which are ratios of counts,
+// so the logs of the counts are looked up rather than computing the log of each frequency.
 template <typename Range>
-auto joint_evaluate(const Range& genotypes, const HardyWeinbergModel& model)
+auto joint_evaluate_with_sample_frequencies(const Range& genotypes, std::vector<unsigned>& counts)
 {
-    return std::accumulate(std::cbegin(genotypes), std::cend(genotypes), 0.0,
-                           [&model] (auto curr, const auto& genotype) { return curr + model.evaluate(get(genotype)); });
+    unsigned n {0};
+    for (const auto& genotype : genotypes) {
+        for (auto idx : get(genotype)) {
+            if (idx >= counts.size()) counts.resize(idx + 1);
+            ++counts[idx];
+            ++n;
+        }
+    }
+    HardyWeinbergModel::LogProbability result {0};
+    for (const auto& genotype : genotypes) {
+        result += log_genotype_coefficient(get(genotype));
+        for (auto idx : get(genotype)) result += ln(counts[idx]);
+    }
+    counts.clear();
+    return result - n * ln(n);
 }
 
 } // namespace
@@ -311,12 +349,7 @@ HardyWeinbergModel::LogProbability HardyWeinbergModel::evaluate(const GenotypeIn
     if (empirical_) {
         return joint_evaluate(genotypes, *this);
     } else {
-        fill_frequencies(genotypes, haplotype_idx_frequencies_);
-        empirical_ = true;
-        auto result = joint_evaluate(genotypes, *this);
-        haplotype_idx_frequencies_.clear();
-        empirical_ = false;
-        return result;
+        return joint_evaluate_with_sample_frequencies(genotypes, count_buffer_);
     }
 }
 
@@ -325,12 +358,44 @@ HardyWeinbergModel::LogProbability HardyWeinbergModel::evaluate(const GenotypeIn
     if (empirical_) {
         return joint_evaluate(genotypes, *this);
     } else {
-        fill_frequencies(genotypes, haplotype_idx_frequencies_);
-        empirical_ = true;
-        auto result = joint_evaluate(genotypes, *this);
-        haplotype_idx_frequencies_.clear();
-        empirical_ = false;
-        return result;
+        return joint_evaluate_with_sample_frequencies(genotypes, count_buffer_);
+    }
+}
+
+HardyWeinbergModel::PackedGenotypeIndices HardyWeinbergModel::pack(const GenotypeIndexVector& genotypes)
+{
+    PackedGenotypeIndices result {};
+    if (genotypes.empty()) return result;
+    result.ploidy = genotypes.front().size();
+    const auto num_genotypes = genotypes.size();
+    result.indices.resize(result.ploidy * num_genotypes);
+    result.log_coefficients.reserve(num_genotypes);
+    for (std::size_t i {0}; i < num_genotypes; ++i) {
+        assert(genotypes[i].size() == result.ploidy);
+        for (unsigned j {0}; j < result.ploidy; ++j) {
+            result.indices[j * num_genotypes + i] = genotypes[i][j];
+        }
+        result.log_coefficients.push_back(log_genotype_coefficient(genotypes[i]));
+    }
+    return result;
+}
+
+void HardyWeinbergModel::evaluate(const PackedGenotypeIndices& genotypes, std::vector<LogProbability>& result) const
+{
+    assert(empirical_);
+    log_frequencies_.resize(haplotype_idx_frequencies_.size());
+    std::transform(std::cbegin(haplotype_idx_frequencies_), std::cend(haplotype_idx_frequencies_), std::begin(log_frequencies_),
+                   [] (auto frequency) { return std::log(frequency); });
+    result.assign(std::cbegin(genotypes.log_coefficients), std::cend(genotypes.log_coefficients));
+    // Haplotype major so each pass is a gather and add the compiler can vectorise
+    const auto num_genotypes = genotypes.size();
+    const auto* log_frequencies = log_frequencies_.data();
+    auto* log_probabilities = result.data();
+    for (unsigned j {0}; j < genotypes.ploidy; ++j) {
+        const auto* indices = genotypes.indices.data() + j * num_genotypes;
+        for (std::size_t i {0}; i < num_genotypes; ++i) {
+            log_probabilities[i] += log_frequencies[indices[i]];
+        }
     }
 }
 
@@ -7,6 +7,7 @@
 #include <vector>
 #include <unordered_map>
 #include <functional>
+#include <cstddef>
 
 #include <boost/optional.hpp>
 
@@ -28,6 +29,18 @@ public:
     using HaplotypeFrequencyMap    = std::unordered_map<Haplotype, double>;
     using HaplotypeFrequencyVector = std::vector<double>;
     
+    // Genotypes of one ploidy laid out for evaluating in bulk, e.g. against the changing
+    // frequencies of an EM. indices[j * size() + i] is the j'th haplotype of genotype i.
+    struct PackedGenotypeIndices
+    {
+        unsigned ploidy;
+        std::vector<unsigned> indices;
+        std::vector<LogProbability> log_coefficients;
+        std::size_t size() const noexcept { return log_coefficients.size(); }
+    };
+    
+    static PackedGenotypeIndices pack(const GenotypeIndexVector& genotypes);
+    
     HardyWeinbergModel() = default;
     
     HardyWeinbergModel(Haplotype reference);
@@ -56,11 +69,16 @@ public:
     LogProbability evaluate(const GenotypeIndexVector& genotypes) const;
     LogProbability evaluate(const GenotypeIndexReferenceVector& genotypes) const;
     
+    // Requires index frequencies. result[i] is the log probability of genotype i.
+    void evaluate(const PackedGenotypeIndices& genotypes, std::vector<LogProbability>& result) const;
+    
 private:
     boost::optional<Haplotype> reference_;
     boost::optional<unsigned> reference_idx_;
     mutable HaplotypeFrequencyMap haplotype_frequencies_;
     mutable HaplotypeFrequencyVector haplotype_idx_frequencies_;
+    mutable std::vector<LogProbability> log_frequencies_;
+    mutable std::vector<unsigned> count_buffer_;
     mutable bool empirical_;
 };
 
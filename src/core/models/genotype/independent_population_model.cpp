@@ -3,12 +3,28 @@
 
 #include "independent_population_model.hpp"
 
+#include <algorithm>
+#include <numeric>
+#include <cassert>
+
+#include "utils/maths.hpp"
+#include "constant_mixture_genotype_likelihood_model.hpp"
+
 namespace octopus { namespace model {
 
 IndependentPopulationModel::IndependentPopulationModel(const GenotypePriorModel& genotype_prior_model,
                                                        boost::optional<logging::DebugLogger> debug_log,
                                                        boost::optional<logging::TraceLogger> trace_log)
+: IndependentPopulationModel {genotype_prior_model, Options {}, debug_log, trace_log}
+{}
+
+IndependentPopulationModel::IndependentPopulationModel(const GenotypePriorModel& genotype_prior_model,
+                                                       Options options,
+                                                       boost::optional<logging::DebugLogger> debug_log,
+                                                       boost::optional<logging::TraceLogger> trace_log)
 : individual_model_ {genotype_prior_model, debug_log, trace_log}
+, options_ {options}
+, is_logging_ {debug_log || trace_log}
 {}
 
 IndependentPopulationModel::InferredLatents
@@ -27,6 +43,41 @@ IndependentPopulationModel::evaluate(const SampleVector& samples,
     return result;
 }
 
+IndependentPopulationModel::InferredLatents
+IndependentPopulationModel::evaluate(const SampleVector& samples,
+                                     const GenotypeVector& genotypes,
+                                     const std::vector<GenotypeIndex>& genotype_indices,
+                                     const std::vector<Haplotype>& haplotypes,
+                                     const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+{
+    assert(genotypes.size() == genotype_indices.size());
+    if (is_logging_) return evaluate(samples, genotypes, haplotype_likelihoods);
+    // The priors do not depend on the sample so are only evaluated once
+    const auto genotype_log_priors = octopus::evaluate(genotype_indices, individual_model_.prior_model());
+    // Priming the array is not thread safe, so each sample's likelihood model is primed up front
+    const bool is_parallel {options_.workers && samples.size() > 1};
+    std::vector<ConstantMixtureGenotypeLikelihoodModel> likelihood_models {};
+    likelihood_models.reserve(samples.size());
+    for (const auto& sample : samples) {
+        haplotype_likelihoods.prime(sample);
+        likelihood_models.emplace_back(haplotype_likelihoods);
+        likelihood_models.back().prime(haplotypes, !is_parallel);
+    }
+    haplotype_likelihoods.unprime();
+    InferredLatents result {};
+    result.posteriors.genotype_probabilities.resize(samples.size());
+    std::vector<double> log_evidences(samples.size());
+    parallel_for(is_parallel ? options_.workers : nullptr, samples.size(), [&] (const std::size_t s) {
+        auto& posteriors = result.posteriors.genotype_probabilities[s];
+        octopus::model::evaluate(genotype_indices, likelihood_models[s], posteriors);
+        std::transform(std::cbegin(posteriors), std::cend(posteriors), std::cbegin(genotype_log_priors),
+                       std::begin(posteriors), std::plus<> {});
+        log_evidences[s] = maths::normalise_exp(posteriors);
+    });
+    result.log_evidence = std::accumulate(std::cbegin(log_evidences), std::cend(log_evidences), 0.0);
+    return result;
+}
+
 IndependentPopulationModel::InferredLatents
 IndependentPopulationModel::evaluate(const SampleVector& samples,
                                      const std::vector<GenotypeVectorReference>& genotypes,
@@ -17,6 +17,7 @@
 #include "core/models/haplotype_likelihood_array.hpp"
 #include "containers/probability_matrix.hpp"
 #include "logging/logging.hpp"
+#include "utils/thread_pool.hpp"
 
 namespace octopus { namespace model {
 
@@ -39,11 +40,20 @@ public:
         double log_evidence;
     };
     
+    struct Options
+    {
+        ThreadPool* workers = nullptr; // optional, used for per-sample evaluation
+    };
+    
     IndependentPopulationModel() = delete;
     
     IndependentPopulationModel(const GenotypePriorModel& genotype_prior_model,
                                boost::optional<logging::DebugLogger> debug_log = boost::none,
                                boost::optional<logging::TraceLogger> trace_log = boost::none);
+    IndependentPopulationModel(const GenotypePriorModel& genotype_prior_model,
+                               Options options,
+                               boost::optional<logging::DebugLogger> debug_log = boost::none,
+                               boost::optional<logging::TraceLogger> trace_log = boost::none);
     
     IndependentPopulationModel(const IndependentPopulationModel&)            = delete;
     IndependentPopulationModel& operator=(const IndependentPopulationModel&) = delete;
@@ -57,6 +67,14 @@ public:
                              const GenotypeVector& genotypes,
                              const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
     
+    // All samples have same ploidy. The genotype prior model must be primed with haplotypes.
+    // Samples are evaluated concurrently if there are workers.
+    InferredLatents evaluate(const SampleVector& samples,
+                             const GenotypeVector& genotypes,
+                             const std::vector<GenotypeIndex>& genotype_indices,
+                             const std::vector<Haplotype>& haplotypes,
+                             const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
+    
     // Samples have different ploidy
     InferredLatents evaluate(const SampleVector& samples,
                              const std::vector<GenotypeVectorReference>& genotypes,
@@ -64,6 +82,8 @@ public:
 
 private:
     IndividualModel individual_model_;
+    Options options_;
+    bool is_logging_;
 };
 
 } // namesapce model
@@ -7,6 +7,7 @@
 #include <algorithm>
 #include <cmath>
 #include <cassert>
+#include <limits>
 #include <iostream>
 
 #include "utils/maths.hpp"
@@ -65,9 +66,82 @@ void print_genotype_likelihoods(const std::vector<Genotype<Haplotype>>& genotype
 IndividualModel::InferredLatents
 IndividualModel::evaluate(const std::vector<Genotype<Haplotype>>& genotypes,
                           const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+{
+    return evaluate(genotypes, ConstantMixtureGenotypeLikelihoodModel {haplotype_likelihoods});
+}
+
+IndividualModel::InferredLatents
+IndividualModel::evaluate(const std::vector<Genotype<Haplotype>>& genotypes,
+                          const std::vector<GenotypeIndex>& genotype_indices,
+                          const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+{
+    ConstantMixtureGenotypeLikelihoodModel likelihood_model {haplotype_likelihoods};
+    return evaluate(genotypes, genotype_indices, likelihood_model);
+}
+
+IndividualModel::InferredLatents
+IndividualModel::evaluate(const std::vector<Genotype<Haplotype>>& genotypes,
+                          const HaplotypeLikelihoodArray::MergedSampleLikelihoods& haplotype_likelihoods) const
+{
+    return evaluate(genotypes, ConstantMixtureGenotypeLikelihoodModel {haplotype_likelihoods});
+}
+
+IndividualModel::InferredLatents
+IndividualModel::evaluate(const std::vector<Genotype<Haplotype>>& genotypes,
+                          const std::vector<GenotypeIndex>& genotype_indices,
+                          const HaplotypeLikelihoodArray::MergedSampleLikelihoods& haplotype_likelihoods) const
+{
+    ConstantMixtureGenotypeLikelihoodModel likelihood_model {haplotype_likelihoods};
+    return evaluate(genotypes, genotype_indices, likelihood_model);
+}
+
+IndividualModel::InferredLatents
+IndividualModel::evaluate(const std::vector<GenotypeIndex>& genotype_indices,
+                          const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+{
+    assert(!genotype_indices.empty());
+    assert(is_primed());
+    ConstantMixtureGenotypeLikelihoodModel likelihood_model {haplotype_likelihoods, *haplotypes_};
+    InferredLatents result {};
+    result.posteriors.genotype_probabilities = octopus::model::evaluate(genotype_indices, likelihood_model);
+    if (debug_log_ || trace_log_) {
+        const auto genotypes = make_genotypes(genotype_indices, *haplotypes_);
+        debug::log_genotype_likelihoods(debug_log_, trace_log_, genotypes, result.posteriors.genotype_probabilities);
+    }
+    octopus::evaluate(genotype_indices, genotype_prior_model_, result.posteriors.genotype_probabilities, false, true);
+    result.log_evidence = maths::normalise_exp(result.posteriors.genotype_probabilities);
+    return result;
+}
+
+double
+IndividualModel::evaluate_log_evidence(const unsigned ploidy, const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+{
+    assert(is_primed());
+    ConstantMixtureGenotypeLikelihoodModel likelihood_model {haplotype_likelihoods};
+    // Each genotype is only evaluated once, so memoising would just fill the likelihood table
+    likelihood_model.prime(*haplotypes_, false);
+    // Running log-sum-exp, rescaled whenever the maximum increases
+    auto max_log_probability = std::numeric_limits<double>::lowest();
+    double scaled_sum {0};
+    for (GenotypeIndexGenerator genotypes {static_cast<unsigned>(haplotypes_->size()), ploidy}; !genotypes.done(); genotypes.next()) {
+        const auto log_probability = likelihood_model.evaluate(genotypes.index()) + genotype_prior_model_.evaluate(genotypes.index());
+        if (log_probability > max_log_probability) {
+            scaled_sum = scaled_sum * std::exp(max_log_probability - log_probability) + 1;
+            max_log_probability = log_probability;
+        } else {
+            scaled_sum += std::exp(log_probability - max_log_probability);
+        }
+    }
+    return max_log_probability + std::log(scaled_sum);
+}
+
+// private methods
+
+IndividualModel::InferredLatents
+IndividualModel::evaluate(const std::vector<Genotype<Haplotype>>& genotypes,
+                          const ConstantMixtureGenotypeLikelihoodModel& likelihood_model) const
 {
     assert(!genotypes.empty());
-    const ConstantMixtureGenotypeLikelihoodModel likelihood_model {haplotype_likelihoods};
     auto posteriors = octopus::model::evaluate(genotypes, likelihood_model);
     debug::log_genotype_likelihoods(debug_log_, trace_log_, genotypes, posteriors);
     octopus::evaluate(genotypes, genotype_prior_model_, posteriors, false, true);
@@ -78,11 +152,10 @@ IndividualModel::evaluate(const std::vector<Genotype<Haplotype>>& genotypes,
 IndividualModel::InferredLatents
 IndividualModel::evaluate(const std::vector<Genotype<Haplotype>>& genotypes,
                           const std::vector<GenotypeIndex>& genotype_indices,
-                          const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+                          ConstantMixtureGenotypeLikelihoodModel& likelihood_model) const
 {
     assert(!genotypes.empty());
     assert(genotypes.size() == genotype_indices.size());
-    ConstantMixtureGenotypeLikelihoodModel likelihood_model {haplotype_likelihoods};
     InferredLatents result {};
     if (is_primed()) {
         likelihood_model.prime(*haplotypes_);
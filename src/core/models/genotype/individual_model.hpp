@@ -16,6 +16,8 @@
 
 namespace octopus { namespace model {
 
+class ConstantMixtureGenotypeLikelihoodModel;
+
 class IndividualModel
 {
 public:
@@ -57,12 +59,34 @@ public:
                              const std::vector<GenotypeIndex>& genotype_indices,
                              const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
     
+    // The merged samples are evaluated as a single sample
+    InferredLatents evaluate(const std::vector<Genotype<Haplotype>>& genotypes,
+                             const HaplotypeLikelihoodArray::MergedSampleLikelihoods& haplotype_likelihoods) const;
+    
+    InferredLatents evaluate(const std::vector<Genotype<Haplotype>>& genotypes,
+                             const std::vector<GenotypeIndex>& genotype_indices,
+                             const HaplotypeLikelihoodArray::MergedSampleLikelihoods& haplotype_likelihoods) const;
+    
+    // Requires the model to be primed; genotypes are only realised for logging
+    InferredLatents evaluate(const std::vector<GenotypeIndex>& genotype_indices,
+                             const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
+    
+    // Requires the model to be primed; the log evidence over all genotypes of the ploidy, which are
+    // streamed rather than materialised
+    double evaluate_log_evidence(unsigned ploidy, const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
+    
 private:
     const GenotypePriorModel& genotype_prior_model_;
     const std::vector<Haplotype>* haplotypes_;
     
     mutable boost::optional<logging::DebugLogger> debug_log_;
     mutable boost::optional<logging::TraceLogger> trace_log_;
+    
+    InferredLatents evaluate(const std::vector<Genotype<Haplotype>>& genotypes,
+                             const ConstantMixtureGenotypeLikelihoodModel& likelihood_model) const;
+    InferredLatents evaluate(const std::vector<Genotype<Haplotype>>& genotypes,
+                             const std::vector<GenotypeIndex>& genotype_indices,
+                             ConstantMixtureGenotypeLikelihoodModel& likelihood_model) const;
 };
 
 } // namesapce model
@@ -0,0 +1,136 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "genotype_likelihood_kernels.hpp"
+
+#include <limits>
+#include <cstdint>
+
+#include <arm_neon.h>
+
+namespace octopus { namespace model { namespace kernels { namespace neon {
+
+namespace {
+
+float64x2_t exp(float64x2_t x) noexcept
+{
+    // NaN (from -inf - -inf) is mapped to minExpArgument too, as vmaxnm prefers the number
+    x = vmaxnmq_f64(x, vdupq_n_f64(detail::minExpArgument));
+    const auto n = vrndnq_f64(vmulq_f64(x, vdupq_n_f64(detail::log2e)));
+    x = vsubq_f64(x, vmulq_f64(n, vdupq_n_f64(detail::ln2Hi)));
+    x = vsubq_f64(x, vmulq_f64(n, vdupq_n_f64(detail::ln2Lo)));
+    constexpr int numCoefficients {sizeof(detail::expCoefficients) / sizeof(double)};
+    auto p = vdupq_n_f64(detail::expCoefficients[numCoefficients - 1]);
+    for (int j {numCoefficients - 2}; j >= 0; --j) {
+        p = vaddq_f64(vmulq_f64(p, x), vdupq_n_f64(detail::expCoefficients[j]));
+    }
+    const auto exponent = vaddq_s64(vcvtq_s64_f64(n), vdupq_n_s64(1023));
+    const auto scale = vreinterpretq_f64_s64(vshlq_n_s64(exponent, 52));
+    return vmulq_f64(p, scale);
+}
+
+// x must be positive and normal
+float64x2_t log(const float64x2_t x) noexcept
+{
+    const auto bits = vreinterpretq_u64_f64(x);
+    const auto magic = vdupq_n_u64(0x4330000000000000); // 2^52
+    auto e = vreinterpretq_f64_u64(vorrq_u64(vshrq_n_u64(bits, 52), magic));
+    e = vsubq_f64(e, vdupq_n_f64(4503599627370496.0 + 1023));
+    auto m = vreinterpretq_f64_u64(vorrq_u64(vandq_u64(bits, vdupq_n_u64(0x000fffffffffffff)),
+                                             vdupq_n_u64(0x3ff0000000000000)));
+    const auto is_large = vcgtq_f64(m, vdupq_n_f64(1.41421356237309504880));
+    m = vbslq_f64(is_large, vmulq_f64(m, vdupq_n_f64(0.5)), m);
+    const auto one = vdupq_n_f64(1.0);
+    e = vaddq_f64(e, vreinterpretq_f64_u64(vandq_u64(is_large, vreinterpretq_u64_f64(one))));
+    const auto s = vdivq_f64(vsubq_f64(m, one), vaddq_f64(m, one));
+    const auto z = vmulq_f64(s, s);
+    constexpr int numCoefficients {sizeof(detail::logCoefficients) / sizeof(double)};
+    auto p = vdupq_n_f64(detail::logCoefficients[numCoefficients - 1]);
+    for (int j {numCoefficients - 2}; j >= 0; --j) {
+        p = vaddq_f64(vmulq_f64(p, z), vdupq_n_f64(detail::logCoefficients[j]));
+    }
+    const auto ln_m = vmulq_f64(vaddq_f64(s, s), p);
+    return vaddq_f64(vmulq_f64(e, vdupq_n_f64(detail::ln2)), ln_m);
+}
+
+float64x2_t load_weight(const double* weights, const std::size_t k) noexcept
+{
+    return vdupq_n_f64(weights ? weights[k] : 0.0);
+}
+
+float64x2_t load(const double* values) noexcept
+{
+    return vld1q_f64(values);
+}
+
+float64x2_t load(const float* values) noexcept
+{
+    return vcvt_f64_f32(vld1_f32(values));
+}
+
+template <typename T>
+double sum_log_sum_exp_rows(const T* const* rows, const double* weights, const std::size_t num_rows,
+                            const std::size_t n, const double* read_weights) noexcept
+{
+    constexpr std::size_t stride {2};
+    const auto neg_inf = vdupq_n_f64(-std::numeric_limits<double>::infinity());
+    auto result = vdupq_n_f64(0.0);
+    std::size_t i {0};
+    for (; i + stride <= n; i += stride) {
+        auto max = neg_inf;
+        for (std::size_t k {0}; k < num_rows; ++k) {
+            max = vmaxq_f64(max, vaddq_f64(load(rows[k] + i), load_weight(weights, k)));
+        }
+        if (vmaxvq_u32(vreinterpretq_u32_u64(vceqq_f64(max, neg_inf))) != 0) return -std::numeric_limits<double>::infinity();
+        auto sum = vdupq_n_f64(0.0);
+        for (std::size_t k {0}; k < num_rows; ++k) {
+            const auto x = vaddq_f64(load(rows[k] + i), load_weight(weights, k));
+            sum = vaddq_f64(sum, exp(vsubq_f64(x, max)));
+        }
+        auto term = vaddq_f64(max, log(sum));
+        if (read_weights) term = vmulq_f64(term, vld1q_f64(read_weights + i));
+        result = vaddq_f64(result, term);
+    }
+    return vaddvq_f64(result) + detail::sum_log_sum_exp(rows, weights, num_rows, i, n, read_weights);
+}
+
+} // namespace
+
+double sum_log_sum_exp(const double* const* rows, const double* weights, const std::size_t num_rows,
+                       const std::size_t n, const double* read_weights) noexcept
+{
+    return sum_log_sum_exp_rows(rows, weights, num_rows, n, read_weights);
+}
+
+double sum_log_sum_exp(const float* const* rows, const double* weights, const std::size_t num_rows,
+                       const std::size_t n, const double* read_weights) noexcept
+{
+    return sum_log_sum_exp_rows(rows, weights, num_rows, n, read_weights);
+}
+
+float inner_product(const float* lhs, const float* rhs, const std::size_t n) noexcept
+{
+    constexpr std::size_t stride {4};
+    auto result = vdupq_n_f32(0.0f);
+    std::size_t i {0};
+    for (; i + stride <= n; i += stride) {
+        result = vaddq_f32(result, vmulq_f32(vld1q_f32(lhs + i), vld1q_f32(rhs + i)));
+    }
+    return vaddvq_f32(result) + detail::inner_product(lhs, rhs, i, n);
+}
+
+double inner_product(const double* lhs, const double* rhs, const std::size_t n) noexcept
+{
+    constexpr std::size_t stride {2};
+    auto result = vdupq_n_f64(0.0);
+    std::size_t i {0};
+    for (; i + stride <= n; i += stride) {
+        result = vaddq_f64(result, vmulq_f64(vld1q_f64(lhs + i), vld1q_f64(rhs + i)));
+    }
+    return vaddvq_f64(result) + detail::inner_product(lhs, rhs, i, n);
+}
+
+} // namespace neon
+} // namespace kernels
+} // namespace model
+} // namespace octopus
@@ -8,10 +8,12 @@
 #include <algorithm>
 #include <cmath>
 #include <limits>
+#include <memory>
 #include <cassert>
 
 #include "utils/maths.hpp"
 #include "utils/select_top_k.hpp"
+#include "utils/thread_pool.hpp"
 #include "constant_mixture_genotype_likelihood_model.hpp"
 #include "hardy_weinberg_model.hpp"
 
@@ -41,12 +43,7 @@ namespace {
 using GenotypeLogLikelihoodVector  = std::vector<double>;
 using GenotypeLogLikelihoodMatrix  = std::vector<GenotypeLogLikelihoodVector>;
 
-struct GenotypeLogProbability
-{
-    const Genotype<Haplotype>& genotype;
-    double log_probability;
-};
-using GenotypeLogMarginalVector = std::vector<GenotypeLogProbability>;
+using GenotypeLogMarginalVector = std::vector<double>;
 
 using GenotypeMarginalPosteriorVector  = std::vector<double>;
 using GenotypeMarginalPosteriorMatrix  = std::vector<GenotypeMarginalPosteriorVector>; // for each sample
@@ -102,12 +99,34 @@ struct EMOptions
 {
     unsigned max_iterations;
     double epsilon;
+    ThreadPool* workers = nullptr;
+    const std::vector<double>* initial_frequencies = nullptr;
 };
 
+auto make_genotype_indices(const std::vector<Haplotype>& haplotypes, const std::vector<Genotype<Haplotype>>& genotypes)
+{
+    using HaplotypeReference = std::reference_wrapper<const Haplotype>;
+    std::unordered_map<HaplotypeReference, unsigned> haplotype_indices {haplotypes.size()};
+    for (unsigned i {0}; i < haplotypes.size(); ++i) {
+        haplotype_indices.emplace(haplotypes[i], i);
+    }
+    std::vector<GenotypeIndex> result {};
+    result.reserve(genotypes.size());
+    for (const auto& genotype : genotypes) {
+        GenotypeIndex indices {};
+        indices.reserve(genotype.ploidy());
+        for (const auto& haplotype : genotype) {
+            indices.push_back(haplotype_indices.at(haplotype));
+        }
+        result.push_back(std::move(indices));
+    }
+    return result;
+}
+
 struct ModelConstants
 {
-    const std::vector<Haplotype>& haplotypes;
-    const std::vector<Genotype<Haplotype>>& genotypes;
+    const std::size_t num_haplotypes;
+    const HardyWeinbergModel::PackedGenotypeIndices genotypes;
     const GenotypeLogLikelihoodMatrix& genotype_log_likilhoods;
     const unsigned ploidy;
     const double frequency_update_norm;
@@ -116,8 +135,8 @@ struct ModelConstants
     ModelConstants(const std::vector<Haplotype>& haplotypes,
                    const std::vector<Genotype<Haplotype>>& genotypes,
                    const GenotypeLogLikelihoodMatrix& genotype_log_likilhoods)
-    : haplotypes {haplotypes}
-    , genotypes {genotypes}
+    : num_haplotypes {haplotypes.size()}
+    , genotypes {HardyWeinbergModel::pack(make_genotype_indices(haplotypes, genotypes))}
     , genotype_log_likilhoods {genotype_log_likilhoods}
     , ploidy {genotypes.front().ploidy()}
     , frequency_update_norm {calculate_frequency_update_norm(genotype_log_likilhoods.size(), ploidy)}
@@ -127,8 +146,8 @@ struct ModelConstants
                    const std::vector<Genotype<Haplotype>>& genotypes,
                    const std::vector<GenotypeIndex>& genotype_indices,
                    const GenotypeLogLikelihoodMatrix& genotype_log_likilhoods)
-    : haplotypes {haplotypes}
-    , genotypes {genotypes}
+    : num_haplotypes {haplotypes.size()}
+    , genotypes {HardyWeinbergModel::pack(genotype_indices)}
     , genotype_log_likilhoods {genotype_log_likilhoods}
     , ploidy {genotypes.front().ploidy()}
     , frequency_update_norm {calculate_frequency_update_norm(genotype_log_likilhoods.size(), ploidy)}
@@ -136,13 +155,13 @@ struct ModelConstants
     {}
 };
 
-HardyWeinbergModel make_hardy_weinberg_model(const ModelConstants& constants)
+HardyWeinbergModel make_hardy_weinberg_model(const ModelConstants& constants, const EMOptions& options)
 {
-    HardyWeinbergModel::HaplotypeFrequencyMap frequencies {constants.haplotypes.size()};
-    for (const auto& haplotype : constants.haplotypes) {
-        frequencies.emplace(haplotype, 1.0 / constants.haplotypes.size());
+    if (options.initial_frequencies && options.initial_frequencies->size() == constants.num_haplotypes) {
+        return HardyWeinbergModel {*options.initial_frequencies};
+    } else {
+        return HardyWeinbergModel {HardyWeinbergModel::HaplotypeFrequencyVector(constants.num_haplotypes, 1.0 / constants.num_haplotypes)};
     }
-    return HardyWeinbergModel {std::move(frequencies)};
 }
 
 GenotypeLogLikelihoodMatrix
@@ -151,39 +170,52 @@ compute_genotype_log_likelihoods(const std::vector<SampleName>& samples,
                                  const HaplotypeLikelihoodArray& haplotype_likelihoods)
 {
     assert(!genotypes.empty());
+    // The genotype haplotypes are only looked up once, rather than once per sample
+    const auto genotype_indices = index_genotypes(genotypes, haplotype_likelihoods);
+    ConstantMixtureGenotypeLikelihoodModel likelihood_model {haplotype_likelihoods};
+    GenotypeLogLikelihoodMatrix result {};
+    result.reserve(samples.size());
+    for (const auto& sample : samples) {
+        haplotype_likelihoods.prime(sample);
+        likelihood_model.prime();
+        result.push_back(octopus::model::evaluate(genotype_indices, likelihood_model));
+        likelihood_model.unprime();
+    }
+    return result;
+}
+
+GenotypeLogLikelihoodMatrix
+compute_genotype_log_likelihoods(const std::vector<SampleName>& samples,
+                                 const std::vector<GenotypeIndex>& genotype_indices,
+                                 const std::vector<Haplotype>& haplotypes,
+                                 const HaplotypeLikelihoodArray& haplotype_likelihoods)
+{
+    assert(!genotype_indices.empty());
     ConstantMixtureGenotypeLikelihoodModel likelihood_model {haplotype_likelihoods};
     GenotypeLogLikelihoodMatrix result {};
     result.reserve(samples.size());
-    std::transform(std::cbegin(samples), std::cend(samples), std::back_inserter(result),
-                   [&genotypes, &haplotype_likelihoods, &likelihood_model] (const auto& sample) {
-                       GenotypeLogLikelihoodVector likelihoods(genotypes.size());
-                       haplotype_likelihoods.prime(sample);
-                       std::transform(std::cbegin(genotypes), std::cend(genotypes), std::begin(likelihoods),
-                                      [&likelihood_model] (const auto& genotype) {
-                                          return likelihood_model.evaluate(genotype);
-                                      });
-                       return likelihoods;
-                   });
+    for (const auto& sample : samples) {
+        haplotype_likelihoods.prime(sample);
+        likelihood_model.prime(haplotypes);
+        result.push_back(octopus::model::evaluate(genotype_indices, likelihood_model));
+        likelihood_model.unprime();
+    }
     return result;
 }
 
 GenotypeLogMarginalVector
-init_genotype_log_marginals(const std::vector<Genotype<Haplotype>>& genotypes,
-                            const HardyWeinbergModel& hw_model)
+init_genotype_log_marginals(const ModelConstants& constants, const HardyWeinbergModel& hw_model)
 {
     GenotypeLogMarginalVector result {};
-    result.reserve(genotypes.size());
-    for (const auto& genotype : genotypes) {
-        result.push_back({genotype, hw_model.evaluate(genotype)});
-    }
+    hw_model.evaluate(constants.genotypes, result);
     return result;
 }
 
 void update_genotype_log_marginals(GenotypeLogMarginalVector& current_log_marginals,
+                                   const ModelConstants& constants,
                                    const HardyWeinbergModel& hw_model)
 {
-    std::for_each(std::begin(current_log_marginals), std::end(current_log_marginals),
-                  [&hw_model] (auto& p) { p.log_probability = hw_model.evaluate(p.genotype); });
+    hw_model.evaluate(constants.genotypes, current_log_marginals);
 }
 
 GenotypeMarginalPosteriorMatrix
@@ -196,8 +228,8 @@ init_genotype_posteriors(const GenotypeLogMarginalVector& genotype_log_marginals
         GenotypeMarginalPosteriorVector posteriors(genotype_log_marginals.size());
         std::transform(std::cbegin(genotype_log_marginals), std::cend(genotype_log_marginals),
                        std::cbegin(sample_genotype_log_likilhoods), std::begin(posteriors),
-                       [] (const auto& genotype_log_marginal, const auto genotype_log_likilhood) {
-                           return genotype_log_marginal.log_probability + genotype_log_likilhood;
+                       [] (const auto genotype_log_marginal, const auto genotype_log_likilhood) {
+                           return genotype_log_marginal + genotype_log_likilhood;
                        });
         maths::normalise_exp(posteriors);
         result.emplace_back(std::move(posteriors));
@@ -207,41 +239,54 @@ init_genotype_posteriors(const GenotypeLogMarginalVector& genotype_log_marginals
 
 void update_genotype_posteriors(GenotypeMarginalPosteriorMatrix& current_genotype_posteriors,
                                 const GenotypeLogMarginalVector& genotype_log_marginals,
-                                const GenotypeLogLikelihoodMatrix& genotype_log_likilhoods)
+                                const GenotypeLogLikelihoodMatrix& genotype_log_likilhoods,
+                                ThreadPool* workers = nullptr)
 {
-    auto likelihood_itr = std::cbegin(genotype_log_likilhoods);
-    for (auto& sample_genotype_posteriors : current_genotype_posteriors) {
+    parallel_for(workers, current_genotype_posteriors.size(), [&] (const std::size_t sample_idx) {
+        auto& sample_genotype_posteriors = current_genotype_posteriors[sample_idx];
         std::transform(std::cbegin(genotype_log_marginals), std::cend(genotype_log_marginals),
-                       std::cbegin(*likelihood_itr++), std::begin(sample_genotype_posteriors),
-                       [] (const auto& log_marginal, const auto& log_likeilhood) {
-                           return log_marginal.log_probability + log_likeilhood;
+                       std::cbegin(genotype_log_likilhoods[sample_idx]), std::begin(sample_genotype_posteriors),
+                       [] (const auto log_marginal, const auto log_likeilhood) {
+                           return log_marginal + log_likeilhood;
                        });
         maths::normalise_exp(sample_genotype_posteriors);
-    }
+    });
 }
 
-auto collapse_genotype_posteriors(const GenotypeMarginalPosteriorMatrix& genotype_posteriors)
+auto collapse_genotype_posteriors(const GenotypeMarginalPosteriorMatrix& genotype_posteriors,
+                                  ThreadPool* workers = nullptr)
 {
     assert(!genotype_posteriors.empty());
     std::vector<double> result(genotype_posteriors.front().size());
-    for (const auto& sample_posteriors : genotype_posteriors) {
-        std::transform(std::cbegin(result), std::cend(result), std::cbegin(sample_posteriors), std::begin(result),
-                       [] (const auto curr, const auto p) { return curr + p; });
+    if (workers) {
+        // Each genotype is summed over samples in sample order, so the reduction is the same as the serial one
+        parallel_for(workers, result.size(), [&] (const std::size_t genotype_idx) {
+            double sum {0};
+            for (const auto& sample_posteriors : genotype_posteriors) {
+                sum += sample_posteriors[genotype_idx];
+            }
+            result[genotype_idx] = sum;
+        });
+    } else {
+        for (const auto& sample_posteriors : genotype_posteriors) {
+            std::transform(std::cbegin(result), std::cend(result), std::cbegin(sample_posteriors), std::begin(result),
+                           [] (const auto curr, const auto p) { return curr + p; });
+        }
     }
     return result;
 }
 
-double update_haplotype_frequencies(const std::vector<Haplotype>& haplotypes,
-                                    HardyWeinbergModel& hw_model,
+double update_haplotype_frequencies(HardyWeinbergModel& hw_model,
                                     const GenotypeMarginalPosteriorMatrix& genotype_posteriors,
                                     const InverseGenotypeTable& genotypes_containing_haplotypes,
-                                    const double frequency_update_norm)
+                                    const double frequency_update_norm,
+                                    ThreadPool* workers = nullptr)
 {
-    const auto collaped_posteriors = collapse_genotype_posteriors(genotype_posteriors);
+    const auto collaped_posteriors = collapse_genotype_posteriors(genotype_posteriors, workers);
     double max_frequency_change {0};
-    auto& current_haplotype_frequencies = hw_model.frequencies();
-    for (std::size_t i {0}; i < haplotypes.size(); ++i) {
-        auto& current_frequency = current_haplotype_frequencies.at(haplotypes[i]);
+    auto& current_haplotype_frequencies = hw_model.index_frequencies();
+    for (std::size_t i {0}; i < current_haplotype_frequencies.size(); ++i) {
+        auto& current_frequency = current_haplotype_frequencies[i];
         double new_frequency {0};
         for (const auto& genotype_index : genotypes_containing_haplotypes[i]) {
             new_frequency += collaped_posteriors[genotype_index];
@@ -259,15 +304,16 @@ double update_haplotype_frequencies(const std::vector<Haplotype>& haplotypes,
 double do_em_iteration(GenotypeMarginalPosteriorMatrix& genotype_posteriors,
                        HardyWeinbergModel& hw_model,
                        GenotypeLogMarginalVector& genotype_log_marginals,
-                       const ModelConstants& constants)
+                       const ModelConstants& constants,
+                       const EMOptions& options)
 {
-    const auto max_change = update_haplotype_frequencies(constants.haplotypes,
-                                                         hw_model,
+    const auto max_change = update_haplotype_frequencies(hw_model,
                                                          genotype_posteriors,
                                                          constants.genotypes_containing_haplotypes,
-                                                         constants.frequency_update_norm);
-    update_genotype_log_marginals(genotype_log_marginals, hw_model);
-    update_genotype_posteriors(genotype_posteriors, genotype_log_marginals, constants.genotype_log_likilhoods);
+                                                         constants.frequency_update_norm,
+                                                         options.workers);
+    update_genotype_log_marginals(genotype_log_marginals, constants, hw_model);
+    update_genotype_posteriors(genotype_posteriors, genotype_log_marginals, constants.genotype_log_likilhoods, options.workers);
     return max_change;
 }
 
@@ -275,24 +321,35 @@ void run_em(GenotypeMarginalPosteriorMatrix& genotype_posteriors,
             HardyWeinbergModel& hw_model,
             GenotypeLogMarginalVector& genotype_log_marginals,
             const ModelConstants& constants, const EMOptions options,
-            boost::optional<logging::TraceLogger> trace_log = boost::none)
+            boost::optional<logging::DebugLogger>& debug_log)
 {
-    for (unsigned n {1}; n <= options.max_iterations; ++n) {
-        const auto max_change = do_em_iteration(genotype_posteriors, hw_model, genotype_log_marginals,constants);
+    unsigned n {1};
+    double max_change {0};
+    for (; n <= options.max_iterations; ++n) {
+        max_change = do_em_iteration(genotype_posteriors, hw_model, genotype_log_marginals, constants, options);
         if (max_change <= options.epsilon) break;
     }
+    if (debug_log) {
+        if (n <= options.max_iterations) {
+            stream(*debug_log) << "Population EM converged after " << n << " iterations";
+        } else {
+            stream(*debug_log) << "Population EM stopped after " << options.max_iterations
+                               << " iterations without converging (max frequency change " << max_change << ")";
+        }
+    }
 }
 
 auto compute_approx_genotype_marginal_posteriors(const std::vector<Haplotype>& haplotypes,
                                                  const std::vector<Genotype<Haplotype>>& genotypes,
                                                  const GenotypeLogLikelihoodMatrix& genotype_likelihoods,
-                                                 const EMOptions options)
+                                                 const EMOptions options,
+                                                 boost::optional<logging::DebugLogger>& debug_log)
 {
     const ModelConstants constants {haplotypes, genotypes, genotype_likelihoods};
-    auto hw_model = make_hardy_weinberg_model(constants);
-    auto genotype_log_marginals = init_genotype_log_marginals(genotypes, hw_model);
+    auto hw_model = make_hardy_weinberg_model(constants, options);
+    auto genotype_log_marginals = init_genotype_log_marginals(constants, hw_model);
     auto result = init_genotype_posteriors(genotype_log_marginals, genotype_likelihoods);
-    run_em(result, hw_model, genotype_log_marginals, constants, options);
+    run_em(result, hw_model, genotype_log_marginals, constants, options, debug_log);
     return result;
 }
 
@@ -300,22 +357,26 @@ auto compute_approx_genotype_marginal_posteriors(const std::vector<Haplotype>& h
                                                  const std::vector<Genotype<Haplotype>>& genotypes,
                                                  const std::vector<GenotypeIndex>& genotype_indices,
                                                  const GenotypeLogLikelihoodMatrix& genotype_likelihoods,
-                                                 const EMOptions options)
+                                                 const EMOptions options,
+                                                 boost::optional<logging::DebugLogger>& debug_log)
 {
     const ModelConstants constants {haplotypes, genotypes, genotype_indices, genotype_likelihoods};
-    auto hw_model = make_hardy_weinberg_model(constants);
-    auto genotype_log_marginals = init_genotype_log_marginals(genotypes, hw_model);
+    auto hw_model = make_hardy_weinberg_model(constants, options);
+    auto genotype_log_marginals = init_genotype_log_marginals(constants, hw_model);
     auto result = init_genotype_posteriors(genotype_log_marginals, genotype_likelihoods);
-    run_em(result, hw_model, genotype_log_marginals, constants, options);
+    run_em(result, hw_model, genotype_log_marginals, constants, options, debug_log);
     return result;
 }
 
 auto compute_approx_genotype_marginal_posteriors(const std::vector<Genotype<Haplotype>>& genotypes,
                                                  const GenotypeLogLikelihoodMatrix& genotype_likelihoods,
-                                                 const EMOptions options)
+                                                 const EMOptions options,
+                                                 boost::optional<logging::DebugLogger>& debug_log)
 {
     const auto haplotypes = extract_unique_elements(genotypes);
-    return compute_approx_genotype_marginal_posteriors(haplotypes, genotypes, genotype_likelihoods, options);
+    auto extracted_options = options;
+    extracted_options.initial_frequencies = nullptr; // not in the order of the extracted haplotypes
+    return compute_approx_genotype_marginal_posteriors(haplotypes, genotypes, genotype_likelihoods, extracted_options, debug_log);
 }
 
 using GenotypeCombinationVector = std::vector<std::size_t>;
@@ -428,7 +489,8 @@ select_top_k_genotypes(const std::vector<Genotype<Haplotype>>& genotypes,
 
 auto propose_joint_genotypes(const std::vector<Genotype<Haplotype>>& genotypes,
                              const GenotypeMarginalPosteriorMatrix& em_genotype_marginals,
-                             const std::size_t max_joint_genotypes)
+                             const std::size_t max_joint_genotypes,
+                             const double max_mass_loss)
 {
     const auto num_samples = em_genotype_marginals.size();
     assert(max_joint_genotypes >= num_samples * genotypes.size());
@@ -436,7 +498,7 @@ auto propose_joint_genotypes(const std::vector<Genotype<Haplotype>>& genotypes,
     if (num_joint_genotypes <= max_joint_genotypes) {
         return generate_all_genotype_combinations(genotypes.size(), num_samples);
     }
-    auto result = select_top_k_tuples(em_genotype_marginals, max_joint_genotypes);
+    auto result = select_top_k_probable_tuples(em_genotype_marginals, max_joint_genotypes, max_mass_loss);
     const auto top_k_genotype_indices = select_top_k_genotypes(genotypes, em_genotype_marginals, num_samples / 2);
     for (const auto genotype_idx : top_k_genotype_indices) {
         for (std::size_t sample_idx {0}; sample_idx < num_samples; ++sample_idx) {
@@ -453,7 +515,11 @@ auto propose_joint_genotypes(const std::vector<Genotype<Haplotype>>& genotypes,
     if (hom_ref_idx) {
         std::vector<std::size_t> ref_indices(num_samples, *hom_ref_idx);
         if (std::find(std::cbegin(result), std::cend(result), ref_indices) == std::cend(result)) {
-            result.back() = std::move(ref_indices);
+            if (result.size() < max_joint_genotypes) {
+                result.push_back(std::move(ref_indices));
+            } else {
+                result.back() = std::move(ref_indices);
+            }
         }
     }
     return result;
@@ -551,6 +617,18 @@ void calculate_posterior_marginals(const std::vector<T>& genotypes,
     result.log_evidence = norm;
 }
 
+EMOptions make_em_options(const PopulationModel::Options& options, const std::size_t num_samples)
+{
+    EMOptions result {options.max_em_iterations, options.em_epsilon};
+    if (options.workers && num_samples >= options.min_parallel_em_samples) {
+        result.workers = options.workers;
+    }
+    if (!options.initial_haplotype_frequencies.empty()) {
+        result.initial_frequencies = std::addressof(options.initial_haplotype_frequencies);
+    }
+    return result;
+}
+
 } // namespace
 
 PopulationModel::InferredLatents
@@ -565,9 +643,10 @@ PopulationModel::evaluate(const SampleVector& samples, const GenotypeVector& gen
         const auto joint_genotypes = generate_all_genotype_combinations(genotypes.size(), samples.size());
         calculate_posterior_marginals(genotypes, joint_genotypes, genotype_log_likelihoods, prior_model_, result);
     } else {
-        const EMOptions em_options {options_.max_em_iterations, options_.em_epsilon};
-        const auto em_genotype_marginals = compute_approx_genotype_marginal_posteriors(genotypes, genotype_log_likelihoods, em_options);
-        const auto joint_genotypes = propose_joint_genotypes(genotypes, em_genotype_marginals, options_.max_joint_genotypes);
+        const auto em_options = make_em_options(options_, samples.size());
+        const auto em_genotype_marginals = compute_approx_genotype_marginal_posteriors(genotypes, genotype_log_likelihoods, em_options, debug_log_);
+        const auto joint_genotypes = propose_joint_genotypes(genotypes, em_genotype_marginals, options_.max_joint_genotypes,
+                                                               options_.max_joint_genotype_mass_loss);
         calculate_posterior_marginals(genotypes, joint_genotypes, genotype_log_likelihoods, prior_model_, result);
     }
     return result;
@@ -581,17 +660,19 @@ PopulationModel::evaluate(const SampleVector& samples,
                           const HaplotypeLikelihoodArray& haplotype_likelihoods) const
 {
     assert(!genotypes.empty());
-    const auto genotype_log_likelihoods = compute_genotype_log_likelihoods(samples, genotypes, haplotype_likelihoods);
+    assert(genotypes.size() == genotype_indices.size());
+    const auto genotype_log_likelihoods = compute_genotype_log_likelihoods(samples, genotype_indices, haplotypes, haplotype_likelihoods);
     const auto num_joint_genotypes = num_combinations(genotypes.size(), samples.size());
     InferredLatents result;
     if (num_joint_genotypes <= options_.max_joint_genotypes) {
         const auto joint_genotypes = generate_all_genotype_combinations(genotypes.size(), samples.size());
-        calculate_posterior_marginals(genotypes, joint_genotypes, genotype_log_likelihoods, prior_model_, result);
+        calculate_posterior_marginals(genotype_indices, joint_genotypes, genotype_log_likelihoods, prior_model_, result);
     } else {
-        const EMOptions em_options {options_.max_em_iterations, options_.em_epsilon};
+        const auto em_options = make_em_options(options_, samples.size());
         const auto em_genotype_marginals = compute_approx_genotype_marginal_posteriors(haplotypes, genotypes, genotype_indices,
-                                                                                       genotype_log_likelihoods, em_options);
-        const auto joint_genotypes = propose_joint_genotypes(genotypes, em_genotype_marginals, options_.max_joint_genotypes);
+                                                                                       genotype_log_likelihoods, em_options, debug_log_);
+        const auto joint_genotypes = propose_joint_genotypes(genotypes, em_genotype_marginals, options_.max_joint_genotypes,
+                                                               options_.max_joint_genotype_mass_loss);
         calculate_posterior_marginals(genotype_indices, joint_genotypes, genotype_log_likelihoods, prior_model_, result);
     }
     return result;
@@ -17,7 +17,11 @@
 #include "containers/probability_matrix.hpp"
 #include "logging/logging.hpp"
 
-namespace octopus { namespace model {
+namespace octopus {
+
+class ThreadPool;
+
+namespace model {
 
 class PopulationModel
 {
@@ -25,8 +29,15 @@ public:
     struct Options
     {
         std::size_t max_joint_genotypes = 1'000'000;
+        // When there are too many joint genotypes to evaluate, proposals stop once they cover all but this
+        // much of the approximate (EM) joint posterior mass
+        double max_joint_genotype_mass_loss = 1e-10;
         unsigned max_em_iterations = 100;
         double em_epsilon = 0.001;
+        ThreadPool* workers = nullptr; // optional, used for the EM E-step
+        std::size_t min_parallel_em_samples = 64;
+        // optional, initial EM haplotype frequencies in the order of the given haplotypes
+        std::vector<double> initial_haplotype_frequencies = {};
     };
     struct Latents
     {
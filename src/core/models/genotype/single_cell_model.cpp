@@ -12,6 +12,7 @@
 #include "utils/k_medoids.hpp"
 #include "utils/select_top_k.hpp"
 #include "utils/maths.hpp"
+#include "utils/thread_pool.hpp"
 #include "subclone_model.hpp"
 #include "population_model.hpp"
 #include "uniform_population_prior_model.hpp"
@@ -19,10 +20,22 @@
 
 namespace octopus { namespace model {
 
+namespace {
+
+auto make_posterior_model_options(const SingleCellModel::AlgorithmParameters& config)
+{
+    VariationalBayesMixtureMixtureModel::Options result {};
+    result.workers = config.workers;
+    return result;
+}
+
+} // namespace
+
 SingleCellModel::SingleCellModel(std::vector<SampleName> samples, SingleCellPriorModel prior_model,
                                  Parameters parameters, AlgorithmParameters config)
 : samples_ {std::move(samples)}
 , prior_model_ {std::move(prior_model)}
+, posterior_model_ {make_posterior_model_options(config)}
 , parameters_ {std::move(parameters)}
 , config_ {std::move(config)}
 {}
@@ -38,7 +51,9 @@ SingleCellModel::evaluate(const std::vector<Genotype<Haplotype>>& genotypes,
         for (const auto& sample : samples_) {
             subclone_priors.alphas.emplace(sample, SubcloneModel::Priors::GenotypeMixturesDirichletAlphas(ploidy, parameters_.dropout_concentration));
         }
-        SubcloneModel helper_model {samples_, std::move(subclone_priors)};
+        SubcloneModel::AlgorithmParameters helper_params {};
+        helper_params.workers = config_.workers;
+        SubcloneModel helper_model {samples_, std::move(subclone_priors), helper_params};
         auto subclone_inferences = helper_model.evaluate(genotypes, haplotype_likelihoods);
         Inferences::GroupInferences founder {};
         founder.genotype_posteriors = std::move(subclone_inferences.posteriors.genotype_probabilities);
@@ -111,16 +126,6 @@ auto select(const std::vector<std::size_t> indices, const std::vector<T>& data)
     return result;
 }
 
-auto pool_likelihood(const std::vector<SampleName>& samples,
-                     const std::vector<Haplotype>& haplotypes,
-                     const HaplotypeLikelihoodArray& haplotype_likelihoods)
-{
-    static const SampleName pooled_sample {"pool"};
-    auto result = merge_samples(samples, pooled_sample, haplotypes, haplotype_likelihoods);
-    result.prime(pooled_sample);
-    return result;
-}
-
 auto kl_divergence(const std::vector<double>& p, const std::vector<double>& q) noexcept
 {
     return std::inner_product(std::cbegin(p), std::cend(p), std::cbegin(q), 0.0,
@@ -153,6 +158,7 @@ SingleCellModel::propose_genotype_combinations(const std::vector<Genotype<Haplot
         UniformPopulationPriorModel population_prior_model {};
         PopulationModel::Options population_model_options {};
         population_model_options.max_joint_genotypes = config_.max_genotype_combinations;
+        population_model_options.workers = config_.workers;
         PopulationModel population_model {population_prior_model, population_model_options};
         const auto population_inferences = population_model.evaluate(samples_, genotypes, haplotype_likelihoods);
         const auto& population_genotype_posteriors = population_inferences.posteriors.marginal_genotype_probabilities;
@@ -163,10 +169,9 @@ SingleCellModel::propose_genotype_combinations(const std::vector<Genotype<Haplot
         IndividualModel individual_model {prior_model_.germline_prior_model()};
         std::vector<ProbabilityVector> cluster_marginal_genotype_posteriors {};
         cluster_marginal_genotype_posteriors.reserve(num_groups);
-        const auto haplotypes = extract_unique_elements(genotypes);
         for (const auto& cluster : clusters) {
             const auto cluster_samples = select(cluster, samples_);
-            const auto pooled_likelihoods = pool_likelihood(cluster_samples, haplotypes, haplotype_likelihoods);
+            const auto pooled_likelihoods = merge_samples(cluster_samples, haplotype_likelihoods);
             auto cluster_inferences = individual_model.evaluate(genotypes, pooled_likelihoods);
             cluster_marginal_genotype_posteriors.push_back(std::move(cluster_inferences.posteriors.genotype_probabilities));
         }
@@ -251,27 +256,34 @@ SingleCellModel::make_likelihood_matrix(const GenotypeCombinationVector& genotyp
                                         const std::vector<Genotype<Haplotype>>& genotypes,
                                         const HaplotypeLikelihoodArray& haplotype_likelihoods) const
 {
-    VBLikelihoodMatrix result {};
-    result.reserve(samples_.size());
-    for (const auto& sample : samples_) {
-        haplotype_likelihoods.prime(sample);
-        VariationalBayesMixtureMixtureModel::GenotypeCombinationLikelihoodVector vb_combination_likelihoods {};
+    // Haplotype lookups are done once rather than once per cell, so each cell only needs indexing
+    std::vector<std::vector<std::size_t>> genotype_haplotype_indices(genotypes.size());
+    std::transform(std::cbegin(genotypes), std::cend(genotypes), std::begin(genotype_haplotype_indices),
+                   [&] (const auto& genotype) {
+                       std::vector<std::size_t> indices {};
+                       indices.reserve(genotype.ploidy());
+                       for (const auto& haplotype : genotype) indices.push_back(haplotype_likelihoods.haplotype_index(haplotype));
+                       return indices;
+                   });
+    VBLikelihoodMatrix result(samples_.size());
+    parallel_for(config_.workers, samples_.size(), [&] (const std::size_t s) {
+        const auto sample_idx = haplotype_likelihoods.sample_index(samples_[s]);
+        auto& vb_combination_likelihoods = result[s];
         vb_combination_likelihoods.reserve(genotype_combinations.size());
         for (const auto& genotype_combination : genotype_combinations) {
             VariationalBayesMixtureMixtureModel::GenotypeLikelihoodVector vb_genotype_likelihoods {};
             vb_genotype_likelihoods.reserve(genotype_combination.size());
             for (const auto genotype_idx : genotype_combination) {
                 VariationalBayesMixtureMixtureModel::HaplotypeLikelihoodVector vb_haplotype_likelihoods {};
-                vb_haplotype_likelihoods.reserve(genotypes[genotype_idx].ploidy());
-                for (const auto& haplotype : genotypes[genotype_idx]) {
-                    vb_haplotype_likelihoods.emplace_back(haplotype_likelihoods[haplotype]);
+                vb_haplotype_likelihoods.reserve(genotype_haplotype_indices[genotype_idx].size());
+                for (const auto haplotype_idx : genotype_haplotype_indices[genotype_idx]) {
+                    vb_haplotype_likelihoods.emplace_back(haplotype_likelihoods(sample_idx, haplotype_idx));
                 }
                 vb_genotype_likelihoods.push_back(std::move(vb_haplotype_likelihoods));
             }
             vb_combination_likelihoods.push_back(std::move(vb_genotype_likelihoods));
         }
-        result.push_back(std::move(vb_combination_likelihoods));
-    }
+    });
     return result;
 }
 
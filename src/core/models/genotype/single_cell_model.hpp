@@ -41,6 +41,7 @@ public:
     {
         std::size_t max_genotype_combinations;
         unsigned max_seeds = 5;
+        ThreadPool* workers = nullptr; // optional, used for per-cell computations
     };
     
     SingleCellModel() = delete;
@@ -115,6 +115,34 @@ auto generate_exhaustive_seeds(const std::size_t n)
     return result;
 }
 
+// Without index haplotypes, genotypes are indexed by likelihood array haplotype index so that each haplotype
+// is looked up once, rather than once per sample
+const std::vector<CancerGenotypeIndex>&
+get_genotype_indices(const std::vector<CancerGenotype<Haplotype>>& genotypes,
+                     const HaplotypeLikelihoodArray& haplotype_log_likelihoods,
+                     const boost::optional<IndexData<CancerGenotypeIndex>>& index_data,
+                     std::vector<CancerGenotypeIndex>& buffer)
+{
+    if (index_data && index_data->haplotypes) return index_data->genotype_indices;
+    buffer.resize(genotypes.size());
+    std::transform(std::cbegin(genotypes), std::cend(genotypes), std::begin(buffer),
+                   [&] (const auto& genotype) -> CancerGenotypeIndex {
+                       return {index_genotype(genotype.germline(), haplotype_log_likelihoods),
+                               index_genotype(genotype.somatic(), haplotype_log_likelihoods)};
+                   });
+    return buffer;
+}
+
+template <typename GenotypeLikelihoodModel>
+void prime(GenotypeLikelihoodModel& model, const boost::optional<IndexData<CancerGenotypeIndex>>& index_data)
+{
+    if (index_data && index_data->haplotypes) {
+        model.prime(*index_data->haplotypes);
+    } else {
+        model.prime();
+    }
+}
+
 std::vector<LogProbabilityVector>
 compute_genotype_likelihoods_with_fixed_mixture_model(const std::vector<SampleName>& samples,
                                                       const std::vector<CancerGenotype<Haplotype>>& genotypes,
@@ -123,29 +151,21 @@ compute_genotype_likelihoods_with_fixed_mixture_model(const std::vector<SampleNa
                                                       boost::optional<IndexData<CancerGenotypeIndex>> index_data)
 {
     VariableMixtureGenotypeLikelihoodModel model {haplotype_log_likelihoods};
-    const bool use_genotype_indices {index_data && index_data->haplotypes};
+    std::vector<CancerGenotypeIndex> array_genotype_indices {};
+    const auto& genotype_indices = get_genotype_indices(genotypes, haplotype_log_likelihoods, index_data, array_genotype_indices);
     std::vector<LogProbabilityVector> result {};
     result.reserve(samples.size());
     for (const auto& sample : samples) {
         const auto& sample_priors = priors.at(sample);
         model.set_mixtures(maths::dirichlet_expectation(sample_priors));
         model.cache().prime(sample);
-        if (use_genotype_indices) {
-            model.prime(*index_data->haplotypes);
-            result.push_back(evaluate(index_data->genotype_indices, model));
-            model.unprime();
-        } else {
-            result.push_back(evaluate(genotypes, model));
-        }
+        prime(model, index_data);
+        result.push_back(evaluate(genotype_indices, model));
+        model.unprime();
     }
     return result;
 }
 
-auto evaluate(const CancerGenotype<Haplotype>& genotype, const ConstantMixtureGenotypeLikelihoodModel& model)
-{
-    return model.evaluate(demote(genotype));
-}
-
 auto evaluate(const CancerGenotypeIndex& genotype, const ConstantMixtureGenotypeLikelihoodModel& model)
 {
     return model.evaluate(concat(genotype.germline, genotype.somatic));
@@ -167,38 +187,19 @@ compute_genotype_likelihoods_with_germline_model(const std::vector<SampleName>&
                                                  boost::optional<IndexData<CancerGenotypeIndex>> index_data)
 {
     ConstantMixtureGenotypeLikelihoodModel model {haplotype_log_likelihoods};
-    const bool use_genotype_indices {index_data && index_data->haplotypes};
+    std::vector<CancerGenotypeIndex> array_genotype_indices {};
+    const auto& genotype_indices = get_genotype_indices(genotypes, haplotype_log_likelihoods, index_data, array_genotype_indices);
     std::vector<LogProbabilityVector> result {};
     result.reserve(samples.size());
     for (const auto& sample : samples) {
         model.cache().prime(sample);
-        if (use_genotype_indices) {
-            model.prime(*index_data->haplotypes);
-            result.push_back(evaluate(index_data->genotype_indices, model));
-            model.unprime();
-        } else {
-            result.push_back(evaluate(genotypes, model));
-        }
+        prime(model, index_data);
+        result.push_back(evaluate(genotype_indices, model));
+        model.unprime();
     }
     return result;
 }
 
-LogProbabilityVector evaluate_germlines(const std::vector<CancerGenotype<Haplotype>>& genotypes, const ConstantMixtureGenotypeLikelihoodModel& model)
-{
-    std::unordered_map<Genotype<Haplotype>, ConstantMixtureGenotypeLikelihoodModel::LogProbability> cache {};
-    cache.reserve(genotypes.size());
-    LogProbabilityVector result(genotypes.size());
-    std::transform(std::cbegin(genotypes), std::cend(genotypes), std::begin(result),
-                   [&] (const auto& genotype) {
-        const auto cache_itr = cache.find(genotype.germline());
-        if (cache_itr != std::cend(cache)) return cache_itr->second;
-        const auto result = model.evaluate(genotype.germline());
-        cache.emplace(genotype.germline(), result);
-        return result;
-    });
-    return result;
-}
-
 struct GenotypeIndexHash
 {
     std::size_t operator()(const GenotypeIndex genotype) const
@@ -230,18 +231,15 @@ compute_germline_genotype_likelihoods_with_germline_model(const std::vector<Samp
                                                           boost::optional<IndexData<CancerGenotypeIndex>> index_data)
 {
     ConstantMixtureGenotypeLikelihoodModel model {haplotype_log_likelihoods};
-    const bool use_genotype_indices {index_data && index_data->haplotypes};
+    std::vector<CancerGenotypeIndex> array_genotype_indices {};
+    const auto& genotype_indices = get_genotype_indices(genotypes, haplotype_log_likelihoods, index_data, array_genotype_indices);
     std::vector<LogProbabilityVector> result {};
     result.reserve(samples.size());
     for (const auto& sample : samples) {
         model.cache().prime(sample);
-        if (use_genotype_indices) {
-            model.prime(*index_data->haplotypes);
-            result.push_back(evaluate_germlines(index_data->genotype_indices, model));
-            model.unprime();
-        } else {
-            result.push_back(evaluate_germlines(genotypes, model));
-        }
+        prime(model, index_data);
+        result.push_back(evaluate_germlines(genotype_indices, model));
+        model.unprime();
     }
     return result;
 }
@@ -277,6 +275,47 @@ auto add_and_normalise(const LogProbabilityVector& lhs, const LogProbabilityVect
     return result;
 }
 
+namespace {
+
+double get_log_weight(const Haplotype& haplotype, const HaplotypeWeightMap& haplotype_weights)
+{
+    static constexpr double minWeight {1e-6};
+    const auto itr = haplotype_weights.find(haplotype);
+    return std::log(itr != std::cend(haplotype_weights) ? std::max(itr->second, minWeight) : minWeight);
+}
+
+double sum_log_weights(const Genotype<Haplotype>& genotype, const HaplotypeWeightMap& haplotype_weights)
+{
+    double result {0};
+    for (const auto& haplotype : genotype) result += get_log_weight(haplotype, haplotype_weights);
+    return result;
+}
+
+} // namespace
+
+LogProbabilityVector
+make_weighted_seed(const std::vector<Genotype<Haplotype>>& genotypes, const HaplotypeWeightMap& haplotype_weights)
+{
+    LogProbabilityVector result(genotypes.size());
+    std::transform(std::cbegin(genotypes), std::cend(genotypes), std::begin(result),
+                   [&] (const auto& genotype) { return sum_log_weights(genotype, haplotype_weights); });
+    maths::normalise_logs(result);
+    return result;
+}
+
+LogProbabilityVector
+make_weighted_seed(const std::vector<CancerGenotype<Haplotype>>& genotypes, const HaplotypeWeightMap& haplotype_weights)
+{
+    LogProbabilityVector result(genotypes.size());
+    std::transform(std::cbegin(genotypes), std::cend(genotypes), std::begin(result),
+                   [&] (const auto& genotype) {
+                       return sum_log_weights(genotype.germline(), haplotype_weights)
+                              + sum_log_weights(genotype.somatic(), haplotype_weights);
+                   });
+    maths::normalise_logs(result);
+    return result;
+}
+
 std::vector<LogProbabilityVector>
 generate_seeds(const std::vector<SampleName>& samples,
                const std::vector<Genotype<Haplotype>>& genotypes,
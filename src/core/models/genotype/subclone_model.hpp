@@ -5,8 +5,11 @@
 #define subclone_model_hpp
 
 #include <vector>
+#include <array>
 #include <unordered_map>
 #include <utility>
+#include <functional>
+#include <algorithm>
 
 #include <boost/optional.hpp>
 
@@ -22,6 +25,8 @@
 
 namespace octopus { namespace model {
 
+using HaplotypeWeightMap = std::unordered_map<std::reference_wrapper<const Haplotype>, double>;
+
 template <typename Genotype_, typename GenotypeIndex_, typename GenotypePriorModel_>
 class SubcloneModelBase
 {
@@ -33,6 +38,11 @@ public:
         unsigned max_seeds      = 12;
         boost::optional<MemoryFootprint> target_max_memory = boost::none;
         ExecutionPolicy execution_policy = ExecutionPolicy::seq;
+        ThreadPool* workers = nullptr; // optional, used to run seeds concurrently
+        // optional, e.g. haplotype posteriors from a previous fit. When given, a seed made from the
+        // weights is tried first and only max_warm_started_seeds other seeds are generated.
+        HaplotypeWeightMap seed_haplotype_weights = {};
+        unsigned max_warm_started_seeds = 2;
     };
     
     struct Priors
@@ -171,6 +181,11 @@ generate_seeds(const std::vector<SampleName>& samples,
                std::size_t max_seeds,
                boost::optional<IndexData<CancerGenotypeIndex>> index_data = boost::none);
 
+LogProbabilityVector
+make_weighted_seed(const std::vector<Genotype<Haplotype>>& genotypes, const HaplotypeWeightMap& haplotype_weights);
+LogProbabilityVector
+make_weighted_seed(const std::vector<CancerGenotype<Haplotype>>& genotypes, const HaplotypeWeightMap& haplotype_weights);
+
 template <std::size_t K, typename G, typename GI, typename GPM>
 VBAlpha<K> flatten(const typename SubcloneModelBase<G, GI, GPM>::Priors::GenotypeMixturesDirichletAlphas& alpha)
 {
@@ -190,67 +205,83 @@ VBAlphaVector<K> flatten(const typename SubcloneModelBase<G, GI, GPM>::Priors::G
 }
 
 template <std::size_t K>
-VBGenotype<K>
-flatten(const Genotype<Haplotype>& genotype, const SampleName& sample,
-        const HaplotypeLikelihoodArray& haplotype_likelihoods)
+using HaplotypeIndexArray = std::array<std::size_t, K>;
+
+template <std::size_t K>
+auto copy_haplotype_indices(const Genotype<Haplotype>& genotype,
+                            const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                            typename HaplotypeIndexArray<K>::iterator result_itr)
 {
-    VBGenotype<K> result {};
-    std::transform(std::cbegin(genotype), std::cend(genotype), std::begin(result),
-                   [&sample, &haplotype_likelihoods] (const Haplotype& haplotype)
-                   -> std::reference_wrapper<const VBReadLikelihoodArray::BaseType> {
-                       return std::cref(haplotype_likelihoods(sample, haplotype));
-                   });
+    return std::transform(std::cbegin(genotype), std::cend(genotype), result_itr,
+                          [&haplotype_likelihoods] (const Haplotype& haplotype) {
+                              return haplotype_likelihoods.haplotype_index(haplotype);
+                          });
+}
+
+template <std::size_t K>
+HaplotypeIndexArray<K>
+index_haplotypes(const Genotype<Haplotype>& genotype, const HaplotypeLikelihoodArray& haplotype_likelihoods)
+{
+    HaplotypeIndexArray<K> result {};
+    assert(genotype.ploidy() == K);
+    copy_haplotype_indices<K>(genotype, haplotype_likelihoods, std::begin(result));
     return result;
 }
 
 template <std::size_t K>
-auto copy_cref(const Genotype<Haplotype>& genotype, const SampleName& sample,
-               const HaplotypeLikelihoodArray& haplotype_likelihoods,
-               typename VBGenotype<K>::iterator result_itr)
+HaplotypeIndexArray<K>
+index_haplotypes(const CancerGenotype<Haplotype>& genotype, const HaplotypeLikelihoodArray& haplotype_likelihoods)
 {
-    return std::transform(std::cbegin(genotype), std::cend(genotype), result_itr,
-                          [&sample, &haplotype_likelihoods] (const Haplotype& haplotype)
-                          -> std::reference_wrapper<const VBReadLikelihoodArray::BaseType> {
-                              return std::cref(haplotype_likelihoods(sample, haplotype));
-                          });
+    HaplotypeIndexArray<K> result {};
+    assert(genotype.ploidy() == K);
+    auto itr = copy_haplotype_indices<K>(genotype.germline(), haplotype_likelihoods, std::begin(result));
+    copy_haplotype_indices<K>(genotype.somatic(), haplotype_likelihoods, itr);
+    return result;
 }
 
 template <std::size_t K>
 VBGenotype<K>
-flatten(const CancerGenotype<Haplotype>& genotype, const SampleName& sample,
-        const HaplotypeLikelihoodArray& haplotype_likelihoods)
+flatten(const HaplotypeIndexArray<K>& genotype, const HaplotypeLikelihoodArray::SampleLikelihoods& sample_likelihoods)
 {
     VBGenotype<K> result {};
-    assert(genotype.ploidy() == K);
-    auto itr = copy_cref<K>(genotype.germline(), sample, haplotype_likelihoods, std::begin(result));
-    copy_cref<K>(genotype.somatic(), sample, haplotype_likelihoods, itr);
+    std::transform(std::cbegin(genotype), std::cend(genotype), std::begin(result),
+                   [&sample_likelihoods] (const std::size_t haplotype_idx)
+                   -> std::reference_wrapper<const VBReadLikelihoodArray::BaseType> {
+                       return std::cref(sample_likelihoods[haplotype_idx]);
+                   });
     return result;
 }
 
-template <std::size_t K, typename G>
+template <std::size_t K>
 VBGenotypeVector<K>
-flatten(const std::vector<G>& genotypes, const SampleName& sample,
-        const HaplotypeLikelihoodArray& haplotype_likelihoods)
+flatten(const std::vector<HaplotypeIndexArray<K>>& genotypes,
+        const HaplotypeLikelihoodArray::SampleLikelihoods& sample_likelihoods)
 {
     VBGenotypeVector<K> result(genotypes.size());
     std::transform(std::cbegin(genotypes), std::cend(genotypes), std::begin(result),
-                   [&sample, &haplotype_likelihoods] (const auto& genotype) {
-                       return flatten<K>(genotype, sample, haplotype_likelihoods);
+                   [&sample_likelihoods] (const auto& genotype) {
+                       return flatten<K>(genotype, sample_likelihoods);
                    });
     return result;
 }
 
+// Each genotype haplotype is looked up once, and each sample's likelihoods once
 template <std::size_t K, typename G>
 VBReadLikelihoodMatrix<K>
 flatten(const std::vector<G>& genotypes,
         const std::vector<SampleName>& samples,
         const HaplotypeLikelihoodArray& haplotype_likelihoods)
 {
+    std::vector<HaplotypeIndexArray<K>> genotype_indices(genotypes.size());
+    std::transform(std::cbegin(genotypes), std::cend(genotypes), std::begin(genotype_indices),
+                   [&haplotype_likelihoods] (const auto& genotype) {
+                       return index_haplotypes<K>(genotype, haplotype_likelihoods);
+                   });
     VBReadLikelihoodMatrix<K> result {};
     result.reserve(samples.size());
     std::transform(std::cbegin(samples), std::cend(samples), std::back_inserter(result),
-                   [&genotypes, &haplotype_likelihoods] (const auto& sample) {
-                       return flatten<K>(genotypes, sample, haplotype_likelihoods);
+                   [&genotype_indices, &haplotype_likelihoods] (const auto& sample) {
+                       return flatten<K>(genotype_indices, haplotype_likelihoods.sample_likelihoods(sample));
                    });
     return result;
 }
@@ -302,6 +333,7 @@ run_variational_bayes_helper(const std::vector<SampleName>& samples,
     if (params.execution_policy == ExecutionPolicy::par) {
         vb_params.parallel_execution = true;
     }
+    vb_params.workers = params.workers;
     const auto vb_prior_alphas = flatten<K, G, GI, GPM>(prior_alphas, samples);
     const auto log_likelihoods = flatten<K>(genotypes, samples, haplotype_log_likelihoods);
     auto p = octopus::model::run_variational_bayes(vb_prior_alphas, genotype_log_priors, log_likelihoods, vb_params, std::move(seeds));
@@ -354,7 +386,13 @@ run_variational_bayes(const std::vector<SampleName>& samples,
                       boost::optional<IndexData<GI>> index_data = boost::none)
 {
     auto genotype_log_priors = evaluate_genotype_priors<G, GI, GPM>(genotypes, priors, index_data);
-    auto seeds = generate_seeds(samples, genotypes, genotype_log_priors, haplotype_log_likelihoods, priors, params.max_seeds, index_data);
+    // Exhaustive seeding is already cheap when there are few genotypes
+    const bool warm_start {!params.seed_haplotype_weights.empty() && genotypes.size() > params.max_seeds};
+    const auto max_seeds = warm_start ? std::min(params.max_seeds, params.max_warm_started_seeds) : params.max_seeds;
+    auto seeds = generate_seeds(samples, genotypes, genotype_log_priors, haplotype_log_likelihoods, priors, max_seeds, index_data);
+    if (warm_start) {
+        seeds.insert(std::begin(seeds), make_weighted_seed(genotypes, params.seed_haplotype_weights));
+    }
     return run_variational_bayes_helper<G, GI, GPM>(samples, genotypes, priors.alphas, std::move(genotype_log_priors),
                                                     haplotype_log_likelihoods, params, std::move(seeds));
 }
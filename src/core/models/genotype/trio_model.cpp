@@ -5,6 +5,9 @@
 
 #include <iterator>
 #include <algorithm>
+#include <numeric>
+#include <functional>
+#include <queue>
 #include <cmath>
 #include <random>
 #include <utility>
@@ -13,10 +16,9 @@
 #include <iostream>
 
 #include "utils/maths.hpp"
+#include "utils/append.hpp"
 #include "constant_mixture_genotype_likelihood_model.hpp"
 
-#include "timers.hpp"
-
 namespace octopus { namespace model {
 
 unsigned TrioModel::max_ploidy() noexcept
@@ -400,28 +402,88 @@ auto join_size(const ReducedVectorMap<T1>& first, const ReducedVectorMap<T2>& se
     return result;
 }
 
+ParentsProbabilityPair
+make_parents_pair(const GenotypeRefProbabilityPair& mother, const GenotypeRefProbabilityPair& father,
+                  const PopulationPriorModel& model)
+{
+    return {mother.genotype, father.genotype, joint_probability(mother, father, model),
+            mother.probability, father.probability, mother.indices, father.indices};
+}
+
+template <typename Iterator>
+auto sort_by_probability(const Iterator first, const Iterator last)
+{
+    std::vector<Iterator> result(std::distance(first, last));
+    std::iota(std::begin(result), std::end(result), first);
+    std::sort(std::begin(result), std::end(result), [] (auto lhs, auto rhs) { return lhs->probability > rhs->probability; });
+    return result;
+}
+
+struct ParentsJoinCell
+{
+    double bound;
+    std::size_t maternal, paternal;
+};
+
+bool operator<(const ParentsJoinCell& lhs, const ParentsJoinCell& rhs) noexcept
+{
+    return lhs.bound < rhs.bound;
+}
+
+// Joins the maternal and paternal genotypes without building the full cross product. The joined parts of
+// each list are sorted by likelihood and the (implicit) grid of pairs is explored best-first in order of
+// likelihood sum, which bounds the joint probability from above as the prior is a log probability. The
+// search stops once no unexplored pair can beat the best pairs found so far, or when max_joint_genotypes
+// pairs have been evaluated (the size of the cross product this replaces). The result contains the
+// top pairs by joint probability, the top pairs by likelihood, and the usual partial joins.
 auto join(const ReducedVectorMap<GenotypeRefProbabilityPair>& maternal,
           const ReducedVectorMap<GenotypeRefProbabilityPair>& paternal,
-          const PopulationPriorModel& model)
+          const PopulationPriorModel& model,
+          const TrioModel::Options& options)
 {
+    const auto sorted_maternal = sort_by_probability(maternal.first, maternal.last_to_join);
+    const auto sorted_paternal = sort_by_probability(paternal.first, paternal.last_to_join);
+    const std::size_t max_keep {std::max(get_sample_reduction_count(options.max_joint_genotypes), 1u)};
+    const auto max_evaluations = std::max(options.max_joint_genotypes, max_keep);
     std::vector<ParentsProbabilityPair> result {};
-    result.reserve(join_size(maternal, paternal));
-    std::for_each(maternal.first, maternal.last_to_join, [&] (const auto& m) {
-        std::for_each(paternal.first, paternal.last_to_join, [&] (const auto& p) {
-            result.push_back({m.genotype, p.genotype, joint_probability(m, p, model),
-                              m.probability, m.probability, m.indices, p.indices});
-        });
-    });
+    result.reserve(2 * max_keep + join_size(maternal, paternal) - sorted_maternal.size() * sorted_paternal.size());
+    std::vector<ParentsProbabilityPair> best {}; // min-heap on joint probability
+    best.reserve(max_keep + 1);
+    std::priority_queue<ParentsJoinCell> frontier {};
+    const auto push_cell = [&] (std::size_t i, std::size_t j) {
+        if (i < sorted_maternal.size() && j < sorted_paternal.size()) {
+            frontier.push({sorted_maternal[i]->probability + sorted_paternal[j]->probability, i, j});
+        }
+    };
+    push_cell(0, 0);
+    for (std::size_t num_evaluated {0}; !frontier.empty() && num_evaluated < max_evaluations; ++num_evaluated) {
+        const auto cell = frontier.top();
+        if (num_evaluated >= max_keep && best.size() == max_keep && cell.bound <= best.front().probability) break;
+        frontier.pop();
+        // Each cell is reached exactly once: rows advance along the first column only
+        push_cell(cell.maternal, cell.paternal + 1);
+        if (cell.paternal == 0) push_cell(cell.maternal + 1, 0);
+        auto pair = make_parents_pair(*sorted_maternal[cell.maternal], *sorted_paternal[cell.paternal], model);
+        if (num_evaluated < max_keep) {
+            result.push_back(std::move(pair));
+        } else if (best.size() < max_keep || pair.probability > best.front().probability) {
+            best.push_back(std::move(pair));
+            std::push_heap(std::begin(best), std::end(best), std::greater<> {});
+            if (best.size() > max_keep) {
+                std::pop_heap(std::begin(best), std::end(best), std::greater<> {});
+                best.pop_back();
+            }
+        }
+    }
+    utils::append(std::move(best), result);
     std::for_each(maternal.last_to_join, maternal.last, [&] (const auto& m) {
         std::for_each(paternal.first, paternal.last_to_partially_join, [&] (const auto& p) {
-            result.push_back({m.genotype, p.genotype, joint_probability(m, p, model),
-                              m.probability, m.probability, m.indices, p.indices});
+            result.push_back(make_parents_pair(m, p, model));
         });
     });
     std::for_each(paternal.last_to_join, paternal.last, [&] (const auto& p) {
         std::for_each(maternal.first, maternal.last_to_partially_join, [&] (const auto& m) {
-            result.push_back({m.genotype, p.genotype, joint_probability(m, p, model),
-                              m.probability, m.probability, m.indices, p.indices});
+            result.push_back(make_parents_pair(m, p, model));
         });
     });
     return result;
@@ -694,6 +756,30 @@ auto join(const ReducedVectorMap<ParentsProbabilityPair>& parents,
     throw std::runtime_error {"TrioModel: unimplemented joint probability function"};
 }
 
+bool is_homozygous_reference(const Genotype<Haplotype>& genotype)
+{
+    return genotype.is_homozygous() && is_reference(genotype[0]);
+}
+
+// The homozygous reference genotype, if it has all but max_mass_loss of the sample's posterior mass
+const GenotypeRefProbabilityPair*
+find_dominant_reference_genotype(const std::vector<GenotypeRefProbabilityPair>& likelihoods,
+                                 const PopulationPriorModel& prior_model,
+                                 const double max_mass_loss)
+{
+    const auto max_likelihood_itr = std::max_element(std::cbegin(likelihoods), std::cend(likelihoods));
+    if (max_likelihood_itr == std::cend(likelihoods) || !is_homozygous_reference(max_likelihood_itr->genotype.get())) {
+        return nullptr;
+    }
+    const auto posteriors = compute_posteriors(likelihoods, prior_model);
+    const auto reference_idx = static_cast<std::size_t>(std::distance(std::cbegin(likelihoods), max_likelihood_itr));
+    double nonreference_mass {0};
+    for (std::size_t i {0}; i < posteriors.size(); ++i) {
+        if (i != reference_idx) nonreference_mass += std::exp(posteriors[i].probability);
+    }
+    return nonreference_mass <= max_mass_loss ? &(*max_likelihood_itr) : nullptr;
+}
+
 auto extract_probabilities(const std::vector<JointProbability>& joint_likelihoods)
 {
     std::vector<double> result(joint_likelihoods.size());
@@ -759,7 +845,7 @@ TrioModel::evaluate(const GenotypeVector& maternal_genotypes,
     const auto reduced_maternal_likelihoods = reduce(maternal_likelihoods, prior_model_, options_);
     const auto reduced_paternal_likelihoods = reduce(paternal_likelihoods, prior_model_, options_);
     const auto reduced_child_likelihoods    = reduce(child_likelihoods, prior_model_, options_);
-    auto parental_likelihoods = join(reduced_maternal_likelihoods, reduced_paternal_likelihoods, prior_model_);
+    auto parental_likelihoods = join(reduced_maternal_likelihoods, reduced_paternal_likelihoods, prior_model_, options_);
     if (debug_log_) debug::print(stream(*debug_log_), parental_likelihoods);
     const auto reduced_parental_likelihoods = reduce(parental_likelihoods, options_);
     auto joint_likelihoods = join(reduced_parental_likelihoods, reduced_child_likelihoods, mutation_model_);
@@ -796,10 +882,33 @@ TrioModel::evaluate(const GenotypeVector& genotypes, std::vector<GenotypeIndex>&
         debug::print(stream(*debug_log_), "paternal", paternal_likelihoods);
         debug::print(stream(*debug_log_), "child", child_likelihoods);
     }
+    if (options_.max_reference_parents_mass_loss > 0) {
+        // Conditioning on the child can only move parental mass off reference by about the inverse de novo
+        // rate, so with confident reference parents the joint reduces to the child given reference parents.
+        const auto maternal_reference = find_dominant_reference_genotype(maternal_likelihoods, prior_model_,
+                                                                         options_.max_reference_parents_mass_loss);
+        const auto paternal_reference = maternal_reference ? find_dominant_reference_genotype(paternal_likelihoods, prior_model_,
+                                                                                              options_.max_reference_parents_mass_loss)
+                                                           : nullptr;
+        if (maternal_reference && paternal_reference) {
+            const std::vector<ParentsProbabilityPair> parental_likelihoods {
+                make_parents_pair(*maternal_reference, *paternal_reference, prior_model_)
+            };
+            const auto reduced_parental_likelihoods = make_reduction_map(parental_likelihoods, std::cend(parental_likelihoods), options_);
+            const auto reduced_child_likelihoods = reduce(child_likelihoods, prior_model_, options_);
+            auto joint_likelihoods = join(reduced_parental_likelihoods, reduced_child_likelihoods, mutation_model_);
+            if (debug_log_) {
+                stream(*debug_log_) << "Parents are homozygous reference, only evaluating child";
+                debug::print(stream(*debug_log_), joint_likelihoods);
+            }
+            const auto evidence = normalise_exp(joint_likelihoods);
+            return {std::move(joint_likelihoods), evidence};
+        }
+    }
     const auto reduced_maternal_likelihoods = reduce(maternal_likelihoods, prior_model_, options_);
     const auto reduced_paternal_likelihoods = reduce(paternal_likelihoods, prior_model_, options_);
     const auto reduced_child_likelihoods    = reduce(child_likelihoods, prior_model_, options_);
-    auto parental_likelihoods = join(reduced_maternal_likelihoods, reduced_paternal_likelihoods, prior_model_);
+    auto parental_likelihoods = join(reduced_maternal_likelihoods, reduced_paternal_likelihoods, prior_model_, options_);
     if (debug_log_) debug::print(stream(*debug_log_), parental_likelihoods);
     const auto reduced_parental_likelihoods = reduce(parental_likelihoods, options_);
     auto joint_likelihoods = join(reduced_parental_likelihoods, reduced_child_likelihoods, mutation_model_);
@@ -47,6 +47,9 @@ public:
     {
         std::size_t max_joint_genotypes;
         double max_individual_mass_loss = 1e-80, max_joint_mass_loss = 1e-200;
+        // If both parents have less than this posterior mass off homozygous reference then only the child
+        // is evaluated, conditioned on homozygous reference parents. Zero disables this.
+        double max_reference_parents_mass_loss = 1e-30;
     };
     
     TrioModel() = delete;
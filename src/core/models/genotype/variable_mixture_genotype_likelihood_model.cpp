@@ -58,10 +58,21 @@ const VariableMixtureGenotypeLikelihoodModel::MixtureVector& VariableMixtureGeno
 void VariableMixtureGenotypeLikelihoodModel::prime(const std::vector<Haplotype>& haplotypes)
 {
     assert(likelihoods_.is_primed());
+    const auto sample_likelihoods = likelihoods_.primed_likelihoods();
     indexed_likelihoods_.reserve(haplotypes.size());
     std::transform(std::cbegin(haplotypes), std::cend(haplotypes), std::back_inserter(indexed_likelihoods_),
-                   [this] (const auto& haplotype) -> const HaplotypeLikelihoodArray::LikelihoodVector& {
-                       return likelihoods_[haplotype]; });
+                   [&] (const auto& haplotype) -> const HaplotypeLikelihoodArray::LikelihoodVector& {
+                       return sample_likelihoods[likelihoods_.haplotype_index(haplotype)]; });
+}
+
+void VariableMixtureGenotypeLikelihoodModel::prime()
+{
+    assert(likelihoods_.is_primed());
+    const auto sample_likelihoods = likelihoods_.primed_likelihoods();
+    indexed_likelihoods_.reserve(sample_likelihoods.num_haplotypes());
+    for (std::size_t haplotype_idx {0}; haplotype_idx < sample_likelihoods.num_haplotypes(); ++haplotype_idx) {
+        indexed_likelihoods_.push_back(sample_likelihoods[haplotype_idx]);
+    }
 }
 
 void VariableMixtureGenotypeLikelihoodModel::unprime() noexcept
@@ -89,10 +100,11 @@ VariableMixtureGenotypeLikelihoodModel::evaluate(const Genotype<Haplotype>& geno
 {
     assert(genotype.ploidy() == mixtures_.size());
     assert(buffer_.size() == mixtures_.size());
+    const auto sample_likelihoods = likelihoods_.primed_likelihoods();
     likelihood_refs_.clear();
     std::transform(std::cbegin(genotype), std::cend(genotype), std::back_inserter(likelihood_refs_),
-                   [this] (const auto& haplotype) -> const HaplotypeLikelihoodArray::LikelihoodVector& {
-                       return likelihoods_[haplotype]; });
+                   [&] (const auto& haplotype) -> const HaplotypeLikelihoodArray::LikelihoodVector& {
+                       return sample_likelihoods[haplotype]; });
     LogProbability result {0};
     const auto num_reads = likelihood_refs_.front().get().size();
     for (std::size_t read_idx {0}; read_idx < num_reads; ++read_idx) {
@@ -127,11 +139,12 @@ VariableMixtureGenotypeLikelihoodModel::evaluate(const CancerGenotype<Haplotype>
 {
     assert(genotype.ploidy() == mixtures_.size());
     assert(buffer_.size() == mixtures_.size());
+    const auto sample_likelihoods = likelihoods_.primed_likelihoods();
     likelihood_refs_.clear();
     std::transform(std::cbegin(genotype.germline()), std::cend(genotype.germline()), std::back_inserter(likelihood_refs_),
-                  [this] (const auto& haplotype) -> const HaplotypeLikelihoodArray::LikelihoodVector& { return likelihoods_[haplotype]; });
+                  [&] (const auto& haplotype) -> const HaplotypeLikelihoodArray::LikelihoodVector& { return sample_likelihoods[haplotype]; });
     std::transform(std::cbegin(genotype.somatic()), std::cend(genotype.somatic()), std::back_inserter(likelihood_refs_),
-                   [this] (const auto& haplotype) -> const HaplotypeLikelihoodArray::LikelihoodVector& { return likelihoods_[haplotype]; });
+                   [&] (const auto& haplotype) -> const HaplotypeLikelihoodArray::LikelihoodVector& { return sample_likelihoods[haplotype]; });
     LogProbability result {0};
     const auto num_reads = likelihood_refs_.front().get().size();
     for (std::size_t read_idx {0}; read_idx < num_reads; ++read_idx) {
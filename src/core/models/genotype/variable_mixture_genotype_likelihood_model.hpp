@@ -39,6 +39,8 @@ public:
     const MixtureVector& mixtures() const noexcept;
     
     void prime(const std::vector<Haplotype>& haplotypes);
+    // Primes with every haplotype in the likelihood array, so genotypes are indexed by array haplotype index
+    void prime();
     void unprime() noexcept;
     bool is_primed() const noexcept;
     
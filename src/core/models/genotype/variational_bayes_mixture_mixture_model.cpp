@@ -13,6 +13,7 @@
 #include <boost/math/special_functions/digamma.hpp>
 
 #include "utils/maths.hpp"
+#include "utils/thread_pool.hpp"
 
 namespace octopus { namespace model {
 
@@ -64,6 +65,11 @@ VariationalBayesMixtureMixtureModel::evaluate(const LogProbabilityVector& genoty
 
 // Private methods
 
+ThreadPool* VariationalBayesMixtureMixtureModel::workers(const std::size_t num_samples) const noexcept
+{
+    return num_samples >= options_.min_parallel_samples ? options_.workers : nullptr;
+}
+
 namespace {
 
 VariationalBayesMixtureMixtureModel::ProbabilityVector&
@@ -88,7 +94,7 @@ auto sum(const std::vector<T>& values) noexcept
 
 auto sum(const VBReadLikelihoodArray& likelihoods) noexcept
 {
-    using T = VBReadLikelihoodArray::BaseType::value_type;
+    using T = HaplotypeLikelihoodArray::LogProbability;
     return std::accumulate(std::cbegin(likelihoods), std::cend(likelihoods), T {0});
 }
 
@@ -191,7 +197,7 @@ VariationalBayesMixtureMixtureModel::init_responsibilities(const GroupConcentrat
             max_K = std::max(max_K, mixture_concentrations[s][t].size());
         }
     }
-    for (std::size_t s {0}; s < S; ++s) {
+    parallel_for(workers(S), S, [&] (const std::size_t s) {
         const auto N = log_likelihoods[s][0][0][0].size();
         const auto tau = 1.0 / max_K;
         const auto tau_sum = N * tau;
@@ -207,7 +213,7 @@ VariationalBayesMixtureMixtureModel::init_responsibilities(const GroupConcentrat
             }
         }
         maths::normalise_exp(result[s]);
-    }
+    });
     return result;
 }
 
@@ -223,7 +229,7 @@ VariationalBayesMixtureMixtureModel::update_responsibilities(GroupResponsibility
     const auto S = log_likelihoods.size();
     const auto G = genotype_posteriors.size();
     const auto ln_ex_psi = dirichlet_expectation_log(group_concentrations);
-    for (std::size_t s {0}; s < S; ++s) {
+    parallel_for(workers(S), S, [&] (const std::size_t s) {
         std::vector<double> component_responsibility_sums(component_responsibilities[s].size());
         std::transform(std::cbegin(component_responsibilities[s]), std::cend(component_responsibilities[s]),
                        std::begin(component_responsibility_sums), [] (const auto& taus) { return sum(taus); });
@@ -239,7 +245,7 @@ VariationalBayesMixtureMixtureModel::update_responsibilities(GroupResponsibility
             }
         }
         maths::normalise_exp(result[s]);
-    }
+    });
 }
 
 VariationalBayesMixtureMixtureModel::ComponentResponsibilityMatrix
@@ -296,7 +302,7 @@ VariationalBayesMixtureMixtureModel::update_responsibilities(ComponentResponsibi
     const auto T = group_concentrations.size();
     const auto S = log_likelihoods.size();
     const auto max_K = result[0].size();
-    for (std::size_t s {0}; s < S; ++s) {
+    parallel_for(workers(S), S, [&] (const std::size_t s) {
         const auto N = log_likelihoods[s][0][0][0].size();
         for (std::size_t t {0}; t < T; ++t) {
             const auto ln_exp_pi = dirichlet_expectation_log(mixture_concentrations[s][t]);
@@ -318,7 +324,7 @@ VariationalBayesMixtureMixtureModel::update_responsibilities(ComponentResponsibi
                 result[s][k][n] = std::exp(ln_rho[k] - ln_rho_norm);
             }
         }
-    }
+    });
 }
 
 void
@@ -328,9 +334,9 @@ VariationalBayesMixtureMixtureModel::update_genotype_log_posteriors(LogProbabili
                                                                     const ComponentResponsibilityMatrix& component_responsibilities,
                                                                     const HaplotypeLikelihoodMatrix& log_likelihoods) const
 {
-    for (std::size_t g {0}; g < genotype_log_priors.size(); ++g) {
+    parallel_for(workers(log_likelihoods.size()), genotype_log_priors.size(), [&] (const std::size_t g) {
         result[g] = genotype_log_priors[g] + marginalise(group_responsibilities, component_responsibilities, log_likelihoods, g);
-    }
+    });
     maths::normalise_logs(result);
 }
 
@@ -439,16 +445,18 @@ VariationalBayesMixtureMixtureModel::calculate_evidence(const GroupConcentration
     const auto G = genotype_log_priors.size();
     const auto S = prior_mixture_concentrations.size();
     const auto T = group_responsibilities.front().size();
-    double result {0};
-    for (std::size_t g {0}; g < G; ++g) {
+    // Summed in a fixed order so the evidence does not depend on the number of workers
+    std::vector<double> genotype_terms(G);
+    parallel_for(workers(S), G, [&] (const std::size_t g) {
         auto w = genotype_log_priors[g] - genotype_log_posteriors[g];
         for (std::size_t s {0}; s < S; ++s) {
             for (std::size_t t {0}; t < T; ++t) {
                 w += group_responsibilities[s][t] * inner_inner_product(component_responsibilities[s], log_likelihoods[s][g][t]);
             }
         }
-        result += genotype_posteriors[g] * w;
-    }
+        genotype_terms[g] = genotype_posteriors[g] * w;
+    });
+    auto result = std::accumulate(std::cbegin(genotype_terms), std::cend(genotype_terms), 0.0);
     for (std::size_t s {0}; s < S; ++s) {
         result += shannon_entropy(group_responsibilities[s]);
         result += shannon_entropy(component_responsibilities[s]);
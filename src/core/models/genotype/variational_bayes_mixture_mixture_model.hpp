@@ -5,6 +5,7 @@
 #define variational_bayes_mixture_mixture_model_hpp
 
 #include <vector>
+#include <cstddef>
 
 #include "core/models/haplotype_likelihood_array.hpp"
 #include "variational_bayes_mixture_model.hpp"
@@ -19,6 +20,8 @@ public:
         double epsilon = 0.05;
         unsigned max_iterations = 1000;
         double save_memory = false;
+        ThreadPool* workers = nullptr; // optional, used for per-sample updates
+        std::size_t min_parallel_samples = 32;
     };
     
     using Probability = double;
@@ -80,6 +83,7 @@ private:
     
     Options options_;
     
+    ThreadPool* workers(std::size_t num_samples) const noexcept;
     Inferences
     evaluate(const LogProbabilityVector& genotype_log_priors,
              const HaplotypeLikelihoodMatrix& log_likelihoods,
@@ -14,6 +14,7 @@
 #include <cassert>
 #include <limits>
 #include <type_traits>
+#include <atomic>
 
 #include <boost/optional.hpp>
 #include <boost/math/special_functions/digamma.hpp>
@@ -22,6 +23,7 @@
 #include "utils/maths.hpp"
 #include "utils/memory_footprint.hpp"
 #include "utils/parallel_transform.hpp"
+#include "genotype_likelihood_kernels.hpp"
 
 
 /**
@@ -41,6 +43,9 @@ struct VariationalBayesParameters
     unsigned max_iterations = 1000;
     bool save_memory = false;
     bool parallel_execution = false;
+    ThreadPool* workers = nullptr; // optional, seeds are run concurrently on idle workers
+    // A seed is abandoned once its evidence lower bound trails that of a converged seed by more than this
+    boost::optional<double> max_seed_evidence_gap = 50.0;
 };
 
 using ProbabilityVector    = std::vector<double>;
@@ -72,7 +77,8 @@ public:
     std::size_t size() const noexcept;
     BaseType::const_iterator begin() const noexcept;
     BaseType::const_iterator end() const noexcept;
-    BaseType::value_type operator[](const std::size_t n) const noexcept;
+    const BaseType::value_type* data() const noexcept;
+    HaplotypeLikelihoodArray::LogProbability operator[](const std::size_t n) const noexcept;
 
 private:
     const BaseType* likelihoods;
@@ -85,7 +91,7 @@ using VBGenotypeVector = std::vector<VBGenotype<K>>; // Per element per genotype
 template <std::size_t K>
 using VBReadLikelihoodMatrix = std::vector<VBGenotypeVector<K>>; // One element per sample
 
-using VBTau = std::vector<VBReadLikelihoodArray::BaseType::value_type>; // One element per read
+using VBTau = std::vector<HaplotypeLikelihoodArray::LogProbability>; // One element per read
 template <std::size_t K>
 using VBResponsibilityVector = std::array<VBTau, K>; // One element per haplotype in genotype (i.e. K)
 template <std::size_t K>
@@ -104,8 +110,29 @@ struct VBLatents
 
 namespace detail {
 
-using VBExpandedLikelihood = std::vector<float>; // One element per genotype
-using VBExpandedGenotype = std::vector<VBExpandedLikelihood>; // One element per read
+using VBExpandedLikelihood = float;
+
+// Read-major likelihoods for one haplotype in genotype, stored contiguously: the num_genotypes
+// likelihoods of read n start at operator[](n).
+class VBExpandedGenotype
+{
+public:
+    VBExpandedGenotype() = default;
+    VBExpandedGenotype(std::size_t num_reads, std::size_t num_genotypes)
+    : num_genotypes_ {num_genotypes}
+    , likelihoods_(num_reads * num_genotypes)
+    {}
+    
+    std::size_t num_reads() const noexcept { return num_genotypes_ > 0 ? likelihoods_.size() / num_genotypes_ : 0; }
+    std::size_t num_genotypes() const noexcept { return num_genotypes_; }
+    VBExpandedLikelihood* operator[](const std::size_t n) noexcept { return likelihoods_.data() + n * num_genotypes_; }
+    const VBExpandedLikelihood* operator[](const std::size_t n) const noexcept { return likelihoods_.data() + n * num_genotypes_; }
+    
+private:
+    std::size_t num_genotypes_ = 0;
+    std::vector<VBExpandedLikelihood> likelihoods_;
+};
+
 template <std::size_t K>
 using VBExpandedGenotypeVector = std::array<VBExpandedGenotype, K>; // One element per haplotype in genotype
 template <std::size_t K>
@@ -120,10 +147,11 @@ auto invert(const VBGenotypeVector<K>& likelihoods)
     const auto num_reads = likelihoods.front().front().size();
     VBExpandedGenotypeVector<K> result {};
     for (std::size_t k {0}; k < K; ++k) {
-        result[k] = VBExpandedGenotype(num_reads, VBExpandedLikelihood(num_genotypes));
-        for (std::size_t n {0}; n < num_reads; ++n) {
-            for (std::size_t g {0}; g < num_genotypes; ++g) {
-                result[k][n][g] = likelihoods[g][k][n];
+        result[k] = VBExpandedGenotype {num_reads, num_genotypes};
+        for (std::size_t g {0}; g < num_genotypes; ++g) {
+            const auto* genotype_likelihoods = likelihoods[g][k].data();
+            for (std::size_t n {0}; n < num_reads; ++n) {
+                result[k][n][g] = genotype_likelihoods[n];
             }
         }
     }
@@ -163,6 +191,11 @@ inline auto sum(const VBAlpha<3>& alpha) noexcept
     return alpha[0] + alpha[1] + alpha[2];
 }
 
+inline auto sum(const VBAlpha<4>& alpha) noexcept
+{
+    return (alpha[0] + alpha[1]) + (alpha[2] + alpha[3]);
+}
+
 template <std::size_t K>
 auto sum(const VBAlpha<K>& alpha) noexcept
 {
@@ -197,43 +230,61 @@ auto count_reads(const VBGenotypeVector<K>& likelihoods) noexcept
 template <std::size_t K>
 auto count_reads(const VBExpandedGenotypeVector<K>& likelihoods) noexcept
 {
-    return likelihoods[0].size();
+    return likelihoods[0].num_reads();
 }
 
-template <typename ProbabilityVector_, std::size_t K>
-auto marginalise(const ProbabilityVector_& distribution, const VBGenotypeVector<K>& likelihoods,
-                 const unsigned k, const std::size_t n) noexcept
+template <typename T>
+T inner_product(const T* lhs, const T* rhs, const std::size_t n) noexcept
 {
-    using T = typename ProbabilityVector_::value_type;
-    return std::inner_product(std::cbegin(distribution), std::cend(distribution),
-                              std::cbegin(likelihoods), T {0}, std::plus<> {},
-                              [k, n] (const auto p, const auto& haplotype_likelihoods) noexcept {
-                                  return p * haplotype_likelihoods[k][n];
-                              });
+    return kernels::inner_product(lhs, rhs, n);
+}
+
+// For single precision read likelihoods, which are widened
+template <typename T1, typename T2>
+auto inner_product(const T1* lhs, const T2* rhs, const std::size_t n) noexcept
+{
+    return std::inner_product(lhs, lhs + n, rhs, double {0});
 }
 
 template <typename T1, typename T2>
 auto inner_product(const T1& lhs, const T2& rhs) noexcept
 {
-    assert(std::distance(std::cbegin(lhs), std::cend(lhs)) == std::distance(std::cbegin(rhs), std::cend(rhs)));
-    using T = typename T1::value_type;
-    return std::inner_product(std::cbegin(lhs), std::cend(lhs), std::cbegin(rhs), T {0});
+    assert(lhs.size() == rhs.size());
+    return inner_product(lhs.data(), rhs.data(), lhs.size());
 }
 
-template <typename ProbabilityVector_, std::size_t K>
-auto marginalise(const ProbabilityVector_& distribution, const VBExpandedGenotypeVector<K>& likelihoods,
+template <std::size_t K>
+auto marginalise(const std::vector<VBExpandedLikelihood>& distribution, const VBExpandedGenotypeVector<K>& likelihoods,
                  const unsigned k, const std::size_t n) noexcept
 {
-    return inner_product(distribution, likelihoods[k][n]);
+    return kernels::inner_product(distribution.data(), likelihoods[k][n], distribution.size());
 }
 
-template <std::size_t K, typename T, typename ProbabilityVector_, typename VBLikelihoodGenotypeVector>
+template <std::size_t K, typename T>
+void normalise_responsibilities(VBResponsibilityVector<K>& result, const std::array<T, K>& ln_rho, const std::size_t n) noexcept
+{
+    const auto ln_rho_norm = maths::fast_log_sum_exp(ln_rho);
+    for (unsigned k {0}; k < K; ++k) {
+        result[k][n] = maths::fast_exp(ln_rho[k] - ln_rho_norm);
+    }
+}
+
+// Two components (e.g. tumour/normal) only need a logistic function, avoiding the log
+template <typename T>
+void normalise_responsibilities(VBResponsibilityVector<2>& result, const std::array<T, 2>& ln_rho, const std::size_t n) noexcept
+{
+    // Not computed as 1 - tau, which may round to zero and break the entropy term
+    const auto d = ln_rho[1] - ln_rho[0];
+    result[0][n] = 1 / (1 + maths::fast_exp(d));
+    result[1][n] = 1 / (1 + maths::fast_exp(-d));
+}
+
+template <std::size_t K, typename T>
 void
 update_responsibilities_helper(VBResponsibilityVector<K>& result,
                                const std::array<T, K>& al,
-                               const ProbabilityVector_& genotype_probabilities,
-                               const VBLikelihoodGenotypeVector& read_likelihoods,
-                               std::true_type)
+                               const std::vector<VBExpandedLikelihood>& genotype_probabilities,
+                               const VBExpandedGenotypeVector<K>& read_likelihoods)
 {
     const auto N = count_reads(read_likelihoods);
     std::array<T, K> ln_rho;
@@ -241,56 +292,59 @@ update_responsibilities_helper(VBResponsibilityVector<K>& result,
         for (unsigned k {0}; k < K; ++k) {
             ln_rho[k] = al[k] + marginalise(genotype_probabilities, read_likelihoods, k, n);
         }
-        const auto ln_rho_norm = maths::fast_log_sum_exp(ln_rho);
-        for (unsigned k {0}; k < K; ++k) {
-            result[k][n] = maths::fast_exp(ln_rho[k] - ln_rho_norm);
-        }
+        normalise_responsibilities(result, ln_rho, n);
     }
 }
 
-template <std::size_t K, typename T, typename ProbabilityVector_>
+// Streams the likelihoods through a small read-major buffer, so the marginalisations are contiguous
+// inner products as for the expanded likelihoods without holding the whole expanded matrix in memory.
+template <std::size_t K, typename T>
 void
 update_responsibilities_helper(VBResponsibilityVector<K>& result,
                                const std::array<T, K>& al,
-                               const ProbabilityVector_& genotype_probabilities,
-                               const VBExpandedGenotypeVector<K>& read_likelihoods,
-                               std::false_type)
+                               const std::vector<VBExpandedLikelihood>& genotype_probabilities,
+                               const VBGenotypeVector<K>& read_likelihoods)
 {
-    using LikelihoodType = VBExpandedLikelihood::value_type;
-    const std::vector<LikelihoodType> demoted_genotype_probabilities {std::cbegin(genotype_probabilities), std::cend(genotype_probabilities)};
-    update_responsibilities_helper(result, al, demoted_genotype_probabilities, read_likelihoods, std::true_type {});
+    constexpr std::size_t blockSize {64};
+    const auto N = count_reads(read_likelihoods);
+    const auto G = read_likelihoods.size();
+    VBExpandedGenotype block {blockSize, G};
+    std::array<std::array<T, blockSize>, K> block_marginals;
+    std::array<T, K> ln_rho;
+    for (std::size_t block_begin {0}; block_begin < N; block_begin += blockSize) {
+        const auto block_size = std::min(blockSize, N - block_begin);
+        for (unsigned k {0}; k < K; ++k) {
+            for (std::size_t g {0}; g < G; ++g) {
+                const auto* genotype_likelihoods = read_likelihoods[g][k].data() + block_begin;
+                for (std::size_t n {0}; n < block_size; ++n) {
+                    block[n][g] = genotype_likelihoods[n];
+                }
+            }
+            for (std::size_t n {0}; n < block_size; ++n) {
+                block_marginals[k][n] = kernels::inner_product(genotype_probabilities.data(), block[n], G);
+            }
+        }
+        for (std::size_t n {0}; n < block_size; ++n) {
+            for (unsigned k {0}; k < K; ++k) {
+                ln_rho[k] = al[k] + block_marginals[k][n];
+            }
+            normalise_responsibilities(result, ln_rho, block_begin + n);
+        }
+    }
 }
 
-template <std::size_t K, typename T, typename ProbabilityVector_>
-void
-update_responsibilities_helper(VBResponsibilityVector<K>& result,
-                               const std::array<T, K>& al,
-                               const ProbabilityVector_& genotype_probabilities,
-                               const VBExpandedGenotypeVector<K>& read_likelihoods)
-{
-    // For the expanded likelihood array, the inner product between likelihoods and genotype
-    // posteriors - a key bottleneck in the responsibility update calculate - can be vectorised.
-    // To ensure optimal execution the floating point types of the genotype probabilities and likelihoods should match.
-    using ProbabilityType = typename ProbabilityVector_::value_type;
-    using LikelihoodType = VBExpandedLikelihood::value_type;
-    update_responsibilities_helper(result, al, genotype_probabilities, read_likelihoods,
-                                   std::is_same<ProbabilityType, LikelihoodType> {});
-}
+// Likelihoods are single precision, so the genotype probabilities are demoted to match
+using VBDemotedProbabilityVector = std::vector<VBExpandedLikelihood>;
 
-template <std::size_t K, typename T, typename VBLikelihoodGenotypeVector, typename ProbabilityVector_>
-void
-update_responsibilities_helper(VBResponsibilityVector<K>& result,
-                               const std::array<T, K>& al,
-                               const ProbabilityVector_& genotype_probabilities,
-                               const VBLikelihoodGenotypeVector& read_likelihoods)
+inline auto demote(const ProbabilityVector& probabilities)
 {
-    update_responsibilities_helper(result, al, genotype_probabilities, read_likelihoods, std::true_type {});
+    return VBDemotedProbabilityVector {std::cbegin(probabilities), std::cend(probabilities)};
 }
 
 template <std::size_t K, typename VBLikelihoodGenotypeVector>
 void update_responsibilities(VBResponsibilityVector<K>& result,
                              const VBAlpha<K>& posterior_alphas,
-                             const ProbabilityVector& genotype_probabilities,
+                             const VBDemotedProbabilityVector& genotype_probabilities,
                              const VBLikelihoodGenotypeVector& read_likelihoods)
 {
     const auto al = compute_digamma_diffs(posterior_alphas);
@@ -303,16 +357,17 @@ void update_responsibilities(VBResponsibilityMatrix<K>& result,
                              const ProbabilityVector& genotype_probabilities,
                              const VBLikelihoodMatrix& read_likelihoods)
 {
+    const auto demoted_genotype_probabilities = demote(genotype_probabilities);
     const auto S = read_likelihoods.size();
     for (std::size_t s {0}; s < S; ++s) {
-        update_responsibilities(result[s], posterior_alphas[s], genotype_probabilities, read_likelihoods[s]);
+        update_responsibilities(result[s], posterior_alphas[s], demoted_genotype_probabilities, read_likelihoods[s]);
     }
 }
 
 template <std::size_t K, typename VBLikelihoodVector_>
 VBResponsibilityVector<K>
 init_responsibilities(const VBAlpha<K>& prior_alphas,
-                      const ProbabilityVector& genotype_probabilities,
+                      const VBDemotedProbabilityVector& genotype_probabilities,
                       const VBLikelihoodVector_& read_likelihoods)
 {
     const auto N = count_reads(read_likelihoods);
@@ -328,11 +383,12 @@ init_responsibilities(const VBAlphaVector<K>& prior_alphas,
                       const ProbabilityVector& genotype_probabilities,
                       const VBLikelihoodMatrix& read_likelihoods)
 {
+    const auto demoted_genotype_probabilities = demote(genotype_probabilities);
     const auto S = read_likelihoods.size(); // num samples
     VBResponsibilityMatrix<K> result {};
     result.reserve(S);
     for (std::size_t s {0}; s < S; ++s) {
-        result.push_back(init_responsibilities(prior_alphas[s], genotype_probabilities, read_likelihoods[s]));
+        result.push_back(init_responsibilities(prior_alphas[s], demoted_genotype_probabilities, read_likelihoods[s]));
     }
     return result;
 }
@@ -454,6 +510,27 @@ auto calculate_evidence_lower_bound(const VBAlphaVector<K>& prior_alphas,
 
 // Main algorithm - single seed
 
+// The best evidence lower bound of the seeds that have converged so far, shared by concurrently running seeds
+class VBSeedTracker
+{
+public:
+    VBSeedTracker(boost::optional<double> max_evidence_gap) : max_evidence_gap_ {max_evidence_gap} {}
+    
+    bool is_dominated(const double evidence) const noexcept
+    {
+        return max_evidence_gap_ && evidence < best_evidence_.load(std::memory_order_relaxed) - *max_evidence_gap_;
+    }
+    void update(const double evidence) noexcept
+    {
+        auto best = best_evidence_.load(std::memory_order_relaxed);
+        while (evidence > best && !best_evidence_.compare_exchange_weak(best, evidence, std::memory_order_relaxed));
+    }
+    
+private:
+    boost::optional<double> max_evidence_gap_;
+    std::atomic<double> best_evidence_ {std::numeric_limits<double>::lowest()};
+};
+
 // Starting iteration with given genotype_log_posteriors
 template <std::size_t K, typename VBLikelihoodMatrix1, typename VBLikelihoodMatrix2>
 VBLatents<K>
@@ -462,7 +539,8 @@ run_variational_bayes(const VBAlphaVector<K>& prior_alphas,
                       const VBLikelihoodMatrix1& log_likelihoods1,
                       const VBLikelihoodMatrix2& log_likelihoods2,
                       LogProbabilityVector genotype_log_posteriors,
-                      const VariationalBayesParameters& params)
+                      const VariationalBayesParameters& params,
+                      VBSeedTracker* seed_tracker = nullptr)
 {
     assert(!prior_alphas.empty());
     assert(!genotype_log_priors.empty());
@@ -476,6 +554,7 @@ run_variational_bayes(const VBAlphaVector<K>& prior_alphas,
     auto responsibilities = init_responsibilities<K>(posterior_alphas, genotype_posteriors, log_likelihoods2);
     assert(responsibilities.size() == log_likelihoods1.size()); // num samples
     auto prev_evidence = std::numeric_limits<double>::lowest();
+    bool is_dominated {false};
     for (unsigned i {0}; i < params.max_iterations; ++i) {
         update_genotype_log_posteriors(genotype_log_posteriors, genotype_log_priors, responsibilities, log_likelihoods1);
         exp(genotype_log_posteriors, genotype_posteriors);
@@ -485,8 +564,13 @@ run_variational_bayes(const VBAlphaVector<K>& prior_alphas,
                                                             log_likelihoods1, 1e-10);
         if (curr_evidence <= prev_evidence || (curr_evidence - prev_evidence) < params.epsilon) break;
         prev_evidence = curr_evidence;
+        if (seed_tracker && seed_tracker->is_dominated(curr_evidence)) {
+            is_dominated = true;
+            break;
+        }
         update_responsibilities(responsibilities, posterior_alphas, genotype_posteriors, log_likelihoods2);
     }
+    if (seed_tracker && !is_dominated) seed_tracker->update(prev_evidence);
     return VBLatents<K> {
         std::move(genotype_posteriors), std::move(genotype_log_posteriors),
         std::move(posterior_alphas), std::move(responsibilities)
@@ -500,10 +584,11 @@ run_variational_bayes(const VBAlphaVector<K>& prior_alphas,
                       const LogProbabilityVector& genotype_log_priors,
                       const VBReadLikelihoodMatrix<K>& log_likelihoods,
                       LogProbabilityVector genotype_log_posteriors,
-                      const VariationalBayesParameters& params)
+                      const VariationalBayesParameters& params,
+                      VBSeedTracker* seed_tracker = nullptr)
 {
-    return run_variational_bayes(prior_alphas, genotype_log_posteriors, log_likelihoods,
-                                 log_likelihoods, genotype_log_posteriors, params);
+    return run_variational_bayes(prior_alphas, genotype_log_priors, log_likelihoods,
+                                 log_likelihoods, std::move(genotype_log_posteriors), params, seed_tracker);
 }
 
 // Main algorithm - multiple seed
@@ -516,6 +601,22 @@ bool run_vb_with_matrix_inversion(const VBReadLikelihoodMatrix<K>& log_likelihoo
     return !params.save_memory;
 }
 
+template <typename F, std::size_t K>
+void run_seeds(std::vector<LogProbabilityVector>& seeds, F func, const VariationalBayesParameters& params,
+               std::vector<VBLatents<K>>& result)
+{
+    if (params.workers && seeds.size() > 1) {
+        // Seeds share the evidence tracker, so concurrent seeds can abandon each other early
+        result.resize(seeds.size());
+        parallel_for(params.workers, seeds.size(), [&] (const std::size_t i) { result[i] = func(std::move(seeds[i])); });
+    } else if (params.parallel_execution) {
+        parallel_transform(std::make_move_iterator(std::begin(seeds)), std::make_move_iterator(std::end(seeds)),
+                           std::back_inserter(result), func);
+    } else {
+        for (auto& seed : seeds) result.push_back(func(std::move(seed)));
+    }
+}
+
 template <std::size_t K>
 std::vector<VBLatents<K>>
 run_variational_bayes(const VBAlphaVector<K>& prior_alphas,
@@ -526,25 +627,18 @@ run_variational_bayes(const VBAlphaVector<K>& prior_alphas,
 {
     std::vector<VBLatents<K>> result {};
     result.reserve(seeds.size());
+    // Dominated seeds stop early but are still returned; they cannot have the maximum evidence
+    VBSeedTracker seed_tracker {params.max_seed_evidence_gap};
     if (run_vb_with_matrix_inversion(log_likelihoods, params, seeds)) {
         const auto inverted_log_likelihoods = invert(log_likelihoods);
         const auto func = [&] (auto&& seed) { return detail::run_variational_bayes(prior_alphas, genotype_log_priors, log_likelihoods,
-                                                                                   inverted_log_likelihoods, std::move(seed), params); };
-        if (params.parallel_execution) {
-            parallel_transform(std::make_move_iterator(std::begin(seeds)), std::make_move_iterator(std::end(seeds)),
-                               std::back_inserter(result), func);
-        } else {
-            for (auto& seed : seeds) result.push_back(func(std::move(seed)));
-        }
+                                                                                   inverted_log_likelihoods, std::move(seed), params,
+                                                                                   &seed_tracker); };
+        run_seeds(seeds, func, params, result);
     } else {
         const auto func = [&] (auto&& seed) { return detail::run_variational_bayes(prior_alphas, genotype_log_priors, log_likelihoods,
-                                                                                   std::move(seed), params); };
-        if (params.parallel_execution) {
-            parallel_transform(std::make_move_iterator(std::begin(seeds)), std::make_move_iterator(std::end(seeds)),
-                               std::back_inserter(result), func);
-        } else {
-            for (auto& seed : seeds) result.push_back(func(std::move(seed)));
-        }
+                                                                                   std::move(seed), params, &seed_tracker); };
+        run_seeds(seeds, func, params, result);
     }
     return result;
 }
@@ -634,7 +728,12 @@ inline VBReadLikelihoodArray::BaseType::const_iterator VBReadLikelihoodArray::en
     return likelihoods->end();
 }
 
-inline VBReadLikelihoodArray::BaseType::value_type VBReadLikelihoodArray::operator[](const std::size_t n) const noexcept
+inline const VBReadLikelihoodArray::BaseType::value_type* VBReadLikelihoodArray::data() const noexcept
+{
+    return likelihoods->data();
+}
+
+inline HaplotypeLikelihoodArray::LogProbability VBReadLikelihoodArray::operator[](const std::size_t n) const noexcept
 {
     return likelihoods->operator[](n);
 }
@@ -656,9 +755,7 @@ estimate_memory_requirement(const std::vector<SampleName>& samples,
         bytes += tau_bytes * K + sizeof(VBResponsibilityVector<K>);
         if (!params.save_memory) {
             bytes += sizeof(detail::VBExpandedLikelihoodMatrix<K>);
-            auto inverse_bytes = sizeof(detail::VBExpandedLikelihood::value_type) * num_genotypes + sizeof(detail::VBExpandedLikelihood);
-            inverse_bytes *= num_likelihoods;
-            inverse_bytes += sizeof(detail::VBExpandedGenotype);
+            const auto inverse_bytes = sizeof(detail::VBExpandedLikelihood) * num_genotypes * num_likelihoods;
             bytes += K * inverse_bytes + sizeof(detail::VBExpandedGenotypeVector<K>);
         }
     }
@@ -0,0 +1,92 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "genotype_likelihood_table.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+#include <boost/functional/hash.hpp>
+
+namespace octopus {
+
+GenotypeLikelihoodTable::GenotypeLikelihoodTable(const std::size_t max_entries)
+: max_entries_ {max_entries}
+{}
+
+std::size_t GenotypeLikelihoodTable::max_entries() const noexcept
+{
+    return max_entries_;
+}
+
+std::size_t GenotypeLikelihoodTable::size() const noexcept
+{
+    return num_entries_;
+}
+
+boost::optional<GenotypeLikelihoodTable::LogProbability>
+GenotypeLikelihoodTable::find(const std::size_t sample, const HaplotypeIndexTuple& genotype) const
+{
+    if (sample < samples_.size()) {
+        const auto itr = samples_[sample].find(genotype);
+        if (itr != std::cend(samples_[sample])) {
+            ++hits_;
+            return itr->second;
+        }
+    }
+    ++misses_;
+    return boost::none;
+}
+
+void GenotypeLikelihoodTable::insert(const std::size_t sample, const HaplotypeIndexTuple& genotype,
+                                     const LogProbability log_likelihood)
+{
+    if (num_entries_ >= max_entries_) return;
+    if (samples_.size() <= sample) samples_.resize(sample + 1);
+    if (samples_[sample].emplace(genotype, log_likelihood).second) ++num_entries_;
+}
+
+void GenotypeLikelihoodTable::erase_haplotypes(const std::vector<std::size_t>& haplotypes)
+{
+    if (haplotypes.empty() || num_entries_ == 0) return;
+    const auto max_haplotype = *std::max_element(std::cbegin(haplotypes), std::cend(haplotypes));
+    std::vector<char> is_erased(max_haplotype + 1, false);
+    for (const auto haplotype : haplotypes) is_erased[haplotype] = true;
+    const auto contains_erased = [&] (const HaplotypeIndexTuple& genotype) {
+        return std::any_of(std::cbegin(genotype), std::cend(genotype),
+                           [&] (const auto haplotype) { return haplotype <= max_haplotype && is_erased[haplotype]; });
+    };
+    for (auto& table : samples_) {
+        for (auto itr = std::begin(table); itr != std::end(table);) {
+            if (contains_erased(itr->first)) {
+                itr = table.erase(itr);
+                --num_entries_;
+            } else {
+                ++itr;
+            }
+        }
+    }
+}
+
+void GenotypeLikelihoodTable::clear() noexcept
+{
+    for (auto& table : samples_) table.clear();
+    num_entries_ = 0;
+}
+
+std::size_t GenotypeLikelihoodTable::hits() const noexcept
+{
+    return hits_;
+}
+
+std::size_t GenotypeLikelihoodTable::misses() const noexcept
+{
+    return misses_;
+}
+
+std::size_t GenotypeLikelihoodTable::TupleHash::operator()(const HaplotypeIndexTuple& genotype) const noexcept
+{
+    return boost::hash_range(std::cbegin(genotype), std::cend(genotype));
+}
+
+} // namespace octopus
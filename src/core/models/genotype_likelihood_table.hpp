@@ -0,0 +1,72 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef genotype_likelihood_table_hpp
+#define genotype_likelihood_table_hpp
+
+#include <cstddef>
+#include <vector>
+#include <unordered_map>
+
+#include <boost/optional.hpp>
+
+namespace octopus {
+
+/*
+    GenotypeLikelihoodTable memoises sample x genotype log likelihoods, i.e.
+    ln p(reads | genotype), so that re-running a genotype model (e.g. after haplotype
+    filtering, or for a fallback model) does not recompute the same genotypes.
+
+    Genotypes are keyed by the sorted tuple of their haplotype indices, where indices
+    are those assigned by the owning HaplotypeLikelihoodArray, and so are stable under
+    haplotype removal. Erasing a haplotype only invalidates genotypes containing it.
+
+    Once the table holds max_entries likelihoods new ones are not added.
+ */
+class GenotypeLikelihoodTable
+{
+public:
+    using LogProbability = double;
+    using HaplotypeIndexTuple = std::vector<unsigned>; // sorted
+    
+    GenotypeLikelihoodTable() = default;
+    
+    GenotypeLikelihoodTable(std::size_t max_entries);
+    
+    GenotypeLikelihoodTable(const GenotypeLikelihoodTable&)            = default;
+    GenotypeLikelihoodTable& operator=(const GenotypeLikelihoodTable&) = default;
+    GenotypeLikelihoodTable(GenotypeLikelihoodTable&&)                 = default;
+    GenotypeLikelihoodTable& operator=(GenotypeLikelihoodTable&&)      = default;
+    
+    ~GenotypeLikelihoodTable() = default;
+    
+    std::size_t max_entries() const noexcept;
+    std::size_t size() const noexcept;
+    
+    boost::optional<LogProbability> find(std::size_t sample, const HaplotypeIndexTuple& genotype) const;
+    void insert(std::size_t sample, const HaplotypeIndexTuple& genotype, LogProbability log_likelihood);
+    
+    // Removes all genotypes containing any of the given haplotypes
+    void erase_haplotypes(const std::vector<std::size_t>& haplotypes);
+    
+    void clear() noexcept;
+    
+    std::size_t hits() const noexcept;
+    std::size_t misses() const noexcept;
+    
+private:
+    struct TupleHash
+    {
+        std::size_t operator()(const HaplotypeIndexTuple& genotype) const noexcept;
+    };
+    
+    using SampleTable = std::unordered_map<HaplotypeIndexTuple, LogProbability, TupleHash>;
+    
+    std::size_t max_entries_ = 0, num_entries_ = 0;
+    std::vector<SampleTable> samples_;
+    mutable std::size_t hits_ = 0, misses_ = 0;
+};
+
+} // namespace octopus
+
+#endif
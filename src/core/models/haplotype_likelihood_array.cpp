@@ -4,8 +4,21 @@
 #include "haplotype_likelihood_array.hpp"
 
 #include <utility>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
 #include <cassert>
 
+#include <boost/functional/hash.hpp>
+
+#include "utils/thread_pool.hpp"
+#include "utils/stage_profiler.hpp"
+
 #include <iostream> // DEBUG
 #include <iomanip>  // DEBUG
 
@@ -15,76 +28,234 @@ namespace octopus {
 
 HaplotypeLikelihoodArray::HaplotypeLikelihoodArray(const unsigned max_haplotypes,
                                                    const std::vector<SampleName>& samples)
-: cache_ {max_haplotypes}
+: matrices_ {}
+, haplotype_indices_ {max_haplotypes}
 , sample_indices_ {samples.size()}
 {
-    mapping_positions_.resize(maxMappingPositions);
+    matrices_.reserve(samples.size());
 }
 
 HaplotypeLikelihoodArray::HaplotypeLikelihoodArray(HaplotypeLikelihoodModel likelihood_model,
                                                    unsigned max_haplotypes,
                                                    const std::vector<SampleName>& samples)
 : likelihood_model_ {std::move(likelihood_model)}
-, cache_ {max_haplotypes}
+, matrices_ {}
+, haplotype_indices_ {max_haplotypes}
 , sample_indices_ {samples.size()}
 {
-    mapping_positions_.resize(maxMappingPositions);
+    matrices_.reserve(samples.size());
+}
+
+namespace {
+
+// Reads that are equal under these are guaranteed to have the same likelihood for any haplotype
+struct ReadLikelihoodHash
+{
+    std::size_t operator()(const AlignedRead& read) const noexcept
+    {
+        using boost::hash_combine;
+        std::size_t result {};
+        hash_combine(result, std::hash<AlignedRead::NucleotideSequence>()(read.sequence()));
+        hash_combine(result, boost::hash_range(std::cbegin(read.base_qualities()), std::cend(read.base_qualities())));
+        hash_combine(result, mapped_begin(read));
+        hash_combine(result, read.mapping_quality());
+        hash_combine(result, read.is_marked_reverse_mapped());
+        return result;
+    }
+};
+
+struct ReadLikelihoodEqual
+{
+    bool operator()(const AlignedRead& lhs, const AlignedRead& rhs) const noexcept
+    {
+        return mapped_begin(lhs) == mapped_begin(rhs)
+            && lhs.mapping_quality() == rhs.mapping_quality()
+            && lhs.is_marked_reverse_mapped() == rhs.is_marked_reverse_mapped()
+            && lhs.sequence() == rhs.sequence()
+            && lhs.base_qualities() == rhs.base_qualities();
+    }
+};
+
+constexpr std::size_t cacheLineSize {64};
+
+std::size_t round_up_to_cache_line(const std::size_t num_likelihoods) noexcept
+{
+    constexpr auto n = cacheLineSize / sizeof(HaplotypeLikelihoodArray::StoredLogProbability);
+    return ((num_likelihoods + n - 1) / n) * n;
 }
 
+} // namespace
+
 HaplotypeLikelihoodArray::ReadPacket::ReadPacket(Iterator first, Iterator last)
 : first {first}
 , last {last}
 , num_reads {static_cast<std::size_t>(std::distance(first, last))}
-{}
+, unique_reads {}
+, unique_read_indices {}
+{
+    unique_reads.reserve(num_reads);
+    unique_read_indices.reserve(num_reads);
+    std::unordered_map<std::reference_wrapper<const AlignedRead>, std::size_t,
+                       ReadLikelihoodHash, ReadLikelihoodEqual> unique_indices {num_reads};
+    std::for_each(first, last, [&] (const AlignedRead& read) {
+        const auto p = unique_indices.emplace(read, unique_reads.size());
+        if (p.second) unique_reads.emplace_back(read);
+        unique_read_indices.push_back(p.first->second);
+    });
+    if (unique_reads.size() == num_reads) {
+        unique_read_indices.clear();
+        unique_read_indices.shrink_to_fit();
+    }
+}
+
+void HaplotypeLikelihoodArray::set_workers(ThreadPool& workers, const std::size_t min_parallel_cells) noexcept
+{
+    workers_ = std::addressof(workers);
+    min_parallel_cells_ = min_parallel_cells;
+}
+
+void HaplotypeLikelihoodArray::set_likelihood_cache(const std::size_t max_likelihoods)
+{
+    if (max_likelihoods > 0) {
+        likelihood_cache_ = std::make_shared<ReadHaplotypeLikelihoodCache>(max_likelihoods);
+    } else {
+        likelihood_cache_ = nullptr;
+    }
+}
+
+void HaplotypeLikelihoodArray::set_local_likelihood_reuse(const bool reuse) noexcept
+{
+    reuse_local_likelihoods_ = reuse;
+}
+
+void HaplotypeLikelihoodArray::set_long_read_mapping(const bool long_reads) noexcept
+{
+    long_read_mapping_ = long_reads;
+}
+
+std::size_t HaplotypeLikelihoodArray::num_cache_hits() const noexcept
+{
+    return likelihood_cache_ ? likelihood_cache_->hits() : 0;
+}
+
+std::size_t HaplotypeLikelihoodArray::num_cache_misses() const noexcept
+{
+    return likelihood_cache_ ? likelihood_cache_->misses() : 0;
+}
+
+void HaplotypeLikelihoodArray::set_genotype_likelihood_table(const std::size_t max_genotype_likelihoods)
+{
+    genotype_likelihoods_ = GenotypeLikelihoodTable {max_genotype_likelihoods};
+}
+
+bool HaplotypeLikelihoodArray::has_genotype_likelihood_table() const noexcept
+{
+    return genotype_likelihoods_.max_entries() > 0;
+}
+
+const GenotypeLikelihoodTable& HaplotypeLikelihoodArray::genotype_likelihood_table() const noexcept
+{
+    return genotype_likelihoods_;
+}
+
+boost::optional<HaplotypeLikelihoodArray::LogProbability>
+HaplotypeLikelihoodArray::find_genotype_likelihood(const GenotypeLikelihoodTable::HaplotypeIndexTuple& genotype) const
+{
+    assert(is_primed());
+    return genotype_likelihoods_.find(*primed_sample_, genotype);
+}
+
+void HaplotypeLikelihoodArray::memoise_genotype_likelihood(const GenotypeLikelihoodTable::HaplotypeIndexTuple& genotype,
+                                                           const LogProbability log_likelihood) const
+{
+    assert(is_primed());
+    genotype_likelihoods_.insert(*primed_sample_, genotype, log_likelihood);
+}
+
+void HaplotypeLikelihoodArray::set_read_compression(const LogProbability tolerance)
+{
+    if (tolerance < 0) {
+        throw std::invalid_argument {"HaplotypeLikelihoodArray: read compression tolerance must be non-negative"};
+    }
+    read_compression_tolerance_ = tolerance;
+    invalidate_compression();
+}
+
+bool HaplotypeLikelihoodArray::is_read_compressed() const noexcept
+{
+    return static_cast<bool>(read_compression_tolerance_);
+}
+
+HaplotypeLikelihoodArray::SampleLikelihoods HaplotypeLikelihoodArray::compressed_likelihoods() const noexcept
+{
+    assert(is_primed() && is_read_compressed() && compressed_[*primed_sample_].is_current);
+    const auto& compressed = compressed_[*primed_sample_];
+    return {*this, compressed.matrix.rows, compressed.read_weights.data(), compressed.uninformative_log_likelihood};
+}
 
 void HaplotypeLikelihoodArray::populate(const ReadMap& reads,
                                         const std::vector<Haplotype>& haplotypes,
                                         boost::optional<FlankState> flank_state)
 {
+    profiling::StageTimer timer {profiling::Stage::likelihoods};
     // This code is not very pretty because it is a bottleneck for the entire application.
     // We want to try a minimise memory allocations for the mapping.
-    cache_.clear();
-    if (cache_.bucket_count() < haplotypes.size()) {
-        cache_.rehash(haplotypes.size());
+    haplotype_indices_.clear();
+    genotype_likelihoods_.clear();
+    invalidate_compression();
+    if (haplotype_indices_.bucket_count() < haplotypes.size()) {
+        haplotype_indices_.rehash(haplotypes.size());
     }
     set_read_iterators_and_sample_indices(reads);
     assert(reads.size() == read_iterators_.size());
     const auto num_samples = reads.size();
+    if (likelihood_cache_) {
+        for (std::size_t s {0}; s < num_samples; ++s) {
+            auto& t = read_iterators_[s];
+            t.unique_read_ids.reserve(t.unique_reads.size());
+            for (const AlignedRead& read : t.unique_reads) {
+                t.unique_read_ids.push_back(likelihood_cache_->read_id(s, read));
+            }
+        }
+    }
+    matrices_.resize(num_samples);
+    for (std::size_t s {0}; s < num_samples; ++s) {
+        matrices_[s].reset(haplotypes.size(), read_iterators_[s].num_reads);
+    }
+    for (std::size_t haplotype_idx {0}; haplotype_idx < haplotypes.size(); ++haplotype_idx) {
+        haplotype_indices_.emplace(haplotypes[haplotype_idx], haplotype_idx);
+    }
+    num_haplotypes_ = haplotypes.size();
     // Precompute all read hashes so we don't have to recompute for each haplotype
-    std::vector<std::vector<KmerPerfectHashes>> read_hashes {};
+    ReadHashes read_hashes {};
     read_hashes.reserve(num_samples);
     for (const auto& t : read_iterators_) {
         std::vector<KmerPerfectHashes> sample_read_hashes {};
-        sample_read_hashes.reserve(t.num_reads);
-        std::transform(t.first, t.last, std::back_inserter(sample_read_hashes),
-                       [] (const AlignedRead& read) { return compute_kmer_hashes<mapperKmerSize>(read.sequence()); });
+        sample_read_hashes.reserve(t.unique_reads.size());
+        std::transform(std::cbegin(t.unique_reads), std::cend(t.unique_reads), std::back_inserter(sample_read_hashes),
+                       [this] (const AlignedRead& read) { return compute_read_hashes(read); });
         read_hashes.emplace_back(std::move(sample_read_hashes));
     }
-    auto haplotype_hashes = init_kmer_hash_table<mapperKmerSize>();
-    const auto first_mapping_position = std::begin(mapping_positions_);
-    for (const auto& haplotype : haplotypes) {
-        populate_kmer_hash_table<mapperKmerSize>(haplotype.sequence(), haplotype_hashes);
-        auto haplotype_mapping_counts = init_mapping_counts(haplotype_hashes);
-        auto itr = std::begin(cache_.emplace(std::piecewise_construct,
-                                             std::forward_as_tuple(haplotype),
-                                             std::forward_as_tuple(num_samples)).first->second);
-        likelihood_model_.reset(haplotype, flank_state);
-        auto read_hash_itr = std::cbegin(read_hashes);
-        for (const auto& t : read_iterators_) { // for each sample
-            *itr = std::vector<LogProbability>(t.num_reads);
-            std::transform(t.first, t.last, std::cbegin(*read_hash_itr), std::begin(*itr),
-                           [&] (const AlignedRead& read, const auto& read_hashes) {
-                               const auto last_mapping_position = map_query_to_target(read_hashes, haplotype_hashes,
-                                                                                      haplotype_mapping_counts,
-                                                                                      first_mapping_position,
-                                                                                      maxMappingPositions);
-                               reset_mapping_counts(haplotype_mapping_counts);
-                               return likelihood_model_.evaluate(read, first_mapping_position, last_mapping_position);
-                           });
-            ++read_hash_itr;
-            ++itr;
+    // Evaluating haplotypes with common prefixes consecutively lets the model reuse likelihoods
+    // of reads that do not overlap the haplotype differences
+    std::vector<std::size_t> order(haplotypes.size());
+    std::iota(std::begin(order), std::end(order), 0);
+    std::sort(std::begin(order), std::end(order), [&] (const auto lhs, const auto rhs) {
+        const Haplotype& lhs_haplotype {haplotypes[lhs]}, &rhs_haplotype {haplotypes[rhs]};
+        if (!begins_equal(lhs_haplotype, rhs_haplotype)) return begins_before(lhs_haplotype, rhs_haplotype);
+        return lhs_haplotype.sequence() < rhs_haplotype.sequence();
+    });
+    likelihood_model_.clear(); // in case a previous population threw
+    if (use_workers(haplotypes.size())) {
+        populate_parallel(haplotypes, order, read_hashes, flank_state);
+    } else {
+        if (buffers_.haplotype_hashes.bin_offsets.empty()) {
+            buffers_.haplotype_hashes = init_kmer_hash_table<mapperKmerSize>();
+        }
+        for (auto& local_likelihoods : buffers_.local_likelihoods) local_likelihoods.clear();
+        for (const auto haplotype_idx : order) {
+            populate(haplotype_idx, haplotypes[haplotype_idx], read_hashes, flank_state, likelihood_model_, buffers_);
         }
-        clear_kmer_hash_table(haplotype_hashes);
     }
     likelihood_model_.clear();
     read_iterators_.clear();
@@ -92,49 +263,129 @@ void HaplotypeLikelihoodArray::populate(const ReadMap& reads,
 
 std::size_t HaplotypeLikelihoodArray::num_likelihoods(const SampleName& sample) const
 {
-    return std::cbegin(cache_)->second.at(sample_indices_.at(sample)).size();
+    return matrices_[sample_indices_.at(sample)].num_reads;
 }
 
 const HaplotypeLikelihoodArray::LikelihoodVector&
 HaplotypeLikelihoodArray::operator()(const SampleName& sample, const Haplotype& haplotype) const
 {
-    return cache_.at(haplotype)[sample_indices_.at(sample)];
+    return (*this)(sample_indices_.at(sample), haplotype_indices_.at(haplotype));
 }
 
 const HaplotypeLikelihoodArray::LikelihoodVector&
 HaplotypeLikelihoodArray::operator[](const Haplotype& haplotype) const
 {
-    return cache_.at(haplotype)[*primed_sample_];
+    return primed_likelihoods()[haplotype];
 }
 
-HaplotypeLikelihoodArray::SampleLikelihoodMap
-HaplotypeLikelihoodArray::extract_sample(const SampleName& sample) const
+std::size_t HaplotypeLikelihoodArray::num_haplotypes() const noexcept
 {
-    const auto sample_index = sample_indices_.at(sample);
-    SampleLikelihoodMap result {cache_.size()};
-    for (const auto& p : cache_) {
-        result.emplace(p.first, p.second[sample_index]);
-    }
+    return num_haplotypes_;
+}
+
+std::size_t HaplotypeLikelihoodArray::sample_index(const SampleName& sample) const
+{
+    return sample_indices_.at(sample);
+}
+
+std::size_t HaplotypeLikelihoodArray::haplotype_index(const Haplotype& haplotype) const
+{
+    return haplotype_indices_.at(haplotype);
+}
+
+const HaplotypeLikelihoodArray::LikelihoodVector&
+HaplotypeLikelihoodArray::operator()(const std::size_t sample_index, const std::size_t haplotype_index) const noexcept
+{
+    assert(sample_index < matrices_.size() && haplotype_index < matrices_[sample_index].rows.size());
+    return matrices_[sample_index].rows[haplotype_index];
+}
+
+HaplotypeLikelihoodArray::SampleLikelihoods
+HaplotypeLikelihoodArray::sample_likelihoods(const SampleName& sample) const
+{
+    return sample_likelihoods(sample_indices_.at(sample));
+}
+
+HaplotypeLikelihoodArray::SampleLikelihoods
+HaplotypeLikelihoodArray::sample_likelihoods(const std::size_t sample_index) const noexcept
+{
+    assert(sample_index < matrices_.size());
+    return {*this, matrices_[sample_index].rows};
+}
+
+HaplotypeLikelihoodArray::SampleLikelihoods HaplotypeLikelihoodArray::primed_likelihoods() const noexcept
+{
+    assert(is_primed());
+    return sample_likelihoods(*primed_sample_);
+}
+
+HaplotypeLikelihoodArray::MergedSampleLikelihoods
+HaplotypeLikelihoodArray::merged_likelihoods(const std::vector<SampleName>& samples) const
+{
+    std::vector<SampleLikelihoods> result {};
+    result.reserve(samples.size());
+    for (const auto& sample : samples) result.push_back(sample_likelihoods(sample));
+    return {*this, std::move(result)};
+}
+
+std::size_t HaplotypeLikelihoodArray::MergedSampleLikelihoods::num_likelihoods() const noexcept
+{
+    std::size_t result {0};
+    for (const auto& sample : samples_) result += sample.num_likelihoods();
     return result;
 }
 
+const HaplotypeLikelihoodArray::LikelihoodVector&
+HaplotypeLikelihoodArray::SampleLikelihoods::operator[](const Haplotype& haplotype) const
+{
+    return (*this)[array_->haplotype_index(haplotype)];
+}
+
 bool HaplotypeLikelihoodArray::contains(const Haplotype& haplotype) const noexcept
 {
-    return cache_.count(haplotype) == 1;
+    return haplotype_indices_.count(haplotype) == 1;
 }
 
 bool HaplotypeLikelihoodArray::is_empty() const noexcept
 {
-    return cache_.empty();
+    return haplotype_indices_.empty();
 }
 
 void HaplotypeLikelihoodArray::clear() noexcept
 {
-    cache_.clear();
+    for (auto& matrix : matrices_) matrix.clear();
+    haplotype_indices_.clear();
+    num_haplotypes_ = 0;
     sample_indices_.clear();
+    genotype_likelihoods_.clear();
+    invalidate_compression();
     unprime();
 }
 
+MemoryFootprint HaplotypeLikelihoodArray::footprint() const noexcept
+{
+    const auto matrix_bytes = [] (const LikelihoodMatrix& matrix) noexcept {
+        return matrix.likelihoods.capacity() * sizeof(StoredLogProbability) + matrix.rows.capacity() * sizeof(LikelihoodVector);
+    };
+    std::size_t bytes {sizeof(HaplotypeLikelihoodArray)};
+    for (const auto& matrix : matrices_) bytes += sizeof(LikelihoodMatrix) + matrix_bytes(matrix);
+    for (const auto& compressed : compressed_) {
+        bytes += sizeof(CompressedLikelihoods) + matrix_bytes(compressed.matrix);
+        bytes += compressed.read_weights.capacity() * sizeof(LogProbability);
+    }
+    bytes += haplotype_indices_.size() * (sizeof(Haplotype) + sizeof(std::size_t) + 2 * sizeof(void*));
+    bytes += genotype_likelihoods_.size() * (sizeof(GenotypeLikelihoodTable::HaplotypeIndexTuple) + sizeof(LogProbability) + 2 * sizeof(void*));
+    bytes += (buffers_.unique_likelihoods.capacity() + buffers_.evaluated_likelihoods.capacity()) * sizeof(LogProbability);
+    for (const auto& buffered : buffers_.buffered) bytes += buffered.likelihoods.capacity() * sizeof(LogProbability);
+    return bytes;
+}
+
+MemoryFootprint HaplotypeLikelihoodArray::estimate_footprint(const std::size_t num_haplotypes, const std::size_t num_reads) noexcept
+{
+    return num_haplotypes * (round_up_to_cache_line(num_reads) * sizeof(LogProbability) + sizeof(LikelihoodVector)
+                             + sizeof(Haplotype) + sizeof(std::size_t) + 2 * sizeof(void*));
+}
+
 bool HaplotypeLikelihoodArray::is_primed() const noexcept
 {
     return static_cast<bool>(primed_sample_);
@@ -143,6 +394,11 @@ bool HaplotypeLikelihoodArray::is_primed() const noexcept
 void HaplotypeLikelihoodArray::prime(const SampleName& sample) const
 {
     primed_sample_ = sample_indices_.at(sample);
+    if (read_compression_tolerance_) {
+        if (compressed_.size() <= *primed_sample_ || !compressed_[*primed_sample_].is_current) {
+            compress(*primed_sample_);
+        }
+    }
 }
 
 void HaplotypeLikelihoodArray::unprime() const noexcept
@@ -152,6 +408,328 @@ void HaplotypeLikelihoodArray::unprime() const noexcept
 
 // private methods
 
+HaplotypeLikelihoodArray::LikelihoodMatrix::LikelihoodMatrix(const LikelihoodMatrix& other)
+: num_reads {other.num_reads}
+, row_stride {other.row_stride}
+, likelihoods {other.likelihoods}
+, rows {}
+{
+    rows.resize(other.rows.size());
+    update_rows();
+}
+
+HaplotypeLikelihoodArray::LikelihoodMatrix&
+HaplotypeLikelihoodArray::LikelihoodMatrix::operator=(const LikelihoodMatrix& other)
+{
+    if (this != &other) {
+        num_reads = other.num_reads;
+        row_stride = other.row_stride;
+        likelihoods = other.likelihoods;
+        rows.resize(other.rows.size());
+        update_rows();
+    }
+    return *this;
+}
+
+void HaplotypeLikelihoodArray::LikelihoodMatrix::reset(const std::size_t num_haplotypes, const std::size_t num_reads)
+{
+    this->num_reads = num_reads;
+    row_stride = round_up_to_cache_line(num_reads);
+    likelihoods.resize(num_haplotypes * row_stride);
+    rows.resize(num_haplotypes);
+    update_rows();
+}
+
+void HaplotypeLikelihoodArray::LikelihoodMatrix::resize(const std::size_t num_haplotypes)
+{
+    likelihoods.resize(num_haplotypes * row_stride);
+    rows.resize(num_haplotypes);
+    update_rows();
+}
+
+void HaplotypeLikelihoodArray::LikelihoodMatrix::clear() noexcept
+{
+    num_reads = 0;
+    row_stride = 0;
+    likelihoods.clear();
+    rows.clear();
+}
+
+HaplotypeLikelihoodArray::StoredLogProbability*
+HaplotypeLikelihoodArray::LikelihoodMatrix::row(const std::size_t haplotype_index) noexcept
+{
+    return likelihoods.data() + haplotype_index * row_stride;
+}
+
+void HaplotypeLikelihoodArray::LikelihoodMatrix::update_rows()
+{
+    for (std::size_t i {0}; i < rows.size(); ++i) {
+        rows[i] = LikelihoodVector {likelihoods.data() + i * row_stride, num_reads};
+    }
+}
+
+bool HaplotypeLikelihoodArray::use_workers(const std::size_t num_haplotypes) const noexcept
+{
+    if (workers_ == nullptr || workers_->empty() || num_haplotypes < 2) return false;
+    std::size_t num_reads {0};
+    for (const auto& t : read_iterators_) num_reads += t.unique_reads.size();
+    return num_haplotypes * num_reads >= min_parallel_cells_;
+}
+
+namespace {
+
+using KmerHashes = std::vector<KmerPerfectHashes>;
+using MappingPositionVectors = std::vector<HaplotypeLikelihoodModel::MappingPositionVector>;
+
+template <typename IndexMap>
+void map_reads(const KmerHashes& read_hashes, const std::size_t num_reads, IndexMap read_index,
+               const KmerHashTable& haplotype_hashes, MappedIndexCounts& mapping_counts,
+               const std::size_t max_mapping_positions, MappingPositionVectors& result)
+{
+    if (result.size() < num_reads) {
+        result.resize(num_reads);
+    }
+    for (std::size_t i {0}; i < num_reads; ++i) {
+        auto& read_mapping_positions = result[i];
+        read_mapping_positions.resize(max_mapping_positions);
+        const auto last_mapping_position = map_query_to_target(read_hashes[read_index(i)], haplotype_hashes,
+                                                               mapping_counts,
+                                                               std::begin(read_mapping_positions),
+                                                               max_mapping_positions);
+        read_mapping_positions.erase(last_mapping_position, std::end(read_mapping_positions));
+        reset_mapping_counts(mapping_counts);
+    }
+    result.resize(num_reads);
+}
+
+} // namespace
+
+void HaplotypeLikelihoodArray::populate(const std::size_t haplotype_index, const Haplotype& haplotype,
+                                        const ReadHashes& read_hashes, const boost::optional<FlankState>& flank_state,
+                                        HaplotypeLikelihoodModel& likelihood_model, PopulationBuffers& buffers)
+{
+    boost::optional<ReadHaplotypeLikelihoodCache::Entry> cached {};
+    std::size_t num_misses {0};
+    if (likelihood_cache_) {
+        cached = likelihood_cache_->take(haplotype, flank_state);
+        if (cached) {
+            for (const auto& t : read_iterators_) {
+                num_misses += std::count_if(std::cbegin(t.unique_read_ids), std::cend(t.unique_read_ids),
+                                            [&] (const auto id) { return !cached->find(id); });
+            }
+        } else {
+            cached = ReadHaplotypeLikelihoodCache::Entry {haplotype, flank_state, {}};
+            for (const auto& t : read_iterators_) num_misses += t.unique_reads.size();
+        }
+        std::size_t num_reads {0};
+        for (const auto& t : read_iterators_) num_reads += t.unique_reads.size();
+        likelihood_cache_->record(num_reads - num_misses, num_misses);
+    }
+    auto& haplotype_hashes = buffers.haplotype_hashes;
+    auto& mapping_positions = buffers.mapping_positions;
+    auto& unique_likelihoods = buffers.unique_likelihoods;
+    const bool needs_evaluation {!cached || num_misses > 0};
+    bool can_reuse_buffered {false};
+    if (needs_evaluation) {
+        populate_haplotype_hashes(haplotype, haplotype_hashes);
+        can_reuse_buffered = likelihood_model.reset_incremental(haplotype, flank_state);
+        buffers.buffered.resize(read_iterators_.size());
+        if (reuse_local_likelihoods_) buffers.local_likelihoods.resize(read_iterators_.size());
+    }
+    auto& haplotype_mapping_counts = buffers.mapping_counts;
+    init_mapping_counts(haplotype_hashes, haplotype_mapping_counts);
+    auto read_hash_itr = std::cbegin(read_hashes);
+    auto matrix_itr = std::begin(matrices_);
+    auto buffered_itr = std::begin(buffers.buffered);
+    auto local_likelihoods_itr = std::begin(buffers.local_likelihoods);
+    for (const auto& t : read_iterators_) { // for each sample
+        const auto num_unique_reads = t.unique_reads.size();
+        const auto row = matrix_itr->row(haplotype_index);
+        unique_likelihoods.resize(num_unique_reads);
+        auto& evaluation_indices = buffers.evaluation_indices;
+        auto& evaluation_reads = buffers.evaluation_reads;
+        auto& new_cached_likelihoods = buffers.new_cached_likelihoods;
+        evaluation_indices.clear();
+        evaluation_reads.clear();
+        new_cached_likelihoods.clear();
+        for (std::size_t i {0}; i < num_unique_reads; ++i) {
+            boost::optional<LogProbability> cached_likelihood {};
+            if (cached) cached_likelihood = cached->find(t.unique_read_ids[i]);
+            if (cached_likelihood) {
+                unique_likelihoods[i] = *cached_likelihood;
+            } else {
+                evaluation_indices.push_back(i);
+            }
+        }
+        if (needs_evaluation) {
+            // The model now buffers this haplotype, so the buffered likelihoods must be kept in sync with it
+            auto& buffered = *buffered_itr;
+            if (!can_reuse_buffered) {
+                buffered.mapping_positions.resize(num_unique_reads);
+                buffered.is_mapped.assign(num_unique_reads, false);
+                buffered.likelihoods.resize(num_unique_reads);
+            } else if (evaluation_indices.size() < num_unique_reads) {
+                // Cached reads are not mapped to this haplotype so cannot be reused for the next one
+                for (std::size_t i {0}, j {0}; i < num_unique_reads; ++i) {
+                    if (j < evaluation_indices.size() && evaluation_indices[j] == i) {
+                        ++j;
+                    } else {
+                        buffered.is_mapped[i] = false;
+                    }
+                }
+            }
+            if (!evaluation_indices.empty()) {
+                map_reads(*read_hash_itr, evaluation_indices.size(), [&] (auto i) { return evaluation_indices[i]; },
+                          haplotype_hashes, haplotype_mapping_counts, maxMappingPositions, mapping_positions);
+                // Reads confined to the prefix shared with the buffered haplotype do not need to be evaluated again
+                auto& evaluation_signatures = buffers.evaluation_signatures;
+                evaluation_signatures.clear();
+                std::size_t num_evaluations {0};
+                for (std::size_t i {0}; i < evaluation_indices.size(); ++i) {
+                    const auto unique_idx = evaluation_indices[i];
+                    const AlignedRead& read = t.unique_reads[unique_idx];
+                    if (can_reuse_buffered && buffered.is_mapped[unique_idx]
+                        && buffered.mapping_positions[unique_idx] == mapping_positions[i]
+                        && likelihood_model.is_unchanged(read, mapping_positions[i])) {
+                        unique_likelihoods[unique_idx] = buffered.likelihoods[unique_idx];
+                        if (cached) new_cached_likelihoods.emplace_back(t.unique_read_ids[unique_idx], unique_likelihoods[unique_idx]);
+                        continue;
+                    }
+                    boost::optional<HaplotypeLikelihoodModel::LocalSignature> signature {};
+                    if (reuse_local_likelihoods_) {
+                        // Reads aligned to the same local sequence as for an earlier haplotype do not need to be evaluated again
+                        signature = likelihood_model.local_signature(read, mapping_positions[i]);
+                        if (signature) {
+                            const auto local_itr = local_likelihoods_itr->find({unique_idx, *signature});
+                            if (local_itr != std::cend(*local_likelihoods_itr)) {
+                                unique_likelihoods[unique_idx] = local_itr->second;
+                                if (cached) new_cached_likelihoods.emplace_back(t.unique_read_ids[unique_idx], local_itr->second);
+                                buffered.mapping_positions[unique_idx] = mapping_positions[i];
+                                buffered.is_mapped[unique_idx] = true;
+                                buffered.likelihoods[unique_idx] = local_itr->second;
+                                continue;
+                            }
+                        }
+                        evaluation_signatures.push_back(signature);
+                    }
+                    using std::swap;
+                    swap(mapping_positions[num_evaluations], mapping_positions[i]);
+                    evaluation_indices[num_evaluations++] = unique_idx;
+                    evaluation_reads.push_back(read);
+                }
+                evaluation_indices.resize(num_evaluations);
+                mapping_positions.resize(num_evaluations);
+                auto& evaluated_likelihoods = buffers.evaluated_likelihoods;
+                evaluated_likelihoods.resize(num_evaluations);
+                if (num_evaluations > 0) {
+                    likelihood_model.evaluate(std::cbegin(evaluation_reads), std::cend(evaluation_reads),
+                                              mapping_positions, evaluated_likelihoods.data());
+                }
+                for (std::size_t i {0}; i < num_evaluations; ++i) {
+                    const auto unique_idx = evaluation_indices[i];
+                    unique_likelihoods[unique_idx] = evaluated_likelihoods[i];
+                    if (cached) new_cached_likelihoods.emplace_back(t.unique_read_ids[unique_idx], evaluated_likelihoods[i]);
+                    using std::swap;
+                    swap(buffered.mapping_positions[unique_idx], mapping_positions[i]);
+                    buffered.is_mapped[unique_idx] = true;
+                    buffered.likelihoods[unique_idx] = evaluated_likelihoods[i];
+                    if (reuse_local_likelihoods_ && evaluation_signatures[i]) {
+                        local_likelihoods_itr->emplace(PopulationBuffers::LocalLikelihoodKey {unique_idx, *evaluation_signatures[i]},
+                                                       evaluated_likelihoods[i]);
+                    }
+                }
+                if (cached) cached->insert(new_cached_likelihoods);
+            }
+        }
+        if (t.unique_read_indices.empty()) {
+            std::copy(std::cbegin(unique_likelihoods), std::cend(unique_likelihoods), row);
+        } else {
+            std::transform(std::cbegin(t.unique_read_indices), std::cend(t.unique_read_indices), row,
+                           [&] (const auto unique_idx) noexcept { return unique_likelihoods[unique_idx]; });
+        }
+        ++read_hash_itr;
+        ++matrix_itr;
+        if (needs_evaluation) {
+            ++buffered_itr;
+            if (reuse_local_likelihoods_) ++local_likelihoods_itr;
+        }
+    }
+    if (needs_evaluation) {
+        clear_kmer_hash_table(haplotype_hashes);
+    }
+    if (cached) {
+        likelihood_cache_->put(std::move(*cached));
+    }
+}
+
+namespace {
+
+struct ParallelPopulationState
+{
+    ParallelPopulationState(const HaplotypeLikelihoodModel& model, std::size_t num_haplotypes)
+    : model {model}, num_haplotypes {num_haplotypes} {}
+    const HaplotypeLikelihoodModel model; // copied by workers
+    const std::size_t num_haplotypes;
+    std::atomic<std::size_t> next_haplotype {0};
+    std::atomic<bool> failed {false};
+    std::mutex mutex {};
+    std::condition_variable done_cv {};
+    std::size_t num_done {0};
+    std::exception_ptr error {};
+};
+
+} // namespace
+
+void HaplotypeLikelihoodArray::populate_parallel(const std::vector<Haplotype>& haplotypes, const std::vector<std::size_t>& order,
+                                                 const ReadHashes& read_hashes, const boost::optional<FlankState>& flank_state)
+{
+    // Blocks of consecutive haplotypes (in order) are claimed by the calling thread and any workers that
+    // pick up a task before all haplotypes are claimed. Each thread has its own copy of the model and
+    // mapping buffers, and writes to distinct matrix rows. Workers that start late only touch the shared
+    // state, so the calling thread never needs to wait for queued tasks. Claiming blocks rather than
+    // single haplotypes keeps haplotypes with common prefixes on the same thread.
+    auto state = std::make_shared<ParallelPopulationState>(likelihood_model_, haplotypes.size());
+    const auto num_helpers = std::min(workers_->n_idle(), haplotypes.size() - 1);
+    const auto block_size = std::max(haplotypes.size() / (4 * (num_helpers + 1)), std::size_t {1});
+    const auto work = [this, state, block_size, &haplotypes, &order, &read_hashes, &flank_state] (HaplotypeLikelihoodModel* model) {
+        boost::optional<HaplotypeLikelihoodModel> worker_model {};
+        PopulationBuffers buffers {};
+        for (auto block_begin = state->next_haplotype.fetch_add(block_size); block_begin < state->num_haplotypes;
+             block_begin = state->next_haplotype.fetch_add(block_size)) {
+            const auto block_end = std::min(block_begin + block_size, state->num_haplotypes);
+            for (auto order_idx = block_begin; order_idx < block_end; ++order_idx) {
+                if (!state->failed) {
+                    try {
+                        if (model == nullptr) {
+                            worker_model = state->model;
+                            model = std::addressof(*worker_model);
+                        }
+                        if (buffers.haplotype_hashes.bin_offsets.empty()) {
+                            buffers.haplotype_hashes = init_kmer_hash_table<mapperKmerSize>();
+                        }
+                        const auto haplotype_idx = order[order_idx];
+                        this->populate(haplotype_idx, haplotypes[haplotype_idx], read_hashes, flank_state, *model, buffers);
+                    } catch (...) {
+                        std::lock_guard<std::mutex> lock {state->mutex};
+                        if (!state->error) state->error = std::current_exception();
+                        state->failed = true;
+                    }
+                }
+            }
+            std::lock_guard<std::mutex> lock {state->mutex};
+            state->num_done += block_end - block_begin;
+            if (state->num_done == state->num_haplotypes) state->done_cv.notify_all();
+        }
+    };
+    for (std::size_t i {0}; i < num_helpers; ++i) {
+        workers_->push(work, nullptr);
+    }
+    work(std::addressof(likelihood_model_));
+    std::unique_lock<std::mutex> lock {state->mutex};
+    state->done_cv.wait(lock, [&] () { return state->num_done == state->num_haplotypes; });
+    if (state->error) std::rethrow_exception(state->error);
+}
+
 void HaplotypeLikelihoodArray::set_read_iterators_and_sample_indices(const ReadMap& reads)
 {
     read_iterators_.clear();
@@ -170,24 +748,136 @@ void HaplotypeLikelihoodArray::set_read_iterators_and_sample_indices(const ReadM
     }
 }
 
-// non-member methods
+KmerPerfectHashes HaplotypeLikelihoodArray::compute_read_hashes(const AlignedRead& read) const
+{
+    if (long_read_mapping_) {
+        return compute_kmer_hashes<longReadMapperKmerSize>(read.sequence());
+    } else {
+        return compute_kmer_hashes<mapperKmerSize>(read.sequence());
+    }
+}
 
-HaplotypeLikelihoodArray merge_samples(const std::vector<SampleName>& samples,
-                                       const SampleName& new_sample,
-                                       const std::vector<Haplotype>& haplotypes,
-                                       const HaplotypeLikelihoodArray& haplotype_likelihoods)
+void HaplotypeLikelihoodArray::populate_haplotype_hashes(const Haplotype& haplotype, KmerHashTable& result) const
 {
-    HaplotypeLikelihoodArray result {static_cast<unsigned>(haplotypes.size()), {new_sample}};
-    for (const auto& haplotype : haplotypes) {
-        HaplotypeLikelihoodArray::LikelihoodVector likelihoods {};
-        for (const auto& sample : samples) {
-            const auto& m = haplotype_likelihoods(sample, haplotype);
-            likelihoods.insert(std::end(likelihoods), std::cbegin(m), std::cend(m));
+    if (long_read_mapping_) {
+        populate_kmer_hash_table<longReadMapperKmerSize>(haplotype.sequence(), result);
+    } else {
+        populate_kmer_hash_table<mapperKmerSize>(haplotype.sequence(), result);
+    }
+}
+
+HaplotypeLikelihoodArray::StoredLogProbability*
+HaplotypeLikelihoodArray::allocate_row(const std::size_t sample_index, const Haplotype& haplotype,
+                                       const std::size_t num_reads)
+{
+    if (matrices_.size() <= sample_index) {
+        matrices_.resize(sample_index + 1);
+    }
+    auto& matrix = matrices_[sample_index];
+    if (matrix.rows.empty()) {
+        matrix.reset(0, num_reads);
+    } else if (matrix.num_reads != num_reads) {
+        throw std::invalid_argument {"HaplotypeLikelihoodArray: inconsistent number of likelihoods for sample"};
+    }
+    const auto itr = haplotype_indices_.emplace(haplotype, num_haplotypes_);
+    const auto haplotype_index = itr.first->second;
+    if (itr.second) {
+        ++num_haplotypes_;
+    } else {
+        // The haplotype's likelihoods may change
+        genotype_likelihoods_.erase_haplotypes({haplotype_index});
+    }
+    if (matrix.rows.size() <= haplotype_index) {
+        matrix.resize(haplotype_index + 1);
+    }
+    invalidate_compression();
+    return matrix.row(haplotype_index);
+}
+
+void HaplotypeLikelihoodArray::invalidate_compression() noexcept
+{
+    for (auto& compressed : compressed_) compressed.is_current = false;
+}
+
+// Erased haplotypes keep their rows, so are included in the compression. This is still exact for
+// the remaining haplotypes, just less compressed.
+void HaplotypeLikelihoodArray::compress(const std::size_t sample_index) const
+{
+    assert(read_compression_tolerance_ && sample_index < matrices_.size());
+    if (compressed_.size() <= sample_index) {
+        compressed_.resize(sample_index + 1);
+    }
+    const auto& matrix = matrices_[sample_index];
+    auto& result = compressed_[sample_index];
+    const auto num_rows = matrix.rows.size();
+    const auto num_reads = matrix.num_reads;
+    result.uninformative_log_likelihood = 0;
+    result.read_weights.clear();
+    std::vector<std::size_t> informative_reads {};
+    if (num_rows > 0) {
+        std::vector<LogProbability> min_likelihoods(matrix.rows.front().begin(), matrix.rows.front().end());
+        auto max_likelihoods = min_likelihoods;
+        for (std::size_t h {1}; h < num_rows; ++h) {
+            const auto& likelihoods = matrix.rows[h];
+            for (std::size_t n {0}; n < num_reads; ++n) {
+                min_likelihoods[n] = std::min(min_likelihoods[n], likelihoods[n]);
+                max_likelihoods[n] = std::max(max_likelihoods[n], likelihoods[n]);
+            }
+        }
+        informative_reads.reserve(num_reads);
+        for (std::size_t n {0}; n < num_reads; ++n) {
+            if (max_likelihoods[n] - min_likelihoods[n] <= *read_compression_tolerance_) {
+                result.uninformative_log_likelihood += (min_likelihoods[n] + max_likelihoods[n]) / 2;
+            } else {
+                informative_reads.push_back(n);
+            }
         }
-        likelihoods.shrink_to_fit();
-        result.insert(new_sample, haplotype, std::move(likelihoods));
     }
-    return result;
+    // Sorting the columns brings duplicates together, stable so the first read of each run represents it
+    std::stable_sort(std::begin(informative_reads), std::end(informative_reads), [&] (const auto lhs, const auto rhs) {
+        for (const auto& row : matrix.rows) {
+            if (row[lhs] != row[rhs]) return row[lhs] < row[rhs];
+        }
+        return false;
+    });
+    const auto is_duplicate = [&] (const auto lhs, const auto rhs) {
+        return std::all_of(std::cbegin(matrix.rows), std::cend(matrix.rows),
+                           [=] (const auto& row) { return row[lhs] == row[rhs]; });
+    };
+    std::vector<std::pair<std::size_t, LogProbability>> unique_reads {};
+    for (std::size_t i {0}; i < informative_reads.size(); ++i) {
+        if (i > 0 && is_duplicate(informative_reads[i], informative_reads[i - 1])) {
+            ++unique_reads.back().second;
+        } else {
+            unique_reads.emplace_back(informative_reads[i], 1);
+        }
+    }
+    // Keep the original read order so sums are accumulated in a consistent order
+    std::sort(std::begin(unique_reads), std::end(unique_reads));
+    result.matrix.reset(num_rows, unique_reads.size());
+    for (std::size_t h {0}; h < num_rows; ++h) {
+        const auto* likelihoods = matrix.rows[h].data();
+        auto* compressed_likelihoods = result.matrix.row(h);
+        for (std::size_t u {0}; u < unique_reads.size(); ++u) {
+            compressed_likelihoods[u] = likelihoods[unique_reads[u].first];
+        }
+    }
+    result.read_weights.reserve(unique_reads.size());
+    for (const auto& p : unique_reads) result.read_weights.push_back(p.second);
+    result.is_current = true;
+}
+
+// non-member methods
+
+HaplotypeLikelihoodArray::MergedSampleLikelihoods
+merge_samples(const std::vector<SampleName>& samples, const HaplotypeLikelihoodArray& haplotype_likelihoods)
+{
+    return haplotype_likelihoods.merged_likelihoods(samples);
+}
+
+MemoryFootprint footprint(const HaplotypeLikelihoodArray& haplotype_likelihoods) noexcept
+{
+    return haplotype_likelihoods.footprint();
 }
 
 namespace debug {
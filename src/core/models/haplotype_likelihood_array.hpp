@@ -7,24 +7,58 @@
 #include <unordered_map>
 #include <vector>
 #include <algorithm>
+#include <iterator>
 #include <functional>
+#include <cstddef>
+#include <memory>
 
 #include <boost/optional.hpp>
+#include <boost/align/aligned_allocator.hpp>
 
 #include "config/common.hpp"
 #include "core/types/haplotype.hpp"
 #include "basics/aligned_read.hpp"
 #include "utils/kmer_mapper.hpp"
+#include "utils/memory_footprint.hpp"
 #include "haplotype_likelihood_model.hpp"
+#include "read_haplotype_likelihood_cache.hpp"
+#include "genotype_likelihood_table.hpp"
 
 namespace octopus {
 
+class ThreadPool;
+
 /*
     HaplotypeLikelihoodArray is essentially a matrix of haplotype likelihoods, i.e.
     p(read | haplotype) for a given set of AlignedReads and Haplotypes.
  
     The matrix can be efficiently populated as the read mapping and alignment are
-    done internally which allows minimal memory allocation.
+    done internally which allows minimal memory allocation. Reads that must have the
+    same likelihood for every haplotype (same sequence, base qualities, mapping position,
+    strand, and mapping quality) are only evaluated once.
+ 
+    The likelihoods of each sample are stored in a single cache aligned row-major
+    (haplotype x read) matrix, with each row starting on a cache line boundary.
+    Haplotypes are indexed in the order they are given to populate, and the index
+    based accessors should be preferred in hot loops as they avoid hashing Haplotypes.
+ 
+    Local likelihood reuse can be enabled so that a read is only evaluated once for all haplotypes
+    that are identical around the read alignments (i.e. the haplotypes differ only outside the read).
+ 
+    A likelihood cache can be enabled to keep likelihoods between populations, so haplotypes
+    that are re-proposed in later (overlapping) active regions are not re-evaluated against
+    the same reads.
+ 
+    If workers are set, then large populations (e.g. many haplotypes in a deep region)
+    are shared between the calling thread and any idle workers.
+ 
+    Genotype log likelihoods computed from the array can be memoised in a
+    GenotypeLikelihoodTable keyed by haplotype index, which is invalidated with the
+    haplotypes it depends on (by erase, insert, populate, or clear).
+ 
+    If octopus is built with OCTOPUS_SINGLE_PRECISION_LIKELIHOODS then the read likelihoods are
+    stored as floats, which halves the size of the matrices. Likelihoods are still computed, and
+    should be accumulated, in double precision.
  */
 class HaplotypeLikelihoodArray
 {
@@ -32,10 +66,95 @@ public:
     using FlankState = HaplotypeLikelihoodModel::FlankState;
     
     using LogProbability       = HaplotypeLikelihoodModel::LogProbability;
-    using LikelihoodVector     = std::vector<LogProbability>;
+#ifdef OCTOPUS_SINGLE_PRECISION_LIKELIHOODS
+    using StoredLogProbability = float;
+#else
+    using StoredLogProbability = LogProbability;
+#endif
+    
+    // A view of one row of a sample likelihood matrix, i.e. the likelihoods of all reads
+    // in the sample for a single haplotype.
+    class LikelihoodVector
+    {
+    public:
+        using value_type     = StoredLogProbability;
+        using size_type      = std::size_t;
+        using const_iterator = const StoredLogProbability*;
+        using iterator       = const_iterator;
+        
+        LikelihoodVector() = default;
+        LikelihoodVector(const StoredLogProbability* first, std::size_t size) noexcept : first_ {first}, size_ {size} {}
+        
+        std::size_t size() const noexcept { return size_; }
+        bool empty() const noexcept { return size_ == 0; }
+        const StoredLogProbability* data() const noexcept { return first_; }
+        const_iterator begin() const noexcept { return first_; }
+        const_iterator end() const noexcept { return first_ + size_; }
+        const_iterator cbegin() const noexcept { return begin(); }
+        const_iterator cend() const noexcept { return end(); }
+        LogProbability operator[](std::size_t n) const noexcept { return first_[n]; }
+        LogProbability front() const noexcept { return *first_; }
+        LogProbability back() const noexcept { return first_[size_ - 1]; }
+    
+    private:
+        const StoredLogProbability* first_ = nullptr;
+        std::size_t size_ = 0;
+    };
+    
     using LikelihoodVectorRef  = std::reference_wrapper<const LikelihoodVector>;
-    using HaplotypeRef         = std::reference_wrapper<const Haplotype>;
-    using SampleLikelihoodMap  = std::unordered_map<HaplotypeRef, LikelihoodVectorRef>;
+    
+    // A view of all the likelihoods of one sample, indexed by haplotype index. Views are obtained once per
+    // sample and are invalidated by any modification of the array.
+    class SampleLikelihoods
+    {
+    public:
+        SampleLikelihoods() = default;
+        SampleLikelihoods(const HaplotypeLikelihoodArray& array, const std::vector<LikelihoodVector>& rows,
+                          const LogProbability* read_weights = nullptr,
+                          LogProbability uninformative_log_likelihood = 0) noexcept
+        : array_ {&array}, rows_ {rows.data()}, num_haplotypes_ {rows.size()}
+        , read_weights_ {read_weights}, uninformative_log_likelihood_ {uninformative_log_likelihood} {}
+        
+        std::size_t num_haplotypes() const noexcept { return num_haplotypes_; }
+        std::size_t num_likelihoods() const noexcept { return num_haplotypes_ > 0 ? rows_->size() : 0; }
+        const LikelihoodVector& operator[](std::size_t haplotype_index) const noexcept { return rows_[haplotype_index]; }
+        const LikelihoodVector& operator[](const Haplotype& haplotype) const;
+        // Null unless the likelihoods are read compressed
+        const LogProbability* read_weights() const noexcept { return read_weights_; }
+        LogProbability uninformative_log_likelihood() const noexcept { return uninformative_log_likelihood_; }
+    
+    private:
+        const HaplotypeLikelihoodArray* array_ = nullptr;
+        const LikelihoodVector* rows_ = nullptr;
+        std::size_t num_haplotypes_ = 0;
+        const LogProbability* read_weights_ = nullptr;
+        LogProbability uninformative_log_likelihood_ = 0;
+    };
+    
+    // A view of the likelihoods of several samples as if they were a single sample, i.e. as if the
+    // likelihood vectors of each haplotype were concatenated. Nothing is copied, and the view does not
+    // depend on which sample is primed. Views are invalidated by any modification of the array.
+    class MergedSampleLikelihoods
+    {
+    public:
+        using const_iterator = std::vector<SampleLikelihoods>::const_iterator;
+        
+        MergedSampleLikelihoods() = default;
+        MergedSampleLikelihoods(const HaplotypeLikelihoodArray& array, std::vector<SampleLikelihoods> samples) noexcept
+        : array_ {&array}, samples_ {std::move(samples)} {}
+        
+        const HaplotypeLikelihoodArray& array() const noexcept { return *array_; }
+        std::size_t num_samples() const noexcept { return samples_.size(); }
+        std::size_t num_haplotypes() const noexcept { return array_->num_haplotypes(); }
+        std::size_t num_likelihoods() const noexcept;
+        const SampleLikelihoods& operator[](std::size_t n) const noexcept { return samples_[n]; }
+        const_iterator begin() const noexcept { return samples_.cbegin(); }
+        const_iterator end() const noexcept { return samples_.cend(); }
+    
+    private:
+        const HaplotypeLikelihoodArray* array_ = nullptr;
+        std::vector<SampleLikelihoods> samples_;
+    };
     
     HaplotypeLikelihoodArray() = default;
     
@@ -52,6 +171,42 @@ public:
     
     ~HaplotypeLikelihoodArray() = default;
     
+    static constexpr std::size_t defaultMinParallelCells {100'000};
+    
+    // populate will only use the workers when there are at least min_parallel_cells (haplotype x read) likelihoods.
+    // The workers must outlive this object.
+    void set_workers(ThreadPool& workers, std::size_t min_parallel_cells = defaultMinParallelCells) noexcept;
+    
+    // The cache is not emptied by clear. Copies of this object share the cache.
+    void set_likelihood_cache(std::size_t max_likelihoods);
+    std::size_t num_cache_hits() const noexcept;
+    std::size_t num_cache_misses() const noexcept;
+    
+    void set_local_likelihood_reuse(bool reuse = true) noexcept;
+    
+    // Map reads to haplotypes with longer k-mers, which are less ambiguous for long sequences
+    void set_long_read_mapping(bool long_reads = true) noexcept;
+    
+    static constexpr std::size_t defaultMaxGenotypeLikelihoods {100'000};
+    
+    // A max_genotype_likelihoods of zero disables genotype likelihood memoisation.
+    void set_genotype_likelihood_table(std::size_t max_genotype_likelihoods = defaultMaxGenotypeLikelihoods);
+    bool has_genotype_likelihood_table() const noexcept;
+    const GenotypeLikelihoodTable& genotype_likelihood_table() const noexcept;
+    // Lookup and memoisation for the primed sample
+    boost::optional<LogProbability> find_genotype_likelihood(const GenotypeLikelihoodTable::HaplotypeIndexTuple& genotype) const;
+    void memoise_genotype_likelihood(const GenotypeLikelihoodTable::HaplotypeIndexTuple& genotype, LogProbability log_likelihood) const;
+    
+    // Read compression is for models whose likelihoods are sums of per-read terms. When enabled, priming a sample
+    // also makes a compressed copy of its likelihoods: reads with the same likelihood (within tolerance) under every
+    // haplotype are dropped and their likelihoods summed into a constant, and reads with identical likelihoods under
+    // every haplotype are merged into a single weighted read. With zero tolerance the compression is exact.
+    // The uncompressed likelihoods are unaffected.
+    void set_read_compression(LogProbability tolerance = 0);
+    bool is_read_compressed() const noexcept;
+    // Compressed likelihoods of the primed sample
+    SampleLikelihoods compressed_likelihoods() const noexcept;
+    
     void populate(const ReadMap& reads, const std::vector<Haplotype>& haplotypes,
                   boost::optional<FlankState> flank_state = boost::none);
     
@@ -60,7 +215,16 @@ public:
     const LikelihoodVector& operator()(const SampleName& sample, const Haplotype& haplotype) const;
     const LikelihoodVector& operator[](const Haplotype& haplotype) const; // when primed with a sample
     
-    SampleLikelihoodMap extract_sample(const SampleName& sample) const;
+    // Index based access. Haplotype indices are assigned in population (or insertion) order.
+    std::size_t num_haplotypes() const noexcept;
+    std::size_t sample_index(const SampleName& sample) const;
+    std::size_t haplotype_index(const Haplotype& haplotype) const;
+    const LikelihoodVector& operator()(std::size_t sample_index, std::size_t haplotype_index) const noexcept;
+    
+    SampleLikelihoods sample_likelihoods(const SampleName& sample) const;
+    SampleLikelihoods sample_likelihoods(std::size_t sample_index) const noexcept;
+    SampleLikelihoods primed_likelihoods() const noexcept;
+    MergedSampleLikelihoods merged_likelihoods(const std::vector<SampleName>& samples) const;
     
     bool contains(const Haplotype& haplotype) const noexcept;
     
@@ -73,12 +237,18 @@ public:
     
     void clear() noexcept;
     
+    // Includes storage retained by clear for reuse
+    MemoryFootprint footprint() const noexcept;
+    // Estimate of the likelihood storage needed to populate num_haplotypes for num_reads (summed over samples)
+    static MemoryFootprint estimate_footprint(std::size_t num_haplotypes, std::size_t num_reads) noexcept;
+    
     bool is_primed() const noexcept;
     void prime(const SampleName& sample) const;
     void unprime() const noexcept;
     
 private:
     static constexpr unsigned char mapperKmerSize {6};
+    static constexpr unsigned char longReadMapperKmerSize {10};
     static constexpr std::size_t maxMappingPositions {10};
     
     HaplotypeLikelihoodModel likelihood_model_;
@@ -89,42 +259,154 @@ private:
         ReadPacket(Iterator first, Iterator last);
         Iterator first, last;
         std::size_t num_reads;
+        std::vector<std::reference_wrapper<const AlignedRead>> unique_reads;
+        std::vector<std::size_t> unique_read_indices; // empty if all reads are unique
+        std::vector<ReadHaplotypeLikelihoodCache::ReadId> unique_read_ids; // empty if there is no cache
+    };
+    
+    struct PopulationBuffers
+    {
+        KmerHashTable haplotype_hashes;
+        MappedIndexCounts mapping_counts;
+        std::vector<HaplotypeLikelihoodModel::MappingPositionVector> mapping_positions;
+        std::vector<LogProbability> unique_likelihoods;
+        std::vector<std::size_t> evaluation_indices;
+        std::vector<std::reference_wrapper<const AlignedRead>> evaluation_reads;
+        std::vector<LogProbability> evaluated_likelihoods;
+        std::vector<std::pair<ReadHaplotypeLikelihoodCache::ReadId, LogProbability>> new_cached_likelihoods;
+        // The likelihoods of each sample's unique reads for the haplotype buffered in the model
+        struct BufferedHaplotypeLikelihoods
+        {
+            std::vector<HaplotypeLikelihoodModel::MappingPositionVector> mapping_positions;
+            std::vector<char> is_mapped;
+            std::vector<LogProbability> likelihoods;
+        };
+        std::vector<BufferedHaplotypeLikelihoods> buffered;
+        // Likelihoods of each sample's unique reads keyed by the local haplotype signature
+        struct LocalLikelihoodKey
+        {
+            std::size_t unique_read_index;
+            HaplotypeLikelihoodModel::LocalSignature signature;
+            friend bool operator==(const LocalLikelihoodKey& lhs, const LocalLikelihoodKey& rhs) noexcept
+            {
+                return lhs.unique_read_index == rhs.unique_read_index && lhs.signature == rhs.signature;
+            }
+        };
+        struct LocalLikelihoodKeyHash
+        {
+            std::size_t operator()(const LocalLikelihoodKey& key) const noexcept
+            {
+                return key.signature.hash1 ^ (key.unique_read_index * 0x9e3779b97f4a7c15);
+            }
+        };
+        std::vector<std::unordered_map<LocalLikelihoodKey, LogProbability, LocalLikelihoodKeyHash>> local_likelihoods;
+        std::vector<boost::optional<HaplotypeLikelihoodModel::LocalSignature>> evaluation_signatures;
+    };
+    
+    using AlignedLikelihoodBuffer = std::vector<StoredLogProbability, boost::alignment::aligned_allocator<StoredLogProbability, 64>>;
+    
+    struct LikelihoodMatrix
+    {
+        LikelihoodMatrix() = default;
+        LikelihoodMatrix(const LikelihoodMatrix& other);
+        LikelihoodMatrix& operator=(const LikelihoodMatrix& other);
+        LikelihoodMatrix(LikelihoodMatrix&&)            = default;
+        LikelihoodMatrix& operator=(LikelihoodMatrix&&) = default;
+        ~LikelihoodMatrix() = default;
+        
+        void reset(std::size_t num_haplotypes, std::size_t num_reads);
+        void resize(std::size_t num_haplotypes);
+        void clear() noexcept;
+        StoredLogProbability* row(std::size_t haplotype_index) noexcept;
+        
+        std::size_t num_reads = 0, row_stride = 0;
+        AlignedLikelihoodBuffer likelihoods;
+        std::vector<LikelihoodVector> rows;
+    
+    private:
+        void update_rows();
     };
     
-    std::unordered_map<Haplotype, std::vector<LikelihoodVector>, HaplotypeHash> cache_;
+    // Storage is not released by clear so that it can be reused for the next population
+    std::vector<LikelihoodMatrix> matrices_;
+    std::unordered_map<Haplotype, std::size_t, HaplotypeHash> haplotype_indices_;
+    std::size_t num_haplotypes_ = 0;
     std::unordered_map<SampleName, std::size_t> sample_indices_;
     
     mutable boost::optional<std::size_t> primed_sample_;
     
+    ThreadPool* workers_ = nullptr;
+    std::size_t min_parallel_cells_ = defaultMinParallelCells;
+    
+    std::shared_ptr<ReadHaplotypeLikelihoodCache> likelihood_cache_ = nullptr;
+    
+    bool reuse_local_likelihoods_ = false;
+    bool long_read_mapping_ = false;
+    
+    mutable GenotypeLikelihoodTable genotype_likelihoods_;
+    
+    struct CompressedLikelihoods
+    {
+        LikelihoodMatrix matrix; // One column per unique informative read
+        std::vector<LogProbability> read_weights;
+        LogProbability uninformative_log_likelihood = 0;
+        bool is_current = false;
+    };
+    
+    boost::optional<LogProbability> read_compression_tolerance_ = boost::none;
+    mutable std::vector<CompressedLikelihoods> compressed_;
+    
     // Just to optimise population
     std::vector<ReadPacket> read_iterators_;
-    std::vector<std::size_t> mapping_positions_;
+    PopulationBuffers buffers_;
+    
+    using ReadHashes = std::vector<std::vector<KmerPerfectHashes>>;
     
     void set_read_iterators_and_sample_indices(const ReadMap& reads);
+    KmerPerfectHashes compute_read_hashes(const AlignedRead& read) const;
+    void populate_haplotype_hashes(const Haplotype& haplotype, KmerHashTable& result) const;
+    bool use_workers(std::size_t num_haplotypes) const noexcept;
+    void populate(std::size_t haplotype_index, const Haplotype& haplotype, const ReadHashes& read_hashes,
+                  const boost::optional<FlankState>& flank_state, HaplotypeLikelihoodModel& likelihood_model,
+                  PopulationBuffers& buffers);
+    void populate_parallel(const std::vector<Haplotype>& haplotypes, const std::vector<std::size_t>& order,
+                           const ReadHashes& read_hashes, const boost::optional<FlankState>& flank_state);
+    StoredLogProbability* allocate_row(std::size_t sample_index, const Haplotype& haplotype, std::size_t num_reads);
+    void invalidate_compression() noexcept;
+    void compress(std::size_t sample_index) const;
 };
 
 template <typename S, typename Container>
 void HaplotypeLikelihoodArray::insert(S&& sample, const Haplotype& haplotype,
                                       Container&& likelihoods)
 {
-    sample_indices_.emplace(std::forward<S>(sample), sample_indices_.size());
-    cache_[haplotype].emplace_back(std::forward<Container>(likelihoods));
+    const auto sample_idx = sample_indices_.emplace(std::forward<S>(sample), sample_indices_.size()).first->second;
+    const auto num_reads = static_cast<std::size_t>(std::distance(std::cbegin(likelihoods), std::cend(likelihoods)));
+    std::copy(std::cbegin(likelihoods), std::cend(likelihoods), allocate_row(sample_idx, haplotype, num_reads));
 }
 
 template <typename Container>
 void HaplotypeLikelihoodArray::erase(const Container& haplotypes)
 {
+    // The matrix rows are left in place, they're just no longer reachable
+    std::vector<std::size_t> erased_indices {};
     for (const auto& haplotype : haplotypes) {
-        cache_.erase(haplotype);
+        const auto itr = haplotype_indices_.find(haplotype);
+        if (itr != std::cend(haplotype_indices_)) {
+            erased_indices.push_back(itr->second);
+            haplotype_indices_.erase(itr);
+        }
     }
+    genotype_likelihoods_.erase_haplotypes(erased_indices);
 }
 
 // non-member methods
 
-HaplotypeLikelihoodArray merge_samples(const std::vector<SampleName>& samples,
-                                       const SampleName& new_sample,
-                                       const std::vector<Haplotype>& haplotypes,
-                                       const HaplotypeLikelihoodArray& haplotype_likelihoods);
+MemoryFootprint footprint(const HaplotypeLikelihoodArray& haplotype_likelihoods) noexcept;
+
+// Pools samples without copying their likelihoods
+HaplotypeLikelihoodArray::MergedSampleLikelihoods
+merge_samples(const std::vector<SampleName>& samples, const HaplotypeLikelihoodArray& haplotype_likelihoods);
 
 namespace debug {
 
@@ -4,6 +4,8 @@
 #include "haplotype_likelihood_model.hpp"
 
 #include <utility>
+#include <algorithm>
+#include <iterator>
 #include <cmath>
 #include <limits>
 #include <cassert>
@@ -43,6 +45,8 @@ void HaplotypeLikelihoodModel::reset(const Haplotype& haplotype, boost::optional
 {
     haplotype_ = std::addressof(haplotype);
     haplotype_flank_state_ = std::move(flank_state);
+    unchanged_prefix_size_ = unchanged_suffix_size_ = 0;
+    has_local_prefix_hashes_ = false;
     if (snv_error_model_) {
         snv_error_model_->evaluate(haplotype,
                                    haplotype_snv_forward_mask_, haplotype_snv_forward_priors_,
@@ -59,10 +63,99 @@ void HaplotypeLikelihoodModel::reset(const Haplotype& haplotype, boost::optional
     }
 }
 
+namespace {
+
+using FlankState = HaplotypeLikelihoodModel::FlankState;
+
+bool are_equal(const boost::optional<FlankState>& lhs, const boost::optional<FlankState>& rhs) noexcept
+{
+    if (lhs && rhs) return lhs->lhs_flank == rhs->lhs_flank && lhs->rhs_flank == rhs->rhs_flank;
+    return !lhs && !rhs;
+}
+
+template <typename T>
+std::size_t common_prefix_size(const T& lhs, const T& rhs) noexcept
+{
+    if (lhs.size() <= rhs.size()) {
+        return std::distance(std::cbegin(lhs), std::mismatch(std::cbegin(lhs), std::cend(lhs), std::cbegin(rhs)).first);
+    } else {
+        return common_prefix_size(rhs, lhs);
+    }
+}
+
+template <typename T>
+std::size_t common_suffix_size(const T& lhs, const T& rhs) noexcept
+{
+    if (lhs.size() != rhs.size()) return 0;
+    return std::distance(std::crbegin(lhs), std::mismatch(std::crbegin(lhs), std::crend(lhs), std::crbegin(rhs)).first);
+}
+
+} // namespace
+
+bool HaplotypeLikelihoodModel::reset_incremental(const Haplotype& haplotype, boost::optional<FlankState> flank_state)
+{
+    const Haplotype* previous {haplotype_};
+    if (previous == nullptr || !is_same_contig(*previous, haplotype) || !begins_equal(*previous, haplotype)
+        || !are_equal(haplotype_flank_state_, flank_state)) {
+        reset(haplotype, std::move(flank_state));
+        return false;
+    }
+    using std::swap;
+    swap(haplotype_snv_forward_mask_, previous_snv_forward_mask_);
+    swap(haplotype_snv_reverse_mask_, previous_snv_reverse_mask_);
+    swap(haplotype_snv_forward_priors_, previous_snv_forward_priors_);
+    swap(haplotype_snv_reverse_priors_, previous_snv_reverse_priors_);
+    swap(haplotype_gap_open_penalities_, previous_gap_open_penalities_);
+    swap(haplotype_gap_extend_penalities_, previous_gap_extend_penalities_);
+    reset(haplotype, std::move(flank_state));
+    const auto common_size = [&] (auto common_size_fn) {
+        auto result = common_size_fn(previous->sequence(), haplotype.sequence());
+        result = std::min(result, common_size_fn(previous_snv_forward_mask_, haplotype_snv_forward_mask_));
+        result = std::min(result, common_size_fn(previous_snv_reverse_mask_, haplotype_snv_reverse_mask_));
+        result = std::min(result, common_size_fn(previous_snv_forward_priors_, haplotype_snv_forward_priors_));
+        result = std::min(result, common_size_fn(previous_snv_reverse_priors_, haplotype_snv_reverse_priors_));
+        result = std::min(result, common_size_fn(previous_gap_open_penalities_, haplotype_gap_open_penalities_));
+        return std::min(result, common_size_fn(previous_gap_extend_penalities_, haplotype_gap_extend_penalities_));
+    };
+    const auto prefix_size = common_size([] (const auto& lhs, const auto& rhs) { return common_prefix_size(lhs, rhs); });
+    // The pair HMM treats reads overlapping the right flank differently, and the flank is relative to the haplotype end
+    const std::size_t rhs_flank_size {haplotype_flank_state_ ? haplotype_flank_state_->rhs_flank : 0u};
+    const auto min_sequence_size = std::min(sequence_size(*previous), sequence_size(haplotype));
+    if (min_sequence_size > rhs_flank_size) {
+        unchanged_prefix_size_ = std::min(prefix_size, min_sequence_size - rhs_flank_size);
+    }
+    if (sequence_size(*previous) == sequence_size(haplotype)) {
+        // Positions after the last difference are unchanged too
+        unchanged_suffix_size_ = common_size([] (const auto& lhs, const auto& rhs) { return common_suffix_size(lhs, rhs); });
+    }
+    return unchanged_prefix_size_ > 0 || unchanged_suffix_size_ > 0;
+}
+
+bool HaplotypeLikelihoodModel::is_unchanged(const AlignedRead& read, const MappingPositionVector& mapping_positions) const noexcept
+{
+    if (unchanged_prefix_size_ == 0 && unchanged_suffix_size_ == 0) return false;
+    // Every alignment of the read must be confined to an unchanged part of the haplotype, including
+    // the fallback positions that the model uses when no mapping position is in range
+    const std::size_t pad {hmm::min_flank_pad()};
+    const auto flank_size = std::max(pad, static_cast<std::size_t>(config_.pair_hmm_band_size));
+    const auto read_size = sequence_size(read);
+    const auto haplotype_size = sequence_size(*haplotype_);
+    const auto suffix_begin = haplotype_size - unchanged_suffix_size_;
+    const auto is_unchanged_at = [=] (const MappingPosition position) noexcept {
+        if (std::max(position, pad) + read_size + flank_size <= unchanged_prefix_size_) return true;
+        return position >= suffix_begin + flank_size && position + read_size + pad <= haplotype_size;
+    };
+    const auto original_mapping_position = static_cast<MappingPosition>(begin_distance(*haplotype_, read));
+    return is_unchanged_at(original_mapping_position)
+           && std::all_of(std::cbegin(mapping_positions), std::cend(mapping_positions), is_unchanged_at);
+}
+
 void HaplotypeLikelihoodModel::clear() noexcept
 {
     haplotype_ = nullptr;
     haplotype_flank_state_ = boost::none;
+    unchanged_prefix_size_ = unchanged_suffix_size_ = 0;
+    has_local_prefix_hashes_ = false;
 }
 
 HaplotypeLikelihoodModel::HaplotypeLikelihoodModel()
@@ -84,11 +177,22 @@ HaplotypeLikelihoodModel::HaplotypeLikelihoodModel(std::unique_ptr<SnvErrorModel
 , haplotype_flank_state_ {}
 , haplotype_gap_open_penalities_ {}
 , haplotype_gap_extend_penalities_ {}
+, unchanged_prefix_size_ {0}
+, unchanged_suffix_size_ {0}
+, previous_snv_forward_mask_ {}
+, previous_snv_reverse_mask_ {}
+, previous_snv_forward_priors_ {}
+, previous_snv_reverse_priors_ {}
+, previous_gap_open_penalities_ {}
+, previous_gap_extend_penalities_ {}
 , config_ {config}
 {
     if (config_.mapping_quality_cap_trigger && *config_.mapping_quality_cap_trigger >= config_.mapping_quality_cap) {
         config_.mapping_quality_cap_trigger = boost::none;
     }
+    if (!hmm::is_supported_band_size(config_.pair_hmm_band_size)) {
+        throw std::invalid_argument {"HaplotypeLikelihoodModel: unsupported pair HMM band size"};
+    }
 }
 
 HaplotypeLikelihoodModel::HaplotypeLikelihoodModel(const HaplotypeLikelihoodModel& other)
@@ -111,6 +215,8 @@ HaplotypeLikelihoodModel::HaplotypeLikelihoodModel(const HaplotypeLikelihoodMode
     haplotype_snv_reverse_priors_ = other.haplotype_snv_reverse_priors_;
     haplotype_gap_open_penalities_ = other.haplotype_gap_open_penalities_;
     haplotype_gap_extend_penalities_ = other.haplotype_gap_extend_penalities_;
+    unchanged_prefix_size_ = other.unchanged_prefix_size_;
+    unchanged_suffix_size_ = other.unchanged_suffix_size_;
     config_ = other.config_;
 }
 
@@ -136,6 +242,17 @@ void swap(HaplotypeLikelihoodModel& lhs, HaplotypeLikelihoodModel& rhs) noexcept
     swap(lhs.haplotype_snv_reverse_priors_, rhs.haplotype_snv_reverse_priors_);
     swap(lhs.haplotype_gap_open_penalities_, rhs.haplotype_gap_open_penalities_);
     swap(lhs.haplotype_gap_extend_penalities_, rhs.haplotype_gap_extend_penalities_);
+    swap(lhs.unchanged_prefix_size_, rhs.unchanged_prefix_size_);
+    swap(lhs.unchanged_suffix_size_, rhs.unchanged_suffix_size_);
+    swap(lhs.previous_snv_forward_mask_, rhs.previous_snv_forward_mask_);
+    swap(lhs.previous_snv_reverse_mask_, rhs.previous_snv_reverse_mask_);
+    swap(lhs.previous_snv_forward_priors_, rhs.previous_snv_forward_priors_);
+    swap(lhs.previous_snv_reverse_priors_, rhs.previous_snv_reverse_priors_);
+    swap(lhs.previous_gap_open_penalities_, rhs.previous_gap_open_penalities_);
+    swap(lhs.previous_gap_extend_penalities_, rhs.previous_gap_extend_penalities_);
+    swap(lhs.local_prefix_hashes_, rhs.local_prefix_hashes_);
+    swap(lhs.local_hash_powers_, rhs.local_hash_powers_);
+    swap(lhs.has_local_prefix_hashes_, rhs.has_local_prefix_hashes_);
     swap(lhs.config_, rhs.config_);
 }
 
@@ -183,7 +300,8 @@ template <typename InputIt>
 HaplotypeLikelihoodModel::LogProbability
 max_score(const AlignedRead& read, const Haplotype& haplotype,
           InputIt first_mapping_position, InputIt last_mapping_position,
-          const hmm::MutationModel& model)
+          const hmm::MutationModel& model,
+          std::size_t* best_mapping_position = nullptr)
 {
     assert(contains(haplotype, read));
     using LogProbability = HaplotypeLikelihoodModel::LogProbability;
@@ -198,14 +316,20 @@ max_score(const AlignedRead& read, const Haplotype& haplotype,
         if (is_in_range(position, read, haplotype)) {
             has_in_range_mapping_position = true;
             auto p = hmm::evaluate(read.sequence(), haplotype.sequence(), read.base_qualities(), position, model);
-            max_log_probability = std::max(static_cast<LogProbability>(p), max_log_probability);
+            if (p > max_log_probability) {
+                max_log_probability = p;
+                if (best_mapping_position) *best_mapping_position = position;
+            }
         }
     });
     if (!is_original_position_mapped && is_in_range(original_mapping_position, read, haplotype)) {
         has_in_range_mapping_position = true;
         auto p = hmm::evaluate(read.sequence(), haplotype.sequence(), read.base_qualities(),
                                original_mapping_position, model);
-        max_log_probability = std::max(static_cast<LogProbability>(p), max_log_probability);
+        if (p >= max_log_probability) {
+            max_log_probability = p;
+            if (best_mapping_position) *best_mapping_position = original_mapping_position;
+        }
     }
     if (!has_in_range_mapping_position) {
         const auto min_shift = num_out_of_range_bases(original_mapping_position, read, haplotype);
@@ -226,6 +350,7 @@ max_score(const AlignedRead& read, const Haplotype& haplotype,
         }
         max_log_probability = hmm::evaluate(read.sequence(), haplotype.sequence(), read.base_qualities(),
                                             final_mapping_position, model);
+        if (best_mapping_position) *best_mapping_position = final_mapping_position;
     }
     assert(max_log_probability > std::numeric_limits<LogProbability>::lowest() && max_log_probability <= 0);
     return max_log_probability;
@@ -239,40 +364,217 @@ HaplotypeLikelihoodModel::evaluate(const AlignedRead& read,
     if (haplotype_ == nullptr) {
         throw std::runtime_error {"HaplotypeLikelihoodModel: no buffered Haplotype"};
     }
-    const auto is_forward = !read.is_marked_reverse_mapped();
-    hmm::MutationModel model {
-        is_forward ? haplotype_snv_forward_mask_ : haplotype_snv_reverse_mask_,
-        is_forward ? haplotype_snv_forward_priors_ : haplotype_snv_reverse_priors_,
-        haplotype_gap_open_penalities_,
-        haplotype_gap_extend_penalities_
-    };
-    if (haplotype_flank_state_) {
-        model.lhs_flank_size = haplotype_flank_state_->lhs_flank;
-        model.rhs_flank_size = haplotype_flank_state_->rhs_flank;
-    } else {
-        model.lhs_flank_size = 0;
-        model.rhs_flank_size = 0;
-    }
+    const auto model = make_mutation_model(!read.is_marked_reverse_mapped());
     const auto ln_prob_given_mapped = max_score(read, *haplotype_, first_mapping_position, last_mapping_position, model);
-    if (config_.use_mapping_quality) {
-        // This calculation is approximately
-        // p(read | hap) = p(read missmapped) p(read | hap, missmapped)
-        //                  + p(read correctly mapped) p(read | hap, correctly mapped)
-        // = p(read correctly mapped) p(read | hap, correctly mapped)
-        //      + p(read missmapped)
-        // assuming p(read | hap, missmapped) = 1
-        auto mapping_quality = read.mapping_quality();
-        if (config_.mapping_quality_cap_trigger && mapping_quality >= *config_.mapping_quality_cap_trigger) {
-            mapping_quality = config_.mapping_quality_cap;
+    return adjust_for_mapping_quality(read, ln_prob_given_mapped);
+}
+
+HaplotypeLikelihoodModel::LogProbability
+HaplotypeLikelihoodModel::evaluate(const AlignedRead& read, const MappingPositionVector& mapping_positions,
+                                   MappingPosition& best_mapping_position) const
+{
+    if (haplotype_ == nullptr) {
+        throw std::runtime_error {"HaplotypeLikelihoodModel: no buffered Haplotype"};
+    }
+    const auto model = make_mutation_model(!read.is_marked_reverse_mapped());
+    const auto ln_prob_given_mapped = max_score(read, *haplotype_, std::cbegin(mapping_positions), std::cend(mapping_positions),
+                                                model, &best_mapping_position);
+    return adjust_for_mapping_quality(read, ln_prob_given_mapped);
+}
+
+namespace {
+
+// Finds the same mapping positions that max_score evaluates
+template <typename InputIt>
+void get_evaluation_positions(const AlignedRead& read, const Haplotype& haplotype,
+                              InputIt first_mapping_position, InputIt last_mapping_position,
+                              std::vector<std::size_t>& result)
+{
+    assert(contains(haplotype, read));
+    const auto original_mapping_position = static_cast<std::size_t>(begin_distance(haplotype, read));
+    result.clear();
+    bool is_original_position_mapped {false};
+    std::for_each(first_mapping_position, last_mapping_position, [&] (const auto position) {
+        if (position == original_mapping_position) {
+            is_original_position_mapped = true;
         }
-        using octopus::maths::constants::ln10Div10;
-        const auto ln_prob_missmapped = -ln10Div10<> * mapping_quality;
-        const auto ln_prob_mapped = std::log(1.0 - std::exp(ln_prob_missmapped));
-        const auto result = maths::log_sum_exp(ln_prob_mapped + ln_prob_given_mapped, ln_prob_missmapped);
-        return result > -1e-15 ? 0.0 : result;
-    } else {
-        return ln_prob_given_mapped  > -1e-15 ? 0.0 : ln_prob_given_mapped;
+        if (is_in_range(position, read, haplotype)) {
+            result.push_back(position);
+        }
+    });
+    if (!is_original_position_mapped && is_in_range(original_mapping_position, read, haplotype)) {
+        result.push_back(original_mapping_position);
     }
+    if (result.empty()) {
+        const auto min_shift = num_out_of_range_bases(original_mapping_position, read, haplotype);
+        auto final_mapping_position = original_mapping_position;
+        if (min_shift > 0) {
+            final_mapping_position += min_shift;
+            if (!is_in_range(final_mapping_position, read, haplotype)) {
+                throw HaplotypeLikelihoodModel::ShortHaplotypeError {haplotype, static_cast<unsigned>(min_shift)};
+            }
+        } else {
+            const auto min_left_shift = static_cast<unsigned>(-min_shift);
+            if (original_mapping_position >= min_left_shift) {
+                final_mapping_position -= min_left_shift;
+            } else {
+                auto required_extension = min_left_shift - original_mapping_position;
+                throw HaplotypeLikelihoodModel::ShortHaplotypeError {haplotype, required_extension};
+            }
+        }
+        result.push_back(final_mapping_position);
+    }
+}
+
+} // namespace
+
+void HaplotypeLikelihoodModel::evaluate(ReadIterator first_read, ReadIterator last_read,
+                                        const std::vector<MappingPositionVector>& mapping_positions,
+                                        LogProbability* result) const
+{
+    evaluate_batch(first_read, last_read, mapping_positions, result);
+}
+
+void HaplotypeLikelihoodModel::evaluate(ReadReferenceIterator first_read, ReadReferenceIterator last_read,
+                                        const std::vector<MappingPositionVector>& mapping_positions,
+                                        LogProbability* result) const
+{
+    evaluate_batch(first_read, last_read, mapping_positions, result);
+}
+
+template <typename InputIt>
+void HaplotypeLikelihoodModel::evaluate_batch(InputIt first_read, InputIt last_read,
+                                              const std::vector<MappingPositionVector>& mapping_positions,
+                                              LogProbability* result) const
+{
+    if (haplotype_ == nullptr) {
+        throw std::runtime_error {"HaplotypeLikelihoodModel: no buffered Haplotype"};
+    }
+    const auto num_reads = static_cast<std::size_t>(std::distance(first_read, last_read));
+    assert(mapping_positions.size() == num_reads);
+    const auto forward_model = make_mutation_model(true), reverse_model = make_mutation_model(false);
+    thread_local std::vector<hmm::EvaluationRequest> requests {};
+    thread_local std::vector<std::size_t> request_reads {}, positions {};
+    thread_local std::vector<double> scores {};
+    requests.clear();
+    request_reads.clear();
+    std::size_t read_idx {0};
+    std::for_each(first_read, last_read, [&] (const AlignedRead& read) {
+        get_evaluation_positions(read, *haplotype_, std::cbegin(mapping_positions[read_idx]),
+                                 std::cend(mapping_positions[read_idx]), positions);
+        const auto& model = read.is_marked_reverse_mapped() ? reverse_model : forward_model;
+        for (const auto position : positions) {
+            requests.push_back({read.sequence(), read.base_qualities(), position, model});
+            request_reads.push_back(read_idx);
+        }
+        ++read_idx;
+    });
+    hmm::evaluate(haplotype_->sequence(), requests, scores);
+    std::fill_n(result, num_reads, std::numeric_limits<LogProbability>::lowest());
+    for (std::size_t i {0}; i < scores.size(); ++i) {
+        auto& max_log_probability = result[request_reads[i]];
+        max_log_probability = std::max(static_cast<LogProbability>(scores[i]), max_log_probability);
+    }
+    read_idx = 0;
+    std::for_each(first_read, last_read, [&] (const AlignedRead& read) {
+        assert(result[read_idx] > std::numeric_limits<LogProbability>::lowest() && result[read_idx] <= 0);
+        result[read_idx] = adjust_for_mapping_quality(read, result[read_idx]);
+        ++read_idx;
+    });
+}
+
+namespace {
+
+constexpr std::uint64_t localHashModulus {(std::uint64_t {1} << 61) - 1};
+constexpr std::array<std::uint64_t, 2> localHashBases {{0x1f3d5b79a3c5e7f1 % localHashModulus, 0x2b7e151628aed2a7 % localHashModulus}};
+
+// a * b mod 2^61 - 1 without 128 bit integers
+std::uint64_t mul_mod(const std::uint64_t a, const std::uint64_t b) noexcept
+{
+    constexpr std::uint64_t mask30 {(std::uint64_t {1} << 30) - 1}, mask31 {(std::uint64_t {1} << 31) - 1};
+    const auto a_hi = a >> 31, a_lo = a & mask31, b_hi = b >> 31, b_lo = b & mask31;
+    const auto mid = a_lo * b_hi + a_hi * b_lo;
+    const auto product = 2 * a_hi * b_hi + (mid >> 30) + ((mid & mask30) << 31) + a_lo * b_lo;
+    const auto result = (product & localHashModulus) + (product >> 61);
+    return result >= localHashModulus ? result - localHashModulus : result;
+}
+
+std::uint64_t add_mod(const std::uint64_t a, const std::uint64_t b) noexcept
+{
+    const auto result = a + b;
+    return result >= localHashModulus ? result - localHashModulus : result;
+}
+
+template <typename T>
+std::uint64_t token_byte(const std::vector<T>& table, const std::size_t i) noexcept
+{
+    return i < table.size() ? static_cast<std::uint8_t>(table[i]) : 0;
+}
+
+} // namespace
+
+void HaplotypeLikelihoodModel::compute_local_prefix_hashes() const
+{
+    const auto haplotype_size = sequence_size(*haplotype_);
+    local_prefix_hashes_.resize(haplotype_size + 1);
+    local_prefix_hashes_[0] = {{0, 0}};
+    if (local_hash_powers_.empty()) local_hash_powers_.push_back({{1, 1}});
+    while (local_hash_powers_.size() <= haplotype_size) {
+        const auto& power = local_hash_powers_.back();
+        local_hash_powers_.push_back({{mul_mod(power[0], localHashBases[0]), mul_mod(power[1], localHashBases[1])}});
+    }
+    const auto& sequence = haplotype_->sequence();
+    for (std::size_t i {0}; i < haplotype_size; ++i) {
+        // Packs everything the pair HMM reads at this position, so equal tokens mean equal inputs
+        const std::uint64_t token {static_cast<std::uint8_t>(sequence[i])
+                                   | token_byte(haplotype_snv_forward_mask_, i) << 8
+                                   | token_byte(haplotype_snv_reverse_mask_, i) << 16
+                                   | token_byte(haplotype_snv_forward_priors_, i) << 24
+                                   | token_byte(haplotype_snv_reverse_priors_, i) << 32
+                                   | token_byte(haplotype_gap_open_penalities_, i) << 40
+                                   | token_byte(haplotype_gap_extend_penalities_, i) << 48};
+        for (std::size_t k {0}; k < 2; ++k) {
+            local_prefix_hashes_[i + 1][k] = add_mod(mul_mod(local_prefix_hashes_[i][k], localHashBases[k]), token);
+        }
+    }
+    has_local_prefix_hashes_ = true;
+}
+
+boost::optional<HaplotypeLikelihoodModel::LocalSignature>
+HaplotypeLikelihoodModel::local_signature(const AlignedRead& read, const MappingPositionVector& mapping_positions) const
+{
+    if (haplotype_ == nullptr) {
+        throw std::runtime_error {"HaplotypeLikelihoodModel: no buffered Haplotype"};
+    }
+    thread_local std::vector<std::size_t> positions {};
+    get_evaluation_positions(read, *haplotype_, std::cbegin(mapping_positions), std::cend(mapping_positions), positions);
+    // The pair HMM only looks at the haplotype within the band of each evaluated position
+    const std::size_t pad {hmm::min_flank_pad()};
+    const auto flank_size = std::max(pad, static_cast<std::size_t>(config_.pair_hmm_band_size));
+    const std::size_t lhs_flank {haplotype_flank_state_ ? haplotype_flank_state_->lhs_flank : 0u};
+    const std::size_t rhs_flank {haplotype_flank_state_ ? haplotype_flank_state_->rhs_flank : 0u};
+    std::sort(std::begin(positions), std::end(positions));
+    if (positions.front() < lhs_flank + flank_size) return boost::none;
+    const auto window_begin = positions.front() - flank_size;
+    const auto window_end = positions.back() + sequence_size(read) + flank_size;
+    if (window_end + rhs_flank > sequence_size(*haplotype_)) return boost::none;
+    if (!has_local_prefix_hashes_) compute_local_prefix_hashes();
+    std::array<std::uint64_t, 2> result;
+    for (std::size_t k {0}; k < 2; ++k) {
+        const auto prefix = mul_mod(local_prefix_hashes_[window_begin][k], local_hash_powers_[window_end - window_begin][k]);
+        auto hash = add_mod(local_prefix_hashes_[window_end][k], localHashModulus - prefix);
+        hash = add_mod(mul_mod(hash, localHashBases[k]), window_end - window_begin);
+        for (const auto position : positions) {
+            hash = add_mod(mul_mod(hash, localHashBases[k]), position - window_begin);
+        }
+        result[k] = hash;
+    }
+    return LocalSignature {result[0], result[1]};
+}
+
+bool operator==(const HaplotypeLikelihoodModel::LocalSignature& lhs, const HaplotypeLikelihoodModel::LocalSignature& rhs) noexcept
+{
+    return lhs.hash1 == rhs.hash1 && lhs.hash2 == rhs.hash2;
 }
 
 HaplotypeLikelihoodModel::Alignment
@@ -358,19 +660,43 @@ HaplotypeLikelihoodModel::align(const AlignedRead& read, MappingPositionItr firs
     if (haplotype_ == nullptr) {
         throw std::runtime_error {"HaplotypeLikelihoodModel: no buffered Haplotype"};
     }
-    const auto is_forward = !read.is_marked_reverse_mapped();
-    hmm::MutationModel model {is_forward ? haplotype_snv_forward_mask_ : haplotype_snv_reverse_mask_,
-                              is_forward ? haplotype_snv_forward_priors_ : haplotype_snv_reverse_priors_,
-                              haplotype_gap_open_penalities_, haplotype_gap_extend_penalities_};
+    const auto model = make_mutation_model(!read.is_marked_reverse_mapped());
+    auto result = compute_optimal_alignment(read, *haplotype_, first_mapping_position, last_mapping_position, model);
+    result.likelihood = adjust_for_mapping_quality(read, result.likelihood);
+    return result;
+}
+
+// private methods
+
+hmm::MutationModel HaplotypeLikelihoodModel::make_mutation_model(const bool is_forward) const noexcept
+{
+    hmm::MutationModel result {
+        is_forward ? haplotype_snv_forward_mask_ : haplotype_snv_reverse_mask_,
+        is_forward ? haplotype_snv_forward_priors_ : haplotype_snv_reverse_priors_,
+        haplotype_gap_open_penalities_,
+        haplotype_gap_extend_penalities_
+    };
     if (haplotype_flank_state_) {
-        model.lhs_flank_size = haplotype_flank_state_->lhs_flank;
-        model.rhs_flank_size = haplotype_flank_state_->rhs_flank;
+        result.lhs_flank_size = haplotype_flank_state_->lhs_flank;
+        result.rhs_flank_size = haplotype_flank_state_->rhs_flank;
     } else {
-        model.lhs_flank_size = 0;
-        model.rhs_flank_size = 0;
+        result.lhs_flank_size = 0;
+        result.rhs_flank_size = 0;
     }
-    auto result = compute_optimal_alignment(read, *haplotype_, first_mapping_position, last_mapping_position, model);
+    result.band_size = config_.pair_hmm_band_size;
+    return result;
+}
+
+HaplotypeLikelihoodModel::LogProbability
+HaplotypeLikelihoodModel::adjust_for_mapping_quality(const AlignedRead& read, const LogProbability ln_prob_given_mapped) const
+{
     if (config_.use_mapping_quality) {
+        // This calculation is approximately
+        // p(read | hap) = p(read missmapped) p(read | hap, missmapped)
+        //                  + p(read correctly mapped) p(read | hap, correctly mapped)
+        // = p(read correctly mapped) p(read | hap, correctly mapped)
+        //      + p(read missmapped)
+        // assuming p(read | hap, missmapped) = 1
         auto mapping_quality = read.mapping_quality();
         if (config_.mapping_quality_cap_trigger && mapping_quality >= *config_.mapping_quality_cap_trigger) {
             mapping_quality = config_.mapping_quality_cap;
@@ -378,12 +704,11 @@ HaplotypeLikelihoodModel::align(const AlignedRead& read, MappingPositionItr firs
         using octopus::maths::constants::ln10Div10;
         const auto ln_prob_missmapped = -ln10Div10<> * mapping_quality;
         const auto ln_prob_mapped = std::log(1.0 - std::exp(ln_prob_missmapped));
-        result.likelihood = maths::log_sum_exp(ln_prob_mapped + result.likelihood, ln_prob_missmapped);
-        result.likelihood = result.likelihood > -1e-15 ? 0.0 : result.likelihood;
+        const auto result = maths::log_sum_exp(ln_prob_mapped + ln_prob_given_mapped, ln_prob_missmapped);
+        return result > -1e-15 ? 0.0 : result;
     } else {
-        result.likelihood = result.likelihood > -1e-15 ? 0.0 : result.likelihood;
+        return ln_prob_given_mapped  > -1e-15 ? 0.0 : ln_prob_given_mapped;
     }
-    return result;
 }
 
 HaplotypeLikelihoodModel make_haplotype_likelihood_model(const std::string label, bool use_mapping_quality)
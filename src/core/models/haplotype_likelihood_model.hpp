@@ -5,6 +5,7 @@
 #define haplotype_likelihood_model_hpp
 
 #include <vector>
+#include <array>
 #include <iterator>
 #include <cstddef>
 #include <cstdint>
@@ -24,8 +25,6 @@
 #include "core/models/error/indel_error_model.hpp"
 #include "pairhmm/pair_hmm.hpp"
 
-#include "timers.hpp"
-
 namespace octopus {
 
 class HaplotypeLikelihoodModel
@@ -40,6 +39,7 @@ public:
         boost::optional<AlignedRead::MappingQuality> mapping_quality_cap_trigger = boost::none;
         AlignedRead::MappingQuality mapping_quality_cap = 120;
         bool use_flank_state = true;
+        unsigned pair_hmm_band_size = hmm::min_flank_pad();
     };
     
     struct FlankState
@@ -52,6 +52,8 @@ public:
     using MappingPosition       = std::size_t;
     using MappingPositionVector = std::vector<MappingPosition>;
     using MappingPositionItr    = MappingPositionVector::const_iterator;
+    using ReadIterator          = ReadContainer::const_iterator;
+    using ReadReferenceIterator = std::vector<std::reference_wrapper<const AlignedRead>>::const_iterator;
     
     struct Alignment
     {
@@ -60,6 +62,12 @@ public:
         LogProbability likelihood;
     };
     
+    // Identifies everything in the buffered haplotype that ln p(read | haplotype) depends on
+    struct LocalSignature
+    {
+        std::size_t hash1, hash2;
+    };
+    
     HaplotypeLikelihoodModel();
     HaplotypeLikelihoodModel(Config config);
     HaplotypeLikelihoodModel(std::unique_ptr<SnvErrorModel> snv_model,
@@ -83,12 +91,40 @@ public:
     
     void reset(const Haplotype& haplotype, boost::optional<FlankState> flank_state = boost::none);
     
+    // Like reset, but also compares the new haplotype with the currently buffered haplotype, which must still
+    // be alive. Returns true if some likelihoods computed for the old haplotype are valid for the new one,
+    // which can be checked with is_unchanged. This is useful when haplotypes share long common prefixes
+    // (or suffixes, if the haplotypes have the same length).
+    bool reset_incremental(const Haplotype& haplotype, boost::optional<FlankState> flank_state = boost::none);
+    
+    // True if ln p(read | haplotype) at mapping_positions is guaranteed to be the same as for the haplotype buffered
+    // before the last reset_incremental, assuming the read had the same mapping positions for that haplotype.
+    bool is_unchanged(const AlignedRead& read, const MappingPositionVector& mapping_positions) const noexcept;
+    
     void clear() noexcept;
     
+    // If the signatures of a read for two haplotypes are equal then so are the likelihoods of the read.
+    // There is no signature if an alignment of the read reaches the haplotype flanks, as these are
+    // scored relative to the whole haplotype.
+    boost::optional<LocalSignature> local_signature(const AlignedRead& read, const MappingPositionVector& mapping_positions) const;
+    
     // ln p(read | haplotype, model)
     LogProbability evaluate(const AlignedRead& read) const;
     LogProbability evaluate(const AlignedRead& read, const MappingPositionVector& mapping_positions) const;
     LogProbability evaluate(const AlignedRead& read, MappingPositionItr first_mapping_position, MappingPositionItr last_mapping_position) const;
+    // Also finds the mapping position with the greatest likelihood, so the read can later be aligned at that position only
+    LogProbability evaluate(const AlignedRead& read, const MappingPositionVector& mapping_positions,
+                            MappingPosition& best_mapping_position) const;
+    
+    // Equivalent to evaluating each read in [first_read, last_read) with the corresponding mapping_positions,
+    // but the pair HMM alignments of different reads are evaluated together, which is much faster at high depth.
+    // result must have space for std::distance(first_read, last_read) likelihoods.
+    void evaluate(ReadIterator first_read, ReadIterator last_read,
+                  const std::vector<MappingPositionVector>& mapping_positions,
+                  LogProbability* result) const;
+    void evaluate(ReadReferenceIterator first_read, ReadReferenceIterator last_read,
+                  const std::vector<MappingPositionVector>& mapping_positions,
+                  LogProbability* result) const;
     
     Alignment align(const AlignedRead& read) const;
     Alignment align(const AlignedRead& read, const MappingPositionVector& mapping_positions) const;
@@ -106,9 +142,30 @@ private:
     std::vector<Penalty> haplotype_snv_forward_priors_, haplotype_snv_reverse_priors_;
     
     std::vector<Penalty> haplotype_gap_open_penalities_, haplotype_gap_extend_penalities_;
+    
+    // Haplotype bases in which the sequence and error tables match the previously buffered haplotype
+    std::size_t unchanged_prefix_size_, unchanged_suffix_size_;
+    std::vector<char> previous_snv_forward_mask_, previous_snv_reverse_mask_;
+    std::vector<Penalty> previous_snv_forward_priors_, previous_snv_reverse_priors_;
+    std::vector<Penalty> previous_gap_open_penalities_, previous_gap_extend_penalities_;
+    
+    // Two polynomial prefix hashes of the buffered haplotype and error tables, computed on demand
+    mutable std::vector<std::array<std::uint64_t, 2>> local_prefix_hashes_, local_hash_powers_;
+    mutable bool has_local_prefix_hashes_ = false;
+    
     Config config_;
+    
+    hmm::MutationModel make_mutation_model(bool is_forward) const noexcept;
+    template <typename InputIt>
+    void evaluate_batch(InputIt first_read, InputIt last_read,
+                        const std::vector<MappingPositionVector>& mapping_positions,
+                        LogProbability* result) const;
+    LogProbability adjust_for_mapping_quality(const AlignedRead& read, LogProbability ln_prob_given_mapped) const;
+    void compute_local_prefix_hashes() const;
 };
 
+bool operator==(const HaplotypeLikelihoodModel::LocalSignature& lhs, const HaplotypeLikelihoodModel::LocalSignature& rhs) noexcept;
+
 class HaplotypeLikelihoodModel::ShortHaplotypeError : public std::runtime_error
 {
 public:
@@ -3,7 +3,9 @@
 
 #include "coalescent_model.hpp"
 
+#include <vector>
 #include <memory>
+#include <algorithm>
 #include <cmath>
 #include <complex>
 #include <numeric>
@@ -60,6 +62,7 @@ void CoalescentModel::prime(std::vector<Haplotype> haplotypes)
     haplotypes_ = std::move(haplotypes);
     index_cache_.assign(haplotypes_.size(), boost::none);
     index_flag_buffer_.assign(haplotypes_.size(), false);
+    index_result_cache_.clear();
 }
 
 void CoalescentModel::unprime() noexcept
@@ -70,6 +73,7 @@ void CoalescentModel::unprime() noexcept
     index_cache_.shrink_to_fit();
     index_flag_buffer_.clear();
     index_flag_buffer_.shrink_to_fit();
+    index_result_cache_.clear();
 }
 
 bool CoalescentModel::is_primed() const noexcept
@@ -84,7 +88,25 @@ CoalescentModel::LogProbability CoalescentModel::evaluate(const Haplotype& haplo
 
 CoalescentModel::LogProbability CoalescentModel::evaluate(const std::vector<unsigned>& haplotype_indices) const
 {
-    return evaluate(count_segregating_sites(haplotype_indices));
+    // The result does not depend on the order of the haplotypes, so equivalent genotypes share an entry
+    index_key_buffer_.assign(std::cbegin(haplotype_indices), std::cend(haplotype_indices));
+    std::sort(std::begin(index_key_buffer_), std::end(index_key_buffer_));
+    const auto itr = index_result_cache_.find(index_key_buffer_);
+    if (itr != std::cend(index_result_cache_)) {
+        ++index_cache_stats_.hits;
+        return itr->second;
+    }
+    ++index_cache_stats_.misses;
+    const auto result = evaluate(count_segregating_sites(haplotype_indices));
+    if (index_result_cache_.size() < maxIndexResultCacheSize) {
+        index_result_cache_.emplace(index_key_buffer_, result);
+    }
+    return result;
+}
+
+CoalescentModel::CacheStatistics CoalescentModel::index_cache_statistics() const noexcept
+{
+    return index_cache_stats_;
 }
 
 namespace {
@@ -99,11 +121,23 @@ auto binom(const unsigned n, const unsigned k)
     return boost::math::binomial_coefficient<CoalescentModel::LogProbability>(n, k);
 }
 
-auto log_binom(const unsigned n, const unsigned k)
+auto log_factorial(const unsigned n)
 {
     using T = CoalescentModel::LogProbability;
-    using maths::log_factorial;
-    return log_factorial<T>(n) - (log_factorial<T>(k) + log_factorial<T>(n - k));
+    static constexpr unsigned max_tabulated {100};
+    static const auto table = [] () {
+        std::vector<T> result(max_tabulated + 1);
+        for (unsigned i {0}; i <= max_tabulated; ++i) {
+            result[i] = maths::log_factorial<T>(i);
+        }
+        return result;
+    }();
+    return n <= max_tabulated ? table[n] : maths::log_factorial<T>(n);
+}
+
+auto log_binom(const unsigned n, const unsigned k)
+{
+    return log_factorial(n) - (log_factorial(k) + log_factorial(n - k));
 }
 
 template <typename T>
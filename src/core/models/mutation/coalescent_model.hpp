@@ -37,6 +37,11 @@ public:
     
     enum class CachingStrategy { none, value, address };
     
+    struct CacheStatistics
+    {
+        std::size_t hits = 0, misses = 0;
+    };
+    
     CoalescentModel() = delete;
     
     CoalescentModel(Haplotype reference,
@@ -62,6 +67,9 @@ public:
     template <typename Container> double evaluate(const Container& haplotypes) const;
     LogProbability evaluate(const std::vector<unsigned>& haplotype_indices) const;
     
+    // Lookups of primed haplotype index evaluations in the memo table
+    CacheStatistics index_cache_statistics() const noexcept;
+    
 private:
     using VariantReference = std::reference_wrapper<const Variant>;
     using SiteCountTuple = std::tuple<unsigned, unsigned, unsigned>;
@@ -74,6 +82,15 @@ private:
             return boost::hash_value(t);
         }
     };
+    struct IndexVectorHash
+    {
+        std::size_t operator()(const std::vector<unsigned>& indices) const noexcept
+        {
+            return boost::hash_range(std::cbegin(indices), std::cend(indices));
+        }
+    };
+    
+    static constexpr std::size_t maxIndexResultCacheSize {65536};
     
     Haplotype reference_;
     IndelMutationModel::ContextIndelModel indel_heterozygosity_model_;
@@ -88,6 +105,9 @@ private:
     mutable std::vector<bool> index_flag_buffer_;
     mutable std::vector<std::vector<boost::optional<LogProbability>>> k_indel_zero_result_cache_;
     mutable std::unordered_map<SiteCountIndelTuple, LogProbability, SiteCountTupleHash> k_indel_pos_result_cache_;
+    mutable std::vector<unsigned> index_key_buffer_;
+    mutable std::unordered_map<std::vector<unsigned>, LogProbability, IndexVectorHash> index_result_cache_;
+    mutable CacheStatistics index_cache_stats_;
     
     LogProbability evaluate(const SiteCountTuple& t) const;
     LogProbability evaluate(unsigned k_snp, unsigned n) const;
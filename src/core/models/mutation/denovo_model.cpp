@@ -31,6 +31,7 @@ std::int8_t probability_to_penalty(const double probability) noexcept
 DeNovoModel::DeNovoModel(Parameters parameters, std::size_t num_haplotypes_hint, CachingStrategy caching)
 : params_ {parameters}
 , snv_penalty_ {probability_to_penalty(params_.snv_mutation_rate)}
+, snv_log_probability_ {std::log(params_.snv_mutation_rate)}
 , indel_model_ {{params_.indel_mutation_rate}}
 , min_ln_probability_ {}
 , num_haplotypes_hint_ {num_haplotypes_hint}
@@ -46,6 +47,7 @@ DeNovoModel::DeNovoModel(Parameters parameters, std::size_t num_haplotypes_hint,
 , unguarded_index_cache_ {}
 , padded_given_ {}
 , use_unguarded_ {false}
+, index_cache_stats_ {}
 {
     if (caching_ == CachingStrategy::address) {
         address_cache_.reserve(num_haplotypes_hint_ * num_haplotypes_hint_);
@@ -72,6 +74,7 @@ void DeNovoModel::prime(std::vector<Haplotype> haplotypes)
             for (unsigned given {0}; given < haplotypes_.size(); ++given) {
                 if (target != given) {
                     unguarded_index_cache_[target][given] = evaluate_uncached(target, given);
+                    ++index_cache_stats_.misses;
                 }
             }
         }
@@ -112,10 +115,14 @@ DeNovoModel::LogProbability DeNovoModel::evaluate(const Haplotype& target, const
 DeNovoModel::LogProbability DeNovoModel::evaluate(const unsigned target, const unsigned given) const
 {
     if (use_unguarded_) {
+        ++index_cache_stats_.hits;
         return unguarded_index_cache_[target][given];
     } else {
         auto& result = guarded_index_cache_[target][given];
-        if (!result) {
+        if (result) {
+            ++index_cache_stats_.hits;
+        } else {
+            ++index_cache_stats_.misses;
             if (target != given) {
                 result = evaluate_uncached(target, given);
             } else {
@@ -126,6 +133,11 @@ DeNovoModel::LogProbability DeNovoModel::evaluate(const unsigned target, const u
     }
 }
 
+DeNovoModel::CacheStatistics DeNovoModel::index_cache_statistics() const noexcept
+{
+    return index_cache_stats_;
+}
+
 // private methods
 
 namespace {
@@ -157,7 +169,7 @@ bool can_try_align_with_hmm(const Haplotype& target, const Haplotype& given) noe
 }
 
 double calculate_log_probability(const Variant& variant, const Haplotype& context,
-                                 const double snv_penalty, const IndelMutationModel::ContextIndelModel& indel_model)
+                                 const double snv_log_probability, const IndelMutationModel::ContextIndelModel& indel_model)
 {
     if (is_indel(variant)) {
         assert(contains(context, variant));
@@ -168,17 +180,17 @@ double calculate_log_probability(const Variant& variant, const Haplotype& contex
             return std::log(calculate_indel_probability(indel_model, offset, ref_sequence_size(variant) + alt_sequence_size(variant)));
         }
     } else {
-        return snv_penalty * -maths::constants::ln10Div10<>;
+        return snv_log_probability;
     }
 }
 
 double calculate_approx_log_probability(const Haplotype& target, const Haplotype& given,
-                                        const double snv_penalty, const IndelMutationModel::ContextIndelModel& indel_model)
+                                        const double snv_log_probability, const IndelMutationModel::ContextIndelModel& indel_model)
 {
     double score {0};
     const auto variants = target.difference(given);
     for (const auto& variant : variants) {
-        score += calculate_log_probability(variant, given, snv_penalty, indel_model);
+        score += calculate_log_probability(variant, given, snv_log_probability, indel_model);
     }
     return score ;
 }
@@ -197,11 +209,10 @@ void set_penalties(const IndelMutationModel::ContextIndelModel& indel_model,
                    [] (const auto& probs) noexcept { return probability_to_penalty(probs[1]); });
 }
 
-auto recalculate_log_probability(const CigarString& alignment, const double snv_probability,
+auto recalculate_log_probability(const CigarString& alignment, const double snv_log_probability,
                                  const IndelMutationModel::ContextIndelModel& indel_model)
 {
     assert(reference_size(alignment) == indel_model.gap_open.size());
-    const auto snv_log_probability = std::log(snv_probability);
     double result {0};
     std::size_t pos {0};
     for (const auto& op : alignment) {
@@ -273,15 +284,15 @@ DeNovoModel::evaluate_uncached(const Haplotype& target, const Haplotype& given,
         try {
             align_with_hmm(target, given);
             if (is_valid_alignment(alignment_)) {
-                result = recalculate_log_probability(alignment_.cigar, params_.snv_mutation_rate, local_indel_model_->indel);
+                result = recalculate_log_probability(alignment_.cigar, snv_log_probability_, local_indel_model_->indel);
             } else {
-                result = calculate_approx_log_probability(target, given, params_.snv_mutation_rate, local_indel_model_->indel);
+                result = calculate_approx_log_probability(target, given, snv_log_probability_, local_indel_model_->indel);
             }
         } catch (const hmm::HMMOverflow&) {
-            result = calculate_approx_log_probability(target, given, params_.snv_mutation_rate, local_indel_model_->indel);
+            result = calculate_approx_log_probability(target, given, snv_log_probability_, local_indel_model_->indel);
         }
     } else {
-        result = calculate_approx_log_probability(target, given, params_.snv_mutation_rate, local_indel_model_->indel);
+        result = calculate_approx_log_probability(target, given, snv_log_probability_, local_indel_model_->indel);
     }
     return min_ln_probability_ ? std::max(result, *min_ln_probability_) : result;
 }
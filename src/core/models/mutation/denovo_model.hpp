@@ -30,6 +30,11 @@ public:
     
     enum class CachingStrategy { none, value, address };
     
+    struct CacheStatistics
+    {
+        std::size_t hits = 0, misses = 0;
+    };
+    
     DeNovoModel() = delete;
     
     DeNovoModel(Parameters parameters,
@@ -53,6 +58,9 @@ public:
     LogProbability evaluate(const Haplotype& target, const Haplotype& given) const;
     LogProbability evaluate(unsigned target, unsigned given) const;
     
+    // Lookups of primed haplotype index pairs in the memo table
+    CacheStatistics index_cache_statistics() const noexcept;
+    
 private:
     struct AddressPairHash
     {
@@ -73,6 +81,7 @@ private:
     
     Parameters params_;
     std::int8_t snv_penalty_;
+    LogProbability snv_log_probability_;
     IndelMutationModel indel_model_;
     boost::optional<LogProbability> min_ln_probability_;
     std::size_t num_haplotypes_hint_;
@@ -89,6 +98,7 @@ private:
     mutable std::vector<std::vector<LogProbability>> unguarded_index_cache_;
     mutable std::string padded_given_;
     mutable bool use_unguarded_;
+    mutable CacheStatistics index_cache_stats_;
     
     LocalIndelModel generate_local_indel_model(const Haplotype& given) const;
     void set_local_indel_model(unsigned given) const;
@@ -0,0 +1,134 @@
+// Copyright (c) 2015-2019 Daniel Cooke and Gerton Lunter
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+// This translation unit must be compiled with AVX2 enabled (-mavx2), and must only be
+// called when the host supports AVX2 (see simd::get_instruction_set).
+
+#if __GNUC__ >= 6
+    #pragma GCC diagnostic ignored "-Wignored-attributes"
+#endif
+
+#include "banded_pair_hmm.hpp"
+
+#include <immintrin.h>
+
+namespace octopus { namespace hmm { namespace simd { namespace avx2 {
+
+namespace {
+
+struct AVX2Vector
+{
+    using Register = __m256i;
+    static constexpr int lanes {16};
+
+    static Register set1(const short x) noexcept { return _mm256_set1_epi16(x); }
+    static Register first(const short x) noexcept { return _mm256_insert_epi16(_mm256_setzero_si256(), x, 0); }
+    static Register load(const short* values) noexcept { return _mm256_load_si256(reinterpret_cast<const __m256i*>(values)); }
+    static short extract(const Register a, const int idx) noexcept
+    {
+        alignas(32) short values[lanes];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(values), a);
+        return values[idx];
+    }
+    static Register add(const Register a, const Register b) noexcept { return _mm256_add_epi16(a, b); }
+    static Register min(const Register a, const Register b) noexcept { return _mm256_min_epi16(a, b); }
+    static Register cmpeq(const Register a, const Register b) noexcept { return _mm256_cmpeq_epi16(a, b); }
+    static Register bitwise_and(const Register a, const Register b) noexcept { return _mm256_and_si256(a, b); }
+    static Register bitwise_andnot(const Register a, const Register b) noexcept { return _mm256_andnot_si256(a, b); }
+    static Register bitwise_or(const Register a, const Register b) noexcept { return _mm256_or_si256(a, b); }
+    // _mm256_slli_si256/_mm256_srli_si256 only shift within 128-bit lanes, so carry across the lane boundary
+    static Register shift_up(const Register a) noexcept
+    {
+        return _mm256_alignr_epi8(a, _mm256_permute2x128_si256(a, a, 0x08), 14);
+    }
+    static Register shift_down(const Register a) noexcept
+    {
+        return _mm256_alignr_epi8(_mm256_permute2x128_si256(a, a, 0x81), a, 2);
+    }
+    static Register insert_first(const Register a, const short x) noexcept { return _mm256_insert_epi16(a, x, 0); }
+    static Register insert_last(const Register a, const short x) noexcept { return _mm256_insert_epi16(a, x, lanes - 1); }
+};
+
+static_assert(AVX2Vector::lanes == band_size(), "");
+
+// Two independent 8 lane bands, one per 128-bit lane
+struct AVX2BatchVector
+{
+    using Register = __m256i;
+    static constexpr int lanes {16};
+    static constexpr int batch_size {2};
+    
+    static Register set1(const short x) noexcept { return _mm256_set1_epi16(x); }
+    static Register load(const short* values) noexcept { return _mm256_load_si256(reinterpret_cast<const __m256i*>(values)); }
+    static void store(const Register a, short* values) noexcept { _mm256_store_si256(reinterpret_cast<__m256i*>(values), a); }
+    static Register add(const Register a, const Register b) noexcept { return _mm256_add_epi16(a, b); }
+    static Register min(const Register a, const Register b) noexcept { return _mm256_min_epi16(a, b); }
+    static Register cmpeq(const Register a, const Register b) noexcept { return _mm256_cmpeq_epi16(a, b); }
+    static Register bitwise_and(const Register a, const Register b) noexcept { return _mm256_and_si256(a, b); }
+    static Register bitwise_andnot(const Register a, const Register b) noexcept { return _mm256_andnot_si256(a, b); }
+    static Register bitwise_or(const Register a, const Register b) noexcept { return _mm256_or_si256(a, b); }
+    static Register shift_up(const Register a) noexcept { return _mm256_slli_si256(a, 2); }
+    static Register shift_down(const Register a) noexcept { return _mm256_srli_si256(a, 2); }
+    static Register insert_first(const Register a, const short* values) noexcept
+    {
+        return _mm256_insert_epi16(_mm256_insert_epi16(a, values[0], 0), values[1], 8);
+    }
+    static Register insert_last(const Register a, const short* values) noexcept
+    {
+        return _mm256_insert_epi16(_mm256_insert_epi16(a, values[0], 7), values[1], 15);
+    }
+};
+
+static_assert(AVX2BatchVector::batch_size == batch_size(), "");
+
+// Four independent 8 lane bands of bytes, one per 64-bit group
+struct AVX2ByteBatchVector
+{
+    using Register = __m256i;
+    static constexpr int batch_size {4};
+    
+    static Register set1(const std::uint8_t x) noexcept { return _mm256_set1_epi8(static_cast<char>(x)); }
+    static Register set_groups(const std::uint64_t* groups) noexcept
+    {
+        return _mm256_set_epi64x(groups[3], groups[2], groups[1], groups[0]);
+    }
+    static Register load(const std::uint8_t* values) noexcept { return _mm256_load_si256(reinterpret_cast<const __m256i*>(values)); }
+    static void store(const Register a, std::uint8_t* values) noexcept { _mm256_store_si256(reinterpret_cast<__m256i*>(values), a); }
+    static Register saturating_add(const Register a, const Register b) noexcept { return _mm256_adds_epu8(a, b); }
+    static Register min(const Register a, const Register b) noexcept { return _mm256_min_epu8(a, b); }
+    static Register cmpeq(const Register a, const Register b) noexcept { return _mm256_cmpeq_epi8(a, b); }
+    static Register bitwise_and(const Register a, const Register b) noexcept { return _mm256_and_si256(a, b); }
+    static Register bitwise_andnot(const Register a, const Register b) noexcept { return _mm256_andnot_si256(a, b); }
+    static Register bitwise_or(const Register a, const Register b) noexcept { return _mm256_or_si256(a, b); }
+    static Register shift_up(const Register a) noexcept { return _mm256_slli_epi64(a, 8); }
+    static Register shift_down(const Register a) noexcept { return _mm256_srli_epi64(a, 8); }
+};
+
+static_assert(AVX2ByteBatchVector::batch_size == byte_batch_size(), "");
+
+} // namespace
+
+int align(const char* truth, const char* target, const std::int8_t* qualities,
+          const int truth_len, const int target_len,
+          const char* snv_mask, const std::int8_t* snv_prior,
+          const std::int8_t* gap_open, const std::int8_t* gap_extend,
+          short nuc_prior) noexcept
+{
+    return banded_align<AVX2Vector>(truth, target, qualities, truth_len, target_len,
+                                    snv_mask, snv_prior, gap_open, gap_extend, nuc_prior);
+}
+
+void align(const BandedAlignment* alignments, int* scores) noexcept
+{
+    batched_banded_align<AVX2BatchVector>(alignments, scores);
+}
+
+void align_u8(const BandedAlignment* alignments, int* scores) noexcept
+{
+    batched_banded_align_u8<AVX2ByteBatchVector>(alignments, scores);
+}
+
+} // namespace avx2
+} // namespace simd
+} // namespace hmm
+} // namespace octopus
@@ -0,0 +1,143 @@
+// Copyright (c) 2015-2019 Daniel Cooke and Gerton Lunter
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+// This translation unit must be compiled with AVX-512BW enabled (-mavx512bw), and must only be
+// called when the host supports AVX-512BW (see simd::get_instruction_set).
+
+#if __GNUC__ >= 6
+    #pragma GCC diagnostic ignored "-Wignored-attributes"
+#endif
+
+#include "banded_pair_hmm.hpp"
+
+#include <immintrin.h>
+
+namespace octopus { namespace hmm { namespace simd { namespace avx512 {
+
+namespace {
+
+struct AVX512Vector
+{
+    using Register = __m512i;
+    static constexpr int lanes {32};
+
+    static Register set1(const short x) noexcept { return _mm512_set1_epi16(x); }
+    static Register first(const short x) noexcept { return _mm512_maskz_set1_epi16(1, x); }
+    static Register load(const short* values) noexcept { return _mm512_load_si512(values); }
+    static short extract(const Register a, const int idx) noexcept
+    {
+        alignas(64) short values[lanes];
+        _mm512_store_si512(values, a);
+        return values[idx];
+    }
+    static Register add(const Register a, const Register b) noexcept { return _mm512_add_epi16(a, b); }
+    static Register min(const Register a, const Register b) noexcept { return _mm512_min_epi16(a, b); }
+    static Register cmpeq(const Register a, const Register b) noexcept { return _mm512_movm_epi16(_mm512_cmpeq_epi16_mask(a, b)); }
+    static Register bitwise_and(const Register a, const Register b) noexcept { return _mm512_and_si512(a, b); }
+    static Register bitwise_andnot(const Register a, const Register b) noexcept { return _mm512_andnot_si512(a, b); }
+    static Register bitwise_or(const Register a, const Register b) noexcept { return _mm512_or_si512(a, b); }
+    static Register shift_up(const Register a) noexcept
+    {
+        const auto indices = _mm512_set_epi16(30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, 16, 15,
+                                              14, 13, 12, 11, 10,  9,  8,  7,  6,  5,  4,  3,  2,  1,  0,  0);
+        return _mm512_maskz_permutexvar_epi16(0xFFFFFFFE, indices, a);
+    }
+    static Register shift_down(const Register a) noexcept
+    {
+        const auto indices = _mm512_set_epi16(31, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17,
+                                              16, 15, 14, 13, 12, 11, 10,  9,  8,  7,  6,  5,  4,  3,  2,  1);
+        return _mm512_maskz_permutexvar_epi16(0x7FFFFFFF, indices, a);
+    }
+    static Register insert_first(const Register a, const short x) noexcept { return _mm512_mask_set1_epi16(a, 1, x); }
+    static Register insert_last(const Register a, const short x) noexcept { return _mm512_mask_set1_epi16(a, 0x80000000, x); }
+};
+
+static_assert(AVX512Vector::lanes == band_size(), "");
+
+// Four independent 8 lane bands, one per 128-bit lane
+struct AVX512BatchVector
+{
+    using Register = __m512i;
+    static constexpr int lanes {32};
+    static constexpr int batch_size {4};
+    
+    static Register set1(const short x) noexcept { return _mm512_set1_epi16(x); }
+    static Register load(const short* values) noexcept { return _mm512_load_si512(values); }
+    static void store(const Register a, short* values) noexcept { _mm512_store_si512(values, a); }
+    static Register add(const Register a, const Register b) noexcept { return _mm512_add_epi16(a, b); }
+    static Register min(const Register a, const Register b) noexcept { return _mm512_min_epi16(a, b); }
+    static Register cmpeq(const Register a, const Register b) noexcept { return _mm512_movm_epi16(_mm512_cmpeq_epi16_mask(a, b)); }
+    static Register bitwise_and(const Register a, const Register b) noexcept { return _mm512_and_si512(a, b); }
+    static Register bitwise_andnot(const Register a, const Register b) noexcept { return _mm512_andnot_si512(a, b); }
+    static Register bitwise_or(const Register a, const Register b) noexcept { return _mm512_or_si512(a, b); }
+    static Register shift_up(const Register a) noexcept { return _mm512_bslli_epi128(a, 2); }
+    static Register shift_down(const Register a) noexcept { return _mm512_bsrli_epi128(a, 2); }
+    static Register insert_first(Register a, const short* values) noexcept
+    {
+        a = _mm512_mask_set1_epi16(a, 0x00000001, values[0]);
+        a = _mm512_mask_set1_epi16(a, 0x00000100, values[1]);
+        a = _mm512_mask_set1_epi16(a, 0x00010000, values[2]);
+        return _mm512_mask_set1_epi16(a, 0x01000000, values[3]);
+    }
+    static Register insert_last(Register a, const short* values) noexcept
+    {
+        a = _mm512_mask_set1_epi16(a, 0x00000080, values[0]);
+        a = _mm512_mask_set1_epi16(a, 0x00008000, values[1]);
+        a = _mm512_mask_set1_epi16(a, 0x00800000, values[2]);
+        return _mm512_mask_set1_epi16(a, 0x80000000, values[3]);
+    }
+};
+
+static_assert(AVX512BatchVector::batch_size == batch_size(), "");
+
+// Eight independent 8 lane bands of bytes, one per 64-bit group
+struct AVX512ByteBatchVector
+{
+    using Register = __m512i;
+    static constexpr int batch_size {8};
+    
+    static Register set1(const std::uint8_t x) noexcept { return _mm512_set1_epi8(static_cast<char>(x)); }
+    static Register set_groups(const std::uint64_t* groups) noexcept
+    {
+        return _mm512_set_epi64(groups[7], groups[6], groups[5], groups[4], groups[3], groups[2], groups[1], groups[0]);
+    }
+    static Register load(const std::uint8_t* values) noexcept { return _mm512_load_si512(values); }
+    static void store(const Register a, std::uint8_t* values) noexcept { _mm512_store_si512(values, a); }
+    static Register saturating_add(const Register a, const Register b) noexcept { return _mm512_adds_epu8(a, b); }
+    static Register min(const Register a, const Register b) noexcept { return _mm512_min_epu8(a, b); }
+    static Register cmpeq(const Register a, const Register b) noexcept { return _mm512_movm_epi8(_mm512_cmpeq_epi8_mask(a, b)); }
+    static Register bitwise_and(const Register a, const Register b) noexcept { return _mm512_and_si512(a, b); }
+    static Register bitwise_andnot(const Register a, const Register b) noexcept { return _mm512_andnot_si512(a, b); }
+    static Register bitwise_or(const Register a, const Register b) noexcept { return _mm512_or_si512(a, b); }
+    static Register shift_up(const Register a) noexcept { return _mm512_slli_epi64(a, 8); }
+    static Register shift_down(const Register a) noexcept { return _mm512_srli_epi64(a, 8); }
+};
+
+static_assert(AVX512ByteBatchVector::batch_size == byte_batch_size(), "");
+
+} // namespace
+
+int align(const char* truth, const char* target, const std::int8_t* qualities,
+          const int truth_len, const int target_len,
+          const char* snv_mask, const std::int8_t* snv_prior,
+          const std::int8_t* gap_open, const std::int8_t* gap_extend,
+          short nuc_prior) noexcept
+{
+    return banded_align<AVX512Vector>(truth, target, qualities, truth_len, target_len,
+                                      snv_mask, snv_prior, gap_open, gap_extend, nuc_prior);
+}
+
+void align(const BandedAlignment* alignments, int* scores) noexcept
+{
+    batched_banded_align<AVX512BatchVector>(alignments, scores);
+}
+
+void align_u8(const BandedAlignment* alignments, int* scores) noexcept
+{
+    batched_banded_align_u8<AVX512ByteBatchVector>(alignments, scores);
+}
+
+} // namespace avx512
+} // namespace simd
+} // namespace hmm
+} // namespace octopus
@@ -0,0 +1,780 @@
+// Copyright (c) 2015-2019 Daniel Cooke and Gerton Lunter
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef banded_pair_hmm_hpp
+#define banded_pair_hmm_hpp
+
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+
+#include "simd_pair_hmm.hpp"
+
+// The portable kernel and policies are also compiled for CUDA devices (see cuda_pair_hmm.cu)
+#ifdef __CUDACC__
+    #define OCTOPUS_HOST_DEVICE __host__ __device__
+#else
+    #define OCTOPUS_HOST_DEVICE
+#endif
+
+namespace octopus { namespace hmm { namespace simd {
+
+// Penalty and mismatch policies say how the per band inputs of banded_align are set up and how they
+// move along the truth. Each combination is a separate instantiation, so inputs that are constant
+// along the truth cost nothing in the inner loop. All penalties are << 2 as the lower two bits are
+// reserved for back tracing.
+
+// A gap penalty that is the same for every truth position
+template <typename Vector>
+class ConstantPenalty
+{
+public:
+    using Register = typename Vector::Register;
+    
+    OCTOPUS_HOST_DEVICE ConstantPenalty(const short penalty) noexcept : window_ {Vector::set1(penalty << 2)} {}
+    
+    OCTOPUS_HOST_DEVICE const Register& window() const noexcept { return window_; }
+    OCTOPUS_HOST_DEVICE void advance(int) noexcept {}
+    
+private:
+    Register window_;
+};
+
+// A gap penalty for each truth position
+template <typename Vector>
+class PerBasePenalty
+{
+public:
+    using Register = typename Vector::Register;
+    
+    OCTOPUS_HOST_DEVICE PerBasePenalty(const std::int8_t* penalties, const int truth_len) noexcept
+    : penalties_ {penalties}
+    , truth_len_ {truth_len}
+    {
+        alignas(64) short window[Vector::lanes];
+        for (int i {0}; i < Vector::lanes; ++i) window[i] = penalties[i] << 2;
+        window_ = Vector::load(window);
+    }
+    
+    OCTOPUS_HOST_DEVICE const Register& window() const noexcept { return window_; }
+    // pos is the truth position entering the top of the band
+    OCTOPUS_HOST_DEVICE void advance(const int pos) noexcept
+    {
+        window_ = Vector::insert_last(Vector::shift_down(window_), penalties_[pos < truth_len_ ? pos : truth_len_ - 1] << 2);
+    }
+    
+private:
+    const std::int8_t* penalties_;
+    int truth_len_;
+    Register window_;
+};
+
+// Mismatches cost the target base quality
+template <typename Vector>
+class QualityMismatch
+{
+public:
+    using Register = typename Vector::Register;
+    
+    OCTOPUS_HOST_DEVICE Register penalty(const Register&, const Register& qualities) const noexcept { return qualities; }
+    OCTOPUS_HOST_DEVICE void advance(int) noexcept {}
+};
+
+// Mismatches to the target base given by snv_mask cost the smaller of the base quality and snv_prior
+template <typename Vector>
+class SnvPriorMismatch
+{
+public:
+    using Register = typename Vector::Register;
+    
+    OCTOPUS_HOST_DEVICE SnvPriorMismatch(const char* snv_mask, const std::int8_t* snv_prior, const int truth_len) noexcept
+    : snv_mask_ {snv_mask}
+    , snv_prior_ {snv_prior}
+    , truth_len_ {truth_len}
+    {
+        alignas(64) short window[Vector::lanes];
+        for (int i {0}; i < Vector::lanes; ++i) window[i] = snv_mask[i];
+        mask_window_ = Vector::load(window);
+        for (int i {0}; i < Vector::lanes; ++i) window[i] = snv_prior[i] << 2;
+        prior_window_ = Vector::load(window);
+    }
+    
+    OCTOPUS_HOST_DEVICE Register penalty(const Register& targets, const Register& qualities) const noexcept
+    {
+        const auto is_snv = Vector::cmpeq(targets, mask_window_);
+        return Vector::min(qualities, Vector::bitwise_or(Vector::bitwise_and(is_snv, prior_window_),
+                                                         Vector::bitwise_andnot(is_snv, qualities)));
+    }
+    OCTOPUS_HOST_DEVICE void advance(const int pos) noexcept
+    {
+        constexpr short inf {0x7800};
+        mask_window_  = Vector::insert_last(Vector::shift_down(mask_window_), pos < truth_len_ ? snv_mask_[pos] : 'N');
+        prior_window_ = Vector::insert_last(Vector::shift_down(prior_window_),
+                                            static_cast<short>((pos < truth_len_ ? snv_prior_[pos] : inf) << 2));
+    }
+    
+private:
+    const char* snv_mask_;
+    const std::int8_t* snv_prior_;
+    int truth_len_;
+    Register mask_window_, prior_window_;
+};
+
+// Emulates an N lane int16 vector, for bands with no native kernel on the host and for devices
+template <int N>
+struct PortableVector
+{
+    struct Register { short values[N]; };
+    static constexpr int lanes {N};
+    
+    OCTOPUS_HOST_DEVICE static Register set1(const short x) noexcept
+    {
+        Register result;
+        for (int i {0}; i < N; ++i) result.values[i] = x;
+        return result;
+    }
+    OCTOPUS_HOST_DEVICE static Register first(const short x) noexcept { auto result = set1(0); result.values[0] = x; return result; }
+    OCTOPUS_HOST_DEVICE static Register load(const short* values) noexcept
+    {
+        Register result;
+        for (int i {0}; i < N; ++i) result.values[i] = values[i];
+        return result;
+    }
+    OCTOPUS_HOST_DEVICE static short extract(const Register& a, const int idx) noexcept { return a.values[idx]; }
+    OCTOPUS_HOST_DEVICE static Register add(const Register& a, const Register& b) noexcept
+    {
+        Register result;
+        for (int i {0}; i < N; ++i) result.values[i] = static_cast<short>(a.values[i] + b.values[i]);
+        return result;
+    }
+    OCTOPUS_HOST_DEVICE static Register min(const Register& a, const Register& b) noexcept
+    {
+        Register result;
+        for (int i {0}; i < N; ++i) result.values[i] = a.values[i] < b.values[i] ? a.values[i] : b.values[i];
+        return result;
+    }
+    OCTOPUS_HOST_DEVICE static Register cmpeq(const Register& a, const Register& b) noexcept
+    {
+        Register result;
+        for (int i {0}; i < N; ++i) result.values[i] = a.values[i] == b.values[i] ? -1 : 0;
+        return result;
+    }
+    OCTOPUS_HOST_DEVICE static Register bitwise_and(const Register& a, const Register& b) noexcept
+    {
+        Register result;
+        for (int i {0}; i < N; ++i) result.values[i] = a.values[i] & b.values[i];
+        return result;
+    }
+    OCTOPUS_HOST_DEVICE static Register bitwise_andnot(const Register& a, const Register& b) noexcept
+    {
+        Register result;
+        for (int i {0}; i < N; ++i) result.values[i] = ~a.values[i] & b.values[i];
+        return result;
+    }
+    OCTOPUS_HOST_DEVICE static Register bitwise_or(const Register& a, const Register& b) noexcept
+    {
+        Register result;
+        for (int i {0}; i < N; ++i) result.values[i] = a.values[i] | b.values[i];
+        return result;
+    }
+    OCTOPUS_HOST_DEVICE static Register shift_up(const Register& a) noexcept
+    {
+        Register result;
+        result.values[0] = 0;
+        for (int i {1}; i < N; ++i) result.values[i] = a.values[i - 1];
+        return result;
+    }
+    OCTOPUS_HOST_DEVICE static Register shift_down(const Register& a) noexcept
+    {
+        Register result;
+        for (int i {0}; i < N - 1; ++i) result.values[i] = a.values[i + 1];
+        result.values[N - 1] = 0;
+        return result;
+    }
+    OCTOPUS_HOST_DEVICE static Register insert_first(Register a, const short x) noexcept { a.values[0] = x; return a; }
+    OCTOPUS_HOST_DEVICE static Register insert_last(Register a, const short x) noexcept { a.values[N - 1] = x; return a; }
+};
+
+// A generic version of the banded alignment kernel. The band size is the number of int16 lanes in
+// Vector, so instantiating with wider registers widens the band.
+//
+// Vector must provide:
+// - Register, lanes
+// - set1(short), first(short) (lane 0 only), load(const short*), extract(Register, int)
+// - add, min, cmpeq, bitwise_and, bitwise_andnot, bitwise_or
+// - shift_up (lanes move up one, lane 0 zeroed), shift_down (lanes move down one, top lane zeroed)
+// - insert_first(Register, short), insert_last(Register, short)
+//
+// This header is included by translation units compiled for different instruction sets, so
+// the kernel deliberately avoids calling any out-of-line function that could be shared between them.
+template <typename Vector, typename MismatchPolicy, typename GapOpenPolicy, typename GapExtendPolicy>
+OCTOPUS_HOST_DEVICE
+int banded_align(const char* truth, const char* target, const std::int8_t* qualities,
+                 const int truth_len, const int target_len,
+                 MismatchPolicy mismatch, GapOpenPolicy gap_open, GapExtendPolicy gap_extend,
+                 short nuc_prior) noexcept
+{
+    using SimdInt = typename Vector::Register;
+    constexpr int band_size {Vector::lanes};
+    constexpr short nScore {2 << 2};
+    constexpr short inf {0x7800};
+
+    assert(truth_len > band_size && (truth_len == target_len + 2 * band_size - 1));
+
+    nuc_prior <<= 2;
+
+    SimdInt _m1 {Vector::set1(inf)};
+    auto _i1 = _m1;
+    auto _d1 = _m1;
+    auto _m2 = _m1;
+    auto _i2 = _m1;
+    auto _d2 = _m1;
+
+    const SimdInt _nuc_prior {Vector::set1(nuc_prior)};
+    SimdInt _initmask  {Vector::first(-1)};
+    SimdInt _initmask2 {Vector::first(-0x8000)};
+
+    alignas(64) short window[band_size];
+
+    for (int i {0}; i < band_size; ++i) window[i] = truth[i];
+    SimdInt _truthwin {Vector::load(window)};
+    SimdInt _targetwin {_m1};
+    SimdInt _qualitieswin {Vector::set1(64 << 2)};
+
+    // if N, make nScore; if != N, make inf
+    SimdInt _truthnqual {Vector::add(Vector::bitwise_and(Vector::cmpeq(_truthwin, Vector::set1('N')),
+                                                         Vector::set1(nScore - inf)),
+                                     Vector::set1(inf))};
+
+    short minscore {inf};
+
+    for (int s {0}; s <= 2 * (target_len + band_size); s += 2) {
+        // truth is current; target needs updating
+        _targetwin    = Vector::shift_up(_targetwin);
+        _qualitieswin = Vector::shift_up(_qualitieswin);
+
+        if (s / 2 < target_len) {
+            _targetwin    = Vector::insert_first(_targetwin, target[s / 2]);
+            _qualitieswin = Vector::insert_first(_qualitieswin, qualities[s / 2] << 2);
+        } else {
+            _targetwin    = Vector::insert_first(_targetwin, '0');
+            _qualitieswin = Vector::insert_first(_qualitieswin, 64 << 2);
+        }
+
+        // S even
+
+        _m1 = Vector::bitwise_or(_initmask2, Vector::bitwise_andnot(_initmask, _m1));
+        _m2 = Vector::bitwise_or(_initmask2, Vector::bitwise_andnot(_initmask, _m2));
+        _m1 = Vector::min(_m1, Vector::min(_i1, _d1));
+
+        const auto score_idx = s / 2 - target_len < band_size ? s / 2 - target_len : band_size - 1;
+
+        if (s / 2 >= target_len) {
+            const short score = Vector::extract(_m1, score_idx);
+            if (score < minscore) minscore = score;
+        }
+
+        _m1 = Vector::add(_m1, Vector::min(Vector::bitwise_andnot(Vector::cmpeq(_targetwin, _truthwin),
+                                                                  mismatch.penalty(_targetwin, _qualitieswin)),
+                                           _truthnqual));
+        _d1 = Vector::min(Vector::add(_d2, gap_extend.window()),
+                          Vector::add(Vector::min(_m2, _i2), Vector::shift_down(gap_open.window()))); // allow I->D
+        _d1 = Vector::insert_first(Vector::shift_up(_d1), inf);
+        _i1 = Vector::add(Vector::min(Vector::add(_i2, gap_extend.window()), Vector::add(_m2, gap_open.window())),
+                          _nuc_prior);
+
+        // S odd
+        // truth needs updating; target is current
+        const auto pos = band_size + s / 2;
+        const char base {pos < truth_len ? truth[pos] : 'N'};
+
+        _truthwin   = Vector::insert_last(Vector::shift_down(_truthwin), base);
+        _truthnqual = Vector::insert_last(Vector::shift_down(_truthnqual), base == 'N' ? nScore : inf);
+        mismatch.advance(pos);
+        gap_open.advance(pos);
+        gap_extend.advance(pos);
+
+        _initmask  = Vector::shift_up(_initmask);
+        _initmask2 = Vector::shift_up(_initmask2);
+
+        _m2 = Vector::min(_m2, Vector::min(_i2, _d2));
+
+        if (s / 2 >= target_len) {
+            const short score = Vector::extract(_m2, score_idx);
+            if (score < minscore) minscore = score;
+        }
+
+        _m2 = Vector::add(_m2, Vector::min(Vector::bitwise_andnot(Vector::cmpeq(_targetwin, _truthwin),
+                                                                  mismatch.penalty(_targetwin, _qualitieswin)),
+                                           _truthnqual));
+        _d2 = Vector::min(Vector::add(_d1, gap_extend.window()),
+                          Vector::add(Vector::min(_m1, _i1), gap_open.window())); // allow I->D
+        _i2 = Vector::insert_last(Vector::add(Vector::min(Vector::add(Vector::shift_down(_i1), gap_extend.window()),
+                                                          Vector::add(Vector::shift_down(_m1), gap_open.window())),
+                                              _nuc_prior), inf);
+    }
+
+    return (minscore + 0x8000) >> 2;
+}
+
+template <typename Vector>
+OCTOPUS_HOST_DEVICE
+int banded_align(const char* truth, const char* target, const std::int8_t* qualities,
+                 const int truth_len, const int target_len,
+                 const char* snv_mask, const std::int8_t* snv_prior,
+                 const std::int8_t* gap_open, const std::int8_t* gap_extend,
+                 const short nuc_prior) noexcept
+{
+    return banded_align<Vector>(truth, target, qualities, truth_len, target_len,
+                                SnvPriorMismatch<Vector> {snv_mask, snv_prior, truth_len},
+                                PerBasePenalty<Vector> {gap_open, truth_len},
+                                PerBasePenalty<Vector> {gap_extend, truth_len},
+                                nuc_prior);
+}
+
+// Runs BatchVector::batch_size independent alignments of the 8 lane kernel in simd_pair_hmm.cpp,
+// one per group of 8 lanes. Results are identical to calling the 8 lane kernel on each alignment.
+//
+// BatchVector must provide the same operations as Vector above except that shift_up and shift_down
+// only move values within groups, index extraction is replaced by store(Register, short*),
+// and insert_first/insert_last take one value per group.
+template <typename BatchVector>
+void batched_banded_align(const BandedAlignment* alignments, int* scores) noexcept
+{
+    using SimdInt = typename BatchVector::Register;
+    constexpr int band_size {8};
+    constexpr int batch_size {BatchVector::batch_size};
+    constexpr int lanes {band_size * batch_size};
+    constexpr short nScore {2 << 2};
+    constexpr short inf {0x7800};
+
+    static_assert(lanes == BatchVector::lanes, "");
+
+    int target_lens[batch_size], truth_lens[batch_size], max_target_len {0};
+    for (int b {0}; b < batch_size; ++b) {
+        target_lens[b] = alignments[b].target_len;
+        truth_lens[b] = target_lens[b] + 2 * band_size - 1;
+        if (target_lens[b] > max_target_len) max_target_len = target_lens[b];
+    }
+
+    SimdInt _m1 {BatchVector::set1(inf)};
+    auto _i1 = _m1;
+    auto _d1 = _m1;
+    auto _m2 = _m1;
+    auto _i2 = _m1;
+    auto _d2 = _m1;
+
+    alignas(64) short window[lanes];
+    alignas(64) short values[batch_size];
+
+    for (int b {0}; b < batch_size; ++b) {
+        for (int i {0}; i < band_size; ++i) window[b * band_size + i] = alignments[b].nuc_prior << 2;
+    }
+    const SimdInt _nuc_prior {BatchVector::load(window)};
+    for (int i {0}; i < lanes; ++i) window[i] = i % band_size == 0 ? -1 : 0;
+    SimdInt _initmask {BatchVector::load(window)};
+    for (int i {0}; i < lanes; ++i) window[i] = i % band_size == 0 ? -0x8000 : 0;
+    SimdInt _initmask2 {BatchVector::load(window)};
+
+    for (int b {0}; b < batch_size; ++b) {
+        for (int i {0}; i < band_size; ++i) window[b * band_size + i] = alignments[b].truth[i];
+    }
+    SimdInt _truthwin {BatchVector::load(window)};
+    SimdInt _targetwin {_m1};
+    SimdInt _qualitieswin {BatchVector::set1(64 << 2)};
+    for (int b {0}; b < batch_size; ++b) {
+        for (int i {0}; i < band_size; ++i) window[b * band_size + i] = alignments[b].snv_mask[i];
+    }
+    SimdInt _snvmaskwin {BatchVector::load(window)};
+    for (int b {0}; b < batch_size; ++b) {
+        for (int i {0}; i < band_size; ++i) window[b * band_size + i] = alignments[b].snv_prior[i] << 2;
+    }
+    SimdInt _snv_priorwin {BatchVector::load(window)};
+    SimdInt _snvmask;
+
+    // if N, make nScore; if != N, make inf
+    SimdInt _truthnqual {BatchVector::add(BatchVector::bitwise_and(BatchVector::cmpeq(_truthwin, BatchVector::set1('N')),
+                                                                   BatchVector::set1(nScore - inf)),
+                                          BatchVector::set1(inf))};
+
+    for (int b {0}; b < batch_size; ++b) {
+        for (int i {0}; i < band_size; ++i) window[b * band_size + i] = alignments[b].gap_open[i] << 2;
+    }
+    SimdInt _gap_open {BatchVector::load(window)};
+    for (int b {0}; b < batch_size; ++b) {
+        for (int i {0}; i < band_size; ++i) window[b * band_size + i] = alignments[b].gap_extend[i] << 2;
+    }
+    SimdInt _gap_extend {BatchVector::load(window)};
+
+    short minscores[batch_size], infs[batch_size];
+    for (int b {0}; b < batch_size; ++b) minscores[b] = infs[b] = inf;
+
+    for (int s {0}; s <= 2 * (max_target_len + band_size); s += 2) {
+        // truth is current; target needs updating
+        _targetwin    = BatchVector::shift_up(_targetwin);
+        _qualitieswin = BatchVector::shift_up(_qualitieswin);
+
+        bool is_scoring {false};
+        for (int b {0}; b < batch_size; ++b) {
+            values[b] = s / 2 < target_lens[b] ? alignments[b].target[s / 2] : '0';
+            if (s / 2 >= target_lens[b] && s <= 2 * (target_lens[b] + band_size)) is_scoring = true;
+        }
+        _targetwin = BatchVector::insert_first(_targetwin, values);
+        for (int b {0}; b < batch_size; ++b) {
+            values[b] = s / 2 < target_lens[b] ? alignments[b].qualities[s / 2] << 2 : 64 << 2;
+        }
+        _qualitieswin = BatchVector::insert_first(_qualitieswin, values);
+
+        // S even
+
+        _m1 = BatchVector::bitwise_or(_initmask2, BatchVector::bitwise_andnot(_initmask, _m1));
+        _m2 = BatchVector::bitwise_or(_initmask2, BatchVector::bitwise_andnot(_initmask, _m2));
+        _m1 = BatchVector::min(_m1, BatchVector::min(_i1, _d1));
+
+        if (is_scoring) {
+            BatchVector::store(_m1, window);
+            for (int b {0}; b < batch_size; ++b) {
+                if (s / 2 >= target_lens[b] && s <= 2 * (target_lens[b] + band_size)) {
+                    const auto idx = s / 2 - target_lens[b] < band_size ? s / 2 - target_lens[b] : band_size - 1;
+                    const auto score = window[b * band_size + idx];
+                    if (score < minscores[b]) minscores[b] = score;
+                }
+            }
+        }
+
+        _snvmask = BatchVector::cmpeq(_targetwin, _snvmaskwin);
+
+        _m1 = BatchVector::add(_m1, BatchVector::min(BatchVector::bitwise_andnot(BatchVector::cmpeq(_targetwin, _truthwin),
+                                                                                 BatchVector::min(_qualitieswin,
+                                                                                                  BatchVector::bitwise_or(BatchVector::bitwise_and(_snvmask, _snv_priorwin),
+                                                                                                                          BatchVector::bitwise_andnot(_snvmask, _qualitieswin)))),
+                                                     _truthnqual));
+        _d1 = BatchVector::min(BatchVector::add(_d2, _gap_extend),
+                               BatchVector::add(BatchVector::min(_m2, _i2), BatchVector::shift_down(_gap_open))); // allow I->D
+        _d1 = BatchVector::insert_first(BatchVector::shift_up(_d1), infs);
+        _i1 = BatchVector::add(BatchVector::min(BatchVector::add(_i2, _gap_extend), BatchVector::add(_m2, _gap_open)),
+                               _nuc_prior);
+
+        // S odd
+        // truth needs updating; target is current
+        const auto pos = band_size + s / 2;
+
+        for (int b {0}; b < batch_size; ++b) values[b] = pos < truth_lens[b] ? alignments[b].truth[pos] : 'N';
+        _truthwin = BatchVector::insert_last(BatchVector::shift_down(_truthwin), values);
+        for (int b {0}; b < batch_size; ++b) values[b] = values[b] == 'N' ? nScore : inf;
+        _truthnqual = BatchVector::insert_last(BatchVector::shift_down(_truthnqual), values);
+        for (int b {0}; b < batch_size; ++b) values[b] = pos < truth_lens[b] ? alignments[b].snv_mask[pos] : 'N';
+        _snvmaskwin = BatchVector::insert_last(BatchVector::shift_down(_snvmaskwin), values);
+        for (int b {0}; b < batch_size; ++b) {
+            values[b] = static_cast<short>((pos < truth_lens[b] ? alignments[b].snv_prior[pos] : inf) << 2);
+        }
+        _snv_priorwin = BatchVector::insert_last(BatchVector::shift_down(_snv_priorwin), values);
+        for (int b {0}; b < batch_size; ++b) {
+            values[b] = alignments[b].gap_open[pos < truth_lens[b] ? pos : truth_lens[b] - 1] << 2;
+        }
+        _gap_open = BatchVector::insert_last(BatchVector::shift_down(_gap_open), values);
+        for (int b {0}; b < batch_size; ++b) {
+            values[b] = alignments[b].gap_extend[pos < truth_lens[b] ? pos : truth_lens[b] - 1] << 2;
+        }
+        _gap_extend = BatchVector::insert_last(BatchVector::shift_down(_gap_extend), values);
+
+        _initmask  = BatchVector::shift_up(_initmask);
+        _initmask2 = BatchVector::shift_up(_initmask2);
+
+        _m2 = BatchVector::min(_m2, BatchVector::min(_i2, _d2));
+
+        if (is_scoring) {
+            BatchVector::store(_m2, window);
+            for (int b {0}; b < batch_size; ++b) {
+                if (s / 2 >= target_lens[b] && s <= 2 * (target_lens[b] + band_size)) {
+                    const auto idx = s / 2 - target_lens[b] < band_size ? s / 2 - target_lens[b] : band_size - 1;
+                    const auto score = window[b * band_size + idx];
+                    if (score < minscores[b]) minscores[b] = score;
+                }
+            }
+        }
+
+        _snvmask = BatchVector::cmpeq(_targetwin, _snvmaskwin);
+
+        _m2 = BatchVector::add(_m2, BatchVector::min(BatchVector::bitwise_andnot(BatchVector::cmpeq(_targetwin, _truthwin),
+                                                                                 BatchVector::min(_qualitieswin,
+                                                                                                  BatchVector::bitwise_or(BatchVector::bitwise_and(_snvmask, _snv_priorwin),
+                                                                                                                          BatchVector::bitwise_andnot(_snvmask, _qualitieswin)))),
+                                                     _truthnqual));
+        _d2 = BatchVector::min(BatchVector::add(_d1, _gap_extend),
+                               BatchVector::add(BatchVector::min(_m1, _i1), _gap_open)); // allow I->D
+        _i2 = BatchVector::insert_last(BatchVector::add(BatchVector::min(BatchVector::add(BatchVector::shift_down(_i1), _gap_extend),
+                                                                         BatchVector::add(BatchVector::shift_down(_m1), _gap_open)),
+                                                        _nuc_prior),
+                                       infs);
+    }
+
+    for (int b {0}; b < batch_size; ++b) scores[b] = (minscores[b] + 0x8000) >> 2;
+}
+
+constexpr int saturated_score {-1};
+
+// An 8 bit version of batched_banded_align. Scores are unsigned and saturate rather than wrap, and
+// drop the two back tracing bits, so any alignment scoring under 255 gets the same score as the
+// 16 bit kernel and any other is given saturated_score. Each 8 lane band is one 64-bit group, so
+// twice as many alignments fit in a register.
+//
+// ByteBatchVector must provide:
+// - Register, batch_size (the number of 64-bit groups)
+// - set1(std::uint8_t), set_groups(const std::uint64_t*), load(const std::uint8_t*), store(Register, std::uint8_t*)
+// - saturating_add, min (unsigned), cmpeq, bitwise_and, bitwise_andnot, bitwise_or
+// - shift_up, shift_down (bytes move up or down one within each group, the vacated byte is zeroed)
+template <typename ByteBatchVector>
+void batched_banded_align_u8(const BandedAlignment* alignments, int* scores) noexcept
+{
+    using SimdInt = typename ByteBatchVector::Register;
+    constexpr int band_size {8};
+    constexpr int batch_size {ByteBatchVector::batch_size};
+    constexpr int lanes {band_size * batch_size};
+    constexpr std::uint8_t nScore {2};
+    constexpr std::uint8_t inf {0xFF};
+
+    int target_lens[batch_size], truth_lens[batch_size], max_target_len {0};
+    for (int b {0}; b < batch_size; ++b) {
+        target_lens[b] = alignments[b].target_len;
+        truth_lens[b] = target_lens[b] + 2 * band_size - 1;
+        if (target_lens[b] > max_target_len) max_target_len = target_lens[b];
+    }
+
+    alignas(64) std::uint8_t window[lanes];
+    std::uint64_t groups[batch_size];
+    std::uint8_t bytes[band_size];
+
+    // The windows move along their inputs a byte per step. Rather than inserting each new byte, the
+    // next band_size bytes of each input are loaded every band_size steps and shifted in from there.
+    // Lane i of each group is input position first + i, or first + band_size - 1 - i if reversed
+    const auto load_bytes = [&] (const int first, const int* lens, auto get, auto get_padded, const bool reversed) {
+        for (int b {0}; b < batch_size; ++b) {
+            if (first + band_size <= lens[b]) {
+                std::memcpy(&groups[b], get(alignments[b]) + first, band_size);
+            } else {
+                for (int i {0}; i < band_size; ++i) bytes[i] = get_padded(alignments[b], lens[b], first + i);
+                std::memcpy(&groups[b], bytes, band_size);
+            }
+            if (reversed) groups[b] = __builtin_bswap64(groups[b]);
+        }
+        return ByteBatchVector::set_groups(groups);
+    };
+    const auto get_truth = [] (const BandedAlignment& alignment) { return reinterpret_cast<const std::uint8_t*>(alignment.truth); };
+    const auto get_snv_mask = [] (const BandedAlignment& alignment) { return reinterpret_cast<const std::uint8_t*>(alignment.snv_mask); };
+    const auto get_snv_prior = [] (const BandedAlignment& alignment) { return reinterpret_cast<const std::uint8_t*>(alignment.snv_prior); };
+    const auto get_gap_open = [] (const BandedAlignment& alignment) { return reinterpret_cast<const std::uint8_t*>(alignment.gap_open); };
+    const auto get_gap_extend = [] (const BandedAlignment& alignment) { return reinterpret_cast<const std::uint8_t*>(alignment.gap_extend); };
+    const auto get_target = [] (const BandedAlignment& alignment) { return reinterpret_cast<const std::uint8_t*>(alignment.target); };
+    const auto get_qualities = [] (const BandedAlignment& alignment) { return reinterpret_cast<const std::uint8_t*>(alignment.qualities); };
+    const auto pad_with = [] (auto get, const std::uint8_t pad) {
+        return [=] (const BandedAlignment& alignment, const int len, const int pos) -> std::uint8_t {
+            return pos < len ? get(alignment)[pos] : pad;
+        };
+    };
+    const auto pad_with_last = [] (auto get) {
+        return [=] (const BandedAlignment& alignment, const int len, const int pos) -> std::uint8_t {
+            return get(alignment)[pos < len ? pos : len - 1];
+        };
+    };
+    // Positions past the end of the truth are N with no SNV prior, and take the last gap penalties
+    const auto pad_truth = pad_with(get_truth, 'N');
+    const auto pad_snv_mask = pad_with(get_snv_mask, 'N');
+    const auto pad_snv_prior = pad_with(get_snv_prior, inf);
+    const auto pad_gap_open = pad_with_last(get_gap_open);
+    const auto pad_gap_extend = pad_with_last(get_gap_extend);
+    const auto pad_target = pad_with(get_target, '0');
+    const auto pad_qualities = pad_with(get_qualities, 64);
+
+    for (int i {0}; i < lanes; ++i) window[i] = i % band_size == 0 ? 0xFF : 0;
+    const SimdInt _firstmask {ByteBatchVector::load(window)};
+    for (int i {0}; i < lanes; ++i) window[i] = i % band_size == band_size - 1 ? 0xFF : 0;
+    const SimdInt _lastmask {ByteBatchVector::load(window)};
+    for (int b {0}; b < batch_size; ++b) {
+        for (int i {0}; i < band_size; ++i) window[b * band_size + i] = static_cast<std::uint8_t>(alignments[b].nuc_prior);
+    }
+    const SimdInt _nuc_prior {ByteBatchVector::load(window)};
+    const SimdInt _nscore {ByteBatchVector::set1(nScore)};
+    const SimdInt _inf {ByteBatchVector::set1(inf)};
+    const SimdInt _n {ByteBatchVector::set1('N')};
+
+    SimdInt _m1 {_inf};
+    auto _i1 = _m1;
+    auto _d1 = _m1;
+    auto _m2 = _m1;
+    auto _i2 = _m1;
+    auto _d2 = _m1;
+
+    SimdInt _initmask {_firstmask};
+    SimdInt _truthwin {load_bytes(0, truth_lens, get_truth, pad_truth, false)};
+    SimdInt _targetwin {_inf};
+    SimdInt _qualitieswin {ByteBatchVector::set1(64)};
+    SimdInt _snvmaskwin {load_bytes(0, truth_lens, get_snv_mask, pad_snv_mask, false)};
+    SimdInt _snv_priorwin {load_bytes(0, truth_lens, get_snv_prior, pad_snv_prior, false)};
+    SimdInt _gap_open {load_bytes(0, truth_lens, get_gap_open, pad_gap_open, false)};
+    SimdInt _gap_extend {load_bytes(0, truth_lens, get_gap_extend, pad_gap_extend, false)};
+    SimdInt _truthnqual, _mismatch;
+    // The next bytes to enter each window
+    SimdInt _next_target {_inf}, _next_qualities {_inf};
+    SimdInt _next_truth {_inf}, _next_snv_mask {_inf}, _next_snv_prior {_inf}, _next_gap_open {_inf}, _next_gap_extend {_inf};
+
+    // The vector state is passed by value so that its address does not escape to the byte stores
+    // above, which would stop it being kept in registers.
+    // if N, make nScore; if != N, make inf
+    const auto make_truthnqual = [] (const SimdInt truthwin, const SimdInt nscore, const SimdInt inf_score, const SimdInt n) {
+        const auto is_n = ByteBatchVector::cmpeq(truthwin, n);
+        return ByteBatchVector::bitwise_or(ByteBatchVector::bitwise_and(is_n, nscore), ByteBatchVector::bitwise_andnot(is_n, inf_score));
+    };
+    const auto make_mismatch = [] (const SimdInt targetwin, const SimdInt qualitieswin, const SimdInt truthwin,
+                                   const SimdInt snvmaskwin, const SimdInt snv_priorwin, const SimdInt truthnqual) {
+        const auto snvmask = ByteBatchVector::cmpeq(targetwin, snvmaskwin);
+        return ByteBatchVector::min(ByteBatchVector::bitwise_andnot(ByteBatchVector::cmpeq(targetwin, truthwin),
+                                                                    ByteBatchVector::min(qualitieswin,
+                                                                                         ByteBatchVector::bitwise_or(ByteBatchVector::bitwise_and(snvmask, snv_priorwin),
+                                                                                                                     ByteBatchVector::bitwise_andnot(snvmask, qualitieswin)))),
+                                    truthnqual);
+    };
+
+    std::uint8_t minscores[batch_size];
+    for (int b {0}; b < batch_size; ++b) minscores[b] = inf;
+    const auto update_minscores = [&] (const SimdInt m, const int s) {
+        bool is_scoring {false};
+        for (int b {0}; b < batch_size; ++b) {
+            if (s / 2 >= target_lens[b] && s <= 2 * (target_lens[b] + band_size)) is_scoring = true;
+        }
+        if (!is_scoring) return;
+        ByteBatchVector::store(m, window);
+        for (int b {0}; b < batch_size; ++b) {
+            if (s / 2 >= target_lens[b] && s <= 2 * (target_lens[b] + band_size)) {
+                const auto idx = s / 2 - target_lens[b] < band_size ? s / 2 - target_lens[b] : band_size - 1;
+                const auto score = window[b * band_size + idx];
+                if (score < minscores[b]) minscores[b] = score;
+            }
+        }
+    };
+
+    _truthnqual = make_truthnqual(_truthwin, _nscore, _inf, _n);
+
+    for (int s {0}; s <= 2 * (max_target_len + band_size); s += 2) {
+        // truth is current; target needs updating
+        if (s / 2 % band_size == 0) {
+            _next_target    = load_bytes(s / 2, target_lens, get_target, pad_target, false);
+            _next_qualities = load_bytes(s / 2, target_lens, get_qualities, pad_qualities, false);
+        }
+        _targetwin      = ByteBatchVector::bitwise_or(ByteBatchVector::shift_up(_targetwin),
+                                                      ByteBatchVector::bitwise_and(_next_target, _firstmask));
+        _qualitieswin   = ByteBatchVector::bitwise_or(ByteBatchVector::shift_up(_qualitieswin),
+                                                      ByteBatchVector::bitwise_and(_next_qualities, _firstmask));
+        _next_target    = ByteBatchVector::shift_down(_next_target);
+        _next_qualities = ByteBatchVector::shift_down(_next_qualities);
+
+        // S even
+
+        _m1 = ByteBatchVector::bitwise_andnot(_initmask, _m1);
+        _m2 = ByteBatchVector::bitwise_andnot(_initmask, _m2);
+        _m1 = ByteBatchVector::min(_m1, ByteBatchVector::min(_i1, _d1));
+        update_minscores(_m1, s);
+
+        _mismatch = make_mismatch(_targetwin, _qualitieswin, _truthwin, _snvmaskwin, _snv_priorwin, _truthnqual);
+        _m1 = ByteBatchVector::saturating_add(_m1, _mismatch);
+        _d1 = ByteBatchVector::min(ByteBatchVector::saturating_add(_d2, _gap_extend),
+                                   ByteBatchVector::saturating_add(ByteBatchVector::min(_m2, _i2),
+                                                                   ByteBatchVector::shift_down(_gap_open))); // allow I->D
+        _d1 = ByteBatchVector::bitwise_or(ByteBatchVector::shift_up(_d1), _firstmask); // first lane is inf
+        _i1 = ByteBatchVector::saturating_add(ByteBatchVector::min(ByteBatchVector::saturating_add(_i2, _gap_extend),
+                                                                   ByteBatchVector::saturating_add(_m2, _gap_open)),
+                                              _nuc_prior);
+
+        // S odd
+        // truth needs updating; target is current
+        const auto pos = band_size + s / 2;
+
+        if (s / 2 % band_size == 0) {
+            _next_truth      = load_bytes(pos, truth_lens, get_truth, pad_truth, true);
+            _next_snv_mask   = load_bytes(pos, truth_lens, get_snv_mask, pad_snv_mask, true);
+            _next_snv_prior  = load_bytes(pos, truth_lens, get_snv_prior, pad_snv_prior, true);
+            _next_gap_open   = load_bytes(pos, truth_lens, get_gap_open, pad_gap_open, true);
+            _next_gap_extend = load_bytes(pos, truth_lens, get_gap_extend, pad_gap_extend, true);
+        }
+        const auto shift_in_last = [&] (const SimdInt window, const SimdInt next) {
+            return ByteBatchVector::bitwise_or(ByteBatchVector::shift_down(window), ByteBatchVector::bitwise_and(next, _lastmask));
+        };
+        _truthwin        = shift_in_last(_truthwin, _next_truth);
+        _snvmaskwin      = shift_in_last(_snvmaskwin, _next_snv_mask);
+        _snv_priorwin    = shift_in_last(_snv_priorwin, _next_snv_prior);
+        _gap_open        = shift_in_last(_gap_open, _next_gap_open);
+        _gap_extend      = shift_in_last(_gap_extend, _next_gap_extend);
+        _next_truth      = ByteBatchVector::shift_up(_next_truth);
+        _next_snv_mask   = ByteBatchVector::shift_up(_next_snv_mask);
+        _next_snv_prior  = ByteBatchVector::shift_up(_next_snv_prior);
+        _next_gap_open   = ByteBatchVector::shift_up(_next_gap_open);
+        _next_gap_extend = ByteBatchVector::shift_up(_next_gap_extend);
+        _truthnqual   = make_truthnqual(_truthwin, _nscore, _inf, _n);
+
+        _initmask = ByteBatchVector::shift_up(_initmask);
+
+        _m2 = ByteBatchVector::min(_m2, ByteBatchVector::min(_i2, _d2));
+        update_minscores(_m2, s);
+
+        _mismatch = make_mismatch(_targetwin, _qualitieswin, _truthwin, _snvmaskwin, _snv_priorwin, _truthnqual);
+        _m2 = ByteBatchVector::saturating_add(_m2, _mismatch);
+        _d2 = ByteBatchVector::min(ByteBatchVector::saturating_add(_d1, _gap_extend),
+                                   ByteBatchVector::saturating_add(ByteBatchVector::min(_m1, _i1), _gap_open)); // allow I->D
+        _i2 = ByteBatchVector::saturating_add(ByteBatchVector::min(ByteBatchVector::saturating_add(ByteBatchVector::shift_down(_i1), _gap_extend),
+                                                                   ByteBatchVector::saturating_add(ByteBatchVector::shift_down(_m1), _gap_open)),
+                                              _nuc_prior);
+        _i2 = ByteBatchVector::bitwise_or(_i2, _lastmask); // last lane is inf
+    }
+
+    for (int b {0}; b < batch_size; ++b) scores[b] = minscores[b] < inf ? minscores[b] : saturated_score;
+}
+
+namespace avx2 {
+
+constexpr int band_size() noexcept { return 16; }
+
+int align(const char* truth, const char* target, const std::int8_t* qualities,
+          int truth_len, int target_len,
+          const char* snv_mask, const std::int8_t* snv_prior,
+          const std::int8_t* gap_open, const std::int8_t* gap_extend,
+          short nuc_prior) noexcept;
+
+constexpr int batch_size() noexcept { return 2; }
+
+// Aligns batch_size() alignments
+void align(const BandedAlignment* alignments, int* scores) noexcept;
+
+constexpr int byte_batch_size() noexcept { return 4; }
+
+// Aligns byte_batch_size() alignments with batched_banded_align_u8
+void align_u8(const BandedAlignment* alignments, int* scores) noexcept;
+
+} // namespace avx2
+
+namespace avx512 {
+
+constexpr int band_size() noexcept { return 32; }
+
+int align(const char* truth, const char* target, const std::int8_t* qualities,
+          int truth_len, int target_len,
+          const char* snv_mask, const std::int8_t* snv_prior,
+          const std::int8_t* gap_open, const std::int8_t* gap_extend,
+          short nuc_prior) noexcept;
+
+constexpr int batch_size() noexcept { return 4; }
+
+// Aligns batch_size() alignments
+void align(const BandedAlignment* alignments, int* scores) noexcept;
+
+constexpr int byte_batch_size() noexcept { return 8; }
+
+// Aligns byte_batch_size() alignments with batched_banded_align_u8
+void align_u8(const BandedAlignment* alignments, int* scores) noexcept;
+
+} // namespace avx512
+
+} // namespace simd
+} // namespace hmm
+} // namespace octopus
+
+#endif
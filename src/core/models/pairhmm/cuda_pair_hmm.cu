@@ -0,0 +1,192 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "cuda_pair_hmm.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <cuda_runtime.h>
+
+#include "banded_pair_hmm.hpp"
+
+namespace octopus { namespace hmm { namespace cuda {
+
+namespace {
+
+constexpr int bandSize {simd::min_flank_pad()};
+constexpr int threadsPerBlock {128};
+
+// Offsets into the packed input buffer. Each alignment is stored as the truth, snv mask, snv prior,
+// gap open, and gap extend (truth length each) followed by the target and qualities.
+struct PackedAlignment
+{
+    std::size_t offset;
+    int target_len;
+    short nuc_prior;
+};
+
+int truth_length(const int target_len) noexcept
+{
+    return target_len + 2 * bandSize - 1;
+}
+
+std::size_t packed_size(const int target_len) noexcept
+{
+    return 5 * static_cast<std::size_t>(truth_length(target_len)) + 2 * static_cast<std::size_t>(target_len);
+}
+
+__global__ void align_kernel(const char* data, const PackedAlignment* alignments, const int num_alignments, int* scores)
+{
+    const int idx {static_cast<int>(blockIdx.x * blockDim.x + threadIdx.x)};
+    if (idx >= num_alignments) return;
+    const auto alignment = alignments[idx];
+    const auto truth_len = alignment.target_len + 2 * bandSize - 1;
+    const auto truth      = data + alignment.offset;
+    const auto snv_mask   = truth + truth_len;
+    const auto snv_prior  = reinterpret_cast<const std::int8_t*>(snv_mask + truth_len);
+    const auto gap_open   = snv_prior + truth_len;
+    const auto gap_extend = gap_open + truth_len;
+    const auto target     = reinterpret_cast<const char*>(gap_extend + truth_len);
+    const auto qualities  = reinterpret_cast<const std::int8_t*>(target + alignment.target_len);
+    scores[idx] = simd::banded_align<simd::PortableVector<bandSize>>(truth, target, qualities, truth_len, alignment.target_len,
+                                                                     snv_mask, snv_prior, gap_open, gap_extend,
+                                                                     alignment.nuc_prior);
+}
+
+template <typename T>
+bool reserve_host(T*& buffer, std::size_t& capacity, const std::size_t size) noexcept
+{
+    if (size <= capacity) return true;
+    if (buffer) cudaFreeHost(buffer);
+    capacity = 0;
+    if (cudaMallocHost(reinterpret_cast<void**>(&buffer), size * sizeof(T)) != cudaSuccess) {
+        buffer = nullptr;
+        return false;
+    }
+    capacity = size;
+    return true;
+}
+
+template <typename T>
+bool reserve_device(T*& buffer, std::size_t& capacity, const std::size_t size) noexcept
+{
+    if (size <= capacity) return true;
+    if (buffer) cudaFree(buffer);
+    capacity = 0;
+    if (cudaMalloc(reinterpret_cast<void**>(&buffer), size * sizeof(T)) != cudaSuccess) {
+        buffer = nullptr;
+        return false;
+    }
+    capacity = size;
+    return true;
+}
+
+// Per thread stream and buffers, grown as needed and reused between calls. Host buffers are pinned
+// so the copies can overlap with other streams.
+struct ThreadContext
+{
+    cudaStream_t stream {nullptr};
+    bool is_valid {false};
+    char* host_data {nullptr};
+    PackedAlignment* host_alignments {nullptr};
+    int* host_scores {nullptr};
+    char* device_data {nullptr};
+    PackedAlignment* device_alignments {nullptr};
+    int* device_scores {nullptr};
+    std::size_t host_data_capacity {0}, host_alignments_capacity {0}, host_scores_capacity {0};
+    std::size_t device_data_capacity {0}, device_alignments_capacity {0}, device_scores_capacity {0};
+
+    ThreadContext() noexcept
+    {
+        is_valid = cudaStreamCreateWithFlags(&stream, cudaStreamNonBlocking) == cudaSuccess;
+    }
+    ~ThreadContext()
+    {
+        if (host_data) cudaFreeHost(host_data);
+        if (host_alignments) cudaFreeHost(host_alignments);
+        if (host_scores) cudaFreeHost(host_scores);
+        if (device_data) cudaFree(device_data);
+        if (device_alignments) cudaFree(device_alignments);
+        if (device_scores) cudaFree(device_scores);
+        if (is_valid) cudaStreamDestroy(stream);
+    }
+
+    bool reserve(const std::size_t data_size, const std::size_t num_alignments) noexcept
+    {
+        return reserve_host(host_data, host_data_capacity, data_size)
+            && reserve_host(host_alignments, host_alignments_capacity, num_alignments)
+            && reserve_host(host_scores, host_scores_capacity, num_alignments)
+            && reserve_device(device_data, device_data_capacity, data_size)
+            && reserve_device(device_alignments, device_alignments_capacity, num_alignments)
+            && reserve_device(device_scores, device_scores_capacity, num_alignments);
+    }
+};
+
+ThreadContext& thread_context()
+{
+    thread_local ThreadContext result {};
+    return result;
+}
+
+bool detect_device() noexcept
+{
+    int count {0};
+    return cudaGetDeviceCount(&count) == cudaSuccess && count > 0;
+}
+
+} // namespace
+
+bool is_available() noexcept
+{
+    static const bool result {detect_device()};
+    return result;
+}
+
+bool align(const simd::BandedAlignment* alignments, const int num_alignments, int* scores) noexcept
+{
+    if (num_alignments <= 0) return true;
+    auto& context = thread_context();
+    if (!context.is_valid) return false;
+    std::size_t data_size {0};
+    for (int i {0}; i < num_alignments; ++i) data_size += packed_size(alignments[i].target_len);
+    if (!context.reserve(data_size, num_alignments)) return false;
+    std::size_t offset {0};
+    for (int i {0}; i < num_alignments; ++i) {
+        const auto& alignment = alignments[i];
+        const auto truth_len = static_cast<std::size_t>(truth_length(alignment.target_len));
+        const auto target_len = static_cast<std::size_t>(alignment.target_len);
+        context.host_alignments[i] = {offset, alignment.target_len, alignment.nuc_prior};
+        auto* out = context.host_data + offset;
+        std::memcpy(out, alignment.truth, truth_len); out += truth_len;
+        std::memcpy(out, alignment.snv_mask, truth_len); out += truth_len;
+        std::memcpy(out, alignment.snv_prior, truth_len); out += truth_len;
+        std::memcpy(out, alignment.gap_open, truth_len); out += truth_len;
+        std::memcpy(out, alignment.gap_extend, truth_len); out += truth_len;
+        std::memcpy(out, alignment.target, target_len); out += target_len;
+        std::memcpy(out, alignment.qualities, target_len);
+        offset += packed_size(alignment.target_len);
+    }
+    const auto stream = context.stream;
+    if (cudaMemcpyAsync(context.device_data, context.host_data, data_size, cudaMemcpyHostToDevice, stream) != cudaSuccess
+        || cudaMemcpyAsync(context.device_alignments, context.host_alignments, num_alignments * sizeof(PackedAlignment),
+                           cudaMemcpyHostToDevice, stream) != cudaSuccess) {
+        return false;
+    }
+    const int num_blocks {(num_alignments + threadsPerBlock - 1) / threadsPerBlock};
+    align_kernel<<<num_blocks, threadsPerBlock, 0, stream>>>(context.device_data, context.device_alignments,
+                                                             num_alignments, context.device_scores);
+    if (cudaGetLastError() != cudaSuccess
+        || cudaMemcpyAsync(context.host_scores, context.device_scores, num_alignments * sizeof(int),
+                           cudaMemcpyDeviceToHost, stream) != cudaSuccess
+        || cudaStreamSynchronize(stream) != cudaSuccess) {
+        return false;
+    }
+    std::memcpy(scores, context.host_scores, num_alignments * sizeof(int));
+    return true;
+}
+
+} // namespace cuda
+} // namespace hmm
+} // namespace octopus
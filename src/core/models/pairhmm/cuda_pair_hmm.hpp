@@ -0,0 +1,28 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef cuda_pair_hmm_hpp
+#define cuda_pair_hmm_hpp
+
+#include "simd_pair_hmm.hpp"
+
+namespace octopus { namespace hmm { namespace cuda {
+
+// Only defined if octopus is built with CUDA (OCTOPUS_CUDA).
+
+// True if a CUDA device is present. This is detected once and cached.
+bool is_available() noexcept;
+
+// Batches smaller than this are not worth the transfer and launch overhead
+constexpr int min_batch_size() noexcept { return 2048; }
+
+// Scores each alignment with the same kernel as simd::align, one device thread per alignment.
+// Each calling thread uses its own stream and buffers, so several threads may offload at once.
+// Returns false if the device failed, in which case scores should be computed on the host.
+bool align(const simd::BandedAlignment* alignments, int num_alignments, int* scores) noexcept;
+
+} // namespace cuda
+} // namespace hmm
+} // namespace octopus
+
+#endif
@@ -17,6 +17,10 @@
 
 #include "utils/maths.hpp"
 #include "simd_pair_hmm.hpp"
+#include "utils/stage_profiler.hpp"
+#ifdef OCTOPUS_CUDA
+#include "cuda_pair_hmm.hpp"
+#endif
 
 namespace octopus { namespace hmm {
 
@@ -59,6 +63,12 @@ bool use_adjusted_alignment_score(const std::string& truth, const std::string& t
     return target_overlaps_truth_flank(truth, target, target_offset, model);
 }
 
+bool can_use_band(const std::string& truth, const std::string& target, const std::size_t target_offset,
+                  const unsigned band_size) noexcept
+{
+    return target_offset >= band_size && target_offset + target.size() + band_size - 1 <= truth.size();
+}
+
 namespace debug {
 
 void print_alignment(const std::vector<char>& align1, const std::vector<char>& align2)
@@ -132,6 +142,22 @@ auto simd_align(const std::string& truth, const std::string& target,
     }
     const auto qualities = reinterpret_cast<const std::int8_t*>(target_qualities.data());
     if (!use_adjusted_alignment_score(truth, target, target_offset, model)) {
+        if (model.band_size != static_cast<unsigned>(pad) && can_use_band(truth, target, target_offset, model.band_size)) {
+            const auto band = static_cast<int>(model.band_size);
+            const auto band_offset = static_cast<int>(target_offset) - band;
+            const auto score = simd::align(band,
+                                           truth.data() + band_offset,
+                                           target.data(),
+                                           qualities,
+                                           target_size + 2 * band - 1,
+                                           target_size,
+                                           model.snv_mask.data() + band_offset,
+                                           model.snv_priors.data() + band_offset,
+                                           model.gap_open.data() + band_offset,
+                                           model.gap_extend.data() + band_offset,
+                                           model.nuc_prior);
+            return -ln10Div10<> * static_cast<double>(score);
+        }
         const auto score = simd::align(truth.data() + alignment_offset,
                                        target.data(),
                                        qualities,
@@ -295,6 +321,11 @@ unsigned min_flank_pad() noexcept
     return simd::min_flank_pad();
 }
 
+bool is_supported_band_size(const unsigned band_size) noexcept
+{
+    return simd::is_supported_band_size(static_cast<int>(band_size));
+}
+
 void validate(const std::string& truth, const std::string& target,
               const std::vector<std::uint8_t>& target_qualities,
               const std::size_t target_offset,
@@ -314,10 +345,12 @@ void validate(const std::string& truth, const std::string& target,
     }
 }
 
-double evaluate(const std::string& target, const std::string& truth,
-                const std::vector<std::uint8_t>& target_qualities,
-                const std::size_t target_offset,
-                const MutationModel& model)
+// Handles the cases that do not require the pair HMM, returning false if alignment is needed
+bool evaluate_without_alignment(const std::string& target, const std::string& truth,
+                                const std::vector<std::uint8_t>& target_qualities,
+                                const std::size_t target_offset,
+                                const MutationModel& model,
+                                double& result)
 {
     using std::cbegin; using std::cend; using std::next; using std::distance;
     static constexpr auto lnProbability = make_phred_to_ln_prob_lookup<std::uint8_t>();
@@ -325,7 +358,8 @@ double evaluate(const std::string& target, const std::string& truth,
     const auto offsetted_truth_begin_itr = next(cbegin(truth), target_offset);
     const auto m1 = std::mismatch(cbegin(target), cend(target), offsetted_truth_begin_itr);
     if (m1.first == cend(target)) {
-        return 0; // sequences are equal, can't do better than this
+        result = 0; // sequences are equal, can't do better than this
+        return true;
     }
     const auto m2 = std::mismatch(next(m1.first), cend(target), next(m1.second));
     if (m2.first == cend(target)) {
@@ -334,7 +368,8 @@ double evaluate(const std::string& target, const std::string& truth,
         // truth:  ACGTTCGT
         const auto truth_mismatch_idx = distance(offsetted_truth_begin_itr, m1.second) + target_offset;
         if (truth_mismatch_idx < model.lhs_flank_size || truth_mismatch_idx >= (truth.size() - model.rhs_flank_size)) {
-            return 0;
+            result = 0;
+            return true;
         }
         const auto target_index = distance(cbegin(target), m1.first);
         auto mispatch_penalty = target_qualities[target_index];
@@ -343,25 +378,109 @@ double evaluate(const std::string& target, const std::string& truth,
                                         static_cast<std::uint8_t>(model.snv_priors[truth_mismatch_idx]));
         }
         if (mispatch_penalty <= model.gap_open[truth_mismatch_idx]) {
-            return lnProbability[mispatch_penalty];
+            result = lnProbability[mispatch_penalty];
+            return true;
         } else {
             if (std::equal(next(m1.first), cend(target), m1.second)) {
                 // target: AAAAGGGG
                 // truth:  AAA GGGGG
-                return lnProbability[model.gap_open[truth_mismatch_idx]];
+                result = lnProbability[model.gap_open[truth_mismatch_idx]];
+                return true;
             } else if (std::equal(m1.first, cend(target), next(m1.second))) {
                 // target: AAA GGGGG
                 // truth:  AAAAGGGGG
-                return lnProbability[model.gap_open[truth_mismatch_idx]];
+                result = lnProbability[model.gap_open[truth_mismatch_idx]];
+                return true;
             } else if (mispatch_penalty <= (model.gap_open[truth_mismatch_idx] + model.gap_extend[truth_mismatch_idx])) {
-                return lnProbability[mispatch_penalty];
+                result = lnProbability[mispatch_penalty];
+                return true;
             }
         }
     }
+    return false;
+}
+
+double evaluate(const std::string& target, const std::string& truth,
+                const std::vector<std::uint8_t>& target_qualities,
+                const std::size_t target_offset,
+                const MutationModel& model)
+{
+    double result;
+    if (evaluate_without_alignment(target, truth, target_qualities, target_offset, model, result)) {
+        return result;
+    }
     // TODO: we should be able to optimise the alignment based of the first mismatch postition
     return simd_align(truth, target, target_qualities, target_offset, model);
 }
 
+void evaluate(const std::string& truth, const std::vector<EvaluationRequest>& requests, std::vector<double>& result)
+{
+    constexpr auto pad = simd::min_flank_pad();
+    thread_local std::vector<simd::BandedAlignment> alignments {};
+    thread_local std::vector<std::size_t> alignment_requests {};
+    thread_local std::vector<int> scores {};
+    alignments.clear();
+    alignment_requests.clear();
+    result.resize(requests.size());
+    for (std::size_t i {0}; i < requests.size(); ++i) {
+        const auto& request = requests[i];
+        const auto& target = request.target;
+        const auto& model = request.model;
+        if (evaluate_without_alignment(target, truth, request.target_qualities, request.target_offset, model, result[i])) {
+            continue;
+        }
+        const auto target_size = static_cast<int>(target.size());
+        const auto truth_alignment_size = static_cast<int>(target_size + 2 * pad - 1);
+        const auto alignment_offset = std::max(0, static_cast<int>(request.target_offset) - pad);
+        const auto uses_wide_band = model.band_size != static_cast<unsigned>(pad)
+                                     && can_use_band(truth, target, request.target_offset, model.band_size);
+        if (uses_wide_band || alignment_offset + truth_alignment_size > static_cast<int>(truth.size())
+            || use_adjusted_alignment_score(truth, target, request.target_offset, model)) {
+            result[i] = simd_align(truth, target, request.target_qualities, request.target_offset, model);
+            continue;
+        }
+        alignments.push_back({truth.data() + alignment_offset,
+                              target.data(),
+                              reinterpret_cast<const std::int8_t*>(request.target_qualities.data()),
+                              target_size,
+                              model.snv_mask.data() + alignment_offset,
+                              model.snv_priors.data() + alignment_offset,
+                              model.gap_open.data() + alignment_offset,
+                              model.gap_extend.data() + alignment_offset,
+                              model.nuc_prior});
+        alignment_requests.push_back(i);
+    }
+    if (alignments.empty()) return;
+    // Alignments packed together run for as long as the longest target
+    std::vector<std::size_t> order(alignments.size());
+    std::iota(std::begin(order), std::end(order), 0);
+    std::stable_sort(std::begin(order), std::end(order), [&] (auto lhs, auto rhs) {
+        return alignments[lhs].target_len < alignments[rhs].target_len;
+    });
+    thread_local std::vector<simd::BandedAlignment> sorted_alignments {};
+    sorted_alignments.clear();
+    sorted_alignments.reserve(alignments.size());
+    for (const auto idx : order) sorted_alignments.push_back(alignments[idx]);
+    scores.resize(alignments.size());
+    const auto num_alignments = static_cast<int>(sorted_alignments.size());
+#ifdef OCTOPUS_CUDA
+    // Falls back to the host if the device fails
+    if (num_alignments >= cuda::min_batch_size() && cuda::is_available()
+        && cuda::align(sorted_alignments.data(), num_alignments, scores.data())) {
+        profiling::count(profiling::Event::hmm_cuda, static_cast<std::uint64_t>(num_alignments));
+    } else
+#endif
+    {
+        const auto tier_counts = simd::align(sorted_alignments.data(), num_alignments, scores.data());
+        profiling::count(profiling::Event::hmm_int8, static_cast<std::uint64_t>(tier_counts.int8));
+        profiling::count(profiling::Event::hmm_int8_saturated, static_cast<std::uint64_t>(tier_counts.int8_saturated));
+        profiling::count(profiling::Event::hmm_int16, static_cast<std::uint64_t>(tier_counts.int16));
+    }
+    for (std::size_t j {0}; j < order.size(); ++j) {
+        result[alignment_requests[order[j]]] = -ln10Div10<> * static_cast<double>(scores[j]);
+    }
+}
+
 Alignment&
 align(const std::string& target, const std::string& truth,
       const std::vector<std::uint8_t>& target_qualities,
@@ -19,6 +19,10 @@ namespace octopus { namespace hmm {
 // the mapped position
 unsigned min_flank_pad() noexcept;
 
+// Band sizes other than min_flank_pad() allow larger gaps relative to the mapped position,
+// and are used when the truth is padded by at least band_size either side of the target
+bool is_supported_band_size(unsigned band_size) noexcept;
+
 struct MutationModel
 {
     using Penalty = std::int8_t;
@@ -28,6 +32,7 @@ struct MutationModel
     const std::vector<Penalty>& gap_extend;
     short nuc_prior = 2;
     std::size_t lhs_flank_size = 0, rhs_flank_size = 0;
+    unsigned band_size = 8;
 };
 
 struct VariableGapExtendMutationModel
@@ -92,6 +97,20 @@ double evaluate(const std::string& target, const std::string& truth,
                 std::size_t target_offset,
                 const MutationModel& model);
 
+struct EvaluationRequest
+{
+    const std::string& target;
+    const std::vector<std::uint8_t>& target_qualities;
+    std::size_t target_offset;
+    const MutationModel& model;
+};
+
+// Equivalent to calling evaluate for each request, but alignments that need the full pair HMM
+// are packed several to a SIMD register when the host supports it, or offloaded to a CUDA device
+// if octopus is built with CUDA and there are enough of them.
+void evaluate(const std::string& truth, const std::vector<EvaluationRequest>& requests,
+              std::vector<double>& result);
+
 Alignment&
 align(const std::string& target, const std::string& truth,
       const std::vector<std::uint8_t>& target_qualities,
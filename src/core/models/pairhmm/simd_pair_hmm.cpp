@@ -8,10 +8,13 @@
 #include "simd_pair_hmm.hpp"
 
 #include <vector>
+#include <array>
 #include <algorithm>
-#include <emmintrin.h>
 #include <cassert>
 
+#include "utils/sse2_neon.hpp"
+#include "banded_pair_hmm.hpp"
+
 #include <boost/container/small_vector.hpp>
 
 //#include <iostream> // DEBUG
@@ -43,722 +46,134 @@
 //    return os;
 //}
 
-namespace octopus { namespace hmm { namespace simd {
-
-constexpr std::size_t staticBackpointerCapacity {10000};
-
-template <typename T>
-using SmallVector = boost::container::small_vector<T, staticBackpointerCapacity>;
-
-constexpr short nScore {2 << 2};
-constexpr int bandSize {8};
-constexpr short inf {0x7800};
-constexpr char gap {'-'};
-
-auto extract_epi16(const __m128i a, const int imm) noexcept
-{
-    switch (imm) {
-        case 0:  return _mm_extract_epi16(a, 0);
-        case 1:  return _mm_extract_epi16(a, 1);
-        case 2:  return _mm_extract_epi16(a, 2);
-        case 3:  return _mm_extract_epi16(a, 3);
-        case 4:  return _mm_extract_epi16(a, 4);
-        case 5:  return _mm_extract_epi16(a, 5);
-        case 6:  return _mm_extract_epi16(a, 6);
-        default: return _mm_extract_epi16(a, 7);
-    }
-}
-
-int align(const char* truth, const char* target, const std::int8_t* qualities,
-          int truth_len, int target_len,
-          short gap_open, short gap_extend, short nuc_prior) noexcept
-{
-    // target is the read; the shorter of the sequences
-    // no checks for overflow are done
-    //
-    // the bottom-left and top-right corners of the DP table are just
-    // included at the extreme ends of the diagonal, which measures
-    // n=8 entries diagonally across.  This fixes the length of the
-    // longer (horizontal) sequence to 15 (2*8-1) more than the shorter
-    //
-    // the << 2's are because the lower two bits are reserved for back tracing
-    
-    assert(truth_len > bandSize && (truth_len == target_len + 2 * bandSize - 1));
-    
-    gap_open <<= 2;
-    gap_extend <<= 2;
-    nuc_prior <<= 2;
-    
-    using SimdInt = __m128i;
-    
-    SimdInt _m1 {_mm_set1_epi16(inf)};
-    auto _i1 = _m1;
-    auto _d1 = _m1;
-    auto _m2 = _m1;
-    auto _i2 = _m1;
-    auto _d2 = _m1;
-    
-    const SimdInt _gap_open {_mm_set1_epi16(gap_open)};
-    const SimdInt _gap_extend {_mm_set1_epi16(gap_extend)};
-    const SimdInt _nuc_prior  {_mm_set1_epi16(nuc_prior)};
-    
-    SimdInt _initmask   {_mm_set_epi16(0,0,0,0,0,0,0,-1)};
-    SimdInt _initmask2  {_mm_set_epi16(0,0,0,0,0,0,0,-0x8000)};
-    
-    // truth is initialized with the n-long prefix, in forward direction
-    // target is initialized as empty; reverse direction
-    SimdInt _truthwin  {_mm_set_epi16(truth[7], truth[6], truth[5], truth[4],
-                                      truth[3], truth[2], truth[1], truth[0])};
-    SimdInt _targetwin  {_m1};
-    SimdInt _qualitieswin {_mm_set1_epi16(64 << 2)};
-    
-    // if N, make nScore; if != N, make inf
-    SimdInt _truthnqual {_mm_add_epi16(_mm_and_si128(_mm_cmpeq_epi16(_truthwin, _mm_set1_epi16('N')),
-                                                     _mm_set1_epi16(nScore - inf)),
-                                       _mm_set1_epi16(inf))};
-    
-    short minscore {inf};
-    
-    for (int s {0}; s <= 2 * (target_len + bandSize); s += 2) {
-        // truth is current; target needs updating
-        _targetwin    = _mm_slli_si128(_targetwin, 2);
-        _qualitieswin = _mm_slli_si128(_qualitieswin, 2);
-        
-        if (s / 2 < target_len) {
-            _targetwin    = _mm_insert_epi16(_targetwin, target[s / 2], 0);
-            _qualitieswin = _mm_insert_epi16(_qualitieswin, qualities[s / 2] << 2, 0);
-        } else {
-            _targetwin    = _mm_insert_epi16(_targetwin, '0', 0);
-            _qualitieswin = _mm_insert_epi16(_qualitieswin, 64 << 2, 0);
-        }
-        
-        // S even
-        
-        _m1 = _mm_or_si128(_initmask2, _mm_andnot_si128(_initmask, _m1));
-        _m2 = _mm_or_si128(_initmask2, _mm_andnot_si128(_initmask, _m2));
-        _m1 = _mm_min_epi16(_m1, _mm_min_epi16(_i1, _d1));
-        
-        short score = extract_epi16(_m1, std::max(0, s / 2 - target_len));
-        if (s / 2 >= target_len) {
-            minscore = std::min(score, minscore);
-        }
-        
-        _m1 = _mm_add_epi16(_m1, _mm_min_epi16(_mm_andnot_si128(_mm_cmpeq_epi16(_targetwin, _truthwin),
-                                                                _qualitieswin), _truthnqual));
-        _d1 = _mm_min_epi16(_mm_add_epi16(_d2, _gap_extend),
-                            _mm_add_epi16(_mm_min_epi16(_m2, _i2),
-                                          _mm_srli_si128(_gap_open, 2))); // allow I->D
-        _d1 = _mm_insert_epi16(_mm_slli_si128(_d1, 2), inf, 0);
-        _i1 = _mm_add_epi16(_mm_min_epi16(_mm_add_epi16(_i2, _gap_extend),
-                                          _mm_add_epi16(_m2, _gap_open)),
-                            _nuc_prior);
-        
-        // S odd
-        // truth needs updating; target is current
-        const auto pos = bandSize + s / 2;
-        const char base {(pos < truth_len) ? truth[pos] : 'N'};
-        
-        _truthwin   = _mm_insert_epi16(_mm_srli_si128(_truthwin, 2), base,
-                                       bandSize - 1);
-        _truthnqual = _mm_insert_epi16(_mm_srli_si128(_truthnqual, 2), base == 'N' ? nScore : inf,
-                                       bandSize - 1);
-        
-        _initmask  = _mm_slli_si128(_initmask, 2);
-        _initmask2 = _mm_slli_si128(_initmask2, 2);
-        _m2 = _mm_min_epi16(_m2, _mm_min_epi16(_i2, _d2));
-        
-        if (s / 2 >= target_len) {
-            minscore = std::min(static_cast<short>(extract_epi16(_m2, s / 2 - target_len)), minscore);
-        }
-        
-        _m2 = _mm_add_epi16(_m2, _mm_min_epi16(_mm_andnot_si128(_mm_cmpeq_epi16(_targetwin, _truthwin),
-                                                                _qualitieswin), _truthnqual));
-        _d2 = _mm_min_epi16(_mm_add_epi16(_d1, _gap_extend),
-                            _mm_add_epi16(_mm_min_epi16(_m1, _i1), _gap_open)); // allow I->D
-        _i2 = _mm_insert_epi16(_mm_add_epi16(_mm_min_epi16(_mm_add_epi16(_mm_srli_si128(_i1, 2),
-                                                                         _gap_extend),
-                                                           _mm_add_epi16(_mm_srli_si128(_m1, 2),
-                                                                         _gap_open)),
-                                             _nuc_prior), inf, bandSize - 1);
-        
-    }
-    
-    return (minscore + 0x8000) >> 2;
-}
+// The AVX2 and AVX-512 kernels are only built for x86 (see src/CMakeLists.txt)
+#if defined(__x86_64__) || defined(__i386__)
+    #define OCTOPUS_AVX_KERNELS
+#endif
 
-int align(const char* truth, const char* target, const std::int8_t* qualities,
-          const int truth_len, const int target_len,
-          const std::int8_t* gap_open, short gap_extend, short nuc_prior) noexcept
-{
-    // target is the read; the shorter of the sequences
-    // no checks for overflow are done
-    //
-    // the bottom-left and top-right corners of the DP table are just
-    // included at the extreme ends of the diagonal, which measures
-    // n=8 entries diagonally across.  This fixes the length of the
-    // longer (horizontal) sequence to 15 (2*8-1) more than the shorter
-    //
-    // the << 2's are because the lower two bits are reserved for back tracing
-    
-    assert(truth_len > bandSize && (truth_len == target_len + 2 * bandSize - 1));
-    
-    gap_extend <<= 2;
-    nuc_prior <<= 2;
-    
-    using SimdInt = __m128i;
-    
-    SimdInt _m1 {_mm_set1_epi16(inf)};
-    auto _i1 = _m1;
-    auto _d1 = _m1;
-    auto _m2 = _m1;
-    auto _i2 = _m1;
-    auto _d2 = _m1;
-    
-    SimdInt _gap_extend {_mm_set1_epi16(gap_extend)};
-    SimdInt _nuc_prior  {_mm_set1_epi16(nuc_prior)};
-    
-    SimdInt _initmask   {_mm_set_epi16(0,0,0,0,0,0,0,-1)};
-    SimdInt _initmask2  {_mm_set_epi16(0,0,0,0,0,0,0,-0x8000)};
-    
-    // truth is initialized with the n-long prefix, in forward direction
-    // target is initialized as empty; reverse direction
-    SimdInt _truthwin  {_mm_set_epi16(truth[7], truth[6], truth[5], truth[4],
-                                      truth[3], truth[2], truth[1], truth[0])};
-    SimdInt _targetwin  {_m1};
-    SimdInt _qualitieswin {_mm_set1_epi16(64 << 2)};
-    
-    // if N, make nScore; if != N, make inf
-    SimdInt _truthnqual {_mm_add_epi16(_mm_and_si128(_mm_cmpeq_epi16(_truthwin, _mm_set1_epi16('N')),
-                                                     _mm_set1_epi16(nScore - inf)),
-                                       _mm_set1_epi16(inf))};
-    
-    SimdInt _gap_open {_mm_set_epi16(gap_open[7] << 2,gap_open[6] << 2,gap_open[5] << 2,gap_open[4] << 2,
-                                     gap_open[3] << 2,gap_open[2] << 2,gap_open[1] << 2,gap_open[0] << 2)};
-    
-    short minscore {inf};
-    
-    for (int s {0}; s <= 2 * (target_len + bandSize); s += 2) {
-        // truth is current; target needs updating
-        _targetwin    = _mm_slli_si128(_targetwin, 2);
-        _qualitieswin = _mm_slli_si128(_qualitieswin, 2);
-        
-        if (s / 2 < target_len) {
-            _targetwin    = _mm_insert_epi16(_targetwin, target[s / 2], 0);
-            _qualitieswin = _mm_insert_epi16(_qualitieswin, qualities[s / 2] << 2, 0);
-        } else {
-            _targetwin    = _mm_insert_epi16(_targetwin, '0', 0);
-            _qualitieswin = _mm_insert_epi16(_qualitieswin, 64 << 2, 0);
-        }
-        
-        // S even
-        
-        _m1 = _mm_or_si128(_initmask2, _mm_andnot_si128(_initmask, _m1));
-        _m2 = _mm_or_si128(_initmask2, _mm_andnot_si128(_initmask, _m2));
-        _m1 = _mm_min_epi16(_m1, _mm_min_epi16(_i1, _d1));
-        
-        if (s / 2 >= target_len) {
-            minscore = std::min(static_cast<short>(extract_epi16(_m1, s / 2 - target_len)), minscore);
-        }
-        
-        _m1 = _mm_add_epi16(_m1, _mm_min_epi16(_mm_andnot_si128(_mm_cmpeq_epi16(_targetwin, _truthwin),
-                                                                _qualitieswin), _truthnqual));
-        _d1 = _mm_min_epi16(_mm_add_epi16(_d2, _gap_extend),
-                            _mm_add_epi16(_mm_min_epi16(_m2, _i2),
-                                          _mm_srli_si128(_gap_open, 2))); // allow I->D
-        _d1 = _mm_insert_epi16(_mm_slli_si128(_d1, 2), inf, 0);
-        _i1 = _mm_add_epi16(_mm_min_epi16(_mm_add_epi16(_i2, _gap_extend),
-                                          _mm_add_epi16(_m2, _gap_open)),
-                            _nuc_prior);
-        
-        // S odd
-        // truth needs updating; target is current
-        const auto pos = bandSize + s / 2;
-        const char base {(pos < truth_len) ? truth[pos] : 'N'};
-        
-        _truthwin   = _mm_insert_epi16(_mm_srli_si128(_truthwin, 2), base,
-                                       bandSize - 1);
-        _truthnqual = _mm_insert_epi16(_mm_srli_si128(_truthnqual, 2), base == 'N' ? nScore : inf,
-                                       bandSize - 1);
-        _gap_open   = _mm_insert_epi16(_mm_srli_si128(_gap_open, 2),
-                                       gap_open[pos < truth_len ? pos : truth_len - 1] << 2,
-                                       bandSize - 1);
-        
-        _initmask  = _mm_slli_si128(_initmask, 2);
-        _initmask2 = _mm_slli_si128(_initmask2, 2);
-        
-        _m2 = _mm_min_epi16(_m2, _mm_min_epi16(_i2, _d2));
-        
-        if (s / 2 >= target_len) {
-            minscore = std::min(static_cast<short>(extract_epi16(_m2, s / 2 - target_len)), minscore);
-        }
-        
-        _m2 = _mm_add_epi16(_m2, _mm_min_epi16(_mm_andnot_si128(_mm_cmpeq_epi16(_targetwin, _truthwin),
-                                                                 _qualitieswin), _truthnqual));
-        _d2 = _mm_min_epi16(_mm_add_epi16(_d1, _gap_extend),
-                            _mm_add_epi16(_mm_min_epi16(_m1, _i1), _gap_open)); // allow I->D
-        _i2 = _mm_insert_epi16(_mm_add_epi16(_mm_min_epi16(_mm_add_epi16(_mm_srli_si128(_i1, 2),
-                                                                         _gap_extend),
-                                                           _mm_add_epi16(_mm_srli_si128(_m1, 2),
-                                                                         _gap_open)),
-                                             _nuc_prior), inf, bandSize - 1);
-        
-    }
-    
-    return (minscore + 0x8000) >> 2;
-}
+namespace octopus { namespace hmm { namespace simd {
 
-int align(const char* truth, const char* target, const std::int8_t* qualities,
-          const int truth_len, const int target_len,
-          const std::int8_t* gap_open, const std::int8_t* gap_extend,
-          short nuc_prior) noexcept
-{
-    assert(truth_len > bandSize && (truth_len == target_len + 2 * bandSize - 1));
-    
-    nuc_prior <<= 2;
-    
-    using SimdInt = __m128i;
-    
-    SimdInt _m1 {_mm_set1_epi16(inf)};
-    auto _i1 = _m1;
-    auto _d1 = _m1;
-    auto _m2 = _m1;
-    auto _i2 = _m1;
-    auto _d2 = _m1;
-    
-    SimdInt _nuc_prior  {_mm_set1_epi16(nuc_prior)};
-    
-    SimdInt _initmask   {_mm_set_epi16(0,0,0,0,0,0,0,-1)};
-    SimdInt _initmask2  {_mm_set_epi16(0,0,0,0,0,0,0,-0x8000)};
-    
-    // truth is initialized with the n-long prefix, in forward direction
-    // target is initialized as empty; reverse direction
-    SimdInt _truthwin  {_mm_set_epi16(truth[7], truth[6], truth[5], truth[4],
-                                      truth[3], truth[2], truth[1], truth[0])};
-    SimdInt _targetwin  {_m1};
-    SimdInt _qualitieswin {_mm_set1_epi16(64 << 2)};
-    
-    // if N, make nScore; if != N, make inf
-    SimdInt _truthnqual {_mm_add_epi16(_mm_and_si128(_mm_cmpeq_epi16(_truthwin, _mm_set1_epi16('N')),
-                                                     _mm_set1_epi16(nScore - inf)),
-                                       _mm_set1_epi16(inf))};
-    
-    SimdInt _gap_open {_mm_set_epi16(gap_open[7] << 2,gap_open[6] << 2,gap_open[5] << 2,gap_open[4] << 2,
-                                     gap_open[3] << 2,gap_open[2] << 2,gap_open[1] << 2,gap_open[0] << 2)};
-    SimdInt _gap_extend {_mm_set_epi16(gap_extend[7] << 2,gap_extend[6] << 2,gap_extend[5] << 2,gap_extend[4] << 2,
-                                       gap_extend[3] << 2,gap_extend[2] << 2,gap_extend[1] << 2,gap_extend[0] << 2)};
-    
-    short minscore {inf};
-    
-    for (int s {0}; s <= 2 * (target_len + bandSize); s += 2) {
-        // truth is current; target needs updating
-        _targetwin    = _mm_slli_si128(_targetwin, 2);
-        _qualitieswin = _mm_slli_si128(_qualitieswin, 2);
-        
-        if (s / 2 < target_len) {
-            _targetwin    = _mm_insert_epi16(_targetwin, target[s / 2], 0);
-            _qualitieswin = _mm_insert_epi16(_qualitieswin, qualities[s / 2] << 2, 0);
-        } else {
-            _targetwin    = _mm_insert_epi16(_targetwin, '0', 0);
-            _qualitieswin = _mm_insert_epi16(_qualitieswin, 64 << 2, 0);
-        }
-        
-        // S even
-        _m1 = _mm_or_si128(_initmask2, _mm_andnot_si128(_initmask, _m1));
-        _m2 = _mm_or_si128(_initmask2, _mm_andnot_si128(_initmask, _m2));
-        _m1 = _mm_min_epi16(_m1, _mm_min_epi16(_i1, _d1));
-        
-        if (s / 2 >= target_len) {
-            minscore = std::min(static_cast<short>(extract_epi16(_m1, s / 2 - target_len)), minscore);
-        }
-        
-        _m1 = _mm_add_epi16(_m1, _mm_min_epi16(_mm_andnot_si128(_mm_cmpeq_epi16(_targetwin, _truthwin),
-                                                                _qualitieswin), _truthnqual));
-        _d1 = _mm_min_epi16(_mm_add_epi16(_d2, _gap_extend),
-                            _mm_add_epi16(_mm_min_epi16(_m2, _i2),
-                                          _mm_srli_si128(_gap_open, 2))); // allow I->D
-        _d1 = _mm_insert_epi16(_mm_slli_si128(_d1, 2), inf, 0);
-        _i1 = _mm_add_epi16(_mm_min_epi16(_mm_add_epi16(_i2, _gap_extend),
-                                          _mm_add_epi16(_m2, _gap_open)),
-                            _nuc_prior);
-        
-        // S odd; truth needs updating; target is current
-        const auto pos = bandSize + s / 2;
-        const char base {(pos < truth_len) ? truth[pos] : 'N'};
-        _truthwin   = _mm_insert_epi16(_mm_srli_si128(_truthwin, 2), base, bandSize - 1);
-        _truthnqual = _mm_insert_epi16(_mm_srli_si128(_truthnqual, 2), base == 'N' ? nScore : inf, bandSize - 1);
-        const auto gap_idx = pos < truth_len ? pos : truth_len - 1;
-        _gap_open   = _mm_insert_epi16(_mm_srli_si128(_gap_open, 2), gap_open[gap_idx] << 2, bandSize - 1);
-        _gap_extend = _mm_insert_epi16(_mm_srli_si128(_gap_extend, 2), gap_extend[gap_idx] << 2, bandSize - 1);
-        
-        _initmask  = _mm_slli_si128(_initmask, 2);
-        _initmask2 = _mm_slli_si128(_initmask2, 2);
-        
-        _m2 = _mm_min_epi16(_m2, _mm_min_epi16(_i2, _d2));
-        
-        if (s / 2 >= target_len) {
-            minscore = std::min(static_cast<short>(extract_epi16(_m2, s / 2 - target_len)), minscore);
-        }
-        
-        _m2 = _mm_add_epi16(_m2, _mm_min_epi16(_mm_andnot_si128(_mm_cmpeq_epi16(_targetwin, _truthwin),
-                                                                _qualitieswin), _truthnqual));
-        _d2 = _mm_min_epi16(_mm_add_epi16(_d1, _gap_extend),
-                            _mm_add_epi16(_mm_min_epi16(_m1, _i1), _gap_open)); // allow I->D
-        _i2 = _mm_insert_epi16(_mm_add_epi16(_mm_min_epi16(_mm_add_epi16(_mm_srli_si128(_i1, 2),
-                                                                         _gap_extend),
-                                                           _mm_add_epi16(_mm_srli_si128(_m1, 2),
-                                                                         _gap_open)),
-                                             _nuc_prior), inf, bandSize - 1);
-        
-    }
-    
-    return (minscore + 0x8000) >> 2;
-}
-
-int align(const char* truth, const char* target, const std::int8_t* qualities,
-          const int truth_len, const int target_len,
-          const std::int8_t* gap_open, const std::int8_t* gap_extend,
-          short nuc_prior,
-          int& first_pos, char* aln1, char* aln2) noexcept
-{
-    using SimdInt = __m128i;
-    
-    assert(truth_len > bandSize && (truth_len == target_len + 2 * bandSize - 1));
-    
-    constexpr int matchLabel  {0};
-    constexpr int insertLabel {1};
-    constexpr int deleteLabel {3};
-    static const SimdInt _three {_mm_set1_epi16(3)};
-    
-    nuc_prior <<= 2;
-    
-    SimdInt _m1 {_mm_set1_epi16(inf)};
-    auto _i1 = _m1;
-    auto _d1 = _m1;
-    auto _m2 = _m1;
-    auto _i2 = _m1;
-    auto _d2 = _m1;
-    
-    SimdInt _nuc_prior  {_mm_set1_epi16(nuc_prior)};
-    
-    SimdInt _initmask   {_mm_set_epi16(0,0,0,0,0,0,0,-1)};
-    SimdInt _initmask2  {_mm_set_epi16(0,0,0,0,0,0,0,-0x8000)};
-    
-    // truth is initialized with the n-long prefix, in forward direction
-    // target is initialized as empty; reverse direction
-    SimdInt _truthwin  {_mm_set_epi16(truth[7], truth[6], truth[5], truth[4],
-                                      truth[3], truth[2], truth[1], truth[0])};
-    SimdInt _targetwin  {_m1};
-    SimdInt _qualitieswin {_mm_set1_epi16(64 << 2)};
-    
-    // if N, make nScore; if != N, make inf
-    SimdInt _truthnqual {_mm_add_epi16(_mm_and_si128(_mm_cmpeq_epi16(_truthwin, _mm_set1_epi16('N')),
-                                                     _mm_set1_epi16(nScore - inf)),
-                                       _mm_set1_epi16(inf))};
-    
-    SimdInt _gap_open {_mm_set_epi16(gap_open[7] << 2,gap_open[6] << 2,gap_open[5] << 2,gap_open[4] << 2,
-                                     gap_open[3] << 2,gap_open[2] << 2,gap_open[1] << 2,gap_open[0] << 2)};
-    SimdInt _gap_extend {_mm_set_epi16(gap_extend[7] << 2,gap_extend[6] << 2,gap_extend[5] << 2,gap_extend[4] << 2,
-                                       gap_extend[3] << 2,gap_extend[2] << 2,gap_extend[1] << 2,gap_extend[0] << 2)};
-    
-    SmallVector<SimdInt> _backpointers(2 * (truth_len + bandSize));
-    
-    short cur_score {0}, minscore {inf}, minscoreidx {-1};
-    
-    int s {0};
-    for (; s <= 2 * (target_len + bandSize); s += 2) {
-        // truth is current; target needs updating
-        _targetwin    = _mm_slli_si128(_targetwin, 2);
-        _qualitieswin = _mm_slli_si128(_qualitieswin, 2);
-        
-        if (s / 2 < target_len) {
-            _targetwin    = _mm_insert_epi16(_targetwin, target[s / 2], 0);
-            _qualitieswin = _mm_insert_epi16(_qualitieswin, qualities[s / 2] << 2, 0);
-        } else {
-            _targetwin    = _mm_insert_epi16(_targetwin, '0', 0);
-            _qualitieswin = _mm_insert_epi16(_qualitieswin, 64 << 2, 0);
-        }
-        
-        // S even
-        _m1 = _mm_or_si128(_initmask2, _mm_andnot_si128(_initmask, _m1));
-        _m2 = _mm_or_si128(_initmask2, _mm_andnot_si128(_initmask, _m2));
-        _m1 = _mm_min_epi16(_m1, _mm_min_epi16(_i1, _d1));
-        
-        if (s / 2 >= target_len) {
-            cur_score = extract_epi16(_m1, s / 2 - target_len);
-            if (cur_score < minscore) {
-                minscore = cur_score;
-                minscoreidx = s;     // point back to the match state at this entry, so as not to
-            }                        // have to store the state at s-2
-        }
-        
-        _m1 = _mm_add_epi16(_m1, _mm_min_epi16(_mm_andnot_si128(_mm_cmpeq_epi16(_targetwin, _truthwin),
-                                                                _qualitieswin), _truthnqual));
-        _d1 = _mm_min_epi16(_mm_add_epi16(_d2, _gap_extend),
-                            _mm_add_epi16(_mm_min_epi16(_m2, _i2),
-                                          _mm_srli_si128(_gap_open, 2))); // allow I->D
-        _d1 = _mm_insert_epi16(_mm_slli_si128(_d1, 2), inf, 0);
-        _i1 = _mm_add_epi16(_mm_min_epi16(_mm_add_epi16(_i2, _gap_extend),
-                                          _mm_add_epi16(_m2, _gap_open)),
-                            _nuc_prior);
-    
-        _backpointers[s] = _mm_or_si128(_mm_or_si128(_mm_and_si128(_three, _m1),
-                                                     _mm_slli_epi16(_mm_and_si128(_three, _i1),
-                                                                    2 * insertLabel)),
-                                        _mm_slli_epi16(_mm_and_si128(_three, _d1), 2 * deleteLabel));
-        // set state labels
-        _m1 = _mm_andnot_si128(_three, _m1);
-        _i1 = _mm_or_si128(_mm_andnot_si128(_three, _i1), _mm_srli_epi16(_three, 1));
-        _d1 = _mm_or_si128(_mm_andnot_si128(_three, _d1), _three);
-        
-        // S odd; truth needs updating; target is current
-        const auto pos = bandSize + s / 2;
-        const char base {(pos < truth_len) ? truth[pos] : 'N'};
-        _truthwin   = _mm_insert_epi16(_mm_srli_si128(_truthwin, 2), base, bandSize - 1);
-        _truthnqual = _mm_insert_epi16(_mm_srli_si128(_truthnqual, 2), base == 'N' ? nScore : inf, bandSize - 1);
-        const auto gap_idx = pos < truth_len ? pos : truth_len - 1;
-        _gap_open   = _mm_insert_epi16(_mm_srli_si128(_gap_open, 2), gap_open[gap_idx] << 2, bandSize - 1);
-        _gap_extend = _mm_insert_epi16(_mm_srli_si128(_gap_extend, 2), gap_extend[gap_idx] << 2, bandSize - 1);
-        
-        _initmask  = _mm_slli_si128(_initmask, 2);
-        _initmask2 = _mm_slli_si128(_initmask2, 2);
-        
-        _m2 = _mm_min_epi16(_m2, _mm_min_epi16(_i2, _d2));
-        
-        if (s / 2 >= target_len) {
-            cur_score = extract_epi16(_m2, s / 2 - target_len);
-            if (cur_score < minscore) {
-                minscore = cur_score;
-                minscoreidx = s + 1;
-            }
-        }
-        
-        _m2 = _mm_add_epi16(_m2, _mm_min_epi16(_mm_andnot_si128(_mm_cmpeq_epi16(_targetwin, _truthwin),
-                                                                _qualitieswin), _truthnqual));
-        _d2 = _mm_min_epi16(_mm_add_epi16(_d1, _gap_extend),
-                            _mm_add_epi16(_mm_min_epi16(_m1, _i1), _gap_open)); // allow I->D
-        _i2 = _mm_insert_epi16(_mm_add_epi16(_mm_min_epi16(_mm_add_epi16(_mm_srli_si128(_i1, 2),
-                                                                         _gap_extend),
-                                                           _mm_add_epi16(_mm_srli_si128(_m1, 2),
-                                                                         _gap_open)),
-                                             _nuc_prior), inf, bandSize - 1);
-        
-        _backpointers[s + 1] = _mm_or_si128(_mm_or_si128(_mm_and_si128(_three, _m2),
-                                                         _mm_slli_epi16(_mm_and_si128(_three, _i2), 2 * insertLabel)),
-                                            _mm_slli_epi16(_mm_and_si128(_three, _d2), 2 * deleteLabel));
-        // set state labels
-        _m2 = _mm_andnot_si128(_three, _m2);
-        _i2 = _mm_or_si128(_mm_andnot_si128(_three, _i2), _mm_srli_epi16(_three, 1));
-        _d2 = _mm_or_si128(_mm_andnot_si128(_three, _d2), _three);
-    }
-    
-    if (minscoreidx < 0) {
-        // minscore was never updated so we must have overflowed badly
-        first_pos = -1;
-        return -1;
-    }
-    
-    s = minscoreidx;    // point to the dummy match transition
-    
-    auto i      = s / 2 - target_len;
-    auto y      = target_len;
-    auto x      = s - y;
-    auto alnidx = 0;
-    
-    auto ptr = reinterpret_cast<short*>(_backpointers.data() + s);
-    if ((ptr + i) < reinterpret_cast<short*>(_backpointers.data())
-        || (ptr + i) >= reinterpret_cast<short*>(_backpointers.data() + _backpointers.size())) {
-        first_pos = -1;
-        return -1;
-    }
-    auto state = (ptr[i] >> (2 * matchLabel)) & 3;
-    
-    s -= 2;
-    
-    // this is 2*y (s even) or 2*y+1 (s odd)
-    while (y > 0) {
-        if (s < 0 || i < 0) {
-            // This should never happen so must have overflowed
-            first_pos = -1;
-            return -1;
-        }
-        const auto new_state = (reinterpret_cast<short*>(_backpointers.data() + s)[i] >> (2 * state)) & 3;
-        if (state == matchLabel) {
-            s -= 2;
-            aln1[alnidx] = truth[--x];
-            aln2[alnidx] = target[--y];
-        } else if (state == insertLabel) {
-            i += s & 1;
-            s -= 1;
-            aln1[alnidx] = gap;
-            aln2[alnidx] = target[--y];
-        } else {
-            s -= 1;
-            i -= s & 1;
-            aln1[alnidx] = truth[--x];
-            aln2[alnidx] = gap;
-        }
-        state = new_state;
-        alnidx++;
-    }
-    aln1[alnidx] = 0;
-    aln2[alnidx] = 0;
-    first_pos = x;
-    // reverse them
-    for (int j {alnidx - 1}, i = 0; i < j; ++i, j--) {
-        x = aln1[i];
-        y = aln2[i];
-        aln1[i] = aln1[j];
-        aln2[i] = aln2[j];
-        aln1[j] = x;
-        aln2[j] = y;
-    }
-    return (minscore + 0x8000) >> 2;
-}
-
-int align(const char* truth, const char* target, const std::int8_t* qualities,
-          const int truth_len, const int target_len,
-          const char* snv_mask, const std::int8_t* snv_prior,
-          const std::int8_t* gap_open, short gap_extend, short nuc_prior) noexcept
-{
-    assert(truth_len > bandSize && (truth_len == target_len + 2 * bandSize - 1));
-    
-    gap_extend <<= 2;
-    nuc_prior <<= 2;
-    
-    using SimdInt = __m128i;
-    
-    SimdInt _m1 {_mm_set1_epi16(inf)};
-    auto _i1 = _m1;
-    auto _d1 = _m1;
-    auto _m2 = _m1;
-    auto _i2 = _m1;
-    auto _d2 = _m1;
-    
-    SimdInt _gap_extend {_mm_set1_epi16(gap_extend)};
-    SimdInt _nuc_prior  {_mm_set1_epi16(nuc_prior)};
-    SimdInt _initmask   {_mm_set_epi16(0,0,0,0,0,0,0,-1)};
-    SimdInt _initmask2  {_mm_set_epi16(0,0,0,0,0,0,0,-0x8000)};
-    
-    SimdInt _truthwin  {_mm_set_epi16(truth[7], truth[6], truth[5], truth[4],
-                                      truth[3], truth[2], truth[1], truth[0])};
-    SimdInt _targetwin  {_m1};
-    SimdInt _qualitieswin {_mm_set1_epi16(64 << 2)};
-    
-    SimdInt _snvmaskwin  {_mm_set_epi16(snv_mask[7], snv_mask[6], snv_mask[5], snv_mask[4],
-                                        snv_mask[3], snv_mask[2], snv_mask[1], snv_mask[0])};
-    SimdInt _snv_priorwin {_mm_set_epi16(snv_prior[7] << 2, snv_prior[6] << 2, snv_prior[5] << 2, snv_prior[4] << 2,
-                                         snv_prior[3] << 2, snv_prior[2] << 2, snv_prior[1] << 2, snv_prior[0] << 2)};
-    
-    SimdInt _snvmask;
-    
-    // if N, make nScore; if != N, make inf
-    SimdInt _truthnqual {_mm_add_epi16(_mm_and_si128(_mm_cmpeq_epi16(_truthwin, _mm_set1_epi16('N')),
-                                                     _mm_set1_epi16(nScore - inf)),
-                                       _mm_set1_epi16(inf))};
-    
-    SimdInt _gap_open {_mm_set_epi16(gap_open[7] << 2,gap_open[6] << 2,gap_open[5] << 2,gap_open[4] << 2,
-                                     gap_open[3] << 2,gap_open[2] << 2,gap_open[1] << 2,gap_open[0] << 2)};
-    
-    short minscore {inf};
-    
-    for (int s {0}; s <= 2 * (target_len + bandSize); s += 2) {
-        // truth is current; target needs updating
-        _targetwin    = _mm_slli_si128(_targetwin, 2);
-        _qualitieswin = _mm_slli_si128(_qualitieswin, 2);
-        
-        if (s / 2 < target_len) {
-            _targetwin    = _mm_insert_epi16(_targetwin, target[s / 2], 0);
-            _qualitieswin = _mm_insert_epi16(_qualitieswin, qualities[s / 2] << 2, 0);
-        } else {
-            _targetwin    = _mm_insert_epi16(_targetwin, '0', 0);
-            _qualitieswin = _mm_insert_epi16(_qualitieswin, 64 << 2, 0);
-        }
-        
-        // S even
-        
-        _m1 = _mm_or_si128(_initmask2, _mm_andnot_si128(_initmask, _m1));
-        _m2 = _mm_or_si128(_initmask2, _mm_andnot_si128(_initmask, _m2));
-        _m1 = _mm_min_epi16(_m1, _mm_min_epi16(_i1, _d1));
-        
-        if (s / 2 >= target_len) {
-            minscore = std::min(static_cast<short>(extract_epi16(_m1, s / 2 - target_len)), minscore);
-        }
-        
-        _snvmask = _mm_cmpeq_epi16(_targetwin, _snvmaskwin);
-        
-        _m1 = _mm_add_epi16(_m1, _mm_min_epi16(_mm_andnot_si128(_mm_cmpeq_epi16(_targetwin, _truthwin),
-                                                                 _mm_min_epi16(_qualitieswin,
-                                                                               _mm_or_si128(_mm_and_si128(_snvmask, _snv_priorwin),
-                                                                                            _mm_andnot_si128(_snvmask, _qualitieswin)))),
-                                               _truthnqual));
-        _d1 = _mm_min_epi16(_mm_add_epi16(_d2, _gap_extend),
-                            _mm_add_epi16(_mm_min_epi16(_m2, _i2),
-                                          _mm_srli_si128(_gap_open, 2))); // allow I->D
-        _d1 = _mm_insert_epi16(_mm_slli_si128(_d1, 2), inf, 0);
-        _i1 = _mm_add_epi16(_mm_min_epi16(_mm_add_epi16(_i2, _gap_extend),
-                                          _mm_add_epi16(_m2, _gap_open)),
-                            _nuc_prior);
-        
-        // S odd
-        // truth needs updating; target is current
-        const auto pos = bandSize + s / 2;
-        const char base {pos < truth_len ? truth[pos] : 'N'};
-        
-        _truthwin     = _mm_insert_epi16(_mm_srli_si128(_truthwin, 2),
-                                         base,
-                                         bandSize - 1);
-        _truthnqual   = _mm_insert_epi16(_mm_srli_si128(_truthnqual, 2),
-                                         base == 'N' ? nScore : inf,
-                                         bandSize - 1);
-        _snvmaskwin   = _mm_insert_epi16(_mm_srli_si128(_snvmaskwin, 2),
-                                         pos < truth_len ? snv_mask[pos] : 'N',
-                                         bandSize - 1);
-        _snv_priorwin = _mm_insert_epi16(_mm_srli_si128(_snv_priorwin, 2),
-                                         (pos < truth_len ? snv_prior[pos] : inf) << 2,
-                                         bandSize - 1);
-        _gap_open     = _mm_insert_epi16(_mm_srli_si128(_gap_open, 2),
-                                         gap_open[pos < truth_len ? pos : truth_len - 1] << 2,
-                                         bandSize - 1);
-        
-        _initmask  = _mm_slli_si128(_initmask, 2);
-        _initmask2 = _mm_slli_si128(_initmask2, 2);
-        
-        _m2 = _mm_min_epi16(_m2, _mm_min_epi16(_i2, _d2));
-        
-        if (s / 2 >= target_len) {
-            minscore = std::min(static_cast<short>(extract_epi16(_m2, s / 2 - target_len)), minscore);
-        }
-        
-        _snvmask = _mm_cmpeq_epi16(_targetwin, _snvmaskwin);
-        
-        _m2 = _mm_add_epi16(_m2, _mm_min_epi16(_mm_andnot_si128(_mm_cmpeq_epi16(_targetwin, _truthwin),
-                                                                _mm_min_epi16(_qualitieswin,
-                                                                              _mm_or_si128(_mm_and_si128(_snvmask, _snv_priorwin),
-                                                                                           _mm_andnot_si128(_snvmask, _qualitieswin)))),
-                                               _truthnqual));
-        _d2 = _mm_min_epi16(_mm_add_epi16(_d1, _gap_extend),
-                            _mm_add_epi16(_mm_min_epi16(_m1, _i1), _gap_open)); // allow I->D
-        _i2 = _mm_insert_epi16(_mm_add_epi16(_mm_min_epi16(_mm_add_epi16(_mm_srli_si128(_i1, 2),
-                                                                         _gap_extend),
-                                                           _mm_add_epi16(_mm_srli_si128(_m1, 2),
-                                                                         _gap_open)),
-                                             _nuc_prior), inf, bandSize - 1);
+constexpr std::size_t staticBackpointerCapacity {10000};
+
+template <typename T>
+using SmallVector = boost::container::small_vector<T, staticBackpointerCapacity>;
+
+constexpr short nScore {2 << 2};
+constexpr int bandSize {8};
+constexpr short inf {0x7800};
+constexpr char gap {'-'};
+
+auto extract_epi16(const __m128i a, const int imm) noexcept
+{
+    switch (imm) {
+        case 0:  return _mm_extract_epi16(a, 0);
+        case 1:  return _mm_extract_epi16(a, 1);
+        case 2:  return _mm_extract_epi16(a, 2);
+        case 3:  return _mm_extract_epi16(a, 3);
+        case 4:  return _mm_extract_epi16(a, 4);
+        case 5:  return _mm_extract_epi16(a, 5);
+        case 6:  return _mm_extract_epi16(a, 6);
+        default: return _mm_extract_epi16(a, 7);
     }
-    
-    return (minscore + 0x8000) >> 2;
 }
 
+namespace {
+
+struct SSE2Vector
+{
+    using Register = __m128i;
+    static constexpr int lanes {bandSize};
+    
+    static Register set1(const short x) noexcept { return _mm_set1_epi16(x); }
+    static Register first(const short x) noexcept { return _mm_set_epi16(0, 0, 0, 0, 0, 0, 0, x); }
+    static Register load(const short* values) noexcept { return _mm_load_si128(reinterpret_cast<const __m128i*>(values)); }
+    static short extract(const Register a, const int idx) noexcept { return extract_epi16(a, idx); }
+    static Register add(const Register a, const Register b) noexcept { return _mm_add_epi16(a, b); }
+    static Register min(const Register a, const Register b) noexcept { return _mm_min_epi16(a, b); }
+    static Register cmpeq(const Register a, const Register b) noexcept { return _mm_cmpeq_epi16(a, b); }
+    static Register bitwise_and(const Register a, const Register b) noexcept { return _mm_and_si128(a, b); }
+    static Register bitwise_andnot(const Register a, const Register b) noexcept { return _mm_andnot_si128(a, b); }
+    static Register bitwise_or(const Register a, const Register b) noexcept { return _mm_or_si128(a, b); }
+    static Register shift_up(const Register a) noexcept { return _mm_slli_si128(a, 2); }
+    static Register shift_down(const Register a) noexcept { return _mm_srli_si128(a, 2); }
+    static Register insert_first(const Register a, const short x) noexcept { return _mm_insert_epi16(a, x, 0); }
+    static Register insert_last(const Register a, const short x) noexcept { return _mm_insert_epi16(a, x, bandSize - 1); }
+};
+
+// Two independent 8 lane bands of bytes, one per 64-bit group
+struct SSE2ByteBatchVector
+{
+    using Register = __m128i;
+    static constexpr int batch_size {2};
+    
+    static Register set1(const std::uint8_t x) noexcept { return _mm_set1_epi8(static_cast<char>(x)); }
+    static Register set_groups(const std::uint64_t* groups) noexcept { return _mm_set_epi64x(groups[1], groups[0]); }
+    static Register load(const std::uint8_t* values) noexcept { return _mm_load_si128(reinterpret_cast<const __m128i*>(values)); }
+    static void store(const Register a, std::uint8_t* values) noexcept { _mm_store_si128(reinterpret_cast<__m128i*>(values), a); }
+    static Register saturating_add(const Register a, const Register b) noexcept { return _mm_adds_epu8(a, b); }
+    static Register min(const Register a, const Register b) noexcept { return _mm_min_epu8(a, b); }
+    static Register cmpeq(const Register a, const Register b) noexcept { return _mm_cmpeq_epi8(a, b); }
+    static Register bitwise_and(const Register a, const Register b) noexcept { return _mm_and_si128(a, b); }
+    static Register bitwise_andnot(const Register a, const Register b) noexcept { return _mm_andnot_si128(a, b); }
+    static Register bitwise_or(const Register a, const Register b) noexcept { return _mm_or_si128(a, b); }
+    static Register shift_up(const Register a) noexcept { return _mm_slli_epi64(a, 8); }
+    static Register shift_down(const Register a) noexcept { return _mm_srli_epi64(a, 8); }
+};
+
+} // namespace
+
+// The score only kernels differ in which inputs vary along the truth; see banded_pair_hmm.hpp
+
 int align(const char* truth, const char* target, const std::int8_t* qualities,
-          int truth_len, int target_len,
-          const char* snv_mask, const std::int8_t* snv_prior,
+          const int truth_len, const int target_len,
+          const short gap_open, const short gap_extend, const short nuc_prior) noexcept
+{
+    return banded_align<SSE2Vector>(truth, target, qualities, truth_len, target_len,
+                                    QualityMismatch<SSE2Vector> {},
+                                    ConstantPenalty<SSE2Vector> {gap_open},
+                                    ConstantPenalty<SSE2Vector> {gap_extend},
+                                    nuc_prior);
+}
+
+int align(const char* truth, const char* target, const std::int8_t* qualities,
+          const int truth_len, const int target_len,
+          const std::int8_t* gap_open, const short gap_extend, const short nuc_prior) noexcept
+{
+    return banded_align<SSE2Vector>(truth, target, qualities, truth_len, target_len,
+                                    QualityMismatch<SSE2Vector> {},
+                                    PerBasePenalty<SSE2Vector> {gap_open, truth_len},
+                                    ConstantPenalty<SSE2Vector> {gap_extend},
+                                    nuc_prior);
+}
+
+int align(const char* truth, const char* target, const std::int8_t* qualities,
+          const int truth_len, const int target_len,
+          const std::int8_t* gap_open, const std::int8_t* gap_extend,
+          const short nuc_prior) noexcept
+{
+    return banded_align<SSE2Vector>(truth, target, qualities, truth_len, target_len,
+                                    QualityMismatch<SSE2Vector> {},
+                                    PerBasePenalty<SSE2Vector> {gap_open, truth_len},
+                                    PerBasePenalty<SSE2Vector> {gap_extend, truth_len},
+                                    nuc_prior);
+}
+
+int align(const char* truth, const char* target, const std::int8_t* qualities,
+          const int truth_len, const int target_len,
           const std::int8_t* gap_open, const std::int8_t* gap_extend,
-          short nuc_prior) noexcept
+          short nuc_prior,
+          int& first_pos, char* aln1, char* aln2) noexcept
 {
+    using SimdInt = __m128i;
+    
     assert(truth_len > bandSize && (truth_len == target_len + 2 * bandSize - 1));
     
-    nuc_prior <<= 2;
+    constexpr int matchLabel  {0};
+    constexpr int insertLabel {1};
+    constexpr int deleteLabel {3};
+    static const SimdInt _three {_mm_set1_epi16(3)};
     
-    using SimdInt = __m128i;
+    nuc_prior <<= 2;
     
     SimdInt _m1 {_mm_set1_epi16(inf)};
     auto _i1 = _m1;
@@ -768,21 +183,17 @@ int align(const char* truth, const char* target, const std::int8_t* qualities,
     auto _d2 = _m1;
     
     SimdInt _nuc_prior  {_mm_set1_epi16(nuc_prior)};
+    
     SimdInt _initmask   {_mm_set_epi16(0,0,0,0,0,0,0,-1)};
     SimdInt _initmask2  {_mm_set_epi16(0,0,0,0,0,0,0,-0x8000)};
     
+    // truth is initialized with the n-long prefix, in forward direction
+    // target is initialized as empty; reverse direction
     SimdInt _truthwin  {_mm_set_epi16(truth[7], truth[6], truth[5], truth[4],
                                       truth[3], truth[2], truth[1], truth[0])};
     SimdInt _targetwin  {_m1};
     SimdInt _qualitieswin {_mm_set1_epi16(64 << 2)};
     
-    SimdInt _snvmaskwin  {_mm_set_epi16(snv_mask[7], snv_mask[6], snv_mask[5], snv_mask[4],
-                                        snv_mask[3], snv_mask[2], snv_mask[1], snv_mask[0])};
-    SimdInt _snv_priorwin {_mm_set_epi16(snv_prior[7] << 2, snv_prior[6] << 2, snv_prior[5] << 2, snv_prior[4] << 2,
-                                         snv_prior[3] << 2, snv_prior[2] << 2, snv_prior[1] << 2, snv_prior[0] << 2)};
-    
-    SimdInt _snvmask;
-    
     // if N, make nScore; if != N, make inf
     SimdInt _truthnqual {_mm_add_epi16(_mm_and_si128(_mm_cmpeq_epi16(_truthwin, _mm_set1_epi16('N')),
                                                      _mm_set1_epi16(nScore - inf)),
@@ -793,9 +204,12 @@ int align(const char* truth, const char* target, const std::int8_t* qualities,
     SimdInt _gap_extend {_mm_set_epi16(gap_extend[7] << 2,gap_extend[6] << 2,gap_extend[5] << 2,gap_extend[4] << 2,
                                        gap_extend[3] << 2,gap_extend[2] << 2,gap_extend[1] << 2,gap_extend[0] << 2)};
     
-    short minscore {inf};
+    SmallVector<SimdInt> _backpointers(2 * (truth_len + bandSize));
+    
+    short cur_score {0}, minscore {inf}, minscoreidx {-1};
     
-    for (int s {0}; s <= 2 * (target_len + bandSize); s += 2) {
+    int s {0};
+    for (; s <= 2 * (target_len + bandSize); s += 2) {
         // truth is current; target needs updating
         _targetwin    = _mm_slli_si128(_targetwin, 2);
         _qualitieswin = _mm_slli_si128(_qualitieswin, 2);
@@ -809,22 +223,20 @@ int align(const char* truth, const char* target, const std::int8_t* qualities,
         }
         
         // S even
-        
         _m1 = _mm_or_si128(_initmask2, _mm_andnot_si128(_initmask, _m1));
         _m2 = _mm_or_si128(_initmask2, _mm_andnot_si128(_initmask, _m2));
         _m1 = _mm_min_epi16(_m1, _mm_min_epi16(_i1, _d1));
         
         if (s / 2 >= target_len) {
-            minscore = std::min(static_cast<short>(extract_epi16(_m1, s / 2 - target_len)), minscore);
+            cur_score = extract_epi16(_m1, s / 2 - target_len);
+            if (cur_score < minscore) {
+                minscore = cur_score;
+                minscoreidx = s;     // point back to the match state at this entry, so as not to
+            }                        // have to store the state at s-2
         }
         
-        _snvmask = _mm_cmpeq_epi16(_targetwin, _snvmaskwin);
-        
         _m1 = _mm_add_epi16(_m1, _mm_min_epi16(_mm_andnot_si128(_mm_cmpeq_epi16(_targetwin, _truthwin),
-                                                                _mm_min_epi16(_qualitieswin,
-                                                                              _mm_or_si128(_mm_and_si128(_snvmask, _snv_priorwin),
-                                                                                           _mm_andnot_si128(_snvmask, _qualitieswin)))),
-                                               _truthnqual));
+                                                                _qualitieswin), _truthnqual));
         _d1 = _mm_min_epi16(_mm_add_epi16(_d2, _gap_extend),
                             _mm_add_epi16(_mm_min_epi16(_m2, _i2),
                                           _mm_srli_si128(_gap_open, 2))); // allow I->D
@@ -832,26 +244,23 @@ int align(const char* truth, const char* target, const std::int8_t* qualities,
         _i1 = _mm_add_epi16(_mm_min_epi16(_mm_add_epi16(_i2, _gap_extend),
                                           _mm_add_epi16(_m2, _gap_open)),
                             _nuc_prior);
+    
+        _backpointers[s] = _mm_or_si128(_mm_or_si128(_mm_and_si128(_three, _m1),
+                                                     _mm_slli_epi16(_mm_and_si128(_three, _i1),
+                                                                    2 * insertLabel)),
+                                        _mm_slli_epi16(_mm_and_si128(_three, _d1), 2 * deleteLabel));
+        // set state labels
+        _m1 = _mm_andnot_si128(_three, _m1);
+        _i1 = _mm_or_si128(_mm_andnot_si128(_three, _i1), _mm_srli_epi16(_three, 1));
+        _d1 = _mm_or_si128(_mm_andnot_si128(_three, _d1), _three);
         
-        // S odd
-        // truth needs updating; target is current
+        // S odd; truth needs updating; target is current
         const auto pos = bandSize + s / 2;
-        const char base {pos < truth_len ? truth[pos] : 'N'};
-        
-        _truthwin     = _mm_insert_epi16(_mm_srli_si128(_truthwin, 2),
-                                         base,
-                                         bandSize - 1);
-        _truthnqual   = _mm_insert_epi16(_mm_srli_si128(_truthnqual, 2),
-                                         base == 'N' ? nScore : inf,
-                                         bandSize - 1);
-        _snvmaskwin   = _mm_insert_epi16(_mm_srli_si128(_snvmaskwin, 2),
-                                         pos < truth_len ? snv_mask[pos] : 'N',
-                                         bandSize - 1);
-        _snv_priorwin = _mm_insert_epi16(_mm_srli_si128(_snv_priorwin, 2),
-                                         (pos < truth_len ? snv_prior[pos] : inf) << 2,
-                                         bandSize - 1);
+        const char base {(pos < truth_len) ? truth[pos] : 'N'};
+        _truthwin   = _mm_insert_epi16(_mm_srli_si128(_truthwin, 2), base, bandSize - 1);
+        _truthnqual = _mm_insert_epi16(_mm_srli_si128(_truthnqual, 2), base == 'N' ? nScore : inf, bandSize - 1);
         const auto gap_idx = pos < truth_len ? pos : truth_len - 1;
-        _gap_open     = _mm_insert_epi16(_mm_srli_si128(_gap_open, 2), gap_open[gap_idx] << 2, bandSize - 1);
+        _gap_open   = _mm_insert_epi16(_mm_srli_si128(_gap_open, 2), gap_open[gap_idx] << 2, bandSize - 1);
         _gap_extend = _mm_insert_epi16(_mm_srli_si128(_gap_extend, 2), gap_extend[gap_idx] << 2, bandSize - 1);
         
         _initmask  = _mm_slli_si128(_initmask, 2);
@@ -860,16 +269,15 @@ int align(const char* truth, const char* target, const std::int8_t* qualities,
         _m2 = _mm_min_epi16(_m2, _mm_min_epi16(_i2, _d2));
         
         if (s / 2 >= target_len) {
-            minscore = std::min(static_cast<short>(extract_epi16(_m2, s / 2 - target_len)), minscore);
+            cur_score = extract_epi16(_m2, s / 2 - target_len);
+            if (cur_score < minscore) {
+                minscore = cur_score;
+                minscoreidx = s + 1;
+            }
         }
         
-        _snvmask = _mm_cmpeq_epi16(_targetwin, _snvmaskwin);
-        
         _m2 = _mm_add_epi16(_m2, _mm_min_epi16(_mm_andnot_si128(_mm_cmpeq_epi16(_targetwin, _truthwin),
-                                                                _mm_min_epi16(_qualitieswin,
-                                                                              _mm_or_si128(_mm_and_si128(_snvmask, _snv_priorwin),
-                                                                                           _mm_andnot_si128(_snvmask, _qualitieswin)))),
-                                               _truthnqual));
+                                                                _qualitieswin), _truthnqual));
         _d2 = _mm_min_epi16(_mm_add_epi16(_d1, _gap_extend),
                             _mm_add_epi16(_mm_min_epi16(_m1, _i1), _gap_open)); // allow I->D
         _i2 = _mm_insert_epi16(_mm_add_epi16(_mm_min_epi16(_mm_add_epi16(_mm_srli_si128(_i1, 2),
@@ -877,11 +285,105 @@ int align(const char* truth, const char* target, const std::int8_t* qualities,
                                                            _mm_add_epi16(_mm_srli_si128(_m1, 2),
                                                                          _gap_open)),
                                              _nuc_prior), inf, bandSize - 1);
+        
+        _backpointers[s + 1] = _mm_or_si128(_mm_or_si128(_mm_and_si128(_three, _m2),
+                                                         _mm_slli_epi16(_mm_and_si128(_three, _i2), 2 * insertLabel)),
+                                            _mm_slli_epi16(_mm_and_si128(_three, _d2), 2 * deleteLabel));
+        // set state labels
+        _m2 = _mm_andnot_si128(_three, _m2);
+        _i2 = _mm_or_si128(_mm_andnot_si128(_three, _i2), _mm_srli_epi16(_three, 1));
+        _d2 = _mm_or_si128(_mm_andnot_si128(_three, _d2), _three);
+    }
+    
+    if (minscoreidx < 0) {
+        // minscore was never updated so we must have overflowed badly
+        first_pos = -1;
+        return -1;
+    }
+    
+    s = minscoreidx;    // point to the dummy match transition
+    
+    auto i      = s / 2 - target_len;
+    auto y      = target_len;
+    auto x      = s - y;
+    auto alnidx = 0;
+    
+    auto ptr = reinterpret_cast<short*>(_backpointers.data() + s);
+    if ((ptr + i) < reinterpret_cast<short*>(_backpointers.data())
+        || (ptr + i) >= reinterpret_cast<short*>(_backpointers.data() + _backpointers.size())) {
+        first_pos = -1;
+        return -1;
     }
+    auto state = (ptr[i] >> (2 * matchLabel)) & 3;
+    
+    s -= 2;
     
+    // this is 2*y (s even) or 2*y+1 (s odd)
+    while (y > 0) {
+        if (s < 0 || i < 0) {
+            // This should never happen so must have overflowed
+            first_pos = -1;
+            return -1;
+        }
+        const auto new_state = (reinterpret_cast<short*>(_backpointers.data() + s)[i] >> (2 * state)) & 3;
+        if (state == matchLabel) {
+            s -= 2;
+            aln1[alnidx] = truth[--x];
+            aln2[alnidx] = target[--y];
+        } else if (state == insertLabel) {
+            i += s & 1;
+            s -= 1;
+            aln1[alnidx] = gap;
+            aln2[alnidx] = target[--y];
+        } else {
+            s -= 1;
+            i -= s & 1;
+            aln1[alnidx] = truth[--x];
+            aln2[alnidx] = gap;
+        }
+        state = new_state;
+        alnidx++;
+    }
+    aln1[alnidx] = 0;
+    aln2[alnidx] = 0;
+    first_pos = x;
+    // reverse them
+    for (int j {alnidx - 1}, i = 0; i < j; ++i, j--) {
+        x = aln1[i];
+        y = aln2[i];
+        aln1[i] = aln1[j];
+        aln2[i] = aln2[j];
+        aln1[j] = x;
+        aln2[j] = y;
+    }
     return (minscore + 0x8000) >> 2;
 }
 
+int align(const char* truth, const char* target, const std::int8_t* qualities,
+          const int truth_len, const int target_len,
+          const char* snv_mask, const std::int8_t* snv_prior,
+          const std::int8_t* gap_open, const short gap_extend, const short nuc_prior) noexcept
+{
+    return banded_align<SSE2Vector>(truth, target, qualities, truth_len, target_len,
+                                    SnvPriorMismatch<SSE2Vector> {snv_mask, snv_prior, truth_len},
+                                    PerBasePenalty<SSE2Vector> {gap_open, truth_len},
+                                    ConstantPenalty<SSE2Vector> {gap_extend},
+                                    nuc_prior);
+}
+
+int align(const char* truth, const char* target, const std::int8_t* qualities,
+          const int truth_len, const int target_len,
+          const char* snv_mask, const std::int8_t* snv_prior,
+          const std::int8_t* gap_open, const std::int8_t* gap_extend,
+          const short nuc_prior) noexcept
+{
+    return banded_align<SSE2Vector>(truth, target, qualities, truth_len, target_len,
+                                    SnvPriorMismatch<SSE2Vector> {snv_mask, snv_prior, truth_len},
+                                    PerBasePenalty<SSE2Vector> {gap_open, truth_len},
+                                    PerBasePenalty<SSE2Vector> {gap_extend, truth_len},
+                                    nuc_prior);
+}
+
 int align(const char* truth, const char* target, const std::int8_t* qualities,
           const int truth_len, const int target_len,
           const std::int8_t* gap_open, short gap_extend, short nuc_prior,
@@ -1757,6 +1259,146 @@ int calculate_flank_score(const int truth_len, const int lhs_flank_len, const in
     return result;
 }
 
+namespace {
+
+using BandedAligner = int(*)(const char*, const char*, const std::int8_t*, int, int,
+                             const char*, const std::int8_t*, const std::int8_t*, const std::int8_t*,
+                             short);
+
+InstructionSet detect_instruction_set() noexcept
+{
+#if defined(__aarch64__)
+    return InstructionSet::neon;
+#else
+#if defined(__GNUC__) && defined(OCTOPUS_AVX_KERNELS)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw")) return InstructionSet::avx512;
+    if (__builtin_cpu_supports("avx2")) return InstructionSet::avx2;
+#endif
+    return InstructionSet::sse2;
+#endif
+}
+
+BandedAligner select_banded_aligner(const int band_size) noexcept
+{
+    switch (band_size) {
+        case avx2::band_size():
+#ifdef OCTOPUS_AVX_KERNELS
+            if (get_instruction_set() == InstructionSet::avx2 || get_instruction_set() == InstructionSet::avx512) return avx2::align;
+#endif
+            return banded_align<PortableVector<avx2::band_size()>>;
+        case avx512::band_size():
+#ifdef OCTOPUS_AVX_KERNELS
+            if (get_instruction_set() == InstructionSet::avx512) return avx512::align;
+#endif
+            return banded_align<PortableVector<avx512::band_size()>>;
+        default:
+            return align;
+    }
+}
+
+} // namespace
+
+InstructionSet get_instruction_set() noexcept
+{
+    static const InstructionSet result {detect_instruction_set()};
+    return result;
+}
+
+bool is_supported_band_size(const int band_size) noexcept
+{
+    return band_size == bandSize || band_size == avx2::band_size() || band_size == avx512::band_size();
+}
+
+namespace {
+
+int align_one(const BandedAlignment& alignment) noexcept
+{
+    return align(alignment.truth, alignment.target, alignment.qualities,
+                 alignment.target_len + 2 * bandSize - 1, alignment.target_len,
+                 alignment.snv_mask, alignment.snv_prior,
+                 alignment.gap_open, alignment.gap_extend,
+                 alignment.nuc_prior);
+}
+
+// Scores batch_size() alignments at a time when the host supports AVX2 or AVX-512
+void align_int16(const BandedAlignment* alignments, const int num_alignments, int* scores) noexcept
+{
+    int i {0};
+#ifdef OCTOPUS_AVX_KERNELS
+    const auto isa = get_instruction_set();
+    int batch_size {1};
+    if (isa == InstructionSet::avx512) {
+        batch_size = avx512::batch_size();
+    } else if (isa == InstructionSet::avx2) {
+        batch_size = avx2::batch_size();
+    }
+    if (batch_size > 1) {
+        for (; i + batch_size <= num_alignments; i += batch_size) {
+            if (isa == InstructionSet::avx512) {
+                avx512::align(alignments + i, scores + i);
+            } else {
+                avx2::align(alignments + i, scores + i);
+            }
+        }
+    }
+#endif
+    for (; i < num_alignments; ++i) {
+        scores[i] = align_one(alignments[i]);
+    }
+}
+
+} // namespace
+
+TierCounts align(const BandedAlignment* alignments, const int num_alignments, int* scores) noexcept
+{
+    auto byte_aligner = batched_banded_align_u8<SSE2ByteBatchVector>;
+    int byte_batch_size {SSE2ByteBatchVector::batch_size};
+#ifdef OCTOPUS_AVX_KERNELS
+    const auto isa = get_instruction_set();
+    if (isa == InstructionSet::avx512) {
+        byte_aligner = avx512::align_u8;
+        byte_batch_size = avx512::byte_batch_size();
+    } else if (isa == InstructionSet::avx2) {
+        byte_aligner = avx2::align_u8;
+        byte_batch_size = avx2::byte_batch_size();
+    }
+#endif
+    TierCounts result {0, 0, 0};
+    int i {0};
+    for (; i + byte_batch_size <= num_alignments; i += byte_batch_size) {
+        byte_aligner(alignments + i, scores + i);
+    }
+    result.int8 = i;
+    // Saturation should be rare, so rescore one at a time
+    for (int j {0}; j < i; ++j) {
+        if (scores[j] == saturated_score) {
+            scores[j] = align_one(alignments[j]);
+            ++result.int8_saturated;
+        }
+    }
+    align_int16(alignments + i, num_alignments - i, scores + i);
+    result.int16 = result.int8_saturated + num_alignments - i;
+    return result;
+}
+
+int align(const int band_size,
+          const char* truth, const char* target, const std::int8_t* qualities,
+          const int truth_len, const int target_len,
+          const char* snv_mask, const std::int8_t* snv_prior,
+          const std::int8_t* gap_open, const std::int8_t* gap_extend,
+          const short nuc_prior) noexcept
+{
+    assert(is_supported_band_size(band_size));
+    static const BandedAligner aligners[] {
+        select_banded_aligner(bandSize),
+        select_banded_aligner(avx2::band_size()),
+        select_banded_aligner(avx512::band_size())
+    };
+    const auto aligner = aligners[band_size == bandSize ? 0 : (band_size == avx2::band_size() ? 1 : 2)];
+    return aligner(truth, target, qualities, truth_len, target_len, snv_mask, snv_prior, gap_open, gap_extend, nuc_prior);
+}
+
 } // namespace simd
 } // namespace hmm
 } // namespace octopus
@@ -10,6 +10,51 @@ namespace octopus { namespace hmm { namespace simd {
 
 constexpr int min_flank_pad() noexcept { return 8; }
 
+enum class InstructionSet { sse2, avx2, avx512, neon };
+
+// The widest instruction set supported by the host CPU. This is detected once and cached. The
+// 128-bit kernels are written with SSE2 intrinsics, which are implemented with NEON on AArch64.
+InstructionSet get_instruction_set() noexcept;
+
+bool is_supported_band_size(int band_size) noexcept;
+
+// The kernel used for a given band size is selected at runtime according to get_instruction_set.
+// Bands that are wider than the host supports natively fall back to a portable implementation, so
+// results only depend on the band size, not the host.
+//
+// Requires truth_len == target_len + 2 * band_size - 1.
+struct BandedAlignment
+{
+    const char* truth; // truth length must be target_len + 2 * min_flank_pad() - 1
+    const char* target;
+    const std::int8_t* qualities;
+    int target_len;
+    const char* snv_mask;
+    const std::int8_t* snv_prior;
+    const std::int8_t* gap_open;
+    const std::int8_t* gap_extend;
+    short nuc_prior;
+};
+
+// The number of alignments scored by each precision tier of the batched align
+struct TierCounts
+{
+    int int8, int8_saturated, int16;
+};
+
+// Equivalent to the score only align overload for each alignment, but packs several alignments
+// into each SIMD register. Alignments are first scored in 8 bit lanes, which fit twice as many per
+// register, and any whose score does not fit in 8 bits are rescored in 16 bit lanes. Alignments
+// should be ordered by target length, as alignments packed together take as long as the longest target.
+TierCounts align(const BandedAlignment* alignments, int num_alignments, int* scores) noexcept;
+
+int align(int band_size,
+          const char* truth, const char* target, const std::int8_t* qualities,
+          int truth_len, int target_len,
+          const char* snv_mask, const std::int8_t* snv_prior,
+          const std::int8_t* gap_open, const std::int8_t* gap_extend,
+          short nuc_prior) noexcept;
+
 int align(const char* truth, const char* target, const std::int8_t* qualities,
           int truth_len, int target_len,
           short gap_open, short gap_extend, short nuc_prior) noexcept;
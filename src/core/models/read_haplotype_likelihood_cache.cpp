@@ -0,0 +1,184 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "read_haplotype_likelihood_cache.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+
+#include <boost/functional/hash.hpp>
+
+namespace octopus {
+
+boost::optional<ReadHaplotypeLikelihoodCache::LogProbability>
+ReadHaplotypeLikelihoodCache::Entry::find(const ReadId read) const noexcept
+{
+    const auto itr = std::lower_bound(std::cbegin(likelihoods), std::cend(likelihoods), read,
+                                      [] (const auto& p, const ReadId id) { return p.first < id; });
+    if (itr != std::cend(likelihoods) && itr->first == read) {
+        return itr->second;
+    } else {
+        return boost::none;
+    }
+}
+
+void ReadHaplotypeLikelihoodCache::Entry::insert(std::vector<std::pair<ReadId, LogProbability>>& new_likelihoods)
+{
+    const auto by_id = [] (const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; };
+    std::sort(std::begin(new_likelihoods), std::end(new_likelihoods), by_id);
+    const auto num_old = likelihoods.size();
+    likelihoods.insert(std::cend(likelihoods), std::cbegin(new_likelihoods), std::cend(new_likelihoods));
+    std::inplace_merge(std::begin(likelihoods), std::next(std::begin(likelihoods), num_old), std::end(likelihoods), by_id);
+}
+
+ReadHaplotypeLikelihoodCache::ReadHaplotypeLikelihoodCache(const std::size_t max_likelihoods)
+: max_likelihoods_ {max_likelihoods}
+, num_likelihoods_ {0}
+, read_ids_ {}
+, entries_ {}
+, entry_index_ {}
+, hits_ {0}
+, misses_ {0}
+, mutex_ {}
+{}
+
+std::size_t ReadHaplotypeLikelihoodCache::max_likelihoods() const noexcept
+{
+    return max_likelihoods_;
+}
+
+namespace {
+
+std::size_t likelihood_hash(const AlignedRead& read)
+{
+    using boost::hash_combine;
+    std::size_t result {};
+    hash_combine(result, std::hash<AlignedRead::NucleotideSequence>()(read.sequence()));
+    hash_combine(result, boost::hash_range(std::cbegin(read.base_qualities()), std::cend(read.base_qualities())));
+    hash_combine(result, mapped_begin(read));
+    hash_combine(result, read.mapping_quality());
+    hash_combine(result, read.is_marked_reverse_mapped());
+    return result;
+}
+
+} // namespace
+
+ReadHaplotypeLikelihoodCache::ReadId
+ReadHaplotypeLikelihoodCache::read_id(const std::size_t sample, const AlignedRead& read)
+{
+    ReadKey key {sample, read.name(), likelihood_hash(read)};
+    std::lock_guard<std::mutex> lock {mutex_};
+    if (read_ids_.size() == std::numeric_limits<ReadId>::max()) {
+        throw std::runtime_error {"ReadHaplotypeLikelihoodCache: too many reads"};
+    }
+    return read_ids_.emplace(std::move(key), static_cast<ReadId>(read_ids_.size())).first->second;
+}
+
+boost::optional<ReadHaplotypeLikelihoodCache::Entry>
+ReadHaplotypeLikelihoodCache::take(const Haplotype& haplotype, const boost::optional<FlankState>& flank_state)
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    const auto index_itr = entry_index_.find(EntryKey {haplotype, flank_state});
+    if (index_itr == std::cend(entry_index_)) return boost::none;
+    const auto entry_itr = index_itr->second;
+    entry_index_.erase(index_itr);
+    Entry result {std::move(*entry_itr)};
+    entries_.erase(entry_itr);
+    num_likelihoods_ -= result.likelihoods.size();
+    return result;
+}
+
+void ReadHaplotypeLikelihoodCache::put(Entry entry)
+{
+    if (entry.likelihoods.size() > max_likelihoods_) return;
+    std::lock_guard<std::mutex> lock {mutex_};
+    const auto index_itr = entry_index_.find(EntryKey {entry.haplotype, entry.flank_state});
+    if (index_itr != std::cend(entry_index_)) {
+        const auto entry_itr = index_itr->second;
+        entry_index_.erase(index_itr);
+        num_likelihoods_ -= entry_itr->likelihoods.size();
+        entries_.erase(entry_itr);
+    }
+    num_likelihoods_ += entry.likelihoods.size();
+    entries_.push_front(std::move(entry));
+    const auto& front = entries_.front();
+    entry_index_.emplace(EntryKey {front.haplotype, front.flank_state}, std::begin(entries_));
+    evict();
+}
+
+void ReadHaplotypeLikelihoodCache::clear()
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    entry_index_.clear();
+    entries_.clear();
+    read_ids_.clear();
+    num_likelihoods_ = 0;
+}
+
+void ReadHaplotypeLikelihoodCache::record(const std::size_t hits, const std::size_t misses) noexcept
+{
+    hits_ += hits;
+    misses_ += misses;
+}
+
+std::size_t ReadHaplotypeLikelihoodCache::hits() const noexcept
+{
+    return hits_;
+}
+
+std::size_t ReadHaplotypeLikelihoodCache::misses() const noexcept
+{
+    return misses_;
+}
+
+// private methods
+
+std::size_t ReadHaplotypeLikelihoodCache::ReadKeyHash::operator()(const ReadKey& key) const noexcept
+{
+    using boost::hash_combine;
+    std::size_t result {};
+    hash_combine(result, key.sample);
+    hash_combine(result, std::hash<std::string>()(key.name));
+    hash_combine(result, key.likelihood_hash);
+    return result;
+}
+
+bool ReadHaplotypeLikelihoodCache::ReadKeyEqual::operator()(const ReadKey& lhs, const ReadKey& rhs) const noexcept
+{
+    return lhs.sample == rhs.sample && lhs.likelihood_hash == rhs.likelihood_hash && lhs.name == rhs.name;
+}
+
+std::size_t ReadHaplotypeLikelihoodCache::EntryKeyHash::operator()(const EntryKey& key) const noexcept
+{
+    using boost::hash_combine;
+    std::size_t result {};
+    hash_combine(result, HaplotypeHash()(key.first));
+    if (key.second) {
+        hash_combine(result, key.second->lhs_flank);
+        hash_combine(result, key.second->rhs_flank);
+    }
+    return result;
+}
+
+bool ReadHaplotypeLikelihoodCache::EntryKeyEqual::operator()(const EntryKey& lhs, const EntryKey& rhs) const noexcept
+{
+    if (static_cast<bool>(lhs.second) != static_cast<bool>(rhs.second)) return false;
+    if (lhs.second && (lhs.second->lhs_flank != rhs.second->lhs_flank || lhs.second->rhs_flank != rhs.second->rhs_flank)) {
+        return false;
+    }
+    return lhs.first.get() == rhs.first.get();
+}
+
+void ReadHaplotypeLikelihoodCache::evict()
+{
+    while (num_likelihoods_ > max_likelihoods_ && !entries_.empty()) {
+        const auto& back = entries_.back();
+        entry_index_.erase(EntryKey {back.haplotype, back.flank_state});
+        num_likelihoods_ -= back.likelihoods.size();
+        entries_.pop_back();
+    }
+}
+
+} // namespace octopus
@@ -0,0 +1,119 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef read_haplotype_likelihood_cache_hpp
+#define read_haplotype_likelihood_cache_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <functional>
+#include <mutex>
+#include <atomic>
+#include <string>
+
+#include <boost/optional.hpp>
+
+#include "basics/aligned_read.hpp"
+#include "core/types/haplotype.hpp"
+#include "haplotype_likelihood_model.hpp"
+
+namespace octopus {
+
+/*
+    ReadHaplotypeLikelihoodCache remembers the read likelihoods computed for each haplotype
+    so that haplotypes which survive between consecutive active regions (e.g. lagging or
+    backtracking) are not re-evaluated against the same reads.
+
+    Reads are identified by sample, name, and a hash of everything the likelihood depends on,
+    so distinct copies of the same read are recognised. Haplotype entries are evicted in least
+    recently used order once the total number of cached likelihoods exceeds the capacity.
+
+    All methods are thread safe. An Entry is removed from the cache while it is in use.
+ */
+class ReadHaplotypeLikelihoodCache
+{
+public:
+    using ReadId         = std::uint32_t;
+    using LogProbability = HaplotypeLikelihoodModel::LogProbability;
+    using FlankState     = HaplotypeLikelihoodModel::FlankState;
+
+    struct Entry
+    {
+        Haplotype haplotype;
+        boost::optional<FlankState> flank_state;
+        std::vector<std::pair<ReadId, LogProbability>> likelihoods; // sorted by ReadId
+
+        boost::optional<LogProbability> find(ReadId read) const noexcept;
+        void insert(std::vector<std::pair<ReadId, LogProbability>>& likelihoods);
+    };
+
+    ReadHaplotypeLikelihoodCache() = delete;
+
+    ReadHaplotypeLikelihoodCache(std::size_t max_likelihoods);
+
+    ReadHaplotypeLikelihoodCache(const ReadHaplotypeLikelihoodCache&)            = delete;
+    ReadHaplotypeLikelihoodCache& operator=(const ReadHaplotypeLikelihoodCache&) = delete;
+    ReadHaplotypeLikelihoodCache(ReadHaplotypeLikelihoodCache&&)                 = delete;
+    ReadHaplotypeLikelihoodCache& operator=(ReadHaplotypeLikelihoodCache&&)      = delete;
+
+    ~ReadHaplotypeLikelihoodCache() = default;
+
+    std::size_t max_likelihoods() const noexcept;
+
+    ReadId read_id(std::size_t sample, const AlignedRead& read);
+
+    // Removes the entry for haplotype (if any), the caller should put it back when finished.
+    boost::optional<Entry> take(const Haplotype& haplotype, const boost::optional<FlankState>& flank_state);
+    void put(Entry entry);
+
+    void clear();
+
+    void record(std::size_t hits, std::size_t misses) noexcept;
+    std::size_t hits() const noexcept;
+    std::size_t misses() const noexcept;
+
+private:
+    struct ReadKey
+    {
+        std::size_t sample;
+        std::string name;
+        std::size_t likelihood_hash;
+    };
+    struct ReadKeyHash
+    {
+        std::size_t operator()(const ReadKey& key) const noexcept;
+    };
+    struct ReadKeyEqual
+    {
+        bool operator()(const ReadKey& lhs, const ReadKey& rhs) const noexcept;
+    };
+
+    using EntryKey = std::pair<std::reference_wrapper<const Haplotype>, boost::optional<FlankState>>;
+    struct EntryKeyHash
+    {
+        std::size_t operator()(const EntryKey& key) const noexcept;
+    };
+    struct EntryKeyEqual
+    {
+        bool operator()(const EntryKey& lhs, const EntryKey& rhs) const noexcept;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    std::size_t max_likelihoods_, num_likelihoods_;
+    std::unordered_map<ReadKey, ReadId, ReadKeyHash, ReadKeyEqual> read_ids_;
+    EntryList entries_; // most recently used first
+    std::unordered_map<EntryKey, EntryList::iterator, EntryKeyHash, EntryKeyEqual> entry_index_;
+    std::atomic<std::size_t> hits_, misses_;
+    mutable std::mutex mutex_;
+
+    void evict();
+};
+
+} // namespace octopus
+
+#endif
@@ -4,10 +4,12 @@
 #include "octopus.hpp"
 
 #include <vector>
+#include <array>
 #include <deque>
 #include <queue>
 #include <map>
 #include <set>
+#include <unordered_set>
 #include <algorithm>
 #include <numeric>
 #include <memory>
@@ -20,11 +22,14 @@
 #include <mutex>
 #include <atomic>
 #include <chrono>
+#include <cmath>
 #include <sstream>
 #include <iostream>
 #include <cassert>
 
 #include <boost/optional.hpp>
+#include <boost/lockfree/spsc_queue.hpp>
+#include <boost/filesystem/operations.hpp>
 
 #include "config/common.hpp"
 #include "basics/genomic_region.hpp"
@@ -44,11 +49,19 @@
 #include "core/callers/caller.hpp"
 #include "utils/maths.hpp"
 #include "logging/progress_meter.hpp"
+#include "logging/live_metrics.hpp"
 #include "logging/logging.hpp"
 #include "logging/error_handler.hpp"
 #include "core/tools/vcf_header_factory.hpp"
 #include "io/variant/vcf.hpp"
 #include "utils/timing.hpp"
+#include "utils/thread_pool.hpp"
+#include "utils/system_utils.hpp"
+#include "utils/memory_footprint.hpp"
+#include "utils/input_reads_profiler.hpp"
+#include "utils/tandem_repeat_index.hpp"
+#include "utils/stage_profiler.hpp"
+#include "exceptions/user_error.hpp"
 #include "exceptions/program_error.hpp"
 #include "exceptions/system_error.hpp"
 #include "csr/filters/variant_call_filter.hpp"
@@ -56,8 +69,7 @@
 #include "readpipe/buffered_read_pipe.hpp"
 #include "core/tools/bam_realigner.hpp"
 #include "core/tools/indel_profiler.hpp"
-
-#include "timers.hpp" // BENCHMARK
+#include "core/tools/shard_manifest.hpp"
 
 namespace octopus {
 
@@ -277,6 +289,7 @@ void write_calls(std::deque<VcfRecord>&& calls, VcfWriter& out)
     if (calls.empty()) return;
     static auto debug_log = get_debug_log();
     if (debug_log) stream(*debug_log) << "Writing " << calls.size() << " calls to output";
+    profiling::StageTimer timer {profiling::Stage::output};
     const bool was_closed {!out.is_open()};
     if (was_closed) out.open();
     write(calls, out);
@@ -285,6 +298,57 @@ void write_calls(std::deque<VcfRecord>&& calls, VcfWriter& out)
     calls.shrink_to_fit();
 }
 
+// Calls rarely connect across a boundary this far from any variation evidence or tandem repeat
+constexpr GenomicRegion::Size quietBoundaryMargin {100};
+constexpr GenomicRegion::Size maxQuietBoundaryShift {2'000};
+
+// Returns the position in search_region closest to target that is quietBoundaryMargin from any read
+// showing variation or any indexed tandem repeat, so calls either side of a task boundary placed there
+// should not need resolving. Returns target if there is no such position or the reads can't tell.
+GenomicRegion::Position find_quiet_boundary(const ContigCallingComponents& components,
+                                            const GenomicRegion& search_region,
+                                            const GenomicRegion::Position target)
+{
+    assert(contains(search_region, GenomicRegion {search_region.contig_name(), target, target}));
+    auto blocks = components.read_manager.get().extract_variation_evidence(components.samples, search_region);
+    if (!blocks) return target;
+    const auto& reference = components.reference.get();
+    const auto repeats = reference.tandem_repeat_index();
+    if (repeats && repeats->has_contig(search_region.contig_name())) {
+        for (const auto& repeat : repeats->fetch(reference, search_region, repeats->max_period())) {
+            blocks->push_back(contig_region(repeat));
+        }
+    }
+    for (auto& block : *blocks) block = expand(block, quietBoundaryMargin);
+    std::sort(std::begin(*blocks), std::end(*blocks));
+    for (auto block_itr = std::cbegin(*blocks); block_itr != std::cend(*blocks);) {
+        auto merged_block = *block_itr;
+        for (++block_itr; block_itr != std::cend(*blocks) && block_itr->begin() <= merged_block.end(); ++block_itr) {
+            merged_block = encompassing_region(merged_block, *block_itr);
+        }
+        if (merged_block.begin() >= target) break;
+        if (target < merged_block.end()) {
+            // Either end of the block is quiet, but must leave the boundary strictly inside the search region
+            const bool lhs_ok {merged_block.begin() > search_region.begin()};
+            const bool rhs_ok {merged_block.end() < search_region.end()};
+            if (lhs_ok && (!rhs_ok || target - merged_block.begin() <= merged_block.end() - target)) {
+                return merged_block.begin();
+            }
+            return rhs_ok ? merged_block.end() : target;
+        }
+    }
+    return target;
+}
+
+// Moves the end of a subregion back to a quiet boundary, keeping at least half of it
+GenomicRegion move_end_to_quiet_boundary(const ContigCallingComponents& components, const GenomicRegion& subregion)
+{
+    const auto max_shift = std::min(size(subregion) / 2, maxQuietBoundaryShift);
+    if (max_shift == 0) return subregion;
+    const GenomicRegion search_region {subregion.contig_name(), subregion.end() - max_shift, subregion.end()};
+    return GenomicRegion {subregion.contig_name(), subregion.begin(), find_quiet_boundary(components, search_region, subregion.end())};
+}
+
 auto find_max_window(const ContigCallingComponents& components,
                      const GenomicRegion& remaining_call_region)
 {
@@ -320,7 +384,7 @@ auto propose_call_subregion(const ContigCallingComponents& components,
         }
         return expand_rhs(head_region(max_window), *min_size);
     }
-    return max_window;
+    return move_end_to_quiet_boundary(components, max_window);
 }
 
 auto propose_call_subregion(const ContigCallingComponents& components,
@@ -449,19 +513,26 @@ void run_octopus_on_contig(ContigCallingComponents&& components)
     }
 }
 
+std::unique_ptr<metrics::LiveMetricsWriter>
+make_live_metrics_writer(GenomeCallingComponents& components, const ThreadPool* workers = nullptr,
+                         std::function<std::size_t()> num_queued_tasks = {})
+{
+    if (components.live_metrics_file()) {
+        metrics::LiveMetricsWriter::Sources sources {components.progress_meter(), workers, std::move(num_queued_tasks)};
+        return std::make_unique<metrics::LiveMetricsWriter>(*components.live_metrics_file(), std::move(sources));
+    } else {
+        return nullptr;
+    }
+}
+
 void run_octopus_single_threaded(GenomeCallingComponents& components)
 {
-    #ifdef BENCHMARK
-    init_timers();
-    #endif
     components.progress_meter().start();
+    const auto live_metrics = make_live_metrics_writer(components);
     for (const auto& contig : components.contigs()) {
         run_octopus_on_contig(ContigCallingComponents {contig, components});
     }
     components.progress_meter().stop();
-    #ifdef BENCHMARK
-        print_all_timers();
-    #endif
 }
 
 bool can_use_temp_bcf(const GenomicRegion& region)
@@ -474,7 +545,7 @@ bool can_use_temp_bcf(const GenomicRegion& region)
 auto create_unique_temp_output_file_path(const GenomicRegion& region,
                                          const GenomeCallingComponents& components)
 {
-    auto result = *components.temp_directory();
+    auto result = components.checkpoint_directory() ? *components.checkpoint_directory() : *components.temp_directory();
     const auto begin   = std::to_string(region.begin());
     const auto end     = std::to_string(region.end());
     boost::filesystem::path file_name {region.contig_name() + "_" + begin + "-" + end + "_temp"};
@@ -503,33 +574,253 @@ VcfWriter create_unique_temp_output_file(const GenomicRegion::ContigName& contig
     return create_unique_temp_output_file(components.reference().contig_region(contig), components);
 }
 
+// Records the tasks written to each checkpointed temp file, and the size of the file after each write. Tasks
+// are written in order, so a resumed run can truncate a temp file to its last recorded size and skip everything
+// in the contig before the end of the last recorded task.
+class CheckpointJournal
+{
+public:
+    struct Entry
+    {
+        GenomicRegion::Position end;
+        std::uintmax_t temp_file_size;
+    };
+    
+    using EntryMap = std::unordered_map<ContigName, Entry>;
+    
+    CheckpointJournal() = delete;
+    CheckpointJournal(const boost::filesystem::path& file, bool append);
+    
+    // The writer must be closed
+    void record(const GenomicRegion& region, const VcfWriter& temp_vcf);
+    
+private:
+    std::mutex mutex_;
+    std::ofstream file_;
+};
+
+CheckpointJournal::CheckpointJournal(const boost::filesystem::path& file, const bool append)
+: mutex_ {}
+, file_ {file.string(), append ? std::ios::app : std::ios::trunc}
+{
+    if (!file_) throw std::ios::failure {"Could not open checkpoint journal " + file.string()};
+}
+
+void CheckpointJournal::record(const GenomicRegion& region, const VcfWriter& temp_vcf)
+{
+    assert(!temp_vcf.is_open());
+    const auto temp_file_size = boost::filesystem::file_size(*temp_vcf.path());
+    std::lock_guard<std::mutex> lock {mutex_};
+    file_ << region.contig_name() << '\t' << region.end() << '\t' << temp_file_size << std::endl;
+}
+
+boost::filesystem::path get_checkpoint_journal_path(const GenomeCallingComponents& components)
+{
+    return *components.checkpoint_directory() / "journal.tsv";
+}
+
+CheckpointJournal::EntryMap read_checkpoint_journal(const boost::filesystem::path& file)
+{
+    CheckpointJournal::EntryMap result {};
+    std::ifstream journal {file.string()};
+    std::string line;
+    while (std::getline(journal, line)) {
+        std::istringstream ss {line};
+        ContigName contig;
+        CheckpointJournal::Entry entry;
+        if (ss >> contig >> entry.end >> entry.temp_file_size) {
+            result[contig] = entry; // the last entry is the most recent
+        } // otherwise the line was partially written when the run was interrupted
+    }
+    return result;
+}
+
+// Removes the parts of the regions that an interrupted run has already called
+InputRegionMap remove_completed(const InputRegionMap& regions, const CheckpointJournal::EntryMap& completed)
+{
+    InputRegionMap result {};
+    for (const auto& p : regions) {
+        const auto completed_itr = completed.find(p.first);
+        if (completed_itr == std::cend(completed)) {
+            result.emplace(p.first, p.second);
+            continue;
+        }
+        const auto completed_end = completed_itr->second.end;
+        InputRegionMap::mapped_type remaining {};
+        for (const auto& region : p.second) {
+            if (region.end() > completed_end) {
+                remaining.emplace(region.contig_name(), std::max(region.begin(), completed_end), region.end());
+            }
+        }
+        if (!remaining.empty()) result.emplace(p.first, std::move(remaining));
+    }
+    return result;
+}
+
+// Temp BCFs can be concatenated into the output without decoding records if they share its header dictionaries
+bool can_naive_merge_temp_files(const GenomeCallingComponents& components, const VcfWriter& output,
+                                const bool calls_filtered = false)
+{
+    const auto output_path = output.path();
+    if (!output_path || output_path->extension() != ".bcf") return false;
+    if (!calls_filtered && components.sites_only() && !apply_csr(components)) return false; // output has no samples
+    return std::all_of(std::cbegin(components.contigs()), std::cend(components.contigs()),
+                       [&] (const auto& contig) { return can_use_temp_bcf(components.reference().contig_region(contig)); });
+}
+
+// The header has all contigs so contig dictionaries match the output
+VcfHeader make_naive_mergeable_temp_header(const GenomeCallingComponents& components)
+{
+    const auto call_types = get_call_types(components, components.contigs());
+    return make_vcf_header(components.samples(), components.contigs(), components.reference(), call_types, "octopus-internal");
+}
+
+VcfWriter create_unique_temp_output_file(const GenomicRegion::ContigName& contig, const GenomeCallingComponents& components,
+                                         VcfHeader header)
+{
+    auto path = create_unique_temp_output_file_path(components.reference().contig_region(contig), components);
+    return VcfWriter {std::move(path), std::move(header)};
+}
+
 using TempVcfWriterMap = std::unordered_map<ContigName, VcfWriter>;
 
-TempVcfWriterMap make_temp_vcf_writers(const GenomeCallingComponents& components)
+// Temp files that are decoded when merged are only ever read by octopus, so favour compression speed over size
+constexpr int decodedTempFileCompressionLevel {1};
+
+// If a header is given then all temp files use it, and contain filtered calls. Temp files of contigs in completed
+// are checkpoints of an interrupted run, which are truncated to their last completed write and appended to.
+TempVcfWriterMap make_temp_vcf_writers(const GenomeCallingComponents& components,
+                                       boost::optional<VcfHeader> header = boost::none,
+                                       const CheckpointJournal::EntryMap& completed = {})
 {
     if (!components.temp_directory()) {
         throw std::runtime_error {"Could not make temp writers"};
     }
+    const bool calls_filtered {header.is_initialized()};
+    const bool naive_mergeable {calls_filtered ? can_naive_merge_temp_files(components, *components.filtered_output(), true)
+                                               : can_naive_merge_temp_files(components, components.output())};
+    if (!header && naive_mergeable) {
+        header = make_naive_mergeable_temp_header(components);
+    }
     TempVcfWriterMap result {};
     result.reserve(components.contigs().size());
     for (const auto& contig : components.contigs()) {
-        auto contig_writer = create_unique_temp_output_file(contig, components);
+        const auto completed_itr = completed.find(contig);
+        if (completed_itr != std::cend(completed)) {
+            auto path = create_unique_temp_output_file_path(components.reference().contig_region(contig), components);
+            boost::filesystem::resize_file(path, completed_itr->second.temp_file_size);
+            VcfWriter contig_writer {std::move(path), VcfWriter::Mode::append};
+            contig_writer.close();
+            if (!naive_mergeable) contig_writer.set_compression_level(decodedTempFileCompressionLevel);
+            result.emplace(contig, std::move(contig_writer));
+            continue;
+        }
+        auto contig_writer = header ? create_unique_temp_output_file(contig, components, *header)
+                                    : create_unique_temp_output_file(contig, components);
         contig_writer.close();
+        // Naively merged temp files are copied into the output without recompression
+        if (!naive_mergeable) contig_writer.set_compression_level(decodedTempFileCompressionLevel);
         result.emplace(contig, std::move(contig_writer));
     }
     return result;
 }
 
+// Filters calls in memory before they are written to temp files, so CSR does not need a second pass over
+// the unfiltered calls. Each thread that writes calls needs its own filter.
+struct TempCallFilter
+{
+    std::unique_ptr<VariantCallFilter> filter;
+    VcfHeader temp_header;
+    std::vector<SampleName> samples;
+};
+
+boost::optional<TempCallFilter>
+make_temp_call_filter(const GenomeCallingComponents& components, const VcfHeader& unfiltered_header,
+                      const std::size_t read_buffer_size)
+{
+    BufferedReadPipe::Config buffer_config {read_buffer_size};
+    buffer_config.fetch_expansion = 100;
+    buffer_config.max_hint_gap = 5'000;
+    buffer_config.compress = components.compress_read_buffer();
+    BufferedReadPipe buffered_rp {components.filter_read_pipe(), buffer_config};
+    auto filter = components.call_filter_factory().make(components.reference(), std::move(buffered_rp), unfiltered_header,
+                                                        components.ploidies(), components.pedigree(), boost::none, 1u);
+    assert(filter);
+    if (!filter->can_filter_in_memory()) return boost::none;
+    auto temp_header = filter->make_header(unfiltered_header);
+    return TempCallFilter {std::move(filter), std::move(temp_header), unfiltered_header.samples()};
+}
+
+// Returns filters for the main thread and each writer thread, or none if calls cannot be filtered in memory
+boost::optional<std::vector<TempCallFilter>>
+make_temp_call_filters(const GenomeCallingComponents& components, const unsigned num_writers)
+{
+    if (!(components.fuse_call_filtering() && apply_csr(components)) || components.filter_request()) return boost::none;
+    const auto unfiltered_header = make_naive_mergeable_temp_header(components);
+    const auto read_buffer_size = components.read_buffer_size() / (num_writers + 1);
+    std::vector<TempCallFilter> result {};
+    result.reserve(num_writers + 1);
+    for (unsigned i {0}; i <= num_writers; ++i) {
+        auto filter = make_temp_call_filter(components, unfiltered_header, read_buffer_size);
+        if (!filter) {
+            logging::WarningLogger warn_log {};
+            warn_log << "The requested filter cannot be fused with calling, calls will be filtered after calling";
+            return boost::none;
+        }
+        result.push_back(std::move(*filter));
+    }
+    return result;
+}
+
+void write_calls(std::deque<VcfRecord>&& calls, VcfWriter& out, const TempCallFilter& call_filter)
+{
+    if (calls.empty()) return;
+    static auto debug_log = get_debug_log();
+    if (debug_log) stream(*debug_log) << "Filtering " << calls.size() << " calls and writing to output";
+    profiling::StageTimer timer {profiling::Stage::output};
+    const std::vector<VcfRecord> unfiltered_calls {std::make_move_iterator(std::begin(calls)), std::make_move_iterator(std::end(calls))};
+    calls.clear();
+    calls.shrink_to_fit();
+    const bool was_closed {!out.is_open()};
+    if (was_closed) out.open();
+    call_filter.filter->filter(unfiltered_calls, call_filter.samples, out, call_filter.temp_header);
+    if (was_closed) out.close();
+}
+
+void write_calls(std::deque<VcfRecord>&& calls, VcfWriter& out, const TempCallFilter* call_filter)
+{
+    if (call_filter) {
+        write_calls(std::move(calls), out, *call_filter);
+    } else {
+        write_calls(std::move(calls), out);
+    }
+}
+
+// How completed tasks are written to temp files
+struct TempWriteContext
+{
+    const TempCallFilter* call_filter;
+    CheckpointJournal* journal;
+};
+
 struct Task : public Mappable<Task>
 {
     GenomicRegion region;
     ExecutionPolicy policy;
+    double estimated_cost;
+    MemoryFootprint estimated_footprint;
+    // If not empty, only these sorted disjoint subregions of the region are called
+    std::vector<GenomicRegion> targets;
     
     Task() = delete;
     
-    Task(GenomicRegion region, ExecutionPolicy policy = ExecutionPolicy::seq)
+    Task(GenomicRegion region, ExecutionPolicy policy = ExecutionPolicy::seq,
+         double estimated_cost = 0, MemoryFootprint estimated_footprint = 0)
     : region {std::move(region)}
     , policy {policy}
+    , estimated_cost {estimated_cost}
+    , estimated_footprint {estimated_footprint}
+    , targets {}
     {};
     
     const GenomicRegion& mapped_region() const noexcept { return region; }
@@ -562,6 +853,152 @@ private:
     std::vector<ContigName> contigs_;
 };
 
+// Fraction of bases in short tandem repeats, which are much more expensive to call than unique sequence
+double calculate_repeat_fraction(const ReferenceGenome::GeneticSequence& sequence) noexcept
+{
+    constexpr std::size_t max_period {4}, min_repeat_length {12};
+    std::array<std::size_t, max_period + 1> run_lengths {};
+    std::size_t num_repeat_bases {0}, covered_end {0};
+    for (std::size_t i {1}; i < sequence.size(); ++i) {
+        if (sequence[i] == 'N') {
+            run_lengths.fill(0);
+            continue;
+        }
+        for (std::size_t period {1}; period <= std::min(max_period, i); ++period) {
+            auto& run_length = run_lengths[period];
+            run_length = sequence[i] == sequence[i - period] ? run_length + 1 : 0;
+            if (run_length + period >= min_repeat_length) {
+                const auto repeat_begin = i + 1 - (run_length + period);
+                num_repeat_bases += i + 1 - std::max(covered_end, repeat_begin);
+                covered_end = i + 1;
+            }
+        }
+    }
+    return sequence.empty() ? 0.0 : static_cast<double>(num_repeat_bases) / sequence.size();
+}
+
+// Estimates the relative cost of calling a region from cheap signals (read count and reference repeat
+// content), and learns how long a unit of cost takes from completed tasks. The task maker uses this to
+// split regions that are predicted to take much longer than other tasks, so threads finish together.
+class TaskCostModel
+{
+public:
+    struct Estimate
+    {
+        double cost;
+        std::size_t num_reads;
+    };
+    
+    TaskCostModel() : seconds_per_unit_cost_ {0}, num_observations_ {0} {}
+    
+    Estimate estimate(const GenomicRegion& region, const ContigCallingComponents& components) const;
+    // Only called by the thread running tasks
+    void observe(double estimated_cost, const utils::TimeInterval& runtime) noexcept;
+    boost::optional<double> max_task_cost() const noexcept;
+    
+private:
+    static constexpr double repeatCostWeight {10};
+    static constexpr GenomicRegion::Size maxRepeatScanSize {1'000'000};
+    static constexpr unsigned minObservations {8};
+    static constexpr double maxTaskSeconds {60};
+    static constexpr double learningRate {0.2};
+    
+    std::atomic<double> seconds_per_unit_cost_;
+    std::atomic_uint num_observations_;
+};
+
+TaskCostModel::Estimate
+TaskCostModel::estimate(const GenomicRegion& region, const ContigCallingComponents& components) const
+{
+    const auto num_reads = components.read_manager.get().estimate_read_count(components.samples.get(), region);
+    if (num_reads == 0) return {0, 0};
+    double repeat_fraction {0};
+    if (size(region) <= maxRepeatScanSize) {
+        repeat_fraction = calculate_repeat_fraction(components.reference.get().fetch_sequence(region));
+    }
+    return {num_reads * (1 + repeatCostWeight * repeat_fraction), num_reads};
+}
+
+void TaskCostModel::observe(const double estimated_cost, const utils::TimeInterval& runtime) noexcept
+{
+    if (estimated_cost <= 0) return;
+    const auto seconds = utils::duration<std::chrono::duration<double>>(runtime).count();
+    const auto rate = seconds / estimated_cost;
+    if (num_observations_ == 0) {
+        seconds_per_unit_cost_ = rate;
+    } else {
+        seconds_per_unit_cost_ = (1 - learningRate) * seconds_per_unit_cost_ + learningRate * rate;
+    }
+    ++num_observations_;
+}
+
+boost::optional<double> TaskCostModel::max_task_cost() const noexcept
+{
+    const double rate {seconds_per_unit_cost_};
+    if (num_observations_ < minObservations || rate <= 0) return boost::none;
+    return maxTaskSeconds / rate;
+}
+
+// Estimates the memory footprint of tasks from their reads and the haplotype likelihoods of those reads,
+// and tracks the footprint of running tasks against a budget. Without a budget every task is admitted.
+class TaskMemoryBudget
+{
+public:
+    TaskMemoryBudget() : budget_ {}, read_bytes_ {static_cast<double>(default_read_size_estimate())}, reserved_ {0}, num_reserved_ {0} {}
+    
+    // These must be set before tasks are made
+    void set_budget(MemoryFootprint budget) noexcept { budget_ = budget; }
+    void set_read_bytes(double bytes) noexcept { read_bytes_ = bytes; }
+    
+    MemoryFootprint estimate(std::size_t num_reads) const noexcept;
+    // Tasks with larger footprints are split when they are made
+    boost::optional<MemoryFootprint> max_task_footprint() const noexcept;
+    
+    // Only called by the thread running tasks. A task can always start if no others are running.
+    bool can_start(MemoryFootprint footprint) const noexcept;
+    void reserve(MemoryFootprint footprint) noexcept;
+    void release(MemoryFootprint footprint) noexcept;
+    
+private:
+    // Likelihoods of a read for a typical number of haplotypes in an active region
+    static constexpr double likelihoodBytesPerRead {128 * sizeof(float)};
+    static constexpr double maxTaskBudgetFraction {0.25};
+    
+    boost::optional<MemoryFootprint> budget_;
+    double read_bytes_;
+    MemoryFootprint reserved_;
+    unsigned num_reserved_;
+};
+
+MemoryFootprint TaskMemoryBudget::estimate(const std::size_t num_reads) const noexcept
+{
+    return static_cast<std::size_t>(num_reads * (read_bytes_ + likelihoodBytesPerRead));
+}
+
+boost::optional<MemoryFootprint> TaskMemoryBudget::max_task_footprint() const noexcept
+{
+    if (!budget_) return boost::none;
+    return MemoryFootprint {static_cast<std::size_t>(maxTaskBudgetFraction * budget_->bytes())};
+}
+
+bool TaskMemoryBudget::can_start(const MemoryFootprint footprint) const noexcept
+{
+    return !budget_ || num_reserved_ == 0 || reserved_ + footprint <= *budget_;
+}
+
+void TaskMemoryBudget::reserve(const MemoryFootprint footprint) noexcept
+{
+    reserved_ += footprint;
+    ++num_reserved_;
+}
+
+void TaskMemoryBudget::release(const MemoryFootprint footprint) noexcept
+{
+    assert(num_reserved_ > 0 && footprint <= reserved_);
+    reserved_ -= footprint;
+    --num_reserved_;
+}
+
 using TaskQueue = std::queue<Task>;
 using TaskMap   = std::map<ContigName, TaskQueue, ContigOrder>;
 
@@ -571,6 +1008,19 @@ auto count_tasks(const TaskMap& tasks) noexcept
                            [] (auto curr, const auto& p) noexcept { return curr + p.second.size(); });
 }
 
+// Running tasks will keep fetching reads from their regions, so try to keep the files they need open
+void hint_running_tasks(const ReadManager& read_manager, const TaskMap& running_tasks)
+{
+    std::vector<GenomicRegion> regions {};
+    for (const auto& p : running_tasks) {
+        auto tasks = p.second; // std::queue is not iterable
+        for (; !tasks.empty(); tasks.pop()) {
+            regions.push_back(tasks.front().region);
+        }
+    }
+    read_manager.hint(regions);
+}
+
 struct TaskMakerSyncPacket
 {
     TaskMakerSyncPacket() : batch_size_hint {1}, waiting {true}, num_tasks {0}, finished {}, all_done {false} {}
@@ -582,33 +1032,81 @@ struct TaskMakerSyncPacket
     std::atomic_uint num_tasks;
     std::unordered_map<ContigName, bool> finished;
     std::atomic_bool all_done;
+    TaskCostModel cost_model;
+    TaskMemoryBudget memory_budget;
 };
 
+// Makes one task for the region, or several if the region is estimated to be too expensive or too large for one
+void make_tasks(const GenomicRegion& region, const ContigCallingComponents& components, const ExecutionPolicy policy,
+                const TaskMakerSyncPacket& sync, const GenomicRegion::Size min_size, std::deque<Task>& result)
+{
+    const auto estimate = sync.cost_model.estimate(region, components);
+    const auto footprint = sync.memory_budget.estimate(estimate.num_reads);
+    GenomicRegion::Size num_parts {1};
+    const auto max_cost = sync.cost_model.max_task_cost();
+    if (max_cost && estimate.cost > *max_cost) {
+        num_parts = std::ceil(estimate.cost / *max_cost);
+    }
+    const auto max_footprint = sync.memory_budget.max_task_footprint();
+    if (max_footprint && max_footprint->bytes() > 0 && footprint > *max_footprint) {
+        const auto num_footprint_parts = std::ceil(static_cast<double>(footprint.bytes()) / max_footprint->bytes());
+        num_parts = std::max(num_parts, static_cast<GenomicRegion::Size>(num_footprint_parts));
+    }
+    if (num_parts > 1 && size(region) >= 2 * min_size) {
+        num_parts = std::min(num_parts, size(region) / min_size);
+        const MemoryFootprint part_footprint {footprint.bytes() / num_parts};
+        auto part_begin = region.begin();
+        for (GenomicRegion::Size i {0}; i < num_parts; ++i) {
+            auto part_end = region.end();
+            if (i + 1 < num_parts) {
+                // Parts are resized as boundaries move so they stay balanced
+                const auto target_size = (region.end() - part_begin) / (num_parts - i);
+                const auto max_shift = std::min(target_size / 4, maxQuietBoundaryShift);
+                const auto target = part_begin + target_size;
+                part_end = find_quiet_boundary(components, GenomicRegion {region.contig_name(), target - max_shift, target + max_shift}, target);
+            }
+            result.emplace_back(GenomicRegion {region.contig_name(), part_begin, part_end}, policy,
+                                estimate.cost / num_parts, part_footprint);
+            part_begin = part_end;
+        }
+    } else {
+        result.emplace_back(region, policy, estimate.cost, footprint);
+    }
+}
+
+constexpr GenomicRegion::Size minTaskSize {5'000};
+
+// Pushes the last tasks made for an input region
+void push_final_tasks(std::deque<Task>& batch, const ContigName& contig, TaskQueue& result, TaskMakerSyncPacket& sync,
+                      const bool last_region_in_contig, const bool last_contig)
+{
+    std::unique_lock<std::mutex> lock {sync.mutex};
+    sync.cv.wait(lock, [&] () { return sync.ready; });
+    for (auto&& task : batch) result.push(std::move(task));
+    sync.num_tasks += batch.size();
+    if (last_region_in_contig) {
+        sync.finished.at(contig) = true;
+        if (last_contig) sync.all_done = true;
+    }
+    lock.unlock();
+    sync.cv.notify_one();
+}
+
 void make_region_tasks(const GenomicRegion& region, const ContigCallingComponents& components, const ExecutionPolicy policy,
                        TaskQueue& result, TaskMakerSyncPacket& sync, const bool last_region_in_contig, const bool last_contig)
 {
-    static constexpr GenomicRegion::Size minTaskSize {5'000};
     std::unique_lock<std::mutex> lock {sync.mutex, std::defer_lock};
     auto subregion = propose_call_subregion(components, region, minTaskSize);
+    std::deque<Task> batch {};
+    make_tasks(subregion, components, policy, sync, minTaskSize, batch);
     if (ends_equal(subregion, region)) {
-        lock.lock();
-        sync.cv.wait(lock, [&] () { return sync.ready; });
-        result.emplace(std::move(subregion), policy);
-        ++sync.num_tasks;
-        if (last_region_in_contig) {
-            sync.finished.at(region.contig_name()) = true;
-            if (last_contig) sync.all_done = true;
-        }
-        lock.unlock();
-        sync.cv.notify_one();
+        push_final_tasks(batch, region.contig_name(), result, sync, last_region_in_contig, last_contig);
     } else {
-        std::deque<GenomicRegion> batch {};
-        batch.push_back(subregion);
         bool done {false};
         while (true) {
             while (batch.size() < std::max(sync.batch_size_hint.load(), 1u) || !sync.waiting) {
                 subregion = propose_call_subregion(components, subregion, region, minTaskSize);
-                batch.push_back(subregion);
+                make_tasks(subregion, components, policy, sync, minTaskSize, batch);
                 assert(!ends_before(region, subregion));
                 if (ends_equal(subregion, region)) {
                     done = true;
@@ -619,7 +1117,7 @@ void make_region_tasks(const GenomicRegion& region, const ContigCallingComponent
             assert(!lock.owns_lock());
             lock.lock();
             sync.cv.wait(lock, [&] () { return sync.ready; });
-            for (auto&& r : batch) result.emplace(std::move(r), policy);
+            for (auto&& task : batch) result.push(std::move(task));
             sync.num_tasks += batch.size();
             if (done) {
                 if (last_region_in_contig) {
@@ -640,14 +1138,54 @@ void make_region_tasks(const GenomicRegion& region, const ContigCallingComponent
     }
 }
 
+bool is_batchable(const GenomicRegion& region) noexcept
+{
+    return size(region) < minTaskSize;
+}
+
+// Groups consecutive small input regions, as in targeted panels, into one task so the per task overhead
+// is paid once. Batches are kept local and well under the maximum task cost so they stay balanced.
+template <typename ForwardIt>
+ForwardIt make_batch_task(ForwardIt first, const ForwardIt last, const ContigCallingComponents& components,
+                          const ExecutionPolicy policy, const TaskMakerSyncPacket& sync, std::deque<Task>& result)
+{
+    static constexpr std::size_t maxBatchTargets {64};
+    static constexpr GenomicRegion::Size maxBatchSpan {1'000'000};
+    static constexpr double maxBatchCostFraction {0.25};
+    const auto max_cost = sync.cost_model.max_task_cost();
+    std::vector<GenomicRegion> targets {};
+    double cost {0};
+    MemoryFootprint footprint {0};
+    for (; first != last && is_batchable(*first) && targets.size() < maxBatchTargets; ++first) {
+        if (!targets.empty() && size(encompassing_region(targets.front(), *first)) > maxBatchSpan) break;
+        const auto estimate = sync.cost_model.estimate(*first, components);
+        if (!targets.empty() && max_cost && cost + estimate.cost > maxBatchCostFraction * *max_cost) break;
+        targets.push_back(*first);
+        cost += estimate.cost;
+        // Targets are called in turn, so only one holds reads at a time
+        footprint = std::max(footprint, sync.memory_budget.estimate(estimate.num_reads));
+    }
+    assert(!targets.empty());
+    result.emplace_back(encompassing_region(targets.front(), targets.back()), policy, cost, footprint);
+    if (targets.size() > 1) result.back().targets = std::move(targets);
+    return first;
+}
+
 void make_contig_tasks(const ContigCallingComponents& components, const ExecutionPolicy policy,
                        TaskQueue& result, TaskMakerSyncPacket& sync, const bool last_contig)
 {
-    if (components.regions.empty()) return;
-    std::for_each(std::cbegin(components.regions), std::prev(std::cend(components.regions)), [&] (const auto& region) {
-        make_region_tasks(region, components, policy, result, sync, false, last_contig);
-    });
-    make_region_tasks(components.regions.back(), components, policy, result, sync, true, last_contig);
+    const auto last = std::cend(components.regions);
+    for (auto first = std::cbegin(components.regions); first != last;) {
+        const auto next = std::next(first);
+        if (next != last && is_batchable(*first) && is_batchable(*next)) {
+            std::deque<Task> batch {};
+            first = make_batch_task(first, last, components, policy, sync, batch);
+            push_final_tasks(batch, components.regions.front().contig_name(), result, sync, first == last, last_contig);
+        } else {
+            make_region_tasks(*first, components, policy, result, sync, next == last, last_contig);
+            first = next;
+        }
+    }
 }
 
 ExecutionPolicy make_execution_policy(const GenomeCallingComponents& components)
@@ -665,8 +1203,9 @@ auto make_contig_components(const ContigName& contig, GenomeCallingComponents& c
     return result;
 }
 
-void make_tasks_helper(TaskMap& tasks, std::vector<ContigName> contigs, GenomeCallingComponents& components,
-                       const unsigned num_threads, ExecutionPolicy execution_policy, TaskMakerSyncPacket& sync)
+void make_tasks_helper(TaskMap& tasks, std::vector<ContigName> contigs, const InputRegionMap& regions,
+                       GenomeCallingComponents& components, const unsigned num_threads,
+                       ExecutionPolicy execution_policy, TaskMakerSyncPacket& sync)
 {
     try {
         static auto debug_log = get_debug_log();
@@ -675,6 +1214,7 @@ void make_tasks_helper(TaskMap& tasks, std::vector<ContigName> contigs, GenomeCa
             const auto& contig = contigs[i];
             if (debug_log) stream(*debug_log) << "Making tasks for contig " << contig;
             auto contig_components = make_contig_components(contig, components, num_threads);
+            contig_components.regions = regions.at(contig);
             make_contig_tasks(contig_components, execution_policy, tasks[contig], sync, i == contigs.size() - 1);
             if (debug_log) stream(*debug_log) << "Finished making tasks for contig " << contig;
         }
@@ -696,10 +1236,14 @@ void make_tasks_helper(TaskMap& tasks, std::vector<ContigName> contigs, GenomeCa
     }
 }
 
-std::thread make_task_maker_thread(TaskMap& tasks, GenomeCallingComponents& components, const unsigned num_threads,
-                                   TaskMakerSyncPacket& sync)
+// The regions must be a subset of the search regions, and are usually the same
+std::thread make_task_maker_thread(TaskMap& tasks, const InputRegionMap& regions, GenomeCallingComponents& components,
+                                   const unsigned num_threads, TaskMakerSyncPacket& sync)
 {
-    auto contigs = components.contigs();
+    std::vector<ContigName> contigs {};
+    contigs.reserve(regions.size());
+    std::copy_if(std::cbegin(components.contigs()), std::cend(components.contigs()), std::back_inserter(contigs),
+                 [&] (const auto& contig) { return regions.count(contig) == 1; });
     if (contigs.empty()) {
         sync.all_done = true;
         return std::thread {};
@@ -708,7 +1252,7 @@ std::thread make_task_maker_thread(TaskMap& tasks, GenomeCallingComponents& comp
     for (const auto& contig : contigs) {
         sync.finished.emplace(contig, false);
     }
-    return std::thread {make_tasks_helper, std::ref(tasks), std::move(contigs), std::ref(components),
+    return std::thread {make_tasks_helper, std::ref(tasks), std::move(contigs), std::cref(regions), std::ref(components),
                         num_threads, make_execution_policy(components), std::ref(sync)};
 }
 
@@ -746,6 +1290,13 @@ Task pop(TaskMap& tasks, TaskMakerSyncPacket& sync)
     return result;
 }
 
+// The footprint of the next task to be popped. The caller must hold the task maker mutex.
+MemoryFootprint peek_footprint(const TaskMap& tasks)
+{
+    assert(!tasks.empty() && !std::cbegin(tasks)->second.empty());
+    return std::cbegin(tasks)->second.front().estimated_footprint;
+}
+
 struct CompletedTask : public Task
 {
     CompletedTask(Task task) : Task {std::move(task)}, calls {}, runtime {} {}
@@ -780,16 +1331,56 @@ bool is_ready(const std::future<R>& f)
     return f.valid() && f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
 }
 
-auto run(Task task, ContigCallingComponents components, CallerSyncPacket& sync)
+using TaskSplitter = std::shared_ptr<CallRegionSplitter>;
+
+struct SplittableTask
+{
+    TaskSplitter splitter = nullptr;
+    MemoryFootprint footprint = 0;
+};
+
+SplittableTask make_splittable(const Task& task)
+{
+    // The uncalled part of a batched task is mostly between its targets, so is not worth splitting off
+    if (!task.targets.empty()) return SplittableTask {nullptr, task.estimated_footprint};
+    return SplittableTask {std::make_shared<CallRegionSplitter>(task.region), task.estimated_footprint};
+}
+
+// Calls each target with the same caller, resolving calls that connect adjacent targets
+auto call_targets(const std::vector<GenomicRegion>& targets, const ContigCallingComponents& components)
+{
+    std::deque<VcfRecord> result {};
+    std::vector<VcfRecord> connecting_calls {};
+    for (auto itr = std::cbegin(targets); itr != std::cend(targets); ++itr) {
+        auto calls = components.caller->call(*itr, components.progress_meter);
+        resolve_connecting_calls(connecting_calls, calls, components);
+        if (std::next(itr) != std::cend(targets)) {
+            buffer_connecting_calls(calls, *std::next(itr), connecting_calls);
+        }
+        result.insert(std::end(result), std::make_move_iterator(std::begin(calls)), std::make_move_iterator(std::end(calls)));
+    }
+    return result;
+}
+
+// The task region may be split while it runs, so the region of the completed task can be shorter
+auto run(Task task, ContigCallingComponents components, CallerSyncPacket& sync, ThreadPool& task_runners,
+         TaskSplitter splitter)
 {
     static auto debug_log = get_debug_log();
     if (debug_log) stream(*debug_log) << "Spawning task " << task;
-    return std::async(std::launch::async, [task = std::move(task), components = std::move(components), &sync] () {
+    return task_runners.push([task = std::move(task), components = std::move(components), &sync, splitter] () {
         try {
+            metrics::add(metrics::Counter::tasks_started);
             CompletedTask result {task};
             result.runtime.start = std::chrono::system_clock::now();
-            result.calls = components.caller->call(task.region, components.progress_meter);
+            if (task.targets.empty()) {
+                result.calls = components.caller->call(task.region, components.progress_meter, splitter.get());
+                result.region = splitter->close();
+            } else {
+                result.calls = call_targets(task.targets, components);
+            }
             result.runtime.end = std::chrono::system_clock::now();
+            metrics::add(metrics::Counter::tasks_completed);
             std::unique_lock<std::mutex> lock {sync.mutex};
             ++sync.num_finished;
             lock.unlock();
@@ -931,40 +1522,99 @@ void resolve_connecting_calls(std::deque<CompletedTask>& adjacent_tasks,
                   [&] (auto& rhs) { resolve_connecting_calls(*lhs++, rhs, calling_components); });
 }
 
+// Completed tasks are passed from the main thread to a writer thread in batches through a bounded
+// lock-free queue. Each writer owns the temp VCFs of a subset of contigs, so calls are written in order.
 struct TaskWriterSyncPacket
 {
-    std::condition_variable cv;
-    std::mutex mutex;
-    std::deque<CompletedTask> tasks = {};
-    bool done = false;
+    using Batch = std::deque<CompletedTask>;
+    
+    static constexpr std::size_t maxQueuedBatches {1024};
+    static constexpr std::chrono::milliseconds backoff {1};
+    
+    TaskWriterSyncPacket() : batches {maxQueuedBatches}, done {false}, queue_depth {0}, max_queue_depth {0}, num_batches {0}, call_filter {}, journal {nullptr} {}
+    
+    boost::lockfree::spsc_queue<Batch*> batches; // Owning, released by the writer
+    std::atomic_bool done;
+    std::atomic_size_t queue_depth;
+    std::size_t max_queue_depth, num_batches; // Only accessed by the main thread
+    boost::optional<TempCallFilter> call_filter; // Only used by the writer
+    CheckpointJournal* journal;
+};
+
+constexpr std::chrono::milliseconds TaskWriterSyncPacket::backoff;
+
+struct TaskWriters
+{
+    TaskWriters(TempVcfWriterMap& temp_writers, const std::vector<ContigName>& contigs, unsigned num_writers,
+                std::vector<TempCallFilter> call_filters = {}, CheckpointJournal* journal = nullptr);
+    
+    TaskWriters(const TaskWriters&)            = delete;
+    TaskWriters& operator=(const TaskWriters&) = delete;
+    TaskWriters(TaskWriters&&)                 = delete;
+    TaskWriters& operator=(TaskWriters&&)      = delete;
+    
+    // Writers finish their queued batches if they are not waited for
+    ~TaskWriters();
+    
+    std::deque<TaskWriterSyncPacket> syncs;
+    std::unordered_map<ContigName, std::reference_wrapper<TaskWriterSyncPacket>> contig_syncs;
+    std::vector<std::thread> threads;
 };
 
-void write(std::deque<CompletedTask>& tasks, TempVcfWriterMap& writers)
+unsigned calculate_num_task_writer_threads(const unsigned num_task_threads, const std::size_t num_contigs)
+{
+    static constexpr unsigned maxTaskWriterThreads {4};
+    static constexpr unsigned taskThreadsPerWriter {8};
+    const auto num_wanted = std::max(num_task_threads / taskThreadsPerWriter, 1u);
+    return std::min({num_wanted, maxTaskWriterThreads, static_cast<unsigned>(std::max(num_contigs, std::size_t {1}))});
+}
+
+void write(CompletedTask& task, VcfWriter& temp_vcf, const TempWriteContext& context)
+{
+    write_calls(std::move(task.calls), temp_vcf, context.call_filter);
+    if (context.journal) context.journal->record(task.region, temp_vcf);
+}
+
+void write(std::deque<CompletedTask>& tasks, TempVcfWriterMap& writers, const TempWriteContext& context)
 {
     static auto debug_log = get_debug_log();
     for (auto&& task : tasks) {
         if (debug_log) {
             stream(*debug_log) << "Writing completed task " << task << " that finished in " << duration(task);
         }
-        auto& writer = writers.at(contig_name(task));
-        write_calls(std::move(task.calls), writer);
+        write(task, writers.at(contig_name(task)), context);
+    }
+    tasks.clear();
+}
+
+void write(std::deque<CompletedTask>& tasks, VcfWriter& vcf, const TempWriteContext& context)
+{
+    static auto debug_log = get_debug_log();
+    for (auto&& task : tasks) {
+        if (debug_log) stream(*debug_log) << "Writing completed task " << task << " that finished in " << duration(task);
+        write(task, vcf, context);
     }
     tasks.clear();
 }
 
-void write_temp_vcf_helper(TempVcfWriterMap& writers, TaskWriterSyncPacket& sync)
+// Output is either the temp VCFs of the writer's contigs, or the final output when calls are streamed
+template <typename Output>
+void write_tasks_helper(Output& output, TaskWriterSyncPacket& sync)
 {
     try {
-        std::unique_lock<std::mutex> lock {sync.mutex, std::defer_lock};
-        std::deque<CompletedTask> buffer {};
-        while (!sync.done) {
-            lock.lock();
-            sync.cv.wait(lock, [&] () { return !sync.tasks.empty() || sync.done; });
-            assert(buffer.empty());
-            std::swap(sync.tasks, buffer);
-            lock.unlock();
-            sync.cv.notify_one();
-            write(buffer, writers);
+        const TempWriteContext context {sync.call_filter ? std::addressof(*sync.call_filter) : nullptr, sync.journal};
+        TaskWriterSyncPacket::Batch* batch {nullptr};
+        while (true) {
+            const bool done {sync.done}; // Read before popping so no batch is missed
+            if (sync.batches.pop(batch)) {
+                std::unique_ptr<TaskWriterSyncPacket::Batch> owned_batch {batch};
+                --sync.queue_depth;
+                write(*owned_batch, output, context);
+            } else if (done) {
+                break;
+            } else {
+                std::this_thread::sleep_for(TaskWriterSyncPacket::backoff);
+            }
         }
         logging::DebugLogger debug_log {};
         debug_log << "Task writer finished";
@@ -985,32 +1635,157 @@ void write_temp_vcf_helper(TempVcfWriterMap& writers, TaskWriterSyncPacket& sync
     }
 }
 
-std::thread make_task_writer_thread(TempVcfWriterMap& temp_writers, TaskWriterSyncPacket& writer_sync)
+// Contigs are assigned to writers round-robin as they are called in order
+TaskWriters::TaskWriters(TempVcfWriterMap& temp_writers, const std::vector<ContigName>& contigs, const unsigned num_writers,
+                         std::vector<TempCallFilter> call_filters, CheckpointJournal* journal)
+{
+    assert(num_writers > 0);
+    assert(call_filters.empty() || call_filters.size() == num_writers);
+    for (unsigned i {0}; i < num_writers; ++i) {
+        syncs.emplace_back();
+        if (!call_filters.empty()) syncs.back().call_filter = std::move(call_filters[i]);
+        syncs.back().journal = journal;
+    }
+    for (std::size_t i {0}; i < contigs.size(); ++i) {
+        contig_syncs.emplace(contigs[i], syncs[i % num_writers]);
+    }
+    threads.reserve(num_writers);
+    for (auto& sync : syncs) {
+        threads.emplace_back(write_tasks_helper<TempVcfWriterMap>, std::ref(temp_writers), std::ref(sync));
+    }
+}
+
+TaskWriters::~TaskWriters()
+{
+    for (auto& sync : syncs) sync.done = true;
+    for (auto& thread : threads) {
+        if (thread.joinable()) thread.join();
+    }
+}
+
+void write(std::deque<CompletedTask>&& tasks, VcfWriter& temp_vcf, const TempWriteContext& context)
+{
+    write(tasks, temp_vcf, context);
+}
+
+void push(std::deque<CompletedTask>&& tasks, TaskWriterSyncPacket& sync)
+{
+    auto batch = std::make_unique<TaskWriterSyncPacket::Batch>(std::move(tasks));
+    const auto queue_depth = ++sync.queue_depth;
+    while (!sync.batches.push(batch.get())) {
+        std::this_thread::sleep_for(TaskWriterSyncPacket::backoff);
+    }
+    batch.release();
+    sync.max_queue_depth = std::max(sync.max_queue_depth, queue_depth);
+    ++sync.num_batches;
+}
+
+// The tasks must all be from the same contig
+void write(std::deque<CompletedTask>&& tasks, TaskWriters& writers)
 {
-    return std::thread {write_temp_vcf_helper, std::ref(temp_writers), std::ref(writer_sync)};
+    if (tasks.empty()) return;
+    assert(std::all_of(std::cbegin(tasks), std::cend(tasks),
+                       [&] (const auto& task) { return contig_name(task) == contig_name(tasks.front()); }));
+    push(std::move(tasks), writers.contig_syncs.at(contig_name(tasks.front())).get());
 }
 
-void write(std::deque<CompletedTask>&& tasks, VcfWriter& temp_vcf)
+// Writes completed tasks straight to a stream output, such as stdout, rather than to temp files that are merged
+// once calling is complete. Contigs are written in order: tasks of the contig being written are passed to a writer
+// thread as soon as they are writable, and tasks of later contigs are buffered until every contig before them is
+// finished.
+class StreamTaskWriter
+{
+public:
+    StreamTaskWriter(VcfWriter& output, std::vector<ContigName> contigs);
+    
+    StreamTaskWriter(const StreamTaskWriter&)            = delete;
+    StreamTaskWriter& operator=(const StreamTaskWriter&) = delete;
+    StreamTaskWriter(StreamTaskWriter&&)                 = delete;
+    StreamTaskWriter& operator=(StreamTaskWriter&&)      = delete;
+    
+    // The writer finishes its queued batches if it is not waited for
+    ~StreamTaskWriter();
+    
+    // The tasks must all be from the same contig, and follow any tasks already written for it
+    void write(std::deque<CompletedTask>&& tasks);
+    // No more tasks will be written for the contig
+    void finish(const ContigName& contig);
+    void wait_until_finished();
+    
+private:
+    std::vector<ContigName> contigs_;
+    std::size_t current_contig_;
+    std::unordered_map<ContigName, std::deque<CompletedTask>> buffered_tasks_;
+    std::unordered_set<ContigName> finished_contigs_;
+    TaskWriterSyncPacket sync_;
+    std::thread thread_;
+};
+
+StreamTaskWriter::StreamTaskWriter(VcfWriter& output, std::vector<ContigName> contigs)
+: contigs_ {std::move(contigs)}
+, current_contig_ {0}
+, buffered_tasks_ {}
+, finished_contigs_ {}
+, sync_ {}
+, thread_ {write_tasks_helper<VcfWriter>, std::ref(output), std::ref(sync_)}
+{}
+
+StreamTaskWriter::~StreamTaskWriter()
+{
+    sync_.done = true;
+    if (thread_.joinable()) thread_.join();
+}
+
+void StreamTaskWriter::write(std::deque<CompletedTask>&& tasks)
+{
+    if (tasks.empty()) return;
+    const auto& contig = contig_name(tasks.front());
+    if (current_contig_ < contigs_.size() && contig == contigs_[current_contig_]) {
+        push(std::move(tasks), sync_);
+    } else {
+        utils::append(std::move(tasks), buffered_tasks_[contig]);
+    }
+}
+
+void StreamTaskWriter::finish(const ContigName& contig)
 {
     static auto debug_log = get_debug_log();
-    for (auto&& task : tasks) {
-        if (debug_log) stream(*debug_log) << "Writing completed task " << task << " that finished in " << duration(task);
-        write_calls(std::move(task.calls), temp_vcf);
+    finished_contigs_.insert(contig);
+    while (current_contig_ < contigs_.size() && finished_contigs_.count(contigs_[current_contig_]) == 1) {
+        if (debug_log) stream(*debug_log) << "Finished streaming calls for contig " << contigs_[current_contig_];
+        ++current_contig_;
+        if (current_contig_ < contigs_.size()) {
+            const auto itr = buffered_tasks_.find(contigs_[current_contig_]);
+            if (itr != std::end(buffered_tasks_)) {
+                push(std::move(itr->second), sync_);
+                buffered_tasks_.erase(itr);
+            }
+        }
     }
 }
 
-void write(std::deque<CompletedTask>&& tasks, TaskWriterSyncPacket& sync)
+void StreamTaskWriter::wait_until_finished()
 {
-    std::unique_lock<std::mutex> lock {sync.mutex};
-    utils::append(std::move(tasks), sync.tasks);
-    lock.unlock();
-    sync.cv.notify_one();
+    static auto debug_log = get_debug_log();
+    assert(buffered_tasks_.empty());
+    sync_.done = true;
+    thread_.join();
+    if (debug_log) {
+        stream(*debug_log) << "Stream writer wrote " << sync_.num_batches << " batches with maximum queue depth "
+                           << sync_.max_queue_depth;
+    }
+}
+
+void write(std::deque<CompletedTask>&& tasks, StreamTaskWriter& writer)
+{
+    writer.write(std::move(tasks));
 }
 
 // A CompletedTask can only be written if all proceeding tasks have completed (either written or buffered)
+template <typename Writers>
 void write_or_buffer(CompletedTask&& task, CompletedTaskMap::mapped_type& buffered_tasks,
                      TaskQueue& running_tasks, HoldbackTask& holdback,
-                     TaskWriterSyncPacket& sync, const ContigCallingComponentFactory& calling_components)
+                     Writers& writers, const ContigCallingComponentFactory& calling_components)
 {
     static auto debug_log = get_debug_log();
     if (is_same_region(task, running_tasks.front())) {
@@ -1024,20 +1799,46 @@ void write_or_buffer(CompletedTask&& task, CompletedTaskMap::mapped_type& buffer
         holdback = p.first->second;
         if (debug_log) stream(*debug_log) << "Holding back completed task " << *holdback;
         writable_tasks.pop_back();
-        write(std::move(writable_tasks), sync);
+        write(std::move(writable_tasks), writers);
     } else {
         if (debug_log) stream(*debug_log) << "Buffering completed task " << task;
         buffered_tasks.emplace(contig_region(task), std::move(task));
     }
 }
 
-void wait_until_finished(TaskWriterSyncPacket& sync)
+// All tasks of the contig have been made and started, and none are still running
+bool is_finished_contig(const ContigName& contig, const TaskMap& pending_tasks, const TaskQueue& running_tasks,
+                        TaskMakerSyncPacket& sync)
 {
-    std::unique_lock<std::mutex> lock {sync.mutex};
-    sync.cv.wait(lock, [&] () { return sync.tasks.empty(); });
-    sync.done = true;
-    lock.unlock();
-    sync.cv.notify_one();
+    if (!running_tasks.empty()) return false;
+    std::lock_guard<std::mutex> lock {sync.mutex};
+    return sync.finished.at(contig) && pending_tasks.count(contig) == 0;
+}
+
+// There are no more tasks to resolve connecting calls with, so the held back task can be written
+void finish_contig(const ContigName& contig, CompletedTaskMap::mapped_type& buffered_tasks, HoldbackTask& holdback,
+                   StreamTaskWriter& writer)
+{
+    std::deque<CompletedTask> tasks {};
+    for (auto& p : buffered_tasks) tasks.push_back(std::move(p.second));
+    buffered_tasks.clear();
+    holdback = boost::none;
+    writer.write(std::move(tasks));
+    writer.finish(contig);
+}
+
+void wait_until_finished(TaskWriters& writers)
+{
+    static auto debug_log = get_debug_log();
+    for (auto& sync : writers.syncs) sync.done = true;
+    for (auto& thread : writers.threads) thread.join();
+    writers.threads.clear();
+    if (debug_log) {
+        for (const auto& sync : writers.syncs) {
+            stream(*debug_log) << "Task writer wrote " << sync.num_batches << " batches with maximum queue depth "
+                               << sync.max_queue_depth;
+        }
+    }
 }
 
 using FutureCompletedTasks = std::vector<std::future<CompletedTask>>;
@@ -1093,21 +1894,84 @@ void resolve_connecting_calls(RemainingTaskMap& remaining_tasks,
     }
 }
 
-void write(RemainingTaskMap&& remaining_tasks, TempVcfWriterMap& temp_vcfs)
+void write(RemainingTaskMap&& remaining_tasks, TempVcfWriterMap& temp_vcfs, const TempWriteContext& context)
 {
     for (auto& p : remaining_tasks) {
-        write(std::move(p.second), temp_vcfs.at(p.first));
+        write(std::move(p.second), temp_vcfs.at(p.first), context);
+    }
+}
+
+// Once all tasks have started, threads become idle as tasks finish. Rather than wait for the longest running
+// tasks, split off the uncalled right-hand part of the task with the most left and run it on an idle thread.
+// Completed tasks are buffered, and connecting calls are resolved when the remaining tasks are written.
+void split_running_tasks_until_finished(FutureCompletedTasks& futures, std::vector<SplittableTask>& splittables,
+                                        CompletedTaskMap& buffered_tasks, CallerSyncPacket& caller_sync,
+                                        TaskMemoryBudget& memory_budget, ThreadPool& task_runners,
+                                        const ContigCallingComponentFactoryMap& calling_components)
+{
+    using namespace std::chrono_literals;
+    static constexpr GenomicRegion::Size minSplitSize {10'000};
+    static auto debug_log = get_debug_log();
+    assert(futures.size() == splittables.size());
+    const auto is_running = [] (const auto& future) { return future.valid(); };
+    while (std::any_of(std::cbegin(futures), std::cend(futures), is_running)) {
+        for (std::size_t i {0}; i < futures.size(); ++i) {
+            if (is_ready(futures[i])) {
+                auto completed_task = futures[i].get();
+                --caller_sync.num_finished;
+                memory_budget.release(completed_task.estimated_footprint);
+                splittables[i] = SplittableTask {};
+                auto& contig_buffered_tasks = buffered_tasks.at(contig_name(completed_task.region));
+                contig_buffered_tasks.emplace(contig_region(completed_task), std::move(completed_task));
+            }
+        }
+        for (std::size_t i {0}; i < futures.size(); ++i) {
+            if (futures[i].valid()) continue;
+            const auto largest = std::max_element(std::cbegin(splittables), std::cend(splittables),
+                                                  [] (const auto& lhs, const auto& rhs) {
+                                                      return (lhs.splitter ? lhs.splitter->unclaimed_size() : 0)
+                                                           < (rhs.splitter ? rhs.splitter->unclaimed_size() : 0);
+                                                  });
+            if (!largest->splitter) break;
+            // The running task keeps its reservation, so the remainder needs its own
+            const MemoryFootprint remainder_footprint {largest->footprint.bytes() / 2};
+            if (!memory_budget.can_start(remainder_footprint)) break;
+            const auto remainder = largest->splitter->split(minSplitSize);
+            if (!remainder) break;
+            if (debug_log) stream(*debug_log) << "Splitting off " << *remainder << " from a running task";
+            Task task {*remainder, ExecutionPolicy::seq, 0, remainder_footprint};
+            splittables[i] = SplittableTask {std::make_shared<CallRegionSplitter>(task.region), remainder_footprint};
+            memory_budget.reserve(remainder_footprint);
+            futures[i] = run(task, calling_components.at(contig_name(task))(), caller_sync, task_runners, splittables[i].splitter);
+        }
+        std::unique_lock<std::mutex> lock {caller_sync.mutex};
+        caller_sync.cv.wait_for(lock, 5s, [&] () { return caller_sync.num_finished > 0; });
     }
 }
 
 void write_remaining_tasks(FutureCompletedTasks& futures, CompletedTaskMap& buffered_tasks, TempVcfWriterMap& temp_vcfs,
-                           const ContigCallingComponentFactoryMap& calling_components)
+                           const ContigCallingComponentFactoryMap& calling_components, const TempWriteContext& context)
+{
+    static auto debug_log = get_debug_log();
+    if (debug_log) stream(*debug_log) << "Waiting for " << futures.size() << " running tasks to finish";
+    auto remaining_tasks = extract_remaining_tasks(futures, buffered_tasks);
+    resolve_connecting_calls(remaining_tasks, calling_components);
+    write(std::move(remaining_tasks), temp_vcfs, context);
+}
+
+void write_remaining_tasks(FutureCompletedTasks& futures, CompletedTaskMap& buffered_tasks, StreamTaskWriter& writer,
+                           const std::vector<ContigName>& contigs, const ContigCallingComponentFactoryMap& calling_components)
 {
     static auto debug_log = get_debug_log();
     if (debug_log) stream(*debug_log) << "Waiting for " << futures.size() << " running tasks to finish";
     auto remaining_tasks = extract_remaining_tasks(futures, buffered_tasks);
     resolve_connecting_calls(remaining_tasks, calling_components);
-    write(std::move(remaining_tasks), temp_vcfs);
+    for (const auto& contig : contigs) {
+        const auto itr = remaining_tasks.find(contig);
+        if (itr != std::end(remaining_tasks)) writer.write(std::move(itr->second));
+        writer.finish(contig);
+    }
+    writer.wait_until_finished();
 }
 
 auto extract_writers(TempVcfWriterMap&& vcfs)
@@ -1126,34 +1990,180 @@ auto extract_as_readers(TempVcfWriterMap&& vcfs)
     return writers_to_readers(extract_writers(std::move(vcfs)), false);
 }
 
-void merge(TempVcfWriterMap&& temp_vcf_writers, GenomeCallingComponents& components)
+void naive_merge(TempVcfWriterMap&& temp_vcf_writers, GenomeCallingComponents& components, VcfWriter& output)
+{
+    std::vector<boost::filesystem::path> temp_paths {};
+    temp_paths.reserve(temp_vcf_writers.size());
+    for (const auto& contig : components.contigs()) {
+        auto& writer = temp_vcf_writers.at(contig);
+        writer.close();
+        temp_paths.push_back(*writer.path());
+    }
+    output.close();
+    concatenate_naive(temp_paths, *output.path());
+    // Removing the temp files first stops the writers indexing them
+    for (const auto& path : temp_paths) boost::filesystem::remove(path);
+    temp_vcf_writers.clear();
+}
+
+void merge(TempVcfWriterMap&& temp_vcf_writers, GenomeCallingComponents& components, VcfWriter& output,
+           const bool calls_filtered = false)
 {
     static auto debug_log = get_debug_log();
-    if (debug_log) stream(*debug_log) << "Merging " << temp_vcf_writers.size() << " temporary VCF files";
-    auto temp_readers = extract_as_readers(std::move(temp_vcf_writers));
-    merge(temp_readers, components.output(), components.contigs());
+    if (can_naive_merge_temp_files(components, output, calls_filtered)) {
+        if (debug_log) stream(*debug_log) << "Concatenating " << temp_vcf_writers.size() << " temporary BCF files";
+        naive_merge(std::move(temp_vcf_writers), components, output);
+    } else {
+        if (debug_log) stream(*debug_log) << "Merging " << temp_vcf_writers.size() << " temporary VCF files";
+        auto temp_readers = extract_as_readers(std::move(temp_vcf_writers));
+        merge(temp_readers, output, components.contigs());
+    }
+}
+
+// The temp files already contain filtered calls, so they are merged straight into the filtered output, which
+// gets the header the filter would have made from the unfiltered output
+void merge_filtered(TempVcfWriterMap&& temp_vcf_writers, GenomeCallingComponents& components,
+                    const TempCallFilter& call_filter)
+{
+    auto& unfiltered_output = components.output();
+    unfiltered_output.close();
+    const VcfReader unfiltered_calls {*unfiltered_output.path()};
+    auto& filtered_output = *components.filtered_output();
+    filtered_output << call_filter.filter->make_header(unfiltered_calls.fetch_header());
+    merge(std::move(temp_vcf_writers), components, filtered_output, true);
+}
+
+void merge(TempVcfWriterMap&& temp_vcf_writers, GenomeCallingComponents& components)
+{
+    merge(std::move(temp_vcf_writers), components, components.output());
+}
+
+// Returns true if the temp files contain filtered calls
+bool merge_temp_files(TempVcfWriterMap&& temp_writers, GenomeCallingComponents& components,
+                      const boost::optional<TempCallFilter>& call_filter)
+{
+    std::vector<boost::filesystem::path> checkpoint_files {};
+    if (components.checkpoint_directory()) {
+        for (const auto& p : temp_writers) checkpoint_files.push_back(*p.second.path());
+        checkpoint_files.push_back(get_checkpoint_journal_path(components));
+    }
+    bool calls_filtered {false};
+    if (call_filter) {
+        merge_filtered(std::move(temp_writers), components, *call_filter);
+        calls_filtered = true;
+    } else {
+        merge(std::move(temp_writers), components);
+    }
+    // The run is complete so the checkpoint is no longer needed
+    for (const auto& file : checkpoint_files) {
+        boost::filesystem::remove(file);
+        boost::filesystem::remove(file.string() + ".csi");
+        boost::filesystem::remove(file.string() + ".tbi");
+    }
+    return calls_filtered;
+}
+
+void log_completed(const InputRegionMap& regions, const CheckpointJournal::EntryMap& completed, ProgressMeter& progress)
+{
+    for (const auto& p : completed) {
+        const auto contig_regions = regions.find(p.first);
+        if (contig_regions == std::cend(regions)) continue;
+        for (const auto& region : contig_regions->second) {
+            if (region.begin() >= p.second.end) break;
+            progress.log_completed(GenomicRegion {p.first, region.begin(), std::min(region.end(), p.second.end)});
+        }
+    }
+}
+
+// Unfiltered calls to a stream output are written as tasks complete, so downstream tools receive calls during the run
+bool can_stream_calls(const GenomeCallingComponents& components)
+{
+    return !components.output().path() && !apply_csr(components) && !components.checkpoint_directory();
 }
 
-void run_octopus_multi_threaded(GenomeCallingComponents& components)
+// Returns true if calls were filtered while calling
+bool run_octopus_multi_threaded(GenomeCallingComponents& components)
 {
     using namespace std::chrono_literals;
     static auto debug_log = get_debug_log();
     
     const auto num_task_threads = calculate_num_task_threads(components);
     
+    std::unique_ptr<CheckpointJournal> journal {};
+    CheckpointJournal::EntryMap completed {};
+    boost::optional<InputRegionMap> remaining_regions {};
+    if (components.checkpoint_directory()) {
+        const auto journal_path = get_checkpoint_journal_path(components);
+        if (components.resume()) {
+            completed = read_checkpoint_journal(journal_path);
+            remaining_regions = remove_completed(components.search_regions(), completed);
+            logging::InfoLogger info_log {};
+            stream(info_log) << "Resuming from checkpoint with "
+                             << utils::format_with_commas(sum_region_sizes(*remaining_regions)) << "bp left to call";
+        }
+        journal = std::make_unique<CheckpointJournal>(journal_path, components.resume());
+    }
+    const InputRegionMap& regions {remaining_regions ? *remaining_regions : components.search_regions()};
+    
+    const auto num_task_writer_threads = calculate_num_task_writer_threads(num_task_threads, components.contigs().size());
+    auto call_filters = make_temp_call_filters(components, num_task_writer_threads);
+    boost::optional<TempCallFilter> main_call_filter {};
+    if (call_filters) {
+        if (debug_log) *debug_log << "Filtering calls in memory";
+        main_call_filter = std::move(call_filters->back());
+        call_filters->pop_back();
+    }
+    const bool stream_calls {can_stream_calls(components)};
+    TempVcfWriterMap temp_writers {};
+    if (!stream_calls) {
+        temp_writers = make_temp_vcf_writers(components, main_call_filter ? boost::make_optional(main_call_filter->temp_header) : boost::none,
+                                             completed);
+    }
+    const TempWriteContext main_write_context {main_call_filter ? std::addressof(*main_call_filter) : nullptr, journal.get()};
+    if (regions.empty()) {
+        if (stream_calls) return false;
+        // Everything was called before the run was interrupted
+        return merge_temp_files(std::move(temp_writers), components, main_call_filter);
+    }
+    std::unique_ptr<TaskWriters> task_writers {};
+    std::unique_ptr<StreamTaskWriter> stream_writer {};
+    std::vector<ContigName> stream_contigs {};
+    if (stream_calls) {
+        if (debug_log) *debug_log << "Streaming calls to output";
+        std::copy_if(std::cbegin(components.contigs()), std::cend(components.contigs()), std::back_inserter(stream_contigs),
+                     [&] (const auto& contig) { return regions.count(contig) == 1; });
+        stream_writer = std::make_unique<StreamTaskWriter>(components.output(), stream_contigs);
+    } else {
+        task_writers = std::make_unique<TaskWriters>(temp_writers, components.contigs(), num_task_writer_threads,
+                                                     call_filters ? std::move(*call_filters) : std::vector<TempCallFilter> {},
+                                                     journal.get());
+    }
+    
     TaskMap pending_tasks {components.contigs()};
     TaskMakerSyncPacket task_maker_sync {};
     task_maker_sync.batch_size_hint = 2 * num_task_threads;
+    const auto reads_profile = components.reads_profile();
+    if (reads_profile) {
+        task_maker_sync.memory_budget.set_read_bytes(reads_profile->mean_read_bytes + reads_profile->read_bytes_stdev);
+    }
+    if (components.working_memory_footprint()) {
+        task_maker_sync.memory_budget.set_budget(components.read_buffer_footprint() + *components.working_memory_footprint());
+    }
     std::unique_lock<std::mutex> pending_task_lock {task_maker_sync.mutex, std::defer_lock};
-    auto task_maker_thread = make_task_maker_thread(pending_tasks, components, num_task_threads, task_maker_sync);
+    auto task_maker_thread = make_task_maker_thread(pending_tasks, regions, components, num_task_threads, task_maker_sync);
     if (!task_maker_thread.joinable()) {
         logging::FatalLogger fatal_log {};
         fatal_log << "Unable to make task maker thread";
-        return;
+        return false;
     }
     task_maker_thread.detach();
     
+    // Persistent so threads are not created for each task. Must outlive the futures.
+    ThreadPool task_runners {num_task_threads, components.pin_threads() ? assign_thread_cpus(num_task_threads) : std::vector<unsigned> {}};
+    const auto live_metrics = make_live_metrics_writer(components, &task_runners,
+                                                       [&task_maker_sync] () -> std::size_t { return task_maker_sync.num_tasks; });
     FutureCompletedTasks futures(num_task_threads);
+    std::vector<SplittableTask> splittables(num_task_threads);
     TaskMap running_tasks {ContigOrder {components.contigs()}};
     CompletedTaskMap buffered_tasks {};
     std::map<ContigName, HoldbackTask> holdbacks {};
@@ -1168,16 +2178,6 @@ void run_octopus_multi_threaded(GenomeCallingComponents& components)
     const auto calling_components = make_contig_calling_component_factory_map(components);
     unsigned num_idle_futures {0};
     
-    auto temp_writers = make_temp_vcf_writers(components);
-    TaskWriterSyncPacket task_writer_sync {};
-    auto task_writer_thread = make_task_writer_thread(temp_writers, task_writer_sync);
-    if (!task_writer_thread.joinable()) {
-        logging::FatalLogger fatal_log {};
-        fatal_log << "Unable to make task writer thread";
-        return;
-    }
-    task_writer_thread.detach();
-    
     // Wait for the first task to be made
     const auto tasks_available = [&] () noexcept { return task_maker_sync.num_tasks > 0; };
     while(task_maker_sync.num_tasks == 0) {
@@ -1188,6 +2188,7 @@ void run_octopus_multi_threaded(GenomeCallingComponents& components)
     task_maker_sync.batch_size_hint = num_task_threads / 2;
     
     components.progress_meter().start();
+    log_completed(components.search_regions(), completed, components.progress_meter());
     
     while (!task_maker_sync.all_done || task_maker_sync.num_tasks > 0) {
         pending_task_lock.lock();
@@ -1207,31 +2208,54 @@ void run_octopus_multi_threaded(GenomeCallingComponents& components)
         }
         pending_task_lock.unlock();
         num_idle_futures = 0;
-        for (auto& future : futures) {
+        bool started_task {false}, deferred_task {false};
+        for (std::size_t i {0}; i < futures.size(); ++i) {
+            auto& future = futures[i];
             if (is_ready(future)) {
                 auto completed_task = future.get();
-                const auto& contig = contig_name(completed_task.region);
-                write_or_buffer(std::move(completed_task), buffered_tasks.at(contig),
-                                running_tasks.at(contig), holdbacks.at(contig),
-                                task_writer_sync, calling_components.at(contig));
+                task_maker_sync.cost_model.observe(completed_task.estimated_cost, completed_task.runtime);
+                task_maker_sync.memory_budget.release(completed_task.estimated_footprint);
+                const auto contig = contig_name(completed_task.region);
+                if (stream_writer) {
+                    write_or_buffer(std::move(completed_task), buffered_tasks.at(contig),
+                                    running_tasks.at(contig), holdbacks.at(contig),
+                                    *stream_writer, calling_components.at(contig));
+                    if (is_finished_contig(contig, pending_tasks, running_tasks.at(contig), task_maker_sync)) {
+                        finish_contig(contig, buffered_tasks.at(contig), holdbacks.at(contig), *stream_writer);
+                    }
+                } else {
+                    write_or_buffer(std::move(completed_task), buffered_tasks.at(contig),
+                                    running_tasks.at(contig), holdbacks.at(contig),
+                                    *task_writers, calling_components.at(contig));
+                }
                 --caller_sync.num_finished;
             }
             if (!future.valid()) {
                 pending_task_lock.lock();
-                if (task_maker_sync.num_tasks > 0) {
+                if (task_maker_sync.num_tasks > 0 && !task_maker_sync.memory_budget.can_start(peek_footprint(pending_tasks))) {
+                    // Defer the task until running tasks release enough memory
+                    pending_task_lock.unlock();
+                    deferred_task = true;
+                    ++num_idle_futures;
+                } else if (task_maker_sync.num_tasks > 0) {
                     pending_task_lock.unlock(); // As pop will need to lock the mutex too == deadlock
                     auto task = pop(pending_tasks, task_maker_sync);
-                    future = run(task, calling_components.at(contig_name(task))(), caller_sync);
+                    task_maker_sync.memory_budget.reserve(task.estimated_footprint);
+                    splittables[i] = make_splittable(task);
+                    future = run(task, calling_components.at(contig_name(task))(), caller_sync, task_runners, splittables[i].splitter);
                     running_tasks.at(contig_name(task)).push(std::move(task));
+                    started_task = true;
                 } else {
                     pending_task_lock.unlock();
                     ++num_idle_futures;
                 }
             }
         }
+        if (started_task) hint_running_tasks(components.read_manager(), running_tasks);
         // If there are no idle futures then all threads are busy and we must wait for one to finish,
-        // otherwise we must have run out of tasks, so we should wait for new ones.
-        if (num_idle_futures == 0 && caller_sync.num_finished == 0) {
+        // otherwise we must have run out of tasks, so we should wait for new ones. Deferred tasks
+        // also need a running task to finish.
+        if ((num_idle_futures == 0 || deferred_task) && caller_sync.num_finished == 0) {
             task_maker_sync.waiting = false;
             std::unique_lock<std::mutex> lock {caller_sync.mutex};
             caller_sync.cv.wait(lock, [&] () { return caller_sync.num_finished > 0; });
@@ -1244,11 +2268,19 @@ void run_octopus_multi_threaded(GenomeCallingComponents& components)
     assert(pending_tasks.empty());
     running_tasks.clear();
     holdbacks.clear(); // holdbacks are just references to buffered tasks
-    if (debug_log) *debug_log << "Finished making new tasks. Waiting for task writer to complete existing jobs";
-    wait_until_finished(task_writer_sync);
-    write_remaining_tasks(futures, buffered_tasks, temp_writers, calling_components);
+    if (debug_log) *debug_log << "Finished making new tasks. Splitting remaining running tasks";
+    split_running_tasks_until_finished(futures, splittables, buffered_tasks, caller_sync, task_maker_sync.memory_budget,
+                                       task_runners, calling_components);
+    if (stream_writer) {
+        write_remaining_tasks(futures, buffered_tasks, *stream_writer, stream_contigs, calling_components);
+        components.progress_meter().stop();
+        return false;
+    }
+    if (debug_log) *debug_log << "Waiting for task writer to complete existing jobs";
+    wait_until_finished(*task_writers);
+    write_remaining_tasks(futures, buffered_tasks, temp_writers, calling_components, main_write_context);
     components.progress_meter().stop();
-    merge(std::move(temp_writers), components);
+    return merge_temp_files(std::move(temp_writers), components, main_call_filter);
 }
 
 } // namespace
@@ -1258,16 +2290,22 @@ bool is_multithreaded(const GenomeCallingComponents& components)
     return !components.num_threads() || *components.num_threads() > 1;
 }
 
-void run_calling(GenomeCallingComponents& components)
+// Returns true if calls were filtered while calling
+bool run_calling(GenomeCallingComponents& components)
 {
     if (is_multithreaded(components)) {
         if (DEBUG_MODE) {
             logging::WarningLogger warn_log {};
             warn_log << "Running in parallel mode can make debug log difficult to interpret";
         }
-        run_octopus_multi_threaded(components);
+        return run_octopus_multi_threaded(components);
     } else {
+        if (components.checkpoint_directory()) {
+            logging::WarningLogger warn_log {};
+            warn_log << "Single threaded runs are not checkpointed";
+        }
         run_octopus_single_threaded(components);
+        return false;
     }
 }
 
@@ -1322,6 +2360,53 @@ bool use_unfiltered_call_region_hints_for_filtering(const GenomeCallingComponent
     return true;
 }
 
+bool is_indexed(const boost::filesystem::path& vcf_path)
+{
+    return boost::filesystem::exists(vcf_path.string() + ".csi") || boost::filesystem::exists(vcf_path.string() + ".tbi");
+}
+
+// Each contig can be filtered into its own temp BCF, which are concatenated into the output in the source's contig order
+bool can_filter_contigs_concurrently(const VariantCallFilter& filter, const VcfReader& in, const VcfWriter& out,
+                                     const GenomeCallingComponents& components)
+{
+    if (!filter.can_filter_contigs_concurrently() || !components.temp_directory()) return false;
+    const auto output_path = out.path();
+    if (!output_path || output_path->extension() != ".bcf" || out.is_header_written()) return false;
+    if (!is_indexed(in.path())) return false;
+    const auto contigs = get_contigs(in.fetch_header());
+    return contigs.size() > 1 && std::all_of(std::cbegin(contigs), std::cend(contigs),
+                                             [] (const auto& contig) { return can_use_temp_bcf(GenomicRegion {contig, 0, 0}); });
+}
+
+void filter_contigs_concurrently(const VariantCallFilter& filter, const VcfReader& in, VcfWriter& out,
+                                 const GenomeCallingComponents& components)
+{
+    static auto debug_log = get_debug_log();
+    const auto source_header = in.fetch_header();
+    const auto contigs = get_contigs(source_header);
+    const auto header = filter.make_header(source_header);
+    std::vector<VcfWriter> temp_writers {};
+    temp_writers.reserve(contigs.size());
+    for (const auto& contig : contigs) {
+        auto path = *components.temp_directory();
+        path /= contig + "_filtered_temp.bcf";
+        temp_writers.emplace_back(std::move(path), header);
+    }
+    if (debug_log) stream(*debug_log) << "Filtering " << contigs.size() << " contigs concurrently";
+    filter.filter(in.path(), contigs, temp_writers, header);
+    std::vector<boost::filesystem::path> temp_paths {};
+    temp_paths.reserve(temp_writers.size());
+    for (auto& writer : temp_writers) {
+        writer.close();
+        temp_paths.push_back(*writer.path());
+    }
+    out << header;
+    out.close();
+    concatenate_naive(temp_paths, *out.path());
+    // Removing the temp files first stops the writers indexing them
+    for (const auto& path : temp_paths) boost::filesystem::remove(path);
+}
+
 void run_csr(GenomeCallingComponents& components)
 {
     if (apply_csr(components)) {
@@ -1339,6 +2424,8 @@ void run_csr(GenomeCallingComponents& components)
         BufferedReadPipe::Config buffer_config {components.read_buffer_size()};
         buffer_config.fetch_expansion = 100;
         buffer_config.max_hint_gap = 5'000;
+        buffer_config.prefetch = true;
+        buffer_config.compress = components.compress_read_buffer();
         BufferedReadPipe buffered_rp {filter_read_pipe, buffer_config};
         if (use_unfiltered_call_region_hints_for_filtering(components)) {
             buffered_rp.hint(extract_call_regions(*input_path));
@@ -1351,7 +2438,11 @@ void run_csr(GenomeCallingComponents& components)
                                                 progress, components.num_threads());
         assert(filter);
         VcfWriter& out {*components.filtered_output()};
-        filter->filter(in, out);
+        if (can_filter_contigs_concurrently(*filter, in, out, components)) {
+            filter_contigs_concurrently(*filter, in, out, components);
+        } else {
+            filter->filter(in, out);
+        }
         out.close();
     }
 }
@@ -1394,9 +2485,10 @@ void run_variant_calling(GenomeCallingComponents& components, std::string comman
     log_run_start(components, command);
     write_caller_output_header(components, command);
     const auto start = std::chrono::system_clock::now();
+    bool calls_filtered {false};
     try {
         if (!components.filter_request()) {
-            run_calling(components);
+            calls_filtered = run_calling(components);
         }
     } catch (const ProgramError& e) {
         try {
@@ -1419,7 +2511,11 @@ void run_variant_calling(GenomeCallingComponents& components, std::string comman
     }
     components.output().close();
     try {
-        run_csr(components);
+        if (calls_filtered) {
+            components.filtered_output()->close();
+        } else {
+            run_csr(components);
+        }
     } catch (...) {
         try {
             if (debug_log) *debug_log << "Encountered an error whilst filtering, attempting to cleanup";
@@ -1431,11 +2527,10 @@ void run_variant_calling(GenomeCallingComponents& components, std::string comman
     log_finish_info(components, {start, end});
 }
 
-void convert_to_legacy(const boost::filesystem::path& src, const boost::filesystem::path& dest)
+void convert_to_legacy(const boost::filesystem::path& src, const boost::filesystem::path& dest, const unsigned num_threads)
 {
-    const VcfReader in {src};
     VcfWriter out {dest};
-    convert_to_legacy(in, out);
+    convert_to_legacy(src, out, num_threads);
 }
 
 void run_legacy_generation(GenomeCallingComponents& components)
@@ -1446,7 +2541,8 @@ void run_legacy_generation(GenomeCallingComponents& components)
         if (output_path) {
             logging::InfoLogger log {};
             destroy(final_output);
-            convert_to_legacy(*output_path, *components.legacy());
+            const auto num_threads = components.num_threads() ? *components.num_threads() : hardware_concurrency();
+            convert_to_legacy(*output_path, *components.legacy(), num_threads);
             stream(log) << "Legacy VCF file written to " << *components.legacy();
         }
     }
@@ -1613,7 +2709,12 @@ void run_data_profiler(GenomeCallingComponents& components)
             info_log << "Starting indel profiler";
             final_output.close();
             if (is_indexable(*final_output_path)) index_vcf(*final_output_path);
-            const auto profile = profile_indels(components.read_pipe(), *final_output_path, components.reference(), components.search_regions());
+            IndelProfiler::ProfileConfig profile_config {};
+            profile_config.sample_fraction = components.data_profile_fraction();
+            IndelProfiler::PerformanceConfig performance_config {};
+            performance_config.max_threads = components.num_threads();
+            const auto profile = profile_indels(components.read_pipe(), *final_output_path, components.reference(),
+                                                components.search_regions(), std::move(profile_config), std::move(performance_config));
             std::ofstream profile_file {data_profile_csv_path->string()};
             profile_file << profile;
             stream(info_log) << "Indel profile written to " << *data_profile_csv_path;
@@ -1630,10 +2731,138 @@ void run_post_calling_requests(GenomeCallingComponents& components)
     run_legacy_generation(components);
 }
 
+// Shards are balanced with the same cost estimates the scheduler uses for tasks
+void run_shard_manifest_generation(GenomeCallingComponents& components)
+{
+    logging::InfoLogger info_log {};
+    const auto config = *components.shard_manifest_request();
+    stream(info_log) << "Estimating calling costs to make " << config.num_shards << " shards";
+    const auto calling_components = make_contig_calling_component_factory_map(components);
+    std::unordered_map<ContigName, ContigCallingComponents> contig_components {};
+    const TaskCostModel cost_model {};
+    const auto estimate_cost = [&] (const GenomicRegion& region) {
+        auto itr = contig_components.find(region.contig_name());
+        if (itr == std::end(contig_components)) {
+            itr = contig_components.emplace(region.contig_name(), calling_components.at(region.contig_name())()).first;
+        }
+        return cost_model.estimate(region, itr->second).cost;
+    };
+    const auto manifest = make_shards(components.search_regions(), components.contigs(), components.reference(),
+                                      estimate_cost, config);
+    write(manifest, *components.shard_manifest());
+    stream(info_log) << "Written " << manifest.size() << " shards to " << *components.shard_manifest();
+}
+
+class BadShardMerge : public UserError
+{
+    std::string do_where() const override { return "run_shard_merge"; }
+    std::string do_why() const override
+    {
+        std::ostringstream ss {};
+        ss << "There are " << num_calls_ << " shard call sets to merge but the shard manifest has " << num_shards_ << " shards";
+        return ss.str();
+    }
+    std::string do_help() const override { return "Give the calls of every shard in the manifest, in shard order"; }
+    
+    std::size_t num_calls_, num_shards_;
+public:
+    BadShardMerge(std::size_t num_calls, std::size_t num_shards) : num_calls_ {num_calls}, num_shards_ {num_shards} {}
+};
+
+GenomicRegion::Position clipped_add(const GenomicRegion::Position position, const GenomicRegion::Size offset,
+                                    const GenomicRegion::Position max) noexcept
+{
+    return std::min(position + offset, max);
+}
+
+// Shard calls are trimmed to the unpadded shard region. Calls near the end of the region are held back in tail
+// as they may connect to calls at the start of the next shard, which are resolved like the calls of adjacent
+// tasks in a single run.
+void write_shard_calls(const VcfReader& shard_calls, const GenomicRegion& region, const GenomicRegion& padded_region,
+                       boost::optional<CompletedTask>& tail, VcfWriter& dst,
+                       const ContigCallingComponentFactoryMap& calling_components)
+{
+    const auto& contig = region.contig_name();
+    const bool connecting {tail && tail->region.contig_name() == contig && tail->region.end() == region.begin()};
+    if (tail && !connecting) {
+        write_calls(std::move(tail->calls), dst);
+        tail = boost::none;
+    }
+    boost::optional<CompletedTask> head {};
+    const auto head_end = clipped_add(region.begin(), region.begin() - padded_region.begin(), region.end());
+    if (connecting) head = CompletedTask {Task {GenomicRegion {contig, region.begin(), head_end}}};
+    const auto tail_size = padded_region.end() - region.end();
+    const auto tail_begin = std::max(region.end() > tail_size ? region.end() - tail_size : 0, head_end);
+    CompletedTask next_tail {Task {GenomicRegion {contig, tail_begin, region.end()}}};
+    const auto flush_head = [&] () {
+        resolve_connecting_calls(*tail, *head, calling_components.at(contig));
+        write_calls(std::move(tail->calls), dst);
+        write_calls(std::move(head->calls), dst);
+        tail = boost::none;
+        head = boost::none;
+    };
+    auto p = shard_calls.iterate(region);
+    std::for_each(std::move(p.first), std::move(p.second), [&] (const VcfRecord& call) {
+        const auto call_begin = mapped_begin(call);
+        if (call_begin < region.begin() || call_begin >= region.end()) return; // belongs to another region
+        if (head && call_begin < head_end) {
+            head->calls.push_back(call);
+            return;
+        }
+        if (head) flush_head();
+        if (call_begin >= tail_begin) {
+            next_tail.calls.push_back(call);
+        } else {
+            dst << call;
+        }
+    });
+    if (head) flush_head();
+    tail = std::move(next_tail);
+}
+
+void run_shard_merge(GenomeCallingComponents& components)
+{
+    logging::InfoLogger info_log {};
+    const auto manifest = read_shard_manifest(*components.shard_manifest(), components.reference());
+    const auto& shard_call_paths = components.merge_shards_request();
+    if (shard_call_paths.size() != manifest.size()) {
+        throw BadShardMerge {shard_call_paths.size(), manifest.size()};
+    }
+    stream(info_log) << "Merging the calls of " << manifest.size() << " shards";
+    std::vector<VcfReader> shard_calls {};
+    shard_calls.reserve(shard_call_paths.size());
+    std::vector<VcfHeader> shard_headers {};
+    shard_headers.reserve(shard_call_paths.size());
+    for (const auto& path : shard_call_paths) {
+        shard_calls.emplace_back(path);
+        shard_headers.push_back(shard_calls.back().fetch_header());
+    }
+    VcfWriter& output {get_final_output(components)};
+    output << merge(shard_headers);
+    const auto calling_components = make_contig_calling_component_factory_map(components);
+    boost::optional<CompletedTask> tail {};
+    for (std::size_t shard {0}; shard < manifest.size(); ++shard) {
+        for (std::size_t i {0}; i < manifest[shard].regions.size(); ++i) {
+            write_shard_calls(shard_calls[shard], manifest[shard].regions[i], manifest[shard].padded_regions[i],
+                              tail, output, calling_components);
+        }
+    }
+    if (tail) write_calls(std::move(tail->calls), output);
+    output.close();
+    const auto output_path = output.path();
+    if (output_path) stream(info_log) << "Merged calls have been written to " << *output_path;
+}
+
 void run_octopus(GenomeCallingComponents& components, std::string command)
 {
-    run_variant_calling(components, std::move(command));
-    run_post_calling_requests(components);
+    if (components.shard_manifest_request()) {
+        run_shard_manifest_generation(components);
+    } else if (!components.merge_shards_request().empty()) {
+        run_shard_merge(components);
+    } else {
+        run_variant_calling(components, std::move(command));
+        run_post_calling_requests(components);
+    }
     cleanup(components);
 }
 
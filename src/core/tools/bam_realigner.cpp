@@ -7,7 +7,11 @@
 #include <iterator>
 #include <algorithm>
 #include <utility>
+#include <memory>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
 #include <cassert>
 
 #include "basics/genomic_region.hpp"
@@ -150,12 +154,21 @@ Haplotype get_aligned_part(const Haplotype& inferred_haplotype, const AlignedRea
 
 auto realign_and_annotate(const std::vector<AlignedRead>& reads, const Haplotype& haplotype,
                           const ReferenceGenome& reference,
-                          boost::optional<int> haplotype_id = boost::none)
+                          boost::optional<int> haplotype_id = boost::none,
+                          const ReadMappingOffsets* mapping_offsets = nullptr)
 {
     std::vector<AnnotatedAlignedRead> result {};
     if (reads.empty()) return result;
     const auto expanded_haplotype = expand_for_realignment(haplotype, reads);
-    auto realignments = realign(reads, expanded_haplotype);
+    auto realignments = reads;
+    if (mapping_offsets && mapping_offsets->size() == reads.size()) {
+        const auto lhs_expansion = static_cast<int>(begin_distance(expanded_haplotype, haplotype));
+        auto expanded_mapping_offsets = *mapping_offsets;
+        for (auto& offset : expanded_mapping_offsets) offset += lhs_expansion;
+        realign(realignments, expanded_haplotype, expanded_mapping_offsets);
+    } else {
+        realign(realignments, expanded_haplotype);
+    }
     const auto inferred_alignments = copy_alignments(realignments);
     rebase(realignments, haplotype);
     result.reserve(realignments.size());
@@ -186,12 +199,15 @@ auto assign_and_realign(const std::vector<AlignedRead>& reads, const Genotype<Ha
             AmbiguousReadList unassigned_reads {};
             AssignmentConfig assigner_config {};
             assigner_config.ambiguous_record = AssignmentConfig::AmbiguousRecord::haplotypes;
-            auto support = compute_haplotype_support(genotype, reads, unassigned_reads, assigner_config);
+            HaplotypeMappingMap mappings {};
+            auto support = compute_haplotype_support(genotype, reads, unassigned_reads, mappings, assigner_config);
             int haplotype_id {0};
             for (auto& p : support) {
                 if (!p.second.empty()) {
                     report.n_reads_assigned += p.second.size();
-                    utils::append(realign_and_annotate(p.second, p.first, reference, haplotype_id), result);
+                    const auto mappings_itr = mappings.find(p.first);
+                    const ReadMappingOffsets* mapping_offsets {mappings_itr != std::cend(mappings) ? &mappings_itr->second : nullptr};
+                    utils::append(realign_and_annotate(p.second, p.first, reference, haplotype_id, mapping_offsets), result);
                 }
                 ++haplotype_id;
             }
@@ -234,6 +250,13 @@ auto move_merge(Container&& src, std::vector<T>& dst)
 
 } // namespace
 
+BAMRealigner::Report& operator+=(BAMRealigner::Report& lhs, const BAMRealigner::Report& rhs) noexcept
+{
+    lhs.n_reads_assigned += rhs.n_reads_assigned;
+    lhs.n_reads_unassigned += rhs.n_reads_unassigned;
+    return lhs;
+}
+
 BAMRealigner::Report
 BAMRealigner::realign(ReadReader& src, VcfReader& variants, ReadWriter& dst,
                       const ReferenceGenome& reference, SampleList samples) const
@@ -247,20 +270,32 @@ BAMRealigner::realign(ReadReader& src, VcfReader& variants, ReadWriter& dst,
     for (auto p = variants.iterate(); p.first != p.second;) {
         std::tie(batch, batch_region) = read_next_batch(p.first, p.second, src, reference, samples, batch_region);
         for (auto& sample : batch) {
-            std::vector<AlignedRead> genotype_reads {};
-            std::vector<AnnotatedAlignedRead> realigned_reads {};
+            std::vector<const Genotype<Haplotype>*> genotypes {};
+            std::vector<std::vector<AlignedRead>> genotype_reads {};
+            genotypes.reserve(sample.genotypes.size());
+            genotype_reads.reserve(sample.genotypes.size());
             auto sample_reads_itr = std::begin(sample.reads);
             for (const auto& genotype : sample.genotypes) {
                 const auto padded_genotype_region = expand(mapped_region(genotype), 1);
                 const auto overlapped_reads = bases(overlap_range(sample_reads_itr, std::end(sample.reads), padded_genotype_region));
-                genotype_reads.assign(std::make_move_iterator(overlapped_reads.begin()),
-                                      std::make_move_iterator(overlapped_reads.end()));
+                genotypes.push_back(&genotype);
+                genotype_reads.emplace_back(std::make_move_iterator(overlapped_reads.begin()),
+                                            std::make_move_iterator(overlapped_reads.end()));
                 sample_reads_itr = sample.reads.erase(overlapped_reads.begin(), overlapped_reads.end());
-                auto bad_reads = to_annotated(remove_unalignable_reads(genotype_reads));
-                auto realignments = assign_and_realign(genotype_reads, genotype, reference, report);
-                report.n_reads_unassigned += bad_reads.size();
-                move_merge(bad_reads, realignments);
-                move_merge(realignments, realigned_reads);
+            }
+            // Genotypes own disjoint reads so can be realigned independently; merging in genotype order keeps the output sorted
+            std::vector<std::vector<AnnotatedAlignedRead>> genotype_realignments(genotypes.size());
+            std::vector<Report> genotype_reports(genotypes.size(), Report {});
+            parallel_for(&workers_, genotypes.size(), [&] (const std::size_t i) {
+                auto bad_reads = to_annotated(remove_unalignable_reads(genotype_reads[i]));
+                genotype_realignments[i] = assign_and_realign(genotype_reads[i], *genotypes[i], reference, genotype_reports[i]);
+                genotype_reports[i].n_reads_unassigned += bad_reads.size();
+                move_merge(bad_reads, genotype_realignments[i]);
+            });
+            std::vector<AnnotatedAlignedRead> realigned_reads {};
+            for (std::size_t i {0}; i < genotypes.size(); ++i) {
+                move_merge(genotype_realignments[i], realigned_reads);
+                report += genotype_reports[i];
             }
             move_merge(to_annotated(std::move(sample.reads)), realigned_reads);
             writer << realigned_reads;
@@ -325,6 +360,100 @@ void move_merge(std::vector<std::vector<AlignedRead>>& src, std::vector<std::vec
     }
 }
 
+// Sorts and writes batches of reads to one output on its own thread, so each output is written
+// concurrently with the others and with realignment. At most max_pending batches are queued.
+class ConcurrentReadWriter
+{
+public:
+    using WriterConfig = io::BufferedReadWriter<AlignedRead>::Config;
+    
+    ConcurrentReadWriter(io::ReadWriter& dst, WriterConfig config, std::size_t max_pending = 2)
+    : writer_ {dst, config}
+    , pending_ {}
+    , max_pending_ {std::max(max_pending, std::size_t {1})}
+    , closed_ {false}
+    , error_ {}
+    , mutex_ {}
+    , pending_cv_ {}
+    , space_cv_ {}
+    , thread_ {[this] () { run(); }}
+    {}
+    
+    ConcurrentReadWriter(const ConcurrentReadWriter&)            = delete;
+    ConcurrentReadWriter& operator=(const ConcurrentReadWriter&) = delete;
+    ConcurrentReadWriter(ConcurrentReadWriter&&)                 = delete;
+    ConcurrentReadWriter& operator=(ConcurrentReadWriter&&)      = delete;
+    
+    ~ConcurrentReadWriter()
+    {
+        try {
+            close();
+        } catch (...) {}
+    }
+    
+    // Rethrows the first write error
+    void write(std::vector<AlignedRead> reads)
+    {
+        if (reads.empty()) return;
+        std::unique_lock<std::mutex> lock {mutex_};
+        space_cv_.wait(lock, [this] () { return pending_.size() < max_pending_ || error_; });
+        if (error_) std::rethrow_exception(error_);
+        pending_.push_back(std::move(reads));
+        lock.unlock();
+        pending_cv_.notify_one();
+    }
+    
+    // Writes all queued reads, then rethrows the first write error
+    void close()
+    {
+        if (!thread_.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock {mutex_};
+            closed_ = true;
+        }
+        pending_cv_.notify_one();
+        thread_.join();
+        if (error_) std::rethrow_exception(error_);
+    }
+    
+private:
+    io::BufferedReadWriter<AlignedRead> writer_;
+    std::deque<std::vector<AlignedRead>> pending_;
+    std::size_t max_pending_;
+    bool closed_;
+    std::exception_ptr error_;
+    std::mutex mutex_;
+    std::condition_variable pending_cv_, space_cv_;
+    std::thread thread_;
+    
+    void run()
+    {
+        try {
+            for (;;) {
+                std::vector<AlignedRead> reads {};
+                {
+                    std::unique_lock<std::mutex> lock {mutex_};
+                    pending_cv_.wait(lock, [this] () { return !pending_.empty() || closed_; });
+                    if (pending_.empty()) break;
+                    reads = std::move(pending_.front());
+                    pending_.pop_front();
+                }
+                space_cv_.notify_one();
+                writer_.write(std::move(reads));
+            }
+            writer_.flush();
+        } catch (...) {
+            writer_.clear();
+            {
+                std::lock_guard<std::mutex> lock {mutex_};
+                error_ = std::current_exception();
+                pending_.clear();
+            }
+            space_cv_.notify_all();
+        }
+    }
+};
+
 } // namespace
 
 BAMRealigner::Report
@@ -334,38 +463,52 @@ BAMRealigner::realign(ReadReader& src, VcfReader& variants, std::vector<ReadWrit
     if (dsts.size() == 1) return realign(src, variants, dsts.front(), reference, samples);
     io::BufferedReadWriter<AlignedRead>::Config writer_config {};
     writer_config.max_buffer_footprint = config_.max_buffer.bytes() / dsts.size();
-    std::vector<io::BufferedReadWriter<AlignedRead>> writers {};
+    std::vector<std::unique_ptr<ConcurrentReadWriter>> writers {};
     writers.reserve(dsts.size());
-    for (auto& dst : dsts) writers.emplace_back(dst, writer_config);
+    for (auto& dst : dsts) writers.push_back(std::make_unique<ConcurrentReadWriter>(dst, writer_config));
     Report report {};
     BatchList batch {};
     boost::optional<GenomicRegion> batch_region {};
     for (auto p = variants.iterate(); p.first != p.second; ) {
         std::tie(batch, batch_region) = read_next_batch(p.first, p.second, src, reference, samples, batch_region);
         for (auto& sample : batch) {
-            std::vector<AlignedRead> genotype_reads {}, unassigned_realigned_reads {};
-            std::vector<std::vector<AlignedRead>> assigned_realigned_reads {};
+            std::vector<const Genotype<Haplotype>*> genotypes {};
+            std::vector<std::vector<AlignedRead>> genotype_reads {};
+            genotypes.reserve(sample.genotypes.size());
+            genotype_reads.reserve(sample.genotypes.size());
             auto sample_reads_itr = std::begin(sample.reads);
             for (const auto& genotype : sample.genotypes) {
                 const auto overlapped_reads = bases(overlap_range(sample_reads_itr, std::end(sample.reads), genotype));
-                genotype_reads.assign(std::make_move_iterator(overlapped_reads.begin()),
-                                      std::make_move_iterator(overlapped_reads.end()));
+                genotypes.push_back(&genotype);
+                genotype_reads.emplace_back(std::make_move_iterator(overlapped_reads.begin()),
+                                            std::make_move_iterator(overlapped_reads.end()));
                 sample_reads_itr = sample.reads.erase(overlapped_reads.begin(), overlapped_reads.end());
-                auto bad_reads = remove_unalignable_reads(genotype_reads);
-                auto realignments = split_and_realign(genotype_reads, genotype, report);
-                report.n_reads_unassigned += bad_reads.size();
-                move_merge(bad_reads, realignments.back());
+            }
+            std::vector<std::vector<std::vector<AlignedRead>>> genotype_realignments(genotypes.size());
+            std::vector<Report> genotype_reports(genotypes.size(), Report {});
+            parallel_for(&workers_, genotypes.size(), [&] (const std::size_t i) {
+                auto bad_reads = remove_unalignable_reads(genotype_reads[i]);
+                genotype_realignments[i] = split_and_realign(genotype_reads[i], *genotypes[i], genotype_reports[i]);
+                genotype_reports[i].n_reads_unassigned += bad_reads.size();
+                move_merge(bad_reads, genotype_realignments[i].back());
+            });
+            std::vector<AlignedRead> unassigned_realigned_reads {};
+            std::vector<std::vector<AlignedRead>> assigned_realigned_reads {};
+            for (std::size_t i {0}; i < genotypes.size(); ++i) {
+                auto& realignments = genotype_realignments[i];
                 move_merge(realignments.back(), unassigned_realigned_reads); // end is always unassigned, but ploidy can change
                 realignments.pop_back();
                 move_merge(realignments, assigned_realigned_reads);
+                report += genotype_reports[i];
             }
             move_merge(unassigned_realigned_reads, sample.reads);
             for (unsigned i {0}; i < assigned_realigned_reads.size(); ++i) {
-                writers[i] << assigned_realigned_reads[i];
+                writers[i]->write(std::move(assigned_realigned_reads[i]));
             }
-            writers.back() << sample.reads;
+            writers.back()->write(std::move(sample.reads));
         }
     }
+    for (auto& writer : writers) writer->close();
     return report;
 }
 
@@ -546,6 +689,16 @@ void BAMRealigner::merge(BatchList& src, BatchList& dst) const
 
 // non-member methods
 
+namespace {
+
+std::unique_ptr<io::HtslibThreadPool> make_compression_threads(const BAMRealigner::Config& config)
+{
+    const auto num_threads = get_pool_size(config);
+    return num_threads > 0 ? std::make_unique<io::HtslibThreadPool>(num_threads) : nullptr;
+}
+
+} // namespace
+
 BAMRealigner::Report realign(io::ReadReader::Path src, VcfReader::Path variants, io::ReadWriter::Path dst,
                              const ReferenceGenome& reference)
 {
@@ -555,7 +708,8 @@ BAMRealigner::Report realign(io::ReadReader::Path src, VcfReader::Path variants,
 BAMRealigner::Report realign(io::ReadReader::Path src, VcfReader::Path variants, io::ReadWriter::Path dst,
                              const ReferenceGenome& reference, BAMRealigner::Config config)
 {
-    io::ReadWriter dst_bam {std::move(dst), src};
+    const auto compression_threads = make_compression_threads(config);
+    io::ReadWriter dst_bam {std::move(dst), src, compression_threads.get()};
     io::ReadReader src_bam {std::move(src)};
     VcfReader vcf {std::move(variants)};
     BAMRealigner realigner {std::move(config)};
@@ -571,10 +725,12 @@ BAMRealigner::Report realign(io::ReadReader::Path src, VcfReader::Path variants,
 BAMRealigner::Report realign(io::ReadReader::Path src, VcfReader::Path variants, std::vector<io::ReadWriter::Path> dsts,
                              const ReferenceGenome& reference, BAMRealigner::Config config)
 {
+    // One pool compresses every output, so threads aren't left idle when outputs fill unevenly
+    const auto compression_threads = make_compression_threads(config);
     std::vector<io::ReadWriter> dst_bams {};
     dst_bams.reserve(dsts.size());
     for (auto& dst : dsts) {
-        dst_bams.emplace_back(std::move(dst), src);
+        dst_bams.emplace_back(std::move(dst), src, compression_threads.get());
     }
     io::ReadReader src_bam {std::move(src)};
     VcfReader vcf {std::move(variants)};
@@ -86,6 +86,8 @@ private:
     void merge(BatchList& src, BatchList& dst) const;
 };
 
+BAMRealigner::Report& operator+=(BAMRealigner::Report& lhs, const BAMRealigner::Report& rhs) noexcept;
+
 BAMRealigner::Report realign(io::ReadReader::Path src, VcfReader::Path variants, io::ReadWriter::Path dst,
                              const ReferenceGenome& reference);
 BAMRealigner::Report realign(io::ReadReader::Path src, VcfReader::Path variants, io::ReadWriter::Path dst,
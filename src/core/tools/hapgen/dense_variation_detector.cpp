@@ -33,6 +33,9 @@ DenseVariationDetector::DenseVariationDetector(Parameters params, boost::optiona
 
 namespace {
 
+// Dense regions are only reported if they contain more than these many variants
+constexpr unsigned minSkipVariantCount {100}, minRestrictVariantCount {50};
+
 struct AlleleBlock : public Mappable<AlleleBlock>, public Comparable<AlleleBlock>
 {
     ContigRegion region;
@@ -274,15 +277,28 @@ auto join_dense_regions(const MappableFlatSet<GenomicRegion>& dense_regions,
     }
 }
 
+GenomicRegion::Size max_mapped_read_size(const ReadMap& reads)
+{
+    GenomicRegion::Size result {0};
+    for (const auto& p : reads) {
+        if (!p.second.empty()) result = std::max(result, region_size(*largest_mappable(p.second)));
+    }
+    return result;
+}
+
 } // namespace
 
 std::vector<DenseVariationDetector::DenseRegion>
 DenseVariationDetector::detect(const MappableFlatSet<Variant>& variants, const ReadMap& reads,
                                boost::optional<const ReadPipe::Report&> reads_report) const
 {
+    if (variants.size() <= minRestrictVariantCount) return {};
     const auto average_read_length = mean_read_length(reads);
     auto expected_log_count = get_max_expected_log_allele_count_per_base();
     const auto dense_zone_log_count_threshold = expected_log_count * average_read_length;
+    // Allele blocks are only merged within a read, and a block of n variants has log count at most n,
+    // so no block can seed a dense region unless some read sized window has enough variants
+    if (max_window_count(variants, max_mapped_read_size(reads)) <= dense_zone_log_count_threshold) return {};
     auto dense_regions = find_dense_regions(variants, reads, dense_zone_log_count_threshold, 1);
     if (dense_regions.empty()) return {};
     auto joined_dense_regions = join_dense_regions(dense_regions, variants, reads);
@@ -302,9 +318,9 @@ DenseVariationDetector::detect(const MappableFlatSet<Variant>& variants, const R
             const auto mean_downsample_depth = static_cast<double>(num_downsampled_reads) / size(state.region);
             total_mean_depth += mean_downsample_depth;
         }
-        if (state.variant_count > 100 && size(state.region) > average_read_length && total_mean_depth > max_expected_coverage) {
+        if (state.variant_count > minSkipVariantCount && size(state.region) > average_read_length && total_mean_depth > max_expected_coverage) {
             result.push_back({region, DenseRegion::RecommendedAction::skip});
-        } else if (state.variant_count > 50
+        } else if (state.variant_count > minRestrictVariantCount
             && reads_profile_
             && std::min(state.median_mapping_quality, state.rmq_mapping_quality)
               < std::max(reads_profile_->median_mapping_quality, reads_profile_->rmq_mapping_quality)
@@ -319,6 +335,20 @@ DenseVariationDetector::detect(const MappableFlatSet<Variant>& variants, const R
     return result;
 }
 
+std::size_t DenseVariationDetector::max_window_count(const MappableFlatSet<Variant>& variants, const GenomicRegion::Size window_size)
+{
+    if (variants.empty()) return 0;
+    // Variants overlapping a window begin at most the largest variant size before it
+    const auto max_begin_distance = window_size + region_size(*largest_mappable(variants));
+    std::size_t result {0};
+    auto window_begin_itr = std::cbegin(variants);
+    for (auto itr = std::cbegin(variants); itr != std::cend(variants); ++itr) {
+        while (mapped_begin(*itr) - mapped_begin(*window_begin_itr) > max_begin_distance) ++window_begin_itr;
+        result = std::max(result, static_cast<std::size_t>(std::distance(window_begin_itr, itr)) + 1);
+    }
+    return result;
+}
+
 double DenseVariationDetector::get_max_expected_log_allele_count_per_base() const noexcept
 {
     using Tolerance = Parameters::Tolerance;
@@ -5,6 +5,7 @@
 #define dense_variation_detector_hpp
 
 #include <vector>
+#include <cstddef>
 
 #include <boost/optional.hpp>
 
@@ -47,6 +48,10 @@ public:
     std::vector<DenseRegion>
     detect(const MappableFlatSet<Variant>& variants, const ReadMap& reads,
            boost::optional<const ReadPipe::Report&> reads_report = boost::none) const;
+    
+    // An upper bound on the number of variants overlapping any window of the given size, computed
+    // with a single sliding window pass over the (sorted) variants.
+    static std::size_t max_window_count(const MappableFlatSet<Variant>& variants, GenomicRegion::Size window_size);
 
 private:
     Parameters params_;
@@ -19,7 +19,6 @@
 #include "utils/append.hpp"
 
 #include <iostream> // DEBUG
-#include "timers.hpp"
 
 #define _unused(x) ((void)(x))
 
@@ -133,6 +132,7 @@ HaplotypeGenerator::HaplotypeGenerator(const ReferenceGenome& reference,
                                        Policies policies,
                                        DenseVariationDetector dense_variation_detector)
 : policies_ {std::move(policies)}
+, reference_ {reference}
 , tree_ {get_contig(candidates), reference}
 , default_walker_ {
     max_included(policies_.haplotype_limits.target),
@@ -959,6 +959,12 @@ void HaplotypeGenerator::populate_tree_with_novel_alleles()
         if (last_added_novel_itr != std::cend(novel_active_alleles)) {
             last_added_novel_itr = extend_tree_until(last_added_novel_itr, std::cend(novel_active_alleles), tree_,
                                                      policies_.haplotype_limits.overflow);
+            if (last_added_novel_itr != std::cend(novel_active_alleles)
+                && policies_.overflow == Policies::Overflow::prune) {
+                extend_tree_with_best_supported({std::cbegin(novel_active_alleles), std::cend(novel_active_alleles)},
+                                                novel_active_region);
+                last_added_novel_itr = std::cend(novel_active_alleles);
+            }
             if (last_added_novel_itr != std::cend(novel_active_alleles)) {
                 if (in_holdout_mode()) {
                     active_region_ = encompassing_region(active_region_, tree_.encompassing_region());
@@ -1248,6 +1254,70 @@ void HaplotypeGenerator::resolve_sandwich_insertion()
     active_region_ = tree_.encompassing_region();
 }
 
+namespace {
+
+// Cheap evidence: the number of reads whose aligned bases over the allele match it
+std::size_t count_supporting_reads(const Allele& allele, const ReadMap& reads)
+{
+    std::size_t result {0};
+    for (const auto& p : reads) {
+        for (const auto& read : overlap_range(p.second, allele)) {
+            if (contains(read, allele) && copy_sequence(read, mapped_region(allele)) == allele.sequence()) {
+                ++result;
+            }
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+void HaplotypeGenerator::extend_tree_with_best_supported(std::vector<Allele> novel_alleles, const GenomicRegion& novel_region)
+{
+    tree_.clear(novel_region);
+    // Each novel allele at most doubles the number of haplotypes
+    unsigned max_novel_alleles {1};
+    for (auto n = std::max(tree_.num_haplotypes(), std::size_t {1}); 4 * n <= policies_.haplotype_limits.holdout; n *= 2) {
+        ++max_novel_alleles;
+    }
+    const auto first_novel = std::stable_partition(std::begin(novel_alleles), std::end(novel_alleles),
+                                                   [this] (const Allele& allele) { return is_reference(allele, reference_); });
+    if (static_cast<std::size_t>(std::distance(first_novel, std::end(novel_alleles))) > max_novel_alleles) {
+        std::vector<std::pair<Allele, std::size_t>> supports {};
+        supports.reserve(std::distance(first_novel, std::end(novel_alleles)));
+        std::transform(std::make_move_iterator(first_novel), std::make_move_iterator(std::end(novel_alleles)),
+                       std::back_inserter(supports),
+                       [this] (Allele&& allele) {
+                           const auto support = count_supporting_reads(allele, reads_);
+                           return std::make_pair(std::move(allele), support);
+                       });
+        novel_alleles.erase(first_novel, std::end(novel_alleles));
+        bool dropped_rightmost {false};
+        std::stable_sort(std::begin(supports), std::end(supports),
+                         [] (const auto& lhs, const auto& rhs) { return lhs.second > rhs.second; });
+        for (std::size_t i {0}; i < supports.size(); ++i) {
+            if (i < max_novel_alleles) {
+                novel_alleles.push_back(std::move(supports[i].first));
+            } else {
+                if (supports[i].first == rightmost_allele_) dropped_rightmost = true;
+                alleles_.erase(supports[i].first);
+            }
+        }
+        if (debug_log_) {
+            stream(*debug_log_) << "Dropped " << (supports.size() - max_novel_alleles) << " of " << supports.size()
+                                << " novel alleles with least read support in " << novel_region
+                                << " to stay within the haplotype limit";
+        }
+        std::sort(std::begin(novel_alleles), std::end(novel_alleles));
+        if (dropped_rightmost && !alleles_.empty()) rightmost_allele_ = alleles_.rightmost();
+    }
+    const auto last_added = extend_tree_until(std::cbegin(novel_alleles), std::cend(novel_alleles), tree_,
+                                              policies_.haplotype_limits.overflow);
+    if (last_added != std::cend(novel_alleles)) {
+        throw HaplotypeOverflow {novel_region, tree_.num_haplotypes()};
+    }
+}
+
 template <typename Range>
 auto calculate_haplotype_reference_distance_lower_bound(const Range& alleles)
 {
@@ -1290,6 +1360,10 @@ GenomicRegion HaplotypeGenerator::calculate_haplotype_region() const
                 rhs_expansion = min_flank_padding - diff;
             }
         }
+        if (policies_.max_read_flank) {
+            lhs_expansion = std::min(lhs_expansion, *policies_.max_read_flank + min_flank_padding);
+            rhs_expansion = std::min(rhs_expansion, *policies_.max_read_flank + min_flank_padding);
+        }
         if (active_region_.begin() < lhs_expansion) {
             rhs_expansion += lhs_expansion - active_region_.begin();
             lhs_expansion = active_region_.begin();
@@ -1335,6 +1409,12 @@ HaplotypeGenerator::Builder& HaplotypeGenerator::Builder::set_overflow_limit(con
     return *this;
 }
 
+HaplotypeGenerator::Builder& HaplotypeGenerator::Builder::set_overflow_policy(const Policies::Overflow policy) noexcept
+{
+    policies_.overflow = policy;
+    return *this;
+}
+
 HaplotypeGenerator::Builder& HaplotypeGenerator::Builder::set_max_holdout_depth(const unsigned n) noexcept
 {
     policies_.max_holdout_depth = n;
@@ -1347,6 +1427,12 @@ HaplotypeGenerator::Builder& HaplotypeGenerator::Builder::set_min_flank_pad(cons
     return *this;
 }
 
+HaplotypeGenerator::Builder& HaplotypeGenerator::Builder::set_max_read_flank(const Haplotype::MappingDomain::Size n) noexcept
+{
+    policies_.max_read_flank = n;
+    return *this;
+}
+
 HaplotypeGenerator::Builder& HaplotypeGenerator::Builder::set_max_indicator_join_distance(Haplotype::NucleotideSequence::size_type n) noexcept
 {
     policies_.max_indicator_join_distance = n;
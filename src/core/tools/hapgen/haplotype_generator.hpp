@@ -43,8 +43,14 @@ public:
         enum class Lagging { none, conservative, moderate, normal, aggressive } lagging = Lagging::normal;
         enum class Extension { conservative, normal, optimistic, aggressive } extension = Extension::normal;
         struct HaplotypeLimits { unsigned target = 128, holdout = 2048, overflow = 8192; } haplotype_limits;
+        // When the overflow limit is reached either skip the region, or keep only the best supported
+        // novel alleles so that the haplotype count stays within the holdout limit
+        enum class Overflow { skip, prune } overflow = Overflow::prune;
         unsigned max_holdout_depth = 2;
         Haplotype::MappingDomain::Size min_flank_pad = 30;
+        // If set, haplotypes extend at most this far (plus padding) beyond the active region, rather than
+        // covering every overlapping read. Reads must then be clipped to the haplotypes before evaluation.
+        boost::optional<Haplotype::MappingDomain::Size> max_read_flank = boost::none;
         boost::optional<Haplotype::NucleotideSequence::size_type> max_indicator_join_distance = boost::none;
         boost::optional<double> max_expected_log_allele_count_per_base = boost::none;
     };
@@ -120,6 +126,7 @@ private:
     
     Policies policies_;
     
+    std::reference_wrapper<const ReferenceGenome> reference_;
     HaplotypeTree tree_;
     GenomeWalker default_walker_, holdout_walker_;
     boost::optional<GenomeWalker> lagged_walker_;
@@ -161,6 +168,7 @@ private:
     void reintroduce_holdouts();
     void clear_holdouts() noexcept;
     void resolve_sandwich_insertion();
+    void extend_tree_with_best_supported(std::vector<Allele> novel_alleles, const GenomicRegion& novel_region);
     GenomicRegion calculate_haplotype_region() const;
 };
 
@@ -229,8 +237,10 @@ public:
     Builder& set_target_limit(unsigned n) noexcept;
     Builder& set_holdout_limit(unsigned n) noexcept;
     Builder& set_overflow_limit(unsigned n) noexcept;
+    Builder& set_overflow_policy(Policies::Overflow policy) noexcept;
     Builder& set_max_holdout_depth(unsigned n) noexcept;
     Builder& set_min_flank_pad(Haplotype::MappingDomain::Size n) noexcept;
+    Builder& set_max_read_flank(Haplotype::MappingDomain::Size n) noexcept;
     Builder& set_max_indicator_join_distance(Haplotype::NucleotideSequence::size_type n) noexcept;
     Builder& set_max_expected_log_allele_count_per_base(double v) noexcept;
     Builder& set_dense_variation_detector(DenseVariationDetector detector) noexcept;
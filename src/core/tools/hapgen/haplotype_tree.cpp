@@ -4,28 +4,25 @@
 #include "haplotype_tree.hpp"
 
 #include <deque>
-#include <stack>
 #include <stdexcept>
 #include <cassert>
 #include <iostream>
-
-#include <boost/property_map/property_map.hpp>
-#include <boost/graph/breadth_first_search.hpp>
-#include <boost/graph/depth_first_search.hpp>
-#include <boost/graph/visitors.hpp>
-#include <boost/graph/copy.hpp>
-#include <boost/graph/graphviz.hpp>
+#include <fstream>
 
 #include "io/reference/reference_genome.hpp"
 #include "utils/mappable_algorithms.hpp"
 
 namespace octopus { namespace coretools {
 
+constexpr HaplotypeTree::Vertex HaplotypeTree::null_vertex;
+
 HaplotypeTree::HaplotypeTree(const GenomicRegion::ContigName& contig, const ReferenceGenome& reference)
 : reference_ {reference}
-, tree_ {}
-, root_ {boost::add_vertex(tree_)}
-, haplotype_leafs_ {root_}
+, nodes_ {}
+, free_vertices_ {}
+, root_ {}
+, haplotype_leafs_ {}
+, leaf_buffer_ {}
 , contig_ {contig}
 , haplotype_leaf_cache_ {}
 , tree_region_ {}
@@ -34,78 +31,8 @@ HaplotypeTree::HaplotypeTree(const GenomicRegion::ContigName& contig, const Refe
         throw std::invalid_argument {"HaplotypeTree: constructed with contig "
             + contig + " which is not in the reference " + reference.name()};
     }
-}
-
-namespace debug {
-
-template <typename G, typename V, typename Container>
-bool is_tree(const G& graph, const V& root, const Container& leafs);
-
-} // namespace debug
-
-namespace {
-
-template <typename Graph>
-bool is_empty(const Graph& g)
-{
-    return boost::num_vertices(g) == 0 && boost::num_edges(g) == 0;
-}
-
-template <typename Graph>
-auto copy_graph(const Graph& src, Graph& dst)
-{
-    assert(is_empty(dst));
-    using Vertex = typename boost::graph_traits<Graph>::vertex_descriptor;
-    std::unordered_map<Vertex, std::size_t> index_map {};
-    index_map.reserve(boost::num_vertices(src));
-    const auto p = boost::vertices(src);
-    std::size_t i {0};
-    std::for_each(p.first, p.second, [&i, &index_map] (const Vertex& v) { index_map.emplace(v, i++); });
-    std::unordered_map<Vertex, Vertex> vertex_copy_map {};
-    vertex_copy_map.reserve(boost::num_vertices(src));
-    boost::copy_graph(src, dst,
-                      boost::vertex_index_map(boost::make_assoc_property_map(index_map))
-                      .orig_to_copy(boost::make_assoc_property_map(vertex_copy_map)));
-    assert(vertex_copy_map.size() == boost::num_vertices(src));
-    return vertex_copy_map;
-}
-
-template <typename Container, typename Map>
-void copy_leafs(const Container& src, Container& dst, const Map& vertex_copy_map)
-{
-    assert(dst.empty());
-    std::transform(std::cbegin(src), std::cend(src), std::back_inserter(dst),
-                   [&vertex_copy_map] (const auto& v) { return vertex_copy_map.at(v); });
-}
-
-} // namespace
-
-HaplotypeTree::HaplotypeTree(const HaplotypeTree& other)
-: reference_ {other.reference_}
-, tree_ {}
-, root_ {}
-, haplotype_leafs_ {}
-, contig_ {other.contig_}
-, haplotype_leaf_cache_ {}
-{
-    const auto vertex_copy_map = copy_graph(other.tree_, tree_);
-    root_ = vertex_copy_map.at(other.root_);
-    copy_leafs(other.haplotype_leafs_, haplotype_leafs_, vertex_copy_map);
-}
-
-HaplotypeTree& HaplotypeTree::operator=(const HaplotypeTree& other)
-{
-    if (&other == this) return *this;
-    tree_.clear();
-    haplotype_leafs_.clear();
-    haplotype_leaf_cache_.clear();
-    reference_ = other.reference_;
-    contig_    = other.contig_;
-    const auto vertex_copy_map = copy_graph(other.tree_, tree_);
-    root_ = vertex_copy_map.at(other.root_);
-    copy_leafs(other.haplotype_leafs_, haplotype_leafs_, vertex_copy_map);
-    assert(debug::is_tree(tree_, root_, haplotype_leafs_));
-    return *this;
+    root_ = add_vertex(ContigAllele {});
+    haplotype_leafs_.push_back(root_);
 }
 
 bool HaplotypeTree::is_empty() const noexcept
@@ -158,9 +85,12 @@ bool HaplotypeTree::is_unique(const Haplotype& haplotype) const
 
 HaplotypeTree& HaplotypeTree::extend(const ContigAllele& allele)
 {
-    for (auto leaf_itr = std::cbegin(haplotype_leafs_); leaf_itr != std::cend(haplotype_leafs_); ++leaf_itr) {
-        leaf_itr = extend_haplotype(leaf_itr, allele);
+    leaf_buffer_.clear();
+    leaf_buffer_.reserve(2 * haplotype_leafs_.size());
+    for (const auto leaf : haplotype_leafs_) {
+        extend_haplotype(leaf, allele, leaf_buffer_);
     }
+    std::swap(haplotype_leafs_, leaf_buffer_);
     haplotype_leaf_cache_.clear();
     tree_region_ = boost::none;
     return *this;
@@ -174,54 +104,17 @@ HaplotypeTree& HaplotypeTree::extend(const Allele& allele)
     return extend(demote(allele));
 }
 
-template <typename Container, typename V>
-struct Splicer : public boost::default_dfs_visitor
-{
-    Splicer(const ContigAllele& allele, std::stack<V>& candidate_splice_sites, Container& splice_sites,
-            V root)
-    : allele_ {allele}
-    , candidate_splice_sites_ {candidate_splice_sites}
-    , splice_sites_ {splice_sites}
-    , root_ {root}
-    {}
-    
-    template <typename G>
-    void finish_vertex(const V v, const G& tree)
-    {
-        if (!candidate_splice_sites_.empty() && v == candidate_splice_sites_.top()) {
-            candidate_splice_sites_.pop();
-            if (v == root_ || is_after(allele_.get(), tree[v])) {
-                splice_sites_.push_back(v);
-            } else {
-                const auto u = *boost::inv_adjacent_vertices(v, tree).first;
-                if (candidate_splice_sites_.empty() || candidate_splice_sites_.top() != u) {
-                    candidate_splice_sites_.push(u);
-                }
-            }
-        }
-    }
-private:
-    std::reference_wrapper<const ContigAllele> allele_;
-    std::stack<V>& candidate_splice_sites_;
-    Container& splice_sites_;
-    V root_;
-};
+namespace {
 
-template <typename Container, typename V>
-auto make_splicer(const ContigAllele& allele, std::stack<V>& candidate_splice_sites,
-                  Container& splice_sites, V root)
+bool is_possible_splice_site(const ContigAllele& allele, const ContigAllele& site, const bool is_leaf)
 {
-    return Splicer<Container, V> {allele, candidate_splice_sites, splice_sites, root};
+    // Can allele go before site in the tree?
+    return begins_before(allele, site)
+           || (is_leaf && overlaps(allele, site))
+           || (begins_equal(allele, site) && (!is_empty_region(site) || (is_insertion(site) && is_deletion(allele))));
 }
 
-template <typename V, typename G>
-bool is_possible_splice_site(const ContigAllele& allele, const V& v, const G& tree)
-{
-    // Can allele go before v in the tree?
-    return begins_before(allele, tree[v])
-           || (boost::out_degree(v, tree) == 0 && overlaps(allele, tree[v]))
-           || (begins_equal(allele, tree[v]) && (!is_empty_region(tree[v]) || (is_insertion(tree[v]) && is_deletion(allele))));
-}
+} // namespace
 
 bool is_deletion_and_insertion(const ContigAllele& new_allele, const ContigAllele& leaf)
 {
@@ -239,34 +132,48 @@ void HaplotypeTree::splice(const ContigAllele& allele)
         extend(allele);
         return;
     }
-    std::unordered_map<Vertex, boost::default_color_type> colours {};
-    colours.reserve(boost::num_vertices(tree_));
-    std::deque<Vertex> splice_sites {};
-    std::stack<Vertex> candidate_splice_sites {};
-    boost::depth_first_visit(tree_, root_,
-                             make_splicer(allele, candidate_splice_sites, splice_sites, root_),
-                             boost::make_assoc_property_map(colours),
-                             [&] (const Vertex v, const Tree& tree) -> bool {
-                                 if (v != root_) {
-                                     if (is_possible_splice_site(allele, v, tree_)) {
-                                         const auto p = boost::inv_adjacent_vertices(v, tree);
-                                         if (p.first != p.second) {
-                                             const auto u = *p.first;
-                                             if (candidate_splice_sites.empty() || candidate_splice_sites.top() != u) {
-                                                 candidate_splice_sites.push(u);
-                                             }
-                                         }
-                                         return true;
-                                     }
-                                 }
-                                 return false;
-                             });
+    std::vector<Vertex> splice_sites {}, candidate_splice_sites {};
+    const auto push_candidate = [&] (const Vertex u) {
+        if (candidate_splice_sites.empty() || candidate_splice_sites.back() != u) {
+            candidate_splice_sites.push_back(u);
+        }
+    };
+    // Returns the first child to visit, the subtree below a possible splice site is not searched
+    const auto discover = [&] (const Vertex v) {
+        if (v != root_ && is_possible_splice_site(allele, nodes_[v].allele, is_leaf(v))) {
+            push_candidate(nodes_[v].parent);
+            return null_vertex;
+        }
+        return nodes_[v].first_child;
+    };
+    const auto finish = [&] (const Vertex v) {
+        if (!candidate_splice_sites.empty() && v == candidate_splice_sites.back()) {
+            candidate_splice_sites.pop_back();
+            if (v == root_ || is_after(allele, nodes_[v].allele)) {
+                splice_sites.push_back(v);
+            } else {
+                push_candidate(nodes_[v].parent);
+            }
+        }
+    };
+    // Depth first search visiting children in insertion order; each entry is a vertex and its next child
+    std::vector<std::pair<Vertex, Vertex>> stack {};
+    stack.emplace_back(root_, discover(root_));
+    while (!stack.empty()) {
+        const auto child = stack.back().second;
+        if (child != null_vertex) {
+            stack.back().second = nodes_[child].next_sibling;
+            const auto first_grandchild = discover(child);
+            stack.emplace_back(child, first_grandchild);
+        } else {
+            finish(stack.back().first);
+            stack.pop_back();
+        }
+    }
     assert(candidate_splice_sites.empty());
     for (const auto v : splice_sites) {
-        if (can_add_to_branch(allele, tree_[v])) {
-            const auto spliced = boost::add_vertex(allele, tree_);
-            boost::add_edge(v, spliced, tree_);
-            haplotype_leafs_.push_back(spliced);
+        if (can_add_to_branch(allele, nodes_[v].allele)) {
+            haplotype_leafs_.push_back(add_vertex(allele, v));
         }
     }
     tree_region_ = boost::none;
@@ -282,19 +189,6 @@ void HaplotypeTree::splice(const Allele& allele)
 
 namespace {
 
-template <typename InputIterator, typename Compare>
-decltype(auto) min_value(InputIterator first, InputIterator last, Compare comp)
-{
-    auto result = *first;
-    ++first;
-    for (; first != last; ++first) {
-        if (comp(*first, result)) {
-            result = *first;
-        }
-    }
-    return result;
-}
-
 template <typename InputIterator, typename Compare>
 decltype(auto) max_value(InputIterator first, InputIterator last, Compare comp)
 {
@@ -316,12 +210,13 @@ GenomicRegion HaplotypeTree::encompassing_region() const
     if (is_empty()) {
         throw std::runtime_error {"HaplotypeTree::encompassing_region called on empty tree"};
     }
-    const auto p = boost::adjacent_vertices(root_, tree_);
-    const auto leftmost = min_value(p.first, p.second, [this] (const auto& lhs, const auto& rhs) {
-                                    return begins_before(tree_[lhs], tree_[rhs]); });
+    auto leftmost = nodes_[root_].first_child;
+    for (auto v = nodes_[leftmost].next_sibling; v != null_vertex; v = nodes_[v].next_sibling) {
+        if (begins_before(nodes_[v].allele, nodes_[leftmost].allele)) leftmost = v;
+    }
     const auto rightmost = max_value(std::cbegin(haplotype_leafs_), std::cend(haplotype_leafs_),
-                                    [this] (const auto& lhs, const auto& rhs) { return ends_before(tree_[lhs], tree_[rhs]); });
-    tree_region_ = GenomicRegion {contig_, octopus::encompassing_region(tree_[leftmost], tree_[rightmost])};
+                                    [this] (const auto& lhs, const auto& rhs) { return ends_before(nodes_[lhs].allele, nodes_[rhs].allele); });
+    tree_region_ = GenomicRegion {contig_, octopus::encompassing_region(nodes_[leftmost].allele, nodes_[rightmost].allele)};
     return *tree_region_;
 }
 
@@ -335,11 +230,18 @@ std::vector<Haplotype> HaplotypeTree::extract_haplotypes() const
 }
 
 std::vector<Haplotype> HaplotypeTree::extract_haplotypes(const GenomicRegion& region) const
+{
+    std::vector<Haplotype> result {};
+    extract_haplotypes(region, result);
+    return result;
+}
+
+void HaplotypeTree::extract_haplotypes(const GenomicRegion& region, std::vector<Haplotype>& result) const
 {
     haplotype_leaf_cache_.clear();
     haplotype_leaf_cache_.reserve(num_haplotypes());
-    std::vector<Haplotype> result {};
-    if (is_empty() || !overlaps(region, encompassing_region())) return result;
+    result.clear();
+    if (is_empty() || !overlaps(region, encompassing_region())) return;
     result.reserve(num_haplotypes());
     for (const auto leaf : haplotype_leafs_) {
         auto haplotype = extract_haplotype(leaf, region);
@@ -348,7 +250,6 @@ std::vector<Haplotype> HaplotypeTree::extract_haplotypes(const GenomicRegion& re
         haplotype_leaf_cache_.emplace(haplotype, leaf);
         result.push_back(std::move(haplotype));
     }
-    return result;
 }
 
 std::vector<HaplotypeTree::HaplotypeLength> HaplotypeTree::extract_haplotype_lengths() const
@@ -371,7 +272,7 @@ std::vector<HaplotypeTree::HaplotypeLength> HaplotypeTree::extract_haplotype_len
 
 void HaplotypeTree::prune_all(const Haplotype& haplotype)
 {
-    using std::cbegin; using std::cend; using std::for_each; using std::find;
+    using std::begin; using std::end; using std::for_each; using std::find;
     if (is_empty() || contig_name(haplotype) != contig_) return;
     // If any of the haplotypes in cache match the query haplotype then the cache must contain
     // all possible leaves corrosponding to that haplotype. So we don't need to look through
@@ -382,22 +283,24 @@ void HaplotypeTree::prune_all(const Haplotype& haplotype)
         for_each(possible_leafs.first, possible_leafs.second,
                  [this, &haplotype] (const HaplotypeVertexMultiMap::value_type& leaf_pair) {
                      const auto p = clear(leaf_pair.second, contig_region(haplotype));
-                     auto leaf_itr = find(cbegin(haplotype_leafs_), cend(haplotype_leafs_), leaf_pair.second);
-                     leaf_itr = haplotype_leafs_.erase(leaf_itr);
+                     auto leaf_itr = find(begin(haplotype_leafs_), end(haplotype_leafs_), leaf_pair.second);
                      if (p.second) {
-                         haplotype_leafs_.insert(leaf_itr, p.first);
+                         *leaf_itr = p.first;
+                     } else {
+                         haplotype_leafs_.erase(leaf_itr);
                      }
                  });
         haplotype_leaf_cache_.erase(haplotype);
     } else {
-        auto leaf_itr = cbegin(haplotype_leafs_);
+        auto leaf_itr = begin(haplotype_leafs_);
         while (true) {
-            leaf_itr = find_equal_haplotype_leaf(leaf_itr, cend(haplotype_leafs_), haplotype);
-            if (leaf_itr == cend(haplotype_leafs_)) return;
+            leaf_itr = find_equal_haplotype_leaf(leaf_itr, end(haplotype_leafs_), haplotype);
+            if (leaf_itr == end(haplotype_leafs_)) return;
             const auto p = clear(*leaf_itr, contig_region(haplotype));
-            leaf_itr = haplotype_leafs_.erase(leaf_itr);
             if (p.second) {
-                leaf_itr = haplotype_leafs_.insert(leaf_itr, p.first);
+                *leaf_itr = p.first;
+            } else {
+                leaf_itr = haplotype_leafs_.erase(leaf_itr);
             }
         }
     }
@@ -405,7 +308,7 @@ void HaplotypeTree::prune_all(const Haplotype& haplotype)
 
 void HaplotypeTree::prune_unique(const Haplotype& haplotype)
 {
-    using std::cbegin; using std::cend; using std::for_each;
+    using std::begin; using std::end;
     if (is_empty()) return;
     tree_region_ = boost::none;
     if (haplotype_leaf_cache_.count(haplotype) > 0) {
@@ -417,33 +320,40 @@ void HaplotypeTree::prune_unique(const Haplotype& haplotype)
         if (match_itr == possible_leafs.second) {
             throw std::runtime_error {"HaplotypeTree::prune_unique called with matching Haplotype not in tree"};
         }
-        const auto leaf_to_keep_itr = match_itr->second;
+        const auto leaf_to_keep = match_itr->second;
         std::for_each(possible_leafs.first, possible_leafs.second,
-                      [this, &haplotype, leaf_to_keep_itr] (HaplotypeVertexMultiMap::value_type& leaf_pair) {
-                          if (leaf_pair.second != leaf_to_keep_itr) {
+                      [this, &haplotype, leaf_to_keep] (HaplotypeVertexMultiMap::value_type& leaf_pair) {
+                          if (leaf_pair.second != leaf_to_keep) {
                               const auto p = clear(leaf_pair.second, contig_region(haplotype));
-                              auto leaf_itr = std::find(cbegin(haplotype_leafs_), cend(haplotype_leafs_), leaf_pair.second);
-                              leaf_itr = haplotype_leafs_.erase(leaf_itr);
-                              if (p.second) haplotype_leafs_.insert(leaf_itr, p.first);
+                              auto leaf_itr = std::find(begin(haplotype_leafs_), end(haplotype_leafs_), leaf_pair.second);
+                              if (p.second) {
+                                  *leaf_itr = p.first;
+                              } else {
+                                  haplotype_leafs_.erase(leaf_itr);
+                              }
                           }
                       });
         haplotype_leaf_cache_.erase(haplotype);
-        haplotype_leaf_cache_.emplace(haplotype, leaf_to_keep_itr);
+        haplotype_leaf_cache_.emplace(haplotype, leaf_to_keep);
     } else {
-        auto leaf_itr = cbegin(haplotype_leafs_);
-        const auto leaf_to_keep_itr = find_exact_haplotype_leaf(leaf_itr, cend(haplotype_leafs_), haplotype);
+        const auto keep_itr = find_exact_haplotype_leaf(begin(haplotype_leafs_), end(haplotype_leafs_), haplotype);
+        const auto leaf_to_keep = keep_itr != end(haplotype_leafs_) ? *keep_itr : null_vertex;
+        auto leaf_itr = begin(haplotype_leafs_);
         while (true) {
-            leaf_itr = find_equal_haplotype_leaf(leaf_itr, cend(haplotype_leafs_), haplotype);
-            if (leaf_itr == cend(haplotype_leafs_)) {
+            leaf_itr = find_equal_haplotype_leaf(leaf_itr, end(haplotype_leafs_), haplotype);
+            if (leaf_itr == end(haplotype_leafs_)) {
                 return;
             }
-            if (leaf_itr == leaf_to_keep_itr) {
+            if (*leaf_itr == leaf_to_keep) {
                 std::advance(leaf_itr, 1);
                 continue;
             }
             const auto p = clear(*leaf_itr, contig_region(haplotype));
-            leaf_itr = haplotype_leafs_.erase(leaf_itr);
-            if (p.second) leaf_itr = haplotype_leafs_.insert(leaf_itr, p.first);
+            if (p.second) {
+                *leaf_itr = p.first;
+            } else {
+                leaf_itr = haplotype_leafs_.erase(leaf_itr);
+            }
         }
     }
 }
@@ -462,17 +372,22 @@ void HaplotypeTree::clear(const GenomicRegion& region)
 void HaplotypeTree::clear() noexcept
 {
     haplotype_leaf_cache_.clear();
-    haplotype_leafs_.clear();
-    tree_.clear();
-    root_ = boost::add_vertex(tree_);
-    haplotype_leafs_.push_back(root_);
+    // Every node but the root is recycled, keeping its storage for the next region
+    free_vertices_.clear();
+    for (auto v = static_cast<Vertex>(nodes_.size()); v-- > 0;) {
+        if (v != root_) free_vertices_.push_back(v);
+    }
+    auto& root = nodes_[root_];
+    root.first_child = root.last_child = null_vertex;
+    haplotype_leafs_.assign(1, root_);
     tree_region_ = boost::none;
 }
 
 void HaplotypeTree::write_dot(std::ostream& out) const
 {
-    const auto vertex_writer = [this] (std::ostream& out, const Vertex v) {
-        const Allele allele {GenomicRegion {contig_, tree_[v].mapped_region()}, tree_[v].sequence()};
+    const auto write_vertex = [this, &out] (const Vertex v) {
+        const Allele allele {GenomicRegion {contig_, nodes_[v].allele.mapped_region()}, nodes_[v].allele.sequence()};
+        out << v;
         if (v == root_) {
             out << " [shape=circle,color=black]" << std::endl;
         } else {
@@ -493,68 +408,134 @@ void HaplotypeTree::write_dot(std::ostream& out) const
             }
             out << " [label=\"" << allele << "\"]" << std::endl;
         }
+        out << ";" << std::endl;
     };
-    const auto edge_writer = [] (std::ostream& out, const Edge e) {
-        out << "[color=black]" << std::endl;
-    };
-    const auto graph_writer = [] (std::ostream& out) {
-        out << "rankdir=LR" << std::endl;
-    };
-    std::unordered_map<Vertex, std::size_t> vertex_ids {};
-    vertex_ids.reserve(boost::num_vertices(tree_));
-    const auto p = boost::vertices(tree_); std::size_t idx {0};
-    std::for_each(p.first, p.second, [&] (Vertex v) { vertex_ids.emplace(v, idx++); });
-    boost::write_graphviz(out, tree_, vertex_writer, edge_writer, graph_writer, boost::make_assoc_property_map(vertex_ids));
+    out << "digraph G {" << std::endl;
+    out << "rankdir=LR" << std::endl;
+    std::vector<Vertex> stack {root_};
+    while (!stack.empty()) {
+        const auto u = stack.back();
+        stack.pop_back();
+        write_vertex(u);
+        for (auto v = nodes_[u].first_child; v != null_vertex; v = nodes_[v].next_sibling) {
+            out << u << "->" << v << " [color=black];" << std::endl;
+            stack.push_back(v);
+        }
+    }
+    out << "}" << std::endl;
 }
 
 // Private methods
 
-HaplotypeTree::Vertex HaplotypeTree::get_previous_allele(const Vertex allele) const
+std::size_t HaplotypeTree::num_vertices() const noexcept
+{
+    return nodes_.size() - free_vertices_.size();
+}
+
+HaplotypeTree::Vertex HaplotypeTree::add_vertex(const ContigAllele& allele, const Vertex parent)
+{
+    Vertex result;
+    if (free_vertices_.empty()) {
+        result = static_cast<Vertex>(nodes_.size());
+        nodes_.push_back({allele, null_vertex, null_vertex, null_vertex, null_vertex, null_vertex});
+        // So clear never needs to allocate
+        free_vertices_.reserve(nodes_.capacity());
+    } else {
+        result = free_vertices_.back();
+        free_vertices_.pop_back();
+        auto& node = nodes_[result];
+        node.allele = allele; // reuses the recycled node's sequence storage
+        node.parent = node.first_child = node.last_child = node.prev_sibling = node.next_sibling = null_vertex;
+    }
+    if (parent != null_vertex) add_edge(parent, result);
+    return result;
+}
+
+void HaplotypeTree::add_edge(const Vertex u, const Vertex v) noexcept
+{
+    assert(nodes_[v].parent == null_vertex);
+    auto& parent = nodes_[u];
+    auto& child = nodes_[v];
+    child.parent = u;
+    child.prev_sibling = parent.last_child;
+    child.next_sibling = null_vertex;
+    if (parent.last_child != null_vertex) {
+        nodes_[parent.last_child].next_sibling = v;
+    } else {
+        parent.first_child = v;
+    }
+    parent.last_child = v;
+}
+
+void HaplotypeTree::remove_edge(const Vertex u, const Vertex v) noexcept
+{
+    assert(nodes_[v].parent == u);
+    auto& parent = nodes_[u];
+    auto& child = nodes_[v];
+    if (child.prev_sibling != null_vertex) {
+        nodes_[child.prev_sibling].next_sibling = child.next_sibling;
+    } else {
+        parent.first_child = child.next_sibling;
+    }
+    if (child.next_sibling != null_vertex) {
+        nodes_[child.next_sibling].prev_sibling = child.prev_sibling;
+    } else {
+        parent.last_child = child.prev_sibling;
+    }
+    child.parent = child.prev_sibling = child.next_sibling = null_vertex;
+}
+
+void HaplotypeTree::remove_vertex(const Vertex v)
 {
-    assert(allele != root_);
-    const auto p = boost::inv_adjacent_vertices(allele, tree_);
-    assert(std::distance(p.first, p.second) == 1);
-    return *p.first;
+    assert(v != root_ && nodes_[v].parent == null_vertex && is_leaf(v));
+    free_vertices_.push_back(v);
 }
 
-bool HaplotypeTree::is_leaf(const Vertex v) const
+HaplotypeTree::Vertex HaplotypeTree::get_previous_allele(const Vertex allele) const noexcept
 {
-    return boost::out_degree(v, tree_) == 0;
+    assert(allele != root_ && nodes_[allele].parent != null_vertex);
+    return nodes_[allele].parent;
 }
 
-bool HaplotypeTree::is_bifurcating(const Vertex v) const
+bool HaplotypeTree::is_leaf(const Vertex v) const noexcept
 {
-    return boost::out_degree(v, tree_) > 1;
+    return nodes_[v].first_child == null_vertex;
+}
+
+bool HaplotypeTree::is_bifurcating(const Vertex v) const noexcept
+{
+    return nodes_[v].first_child != nodes_[v].last_child;
 }
 
 HaplotypeTree::Vertex HaplotypeTree::remove_forward(const Vertex u)
 {
-    const auto p = boost::adjacent_vertices(u, tree_);
-    assert(std::distance(p.first, p.second) == 1);
-    const auto v = *p.first;
-    boost::remove_edge(u, v, tree_);
-    boost::remove_vertex(u, tree_);
+    const auto v = nodes_[u].first_child;
+    assert(v != null_vertex && v == nodes_[u].last_child);
+    remove_edge(u, v);
+    remove_vertex(u);
     return v;
 }
 
 HaplotypeTree::Vertex HaplotypeTree::remove_backward(const Vertex v)
 {
     const auto u = get_previous_allele(v);
-    boost::remove_edge(u, v, tree_);
-    boost::remove_vertex(v, tree_);
+    remove_edge(u, v);
+    remove_vertex(v);
     return u;
 }
 
 bool HaplotypeTree::allele_exists(const Vertex leaf, const ContigAllele& allele) const
 {
-    const auto p = boost::adjacent_vertices(leaf, tree_);
-    return std::any_of(p.first, p.second, [this, &allele] (const Vertex v) { return tree_[v] == allele; });
+    for (auto v = nodes_[leaf].first_child; v != null_vertex; v = nodes_[v].next_sibling) {
+        if (nodes_[v].allele == allele) return true;
+    }
+    return false;
 }
 
 HaplotypeTree::Vertex HaplotypeTree::find_allele_before(Vertex v, const ContigAllele& allele) const
 {
-    while (v != root_ && overlaps(allele, tree_[v])) {
-        if (is_same_region(allele, tree_[v])) { // for insertions
+    while (v != root_ && overlaps(allele, nodes_[v].allele)) {
+        if (is_same_region(allele, nodes_[v].allele)) { // for insertions
             v = get_previous_allele(v);
             break;
         }
@@ -563,46 +544,38 @@ HaplotypeTree::Vertex HaplotypeTree::find_allele_before(Vertex v, const ContigAl
     return v;
 }
 
-HaplotypeTree::LeafIterator
-HaplotypeTree::extend_haplotype(LeafIterator leaf_itr, const ContigAllele& new_allele)
+void HaplotypeTree::extend_haplotype(const Vertex leaf, const ContigAllele& new_allele, std::vector<Vertex>& result)
 {
-    if (*leaf_itr == root_) {
-        const auto new_leaf = boost::add_vertex(new_allele, tree_);
-        boost::add_edge(*leaf_itr, new_leaf, tree_);
-        leaf_itr = haplotype_leafs_.erase(leaf_itr);
-        leaf_itr = haplotype_leafs_.insert(leaf_itr, new_leaf);
-    } else {
-        const auto& leaf_allele = tree_[*leaf_itr];
-        if (can_add_to_branch(new_allele, leaf_allele)) {
-            if (is_after(new_allele, leaf_allele)) {
-                const auto new_leaf = boost::add_vertex(new_allele, tree_);
-                boost::add_edge(*leaf_itr, new_leaf, tree_);
-                leaf_itr = haplotype_leafs_.erase(leaf_itr);
-                leaf_itr = haplotype_leafs_.insert(leaf_itr, new_leaf);
-            } else if (overlaps(new_allele, leaf_allele)) {
-                const auto branch_point = find_allele_before(*leaf_itr, new_allele);
-                if ((branch_point == root_ || can_add_to_branch(new_allele, tree_[branch_point]))
-                    && !allele_exists(branch_point, new_allele)) {
-                    const auto new_leaf = boost::add_vertex(new_allele, tree_);
-                    boost::add_edge(branch_point, new_leaf, tree_);
-                    haplotype_leafs_.insert(leaf_itr, new_leaf);
-                }
+    if (leaf == root_) {
+        result.push_back(add_vertex(new_allele, leaf));
+        return;
+    }
+    const auto& leaf_allele = nodes_[leaf].allele; // invalidated by add_vertex
+    if (can_add_to_branch(new_allele, leaf_allele)) {
+        if (is_after(new_allele, leaf_allele)) {
+            result.push_back(add_vertex(new_allele, leaf));
+            return;
+        } else if (overlaps(new_allele, leaf_allele)) {
+            const auto branch_point = find_allele_before(leaf, new_allele);
+            if ((branch_point == root_ || can_add_to_branch(new_allele, nodes_[branch_point].allele))
+                && !allele_exists(branch_point, new_allele)) {
+                result.push_back(add_vertex(new_allele, branch_point));
             }
         }
     }
-    return leaf_itr;
+    result.push_back(leaf);
 }
 
 Haplotype HaplotypeTree::extract_haplotype(Vertex leaf, const GenomicRegion& region) const
 {
     const auto& contig_region = region.contig_region();
     using octopus::contains;
-    while (leaf != root_ && !contains(contig_region, tree_[leaf])) {
+    while (leaf != root_ && !contains(contig_region, nodes_[leaf].allele)) {
         leaf = get_previous_allele(leaf);
     }
     Haplotype::Builder result {region, reference_};
-    while (leaf != root_ && contains(contig_region, tree_[leaf])) {
-        result.push_front(tree_[leaf]);
+    while (leaf != root_ && contains(contig_region, nodes_[leaf].allele)) {
+        result.push_front(nodes_[leaf].allele);
         leaf = get_previous_allele(leaf);
     }
     return result.build();
@@ -612,25 +585,25 @@ HaplotypeTree::HaplotypeLength HaplotypeTree::extract_haplotype_length(Vertex le
 {
     const auto& contig_region = region.contig_region();
     using octopus::contains;
-    while (leaf != root_ && !contains(contig_region, tree_[leaf])) {
+    while (leaf != root_ && !contains(contig_region, nodes_[leaf].allele)) {
         leaf = get_previous_allele(leaf);
     }
     if (leaf == root_) {
         return size(contig_region);
     }
-    HaplotypeLength result {right_overhang_size(contig_region, tree_[leaf])};
+    HaplotypeLength result {right_overhang_size(contig_region, nodes_[leaf].allele)};
     auto prev_node = leaf;
     while (true) {
-        result += sequence_size(tree_[leaf]);
+        result += sequence_size(nodes_[leaf].allele);
         prev_node = leaf;
         leaf = get_previous_allele(leaf);
-        if (leaf != root_ && contains(contig_region, tree_[leaf])) {
-            result += inner_distance(tree_[leaf], tree_[prev_node]);
+        if (leaf != root_ && contains(contig_region, nodes_[leaf].allele)) {
+            result += inner_distance(nodes_[leaf].allele, nodes_[prev_node].allele);
         } else {
             break;
         }
     }
-    result += left_overhang_size(contig_region, tree_[prev_node]);
+    result += left_overhang_size(contig_region, nodes_[prev_node].allele);
     return result;
 }
 
@@ -640,7 +613,7 @@ bool HaplotypeTree::define_same_haplotype(Vertex leaf1, Vertex leaf2) const
         return true;
     }
     while (leaf1 != root_) {
-        if (leaf2 == root_ || tree_[leaf1] != tree_[leaf2]) return false;
+        if (leaf2 == root_ || nodes_[leaf1].allele != nodes_[leaf2].allele) return false;
         leaf1 = get_previous_allele(leaf1);
         leaf2 = get_previous_allele(leaf2);
     }
@@ -649,11 +622,11 @@ bool HaplotypeTree::define_same_haplotype(Vertex leaf1, Vertex leaf2) const
 
 bool HaplotypeTree::is_branch_exact_haplotype(Vertex leaf, const Haplotype& haplotype) const
 {
-    if (leaf == root_ || !overlaps(tree_[leaf], contig_region(haplotype))) {
+    if (leaf == root_ || !overlaps(nodes_[leaf].allele, contig_region(haplotype))) {
         return false;
     }
     while (leaf != root_) {
-        if (!haplotype.includes(tree_[leaf])) {
+        if (!haplotype.includes(nodes_[leaf].allele)) {
             return false;
         }
         leaf = get_previous_allele(leaf);
@@ -664,7 +637,7 @@ bool HaplotypeTree::is_branch_exact_haplotype(Vertex leaf, const Haplotype& hapl
 bool HaplotypeTree::is_branch_equal_haplotype(const Vertex leaf, const Haplotype& haplotype) const
 {
     // TODO: check if this is quicker than calling Haplotype::contains for each ContigAllele
-    return leaf != root_ && overlaps(contig_region(haplotype), tree_[leaf])
+    return leaf != root_ && overlaps(contig_region(haplotype), nodes_[leaf].allele)
             && extract_haplotype(leaf, haplotype.mapped_region()) == haplotype;
 }
 
@@ -691,21 +664,21 @@ HaplotypeTree::find_equal_haplotype_leaf(const LeafIterator first, const LeafIte
 void HaplotypeTree::clear_overlapped(const ContigRegion& region)
 {
     haplotype_leaf_cache_.clear();
-    std::list<Vertex> new_leafs {};
+    leaf_buffer_.clear();
     for (const Vertex leaf : haplotype_leafs_) {
         const auto p = clear(leaf, region);
-        if (p.second) new_leafs.push_back(p.first);
+        if (p.second) leaf_buffer_.push_back(p.first);
     }
     // As the tree is cleared, a  branch stub could be appended to a previous new leaf node
-    new_leafs.erase(std::remove_if(std::begin(new_leafs), std::end(new_leafs), [this] (Vertex v) { return !is_leaf(v); }), std::end(new_leafs));
-    haplotype_leafs_ = std::move(new_leafs);
+    leaf_buffer_.erase(std::remove_if(std::begin(leaf_buffer_), std::end(leaf_buffer_), [this] (Vertex v) { return !is_leaf(v); }), std::end(leaf_buffer_));
+    std::swap(haplotype_leafs_, leaf_buffer_);
     tree_region_ = boost::none;
 }
 
 std::pair<HaplotypeTree::Vertex, bool>
 HaplotypeTree::clear(const Vertex leaf, const ContigRegion& region)
 {
-    if (overlaps(region, tree_[leaf])) {
+    if (overlaps(region, nodes_[leaf].allele)) {
         return clear_external(leaf, region);
     } else {
         return clear_internal(leaf, region);
@@ -717,16 +690,16 @@ HaplotypeTree::clear_external(Vertex leaf, const ContigRegion& region)
 {
     assert(is_leaf(leaf));
     while (leaf != root_) {
-        if (boost::out_degree(leaf, tree_) > 0) {
+        if (!is_leaf(leaf)) {
             return std::make_pair(leaf, false);
-        } else if (begins_before(tree_[leaf], region)) {
+        } else if (begins_before(nodes_[leaf].allele, region)) {
             return std::make_pair(leaf, true);
         } else {
             leaf = remove_backward(leaf);
         }
     }
     // the root should only be indicated as a leaf node if there are no other nodes in the tree
-    return std::make_pair(leaf, boost::num_vertices(tree_) == 1);
+    return std::make_pair(leaf, num_vertices() == 1);
 }
 
 std::pair<HaplotypeTree::Vertex, bool>
@@ -734,7 +707,7 @@ HaplotypeTree::clear_internal(const Vertex leaf, const ContigRegion& region)
 {
     assert(is_leaf(leaf));
     // TODO: we can optimise this for cases where region overlaps the leftmost alleles in the tree
-    if (leaf == root_ || is_after(region, tree_[leaf])) {
+    if (leaf == root_ || is_after(region, nodes_[leaf].allele)) {
         return std::make_pair(leaf, true);
     }
     Vertex current_allele {leaf}, allele_to_move {leaf};
@@ -742,7 +715,7 @@ HaplotypeTree::clear_internal(const Vertex leaf, const ContigRegion& region)
     bool is_bifurcating_branch {false};
     while (true) {
         current_allele = get_previous_allele(current_allele);
-        if (current_allele == root_ || overlaps(tree_[current_allele], region)) {
+        if (current_allele == root_ || overlaps(nodes_[current_allele].allele, region)) {
             break;
         }
         is_bifurcating_branch = is_bifurcating_branch || is_bifurcating(current_allele);
@@ -753,26 +726,25 @@ HaplotypeTree::clear_internal(const Vertex leaf, const ContigRegion& region)
         }
     }
     if (alleles_to_copy.empty()) {
-        boost::remove_edge(current_allele, allele_to_move, tree_);
+        remove_edge(current_allele, allele_to_move);
     } else {
         assert(alleles_to_copy.back() != allele_to_move);
-        boost::remove_edge(alleles_to_copy.back(), allele_to_move, tree_);
+        remove_edge(alleles_to_copy.back(), allele_to_move);
     }
-    while (current_allele != root_ && overlaps(region, tree_[current_allele])) {
+    while (current_allele != root_ && overlaps(region, nodes_[current_allele].allele)) {
         const auto previous_allele = get_previous_allele(current_allele);
-        is_bifurcating_branch = is_bifurcating_branch || boost::out_degree(current_allele, tree_) > 0;
+        is_bifurcating_branch = is_bifurcating_branch || !is_leaf(current_allele);
         if (!is_bifurcating_branch) {
-            assert(boost::out_degree(current_allele, tree_) <= 1);
-            boost::remove_edge(previous_allele, current_allele, tree_);
-            boost::remove_vertex(current_allele, tree_);
+            remove_edge(previous_allele, current_allele);
+            remove_vertex(current_allele);
         }
         current_allele = previous_allele;
     }
     // Simpler to prepend onto the movable branch and then call that moveable than treat each separately
     std::for_each(std::crbegin(alleles_to_copy), std::crend(alleles_to_copy),
                   [this, &allele_to_move] (const Vertex allele) {
-                      const auto v = boost::add_vertex(tree_[allele], tree_);
-                      boost::add_edge(v, allele_to_move, tree_);
+                      const auto v = add_vertex(nodes_[allele].allele);
+                      add_edge(v, allele_to_move);
                       allele_to_move = v;
                   });
     alleles_to_copy.clear();
@@ -780,26 +752,25 @@ HaplotypeTree::clear_internal(const Vertex leaf, const ContigRegion& region)
     auto allele_to_move_to = current_allele;
     // Now avoid duplicate branches
     while (true) {
-        const auto vertex_range = boost::adjacent_vertices(allele_to_move_to, tree_);
-        const auto it = std::find_if(vertex_range.first, vertex_range.second,
-                                     [this, allele_to_move] (const Vertex allele) {
-                                         return tree_[allele] == tree_[allele_to_move];
-                                     });
-        if (it == vertex_range.second) break;
-        allele_to_move_to = *it; // i.e. move forward
+        auto it = nodes_[allele_to_move_to].first_child;
+        while (it != null_vertex && nodes_[it].allele != nodes_[allele_to_move].allele) {
+            it = nodes_[it].next_sibling;
+        }
+        if (it == null_vertex) break;
+        allele_to_move_to = it; // i.e. move forward
         if (is_leaf(allele_to_move)) break;
         // Safe to remove forward as we made this branch earlier via copies
         allele_to_move = remove_forward(allele_to_move);
     }
-    if (allele_to_move_to == root_ || tree_[allele_to_move_to] != tree_[allele_to_move]) {
-        boost::add_edge(allele_to_move_to, allele_to_move, tree_);
+    if (allele_to_move_to == root_ || nodes_[allele_to_move_to].allele != nodes_[allele_to_move].allele) {
+        add_edge(allele_to_move_to, allele_to_move);
         return std::make_pair(leaf, true);
     } else {
         // Ditch the entire copied branch as it's already in the tree
-        while (boost::out_degree(allele_to_move, tree_) > 0) {
+        while (!is_leaf(allele_to_move)) {
             allele_to_move = remove_forward(allele_to_move);
         }
-        boost::remove_vertex(allele_to_move, tree_);
+        remove_vertex(allele_to_move);
         return std::make_pair(allele_to_move_to, false);
     }
 }
@@ -878,41 +849,6 @@ void write_dot(const HaplotypeTree& tree, const boost::filesystem::path& dest)
     tree.write_dot(file);
 }
 
-template <typename G, typename V, typename Container>
-bool is_tree(const G& graph, const V& root, const Container& leafs)
-{
-    if (boost::num_vertices(graph) == 1) {
-        return *boost::vertices(graph).first == root;
-    }
-    std::unordered_set<V> visited_vertices {};
-    visited_vertices.reserve(boost::num_vertices(graph));
-    auto vis = boost::make_bfs_visitor(boost::write_property(boost::typed_identity_property_map<V>(),
-                                                             std::inserter(visited_vertices,
-                                                                           std::begin(visited_vertices)),
-                                                             boost::on_discover_vertex()));
-    std::unordered_map<V, std::size_t> index_map {};
-    index_map.reserve(boost::num_vertices(graph));
-    const auto p = boost::vertices(graph);
-    std::size_t i {0};
-    std::for_each(p.first, p.second, [&i, &index_map] (const auto& v) { index_map.emplace(v, i++); });
-    boost::breadth_first_search(graph, root,
-                                boost::visitor(vis)
-                                .vertex_index_map(boost::make_assoc_property_map(index_map)));
-    if (visited_vertices.size() != boost::num_vertices(graph) || visited_vertices.count(root) == 0) {
-        return false;
-    }
-    return std::all_of(std::cbegin(leafs), std::cend(leafs),
-                       [&graph, &root] (auto v) {
-                           if (boost::out_degree(v, graph) != 0) return false;
-                           while (v != root) {
-                               const auto p = boost::inv_adjacent_vertices(v, graph);
-                               if (std::distance(p.first, p.second) != 1) return false;
-                               v = *p.first;
-                           }
-                           return true;
-                       });
-}
-
 } // namespace debug
 
 } // namespace coretools
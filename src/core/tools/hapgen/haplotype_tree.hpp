@@ -5,9 +5,7 @@
 #define haplotype_tree_hpp
 
 #include <vector>
-#include <list>
 #include <unordered_map>
-#include <unordered_set>
 #include <utility>
 #include <functional>
 #include <iterator>
@@ -15,8 +13,8 @@
 #include <type_traits>
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
 
-#include <boost/graph/adjacency_list.hpp>
 #include <boost/optional.hpp>
 #include <boost/filesystem.hpp>
 
@@ -31,6 +29,12 @@ class ReferenceGenome;
 
 namespace coretools {
 
+/*
+ HaplotypeTree stores its alleles in a pool of nodes addressed by stable integer ids. Removed nodes,
+ and all nodes when the tree is cleared, are recycled rather than freed, so walking a contig reuses
+ the same storage (including the allele sequences) region after region, and copying a tree is a
+ plain copy of the pool.
+ */
 class HaplotypeTree
 {
 public:
@@ -40,8 +44,8 @@ public:
     
     HaplotypeTree(const GenomicRegion::ContigName& contig, const ReferenceGenome& reference);
     
-    HaplotypeTree(const HaplotypeTree&);
-    HaplotypeTree& operator=(const HaplotypeTree&);
+    HaplotypeTree(const HaplotypeTree&)            = default;
+    HaplotypeTree& operator=(const HaplotypeTree&) = default;
     HaplotypeTree(HaplotypeTree&&)            = default;
     HaplotypeTree& operator=(HaplotypeTree&&) = default;
     
@@ -72,6 +76,8 @@ public:
     
     std::vector<Haplotype> extract_haplotypes() const;
     std::vector<Haplotype> extract_haplotypes(const GenomicRegion& region) const;
+    // Replaces the contents of result, reusing its storage
+    void extract_haplotypes(const GenomicRegion& region, std::vector<Haplotype>& result) const;
     
     std::vector<HaplotypeLength> extract_haplotype_lengths() const;
     std::vector<HaplotypeLength> extract_haplotype_lengths(const GenomicRegion& region) const;
@@ -89,35 +95,44 @@ public:
     void write_dot(std::ostream& out) const;
     
 private:
-    using Tree = boost::adjacency_list<
-        boost::listS, boost::listS, boost::bidirectionalS, ContigAllele, boost::no_property
-    >;
+    using Vertex = std::uint32_t;
     
-    using Vertex = boost::graph_traits<Tree>::vertex_descriptor;
-    using Edge   = boost::graph_traits<Tree>::edge_descriptor;
+    struct Node
+    {
+        ContigAllele allele;
+        Vertex parent, first_child, last_child, prev_sibling, next_sibling;
+    };
+    
+    static constexpr Vertex null_vertex {~Vertex {0}};
     
     using HaplotypeVertexMultiMap = std::unordered_multimap<Haplotype, Vertex>;
     
     std::reference_wrapper<const ReferenceGenome> reference_;
-    Tree tree_;
+    std::vector<Node> nodes_;
+    std::vector<Vertex> free_vertices_;
     Vertex root_;
-    std::list<Vertex> haplotype_leafs_;
+    std::vector<Vertex> haplotype_leafs_, leaf_buffer_;
     GenomicRegion::ContigName contig_;
     
     mutable HaplotypeVertexMultiMap haplotype_leaf_cache_;
     mutable boost::optional<GenomicRegion> tree_region_;
     
-    using LeafIterator  = decltype(haplotype_leafs_)::const_iterator;
+    using LeafIterator  = decltype(haplotype_leafs_)::iterator;
     using CacheIterator = decltype(haplotype_leaf_cache_)::iterator;
     
-    bool is_leaf(Vertex v) const;
-    bool is_bifurcating(Vertex v) const;
+    std::size_t num_vertices() const noexcept;
+    Vertex add_vertex(const ContigAllele& allele, Vertex parent = null_vertex);
+    void add_edge(Vertex u, Vertex v) noexcept;
+    void remove_edge(Vertex u, Vertex v) noexcept;
+    void remove_vertex(Vertex v);
+    bool is_leaf(Vertex v) const noexcept;
+    bool is_bifurcating(Vertex v) const noexcept;
     Vertex remove_forward(Vertex u);
     Vertex remove_backward(Vertex v);
-    Vertex get_previous_allele(Vertex allele) const;
+    Vertex get_previous_allele(Vertex allele) const noexcept;
     Vertex find_allele_before(Vertex v, const ContigAllele& allele) const;
     bool allele_exists(Vertex leaf, const ContigAllele& allele) const;
-    LeafIterator extend_haplotype(LeafIterator leaf, const ContigAllele& new_allele);
+    void extend_haplotype(Vertex leaf, const ContigAllele& new_allele, std::vector<Vertex>& result);
     Haplotype extract_haplotype(Vertex leaf, const GenomicRegion& region) const;
     HaplotypeLength extract_haplotype_length(Vertex leaf, const GenomicRegion& region) const;
     bool define_same_haplotype(Vertex leaf1, Vertex leaf2) const;
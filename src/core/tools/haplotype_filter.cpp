@@ -18,6 +18,7 @@
 #include "core/models/haplotype_likelihood_array.hpp"
 #include "utils/maths.hpp"
 #include "utils/append.hpp"
+#include "utils/monotonic_arena.hpp"
 #include "logging/logging.hpp"
 
 namespace octopus {
@@ -27,10 +28,21 @@ namespace {
 struct SampleIntersectTag {};
 struct SamplePoolTag {};
 
+// Filtering scratch space is taken from the task arena
+template <typename T>
+using FilterScoreMap = std::unordered_map<Haplotype, T, std::hash<Haplotype>, std::equal_to<Haplotype>,
+                                          ArenaAllocator<std::pair<const Haplotype, T>>>;
+
+template <typename T>
+FilterScoreMap<T> make_filter_score_map(const std::size_t num_haplotypes)
+{
+    return FilterScoreMap<T> {num_haplotypes, std::hash<Haplotype> {}, std::equal_to<Haplotype> {}, task_arena()};
+}
+
 template <typename T>
 struct FilterGreater
 {
-    FilterGreater(const std::unordered_map<Haplotype, T>& values) : values_ {values} {}
+    FilterGreater(const FilterScoreMap<T>& values) : values_ {values} {}
     
     bool operator()(const Haplotype& lhs, const T rhs) const
     {
@@ -46,7 +58,7 @@ struct FilterGreater
     }
     
 private:
-    const std::unordered_map<Haplotype, T>& values_;
+    const FilterScoreMap<T>& values_;
 };
 
 template <typename T>
@@ -79,7 +91,8 @@ std::size_t try_filter(std::vector<Haplotype>& haplotypes,
     bool first_sample {true};
     std::vector<Haplotype> new_filtered {};
     for (const auto& sample : samples) {
-        std::vector<std::pair<HaplotypeReference, T>> filter_scores {};
+        ArenaVector<std::pair<HaplotypeReference, T>> filter_scores {task_arena()};
+        filter_scores.reserve(haplotypes.size());
         for (const auto& haplotype : haplotypes) {
             filter_scores.emplace_back(haplotype, filter(haplotype, sample, haplotype_likelihoods));
         }
@@ -138,7 +151,7 @@ std::size_t try_filter(std::vector<Haplotype>& haplotypes,
                        F filter, SamplePoolTag)
 {
     using T = std::result_of_t<F(const Haplotype&, decltype(samples), decltype(haplotype_likelihoods))>;
-    std::unordered_map<Haplotype, T> filter_score {haplotypes.size()};
+    auto filter_score = make_filter_score_map<T>(haplotypes.size());
     for (const auto& haplotype : haplotypes) {
         filter_score.emplace(haplotype, filter(haplotype, samples, haplotype_likelihoods));
     }
@@ -176,7 +189,7 @@ void force_filter(std::vector<Haplotype>& haplotypes,
                   F filter)
 {
     using T = std::result_of_t<F(const Haplotype&, decltype(samples), decltype(haplotype_likelihoods))>;
-    std::unordered_map<Haplotype, T> filter_likelihoods {haplotypes.size()};
+    auto filter_likelihoods = make_filter_score_map<T>(haplotypes.size());
     for (const auto& haplotype : haplotypes) {
         filter_likelihoods.emplace(haplotype, filter(haplotype, samples, haplotype_likelihoods));
     }
@@ -264,7 +277,7 @@ public:
         for (const auto& sample : samples) {
             const auto n = haplotype_likelihoods.num_likelihoods(sample);
             for (std::size_t i {0}; i < n; ++i) {
-                using P = HaplotypeLikelihoodArray::LikelihoodVector::value_type;
+                using P = HaplotypeLikelihoodArray::LogProbability;
                 auto cur_max = std::numeric_limits<P>::lowest();
                 std::for_each(first, last, [&] (const auto& haplotype) {
                     const auto p = haplotype_likelihoods(sample, haplotype)[i];
@@ -5,8 +5,12 @@
 
 #include <iterator>
 #include <algorithm>
+#include <functional>
 #include <utility>
 #include <thread>
+#include <future>
+#include <exception>
+#include <cmath>
 #include <cassert>
 #include <iostream>
 
@@ -51,7 +55,7 @@ IndelProfiler::IndelProfiler(ProfileConfig config)
 
 IndelProfiler::IndelProfiler(ProfileConfig config, PerformanceConfig performance_config)
 : config_ {std::move(config)}
-, performance_config_ {}
+, performance_config_ {std::move(performance_config)}
 , workers_ {get_pool_size(performance_config_)}
 {}
 
@@ -74,6 +78,42 @@ IndelProfiler::profile(const ReadPipe& src, VcfReader& variants, const Reference
     return result;
 }
 
+namespace {
+
+// Small enough to sample the genome evenly, large enough that few batches are split
+constexpr GenomicRegion::Size profileChunkSize {1'000'000};
+
+std::vector<GenomicRegion> make_chunks(const InputRegionMap& regions)
+{
+    std::vector<GenomicRegion> result {};
+    for (const auto& p : regions) {
+        for (const auto& region : p.second) {
+            for (auto begin = region.begin(); begin < region.end(); begin += std::min(profileChunkSize, region.end() - begin)) {
+                result.emplace_back(region.contig_name(), begin, std::min(begin + profileChunkSize, region.end()));
+            }
+        }
+    }
+    return result;
+}
+
+// Systematic sampling, so the selected chunks are spread evenly over the input regions
+std::vector<bool> select_chunks(const std::size_t num_chunks, const double fraction)
+{
+    std::vector<bool> result(num_chunks, fraction >= 1.0);
+    if (fraction >= 1.0) return result;
+    for (std::size_t i {0}; i < num_chunks; ++i) {
+        result[i] = std::floor((i + 1) * fraction) > std::floor(i * fraction);
+    }
+    if (num_chunks > 0 && fraction > 0 && std::none_of(std::cbegin(result), std::cend(result), [] (bool b) { return b; })) {
+        result[num_chunks / 2] = true;
+    }
+    return result;
+}
+
+void merge(IndelProfiler::IndelProfile src, IndelProfiler::IndelProfile& dst);
+
+} // namespace
+
 IndelProfiler::IndelProfile
 IndelProfiler::profile(const ReadPipe& src, VcfReader& variants, const ReferenceGenome& reference,
                        const InputRegionMap& regions) const
@@ -83,17 +123,49 @@ IndelProfiler::profile(const ReadPipe& src, VcfReader& variants, const Reference
     ProgressMeter progress {regions};
     progress.start();
     IndelProfile result {};
-    for (const auto& r : regions) {
-        for (const auto& analysis_region : r.second) {
-            boost::optional<GenomicRegion> batch_region {};
-            for (auto p = variants.iterate(analysis_region); !batch_region || p.first != p.second; ) {
-                const auto data = read_next_data_batch(p.first, p.second, src, reference, samples, analysis_region, batch_region);
-                evaluate_indel_profile(data, result);
-                batch_region = mapped_region(data.reference);
-                progress.log_completed(*batch_region);
+    if (workers_.size() == 0 && config_.sample_fraction >= 1.0) {
+        for (const auto& r : regions) {
+            for (const auto& analysis_region : r.second) {
+                profile_region(src, variants, reference, samples, analysis_region, result, &progress);
             }
         }
+        progress.stop();
+        return result;
+    }
+    // Chunks are profiled independently and merged, so repeats and calls spanning a chunk boundary
+    // may be split or counted in both chunks.
+    const auto chunks = make_chunks(regions);
+    const auto selected = select_chunks(chunks.size(), config_.sample_fraction);
+    const auto& variants_path = variants.path();
+    const auto profile_chunk = [&] (const GenomicRegion& chunk) {
+        // Record iterators of one reader share a file handle, so each chunk opens its own
+        VcfReader chunk_variants {variants_path};
+        IndelProfile chunk_result {};
+        profile_region(src, chunk_variants, reference, samples, chunk, chunk_result);
+        progress.log_completed(chunk);
+        return chunk_result;
+    };
+    std::vector<std::future<IndelProfile>> tasks {};
+    std::exception_ptr error {};
+    for (std::size_t i {0}; i < chunks.size(); ++i) {
+        if (!selected[i]) {
+            progress.log_completed(chunks[i]);
+        } else if (workers_.size() > 0) {
+            const auto& chunk = chunks[i];
+            tasks.push_back(workers_.push([&profile_chunk, &chunk] () { return profile_chunk(chunk); }));
+        } else {
+            merge(profile_chunk(chunks[i]), result);
+        }
     }
+    // Wait for every task, even after an error, as they reference locals
+    for (auto& task : tasks) {
+        try {
+            merge(task.get(), result);
+        } catch (...) {
+            if (!error) error = std::current_exception();
+        }
+    }
+    if (error) std::rethrow_exception(error);
     progress.stop();
     return result;
 }
@@ -105,17 +177,25 @@ IndelProfiler::profile(const ReadPipe& src, VcfReader& variants, const Reference
     const auto samples = src.samples();
     check_samples(samples, variants);
     IndelProfile result {};
+    profile_region(src, variants, reference, samples, region, result);
+    return result;
+}
+
+// private methods
+
+void IndelProfiler::profile_region(const ReadPipe& src, VcfReader& variants, const ReferenceGenome& reference,
+                                   const SampleList& samples, const GenomicRegion& region, IndelProfile& result,
+                                   ProgressMeter* progress) const
+{
     boost::optional<GenomicRegion> batch_region {};
     for (auto p = variants.iterate(region); !batch_region || p.first != p.second; ) {
         const auto data = read_next_data_batch(p.first, p.second, src, reference, samples, region, batch_region);
         evaluate_indel_profile(data, result);
         batch_region = mapped_region(data.reference);
+        if (progress) progress->log_completed(*batch_region);
     }
-    return result;
 }
 
-// private methods
-
 void IndelProfiler::check_samples(const SampleList& samples, const VcfReader& variants) const
 {
     auto vcf_samples = variants.fetch_header().samples();
@@ -321,6 +401,35 @@ find_or_insert_motif(const Haplotype::NucleotideSequence& motif, std::deque<Inde
     return *states.insert(motif_itr, std::move(state));
 }
 
+void add(const std::vector<unsigned>& src, std::vector<unsigned>& dst)
+{
+    if (dst.size() < src.size()) dst.resize(src.size());
+    std::transform(std::cbegin(src), std::cend(src), std::cbegin(dst), std::begin(dst), std::plus<> {});
+}
+
+void merge(IndelProfiler::IndelProfile src, IndelProfiler::IndelProfile& dst)
+{
+    if (dst.states.size() < src.states.size()) dst.states.resize(src.states.size());
+    for (std::size_t period {0}; period < src.states.size(); ++period) {
+        auto& dst_period_states = dst.states[period];
+        if (dst_period_states.size() < src.states[period].size()) dst_period_states.resize(src.states[period].size());
+        for (std::size_t periods {0}; periods < src.states[period].size(); ++periods) {
+            for (const auto& state : src.states[period][periods]) {
+                auto& dst_state = find_or_insert_motif(state.motif, dst_period_states[periods]);
+                dst_state.span += state.span;
+                if (period == 0) {
+                    dst_state.reference_count = std::max(dst_state.reference_count, state.reference_count); // complex
+                } else {
+                    dst_state.reference_count += state.reference_count;
+                }
+                dst_state.read_count += state.read_count;
+                add(state.polymorphism_counts, dst_state.polymorphism_counts);
+                add(state.error_counts, dst_state.error_counts);
+            }
+        }
+    }
+}
+
 } // namespace
 
 void IndelProfiler::evaluate_indel_profile(const DataBatch& data, IndelProfile& result) const
@@ -550,6 +659,15 @@ profile_indels(const ReadPipe& reads, VcfReader::Path variants, const ReferenceG
     return profiler.profile(reads, vcf, reference, regions);
 }
 
+IndelProfiler::IndelProfile
+profile_indels(const ReadPipe& reads, VcfReader::Path variants, const ReferenceGenome& reference, const InputRegionMap& regions,
+               IndelProfiler::ProfileConfig config, IndelProfiler::PerformanceConfig performance_config)
+{
+    VcfReader vcf {std::move(variants)};
+    IndelProfiler profiler {std::move(config), std::move(performance_config)};
+    return profiler.profile(reads, vcf, reference, regions);
+}
+
 IndelProfiler::IndelProfile
 profile_indels(const ReadPipe& reads, VcfReader::Path variants, const ReferenceGenome& reference, const GenomicRegion& region)
 {
@@ -558,9 +676,25 @@ profile_indels(const ReadPipe& reads, VcfReader::Path variants, const ReferenceG
     return profiler.profile(reads, vcf, reference, region);
 }
 
+namespace {
+
+// 95% Wilson score interval of the error rate, which stays sensible for the small counts seen when
+// only a fraction of the genome is profiled.
+std::pair<double, double> error_rate_interval(const unsigned errors, const unsigned reads)
+{
+    if (reads == 0) return {0.0, 1.0};
+    constexpr double z {1.96};
+    const double n {static_cast<double>(reads)}, p {errors / n};
+    const auto centre = (p + z * z / (2 * n)) / (1 + z * z / n);
+    const auto half_width = (z / (1 + z * z / n)) * std::sqrt(p * (1 - p) / n + z * z / (4 * n * n));
+    return {std::max(centre - half_width, 0.0), std::min(centre + half_width, 1.0)};
+}
+
+} // namespace
+
 std::ostream& operator<<(std::ostream& os, const IndelProfiler::IndelProfile::RepeaStateArray& states)
 {
-    os << "period,periods,motif,reference_count,reference_span,indel_length,polymorphisms,errors,reads";
+    os << "period,periods,motif,reference_count,reference_span,indel_length,polymorphisms,errors,reads,error_rate_lower,error_rate_upper";
     if (states.empty()) return os;
     const auto max_period = states.size() - 1;
     for (std::size_t period {0}; period <= max_period; ++period) {
@@ -580,12 +714,9 @@ std::ostream& operator<<(std::ostream& os, const IndelProfiler::IndelProfile::Re
                         os << 0;
                     }
                     os << ',';
-                    if (indel_length < state.error_counts.size()) {
-                        os << state.error_counts[indel_length];
-                    } else {
-                        os << 0;
-                    }
-                    os << ',' << state.read_count;
+                    const auto errors = indel_length < state.error_counts.size() ? state.error_counts[indel_length] : 0u;
+                    const auto error_rate_bounds = error_rate_interval(errors, state.read_count);
+                    os << errors << ',' << state.read_count << ',' << error_rate_bounds.first << ',' << error_rate_bounds.second;
                 }
             }
         }
@@ -24,6 +24,7 @@
 #include "readpipe/read_pipe.hpp"
 #include "readpipe/buffered_read_pipe.hpp"
 #include "utils/thread_pool.hpp"
+#include "logging/progress_meter.hpp"
 #include "read_assigner.hpp"
 
 namespace octopus {
@@ -40,6 +41,8 @@ public:
         unsigned max_length = 200;
         bool check_read_misalignments = true;
         Haplotype::NucleotideSequence complex_motif = "N";
+        // Profile this fraction of the input regions, taken as evenly spaced chunks
+        double sample_fraction = 1.0;
     };
     
     struct PerformanceConfig
@@ -86,6 +89,9 @@ private:
     mutable ThreadPool workers_;
     
     void check_samples(const SampleList& samples, const VcfReader& variants) const;
+    void profile_region(const ReadPipe& src, VcfReader& variants, const ReferenceGenome& reference,
+                        const SampleList& samples, const GenomicRegion& region, IndelProfile& result,
+                        ProgressMeter* progress = nullptr) const;
     CallBlock read_next_block(VcfIterator& first, const VcfIterator& last, const SampleList& samples) const;
     DataBatch read_next_data_batch(VcfIterator& first, const VcfIterator& last, const ReadPipe& src,
                                    const ReferenceGenome& reference, const SampleList& samples,
@@ -115,6 +121,9 @@ profile_indels(const ReadPipe& reads, VcfReader::Path variants, const ReferenceG
 IndelProfiler::IndelProfile
 profile_indels(const ReadPipe& reads, VcfReader::Path variants, const ReferenceGenome& reference, const InputRegionMap& regions);
 IndelProfiler::IndelProfile
+profile_indels(const ReadPipe& reads, VcfReader::Path variants, const ReferenceGenome& reference, const InputRegionMap& regions,
+               IndelProfiler::ProfileConfig config, IndelProfiler::PerformanceConfig performance_config);
+IndelProfiler::IndelProfile
 profile_indels(const ReadPipe& reads, VcfReader::Path variants, const ReferenceGenome& reference, const GenomicRegion& region);
 
 std::ostream& operator<<(std::ostream& os, const IndelProfiler::IndelProfile& indel_profile);
@@ -3,8 +3,10 @@
 
 #include "phaser.hpp"
 
-#include <deque>
+#include <vector>
+#include <unordered_map>
 #include <algorithm>
+#include <iterator>
 #include <numeric>
 #include <cstddef>
 #include <cmath>
@@ -16,93 +18,174 @@
 #include "utils/mappable_algorithms.hpp"
 #include "utils/maths.hpp"
 
-#include "timers.hpp"
-
 namespace octopus {
 
 Phaser::Phaser(Phred<double> min_phase_score) : min_phase_score_ {min_phase_score} {}
 
 namespace {
 
-using GenotypeReference    = std::reference_wrapper<const Genotype<Haplotype>>;
-using PhaseComplementSet   = std::deque<GenotypeReference>;
-using PhaseComplementSets  = std::vector<PhaseComplementSet>;
-using PartitionIterator    = std::vector<GenomicRegion>::const_iterator;
-using GenotypeChunkVector = std::vector<Genotype<Haplotype>>;
+using GenotypeReference = std::reference_wrapper<const Genotype<Haplotype>>;
+using IndexVector       = std::vector<unsigned>;
 
-struct GenotypeChunkPartitions
+struct IndexVectorHash
 {
-    GenotypeReference genotype;
-    GenotypeChunkVector chunks;
+    std::size_t operator()(const IndexVector& indices) const noexcept
+    {
+        return boost::hash_range(std::cbegin(indices), std::cend(indices));
+    }
 };
 
-using GenotypeChunkTable = std::vector<GenotypeChunkPartitions>;
+using IndexMap = std::unordered_map<IndexVector, unsigned, IndexVectorHash>;
 
-template <typename Container>
-GenotypeChunkTable
-make_chunk_table(const Container& genotypes, PartitionIterator first_parition, PartitionIterator last_partition)
+// Genotype projections onto regions are computed through their haplotypes, of which there are far fewer,
+// and interned so that projections can be compared by index. Projections onto each partition and each
+// window of consecutive partitions are cached as they do not depend on the sample.
+class ProjectionCache
 {
-    const auto num_partitions = std::distance(first_parition, last_partition);
-    GenotypeChunkTable result {};
-    result.reserve(genotypes.size());
+public:
+    ProjectionCache(const std::vector<GenotypeReference>& genotypes, const std::vector<GenomicRegion>& partitions);
+    
+    std::size_t num_genotypes() const noexcept { return genotype_haplotypes_.size(); }
+    const IndexVector& haplotypes(const std::size_t genotype) const noexcept { return genotype_haplotypes_[genotype]; }
+    const IndexVector& partition(const std::size_t p) const noexcept { return partition_ids_[p]; }
+    const IndexVector& window(std::size_t first, std::size_t last);
+    
+private:
+    struct WindowHash
+    {
+        std::size_t operator()(const std::pair<std::size_t, std::size_t>& window) const noexcept
+        {
+            return boost::hash_value(window);
+        }
+    };
+    
+    const std::vector<GenomicRegion>& partitions_;
+    std::vector<Haplotype> haplotypes_;
+    std::vector<IndexVector> genotype_haplotypes_;
+    std::vector<IndexVector> partition_ids_;
+    std::unordered_map<std::pair<std::size_t, std::size_t>, IndexVector, WindowHash> windows_;
+    
+    IndexVector project(const GenomicRegion& region) const;
+};
+
+ProjectionCache::ProjectionCache(const std::vector<GenotypeReference>& genotypes, const std::vector<GenomicRegion>& partitions)
+: partitions_ {partitions}
+, haplotypes_ {}
+, genotype_haplotypes_ {}
+, partition_ids_ {}
+, windows_ {}
+{
+    std::unordered_map<Haplotype, unsigned> haplotype_indices {};
+    genotype_haplotypes_.reserve(genotypes.size());
     for (const auto& genotype : genotypes) {
-        result.push_back({std::cref(genotype), GenotypeChunkVector {}});
-        result.back().chunks.reserve(num_partitions);
-    }
-    std::for_each(first_parition, last_partition, [&] (const auto& region) {
-        auto chunks = copy_each<Haplotype>(genotypes, region);
-        for (std::size_t i {0}; i < genotypes.size(); ++i) {
-            result[i].chunks.push_back(std::move(chunks[i]));
+        IndexVector indices {};
+        indices.reserve(genotype.get().ploidy());
+        for (const auto& haplotype : genotype.get()) {
+            const auto p = haplotype_indices.emplace(haplotype, haplotypes_.size());
+            if (p.second) haplotypes_.push_back(haplotype);
+            indices.push_back(p.first->second);
         }
+        genotype_haplotypes_.push_back(std::move(indices));
+    }
+    partition_ids_.reserve(partitions.size());
+    for (const auto& partition : partitions) {
+        partition_ids_.push_back(project(partition));
+    }
+}
+
+IndexVector ProjectionCache::project(const GenomicRegion& region) const
+{
+    std::unordered_map<Haplotype, unsigned> projection_ids {};
+    projection_ids.reserve(haplotypes_.size());
+    IndexVector result(haplotypes_.size());
+    std::transform(std::cbegin(haplotypes_), std::cend(haplotypes_), std::begin(result), [&] (const Haplotype& haplotype) {
+        return projection_ids.emplace(copy<Haplotype>(haplotype, region), projection_ids.size()).first->second;
     });
     return result;
 }
 
-struct GenotypeChunkVectorHash
+const IndexVector& ProjectionCache::window(const std::size_t first, const std::size_t last)
 {
-    auto operator()(const GenotypeChunkVector& chunks) const noexcept
-    {
-        std::size_t result {};
-        for (const auto& genotype : chunks) {
-            using boost::hash_combine;
-            hash_combine(result, std::hash<Genotype<Haplotype>>{}(genotype));
-        }
-        return result;
+    const auto key = std::make_pair(first, last);
+    auto itr = windows_.find(key);
+    if (itr == std::cend(windows_)) {
+        const auto region = encompassing_region(std::next(std::cbegin(partitions_), first), std::next(std::cbegin(partitions_), last));
+        itr = windows_.emplace(key, project(region)).first;
     }
-};
+    return itr->second;
+}
 
-using PhaseSetMap = std::unordered_map<GenotypeChunkVector, PhaseComplementSet, GenotypeChunkVectorHash>;
+// A genotype projection is the sorted projections of its haplotypes
+void append_projection(const IndexVector& genotype_haplotypes, const IndexVector& haplotype_projections, IndexVector& result)
+{
+    const auto first = result.size();
+    for (auto haplotype : genotype_haplotypes) result.push_back(haplotype_projections[haplotype]);
+    std::sort(std::next(std::begin(result), first), std::end(result));
+}
 
-PhaseComplementSets make_phase_sets(const GenotypeChunkTable& table)
+auto project(const IndexVector& genotype_haplotypes, const IndexVector& haplotype_projections)
 {
-    PhaseSetMap phase_sets {};
-    phase_sets.reserve(table.size());
-    for (const auto& row : table) {
-        phase_sets[row.chunks].push_back(row.genotype);
-    }
-    PhaseComplementSets result {};
-    result.reserve(phase_sets.size());
-    for (auto&& p : phase_sets) {
-        result.push_back(std::move(p.second));
+    IndexVector result {};
+    result.reserve(genotype_haplotypes.size());
+    append_projection(genotype_haplotypes, haplotype_projections, result);
+    return result;
+}
+
+// Genotypes that are indistinguishable within each partition have the same key
+auto project(const IndexVector& genotype_haplotypes, const ProjectionCache& cache,
+             const std::size_t first_partition, const std::size_t last_partition)
+{
+    IndexVector result {};
+    result.reserve(genotype_haplotypes.size() * (last_partition - first_partition));
+    for (auto p = first_partition; p < last_partition; ++p) {
+        append_projection(genotype_haplotypes, cache.partition(p), result);
     }
     return result;
 }
 
-template <typename Container>
+using PhaseComplementSet  = std::vector<double>; // posteriors of the chunks that are indistinguishable by partition
+using PhaseComplementSets = std::vector<PhaseComplementSet>;
+
+// Genotypes are merged into chunks by their projection onto the window encompassing region, unless
+// merge_chunks is false, and chunks are then grouped into phase complement sets by their projections
+// onto each partition in the window.
 PhaseComplementSets
-generate_phase_complement_sets(const Container& genotypes, PartitionIterator first_parition, PartitionIterator last_partition)
+make_phase_complement_sets(ProjectionCache& cache, const std::size_t first_partition, const std::size_t last_partition,
+                           const std::vector<double>& genotype_posteriors, const bool merge_chunks)
 {
-    const auto table = make_chunk_table(genotypes, first_parition, last_partition);
-    return make_phase_sets(table);
+    std::vector<double> chunk_posteriors {};
+    std::vector<std::size_t> chunk_genotypes {};
+    if (merge_chunks) {
+        const auto& window = cache.window(first_partition, last_partition);
+        IndexMap chunk_indices {};
+        chunk_indices.reserve(cache.num_genotypes());
+        for (std::size_t g {0}; g < cache.num_genotypes(); ++g) {
+            const auto p = chunk_indices.emplace(project(cache.haplotypes(g), window), chunk_posteriors.size());
+            if (p.second) {
+                chunk_posteriors.push_back(0);
+                chunk_genotypes.push_back(g);
+            }
+            chunk_posteriors[p.first->second] += genotype_posteriors[g];
+        }
+    } else {
+        chunk_posteriors = genotype_posteriors;
+        chunk_genotypes.resize(cache.num_genotypes());
+        std::iota(std::begin(chunk_genotypes), std::end(chunk_genotypes), 0);
+    }
+    IndexMap set_indices {};
+    set_indices.reserve(chunk_genotypes.size());
+    PhaseComplementSets result {};
+    for (std::size_t c {0}; c < chunk_genotypes.size(); ++c) {
+        const auto p = set_indices.emplace(project(cache.haplotypes(chunk_genotypes[c]), cache, first_partition, last_partition), result.size());
+        if (p.second) result.emplace_back();
+        result[p.first->second].push_back(chunk_posteriors[c]);
+    }
+    return result;
 }
 
-template <typename Map>
-double marginalise(const PhaseComplementSet& phase_set, const Map& genotype_posteriors)
+double marginalise(const PhaseComplementSet& phase_set)
 {
-    return std::accumulate(std::cbegin(phase_set), std::cend(phase_set), 0.0,
-                           [&] (const auto curr, const auto& genotype) {
-                               return curr + genotype_posteriors.at(genotype);
-                           });
+    return std::accumulate(std::cbegin(phase_set), std::cend(phase_set), 0.0);
 }
 
 double maximum_entropy(const std::size_t num_elements)
@@ -110,42 +193,38 @@ double maximum_entropy(const std::size_t num_elements)
     return std::log2(num_elements);
 }
 
-template <typename Map>
-double calculate_entropy(const PhaseComplementSet& phase_set, const Map& genotype_posteriors)
+double calculate_entropy(const PhaseComplementSet& phase_set)
 {
-    const auto norm = marginalise(phase_set, genotype_posteriors);
+    const auto norm = marginalise(phase_set);
     if (norm <= 0.0) {
         // if norm ~= 0 then every element in the phase must must have probability ~= 0, so it
         // just looks like a uniform distirbution
         return maximum_entropy(phase_set.size());
     }
     return std::max(0.0, -std::accumulate(std::cbegin(phase_set), std::cend(phase_set), 0.0,
-                                          [&genotype_posteriors, norm] (const auto curr, const auto& genotype) {
-                                              const auto p = genotype_posteriors.at(genotype) / norm;
+                                          [norm] (const auto curr, const auto posterior) {
+                                              const auto p = posterior / norm;
                                               return curr + p * std::log2(p);
                                           }));
 }
 
-template <typename Map>
-double calculate_relative_entropy(const PhaseComplementSet& phase_set, const Map& genotype_posteriors)
+double calculate_relative_entropy(const PhaseComplementSet& phase_set)
 {
     if (phase_set.size() < 2) return 1.0;
-    return 1.0 - calculate_entropy(phase_set, genotype_posteriors) / maximum_entropy(phase_set.size());
+    return 1.0 - calculate_entropy(phase_set) / maximum_entropy(phase_set.size());
 }
 
-template <typename Map>
-auto calculate_phase_score(const PhaseComplementSet& phase_set, const Map& genotype_posteriors)
+auto calculate_phase_score(const PhaseComplementSet& phase_set)
 {
-    return marginalise(phase_set, genotype_posteriors) * calculate_relative_entropy(phase_set, genotype_posteriors);
+    return marginalise(phase_set) * calculate_relative_entropy(phase_set);
 }
 
-template <typename Map>
-Phred<double> calculate_phase_score(const PhaseComplementSets& phase_sets, const Map& genotype_posteriors)
+Phred<double> calculate_phase_score(const PhaseComplementSets& phase_sets)
 {
     return Phred<double> { Phred<double>::Probability {
         std::max(0.0, 1.0 - std::accumulate(std::cbegin(phase_sets), std::cend(phase_sets), 0.0,
                                            [&] (const auto curr, const auto& phase_set) {
-                                               return curr + calculate_phase_score(phase_set, genotype_posteriors);
+                                               return curr + calculate_phase_score(phase_set);
                                            }))
     }};
 }
@@ -171,24 +250,6 @@ std::vector<GenotypeReference> extract_genotypes(const Phaser::GenotypePosterior
     return extract_key_refs(genotype_posteriors);
 }
 
-using GenotypeChunkPosteriorMap = std::unordered_map<Genotype<Haplotype>, double>;
-
-template <typename Container>
-auto copy_and_marginalise(const Container& genotypes,
-                          const Phaser::SampleGenotypePosteriorMap& genotype_posteriors,
-                          const GenomicRegion& region)
-{
-    auto chunks = copy_each<Haplotype>(genotypes, region);
-    GenotypeChunkPosteriorMap chunk_posteriors {genotypes.size()};
-    auto chunk_posteriors_itr = std::cbegin(chunks);
-    for (const auto& genotype : genotypes) {
-        chunk_posteriors[*chunk_posteriors_itr++] += genotype_posteriors[genotype];
-    }
-    std::sort(std::begin(chunks), std::end(chunks), GenotypeLess {});
-    chunks.erase(std::unique(std::begin(chunks), std::end(chunks)), std::end(chunks));
-    return std::make_pair(std::move(chunks), std::move(chunk_posteriors));
-}
-
 } // namespace
 
 boost::optional<Phaser::PhaseSet>
@@ -200,33 +261,34 @@ Phaser::try_phase(const std::vector<Haplotype>& haplotypes,
     return boost::none;
 }
 
+namespace {
+
 Phaser::PhaseSet::SamplePhaseRegions
 force_phase_sample(const GenomicRegion& region,
                    const std::vector<GenomicRegion>& partitions,
                    const std::vector<GenotypeReference>& genotypes,
                    const Phaser::SampleGenotypePosteriorMap& genotype_posteriors,
-                   const Phred<double> min_phase_score)
+                   const Phred<double> min_phase_score,
+                   ProjectionCache& projections)
 {
-    auto first_partition = std::cbegin(partitions);
-    auto last_partition  = std::cend(partitions);
-    auto phase_set = generate_phase_complement_sets(genotypes, first_partition, last_partition);
-    auto phase_score = calculate_phase_score(phase_set, genotype_posteriors);
+    // genotypes are in column order
+    const auto sample_posteriors = genotype_posteriors.values();
+    const std::vector<double> posteriors(std::cbegin(sample_posteriors), std::cend(sample_posteriors));
+    std::size_t first_partition {0}, last_partition {partitions.size()};
+    auto phase_score = calculate_phase_score(make_phase_complement_sets(projections, first_partition, last_partition, posteriors, false));
     if (phase_score >= min_phase_score) {
         return {Phaser::PhaseSet::PhaseRegion {region, phase_score}};
     }
     Phaser::PhaseSet::SamplePhaseRegions result {};
     --last_partition;
-    std::vector<Genotype<Haplotype>> chunks;
-    GenotypeChunkPosteriorMap chunk_posteriors;
-    while (first_partition != std::cend(partitions)) {
-        auto curr_region = encompassing_region(first_partition, last_partition);
-        std::tie(chunks, chunk_posteriors) = copy_and_marginalise(genotypes, genotype_posteriors, curr_region);
-        phase_set = generate_phase_complement_sets(chunks, first_partition, last_partition);
-        phase_score = calculate_phase_score(phase_set, chunk_posteriors);
-        if (phase_score >= min_phase_score || std::distance(first_partition, last_partition) == 1) {
-            result.emplace_back(encompassing_region(first_partition, last_partition), phase_score);
+    while (first_partition != partitions.size()) {
+        phase_score = calculate_phase_score(make_phase_complement_sets(projections, first_partition, last_partition, posteriors, true));
+        if (phase_score >= min_phase_score || last_partition - first_partition == 1) {
+            result.emplace_back(encompassing_region(std::next(std::cbegin(partitions), first_partition),
+                                                    std::next(std::cbegin(partitions), last_partition)),
+                                phase_score);
             first_partition = last_partition;
-            last_partition  = std::cend(partitions);
+            last_partition  = partitions.size();
         } else {
             --last_partition;
         }
@@ -234,6 +296,8 @@ force_phase_sample(const GenomicRegion& region,
     return result;
 }
 
+} // namespace
+
 Phaser::PhaseSet
 Phaser::force_phase(const std::vector<Haplotype>& haplotypes,
                     const GenotypePosteriorMap& genotype_posteriors,
@@ -260,11 +324,12 @@ Phaser::force_phase(const std::vector<Haplotype>& haplotypes,
         }
         return result;
     }
+    ProjectionCache projections {genotypes, partitions};
     for (const auto& p : genotype_posteriors) {
         if (genotype_calls && max_phase_score_ && min_phase_score(genotype_calls->at(p.first), p.second) >= *max_phase_score_) {
             result.phase_regions[p.first].emplace_back(haplotype_region, *max_phase_score_);
         } else {
-            auto phases = force_phase_sample(haplotype_region, partitions, genotypes, p.second, min_phase_score_);
+            auto phases = force_phase_sample(haplotype_region, partitions, genotypes, p.second, min_phase_score_, projections);
             if (max_phase_score_) {
                 for (auto& phase : phases) phase.score = std::min(phase.score, *max_phase_score_);
             }
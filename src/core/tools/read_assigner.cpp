@@ -23,6 +23,7 @@ namespace octopus {
 namespace {
 
 using HaplotypeLikelihoods = std::vector<std::vector<double>>;
+using HaplotypeMappingOffsets = std::vector<std::vector<int>>;
 
 auto vectorise(const std::vector<Haplotype>& haplotypes, const HaplotypeProbabilityMap& priors)
 {
@@ -66,29 +67,35 @@ auto calculate_support(const std::vector<Haplotype>& haplotypes,
                        const std::vector<AlignedRead>& reads,
                        const std::vector<double>& log_priors,
                        const HaplotypeLikelihoods& likelihoods,
+                       const HaplotypeMappingOffsets& mapping_offsets,
                        boost::optional<AmbiguousReadList&> ambiguous,
+                       boost::optional<HaplotypeMappingMap&> mappings,
                        const AssignmentConfig& config)
 {
     HaplotypeSupportMap result {};
+    const auto assign = [&] (const unsigned haplotype_idx, const unsigned read_idx) {
+        result[haplotypes[haplotype_idx]].push_back(reads[read_idx]);
+        if (mappings) (*mappings)[haplotypes[haplotype_idx]].push_back(mapping_offsets[haplotype_idx][read_idx]);
+    };
     std::vector<unsigned> top {};
     top.reserve(haplotypes.size());
     for (unsigned i {0}; i < reads.size(); ++i) {
         const auto& read = reads[i];
         find_map_haplotypes(haplotypes, i, likelihoods, log_priors, top);
         if (top.size() == 1) {
-            result[haplotypes[top.front()]].push_back(read);
+            assign(top.front(), i);
         } else {
             using UA = AssignmentConfig::AmbiguousAction;
             switch (config.ambiguous_action) {
                 case UA::first:
-                    result[haplotypes[top.front()]].push_back(read);
+                    assign(top.front(), i);
                     break;
                 case UA::all: {
-                    for (auto idx : top) result[haplotypes[idx]].push_back(read);
+                    for (auto idx : top) assign(idx, i);
                     break;
                 }
                 case UA::random: {
-                    result[haplotypes[random_select(top)]].push_back(read);
+                    assign(random_select(top), i);
                     break;
                 }
                 case UA::drop:
@@ -155,7 +162,7 @@ auto expand_for_alignment(const Haplotype& haplotype, const GenomicRegion& reads
 
 template <typename Container>
 auto calculate_likelihoods(const std::vector<Haplotype>& haplotypes, const Container& reads,
-                           HaplotypeLikelihoodModel& model)
+                           HaplotypeLikelihoodModel& model, HaplotypeMappingOffsets& mapping_offsets)
 {
     assert(!haplotypes.empty());
     const auto reads_region = encompassing_region(reads);
@@ -164,19 +171,24 @@ auto calculate_likelihoods(const std::vector<Haplotype>& haplotypes, const Conta
     auto haplotype_hashes = init_kmer_hash_table<mapperKmerSize>();
     HaplotypeLikelihoods result {};
     result.reserve(haplotypes.size());
+    mapping_offsets.assign(haplotypes.size(), std::vector<int>(reads.size()));
     const auto indel_factor = estimate_max_indel_size(haplotypes) + estimate_max_indel_size(reads);
-    for (const auto& haplotype : haplotypes) {
+    for (std::size_t k {0}; k < haplotypes.size(); ++k) {
+        const auto& haplotype = haplotypes[k];
         const auto expanded_haplotype = expand_for_alignment(haplotype, reads_region, indel_factor);
+        // The expansion flanks are reference, so the sequence and region offsets agree
+        const auto lhs_expansion = static_cast<int>(begin_distance(expanded_haplotype, haplotype));
         populate_kmer_hash_table<mapperKmerSize>(expanded_haplotype.sequence(), haplotype_hashes);
         auto haplotype_mapping_counts = init_mapping_counts(haplotype_hashes);
         model.reset(expanded_haplotype);
         std::vector<double> likelihoods(reads.size());
-        std::transform(std::cbegin(reads), std::cend(reads), std::cbegin(read_hashes), std::begin(likelihoods),
-                       [&] (const auto& read, const auto& read_hash) {
-                           auto mapping_positions = map_query_to_target(read_hash, haplotype_hashes, haplotype_mapping_counts);
-                           reset_mapping_counts(haplotype_mapping_counts);
-                           return model.evaluate(read, mapping_positions);
-                       });
+        for (std::size_t i {0}; i < reads.size(); ++i) {
+            auto mapping_positions = map_query_to_target(read_hashes[i], haplotype_hashes, haplotype_mapping_counts);
+            reset_mapping_counts(haplotype_mapping_counts);
+            HaplotypeLikelihoodModel::MappingPosition best_mapping_position {};
+            likelihoods[i] = model.evaluate(reads[i], mapping_positions, best_mapping_position);
+            mapping_offsets[k][i] = static_cast<int>(best_mapping_position) - lhs_expansion;
+        }
         clear_kmer_hash_table(haplotype_hashes);
         result.push_back(std::move(likelihoods));
     }
@@ -189,17 +201,19 @@ HaplotypeSupportMap
 compute_haplotype_support(const Genotype<Haplotype>& genotype,
                           const std::vector<AlignedRead>& reads,
                           const HaplotypeProbabilityMap& log_priors,
-                          HaplotypeLikelihoodModel model,
+                          HaplotypeLikelihoodModel& model,
                           boost::optional<AmbiguousReadList&> ambiguous,
-                          AssignmentConfig config)
+                          AssignmentConfig config,
+                          boost::optional<HaplotypeMappingMap&> mappings = boost::none)
 {
     if (!reads.empty()) {
         if (!genotype.is_homozygous()) {
             const auto unique_haplotypes = genotype.copy_unique();
             assert(unique_haplotypes.size() > 1);
             const auto priors = get_priors(unique_haplotypes, log_priors);
-            const auto likelihoods = calculate_likelihoods(unique_haplotypes, reads, model);
-            return calculate_support(unique_haplotypes, reads, priors, likelihoods, ambiguous, config);
+            HaplotypeMappingOffsets mapping_offsets {};
+            const auto likelihoods = calculate_likelihoods(unique_haplotypes, reads, model, mapping_offsets);
+            return calculate_support(unique_haplotypes, reads, priors, likelihoods, mapping_offsets, ambiguous, mappings, config);
         } else if (config.ambiguous_action != AssignmentConfig::AmbiguousAction::drop) {
             HaplotypeSupportMap result {};
             result.emplace(genotype[0], reads);
@@ -283,7 +297,7 @@ compute_haplotype_support(const Genotype<Haplotype>& genotype,
                           HaplotypeLikelihoodModel model,
                           AssignmentConfig config)
 {
-    return compute_haplotype_support(genotype, reads, {}, std::move(model), boost::none, config);
+    return compute_haplotype_support(genotype, reads, {}, model, boost::none, config);
 }
 
 HaplotypeSupportMap
@@ -296,6 +310,72 @@ compute_haplotype_support(const Genotype<Haplotype>& genotype,
     return compute_haplotype_support(genotype, reads, std::move(model), ambiguous, config);
 }
 
+HaplotypeSupportMap
+compute_haplotype_support(const Genotype<Haplotype>& genotype,
+                          const std::vector<AlignedRead>& reads,
+                          AmbiguousReadList& ambiguous,
+                          HaplotypeMappingMap& mappings,
+                          AssignmentConfig config)
+{
+    auto model = make_default_haplotype_likelihood_model();
+    return compute_haplotype_support(genotype, reads, {}, model, ambiguous, config, mappings);
+}
+
+namespace {
+
+std::vector<HaplotypeSupportMap>
+compute_haplotype_support_batch(const std::vector<Genotype<Haplotype>>& genotypes,
+                                const std::vector<std::vector<AlignedRead>>& reads,
+                                AmbiguousReadList& ambiguous,
+                                boost::optional<std::vector<HaplotypeMappingMap>&> mappings,
+                                AssignmentConfig config)
+{
+    assert(genotypes.size() == reads.size());
+    std::vector<HaplotypeSupportMap> result {};
+    result.reserve(genotypes.size());
+    if (mappings) mappings->assign(genotypes.size(), HaplotypeMappingMap {});
+    boost::optional<HaplotypeLikelihoodModel> model {};
+    for (std::size_t i {0}; i < genotypes.size(); ++i) {
+        if (!model && !reads[i].empty() && !genotypes[i].is_homozygous()) {
+            model = make_default_haplotype_likelihood_model();
+        }
+        if (model) {
+            boost::optional<HaplotypeMappingMap&> genotype_mappings {};
+            if (mappings) genotype_mappings = (*mappings)[i];
+            result.push_back(compute_haplotype_support(genotypes[i], reads[i], {}, *model, ambiguous, config, genotype_mappings));
+        } else {
+            // No likelihoods are needed, so the model is not made
+            HaplotypeSupportMap support {};
+            if (!reads[i].empty() && config.ambiguous_action != AssignmentConfig::AmbiguousAction::drop) {
+                support.emplace(genotypes[i][0], reads[i]);
+            }
+            result.push_back(std::move(support));
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+std::vector<HaplotypeSupportMap>
+compute_haplotype_support(const std::vector<Genotype<Haplotype>>& genotypes,
+                          const std::vector<std::vector<AlignedRead>>& reads,
+                          AmbiguousReadList& ambiguous,
+                          AssignmentConfig config)
+{
+    return compute_haplotype_support_batch(genotypes, reads, ambiguous, boost::none, config);
+}
+
+std::vector<HaplotypeSupportMap>
+compute_haplotype_support(const std::vector<Genotype<Haplotype>>& genotypes,
+                          const std::vector<std::vector<AlignedRead>>& reads,
+                          AmbiguousReadList& ambiguous,
+                          std::vector<HaplotypeMappingMap>& mappings,
+                          AssignmentConfig config)
+{
+    return compute_haplotype_support_batch(genotypes, reads, ambiguous, mappings, config);
+}
+
 AlleleSupportMap
 compute_allele_support(const std::vector<Allele>& alleles, const HaplotypeSupportMap& haplotype_support)
 {
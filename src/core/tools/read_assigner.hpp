@@ -30,6 +30,10 @@ using HaplotypeSupportMap = std::unordered_map<Haplotype, ReadSupportSet>;
 using AlignedReadConstReference = MappableReferenceWrapper<const AlignedRead>;
 using ReadRefSupportSet = std::vector<AlignedReadConstReference>;
 using AlleleSupportMap = std::unordered_map<Allele, ReadRefSupportSet>;
+// Offsets of the best mapping of each supporting read from the start of the assigned haplotype sequence, in
+// the same order as the reads in the HaplotypeSupportMap. Only haplotypes with computed likelihoods are present.
+using ReadMappingOffsets = std::vector<int>;
+using HaplotypeMappingMap = std::unordered_map<Haplotype, ReadMappingOffsets>;
 
 struct AmbiguousRead : public Mappable<AmbiguousRead>
 {
@@ -93,6 +97,28 @@ compute_haplotype_support(const Genotype<Haplotype>& genotype,
                           HaplotypeLikelihoodModel model,
                           AssignmentConfig config = AssignmentConfig {});
 
+// Also records the mappings found for the assigned reads, so they can be realigned without remapping
+HaplotypeSupportMap
+compute_haplotype_support(const Genotype<Haplotype>& genotype,
+                          const std::vector<AlignedRead>& reads,
+                          AmbiguousReadList& ambiguous,
+                          HaplotypeMappingMap& mappings,
+                          AssignmentConfig config = AssignmentConfig {});
+
+// Equivalent to calling compute_haplotype_support for each genotype with the corresponding reads, but
+// the likelihood model is made once and reused for every genotype.
+std::vector<HaplotypeSupportMap>
+compute_haplotype_support(const std::vector<Genotype<Haplotype>>& genotypes,
+                          const std::vector<std::vector<AlignedRead>>& reads,
+                          AmbiguousReadList& ambiguous,
+                          AssignmentConfig config = AssignmentConfig {});
+std::vector<HaplotypeSupportMap>
+compute_haplotype_support(const std::vector<Genotype<Haplotype>>& genotypes,
+                          const std::vector<std::vector<AlignedRead>>& reads,
+                          AmbiguousReadList& ambiguous,
+                          std::vector<HaplotypeMappingMap>& mappings,
+                          AssignmentConfig config = AssignmentConfig {});
+
 template <typename BinaryPredicate>
 AlleleSupportMap
 compute_allele_support(const std::vector<Allele>& alleles,
@@ -116,6 +116,50 @@ void realign(std::vector<AlignedRead>& reads, const Haplotype& haplotype)
     realign(reads, haplotype, make_default_haplotype_likelihood_model());
 }
 
+namespace {
+
+bool is_alignable(const int mapping_offset, const AlignedRead& read, const Haplotype& haplotype) noexcept
+{
+    const auto pad = static_cast<int>(HaplotypeLikelihoodModel::pad_requirement());
+    return mapping_offset >= pad
+           && mapping_offset + static_cast<int>(sequence_size(read)) + pad <= static_cast<int>(sequence_size(haplotype));
+}
+
+} // namespace
+
+void realign(std::vector<AlignedRead>& reads, const Haplotype& haplotype, const std::vector<int>& mapping_offsets,
+             HaplotypeLikelihoodModel model)
+{
+    assert(mapping_offsets.size() == reads.size());
+    if (!reads.empty()) {
+        std::vector<std::size_t> unmapped_indices {};
+        model.reset(haplotype);
+        HaplotypeLikelihoodModel::MappingPositionVector mapping_position(1);
+        for (std::size_t i {0}; i < reads.size(); ++i) {
+            if (is_alignable(mapping_offsets[i], reads[i], haplotype) && contains(haplotype, reads[i])) {
+                mapping_position.front() = mapping_offsets[i];
+                realign(reads[i], haplotype, model.align(reads[i], mapping_position));
+            } else {
+                unmapped_indices.push_back(i);
+            }
+        }
+        if (!unmapped_indices.empty()) {
+            std::vector<AlignedRead> unmapped_reads {};
+            unmapped_reads.reserve(unmapped_indices.size());
+            for (auto idx : unmapped_indices) unmapped_reads.push_back(std::move(reads[idx]));
+            realign(unmapped_reads, haplotype, std::move(model));
+            for (std::size_t i {0}; i < unmapped_indices.size(); ++i) {
+                reads[unmapped_indices[i]] = std::move(unmapped_reads[i]);
+            }
+        }
+    }
+}
+
+void realign(std::vector<AlignedRead>& reads, const Haplotype& haplotype, const std::vector<int>& mapping_offsets)
+{
+    realign(reads, haplotype, mapping_offsets, make_default_haplotype_likelihood_model());
+}
+
 std::vector<AlignedRead> realign(const std::vector<AlignedRead>& reads, const Haplotype& haplotype,
                                  HaplotypeLikelihoodModel model)
 {
@@ -147,6 +191,26 @@ void safe_realign(std::vector<AlignedRead>& reads, const Haplotype& haplotype)
     safe_realign(reads, haplotype, make_default_haplotype_likelihood_model());
 }
 
+namespace {
+
+void safe_realign(std::vector<AlignedRead>& reads, const Haplotype& haplotype, const std::vector<int>& mapping_offsets)
+{
+    if (!reads.empty()) {
+        auto expanded_haplotype = expand_for_realignment(haplotype, reads);
+        const auto lhs_expansion = static_cast<int>(begin_distance(expanded_haplotype, haplotype));
+        auto expanded_mapping_offsets = mapping_offsets;
+        for (auto& offset : expanded_mapping_offsets) offset += lhs_expansion;
+        try {
+            realign(reads, expanded_haplotype, expanded_mapping_offsets);
+        } catch (const HaplotypeLikelihoodModel::ShortHaplotypeError& e) {
+            expanded_haplotype = expand(expanded_haplotype, e.required_extension());
+            realign(reads, expanded_haplotype);
+        }
+    }
+}
+
+} // namespace
+
 std::vector<AlignedRead>
 safe_realign(const std::vector<AlignedRead>& reads, const Haplotype& haplotype, HaplotypeLikelihoodModel model)
 {
@@ -522,6 +586,13 @@ void safe_realign_to_reference(std::vector<AlignedRead>& reads, const Haplotype&
     safe_realign_to_reference(reads, haplotype, make_default_haplotype_likelihood_model());
 }
 
+void safe_realign_to_reference(std::vector<AlignedRead>& reads, const Haplotype& haplotype,
+                               const std::vector<int>& mapping_offsets)
+{
+    safe_realign(reads, haplotype, mapping_offsets);
+    rebase(reads, haplotype);
+}
+
 std::vector<AlignedRead>
 safe_realign_to_reference(const std::vector<AlignedRead>& reads, const Haplotype& haplotype, HaplotypeLikelihoodModel model)
 {
@@ -23,6 +23,13 @@ realign(const std::vector<AlignedRead>& reads, const Haplotype& haplotype, Haplo
 std::vector<AlignedRead>
 realign(const std::vector<AlignedRead>& reads, const Haplotype& haplotype);
 
+// mapping_offsets are the offsets of the best mapping of each read from the start of the haplotype sequence, as
+// found by the read assigner. Each read is only aligned at its offset, and reads with offsets too close to the
+// haplotype ends are remapped.
+void realign(std::vector<AlignedRead>& reads, const Haplotype& haplotype, const std::vector<int>& mapping_offsets,
+             HaplotypeLikelihoodModel model);
+void realign(std::vector<AlignedRead>& reads, const Haplotype& haplotype, const std::vector<int>& mapping_offsets);
+
 void safe_realign(std::vector<AlignedRead>& reads, const Haplotype& haplotype, HaplotypeLikelihoodModel model);
 void safe_realign(std::vector<AlignedRead>& reads, const Haplotype& haplotype);
 
@@ -44,6 +51,8 @@ realign_to_reference(const std::vector<AlignedRead>& reads, const Haplotype& hap
 
 void safe_realign_to_reference(std::vector<AlignedRead>& reads, const Haplotype& haplotype, HaplotypeLikelihoodModel model);
 void safe_realign_to_reference(std::vector<AlignedRead>& reads, const Haplotype& haplotype);
+void safe_realign_to_reference(std::vector<AlignedRead>& reads, const Haplotype& haplotype,
+                               const std::vector<int>& mapping_offsets);
 
 std::vector<AlignedRead>
 safe_realign_to_reference(const std::vector<AlignedRead>& reads, const Haplotype& haplotype, HaplotypeLikelihoodModel model);
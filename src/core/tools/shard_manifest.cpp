@@ -0,0 +1,127 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "shard_manifest.hpp"
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+#include "io/region/region_parser.hpp"
+
+namespace octopus {
+
+namespace {
+
+std::vector<GenomicRegion> make_blocks(const InputRegionMap& regions, const std::vector<GenomicRegion::ContigName>& contig_order,
+                                       const GenomicRegion::Size block_size)
+{
+    std::vector<GenomicRegion> result {};
+    for (const auto& contig : contig_order) {
+        const auto contig_regions = regions.find(contig);
+        if (contig_regions == std::cend(regions)) continue;
+        for (const auto& region : contig_regions->second) {
+            for (auto begin = region.begin(); begin < region.end(); begin += std::min(block_size, region.end() - begin)) {
+                result.emplace_back(contig, begin, std::min(begin + block_size, region.end()));
+            }
+        }
+    }
+    return result;
+}
+
+void append(const GenomicRegion& block, std::vector<GenomicRegion>& regions)
+{
+    if (!regions.empty() && is_same_contig(regions.back(), block) && regions.back().end() == block.begin()) {
+        regions.back() = encompassing_region(regions.back(), block);
+    } else {
+        regions.push_back(block);
+    }
+}
+
+GenomicRegion pad(const GenomicRegion& region, const GenomicRegion::Size padding, const ReferenceGenome& reference)
+{
+    const auto contig_size = reference.contig_size(region.contig_name());
+    const auto begin = region.begin() > padding ? region.begin() - padding : 0;
+    const auto end = std::min(region.end() + padding, contig_size);
+    return GenomicRegion {region.contig_name(), begin, end};
+}
+
+} // namespace
+
+ShardManifest make_shards(const InputRegionMap& regions, const std::vector<GenomicRegion::ContigName>& contig_order,
+                          const ReferenceGenome& reference, const RegionCostFunction& cost, ShardingConfig config)
+{
+    if (config.num_shards == 0) throw std::invalid_argument {"make_shards: num_shards must be positive"};
+    if (config.block_size == 0) throw std::invalid_argument {"make_shards: block_size must be positive"};
+    const auto blocks = make_blocks(regions, contig_order, config.block_size);
+    std::vector<double> block_costs(blocks.size());
+    std::transform(std::cbegin(blocks), std::cend(blocks), std::begin(block_costs), cost);
+    auto total_cost = std::accumulate(std::cbegin(block_costs), std::cend(block_costs), 0.0);
+    if (total_cost <= 0) {
+        // No information, so balance by size
+        std::transform(std::cbegin(blocks), std::cend(blocks), std::begin(block_costs),
+                       [] (const auto& block) { return static_cast<double>(size(block)); });
+        total_cost = std::accumulate(std::cbegin(block_costs), std::cend(block_costs), 0.0);
+    }
+    const auto target_shard_cost = total_cost / config.num_shards;
+    ShardManifest result(config.num_shards);
+    std::size_t shard {0};
+    double cumulative_cost {0};
+    for (std::size_t i {0}; i < blocks.size(); ++i) {
+        append(blocks[i], result[shard].regions);
+        cumulative_cost += block_costs[i];
+        if (shard + 1 < config.num_shards && cumulative_cost >= (shard + 1) * target_shard_cost) ++shard;
+    }
+    result.erase(std::remove_if(std::begin(result), std::end(result), [] (const auto& shard) { return shard.regions.empty(); }),
+                 std::end(result));
+    for (auto& shard : result) {
+        shard.padded_regions.reserve(shard.regions.size());
+        for (const auto& region : shard.regions) {
+            shard.padded_regions.push_back(pad(region, config.padding, reference));
+        }
+    }
+    return result;
+}
+
+void write(const ShardManifest& manifest, const boost::filesystem::path& dst)
+{
+    std::ofstream file {dst.string()};
+    if (!file) throw std::ios::failure {"Could not open " + dst.string()};
+    file << "#shard\tregion\tpadded_region\n";
+    for (std::size_t shard {0}; shard < manifest.size(); ++shard) {
+        for (std::size_t i {0}; i < manifest[shard].regions.size(); ++i) {
+            file << shard << '\t' << to_string(manifest[shard].regions[i])
+                 << '\t' << to_string(manifest[shard].padded_regions[i]) << '\n';
+        }
+    }
+}
+
+ShardManifest read_shard_manifest(const boost::filesystem::path& src, const ReferenceGenome& reference)
+{
+    std::ifstream file {src.string()};
+    if (!file) throw std::ios::failure {"Could not open " + src.string()};
+    ShardManifest result {};
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line.front() == '#') continue;
+        std::istringstream ss {line};
+        std::size_t shard;
+        std::string region, padded_region;
+        if (!(ss >> shard >> region >> padded_region)) {
+            throw std::runtime_error {"Malformed line in shard manifest " + src.string() + ": " + line};
+        }
+        if (shard > result.size() || (shard + 1 < result.size())) {
+            throw std::runtime_error {"Shards in manifest " + src.string() + " must be listed in order"};
+        }
+        if (shard == result.size()) result.emplace_back();
+        result.back().regions.push_back(io::parse_region(std::move(region), reference));
+        result.back().padded_regions.push_back(io::parse_region(std::move(padded_region), reference));
+    }
+    return result;
+}
+
+} // namespace octopus
@@ -0,0 +1,49 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef shard_manifest_hpp
+#define shard_manifest_hpp
+
+#include <vector>
+#include <cstddef>
+#include <functional>
+
+#include <boost/filesystem/path.hpp>
+
+#include "config/common.hpp"
+#include "basics/genomic_region.hpp"
+#include "io/reference/reference_genome.hpp"
+
+namespace octopus {
+
+// Shards partition the search regions so each can be called by a separate process. A shard is called
+// on its padded regions so calls near shard boundaries are made with the same flanking context as in a
+// single run, and calls are trimmed back to the unpadded regions when the shards are merged.
+struct Shard
+{
+    std::vector<GenomicRegion> regions, padded_regions;
+};
+
+using ShardManifest = std::vector<Shard>;
+
+struct ShardingConfig
+{
+    std::size_t num_shards = 1;
+    GenomicRegion::Size padding = 10'000;
+    GenomicRegion::Size block_size = 1'000'000;
+};
+
+using RegionCostFunction = std::function<double(const GenomicRegion&)>;
+
+// Splits the regions into blocks and assigns runs of consecutive blocks to shards so that each shard has
+// about the same estimated cost. Shards are ordered by contig_order, so merged shards are sorted.
+ShardManifest make_shards(const InputRegionMap& regions, const std::vector<GenomicRegion::ContigName>& contig_order,
+                          const ReferenceGenome& reference, const RegionCostFunction& cost, ShardingConfig config);
+
+void write(const ShardManifest& manifest, const boost::filesystem::path& dst);
+
+ShardManifest read_shard_manifest(const boost::filesystem::path& src, const ReferenceGenome& reference);
+
+} // namespace octopus
+
+#endif
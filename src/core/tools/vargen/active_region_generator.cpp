@@ -38,7 +38,9 @@ void ActiveRegionGenerator::add_generator(const std::string& name)
 void ActiveRegionGenerator::add_read(const SampleName& sample, const AlignedRead& read)
 {
     max_read_length_ = std::max(max_read_length_, sequence_size(read));
-    if (assembler_active_region_generator_) assembler_active_region_generator_->add(sample, read);
+    if (assembler_active_region_generator_ && !is_in_previous_read_window(read)) {
+        assembler_active_region_generator_->add(sample, read);
+    }
 }
 
 auto merge(std::vector<GenomicRegion> lhs, std::vector<GenomicRegion> rhs)
@@ -87,11 +89,33 @@ std::vector<GenomicRegion> ActiveRegionGenerator::generate(const GenomicRegion&
     }
 }
 
-void ActiveRegionGenerator::clear() noexcept
+void ActiveRegionGenerator::slide_read_window(const GenomicRegion& region)
+{
+    if (read_window_ && is_same_contig(*read_window_, region) && !begins_before(region, *read_window_)
+        && overlaps(*read_window_, region)) {
+        previous_read_window_ = std::move(read_window_);
+        if (assembler_active_region_generator_) assembler_active_region_generator_->clear_before(region);
+    } else {
+        // Evidence from the previous window cannot be reused
+        previous_read_window_ = boost::none;
+        if (assembler_active_region_generator_) assembler_active_region_generator_->clear();
+    }
+    read_window_ = region;
+}
+
+void ActiveRegionGenerator::reset_read_window() noexcept
 {
+    read_window_ = boost::none;
+    previous_read_window_ = boost::none;
     if (assembler_active_region_generator_) assembler_active_region_generator_->clear();
 }
 
+void ActiveRegionGenerator::clear() noexcept
+{
+    // With a read window, evidence is discarded as the window slides instead
+    if (!read_window_ && assembler_active_region_generator_) assembler_active_region_generator_->clear();
+}
+
 // private methods
 
 bool ActiveRegionGenerator::is_cigar_scanner(const std::string& generator) const noexcept
@@ -109,5 +133,10 @@ bool ActiveRegionGenerator::using_assembler() const noexcept
     return using_assembler_;
 }
 
+bool ActiveRegionGenerator::is_in_previous_read_window(const AlignedRead& read) const noexcept
+{
+    return previous_read_window_ && overlaps(read, *previous_read_window_);
+}
+
 } // namespace coretools
 } // namespace octopus
@@ -47,6 +47,13 @@ public:
     
     std::vector<GenomicRegion> generate(const GenomicRegion& region, const std::string& generator) const;
     
+    // Declares that subsequently added reads are those overlapping region. Read evidence is then kept
+    // between calls to clear, reads already seen in the previous window are skipped when re-added, and
+    // evidence before region is dropped, so each window slide only costs the reads new to the window.
+    void slide_read_window(const GenomicRegion& region);
+    // Drops all read evidence, e.g. when reads in a window are skipped
+    void reset_read_window() noexcept;
+    
     void clear() noexcept;
     
 private:
@@ -71,7 +78,9 @@ private:
     std::size_t max_read_length_;
     mutable boost::optional<RepeatRegions> repeats_;
     mutable boost::optional<AssemblerActiveRegions> assembler_active_regions_;
+    boost::optional<GenomicRegion> read_window_, previous_read_window_;
     
+    bool is_in_previous_read_window(const AlignedRead& read) const noexcept;
     bool is_cigar_scanner(const std::string& generator) const noexcept;
     bool is_assembler(const std::string& generator) const noexcept;
     bool using_assembler() const noexcept;
@@ -80,7 +89,15 @@ private:
 template <typename ForwardIterator>
 void ActiveRegionGenerator::add_reads(const SampleName& sample, ForwardIterator first, ForwardIterator last)
 {
-    if (assembler_active_region_generator_) assembler_active_region_generator_->add(sample, first, last);
+    if (assembler_active_region_generator_) {
+        if (previous_read_window_) {
+            std::for_each(first, last, [&] (const AlignedRead& read) {
+                if (!is_in_previous_read_window(read)) assembler_active_region_generator_->add(sample, read);
+            });
+        } else {
+            assembler_active_region_generator_->add(sample, first, last);
+        }
+    }
     std::for_each(first, last, [this] (const auto& read) { max_read_length_ = std::max(max_read_length_, sequence_size(read)); });
 }
 
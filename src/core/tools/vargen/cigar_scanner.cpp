@@ -6,6 +6,8 @@
 #include <iterator>
 #include <algorithm>
 #include <numeric>
+#include <future>
+#include <exception>
 
 #include <boost/iterator/zip_iterator.hpp>
 #include <boost/tuple/tuple.hpp>
@@ -18,6 +20,8 @@
 #include "utils/mappable_algorithms.hpp"
 #include "utils/append.hpp"
 #include "utils/sequence_utils.hpp"
+#include "utils/read_mismatches.hpp"
+#include "utils/thread_pool.hpp"
 #include "logging/logging.hpp"
 
 #include "utils/maths.hpp"
@@ -84,115 +88,85 @@ void CigarScanner::add_read(const SampleName& sample, const AlignedRead& read,
                             CoverageTracker<GenomicRegion>& coverage_tracker,
                             CoverageTracker<GenomicRegion>& forward_strand_coverage_tracker)
 {
-    using std::cbegin; using std::next; using std::move;
-    using Flag = CigarOperation::Flag;
-    const auto& read_contig   = contig_name(read);
-    const auto& read_sequence = read.sequence();
-    auto ref_index = mapped_begin(read);
-    std::size_t read_index {0};
-    GenomicRegion region;
-    double misalignment_penalty {0};
     buffer_.clear();
-    for (const auto& cigar_operation : read.cigar()) {
-        const auto op_size = cigar_operation.size();
-        switch (cigar_operation.flag()) {
-            case Flag::alignmentMatch:
-                misalignment_penalty += add_snvs_in_match_range(GenomicRegion {read_contig, ref_index, ref_index + op_size},
-                                                                read, read_index, sample);
-                read_index += op_size;
-                ref_index  += op_size;
-                break;
-            case Flag::sequenceMatch:
-                read_index += op_size;
-                ref_index  += op_size;
-                break;
-            case Flag::substitution:
-            {
-                region = GenomicRegion {read_contig, ref_index, ref_index + op_size};
-                add_candidate(region,
-                              reference_.get().fetch_sequence(region),
-                              copy(read_sequence, read_index, op_size),
-                              read, read_index, sample);
-                read_index += op_size;
-                ref_index  += op_size;
-                misalignment_penalty += op_size * options_.misalignment_parameters.snv_penalty;
-                break;
-            }
-            case Flag::insertion:
-            {
-                add_candidate(GenomicRegion {read_contig, ref_index, ref_index},
-                              "",
-                              copy(read_sequence, read_index, op_size),
-                              read, read_index, sample);
-                read_index += op_size;
-                misalignment_penalty += options_.misalignment_parameters.indel_penalty;
-                break;
-            }
-            case Flag::deletion:
-            {
-                region = GenomicRegion {read_contig, ref_index, ref_index + op_size};
-                add_candidate(move(region),
-                              reference_.get().fetch_sequence(region),
-                              "",
-                              read, read_index, sample);
-                ref_index += op_size;
-                misalignment_penalty += options_.misalignment_parameters.indel_penalty;
-                break;
-            }
-            case Flag::softClipped:
-            {
-                read_index += op_size;
-                ref_index  += op_size;
-                if (op_size > options_.misalignment_parameters.max_unpenalised_clip_size) {
-                    misalignment_penalty += options_.misalignment_parameters.clip_penalty;
-                }
-                break;
-            }
-            case Flag::hardClipped:
-            {
-                if (op_size > options_.misalignment_parameters.max_unpenalised_clip_size) {
-                    misalignment_penalty += options_.misalignment_parameters.clip_penalty;
-                }
-                break;
+    const auto misalignment_penalty = scan(read, sample, buffer_);
+    add_scanned_read(read, misalignment_penalty, std::begin(buffer_), std::end(buffer_),
+                     coverage_tracker, forward_strand_coverage_tracker);
+}
+
+struct CigarScanner::ScannedReads
+{
+    std::vector<Candidate> candidates;
+    std::vector<std::size_t> candidate_ends;
+    std::vector<double> misalignment_penalties;
+};
+
+namespace {
+
+constexpr std::size_t min_reads_per_scan_task {1000};
+
+} // namespace
+
+template <typename InputIt>
+void CigarScanner::add_reads(const SampleName& sample, InputIt first, InputIt last)
+{
+    auto& coverage_tracker = sample_read_coverage_tracker_[sample];
+    auto& forward_strand_coverage_tracker = sample_forward_strand_coverage_tracker_[sample];
+    const auto num_reads = static_cast<std::size_t>(std::distance(first, last));
+    const auto num_tasks = options_.workers ? std::min(options_.workers->size() + 1, num_reads / min_reads_per_scan_task) : 0;
+    if (num_tasks < 2) {
+        std::for_each(first, last, [&] (const AlignedRead& read) { add_read(sample, read, coverage_tracker, forward_strand_coverage_tracker); });
+        return;
+    }
+    // Reads are scanned in parallel blocks but added in order, so the result is the same as adding them serially
+    std::vector<ScannedReads> blocks(num_tasks);
+    const auto scan_block = [this, &sample] (InputIt first_read, const InputIt last_read, ScannedReads& result) {
+        for (; first_read != last_read; ++first_read) {
+            result.misalignment_penalties.push_back(scan(*first_read, sample, result.candidates));
+            result.candidate_ends.push_back(result.candidates.size());
+        }
+    };
+    std::vector<std::future<void>> block_futures {};
+    block_futures.reserve(num_tasks - 1);
+    auto first_block_read = first;
+    std::exception_ptr error {};
+    try {
+        for (std::size_t i {0}; i < num_tasks; ++i) {
+            const auto block_size = num_reads / num_tasks + (i < num_reads % num_tasks ? 1 : 0);
+            const auto last_block_read = std::next(first_block_read, block_size);
+            if (i + 1 < num_tasks) {
+                block_futures.push_back(options_.workers->push(scan_block, first_block_read, last_block_read, std::ref(blocks[i])));
+            } else {
+                scan_block(first_block_read, last_block_read, blocks[i]);
             }
-            case Flag::padding:
-                ref_index += op_size;
-                break;
-            case Flag::skipped:
-                ref_index += op_size;
-                break;
+            first_block_read = last_block_read;
         }
+    } catch (...) {
+        error = std::current_exception();
     }
-    if (options_.use_clipped_coverage_tracking) {
-        const auto clipped_region = clipped_mapped_region(read);
-        combined_read_coverage_tracker_.add(clipped_region);
-        coverage_tracker.add(clipped_region);
-        if (is_forward_strand(read)) forward_strand_coverage_tracker.add(clipped_region);
-    } else {
-        combined_read_coverage_tracker_.add(read);
-        coverage_tracker.add(read);
-        if (is_forward_strand(read)) forward_strand_coverage_tracker.add(read);
-    }
-    if (!is_likely_misaligned(read, misalignment_penalty)) {
-        utils::append(std::move(buffer_), candidates_);
-    } else {
-        utils::append(std::move(buffer_), likely_misaligned_candidates_);
-        misaligned_read_coverage_tracker_.add(clipped_mapped_region(read));
+    for (auto& future : block_futures) future.wait();
+    if (error) std::rethrow_exception(error);
+    for (auto& future : block_futures) future.get();
+    auto read_itr = first;
+    for (auto& block : blocks) {
+        auto first_candidate = std::begin(block.candidates);
+        for (std::size_t i {0}; i < block.candidate_ends.size(); ++i, ++read_itr) {
+            const auto last_candidate = std::next(std::begin(block.candidates), block.candidate_ends[i]);
+            add_scanned_read(*read_itr, block.misalignment_penalties[i], first_candidate, last_candidate,
+                             coverage_tracker, forward_strand_coverage_tracker);
+            first_candidate = last_candidate;
+        }
     }
 }
 
 void CigarScanner::do_add_reads(const SampleName& sample, ReadVectorIterator first, ReadVectorIterator last)
 {
-    auto& coverage_tracker = sample_read_coverage_tracker_[sample];
-    auto& forward_strand_coverage_tracker = sample_forward_strand_coverage_tracker_[sample];
-    std::for_each(first, last, [&] (const AlignedRead& read) { add_read(sample, read, coverage_tracker, forward_strand_coverage_tracker); });
+    add_reads(sample, first, last);
 }
 
 void CigarScanner::do_add_reads(const SampleName& sample, ReadFlatSetIterator first, ReadFlatSetIterator last)
 {
-    auto& coverage_tracker = sample_read_coverage_tracker_[sample];
-    auto& forward_strand_coverage_tracker = sample_forward_strand_coverage_tracker_[sample];
-    std::for_each(first, last, [&] (const AlignedRead& read) { add_read(sample, read, coverage_tracker, forward_strand_coverage_tracker); });
+    add_reads(sample, first, last);
 }
 
 unsigned get_min_depth(const Variant& v, const CoverageTracker<GenomicRegion>& tracker)
@@ -283,25 +257,134 @@ std::string CigarScanner::name() const
 
 // private methods
 
-double CigarScanner::add_snvs_in_match_range(const GenomicRegion& region, const AlignedRead& read,
-                                             std::size_t read_index, const SampleName& origin)
+double CigarScanner::scan(const AlignedRead& read, const SampleName& sample, std::vector<Candidate>& buffer) const
 {
-    const NucleotideSequence ref_segment {reference_.get().fetch_sequence(region)};
+    using std::cbegin; using std::next; using std::move;
+    using Flag = CigarOperation::Flag;
+    const auto& read_contig   = contig_name(read);
+    const auto& read_sequence = read.sequence();
+    auto ref_index = mapped_begin(read);
+    std::size_t read_index {0};
+    GenomicRegion region;
     double misalignment_penalty {0};
-    for (std::size_t ref_index {0}; ref_index < ref_segment.size(); ++ref_index, ++read_index) {
-        const char ref_base {ref_segment[ref_index]}, read_base {read.sequence()[read_index]};
-        if (ref_base != read_base && ref_base != 'N' && read_base != 'N') {
-            const auto begin_pos = region.begin() + static_cast<GenomicRegion::Position>(ref_index);
-            add_candidate(GenomicRegion {region.contig_name(), begin_pos, begin_pos + 1},
-                          ref_base, read_base, read, read_index, origin);
-            if (read.base_qualities()[read_index] >= options_.misalignment_parameters.snv_threshold) {
-                misalignment_penalty += options_.misalignment_parameters.snv_penalty;
+    for (const auto& cigar_operation : read.cigar()) {
+        const auto op_size = cigar_operation.size();
+        switch (cigar_operation.flag()) {
+            case Flag::alignmentMatch:
+                misalignment_penalty += add_snvs_in_match_range(GenomicRegion {read_contig, ref_index, ref_index + op_size},
+                                                                read, read_index, sample, buffer);
+                read_index += op_size;
+                ref_index  += op_size;
+                break;
+            case Flag::sequenceMatch:
+                read_index += op_size;
+                ref_index  += op_size;
+                break;
+            case Flag::substitution:
+            {
+                region = GenomicRegion {read_contig, ref_index, ref_index + op_size};
+                add_candidate(region,
+                              reference_.get().fetch_sequence(region),
+                              copy(read_sequence, read_index, op_size),
+                              read, read_index, sample, buffer);
+                read_index += op_size;
+                ref_index  += op_size;
+                misalignment_penalty += op_size * options_.misalignment_parameters.snv_penalty;
+                break;
             }
+            case Flag::insertion:
+            {
+                add_candidate(GenomicRegion {read_contig, ref_index, ref_index},
+                              "",
+                              copy(read_sequence, read_index, op_size),
+                              read, read_index, sample, buffer);
+                read_index += op_size;
+                misalignment_penalty += options_.misalignment_parameters.indel_penalty;
+                break;
+            }
+            case Flag::deletion:
+            {
+                region = GenomicRegion {read_contig, ref_index, ref_index + op_size};
+                add_candidate(move(region),
+                              reference_.get().fetch_sequence(region),
+                              "",
+                              read, read_index, sample, buffer);
+                ref_index += op_size;
+                misalignment_penalty += options_.misalignment_parameters.indel_penalty;
+                break;
+            }
+            case Flag::softClipped:
+            {
+                read_index += op_size;
+                ref_index  += op_size;
+                if (op_size > options_.misalignment_parameters.max_unpenalised_clip_size) {
+                    misalignment_penalty += options_.misalignment_parameters.clip_penalty;
+                }
+                break;
+            }
+            case Flag::hardClipped:
+            {
+                if (op_size > options_.misalignment_parameters.max_unpenalised_clip_size) {
+                    misalignment_penalty += options_.misalignment_parameters.clip_penalty;
+                }
+                break;
+            }
+            case Flag::padding:
+                ref_index += op_size;
+                break;
+            case Flag::skipped:
+                ref_index += op_size;
+                break;
         }
     }
     return misalignment_penalty;
 }
 
+void CigarScanner::add_scanned_read(const AlignedRead& read, const double misalignment_penalty,
+                                    const CandidateBufferIterator first_candidate, const CandidateBufferIterator last_candidate,
+                                    CoverageTracker<GenomicRegion>& coverage_tracker,
+                                    CoverageTracker<GenomicRegion>& forward_strand_coverage_tracker)
+{
+    if (options_.use_clipped_coverage_tracking) {
+        const auto clipped_region = clipped_mapped_region(read);
+        combined_read_coverage_tracker_.add(clipped_region);
+        coverage_tracker.add(clipped_region);
+        if (is_forward_strand(read)) forward_strand_coverage_tracker.add(clipped_region);
+    } else {
+        combined_read_coverage_tracker_.add(read);
+        coverage_tracker.add(read);
+        if (is_forward_strand(read)) forward_strand_coverage_tracker.add(read);
+    }
+    std::for_each(first_candidate, last_candidate, [this] (const Candidate& candidate) {
+        max_seen_candidate_size_ = std::max(max_seen_candidate_size_, region_size(candidate));
+    });
+    auto& destination = is_likely_misaligned(read, misalignment_penalty) ? likely_misaligned_candidates_ : candidates_;
+    destination.insert(std::end(destination), std::make_move_iterator(first_candidate), std::make_move_iterator(last_candidate));
+    if (&destination == &likely_misaligned_candidates_) {
+        misaligned_read_coverage_tracker_.add(clipped_mapped_region(read));
+    }
+}
+
+double CigarScanner::add_snvs_in_match_range(const GenomicRegion& region, const AlignedRead& read,
+                                             std::size_t read_index, const SampleName& origin,
+                                             std::vector<Candidate>& buffer) const
+{
+    const auto ref_segment = reference_.get().fetch_sequence_view(region);
+    const auto& read_sequence = read.sequence();
+    double misalignment_penalty {0};
+    for_each_reference_mismatch(read, read_index, ref_segment.data(), ref_segment.size(),
+                                [&] (const std::size_t ref_index) {
+        const auto base_index = read_index + ref_index;
+        const auto begin_pos = region.begin() + static_cast<GenomicRegion::Position>(ref_index);
+        add_candidate(GenomicRegion {region.contig_name(), begin_pos, begin_pos + 1},
+                      ref_segment[ref_index], read_sequence[base_index], read, base_index, origin, buffer);
+        if (read.base_qualities()[base_index] >= options_.misalignment_parameters.snv_threshold) {
+            misalignment_penalty += options_.misalignment_parameters.snv_penalty;
+        }
+    });
+    return misalignment_penalty;
+}
+
 void CigarScanner::generate(const GenomicRegion& region, std::vector<Variant>& result) const
 {
     using std::begin; using std::end; using std::cbegin; using std::cend; using std::next;
@@ -24,6 +24,7 @@ namespace octopus {
 
 class ReferenceGenome;
 class GenomicRegion;
+class ThreadPool;
 
 namespace coretools {
 
@@ -64,6 +65,7 @@ public:
         bool use_clipped_coverage_tracking = false;
         Variant::MappingDomain::Size max_variant_size = 2000;
         MisalignmentParameters misalignment_parameters = MisalignmentParameters {};
+        std::shared_ptr<ThreadPool> workers = nullptr; // optional, used to scan large read batches in parallel
     };
     
     CigarScanner() = delete;
@@ -86,6 +88,8 @@ private:
     void add_read(const SampleName& sample, const AlignedRead& read,
                   CoverageTracker<GenomicRegion>& coverage_tracker,
                   CoverageTracker<GenomicRegion>& forward_strand_coverage_tracker);
+    template <typename InputIt>
+    void add_reads(const SampleName& sample, InputIt first, InputIt last);
     void do_add_reads(const SampleName& sample, ReadVectorIterator first, ReadVectorIterator last) override;
     void do_add_reads(const SampleName& sample, ReadFlatSetIterator first, ReadFlatSetIterator last) override;
     std::vector<Variant> do_generate(const RegionSet& regions) const override;
@@ -117,18 +121,28 @@ private:
     std::reference_wrapper<const ReferenceGenome> reference_;
     Options options_;
     std::vector<Candidate> buffer_;
-    mutable std::deque<Candidate> candidates_, likely_misaligned_candidates_;
+    mutable std::vector<Candidate> candidates_, likely_misaligned_candidates_;
     Variant::MappingDomain::Size max_seen_candidate_size_;
     CoverageTracker<GenomicRegion> combined_read_coverage_tracker_, misaligned_read_coverage_tracker_;
     SampleCoverageTrackerMap sample_read_coverage_tracker_, sample_forward_strand_coverage_tracker_;
     
     using CandidateIterator = OverlapIterator<decltype(candidates_)::const_iterator>;
     
+    using CandidateBufferIterator = std::vector<Candidate>::iterator;
+    struct ScannedReads;
+    
     template <typename T1, typename T2, typename T3>
     void add_candidate(T1&& region, T2&& sequence_removed, T3&& sequence_added,
-                       const AlignedRead& read, std::size_t offset, const SampleName& sample);
+                       const AlignedRead& read, std::size_t offset, const SampleName& sample,
+                       std::vector<Candidate>& buffer) const;
+    double scan(const AlignedRead& read, const SampleName& sample, std::vector<Candidate>& buffer) const;
     double add_snvs_in_match_range(const GenomicRegion& region, const AlignedRead& read,
-                                   std::size_t read_index, const SampleName& origin);
+                                   std::size_t read_index, const SampleName& origin,
+                                   std::vector<Candidate>& buffer) const;
+    void add_scanned_read(const AlignedRead& read, double misalignment_penalty,
+                          CandidateBufferIterator first_candidate, CandidateBufferIterator last_candidate,
+                          CoverageTracker<GenomicRegion>& coverage_tracker,
+                          CoverageTracker<GenomicRegion>& forward_strand_coverage_tracker);
     void generate(const GenomicRegion& region, std::vector<Variant>& result) const;
     unsigned sum_base_qualities(const Candidate& candidate) const noexcept;
     bool is_likely_misaligned(const AlignedRead& read, double penalty) const;
@@ -149,15 +163,13 @@ CigarScanner::Candidate::Candidate(T1&& region, T2&& sequence_removed, T3&& sequ
 template <typename T1, typename T2, typename T3>
 void CigarScanner::add_candidate(T1&& region, T2&& sequence_removed, T3&& sequence_added,
                                  const AlignedRead& read, const std::size_t offset,
-                                 const SampleName& sample)
+                                 const SampleName& sample, std::vector<Candidate>& buffer) const
 {
-    const auto candidate_size = size(region);
-    if (candidate_size <= options_.max_variant_size) {
-        buffer_.emplace_back(std::forward<T1>(region),
-                             std::forward<T2>(sequence_removed),
-                             std::forward<T3>(sequence_added),
-                             read, offset, sample);
-        max_seen_candidate_size_ = std::max(max_seen_candidate_size_, candidate_size);
+    if (size(region) <= options_.max_variant_size) {
+        buffer.emplace_back(std::forward<T1>(region),
+                            std::forward<T2>(sequence_removed),
+                            std::forward<T3>(sequence_added),
+                            read, offset, sample);
     }
 }
 
@@ -7,8 +7,9 @@
 #include <iterator>
 #include <deque>
 #include <stdexcept>
-#include <thread>
-#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
 #include <cassert>
 
 #include "tandem/tandem.hpp"
@@ -22,6 +23,9 @@
 #include "utils/append.hpp"
 #include "utils/global_aligner.hpp"
 #include "utils/read_stats.hpp"
+#include "utils/read_mismatches.hpp"
+#include "utils/thread_pool.hpp"
+#include "utils/stage_profiler.hpp"
 #include "io/reference/reference_genome.hpp"
 #include "logging/logging.hpp"
 
@@ -51,7 +55,7 @@ auto generate_fallback_kmer_sizes(std::vector<unsigned>& result,
 } // namespace
 
 LocalReassembler::LocalReassembler(const ReferenceGenome& reference, Options options)
-: execution_policy_ {options.execution_policy}
+: workers_ {std::move(options.workers)}
 , reference_ {reference}
 , default_kmer_sizes_ {std::move(options.kmer_sizes)}
 , fallback_kmer_sizes_ {}
@@ -60,9 +64,12 @@ LocalReassembler::LocalReassembler(const ReferenceGenome& reference, Options opt
 , max_bin_overlap_ {options.bin_overlap}
 , mask_threshold_ {options.mask_threshold}
 , min_kmer_observations_ {options.min_kmer_observations}
+, mask_low_count_kmers_ {options.mask_low_count_kmers}
 , max_bubbles_ {options.max_bubbles}
 , min_bubble_score_ {options.min_bubble_score}
 , max_variant_size_ {options.max_variant_size}
+, stop_at_first_assembled_kmer_ {options.stop_at_first_assembled_kmer}
+, min_sample_evidence_ {options.min_sample_evidence}
 {
     if (max_bin_size_ == 0) {
         throw std::runtime_error {"bin size must be greater than zero"};
@@ -320,13 +327,55 @@ void remove_larger_than(std::deque<Variant>& variants, const Variant::MappingDom
                    std::end(variants));
 }
 
+namespace {
+
+bool is_variation(const CigarOperation& op) noexcept
+{
+    using Flag = CigarOperation::Flag;
+    switch (op.flag()) {
+        case Flag::alignmentMatch:
+        case Flag::sequenceMatch:
+        case Flag::padding:
+        case Flag::skipped: return false;
+        default: return true;
+    }
+}
+
+bool shows_variation(const AlignedRead& read, const ReferenceGenome& reference)
+{
+    const auto& cigar = read.cigar();
+    if (std::any_of(std::cbegin(cigar), std::cend(cigar), [] (const auto& op) { return is_variation(op); })) {
+        return true;
+    }
+    if (const auto mismatches = read.reference_mismatches()) {
+        return !mismatches->empty();
+    }
+    return !find_reference_mismatches(read, reference).empty();
+}
+
+} // namespace
+
+// Reads are pooled over samples for assembly, so in large cohorts most of the assembly input can come
+// from samples with no variation in the region. Such samples are left out.
+bool LocalReassembler::has_assembly_evidence(const ReadBuffer& reads, const GenomicRegion& region) const
+{
+    if (min_sample_evidence_ == 0) return true;
+    unsigned num_supporting_reads {0};
+    for (const auto& read : overlap_range(reads, region)) {
+        if (shows_variation(read, reference_) && ++num_supporting_reads >= min_sample_evidence_) return true;
+    }
+    return false;
+}
+
 std::vector<Variant> LocalReassembler::do_generate(const RegionSet& regions) const
 {
+    profiling::StageTimer timer {profiling::Stage::assembly};
     BinList bins {};
     SequenceBuffer masked_sequence_buffer {};
     for (const auto& region : regions) {
         prepare_bins(region, bins);
         for (const auto& p : read_buffer_) {
+            if (!has_assembly_evidence(p.second, region)) continue;
             for (const auto& read : overlap_range(p.second, region)) {
                 auto active_bins = overlapped_bins(bins, read);
                 assert(!active_bins.empty());
@@ -347,39 +396,13 @@ std::vector<Variant> LocalReassembler::do_generate(const RegionSet& regions) con
     finalise_bins(bins, regions);
     if (bins.empty()) return {};
     std::deque<Variant> candidates {};
-    if (execution_policy_ == ExecutionPolicy::seq || bins.size() < 2) {
+    if (workers_ && bins.size() > 1) {
+        assemble_with_workers(bins, candidates);
+    } else {
         for (auto& bin : bins) {
-            if (debug_log_) {
-                stream(*debug_log_) << "Assembling " << bin.size() << " reads in bin " << mapped_region(bin);
-            }
-            const auto num_default_failures = try_assemble_with_defaults(bin, candidates);
-            if (num_default_failures == default_kmer_sizes_.size()) {
-                try_assemble_with_fallbacks(bin, candidates);
+            if (run({&bin, &candidates, AssemblyStage::defaults})) {
+                run({&bin, &candidates, AssemblyStage::fallbacks});
             }
-            bin.clear();
-        }
-    } else {
-        const std::size_t num_threads {4};
-        std::vector<std::future<std::deque<Variant>>> bin_futures(std::min(bins.size(), num_threads));
-        for (auto first_bin = std::begin(bins), last_bin = std::end(bins); first_bin != last_bin; ) {
-            const auto batch_size = std::min(num_threads, static_cast<std::size_t>(std::distance(first_bin, last_bin)));
-            const auto next_bin = std::next(first_bin, batch_size);
-            auto last_future = std::transform(first_bin, next_bin, std::begin(bin_futures), [&] (Bin& bin) {
-                if (debug_log_) {
-                    stream(*debug_log_) << "Assembling " << bin.size() << " reads in bin " << mapped_region(bin);
-                }
-                return std::async([&] () {
-                    std::deque<Variant> result {};
-                    const auto num_default_failures = try_assemble_with_defaults(bin, result);
-                    if (num_default_failures == default_kmer_sizes_.size()) {
-                        try_assemble_with_fallbacks(bin, result);
-                    }
-                    bin.clear();
-                    return result;
-                });
-            });
-            std::for_each(std::begin(bin_futures), last_future, [&] (auto& f) { utils::append(f.get(), candidates); });
-            first_bin = next_bin;
         }
     }
     remove_duplicates(candidates);
@@ -461,6 +484,87 @@ void LocalReassembler::finalise_bins(BinList& bins, const RegionSet& active_regi
                                              }).base());
 }
 
+bool LocalReassembler::run(const AssemblyTask task) const
+{
+    auto& bin = *task.bin;
+    if (task.stage == AssemblyStage::defaults) {
+        if (debug_log_) {
+            stream(*debug_log_) << "Assembling " << bin.size() << " reads in bin " << mapped_region(bin);
+        }
+        const auto num_default_failures = try_assemble_with_defaults(bin, *task.result);
+        if (num_default_failures == default_kmer_sizes_.size()) return true;
+    } else {
+        try_assemble_with_fallbacks(bin, *task.result);
+    }
+    bin.clear();
+    return false;
+}
+
+struct LocalReassembler::AssemblyJob
+{
+    const LocalReassembler* reassembler;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<AssemblyTask> pending;
+    std::size_t num_unfinished_bins;
+    std::exception_ptr error;
+};
+
+void LocalReassembler::run(AssemblyJob& job, const bool wait_for_tasks)
+{
+    std::unique_lock<std::mutex> lock {job.mutex};
+    while (true) {
+        if (job.pending.empty()) {
+            if (!wait_for_tasks || job.num_unfinished_bins == 0) return;
+            job.changed.wait(lock, [&] () { return !job.pending.empty() || job.num_unfinished_bins == 0; });
+            continue;
+        }
+        const auto task = job.pending.front();
+        job.pending.pop_front();
+        const bool has_failed {job.error};
+        lock.unlock();
+        bool requires_fallbacks {false};
+        std::exception_ptr error {};
+        try {
+            if (!has_failed) requires_fallbacks = job.reassembler->run(task);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        lock.lock();
+        if (error && !job.error) job.error = error;
+        if (requires_fallbacks) {
+            // Any thread may pick up the fallback assembly, not just the one that ran the defaults
+            job.pending.push_back({task.bin, task.result, AssemblyStage::fallbacks});
+        } else {
+            --job.num_unfinished_bins;
+        }
+        job.changed.notify_all();
+    }
+}
+
+void LocalReassembler::assemble_with_workers(BinList& bins, std::deque<Variant>& result) const
+{
+    // Workers never block on each other, so the pool can be shared with other components without
+    // deadlock. The calling thread also assembles, and only returns once every bin is finished, but
+    // workers that start late may still hold the job, so it is shared.
+    std::vector<std::deque<Variant>> bin_results(bins.size());
+    auto job = std::make_shared<AssemblyJob>();
+    job->reassembler = this;
+    for (std::size_t i {0}; i < bins.size(); ++i) {
+        job->pending.push_back({&bins[i], &bin_results[i], AssemblyStage::defaults});
+    }
+    job->num_unfinished_bins = bins.size();
+    const auto num_helpers = std::min(bins.size() - 1, workers_->size());
+    for (std::size_t i {0}; i < num_helpers; ++i) {
+        workers_->push([job] () { run(*job, false); });
+    }
+    run(*job, true);
+    if (job->error) std::rethrow_exception(job->error);
+    for (auto& bin_result : bin_results) {
+        utils::append(std::move(bin_result), result);
+    }
+}
+
 namespace {
 
 template <typename L>
@@ -485,9 +589,26 @@ void log_failure(L& log, const char* type, const unsigned k)
 
 unsigned LocalReassembler::try_assemble_with_defaults(const Bin& bin, std::deque<Variant>& result) const
 {
-    unsigned num_failures {0};
+    if (bin.empty()) return 0;
+    // Every default kmer size is loaded in a single pass over the bin's reads
+    std::vector<std::unique_ptr<AssemblerInput>> inputs {};
+    inputs.reserve(default_kmer_sizes_.size());
+    std::vector<Assembler*> assemblers {};
+    assemblers.reserve(default_kmer_sizes_.size());
     for (const auto k : default_kmer_sizes_) {
-        const auto status = assemble_bin(k, bin, result);
+        inputs.push_back(prepare_assembler(k, bin));
+        if (inputs.back()) assemblers.push_back(std::addressof(inputs.back()->assembler));
+    }
+    Assembler::insert_reads(assemblers, bin.forward_read_sequences, bin.reverse_read_sequences, min_kmer_mask_count());
+    unsigned num_failures {0};
+    for (std::size_t i {0}; i < default_kmer_sizes_.size(); ++i) {
+        const auto k = default_kmer_sizes_[i];
+        auto status = AssemblerStatus::failed;
+        const auto num_prior_variants = result.size();
+        if (inputs[i]) {
+            status = try_assemble_region(inputs[i]->assembler, inputs[i]->reference_sequence, inputs[i]->region, result);
+            inputs[i].reset();
+        }
         switch (status) {
             case AssemblerStatus::success:
                 log_success(debug_log_, "Default", k);
@@ -500,6 +621,9 @@ unsigned LocalReassembler::try_assemble_with_defaults(const Bin& bin, std::deque
                 log_failure(debug_log_, "Default", k);
                 ++num_failures;
         }
+        if (stop_at_first_assembled_kmer_ && status == AssemblerStatus::success && result.size() > num_prior_variants) {
+            break;
+        }
     }
     return num_failures;
 }
@@ -549,31 +673,43 @@ GenomicRegion LocalReassembler::propose_assembler_region(const GenomicRegion& in
     }
 }
 
+unsigned LocalReassembler::min_kmer_mask_count() const noexcept
+{
+    return mask_low_count_kmers_ ? min_kmer_observations_ : 0;
+}
+
 void LocalReassembler::load(const Bin& bin, Assembler& assembler) const
 {
-    for (const auto& sequence : bin.forward_read_sequences) {
-        assembler.insert_read(sequence, Assembler::Direction::forward);
-    }
-    for (const auto& sequence : bin.reverse_read_sequences) {
-        assembler.insert_read(sequence, Assembler::Direction::reverse);
-    }
+    assembler.insert_reads(bin.forward_read_sequences, bin.reverse_read_sequences, min_kmer_mask_count());
+}
+
+LocalReassembler::AssemblerInput::AssemblerInput(const unsigned kmer_size, GenomicRegion region,
+                                                 NucleotideSequence reference_sequence)
+: region {std::move(region)}
+, reference_sequence {std::move(reference_sequence)}
+, assembler {{kmer_size, 0.01}, this->reference_sequence}
+{}
+
+std::unique_ptr<LocalReassembler::AssemblerInput>
+LocalReassembler::prepare_assembler(const unsigned kmer_size, const Bin& bin) const
+{
+    auto assemble_region = propose_assembler_region(bin.region, kmer_size);
+    if (size(assemble_region) < kmer_size) return nullptr;
+    auto reference_sequence = reference_.get().fetch_sequence(assemble_region);
+    if (!utils::is_canonical_dna(reference_sequence)) return nullptr;
+    auto result = std::make_unique<AssemblerInput>(kmer_size, std::move(assemble_region), std::move(reference_sequence));
+    if (!result->assembler.is_unique_reference()) return nullptr;
+    return result;
 }
 
 LocalReassembler::AssemblerStatus
 LocalReassembler::assemble_bin(const unsigned kmer_size, const Bin& bin, std::deque<Variant>& result) const
 {
     if (bin.empty()) return AssemblerStatus::success;
-    const auto assemble_region = propose_assembler_region(bin.region, kmer_size);
-    if (size(assemble_region) < kmer_size) return AssemblerStatus::failed;
-    const auto reference_sequence = reference_.get().fetch_sequence(assemble_region);
-    if (!utils::is_canonical_dna(reference_sequence)) return AssemblerStatus::failed;
-    Assembler assembler {{kmer_size, 0.01}, reference_sequence};
-    if (assembler.is_unique_reference()) {
-        load(bin, assembler);
-        return try_assemble_region(assembler, reference_sequence, assemble_region, result);
-    } else {
-        return AssemblerStatus::failed;
-    }
+    const auto input = prepare_assembler(kmer_size, bin);
+    if (!input) return AssemblerStatus::failed;
+    load(bin, input->assembler);
+    return try_assemble_region(input->assembler, input->reference_sequence, input->region, result);
 }
 
 bool is_inversion(const Assembler::Variant& v) noexcept
@@ -985,6 +1121,7 @@ LocalReassembler::try_assemble_region(Assembler& assembler, const NucleotideSequ
                                       const GenomicRegion& assemble_region, std::deque<Variant>& result) const
 {
     assert(assembler.is_unique_reference());
+    profiling::note_memory(footprint(assembler).bytes());
     assembler.try_recover_dangling_branches();
     assembler.prune(min_kmer_observations_);
     auto status = AssemblerStatus::success;
@@ -5,6 +5,7 @@
 #define local_reassembler_hpp
 
 #include <vector>
+#include <deque>
 #include <map>
 #include <cstddef>
 #include <functional>
@@ -25,6 +26,7 @@
 namespace octopus {
 
 class ReferenceGenome;
+class ThreadPool;
 
 namespace coretools {
 
@@ -36,17 +38,20 @@ public:
     
     struct Options
     {
-        ExecutionPolicy execution_policy              = ExecutionPolicy::seq;
+        std::shared_ptr<ThreadPool> workers           = nullptr; // optional, may be shared with other components
         std::vector<unsigned> kmer_sizes              = {10, 25, 35};
         unsigned num_fallbacks                        = 6;
         unsigned fallback_interval_size               = 10;
+        bool stop_at_first_assembled_kmer             = false;
         GenomicRegion::Size bin_size                  = 1000;
         GenomicRegion::Size bin_overlap               = 0;
         AlignedRead::BaseQuality mask_threshold       = 0;
         unsigned min_kmer_observations                = 1;
+        bool mask_low_count_kmers                     = false; // drop kmers below min_kmer_observations before insertion
         unsigned max_bubbles                          = 10;
         BubbleScoreSetter min_bubble_score            = [] (const GenomicRegion&, const ReadBaseCountMap&) { return 2.0; };
         Variant::MappingDomain::Size max_variant_size = 5000;
+        unsigned min_sample_evidence                  = 0; // reads showing variation a sample needs to be assembled, 0 to disable
     };
     
     LocalReassembler() = delete;
@@ -107,25 +112,51 @@ private:
     using BinList = std::deque<Bin>;
     
     enum class AssemblerStatus { success, partial_success, failed };
+    enum class AssemblyStage { defaults, fallbacks };
     
-    ExecutionPolicy execution_policy_;
+    struct AssemblerInput
+    {
+        AssemblerInput(unsigned kmer_size, GenomicRegion region, NucleotideSequence reference_sequence);
+        GenomicRegion region;
+        NucleotideSequence reference_sequence;
+        Assembler assembler; // refers to reference_sequence
+    };
+    
+    struct AssemblyTask
+    {
+        Bin* bin;
+        std::deque<Variant>* result;
+        AssemblyStage stage;
+    };
+    struct AssemblyJob;
+    
+    std::shared_ptr<ThreadPool> workers_;
     std::reference_wrapper<const ReferenceGenome> reference_;
     std::vector<unsigned> default_kmer_sizes_, fallback_kmer_sizes_;
     ReadBufferMap read_buffer_;
     GenomicRegion::Size max_bin_size_, max_bin_overlap_;
     AlignedRead::BaseQuality mask_threshold_;
     unsigned min_kmer_observations_;
+    bool mask_low_count_kmers_;
     unsigned max_bubbles_;
     BubbleScoreSetter min_bubble_score_;
     Variant::MappingDomain::Size max_variant_size_;
+    bool stop_at_first_assembled_kmer_;
+    unsigned min_sample_evidence_;
     
+    bool has_assembly_evidence(const ReadBuffer& reads, const GenomicRegion& region) const;
     void prepare_bins(const GenomicRegion& active_region, BinList& bins) const;
     bool should_assemble_bin(const Bin& bin) const;
     void finalise_bins(BinList& bins, const RegionSet& active_regions) const;
+    bool run(AssemblyTask task) const;
+    static void run(AssemblyJob& job, bool wait_for_tasks);
+    void assemble_with_workers(BinList& bins, std::deque<Variant>& result) const;
     unsigned try_assemble_with_defaults(const Bin& bin, std::deque<Variant>& result) const;
     void try_assemble_with_fallbacks(const Bin& bin, std::deque<Variant>& result) const;
     GenomicRegion propose_assembler_region(const GenomicRegion& input_region, unsigned kmer_size) const;
+    unsigned min_kmer_mask_count() const noexcept;
     void load(const Bin& bin, Assembler& assembler) const;
+    std::unique_ptr<AssemblerInput> prepare_assembler(unsigned kmer_size, const Bin& bin) const;
     AssemblerStatus assemble_bin(unsigned kmer_size, const Bin& bin, std::deque<Variant>& result) const;
     AssemblerStatus try_assemble_region(Assembler& assembler, const NucleotideSequence& reference_sequence,
                                         const GenomicRegion& reference_region, std::deque<Variant>& result) const;
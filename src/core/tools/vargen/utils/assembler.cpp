@@ -9,6 +9,9 @@
 #include <cmath>
 #include <numeric>
 #include <limits>
+#include <list>
+#include <queue>
+#include <functional>
 #include <cassert>
 #include <iostream>
 
@@ -25,8 +28,6 @@
 #include <boost/graph/exception.hpp>
 #include <boost/graph/graphviz.hpp>
 
-#include "ksp/yen_ksp.hpp"
-
 #include "utils/sequence_utils.hpp"
 #include "utils/append.hpp"
 #include "utils/maths.hpp"
@@ -105,6 +106,12 @@ void Assembler::insert_reference(const NucleotideSequence& sequence)
 }
 
 void Assembler::insert_read(const NucleotideSequence& sequence, const Direction strand)
+{
+    insert_read(sequence, strand, nullptr, 0);
+}
+
+void Assembler::insert_read(const NucleotideSequence& sequence, const Direction strand,
+                            const CountMinSketch* kmer_counts, const unsigned min_kmer_count)
 {
     if (sequence.size() >= kmer_size()) {
         const bool is_forward_strand {strand == Direction::forward};
@@ -115,7 +122,7 @@ void Assembler::insert_read(const NucleotideSequence& sequence, const Direction
         auto vertex_itr = vertex_cache_.find(prev_kmer);
         auto ref_kmer_itr = std::cbegin(reference_kmers_);
         if (vertex_itr == std::cend(vertex_cache_)) {
-            const auto u = add_vertex(prev_kmer);
+            const auto u = add_read_vertex(prev_kmer, kmer_counts, min_kmer_count);
             if (!u) prev_kmer_good = false;
         } else if (is_reference(vertex_itr->second)) {
             ref_kmer_itr = std::find(std::cbegin(reference_kmers_), std::cend(reference_kmers_), prev_kmer);
@@ -149,7 +156,7 @@ void Assembler::insert_read(const NucleotideSequence& sequence, const Direction
             Kmer kmer {kmer_begin, kmer_end};
             const auto kmer_itr = vertex_cache_.find(kmer);
             if (kmer_itr == std::cend(vertex_cache_)) {
-                const auto v = add_vertex(kmer);
+                const auto v = add_read_vertex(kmer, kmer_counts, min_kmer_count);
                 if (v) {
                     if (prev_kmer_good) {
                         const auto u = vertex_cache_.at(prev_kmer);
@@ -215,6 +222,23 @@ bool Assembler::is_empty() const noexcept
     return vertex_cache_.empty();
 }
 
+MemoryFootprint Assembler::footprint() const noexcept
+{
+    // listS nodes carry two list links; each vertex also owns in and out edge lists,
+    // and each edge is referenced from both of them
+    constexpr std::size_t list_node_bytes {2 * sizeof(void*)};
+    constexpr std::size_t vertex_bytes {sizeof(GraphNode) + list_node_bytes + 2 * sizeof(std::list<Edge>)};
+    constexpr std::size_t edge_bytes {sizeof(GraphEdge) + list_node_bytes + 2 * (sizeof(Edge) + list_node_bytes)};
+    constexpr std::size_t cache_entry_bytes {sizeof(Kmer) + sizeof(Vertex) + sizeof(void*) + sizeof(std::size_t)};
+    std::size_t bytes {sizeof(Assembler)};
+    bytes += boost::num_vertices(graph_) * vertex_bytes;
+    bytes += boost::num_edges(graph_) * edge_bytes;
+    bytes += vertex_cache_.size() * cache_entry_bytes + vertex_cache_.bucket_count() * sizeof(void*);
+    bytes += reference_kmers_.size() * sizeof(Kmer);
+    bytes += reference_vertices_.size() * sizeof(Vertex) + reference_edges_.size() * sizeof(Edge);
+    return bytes;
+}
+
 bool Assembler::is_acyclic() const
 {
     return !(graph_has_trivial_cycle() || graph_has_nontrivial_cycle());
@@ -519,6 +543,59 @@ void Assembler::insert_reference_into_populated_graph(const NucleotideSequence&
     reference_head_position_ = 0;
 }
 
+boost::optional<CompactKmerGraph> Assembler::make_compact_graph() const
+{
+    if (kmer_size() > CompactKmerGraph::max_kmer_size || reference_kmers_.empty()) return boost::none;
+    // Only replay into a graph with just a unique reference path, so every vertex and edge is known
+    if (boost::num_vertices(graph_) != reference_vertices_.size() || boost::num_edges(graph_) != reference_edges_.size()) {
+        return boost::none;
+    }
+    CompactKmerGraph result {kmer_size(), 4 * reference_kmers_.size()};
+    if (!result.insert_reference(std::cbegin(reference_kmers_.front()), std::cend(reference_kmers_.back()))) {
+        return boost::none;
+    }
+    assert(result.num_kmers() == reference_vertices_.size());
+    return result;
+}
+
+void Assembler::insert(const CompactKmerGraph& graph, const unsigned min_kmer_count)
+{
+    assert(graph.num_kmers() >= reference_vertices_.size());
+    const auto is_masked = [&] (const CompactKmerGraph::NodeIndex node) {
+        return !graph.is_reference(node) && graph.count(node) < min_kmer_count;
+    };
+    std::vector<Vertex> vertices(graph.num_kmers());
+    std::copy(std::cbegin(reference_vertices_), std::cend(reference_vertices_), std::begin(vertices));
+    vertex_cache_.reserve(graph.num_kmers());
+    for (auto node = reference_vertices_.size(); node < graph.num_kmers(); ++node) {
+        if (is_masked(node)) continue;
+        const auto kmer_begin = graph.kmer_begin(node);
+        const auto v = add_vertex(Kmer {kmer_begin, std::next(kmer_begin, kmer_size())});
+        assert(v);
+        vertices[node] = *v;
+    }
+    for (const auto& edge : graph.edges()) {
+        if (edge.is_reference) {
+            // reference kmer i is node i, so its out reference edge is reference_edges_[i]
+            auto& reference_edge = graph_[reference_edges_[edge.source]];
+            reference_edge.weight += edge.weight;
+            reference_edge.forward_strand_weight += edge.forward_strand_weight;
+        } else if (!is_masked(edge.source) && !is_masked(edge.target)) {
+            add_edge(vertices[edge.source], vertices[edge.target], edge.weight, edge.forward_strand_weight);
+        }
+    }
+}
+
+void Assembler::count_read_kmers(const NucleotideSequence& sequence, CountMinSketch& kmer_counts) const
+{
+    if (sequence.size() < kmer_size()) return;
+    auto kmer_end = std::next(std::cbegin(sequence), kmer_size());
+    for (auto kmer_begin = std::cbegin(sequence); ; ++kmer_begin, ++kmer_end) {
+        kmer_counts.add(Kmer {kmer_begin, kmer_end}.hash());
+        if (kmer_end == std::cend(sequence)) break;
+    }
+}
+
 bool Assembler::contains_kmer(const Kmer& kmer) const noexcept
 {
     return vertex_cache_.count(kmer) == 1;
@@ -576,6 +653,13 @@ boost::optional<Assembler::Vertex> Assembler::add_vertex(const Kmer& kmer, const
     return u;
 }
 
+boost::optional<Assembler::Vertex>
+Assembler::add_read_vertex(const Kmer& kmer, const CountMinSketch* kmer_counts, const unsigned min_kmer_count)
+{
+    if (kmer_counts && kmer_counts->count(kmer.hash()) < min_kmer_count) return boost::none;
+    return add_vertex(kmer);
+}
+
 void Assembler::remove_vertex(const Vertex v)
 {
     const auto c = vertex_cache_.erase(kmer_of(v));
@@ -1687,15 +1771,107 @@ double Assembler::bubble_score(const Path& path) const
     return result;
 }
 
-std::vector<Assembler::EdgePath> Assembler::extract_k_shortest_paths(Vertex src, Vertex dst, unsigned k) const
+// The graph is acyclic here, so all paths are loopless. The shortest path tree to dst is computed once and
+// its distances are used as an exact heuristic in a best-first search over path prefixes, so every prefix
+// expanded extends to one of the next shortest paths (a lazy form of Eppstein's algorithm). This avoids
+// rerunning Dijkstra for each spur node as Yen's algorithm does.
+std::vector<Assembler::EdgePath> Assembler::extract_k_shortest_paths(const Vertex src, const Vertex dst, const unsigned k) const
 {
-    auto weights = boost::get(&GraphEdge::transition_score, graph_);
-    auto indices = boost::get(&GraphNode::index, graph_);
-    const auto ksps = boost::yen_ksp(graph_, src, dst, std::move(weights), std::move(indices), k);
+    using ScoreType = GraphEdge::ScoreType;
+    using OutEdgeIterator = boost::graph_traits<KmerGraph>::out_edge_iterator;
     std::vector<EdgePath> result {};
+    if (k == 0 || src == dst) return result;
+    const auto num_vertices = boost::num_vertices(graph_);
+    // Reverse topological order of the vertices reachable from src without passing dst
+    std::vector<Vertex> post_order {};
+    std::vector<char> visited(num_vertices, false);
+    std::vector<std::pair<Vertex, OutEdgeIterator>> stack {};
+    visited[graph_[src].index] = true;
+    stack.emplace_back(src, boost::out_edges(src, graph_).first);
+    while (!stack.empty()) {
+        const auto v = stack.back().first;
+        auto& next_edge = stack.back().second;
+        if (v == dst || next_edge == boost::out_edges(v, graph_).second) {
+            post_order.push_back(v);
+            stack.pop_back();
+        } else {
+            const auto u = boost::target(*next_edge++, graph_);
+            if (!visited[graph_[u].index]) {
+                visited[graph_[u].index] = true;
+                stack.emplace_back(u, boost::out_edges(u, graph_).first);
+            }
+        }
+    }
+    constexpr auto unreachable = std::numeric_limits<ScoreType>::infinity();
+    std::vector<ScoreType> distance_to_dst(num_vertices, unreachable);
+    distance_to_dst[graph_[dst].index] = 0;
+    // Flatten the edges that lie on some path to dst, keyed by position in post_order
+    std::vector<std::size_t> flat_ids(num_vertices);
+    for (std::size_t i {0}; i < post_order.size(); ++i) {
+        flat_ids[graph_[post_order[i]].index] = i;
+    }
+    struct FlatEdge
+    {
+        Edge edge;
+        std::size_t target;
+        ScoreType score, score_to_dst;
+    };
+    std::vector<FlatEdge> flat_edges {};
+    std::vector<std::size_t> flat_offsets {};
+    flat_offsets.reserve(post_order.size() + 1);
+    for (const auto v : post_order) {
+        flat_offsets.push_back(flat_edges.size());
+        if (v == dst) continue;
+        auto& v_distance = distance_to_dst[graph_[v].index];
+        for (const auto e : boost::make_iterator_range(boost::out_edges(v, graph_))) {
+            const auto u = boost::target(e, graph_);
+            const auto u_distance = distance_to_dst[graph_[u].index];
+            if (u_distance != unreachable) {
+                const auto score = graph_[e].transition_score;
+                flat_edges.push_back({e, flat_ids[graph_[u].index], score, score + u_distance});
+                v_distance = std::min(v_distance, score + u_distance);
+            }
+        }
+    }
+    flat_offsets.push_back(flat_edges.size());
+    if (distance_to_dst[graph_[src].index] == unreachable) return result;
+    // Prefixes share their heads through parent links
+    struct PathPrefix
+    {
+        std::size_t vertex;
+        ScoreType score;
+        std::size_t parent, edge;
+    };
+    constexpr auto npos = std::numeric_limits<std::size_t>::max();
+    std::vector<PathPrefix> prefixes {{flat_ids[graph_[src].index], 0, npos, npos}};
+    // Ordered by estimated total score, then by depth so ties are completed before others are opened
+    using Candidate = std::pair<ScoreType, std::pair<ScoreType, std::size_t>>;
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<>> candidates {};
+    candidates.push({distance_to_dst[graph_[src].index], {-ScoreType {0}, 0}});
+    const auto flat_dst = flat_ids[graph_[dst].index];
+    // Many equally scoring paths could otherwise make the search exponential
+    const auto max_expansions = static_cast<std::size_t>(k) * post_order.size();
+    std::size_t num_expansions {0};
     result.reserve(k);
-    for (const auto& p : ksps) {
-        result.emplace_back(std::cbegin(p.second), std::cend(p.second));
+    while (!candidates.empty() && result.size() < k && num_expansions < max_expansions) {
+        const auto prefix_idx = candidates.top().second.second;
+        candidates.pop();
+        const auto prefix = prefixes[prefix_idx];
+        if (prefix.vertex == flat_dst) {
+            EdgePath path {};
+            for (auto idx = prefix_idx; prefixes[idx].parent != npos; idx = prefixes[idx].parent) {
+                path.push_back(flat_edges[prefixes[idx].edge].edge);
+            }
+            std::reverse(std::begin(path), std::end(path));
+            result.push_back(std::move(path));
+            continue;
+        }
+        ++num_expansions;
+        for (auto edge_idx = flat_offsets[prefix.vertex]; edge_idx < flat_offsets[prefix.vertex + 1]; ++edge_idx) {
+            const auto& edge = flat_edges[edge_idx];
+            prefixes.push_back({edge.target, prefix.score + edge.score, prefix_idx, edge_idx});
+            candidates.push({prefix.score + edge.score_to_dst, {-prefixes.back().score, prefixes.size() - 1}});
+        }
     }
     return result;
 }
@@ -2046,5 +2222,10 @@ bool operator==(const Assembler::Variant& lhs, const Assembler::Variant& rhs) no
     return lhs.begin_pos == rhs.begin_pos && lhs.ref.size() == rhs.ref.size() && lhs.alt == rhs.alt;
 }
 
+MemoryFootprint footprint(const Assembler& assembler) noexcept
+{
+    return assembler.footprint();
+}
+
 } // namespace coretools
 } // namespace octopus
@@ -5,6 +5,7 @@
 #define assembler_hpp
 
 #include <vector>
+#include <memory>
 #include <deque>
 #include <string>
 #include <unordered_map>
@@ -14,12 +15,17 @@
 #include <tuple>
 #include <stdexcept>
 #include <iosfwd>
+#include <algorithm>
 
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/optional.hpp>
 
 #include "concepts/equitable.hpp"
 #include "concepts/comparable.hpp"
+#include "utils/memory_footprint.hpp"
+#include "utils/count_min_sketch.hpp"
+
+#include "compact_kmer_graph.hpp"
 
 namespace octopus { namespace coretools { class Assembler; }}
 
@@ -70,11 +76,32 @@ public:
     // Threads the given read sequence into the graph
     void insert_read(const NucleotideSequence& sequence, Direction strand);
     
+    // Threads all the given read sequences into the graph, forward strand reads first. The result is
+    // the same as calling insert_read on each sequence in turn, but when the graph only contains unique
+    // reference and kmer_size() <= 32 the reads are first threaded into a CompactKmerGraph and only the
+    // unique kmers are copied into the graph.
+    // Non-reference kmers seen in fewer than min_kmer_count of the reads are masked and never enter the
+    // graph. Counts are exact for reads threaded through a CompactKmerGraph, and otherwise come from a
+    // CountMinSketch filled in a first pass over the reads, which may keep some rare kmers.
+    template <typename ForwardReadRange, typename ReverseReadRange>
+    void insert_reads(const ForwardReadRange& forward_reads, const ReverseReadRange& reverse_reads,
+                      unsigned min_kmer_count = 0);
+    
+    // Threads the read sequences into each of the assemblers, which may have different kmer sizes, in a
+    // single pass over the sequences. The result is the same as calling insert_reads on each assembler.
+    template <typename ForwardReadRange, typename ReverseReadRange>
+    static void insert_reads(const std::vector<Assembler*>& assemblers,
+                             const ForwardReadRange& forward_reads, const ReverseReadRange& reverse_reads,
+                             unsigned min_kmer_count = 0);
+    
     // Returns the current number of unique kmers in the graph
     std::size_t num_kmers() const noexcept;
     
     bool is_empty() const noexcept;
     
+    // Estimate of the memory held by the graph and kmer index
+    MemoryFootprint footprint() const noexcept;
+    
     bool is_acyclic() const;
     void remove_nonreference_cycles(bool break_chains = true);
     
@@ -187,6 +214,11 @@ private:
     
     void insert_reference_into_empty_graph(const NucleotideSequence& reference);
     void insert_reference_into_populated_graph(const NucleotideSequence& reference);
+    boost::optional<CompactKmerGraph> make_compact_graph() const;
+    void insert(const CompactKmerGraph& graph, unsigned min_kmer_count = 0);
+    void insert_read(const NucleotideSequence& sequence, Direction strand,
+                     const CountMinSketch* kmer_counts, unsigned min_kmer_count);
+    void count_read_kmers(const NucleotideSequence& sequence, CountMinSketch& kmer_counts) const;
     bool contains_kmer(const Kmer& kmer) const noexcept;
     std::size_t count_kmer(const Kmer& kmer) const noexcept;
     std::size_t reference_size() const noexcept;
@@ -194,6 +226,7 @@ private:
     bool is_reference_unique_path() const;
     Vertex null_vertex() const;
     boost::optional<Vertex> add_vertex(const Kmer& kmer, bool is_reference = false);
+    boost::optional<Vertex> add_read_vertex(const Kmer& kmer, const CountMinSketch* kmer_counts, unsigned min_kmer_count);
     void remove_vertex(Vertex v);
     void clear_and_remove_vertex(Vertex v);
     void clear_and_remove_all(const std::unordered_set<Vertex>& vertices);
@@ -328,6 +361,62 @@ private:
     NucleotideSequence reference_sequence_;
 };
 
+template <typename ForwardReadRange, typename ReverseReadRange>
+void Assembler::insert_reads(const ForwardReadRange& forward_reads, const ReverseReadRange& reverse_reads,
+                             const unsigned min_kmer_count)
+{
+    insert_reads(std::vector<Assembler*> {this}, forward_reads, reverse_reads, min_kmer_count);
+}
+
+template <typename ForwardReadRange, typename ReverseReadRange>
+void Assembler::insert_reads(const std::vector<Assembler*>& assemblers,
+                             const ForwardReadRange& forward_reads, const ReverseReadRange& reverse_reads,
+                             const unsigned min_kmer_count)
+{
+    std::vector<boost::optional<CompactKmerGraph>> compact_graphs {};
+    compact_graphs.reserve(assemblers.size());
+    std::vector<CompactKmerGraph*> packed_graphs {};
+    std::vector<Assembler*> direct_assemblers {};
+    for (auto assembler : assemblers) {
+        compact_graphs.push_back(assembler->make_compact_graph());
+        if (compact_graphs.back()) {
+            packed_graphs.push_back(std::addressof(*compact_graphs.back()));
+        } else {
+            direct_assemblers.push_back(assembler);
+        }
+    }
+    std::vector<CountMinSketch> kmer_counts {};
+    if (min_kmer_count > 1 && !direct_assemblers.empty()) {
+        constexpr std::size_t max_sketch_width {1u << 20};
+        std::size_t num_bases {0};
+        for (const NucleotideSequence& sequence : forward_reads) num_bases += sequence.size();
+        for (const NucleotideSequence& sequence : reverse_reads) num_bases += sequence.size();
+        kmer_counts.assign(direct_assemblers.size(), CountMinSketch {std::min(num_bases, max_sketch_width)});
+        const auto count = [&] (const NucleotideSequence& sequence) {
+            for (std::size_t i {0}; i < direct_assemblers.size(); ++i) {
+                direct_assemblers[i]->count_read_kmers(sequence, kmer_counts[i]);
+            }
+        };
+        for (const NucleotideSequence& sequence : forward_reads) count(sequence);
+        for (const NucleotideSequence& sequence : reverse_reads) count(sequence);
+    }
+    const auto insert = [&] (const NucleotideSequence& sequence, const Direction strand) {
+        if (!packed_graphs.empty()) {
+            CompactKmerGraph::insert(packed_graphs, std::cbegin(sequence), std::cend(sequence),
+                                     strand == Direction::forward);
+        }
+        for (std::size_t i {0}; i < direct_assemblers.size(); ++i) {
+            direct_assemblers[i]->insert_read(sequence, strand, kmer_counts.empty() ? nullptr : &kmer_counts[i],
+                                              min_kmer_count);
+        }
+    };
+    for (const NucleotideSequence& sequence : forward_reads) insert(sequence, Direction::forward);
+    for (const NucleotideSequence& sequence : reverse_reads) insert(sequence, Direction::reverse);
+    for (std::size_t i {0}; i < assemblers.size(); ++i) {
+        if (compact_graphs[i]) assemblers[i]->insert(*compact_graphs[i], min_kmer_count);
+    }
+}
+
 template <typename S1, typename S2>
 Assembler::Variant::Variant(std::size_t pos, S1&& ref, S2&& alt)
 : ref {std::forward<S1>(ref)}
@@ -337,6 +426,8 @@ Assembler::Variant::Variant(std::size_t pos, S1&& ref, S2&& alt)
 
 bool operator==(const Assembler::Variant& lhs, const Assembler::Variant& rhs) noexcept;
 
+MemoryFootprint footprint(const Assembler& assembler) noexcept;
+
 } // namespace coretools
 } // namespace octopus
 
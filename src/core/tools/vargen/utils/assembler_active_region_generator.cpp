@@ -16,6 +16,7 @@
 #include "utils/mappable_algorithms.hpp"
 #include "utils/maths.hpp"
 #include "utils/append.hpp"
+#include "utils/read_mismatches.hpp"
 
 #include <iostream>
 
@@ -291,6 +292,22 @@ void AssemblerActiveRegionGenerator::clear() noexcept
     clipped_coverage_tracker_.clear();
 }
 
+namespace {
+
+void clear_before(std::unordered_map<SampleName, CoverageTracker<GenomicRegion>>& trackers, const GenomicRegion& region)
+{
+    for (auto& p : trackers) p.second.clear_before(region);
+}
+
+} // namespace
+
+void AssemblerActiveRegionGenerator::clear_before(const GenomicRegion& region)
+{
+    coretools::clear_before(coverage_tracker_, region);
+    coretools::clear_before(interesting_read_coverages_, region);
+    coretools::clear_before(clipped_coverage_tracker_, region);
+}
+
 // private methods
 
 namespace {
@@ -298,21 +315,14 @@ namespace {
 using NucleotideSequenceIterator = AlignedRead::NucleotideSequence::const_iterator;
 using BaseQualityVectorIterator = AlignedRead::BaseQualityVector::const_iterator;
 
-bool has_snv_in_match_range(const NucleotideSequenceIterator first_ref, const NucleotideSequenceIterator last_ref,
-                            const NucleotideSequenceIterator first_base, const BaseQualityVectorIterator first_quality,
-                            const AlignedRead::BaseQuality trigger)
+bool has_snv_in_match_range(const AlignedRead& read, const std::size_t read_index, const GenomicRegion& region,
+                            const ReferenceGenome& reference, const AlignedRead::BaseQuality trigger)
 {
-    using boost::make_zip_iterator;
-    using Tuple = boost::tuple<char, char, AlignedRead::BaseQuality>;
-    const auto num_bases = std::distance(first_ref, last_ref);
-    const auto last_base = std::next(first_base, num_bases);
-    const auto last_quality = std::next(first_quality, num_bases);
-    return std::any_of(make_zip_iterator(boost::make_tuple(first_ref, first_base, first_quality)),
-                       make_zip_iterator(boost::make_tuple(last_ref, last_base, last_quality)),
-                       [trigger] (const Tuple& t) {
-                           const char ref_base  {t.get<0>()}, read_base {t.get<1>()};
-                           return ref_base != read_base && ref_base != 'N' && read_base != 'N' && t.get<2>() >= trigger;
-                       });
+    bool result {false};
+    for_each_reference_mismatch(read, read_index, reference, region, [&] (const std::size_t i) {
+        if (read.base_qualities()[read_index + i] >= trigger) result = true;
+    });
+    return result;
 }
 
 bool is_good_clip(const NucleotideSequenceIterator first_base, const NucleotideSequenceIterator last_base,
@@ -347,11 +357,7 @@ bool AssemblerActiveRegionGenerator::is_interesting(const AlignedRead& read) con
             {
                 if (snvs_interesting_) {
                     const GenomicRegion region{contig_name(read), ref_index, ref_index + op_size};
-                    const auto ref_segment = reference_.get().fetch_sequence(region);
-                    if (has_snv_in_match_range(std::cbegin(ref_segment), std::cend(ref_segment),
-                                               next(sequence_itr, read_index),
-                                               next(base_quality_itr, read_index),
-                                               trigger_quality_)) {
+                    if (has_snv_in_match_range(read, read_index, region, reference_, trigger_quality_)) {
                         return true;
                     }
                 }
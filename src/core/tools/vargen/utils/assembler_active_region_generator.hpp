@@ -54,6 +54,7 @@ public:
     std::vector<GenomicRegion> generate(const GenomicRegion& region) const;
 
     void clear() noexcept;
+    void clear_before(const GenomicRegion& region);
     
 private:
     using CoverageTrackerMap = std::unordered_map<SampleName, CoverageTracker<GenomicRegion>>;
@@ -0,0 +1,287 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "compact_kmer_graph.hpp"
+
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+#include <cassert>
+
+namespace octopus { namespace coretools {
+
+namespace {
+
+constexpr std::uint8_t invalid_base {4};
+
+std::uint8_t encode(const char base) noexcept
+{
+    switch (base) {
+        case 'A': return 0;
+        case 'C': return 1;
+        case 'G': return 2;
+        case 'T': return 3;
+        default: return invalid_base;
+    }
+}
+
+std::size_t mix(std::uint64_t x) noexcept
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return static_cast<std::size_t>(x);
+}
+
+std::size_t next_power_of_two(std::size_t n) noexcept
+{
+    std::size_t result {1};
+    while (result < n) result <<= 1;
+    return result;
+}
+
+unsigned count_bits(const std::uint8_t mask) noexcept
+{
+    return (mask & 1u) + ((mask >> 1) & 1u) + ((mask >> 2) & 1u) + ((mask >> 3) & 1u);
+}
+
+} // namespace
+
+constexpr unsigned CompactKmerGraph::max_kmer_size;
+constexpr CompactKmerGraph::NodeIndex CompactKmerGraph::empty_slot;
+constexpr CompactKmerGraph::NodeIndex CompactKmerGraph::null_node;
+
+CompactKmerGraph::CompactKmerGraph(const unsigned kmer_size, const std::size_t expected_num_kmers)
+: kmer_size_ {kmer_size}
+, kmer_mask_ {kmer_size >= max_kmer_size ? ~PackedKmer {0} : (PackedKmer {1} << (2 * kmer_size)) - 1}
+, nodes_ {}
+, table_ {}
+, edge_order_ {}
+{
+    if (kmer_size_ == 0 || kmer_size_ > max_kmer_size) {
+        throw std::invalid_argument {"CompactKmerGraph: kmer_size must be in [1, 32]"};
+    }
+    nodes_.reserve(expected_num_kmers);
+    edge_order_.reserve(expected_num_kmers);
+    table_.assign(next_power_of_two(2 * std::max(expected_num_kmers, std::size_t {8})), empty_slot);
+}
+
+unsigned CompactKmerGraph::kmer_size() const noexcept
+{
+    return kmer_size_;
+}
+
+std::size_t CompactKmerGraph::num_kmers() const noexcept
+{
+    return nodes_.size();
+}
+
+std::size_t CompactKmerGraph::num_edges() const noexcept
+{
+    return edge_order_.size();
+}
+
+bool CompactKmerGraph::is_empty() const noexcept
+{
+    return nodes_.empty();
+}
+
+bool CompactKmerGraph::insert_reference(SequenceIterator first, const SequenceIterator last)
+{
+    assert(is_empty());
+    if (std::distance(first, last) < static_cast<std::ptrdiff_t>(kmer_size_)) return false;
+    PackedKmer kmer {0};
+    unsigned num_bases {0};
+    auto prev = null_node;
+    for (auto itr = first; itr != last; ++itr) {
+        const auto base = encode(*itr);
+        if (base == invalid_base) {
+            clear();
+            return false;
+        }
+        kmer = ((kmer << 2) | base) & kmer_mask_;
+        if (++num_bases < kmer_size_) continue;
+        if (find(kmer) != null_node) {
+            clear();
+            return false;
+        }
+        const auto node = add_node(kmer, std::prev(itr, kmer_size_ - 1), true);
+        if (prev != null_node) add_edge(prev, base, node, true);
+        prev = node;
+    }
+    return true;
+}
+
+void CompactKmerGraph::insert(const SequenceIterator first, const SequenceIterator last, const bool is_forward_strand)
+{
+    PackedKmer code {0};
+    unsigned num_bases {0};
+    auto prev = null_node;
+    for (auto itr = first; itr != last; ++itr) {
+        const auto base = encode(*itr);
+        if (base == invalid_base) {
+            num_bases = 0;
+            prev = null_node;
+            continue;
+        }
+        code = (code << 2) | base;
+        if (num_bases < kmer_size_) ++num_bases;
+        if (num_bases < kmer_size_) continue;
+        prev = extend(prev, code, base, itr, is_forward_strand);
+    }
+}
+
+void CompactKmerGraph::insert(const std::vector<CompactKmerGraph*>& graphs, const SequenceIterator first,
+                              const SequenceIterator last, const bool is_forward_strand)
+{
+    std::vector<NodeIndex> prevs(graphs.size(), null_node);
+    PackedKmer code {0};
+    unsigned num_bases {0};
+    for (auto itr = first; itr != last; ++itr) {
+        const auto base = encode(*itr);
+        if (base == invalid_base) {
+            num_bases = 0;
+            std::fill(std::begin(prevs), std::end(prevs), null_node);
+            continue;
+        }
+        code = (code << 2) | base;
+        if (num_bases < max_kmer_size) ++num_bases;
+        for (std::size_t i {0}; i < graphs.size(); ++i) {
+            if (num_bases >= graphs[i]->kmer_size_) {
+                prevs[i] = graphs[i]->extend(prevs[i], code, base, itr, is_forward_strand);
+            }
+        }
+    }
+}
+
+CompactKmerGraph::SequenceIterator CompactKmerGraph::kmer_begin(const NodeIndex node) const noexcept
+{
+    return nodes_[node].first;
+}
+
+bool CompactKmerGraph::is_reference(const NodeIndex node) const noexcept
+{
+    return nodes_[node].is_reference;
+}
+
+CompactKmerGraph::WeightType CompactKmerGraph::count(const NodeIndex node) const noexcept
+{
+    return nodes_[node].count;
+}
+
+unsigned CompactKmerGraph::out_degree(const NodeIndex node) const noexcept
+{
+    return count_bits(nodes_[node].out_edges);
+}
+
+unsigned CompactKmerGraph::in_degree(const NodeIndex node) const noexcept
+{
+    return count_bits(nodes_[node].in_edges);
+}
+
+std::vector<CompactKmerGraph::Edge> CompactKmerGraph::edges() const
+{
+    std::vector<Edge> result {};
+    result.reserve(edge_order_.size());
+    for (const auto& p : edge_order_) {
+        const auto& source = nodes_[p.first];
+        result.push_back({p.first, source.successors[p.second], source.weights[p.second],
+                          source.forward_strand_weights[p.second],
+                          static_cast<bool>(source.reference_out_edges & (1u << p.second))});
+    }
+    return result;
+}
+
+void CompactKmerGraph::clear() noexcept
+{
+    nodes_.clear();
+    edge_order_.clear();
+    std::fill(std::begin(table_), std::end(table_), empty_slot);
+}
+
+// private methods
+
+std::size_t CompactKmerGraph::slot_of(const PackedKmer kmer) const noexcept
+{
+    return mix(kmer) & (table_.size() - 1);
+}
+
+CompactKmerGraph::NodeIndex CompactKmerGraph::find(const PackedKmer kmer) const noexcept
+{
+    for (auto slot = slot_of(kmer); table_[slot] != empty_slot; slot = (slot + 1) & (table_.size() - 1)) {
+        const auto node = table_[slot] - 1;
+        if (nodes_[node].kmer == kmer) return node;
+    }
+    return null_node;
+}
+
+CompactKmerGraph::NodeIndex
+CompactKmerGraph::add_node(const PackedKmer kmer, const SequenceIterator first, const bool is_reference)
+{
+    if (2 * (nodes_.size() + 1) > table_.size()) rehash(2 * table_.size());
+    const auto result = static_cast<NodeIndex>(nodes_.size());
+    nodes_.push_back({kmer, first, {}, {}, {}, 0, 0, 0, is_reference, 0});
+    auto slot = slot_of(kmer);
+    while (table_[slot] != empty_slot) slot = (slot + 1) & (table_.size() - 1);
+    table_[slot] = result + 1;
+    return result;
+}
+
+void CompactKmerGraph::rehash(const std::size_t num_slots)
+{
+    table_.assign(num_slots, empty_slot);
+    for (NodeIndex node {0}; node < nodes_.size(); ++node) {
+        auto slot = slot_of(nodes_[node].kmer);
+        while (table_[slot] != empty_slot) slot = (slot + 1) & (table_.size() - 1);
+        table_[slot] = node + 1;
+    }
+}
+
+CompactKmerGraph::Base CompactKmerGraph::front_base(const PackedKmer kmer) const noexcept
+{
+    return static_cast<Base>((kmer >> (2 * (kmer_size_ - 1))) & 3u);
+}
+
+CompactKmerGraph::NodeIndex
+CompactKmerGraph::extend(const NodeIndex prev, const PackedKmer code, const Base base, const SequenceIterator last_base,
+                         const bool is_forward_strand)
+{
+    const auto kmer = code & kmer_mask_;
+    auto node = null_node;
+    if (prev != null_node) {
+        const std::uint8_t bit = 1u << base;
+        if (nodes_[prev].out_edges & bit) {
+            // The successor is already known, which is the common case at high coverage
+            node = nodes_[prev].successors[base];
+        } else {
+            node = find(kmer);
+            if (node == null_node) node = add_node(kmer, std::prev(last_base, kmer_size_ - 1), false);
+            add_edge(prev, base, node, false);
+        }
+        auto& source = nodes_[prev];
+        ++source.weights[base];
+        if (is_forward_strand) ++source.forward_strand_weights[base];
+    } else {
+        node = find(kmer);
+        if (node == null_node) node = add_node(kmer, std::prev(last_base, kmer_size_ - 1), false);
+    }
+    ++nodes_[node].count;
+    return node;
+}
+
+void CompactKmerGraph::add_edge(const NodeIndex source, const Base base, const NodeIndex target, const bool is_reference)
+{
+    auto& node = nodes_[source];
+    const std::uint8_t bit = 1u << base;
+    assert(!(node.out_edges & bit));
+    node.out_edges |= bit;
+    if (is_reference) node.reference_out_edges |= bit;
+    node.successors[base] = target;
+    nodes_[target].in_edges |= 1u << front_base(node.kmer);
+    edge_order_.emplace_back(source, base);
+}
+
+} // namespace coretools
+} // namespace octopus
@@ -0,0 +1,122 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef compact_kmer_graph_hpp
+#define compact_kmer_graph_hpp
+
+#include <vector>
+#include <array>
+#include <string>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+
+namespace octopus { namespace coretools {
+
+/*
+ CompactKmerGraph is a weighted de Bruijn graph over 2-bit packed kmers (kmer_size <= 32).
+
+ Nodes are stored contiguously in insertion order and are found through an open-addressing table,
+ and each node has four out-edge slots (one per successor base) and four in-edge flags (one per
+ predecessor base). Threading a sequence therefore costs one table probe per kmer and allocates
+ only when a new kmer or edge is seen. Edges are also recorded in creation order so the graph can
+ be replayed into another representation deterministically.
+ */
+class CompactKmerGraph
+{
+public:
+    using NucleotideSequence = std::string;
+    using SequenceIterator   = NucleotideSequence::const_iterator;
+    using NodeIndex          = std::uint32_t;
+    using WeightType         = unsigned;
+
+    struct Edge
+    {
+        NodeIndex source, target;
+        WeightType weight, forward_strand_weight;
+        bool is_reference;
+    };
+
+    static constexpr unsigned max_kmer_size {32};
+
+    CompactKmerGraph() = delete;
+
+    CompactKmerGraph(unsigned kmer_size, std::size_t expected_num_kmers = 1024);
+
+    CompactKmerGraph(const CompactKmerGraph&)            = default;
+    CompactKmerGraph& operator=(const CompactKmerGraph&) = default;
+    CompactKmerGraph(CompactKmerGraph&&)                 = default;
+    CompactKmerGraph& operator=(CompactKmerGraph&&)      = default;
+
+    ~CompactKmerGraph() = default;
+
+    unsigned kmer_size() const noexcept;
+    std::size_t num_kmers() const noexcept;
+    std::size_t num_edges() const noexcept;
+    bool is_empty() const noexcept;
+
+    // Threads the reference sequence into an empty graph with zero weight reference edges.
+    // Returns false if the sequence is non-canonical or contains a repeated kmer, in which case
+    // the graph is left empty.
+    bool insert_reference(SequenceIterator first, SequenceIterator last);
+
+    // Threads the sequence into the graph, adding one to the weight of each edge traversed.
+    // Kmers containing non-canonical bases are skipped.
+    void insert(SequenceIterator first, SequenceIterator last, bool is_forward_strand);
+
+    // Threads the sequence into each of the graphs, which may have different kmer sizes. Each base is
+    // encoded once and every graph takes its kmers from the same rolling code.
+    static void insert(const std::vector<CompactKmerGraph*>& graphs, SequenceIterator first, SequenceIterator last,
+                       bool is_forward_strand);
+
+    // Returns an iterator to the first occurrence of the node's kmer in an inserted sequence,
+    // which must still be alive.
+    SequenceIterator kmer_begin(NodeIndex node) const noexcept;
+    bool is_reference(NodeIndex node) const noexcept;
+    // Number of times the kmer was seen in sequences threaded with insert
+    WeightType count(NodeIndex node) const noexcept;
+    unsigned out_degree(NodeIndex node) const noexcept;
+    unsigned in_degree(NodeIndex node) const noexcept;
+
+    // Edges in the order they were first created
+    std::vector<Edge> edges() const;
+
+    void clear() noexcept;
+
+private:
+    using PackedKmer = std::uint64_t;
+    using Base       = std::uint8_t;
+
+    struct Node
+    {
+        PackedKmer kmer;
+        SequenceIterator first;
+        std::array<NodeIndex, 4> successors;
+        std::array<WeightType, 4> weights, forward_strand_weights;
+        std::uint8_t out_edges, in_edges, reference_out_edges;
+        bool is_reference;
+        WeightType count;
+    };
+
+    static constexpr NodeIndex empty_slot {0};
+    static constexpr NodeIndex null_node {~NodeIndex {0}};
+
+    unsigned kmer_size_;
+    PackedKmer kmer_mask_;
+    std::vector<Node> nodes_;
+    std::vector<NodeIndex> table_; // node index + 1, or empty_slot
+    std::vector<std::pair<NodeIndex, Base>> edge_order_;
+
+    std::size_t slot_of(PackedKmer kmer) const noexcept;
+    NodeIndex find(PackedKmer kmer) const noexcept;
+    NodeIndex add_node(PackedKmer kmer, SequenceIterator first, bool is_reference);
+    void rehash(std::size_t num_slots);
+    Base front_base(PackedKmer kmer) const noexcept;
+    void add_edge(NodeIndex source, Base base, NodeIndex target, bool is_reference);
+    NodeIndex extend(NodeIndex prev, PackedKmer code, Base base, SequenceIterator last_base, bool is_forward_strand);
+};
+
+} // namespace coretools
+} // namespace octopus
+
+#endif
@@ -6,6 +6,7 @@
 #include <vector>
 #include <deque>
 #include <cstddef>
+#include <cstdint>
 #include <algorithm>
 #include <iterator>
 #include <functional>
@@ -21,120 +22,94 @@ struct Cell
     ScoreType match = 0, insertion = 0, deletion = 0;
 };
 
-using DPMatrix = std::vector<std::vector<Cell>>;
-
-auto ncols(const DPMatrix& matrix) noexcept
+// Only two rows of scores are kept. The traceback only needs, for each cell, the best state and
+// whether each gap state was opened from the match state, which packs into one byte rather than
+// three scores.
+enum TracebackFlag : std::uint8_t
 {
-    return matrix.size();
-}
+    bestMatch     = 0,
+    bestInsertion = 1,
+    bestDeletion  = 2,
+    bestMask      = 3,
+    insertionOpen = 4,
+    deletionOpen  = 8
+};
 
-auto nrows(const DPMatrix& matrix) noexcept
+class TracebackMatrix
 {
-    return matrix.front().size();
-}
+public:
+    TracebackMatrix(std::size_t ncols, std::size_t nrows) : nrows_ {nrows}, flags_(ncols * nrows) {}
+    std::size_t ncols() const noexcept { return flags_.size() / nrows_; }
+    std::size_t nrows() const noexcept { return nrows_; }
+    std::uint8_t& operator()(std::size_t i, std::size_t j) noexcept { return flags_[i * nrows_ + j]; }
+    std::uint8_t operator()(std::size_t i, std::size_t j) const noexcept { return flags_[i * nrows_ + j]; }
+private:
+    std::size_t nrows_;
+    std::vector<std::uint8_t> flags_;
+};
 
-auto init_dp_matrix(const std::string& target, const std::string& query, const Model& model)
+std::uint8_t best_state(const Cell& cell) noexcept
 {
-    assert(!(target.empty() || query.empty()));
-    DPMatrix result(target.size() + 1, DPMatrix::value_type(query.size() + 1));
-    using ScoreType = Cell::ScoreType;
-    const ScoreType inf {std::min(model.mismatch, model.gap_open) * static_cast<ScoreType>(std::max(ncols(result), nrows(result)))};
-    for (std::size_t i {1}; i < ncols(result); ++i) {
-        result[i][0] = {inf, inf, model.gap_open + static_cast<ScoreType>(i - 1) * model.gap_extend};
-    }
-    for (std::size_t j {1}; j < nrows(result); ++j) {
-        result[0][j] = {inf, model.gap_open + static_cast<ScoreType>(j - 1) * model.gap_extend, inf};
+    if (cell.match >= cell.deletion) {
+        return cell.match >= cell.insertion ? bestMatch : bestInsertion;
+    } else {
+        return cell.deletion >= cell.insertion ? bestDeletion : bestInsertion;
     }
-    return result;
-}
-
-auto match(const std::string& target, const std::string& query,
-           const DPMatrix& matrix, const std::size_t i, const std::size_t j,
-           const Model& model) noexcept
-{
-    const auto penalty = target[i - 1] == query[j - 1] ? model.match : model.mismatch;
-    const auto& prev = matrix[i - 1][j - 1];
-    return std::max({prev.match, prev.insertion, prev.deletion}) + penalty;
-}
-
-auto insertion(const DPMatrix& matrix, const std::size_t i, const std::size_t j, const Model& model) noexcept
-{
-    const auto& prev = matrix[i][j - 1];
-    return std::max(prev.insertion + model.gap_extend, prev.match + model.gap_open);
-}
-
-auto deletion(const DPMatrix& matrix, const std::size_t i, const std::size_t j, const Model& model) noexcept
-{
-    const auto& prev = matrix[i - 1][j];
-    return std::max(prev.deletion + model.gap_extend, prev.match + model.gap_open);
 }
 
-void fill(const std::string& target, const std::string& query,
-          DPMatrix& matrix, const std::size_t i, const std::size_t j,
-          const Model& model) noexcept
+std::uint8_t make_flags(const Cell& curr, const Cell& up, const Cell& left, const Model& model) noexcept
 {
-    auto& curr = matrix[i][j];
-    curr.match     = match(target, query, matrix, i, j, model);
-    curr.insertion = insertion(matrix, i, j, model);
-    curr.deletion  = deletion(matrix, i, j, model);
+    std::uint8_t result {best_state(curr)};
+    if (curr.insertion == left.match + model.gap_open) result |= insertionOpen;
+    if (curr.deletion == up.match + model.gap_open) result |= deletionOpen;
+    return result;
 }
 
-void fill(DPMatrix& matrix, const std::string& target, const std::string& query, const Model& model) noexcept
+auto fill(const std::string& target, const std::string& query, TracebackMatrix& traceback, const Model& model)
 {
-    for (std::size_t i {1}; i < ncols(matrix); ++i) {
-        for (std::size_t j {1}; j < nrows(matrix); ++j) {
-            fill(target, query, matrix, i, j, model);
+    assert(!(target.empty() || query.empty()));
+    using ScoreType = Cell::ScoreType;
+    const auto ncols = target.size() + 1, nrows = query.size() + 1;
+    const ScoreType inf {std::min(model.mismatch, model.gap_open) * static_cast<ScoreType>(std::max(ncols, nrows))};
+    std::vector<Cell> prev(nrows), curr(nrows);
+    for (std::size_t j {1}; j < nrows; ++j) {
+        prev[j] = {inf, model.gap_open + static_cast<ScoreType>(j - 1) * model.gap_extend, inf};
+        traceback(0, j) = make_flags(prev[j], Cell {inf, inf, inf}, prev[j - 1], model);
+    }
+    for (std::size_t i {1}; i < ncols; ++i) {
+        curr[0] = {inf, inf, model.gap_open + static_cast<ScoreType>(i - 1) * model.gap_extend};
+        traceback(i, 0) = make_flags(curr[0], prev[0], Cell {inf, inf, inf}, model);
+        const auto base = target[i - 1];
+        for (std::size_t j {1}; j < nrows; ++j) {
+            const auto& diag = prev[j - 1];
+            const auto& up   = prev[j];
+            const auto& left = curr[j - 1];
+            auto& cell = curr[j];
+            cell.match     = std::max({diag.match, diag.insertion, diag.deletion}) + (base == query[j - 1] ? model.match : model.mismatch);
+            cell.insertion = std::max(left.insertion + model.gap_extend, left.match + model.gap_open);
+            cell.deletion  = std::max(up.deletion + model.gap_extend, up.match + model.gap_open);
+            traceback(i, j) = make_flags(cell, up, left, model);
         }
+        std::swap(prev, curr);
     }
+    const auto& last = prev.back();
+    return std::max({last.match, last.insertion, last.deletion});
 }
 
-auto build_dp_matrix(const std::string& target, const std::string& query, const Model& model)
-{
-    auto result = init_dp_matrix(target, query, model);
-    fill(result, target, query, model);
-    return result;
-}
-
-char traceback(const std::string& target, const std::string& query, const DPMatrix& matrix,
-               const std::size_t i, const std::size_t j, const Model& model, const char prev_state) noexcept
+char traceback(const std::string& target, const std::string& query, const TracebackMatrix& matrix,
+               const std::size_t i, const std::size_t j, const char prev_state) noexcept
 {
-    const auto& curr = matrix[i][j];
-    if (prev_state == '$') {
-        if (curr.match >= curr.deletion) {
-            if (curr.match >= curr.insertion) {
-                return target[i - 1] == query[j - 1] ? '=' : 'X';
-            } else {
-                return 'I';
-            }
-        } else {
-            return curr.deletion >= curr.insertion ? 'D' : 'I';
-        }
+    const auto match_state = [&] () { return target[i - 1] == query[j - 1] ? '=' : 'X'; };
+    if (prev_state == 'D') {
+        return matrix(i + 1, j) & deletionOpen ? match_state() : 'D';
+    } else if (prev_state == 'I') {
+        return matrix(i, j + 1) & insertionOpen ? match_state() : 'I';
     } else {
-        if (prev_state == '=' || prev_state == 'X') {
-            if (curr.match >= curr.deletion) {
-                if (curr.match >= curr.insertion) {
-                    return target[i - 1] == query[j - 1] ? '=' : 'X';
-                } else {
-                    return 'I';
-                }
-            } else {
-                return curr.deletion >= curr.insertion ? 'D' : 'I';
-            }
-        } else if (prev_state == 'D') {
-            const auto& prev = matrix[i + 1][j];
-            if (prev.deletion == curr.match + model.gap_open) {
-                return target[i - 1] == query[j - 1] ? '=' : 'X';
-            } else {
-                return 'D';
-            }
-        } else {
-            assert(prev_state == 'I');
-            const auto& prev = matrix[i][j + 1];
-            if (prev.insertion == curr.match + model.gap_open) {
-                return target[i - 1] == query[j - 1] ? '=' : 'X';
-            } else {
-                return 'I';
-            }
+        assert(prev_state == '$' || prev_state == '=' || prev_state == 'X');
+        switch (matrix(i, j) & bestMask) {
+            case bestMatch: return match_state();
+            case bestDeletion: return 'D';
+            default: return 'I';
         }
     }
 }
@@ -158,15 +133,15 @@ auto make_cigar(const AlignmentString& alignment)
     return result;
 }
 
-auto extract_alignment(const std::string& target, const std::string& query, const DPMatrix& matrix, const Model& model)
+auto extract_alignment(const std::string& target, const std::string& query, const TracebackMatrix& matrix)
 {
     AlignmentString alignment {};
-    auto i = ncols(matrix) - 1;
-    auto j = nrows(matrix) - 1;
+    auto i = matrix.ncols() - 1;
+    auto j = matrix.nrows() - 1;
     char state {'$'};
     while(i > 0 || j > 0) {
         using Flag = CigarOperation::Flag;
-        state = traceback(target, query, matrix, i, j, model, state);
+        state = traceback(target, query, matrix, i, j, state);
         switch(state) {
             case '=':
             {
@@ -203,12 +178,6 @@ auto extract_alignment(const std::string& target, const std::string& query, cons
     return make_cigar(alignment);
 }
 
-auto score(const DPMatrix& matrix) noexcept
-{
-    const auto& last = matrix.back().back();
-    return std::max({last.match, last.insertion, last.deletion});
-}
-
 } // namespace
 
 Alignment align(const std::string& target, const std::string& query, Model model)
@@ -224,8 +193,9 @@ Alignment align(const std::string& target, const std::string& query, Model model
         return {CigarString {CigarOperation {static_cast<Size>(target.size()), Flag::deletion}},
                 model.gap_open + static_cast<int>(target.size() - 1) * model.gap_extend};
     }
-    const auto matrix = build_dp_matrix(target, query, model);
-    return {extract_alignment(target, query, matrix, model), score(matrix)};
+    TracebackMatrix traceback {target.size() + 1, query.size() + 1};
+    const auto score = fill(target, query, traceback, model);
+    return {extract_alignment(target, query, traceback), score};
 }
 
 } // namespace coretools
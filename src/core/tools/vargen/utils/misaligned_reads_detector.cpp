@@ -7,13 +7,11 @@
 #include <algorithm>
 #include <cassert>
 
-#include <boost/iterator/zip_iterator.hpp>
-#include <boost/tuple/tuple.hpp>
-
 #include "basics/cigar_string.hpp"
 #include "utils/mappable_algorithms.hpp"
 #include "utils/maths.hpp"
 #include "utils/append.hpp"
+#include "utils/read_mismatches.hpp"
 
 namespace octopus { namespace coretools {
 
@@ -59,24 +57,14 @@ void MisalignedReadsDetector::clear() noexcept
 
 namespace {
 
-using NucleotideSequenceIterator = AlignedRead::NucleotideSequence::const_iterator;
-using BaseQualityVectorIterator  = AlignedRead::BaseQualityVector::const_iterator;
-
-bool count_snvs_in_match_range(const NucleotideSequenceIterator first_ref, const NucleotideSequenceIterator last_ref,
-                               const NucleotideSequenceIterator first_base, const BaseQualityVectorIterator first_quality,
-                               const AlignedRead::BaseQuality trigger)
+unsigned count_snvs_in_match_range(const AlignedRead& read, const std::size_t read_index, const GenomicRegion& region,
+                                   const ReferenceGenome& reference, const AlignedRead::BaseQuality trigger)
 {
-    using boost::make_zip_iterator;
-    using Tuple = boost::tuple<char, char, AlignedRead::BaseQuality>;
-    const auto num_bases = std::distance(first_ref, last_ref);
-    const auto last_base = std::next(first_base, num_bases);
-    const auto last_quality = std::next(first_quality, num_bases);
-    return std::count_if(make_zip_iterator(boost::make_tuple(first_ref, first_base, first_quality)),
-                        make_zip_iterator(boost::make_tuple(last_ref, last_base, last_quality)),
-                        [trigger](const Tuple& t) {
-                            const char ref_base{t.get<0>()}, read_base{t.get<1>()};
-                            return ref_base != read_base && ref_base != 'N' && read_base != 'N' && t.get<2>() >= trigger;
-                        });
+    unsigned result {0};
+    for_each_reference_mismatch(read, read_index, reference, region, [&] (const std::size_t i) {
+        if (read.base_qualities()[read_index + i] >= trigger) ++result;
+    });
+    return result;
 }
 
 double ln_probability_read_correctly_aligned(const double misalign_penalty, const AlignedRead& read,
@@ -98,11 +86,18 @@ double ln_probability_read_correctly_aligned(const double misalign_penalty, cons
 
 bool MisalignedReadsDetector::is_likely_misaligned(const AlignedRead& read) const
 {
-    using std::cbegin; using std::next; using std::move;
+    using std::cbegin; using std::cend; using std::next;
     using Flag = CigarOperation::Flag;
-    const auto& read_sequence = read.sequence();
-    auto sequence_itr = cbegin(read_sequence);
-    auto base_quality_itr = cbegin(read.base_qualities());
+    const auto base_quality_itr = cbegin(read.base_qualities());
+    const auto is_snv_quality = [this] (const AlignedRead::BaseQuality quality) { return quality >= options_.snv_threshold; };
+    const auto mismatches = read.reference_mismatches();
+    std::size_t num_snvs {0};
+    if (mismatches) {
+        // The cached mismatches cover all match operations, so no reference is needed
+        num_snvs = std::count_if(cbegin(*mismatches), cend(*mismatches), [&] (const auto read_index) {
+            return is_snv_quality(*next(base_quality_itr, read_index));
+        });
+    }
     auto ref_index = mapped_begin(read);
     std::size_t read_index {0};
     double misalignment_penalty {0};
@@ -111,51 +106,24 @@ bool MisalignedReadsDetector::is_likely_misaligned(const AlignedRead& read) cons
         switch (cigar_operation.flag()) {
             case Flag::alignmentMatch:
             {
-                const GenomicRegion region {contig_name(read), ref_index, ref_index + op_size};
-                const auto ref_segment = reference_.get().fetch_sequence(region);
-                auto num_snvs = count_snvs_in_match_range(std::cbegin(ref_segment), std::cend(ref_segment),
-                                                          next(sequence_itr, read_index),
-                                                          next(base_quality_itr, read_index),
-                                                          options_.snv_threshold);
-                misalignment_penalty += num_snvs * options_.snv_penalty;
-                read_index += op_size;
-                ref_index += op_size;
+                if (!mismatches) {
+                    const GenomicRegion region {contig_name(read), ref_index, ref_index + op_size};
+                    num_snvs += count_snvs_in_match_range(read, read_index, region, reference_, options_.snv_threshold);
+                }
                 break;
             }
-            case Flag::sequenceMatch:
-                read_index += op_size;
-                ref_index += op_size;
-                break;
             case Flag::substitution:
             {
-                auto num_snvs = std::count_if(next(base_quality_itr, read_index), next(base_quality_itr, read_index + op_size),
-                                              [this] (const AlignedRead::BaseQuality quality) { return quality >= options_.snv_threshold; });
-                misalignment_penalty += num_snvs * options_.snv_penalty;
-                read_index += op_size;
-                ref_index += op_size;
+                num_snvs += std::count_if(next(base_quality_itr, read_index), next(base_quality_itr, read_index + op_size), is_snv_quality);
                 break;
             }
             case Flag::insertion:
-            {
-                read_index += op_size;
-                misalignment_penalty += options_.indel_penalty;
-                break;
-            }
             case Flag::deletion:
             {
-                ref_index += op_size;
                 misalignment_penalty += options_.indel_penalty;
                 break;
             }
             case Flag::softClipped:
-            {
-                if (op_size > options_.max_unpenalised_clip_size) {
-                    misalignment_penalty += options_.clip_penalty;
-                }
-                read_index += op_size;
-                ref_index += op_size;
-                break;
-            }
             case Flag::hardClipped:
             {
                 if (op_size > options_.max_unpenalised_clip_size) {
@@ -163,14 +131,12 @@ bool MisalignedReadsDetector::is_likely_misaligned(const AlignedRead& read) cons
                 }
                 break;
             }
-            case Flag::padding:
-                ref_index += op_size;
-                break;
-            case Flag::skipped:
-                ref_index += op_size;
-                break;
+            default: break;
         }
+        if (advances_sequence(cigar_operation)) read_index += op_size;
+        if (advances_reference(cigar_operation) || cigar_operation.flag() == Flag::padding) ref_index += op_size;
     }
+    misalignment_penalty += num_snvs * options_.snv_penalty;
     auto mu = options_.max_expected_mutation_rate;
     auto ln_prob_misaligned = ln_probability_read_correctly_aligned(misalignment_penalty, read, mu);
     auto min_ln_prob_misaligned = options_.min_ln_prob_correctly_aligned;
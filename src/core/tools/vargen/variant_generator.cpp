@@ -108,12 +108,29 @@ bool VariantGenerator::requires_reads() const noexcept
                        [] (const auto& generator) { return generator->do_requires_reads(); });
 }
 
+bool VariantGenerator::requires_only_reads() const noexcept
+{
+    return !variant_generators_.empty()
+        && std::all_of(std::cbegin(variant_generators_), std::cend(variant_generators_),
+                       [] (const auto& generator) { return generator->do_requires_reads(); });
+}
+
 void VariantGenerator::add_read(const SampleName& sample, const AlignedRead& read)
 {
     if (active_region_generator_) active_region_generator_->add_read(sample, read);
     for (auto& generator : variant_generators_) generator->do_add_read(sample, read);
 }
 
+void VariantGenerator::slide_read_window(const GenomicRegion& region)
+{
+    if (active_region_generator_) active_region_generator_->slide_read_window(region);
+}
+
+void VariantGenerator::reset_read_window() noexcept
+{
+    if (active_region_generator_) active_region_generator_->reset_read_window();
+}
+
 void VariantGenerator::clear() noexcept
 {
     if (active_region_generator_) active_region_generator_->clear();
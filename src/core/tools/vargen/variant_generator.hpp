@@ -45,11 +45,19 @@ public:
     std::vector<Variant> generate(const GenomicRegion& region) const;
     
     bool requires_reads() const noexcept;
+    // True if all candidates are discovered from reads, so none are generated without read evidence
+    bool requires_only_reads() const noexcept;
     
     void add_read(const SampleName& sample, const AlignedRead& read);
     template <typename InputIt>
     void add_reads(const SampleName& sample, InputIt first, InputIt last);
     
+    // Reads subsequently added are those overlapping region. Lets read evidence that is
+    // independent of the candidate region be kept incrementally between calls to clear.
+    void slide_read_window(const GenomicRegion& region);
+    // Must be called if reads overlapping a window are not added
+    void reset_read_window() noexcept;
+    
     void clear() noexcept;
     
 protected:
@@ -31,6 +31,13 @@ VariantGeneratorBuilder::add_vcf_extractor(boost::filesystem::path file, VcfExtr
     return *this;
 }
 
+VariantGeneratorBuilder&
+VariantGeneratorBuilder::add_vcf_extractor(std::shared_ptr<const VariantIndex> index)
+{
+    indexed_vcf_extractors_.push_back(std::move(index));
+    return *this;
+}
+
 VariantGeneratorBuilder&
 VariantGeneratorBuilder::set_repeat_scanner(RepeatScanner::Options options)
 {
@@ -72,6 +79,9 @@ VariantGenerator VariantGeneratorBuilder::build(const ReferenceGenome& reference
     for (auto packet : vcf_extractors_) {
         result.add(std::make_unique<VcfExtractor>(std::make_unique<VcfReader>(packet.file), packet.options));
     }
+    for (const auto& index : indexed_vcf_extractors_) {
+        result.add(std::make_unique<VcfExtractor>(index));
+    }
     if (repeat_scanner_) {
         result.add(std::make_unique<RepeatScanner>(reference, *repeat_scanner_));
     }
@@ -5,6 +5,7 @@
 #define variant_generator_builder_hpp
 
 #include <deque>
+#include <memory>
 
 #include <boost/optional.hpp>
 #include <boost/filesystem.hpp>
@@ -12,6 +13,7 @@
 #include "cigar_scanner.hpp"
 #include "local_reassembler.hpp"
 #include "vcf_extractor.hpp"
+#include "variant_index.hpp"
 #include "repeat_scanner.hpp"
 #include "downloader.hpp"
 #include "randomiser.hpp"
@@ -40,6 +42,7 @@ public:
     VariantGeneratorBuilder& set_local_reassembler(LocalReassembler::Options options);
     VariantGeneratorBuilder& add_vcf_extractor(boost::filesystem::path reader,
                                                VcfExtractor::Options options = VcfExtractor::Options {});
+    VariantGeneratorBuilder& add_vcf_extractor(std::shared_ptr<const VariantIndex> index);
     VariantGeneratorBuilder& set_repeat_scanner(RepeatScanner::Options options);
     VariantGeneratorBuilder& add_downloader(Downloader::Options options = Downloader::Options {});
     VariantGeneratorBuilder& add_randomiser(Randomiser::Options options = Randomiser::Options {});
@@ -57,6 +60,7 @@ private:
     boost::optional<CigarScanner::Options> cigar_scanner_;
     boost::optional<LocalReassembler::Options> local_reassembler_;
     std::deque<VcfExtractorPacket> vcf_extractors_;
+    std::deque<std::shared_ptr<const VariantIndex>> indexed_vcf_extractors_;
     boost::optional<RepeatScanner::Options> repeat_scanner_;
     std::deque<Downloader::Options> downloaders_;
     std::deque<Randomiser::Options> randomisers_;
@@ -0,0 +1,295 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "variant_index.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <fstream>
+#include <limits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include <boost/filesystem/operations.hpp>
+
+#include "io/variant/vcf_record.hpp"
+#include "io/variant/vcf_spec.hpp"
+
+namespace octopus { namespace coretools {
+
+namespace {
+
+// Layout: magic, has_frequencies (u32), extract_filtered (u32), min_quality (f32, NaN if none), num_contigs (u32),
+// allele table size (u64), then for each contig its name length (u32), name, max reference length (u32) and number
+// of records (u64), then padding to a 4 byte boundary, every contig's records in directory order, each sorted by
+// begin, and finally the allele table.
+constexpr char magic[8] = {'O', 'C', 'T', 'V', 'A', 'R', '1', '\0'};
+
+constexpr std::size_t maxInlineAlleleBases {sizeof(std::uint32_t)};
+
+template <typename T>
+T read_value(const char*& data, const char* last, const std::string& path)
+{
+    if (static_cast<std::size_t>(last - data) < sizeof(T)) {
+        throw std::runtime_error {"VariantIndex: " + path + " is truncated"};
+    }
+    T result;
+    std::memcpy(&result, data, sizeof(T));
+    data += sizeof(T);
+    return result;
+}
+
+template <typename T>
+void write_value(std::ofstream& out, const T& value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+} // namespace
+
+VariantIndex::VariantIndex(const Path& index_path)
+: path_ {index_path}
+, file_ {index_path.string()}
+, has_frequencies_ {}
+, options_ {}
+, alleles_ {}
+, alleles_size_ {}
+, contigs_ {}
+{
+    const auto first = file_.data();
+    const auto last = first + file_.size();
+    auto data = first;
+    if (file_.size() < sizeof(magic) || std::memcmp(data, magic, sizeof(magic)) != 0) {
+        throw std::runtime_error {"VariantIndex: " + path_.string() + " is not a variant index"};
+    }
+    data += sizeof(magic);
+    has_frequencies_ = read_value<std::uint32_t>(data, last, path_.string()) != 0;
+    options_.extract_filtered = read_value<std::uint32_t>(data, last, path_.string()) != 0;
+    const auto min_quality = read_value<float>(data, last, path_.string());
+    if (!std::isnan(min_quality)) options_.min_quality = min_quality;
+    const auto num_contigs = read_value<std::uint32_t>(data, last, path_.string());
+    alleles_size_ = static_cast<std::size_t>(read_value<std::uint64_t>(data, last, path_.string()));
+    std::vector<std::pair<GenomicRegion::ContigName, ContigRecords>> directory {};
+    directory.reserve(num_contigs);
+    std::size_t num_records {0};
+    for (std::uint32_t i {0}; i < num_contigs; ++i) {
+        const auto name_length = read_value<std::uint32_t>(data, last, path_.string());
+        if (static_cast<std::size_t>(last - data) < name_length) {
+            throw std::runtime_error {"VariantIndex: " + path_.string() + " is truncated"};
+        }
+        GenomicRegion::ContigName contig {data, data + name_length};
+        data += name_length;
+        const auto max_ref_length = read_value<std::uint32_t>(data, last, path_.string());
+        const auto size = static_cast<std::size_t>(read_value<std::uint64_t>(data, last, path_.string()));
+        directory.push_back({std::move(contig), ContigRecords {nullptr, size, max_ref_length}});
+        num_records += size;
+    }
+    data += (alignof(Record) - (data - first) % alignof(Record)) % alignof(Record);
+    if (data > last || static_cast<std::size_t>(last - data) < num_records * sizeof(Record) + alleles_size_) {
+        throw std::runtime_error {"VariantIndex: " + path_.string() + " is truncated"};
+    }
+    // The mapping is page aligned, so records at an aligned offset can be read in place
+    auto records = reinterpret_cast<const Record*>(data);
+    contigs_.reserve(directory.size());
+    for (auto& p : directory) {
+        p.second.first = records;
+        records += p.second.size;
+        contigs_.emplace(std::move(p.first), p.second);
+    }
+    alleles_ = reinterpret_cast<const char*>(records);
+}
+
+const VariantIndex::Path& VariantIndex::path() const noexcept
+{
+    return path_;
+}
+
+bool VariantIndex::has_frequencies() const noexcept
+{
+    return has_frequencies_;
+}
+
+const VcfExtractor::Options& VariantIndex::options() const noexcept
+{
+    return options_;
+}
+
+bool VariantIndex::has_contig(const GenomicRegion::ContigName& contig) const noexcept
+{
+    return contigs_.count(contig) == 1;
+}
+
+std::vector<Variant> VariantIndex::fetch(const GenomicRegion& region) const
+{
+    std::vector<Variant> result {};
+    visit(region, [&] (Variant&& variant, const Record&) { result.push_back(std::move(variant)); });
+    std::sort(std::begin(result), std::end(result));
+    result.erase(std::unique(std::begin(result), std::end(result)), std::end(result));
+    return result;
+}
+
+std::vector<std::pair<Variant, boost::optional<VariantIndex::Frequency>>>
+VariantIndex::fetch_frequencies(const GenomicRegion& region) const
+{
+    std::vector<std::pair<Variant, boost::optional<Frequency>>> result {};
+    visit(region, [&] (Variant&& variant, const Record& record) {
+        boost::optional<Frequency> frequency {};
+        if (!std::isnan(record.frequency)) frequency = record.frequency;
+        result.emplace_back(std::move(variant), frequency);
+    });
+    std::sort(std::begin(result), std::end(result), [] (const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+    result.erase(std::unique(std::begin(result), std::end(result), [] (const auto& lhs, const auto& rhs) { return lhs.first == rhs.first; }),
+                 std::end(result));
+    return result;
+}
+
+// private methods
+
+template <typename F>
+void VariantIndex::visit(const GenomicRegion& region, F&& f) const
+{
+    const auto contig_itr = contigs_.find(region.contig_name());
+    if (contig_itr == std::cend(contigs_)) return;
+    const auto& contig = contig_itr->second;
+    const auto records_begin = contig.first, records_end = contig.first + contig.size;
+    // No record beginning before this can reach the region; the extra base is for insertions at the boundary
+    const auto reach = static_cast<GenomicRegion::Position>(contig.max_ref_length) + 1;
+    const auto min_begin = region.begin() > reach ? region.begin() - reach : 0;
+    auto itr = std::lower_bound(records_begin, records_end, min_begin,
+                                [] (const Record& record, const GenomicRegion::Position pos) { return record.begin < pos; });
+    for (; itr != records_end && itr->begin <= region.end(); ++itr) {
+        auto variant = make_variant(region.contig_name(), *itr);
+        if (overlaps(variant, region)) f(std::move(variant), *itr);
+    }
+}
+
+Variant VariantIndex::make_variant(const GenomicRegion::ContigName& contig, const Record& record) const
+{
+    const char* bases;
+    if (record.ref_length + record.alt_length <= maxInlineAlleleBases) {
+        bases = reinterpret_cast<const char*>(&record.alleles);
+    } else {
+        bases = alleles_ + record.alleles;
+    }
+    return Variant {contig, record.begin,
+                    Variant::NucleotideSequence {bases, bases + record.ref_length},
+                    Variant::NucleotideSequence {bases + record.ref_length, bases + record.ref_length + record.alt_length}};
+}
+
+namespace {
+
+boost::optional<VariantIndex::Frequency>
+get_frequency(const VcfRecord& record, const std::string& field, const std::size_t alt_idx)
+{
+    if (!record.has_info(field)) return boost::none;
+    const auto& values = record.info_value(field);
+    if (alt_idx >= values.size() || values[alt_idx] == vcfspec::missingValue) return boost::none;
+    char* end;
+    const auto result = std::strtof(values[alt_idx].c_str(), &end);
+    if (end == values[alt_idx].c_str() || std::isnan(result)) return boost::none;
+    return result;
+}
+
+} // namespace
+
+void build_variant_index(const VcfReader& source, const VariantIndex::Path& index_path,
+                         VcfExtractor::Options options, boost::optional<std::string> frequency_field)
+{
+    using Record = VariantIndex::Record;
+    std::vector<GenomicRegion::ContigName> contigs {};
+    std::unordered_map<GenomicRegion::ContigName, std::size_t> contig_indices {};
+    std::vector<std::vector<Record>> contig_records {};
+    std::vector<std::uint32_t> max_ref_lengths {};
+    std::string alleles {};
+    bool has_frequencies {false};
+    const auto unpack = frequency_field ? VcfReader::UnpackPolicy::sites : VcfReader::UnpackPolicy::minimal;
+    auto records = source.iterate(unpack);
+    std::vector<Variant> variants {};
+    for (; records.first != records.second; ++records.first) {
+        const VcfRecord& record {*records.first};
+        if (!is_extractable(record, options)) continue;
+        auto contig_itr = contig_indices.find(record.chrom());
+        if (contig_itr == std::cend(contig_indices)) {
+            contig_itr = contig_indices.emplace(record.chrom(), contigs.size()).first;
+            contigs.push_back(record.chrom());
+            contig_records.emplace_back();
+            max_ref_lengths.push_back(0);
+        }
+        const auto c = contig_itr->second;
+        const auto& alts = record.alt();
+        for (std::size_t alt_idx {0}; alt_idx < alts.size(); ++alt_idx) {
+            extract_variants(record, alts[alt_idx], variants);
+            boost::optional<VariantIndex::Frequency> frequency {};
+            if (frequency_field) frequency = get_frequency(record, *frequency_field, alt_idx);
+            if (frequency) has_frequencies = true;
+            for (const auto& variant : variants) {
+                const auto& ref = ref_sequence(variant);
+                const auto& alt = alt_sequence(variant);
+                if (ref.size() > std::numeric_limits<std::uint16_t>::max()
+                    || alt.size() > std::numeric_limits<std::uint16_t>::max()) continue;
+                Record index_record {static_cast<std::uint32_t>(mapped_begin(variant)),
+                                     static_cast<std::uint16_t>(ref.size()), static_cast<std::uint16_t>(alt.size()), 0,
+                                     frequency ? *frequency : std::numeric_limits<VariantIndex::Frequency>::quiet_NaN()};
+                if (ref.size() + alt.size() <= maxInlineAlleleBases) {
+                    char bases[maxInlineAlleleBases] = {};
+                    std::copy(std::cbegin(ref), std::cend(ref), bases);
+                    std::copy(std::cbegin(alt), std::cend(alt), bases + ref.size());
+                    std::memcpy(&index_record.alleles, bases, sizeof(bases));
+                } else {
+                    if (alleles.size() > std::numeric_limits<std::uint32_t>::max() - ref.size() - alt.size()) {
+                        throw std::runtime_error {"build_variant_index: too many long alleles in " + source.path().string()};
+                    }
+                    index_record.alleles = static_cast<std::uint32_t>(alleles.size());
+                    alleles += ref;
+                    alleles += alt;
+                }
+                contig_records[c].push_back(index_record);
+                max_ref_lengths[c] = std::max(max_ref_lengths[c], static_cast<std::uint32_t>(ref.size()));
+            }
+            variants.clear();
+        }
+    }
+    // Trimming can move a variant past one from a later record
+    for (auto& records : contig_records) {
+        std::stable_sort(std::begin(records), std::end(records),
+                         [] (const Record& lhs, const Record& rhs) { return lhs.begin < rhs.begin; });
+    }
+    // Write to a temporary so an interrupted build never leaves a partial index in place
+    auto tmp_path = index_path;
+    tmp_path += ".tmp";
+    {
+        std::ofstream out {tmp_path.string(), std::ios::binary | std::ios::trunc};
+        if (!out) {
+            throw std::runtime_error {"build_variant_index: could not open " + tmp_path.string()};
+        }
+        out.write(magic, sizeof(magic));
+        write_value(out, static_cast<std::uint32_t>(has_frequencies));
+        write_value(out, static_cast<std::uint32_t>(options.extract_filtered));
+        write_value(out, options.min_quality ? static_cast<float>(*options.min_quality) : std::numeric_limits<float>::quiet_NaN());
+        write_value(out, static_cast<std::uint32_t>(contigs.size()));
+        write_value(out, static_cast<std::uint64_t>(alleles.size()));
+        std::size_t offset {sizeof(magic) + 3 * sizeof(std::uint32_t) + sizeof(float) + sizeof(std::uint64_t)};
+        for (std::size_t c {0}; c < contigs.size(); ++c) {
+            write_value(out, static_cast<std::uint32_t>(contigs[c].size()));
+            out.write(contigs[c].data(), contigs[c].size());
+            write_value(out, max_ref_lengths[c]);
+            write_value(out, static_cast<std::uint64_t>(contig_records[c].size()));
+            offset += 2 * sizeof(std::uint32_t) + contigs[c].size() + sizeof(std::uint64_t);
+        }
+        const char padding[alignof(Record)] = {};
+        out.write(padding, (alignof(Record) - offset % alignof(Record)) % alignof(Record));
+        for (const auto& records : contig_records) {
+            out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(Record));
+        }
+        out.write(alleles.data(), alleles.size());
+        if (!out) {
+            throw std::runtime_error {"build_variant_index: could not write " + tmp_path.string()};
+        }
+    }
+    boost::filesystem::rename(tmp_path, index_path);
+}
+
+} // namespace coretools
+} // namespace octopus
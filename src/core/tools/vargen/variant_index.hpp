@@ -0,0 +1,102 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef variant_index_hpp
+#define variant_index_hpp
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+
+#include <boost/optional.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include "basics/genomic_region.hpp"
+#include "core/types/variant.hpp"
+#include "io/variant/vcf_reader.hpp"
+#include "vcf_extractor.hpp"
+
+namespace octopus { namespace coretools {
+
+/*
+ VariantIndex is a read-only, memory mapped table of the variants a VcfExtractor would extract from a
+ VCF, optionally with each variant's population frequency. The index is built once with build_variant_index
+ and then searched by any number of threads without locking, so large candidate or prior sets (e.g. gnomAD
+ sites) are not parsed again on every run or by every thread.
+ */
+class VariantIndex
+{
+public:
+    using Path = boost::filesystem::path;
+    using Frequency = float;
+
+    VariantIndex() = delete;
+
+    VariantIndex(const Path& index_path);
+
+    VariantIndex(const VariantIndex&)            = default;
+    VariantIndex& operator=(const VariantIndex&) = default;
+    VariantIndex(VariantIndex&&)                 = default;
+    VariantIndex& operator=(VariantIndex&&)      = default;
+
+    ~VariantIndex() = default;
+
+    const Path& path() const noexcept;
+    bool has_frequencies() const noexcept;
+    // The options the index was built with; max_variant_size is not applied
+    const VcfExtractor::Options& options() const noexcept;
+    bool has_contig(const GenomicRegion::ContigName& contig) const noexcept;
+
+    // Sorted variants overlapping the region
+    std::vector<Variant> fetch(const GenomicRegion& region) const;
+    // As fetch, with the frequency of each variant if it has one
+    std::vector<std::pair<Variant, boost::optional<Frequency>>> fetch_frequencies(const GenomicRegion& region) const;
+
+private:
+    // Alleles with at most four bases between them are stored in place of the offset into the allele table
+    struct Record
+    {
+        std::uint32_t begin;
+        std::uint16_t ref_length, alt_length;
+        std::uint32_t alleles;
+        Frequency frequency;
+    };
+
+    struct ContigRecords
+    {
+        const Record* first;
+        std::size_t size;
+        std::uint32_t max_ref_length;
+    };
+
+    Path path_;
+    boost::iostreams::mapped_file_source file_;
+    bool has_frequencies_;
+    VcfExtractor::Options options_;
+    const char* alleles_;
+    std::size_t alleles_size_;
+    std::unordered_map<GenomicRegion::ContigName, ContigRecords> contigs_;
+
+    template <typename F> void visit(const GenomicRegion& region, F&& f) const;
+    Variant make_variant(const GenomicRegion::ContigName& contig, const Record& record) const;
+
+    friend void build_variant_index(const VcfReader&, const Path&, VcfExtractor::Options, boost::optional<std::string>);
+};
+
+// Writes the variants in source which pass options to index_path. Frequencies are read from the given
+// per-allele INFO field, and variants without one are stored without a frequency.
+void build_variant_index(const VcfReader& source, const VariantIndex::Path& index_path,
+                         VcfExtractor::Options options = {},
+                         boost::optional<std::string> frequency_field = std::string {"AF"});
+
+} // namespace coretools
+
+using coretools::VariantIndex;
+
+} // namespace octopus
+
+#endif
@@ -7,11 +7,14 @@
 #include <algorithm>
 #include <iterator>
 #include <utility>
+#include <limits>
+#include <cstdint>
 
 #include "io/variant/vcf_spec.hpp"
 #include "io/variant/vcf_record.hpp"
 #include "utils/sequence_utils.hpp"
 #include "utils/append.hpp"
+#include "variant_index.hpp"
 
 namespace octopus { namespace coretools {
 
@@ -21,9 +24,16 @@ VcfExtractor::VcfExtractor(std::unique_ptr<const VcfReader> reader)
 
 VcfExtractor::VcfExtractor(std::unique_ptr<const VcfReader> reader, Options options)
 : reader_ {std::move(reader)}
+, index_ {}
 , options_ {options}
 {}
 
+VcfExtractor::VcfExtractor(std::shared_ptr<const VariantIndex> index)
+: reader_ {}
+, index_ {std::move(index)}
+, options_ {}
+{}
+
 std::unique_ptr<VariantGenerator> VcfExtractor::do_clone() const
 {
     return std::make_unique<VcfExtractor>(*this);
@@ -46,46 +56,49 @@ auto make_allele(const Iterator first_base, const Iterator last_base)
     return result;
 }
 
-template <typename Container>
-void extract_variants(const VcfRecord& record, Container& result)
+} // namespace
+
+void extract_variants(const VcfRecord& record, const VcfRecord::NucleotideSequence& alt_allele,
+                      std::vector<Variant>& result)
 {
-    for (const auto& alt_allele : record.alt()) {
-        if (is_canonical(alt_allele)) {
-            const auto& ref_allele = record.ref();
-            if (ref_allele.size() != alt_allele.size()) {
-                auto begin = record.pos();
-                const auto p = std::mismatch(std::cbegin(ref_allele), std::cend(ref_allele),
-                                             std::cbegin(alt_allele), std::cend(alt_allele));
-                if (p.first != std::cend(ref_allele) && alt_allele.size() > ref_allele.size()) {
-                    // Split non-reference padded insertions into snv (or mnv) and insertion with empty
-                    // reference (e.g. A -> TT makes two variants A -> T and -> T).
-                    const auto ref_pad_size = std::distance(std::cbegin(ref_allele), p.first);
-                    begin += ref_pad_size;
-                    const auto remaining_ref_size = ref_allele.size() - ref_pad_size;
-                    const auto first_alt_end = std::next(p.second, remaining_ref_size);
-                    result.emplace_back(record.chrom(), begin - 1,
-                                        make_allele(p.first, std::cend(ref_allele)),
-                                        make_allele(p.second, first_alt_end));
-                    begin += remaining_ref_size;
-                    result.emplace_back(record.chrom(), begin - 1, "",
-                                        make_allele(first_alt_end, std::cend(alt_allele)));
-                } else {
-                    begin += std::distance(std::cbegin(ref_allele), p.first);
-                    result.emplace_back(record.chrom(), begin - 1,
-                                        make_allele(p.first, std::cend(ref_allele)),
-                                        make_allele(p.second, std::cend(alt_allele)));
-                }
-            } else {
-                using utils::capitalise_copy;
-                result.emplace_back(record.chrom(), record.pos() - 1,
-                                    capitalise_copy(record.ref()),
-                                    capitalise_copy(alt_allele));
-            }
+    if (!is_canonical(alt_allele)) return;
+    const auto& ref_allele = record.ref();
+    if (ref_allele.size() != alt_allele.size()) {
+        auto begin = record.pos();
+        const auto p = std::mismatch(std::cbegin(ref_allele), std::cend(ref_allele),
+                                     std::cbegin(alt_allele), std::cend(alt_allele));
+        if (p.first != std::cend(ref_allele) && alt_allele.size() > ref_allele.size()) {
+            // Split non-reference padded insertions into snv (or mnv) and insertion with empty
+            // reference (e.g. A -> TT makes two variants A -> T and -> T).
+            const auto ref_pad_size = std::distance(std::cbegin(ref_allele), p.first);
+            begin += ref_pad_size;
+            const auto remaining_ref_size = ref_allele.size() - ref_pad_size;
+            const auto first_alt_end = std::next(p.second, remaining_ref_size);
+            result.emplace_back(record.chrom(), begin - 1,
+                                make_allele(p.first, std::cend(ref_allele)),
+                                make_allele(p.second, first_alt_end));
+            begin += remaining_ref_size;
+            result.emplace_back(record.chrom(), begin - 1, "",
+                                make_allele(first_alt_end, std::cend(alt_allele)));
+        } else {
+            begin += std::distance(std::cbegin(ref_allele), p.first);
+            result.emplace_back(record.chrom(), begin - 1,
+                                make_allele(p.first, std::cend(ref_allele)),
+                                make_allele(p.second, std::cend(alt_allele)));
         }
+    } else {
+        using utils::capitalise_copy;
+        result.emplace_back(record.chrom(), record.pos() - 1,
+                            capitalise_copy(record.ref()),
+                            capitalise_copy(alt_allele));
     }
 }
 
-} // namespace
+bool is_extractable(const VcfRecord& record, const VcfExtractor::Options& options)
+{
+    if (!options.extract_filtered && is_filtered(record)) return false;
+    return !options.min_quality || (record.qual() && *record.qual() >= *options.min_quality);
+}
 
 std::vector<Variant> VcfExtractor::do_generate(const RegionSet& regions) const
 {
@@ -103,23 +116,47 @@ std::string VcfExtractor::name() const
 
 std::vector<Variant> VcfExtractor::fetch_variants(const GenomicRegion& region) const
 {
-  std::deque<Variant> variants {};
-    for (auto p = reader_->iterate(region, VcfReader::UnpackPolicy::sites); p.first != p.second; ++p.first) {
-        if (is_good(*p.first)) {
-            extract_variants(*p.first, variants);
+    if (index_) return index_->fetch(region);
+    std::lock_guard<std::mutex> lock {stream_.mutex};
+    if (!stream_.records || region.contig_name() != stream_.contig || region.begin() < stream_.position) {
+        seek(region);
+    }
+    stream_.position = region.begin();
+    auto& buffer = stream_.buffer;
+    // Regions only move forward, so nothing ending here can overlap this or any later region
+    buffer.erase(std::remove_if(std::begin(buffer), std::end(buffer),
+                                [&] (const auto& p) { return p.first.end() <= region.begin(); }),
+                 std::end(buffer));
+    auto& record_itr = stream_.records->first;
+    std::vector<Variant> variants {};
+    for (; record_itr != stream_.records->second && mapped_begin(*record_itr) < region.end(); ++record_itr) {
+        if (is_extractable(*record_itr, options_)) {
+            for (const auto& alt_allele : record_itr->alt()) {
+                extract_variants(*record_itr, alt_allele, variants);
+            }
+            for (auto& variant : variants) {
+                buffer.emplace_back(mapped_region(*record_itr), std::move(variant));
+            }
+            variants.clear();
         }
     }
-    std::vector<Variant> result {std::make_move_iterator(std::begin(variants)),
-                                 std::make_move_iterator(std::end(variants))};
+    std::vector<Variant> result {};
+    for (const auto& p : buffer) {
+        if (overlaps(p.first, region)) result.push_back(p.second);
+    }
     std::sort(std::begin(result), std::end(result));
     result.erase(std::unique(std::begin(result), std::end(result)), std::end(result));
     return result;
 }
 
-bool VcfExtractor::is_good(const VcfRecord& record) const
+void VcfExtractor::seek(const GenomicRegion& region) const
 {
-    if (!options_.extract_filtered && is_filtered(record)) return false;
-    return !options_.min_quality || (record.qual() && *record.qual() >= *options_.min_quality);
+    // The iterator is left open ended so it can follow later regions on the contig
+    static constexpr GenomicRegion::Position stream_end {std::numeric_limits<std::int32_t>::max()};
+    const GenomicRegion stream_region {region.contig_name(), region.begin(), std::max(region.end(), stream_end)};
+    stream_.records = std::make_unique<VcfReader::RecordIteratorPair>(reader_->iterate(stream_region, VcfReader::UnpackPolicy::minimal));
+    stream_.contig = region.contig_name();
+    stream_.buffer.clear();
 }
 
 } // namespace coretools
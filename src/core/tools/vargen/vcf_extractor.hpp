@@ -5,21 +5,32 @@
 #define vcf_extractor_hpp
 
 #include <vector>
+#include <deque>
 #include <memory>
+#include <mutex>
+#include <utility>
 
 #include <boost/filesystem.hpp>
 #include <boost/optional.hpp>
 
+#include "basics/genomic_region.hpp"
 #include "io/variant/vcf.hpp"
 #include "core/types/variant.hpp"
 #include "variant_generator.hpp"
 
-namespace octopus {
+namespace octopus { namespace coretools {
 
-class GenomicRegion;
-
-namespace coretools {
+class VariantIndex;
 
+/*
+ VcfExtractor streams records through one open iterator per contig, so consecutive requests for
+ increasing regions (the common case when calling) read each record once and never reopen the file
+ or reload its index. Only site fields are unpacked; INFO and sample columns are skipped. A
+ request behind the stream, or on another contig, seeks a new iterator through the index.
+ 
+ An extractor made from a VariantIndex instead searches the index directly, without locking, so
+ clones share the mapping rather than each streaming the file.
+ */
 class VcfExtractor : public VariantGenerator
 {
 public:
@@ -34,6 +45,7 @@ public:
     
     VcfExtractor(std::unique_ptr<const VcfReader> reader);
     VcfExtractor(std::unique_ptr<const VcfReader> reader, Options options);
+    VcfExtractor(std::shared_ptr<const VariantIndex> index);
         
     VcfExtractor(const VcfExtractor&)            = default;
     VcfExtractor& operator=(const VcfExtractor&) = default;
@@ -47,13 +59,38 @@ private:
     std::vector<Variant> do_generate(const RegionSet& regions) const override;
     std::string name() const override;
     
+    struct RecordStream
+    {
+        RecordStream() = default;
+        // Copies start their own stream
+        RecordStream(const RecordStream&) : RecordStream {} {}
+        RecordStream& operator=(const RecordStream&) { records.reset(); buffer.clear(); return *this; }
+        ~RecordStream() = default;
+        
+        std::mutex mutex;
+        std::unique_ptr<VcfReader::RecordIteratorPair> records;
+        GenomicRegion::ContigName contig;
+        GenomicRegion::Position position;
+        // Variants from records which may overlap later regions, with the record regions
+        std::deque<std::pair<GenomicRegion, Variant>> buffer;
+    };
+    
     std::shared_ptr<const VcfReader> reader_;
+    std::shared_ptr<const VariantIndex> index_;
     Options options_;
+    mutable RecordStream stream_;
     
     std::vector<Variant> fetch_variants(const GenomicRegion& region) const;
-    bool is_good(const VcfRecord& record) const;
+    void seek(const GenomicRegion& region) const;
 };
 
+// Appends the variants of one of the record's alt alleles, which are trimmed, and split in two if
+// the insertion is not reference padded. Missing and symbolic alleles give no variants.
+void extract_variants(const VcfRecord& record, const VcfRecord::NucleotideSequence& alt_allele,
+                      std::vector<Variant>& result);
+
+bool is_extractable(const VcfRecord& record, const VcfExtractor::Options& options);
+
 } // namespace coretools
 } // namespace octopus
 
@@ -43,11 +43,13 @@ const std::string deleted_sequence {vcfspec::deletedBase};
 } // namespace
 
 VcfRecordFactory::VcfRecordFactory(const ReferenceGenome& reference, const ReadMap& reads,
-                                   std::vector<SampleName> samples, bool sites_only)
+                                   std::vector<SampleName> samples, bool sites_only,
+                                   ThreadPool* workers)
 : reference_ {reference}
 , reads_ {reads}
 , samples_ {std::move(samples)}
 , sites_only_ {sites_only}
+, workers_ {workers}
 {}
 
 namespace {
@@ -239,6 +241,49 @@ void pad_indels(std::vector<CallWrapper>& calls, const std::vector<SampleName>&
     }
 }
 
+namespace {
+
+constexpr GenomicRegion::Size maxCachedRegionSize {10'000'000};
+
+// Serves padding bases from one fetch of the region spanned by the calls, unless the calls are so
+// sparse that fetching each base is cheaper
+class ReferenceBaseCache
+{
+public:
+    ReferenceBaseCache(const ReferenceGenome& reference, const std::vector<CallWrapper>& calls)
+    : reference_ {reference}
+    {
+        if (!calls.empty()) {
+            auto region = encompassing_region(calls);
+            if (size(region) <= maxCachedRegionSize) {
+                sequence_ = reference.fetch_sequence(region);
+                region_ = std::move(region);
+            }
+        }
+    }
+    
+    char fetch(const GenomicRegion& position) const
+    {
+        if (region_ && contains(*region_, position) && position.begin() < region_->end()) {
+            return sequence_[position.begin() - region_->begin()];
+        }
+        return reference_.get().fetch_sequence(position).front();
+    }
+    
+private:
+    std::reference_wrapper<const ReferenceGenome> reference_;
+    boost::optional<GenomicRegion> region_;
+    ReferenceGenome::GeneticSequence sequence_;
+};
+
+struct RecordCalls
+{
+    std::vector<std::unique_ptr<Call>> calls;
+    bool is_segment = false;
+};
+
+} // namespace
+
 std::vector<VcfRecord> VcfRecordFactory::make(std::vector<CallWrapper>&& calls) const
 {
     using std::begin; using std::end; using std::cbegin; using std::cend; using std::next;
@@ -248,17 +293,22 @@ std::vector<VcfRecord> VcfRecordFactory::make(std::vector<CallWrapper>&& calls)
     assert(std::is_sorted(std::cbegin(calls), std::cend(calls)));
     resolve_indel_genotypes(calls, samples_, reference_);
     pad_indels(calls, samples_);
-    std::vector<VcfRecord> result {};
-    result.reserve(calls.size());
+    const ReferenceBaseCache reference_bases {reference_, calls};
+    // Calls are resolved serially as neighbouring calls interact, but each record then only depends
+    // on its own calls, so records are built afterwards in parallel
+    std::vector<RecordCalls> record_calls {};
+    record_calls.reserve(calls.size());
     for (auto call_itr = begin(calls); call_itr != end(calls);) {
         const auto block_begin_itr = adjacent_overlap_find(call_itr, end(calls));
-        transform(std::make_move_iterator(call_itr), std::make_move_iterator(block_begin_itr), std::back_inserter(result),
-                  [this] (CallWrapper&& call) {
-                      call->replace(dummy_base, reference_.fetch_sequence(head_position(call)).front());
+        transform(std::make_move_iterator(call_itr), std::make_move_iterator(block_begin_itr), std::back_inserter(record_calls),
+                  [&reference_bases] (CallWrapper&& call) {
+                      call->replace(dummy_base, reference_bases.fetch(head_position(call)));
                       // We may still have uncalled genotyped alleles here if the called genotype
                       // did not have a high posterior
                       call->replace_uncalled_genotype_alleles(Allele {call->mapped_region(), vcfspec::missingValue}, 'N');
-                      return this->make(move(call.call));
+                      RecordCalls result {};
+                      result.calls.push_back(move(call.call));
+                      return result;
                   });
         if (block_begin_itr == end(calls)) break;
         auto block_end_itr = find_next_mutually_exclusive(block_begin_itr, end(calls));
@@ -276,10 +326,10 @@ std::vector<VcfRecord> VcfRecordFactory::make(std::vector<CallWrapper>&& calls)
         boost::optional<decltype(block_head_end_itr)> base {};
         if (alt_itr != block_head_end_itr) base = alt_itr;
         std::deque<CallWrapper> duplicates {};
-        for_each(block_begin_itr, block_head_end_itr, [this, base, &duplicates] (auto& call) {
+        for_each(block_begin_itr, block_head_end_itr, [this, base, &duplicates, &reference_bases] (auto& call) {
             assert(!call->reference().sequence().empty());
             if (call->reference().sequence().front() == dummy_base) {
-                const auto actual_reference_base = reference_.fetch_sequence(head_position(call)).front();
+                const auto actual_reference_base = reference_bases.fetch(head_position(call));
                 auto new_sequence = call->reference().sequence();
                 new_sequence.front() = actual_reference_base;
                 Allele new_allele {mapped_region(call), move(new_sequence)};
@@ -378,7 +428,7 @@ std::vector<VcfRecord> VcfRecordFactory::make(std::vector<CallWrapper>&& calls)
             std::unordered_map<Allele, Allele> replacements {};
             assert(!curr_call->reference().sequence().empty());
             if (curr_call->reference().sequence().front() == dummy_base) {
-                const auto actual_reference_base = reference_.fetch_sequence(head_position(curr_call)).front();
+                const auto actual_reference_base = reference_bases.fetch(head_position(curr_call));
                 auto new_ref_sequence = curr_call->reference().sequence();
                 new_ref_sequence.front() = actual_reference_base;
                 Allele new_ref_allele {mapped_region(curr_call), move(new_ref_sequence)};
@@ -490,15 +540,25 @@ std::vector<VcfRecord> VcfRecordFactory::make(std::vector<CallWrapper>&& calls)
         }
         for (auto&& segment : segements) {
             for (auto&& new_segment : segment_by_end_move(segment)) {
-                std::vector<std::unique_ptr<Call>> final_segment {};
+                RecordCalls final_segment {};
                 transform(std::make_move_iterator(begin(new_segment)), std::make_move_iterator(end(new_segment)),
-                          std::back_inserter(final_segment),
+                          std::back_inserter(final_segment.calls),
                           [] (auto&& call) -> std::unique_ptr<Call>&& { return move(call.call); });
-                result.emplace_back(this->make_segment(move(final_segment)));
+                final_segment.is_segment = true;
+                record_calls.push_back(move(final_segment));
             }
         }
         call_itr = block_end_itr;
     }
+    std::vector<VcfRecord> result(record_calls.size());
+    parallel_for(workers_, record_calls.size(), [&] (const std::size_t i) {
+        auto& calls = record_calls[i];
+        if (calls.is_segment) {
+            result[i] = this->make_segment(move(calls.calls));
+        } else {
+            result[i] = this->make(move(calls.calls.front()));
+        }
+    });
     return result;
 }
 
@@ -12,6 +12,7 @@
 #include "io/variant/vcf_record.hpp"
 #include "core/types/calls/call.hpp"
 #include "core/types/calls/call_wrapper.hpp"
+#include "utils/thread_pool.hpp"
 
 namespace octopus {
 
@@ -20,8 +21,10 @@ class VcfRecordFactory
 public:
     VcfRecordFactory() = delete;
     
+    // Records are built on workers, if given, once calls have been resolved
     VcfRecordFactory(const ReferenceGenome& reference, const ReadMap& reads,
-                     std::vector<SampleName> samples, bool sites_only);
+                     std::vector<SampleName> samples, bool sites_only,
+                     ThreadPool* workers = nullptr);
     
     VcfRecordFactory(const VcfRecordFactory&)            = default;
     VcfRecordFactory& operator=(const VcfRecordFactory&) = delete;
@@ -37,6 +40,7 @@ private:
     const ReadMap& reads_;
     std::vector<SampleName> samples_;
     bool sites_only_;
+    ThreadPool* workers_;
     double max_qual = 10000;
     
     VcfRecord make(std::unique_ptr<Call> call) const;
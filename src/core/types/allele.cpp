@@ -21,7 +21,7 @@ bool is_reference(const Allele& allele, const ReferenceGenome& reference)
 {
     if (region_size(allele) != sequence_size(allele)) return false;
     if (is_empty_region(allele) && is_sequence_empty(allele)) return true;
-    return allele.sequence() == reference.fetch_sequence(allele.mapped_region());
+    return allele.sequence() == reference.fetch_sequence_view(allele.mapped_region());
 }
 
 Allele make_reference_allele(const GenomicRegion& region, const ReferenceGenome& reference)
@@ -315,10 +315,10 @@ bool operator==(const BasicAllele<RegionTp>& lhs, const BasicAllele<RegionTp>& r
 template <typename RegionTp>
 bool operator<(const BasicAllele<RegionTp>& lhs, const BasicAllele<RegionTp>& rhs)
 {
-    if (lhs.mapped_region() == rhs.mapped_region()) {
-        return lhs.sequence() < rhs.sequence();
+    if (lhs.mapped_region() != rhs.mapped_region()) {
+        return lhs.mapped_region() < rhs.mapped_region();
     }
-    return lhs.mapped_region() < rhs.mapped_region();
+    return lhs.sequence() < rhs.sequence();
 }
 
 template <typename RegionTp>
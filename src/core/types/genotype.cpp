@@ -214,6 +214,24 @@ std::size_t num_genotypes(const unsigned num_elements, const unsigned ploidy)
     return boost::math::binomial_coefficient<double>(num_elements + ploidy - 1, num_elements - 1);
 }
 
+MemoryFootprint footprint(const Genotype<Haplotype>& genotype) noexcept
+{
+    return estimate_genotypes_footprint(1, genotype.ploidy());
+}
+
+MemoryFootprint footprint(const std::vector<Genotype<Haplotype>>& genotypes) noexcept
+{
+    std::size_t bytes {sizeof(std::vector<Genotype<Haplotype>>)};
+    bytes += (genotypes.capacity() - genotypes.size()) * sizeof(Genotype<Haplotype>);
+    for (const auto& genotype : genotypes) bytes += footprint(genotype).bytes();
+    return bytes;
+}
+
+MemoryFootprint estimate_genotypes_footprint(const std::size_t num_genotypes, const unsigned ploidy) noexcept
+{
+    return num_genotypes * (sizeof(Genotype<Haplotype>) + ploidy * sizeof(std::shared_ptr<Haplotype>));
+}
+
 std::size_t max_num_elements(const std::size_t num_genotypes, const unsigned ploidy)
 {
     if (num_genotypes == 0 || ploidy == 0) return 0;
@@ -229,6 +247,63 @@ std::size_t max_num_elements(const std::size_t num_genotypes, const unsigned plo
     return j + 1;
 }
 
+namespace {
+
+// Exact while the result fits, as each partial product is itself a binomial coefficient
+std::size_t choose(const std::size_t n, const std::size_t k) noexcept
+{
+    if (k > n) return 0;
+    std::size_t result {1};
+    for (std::size_t i {1}; i <= k; ++i) {
+        result = result * (n - k + i) / i;
+    }
+    return result;
+}
+
+std::size_t num_genotype_indices(const unsigned num_elements, const unsigned ploidy) noexcept
+{
+    return choose(num_elements + ploidy - 1, ploidy);
+}
+
+} // namespace
+
+// Complementing each element (d = n - 1 - a) and reading the index backwards gives a non-increasing
+// sequence d_0 >= ... >= d_{k-1} whose colexicographic order is the reverse of the generation order.
+// Its colex rank in the combinatorial number system is the sum of C(d_j + k - 1 - j, k - j).
+std::size_t rank_genotype_index(const GenotypeIndex& index, const unsigned num_elements)
+{
+    const auto ploidy = static_cast<unsigned>(index.size());
+    std::size_t colex_rank {0};
+    for (unsigned j {0}; j < ploidy; ++j) {
+        const auto d = num_elements - 1 - index[ploidy - 1 - j];
+        colex_rank += choose(d + ploidy - 1 - j, ploidy - j);
+    }
+    return num_genotype_indices(num_elements, ploidy) - 1 - colex_rank;
+}
+
+GenotypeIndex unrank_genotype_index(const std::size_t rank, const unsigned num_elements, const unsigned ploidy)
+{
+    auto colex_rank = num_genotype_indices(num_elements, ploidy) - 1 - rank;
+    GenotypeIndex result(ploidy);
+    for (unsigned j {0}; j < ploidy; ++j) {
+        const auto k = ploidy - j;
+        std::size_t b {k - 1};
+        while (choose(b + 1, k) <= colex_rank) ++b;
+        colex_rank -= choose(b, k);
+        result[ploidy - 1 - j] = num_elements - 1 - static_cast<unsigned>(b - (k - 1));
+    }
+    return result;
+}
+
+GenotypeIndexGenerator::GenotypeIndexGenerator(const unsigned num_elements, const unsigned ploidy, const std::size_t first_rank)
+: num_elements_ {num_elements}
+, index_ {}
+, rank_ {first_rank}
+, done_ {ploidy == 0 || num_elements == 0 || first_rank >= num_genotype_indices(num_elements, ploidy)}
+{
+    if (!done_) index_ = unrank_genotype_index(first_rank, num_elements, ploidy);
+}
+
 std::size_t element_cardinality_in_genotypes(const unsigned num_elements, const unsigned ploidy)
 {
     return ploidy * (num_genotypes(num_elements, ploidy) / num_elements);
@@ -240,6 +315,17 @@ generate_all_genotypes(const std::vector<std::shared_ptr<Haplotype>>& haplotypes
     return detail::generate_all_genotypes(haplotypes, ploidy, std::false_type {});
 }
 
+std::vector<GenotypeIndex> generate_all_genotype_indices(const unsigned num_elements, const unsigned ploidy)
+{
+    std::vector<GenotypeIndex> result {};
+    if (ploidy == 0 || num_elements == 0) return result;
+    result.reserve(num_genotypes(num_elements, ploidy));
+    for (GenotypeIndexGenerator generator {num_elements, ploidy}; !generator.done(); generator.next()) {
+        result.push_back(generator.index());
+    }
+    return result;
+}
+
 std::size_t num_max_zygosity_genotypes(const unsigned num_elements, const unsigned ploidy)
 {
     return boost::math::binomial_coefficient<double>(num_elements, ploidy);
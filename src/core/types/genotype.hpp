@@ -22,6 +22,7 @@
 
 #include "concepts/equitable.hpp"
 #include "concepts/mappable.hpp"
+#include "utils/memory_footprint.hpp"
 #include "allele.hpp"
 #include "haplotype.hpp"
 
@@ -566,6 +567,11 @@ std::size_t num_genotypes(unsigned num_elements, unsigned ploidy);
 std::size_t max_num_elements(std::size_t num_genotypes, unsigned ploidy);
 std::size_t element_cardinality_in_genotypes(unsigned num_elements, unsigned ploidy);
 
+// Haplotypes are shared between genotypes so are not counted
+MemoryFootprint footprint(const Genotype<Haplotype>& genotype) noexcept;
+MemoryFootprint footprint(const std::vector<Genotype<Haplotype>>& genotypes) noexcept;
+MemoryFootprint estimate_genotypes_footprint(std::size_t num_genotypes, unsigned ploidy) noexcept;
+
 template <typename MappableType>
 unsigned count_shared(const Genotype<MappableType>& lhs, const Genotype<MappableType>& rhs)
 {
@@ -595,6 +601,62 @@ bool have_shared(const Genotype<MappableType>& lhs, const Genotype<MappableType>
 
 using GenotypeIndex = std::vector<unsigned>;
 
+/*
+ GenotypeIndexGenerator enumerates the indices of every genotype of a ploidy over some number of elements
+ in the order generate_all_genotypes uses, without materialising them, so genotypes can be evaluated as a
+ stream. Each index is a non-increasing sequence of element indices, ordered lexicographically from its last
+ (smallest) element. The rank of an index is its position in this order; see rank_genotype_index and
+ unrank_genotype_index, which let a stream start anywhere. next() is amortised O(1).
+ */
+class GenotypeIndexGenerator
+{
+public:
+    GenotypeIndexGenerator() = delete;
+    
+    // Starts at the index with rank first_rank
+    GenotypeIndexGenerator(unsigned num_elements, unsigned ploidy, std::size_t first_rank = 0);
+    
+    GenotypeIndexGenerator(const GenotypeIndexGenerator&)            = default;
+    GenotypeIndexGenerator& operator=(const GenotypeIndexGenerator&) = default;
+    GenotypeIndexGenerator(GenotypeIndexGenerator&&)                 = default;
+    GenotypeIndexGenerator& operator=(GenotypeIndexGenerator&&)      = default;
+    
+    ~GenotypeIndexGenerator() = default;
+    
+    const GenotypeIndex& index() const noexcept { return index_; }
+    std::size_t rank() const noexcept { return rank_; }
+    bool done() const noexcept { return done_; }
+    
+    // Returns false if there are no more indices
+    bool next() noexcept;
+    
+private:
+    unsigned num_elements_;
+    GenotypeIndex index_;
+    std::size_t rank_;
+    bool done_;
+};
+
+inline bool GenotypeIndexGenerator::next() noexcept
+{
+    assert(!done_);
+    ++rank_;
+    if (++index_[0] < num_elements_) return true;
+    const auto ploidy = static_cast<unsigned>(index_.size());
+    unsigned i {0};
+    while (++i < ploidy && index_[i] == num_elements_ - 1);
+    if (i == ploidy) {
+        done_ = true;
+        return false;
+    }
+    ++index_[i];
+    std::fill_n(std::begin(index_), i, index_[i]);
+    return true;
+}
+
+std::size_t rank_genotype_index(const GenotypeIndex& index, unsigned num_elements);
+GenotypeIndex unrank_genotype_index(std::size_t rank, unsigned num_elements, unsigned ploidy);
+
 namespace detail {
 
 namespace {
@@ -731,18 +793,8 @@ auto do_generate_all_genotypes(const Container& elements, const unsigned ploidy)
     // Otherwise resort to general algorithm
     ResultType result{};
     result.reserve(num_genotypes(num_elements, ploidy));
-    std::vector<unsigned> element_indicies(ploidy, 0);
-    
-    while (true) {
-        if (element_indicies[0] == num_elements) {
-            unsigned i {0};
-            while (++i < ploidy && element_indicies[i] == num_elements - 1);
-            if (i == ploidy) break;
-            ++element_indicies[i];
-            std::fill_n(std::begin(element_indicies), i + 1, element_indicies[i]);
-        }
-        result.push_back(detail::generate_genotype(elements, element_indicies));
-        ++element_indicies[0];
+    for (GenotypeIndexGenerator generator {num_elements, ploidy}; !generator.done(); generator.next()) {
+        result.push_back(detail::generate_genotype(elements, generator.index()));
     }
     
     return result;
@@ -762,18 +814,9 @@ auto do_generate_all_genotypes(const Container& elements, const unsigned ploidy,
     const auto result_size = num_genotypes(num_elements, ploidy);
     result.reserve(result_size);
     indices.reserve(result_size);
-    GenotypeIndex element_indicies(ploidy, 0);
-    while (true) {
-        if (element_indicies[0] == num_elements) {
-            unsigned i {0};
-            while (++i < ploidy && element_indicies[i] == num_elements - 1);
-            if (i == ploidy) break;
-            ++element_indicies[i];
-            std::fill_n(std::begin(element_indicies), i + 1, element_indicies[i]);
-        }
-        result.push_back(detail::generate_genotype(elements, element_indicies));
-        indices.push_back(element_indicies);
-        ++element_indicies[0];
+    for (GenotypeIndexGenerator generator {num_elements, ploidy}; !generator.done(); generator.next()) {
+        result.push_back(detail::generate_genotype(elements, generator.index()));
+        indices.push_back(generator.index());
     }
     return result;
 }
@@ -784,18 +827,9 @@ auto do_generate_all_genotypes(const Container& elements, const unsigned ploidy,
 {
     if (ploidy == 0 || elements.empty()) return result_itr;
     const auto num_elements = static_cast<unsigned>(elements.size());
-    std::vector<unsigned> element_indicies(ploidy, 0);
-    while (true) {
-        if (element_indicies[0] == num_elements) {
-            unsigned i {0};
-            while (++i < ploidy && element_indicies[i] == num_elements - 1);
-            if (i == ploidy) break;
-            ++element_indicies[i];
-            std::fill_n(std::begin(element_indicies), i + 1, element_indicies[i]);
-        }
-        auto genotype = detail::generate_genotype(elements, element_indicies);
+    for (GenotypeIndexGenerator generator {num_elements, ploidy}; !generator.done(); generator.next()) {
+        auto genotype = detail::generate_genotype(elements, generator.index());
         if (pred(genotype)) *result_itr++ = std::move(genotype);
-        ++element_indicies[0];
     }
     return result_itr;
 }
@@ -807,21 +841,12 @@ auto do_generate_all_genotypes(const Container& elements, const unsigned ploidy,
 {
     if (ploidy == 0 || elements.empty()) return result_itr;
     const auto num_elements = static_cast<unsigned>(elements.size());
-    std::vector<unsigned> element_indicies(ploidy, 0);
-    while (true) {
-        if (element_indicies[0] == num_elements) {
-            unsigned i {0};
-            while (++i < ploidy && element_indicies[i] == num_elements - 1);
-            if (i == ploidy) break;
-            ++element_indicies[i];
-            std::fill_n(std::begin(element_indicies), i + 1, element_indicies[i]);
-        }
-        auto genotype = detail::generate_genotype(elements, element_indicies);
+    for (GenotypeIndexGenerator generator {num_elements, ploidy}; !generator.done(); generator.next()) {
+        auto genotype = detail::generate_genotype(elements, generator.index());
         if (pred(genotype)) {
             *result_itr++ = std::move(genotype);
-            indices.push_back(element_indicies);
+            indices.push_back(generator.index());
         }
-        ++element_indicies[0];
     }
     return result_itr;
 }
@@ -960,6 +985,29 @@ generate_all_genotypes(const std::vector<std::reference_wrapper<const MappableTy
 std::vector<Genotype<Haplotype>>
 generate_all_genotypes(const std::vector<std::shared_ptr<Haplotype>>& haplotypes, unsigned ploidy);
 
+// Enumerates genotypes as element indices only, in the same order as generate_all_genotypes.
+// Each index is sorted in non-increasing order.
+std::vector<GenotypeIndex> generate_all_genotype_indices(unsigned num_elements, unsigned ploidy);
+
+// Realises the genotype of elements given by an index
+template <typename MappableType>
+Genotype<MappableType> make_genotype(const GenotypeIndex& index, const std::vector<MappableType>& elements)
+{
+    return detail::generate_genotype(elements, index);
+}
+
+template <typename MappableType>
+std::vector<Genotype<MappableType>>
+make_genotypes(const std::vector<GenotypeIndex>& indices, const std::vector<MappableType>& elements)
+{
+    std::vector<Genotype<MappableType>> result {};
+    result.reserve(indices.size());
+    for (const auto& index : indices) {
+        result.push_back(make_genotype(index, elements));
+    }
+    return result;
+}
+
 template <typename MappableType>
 bool is_max_zygosity(const Genotype<MappableType>& genotype)
 {
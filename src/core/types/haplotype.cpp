@@ -51,38 +51,38 @@ bool Haplotype::contains(const ContigAllele& allele) const
 {
     using octopus::contains; using std::cbegin; using std::cend;
     if (contains(region_.contig_region(), allele)) {
-        if (begins_before(allele, explicit_allele_region_)) {
-            if (is_before(allele, explicit_allele_region_)) {
+        if (begins_before(allele, data_->explicit_allele_region)) {
+            if (is_before(allele, data_->explicit_allele_region)) {
                 return allele.sequence() == fetch_reference_sequence(contig_region(allele));
             }
-            const auto flank_region = left_overhang_region(explicit_allele_region_, contig_region(allele));
+            const auto flank_region = left_overhang_region(data_->explicit_allele_region, contig_region(allele));
             if (copy(allele, flank_region).sequence() != fetch_reference_sequence(flank_region)) {
                 return false;
             }
         }
-        if (ends_before(explicit_allele_region_, allele)) {
-            if (is_after(allele, explicit_allele_region_)) {
+        if (ends_before(data_->explicit_allele_region, allele)) {
+            if (is_after(allele, data_->explicit_allele_region)) {
                 return allele.sequence() == fetch_reference_sequence(contig_region(allele));
             }
-            const auto flank_region = right_overhang_region(contig_region(allele), explicit_allele_region_);
+            const auto flank_region = right_overhang_region(contig_region(allele), data_->explicit_allele_region);
             if (copy(allele, flank_region).sequence() != fetch_reference_sequence(flank_region)) {
                 return false;
             }
         }
-        const auto match_itr = binary_find(cbegin(explicit_alleles_), cend(explicit_alleles_), allele.mapped_region());
-        if (match_itr != cend(explicit_alleles_)) {
+        const auto match_itr = binary_find(cbegin(data_->explicit_alleles), cend(data_->explicit_alleles), allele.mapped_region());
+        if (match_itr != cend(data_->explicit_alleles)) {
             if (*match_itr == allele) return true;
             if (is_same_region(*match_itr, allele)) {
                 // If the allele is not explcitly contained but the region is then it must be a different
                 // allele, unless it is an insertion, in which case we must check the sequence
                 if (is_insertion(allele)) {
-                    return contains(*std::lower_bound(cbegin(explicit_alleles_), cend(explicit_alleles_),
+                    return contains(*std::lower_bound(cbegin(data_->explicit_alleles), cend(data_->explicit_alleles),
                                                       allele.mapped_region()), allele);
                 }
                 return false;
             }
         }
-        const auto overlapped = haplotype_overlap_range(explicit_alleles_, allele);
+        const auto overlapped = haplotype_overlap_range(data_->explicit_alleles, allele);
         if (overlapped.size() == 1 && contains(overlapped.front(), allele)) {
             return allele == copy(overlapped.front(), contig_region(allele));
         }
@@ -102,21 +102,23 @@ bool Haplotype::includes(const ContigAllele& allele) const
     using octopus::contains;
     if (!contains(region_.contig_region(), allele)) {
         return false;
-    } else if (!explicit_alleles_.empty()) {
-        if (contains(explicit_allele_region_, allele)) {
-            return std::binary_search(std::cbegin(explicit_alleles_), std::cend(explicit_alleles_), allele);
-        } else if (overlaps(explicit_allele_region_, allele)) {
+    } else if (!data_->explicit_alleles.empty()) {
+        if (contains(data_->explicit_allele_region, allele)) {
+            return std::binary_search(std::cbegin(data_->explicit_alleles), std::cend(data_->explicit_alleles), allele);
+        } else if (overlaps(data_->explicit_allele_region, allele)) {
             return false;
-        } else if (is_after(allele, explicit_allele_region_)) {
+        } else if (is_after(allele, data_->explicit_allele_region)) {
             if (is_indel(allele)) return false;
-            const auto ref_ritr = std::next(std::crbegin(sequence_), end_distance(allele, region_.contig_region()));
-            assert(static_cast<std::size_t>(std::distance(ref_ritr, std::crend(sequence_))) >= allele.sequence().size());
+            if (!is_sequence_built()) return allele.sequence() == fetch_reference_sequence(contig_region(allele));
+            const auto ref_ritr = std::next(std::crbegin(data_->sequence), end_distance(allele, region_.contig_region()));
+            assert(static_cast<std::size_t>(std::distance(ref_ritr, std::crend(data_->sequence))) >= allele.sequence().size());
             return std::equal(std::crbegin(allele.sequence()), std::crend(allele.sequence()), ref_ritr);
         }
     }
     if (is_indel(allele)) return false;
-    const auto ref_itr = std::next(std::cbegin(sequence_), begin_distance(region_.contig_region(), allele));
-    assert(static_cast<std::size_t>(std::distance(ref_itr, std::cend(sequence_))) >= allele.sequence().size());
+    if (!is_sequence_built()) return allele.sequence() == fetch_reference_sequence(contig_region(allele));
+    const auto ref_itr = std::next(std::cbegin(data_->sequence), begin_distance(region_.contig_region(), allele));
+    assert(static_cast<std::size_t>(std::distance(ref_itr, std::cend(data_->sequence))) >= allele.sequence().size());
     return std::equal(std::cbegin(allele.sequence()), std::cend(allele.sequence()), ref_itr);
 }
 
@@ -147,18 +149,19 @@ Haplotype::NucleotideSequence Haplotype::sequence(const ContigRegion& region) co
     if (!contains(region_.contig_region(), region)) {
         throw std::out_of_range {"Haplotype: attempting to sequence from region not contained by Haplotype region"};
     }
-    if (explicit_alleles_.empty()) {
-        return sequence_.substr(begin_distance(region_.contig_region(), region), region_size(region));
+    if (data_->explicit_alleles.empty()) {
+        if (!is_sequence_built()) return fetch_reference_sequence(region);
+        return data_->sequence.substr(begin_distance(region_.contig_region(), region), region_size(region));
     }
-    if (is_in_reference_flank(region, explicit_allele_region_, explicit_alleles_)) {
+    if (is_in_reference_flank(region, data_->explicit_allele_region, data_->explicit_alleles)) {
         return fetch_reference_sequence(region);
     }
     NucleotideSequence result {};
     result.reserve(region_size(region)); // may be more or less depending on indels
-    if (begins_before(region, explicit_allele_region_)) {
-        append_reference(result, left_overhang_region(region, explicit_allele_region_));
+    if (begins_before(region, data_->explicit_allele_region)) {
+        append_reference(result, left_overhang_region(region, data_->explicit_allele_region));
     }
-    auto overlapped_explicit_alleles = haplotype_overlap_range(explicit_alleles_, region);
+    auto overlapped_explicit_alleles = haplotype_overlap_range(data_->explicit_alleles, region);
     assert(!overlapped_explicit_alleles.empty());
     if (contains(overlapped_explicit_alleles.front(), region)) {
         append(result, copy(overlapped_explicit_alleles.front(), region));
@@ -172,7 +175,7 @@ Haplotype::NucleotideSequence Haplotype::sequence(const ContigRegion& region) co
                             *overlapped_region(overlapped_explicit_alleles.front(), region)));
         overlapped_explicit_alleles.advance_begin(1);
         if (overlapped_explicit_alleles.empty()) {
-            append_reference(result, right_overhang_region(region, explicit_allele_region_));
+            append_reference(result, right_overhang_region(region, data_->explicit_allele_region));
             return result;
         }
     }
@@ -186,8 +189,8 @@ Haplotype::NucleotideSequence Haplotype::sequence(const ContigRegion& region) co
         overlapped_explicit_alleles.advance_end(1); // as we previously removed this allele
         append(result, copy(overlapped_explicit_alleles.back(),
                             *overlapped_region(overlapped_explicit_alleles.back(), region)));
-    } else if (ends_before(explicit_allele_region_, region)) {
-        append_reference(result, right_overhang_region(region, explicit_allele_region_));
+    } else if (ends_before(data_->explicit_allele_region, region)) {
+        append_reference(result, right_overhang_region(region, data_->explicit_allele_region));
     }
     return result;
 }
@@ -200,9 +203,17 @@ Haplotype::NucleotideSequence Haplotype::sequence(const GenomicRegion& region) c
     return sequence(region.contig_region());
 }
 
-const Haplotype::NucleotideSequence& Haplotype::sequence() const noexcept
+const Haplotype::NucleotideSequence& Haplotype::sequence() const
 {
-    return sequence_;
+    if (!is_sequence_built()) {
+        std::call_once(data_->sequence_flag, [this] () { build_sequence(); });
+    }
+    return data_->sequence;
+}
+
+Haplotype::NucleotideSequence::size_type Haplotype::sequence_size() const noexcept
+{
+    return data_->sequence_size;
 }
 
 Haplotype::NucleotideSequence::size_type Haplotype::sequence_size(const ContigRegion& region) const
@@ -219,9 +230,9 @@ Haplotype::NucleotideSequence::size_type Haplotype::sequence_size(const GenomicR
 std::vector<Variant> Haplotype::difference(const Haplotype& other) const
 {
     std::vector<Variant> result {};
-    result.reserve(explicit_alleles_.size());
+    result.reserve(data_->explicit_alleles.size());
     const auto& contig = region_.contig_name();
-    for (const auto& allele : explicit_alleles_) {
+    for (const auto& allele : data_->explicit_alleles) {
         if (!other.contains(allele)) {
             result.emplace_back(GenomicRegion {contig, allele.mapped_region()},
                                 other.sequence(allele.mapped_region()),
@@ -235,15 +246,15 @@ CigarString Haplotype::cigar() const
 {
     using Flag = CigarOperation::Flag;
     CigarString result {};
-    if (!explicit_alleles_.empty()) {
-        const auto reference = reference_.get().fetch_sequence(GenomicRegion {region_.contig_name(), explicit_allele_region_});
-        result.reserve(2 * explicit_alleles_.size() + 2);
-        auto curr_op_size = begin_distance(region_.contig_region(), explicit_allele_region_);
+    if (!data_->explicit_alleles.empty()) {
+        const auto reference = reference_.get().fetch_sequence_view(GenomicRegion {region_.contig_name(), data_->explicit_allele_region});
+        result.reserve(2 * data_->explicit_alleles.size() + 2);
+        auto curr_op_size = begin_distance(region_.contig_region(), data_->explicit_allele_region);
         auto curr_op_flag = Flag::sequenceMatch;
-        for (std::size_t i {0}; i < explicit_alleles_.size(); ++i) {
-            const auto& allele = explicit_alleles_[i];
+        for (std::size_t i {0}; i < data_->explicit_alleles.size(); ++i) {
+            const auto& allele = data_->explicit_alleles[i];
             if (i > 0) {
-                const auto& prev_allele = explicit_alleles_[i - 1];
+                const auto& prev_allele = data_->explicit_alleles[i - 1];
                 if (!are_adjacent(prev_allele, allele)) {
                     result.emplace_back(curr_op_size, curr_op_flag);
                     curr_op_flag = Flag::sequenceMatch;
@@ -281,7 +292,7 @@ CigarString Haplotype::cigar() const
                     }
                 }
             } else if (!is_empty_region(allele)) {
-                const auto ref_idx = static_cast<std::size_t>(begin_distance(explicit_allele_region_, allele));
+                const auto ref_idx = static_cast<std::size_t>(begin_distance(data_->explicit_allele_region, allele));
                 assert(ref_idx < reference.size());
                 if (region_size(allele) == 1) {
                     if (allele.sequence()[0] == reference[ref_idx]) {
@@ -311,7 +322,7 @@ CigarString Haplotype::cigar() const
                 curr_op_size = allele_op_size;
             }
         }
-        const auto rhs_ref_flank_size = end_distance(explicit_allele_region_, region_.contig_region());
+        const auto rhs_ref_flank_size = end_distance(data_->explicit_allele_region, region_.contig_region());
         if (curr_op_flag == Flag::sequenceMatch) {
             curr_op_size += rhs_ref_flank_size;
         } else {
@@ -325,18 +336,113 @@ CigarString Haplotype::cigar() const
     } else {
         result.emplace_back(size(region_), Flag::sequenceMatch);
     }
-    assert(octopus::sequence_size(result) == sequence_.size());
+    assert(octopus::sequence_size(result) == data_->sequence_size);
     assert(reference_size(result) == size(region_));
     return result;
 }
 
 std::size_t Haplotype::get_hash() const noexcept
 {
-    return cached_hash_;
+    return static_cast<std::size_t>(data_->hash.first ^ data_->hash.second);
+}
+
+const Haplotype::StrongHash& Haplotype::get_strong_hash() const noexcept
+{
+    return data_->hash;
 }
 
 // private methods
 
+namespace {
+
+// Two polynomial rolling hashes modulo the Mersenne prime 2^61 - 1, so the hash of a sequence can
+// be accumulated piece by piece without assembling it
+constexpr std::uint64_t sequenceHashModulus {(std::uint64_t {1} << 61) - 1};
+constexpr std::uint64_t sequenceHashBase1 {1099511628211ull}, sequenceHashBase2 {2305843009213693921ull};
+
+std::uint64_t mod_mul_add(const std::uint64_t a, const std::uint64_t b, const std::uint64_t c) noexcept
+{
+    const auto product = static_cast<unsigned __int128>(a) * b + c;
+    auto result = (static_cast<std::uint64_t>(product) & sequenceHashModulus) + static_cast<std::uint64_t>(product >> 61);
+    result = (result & sequenceHashModulus) + (result >> 61);
+    return result >= sequenceHashModulus ? result - sequenceHashModulus : result;
+}
+
+template <typename Range>
+Haplotype::StrongHash roll_hash(Haplotype::StrongHash hash, const Range& sequence) noexcept
+{
+    for (const char base : sequence) {
+        const auto value = static_cast<unsigned char>(base);
+        hash.first  = mod_mul_add(hash.first, sequenceHashBase1, value);
+        hash.second = mod_mul_add(hash.second, sequenceHashBase2, value);
+    }
+    return hash;
+}
+
+} // namespace
+
+template <typename F>
+void Haplotype::visit_sequence(F&& f) const
+{
+    // f may be called with views into the reference, which are only valid until the next fetch
+    if (data_->explicit_alleles.empty()) {
+        if (!is_empty(region_)) f(reference_.get().fetch_sequence_view(region_));
+        return;
+    }
+    const auto& contig = region_.contig_name();
+    const auto lhs_reference_region = left_overhang_region(region_.contig_region(), data_->explicit_allele_region);
+    if (!is_empty(lhs_reference_region)) {
+        f(reference_.get().fetch_sequence_view(GenomicRegion {contig, lhs_reference_region}));
+    }
+    for (const auto& allele : data_->explicit_alleles) {
+        f(allele.sequence());
+    }
+    const auto rhs_reference_region = right_overhang_region(region_.contig_region(), data_->explicit_allele_region);
+    if (!is_empty(rhs_reference_region)) {
+        f(reference_.get().fetch_sequence_view(GenomicRegion {contig, rhs_reference_region}));
+    }
+}
+
+void Haplotype::init_sequence(NucleotideSequence sequence)
+{
+    auto data = std::make_shared<Data>();
+    data->explicit_allele_region = region_.contig_region();
+    data->explicit_alleles.emplace_back(data->explicit_allele_region, sequence);
+    data->sequence_size = sequence.size();
+    data->hash = roll_hash({0, 0}, sequence);
+    data->sequence = std::move(sequence);
+    data->is_sequence_built = true;
+    data_ = std::move(data);
+}
+
+void Haplotype::init_lazy_sequence(std::vector<ContigAllele> explicit_alleles)
+{
+    auto data = std::make_shared<Data>();
+    if (!explicit_alleles.empty()) {
+        data->explicit_allele_region = encompassing_region(explicit_alleles.front(), explicit_alleles.back());
+    }
+    data->explicit_alleles = std::move(explicit_alleles);
+    data_ = data;
+    visit_sequence([&data] (const auto& sequence) {
+        data->sequence_size += sequence.size();
+        data->hash = roll_hash(data->hash, sequence);
+    });
+}
+
+void Haplotype::build_sequence() const
+{
+    auto& sequence = data_->sequence;
+    sequence.reserve(data_->sequence_size);
+    visit_sequence([&sequence] (const auto& piece) { sequence.append(std::cbegin(piece), std::cend(piece)); });
+    assert(sequence.size() == data_->sequence_size);
+    data_->is_sequence_built.store(true, std::memory_order_release);
+}
+
+bool Haplotype::is_sequence_built() const noexcept
+{
+    return data_->is_sequence_built.load(std::memory_order_acquire);
+}
+
 void Haplotype::append(NucleotideSequence& result, const ContigAllele& allele) const
 {
     result.append(allele.sequence());
@@ -349,13 +455,16 @@ void Haplotype::append(NucleotideSequence& result, AlleleIterator first, AlleleI
 
 void Haplotype::append_reference(NucleotideSequence& result, const ContigRegion& region) const
 {
-    if (is_before(region, explicit_allele_region_)) {
+    if (!is_sequence_built()) {
+        const auto flank = reference_.get().fetch_sequence_view(GenomicRegion {region_.contig_name(), region});
+        result.append(std::cbegin(flank), std::cend(flank));
+    } else if (is_before(region, data_->explicit_allele_region)) {
         const auto offset = begin_distance(region_.contig_region(), region);
-        const auto it = std::next(std::cbegin(sequence_), offset);
+        const auto it = std::next(std::cbegin(data_->sequence), offset);
         result.append(it, std::next(it, region_size(region)));
     } else {
         const auto offset = end_distance(region, region_.contig_region());
-        const auto it = std::prev(std::cend(sequence_), offset);
+        const auto it = std::prev(std::cend(data_->sequence), offset);
         result.append(std::prev(it, region_size(region)), it);
     }
 }
@@ -505,12 +614,12 @@ ContigAllele Haplotype::Builder::get_intervening_reference_allele(const ContigAl
 
 Haplotype::NucleotideSequence::size_type sequence_size(const Haplotype& haplotype) noexcept
 {
-    return haplotype.sequence().size();
+    return haplotype.sequence_size();
 }
 
 bool is_sequence_empty(const Haplotype& haplotype) noexcept
 {
-    return haplotype.sequence().empty();
+    return haplotype.sequence_size() == 0;
 }
 
 bool contains(const Haplotype& lhs, const Allele& rhs)
@@ -536,14 +645,14 @@ Haplotype do_copy(const Haplotype& haplotype, const GenomicRegion& region, std::
     }
     if (is_same_region(haplotype, region)) return haplotype;
     Haplotype::Builder result {region, haplotype.reference_};
-    if (haplotype.explicit_alleles_.empty()) return result.build();
+    if (haplotype.data_->explicit_alleles.empty()) return result.build();
     const auto& contig_region = region.contig_region();
-    if (contains(contig_region, haplotype.explicit_allele_region_)) {
-        result.explicit_alleles_.assign(cbegin(haplotype.explicit_alleles_), cend(haplotype.explicit_alleles_));
+    if (contains(contig_region, haplotype.data_->explicit_allele_region)) {
+        result.explicit_alleles_.assign(cbegin(haplotype.data_->explicit_alleles), cend(haplotype.data_->explicit_alleles));
         return result.build();
     }
-    if (!overlaps(contig_region, haplotype.explicit_allele_region_)) return result.build();
-    auto overlapped = haplotype_overlap_range(haplotype.explicit_alleles_, region.contig_region());
+    if (!overlaps(contig_region, haplotype.data_->explicit_allele_region)) return result.build();
+    auto overlapped = haplotype_overlap_range(haplotype.data_->explicit_alleles, region.contig_region());
     assert(!overlapped.empty());
     if (is_empty(contig_region)) {
         if (!is_empty_region(overlapped.front()) && are_adjacent(contig_region, overlapped.front())) {
@@ -585,8 +694,8 @@ ContigAllele copy(const Haplotype& haplotype, const ContigRegion& region)
 
 bool is_reference(const Haplotype& haplotype)
 {
-    if (haplotype.explicit_alleles_.empty()) return true;
-    return haplotype.sequence() == haplotype.reference_.get().fetch_sequence(haplotype.mapped_region());
+    if (haplotype.data_->explicit_alleles.empty()) return true;
+    return haplotype.sequence() == haplotype.reference_.get().fetch_sequence_view(haplotype.mapped_region());
 }
 
 Haplotype expand(const Haplotype& haplotype, Haplotype::MappingDomain::Size n)
@@ -594,7 +703,7 @@ Haplotype expand(const Haplotype& haplotype, Haplotype::MappingDomain::Size n)
     if (n == 0) return haplotype;
     return Haplotype {
         expand(mapped_region(haplotype), n),
-        std::cbegin(haplotype.explicit_alleles_), std::cend(haplotype.explicit_alleles_),
+        std::cbegin(haplotype.data_->explicit_alleles), std::cend(haplotype.data_->explicit_alleles),
         haplotype.reference_
     };
 }
@@ -605,12 +714,12 @@ Haplotype remap(const Haplotype& haplotype, const GenomicRegion& region)
         return haplotype;
     } else if (contains(region, haplotype)) {
         return Haplotype {
-            region, std::cbegin(haplotype.explicit_alleles_), std::cend(haplotype.explicit_alleles_), haplotype.reference_
+            region, std::cbegin(haplotype.data_->explicit_alleles), std::cend(haplotype.data_->explicit_alleles), haplotype.reference_
         };
     } else if (contains(haplotype, region)) {
         return copy<Haplotype>(haplotype, region);
     } else if (is_same_contig(haplotype, region)) {
-        const auto remap_alleles = haplotype_contained_range(haplotype.explicit_alleles_, region.contig_region());
+        const auto remap_alleles = haplotype_contained_range(haplotype.data_->explicit_alleles, region.contig_region());
         return Haplotype {
             region, std::cbegin(remap_alleles), std::cend(remap_alleles), haplotype.reference_
         };
@@ -632,7 +741,8 @@ std::vector<Variant> difference(const Haplotype& lhs, const Haplotype& rhs)
 
 bool operator==(const Haplotype& lhs, const Haplotype& rhs)
 {
-    return lhs.mapped_region() == rhs.mapped_region() && lhs.sequence() == rhs.sequence();
+    return lhs.mapped_region() == rhs.mapped_region() && lhs.get_strong_hash() == rhs.get_strong_hash()
+           && lhs.sequence_size() == rhs.sequence_size() && lhs.sequence() == rhs.sequence();
 }
 
 bool operator<(const Haplotype& lhs, const Haplotype& rhs)
@@ -642,7 +752,7 @@ bool operator<(const Haplotype& lhs, const Haplotype& rhs)
 
 bool HaveSameAlleles::operator()(const Haplotype &lhs, const Haplotype &rhs) const
 {
-    return lhs.explicit_alleles_ == rhs.explicit_alleles_;
+    return lhs.data_->explicit_alleles == rhs.data_->explicit_alleles;
 }
 
 bool have_same_alleles(const Haplotype& lhs, const Haplotype& rhs)
@@ -654,15 +764,15 @@ IsLessComplex::IsLessComplex(boost::optional<Haplotype> reference) : reference_
 
 bool IsLessComplex::operator()(const Haplotype& lhs, const Haplotype& rhs) const
 {
-    if (lhs.explicit_alleles_.size() != rhs.explicit_alleles_.size()) {
-        return lhs.explicit_alleles_.size() < rhs.explicit_alleles_.size();
+    if (lhs.data_->explicit_alleles.size() != rhs.data_->explicit_alleles.size()) {
+        return lhs.data_->explicit_alleles.size() < rhs.data_->explicit_alleles.size();
     }
     if (reference_) {
         return lhs.difference(*reference_).size() < rhs.difference(*reference_).size();
     }
     // otherwise prefer the sequence with the least amount of indels
-    auto score = std::inner_product(std::cbegin(lhs.explicit_alleles_), std::cend(lhs.explicit_alleles_),
-                                    std::cbegin(rhs.explicit_alleles_), 0, std::plus<> {},
+    auto score = std::inner_product(std::cbegin(lhs.data_->explicit_alleles), std::cend(lhs.data_->explicit_alleles),
+                                    std::cbegin(rhs.data_->explicit_alleles), 0, std::plus<> {},
                                     [] (const auto& lhs, const auto& rhs) {
                                         if (lhs == rhs) {
                                             return 0;
@@ -687,7 +797,20 @@ bool StrictLess::operator()(const Haplotype& lhs, const Haplotype& rhs) const
         if (lhs.sequence() != rhs.sequence()) {
             return lhs.sequence() < rhs.sequence();
         } else {
-            return lhs.explicit_alleles_ < rhs.explicit_alleles_;
+            return lhs.data_->explicit_alleles < rhs.data_->explicit_alleles;
+        }
+    } else {
+        return lhs.mapped_region() < rhs.mapped_region();
+    }
+}
+
+bool StrongHashLess::operator()(const Haplotype& lhs, const Haplotype& rhs) const
+{
+    if (lhs.mapped_region() == rhs.mapped_region()) {
+        if (lhs.data_->hash != rhs.data_->hash) {
+            return lhs.data_->hash < rhs.data_->hash;
+        } else {
+            return lhs.data_->explicit_alleles < rhs.data_->explicit_alleles;
         }
     } else {
         return lhs.mapped_region() < rhs.mapped_region();
@@ -6,11 +6,15 @@
 
 #include <deque>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <type_traits>
 #include <utility>
 #include <numeric>
 #include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <atomic>
 
 #include <boost/functional/hash.hpp>
 #include <boost/optional.hpp>
@@ -30,6 +34,13 @@ class Variant;
 /*
     A Haplotype is an ordered, non-overlapping, set of Alleles, and therefore implictly
     defines a sequence in a given GenomicRegion.
+ 
+    Haplotypes built from Alleles only store the Alleles, the sequence size, and a 128-bit rolling
+    hash of the sequence; the full sequence is assembled on the first call to sequence(). Many
+    haplotypes are discarded (e.g. as duplicates) before anything needs their sequence.
+ 
+    The alleles and sequence are immutable and shared between copies, so copying a Haplotype
+    (e.g. into genotypes, likelihood tables, or caches) never copies sequence data.
  */
 class Haplotype;
 
@@ -84,17 +95,22 @@ public:
     
     NucleotideSequence sequence(const ContigRegion& region) const;
     NucleotideSequence sequence(const GenomicRegion& region) const;
-    const NucleotideSequence& sequence() const noexcept;
+    const NucleotideSequence& sequence() const;
     
+    NucleotideSequence::size_type sequence_size() const noexcept;
     NucleotideSequence::size_type sequence_size(const ContigRegion& region) const;
     NucleotideSequence::size_type sequence_size(const GenomicRegion& region) const;
     
     std::vector<Variant> difference(const Haplotype& other) const; // w.r.t this
     CigarString cigar() const; // w.r.t reference
     
+    using StrongHash = std::pair<std::uint64_t, std::uint64_t>;
+    
     std::size_t get_hash() const noexcept;
+    const StrongHash& get_strong_hash() const noexcept; // equal sequences have equal hashes
     
     friend struct StrictLess;
+    friend struct StrongHashLess;
     friend struct HaveSameAlleles;
     friend struct IsLessComplex;
     
@@ -108,15 +124,28 @@ public:
     template <typename S> friend void debug::print_variant_alleles(S&&, const Haplotype&);
     
 private:
+    struct Data
+    {
+        std::vector<ContigAllele> explicit_alleles = {};
+        ContigRegion explicit_allele_region = {};
+        NucleotideSequence::size_type sequence_size = 0;
+        StrongHash hash = {0, 0};
+        mutable NucleotideSequence sequence = {};
+        mutable std::once_flag sequence_flag = {};
+        mutable std::atomic<bool> is_sequence_built {false};
+    };
+    
     GenomicRegion region_;
-    std::vector<ContigAllele> explicit_alleles_;
-    ContigRegion explicit_allele_region_;
-    NucleotideSequence sequence_;
-    std::size_t cached_hash_;
+    std::shared_ptr<const Data> data_;
     std::reference_wrapper<const ReferenceGenome> reference_;
     
-    using AlleleIterator = decltype(explicit_alleles_)::const_iterator;
+    using AlleleIterator = std::vector<ContigAllele>::const_iterator;
     
+    template <typename F> void visit_sequence(F&& f) const;
+    void init_sequence(NucleotideSequence sequence);
+    void init_lazy_sequence(std::vector<ContigAllele> explicit_alleles);
+    void build_sequence() const;
+    bool is_sequence_built() const noexcept;
     void append(NucleotideSequence& result, const ContigAllele& allele) const;
     void append(NucleotideSequence& result, AlleleIterator first, AlleleIterator last) const;
     void append_reference(NucleotideSequence& result, const ContigRegion& region) const;
@@ -126,71 +155,29 @@ private:
 template <typename R>
 Haplotype::Haplotype(R&& region, const ReferenceGenome& reference)
 : region_ {std::forward<R>(region)}
-, explicit_alleles_ {}
-, explicit_allele_region_ {}
-, sequence_ {reference.fetch_sequence(region_)}
-, cached_hash_ {std::hash<NucleotideSequence>()(sequence_)}
+, data_ {}
 , reference_ {reference}
-{}
+{
+    init_lazy_sequence({});
+}
 
 template <typename R, typename S>
 Haplotype::Haplotype(R&& region, S&& sequence, const ReferenceGenome& reference)
 : region_ {std::forward<R>(region)}
-, explicit_alleles_ {}
-, explicit_allele_region_ {region_.contig_region()}
-, sequence_ {std::forward<S>(sequence)}
-, cached_hash_ {std::hash<NucleotideSequence>()(sequence_)}
+, data_ {}
 , reference_ {reference}
 {
-    explicit_alleles_.reserve(1);
-    explicit_alleles_.emplace_back(explicit_allele_region_, sequence_);
-}
-
-namespace detail {
-    template <typename T>
-    void append(T& result, const ReferenceGenome& reference,
-                const GenomicRegion::ContigName& contig,
-                const ContigRegion& region)
-    {
-        result.append(reference.fetch_sequence(GenomicRegion {contig, region}));
-    }
+    init_sequence(std::forward<S>(sequence));
 }
 
 template <typename R, typename ForwardIt>
 Haplotype::Haplotype(R&& region, ForwardIt first_allele, ForwardIt last_allele,
                      const ReferenceGenome& reference)
 : region_ {std::forward<R>(region)}
-, explicit_alleles_ {first_allele, last_allele}
-, explicit_allele_region_ {}
-, sequence_ {}
-, cached_hash_ {0}
+, data_ {}
 , reference_ {reference}
 {
-    if (!explicit_alleles_.empty()) {
-        explicit_allele_region_ = encompassing_region(explicit_alleles_.front(), explicit_alleles_.back());
-        auto num_bases = std::accumulate(std::cbegin(explicit_alleles_), std::cend(explicit_alleles_),
-                                         0, [] (const auto curr, const auto& allele) {
-                                             return curr + ::octopus::sequence_size(allele);
-                                         });
-        const auto lhs_reference_region = left_overhang_region(region_.contig_region(),
-                                                               explicit_allele_region_);
-        const auto rhs_reference_region = right_overhang_region(region_.contig_region(),
-                                                                explicit_allele_region_);
-        num_bases += region_size(lhs_reference_region) + region_size(rhs_reference_region);
-        
-        sequence_.reserve(num_bases);
-        const auto& contig = region_.contig_name();
-        if (!is_empty(lhs_reference_region)) {
-            detail::append(sequence_, reference, contig, lhs_reference_region);
-        }
-        append(sequence_, std::cbegin(explicit_alleles_), std::cend(explicit_alleles_));
-        if (!is_empty(rhs_reference_region)) {
-            detail::append(sequence_, reference, contig, rhs_reference_region);
-        }
-    } else {
-        sequence_ = reference.fetch_sequence(region_);
-    }
-    cached_hash_ = std::hash<NucleotideSequence>()(sequence_);
+    init_lazy_sequence({first_allele, last_allele});
 }
 
 class Haplotype::Builder
@@ -311,34 +298,48 @@ struct StrictLess
     bool operator()(const Haplotype& lhs, const Haplotype& rhs) const;
 };
 
+// Orders by region then strong hash, so duplicates are adjacent without comparing sequences
+struct StrongHashLess
+{
+    bool operator()(const Haplotype& lhs, const Haplotype& rhs) const;
+};
+
 // Removes all duplicates haplotypes (w.r.t operator==) keeping the duplicate which is considered least complex w.r.t cmp.
+// Haplotypes are bucketed by strong hash, so only sequences with a duplicate are compared.
 template <typename Cmp>
 unsigned remove_duplicates(std::vector<Haplotype>& haplotypes, const Cmp& cmp)
 {
     using std::begin; using std::end;
-    std::sort(begin(haplotypes), end(haplotypes), StrictLess {});
-    auto first_dup_itr  = begin(haplotypes);
+    std::sort(begin(haplotypes), end(haplotypes), StrongHashLess {});
+    std::vector<Haplotype> result {};
+    result.reserve(haplotypes.size());
+    auto bucket_itr = begin(haplotypes);
     const auto last_itr = end(haplotypes);
-    while (true) {
-        first_dup_itr = std::adjacent_find(first_dup_itr, last_itr);
-        if (first_dup_itr == last_itr) break;
-        auto dup_keep_itr = (cmp(*first_dup_itr, *std::next(first_dup_itr))) ? first_dup_itr : std::next(first_dup_itr);
-        auto last_dup_itr = std::next(first_dup_itr, 2);
-        for (; last_dup_itr != last_itr; ++last_dup_itr) {
-            if (*last_dup_itr != *first_dup_itr) {
-                break;
-            }
-            if (cmp(*last_dup_itr, *dup_keep_itr)) {
-                dup_keep_itr = last_dup_itr;
+    while (bucket_itr != last_itr) {
+        const auto bucket_end_itr = std::find_if(std::next(bucket_itr), last_itr, [&] (const Haplotype& haplotype) {
+            return haplotype.mapped_region() != bucket_itr->mapped_region()
+                || haplotype.get_strong_hash() != bucket_itr->get_strong_hash();
+        });
+        while (bucket_itr != bucket_end_itr) {
+            // Buckets with distinct sequences are only possible with hash collisions
+            const auto last_dup_itr = std::stable_partition(std::next(bucket_itr), bucket_end_itr,
+                                                            [&] (const Haplotype& haplotype) { return haplotype == *bucket_itr; });
+            auto dup_keep_itr = bucket_itr;
+            if (std::distance(bucket_itr, last_dup_itr) > 1) {
+                auto dup_itr = std::next(bucket_itr);
+                if (!cmp(*bucket_itr, *dup_itr)) dup_keep_itr = dup_itr;
+                for (++dup_itr; dup_itr != last_dup_itr; ++dup_itr) {
+                    if (cmp(*dup_itr, *dup_keep_itr)) dup_keep_itr = dup_itr;
+                }
             }
+            result.push_back(std::move(*dup_keep_itr));
+            bucket_itr = last_dup_itr;
         }
-        std::iter_swap(first_dup_itr, dup_keep_itr);
-        first_dup_itr = last_dup_itr;
     }
-    const auto last_keep_itr = std::unique(begin(haplotypes), end(haplotypes));
-    const auto result = std::distance(last_keep_itr, end(haplotypes));
-    haplotypes.erase(last_keep_itr, last_itr);
-    return static_cast<unsigned>(result);
+    const auto num_removed = haplotypes.size() - result.size();
+    std::sort(begin(result), end(result));
+    haplotypes = std::move(result);
+    return static_cast<unsigned>(num_removed);
 }
 
 unsigned remove_duplicates(std::vector<Haplotype>& haplotypes);
@@ -360,7 +361,7 @@ template <typename S>
 void print_alleles(S&& stream, const Haplotype& haplotype)
 {
     stream << "< ";
-    for (const auto& allele : haplotype.explicit_alleles_) {
+    for (const auto& allele : haplotype.data_->explicit_alleles) {
         stream << "{" << allele << "} ";
     }
     stream << ">";
@@ -374,7 +375,7 @@ void print_variant_alleles(S&& stream, const Haplotype& haplotype)
     } else {
         const auto& contig = contig_name(haplotype);
         stream << "< ";
-        for (const auto& contig_allele : haplotype.explicit_alleles_) {
+        for (const auto& contig_allele : haplotype.data_->explicit_alleles) {
             Allele allele {GenomicRegion {contig, contig_allele.mapped_region()}, contig_allele.sequence()};
             if (!is_reference(allele, haplotype.reference_)) stream << "{" << allele << "} ";
         }
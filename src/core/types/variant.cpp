@@ -58,15 +58,22 @@ Variant::NucleotideSequence::size_type  alt_sequence_size(const Variant& variant
     return sequence_size(variant.alt_allele());
 }
 
+// The ref and alt alleles always share a region, so the region is compared once and the
+// sequences with a single three-way compare each.
+
 bool operator==(const Variant& lhs, const Variant& rhs)
 {
-    return lhs.ref_allele() == rhs.ref_allele() && alt_sequence(lhs) == alt_sequence(rhs);
+    return alt_sequence(lhs) == alt_sequence(rhs) && ref_sequence(lhs) == ref_sequence(rhs)
+           && lhs.mapped_region() == rhs.mapped_region();
 }
 
 bool operator<(const Variant& lhs, const Variant& rhs)
 {
-    return (lhs.ref_allele() < rhs.ref_allele()
-            || (lhs.ref_allele() == rhs.ref_allele() && lhs.alt_allele() < rhs.alt_allele()));
+    if (lhs.mapped_region() != rhs.mapped_region()) {
+        return lhs.mapped_region() < rhs.mapped_region();
+    }
+    const auto ref_order = ref_sequence(lhs).compare(ref_sequence(rhs));
+    return ref_order != 0 ? ref_order < 0 : alt_sequence(lhs) < alt_sequence(rhs);
 }
 
 void remove_duplicates(std::vector<Variant>& variants)
@@ -249,6 +256,72 @@ GenomicRegion extend_alleles(NucleotideList& big_allele, NucleotideList& small_a
     return new_region;
 }
 
+// window is the reference sequence from window_begin up to at least the variant. Returns none if the
+// variant could shift to window_begin or before, as then more sequence is needed.
+boost::optional<Variant> left_align(const Variant& variant, const ReferenceGenome::GeneticSequence& window,
+                                    const GenomicRegion::Position window_begin)
+{
+    const auto& ref_allele_sequence = ref_sequence(variant);
+    const auto& alt_allele_sequence = alt_sequence(variant);
+    const bool is_ref_bigger {ref_allele_sequence.size() > alt_allele_sequence.size()};
+    const auto& big_allele   = is_ref_bigger ? ref_allele_sequence : alt_allele_sequence;
+    const auto& small_allele = is_ref_bigger ? alt_allele_sequence : ref_allele_sequence;
+    // Each allele is considered with the window sequence before the variant prepended
+    const std::size_t prefix_size {mapped_begin(variant) - window_begin};
+    assert(prefix_size <= window.size());
+    const auto base = [&] (const Variant::NucleotideSequence& allele, const std::size_t i) {
+        return i < prefix_size ? window[i] : allele[i - prefix_size];
+    };
+    const auto big_size = prefix_size + big_allele.size(), small_size = prefix_size + small_allele.size();
+    std::size_t shift {0};
+    while (shift < small_size && base(big_allele, big_size - shift - 1) == base(small_allele, small_size - shift - 1)) {
+        ++shift;
+    }
+    if (shift >= prefix_size) return boost::none;
+    const auto new_begin = prefix_size - shift;
+    Variant::NucleotideSequence new_big_allele(big_allele.size(), 'N'), new_small_allele(small_allele.size(), 'N');
+    for (std::size_t i {0}; i < big_allele.size(); ++i) new_big_allele[i] = base(big_allele, new_begin + i);
+    for (std::size_t i {0}; i < small_allele.size(); ++i) new_small_allele[i] = base(small_allele, new_begin + i);
+    const auto new_ref_region_begin = window_begin + static_cast<GenomicRegion::Position>(new_begin);
+    GenomicRegion new_ref_region {contig_name(variant), new_ref_region_begin,
+                                  new_ref_region_begin + static_cast<GenomicRegion::Size>(ref_allele_sequence.size())};
+    if (is_ref_bigger) {
+        return Variant {std::move(new_ref_region), std::move(new_big_allele), std::move(new_small_allele)};
+    } else {
+        return Variant {std::move(new_ref_region), std::move(new_small_allele), std::move(new_big_allele)};
+    }
+}
+
+template <typename Iterator>
+void left_align_sorted(Iterator first, const Iterator last, const ReferenceGenome& reference,
+                       const GenomicRegion::Size window_padding)
+{
+    constexpr GenomicRegion::Size maxWindowSize {100'000};
+    while (first != last) {
+        if (!is_left_alignable(*first)) {
+            ++first;
+            continue;
+        }
+        const auto& contig = contig_name(*first);
+        const auto window_begin = mapped_begin(*first) > window_padding ? mapped_begin(*first) - window_padding : 0;
+        // Only sequence before each variant is needed
+        auto window_end = mapped_begin(*first);
+        auto cluster_last = std::next(first);
+        for (; cluster_last != last && contig_name(*cluster_last) == contig
+               && mapped_begin(*cluster_last) < window_begin + maxWindowSize; ++cluster_last) {
+            window_end = std::max(window_end, mapped_begin(*cluster_last));
+        }
+        const auto window = reference.fetch_sequence(GenomicRegion {contig, window_begin, window_end});
+        std::for_each(first, cluster_last, [&] (Variant& variant) {
+            if (is_left_alignable(variant)) {
+                auto left_aligned = left_align(variant, window, window_begin);
+                variant = left_aligned ? std::move(*left_aligned) : left_align(variant, reference);
+            }
+        });
+        first = cluster_last;
+    }
+}
+
 } // namespace
 
 Variant left_align(const Variant& variant, const ReferenceGenome& reference,
@@ -310,6 +383,14 @@ Variant left_align(const Variant& variant, const ReferenceGenome& reference,
     }
 }
 
+std::vector<Variant> left_align_each(std::vector<Variant>&& variants, const ReferenceGenome& reference,
+                                     const GenomicRegion::Size window_padding)
+{
+    assert(std::is_sorted(std::cbegin(variants), std::cend(variants)));
+    left_align_sorted(std::begin(variants), std::end(variants), reference, window_padding);
+    return std::move(variants);
+}
+
 Variant normalise(const Variant& variant, const ReferenceGenome& reference,
                   const unsigned extension_size)
 {
@@ -359,12 +440,9 @@ Variant pad_right(const Variant& variant, const ReferenceGenome& reference, cons
 std::vector<Variant> unique_left_align(const std::vector<Variant>& variants,
                                        const ReferenceGenome& reference)
 {
-    std::vector<Variant> result {};
-    result.reserve(variants.size());
-    boost::transform(variants, std::back_inserter(result),
-                     [&reference] (const Variant& variant) { return left_align(variant, reference); });
-    result.erase(boost::unique<boost::return_found>(boost::sort(result)), std::end(result));
-    return result;
+    std::vector<Variant> sorted_variants {variants};
+    sorted_variants.erase(boost::unique<boost::return_found>(boost::sort(sorted_variants)), std::end(sorted_variants));
+    return unique_left_align(std::move(sorted_variants), reference);
 }
 
 std::vector<Variant> unique_left_align(std::vector<Variant>&& variants,
@@ -376,10 +454,7 @@ std::vector<Variant> unique_left_align(std::vector<Variant>&& variants,
                                           [] (const Variant& variant) {
                                               return !is_left_alignable(variant);
                                           });
-    std::transform(std::make_move_iterator(it), std::make_move_iterator(end(variants)), it,
-                   [&reference] (Variant&& variant) {
-                       return left_align(std::move(variant), reference);
-                   });
+    left_align_sorted(it, std::end(variants), reference, 100);
     std::sort(it, std::end(variants));
     variants.erase(std::unique(it, std::end(variants)), std::end(variants));
     std::inplace_merge(std::begin(variants), it, std::end(variants));
@@ -226,6 +226,14 @@ bool is_left_alignable(const Variant& variant) noexcept;
 Variant left_align(const Variant& variant, const ReferenceGenome& reference,
                    GenomicRegion::Size extension_size = 30);
 
+/*
+ Left aligns each of the given sorted variants. Reference sequence is fetched once for each cluster of
+ nearby variants, with window_padding bases before the first, rather than once per variant. The result
+ is the same as calling left_align on each variant.
+ */
+std::vector<Variant> left_align_each(std::vector<Variant>&& variants, const ReferenceGenome& reference,
+                                     GenomicRegion::Size window_padding = 100);
+
 /*
  A variant is normalised if and only if it is parsimonious and left aligned.
  */
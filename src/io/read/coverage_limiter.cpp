@@ -0,0 +1,37 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "coverage_limiter.hpp"
+
+#include <algorithm>
+
+namespace octopus { namespace io {
+
+CoverageLimiter::CoverageLimiter(const unsigned max_coverage)
+: max_coverage_ {max_coverage}
+, admitted_ends_ {}
+, num_rejected_ {0}
+{}
+
+bool CoverageLimiter::admit(const Position begin, Position end)
+{
+    end = std::max(end, begin + 1); // unmapped reads still occupy one position
+    while (!admitted_ends_.empty() && admitted_ends_.top() <= begin) {
+        admitted_ends_.pop();
+    }
+    if (admitted_ends_.size() < max_coverage_) {
+        admitted_ends_.push(end);
+        return true;
+    } else {
+        ++num_rejected_;
+        return false;
+    }
+}
+
+std::size_t CoverageLimiter::num_rejected() const noexcept
+{
+    return num_rejected_;
+}
+
+} // namespace io
+} // namespace octopus
@@ -0,0 +1,53 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef coverage_limiter_hpp
+#define coverage_limiter_hpp
+
+#include <vector>
+#include <queue>
+#include <functional>
+#include <cstddef>
+
+#include "basics/genomic_region.hpp"
+
+namespace octopus { namespace io {
+
+/*
+ CoverageLimiter decides, while reads are streamed in coordinate order, whether each read should be
+ kept. A read is admitted only if fewer than max_coverage admitted reads overlap its first position,
+ which guarantees the coverage of the admitted reads never exceeds max_coverage anywhere. Memory is
+ bounded by max_coverage, and the choice depends only on the input order so is deterministic.
+ */
+class CoverageLimiter
+{
+public:
+    using Position = GenomicRegion::Position;
+    
+    CoverageLimiter() = delete;
+    
+    explicit CoverageLimiter(unsigned max_coverage);
+    
+    CoverageLimiter(const CoverageLimiter&)            = default;
+    CoverageLimiter& operator=(const CoverageLimiter&) = default;
+    CoverageLimiter(CoverageLimiter&&)                 = default;
+    CoverageLimiter& operator=(CoverageLimiter&&)      = default;
+    
+    ~CoverageLimiter() = default;
+    
+    bool admit(Position begin, Position end);
+    
+    std::size_t num_rejected() const noexcept;
+    
+private:
+    using EndQueue = std::priority_queue<Position, std::vector<Position>, std::greater<Position>>;
+    
+    unsigned max_coverage_;
+    EndQueue admitted_ends_;
+    std::size_t num_rejected_;
+};
+
+} // namespace io
+} // namespace octopus
+
+#endif
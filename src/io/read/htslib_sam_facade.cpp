@@ -6,17 +6,25 @@
 #include <sstream>
 #include <cmath>
 #include <algorithm>
+#include <numeric>
 #include <iterator>
 #include <stdexcept>
 #include <sstream>
+#include <cctype>
+#include <cstring>
 #include <cassert>
 
+#ifdef __SSSE3__
+    #include <tmmintrin.h>
+#endif
+
 #include <boost/filesystem/operations.hpp>
 #include <htslib/sam.h>
 
 #include "basics/cigar_string.hpp"
 #include "basics/genomic_region.hpp"
 #include "basics/contig_region.hpp"
+#include "utils/path_utils.hpp"
 #include "exceptions/missing_file_error.hpp"
 #include "exceptions/missing_index_error.hpp"
 #include "exceptions/malformed_file_error.hpp"
@@ -28,6 +36,8 @@ namespace octopus { namespace io {
 static const std::string readGroupTag   {"RG"};
 static const std::string readGroupIdTag {"ID"};
 static const std::string sampleIdTag    {"SM"};
+static const std::string editDistanceTag {"NM"};
+static const std::string mismatchTag     {"MD"};
 
 class MissingBAM : public MissingFileError
 {
@@ -154,12 +164,52 @@ private:
 
 // public methods
 
+HtslibThreadPool::HtslibThreadPool(const unsigned num_threads)
+: pool_ {hts_tpool_init(static_cast<int>(num_threads)), 0}
+, num_threads_ {num_threads}
+{
+    if (pool_.pool == nullptr) {
+        throw std::runtime_error {"HtslibThreadPool: could not create htslib thread pool"};
+    }
+}
+
+HtslibThreadPool::~HtslibThreadPool()
+{
+    hts_tpool_destroy(pool_.pool);
+}
+
+unsigned HtslibThreadPool::num_threads() const noexcept
+{
+    return num_threads_;
+}
+
+htsThreadPool* HtslibThreadPool::get() noexcept
+{
+    return &pool_;
+}
+
 namespace {
 
-auto open_hts_file(const boost::filesystem::path& file)
+constexpr int remoteBlockSize {4 * 1024 * 1024};
+
+auto open_hts_file(const boost::filesystem::path& file, HtslibThreadPool* decompression_threads,
+                   const boost::optional<boost::filesystem::path>& reference)
 {
     hts_verbose = 0; // disable hts error reporting
-    return sam_open(file.c_str(), "r");
+    auto result = sam_open(file.c_str(), "r");
+    if (result && decompression_threads) {
+        // Failure just means blocks are decompressed on the calling thread
+        hts_set_thread_pool(result, decompression_threads->get());
+    }
+    if (result && is_url(file)) {
+        // Fewer, larger range requests, as each costs a round trip
+        hts_set_opt(result, HTS_OPT_BLOCK_SIZE, remoteBlockSize);
+    }
+    if (result && reference && result->is_cram) {
+        // Otherwise htslib looks up the header M5 tags in REF_CACHE/REF_PATH, and may download the reference
+        hts_set_fai_filename(result, reference->c_str());
+    }
+    return result;
 }
 
 bool is_cram(const boost::filesystem::path& file)
@@ -169,15 +219,20 @@ bool is_cram(const boost::filesystem::path& file)
 
 } // namespace
 
-HtslibSamFacade::HtslibSamFacade(Path file_path)
+HtslibSamFacade::HtslibSamFacade(Path file_path, HtslibThreadPool* decompression_threads, boost::optional<Path> reference)
 : file_path_ {std::move(file_path)}
-, hts_file_ {open_hts_file(file_path_), HtsFileDeleter {}}
+, decompression_threads_ {decompression_threads}
+, reference_ {std::move(reference)}
+, hts_file_ {open_hts_file(file_path_, decompression_threads_, reference_), HtsFileDeleter {}}
 , hts_header_ {(hts_file_) ? sam_hdr_read(hts_file_.get()) : nullptr, HtsHeaderDeleter {}}
-, hts_index_ {(hts_file_) ? sam_index_load(hts_file_.get(), file_path_.c_str()) : nullptr, HtsIndexDeleter {}}
+, hts_index_ {(hts_file_ && !is_stdin(file_path_)) ? sam_index_load(hts_file_.get(), file_path_.c_str()) : nullptr, HtsIndexDeleter {}}
 , hts_targets_ {}
 , contig_names_ {}
 , sample_names_ {}
 , samples_ {}
+, read_group_index_ {}
+, coverage_index_ {}
+, stream_iterator_ {}
 {
     namespace fs = boost::filesystem;
     if (!hts_file_) {
@@ -195,7 +250,7 @@ HtslibSamFacade::HtslibSamFacade(Path file_path)
             }
         }
     }
-    if (hts_file_ && !hts_index_) {
+    if (hts_file_ && !hts_index_ && !is_stream()) {
         if (hts_file_->is_cram) {
             throw MissingCRAMIndex {file_path};
         } else {
@@ -215,23 +270,29 @@ HtslibSamFacade::HtslibSamFacade(Path file_path)
     }
     samples_.shrink_to_fit();
     std::sort(std::begin(samples_), std::end(samples_));
+    init_read_group_index();
 }
 
-auto open_hts_writable_file(const boost::filesystem::path& path)
+auto open_hts_writable_file(const boost::filesystem::path& path, HtslibThreadPool* compression_threads)
 {
     std::string mode {"[w]"};
     const auto extension = path.extension();
     if (extension == ".bam") {
         mode += "b";
     }
-    return sam_open(path.c_str(), mode.c_str());
+    auto result = sam_open(path.c_str(), mode.c_str());
+    if (result && compression_threads) {
+        // Failure just means blocks are compressed on the writing thread
+        hts_set_thread_pool(result, compression_threads->get());
+    }
+    return result;
 }
 
-HtslibSamFacade::HtslibSamFacade(Path sam_out, Path sam_template)
+HtslibSamFacade::HtslibSamFacade(Path sam_out, Path sam_template, HtslibThreadPool* compression_threads)
 : HtslibSamFacade {std::move(sam_template)}
 {
     file_path_ = std::move(sam_out);
-    hts_file_.reset(open_hts_writable_file(file_path_));
+    hts_file_.reset(open_hts_writable_file(file_path_, compression_threads));
     if (!hts_file_) {
         throw UnwritableBAM {std::move(file_path_)};
     }
@@ -243,7 +304,7 @@ HtslibSamFacade::HtslibSamFacade(Path sam_out, Path sam_template)
 
 HtslibSamFacade::~HtslibSamFacade()
 {
-    if (!hts_index_) {
+    if (!hts_index_ && !is_stream()) {
         hts_header_.reset(nullptr);
         hts_file_.reset(nullptr);
         if (sam_index_build(file_path_.c_str(), 0) < 0) {
@@ -254,13 +315,14 @@ HtslibSamFacade::~HtslibSamFacade()
 
 bool HtslibSamFacade::is_open() const noexcept
 {
-    return hts_file_ != nullptr && hts_header_ != nullptr && hts_index_ != nullptr;
+    return hts_file_ != nullptr && hts_header_ != nullptr && (hts_index_ != nullptr || is_stream());
 }
 
 void HtslibSamFacade::open()
 {
-    hts_file_.reset(sam_open(file_path_.string().c_str(), "r"));
-    if (hts_file_) {
+    if (hts_file_) return;
+    hts_file_.reset(open_hts_file(file_path_, decompression_threads_, reference_));
+    if (hts_file_ && !(hts_header_ && hts_index_)) {
         hts_header_.reset(sam_hdr_read(hts_file_.get()));
         hts_index_.reset(sam_index_load(hts_file_.get(), file_path_.c_str()));
     }
@@ -268,9 +330,15 @@ void HtslibSamFacade::open()
 
 void HtslibSamFacade::close()
 {
+    if (is_stream()) return; // could not be reopened
+    // BAM headers and indices don't depend on the file handle, so keeping them makes reopening
+    // cheap. CRAM indices are owned by the file handle, so must go with it.
+    const bool retain_index {hts_file_ && !hts_file_->is_cram};
     hts_file_.reset(nullptr);
-    hts_header_.reset(nullptr);
-    hts_index_.reset(nullptr);
+    if (!retain_index) {
+        hts_header_.reset(nullptr);
+        hts_index_.reset(nullptr);
+    }
 }
 
 GenomicRegion::Size HtslibSamFacade::reference_size(const GenomicRegion::ContigName& contig) const
@@ -349,19 +417,6 @@ bool is_subset(const std::vector<T>& lhs, const std::vector<T>& rhs)
     }
 }
 
-template <typename S>
-auto get_readable_samples(std::vector<S> request_samples, const std::vector<S>& file_samples)
-{
-    std::sort(std::begin(request_samples), std::end(request_samples));
-    std::vector<S> result {};
-    result.reserve(request_samples.size());
-    std::set_intersection(std::make_move_iterator(std::begin(request_samples)),
-                          std::make_move_iterator(std::end(request_samples)),
-                          std::cbegin(file_samples), std::cend(file_samples),
-                          std::back_inserter(result));
-    return result;
-}
-
 } // namespace
 
 // has_reads
@@ -375,8 +430,10 @@ bool HtslibSamFacade::has_reads(const GenomicRegion& region) const
 bool HtslibSamFacade::has_reads(const SampleName& sample, const GenomicRegion& region) const
 {
     if (samples_.size() == 1 && samples_.front() == sample) return has_reads(region);
+    const auto sample_id = find_sample(sample);
+    if (!sample_id) return false;
     HtslibIterator it {*this, region};
-    while (++it) if (sample_names_.at(it.read_group()) == sample) return true;
+    while (++it) if (it.sample() == *sample_id) return true;
     return false;
 }
 
@@ -385,13 +442,10 @@ bool HtslibSamFacade::has_reads(const std::vector<SampleName>& samples, const Ge
     if (samples.empty()) return false;
     if (samples.size() == 1) return has_reads(samples.front(), region);
     if (is_subset(samples, samples_)) return has_reads(region);
-    const auto readable_samples = get_readable_samples(samples, samples_);
+    const auto sample_mask = make_sample_mask(samples);
     HtslibIterator it {*this, region};
     while (++it) {
-        if (std::binary_search(std::cbegin(readable_samples), std::cend(readable_samples),
-                               sample_names_.at(it.read_group()))) {
-            return true;
-        }
+        if (sample_mask[it.sample()]) return true;
     }
     return false;
 }
@@ -409,9 +463,11 @@ std::size_t HtslibSamFacade::count_reads(const GenomicRegion& region) const
 std::size_t HtslibSamFacade::count_reads(const SampleName& sample, const GenomicRegion& region) const
 {
     if (samples_.size() == 1 && samples_.front() == sample) return count_reads(region);
+    const auto sample_id = find_sample(sample);
+    if (!sample_id) return 0;
     HtslibIterator it {*this, region};
     std::size_t result {0};
-    while (++it && sample_names_.at(it.read_group()) == sample) ++result;
+    while (++it && it.sample() == *sample_id) ++result;
     return result;
 }
 
@@ -420,12 +476,57 @@ std::size_t HtslibSamFacade::count_reads(const std::vector<SampleName>& samples,
     if (samples.empty()) return 0;
     if (samples.size() == 1) return count_reads(samples.front(), region);
     if (is_subset(samples, samples_)) return count_reads(region);
-    const auto readable_samples = get_readable_samples(samples, samples_);
+    const auto sample_mask = make_sample_mask(samples);
     HtslibIterator it {*this, region};
     std::size_t result {0};
-    while (++it && std::binary_search(std::cbegin(readable_samples), std::cend(readable_samples),
-                                      sample_names_.at(it.read_group()))) {
-        ++result;
+    while (++it && sample_mask[it.sample()]) ++result;
+    return result;
+}
+
+std::size_t HtslibSamFacade::estimate_read_count(const std::vector<SampleName>& samples, const GenomicRegion& region) const
+{
+    if (samples.empty() || is_empty(region)) return count_reads(samples, region);
+    const auto& index = index_coverage(region);
+    const auto first_bin = region.begin() / coverageIndexBinSize_;
+    const auto last_bin = (region.end() - 1) / coverageIndexBinSize_;
+    std::size_t result {0};
+    for (const auto& sample : samples) {
+        const auto sample_id = find_sample(sample);
+        if (!sample_id) continue;
+        const auto& counts = index.counts[*sample_id];
+        result = std::accumulate(std::next(std::cbegin(counts), first_bin), std::next(std::cbegin(counts), last_bin + 1), result);
+    }
+    return result;
+}
+
+const HtslibSamFacade::ContigCoverageIndex& HtslibSamFacade::index_coverage(const GenomicRegion& region) const
+{
+    const auto& contig = region.contig_name();
+    auto& result = coverage_index_[contig];
+    if (result.is_indexed.empty()) {
+        const auto num_bins = reference_size(contig) / coverageIndexBinSize_ + 1;
+        result.is_indexed.resize(num_bins, false);
+        result.counts.assign(samples_.size(), std::vector<std::uint32_t>(num_bins, 0));
+    }
+    const auto last_bin = std::min((region.end() - 1) / coverageIndexBinSize_, result.is_indexed.size() - 1);
+    auto bin = region.begin() / coverageIndexBinSize_;
+    while (bin <= last_bin) {
+        if (result.is_indexed[bin]) {
+            ++bin;
+            continue;
+        }
+        // Scan each run of unindexed bins with a single iterator
+        auto run_end = bin + 1;
+        while (run_end <= last_bin && !result.is_indexed[run_end]) ++run_end;
+        const GenomicRegion run_region {contig, bin * coverageIndexBinSize_, run_end * coverageIndexBinSize_};
+        HtslibIterator it {*this, run_region};
+        while (++it) {
+            const auto read_begin = it.begin();
+            if (read_begin < run_region.begin()) continue; // counted with an earlier bin
+            ++result.counts[it.sample()][read_begin / coverageIndexBinSize_];
+        }
+        std::fill(std::next(std::begin(result.is_indexed), bin), std::next(std::begin(result.is_indexed), run_end), true);
+        bin = run_end;
     }
     return result;
 }
@@ -445,22 +546,18 @@ HtslibSamFacade::extract_read_positions(const GenomicRegion& region, std::size_t
     return result;
 }
 
-bool contains(const std::vector<HtslibSamFacade::SampleName>& samples, const HtslibSamFacade::SampleName& sample) noexcept
-{
-    return std::find(std::cbegin(samples), std::cend(samples), sample) != std::cend(samples);
-}
-
 HtslibSamFacade::PositionList
 HtslibSamFacade::extract_read_positions(const SampleName& sample, const GenomicRegion& region,
                                         std::size_t max_coverage) const
 {
-    if (!contains(samples_, sample)) return {};
+    const auto sample_id = find_sample(sample);
+    if (!sample_id) return {};
     if (samples_.size() == 1) return extract_read_positions(region, max_coverage);
     PositionList result {};
     result.reserve(max_coverage);
     HtslibIterator it {*this, region};
     while (max_coverage > 0 && ++it) {
-        if (sample == sample_names_.at(it.read_group())) {
+        if (it.sample() == *sample_id) {
             result.push_back(it.begin());
             --max_coverage;
         }
@@ -475,11 +572,12 @@ HtslibSamFacade::extract_read_positions(const std::vector<SampleName>& samples,
     if (samples.empty()) return {};
     if (samples.size() == 1) return extract_read_positions(samples.front(), region, max_coverage);
     if (is_subset(samples, samples_)) return extract_read_positions(region, max_coverage);
+    const auto sample_mask = make_sample_mask(samples);
     PositionList result {};
     result.reserve(max_coverage);
     HtslibIterator it {*this, region};
     while (max_coverage > 0 && ++it) {
-        if (contains(samples, sample_names_.at(it.read_group()))) {
+        if (sample_mask[it.sample()]) {
             result.push_back(it.begin());
             --max_coverage;
         }
@@ -487,6 +585,24 @@ HtslibSamFacade::extract_read_positions(const std::vector<SampleName>& samples,
     return result;
 }
 
+// extract_variation_evidence
+
+boost::optional<HtslibSamFacade::EvidenceList>
+HtslibSamFacade::extract_variation_evidence(const std::vector<SampleName>& samples, const GenomicRegion& region) const
+{
+    EvidenceList result {};
+    if (samples.empty()) return result;
+    const auto check_samples = !is_subset(samples, samples_);
+    const auto sample_mask = make_sample_mask(samples);
+    HtslibIterator it {*this, region};
+    while (++it) {
+        if (!check_samples || sample_mask[it.sample()]) {
+            it.extract_variation_evidence(result);
+        }
+    }
+    return result;
+}
+
 // fetch_reads
 
 namespace {
@@ -509,72 +625,51 @@ bool try_reserve(Container& c, const std::size_t max, const std::size_t min)
 
 HtslibSamFacade::SampleReadMap HtslibSamFacade::fetch_reads(const GenomicRegion& region) const
 {
-    SampleReadMap result {samples_.size()};
-    if (samples_.size() == 1) {
-        return {{samples_.front(), fetch_reads(samples_.front(), region)}};
-    }
-    HtslibIterator it {*this, region};
-    for (const auto& sample : samples_) {
-        auto p = result.emplace(std::piecewise_construct, std::forward_as_tuple(sample), std::forward_as_tuple());
-        try_reserve(p.first->second, defaultReserve_, defaultReserve_ / 10);
-    }
-    while (++it) {
-        try {
-            result.at(sample_names_.at(it.read_group())).emplace_back(*it);
-        } catch (InvalidBamRecord& e) {
-            // TODO: Just ignore? Could log or something.
-            //std::clog << "Warning: " << e.what() << std::endl;
-        } catch (...) {
-            throw;
-        }
-    }
-    return result;
+    return fetch_reads(region, ReadPrefilter {}, boost::none);
 }
 
 HtslibSamFacade::ReadContainer HtslibSamFacade::fetch_reads(const SampleName& sample, const GenomicRegion& region) const
 {
-    if (!contains(samples_, sample)) return {};
-    if (samples_.size() == 1) return fetch_all_reads(region);
-    HtslibIterator it {*this, region};
-    ReadContainer result {};
-    try_reserve(result, defaultReserve_, defaultReserve_ / 10);
-    while (++it) {
-        if (sample_names_.at(it.read_group()) == sample) {
-            try {
-                result.emplace_back(*it);
-            } catch (InvalidBamRecord& e) {
-                // TODO
-            } catch (...) {
-                throw;
-            }
-        }
-    }
-    return result;
+    return fetch_reads(sample, region, ReadPrefilter {}, boost::none);
 }
 
 HtslibSamFacade::SampleReadMap HtslibSamFacade::fetch_reads(const std::vector<SampleName>& samples,
                                                             const GenomicRegion& region) const
+{
+    return fetch_reads(samples, region, ReadPrefilter {}, boost::none);
+}
+
+HtslibSamFacade::SampleReadMap HtslibSamFacade::fetch_reads(const std::vector<SampleName>& samples,
+                                                            const GenomicRegion& region,
+                                                            const ReadPrefilter& prefilter,
+                                                            const boost::optional<unsigned> max_coverage) const
 {
     if (samples.size() == 1) {
-        return {{samples.front(), fetch_reads(samples.front(), region)}};
+        return {{samples.front(), fetch_reads(samples.front(), region, prefilter, max_coverage)}};
     }
-    if (is_subset(samples_, samples)) return fetch_reads(region);
+    if (is_subset(samples_, samples)) return fetch_reads(region, prefilter, max_coverage);
     HtslibIterator it {*this, region};
     SampleReadMap result {samples.size()};
+    // Indexed by sample id so records are routed without hashing sample names
+    std::vector<ReadContainer*> sample_reads(samples_.size(), nullptr);
     for (const auto& sample : samples) {
-        if (contains(samples_, sample)) {
-            auto p = result.emplace(std::piecewise_construct,
-                                    std::forward_as_tuple(sample),
-                                    std::forward_as_tuple());
-            try_reserve(p.first->second, defaultReserve_, defaultReserve_ / 10);
+        const auto sample_id = find_sample(sample);
+        if (sample_id) {
+            auto& reads = result[sample];
+            try_reserve(reads, defaultReserve_, defaultReserve_ / 10);
+            sample_reads[*sample_id] = &reads;
         }
     }
     if (result.empty()) return result; // no matching samples
+    std::vector<CoverageLimiter> limiters {};
+    if (max_coverage) limiters.assign(samples_.size(), CoverageLimiter {*max_coverage});
     while (++it) {
-        const auto& sample = sample_names_.at(it.read_group());
-        if (result.count(sample) == 1) {
+        if (!it.passes(prefilter)) continue;
+        const auto sample = it.sample();
+        if (sample_reads[sample]) {
+            if (max_coverage && !it.admitted_by(limiters[sample])) continue;
             try {
-                result.at(sample_names_.at(it.read_group())).emplace_back(*it);
+                sample_reads[sample]->emplace_back(*it);
             } catch (InvalidBamRecord& e) {
                 // TODO
             } catch (...) {
@@ -610,6 +705,20 @@ boost::optional<std::vector<GenomicRegion::ContigName>> HtslibSamFacade::mapped_
     return result;
 }
 
+boost::optional<HtslibSamFacade::StreamRecord> HtslibSamFacade::read_next()
+{
+    if (!stream_iterator_) stream_iterator_ = std::make_unique<HtslibIterator>(*this);
+    auto& it = *stream_iterator_;
+    while (++it) {
+        if (it.contig() < 0) break; // unplaced reads are last in sorted files
+        try {
+            const auto sample = it.sample();
+            return StreamRecord {samples_[sample], it.begin(), it.end(), *it};
+        } catch (const InvalidBamRecord&) {}
+    }
+    return boost::none;
+}
+
 void HtslibSamFacade::write(const AlignedRead& read)
 {
     if (!hts_file_ || !hts_header_) {
@@ -642,12 +751,82 @@ void HtslibSamFacade::write(const AnnotatedAlignedRead& read)
 
 // private methods
 
-HtslibSamFacade::ReadContainer HtslibSamFacade::fetch_all_reads(const GenomicRegion& region) const
+bool HtslibSamFacade::is_stream() const noexcept
 {
+    return is_stdin(file_path_);
+}
+
+HtslibSamFacade::SampleReadMap HtslibSamFacade::fetch_reads(const GenomicRegion& region, const ReadPrefilter& prefilter,
+                                                            const boost::optional<unsigned> max_coverage) const
+{
+    SampleReadMap result {samples_.size()};
+    if (samples_.size() == 1) {
+        return {{samples_.front(), fetch_reads(samples_.front(), region, prefilter, max_coverage)}};
+    }
+    HtslibIterator it {*this, region};
+    std::vector<ReadContainer*> sample_reads(samples_.size(), nullptr);
+    for (std::size_t sample_id {0}; sample_id < samples_.size(); ++sample_id) {
+        auto& reads = result[samples_[sample_id]];
+        try_reserve(reads, defaultReserve_, defaultReserve_ / 10);
+        sample_reads[sample_id] = &reads;
+    }
+    std::vector<CoverageLimiter> limiters {};
+    if (max_coverage) limiters.assign(samples_.size(), CoverageLimiter {*max_coverage});
+    while (++it) {
+        if (!it.passes(prefilter)) continue;
+        const auto sample = it.sample();
+        if (max_coverage && !it.admitted_by(limiters[sample])) continue;
+        try {
+            sample_reads[sample]->emplace_back(*it);
+        } catch (InvalidBamRecord& e) {
+            // TODO: Just ignore? Could log or something.
+            //std::clog << "Warning: " << e.what() << std::endl;
+        } catch (...) {
+            throw;
+        }
+    }
+    return result;
+}
+
+HtslibSamFacade::ReadContainer HtslibSamFacade::fetch_reads(const SampleName& sample, const GenomicRegion& region,
+                                                            const ReadPrefilter& prefilter,
+                                                            const boost::optional<unsigned> max_coverage) const
+{
+    const auto sample_id = find_sample(sample);
+    if (!sample_id) return {};
+    if (samples_.size() == 1) return fetch_all_reads(region, prefilter, max_coverage);
     HtslibIterator it {*this, region};
     ReadContainer result {};
     try_reserve(result, defaultReserve_, defaultReserve_ / 10);
+    boost::optional<CoverageLimiter> limiter {};
+    if (max_coverage) limiter = CoverageLimiter {*max_coverage};
     while (++it) {
+        if (it.passes(prefilter) && it.sample() == *sample_id) {
+            if (limiter && !it.admitted_by(*limiter)) continue;
+            try {
+                result.emplace_back(*it);
+            } catch (InvalidBamRecord& e) {
+                // TODO
+            } catch (...) {
+                throw;
+            }
+        }
+    }
+    return result;
+}
+
+HtslibSamFacade::ReadContainer HtslibSamFacade::fetch_all_reads(const GenomicRegion& region,
+                                                                const ReadPrefilter& prefilter,
+                                                                const boost::optional<unsigned> max_coverage) const
+{
+    HtslibIterator it {*this, region};
+    ReadContainer result {};
+    try_reserve(result, defaultReserve_, defaultReserve_ / 10);
+    boost::optional<CoverageLimiter> limiter {};
+    if (max_coverage) limiter = CoverageLimiter {*max_coverage};
+    while (++it) {
+        if (!it.passes(prefilter)) continue;
+        if (limiter && !it.admitted_by(*limiter)) continue;
         try {
             result.emplace_back(*it);
         } catch (InvalidBamRecord& e) {
@@ -720,6 +899,33 @@ void HtslibSamFacade::init_maps()
     }
 }
 
+void HtslibSamFacade::init_read_group_index()
+{
+    std::vector<std::pair<ReadGroupIdType, SampleId>> read_groups {};
+    read_groups.reserve(sample_names_.size());
+    for (const auto& p : sample_names_) {
+        read_groups.emplace_back(p.first, *find_sample(p.second));
+    }
+    read_group_index_ = ReadGroupIndex {read_groups};
+}
+
+boost::optional<HtslibSamFacade::SampleId> HtslibSamFacade::find_sample(const SampleName& sample) const noexcept
+{
+    const auto itr = std::lower_bound(std::cbegin(samples_), std::cend(samples_), sample);
+    if (itr == std::cend(samples_) || *itr != sample) return boost::none;
+    return static_cast<SampleId>(std::distance(std::cbegin(samples_), itr));
+}
+
+std::vector<char> HtslibSamFacade::make_sample_mask(const std::vector<SampleName>& samples) const
+{
+    std::vector<char> result(samples_.size(), false);
+    for (const auto& sample : samples) {
+        const auto sample_id = find_sample(sample);
+        if (sample_id) result[*sample_id] = true;
+    }
+    return result;
+}
+
 HtslibSamFacade::HtsTid HtslibSamFacade::get_htslib_target(const GenomicRegion::ContigName& contig) const
 {
     return hts_targets_.at(contig);
@@ -730,6 +936,44 @@ const std::string& HtslibSamFacade::get_contig_name(HtsTid target) const
     return contig_names_.at(target);
 }
 
+// ReadGroupIndex
+
+HtslibSamFacade::ReadGroupIndex::ReadGroupIndex(const std::vector<std::pair<ReadGroupIdType, SampleId>>& read_groups)
+{
+    std::size_t num_slots {1};
+    while (num_slots < 2 * read_groups.size()) num_slots *= 2;
+    for (;; num_slots *= 2) {
+        for (seed_ = 0; seed_ < 64; ++seed_) {
+            slots_.assign(num_slots, Slot {});
+            const auto collides = std::any_of(std::cbegin(read_groups), std::cend(read_groups), [this] (const auto& p) {
+                auto& s = slots_[slot(p.first.c_str())];
+                if (s.used) return true;
+                s = Slot {p.first, p.second, true};
+                return false;
+            });
+            if (!collides) return;
+        }
+    }
+}
+
+const HtslibSamFacade::SampleId* HtslibSamFacade::ReadGroupIndex::find(const char* read_group) const noexcept
+{
+    if (slots_.empty()) return nullptr;
+    const auto& s = slots_[slot(read_group)];
+    return s.used && std::strcmp(s.read_group.c_str(), read_group) == 0 ? &s.sample : nullptr;
+}
+
+std::size_t HtslibSamFacade::ReadGroupIndex::slot(const char* read_group) const noexcept
+{
+    // FNV-1a with the seed mixed into the offset basis
+    std::uint64_t h {14695981039346656037ull ^ (seed_ * 0x9E3779B97F4A7C15ull)};
+    for (; *read_group != '\0'; ++read_group) {
+        h ^= static_cast<unsigned char>(*read_group);
+        h *= 1099511628211ull;
+    }
+    return static_cast<std::size_t>(h ^ (h >> 32)) & (slots_.size() - 1);
+}
+
 // HtslibIterator
 
 auto make_hts_iterator(const hts_idx_t* idx, bam_hdr_t* hdr, const GenomicRegion& region)
@@ -740,7 +984,7 @@ auto make_hts_iterator(const hts_idx_t* idx, bam_hdr_t* hdr, const GenomicRegion
 
 HtslibSamFacade::HtslibIterator::HtslibIterator(const HtslibSamFacade& hts_facade, const GenomicRegion& region)
 : hts_facade_ {hts_facade}
-, hts_iterator_ {hts_facade.is_open()
+, hts_iterator_ {hts_facade.is_open() && hts_facade.hts_index_
         ? make_hts_iterator(hts_facade_.hts_index_.get(), hts_facade_.hts_header_.get(), region)
     : nullptr, HtsIteratorDeleter {}}
 , hts_bam1_ {bam_init1(), HtsBam1Deleter {}}
@@ -755,7 +999,7 @@ HtslibSamFacade::HtslibIterator::HtslibIterator(const HtslibSamFacade& hts_facad
 
 HtslibSamFacade::HtslibIterator::HtslibIterator(const HtslibSamFacade& hts_facade, const GenomicRegion::ContigName& contig)
 : hts_facade_ {hts_facade}
-, hts_iterator_ {hts_facade.is_open() ? sam_itr_querys(hts_facade_.hts_index_.get(), hts_facade_.hts_header_.get(),
+, hts_iterator_ {hts_facade.is_open() && hts_facade.hts_index_ ? sam_itr_querys(hts_facade_.hts_index_.get(), hts_facade_.hts_header_.get(),
                                                      contig.c_str()) : nullptr, HtsIteratorDeleter {}}
 , hts_bam1_ {bam_init1(), HtsBam1Deleter {}}
 {
@@ -767,6 +1011,16 @@ HtslibSamFacade::HtslibIterator::HtslibIterator(const HtslibSamFacade& hts_facad
     }
 }
 
+HtslibSamFacade::HtslibIterator::HtslibIterator(const HtslibSamFacade& hts_facade)
+: hts_facade_ {hts_facade}
+, hts_iterator_ {nullptr, HtsIteratorDeleter {}}
+, hts_bam1_ {bam_init1(), HtsBam1Deleter {}}
+{
+    if (hts_bam1_ == nullptr) {
+        throw std::runtime_error {"HtslibIterator: error creating bam1 for " + hts_facade.file_path_.string()};
+    }
+}
+
 std::string extract_read_name(const bam1_t* b)
 {
     return std::string {bam_get_qname(b)};
@@ -774,6 +1028,9 @@ std::string extract_read_name(const bam1_t* b)
 
 bool HtslibSamFacade::HtslibIterator::operator++()
 {
+    if (!hts_iterator_) {
+        return sam_read1(hts_facade_.hts_file_.get(), hts_facade_.hts_header_.get(), hts_bam1_.get()) >= 0;
+    }
     return sam_itr_next(hts_facade_.hts_file_.get(), hts_iterator_.get(), hts_bam1_.get()) >= 0;
 }
 
@@ -793,14 +1050,33 @@ char extract_base(const std::uint8_t* hts_sequence, const std::uint32_t index) n
     return symbolTable[bam_seqi(hts_sequence, index)];
 }
 
+void decode_bases(const std::uint8_t* hts_sequence, const std::size_t num_bases, char* result) noexcept
+{
+    std::size_t i {0};
+#ifdef __SSSE3__
+    // Each byte packs two bases, so use the nibbles as shuffle indices into the symbol table
+    // and interleave the results, decoding 32 bases per iteration
+    const auto symbols = _mm_setr_epi8('=', 'A', 'C', 'M', 'G', 'R', 'S', 'V', 'T', 'W', 'Y', 'H', 'K', 'D', 'B', 'N');
+    const auto nibble_mask = _mm_set1_epi8(0xF);
+    for (; i + 32 <= num_bases; i += 32) {
+        const auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hts_sequence + i / 2));
+        const auto firsts  = _mm_shuffle_epi8(symbols, _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble_mask));
+        const auto seconds = _mm_shuffle_epi8(symbols, _mm_and_si128(bytes, nibble_mask));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(result + i), _mm_unpacklo_epi8(firsts, seconds));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(result + i + 16), _mm_unpackhi_epi8(firsts, seconds));
+    }
+#endif
+    for (; i < num_bases; ++i) {
+        result[i] = extract_base(hts_sequence, static_cast<std::uint32_t>(i));
+    }
+}
+
 AlignedRead::NucleotideSequence extract_sequence(const bam1_t* b)
 {
     using NucleotideSequence = AlignedRead::NucleotideSequence;
     const auto sequence_length  = static_cast<NucleotideSequence::size_type>(extract_sequence_length(b));
-    const auto hts_sequence     = bam_get_seq(b);
     NucleotideSequence result(sequence_length, 'N');
-    std::uint32_t i {0};
-    std::generate_n(std::begin(result), sequence_length, [&] () { return extract_base(hts_sequence, i++); });
+    if (sequence_length > 0) decode_bases(bam_get_seq(b), sequence_length, &result[0]);
     return result;
 }
 
@@ -822,10 +1098,7 @@ CigarString extract_cigar_string(const bam1_t* b)
     const auto cigar_length     = get_cigar_length(b);
     CigarString result(cigar_length);
     std::transform(cigar_operations, cigar_operations + cigar_length, std::begin(result),
-                   [] (const auto op) noexcept {
-                       return CigarOperation {static_cast<CigarOperation::Size>(bam_cigar_oplen(op)),
-                                              static_cast<CigarOperation::Flag>(bam_cigar_opchr(op))};
-                   });
+                   [] (const auto op) noexcept { return CigarOperation::unpack(op); });
     return result;
 }
 
@@ -930,6 +1203,103 @@ AlignedRead HtslibSamFacade::HtslibIterator::operator*() const
     }
 }
 
+AlignedRead::Core HtslibSamFacade::HtslibIterator::core() const noexcept
+{
+    const auto& info = hts_bam1_->core;
+    AlignedRead::Core result {};
+    result.mapping_quality = mapping_quality(info);
+    result.flags = extract_flags(info);
+    result.has_other_segment = has_multiple_segments(info);
+    result.next_segment_flags = extract_next_segment_flags(info);
+    result.is_next_segment_on_same_contig = info.mtid == info.tid;
+    return result;
+}
+
+bool HtslibSamFacade::HtslibIterator::passes(const ReadPrefilter& prefilter) const
+{
+    return !prefilter || prefilter(core());
+}
+
+bool HtslibSamFacade::HtslibIterator::admitted_by(CoverageLimiter& limiter) const
+{
+    return limiter.admit(hts_bam1_->core.pos, bam_endpos(hts_bam1_.get()));
+}
+
+namespace {
+
+void add_evidence(const std::size_t begin, const std::size_t end, HtslibSamFacade::EvidenceList& result)
+{
+    using Position = ContigRegion::Position;
+    result.emplace_back(static_cast<Position>(begin), static_cast<Position>(std::max(end, begin + 1)));
+}
+
+// Mismatch positions in the MD tag are offsets into the reference bases covered by the alignment
+void add_mismatch_evidence(const char* md, std::size_t position, HtslibSamFacade::EvidenceList& result)
+{
+    bool in_deletion {false};
+    std::size_t match_length {0};
+    for (; *md != '\0'; ++md) {
+        if (std::isdigit(static_cast<unsigned char>(*md))) {
+            match_length = 10 * match_length + (*md - '0');
+            in_deletion = false;
+        } else if (*md == '^') {
+            position += match_length;
+            match_length = 0;
+            in_deletion = true;
+        } else {
+            position += match_length;
+            match_length = 0;
+            if (!in_deletion) add_evidence(position, position + 1, result);
+            ++position;
+        }
+    }
+}
+
+} // namespace
+
+void HtslibSamFacade::HtslibIterator::extract_variation_evidence(EvidenceList& result) const
+{
+    const auto b = hts_bam1_.get();
+    const auto read_begin = static_cast<std::size_t>(b->core.pos);
+    const auto read_end = static_cast<std::size_t>(bam_endpos(b));
+    const auto cigar_operations = bam_get_cigar(b);
+    const auto cigar_length = get_cigar_length(b);
+    auto position = read_begin;
+    std::size_t num_indel_bases {0};
+    for (std::uint32_t i {0}; i < cigar_length; ++i) {
+        const auto op = bam_cigar_op(cigar_operations[i]);
+        const auto length = static_cast<std::size_t>(bam_cigar_oplen(cigar_operations[i]));
+        switch (op) {
+            case BAM_CINS:
+                num_indel_bases += length;
+                add_evidence(position, position + 1, result);
+                break;
+            case BAM_CDEL:
+                num_indel_bases += length;
+                add_evidence(position, position + length, result);
+                break;
+            case BAM_CSOFT_CLIP:
+            case BAM_CHARD_CLIP:
+                add_evidence(position, position + 1, result);
+                break;
+            case BAM_CDIFF:
+                add_evidence(position, position + length, result);
+                break;
+            default:
+                break;
+        }
+        if (bam_cigar_type(op) & 2) position += length; // consumes reference
+    }
+    const auto nm = bam_aux_get(b, editDistanceTag.c_str());
+    if (nm != nullptr && bam_aux2i(nm) <= static_cast<std::int64_t>(num_indel_bases)) return;
+    const auto md = bam_aux_get(b, mismatchTag.c_str());
+    if (md != nullptr) {
+        add_mismatch_evidence(bam_aux2Z(md), read_begin, result);
+    } else {
+        add_evidence(read_begin, read_end, result);
+    }
+}
+
 HtslibSamFacade::ReadGroupIdType HtslibSamFacade::HtslibIterator::read_group() const
 {
     const auto ptr = bam_aux_get(hts_bam1_.get(), readGroupTag.c_str());
@@ -939,6 +1309,19 @@ HtslibSamFacade::ReadGroupIdType HtslibSamFacade::HtslibIterator::read_group() c
     return HtslibSamFacade::ReadGroupIdType {bam_aux2Z(ptr)};
 }
 
+HtslibSamFacade::SampleId HtslibSamFacade::HtslibIterator::sample() const
+{
+    const auto ptr = bam_aux_get(hts_bam1_.get(), readGroupTag.c_str());
+    if (ptr == nullptr) {
+        throw InvalidBamRecord {hts_facade_.file_path_, extract_read_name(hts_bam1_.get()), "no read group"};
+    }
+    const auto result = hts_facade_.read_group_index_.find(bam_aux2Z(ptr));
+    if (result == nullptr) {
+        throw InvalidBamRecord {hts_facade_.file_path_, extract_read_name(hts_bam1_.get()), "unknown read group"};
+    }
+    return *result;
+}
+
 bool HtslibSamFacade::HtslibIterator::is_good() const noexcept
 {
     if (extract_sequence_length(hts_bam1_.get()) == 0) {
@@ -959,6 +1342,16 @@ std::size_t HtslibSamFacade::HtslibIterator::begin() const noexcept
     return hts_bam1_->core.pos;
 }
 
+std::size_t HtslibSamFacade::HtslibIterator::end() const noexcept
+{
+    return bam_endpos(hts_bam1_.get());
+}
+
+std::int32_t HtslibSamFacade::HtslibIterator::contig() const noexcept
+{
+    return hts_bam1_->core.tid;
+}
+
 namespace {
 
 void set_contig(const std::int32_t tid, bam1_t* result) noexcept
@@ -1091,24 +1484,7 @@ void set_cigar(const AlignedRead& read, bam1_t* result) noexcept
     const auto& cigar = read.cigar();
     result->core.n_cigar = cigar.size();
     std::transform(std::cbegin(cigar), std::cend(cigar), bam_get_cigar(result),
-                   [] (const CigarOperation& op) noexcept -> std::uint32_t {
-                       // Lower 4 bits for CIGAR operation and the higher 28 bits for size
-                       std::uint32_t result = op.size();
-                       result <<= BAM_CIGAR_SHIFT;
-                       using Flag = CigarOperation::Flag;
-                       switch (op.flag()) {
-                           case Flag::alignmentMatch: result |= BAM_CMATCH; break;
-                           case Flag::insertion:      result |= BAM_CINS; break;
-                           case Flag::deletion:       result |= BAM_CDEL; break;
-                           case Flag::skipped:        result |= BAM_CREF_SKIP; break;
-                           case Flag::softClipped:    result |= BAM_CSOFT_CLIP; break;
-                           case Flag::hardClipped:    result |= BAM_CHARD_CLIP; break;
-                           case Flag::padding:        result |= BAM_CPAD; break;
-                           case Flag::sequenceMatch:  result |= BAM_CEQUAL; break;
-                           case Flag::substitution:   result |= BAM_CDIFF; break;
-                       }
-                       return result;
-                   });
+                   [] (const CigarOperation& op) noexcept { return op.packed(); });
     result->l_data += cigar_bytes(read);
 }
 
@@ -17,18 +17,46 @@
 
 #include "htslib/hts.h"
 #include "htslib/sam.h"
+#include "htslib/thread_pool.h"
 
+#include "basics/genomic_region.hpp"
 #include "basics/aligned_read.hpp"
 #include "read_reader_impl.hpp"
 
 namespace octopus {
 
-class GenomicRegion;
 class ContigRegion;
 class AnnotatedAlignedRead;
 
 namespace io {
 
+/*
+ HtslibThreadPool is a pool of htslib worker threads used for BGZF and CRAM (de)compression.
+ A single pool can be shared by any number of HtslibSamFacades, but must outlive them all.
+ */
+class HtslibThreadPool
+{
+public:
+    HtslibThreadPool() = delete;
+    
+    HtslibThreadPool(unsigned num_threads);
+    
+    HtslibThreadPool(const HtslibThreadPool&)            = delete;
+    HtslibThreadPool& operator=(const HtslibThreadPool&) = delete;
+    HtslibThreadPool(HtslibThreadPool&&)                 = delete;
+    HtslibThreadPool& operator=(HtslibThreadPool&&)      = delete;
+    
+    ~HtslibThreadPool();
+    
+    unsigned num_threads() const noexcept;
+    
+    htsThreadPool* get() noexcept;
+    
+private:
+    htsThreadPool pool_;
+    unsigned num_threads_;
+};
+
 class HtslibSamFacade : public IReadReaderImpl
 {
 public:
@@ -38,6 +66,7 @@ public:
     using IReadReaderImpl::ReadContainer;
     using IReadReaderImpl::SampleReadMap;
     using IReadReaderImpl::PositionList;
+    using IReadReaderImpl::EvidenceList;
     
     using NucleotideSequence = AlignedRead::NucleotideSequence;
     
@@ -45,8 +74,11 @@ public:
     
     HtslibSamFacade() = delete;
     
-    HtslibSamFacade(Path file_path);
-    HtslibSamFacade(Path sam_out, Path sam_template);
+    // The reference is only used to decode CRAM files, in place of the one named in the CRAM header.
+    // A file_path of "-" reads the standard input, which needs no index but can only be read with read_next.
+    HtslibSamFacade(Path file_path, HtslibThreadPool* decompression_threads = nullptr,
+                    boost::optional<Path> reference = boost::none);
+    HtslibSamFacade(Path sam_out, Path sam_template, HtslibThreadPool* compression_threads = nullptr);
     
     HtslibSamFacade(const HtslibSamFacade&)            = delete;
     HtslibSamFacade& operator=(const HtslibSamFacade&) = delete;
@@ -73,6 +105,9 @@ public:
                             const GenomicRegion& region) const override;
     std::size_t count_reads(const std::vector<SampleName>& samples,
                             const GenomicRegion& region) const override;
+    // Counts reads starting in the index bins overlapping region. Bins are indexed on first use.
+    std::size_t estimate_read_count(const std::vector<SampleName>& samples,
+                                    const GenomicRegion& region) const override;
     
     PositionList extract_read_positions(const GenomicRegion& region,
                                         std::size_t max_reads) const override;
@@ -83,23 +118,77 @@ public:
                                         const GenomicRegion& region,
                                         std::size_t max_reads) const override;
     
+    // Evidence is taken from CIGARs and the NM and MD tags. Reads with mismatches but no MD tag
+    // contribute their whole mapped region.
+    boost::optional<EvidenceList> extract_variation_evidence(const std::vector<SampleName>& samples,
+                                                             const GenomicRegion& region) const override;
+    
     SampleReadMap fetch_reads(const GenomicRegion& region) const override;
     ReadContainer fetch_reads(const SampleName& sample,
                               const GenomicRegion& region) const override;
     SampleReadMap fetch_reads(const std::vector<SampleName>& samples,
                               const GenomicRegion& region) const override;
+    SampleReadMap fetch_reads(const std::vector<SampleName>& samples,
+                              const GenomicRegion& region,
+                              const ReadPrefilter& prefilter,
+                              boost::optional<unsigned> max_coverage) const override;
     
     GenomicRegion::Size reference_size(const GenomicRegion::ContigName& contig) const override;
     std::vector<GenomicRegion::ContigName> reference_contigs() const override;
     boost::optional<std::vector<GenomicRegion::ContigName>> mapped_contigs() const override;
     
+    struct StreamRecord
+    {
+        SampleName sample;
+        GenomicRegion::Position begin, end; // of the alignment without clipping, as used by the index
+        AlignedRead read;
+    };
+    
+    // Reads the next record with a contig in file order, or none once there are none left. For streams,
+    // which have no index.
+    boost::optional<StreamRecord> read_next();
+    
     void write(const AlignedRead& read);
     void write(const AnnotatedAlignedRead& read);
     
 private:
     using HtsTid = std::int32_t;
+    using SampleId = unsigned; // index into samples_
+    
+    // Maps read group ids to sample ids without constructing strings. The hash seed is chosen when the
+    // header is read so that no two read groups share a slot, so a lookup makes one string comparison.
+    class ReadGroupIndex
+    {
+    public:
+        ReadGroupIndex() = default;
+        
+        ReadGroupIndex(const std::vector<std::pair<ReadGroupIdType, SampleId>>& read_groups);
+        
+        const SampleId* find(const char* read_group) const noexcept; // nullptr if unknown
+        
+    private:
+        struct Slot
+        {
+            ReadGroupIdType read_group;
+            SampleId sample;
+            bool used = false;
+        };
+        
+        std::vector<Slot> slots_;
+        std::uint64_t seed_ = 0;
+        
+        std::size_t slot(const char* read_group) const noexcept;
+    };
     
     static constexpr std::size_t defaultReserve_ {1'000'000};
+    static constexpr GenomicRegion::Size coverageIndexBinSize_ {16'384};
+    
+    // Read start counts for each sample in fixed size bins
+    struct ContigCoverageIndex
+    {
+        std::vector<std::vector<std::uint32_t>> counts; // by SampleId
+        std::vector<bool> is_indexed;
+    };
     
     struct HtsFileDeleter
     {
@@ -125,6 +214,7 @@ private:
         
         HtslibIterator(const HtslibSamFacade& hts_facade, const GenomicRegion& region);
         HtslibIterator(const HtslibSamFacade& hts_facade, const GenomicRegion::ContigName& contig);
+        HtslibIterator(const HtslibSamFacade& hts_facade); // all records in file order, without the index
         
         HtslibIterator(const HtslibIterator&) = delete;
         HtslibIterator& operator=(const HtslibIterator&) = delete;
@@ -134,10 +224,18 @@ private:
         bool operator++();
         AlignedRead operator*() const;
         
+        AlignedRead::Core core() const noexcept;
+        bool passes(const ReadPrefilter& prefilter) const; // checked before decoding the read
+        bool admitted_by(CoverageLimiter& limiter) const; // must be called in iteration order
+        void extract_variation_evidence(EvidenceList& result) const; // without decoding the read
+        
         HtslibSamFacade::ReadGroupIdType read_group() const;
+        SampleId sample() const;
         
         bool is_good() const noexcept;
         std::size_t begin() const noexcept;
+        std::size_t end() const noexcept;
+        std::int32_t contig() const noexcept; // negative if the record has no contig
     
     private:
         struct HtsIteratorDeleter
@@ -156,6 +254,8 @@ private:
     };
     
     Path file_path_;
+    HtslibThreadPool* decompression_threads_;
+    boost::optional<Path> reference_;
     
     std::unique_ptr<htsFile, HtsFileDeleter> hts_file_;
     std::unique_ptr<bam_hdr_t, HtsHeaderDeleter> hts_header_;
@@ -166,12 +266,28 @@ private:
     std::unordered_map<ReadGroupIdType, SampleName> sample_names_;
     
     std::vector<SampleName> samples_;
+    ReadGroupIndex read_group_index_;
+    
+    mutable std::unordered_map<GenomicRegion::ContigName, ContigCoverageIndex> coverage_index_;
+    
+    std::unique_ptr<HtslibIterator> stream_iterator_;
+    
+    bool is_stream() const noexcept;
     
     void init_maps();
+    void init_read_group_index();
+    boost::optional<SampleId> find_sample(const SampleName& sample) const noexcept;
+    std::vector<char> make_sample_mask(const std::vector<SampleName>& samples) const;
+    const ContigCoverageIndex& index_coverage(const GenomicRegion& region) const;
     HtsTid get_htslib_target(const GenomicRegion::ContigName& contig) const;
     const GenomicRegion::ContigName& get_contig_name(HtsTid target) const;
     std::uint64_t get_num_mapped_reads(const GenomicRegion::ContigName& contig) const;
-    ReadContainer fetch_all_reads(const GenomicRegion& region) const;
+    SampleReadMap fetch_reads(const GenomicRegion& region, const ReadPrefilter& prefilter,
+                              boost::optional<unsigned> max_coverage) const;
+    ReadContainer fetch_reads(const SampleName& sample, const GenomicRegion& region,
+                              const ReadPrefilter& prefilter, boost::optional<unsigned> max_coverage) const;
+    ReadContainer fetch_all_reads(const GenomicRegion& region, const ReadPrefilter& prefilter,
+                                  boost::optional<unsigned> max_coverage) const;
     void set_fixed_length_data(const AlignedRead& read, bam1_t* result) const;
     void write(const AlignedRead& read, bam1_t* result) const;
     void write(const AnnotatedAlignedRead& read, bam1_t* result) const;
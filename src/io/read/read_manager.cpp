@@ -8,29 +8,50 @@
 #include <utility>
 #include <deque>
 #include <numeric>
+#include <future>
 #include <cassert>
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <stdexcept>
 
 #include <boost/filesystem/operations.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/classification.hpp>
 
 #include "basics/aligned_read.hpp"
 #include "utils/append.hpp"
 #include "utils/coverage_tracker.hpp"
+#include "utils/thread_pool.hpp"
+#include "utils/path_utils.hpp"
+#include "htslib_sam_facade.hpp"
 
 namespace octopus { namespace io {
 
-ReadManager::ReadManager(std::vector<Path> read_file_paths, unsigned max_open_files)
+ReadManager::ReadManager(std::vector<Path> read_file_paths, unsigned max_open_files, unsigned num_decompression_threads,
+                         unsigned num_fetch_threads, boost::optional<Path> manifest, boost::optional<Path> reference)
 : max_open_files_ {max_open_files}
 , num_files_ {static_cast<unsigned>(read_file_paths.size())}
+, is_streaming_ {std::any_of(std::cbegin(read_file_paths), std::cend(read_file_paths), [] (const auto& path) { return is_stdin(path); })}
+, decompression_threads_ {num_decompression_threads > 0 ? std::make_shared<HtslibThreadPool>(num_decompression_threads) : nullptr}
+, fetch_workers_ {num_fetch_threads > 1 && read_file_paths.size() > 1 ? std::make_shared<ThreadPool>(num_fetch_threads) : nullptr}
+, reference_ {std::move(reference)}
 , closed_readers_ {
     std::make_move_iterator(std::begin(read_file_paths)),
     std::make_move_iterator(std::end(read_file_paths))}
 , open_readers_ {FileSizeCompare {}}
+, idle_readers_ {}
+, last_reader_use_ {}
+, num_reader_uses_ {0}
+, hinted_readers_ {}
 , reader_paths_containing_sample_ {}
 , possible_regions_in_readers_ {}
 , samples_ {}
 {
-    setup_reader_samples_and_regions();
-    open_initial_files();
+    if (is_streaming_ && num_files_ > 1) {
+        throw std::invalid_argument {"ReadManager: a read stream must be the only read file"};
+    }
+    setup_reader_samples_and_regions(manifest);
     samples_.reserve(reader_paths_containing_sample_.size());
     for (const auto& pair : reader_paths_containing_sample_) {
         samples_.emplace_back(pair.first);
@@ -49,8 +70,16 @@ ReadManager::ReadManager(ReadManager&& other)
     using std::move;
     max_open_files_                 = move(other.max_open_files_);
     num_files_                      = move(other.num_files_);
+    is_streaming_                   = move(other.is_streaming_);
+    decompression_threads_          = move(other.decompression_threads_);
+    fetch_workers_                  = move(other.fetch_workers_);
+    reference_                      = std::move(other.reference_);
     closed_readers_                 = move(other.closed_readers_);
     open_readers_                   = move(other.open_readers_);
+    idle_readers_                   = move(other.idle_readers_);
+    last_reader_use_                = move(other.last_reader_use_);
+    num_reader_uses_                = move(other.num_reader_uses_);
+    hinted_readers_                 = move(other.hinted_readers_);
     reader_paths_containing_sample_ = move(other.reader_paths_containing_sample_);
     possible_regions_in_readers_    = move(other.possible_regions_in_readers_);
     samples_                        = move(other.samples_);
@@ -64,8 +93,16 @@ ReadManager& ReadManager::operator=(ReadManager&& other)
         using std::move;
         max_open_files_                 = move(other.max_open_files_);
         num_files_                      = move(other.num_files_);
+        is_streaming_                   = move(other.is_streaming_);
         closed_readers_                 = move(other.closed_readers_);
         open_readers_                   = move(other.open_readers_);
+        idle_readers_                   = move(other.idle_readers_);
+        last_reader_use_                = move(other.last_reader_use_);
+        num_reader_uses_                = move(other.num_reader_uses_);
+        hinted_readers_                 = move(other.hinted_readers_);
+        decompression_threads_          = move(other.decompression_threads_); // after the readers it served are closed
+        fetch_workers_                  = move(other.fetch_workers_);
+        reference_                      = std::move(other.reference_);
         reader_paths_containing_sample_ = move(other.reader_paths_containing_sample_);
         possible_regions_in_readers_    = move(other.possible_regions_in_readers_);
         samples_                        = move(other.samples_);
@@ -81,8 +118,16 @@ void swap(ReadManager& lhs, ReadManager& rhs) noexcept
     using std::swap;
     swap(lhs.max_open_files_,                 rhs.max_open_files_);
     swap(lhs.num_files_,                      rhs.num_files_);
+    swap(lhs.is_streaming_,                   rhs.is_streaming_);
+    swap(lhs.decompression_threads_,          rhs.decompression_threads_);
+    swap(lhs.fetch_workers_,                  rhs.fetch_workers_);
+    swap(lhs.reference_,                      rhs.reference_);
     swap(lhs.closed_readers_,                 rhs.closed_readers_);
     swap(lhs.open_readers_,                   rhs.open_readers_);
+    swap(lhs.idle_readers_,                   rhs.idle_readers_);
+    swap(lhs.last_reader_use_,                rhs.last_reader_use_);
+    swap(lhs.num_reader_uses_,                rhs.num_reader_uses_);
+    swap(lhs.hinted_readers_,                 rhs.hinted_readers_);
     swap(lhs.reader_paths_containing_sample_, rhs.reader_paths_containing_sample_);
     swap(lhs.possible_regions_in_readers_,    rhs.possible_regions_in_readers_);
     swap(lhs.samples_,                        rhs.samples_);
@@ -92,6 +137,7 @@ void ReadManager::close() const noexcept
 {
     std::lock_guard<std::mutex> lock {mutex_};
     close_readers(num_files_);
+    idle_readers_.clear();
 }
 
 bool ReadManager::good() const noexcept
@@ -130,6 +176,11 @@ const std::vector<ReadManager::SampleName>& ReadManager::samples() const
     return samples_;
 }
 
+bool ReadManager::is_streaming() const noexcept
+{
+    return is_streaming_;
+}
+
 unsigned ReadManager::drop_samples(std::vector<SampleName> samples)
 {
     std::sort(std::begin(samples), std::end(samples));
@@ -282,6 +333,90 @@ std::size_t ReadManager::count_reads(const GenomicRegion& region) const
     return count_reads(samples(), region);
 }
 
+std::size_t ReadManager::estimate_read_count(const std::vector<SampleName>& samples, const GenomicRegion& region) const
+{
+    if (all_readers_are_open()) {
+        return std::accumulate(std::cbegin(open_readers_), std::cend(open_readers_), std::size_t {0},
+                               [&] (std::size_t curr, const auto& p) {
+                                   return curr + p.second.estimate_read_count(samples, region);
+                               });
+    } else {
+        std::lock_guard<std::mutex> lock {mutex_};
+        auto reader_paths = get_possible_reader_paths(samples, region);
+        auto reader_itr = partition_open(reader_paths);
+        std::size_t result {0};
+        while (!reader_paths.empty()) {
+            using std::begin; using std::end; using std::for_each;
+            for_each(reader_itr, end(reader_paths), [this, &samples, &region, &result] (const auto& reader_path) {
+                result += open_readers_.at(reader_path).estimate_read_count(samples, region);
+            });
+            reader_paths.erase(reader_itr, end(reader_paths));
+            reader_itr = open_readers(begin(reader_paths), end(reader_paths));
+        }
+        return result;
+    }
+}
+
+namespace {
+
+bool has_min_depth(const ReadReader::EvidenceList& evidence, const unsigned min_depth)
+{
+    if (evidence.size() < min_depth) return false;
+    std::vector<ContigRegion::Position> begins(evidence.size()), ends(evidence.size());
+    std::transform(std::cbegin(evidence), std::cend(evidence), std::begin(begins), [] (const auto& region) { return region.begin(); });
+    std::transform(std::cbegin(evidence), std::cend(evidence), std::begin(ends), [] (const auto& region) { return region.end(); });
+    std::sort(std::begin(begins), std::end(begins));
+    std::sort(std::begin(ends), std::end(ends));
+    std::size_t num_ended {0};
+    for (std::size_t i {0}; i < begins.size(); ++i) {
+        while (ends[num_ended] <= begins[i]) ++num_ended;
+        if (i + 1 - num_ended >= min_depth) return true;
+    }
+    return false;
+}
+
+} // namespace
+
+bool ReadManager::has_variation_evidence(const std::vector<SampleName>& samples, const GenomicRegion& region,
+                                         const unsigned min_support) const
+{
+    const auto evidence = extract_variation_evidence(samples, region);
+    return !evidence || has_min_depth(*evidence, min_support);
+}
+
+boost::optional<ReadManager::EvidenceList>
+ReadManager::extract_variation_evidence(const std::vector<SampleName>& samples, const GenomicRegion& region) const
+{
+    EvidenceList evidence {};
+    bool is_unknown {false};
+    const auto add_evidence = [&] (const ReadReader& reader) {
+        if (is_unknown) return;
+        auto reader_evidence = reader.extract_variation_evidence(samples, region);
+        if (reader_evidence) {
+            utils::append(std::move(*reader_evidence), evidence);
+        } else {
+            is_unknown = true;
+        }
+    };
+    if (all_readers_are_open()) {
+        for (const auto& p : open_readers_) add_evidence(p.second);
+    } else {
+        std::lock_guard<std::mutex> lock {mutex_};
+        auto reader_paths = get_possible_reader_paths(samples, region);
+        auto reader_itr = partition_open(reader_paths);
+        while (!reader_paths.empty()) {
+            using std::begin; using std::end; using std::for_each;
+            for_each(reader_itr, end(reader_paths), [&] (const auto& reader_path) {
+                add_evidence(open_readers_.at(reader_path));
+            });
+            reader_paths.erase(reader_itr, end(reader_paths));
+            reader_itr = open_readers(begin(reader_paths), end(reader_paths));
+        }
+    }
+    if (is_unknown) return boost::none;
+    return evidence;
+}
+
 GenomicRegion ReadManager::find_covered_subregion(const SampleName& sample, const GenomicRegion& region,
                                                   const std::size_t max_reads) const
 {
@@ -330,6 +465,9 @@ GenomicRegion ReadManager::find_covered_subregion(const std::vector<SampleName>&
                                                   const std::size_t max_reads) const
 {
     if (samples.empty() || is_empty(region)) return region;
+    // Estimates count reads starting in whole index bins, so a comfortable margin means the entire
+    // region fits without extracting positions
+    if (estimate_read_count(samples, region) <= max_reads / 2) return region;
     CoverageTracker<ContigRegion> position_tracker {};
     if (all_readers_are_open()) {
         for (const auto& p : open_readers_) {
@@ -388,6 +526,7 @@ ReadManager::ReadContainer ReadManager::fetch_reads(const SampleName& sample, co
         while (!reader_paths.empty()) {
             using std::begin; using std::end; using std::make_move_iterator; using std::for_each;
             for_each(reader_itr, end(reader_paths), [&] (const auto& reader_path) {
+                mark_used(reader_path);
                 merge_insert(open_readers_.at(reader_path).fetch_reads(sample, region), result);
             });
             reader_paths.erase(reader_itr, end(reader_paths));
@@ -398,35 +537,44 @@ ReadManager::ReadContainer ReadManager::fetch_reads(const SampleName& sample, co
 }
 
 ReadManager::SampleReadMap ReadManager::fetch_reads(const std::vector<SampleName>& samples, const GenomicRegion& region) const
+{
+    return fetch_reads(samples, region, ReadPrefilter {});
+}
+
+ReadManager::SampleReadMap ReadManager::fetch_reads(const GenomicRegion& region) const
+{
+    return fetch_reads(samples(), region);
+}
+
+ReadManager::SampleReadMap ReadManager::fetch_reads(const std::vector<SampleName>& samples, const GenomicRegion& region,
+                                                    const ReadPrefilter& prefilter,
+                                                    const boost::optional<unsigned> max_coverage) const
 {
     SampleReadMap result {samples.size()};
     // Populate here so we can make unchecked access
     for (const auto& sample : samples) {
         result.emplace(std::piecewise_construct, std::forward_as_tuple(sample), std::forward_as_tuple());
     }
+    std::vector<const ReadReader*> readers {};
     if (all_readers_are_open()) {
+        readers.reserve(open_readers_.size());
         for (const auto& p : open_readers_) {
-            auto reads = p.second.fetch_reads(samples, region);
-            for (auto&& r : reads) {
-                merge_insert(std::move(r.second), result.at(r.first));
-                r.second.clear();
-                r.second.shrink_to_fit();
-            }
+            readers.push_back(&p.second);
         }
+        fetch_reads(readers, samples, region, prefilter, max_coverage, result);
     } else {
         std::lock_guard<std::mutex> lock {mutex_};
         auto reader_paths = get_possible_reader_paths(samples, region);
         auto reader_itr = partition_open(reader_paths);
         while (!reader_paths.empty()) {
-            using std::begin; using std::end; using std::make_move_iterator; using std::for_each;
-            for_each(reader_itr, end(reader_paths), [&] (const auto& reader_path) {
-                auto reads = open_readers_.at(reader_path).fetch_reads(samples, region);
-                for (auto&& r : reads) {
-                    merge_insert(std::move(r.second), result.at(r.first));
-                    r.second.clear();
-                    r.second.shrink_to_fit();
-                }
-            });
+            using std::begin; using std::end;
+            readers.clear();
+            std::transform(reader_itr, end(reader_paths), std::back_inserter(readers),
+                           [this] (const auto& reader_path) {
+                               mark_used(reader_path);
+                               return &open_readers_.at(reader_path);
+                           });
+            fetch_reads(readers, samples, region, prefilter, max_coverage, result);
             reader_paths.erase(reader_itr, end(reader_paths));
             reader_itr = open_readers(begin(reader_paths), end(reader_paths));
         }
@@ -434,15 +582,33 @@ ReadManager::SampleReadMap ReadManager::fetch_reads(const std::vector<SampleName
     return result;
 }
 
-ReadManager::SampleReadMap ReadManager::fetch_reads(const GenomicRegion& region) const
+void ReadManager::hint(const std::vector<GenomicRegion>& regions) const
 {
-    return fetch_reads(samples(), region);
+    if (is_streaming_) {
+        // The stream is never closed, so needs no reader hints, but uses them to decide which reads to keep
+        for (const auto& p : open_readers_) p.second.hint(regions);
+        return;
+    }
+    if (all_readers_are_open()) return; // nothing will be closed
+    // Doesn't take mutex_ so callers are not blocked by fetches
+    ClosedReaderSet hinted_readers {};
+    for (const auto& p : possible_regions_in_readers_) {
+        if (std::any_of(std::cbegin(regions), std::cend(regions),
+                        [&] (const auto& region) { return could_reader_contain_region(p.first, region); })) {
+            hinted_readers.insert(p.first);
+        }
+    }
+    std::lock_guard<std::mutex> lock {hint_mutex_};
+    hinted_readers_ = std::move(hinted_readers);
 }
 
 // Private methods
 
+// Remote files cannot be sized cheaply, so order after all local files
 bool ReadManager::FileSizeCompare::operator()(const Path& lhs, const Path& rhs) const
 {
+    const bool lhs_remote {is_url(lhs) || is_stdin(lhs)}, rhs_remote {is_url(rhs) || is_stdin(rhs)};
+    if (lhs_remote || rhs_remote) return lhs_remote && rhs_remote ? lhs < rhs : rhs_remote;
     return boost::filesystem::file_size(lhs) < boost::filesystem::file_size(rhs);
 }
 
@@ -461,38 +627,186 @@ auto extract_spanning_regions(std::vector<GenomicRegion::ContigName> contigs,
 
 } // namespace
 
-void ReadManager::setup_reader_samples_and_regions()
+namespace {
+
+struct ManifestEntry
+{
+    std::uintmax_t file_size;
+    std::time_t last_write_time;
+    std::vector<ReadManager::SampleName> samples;
+    std::vector<GenomicRegion> regions;
+};
+
+using Manifest = std::unordered_map<std::string, ManifestEntry>;
+
+constexpr const char* manifest_magic {"octopus_read_manifest_v1"};
+
+// Lines are tab separated: 'F path size mtime' starts an entry, followed by 'S sample' and 'R contig begin end' lines
+Manifest read_manifest(const boost::filesystem::path& path)
+{
+    Manifest result {};
+    std::ifstream file {path.string()};
+    std::string line {};
+    if (!std::getline(file, line) || line != manifest_magic) return result;
+    ManifestEntry* entry {nullptr};
+    while (std::getline(file, line)) {
+        std::vector<std::string> fields {};
+        boost::split(fields, line, boost::is_any_of("\t"));
+        try {
+            if (fields.size() == 4 && fields[0] == "F") {
+                entry = &result[fields[1]];
+                entry->file_size = std::stoull(fields[2]);
+                entry->last_write_time = static_cast<std::time_t>(std::stoll(fields[3]));
+            } else if (entry && fields.size() == 2 && fields[0] == "S") {
+                entry->samples.push_back(fields[1]);
+            } else if (entry && fields.size() == 4 && fields[0] == "R") {
+                entry->regions.emplace_back(fields[1], std::stoul(fields[2]), std::stoul(fields[3]));
+            } else {
+                return {}; // corrupt, so rebuild it all
+            }
+        } catch (const std::exception&) {
+            return {};
+        }
+    }
+    return result;
+}
+
+void write_manifest(const std::vector<ReadManager::Path>& paths, const std::vector<ManifestEntry>& entries,
+                    const boost::filesystem::path& path)
 {
-    for (const auto& reader_path : closed_readers_) {
-        auto reader = make_reader(reader_path);
-        auto possible_reader_regions = reader.mapped_regions();
-        if (possible_reader_regions) {
-            add_possible_regions_to_reader_map(reader_path, *possible_reader_regions);
+    const auto temp_path = path.string() + ".tmp";
+    {
+        std::ofstream file {temp_path};
+        file << manifest_magic << '\n';
+        for (std::size_t i {0}; i < paths.size(); ++i) {
+            const auto& entry = entries[i];
+            file << "F\t" << paths[i].string() << '\t' << entry.file_size << '\t' << entry.last_write_time << '\n';
+            for (const auto& sample : entry.samples) file << "S\t" << sample << '\n';
+            for (const auto& region : entry.regions) {
+                file << "R\t" << region.contig_name() << '\t' << region.begin() << '\t' << region.end() << '\n';
+            }
+        }
+        if (!file) {
+            boost::system::error_code ec {};
+            boost::filesystem::remove(temp_path, ec);
+            return;
+        }
+    }
+    boost::system::error_code ec {};
+    boost::filesystem::rename(temp_path, path, ec);
+}
+
+bool is_current(const ManifestEntry& entry, const ReadManager::Path& path)
+{
+    if (is_url(path)) return true; // remote objects are assumed immutable
+    boost::system::error_code ec {};
+    const auto file_size = boost::filesystem::file_size(path, ec);
+    if (ec || file_size != entry.file_size) return false;
+    const auto last_write_time = boost::filesystem::last_write_time(path, ec);
+    return !ec && last_write_time == entry.last_write_time;
+}
+
+auto make_manifest_entry(const ReadManager::Path& path, const ReadReader& reader)
+{
+    ManifestEntry result {};
+    if (!is_url(path) && !is_stdin(path)) {
+        result.file_size = boost::filesystem::file_size(path);
+        result.last_write_time = boost::filesystem::last_write_time(path);
+    }
+    auto possible_reader_regions = reader.mapped_regions();
+    if (possible_reader_regions) {
+        result.regions = std::move(*possible_reader_regions);
+    } else {
+        auto possible_reader_contigs = reader.mapped_contigs();
+        if (possible_reader_contigs) {
+            result.regions = extract_spanning_regions(std::move(*possible_reader_contigs), reader);
         } else {
-            auto possible_reader_contigs = reader.mapped_contigs();
-            if (possible_reader_contigs) {
-                add_possible_regions_to_reader_map(reader_path, extract_spanning_regions(*possible_reader_contigs, reader));
+            result.regions = extract_spanning_regions(reader.reference_contigs(), reader);
+        }
+    }
+    result.samples = reader.extract_samples();
+    return result;
+}
+
+} // namespace
+
+// Headers are parsed concurrently. The readers that would be opened first anyway are kept open rather
+// than opened twice. Files with a current manifest entry are otherwise not opened, so their indices
+// are not loaded until they are first fetched from.
+void ReadManager::setup_reader_samples_and_regions(const boost::optional<Path>& manifest_path)
+{
+    std::vector<Path> reader_paths {std::cbegin(closed_readers_), std::cend(closed_readers_)};
+    const auto num_initial_readers = std::min(max_open_files_, static_cast<unsigned>(reader_paths.size()));
+    std::nth_element(std::begin(reader_paths), std::next(std::begin(reader_paths), num_initial_readers),
+                     std::end(reader_paths), FileSizeCompare {});
+    const auto manifest = manifest_path ? read_manifest(*manifest_path) : Manifest {};
+    std::vector<ManifestEntry> entries(reader_paths.size());
+    std::vector<char> is_new_entry(reader_paths.size(), false);
+    std::vector<std::unique_ptr<ReadReader>> initial_readers(num_initial_readers);
+    parallel_for(fetch_workers_.get(), reader_paths.size(), [&] (const std::size_t i) {
+        const auto& path = reader_paths[i];
+        const auto manifest_itr = manifest.find(path.string());
+        const bool is_cached {manifest_itr != std::cend(manifest) && !is_stdin(path) && is_current(manifest_itr->second, path)};
+        if (i < num_initial_readers || !is_cached) {
+            auto reader = make_reader(path);
+            if (is_cached) {
+                entries[i] = manifest_itr->second;
             } else {
-                add_possible_regions_to_reader_map(reader_path, extract_spanning_regions(reader.reference_contigs(), reader));
+                entries[i] = make_manifest_entry(path, reader);
+                is_new_entry[i] = true;
             }
+            if (i < num_initial_readers) {
+                initial_readers[i] = std::make_unique<ReadReader>(std::move(reader));
+            }
+        } else {
+            entries[i] = manifest_itr->second;
         }
-        add_reader_to_sample_map(reader_path, reader.extract_samples());
+    });
+    for (std::size_t i {0}; i < reader_paths.size(); ++i) {
+        add_possible_regions_to_reader_map(reader_paths[i], entries[i].regions);
+        add_reader_to_sample_map(reader_paths[i], entries[i].samples);
+    }
+    for (unsigned i {0}; i < num_initial_readers; ++i) {
+        open_readers_.emplace(reader_paths[i], std::move(*initial_readers[i]));
+        closed_readers_.erase(reader_paths[i]);
+    }
+    if (manifest_path && std::find(std::cbegin(is_new_entry), std::cend(is_new_entry), true) != std::cend(is_new_entry)) {
+        write_manifest(reader_paths, entries, *manifest_path);
     }
 }
 
-void ReadManager::open_initial_files()
+ReadReader ReadManager::make_reader(const Path& reader_path) const
 {
-    using std::begin; using std::end; using std::cbegin; using std::cend;
-    std::vector<Path> reader_paths {cbegin(closed_readers_), cend(closed_readers_)};
-    auto num_files_to_open = std::min(max_open_files_, static_cast<unsigned>(closed_readers_.size()));
-    std::nth_element(begin(reader_paths), begin(reader_paths) + num_files_to_open, end(reader_paths),
-                     FileSizeCompare {});
-    open_readers(begin(reader_paths), begin(reader_paths) + num_files_to_open);
+    return ReadReader {reader_path, decompression_threads_.get(), reference_};
 }
 
-ReadReader ReadManager::make_reader(const Path& reader_path) const
+void ReadManager::fetch_reads(const std::vector<const ReadReader*>& readers, const std::vector<SampleName>& samples,
+                              const GenomicRegion& region, const ReadPrefilter& prefilter,
+                              const boost::optional<unsigned> max_coverage, SampleReadMap& result) const
 {
-    return ReadReader {reader_path};
+    const auto merge = [&result] (SampleReadMap&& reads) {
+        for (auto&& r : reads) {
+            merge_insert(std::move(r.second), result.at(r.first));
+            r.second.clear();
+            r.second.shrink_to_fit();
+        }
+    };
+    if (fetch_workers_ && readers.size() > 1) {
+        // Each reader has its own lock so independent files can be read concurrently
+        std::vector<std::future<SampleReadMap>> fetches {};
+        fetches.reserve(readers.size());
+        for (const auto reader : readers) {
+            fetches.push_back(fetch_workers_->push([reader, &samples, &region, &prefilter, max_coverage] () {
+                return reader->fetch_reads(samples, region, prefilter, max_coverage); }));
+        }
+        for (auto& fetch : fetches) fetch.wait(); // the tasks reference our arguments, so can't leave early
+        // Merge in reader order so the result does not depend on scheduling
+        for (auto& fetch : fetches) merge(fetch.get());
+    } else {
+        for (const auto reader : readers) {
+            merge(reader->fetch_reads(samples, region, prefilter, max_coverage));
+        }
+    }
 }
 
 bool ReadManager::all_readers_are_open() const noexcept
@@ -522,12 +836,34 @@ unsigned ReadManager::num_reader_spaces() const noexcept
     return max_open_files_ - num_open_readers();
 }
 
+void ReadManager::mark_used(const Path& reader_path) const
+{
+    last_reader_use_[reader_path] = ++num_reader_uses_;
+}
+
+std::uint64_t ReadManager::last_use(const Path& reader_path) const noexcept
+{
+    const auto itr = last_reader_use_.find(reader_path);
+    return itr != std::cend(last_reader_use_) ? itr->second : 0;
+}
+
 void ReadManager::open_reader(const Path& reader_path) const
 {
     if (num_open_readers() == max_open_files_) { // do we need this?
         close_reader(choose_reader_to_close());
     }
-    open_readers_.emplace(reader_path, make_reader(reader_path));
+    const auto idle_itr = idle_readers_.find(reader_path);
+    if (idle_itr != std::end(idle_readers_)) {
+        idle_itr->second.open();
+        if (idle_itr->second.is_open()) {
+            open_readers_.emplace(reader_path, std::move(idle_itr->second));
+        } else {
+            open_readers_.emplace(reader_path, make_reader(reader_path)); // reports the error
+        }
+        idle_readers_.erase(idle_itr);
+    } else {
+        open_readers_.emplace(reader_path, make_reader(reader_path));
+    }
     closed_readers_.erase(reader_path);
 }
 
@@ -561,19 +897,42 @@ void ReadManager::open_readers(unsigned n) const
 
 void ReadManager::close_reader(const Path& reader_path) const
 {
-    // TODO: we can make use of IReadReaderImpl::close to avoid calling deconstructor on the file.
-    open_readers_.erase(reader_path);
+    const auto itr = open_readers_.find(reader_path);
+    if (itr == std::end(open_readers_)) return;
+    itr->second.close(); // releases the file handle, but may keep the header and index
+    idle_readers_.emplace(reader_path, std::move(itr->second));
+    open_readers_.erase(itr);
     closed_readers_.insert(reader_path);
+    // Retained indices can be large, so keep no more than we keep open
+    if (idle_readers_.size() > max_open_files_) {
+        const auto lru_itr = std::min_element(std::cbegin(idle_readers_), std::cend(idle_readers_),
+                                              [this] (const auto& lhs, const auto& rhs) {
+                                                  return last_use(lhs.first) < last_use(rhs.first); });
+        idle_readers_.erase(lru_itr);
+    }
 }
 
 ReadManager::Path ReadManager::choose_reader_to_close() const
 {
-    return open_readers_.begin()->first; // i.e. smallest file size
+    assert(!open_readers_.empty());
+    std::lock_guard<std::mutex> lock {hint_mutex_};
+    // Prefer readers that are not hinted, then local files as remote ones are costly to reopen,
+    // then the least recently used
+    const auto itr = std::min_element(std::cbegin(open_readers_), std::cend(open_readers_),
+                                      [this] (const auto& lhs, const auto& rhs) {
+                                          const bool lhs_hinted {hinted_readers_.count(lhs.first) == 1};
+                                          const bool rhs_hinted {hinted_readers_.count(rhs.first) == 1};
+                                          if (lhs_hinted != rhs_hinted) return rhs_hinted;
+                                          const bool lhs_remote {is_url(lhs.first)}, rhs_remote {is_url(rhs.first)};
+                                          if (lhs_remote != rhs_remote) return rhs_remote;
+                                          return last_use(lhs.first) < last_use(rhs.first);
+                                      });
+    return itr->first;
 }
 
 void ReadManager::close_readers(unsigned n) const
 {
-    for (; n > 0; --n) {
+    for (; n > 0 && !open_readers_.empty(); --n) {
         close_reader(choose_reader_to_close());
     }
 }
@@ -10,9 +10,12 @@
 #include <unordered_set>
 #include <initializer_list>
 #include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <mutex>
 
 #include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
 
 #include "basics/contig_region.hpp"
 #include "basics/genomic_region.hpp"
@@ -24,9 +27,12 @@
 namespace octopus {
 
 class AlignedRead;
+class ThreadPool;
 
 namespace io {
 
+class HtslibThreadPool;
+
 class ReadManager
 {
 public:
@@ -35,10 +41,21 @@ public:
     using SampleName    = IReadReaderImpl::SampleName;
     using ReadContainer = IReadReaderImpl::ReadContainer;
     using SampleReadMap = IReadReaderImpl::SampleReadMap;
+    using ReadPrefilter = IReadReaderImpl::ReadPrefilter;
+    using EvidenceList  = IReadReaderImpl::EvidenceList;
     
     ReadManager() = default;
     
-    ReadManager(std::vector<Path> read_file_paths, unsigned max_open_files);
+    // Decompression threads are shared by all opened readers. Fetch threads are used to fetch reads from
+    // multiple files concurrently, and to parse file headers concurrently on construction. If a manifest
+    // is given, the samples and regions of files unchanged since it was written are read from it rather
+    // than from the files, and it is rewritten if any file is new or has changed. Remote (URL) files are
+    // assumed not to change, and are kept open in preference to local files. If a reference is given,
+    // CRAM files are decoded with it rather than the reference named in their headers. A path of "-" reads
+    // a coordinate sorted stream on the standard input, which must then be the only read file.
+    ReadManager(std::vector<Path> read_file_paths, unsigned max_open_files, unsigned num_decompression_threads = 0,
+                unsigned num_fetch_threads = 0, boost::optional<Path> manifest = boost::none,
+                boost::optional<Path> reference = boost::none);
     ReadManager(std::initializer_list<Path> read_file_paths);
     
     ReadManager(const ReadManager&)            = delete;
@@ -57,6 +74,9 @@ public:
     unsigned num_samples() const noexcept;
     const std::vector<SampleName>& samples() const;
     unsigned drop_samples(std::vector<SampleName> samples);
+    // True if reads are streamed, so must be fetched in coordinate order and can't be fetched again
+    // once the stream has moved on (see SamStreamReader)
+    bool is_streaming() const noexcept;
     
     bool has_reads(const SampleName& sample, const GenomicRegion& region) const;
     bool has_reads(const std::vector<SampleName>& samples, const GenomicRegion& region) const;
@@ -66,6 +86,17 @@ public:
     std::size_t count_reads(const std::vector<SampleName>& samples, const GenomicRegion& region) const;
     std::size_t count_reads(const GenomicRegion& region) const;
     
+    // Approximate, but usually answered from the readers' coverage indices without reading records
+    std::size_t estimate_read_count(const std::vector<SampleName>& samples, const GenomicRegion& region) const;
+    
+    // False only if no position is covered by min_support reads in region with a mismatch, indel, or clip.
+    // Reads are not decoded, so this is much cheaper than fetching.
+    bool has_variation_evidence(const std::vector<SampleName>& samples, const GenomicRegion& region,
+                                unsigned min_support) const;
+    // The regions of reads in region with a mismatch, indel, or clip, or none if any reader can't tell
+    boost::optional<EvidenceList> extract_variation_evidence(const std::vector<SampleName>& samples,
+                                                             const GenomicRegion& region) const;
+    
     GenomicRegion find_covered_subregion(const SampleName& sample, const GenomicRegion& region,
                                          std::size_t max_reads) const;
     GenomicRegion find_covered_subregion(const std::vector<SampleName>& samples, const GenomicRegion& region,
@@ -75,6 +106,16 @@ public:
     ReadContainer fetch_reads(const SampleName& sample,  const GenomicRegion& region) const;
     SampleReadMap fetch_reads(const std::vector<SampleName>& samples, const GenomicRegion& region) const;
     SampleReadMap fetch_reads(const GenomicRegion& region) const;
+    // Reads failing prefilter may be discarded before they are fully decoded. If max_coverage is given,
+    // reads are dropped as they are read so that each sample has at most max_coverage overlapping reads
+    // at any position in each file.
+    SampleReadMap fetch_reads(const std::vector<SampleName>& samples, const GenomicRegion& region,
+                              const ReadPrefilter& prefilter,
+                              boost::optional<unsigned> max_coverage = boost::none) const;
+    
+    // Hints are regions that will likely be fetched soon. Readers that could contain hinted regions are
+    // kept open in preference to others when files must be closed. This does not change observable behaviour.
+    void hint(const std::vector<GenomicRegion>& regions) const;
     
 private:
     using PathHash = octopus::utils::FilepathHash;
@@ -89,25 +130,42 @@ private:
     using SampleIdToReaderPathMap = std::unordered_map<SampleName, std::vector<Path>>;
     using ContigMap               = MappableMap<GenomicRegion::ContigName, ContigRegion>;
     using ReaderRegionsMap        = std::unordered_map<Path, ContigMap, PathHash>;
+    using IdleReaderMap           = std::unordered_map<Path, ReadReader, PathHash>;
+    using ReaderUseMap            = std::unordered_map<Path, std::uint64_t, PathHash>;
     
     unsigned max_open_files_ = 200;
     unsigned num_files_;
+    bool is_streaming_;
+    
+    // Must be declared before the readers so it outlives them
+    std::shared_ptr<HtslibThreadPool> decompression_threads_;
+    std::shared_ptr<ThreadPool> fetch_workers_;
+    boost::optional<Path> reference_;
     
     mutable ClosedReaderSet closed_readers_;
     mutable OpenReaderMap open_readers_;
+    // Closed readers that keep their parsed header and index so reopening is cheap
+    mutable IdleReaderMap idle_readers_;
+    mutable ReaderUseMap last_reader_use_;
+    mutable std::uint64_t num_reader_uses_;
+    mutable ClosedReaderSet hinted_readers_;
     
     SampleIdToReaderPathMap reader_paths_containing_sample_;
     ReaderRegionsMap possible_regions_in_readers_;
     std::vector<SampleName> samples_;
     
-    mutable std::mutex mutex_;
+    mutable std::mutex mutex_, hint_mutex_;
     
-    void setup_reader_samples_and_regions();
-    void open_initial_files();
+    void setup_reader_samples_and_regions(const boost::optional<Path>& manifest_path);
     
     ReadReader make_reader(const Path& reader_path) const;
+    void fetch_reads(const std::vector<const ReadReader*>& readers, const std::vector<SampleName>& samples,
+                     const GenomicRegion& region, const ReadPrefilter& prefilter,
+                     boost::optional<unsigned> max_coverage, SampleReadMap& result) const;
     bool all_readers_are_open() const noexcept;
     bool is_open(const Path& reader_path) const noexcept;
+    void mark_used(const Path& reader_path) const;
+    std::uint64_t last_use(const Path& reader_path) const noexcept;
     std::vector<Path>::iterator partition_open(std::vector<Path>& reader_paths) const;
     unsigned num_open_readers() const noexcept;
     unsigned num_reader_spaces() const noexcept;
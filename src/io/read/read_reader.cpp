@@ -9,7 +9,9 @@
 #include <iterator>
 #include <algorithm>
 
+#include "utils/path_utils.hpp"
 #include "htslib_sam_facade.hpp"
+#include "sam_stream_reader.hpp"
 #include "exceptions/user_error.hpp"
 
 namespace octopus { namespace io {
@@ -67,19 +69,25 @@ bool is_valid_read_file_type(const boost::filesystem::path& file_path)
     return includes(validReadFileExtensions, get_extension(file_path));
 }
 
-auto make_reader(const boost::filesystem::path& file_path)
+std::unique_ptr<IReadReaderImpl>
+make_reader(const boost::filesystem::path& file_path, HtslibThreadPool* decompression_threads,
+            boost::optional<boost::filesystem::path> reference)
 {
+    if (is_stdin(file_path)) {
+        return std::make_unique<SamStreamReader>(file_path, decompression_threads, std::move(reference));
+    }
     if (!is_valid_read_file_type(file_path)) {
         throw UnknownReadFileFormat {file_path};
     }
-    return std::make_unique<HtslibSamFacade>(file_path);
+    return std::make_unique<HtslibSamFacade>(file_path, decompression_threads, std::move(reference));
 }
 
 } //namespace
 
-ReadReader::ReadReader(const boost::filesystem::path& file_path)
+ReadReader::ReadReader(const boost::filesystem::path& file_path, HtslibThreadPool* decompression_threads,
+                       boost::optional<boost::filesystem::path> reference)
 : file_path_ {file_path}
-, impl_ {make_reader(file_path_)}
+, impl_ {make_reader(file_path_, decompression_threads, std::move(reference))}
 {}
 
 ReadReader::ReadReader(ReadReader&& other)
@@ -195,6 +203,12 @@ std::size_t ReadReader::count_reads(const std::vector<SampleName>& samples, cons
     return impl_->count_reads(samples, region);
 }
 
+std::size_t ReadReader::estimate_read_count(const std::vector<SampleName>& samples, const GenomicRegion& region) const
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    return impl_->estimate_read_count(samples, region);
+}
+
 ReadReader::PositionList
 ReadReader::extract_read_positions(const GenomicRegion& region, std::size_t max_coverage) const
 {
@@ -218,6 +232,13 @@ ReadReader::extract_read_positions(const std::vector<SampleName>& samples,
     return impl_->extract_read_positions(samples, region, max_coverage);
 }
 
+boost::optional<ReadReader::EvidenceList>
+ReadReader::extract_variation_evidence(const std::vector<SampleName>& samples, const GenomicRegion& region) const
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    return impl_->extract_variation_evidence(samples, region);
+}
+
 ReadReader::SampleReadMap ReadReader::fetch_reads(const GenomicRegion& region) const
 {
     std::lock_guard<std::mutex> lock {mutex_};
@@ -237,6 +258,21 @@ ReadReader::SampleReadMap ReadReader::fetch_reads(const std::vector<SampleName>&
     return impl_->fetch_reads(samples, region);
 }
 
+ReadReader::SampleReadMap ReadReader::fetch_reads(const std::vector<SampleName>& samples,
+                                                  const GenomicRegion& region,
+                                                  const ReadPrefilter& prefilter,
+                                                  const boost::optional<unsigned> max_coverage) const
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    return impl_->fetch_reads(samples, region, prefilter, max_coverage);
+}
+
+void ReadReader::hint(const std::vector<GenomicRegion>& regions) const
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    impl_->hint(regions);
+}
+
 bool operator==(const ReadReader& lhs, const ReadReader& rhs)
 {
     return lhs.path() == rhs.path();
@@ -24,6 +24,8 @@ class AlignedRead;
 
 namespace io {
 
+class HtslibThreadPool;
+
 /*
  ReadReader is a simple RAII threadsafe wrapper around a IReadReaderImpl
  */
@@ -36,10 +38,13 @@ public:
     using ReadContainer   = IReadReaderImpl::ReadContainer;
     using SampleReadMap   = IReadReaderImpl::SampleReadMap;
     using PositionList    = IReadReaderImpl::PositionList;
+    using EvidenceList    = IReadReaderImpl::EvidenceList;
+    using ReadPrefilter   = IReadReaderImpl::ReadPrefilter;
     
     ReadReader() = default;
     
-    ReadReader(const Path& file_path);
+    ReadReader(const Path& file_path, HtslibThreadPool* decompression_threads = nullptr,
+               boost::optional<Path> reference = boost::none);
     
     ReadReader(const ReadReader&)            = delete;
     ReadReader& operator=(const ReadReader&) = delete;
@@ -76,6 +81,8 @@ public:
                             const GenomicRegion& region) const;
     std::size_t count_reads(const std::vector<SampleName>& samples,
                             const GenomicRegion& region) const;
+    std::size_t estimate_read_count(const std::vector<SampleName>& samples,
+                                    const GenomicRegion& region) const;
     
     PositionList extract_read_positions(const GenomicRegion& region,
                                         std::size_t max_coverage) const;
@@ -86,11 +93,20 @@ public:
                                         const GenomicRegion& region,
                                         std::size_t max_coverage) const;
     
+    boost::optional<EvidenceList> extract_variation_evidence(const std::vector<SampleName>& samples,
+                                                             const GenomicRegion& region) const;
+    
     SampleReadMap fetch_reads(const GenomicRegion& region) const;
     ReadContainer fetch_reads(const SampleName& sample,
                               const GenomicRegion& region) const;
     SampleReadMap fetch_reads(const std::vector<SampleName>& samples,
                               const GenomicRegion& region) const;
+    SampleReadMap fetch_reads(const std::vector<SampleName>& samples,
+                              const GenomicRegion& region,
+                              const ReadPrefilter& prefilter,
+                              boost::optional<unsigned> max_coverage = boost::none) const;
+    
+    void hint(const std::vector<GenomicRegion>& regions) const;
     
 private:
     Path file_path_;
@@ -9,11 +9,16 @@
 #include <cstddef>
 #include <unordered_map>
 #include <utility>
+#include <functional>
+#include <algorithm>
+#include <iterator>
 
 #include <boost/optional.hpp>
 
 #include "basics/genomic_region.hpp"
+#include "basics/contig_region.hpp"
 #include "basics/aligned_read.hpp"
+#include "coverage_limiter.hpp"
 
 namespace octopus { namespace io {
 
@@ -24,6 +29,8 @@ public:
     using ReadContainer   = std::vector<AlignedRead>;
     using SampleReadMap   = std::unordered_map<SampleName, ReadContainer>;
     using PositionList    = std::vector<GenomicRegion::Position>;
+    using EvidenceList    = std::vector<ContigRegion>;
+    using ReadPrefilter   = std::function<bool(const AlignedRead::Core&)>;
     
     virtual ~IReadReaderImpl() noexcept = default;
     
@@ -45,6 +52,12 @@ public:
                                     const GenomicRegion& region) const = 0;
     virtual std::size_t count_reads(const std::vector<SampleName>& sample,
                                     const GenomicRegion& region) const = 0;
+    // A cheap approximate count for planning, which may be answered from a coarse index.
+    virtual std::size_t estimate_read_count(const std::vector<SampleName>& samples,
+                                            const GenomicRegion& region) const
+    {
+        return count_reads(samples, region);
+    }
     
     virtual PositionList extract_read_positions(const GenomicRegion& region,
                                                 std::size_t max_reads) const = 0;
@@ -55,17 +68,57 @@ public:
                                                 const GenomicRegion& region,
                                                 std::size_t max_reads) const = 0;
     
+    // The reference regions of mismatches, indels, and clips in reads overlapping region, found without
+    // decoding the reads. Returns none if the implementation cannot find evidence this way.
+    virtual boost::optional<EvidenceList> extract_variation_evidence(const std::vector<SampleName>& samples,
+                                                                     const GenomicRegion& region) const
+    {
+        return boost::none;
+    }
+    
     virtual SampleReadMap fetch_reads(const GenomicRegion& region) const = 0;
     virtual ReadContainer fetch_reads(const SampleName& sample,
                                       const GenomicRegion& region) const = 0;
     virtual SampleReadMap fetch_reads(const std::vector<SampleName>& samples,
                                       const GenomicRegion& region) const = 0;
+    // Only returns reads passing prefilter. If max_coverage is given then reads are also dropped, in
+    // file order, so that no sample has more than max_coverage reads overlapping any position (see
+    // CoverageLimiter). Implementations that can evaluate AlignedRead::Core before decoding a read
+    // should override this to avoid decoding reads that are thrown away.
+    virtual SampleReadMap fetch_reads(const std::vector<SampleName>& samples,
+                                      const GenomicRegion& region,
+                                      const ReadPrefilter& prefilter,
+                                      boost::optional<unsigned> max_coverage) const
+    {
+        auto result = fetch_reads(samples, region);
+        for (auto& p : result) {
+            auto& reads = p.second;
+            if (prefilter) {
+                reads.erase(std::remove_if(std::begin(reads), std::end(reads),
+                                           [&] (const AlignedRead& read) { return !prefilter(extract_core(read)); }),
+                            std::end(reads));
+            }
+            if (max_coverage) {
+                std::sort(std::begin(reads), std::end(reads));
+                CoverageLimiter limiter {*max_coverage};
+                reads.erase(std::remove_if(std::begin(reads), std::end(reads),
+                                           [&] (const AlignedRead& read) {
+                                               return !limiter.admit(mapped_begin(read), mapped_end(read)); }),
+                            std::end(reads));
+            }
+        }
+        return result;
+    }
     
     virtual std::vector<GenomicRegion::ContigName> reference_contigs() const = 0;
     virtual GenomicRegion::Size reference_size(const GenomicRegion::ContigName& contig) const = 0;
     
     virtual boost::optional<std::vector<GenomicRegion::ContigName>> mapped_contigs() const { return boost::none; };
     virtual boost::optional<std::vector<GenomicRegion>> mapped_regions() const { return boost::none; };
+    
+    // Regions that will likely be fetched soon. Readers that can't seek, such as streams, may use these
+    // to decide which reads they can drop.
+    virtual void hint(const std::vector<GenomicRegion>&) const {}
 };
 
 } // namespace io
@@ -10,9 +10,9 @@
 
 namespace octopus { namespace io {
 
-ReadWriter::ReadWriter(Path bam_out, Path bam_template)
+ReadWriter::ReadWriter(Path bam_out, Path bam_template, HtslibThreadPool* compression_threads)
 : path_ {std::move(bam_out)}
-, impl_ {std::make_unique<HtslibSamFacade>(path_, std::move(bam_template))}
+, impl_ {std::make_unique<HtslibSamFacade>(path_, std::move(bam_template), compression_threads)}
 {}
 
 ReadWriter::ReadWriter(ReadWriter&& other)
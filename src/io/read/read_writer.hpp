@@ -26,7 +26,7 @@ public:
     
     ReadWriter() = delete;
     
-    ReadWriter(Path bam_out, Path bam_template);
+    ReadWriter(Path bam_out, Path bam_template, HtslibThreadPool* compression_threads = nullptr);
     
     ReadWriter(const ReadWriter&)            = delete;
     ReadWriter& operator=(const ReadWriter&) = delete;
@@ -42,6 +42,9 @@ public:
     void write(const AlignedRead& read);
     void write(const AnnotatedAlignedRead& read);
     
+    // Writes all reads under a single lock
+    template <typename Container> void write_all(const Container& reads);
+    
 private:
     Path path_;
     std::unique_ptr<HtslibSamFacade> impl_;
@@ -52,13 +55,20 @@ ReadWriter& operator<<(ReadWriter& dst, const AlignedRead& read);
 ReadWriter& operator<<(ReadWriter& dst, const AnnotatedAlignedRead& read);
 
 template <typename Container>
-void write(const Container& reads, ReadWriter& dst)
+void ReadWriter::write_all(const Container& reads)
 {
+    std::lock_guard<std::mutex> lock {mutex_};
     for (const auto& read : reads) {
-        dst << read;
+        impl_->write(read);
     }
 }
 
+template <typename Container>
+void write(const Container& reads, ReadWriter& dst)
+{
+    dst.write_all(reads);
+}
+
 template <typename Container>
 ReadWriter& operator<<(ReadWriter& dst, const Container& reads)
 {
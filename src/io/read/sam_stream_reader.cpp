@@ -0,0 +1,319 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "sam_stream_reader.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <sstream>
+#include <utility>
+
+#include "exceptions/user_error.hpp"
+#include "coverage_limiter.hpp"
+
+namespace octopus { namespace io {
+
+class ReadStreamOverrun : public UserError
+{
+    std::string do_where() const override
+    {
+        return "SamStreamReader";
+    }
+    
+    std::string do_why() const override
+    {
+        std::ostringstream ss {};
+        ss << "reads in " << region_ << " were requested after the input read stream had moved past them";
+        return ss.str();
+    }
+    
+    std::string do_help() const override
+    {
+        return "Streamed reads must be sorted in the same contig order as the reference index, and calling"
+               " regions must be given in that order. Otherwise write the reads to an indexed file";
+    }
+    
+    GenomicRegion region_;
+    
+public:
+    ReadStreamOverrun(GenomicRegion region) : region_ {std::move(region)} {}
+};
+
+class UnsortedReadStream : public UserError
+{
+    std::string do_where() const override
+    {
+        return "SamStreamReader";
+    }
+    
+    std::string do_why() const override
+    {
+        return "the read " + read_name_ + " in the input read stream is out of order";
+    }
+    
+    std::string do_help() const override
+    {
+        return "Streamed reads must be coordinate sorted (e.g. with samtools sort)";
+    }
+    
+    std::string read_name_;
+    
+public:
+    UnsortedReadStream(std::string read_name) : read_name_ {std::move(read_name)} {}
+};
+
+SamStreamReader::SamStreamReader(Path file_path, HtslibThreadPool* decompression_threads,
+                                 boost::optional<Path> reference, const GenomicRegion::Size max_lag)
+: stream_ {std::move(file_path), decompression_threads, std::move(reference)}
+, max_lag_ {max_lag}
+, samples_ {stream_.extract_samples()}
+, sample_indices_ {}
+, contig_offsets_ {}
+, buffer_ {}
+, stream_position_ {0}
+, window_begin_ {0}
+, furthest_request_ {0}
+, hinted_begin_ {}
+, max_read_span_ {0}
+, stream_done_ {false}
+{
+    for (SampleIndex i {0}; i < samples_.size(); ++i) {
+        sample_indices_.emplace(samples_[i], i);
+    }
+    LinearPosition offset {0};
+    for (const auto& contig : stream_.reference_contigs()) {
+        contig_offsets_.emplace(contig, offset);
+        offset += stream_.reference_size(contig);
+    }
+}
+
+bool SamStreamReader::is_open() const noexcept
+{
+    return stream_.is_open();
+}
+
+// A stream can't be reopened, so it stays open until it is destroyed
+void SamStreamReader::open() {}
+
+void SamStreamReader::close() {}
+
+std::vector<SamStreamReader::SampleName> SamStreamReader::extract_samples() const
+{
+    return samples_;
+}
+
+std::vector<std::string> SamStreamReader::extract_read_groups(const SampleName& sample) const
+{
+    return stream_.extract_read_groups(sample);
+}
+
+// has_reads
+
+bool SamStreamReader::has_reads(const GenomicRegion& region) const
+{
+    return has_reads(samples_, region);
+}
+
+bool SamStreamReader::has_reads(const SampleName& sample, const GenomicRegion& region) const
+{
+    return has_reads(std::vector<SampleName> {sample}, region);
+}
+
+bool SamStreamReader::has_reads(const std::vector<SampleName>& samples, const GenomicRegion& region) const
+{
+    bool result {false};
+    visit(region, make_sample_mask(samples), [&] (const BufferedRead&) { result = true; return false; });
+    return result;
+}
+
+// count_reads
+
+std::size_t SamStreamReader::count_reads(const GenomicRegion& region) const
+{
+    return count_reads(samples_, region);
+}
+
+std::size_t SamStreamReader::count_reads(const SampleName& sample, const GenomicRegion& region) const
+{
+    return count_reads(std::vector<SampleName> {sample}, region);
+}
+
+std::size_t SamStreamReader::count_reads(const std::vector<SampleName>& samples, const GenomicRegion& region) const
+{
+    std::size_t result {0};
+    visit(region, make_sample_mask(samples), [&] (const BufferedRead&) { ++result; return true; });
+    return result;
+}
+
+std::size_t SamStreamReader::estimate_read_count(const std::vector<SampleName>&, const GenomicRegion&) const
+{
+    return 0;
+}
+
+// extract_read_positions
+
+SamStreamReader::PositionList
+SamStreamReader::extract_read_positions(const GenomicRegion& region, const std::size_t max_reads) const
+{
+    return extract_read_positions(samples_, region, max_reads);
+}
+
+SamStreamReader::PositionList
+SamStreamReader::extract_read_positions(const SampleName& sample, const GenomicRegion& region,
+                                        const std::size_t max_reads) const
+{
+    return extract_read_positions(std::vector<SampleName> {sample}, region, max_reads);
+}
+
+SamStreamReader::PositionList
+SamStreamReader::extract_read_positions(const std::vector<SampleName>& samples, const GenomicRegion& region,
+                                        const std::size_t max_reads) const
+{
+    PositionList result {};
+    if (max_reads == 0) return result;
+    const auto offset = contig_offsets_.at(region.contig_name());
+    visit(region, make_sample_mask(samples), [&] (const BufferedRead& buffered) {
+        result.push_back(buffered.begin - offset);
+        return result.size() < max_reads;
+    });
+    return result;
+}
+
+// fetch_reads
+
+SamStreamReader::SampleReadMap SamStreamReader::fetch_reads(const GenomicRegion& region) const
+{
+    return fetch_reads(samples_, region);
+}
+
+SamStreamReader::ReadContainer SamStreamReader::fetch_reads(const SampleName& sample, const GenomicRegion& region) const
+{
+    auto reads = fetch_reads(std::vector<SampleName> {sample}, region);
+    if (reads.empty()) return {};
+    return std::move(reads.begin()->second);
+}
+
+SamStreamReader::SampleReadMap SamStreamReader::fetch_reads(const std::vector<SampleName>& samples,
+                                                            const GenomicRegion& region) const
+{
+    return fetch_reads(samples, region, ReadPrefilter {}, boost::none);
+}
+
+SamStreamReader::SampleReadMap SamStreamReader::fetch_reads(const std::vector<SampleName>& samples,
+                                                            const GenomicRegion& region,
+                                                            const ReadPrefilter& prefilter,
+                                                            const boost::optional<unsigned> max_coverage) const
+{
+    SampleReadMap result {samples.size()};
+    std::vector<ReadContainer*> sample_reads(samples_.size(), nullptr);
+    std::vector<CoverageLimiter> limiters {};
+    if (max_coverage) limiters.assign(samples_.size(), CoverageLimiter {*max_coverage});
+    for (const auto& sample : samples) {
+        const auto itr = sample_indices_.find(sample);
+        if (itr != std::cend(sample_indices_)) {
+            sample_reads[itr->second] = &result[sample];
+        }
+    }
+    if (result.empty()) return result; // no matching samples
+    visit(region, make_sample_mask(samples), [&] (const BufferedRead& buffered) {
+        if (prefilter && !prefilter(extract_core(buffered.read))) return true;
+        if (max_coverage && !limiters[buffered.sample].admit(buffered.begin, buffered.end)) return true;
+        sample_reads[buffered.sample]->push_back(buffered.read);
+        return true;
+    });
+    return result;
+}
+
+std::vector<GenomicRegion::ContigName> SamStreamReader::reference_contigs() const
+{
+    return stream_.reference_contigs();
+}
+
+GenomicRegion::Size SamStreamReader::reference_size(const GenomicRegion::ContigName& contig) const
+{
+    return stream_.reference_size(contig);
+}
+
+void SamStreamReader::hint(const std::vector<GenomicRegion>& regions) const
+{
+    hinted_begin_ = boost::none;
+    for (const auto& region : regions) {
+        if (contig_offsets_.count(region.contig_name()) == 0) continue;
+        const auto begin = to_linear(region.contig_name(), region.begin());
+        if (!hinted_begin_ || begin < *hinted_begin_) hinted_begin_ = begin;
+    }
+}
+
+// private methods
+
+SamStreamReader::LinearPosition
+SamStreamReader::to_linear(const GenomicRegion::ContigName& contig, const GenomicRegion::Position position) const
+{
+    return contig_offsets_.at(contig) + position;
+}
+
+std::vector<bool> SamStreamReader::make_sample_mask(const std::vector<SampleName>& samples) const
+{
+    std::vector<bool> result(samples_.size(), false);
+    for (const auto& sample : samples) {
+        const auto itr = sample_indices_.find(sample);
+        if (itr != std::cend(sample_indices_)) result[itr->second] = true;
+    }
+    return result;
+}
+
+void SamStreamReader::slide_window(const LinearPosition request_begin) const
+{
+    furthest_request_ = std::max(furthest_request_, request_begin);
+    auto begin = furthest_request_ > max_lag_ ? furthest_request_ - max_lag_ : 0;
+    if (hinted_begin_) begin = std::min(begin, *hinted_begin_);
+    window_begin_ = std::max(window_begin_, begin);
+    while (!buffer_.empty() && buffer_.front().end <= window_begin_) {
+        buffer_.pop_front();
+    }
+}
+
+bool SamStreamReader::read_next() const
+{
+    while (!stream_done_) {
+        auto record = stream_.read_next();
+        if (!record) {
+            stream_done_ = true;
+            break;
+        }
+        const auto& contig = contig_name(record->read);
+        const auto begin = to_linear(contig, record->begin);
+        const auto end = to_linear(contig, std::max(record->end, record->begin + 1));
+        if (begin < stream_position_) throw UnsortedReadStream {record->read.name()};
+        stream_position_ = begin;
+        if (end <= window_begin_) continue; // no longer requestable
+        max_read_span_ = std::max(max_read_span_, static_cast<GenomicRegion::Size>(end - begin));
+        buffer_.push_back({begin, end, sample_indices_.at(record->sample), std::move(record->read)});
+        return true;
+    }
+    return false;
+}
+
+template <typename F>
+void SamStreamReader::visit(const GenomicRegion& region, const std::vector<bool>& sample_mask, F&& f) const
+{
+    const auto begin = to_linear(region.contig_name(), region.begin());
+    const auto end = to_linear(region.contig_name(), region.end());
+    if (begin < window_begin_) throw ReadStreamOverrun {region};
+    slide_window(begin);
+    const auto search_begin = begin > max_read_span_ ? begin - max_read_span_ : 0;
+    const auto first = std::lower_bound(std::cbegin(buffer_), std::cend(buffer_), search_begin,
+                                        [] (const BufferedRead& read, LinearPosition position) {
+                                            return read.begin < position; });
+    // Indices are used as reading the stream may invalidate deque iterators
+    for (auto idx = static_cast<std::size_t>(std::distance(std::cbegin(buffer_), first));; ++idx) {
+        if (idx == buffer_.size() && !read_next()) return;
+        const auto& buffered = buffer_[idx];
+        if (buffered.begin >= end) return;
+        if (buffered.end > begin && sample_mask[buffered.sample] && !f(buffered)) return;
+    }
+}
+
+} // namespace io
+} // namespace octopus
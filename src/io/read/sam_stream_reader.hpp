@@ -0,0 +1,136 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef sam_stream_reader_hpp
+#define sam_stream_reader_hpp
+
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+
+#include <boost/optional.hpp>
+
+#include "basics/genomic_region.hpp"
+#include "basics/aligned_read.hpp"
+#include "read_reader_impl.hpp"
+#include "htslib_sam_facade.hpp"
+
+namespace octopus { namespace io {
+
+/*
+ SamStreamReader reads a coordinate sorted SAM/BAM/CRAM stream, such as an aligner's sorted output on the
+ standard input, once and without an index. Reads are kept in a window that slides forward with the
+ requests: the window ends at the furthest position requested, and starts max_lag before the furthest
+ requested begin, or earlier if a hinted region starts earlier. Requests must therefore move forward
+ through the stream, and requesting a region before the window is an error. Contigs are ordered as in the
+ stream header.
+ */
+class SamStreamReader : public IReadReaderImpl
+{
+public:
+    using Path = HtslibSamFacade::Path;
+    
+    using IReadReaderImpl::SampleName;
+    using IReadReaderImpl::ReadContainer;
+    using IReadReaderImpl::SampleReadMap;
+    using IReadReaderImpl::PositionList;
+    
+    SamStreamReader() = delete;
+    
+    SamStreamReader(Path file_path, HtslibThreadPool* decompression_threads = nullptr,
+                    boost::optional<Path> reference = boost::none,
+                    GenomicRegion::Size max_lag = 1'000'000);
+    
+    SamStreamReader(const SamStreamReader&)            = delete;
+    SamStreamReader& operator=(const SamStreamReader&) = delete;
+    SamStreamReader(SamStreamReader&&)                 = delete;
+    SamStreamReader& operator=(SamStreamReader&&)      = delete;
+    
+    ~SamStreamReader() override = default;
+    
+    bool is_open() const noexcept override;
+    void open() override;
+    void close() override;
+    
+    std::vector<SampleName> extract_samples() const override;
+    std::vector<std::string> extract_read_groups(const SampleName& sample) const override;
+    
+    bool has_reads(const GenomicRegion& region) const override;
+    bool has_reads(const SampleName& sample,
+                   const GenomicRegion& region) const override;
+    bool has_reads(const std::vector<SampleName>& samples,
+                   const GenomicRegion& region) const override;
+    
+    std::size_t count_reads(const GenomicRegion& region) const override;
+    std::size_t count_reads(const SampleName& sample,
+                            const GenomicRegion& region) const override;
+    std::size_t count_reads(const std::vector<SampleName>& samples,
+                            const GenomicRegion& region) const override;
+    // Always zero, as reads ahead of the window are not read for planning
+    std::size_t estimate_read_count(const std::vector<SampleName>& samples,
+                                    const GenomicRegion& region) const override;
+    
+    PositionList extract_read_positions(const GenomicRegion& region,
+                                        std::size_t max_reads) const override;
+    PositionList extract_read_positions(const SampleName& sample,
+                                        const GenomicRegion& region,
+                                        std::size_t max_reads) const override;
+    PositionList extract_read_positions(const std::vector<SampleName>& samples,
+                                        const GenomicRegion& region,
+                                        std::size_t max_reads) const override;
+    
+    SampleReadMap fetch_reads(const GenomicRegion& region) const override;
+    ReadContainer fetch_reads(const SampleName& sample,
+                              const GenomicRegion& region) const override;
+    SampleReadMap fetch_reads(const std::vector<SampleName>& samples,
+                              const GenomicRegion& region) const override;
+    SampleReadMap fetch_reads(const std::vector<SampleName>& samples,
+                              const GenomicRegion& region,
+                              const ReadPrefilter& prefilter,
+                              boost::optional<unsigned> max_coverage) const override;
+    
+    std::vector<GenomicRegion::ContigName> reference_contigs() const override;
+    GenomicRegion::Size reference_size(const GenomicRegion::ContigName& contig) const override;
+    
+    void hint(const std::vector<GenomicRegion>& regions) const override;
+    
+private:
+    using LinearPosition = std::uint64_t;
+    using SampleIndex = unsigned;
+    
+    // Positions are offset by the length of all contigs before the read's contig in the stream
+    struct BufferedRead
+    {
+        LinearPosition begin, end;
+        SampleIndex sample;
+        AlignedRead read;
+    };
+    
+    mutable HtslibSamFacade stream_;
+    GenomicRegion::Size max_lag_;
+    std::vector<SampleName> samples_;
+    std::unordered_map<SampleName, SampleIndex> sample_indices_;
+    std::unordered_map<GenomicRegion::ContigName, LinearPosition> contig_offsets_;
+    
+    mutable std::deque<BufferedRead> buffer_;
+    mutable LinearPosition stream_position_, window_begin_, furthest_request_;
+    mutable boost::optional<LinearPosition> hinted_begin_;
+    mutable GenomicRegion::Size max_read_span_;
+    mutable bool stream_done_;
+    
+    LinearPosition to_linear(const GenomicRegion::ContigName& contig, GenomicRegion::Position position) const;
+    std::vector<bool> make_sample_mask(const std::vector<SampleName>& samples) const;
+    void slide_window(LinearPosition request_begin) const;
+    bool read_next() const;
+    // Calls f on each buffered read overlapping region from a sample in the mask, in stream order, until
+    // f returns false. The stream is only read as far as needed.
+    template <typename F>
+    void visit(const GenomicRegion& region, const std::vector<bool>& sample_mask, F&& f) const;
+};
+
+} // namespace io
+} // namespace octopus
+
+#endif
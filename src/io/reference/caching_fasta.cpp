@@ -11,6 +11,7 @@
 #include <cassert>
 
 #include "basics/genomic_region.hpp"
+#include "logging/live_metrics.hpp"
 
 namespace octopus { namespace io {
 
@@ -138,24 +139,33 @@ CachingFasta::GenomicSize CachingFasta::do_fetch_contig_size(const ContigName& c
 }
 
 CachingFasta::GeneticSequence CachingFasta::do_fetch_sequence(const GenomicRegion& region) const
+{
+    return do_fetch_sequence_view(region).str();
+}
+
+CachingFasta::GeneticSequenceView CachingFasta::do_fetch_sequence_view(const GenomicRegion& region) const
 {
     if (is_empty(region)) {
-        return "";
+        return {};
     }
     if (size(region) > max_cache_size_) {
-        return fasta_->fetch_sequence(region);
+        return GeneticSequenceView {fasta_->fetch_sequence(region)};
     }
     std::unique_lock<std::mutex> lock {mutex_};
     const auto cache_itr = find_cached(region);
     if (cache_itr) {
+        metrics::add(metrics::Counter::reference_cache_hits);
         register_cache_hit(region);
-        return get_subsequence(region.contig_region(), (*cache_itr)->first, (*cache_itr)->second);
+        const auto offset = static_cast<std::size_t>(begin_distance((*cache_itr)->first, region.contig_region()));
+        return {(*cache_itr)->second, offset, size(region)};
     }
+    metrics::add(metrics::Counter::reference_cache_misses);
     auto fetch_region = get_region_to_fetch(region);
     assert(contains(fetch_region, region));
     lock.unlock();
-    auto fetched_sequence = fasta_->fetch_sequence(fetch_region);
-    auto result = get_subsequence(region.contig_region(), fetch_region.contig_region(), fetched_sequence);
+    auto fetched_sequence = std::make_shared<const GeneticSequence>(fasta_->fetch_sequence(fetch_region));
+    const auto offset = static_cast<std::size_t>(begin_distance(fetch_region.contig_region(), region.contig_region()));
+    GeneticSequenceView result {fetched_sequence, offset, size(region)};
     lock.lock();
     add_sequence_to_cache(std::move(fetched_sequence), std::move(fetch_region));
     return result;
@@ -246,10 +256,10 @@ GenomicRegion CachingFasta::get_partial_contig_chunk(const GenomicRegion& reques
     return get_new_contig_chunk(requested_region);
 }
 
-void CachingFasta::add_sequence_to_cache(GeneticSequence&& sequence, GenomicRegion&& region) const
+void CachingFasta::add_sequence_to_cache(CachedSequence sequence, GenomicRegion region) const
 {
     assert(size(region) <= max_cache_size_);
-    recache_overlapped_regions(sequence, region);
+    recache_overlapped_regions(*sequence, region);
     const auto& contig = region.contig_name();
     if (sequence_cache_.count(contig) == 0 && contig_sizes_.at(contig) >= get_remaining_cache_size()) {
         // Try to clear some room for the new contig hit as we can expect more
@@ -347,9 +357,9 @@ void CachingFasta::recache_overlapped_regions(const GeneticSequence& sequence, c
                     const auto cached_subregion_to_keep = get_nonoverlapped_part(cached_region, region);
                     assert(contains(cached_region, cached_subregion_to_keep));
                     to_recache.emplace_back(cached_subregion_to_keep.contig_region(),
-                                            get_subsequence(cached_subregion_to_keep.contig_region(),
-                                                            cached_contig_region,
-                                                            p.second));
+                                            std::make_shared<const GeneticSequence>(get_subsequence(cached_subregion_to_keep.contig_region(),
+                                                                                                    cached_contig_region,
+                                                                                                    *p.second)));
                     replace_in_usage_cache(cached_region, cached_subregion_to_keep);
                     current_cache_size_ += size(cached_subregion_to_keep);
                 }
@@ -47,9 +47,10 @@ class CachingFasta : public ReferenceReader
 public:
     using Path = Fasta::Path;
     
-    using ContigName      = ReferenceReader::ContigName;
-    using GenomicSize     = ReferenceReader::GenomicSize;
-    using GeneticSequence = ReferenceReader::GeneticSequence;
+    using ContigName          = ReferenceReader::ContigName;
+    using GenomicSize         = ReferenceReader::GenomicSize;
+    using GeneticSequence     = ReferenceReader::GeneticSequence;
+    using GeneticSequenceView = ReferenceReader::GeneticSequenceView;
     
     CachingFasta() = delete;
     
@@ -64,7 +65,8 @@ public:
     CachingFasta& operator=(CachingFasta&&);
     
 private:
-    using ContigSequenceCache = std::map<ContigRegion, GeneticSequence>;
+    using CachedSequence      = std::shared_ptr<const GeneticSequence>;
+    using ContigSequenceCache = std::map<ContigRegion, CachedSequence>;
     using SequenceCache       = std::unordered_map<std::string, ContigSequenceCache>;
     using CacheIterator       = ContigSequenceCache::const_iterator;
     using OverlapRange        = boost::iterator_range<CacheIterator>;
@@ -85,6 +87,7 @@ private:
     std::vector<ContigName> do_fetch_contig_names() const override;
     GenomicSize do_fetch_contig_size(const ContigName& contig) const override;
     GeneticSequence do_fetch_sequence(const GenomicRegion& region) const override;
+    GeneticSequenceView do_fetch_sequence_view(const GenomicRegion& region) const override;
     
     void setup_cache();
     GenomicSize get_remaining_cache_size() const;
@@ -95,7 +98,7 @@ private:
     GenomicRegion get_partial_contig_chunk(const GenomicRegion& requested_region) const;
     bool is_contig_cached(const GenomicRegion& region) const;
     boost::optional<CacheIterator> find_cached(const GenomicRegion& request_region) const noexcept;
-    void add_sequence_to_cache(GeneticSequence&& sequence, GenomicRegion&& region) const;
+    void add_sequence_to_cache(CachedSequence sequence, GenomicRegion region) const;
     void register_cache_hit(const GenomicRegion& region) const;
     OverlapRange overlap_range(const GenomicRegion& region) const;
     void remove_from_sequence_cache(const GenomicRegion& region) const;
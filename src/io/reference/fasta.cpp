@@ -106,6 +106,8 @@ Fasta::Fasta(const Fasta& other)
 : path_ {other.path_}
 , index_path_ {other.index_path_}
 , fasta_ {path_.string()}
+, fasta_index_ {other.fasta_index_}
+, options_ {other.options_}
 {}
 
 Fasta& Fasta::operator=(Fasta other)
@@ -114,9 +116,21 @@ Fasta& Fasta::operator=(Fasta other)
     swap(path_, other.path_);
     swap(index_path_, other.index_path_);
     swap(fasta_, other.fasta_);
+    swap(fasta_index_, other.fasta_index_);
+    swap(options_, other.options_);
     return *this;
 }
 
+const Fasta::Path& Fasta::path() const noexcept
+{
+    return path_;
+}
+
+const Fasta::Path& Fasta::index_path() const noexcept
+{
+    return index_path_;
+}
+
 // virtual private methods
 
 std::unique_ptr<ReferenceReader> Fasta::do_clone() const
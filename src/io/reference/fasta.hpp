@@ -53,6 +53,9 @@ public:
     Fasta(Fasta&&)            = default;
     Fasta& operator=(Fasta&&) = default;
     
+    const Path& path() const noexcept;
+    const Path& index_path() const noexcept;
+    
 private:
     Path path_;
     Path index_path_;
@@ -0,0 +1,151 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "mapped_fasta.hpp"
+
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "basics/genomic_region.hpp"
+#include "utils/sequence_utils.hpp"
+
+namespace octopus { namespace io {
+
+class MappedFasta::MappedFile
+{
+public:
+    MappedFile() = delete;
+
+    MappedFile(const Path& path)
+    {
+        const auto fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error {"MappedFasta: could not open " + path.string()};
+        }
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error {"MappedFasta: could not stat " + path.string()};
+        }
+        size_ = static_cast<std::size_t>(info.st_size);
+        if (size_ > 0) {
+            auto data = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+            if (data == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error {"MappedFasta: could not memory map " + path.string()};
+            }
+            data_ = static_cast<const char*>(data);
+        }
+        ::close(fd); // the mapping keeps the file alive
+    }
+
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile()
+    {
+        if (data_) ::munmap(const_cast<char*>(data_), size_);
+    }
+
+    const char* data() const noexcept { return data_; }
+    std::size_t size() const noexcept { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+MappedFasta::MappedFasta(Path fasta_path)
+: MappedFasta {std::move(fasta_path), Options {}}
+{}
+
+MappedFasta::MappedFasta(Path fasta_path, Options options)
+: MappedFasta {Fasta {std::move(fasta_path), options}, options}
+{}
+
+MappedFasta::MappedFasta(Path fasta_path, Path fasta_index_path)
+: MappedFasta {std::move(fasta_path), std::move(fasta_index_path), Options {}}
+{}
+
+MappedFasta::MappedFasta(Path fasta_path, Path fasta_index_path, Options options)
+: MappedFasta {Fasta {std::move(fasta_path), std::move(fasta_index_path), options}, options}
+{}
+
+MappedFasta::MappedFasta(Fasta fasta, Options options)
+: fasta_ {std::make_shared<Fasta>(std::move(fasta))}
+, file_ {std::make_shared<MappedFile>(fasta_->path())}
+, fasta_index_ {std::make_shared<bioio::FastaIndex>(bioio::read_fasta_index(fasta_->index_path().string()))}
+, options_ {options}
+{}
+
+// virtual private methods
+
+std::unique_ptr<ReferenceReader> MappedFasta::do_clone() const
+{
+    return std::make_unique<MappedFasta>(*this);
+}
+
+bool MappedFasta::do_is_open() const noexcept
+{
+    return file_ != nullptr;
+}
+
+std::string MappedFasta::do_fetch_reference_name() const
+{
+    return fasta_->fetch_reference_name();
+}
+
+std::vector<MappedFasta::ContigName> MappedFasta::do_fetch_contig_names() const
+{
+    return fasta_->fetch_contig_names();
+}
+
+MappedFasta::GenomicSize MappedFasta::do_fetch_contig_size(const ContigName& contig) const
+{
+    return fasta_->fetch_contig_size(contig);
+}
+
+MappedFasta::GeneticSequence MappedFasta::do_fetch_sequence(const GenomicRegion& region) const
+{
+    const auto& index = fasta_index_->at(contig_name(region));
+    GeneticSequence result {};
+    const std::size_t begin {mapped_begin(region)};
+    if (begin < index.length) {
+        const auto length = std::min(static_cast<std::size_t>(size(region)), index.length - begin);
+        result.reserve(size(region));
+        // Copy a line at a time, skipping the line terminators
+        for (auto position = begin; result.size() < length;) {
+            const auto line_offset = position % index.line_length;
+            const auto offset = index.offset + position / index.line_length * index.line_byte_length + line_offset;
+            if (offset >= file_->size()) break; // truncated file
+            auto num_bases = std::min(index.line_length - line_offset, length - result.size());
+            num_bases = std::min(num_bases, file_->size() - offset);
+            result.append(file_->data() + offset, num_bases);
+            position += num_bases;
+        }
+    }
+    if (options_.base_transform_policy == Options::CapitalisationPolicy::capitalise) {
+        utils::capitalise(result);
+    }
+    if (options_.iupac_ambiguity_symbol_policy == Options::IUPACAmbiguitySymbolPolicy::disambiguate) {
+        utils::disambiguate_iupac_bases(result, true);
+    }
+    if (result.size() < size(region)) {
+        if (options_.base_fill_policy == Options::BaseFillPolicy::throw_exception) {
+            throw std::runtime_error {"MappedFasta: requested bad reference region " + to_string(region)};
+        }
+        if (options_.base_fill_policy == Options::BaseFillPolicy::fill_with_ns) {
+            result.resize(size(region), 'N');
+        }
+    }
+    return result;
+}
+
+} // namespace io
+} // namespace octopus
@@ -0,0 +1,76 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef mapped_fasta_hpp
+#define mapped_fasta_hpp
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <memory>
+
+#include <boost/filesystem/path.hpp>
+
+#include "bioio.hpp"
+
+#include "reference_reader.hpp"
+#include "fasta.hpp"
+
+namespace octopus {
+
+class GenomicRegion;
+
+namespace io {
+
+/*
+ MappedFasta reads sequence straight from a read-only memory mapping of the fasta file. Fetches
+ need no locking, so one MappedFasta can be shared by all threads (there is no need to wrap it in a
+ ThreadsafeFasta). The mapping is backed by the page cache, so concurrent processes reading the same
+ reference share a single copy. Clones share the mapping.
+ */
+class MappedFasta : public ReferenceReader
+{
+public:
+    using Path    = Fasta::Path;
+    using Options = Fasta::Options;
+
+    using ContigName      = ReferenceReader::ContigName;
+    using GenomicSize     = ReferenceReader::GenomicSize;
+    using GeneticSequence = ReferenceReader::GeneticSequence;
+
+    MappedFasta() = delete;
+
+    MappedFasta(Path fasta_path);
+    MappedFasta(Path fasta_path, Options options);
+    MappedFasta(Path fasta_path, Path fasta_index_path);
+    MappedFasta(Path fasta_path, Path fasta_index_path, Options options);
+
+    MappedFasta(const MappedFasta&)            = default;
+    MappedFasta& operator=(const MappedFasta&) = default;
+    MappedFasta(MappedFasta&&)                 = default;
+    MappedFasta& operator=(MappedFasta&&)      = default;
+
+private:
+    class MappedFile;
+
+    // Validates the paths and provides the metadata
+    std::shared_ptr<const Fasta> fasta_;
+    std::shared_ptr<const MappedFile> file_;
+    std::shared_ptr<const bioio::FastaIndex> fasta_index_;
+
+    Options options_;
+
+    MappedFasta(Fasta fasta, Options options);
+
+    std::unique_ptr<ReferenceReader> do_clone() const override;
+    bool do_is_open() const noexcept override;
+    std::string do_fetch_reference_name() const override;
+    std::vector<ContigName> do_fetch_contig_names() const override;
+    GenomicSize do_fetch_contig_size(const ContigName& contig) const override;
+    GeneticSequence do_fetch_sequence(const GenomicRegion& region) const override;
+};
+
+} // namespace io
+} // namespace octopus
+
+#endif
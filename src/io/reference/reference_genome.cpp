@@ -7,10 +7,13 @@
 #include <iterator>
 #include <utility>
 #include <numeric>
+#include <thread>
 
 #include "fasta.hpp"
 #include "threadsafe_fasta.hpp"
 #include "caching_fasta.hpp"
+#include "sharded_caching_fasta.hpp"
+#include "mapped_fasta.hpp"
 
 namespace octopus {
 
@@ -23,6 +26,7 @@ ReferenceGenome::ReferenceGenome(std::unique_ptr<io::ReferenceReader> impl)
         try {
             name_ = impl_->fetch_reference_name();
             ordered_contigs_ = impl_->fetch_contig_names();
+            intern_contig_names(ordered_contigs_);
             contig_sizes_.reserve(ordered_contigs_.size());
             for (const auto& contig_name : ordered_contigs_) {
                 contig_sizes_.emplace(contig_name, impl_->fetch_contig_size(contig_name));
@@ -40,6 +44,7 @@ ReferenceGenome::ReferenceGenome(const ReferenceGenome& other)
 , name_ {other.name_}
 , contig_sizes_ {other.contig_sizes_}
 , ordered_contigs_ {other.ordered_contigs_}
+, tandem_repeat_index_ {other.tandem_repeat_index_}
 {}
 
 ReferenceGenome& ReferenceGenome::operator=(ReferenceGenome other)
@@ -49,6 +54,7 @@ ReferenceGenome& ReferenceGenome::operator=(ReferenceGenome other)
     swap(name_,            other.name_);
     swap(contig_sizes_,    other.contig_sizes_);
     swap(ordered_contigs_, other.ordered_contigs_);
+    swap(tandem_repeat_index_, other.tandem_repeat_index_);
     return *this;
 }
 
@@ -92,13 +98,29 @@ ReferenceGenome::GeneticSequence ReferenceGenome::fetch_sequence(const GenomicRe
     return impl_->fetch_sequence(region);
 }
 
+ReferenceGenome::GeneticSequenceView ReferenceGenome::fetch_sequence_view(const GenomicRegion& region) const
+{
+    return impl_->fetch_sequence_view(region);
+}
+
+void ReferenceGenome::set_tandem_repeat_index(std::shared_ptr<const TandemRepeatIndex> index) noexcept
+{
+    tandem_repeat_index_ = std::move(index);
+}
+
+const TandemRepeatIndex* ReferenceGenome::tandem_repeat_index() const noexcept
+{
+    return tandem_repeat_index_.get();
+}
+
 // non-member functions
 
 ReferenceGenome make_reference(boost::filesystem::path reference_path,
                                const MemoryFootprint max_cache_size,
                                const bool is_threaded,
                                const bool capitalise_bases,
-                               const bool disambiguate_iupac_ambiguity_symbols)
+                               const bool disambiguate_iupac_ambiguity_symbols,
+                               const bool memory_map)
 {
     using namespace io;
     std::unique_ptr<ReferenceReader> impl_ {};
@@ -110,6 +132,16 @@ ReferenceGenome make_reference(boost::filesystem::path reference_path,
         options.iupac_ambiguity_symbol_policy = Fasta::Options::IUPACAmbiguitySymbolPolicy::disambiguate;
     }
     options.base_fill_policy = Fasta::Options::BaseFillPolicy::fill_with_ns;
+    if (memory_map) {
+        // Lock free, and the page cache already acts as a shared cache
+        return ReferenceGenome {std::make_unique<MappedFasta>(std::move(reference_path), options)};
+    }
+    if (is_threaded && max_cache_size.bytes() > 0) {
+        // Shards read through their own Fasta clones, so no ThreadsafeFasta is needed
+        const auto num_shards = std::max(std::thread::hardware_concurrency(), 1u);
+        return ReferenceGenome {std::make_unique<ShardedCachingFasta>(std::make_unique<Fasta>(std::move(reference_path), options),
+                                                                      max_cache_size.bytes(), num_shards)};
+    }
     if (is_threaded) {
         impl_ = std::make_unique<ThreadsafeFasta>(std::make_unique<Fasta>(reference_path, options));
     } else {
@@ -117,7 +149,6 @@ ReferenceGenome make_reference(boost::filesystem::path reference_path,
     }
     if (max_cache_size.bytes() > 0) {
         double locality_bias {0.99}, forward_bias {0.99};
-        if (is_threaded) locality_bias = 0.25;
         return ReferenceGenome {std::make_unique<CachingFasta>(std::move(impl_), max_cache_size.bytes(),
                                                                locality_bias, forward_bias)};
     } else {
@@ -18,11 +18,14 @@
 
 namespace octopus {
 
+class TandemRepeatIndex;
+
 class ReferenceGenome
 {
 public:
-    using ContigName      = io::ReferenceReader::ContigName;
-    using GeneticSequence = io::ReferenceReader::GeneticSequence;
+    using ContigName          = io::ReferenceReader::ContigName;
+    using GeneticSequence     = io::ReferenceReader::GeneticSequence;
+    using GeneticSequenceView = io::ReferenceReader::GeneticSequenceView;
     
     ReferenceGenome() = delete;
     
@@ -45,12 +48,20 @@ public:
     bool contains(const GenomicRegion& region) const noexcept;
     
     GeneticSequence fetch_sequence(const GenomicRegion& region) const;
+    // The view shares the reader's cached sequence where possible, so avoids a copy.
+    GeneticSequenceView fetch_sequence_view(const GenomicRegion& region) const;
+    
+    // An attached index lets repeat finding use lookups rather than scanning fetched sequence.
+    // The index is shared by copies.
+    void set_tandem_repeat_index(std::shared_ptr<const TandemRepeatIndex> index) noexcept;
+    const TandemRepeatIndex* tandem_repeat_index() const noexcept;
     
 private:
     std::unique_ptr<io::ReferenceReader> impl_;
     std::string name_;
     std::unordered_map<ContigName, ContigRegion::Size> contig_sizes_;
     std::vector<ContigName> ordered_contigs_;
+    std::shared_ptr<const TandemRepeatIndex> tandem_repeat_index_;
 };
 
 // non-member functions
@@ -59,7 +70,8 @@ ReferenceGenome make_reference(boost::filesystem::path reference_path,
                                MemoryFootprint max_cache_size = 0,
                                bool is_threaded = false,
                                bool capitalise_bases = true,
-                               bool disambiguate_iupac_ambiguity_symbols = true);
+                               bool disambiguate_iupac_ambiguity_symbols = true,
+                               bool memory_map = false);
 
 std::vector<GenomicRegion> get_all_contig_regions(const ReferenceGenome& reference);
 
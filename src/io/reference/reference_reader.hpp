@@ -10,15 +10,17 @@
 #include <memory>
 
 #include "basics/genomic_region.hpp"
+#include "sequence_view.hpp"
 
 namespace octopus { namespace io {
 
 class ReferenceReader
 {
 public:
-    using ContigName      = GenomicRegion::ContigName;
-    using GenomicSize     = GenomicRegion::Size;
-    using GeneticSequence = std::string;
+    using ContigName          = GenomicRegion::ContigName;
+    using GenomicSize         = GenomicRegion::Size;
+    using GeneticSequence     = std::string;
+    using GeneticSequenceView = SequenceView;
     
     virtual ~ReferenceReader() = default;
     
@@ -52,6 +54,11 @@ public:
         return do_fetch_sequence(region);
     }
     
+    GeneticSequenceView fetch_sequence_view(const GenomicRegion& region) const
+    {
+        return do_fetch_sequence_view(region);
+    }
+    
 private:
     virtual std::unique_ptr<ReferenceReader> do_clone() const = 0;
     virtual bool do_is_open() const noexcept = 0;
@@ -59,6 +66,10 @@ private:
     virtual std::vector<ContigName> do_fetch_contig_names() const = 0;
     virtual GenomicSize do_fetch_contig_size(const ContigName& contig) const = 0;
     virtual GeneticSequence do_fetch_sequence(const GenomicRegion& region) const = 0;
+    virtual GeneticSequenceView do_fetch_sequence_view(const GenomicRegion& region) const
+    {
+        return GeneticSequenceView {do_fetch_sequence(region)};
+    }
 };
 
 } // namespace io
@@ -0,0 +1,112 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef sequence_view_hpp
+#define sequence_view_hpp
+
+#include <string>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <ostream>
+#include <cassert>
+
+namespace octopus { namespace io {
+
+/*
+ A read-only view of reference sequence that shares ownership of the storage it points into, so it
+ stays valid however long it is kept. Readers that cache sequence in immutable chunks can hand out
+ views without copying; other readers wrap a freshly fetched string.
+ */
+class SequenceView
+{
+public:
+    using value_type     = char;
+    using size_type      = std::size_t;
+    using const_iterator = const char*;
+    using iterator       = const_iterator;
+
+    SequenceView() = default;
+
+    explicit SequenceView(std::string sequence)
+    : SequenceView {std::make_shared<const std::string>(std::move(sequence))}
+    {}
+
+    explicit SequenceView(std::shared_ptr<const std::string> sequence)
+    : owner_ {std::move(sequence)}
+    , data_ {owner_->data()}
+    , size_ {owner_->size()}
+    {}
+
+    SequenceView(std::shared_ptr<const std::string> sequence, size_type pos, size_type count)
+    : owner_ {std::move(sequence)}
+    , data_ {owner_->data() + pos}
+    , size_ {count}
+    {
+        assert(pos + count <= owner_->size());
+    }
+
+    SequenceView(const SequenceView&)            = default;
+    SequenceView& operator=(const SequenceView&) = default;
+    SequenceView(SequenceView&&)                 = default;
+    SequenceView& operator=(SequenceView&&)      = default;
+
+    ~SequenceView() = default;
+
+    const char* data() const noexcept { return data_; }
+    size_type size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+
+    const_iterator begin() const noexcept { return data_; }
+    const_iterator end() const noexcept { return data_ + size_; }
+    const_iterator cbegin() const noexcept { return begin(); }
+    const_iterator cend() const noexcept { return end(); }
+
+    char operator[](size_type pos) const noexcept { return data_[pos]; }
+    char front() const noexcept { return data_[0]; }
+    char back() const noexcept { return data_[size_ - 1]; }
+
+    std::string str() const { return std::string(data_, size_); }
+    explicit operator std::string() const { return str(); }
+
+private:
+    std::shared_ptr<const std::string> owner_ = nullptr;
+    const char* data_ = nullptr;
+    size_type size_ = 0;
+};
+
+inline bool operator==(const SequenceView& lhs, const SequenceView& rhs) noexcept
+{
+    return lhs.size() == rhs.size() && std::equal(std::cbegin(lhs), std::cend(lhs), std::cbegin(rhs));
+}
+inline bool operator!=(const SequenceView& lhs, const SequenceView& rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+inline bool operator==(const SequenceView& lhs, const std::string& rhs) noexcept
+{
+    return lhs.size() == rhs.size() && std::equal(std::cbegin(lhs), std::cend(lhs), std::cbegin(rhs));
+}
+inline bool operator==(const std::string& lhs, const SequenceView& rhs) noexcept
+{
+    return rhs == lhs;
+}
+inline bool operator!=(const SequenceView& lhs, const std::string& rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+inline bool operator!=(const std::string& lhs, const SequenceView& rhs) noexcept
+{
+    return !(rhs == lhs);
+}
+
+inline std::ostream& operator<<(std::ostream& os, const SequenceView& sequence)
+{
+    return os.write(sequence.data(), sequence.size());
+}
+
+} // namespace io
+} // namespace octopus
+
+#endif
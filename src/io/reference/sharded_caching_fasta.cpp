@@ -0,0 +1,252 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "sharded_caching_fasta.hpp"
+
+#include <algorithm>
+#include <utility>
+#include <functional>
+#include <cassert>
+
+#include <boost/functional/hash.hpp>
+
+#include "basics/genomic_region.hpp"
+#include "config/common.hpp"
+#include "logging/logging.hpp"
+#include "logging/live_metrics.hpp"
+
+namespace octopus { namespace io {
+
+namespace {
+
+static constexpr ReferenceReader::GenomicSize max_chunk_size {65'536};
+static constexpr std::size_t max_chunks_per_request {8};
+
+} // namespace
+
+std::size_t ShardedCachingFasta::ChunkKeyHash::operator()(const ChunkKey& key) const noexcept
+{
+    auto result = std::hash<ContigName>{}(key.contig);
+    boost::hash_combine(result, key.index);
+    return result;
+}
+
+bool ShardedCachingFasta::ChunkKeyEqual::operator()(const ChunkKey& lhs, const ChunkKey& rhs) const noexcept
+{
+    return lhs.index == rhs.index && lhs.contig == rhs.contig;
+}
+
+// public methods
+
+ShardedCachingFasta::ShardedCachingFasta(std::unique_ptr<ReferenceReader> fasta,
+                                         const GenomicSize max_cache_size,
+                                         const unsigned num_shards)
+: fasta_ {std::move(fasta)}
+, contig_sizes_ {}
+, max_cache_size_ {max_cache_size}
+, chunk_size_ {}
+, max_chunks_per_shard_ {}
+, shards_ {std::max(num_shards, 1u)}
+{
+    chunk_size_ = std::max(GenomicSize {1}, std::min(max_chunk_size, max_cache_size_ / static_cast<GenomicSize>(shards_.size())));
+    max_chunks_per_shard_ = std::max(std::size_t {1}, max_cache_size_ / (shards_.size() * chunk_size_));
+    for (auto&& contig : fasta_->fetch_contig_names()) {
+        const auto size = fasta_->fetch_contig_size(contig);
+        contig_sizes_.emplace(std::move(contig), size);
+    }
+    make_shards();
+}
+
+ShardedCachingFasta::ShardedCachingFasta(const ShardedCachingFasta& other)
+: fasta_ {other.fasta_->clone()}
+, contig_sizes_ {other.contig_sizes_}
+, max_cache_size_ {other.max_cache_size_}
+, chunk_size_ {other.chunk_size_}
+, max_chunks_per_shard_ {other.max_chunks_per_shard_}
+, shards_ {other.shards_.size()}
+{
+    make_shards();
+}
+
+ShardedCachingFasta::~ShardedCachingFasta()
+{
+    if (DEBUG_MODE && !shards_.empty()) {
+        try {
+            report_usage();
+        } catch (...) {}
+    }
+}
+
+// virtual private methods
+
+std::unique_ptr<ReferenceReader> ShardedCachingFasta::do_clone() const
+{
+    return std::make_unique<ShardedCachingFasta>(*this);
+}
+
+bool ShardedCachingFasta::do_is_open() const noexcept
+{
+    return fasta_->is_open();
+}
+
+std::string ShardedCachingFasta::do_fetch_reference_name() const
+{
+    return fasta_->fetch_reference_name();
+}
+
+std::vector<ShardedCachingFasta::ContigName> ShardedCachingFasta::do_fetch_contig_names() const
+{
+    return fasta_->fetch_contig_names();
+}
+
+ShardedCachingFasta::GenomicSize ShardedCachingFasta::do_fetch_contig_size(const ContigName& contig) const
+{
+    return contig_sizes_.at(contig);
+}
+
+ShardedCachingFasta::GeneticSequence ShardedCachingFasta::do_fetch_sequence(const GenomicRegion& region) const
+{
+    if (is_empty(region)) {
+        return "";
+    }
+    const auto first_chunk = region.begin() / chunk_size_;
+    const auto last_chunk = (region.end() - 1) / chunk_size_;
+    const auto num_chunks = static_cast<std::size_t>(last_chunk - first_chunk + 1);
+    if (region.end() > contig_sizes_.at(region.contig_name())
+        || num_chunks > std::min(max_chunks_per_request, max_chunks_per_shard_)) {
+        // Not worth caching, or needs fill policy handling by the underlying reader
+        return read(shard(ChunkKey {region.contig_name(), first_chunk}), region);
+    }
+    GeneticSequence result {};
+    result.reserve(size(region));
+    for (auto index = first_chunk; index <= last_chunk; ++index) {
+        const auto chunk = get_chunk(ChunkKey {region.contig_name(), index});
+        const auto chunk_begin = index * chunk_size_;
+        const auto begin = std::max(region.begin(), chunk_begin) - chunk_begin;
+        const auto end = std::min(region.end(), chunk_begin + chunk_size_) - chunk_begin;
+        assert(end <= chunk->size());
+        result.append(*chunk, begin, end - begin);
+    }
+    return result;
+}
+
+ShardedCachingFasta::GeneticSequenceView ShardedCachingFasta::do_fetch_sequence_view(const GenomicRegion& region) const
+{
+    if (!is_empty(region) && region.end() <= contig_sizes_.at(region.contig_name())) {
+        const auto index = region.begin() / chunk_size_;
+        if ((region.end() - 1) / chunk_size_ == index) {
+            const auto chunk_begin = index * chunk_size_;
+            return {get_chunk(ChunkKey {region.contig_name(), index}), region.begin() - chunk_begin, size(region)};
+        }
+    }
+    return GeneticSequenceView {do_fetch_sequence(region)};
+}
+
+// private methods
+
+void ShardedCachingFasta::make_shards()
+{
+    for (auto& shard : shards_) {
+        shard = std::make_unique<Shard>();
+        shard->reader = fasta_->clone();
+        shard->chunks.reserve(max_chunks_per_shard_);
+        shard->hits = 0;
+        shard->misses = 0;
+        shard->contended = 0;
+    }
+}
+
+ShardedCachingFasta::Shard& ShardedCachingFasta::shard(const ChunkKey& key) const noexcept
+{
+    return *shards_[ChunkKeyHash{}(key) % shards_.size()];
+}
+
+ShardedCachingFasta::Chunk ShardedCachingFasta::get_chunk(const ChunkKey& key) const
+{
+    auto& shard = this->shard(key);
+    auto result = find_chunk(shard, key);
+    if (result) {
+        ++shard.hits;
+        metrics::add(metrics::Counter::reference_cache_hits);
+    } else {
+        ++shard.misses;
+        metrics::add(metrics::Counter::reference_cache_misses);
+        result = fetch_chunk(shard, key);
+        add_chunk(shard, key, result);
+    }
+    return result;
+}
+
+ShardedCachingFasta::Chunk ShardedCachingFasta::find_chunk(Shard& shard, const ChunkKey& key) const
+{
+    std::shared_lock<std::shared_timed_mutex> lock {shard.mutex, std::try_to_lock};
+    if (!lock.owns_lock()) {
+        ++shard.contended;
+        lock.lock();
+    }
+    const auto itr = shard.chunks.find(key);
+    if (itr == std::cend(shard.chunks)) return nullptr;
+    itr->second.referenced.store(true, std::memory_order_relaxed);
+    return itr->second.sequence;
+}
+
+ShardedCachingFasta::Chunk ShardedCachingFasta::fetch_chunk(Shard& shard, const ChunkKey& key) const
+{
+    const auto begin = key.index * chunk_size_;
+    const auto end = std::min(begin + chunk_size_, contig_sizes_.at(key.contig));
+    return std::make_shared<const GeneticSequence>(read(shard, GenomicRegion {key.contig, begin, end}));
+}
+
+void ShardedCachingFasta::add_chunk(Shard& shard, const ChunkKey& key, Chunk& chunk) const
+{
+    std::unique_lock<std::shared_timed_mutex> lock {shard.mutex, std::try_to_lock};
+    if (!lock.owns_lock()) {
+        ++shard.contended;
+        lock.lock();
+    }
+    const auto p = shard.chunks.emplace(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(chunk));
+    if (!p.second) {
+        // Another thread got here first
+        chunk = p.first->second.sequence;
+        return;
+    }
+    shard.clock.push_back(key);
+    while (shard.chunks.size() > max_chunks_per_shard_) {
+        assert(!shard.clock.empty());
+        auto candidate = std::move(shard.clock.front());
+        shard.clock.pop_front();
+        const auto itr = shard.chunks.find(candidate);
+        assert(itr != std::end(shard.chunks));
+        if (itr->second.referenced.exchange(false, std::memory_order_relaxed)) {
+            shard.clock.push_back(std::move(candidate)); // second chance
+        } else {
+            shard.chunks.erase(itr); // readers still holding the chunk keep it alive
+        }
+    }
+}
+
+ShardedCachingFasta::GeneticSequence ShardedCachingFasta::read(Shard& shard, const GenomicRegion& region) const
+{
+    std::lock_guard<std::mutex> lock {shard.reader_mutex};
+    return shard.reader->fetch_sequence(region);
+}
+
+void ShardedCachingFasta::report_usage() const
+{
+    std::size_t hits {0}, misses {0}, contended {0};
+    for (const auto& shard : shards_) {
+        if (!shard) continue;
+        hits += shard->hits;
+        misses += shard->misses;
+        contended += shard->contended;
+    }
+    const auto requests = hits + misses;
+    if (requests == 0) return;
+    logging::DebugLogger log {};
+    stream(log) << "Reference cache: " << hits << " hits in " << requests << " chunk requests ("
+                << (100.0 * hits / requests) << "%) over " << shards_.size() << " shards; "
+                << contended << " contended lock acquisitions";
+}
+
+} // namespace io
+} // namespace octopus
@@ -0,0 +1,115 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef sharded_caching_fasta_hpp
+#define sharded_caching_fasta_hpp
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+
+#include "reference_reader.hpp"
+
+namespace octopus {
+
+class GenomicRegion;
+
+namespace io {
+
+/*
+ ShardedCachingFasta is a thread safe cache designed for many concurrent readers. Contigs are cut
+ into fixed size chunks, and each chunk is assigned to one of several independent shards. Cached
+ chunks are immutable and shared, so a cache hit only takes a shard's read lock to copy a pointer;
+ recency is tracked with a per-chunk reference bit (CLOCK eviction) rather than by moving list nodes.
+ Each shard reads misses through its own clone of the underlying reader, so misses in different
+ shards do not serialise on one file handle either.
+
+ Hit rates and lock contention are written to the debug log when the object is destroyed.
+ */
+class ShardedCachingFasta : public ReferenceReader
+{
+public:
+    using ContigName          = ReferenceReader::ContigName;
+    using GenomicSize         = ReferenceReader::GenomicSize;
+    using GeneticSequence     = ReferenceReader::GeneticSequence;
+    using GeneticSequenceView = ReferenceReader::GeneticSequenceView;
+
+    ShardedCachingFasta() = delete;
+
+    ShardedCachingFasta(std::unique_ptr<ReferenceReader> fasta, GenomicSize max_cache_size, unsigned num_shards);
+
+    ShardedCachingFasta(const ShardedCachingFasta&);
+    ShardedCachingFasta& operator=(const ShardedCachingFasta&) = delete;
+    ShardedCachingFasta(ShardedCachingFasta&&)                 = default;
+    ShardedCachingFasta& operator=(ShardedCachingFasta&&)      = default;
+
+    ~ShardedCachingFasta() override;
+
+private:
+    using Chunk = std::shared_ptr<const GeneticSequence>;
+
+    struct ChunkKey
+    {
+        ContigName contig;
+        GenomicSize index;
+    };
+    struct ChunkKeyHash
+    {
+        std::size_t operator()(const ChunkKey& key) const noexcept;
+    };
+    struct ChunkKeyEqual
+    {
+        bool operator()(const ChunkKey& lhs, const ChunkKey& rhs) const noexcept;
+    };
+
+    struct CachedChunk
+    {
+        CachedChunk(Chunk sequence) : sequence {std::move(sequence)}, referenced {true} {}
+        Chunk sequence;
+        mutable std::atomic<bool> referenced;
+    };
+
+    struct Shard
+    {
+        std::unique_ptr<ReferenceReader> reader;
+        std::mutex reader_mutex;
+        std::unordered_map<ChunkKey, CachedChunk, ChunkKeyHash, ChunkKeyEqual> chunks;
+        std::deque<ChunkKey> clock; // insertion order, for second chance eviction
+        mutable std::shared_timed_mutex mutex;
+        std::atomic<std::size_t> hits, misses, contended;
+    };
+
+    std::unique_ptr<ReferenceReader> fasta_;
+    std::unordered_map<ContigName, GenomicSize> contig_sizes_;
+    GenomicSize max_cache_size_, chunk_size_;
+    std::size_t max_chunks_per_shard_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    std::unique_ptr<ReferenceReader> do_clone() const override;
+    bool do_is_open() const noexcept override;
+    std::string do_fetch_reference_name() const override;
+    std::vector<ContigName> do_fetch_contig_names() const override;
+    GenomicSize do_fetch_contig_size(const ContigName& contig) const override;
+    GeneticSequence do_fetch_sequence(const GenomicRegion& region) const override;
+    GeneticSequenceView do_fetch_sequence_view(const GenomicRegion& region) const override;
+
+    void make_shards();
+    Shard& shard(const ChunkKey& key) const noexcept;
+    Chunk get_chunk(const ChunkKey& key) const;
+    Chunk find_chunk(Shard& shard, const ChunkKey& key) const;
+    Chunk fetch_chunk(Shard& shard, const ChunkKey& key) const;
+    void add_chunk(Shard& shard, const ChunkKey& key, Chunk& chunk) const;
+    GeneticSequence read(Shard& shard, const GenomicRegion& region) const;
+    void report_usage() const;
+};
+
+} // namespace io
+} // namespace octopus
+
+#endif
@@ -38,6 +38,15 @@ bool is_missing(const std::string& value) noexcept
     return value == bcf_missing_str;
 }
 
+// Stops htslib parsing sample columns, which dominate the cost of reading files with many samples.
+// Must be called before any records are read.
+void exclude_samples(bcf_srs_t* sr, const IVcfReaderImpl::UnpackPolicy level)
+{
+    if (level != IVcfReaderImpl::UnpackPolicy::all) {
+        bcf_hdr_set_samples(sr->readers[0].header, nullptr, 0);
+    }
+}
+
 namespace bc = boost::container;
 
 } // namespace
@@ -63,7 +72,8 @@ std::vector<std::string> extract_samples(const bcf_hdr_t* header)
 
 // public methods
 
-std::string get_hts_mode(const HtslibBcfFacade::Path& file_path, const HtslibBcfFacade::Mode mode)
+std::string get_hts_mode(const HtslibBcfFacade::Path& file_path, const HtslibBcfFacade::Mode mode,
+                         const boost::optional<int> compression_level = boost::none)
 {
     std::string result {"["};
     using Mode = HtslibBcfFacade::Mode;
@@ -78,7 +88,10 @@ std::string get_hts_mode(const HtslibBcfFacade::Path& file_path, const HtslibBcf
             result += "b";
         } else if (extension == ".gz" && file_path.stem().extension() == ".vcf") {
             result += "z";
+        } else {
+            return result;
         }
+        if (compression_level) result += std::to_string(*compression_level);
     }
     return result;
 }
@@ -88,6 +101,9 @@ HtslibBcfFacade::HtslibBcfFacade()
 , file_ {bcf_open("-", "[w]"), HtsFileDeleter {}}
 , header_ {bcf_hdr_init("w"), HtsHeaderDeleter {}}
 , samples_ {}
+, write_buffer_ {nullptr, HtsBcf1Deleter {}}
+, selected_info_ {}
+, selected_format_ {}
 {
     if (file_ == nullptr) {
         throw std::runtime_error {"HtslibBcfFacade: could not open stdout writer"};
@@ -97,13 +113,16 @@ HtslibBcfFacade::HtslibBcfFacade()
     }
 }
 
-HtslibBcfFacade::HtslibBcfFacade(Path file_path, Mode mode)
+HtslibBcfFacade::HtslibBcfFacade(Path file_path, Mode mode, boost::optional<int> compression_level)
 : file_path_ {std::move(file_path)}
 , file_ {nullptr, HtsFileDeleter {}}
 , header_ {nullptr, HtsHeaderDeleter {}}
 , samples_ {}
+, write_buffer_ {nullptr, HtsBcf1Deleter {}}
+, selected_info_ {}
+, selected_format_ {}
 {
-    const auto hts_mode = get_hts_mode(file_path_, mode);
+    const auto hts_mode = get_hts_mode(file_path_, mode, compression_level);
     if (mode == Mode::read) {
         if (boost::filesystem::exists(file_path_)) {
             file_.reset(bcf_open(file_path_.c_str(), hts_mode.c_str()));
@@ -225,6 +244,7 @@ HtslibBcfFacade::RecordIteratorPtrPair HtslibBcfFacade::iterate(const UnpackPoli
             throw std::runtime_error {"failed to open file " + file_path_.string()};
         }
     }
+    exclude_samples(sr.get(), level);
     return std::make_pair(std::make_unique<RecordIterator>(*this, std::move(sr), level),
                           std::make_unique<RecordIterator>(*this));
 }
@@ -245,6 +265,7 @@ HtslibBcfFacade::iterate(const std::string& contig, const UnpackPolicy level) co
             throw std::runtime_error {"failed to open file " + file_path_.string()};
         }
     }
+    exclude_samples(sr.get(), level);
     return std::make_pair(std::make_unique<RecordIterator>(*this, std::move(sr), level),
                           std::make_unique<RecordIterator>(*this));
 }
@@ -266,6 +287,7 @@ HtslibBcfFacade::iterate(const GenomicRegion& region, const UnpackPolicy level)
             throw std::runtime_error {"failed to open file " + file_path_.string()};
         }
     }
+    exclude_samples(sr.get(), level);
     return std::make_pair(std::make_unique<RecordIterator>(*this, std::move(sr), level),
                           std::make_unique<RecordIterator>(*this));
 }
@@ -280,6 +302,7 @@ HtslibBcfFacade::fetch_records(const UnpackPolicy level) const
         sr.release();
         throw std::runtime_error {"failed to open file " + file_path_.string()};
     }
+    exclude_samples(sr.get(), level);
     return fetch_records(sr.get(), level, n_records);
 }
 
@@ -296,6 +319,7 @@ HtslibBcfFacade::fetch_records(const std::string& contig, const UnpackPolicy lev
         sr.release();
         throw std::runtime_error {"failed to open file " + file_path_.string()};
     }
+    exclude_samples(sr.get(), level);
     return fetch_records(sr.get(), level, n_records);
 }
 
@@ -313,6 +337,7 @@ HtslibBcfFacade::fetch_records(const GenomicRegion& region, const UnpackPolicy l
         sr.release();
         throw std::runtime_error {"failed to open file " + file_path_.string()};
     }
+    exclude_samples(sr.get(), level);
     return fetch_records(sr.get(), level, n_records);
 }
 
@@ -403,6 +428,44 @@ void set_info(const bcf_hdr_t* header, bcf1_t* dest, const VcfRecord& source);
 void set_samples(const bcf_hdr_t* header, bcf1_t* dest, const VcfRecord& source,
                  const std::vector<std::string>& samples);
 
+namespace {
+
+boost::optional<std::vector<int>>
+get_header_ids(const bcf_hdr_t* header, const boost::optional<std::vector<std::string>>& keys)
+{
+    if (!keys) return boost::none;
+    std::vector<int> result {};
+    result.reserve(keys->size());
+    for (const auto& key : *keys) {
+        const auto id = bcf_hdr_id2int(header, BCF_DT_ID, key.c_str());
+        if (id >= 0) result.push_back(id);
+    }
+    std::sort(std::begin(result), std::end(result));
+    return result;
+}
+
+bool is_selected(const int key_id, const boost::optional<std::vector<int>>& selection) noexcept
+{
+    return !selection || std::binary_search(std::cbegin(*selection), std::cend(*selection), key_id);
+}
+
+} // namespace
+
+void HtslibBcfFacade::select_fields(FieldSelection fields)
+{
+    if (header_ == nullptr) return;
+    selected_info_ = get_header_ids(header_.get(), fields.info);
+    selected_format_ = get_header_ids(header_.get(), fields.format);
+}
+
+void HtslibBcfFacade::set_compression_threads(const unsigned num_threads)
+{
+    if (file_ && num_threads > 1) {
+        // Failure just means blocks are compressed on the writing thread
+        hts_set_threads(file_.get(), static_cast<int>(num_threads));
+    }
+}
+
 void HtslibBcfFacade::write(const VcfRecord& record)
 {
     if (file_ == nullptr) {
@@ -418,7 +481,13 @@ void HtslibBcfFacade::write(const VcfRecord& record)
         throw std::runtime_error {"HtslibBcfFacade: required contig header line missing for contig \"" + contig + "\""};
     }
     
-    auto hts_record = bcf_init();
+    // The record buffer is cleared rather than reallocated, so its field storage is reused between writes
+    if (write_buffer_) {
+        bcf_clear(write_buffer_.get());
+    } else {
+        write_buffer_.reset(bcf_init());
+    }
+    auto hts_record = write_buffer_.get();
     set_chrom(header_.get(), hts_record, contig);
     set_pos(hts_record, record.pos() - 1);
     set_id(hts_record, record.id());
@@ -434,7 +503,6 @@ void HtslibBcfFacade::write(const VcfRecord& record)
     if (bcf_write(file_.get(), header_.get(), hts_record) < 0) {
         throw std::runtime_error {"HtslibBcfFacade: record write failed"};
     }
-    bcf_destroy(hts_record);
 }
 
 // HtslibBcfFacade::RecordIterator
@@ -595,7 +663,8 @@ void set_filter(const bcf_hdr_t* header, bcf1_t* record, const std::vector<std::
     }
 }
 
-void extract_info(const bcf_hdr_t* header, bcf1_t* record, VcfRecord::Builder& builder)
+void extract_info(const bcf_hdr_t* header, bcf1_t* record, VcfRecord::Builder& builder,
+                  const boost::optional<std::vector<int>>& selection)
 {
     int* intinfo {nullptr};
     float* floatinfo {nullptr};
@@ -608,6 +677,7 @@ void extract_info(const bcf_hdr_t* header, bcf1_t* record, VcfRecord::Builder& b
         if (key_id >= header->n[BCF_DT_ID]) {
             throw std::runtime_error {"HtslibBcfFacade: found INFO key not present in header file"};
         }
+        if (!is_selected(key_id, selection)) continue;
         const char* key {header->id[BCF_DT_ID][key_id].key};
         std::vector<std::string> values {};
         switch (bcf_hdr_id2type(header, BCF_HL_INFO, key_id)) {
@@ -706,7 +776,7 @@ bool has_samples(const bcf_hdr_t* header)
     return bcf_hdr_nsamples(header) > 0;
 }
 
-auto extract_format(const bcf_hdr_t* header, const bcf1_t* record)
+auto extract_format(const bcf_hdr_t* header, const bcf1_t* record, const boost::optional<std::vector<int>>& selection)
 {
     std::vector<VcfRecord::KeyType> result {};
     result.reserve(record->n_fmt);
@@ -715,14 +785,18 @@ auto extract_format(const bcf_hdr_t* header, const bcf1_t* record)
         if (key_id >= header->n[BCF_DT_ID]) {
             throw std::runtime_error {"HtslibBcfFacade: found FORMAT key not present in header file"};
         }
-        result.emplace_back(header->id[BCF_DT_ID][key_id].key);
+        if (is_selected(key_id, selection)) {
+            result.emplace_back(header->id[BCF_DT_ID][key_id].key);
+        }
     }
     return result;
 }
 
-void extract_samples(const bcf_hdr_t* header, bcf1_t* record, VcfRecord::Builder& builder)
+void extract_samples(const bcf_hdr_t* header, bcf1_t* record, VcfRecord::Builder& builder,
+                     const boost::optional<std::vector<int>>& selection)
 {
-    auto format = extract_format(header, record);
+    auto format = extract_format(header, record, selection);
+    if (format.empty()) return;
     const auto num_samples = record->n_sample;
     builder.reserve_samples(num_samples);
     auto first_format = std::cbegin(format);
@@ -831,15 +905,6 @@ auto genotype_number(const T& allele, const Container& alleles, const bool is_ph
     return (is_phased) ? allele_num + 1 : allele_num;
 }
 
-auto max_format_cardinality(const VcfRecord& record, const VcfRecord::KeyType& key, const std::vector<std::string>& samples)
-{
-    std::size_t result {0};
-    for (const auto& sample : samples) {
-        result = std::max(result, record.get_sample_value(sample, key).size());
-    }
-    return result;
-}
-
 float get_bcf_float_pad() noexcept
 {
     float result;
@@ -884,14 +949,18 @@ void set_samples(const bcf_hdr_t* header, bcf1_t* dest, const VcfRecord& source,
     }
     std::vector<std::string> str_buffer {};
     std::for_each(first_format, std::cend(format), [&] (const auto& key) {
-        const auto key_cardinality = source.format_cardinality(key);
-        int num_values {};
-        if (key_cardinality) {
-            num_values = *key_cardinality * num_samples;
-        } else {
-            num_values = max_format_cardinality(source, key, samples) * num_samples;
+        // Each sample's values are looked up once per key, and the key's cardinality is found in the same pass
+        const auto sample_values = source.get_sample_values(samples, key);
+        std::size_t num_values_per_sample {0};
+        bool is_fixed_cardinality {true};
+        for (const auto& values : sample_values) {
+            const auto num_sample_values = values.get().size();
+            if (num_sample_values != num_values_per_sample && &values != &sample_values.front()) {
+                is_fixed_cardinality = false;
+            }
+            num_values_per_sample = std::max(num_values_per_sample, num_sample_values);
         }
-        const auto num_values_per_sample = static_cast<std::size_t>(num_values / num_samples);
+        int num_values {static_cast<int>(num_values_per_sample) * num_samples};
         static constexpr std::size_t defaultValueCapacity {1'000};
         switch (bcf_hdr_id2type(header, BCF_HL_FMT, bcf_hdr_id2int(header, BCF_DT_ID, key.c_str()))) {
           case BCF_HT_INT:
@@ -899,8 +968,8 @@ void set_samples(const bcf_hdr_t* header, bcf1_t* dest, const VcfRecord& source,
               static const int pad {bcf_int32_vector_end};
               bc::small_vector<int, defaultValueCapacity> typed_values(num_values);
               auto value_itr = std::begin(typed_values);
-              for (const auto& sample : samples) {
-                  const auto& values = source.get_sample_value(sample, key);
+              for (const auto& values_ref : sample_values) {
+                  const auto& values = values_ref.get();
                   value_itr = std::transform(std::cbegin(values), std::cend(values), value_itr,
                                              [] (const auto& v) { return !is_missing(v) ? std::stoi(v) : bcf_int32_missing; });
                   assert(values.size() <= num_values_per_sample);
@@ -914,8 +983,8 @@ void set_samples(const bcf_hdr_t* header, bcf1_t* dest, const VcfRecord& source,
               static const float pad {get_bcf_float_pad()};
               bc::small_vector<float, defaultValueCapacity> typed_values(num_values);
               auto value_itr = std::begin(typed_values);
-              for (const auto& sample : samples) {
-                  const auto& values = source.get_sample_value(sample, key);
+              for (const auto& values_ref : sample_values) {
+                  const auto& values = values_ref.get();
                   value_itr = std::transform(std::cbegin(values), std::cend(values), value_itr,
                                              [] (const auto& v) { return !is_missing(v) ? std::stof(v) : get_bcf_float_missing(); });
                   assert(values.size() <= num_values_per_sample);
@@ -927,19 +996,19 @@ void set_samples(const bcf_hdr_t* header, bcf1_t* dest, const VcfRecord& source,
           case BCF_HT_STR:
           {
               bc::small_vector<const char*, defaultValueCapacity> typed_values;
-              if (key_cardinality && *key_cardinality <= 1) {
+              if (is_fixed_cardinality && num_values_per_sample <= 1) {
                   typed_values.resize(num_values);
                   auto value_itr = std::begin(typed_values);
-                  for (const auto& sample : samples) {
-                      const auto& values = source.get_sample_value(sample, key);
+                  for (const auto& values_ref : sample_values) {
+                      const auto& values = values_ref.get();
                       value_itr = std::transform(std::cbegin(values), std::cend(values), value_itr,
                                                  [] (const auto& value) { return value.c_str(); });
                   }
               } else {
                   str_buffer.clear();
                   str_buffer.reserve(num_samples);
-                  for (const auto& sample : samples) {
-                      str_buffer.push_back(utils::join(source.get_sample_value(sample, key), vcfspec::format::valueSeperator));
+                  for (const auto& values : sample_values) {
+                      str_buffer.push_back(utils::join(values.get(), vcfspec::format::valueSeperator));
                   }
                   num_values = num_samples;
                   typed_values.resize(num_values);
@@ -969,7 +1038,13 @@ std::size_t HtslibBcfFacade::count_records(HtsBcfSrPtr& sr) const
 VcfRecord HtslibBcfFacade::fetch_record(const bcf_srs_t* sr, UnpackPolicy level) const
 {
     auto hts_record = bcf_sr_get_line(sr, 0);
-    bcf_unpack(hts_record, level == UnpackPolicy::all ? BCF_UN_ALL : BCF_UN_SHR);
+    switch (level) {
+        case UnpackPolicy::all:
+            bcf_unpack(hts_record, selected_format_ && selected_format_->empty() ? BCF_UN_SHR : BCF_UN_ALL);
+            break;
+        case UnpackPolicy::sites: bcf_unpack(hts_record, BCF_UN_SHR); break;
+        case UnpackPolicy::minimal: bcf_unpack(hts_record, BCF_UN_FLT); break;
+    }
     VcfRecord::Builder record_builder {};
     extract_chrom(header_.get(), hts_record, record_builder);
     extract_pos(hts_record, record_builder);
@@ -978,9 +1053,11 @@ VcfRecord HtslibBcfFacade::fetch_record(const bcf_srs_t* sr, UnpackPolicy level)
     extract_alt(hts_record, record_builder);
     extract_qual(hts_record, record_builder);
     extract_filter(header_.get(), hts_record, record_builder);
-    extract_info(header_.get(), hts_record, record_builder);
+    if (level != UnpackPolicy::minimal) {
+        extract_info(header_.get(), hts_record, record_builder, selected_info_);
+    }
     if (level == UnpackPolicy::all && has_samples(header_.get())) {
-        extract_samples(header_.get(), hts_record, record_builder);
+        extract_samples(header_.get(), hts_record, record_builder, selected_format_);
     }
     return record_builder.build_once();
 }
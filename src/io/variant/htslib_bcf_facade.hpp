@@ -11,6 +11,7 @@
 #include <iterator>
 
 #include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
 
 #include "htslib/hts.h"
 #include "htslib/vcf.h"
@@ -36,7 +37,8 @@ public:
     enum class Mode { read, write, append };
     
     HtslibBcfFacade(); // write only, goes to stdout
-    HtslibBcfFacade(Path file_path, Mode mode = Mode::read);
+    // compression_level is the BGZF level of compressed output, or none for the htslib default
+    HtslibBcfFacade(Path file_path, Mode mode = Mode::read, boost::optional<int> compression_level = boost::none);
     
     HtslibBcfFacade(const HtslibBcfFacade&)            = delete;
     HtslibBcfFacade& operator=(const HtslibBcfFacade&) = delete;
@@ -61,9 +63,14 @@ public:
     RecordContainer fetch_records(const std::string& contig, UnpackPolicy level) const override;
     RecordContainer fetch_records(const GenomicRegion& region, UnpackPolicy level) const override;
     
+    void select_fields(FieldSelection fields) override;
+    
     void write(const VcfHeader& header);
     void write(const VcfRecord& record);
     
+    // Compresses output with num_threads htslib threads. Has no effect on uncompressed output.
+    void set_compression_threads(unsigned num_threads);
+    
 private:
     struct HtsFileDeleter
     {
@@ -89,6 +96,8 @@ private:
     std::unique_ptr<htsFile, HtsFileDeleter> file_;
     std::unique_ptr<bcf_hdr_t, HtsHeaderDeleter> header_;
     std::vector<std::string> samples_;
+    HtsBcf1Ptr write_buffer_; // reused for every written record
+    boost::optional<std::vector<int>> selected_info_, selected_format_; // sorted header ids
     
     bool is_bcf() const noexcept;
     std::size_t count_records(HtsBcfSrPtr& sr) const;
@@ -106,6 +106,7 @@ bool operator==(const VcfReader::RecordIterator& lhs, const VcfReader::RecordIte
 VcfReader::VcfReader(Path file_path)
 : file_path_ {std::move(file_path)}
 , reader_ {make_vcf_reader(file_path_)}
+, selected_fields_ {}
 {}
 
 VcfReader::VcfReader(VcfReader&& other)
@@ -113,6 +114,7 @@ VcfReader::VcfReader(VcfReader&& other)
     std::lock_guard<std::mutex> lock {other.mutex_};
     file_path_ = std::move(other.file_path_);
     reader_  = std::move(other.reader_);
+    selected_fields_ = std::move(other.selected_fields_);
 }
 
 VcfReader& VcfReader::operator=(VcfReader&& other)
@@ -122,6 +124,7 @@ VcfReader& VcfReader::operator=(VcfReader&& other)
         std::lock(lock_lhs, lock_rhs);
         file_path_ = std::move(other.file_path_);
         reader_    = std::move(other.reader_);
+        selected_fields_ = std::move(other.selected_fields_);
     }
     return *this;
 }
@@ -134,6 +137,7 @@ void swap(VcfReader& lhs, VcfReader& rhs) noexcept
     using std::swap;
     swap(lhs.file_path_, rhs.file_path_);
     swap(lhs.reader_, rhs.reader_);
+    swap(lhs.selected_fields_, rhs.selected_fields_);
 }
 
 bool VcfReader::is_open() const noexcept
@@ -146,6 +150,7 @@ void VcfReader::open() noexcept
 {
     std::lock_guard<std::mutex> lock {mutex_};
     reader_ = make_vcf_reader(file_path_);
+    reader_->select_fields(selected_fields_);
 }
 
 void VcfReader::close() noexcept
@@ -222,6 +227,13 @@ VcfReader::RecordIteratorPair VcfReader::iterate(const GenomicRegion& region, co
     return std::make_pair(std::move(p.first), std::move(p.second));
 }
 
+void VcfReader::select_fields(FieldSelection fields)
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    selected_fields_ = std::move(fields);
+    if (reader_) reader_->select_fields(selected_fields_);
+}
+
 // non member methods
 
 bool operator==(const VcfReader& lhs, const VcfReader& rhs)
@@ -30,6 +30,7 @@ public:
     using Path = boost::filesystem::path;
     using UnpackPolicy = IVcfReaderImpl::UnpackPolicy;
     using RecordContainer = IVcfReaderImpl::RecordContainer;
+    using FieldSelection = IVcfReaderImpl::FieldSelection;
     
     class RecordIterator;
     using RecordIteratorPair = std::pair<RecordIterator, RecordIterator>;
@@ -67,9 +68,14 @@ public:
     RecordIteratorPair iterate(const std::string& contig, UnpackPolicy level = UnpackPolicy::all) const;
     RecordIteratorPair iterate(const GenomicRegion& region, UnpackPolicy level = UnpackPolicy::all) const;
     
+    // Records only need to contain the selected INFO and FORMAT fields, so the rest need not be decoded.
+    // The selection persists if the reader is closed and reopened.
+    void select_fields(FieldSelection fields);
+    
 private:
     Path file_path_;
     std::unique_ptr<IVcfReaderImpl> reader_;
+    FieldSelection selected_fields_;
     
     mutable std::mutex mutex_;
 };
@@ -10,6 +10,8 @@
 #include <memory>
 #include <utility>
 
+#include <boost/optional.hpp>
+
 namespace octopus {
 
 class GenomicRegion;
@@ -19,10 +21,17 @@ class VcfRecord;
 class IVcfReaderImpl
 {
 public:
-    enum class UnpackPolicy { all, sites };
+    // sites skips samples, and minimal also skips INFO
+    enum class UnpackPolicy { all, sites, minimal };
     
     using RecordContainer = std::vector<VcfRecord>;
     
+    // The INFO and FORMAT keys that unpacked records need to contain; none means all keys
+    struct FieldSelection
+    {
+        boost::optional<std::vector<std::string>> info = boost::none, format = boost::none;
+    };
+    
     class RecordIterator
     {
     public:
@@ -61,6 +70,9 @@ public:
     virtual RecordIteratorPtrPair iterate(const std::string& contig, UnpackPolicy level) const  = 0;
     virtual RecordIteratorPtrPair iterate(const GenomicRegion& region, UnpackPolicy level) const = 0;
     
+    // Applies to all subsequent fetches. Implementations may decode more fields than selected.
+    virtual void select_fields(FieldSelection fields) {}
+    
     virtual ~IVcfReaderImpl() noexcept = default;
 };
 
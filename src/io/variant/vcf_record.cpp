@@ -177,6 +177,19 @@ const std::vector<VcfRecord::ValueType>& VcfRecord::get_sample_value(const Sampl
     return (key == vcfspec::format::genotype) ? genotypes_.at(sample).first : samples_.at(sample).at(key);
 }
 
+std::vector<std::reference_wrapper<const std::vector<VcfRecord::ValueType>>>
+VcfRecord::get_sample_values(const std::vector<SampleName>& samples, const KeyType& key) const
+{
+    std::vector<std::reference_wrapper<const std::vector<ValueType>>> result {};
+    result.reserve(samples.size());
+    if (key == vcfspec::format::genotype) {
+        for (const auto& sample : samples) result.emplace_back(genotypes_.at(sample).first);
+    } else {
+        for (const auto& sample : samples) result.emplace_back(samples_.at(sample).at(key));
+    }
+    return result;
+}
+
 // helper non-members needed for printing
 
 namespace {
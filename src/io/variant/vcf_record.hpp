@@ -96,6 +96,9 @@ public:
     bool has_ref_allele(const SampleName& sample) const;
     bool has_alt_allele(const SampleName& sample) const;
     const std::vector<ValueType>& get_sample_value(const SampleName& sample, const KeyType& key) const;
+    // The values of key for each of samples, in order
+    std::vector<std::reference_wrapper<const std::vector<ValueType>>>
+    get_sample_values(const std::vector<SampleName>& samples, const KeyType& key) const;
     
     friend std::ostream& operator<<(std::ostream& os, const VcfRecord& record);
     friend Builder;
@@ -5,6 +5,8 @@
 
 #include <unordered_map>
 #include <deque>
+#include <array>
+#include <memory>
 #include <queue>
 #include <unordered_set>
 #include <iterator>
@@ -12,9 +14,16 @@
 #include <functional>
 #include <stdexcept>
 #include <numeric>
+#include <cstring>
+#include <cstdint>
+#include <ios>
+#include <future>
+
+#include <boost/filesystem/operations.hpp>
 
 #include "htslib/vcf.h"
 #include "htslib/tbx.h"
+#include "htslib/bgzf.h"
 
 #include "basics/contig_region.hpp"
 #include "basics/genomic_region.hpp"
@@ -57,7 +66,7 @@ bool is_indexable(const boost::filesystem::path& vcf_path)
     return extension == ".bcf" || extension == ".gz";
 }
 
-void index_vcf(const boost::filesystem::path& vcf_path)
+void index_vcf(const boost::filesystem::path& vcf_path, const unsigned num_threads)
 {
     auto* const fp = hts_open(vcf_path.c_str(), "r");
     if (fp == nullptr) {
@@ -65,11 +74,21 @@ void index_vcf(const boost::filesystem::path& vcf_path)
     }
     const auto type = *hts_get_format(fp);
     hts_close(fp);
+#if defined(HTS_VERSION) && HTS_VERSION >= 101000
+    // Threads decompress the file being indexed
+    const auto n_threads = static_cast<int>(num_threads);
+    if (type.format == bcf) {
+        bcf_index_build3(vcf_path.c_str(), nullptr, 14, n_threads);
+    } else {
+        tbx_index_build3(vcf_path.c_str(), nullptr, 0, n_threads, &tbx_conf_vcf);
+    }
+#else
     if (type.format == bcf) {
         bcf_index_build(vcf_path.c_str(), 14);
     } else {
         tbx_index_build(vcf_path.c_str(), 0, &tbx_conf_vcf);
     }
+#endif
 }
 
 void index_vcf(const VcfReader& reader)
@@ -445,6 +464,142 @@ void merge(std::vector<VcfReader>& sources, VcfWriter& dst)
 
 namespace {
 
+struct BgzfDeleter
+{
+    void operator()(BGZF* fp) const noexcept { bgzf_close(fp); }
+};
+
+using BgzfPtr = std::unique_ptr<BGZF, BgzfDeleter>;
+
+struct BcfHeaderDeleter
+{
+    void operator()(bcf_hdr_t* header) const noexcept { bcf_hdr_destroy(header); }
+};
+
+using BcfHeaderPtr = std::unique_ptr<bcf_hdr_t, BcfHeaderDeleter>;
+
+BgzfPtr open_bgzf(const boost::filesystem::path& path, const char* mode)
+{
+    BgzfPtr result {bgzf_open(path.c_str(), mode)};
+    if (!result) {
+        throw std::ios::failure {path.string()};
+    }
+    return result;
+}
+
+// The magic string and little-endian text length precede the header text
+constexpr std::size_t rawBcfHeaderPrefixLength {9};
+
+// Leaves the file positioned at the first record
+std::string read_raw_bcf_header(BGZF* fp, const boost::filesystem::path& path)
+{
+    std::string result(rawBcfHeaderPrefixLength, '\0');
+    if (bgzf_read(fp, &result[0], rawBcfHeaderPrefixLength) != static_cast<ssize_t>(rawBcfHeaderPrefixLength)
+        || result.compare(0, 5, "BCF\2\2") != 0) {
+        throw std::runtime_error {"concatenate_naive: " + path.string() + " is not a BCF file"};
+    }
+    std::uint32_t text_length {0};
+    for (int i {3}; i >= 0; --i) {
+        text_length = (text_length << 8) | static_cast<unsigned char>(result[5 + i]);
+    }
+    result.resize(rawBcfHeaderPrefixLength + text_length);
+    if (bgzf_read(fp, &result[rawBcfHeaderPrefixLength], text_length) != static_cast<ssize_t>(text_length)) {
+        throw std::runtime_error {"concatenate_naive: could not read the header of " + path.string()};
+    }
+    return result;
+}
+
+BcfHeaderPtr parse_raw_bcf_header(std::string raw_header)
+{
+    BcfHeaderPtr result {bcf_hdr_init("r")};
+    raw_header.push_back('\0');
+    bcf_hdr_parse(result.get(), &raw_header[rawBcfHeaderPrefixLength]);
+    return result;
+}
+
+// Records only refer to header lines by their dictionary index
+bool have_same_dictionaries(const bcf_hdr_t* lhs, const bcf_hdr_t* rhs)
+{
+    for (const int type : {BCF_DT_ID, BCF_DT_CTG, BCF_DT_SAMPLE}) {
+        if (lhs->n[type] != rhs->n[type]) return false;
+        for (int i {0}; i < lhs->n[type]; ++i) {
+            if (std::strcmp(lhs->id[type][i].key, rhs->id[type][i].key) != 0) return false;
+        }
+    }
+    return true;
+}
+
+// Copies the remaining compressed blocks of src to dst, except the end-of-file marker
+void copy_raw_blocks(BGZF* src, BGZF* dst, const boost::filesystem::path& path)
+{
+    static constexpr std::array<char, 28> eofMarker {{
+        '\37', '\213', '\10', '\4', '\0', '\0', '\0', '\0', '\0', '\377', '\6', '\0', '\102', '\103',
+        '\2', '\0', '\33', '\0', '\3', '\0', '\0', '\0', '\0', '\0', '\0', '\0', '\0', '\0'
+    }};
+    static constexpr std::size_t bufferSize {1 << 16};
+    const auto copy_error = [&path] () { return std::runtime_error {"concatenate_naive: could not copy records from " + path.string()}; };
+    // Records decompressed along with the header must be recompressed
+    const auto num_decompressed = src->block_length - src->block_offset;
+    if (num_decompressed > 0) {
+        const auto first = static_cast<const char*>(src->uncompressed_block) + src->block_offset;
+        if (bgzf_write(dst, first, num_decompressed) != num_decompressed) throw copy_error();
+    }
+    if (bgzf_flush(dst) != 0) throw copy_error();
+    std::vector<char> buffer(bufferSize + eofMarker.size());
+    std::size_t num_held {0}; // the last bytes read, which may be the end-of-file marker
+    while (true) {
+        const auto num_read = bgzf_raw_read(src, buffer.data() + num_held, bufferSize);
+        if (num_read < 0) throw copy_error();
+        if (num_read == 0) break;
+        const auto num_available = num_held + static_cast<std::size_t>(num_read);
+        const auto num_writable = num_available > eofMarker.size() ? num_available - eofMarker.size() : std::size_t {0};
+        if (num_writable > 0) {
+            if (bgzf_raw_write(dst, buffer.data(), num_writable) != static_cast<ssize_t>(num_writable)) throw copy_error();
+            std::copy(buffer.data() + num_writable, buffer.data() + num_available, buffer.data());
+        }
+        num_held = num_available - num_writable;
+    }
+    const bool is_eof_marker {num_held == eofMarker.size() && std::equal(std::cbegin(eofMarker), std::cend(eofMarker), buffer.data())};
+    if (num_held > 0 && !is_eof_marker) {
+        if (bgzf_raw_write(dst, buffer.data(), num_held) != static_cast<ssize_t>(num_held)) throw copy_error();
+    }
+}
+
+} // namespace
+
+void concatenate_naive(const std::vector<boost::filesystem::path>& sources, const boost::filesystem::path& dst)
+{
+    auto concatenated = dst;
+    concatenated += ".concat";
+    {
+        auto header_src = open_bgzf(dst, "r");
+        const auto raw_header = read_raw_bcf_header(header_src.get(), dst);
+        char c;
+        if (bgzf_read(header_src.get(), &c, 1) != 0) {
+            throw std::runtime_error {"concatenate_naive: " + dst.string() + " already contains records"};
+        }
+        const auto header = parse_raw_bcf_header(raw_header);
+        auto out = open_bgzf(concatenated, "w");
+        if (bgzf_write(out.get(), raw_header.data(), raw_header.size()) != static_cast<ssize_t>(raw_header.size())) {
+            throw std::ios::failure {concatenated.string()};
+        }
+        for (const auto& source : sources) {
+            auto in = open_bgzf(source, "r");
+            const auto source_header = parse_raw_bcf_header(read_raw_bcf_header(in.get(), source));
+            if (!have_same_dictionaries(header.get(), source_header.get())) {
+                throw std::runtime_error {"concatenate_naive: the header of " + source.string() + " does not match " + dst.string()};
+            }
+            copy_raw_blocks(in.get(), out.get(), source);
+        }
+        if (bgzf_close(out.release()) != 0) {
+            throw std::ios::failure {concatenated.string()};
+        }
+    }
+    boost::filesystem::rename(concatenated, dst);
+}
+
+namespace {
+
 VcfHeader to_legacy(const VcfHeader& native)
 {
     return VcfHeader::Builder(native).set_file_format("VCFv4.2").build_once();
@@ -495,11 +650,12 @@ VcfRecord convert_to_legacy(const VcfRecord& record, const std::vector<std::stri
     return cb.build_once();
 }
 
-void convert_to_legacy_keep_all(const VcfReader& src, VcfWriter& dst)
+template <typename RecordIterator, typename Writer>
+void convert_to_legacy_keep_all(RecordIterator first, RecordIterator last, const std::vector<std::string>& samples,
+                                Writer&& write)
 {
-    const auto samples = src.fetch_header().samples();
-    for (auto p = src.iterate(); p.first != p.second; ++p.first) {
-        dst << convert_to_legacy(*p.first, samples);
+    for (; first != last; ++first) {
+        write(convert_to_legacy(*first, samples));
     }
 }
 
@@ -589,34 +745,85 @@ bool is_lhs_ref_flank_snv_duplicate(const VcfRecord& lhs, const VcfRecord& rhs,
     return result;
 }
 
-void convert_to_legacy_dedup(const VcfReader& src, VcfWriter& dst)
+template <typename RecordIterator, typename Writer>
+void convert_to_legacy_dedup(RecordIterator first, RecordIterator last, const std::vector<std::string>& samples,
+                             Writer&& write)
 {
-    auto p = src.iterate();
-    if (p.first == p.second) return;
-    const auto samples = src.fetch_header().samples();
-    VcfRecord prev_record {*p.first};
-    ++p.first;
-    for (; p.first != p.second; ++p.first) {
-        const auto& record = *p.first;
+    if (first == last) return;
+    VcfRecord prev_record {*first};
+    ++first;
+    for (; first != last; ++first) {
+        const auto& record = *first;
         if (record != prev_record && !is_lhs_ref_flank_snv_duplicate(prev_record, record, samples)) {
-            dst << convert_to_legacy(prev_record, samples);
+            write(convert_to_legacy(prev_record, samples));
         }
         prev_record = record;
     }
-    dst << convert_to_legacy(prev_record, samples);
+    write(convert_to_legacy(prev_record, samples));
+}
+
+template <typename RecordIterator, typename Writer>
+void convert_to_legacy(RecordIterator first, RecordIterator last, const std::vector<std::string>& samples,
+                       const bool remove_ref_pad_duplicates, Writer&& write)
+{
+    if (remove_ref_pad_duplicates) {
+        convert_to_legacy_dedup(first, last, samples, write);
+    } else {
+        convert_to_legacy_keep_all(first, last, samples, write);
+    }
+}
+
+bool has_index(const boost::filesystem::path& vcf_path)
+{
+    return boost::filesystem::exists(vcf_path.string() + ".csi") || boost::filesystem::exists(vcf_path.string() + ".tbi");
 }
 
 } // namespace
 
 void convert_to_legacy(const VcfReader& src, VcfWriter& dst, const bool remove_ref_pad_duplicates)
 {
+    const auto header = src.fetch_header();
     if (!dst.is_header_written()) {
-        dst << to_legacy(src.fetch_header());
+        dst << to_legacy(header);
     }
-    if (remove_ref_pad_duplicates) {
-        convert_to_legacy_dedup(src, dst);
-    } else {
-        convert_to_legacy_keep_all(src, dst);
+    const auto p = src.iterate();
+    convert_to_legacy(p.first, p.second, header.samples(), remove_ref_pad_duplicates,
+                      [&dst] (const VcfRecord& record) { dst << record; });
+}
+
+void convert_to_legacy(const boost::filesystem::path& src, VcfWriter& dst, const unsigned num_threads,
+                       const bool remove_ref_pad_duplicates)
+{
+    const VcfReader reader {src};
+    if (num_threads < 2 || !is_indexable(src) || !has_index(src)) {
+        convert_to_legacy(reader, dst, remove_ref_pad_duplicates);
+        return;
+    }
+    const auto header = reader.fetch_header();
+    if (!dst.is_header_written()) {
+        dst << to_legacy(header);
+    }
+    const auto samples = header.samples();
+    // Duplicates are only removed between adjacent records on the same contig, so contigs are independent
+    const auto convert_contig = [&] (const std::string& contig) {
+        const VcfReader contig_reader {src};
+        std::vector<VcfRecord> result {};
+        const auto p = contig_reader.iterate(contig);
+        convert_to_legacy(p.first, p.second, samples, remove_ref_pad_duplicates,
+                          [&result] (VcfRecord&& record) { result.push_back(std::move(record)); });
+        return result;
+    };
+    const auto contigs = get_contigs(header);
+    std::deque<std::future<std::vector<VcfRecord>>> pending {};
+    auto contig_itr = std::cbegin(contigs);
+    while (contig_itr != std::cend(contigs) || !pending.empty()) {
+        for (; contig_itr != std::cend(contigs) && pending.size() < num_threads; ++contig_itr) {
+            pending.push_back(std::async(std::launch::async, convert_contig, std::cref(*contig_itr)));
+        }
+        for (const auto& record : pending.front().get()) {
+            dst << record;
+        }
+        pending.pop_front();
     }
 }
 
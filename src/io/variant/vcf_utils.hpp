@@ -30,7 +30,7 @@ get_typed_format_values(const VcfHeader& header, const VcfRecord& record,
 
 bool is_indexable(const boost::filesystem::path& vcf_path);
 
-void index_vcf(const boost::filesystem::path& vcf_path);
+void index_vcf(const boost::filesystem::path& vcf_path, unsigned num_threads = 0);
 void index_vcf(const VcfReader& reader);
 void index_vcfs(const std::vector<VcfReader>& readers);
 
@@ -46,7 +46,15 @@ VcfHeader merge(const std::vector<VcfHeader>& headers);
 void merge(std::vector<VcfReader>& sources, VcfWriter& dst, const std::vector<std::string>& contigs);
 void merge(std::vector<VcfReader>& sources, VcfWriter& dst);
 
+// Appends the records of the BCF sources to dst, a closed BCF containing only a header with the same dictionaries
+// as the sources. Compressed blocks are copied directly, so records are not decoded or re-encoded.
+void concatenate_naive(const std::vector<boost::filesystem::path>& sources, const boost::filesystem::path& dst);
+
 void convert_to_legacy(const VcfReader& src, VcfWriter& dst, bool remove_ref_pad_duplicates = true);
+// Contigs are converted concurrently, each with its own reader, and written in order. Falls back to
+// the serial conversion if src is not indexed.
+void convert_to_legacy(const boost::filesystem::path& src, VcfWriter& dst, unsigned num_threads,
+                       bool remove_ref_pad_duplicates = true);
 
 } // namespace octopus    
 
@@ -17,10 +17,10 @@ namespace octopus {
 
 namespace {
 
-auto make_vcf_writer(boost::optional<VcfWriter::Path> path = boost::none)
+auto make_vcf_writer(boost::optional<VcfWriter::Path> path = boost::none, boost::optional<int> compression_level = boost::none)
 {
     if (path) {
-        return std::make_unique<HtslibBcfFacade>(std::move(*path), HtslibBcfFacade::Mode::write);
+        return std::make_unique<HtslibBcfFacade>(std::move(*path), HtslibBcfFacade::Mode::write, compression_level);
     } else {
         return std::make_unique<HtslibBcfFacade>();
     }
@@ -32,12 +32,16 @@ VcfWriter::VcfWriter()
 : file_path_ {}
 , writer_ {make_vcf_writer()}
 , is_header_written_ {false}
+, num_compression_threads_ {0}
+, compression_level_ {}
 {}
 
 VcfWriter::VcfWriter(Path file_path)
 : file_path_ {std::move(file_path)}
 , writer_ {nullptr}
 , is_header_written_ {false}
+, num_compression_threads_ {0}
+, compression_level_ {}
 {
     using namespace boost::filesystem;
     
@@ -62,6 +66,25 @@ VcfWriter::VcfWriter(Path file_path)
     writer_ = make_vcf_writer(*file_path_);
 }
 
+VcfWriter::VcfWriter(Path file_path, const Mode mode)
+: file_path_ {}
+, writer_ {nullptr}
+, is_header_written_ {false}
+, num_compression_threads_ {0}
+, compression_level_ {}
+{
+    if (mode == Mode::write) {
+        *this = VcfWriter {std::move(file_path)};
+    } else {
+        if (!boost::filesystem::exists(file_path)) {
+            throw std::runtime_error {"VcfWriter: cannot append to " + file_path.string() + " as it does not exist"};
+        }
+        file_path_ = std::move(file_path);
+        writer_ = std::make_unique<HtslibBcfFacade>(*file_path_, HtslibBcfFacade::Mode::append);
+        is_header_written_ = true;
+    }
+}
+
 VcfWriter::VcfWriter(const VcfHeader& header)
 : VcfWriter {}
 {
@@ -80,6 +103,8 @@ VcfWriter::VcfWriter(VcfWriter&& other)
     file_path_         = std::move(other.file_path_);
     is_header_written_ = other.is_header_written_;
     writer_            = std::move(other.writer_);
+    num_compression_threads_ = other.num_compression_threads_;
+    compression_level_ = other.compression_level_;
 }
 
 VcfWriter& VcfWriter::operator=(VcfWriter&& other)
@@ -90,6 +115,8 @@ VcfWriter& VcfWriter::operator=(VcfWriter&& other)
         file_path_         = std::move(other.file_path_);
         is_header_written_ = other.is_header_written_;
         writer_            = std::move(other.writer_);
+        num_compression_threads_ = other.num_compression_threads_;
+        compression_level_ = other.compression_level_;
     }
     return *this;
 }
@@ -99,7 +126,7 @@ VcfWriter::~VcfWriter()
     try {
         close();
         if (can_write_index()) {
-            index_vcf(*file_path_);
+            index_vcf(*file_path_, num_compression_threads_);
         }
     } catch(...) {
         return;
@@ -115,6 +142,8 @@ void swap(VcfWriter& lhs, VcfWriter& rhs) noexcept
     swap(lhs.file_path_, rhs.file_path_);
     swap(lhs.is_header_written_, rhs.is_header_written_);
     swap(lhs.writer_, rhs.writer_);
+    swap(lhs.num_compression_threads_, rhs.num_compression_threads_);
+    swap(lhs.compression_level_, rhs.compression_level_);
 }
 
 bool VcfWriter::is_open() const noexcept
@@ -129,15 +158,17 @@ void VcfWriter::open()
         throw std::runtime_error {"VcfWriter::open: invalid open request"};
     }
     std::lock_guard<std::mutex> lock {mutex_};
-    writer_ = std::make_unique<HtslibBcfFacade>(*file_path_, HtslibBcfFacade::Mode::append);
+    writer_ = std::make_unique<HtslibBcfFacade>(*file_path_, HtslibBcfFacade::Mode::append, compression_level_);
+    writer_->set_compression_threads(num_compression_threads_);
 }
 
 void VcfWriter::open(Path file_path)
 {
     std::lock_guard<std::mutex> lock {mutex_};
     file_path_         = std::move(file_path);
-    writer_            = make_vcf_writer(*file_path_);
+    writer_            = make_vcf_writer(*file_path_, compression_level_);
     is_header_written_ = false;
+    writer_->set_compression_threads(num_compression_threads_);
 }
 
 void VcfWriter::close() noexcept
@@ -175,6 +206,19 @@ void VcfWriter::write(const VcfRecord& record)
     }
 }
 
+void VcfWriter::set_compression_threads(const unsigned num_threads)
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    num_compression_threads_ = num_threads;
+    if (writer_) writer_->set_compression_threads(num_threads);
+}
+
+void VcfWriter::set_compression_level(const int level)
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    compression_level_ = level;
+}
+
 bool VcfWriter::can_write_index() const noexcept
 {
     return file_path_ && is_header_written_
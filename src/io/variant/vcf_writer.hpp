@@ -26,8 +26,12 @@ class VcfWriter
 public:
     using Path = boost::filesystem::path;
     
+    enum class Mode { write, append };
+    
     VcfWriter();
     VcfWriter(Path file_path);
+    // In append mode the file must exist and already have a header
+    VcfWriter(Path file_path, Mode mode);
     VcfWriter(const VcfHeader& header);
     VcfWriter(Path file_path, const VcfHeader& header);
     
@@ -52,10 +56,17 @@ public:
     void write(const VcfHeader& header);
     void write(const VcfRecord& record);
     
+    // Compresses and indexes with num_threads threads, for this and any subsequently opened file
+    void set_compression_threads(unsigned num_threads);
+    // Sets the BGZF compression level (0-9) of files subsequently opened by this writer
+    void set_compression_level(int level);
+    
 private:
     boost::optional<Path> file_path_;
     std::unique_ptr<HtslibBcfFacade> writer_;
     bool is_header_written_;
+    unsigned num_compression_threads_;
+    boost::optional<int> compression_level_;
     mutable std::mutex mutex_;
     
     bool can_write_index() const noexcept;
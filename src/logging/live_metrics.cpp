@@ -0,0 +1,188 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "live_metrics.hpp"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <fstream>
+#include <utility>
+
+#include <boost/filesystem/operations.hpp>
+
+#include "progress_meter.hpp"
+#include "logging.hpp"
+#include "utils/thread_pool.hpp"
+#include "utils/system_utils.hpp"
+
+namespace octopus { namespace metrics {
+
+namespace {
+
+// Only the owning thread writes its counters
+using ThreadCounters = std::array<std::atomic<std::uint64_t>, num_counters>;
+
+std::atomic<bool> enabled {false};
+
+std::mutex registry_mutex {};
+std::vector<std::shared_ptr<ThreadCounters>> registry {};
+
+ThreadCounters& get_thread_counters()
+{
+    static thread_local std::shared_ptr<ThreadCounters> counters {};
+    if (!counters) {
+        counters = std::make_shared<ThreadCounters>();
+        for (auto& counter : *counters) counter.store(0, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock {registry_mutex};
+        registry.push_back(counters);
+    }
+    return *counters;
+}
+
+} // namespace
+
+void enable() noexcept
+{
+    enabled.store(true, std::memory_order_relaxed);
+}
+
+bool is_enabled() noexcept
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+void add(const Counter counter, const std::uint64_t n) noexcept
+{
+    if (is_enabled()) {
+        try {
+            get_thread_counters()[static_cast<std::size_t>(counter)].fetch_add(n, std::memory_order_relaxed);
+        } catch (...) {}
+    }
+}
+
+CounterSnapshot snapshot()
+{
+    CounterSnapshot result {};
+    result.fill(0);
+    std::lock_guard<std::mutex> lock {registry_mutex};
+    for (const auto& counters : registry) {
+        for (std::size_t i {0}; i < num_counters; ++i) {
+            result[i] += (*counters)[i].load(std::memory_order_relaxed);
+        }
+    }
+    return result;
+}
+
+LiveMetricsWriter::LiveMetricsWriter(Path path, Sources sources, std::chrono::seconds interval)
+: path_ {std::move(path)}
+, sources_ {std::move(sources)}
+, interval_ {interval}
+, start_ {Clock::now()}
+, num_utilisation_samples_ {0}
+, utilisation_sum_ {0}
+, mutex_ {}
+, cv_ {}
+, done_ {false}
+, thread_ {}
+{
+    enable();
+    thread_ = std::thread {&LiveMetricsWriter::run, this};
+}
+
+LiveMetricsWriter::~LiveMetricsWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock {mutex_};
+        done_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+    try {
+        write();
+    } catch (...) {}
+}
+
+// private methods
+
+void LiveMetricsWriter::run()
+{
+    std::unique_lock<std::mutex> lock {mutex_};
+    while (!cv_.wait_for(lock, interval_, [this] () { return done_; })) {
+        lock.unlock();
+        try {
+            write();
+        } catch (const std::exception& e) {
+            logging::WarningLogger warn_log {};
+            stream(warn_log) << "Could not write live metrics to " << path_ << ": " << e.what();
+        }
+        lock.lock();
+    }
+}
+
+namespace {
+
+template <typename T>
+void write_metric(std::ostream& os, const char* name, const char* type, const char* help, const T value)
+{
+    os << "# HELP octopus_" << name << ' ' << help << '\n';
+    os << "# TYPE octopus_" << name << ' ' << type << '\n';
+    os << "octopus_" << name << ' ' << value << '\n';
+}
+
+double hit_rate(const std::uint64_t hits, const std::uint64_t misses) noexcept
+{
+    const auto requests = hits + misses;
+    return requests > 0 ? static_cast<double>(hits) / requests : 0.0;
+}
+
+} // namespace
+
+void LiveMetricsWriter::write()
+{
+    const auto counts = snapshot();
+    const auto count = [&counts] (Counter counter) { return counts[static_cast<std::size_t>(counter)]; };
+    const auto elapsed = std::chrono::duration<double> {Clock::now() - start_}.count();
+    const auto& progress = sources_.progress.get();
+    const auto bp_completed = progress.num_bp_completed();
+    const auto bp_to_search = progress.num_bp_to_search();
+    double worker_utilisation {0};
+    std::size_t busy_workers {0};
+    if (sources_.workers && sources_.workers->size() > 0) {
+        const auto num_workers = sources_.workers->size();
+        busy_workers = num_workers - std::min(sources_.workers->n_idle(), num_workers);
+        utilisation_sum_ += static_cast<double>(busy_workers) / num_workers;
+        ++num_utilisation_samples_;
+        worker_utilisation = utilisation_sum_ / num_utilisation_samples_;
+    }
+    const auto tasks_started = count(Counter::tasks_started), tasks_completed = count(Counter::tasks_completed);
+    const auto temp_path = path_.string() + ".tmp";
+    {
+        std::ofstream file {temp_path};
+        write_metric(file, "elapsed_seconds", "gauge", "Seconds since calling started", elapsed);
+        write_metric(file, "bp_completed", "gauge", "Base pairs called", bp_completed);
+        write_metric(file, "bp_total", "gauge", "Base pairs to call", bp_to_search);
+        write_metric(file, "bp_per_second", "gauge", "Mean calling throughput", elapsed > 0 ? bp_completed / elapsed : 0.0);
+        if (sources_.num_queued_tasks) {
+            write_metric(file, "tasks_queued", "gauge", "Tasks made but not started", sources_.num_queued_tasks());
+        }
+        write_metric(file, "tasks_running", "gauge", "Tasks started but not completed", tasks_started - std::min(tasks_completed, tasks_started));
+        write_metric(file, "tasks_completed", "counter", "Tasks completed", tasks_completed);
+        if (sources_.workers) {
+            write_metric(file, "workers", "gauge", "Calling worker threads", sources_.workers->size());
+            write_metric(file, "workers_busy", "gauge", "Calling worker threads running a task", busy_workers);
+            write_metric(file, "worker_utilisation", "gauge", "Mean fraction of sampled calling workers that were busy", worker_utilisation);
+        }
+        write_metric(file, "reference_cache_hit_rate", "gauge", "Fraction of reference cache requests that were hits",
+                     hit_rate(count(Counter::reference_cache_hits), count(Counter::reference_cache_misses)));
+        write_metric(file, "likelihood_cache_hit_rate", "gauge", "Fraction of read-haplotype likelihood cache requests that were hits",
+                     hit_rate(count(Counter::likelihood_cache_hits), count(Counter::likelihood_cache_misses)));
+        write_metric(file, "resident_memory_bytes", "gauge", "Resident set size", get_resident_memory());
+        write_metric(file, "peak_resident_memory_bytes", "gauge", "Largest resident set size", get_peak_resident_memory());
+        if (!file) throw std::runtime_error {"failed to write " + temp_path};
+    }
+    boost::filesystem::rename(temp_path, path_);
+}
+
+} // namespace metrics
+} // namespace octopus
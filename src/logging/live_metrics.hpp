@@ -0,0 +1,100 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef live_metrics_hpp
+#define live_metrics_hpp
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <boost/filesystem/path.hpp>
+
+namespace octopus {
+
+class ProgressMeter;
+class ThreadPool;
+
+namespace metrics {
+
+enum class Counter
+{
+    tasks_started,
+    tasks_completed,
+    reference_cache_hits,
+    reference_cache_misses,
+    likelihood_cache_hits,
+    likelihood_cache_misses
+};
+
+constexpr std::size_t num_counters {6};
+
+using CounterSnapshot = std::array<std::uint64_t, num_counters>;
+
+// Counters are off until enabled, in which case add does nothing
+void enable() noexcept;
+bool is_enabled() noexcept;
+
+// Counts are thread local, so adding never contends with other threads
+void add(Counter counter, std::uint64_t n = 1) noexcept;
+
+// Sums the counts of every thread that has added to a counter
+CounterSnapshot snapshot();
+
+/*
+ LiveMetricsWriter periodically rewrites a file of metrics in Prometheus text format from a
+ background thread, so long running jobs can be monitored. The file is written to a temporary
+ path and renamed, so readers never see a partial file. Sources are only read with atomic loads,
+ so writing never blocks calling threads.
+ */
+class LiveMetricsWriter
+{
+public:
+    using Path = boost::filesystem::path;
+
+    struct Sources
+    {
+        std::reference_wrapper<const ProgressMeter> progress;
+        const ThreadPool* workers = nullptr;
+        std::function<std::size_t()> num_queued_tasks = {};
+    };
+
+    LiveMetricsWriter() = delete;
+
+    LiveMetricsWriter(Path path, Sources sources, std::chrono::seconds interval = std::chrono::seconds {10});
+
+    LiveMetricsWriter(const LiveMetricsWriter&)            = delete;
+    LiveMetricsWriter& operator=(const LiveMetricsWriter&) = delete;
+    LiveMetricsWriter(LiveMetricsWriter&&)                 = delete;
+    LiveMetricsWriter& operator=(LiveMetricsWriter&&)      = delete;
+
+    // Writes a final update
+    ~LiveMetricsWriter();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    Path path_;
+    Sources sources_;
+    std::chrono::seconds interval_;
+    Clock::time_point start_;
+    std::size_t num_utilisation_samples_;
+    double utilisation_sum_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool done_;
+    std::thread thread_;
+
+    void run();
+    void write();
+};
+
+} // namespace metrics
+} // namespace octopus
+
+#endif
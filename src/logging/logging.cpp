@@ -4,6 +4,12 @@
 #include "logging.hpp"
 
 #include <iostream>
+#include <utility>
+#include <cstdint>
+
+#include <boost/make_shared.hpp>
+#include <boost/log/sinks/async_frontend.hpp>
+#include <boost/log/attributes/value_extraction.hpp>
 
 namespace octopus { namespace logging {
 
@@ -24,6 +30,38 @@ std::ostream& operator<<(std::ostream& os, severity_level level)
     return os;
 }
 
+namespace {
+
+using AsyncFileSink = sinks::asynchronous_sink<sinks::text_file_backend>;
+
+double log_sample_rate {1.0};
+
+thread_local bool sampled {true};
+
+auto make_formatter()
+{
+    return expr::stream
+        << expr::format_date_time< boost::posix_time::ptime >("TimeStamp", "[%Y-%m-%d %H:%M:%S]")
+        << " <" << severity
+        << "> " << expr::smessage;
+}
+
+// Filters run on the thread emitting the record, which is where the sampling state lives
+void add_async_file_log(const boost::filesystem::path& file, const severity_level excluded)
+{
+    auto backend = boost::make_shared<sinks::text_file_backend>(keywords::file_name = file.string());
+    auto sink = boost::make_shared<AsyncFileSink>(std::move(backend));
+    sink->set_filter([excluded] (const logging::attribute_value_set& attributes) {
+        const auto level = logging::extract<severity_level>("Severity", attributes);
+        if (!level || *level == excluded) return false;
+        return *level > severity_level::debug || sampled;
+    });
+    sink->set_formatter(make_formatter());
+    logging::core::get()->add_sink(std::move(sink));
+}
+
+} // namespace
+
 void init(boost::optional<boost::filesystem::path> debug_log,
           boost::optional<boost::filesystem::path> trace_log)
 {
@@ -34,53 +72,68 @@ void init(boost::optional<boost::filesystem::path> debug_log,
         (
             severity != severity_level::debug && severity != severity_level::trace
         ),
-        keywords::format =
-        (
-         expr::stream
-            << expr::format_date_time< boost::posix_time::ptime >("TimeStamp", "[%Y-%m-%d %H:%M:%S]")
-            << " <" << severity
-            << "> " << expr::smessage
-        )
+        keywords::format = make_formatter()
     );
     
     if (debug_log) {
-        logging::add_file_log
-        (
-         keywords::file_name = debug_log->c_str(),
-         keywords::filter =
-         (
-          severity != severity_level::trace
-          ),
-         keywords::format =
-         (
-            expr::stream
-                << expr::format_date_time< boost::posix_time::ptime >("TimeStamp", "[%Y-%m-%d %H:%M:%S]")
-                << " <" << severity
-                << "> " << expr::smessage
-          )
-         );
+        add_async_file_log(*debug_log, severity_level::trace);
     }
     
     if (trace_log) {
-        logging::add_file_log
-        (
-         keywords::file_name = trace_log->c_str(),
-         keywords::filter =
-         (
-          severity != severity_level::debug
-          ),
-         keywords::format =
-         (
-          expr::stream
-                << expr::format_date_time< boost::posix_time::ptime >("TimeStamp", "[%Y-%m-%d %H:%M:%S]")
-                << " <" << severity
-                << "> " << expr::smessage
-          )
-         );
+        add_async_file_log(*trace_log, severity_level::debug);
     }
     
     logging::add_common_attributes();
 }
 
+void flush()
+{
+    logging::core::get()->flush();
+}
+
+void set_log_sample_rate(const double rate) noexcept
+{
+    log_sample_rate = rate;
+}
+
+bool is_log_sampled() noexcept
+{
+    return sampled;
+}
+
+namespace {
+
+// splitmix64 finaliser, so nearby keys are sampled independently
+std::uint64_t mix(std::uint64_t x) noexcept
+{
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+} // namespace
+
+LogSamplingScope::LogSamplingScope(const std::size_t key) noexcept
+: sampled_ {}
+, parent_sampled_ {sampled}
+{
+    if (log_sample_rate >= 1) {
+        sampled_ = true;
+    } else {
+        sampled_ = static_cast<double>(mix(key) >> 11) / 9007199254740992.0 < log_sample_rate;
+    }
+    sampled = sampled_;
+}
+
+LogSamplingScope::~LogSamplingScope() noexcept
+{
+    sampled = parent_sampled_;
+}
+
+bool LogSamplingScope::is_sampled() const noexcept
+{
+    return sampled_;
+}
+
 } // namespace logging
 } // namespace octopus
@@ -7,6 +7,7 @@
 #include <iostream>
 #include <functional>
 #include <sstream>
+#include <cstddef>
 
 #include <boost/optional.hpp>
 #include <boost/filesystem.hpp>
@@ -43,9 +44,41 @@ BOOST_LOG_INLINE_GLOBAL_LOGGER_DEFAULT(logger, src::severity_logger<severity_lev
 
 BOOST_LOG_ATTRIBUTE_KEYWORD(severity, "Severity", severity_level)
 
+// Debug and trace logs are written by a background thread, so calling threads only build each
+// message and queue it. Console logs are written synchronously.
 void init(boost::optional<boost::filesystem::path> debug_log = boost::none,
           boost::optional<boost::filesystem::path> trace_log = boost::none);
 
+// Writes all queued records
+void flush();
+
+// Debug and trace records are only written for this fraction of sampling scopes
+void set_log_sample_rate(double rate) noexcept;
+
+bool is_log_sampled() noexcept;
+
+// Samples debug and trace logging on this thread for the lifetime of the scope. Scopes with the same
+// key are always sampled the same way, so reruns log the same regions.
+class LogSamplingScope
+{
+public:
+    LogSamplingScope() = delete;
+    
+    LogSamplingScope(std::size_t key) noexcept;
+    
+    LogSamplingScope(const LogSamplingScope&)            = delete;
+    LogSamplingScope& operator=(const LogSamplingScope&) = delete;
+    LogSamplingScope(LogSamplingScope&&)                 = delete;
+    LogSamplingScope& operator=(LogSamplingScope&&)      = delete;
+    
+    ~LogSamplingScope() noexcept;
+    
+    bool is_sampled() const noexcept;
+    
+private:
+    bool sampled_, parent_sampled_;
+};
+
 template <severity_level L>
 class Logger
 {
@@ -26,6 +26,7 @@ inline void log_program_end()
 {
     logging::InfoLogger log {};
     log_program_end(log);
+    logging::flush();
 }
     
 } // namespace octopus
@@ -74,6 +74,8 @@ ProgressMeter::ProgressMeter(InputRegionMap regions)
 , done_ {false}
 , position_tab_length_ {}
 , block_compute_times_ {}
+, pending_ {}
+, num_pending_ {0}
 , log_ {}
 {
     for (auto& p : target_regions_) {
@@ -99,8 +101,8 @@ ProgressMeter::ProgressMeter(ProgressMeter&& other)
     using std::move;
     target_regions_       = move(other.target_regions_);
     completed_regions_    = move(other.completed_regions_);
-    num_bp_to_search_     = move(other.num_bp_to_search_);
-    num_bp_completed_     = move(other.num_bp_completed_);
+    num_bp_to_search_     = other.num_bp_to_search_.load();
+    num_bp_completed_     = other.num_bp_completed_.load();
     max_tick_size_        = move(other.max_tick_size_);
     curr_tick_size_       = move(other.curr_tick_size_);
     percent_until_tick_   = move(other.percent_until_tick_);
@@ -111,6 +113,8 @@ ProgressMeter::ProgressMeter(ProgressMeter&& other)
     done_                 = move(other.done_);
     position_tab_length_  = move(other.position_tab_length_);
     block_compute_times_  = move(other.block_compute_times_);
+    pending_              = move(other.pending_);
+    num_pending_          = other.num_pending_.load();
     log_                  = move(other.log_);
 }
 
@@ -122,8 +126,8 @@ ProgressMeter& ProgressMeter::operator=(ProgressMeter&& other)
         using std::move;
         target_regions_       = move(other.target_regions_);
         completed_regions_    = move(other.completed_regions_);
-        num_bp_to_search_     = move(other.num_bp_to_search_);
-        num_bp_completed_     = move(other.num_bp_completed_);
+        num_bp_to_search_     = other.num_bp_to_search_.load();
+        num_bp_completed_     = other.num_bp_completed_.load();
         max_tick_size_        = move(other.max_tick_size_);
         curr_tick_size_       = move(other.curr_tick_size_);
         percent_until_tick_   = move(other.percent_until_tick_);
@@ -134,6 +138,8 @@ ProgressMeter& ProgressMeter::operator=(ProgressMeter&& other)
         done_                 = move(other.done_);
         position_tab_length_  = move(other.position_tab_length_);
         block_compute_times_  = move(other.block_compute_times_);
+        pending_              = move(other.pending_);
+        num_pending_          = other.num_pending_.load();
         log_                  = move(other.log_);
     }
     return *this;
@@ -264,6 +270,10 @@ void ProgressMeter::pause()
 
 void ProgressMeter::stop()
 {
+    {
+        std::lock_guard<std::mutex> lock {mutex_};
+        merge_pending();
+    }
     if (!done_ && !target_regions_.empty()) {
         const TimeInterval duration {start_, std::chrono::system_clock::now()};
         const auto time_taken = to_string(duration);
@@ -291,17 +301,28 @@ void ProgressMeter::reset()
     done_ = false;
     block_compute_times_.clear();
     block_compute_times_.shrink_to_fit();
+    pending_.clear();
+    num_pending_ = 0;
     
 }
 
 void ProgressMeter::log_completed(const GenomicRegion& region)
 {
-    std::lock_guard<std::mutex> lock {mutex_};
-    const auto new_bp_processed = merge(region);
-    const auto new_percent_done = percent_completed(new_bp_processed, num_bp_to_search_);
-    num_bp_completed_ += new_bp_processed;
-    percent_until_tick_ -= new_percent_done;
-    if (percent_until_tick_ <= 0) output_log(region);
+    {
+        std::lock_guard<std::mutex> lock {pending_mutex_};
+        pending_.push_back(region);
+        ++num_pending_;
+    }
+    // Whichever thread holds the meter lock merges the regions logged by other threads, so threads
+    // never wait for merging or output. Regions are queued before trying the lock and the queue is
+    // checked after releasing it, so no region is left unmerged.
+    std::unique_lock<std::mutex> lock {mutex_, std::try_to_lock};
+    while (lock.owns_lock()) {
+        merge_pending();
+        lock.unlock();
+        if (num_pending_ == 0) break;
+        lock.try_lock();
+    }
 }
 
 void ProgressMeter::log_completed(const GenomicRegion::ContigName& contig)
@@ -313,8 +334,35 @@ void ProgressMeter::log_completed(const GenomicRegion::ContigName& contig)
     }
 }
 
+std::size_t ProgressMeter::num_bp_completed() const noexcept
+{
+    return num_bp_completed_.load(std::memory_order_relaxed);
+}
+
+std::size_t ProgressMeter::num_bp_to_search() const noexcept
+{
+    return num_bp_to_search_.load(std::memory_order_relaxed);
+}
+
 // private methods
 
+void ProgressMeter::merge_pending()
+{
+    std::vector<GenomicRegion> regions {};
+    {
+        std::lock_guard<std::mutex> lock {pending_mutex_};
+        regions.swap(pending_);
+        num_pending_ = 0;
+    }
+    for (const auto& region : regions) {
+        const auto new_bp_processed = merge(region);
+        const auto new_percent_done = percent_completed(new_bp_processed, num_bp_to_search_);
+        num_bp_completed_ += new_bp_processed;
+        percent_until_tick_ -= new_percent_done;
+        if (percent_until_tick_ <= 0) output_log(region);
+    }
+}
+
 ProgressMeter::RegionSizeType ProgressMeter::merge(const GenomicRegion& region)
 {
     RegionSizeType result {0};
@@ -8,7 +8,9 @@
 #include <cstddef>
 #include <chrono>
 #include <deque>
+#include <vector>
 #include <mutex>
+#include <atomic>
 
 #include "config/common.hpp"
 #include "basics/contig_region.hpp"
@@ -44,6 +46,10 @@ public:
     void log_completed(const GenomicRegion& region);
     void log_completed(const GenomicRegion::ContigName& contig);
     
+    // Lock free, so can be polled from other threads
+    std::size_t num_bp_completed() const noexcept;
+    std::size_t num_bp_to_search() const noexcept;
+    
 private:
     using RegionSizeType = ContigRegion::Position;
     using ContigRegionMap = MappableSetMap<ContigName, ContigRegion>;
@@ -51,7 +57,7 @@ private:
     
     InputRegionMap target_regions_;
     ContigRegionMap completed_regions_;
-    RegionSizeType num_bp_to_search_, num_bp_completed_;
+    std::atomic<RegionSizeType> num_bp_to_search_, num_bp_completed_;
     double min_tick_size_ = 0.1, max_tick_size_ = 1.0, curr_tick_size_ = 1.0;
     double percent_until_tick_;
     double percent_at_last_tick_;
@@ -61,8 +67,12 @@ private:
     std::size_t position_tab_length_;
     mutable std::deque<DurationUnits> block_compute_times_;
     mutable std::mutex mutex_;
+    std::vector<GenomicRegion> pending_;
+    std::atomic<std::size_t> num_pending_;
+    std::mutex pending_mutex_;
     logging::InfoLogger log_;
     
+    void merge_pending();
     RegionSizeType merge(const GenomicRegion& region);
     
     void write_header();
@@ -2,9 +2,15 @@
 // Use of this source code is governed by the MIT license that can be found in the LICENSE file.
 
 #include <iostream>
+#include <fstream>
 #include <cstdlib>
+#include <cstddef>
 #include <chrono>
 #include <exception>
+#include <vector>
+#include <utility>
+
+#include <boost/optional.hpp>
 
 #include "config/config.hpp"
 #include "config/common.hpp"
@@ -14,6 +20,8 @@
 #include "config/option_collation.hpp"
 #include "core/octopus.hpp"
 #include "utils/timing.hpp"
+#include "utils/stage_profiler.hpp"
+#include "utils/region_snapshot.hpp"
 #include "utils/system_utils.hpp"
 #include "utils/string_utils.hpp"
 #include "exceptions/error.hpp"
@@ -45,6 +53,18 @@ void init_common(const OptionMap& options)
     logging::init(get_debug_log_file_name(options), get_trace_log_file_name(options));
     DEBUG_MODE = options::is_debug_mode(options);
     TRACE_MODE = options::is_trace_mode(options);
+    logging::set_log_sample_rate(get_log_sample_rate(options));
+    if (get_profile_file_name(options)) profiling::enable();
+    const auto perf_trace_path = get_perf_trace_file_name(options);
+    if (perf_trace_path) profiling::open_region_trace(*perf_trace_path);
+}
+
+void write_profile(const boost::filesystem::path& profile_path)
+{
+    std::ofstream profile_file {profile_path.string()};
+    profiling::write_json(profile_file);
+    logging::InfoLogger info_log {};
+    stream(info_log) << "Wrote calling profile to " << profile_path;
 }
 
 std::string to_string(const int argc, const char** argv)
@@ -66,6 +86,38 @@ void sanity_check(const OptionMap& options)
     }
 }
 
+void run_batch(const int argc, const char** argv, const std::vector<BatchJob>& jobs)
+{
+    logging::InfoLogger info_log {};
+    using utils::TimeInterval;
+    using CallingInputs = std::pair<ReferenceGenome, ReadManager>;
+    boost::optional<CallingInputs> inputs {};
+    OptionMap input_options {};
+    for (std::size_t job_idx {0}; job_idx < jobs.size(); ++job_idx) {
+        std::vector<const char*> job_argv {argv, argv + argc};
+        for (const auto& arg : jobs[job_idx]) job_argv.push_back(arg.c_str());
+        const auto job_options = parse_options(static_cast<int>(job_argv.size()), job_argv.data());
+        const auto start = std::chrono::system_clock::now();
+        auto components = [&] () {
+            if (inputs && have_same_inputs(input_options, job_options)) {
+                auto result = collate_genome_calling_components(job_options, std::move(inputs->first), std::move(inputs->second));
+                inputs = boost::none;
+                return result;
+            }
+            inputs = boost::none;
+            return collate_genome_calling_components(job_options);
+        }();
+        const auto end = std::chrono::system_clock::now();
+        stream(info_log) << "Done initialising calling components for batch job " << (job_idx + 1) << " of "
+                         << jobs.size() << " in " << TimeInterval {start, end};
+        if (validate(components)) {
+            run_octopus(components, to_string(static_cast<int>(job_argv.size()), job_argv.data()));
+        }
+        inputs = components.release_inputs();
+        input_options = job_options;
+    }
+}
+
 } // namespace
 
 int main(const int argc, const char** argv)
@@ -89,13 +141,27 @@ int main(const int argc, const char** argv)
             logging::InfoLogger info_log {};
             const auto start = std::chrono::system_clock::now();
             sanity_check(options);
+            const auto profile_path = get_profile_file_name(options);
+            const auto batch_jobs = get_batch_jobs(options);
+            if (batch_jobs) {
+                options.clear();
+                run_batch(argc, argv, *batch_jobs);
+                if (profile_path) write_profile(*profile_path);
+                log_program_end();
+                return EXIT_SUCCESS;
+            }
             auto components = collate_genome_calling_components(options);
             auto end = std::chrono::system_clock::now();
             using utils::TimeInterval;
             stream(info_log) << "Done initialising calling components in " << TimeInterval {start, end};
+            auto snapshot_regions = get_snapshot_regions(options, components.reference());
+            if (!snapshot_regions.empty()) {
+                capture_region_snapshots(std::move(snapshot_regions), get_snapshot_directory(options), to_string(argc, argv));
+            }
             options.clear();
             if (validate(components)) {
                 run_octopus(components, to_string(argc, argv));
+                if (profile_path) write_profile(*profile_path);
             }
             log_program_end();
         } catch (const Error& e) {
@@ -7,6 +7,8 @@
 #include <limits>
 #include <algorithm>
 #include <iterator>
+#include <vector>
+#include <cassert>
 
 #include "utils/mappable_algorithms.hpp"
 #include "utils/read_stats.hpp"
@@ -23,6 +25,7 @@ BufferedReadPipe::BufferedReadPipe(const ReadPipe& source, Config config, std::v
 , buffer_ {}
 , buffered_region_ {}
 , hints_ {}
+, prefetch_ {}
 {
     hint(std::move(hints));
 }
@@ -34,6 +37,7 @@ const ReadPipe& BufferedReadPipe::source() const noexcept
 
 void BufferedReadPipe::clear() noexcept
 {
+    cancel_prefetch();
     buffer_.clear();
     buffered_region_ = boost::none;
     hints_.clear();
@@ -43,7 +47,15 @@ ReadMap BufferedReadPipe::fetch_reads(const GenomicRegion& region) const
 {
     if (config_.max_buffer_size == 0) return source_.get().fetch_reads(region);
     setup_buffer(region);
-    return copy_overlapped(buffer_, region);
+    ReadMap result {buffer_.size()};
+    std::vector<AlignedRead> overlapped {};
+    for (const auto& p : buffer_) {
+        overlapped.clear();
+        p.second.decode_overlapped(region, std::back_inserter(overlapped));
+        result.emplace(p.first, ReadContainer {std::make_move_iterator(std::begin(overlapped)),
+                                               std::make_move_iterator(std::end(overlapped))});
+    }
+    return result;
 }
 
 void BufferedReadPipe::hint(std::vector<GenomicRegion> hints) const
@@ -66,42 +78,180 @@ bool BufferedReadPipe::is_cached(const GenomicRegion& region) const noexcept
     return buffered_region_ && contains(*buffered_region_, region);
 }
 
+namespace {
+
+// Releases each sample's reads as soon as they are compacted to keep the peak footprint low
+void compact(ReadMap& reads, std::unordered_map<SampleName, CompactReadBatch>& result)
+{
+    for (auto& p : reads) {
+        result.emplace(p.first, CompactReadBatch {std::cbegin(p.second), std::cend(p.second)});
+        p.second.clear();
+        p.second.shrink_to_fit();
+    }
+}
+
+// Reads that begin before a piece were fetched with the previous piece, which they must overlap
+std::unordered_map<SampleName, CompactReadBatch>
+fetch_compressed(const ReadPipe& source, const GenomicRegion& region, const std::size_t piece_budget)
+{
+    std::unordered_map<SampleName, CompactReadBatch> result {};
+    for (const auto& sample : source.samples()) result.emplace(sample, CompactReadBatch {true});
+    auto remaining = region;
+    bool first_piece {true};
+    while (true) {
+        auto piece = source.read_manager().find_covered_subregion(remaining, piece_budget);
+        if (is_empty(piece) && !is_empty(remaining)) piece = expand_rhs(piece, 1);
+        auto reads = source.fetch_reads(piece);
+        for (auto& p : reads) {
+            auto& batch = result.at(p.first);
+            for (const auto& read : p.second) {
+                if (first_piece || mapped_begin(read) >= piece.begin()) batch.push_back(read);
+            }
+            p.second.clear();
+            p.second.shrink_to_fit();
+        }
+        if (piece.end() >= remaining.end()) break;
+        remaining = right_overhang_region(remaining, piece);
+        first_piece = false;
+    }
+    for (auto& p : result) p.second.shrink_to_fit();
+    return result;
+}
+
+} // namespace
+
 // private methods
 
 void BufferedReadPipe::setup_buffer(const GenomicRegion& request) const
 {
     if (!is_cached(request)) {
-        auto max_region = get_max_fetch_region(request);
-        bool unchecked_fetch {false};
-        if (can_make_unchecked_fetch()) {
-            buffered_region_ = std::move(max_region);
-            unchecked_fetch = true;
-        } else {
-            buffered_region_ = source_.get().read_manager().find_covered_subregion(max_region, config_.max_buffer_size);
-        }
-        buffer_ = source_.get().fetch_reads(expand(*buffered_region_, config_.fetch_expansion));
-        if (unchecked_fetch) {
-            const auto fetch_size = count_reads(buffer_);
-            if (fetch_size > config_.max_buffer_size) {
-                if (default_unchecked_fetch_overflowed_) {
-                    adjusted_unchecked_fetch_overflowed_ = true;
-                } else {
-                    default_unchecked_fetch_overflowed_ = true;
-                }
-                // Clear buffer of reads to rhs of request
-                for (auto& p : buffer_) {
-                    const auto last_overlapped = find_first_after(p.second, request);
-                    p.second.erase(last_overlapped, std::cend(p.second));
-                }
-                buffered_region_ = request;
+        if (!use_prefetch(request)) {
+            auto max_region = get_max_fetch_region(request);
+            bool unchecked_fetch {false};
+            if (can_make_unchecked_fetch()) {
+                buffered_region_ = std::move(max_region);
+                unchecked_fetch = true;
+            } else {
+                buffered_region_ = source_.get().read_manager().find_covered_subregion(max_region, buffer_budget());
             }
-        } else {
-            if (min_checked_fetch_size_) {
-                min_checked_fetch_size_ = std::min(size(*buffered_region_), *min_checked_fetch_size_);
+            const auto fetch_region = expand(*buffered_region_, config_.fetch_expansion);
+            if (config_.compress) {
+                assert(!unchecked_fetch);
+                record_checked_fetch(*buffered_region_);
+                buffer_ = fetch_compressed(source_, fetch_region, fetch_budget());
             } else {
-                min_checked_fetch_size_ = size(*buffered_region_);
+                auto reads = source_.get().fetch_reads(fetch_region);
+                if (unchecked_fetch) {
+                    const auto fetch_size = count_reads(reads);
+                    if (fetch_size > buffer_budget()) {
+                        record_unchecked_overflow();
+                        // Clear buffer of reads to rhs of request
+                        for (auto& p : reads) {
+                            const auto last_overlapped = find_first_after(p.second, request);
+                            p.second.erase(last_overlapped, std::cend(p.second));
+                        }
+                        buffered_region_ = request;
+                    }
+                } else {
+                    record_checked_fetch(*buffered_region_);
+                }
+                fill_buffer(reads);
             }
         }
+        if (config_.prefetch) start_prefetch();
+    }
+}
+
+
+void BufferedReadPipe::fill_buffer(ReadMap& reads) const
+{
+    buffer_.clear();
+    compact(reads, buffer_);
+}
+
+namespace {
+
+// A conservative ratio of decoded to compressed read size
+constexpr std::size_t compressedBufferScale {4};
+
+} // namespace
+
+std::size_t BufferedReadPipe::buffer_budget() const noexcept
+{
+    return config_.compress ? compressedBufferScale * fetch_budget() : fetch_budget();
+}
+
+std::size_t BufferedReadPipe::fetch_budget() const noexcept
+{
+    return config_.prefetch ? std::max(config_.max_buffer_size / 2, std::size_t {1}) : config_.max_buffer_size;
+}
+
+void BufferedReadPipe::start_prefetch() const
+{
+    assert(buffered_region_);
+    // Requests move left to right, so the next one will most likely start where this buffer ends
+    const auto max_region = get_max_fetch_region(tail_region(*buffered_region_));
+    if (is_empty(max_region)) return;
+    // The task must not refer to this object as it may be moved while the task runs
+    prefetch_ = std::async(std::launch::async,
+                           [source = source_, max_region, unchecked = can_make_unchecked_fetch(),
+                            budget = buffer_budget(), fetch_budget = fetch_budget(),
+                            expansion = config_.fetch_expansion, compress = config_.compress] () {
+        Prefetch result {};
+        result.unchecked = unchecked;
+        result.region = unchecked ? max_region : source.get().read_manager().find_covered_subregion(max_region, budget);
+        if (compress) {
+            result.buffer = fetch_compressed(source, expand(result.region, expansion), fetch_budget);
+            return result;
+        }
+        auto reads = source.get().fetch_reads(expand(result.region, expansion));
+        result.num_reads = count_reads(reads);
+        if (!unchecked || result.num_reads <= budget) compact(reads, result.buffer);
+        return result;
+    });
+}
+
+bool BufferedReadPipe::use_prefetch(const GenomicRegion& request) const
+{
+    if (!prefetch_.valid()) return false;
+    auto prefetch = prefetch_.get();
+    if (!contains(prefetch.region, request)) return false;
+    if (prefetch.unchecked) {
+        if (prefetch.num_reads > buffer_budget()) {
+            record_unchecked_overflow();
+            return false;
+        }
+    } else {
+        record_checked_fetch(prefetch.region);
+    }
+    buffer_ = std::move(prefetch.buffer);
+    buffered_region_ = std::move(prefetch.region);
+    return true;
+}
+
+void BufferedReadPipe::cancel_prefetch() const noexcept
+{
+    if (prefetch_.valid()) {
+        prefetch_.wait();
+        prefetch_ = {};
+    }
+}
+
+void BufferedReadPipe::record_unchecked_overflow() const noexcept
+{
+    if (default_unchecked_fetch_overflowed_) {
+        adjusted_unchecked_fetch_overflowed_ = true;
+    } else {
+        default_unchecked_fetch_overflowed_ = true;
+    }
+}
+
+void BufferedReadPipe::record_checked_fetch(const GenomicRegion& region) const
+{
+    if (min_checked_fetch_size_) {
+        min_checked_fetch_size_ = std::min(size(region), *min_checked_fetch_size_);
+    } else {
+        min_checked_fetch_size_ = size(region);
     }
 }
 
@@ -158,7 +308,8 @@ GenomicRegion BufferedReadPipe::get_default_max_fetch_region(const GenomicRegion
 
 bool BufferedReadPipe::can_make_unchecked_fetch() const noexcept
 {
-    return config_.allow_unchecked_fetches
+    return !config_.compress
+           && config_.allow_unchecked_fetches
            && !(default_unchecked_fetch_overflowed_ && !min_checked_fetch_size_)
            && !adjusted_unchecked_fetch_overflowed_
            && (config_.max_fetch_size || min_checked_fetch_size_);
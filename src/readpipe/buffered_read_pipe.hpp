@@ -6,11 +6,15 @@
 
 #include <functional>
 #include <cstddef>
+#include <unordered_map>
+#include <future>
 
 #include <boost/optional.hpp>
 
 #include "read_pipe.hpp"
+#include "config/common.hpp"
 #include "basics/genomic_region.hpp"
+#include "basics/compact_read_batch.hpp"
 #include "containers/mappable_map.hpp"
 
 namespace octopus {
@@ -25,6 +29,13 @@ public:
         boost::optional<GenomicRegion::Size> max_fetch_size = boost::none;
         boost::optional<GenomicRegion::Size> max_hint_gap = boost::none;
         bool allow_unchecked_fetches = true;
+        // Fill the next buffer in the background while the current one is used. The two buffers
+        // share max_buffer_size.
+        bool prefetch = false;
+        // Block compress buffered reads. Buffers are then filled in pieces of at most max_buffer_size
+        // reads, each compressed before the next is fetched, so a buffer can cover several times as
+        // many reads for the same peak memory.
+        bool compress = false;
     };
     
     BufferedReadPipe() = delete;
@@ -54,17 +65,35 @@ public:
     
 private:
     using RegionMap = MappableSetMap<GenomicRegion::ContigName, GenomicRegion>;
+    using ReadBuffer = std::unordered_map<SampleName, CompactReadBatch>;
+    
+    struct Prefetch
+    {
+        GenomicRegion region;
+        bool unchecked;
+        std::size_t num_reads;
+        ReadBuffer buffer;
+    };
     
     std::reference_wrapper<const ReadPipe> source_;
     Config config_;
-    mutable ReadMap buffer_;
+    mutable ReadBuffer buffer_;
     mutable boost::optional<GenomicRegion> buffered_region_;
     mutable RegionMap hints_;
     mutable bool default_unchecked_fetch_overflowed_ = false;
     mutable bool adjusted_unchecked_fetch_overflowed_ = false;
     mutable boost::optional<GenomicRegion::Size> min_checked_fetch_size_ = boost::none;
+    mutable std::future<Prefetch> prefetch_;
     
     void setup_buffer(const GenomicRegion& request) const;
+    void fill_buffer(ReadMap& reads) const;
+    std::size_t buffer_budget() const noexcept;
+    std::size_t fetch_budget() const noexcept;
+    void start_prefetch() const;
+    bool use_prefetch(const GenomicRegion& request) const;
+    void cancel_prefetch() const noexcept;
+    void record_unchecked_overflow() const noexcept;
+    void record_checked_fetch(const GenomicRegion& region) const;
     GenomicRegion get_max_fetch_region(const GenomicRegion& request) const;
     GenomicRegion get_default_max_fetch_region(const GenomicRegion& request) const;
     bool can_make_unchecked_fetch() const noexcept;
@@ -56,40 +56,39 @@ auto calculate_minimum_coverages(const ForwardIt first, const ForwardIt last,
     return result;
 }
 
-auto sample(const PositionCoverages& required_coverage)
+auto sample(const PositionCoverages& required_coverage, std::mt19937& generator)
 {
-    static std::mt19937 generator {42};
     // TODO: Do we really need to keep regenerating this distribution?
     boost::random::discrete_distribution<std::size_t> dist {std::cbegin(required_coverage), std::cend(required_coverage)};
     return dist(generator);
 }
 
 template <typename BidirIt>
-BidirIt random_sample(const BidirIt first, const BidirIt last)
+BidirIt random_sample(const BidirIt first, const BidirIt last, std::mt19937& generator)
 {
-    static std::mt19937 generator {42};
     boost::random::uniform_int_distribution<std::size_t> dist(0, std::distance(first, last) - 1);
     return std::next(first, dist(generator));
 }
 
 template <typename T>
-auto random_sample(const OverlapRange<T>& range)
+auto random_sample(const OverlapRange<T>& range, std::mt19937& generator)
 {
-    return random_sample(std::begin(range), std::end(range)).base();
+    return random_sample(std::begin(range), std::end(range), generator).base();
 }
 
 template <typename BidirIt>
 auto pick_sample(BidirIt first_unsampled, BidirIt last_unsampled,
                  const std::vector<GenomicRegion>& positions,
                  const PositionCoverages& required_coverage,
-                 const AlignedRead::MappingDomain::Size max_read_size)
+                 const AlignedRead::MappingDomain::Size max_read_size,
+                 std::mt19937& generator)
 {
     assert(first_unsampled < last_unsampled);
     const auto candidates = overlap_range(first_unsampled, last_unsampled,
-                                          positions[sample(required_coverage)],
+                                          positions[sample(required_coverage, generator)],
                                           max_read_size);
     assert(!candidates.empty());
-    return random_sample(candidates);
+    return random_sample(candidates, generator);
 }
 
 void reduce(PositionCoverages& coverages, const ReadWrapper& read, const GenomicRegion& region)
@@ -152,7 +151,7 @@ auto extract_sampled(std::vector<ReadWrapper>& reads,
 
 template <typename InputIt>
 auto sample(const InputIt first_read, const InputIt last_read, const GenomicRegion& region,
-            const unsigned target_coverage)
+            const unsigned target_coverage, std::mt19937& generator)
 {
     if (first_read == last_read) return std::vector<AlignedRead> {};
     const auto positions = decompose(region);
@@ -166,7 +165,7 @@ auto sample(const InputIt first_read, const InputIt last_read, const GenomicRegi
     auto last_unsampled_itr  = std::end(reads);
     while (!has_minimum_coverage(required_coverage)) {
         const auto sampled_itr = pick_sample(first_unsampled_itr, last_unsampled_itr,
-                                             positions, required_coverage, max_read_size);
+                                             positions, required_coverage, max_read_size, generator);
         reduce(required_coverage, *sampled_itr, region);
         remove_sample(first_unsampled_itr, sampled_itr, last_unsampled_itr);
     }
@@ -205,6 +204,8 @@ Downsampler::Report sample(ReadContainer& reads, const unsigned trigger_coverage
     if (reads.empty()) return result;
     const auto targets = find_target_regions(reads, trigger_coverage, target_coverage);
     if (targets.empty()) return result;
+    // Seeded per call so the result only depends on the reads, and samples can be downsampled concurrently
+    std::mt19937 generator {42};
     
     // We avoid using ReadContainers member methods for inserting sampled reads as they are order
     //  N log(size() + N) + N * size(). This is because they assume the input range is unsorted,
@@ -223,7 +224,7 @@ Downsampler::Report sample(ReadContainer& reads, const unsigned trigger_coverage
         const auto contained = bases(contained_range(begin(reads), end(reads), region));
         num_reads += std::distance(end(contained), end(reads));
         unsampled_read_blocks.emplace_back(make_move_iterator(end(contained)), make_move_iterator(end(reads)));
-        auto sampled_reads = sample(begin(contained), end(contained), region, target_coverage);
+        auto sampled_reads = sample(begin(contained), end(contained), region, target_coverage, generator);
         num_reads += sampled_reads.size();
         const auto num_reads_in_target = size(contained);
         assert(num_reads_in_target >= sampled_reads.size());
@@ -259,6 +260,16 @@ Downsampler::Downsampler(const unsigned trigger_coverage, const unsigned target_
     }
 }
 
+unsigned Downsampler::trigger_coverage() const noexcept
+{
+    return trigger_coverage_;
+}
+
+unsigned Downsampler::target_coverage() const noexcept
+{
+    return target_coverage_;
+}
+
 Downsampler::Report Downsampler::downsample(ReadContainer& reads) const
 {
     return sample(reads, trigger_coverage_, target_coverage_);
@@ -50,6 +50,9 @@ public:
     
     ~Downsampler() = default;
     
+    unsigned trigger_coverage() const noexcept;
+    unsigned target_coverage() const noexcept;
+    
     // Returns the number of reads removed
     Report downsample(ReadContainer& reads) const;
     
@@ -35,6 +35,11 @@ bool IsNotSecondaryAlignment::passes(const AlignedRead& read) const noexcept
     return !read.is_marked_secondary_alignment();
 }
 
+bool IsNotSecondaryAlignment::passes_core(const AlignedRead::Core& core) const noexcept
+{
+    return !core.flags.secondary_alignment;
+}
+
 IsNotSupplementaryAlignment::IsNotSupplementaryAlignment()
 : BasicReadFilter {"IsNotSupplementaryAlignment"} {}
 
@@ -46,6 +51,11 @@ bool IsNotSupplementaryAlignment::passes(const AlignedRead& read) const noexcept
     return !read.is_marked_supplementary_alignment();
 }
 
+bool IsNotSupplementaryAlignment::passes_core(const AlignedRead::Core& core) const noexcept
+{
+    return !core.flags.supplementary_alignment;
+}
+
 IsGoodMappingQuality::IsGoodMappingQuality(MappingQuality good_mapping_quality)
 :
 BasicReadFilter {"IsGoodMappingQuality"}
@@ -60,6 +70,11 @@ bool IsGoodMappingQuality::passes(const AlignedRead& read) const noexcept
     return read.mapping_quality() >= good_mapping_quality_;
 }
 
+bool IsGoodMappingQuality::passes_core(const AlignedRead::Core& core) const noexcept
+{
+    return core.mapping_quality >= good_mapping_quality_;
+}
+
 HasSufficientGoodBaseFraction::HasSufficientGoodBaseFraction(BaseQuality good_base_quality,
                                                              double min_good_base_fraction)
 : BasicReadFilter {"HasSufficientGoodBaseFraction"}
@@ -114,6 +129,11 @@ bool IsMapped::passes(const AlignedRead& read) const noexcept
     return !read.is_marked_unmapped();
 }
 
+bool IsMapped::passes_core(const AlignedRead::Core& core) const noexcept
+{
+    return !core.flags.unmapped;
+}
+
 IsNotChimeric::IsNotChimeric() : BasicReadFilter {"IsNotChimeric"} {}
 IsNotChimeric::IsNotChimeric(std::string name) :  BasicReadFilter {std::move(name)} {}
 
@@ -122,6 +142,11 @@ bool IsNotChimeric::passes(const AlignedRead& read) const noexcept
     return !read.has_other_segment();
 }
 
+bool IsNotChimeric::passes_core(const AlignedRead::Core& core) const noexcept
+{
+    return !core.has_other_segment;
+}
+
 IsNextSegmentMapped::IsNextSegmentMapped() : BasicReadFilter {"IsNextSegmentMapped"} {}
 IsNextSegmentMapped::IsNextSegmentMapped(std::string name) :  BasicReadFilter {std::move(name)} {}
 
@@ -130,6 +155,11 @@ bool IsNextSegmentMapped::passes(const AlignedRead& read) const noexcept
     return !read.has_other_segment() || !read.next_segment().is_marked_unmapped();
 }
 
+bool IsNextSegmentMapped::passes_core(const AlignedRead::Core& core) const noexcept
+{
+    return !core.has_other_segment || !core.next_segment_flags.unmapped;
+}
+
 IsNotMarkedDuplicate::IsNotMarkedDuplicate() : BasicReadFilter {"IsNotMarkedDuplicate"} {}
 IsNotMarkedDuplicate::IsNotMarkedDuplicate(std::string name) :  BasicReadFilter {std::move(name)} {}
 
@@ -138,6 +168,11 @@ bool IsNotMarkedDuplicate::passes(const AlignedRead& read) const noexcept
     return !read.is_marked_duplicate();
 }
 
+bool IsNotMarkedDuplicate::passes_core(const AlignedRead::Core& core) const noexcept
+{
+    return !core.flags.duplicate;
+}
+
 IsShort::IsShort(Length max_length)
 : BasicReadFilter {"IsShort"}
 , max_length_ {max_length} {}
@@ -184,6 +219,11 @@ bool IsNotMarkedQcFail::passes(const AlignedRead& read) const noexcept
     return !read.is_marked_qc_fail();
 }
 
+bool IsNotMarkedQcFail::passes_core(const AlignedRead::Core& core) const noexcept
+{
+    return !core.flags.qc_fail;
+}
+
 IsProperTemplate::IsProperTemplate() : BasicReadFilter {"IsProperTemplate"} {}
 IsProperTemplate::IsProperTemplate(std::string name) :  BasicReadFilter {std::move(name)} {}
 
@@ -192,6 +232,11 @@ bool IsProperTemplate::passes(const AlignedRead& read) const noexcept
     return !read.has_other_segment() || read.is_marked_all_segments_in_read_aligned();
 }
 
+bool IsProperTemplate::passes_core(const AlignedRead::Core& core) const noexcept
+{
+    return !core.has_other_segment || core.flags.all_segments_in_read_aligned;
+}
+
 IsLocalTemplate::IsLocalTemplate() : BasicReadFilter {"IsLocalTemplate"} {}
 IsLocalTemplate::IsLocalTemplate(std::string name) :  BasicReadFilter {std::move(name)} {}
 
@@ -200,5 +245,10 @@ bool IsLocalTemplate::passes(const AlignedRead& read) const noexcept
     return !read.has_other_segment() || read.next_segment().contig_name() == contig_name(read);
 }
 
+bool IsLocalTemplate::passes_core(const AlignedRead::Core& core) const noexcept
+{
+    return !core.has_other_segment || core.is_next_segment_on_same_contig;
+}
+
 } // namespace readpipe
 } // namespace octopus
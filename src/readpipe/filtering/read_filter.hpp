@@ -49,11 +49,21 @@ public:
         return passes(read);
     }
     
+    // Only meaningful if is_core_filter() is true
+    bool operator()(const AlignedRead::Core& core) const noexcept
+    {
+        return passes_core(core);
+    }
+    
+    // Core filters can be evaluated on AlignedRead::Core alone, so may be applied before reads are decoded
+    virtual bool is_core_filter() const noexcept { return false; }
+    
 protected:
     BasicReadFilter(std::string name) : Nameable {std::move(name)} {};
     
 private:
     virtual bool passes(const AlignedRead&) const noexcept = 0;
+    virtual bool passes_core(const AlignedRead::Core&) const noexcept { return true; }
 };
 
 struct HasWellFormedCigar : BasicReadFilter
@@ -78,6 +88,8 @@ struct IsNotSecondaryAlignment : BasicReadFilter
     IsNotSecondaryAlignment(std::string name);
     
     bool passes(const AlignedRead& read) const noexcept override;
+    bool is_core_filter() const noexcept override { return true; }
+    bool passes_core(const AlignedRead::Core& core) const noexcept override;
 };
 
 struct IsNotSupplementaryAlignment : BasicReadFilter
@@ -86,6 +98,8 @@ struct IsNotSupplementaryAlignment : BasicReadFilter
     IsNotSupplementaryAlignment(std::string name);
     
     bool passes(const AlignedRead& read) const noexcept override;
+    bool is_core_filter() const noexcept override { return true; }
+    bool passes_core(const AlignedRead::Core& core) const noexcept override;
 };
 
 struct IsGoodMappingQuality : BasicReadFilter
@@ -99,6 +113,8 @@ struct IsGoodMappingQuality : BasicReadFilter
     IsGoodMappingQuality(std::string name, MappingQuality good_mapping_quality);
     
     bool passes(const AlignedRead& read) const noexcept override;
+    bool is_core_filter() const noexcept override { return true; }
+    bool passes_core(const AlignedRead::Core& core) const noexcept override;
     
 private:
     MappingQuality good_mapping_quality_;
@@ -144,6 +160,8 @@ struct IsMapped : BasicReadFilter
     IsMapped(std::string name);
     
     bool passes(const AlignedRead& read) const noexcept override;
+    bool is_core_filter() const noexcept override { return true; }
+    bool passes_core(const AlignedRead::Core& core) const noexcept override;
 };
 
 struct IsNotChimeric : BasicReadFilter
@@ -152,6 +170,8 @@ struct IsNotChimeric : BasicReadFilter
     IsNotChimeric(std::string name);
     
     bool passes(const AlignedRead& read) const noexcept override;
+    bool is_core_filter() const noexcept override { return true; }
+    bool passes_core(const AlignedRead::Core& core) const noexcept override;
 };
 
 struct IsNextSegmentMapped : BasicReadFilter
@@ -160,6 +180,8 @@ struct IsNextSegmentMapped : BasicReadFilter
     IsNextSegmentMapped(std::string name);
     
     bool passes(const AlignedRead& read) const noexcept override;
+    bool is_core_filter() const noexcept override { return true; }
+    bool passes_core(const AlignedRead::Core& core) const noexcept override;
 };
 
 struct IsNotMarkedDuplicate : BasicReadFilter
@@ -168,6 +190,8 @@ struct IsNotMarkedDuplicate : BasicReadFilter
     IsNotMarkedDuplicate(std::string name);
     
     bool passes(const AlignedRead& read) const noexcept override;
+    bool is_core_filter() const noexcept override { return true; }
+    bool passes_core(const AlignedRead::Core& core) const noexcept override;
 };
 
 struct IsShort : BasicReadFilter
@@ -212,6 +236,8 @@ struct IsNotMarkedQcFail : BasicReadFilter
     IsNotMarkedQcFail(std::string name);
     
     bool passes(const AlignedRead& read) const noexcept override;
+    bool is_core_filter() const noexcept override { return true; }
+    bool passes_core(const AlignedRead::Core& core) const noexcept override;
 };
 
 struct IsProperTemplate : BasicReadFilter
@@ -220,6 +246,8 @@ struct IsProperTemplate : BasicReadFilter
     IsProperTemplate(std::string name);
     
     bool passes(const AlignedRead& read) const noexcept override;
+    bool is_core_filter() const noexcept override { return true; }
+    bool passes_core(const AlignedRead::Core& core) const noexcept override;
 };
     
 struct IsLocalTemplate : BasicReadFilter
@@ -228,6 +256,8 @@ struct IsLocalTemplate : BasicReadFilter
     IsLocalTemplate(std::string name);
     
     bool passes(const AlignedRead& read) const noexcept override;
+    bool is_core_filter() const noexcept override { return true; }
+    bool passes_core(const AlignedRead::Core& core) const noexcept override;
 };
 
 // Context filters
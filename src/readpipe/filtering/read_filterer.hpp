@@ -11,6 +11,9 @@
 #include <iterator>
 #include <type_traits>
 #include <utility>
+#include <numeric>
+#include <mutex>
+#include <chrono>
 
 #include <boost/optional.hpp>
 
@@ -24,6 +27,11 @@ namespace octopus { namespace readpipe
  
  This is a template class as the type of iterator used for context-based filteration needs to be 
  known at compile time. The class needs to know what container it is going to be operating on.
+ 
+ Basic filters are not applied in the order they are added. The filterer measures the cost and rejection
+ rate of each basic filter as reads are filtered, and periodically reorders them so filters that are cheap
+ and reject many reads come first, minimising the expected cost of filtering a read. Filter counts are
+ attributed to the first failing filter in the current order.
  */
 template <typename BidirIt>
 class ReadFilterer
@@ -36,10 +44,10 @@ public:
     
     using FilterCountMap = std::unordered_map<std::string, std::size_t>;
     
-    ReadFilterer() = default;
+    ReadFilterer();
     
-    ReadFilterer(const ReadFilterer&)            = default;
-    ReadFilterer& operator=(const ReadFilterer&) = default;
+    ReadFilterer(const ReadFilterer&)            = delete;
+    ReadFilterer& operator=(const ReadFilterer&) = delete;
     ReadFilterer(ReadFilterer&&)                 = default;
     ReadFilterer& operator=(ReadFilterer&&)      = default;
     
@@ -50,6 +58,12 @@ public:
     
     unsigned num_filters() const noexcept;
     
+    bool has_core_filters() const noexcept;
+    
+    // Only checks filters that can be evaluated before a read is decoded. Reads failing these would
+    // also be removed by remove, so callers may drop them early.
+    bool passes_core_filters(const AlignedRead::Core& core) const noexcept;
+    
     void shrink_to_fit() noexcept; // Just removes extra capcity for filters
     
     // Like std::remove
@@ -61,17 +75,77 @@ public:
     BidirIt partition(ReadIterator first, ReadIterator last, FilterCountMap& filter_counts) const;
     
 private:
+    using FilterOrder = std::shared_ptr<const std::vector<std::size_t>>;
+    
+    struct FilterStats
+    {
+        std::size_t num_evaluated = 0, num_rejected = 0, num_timed = 0;
+        double seconds = 0;
+    };
+    
+    // Stats of one filtering pass, so filters are only reordered between passes
+    class BasicFilterPass
+    {
+    public:
+        BasicFilterPass(const ReadFilterer& filterer);
+        BasicFilterPass(const BasicFilterPass&)            = delete;
+        BasicFilterPass& operator=(const BasicFilterPass&) = delete;
+        ~BasicFilterPass();
+        // Returns the index of the first failing filter, or the number of filters if the read passes
+        std::size_t find_failing_filter(const AlignedRead& read);
+    private:
+        const ReadFilterer& filterer_;
+        FilterOrder order_;
+        std::vector<FilterStats> stats_;
+        std::size_t num_reads_;
+    };
+    
+    // Shared by concurrent filtering passes
+    struct FilterScheduler
+    {
+        std::mutex mutex;
+        FilterOrder order;
+        std::vector<FilterStats> stats;
+        std::size_t num_reads_since_reorder = 0;
+    };
+    
+    static constexpr std::size_t timingInterval {64}; // only every nth read is timed
+    static constexpr std::size_t reorderInterval {100'000}; // reads
+    
     std::vector<BasicFilterPtr> basic_filters_;
     std::vector<ContextFilterPtr> context_filters_;
+    std::vector<const BasicReadFilter*> core_filters_;
+    std::unique_ptr<FilterScheduler> scheduler_;
     
-    bool passes_all_basic_filters(const AlignedRead& read) const noexcept;
-    auto find_failing_basic_filter(const AlignedRead& read) const noexcept;
+    FilterOrder order() const;
+    void update(const std::vector<FilterStats>& stats, std::size_t num_reads) const;
 };
 
+template <typename BidirIt>
+constexpr std::size_t ReadFilterer<BidirIt>::timingInterval;
+template <typename BidirIt>
+constexpr std::size_t ReadFilterer<BidirIt>::reorderInterval;
+
+template <typename BidirIt>
+ReadFilterer<BidirIt>::ReadFilterer()
+: basic_filters_ {}
+, context_filters_ {}
+, core_filters_ {}
+, scheduler_ {std::make_unique<FilterScheduler>()}
+{
+    scheduler_->order = std::make_shared<std::vector<std::size_t>>();
+}
+
 template <typename BidirIt>
 void ReadFilterer<BidirIt>::add(BasicFilterPtr filter)
 {
+    if (filter->is_core_filter()) core_filters_.push_back(filter.get());
     basic_filters_.emplace_back(std::move(filter));
+    std::vector<std::size_t> order(basic_filters_.size());
+    std::iota(std::begin(order), std::end(order), std::size_t {0});
+    scheduler_->order = std::make_shared<std::vector<std::size_t>>(std::move(order));
+    scheduler_->stats.assign(basic_filters_.size(), FilterStats {});
+    scheduler_->num_reads_since_reorder = 0;
 }
 
 template <typename BidirIt>
@@ -86,11 +160,25 @@ unsigned ReadFilterer<BidirIt>::num_filters() const noexcept
     return static_cast<unsigned>(basic_filters_.size() + context_filters_.size());
 }
 
+template <typename BidirIt>
+bool ReadFilterer<BidirIt>::has_core_filters() const noexcept
+{
+    return !core_filters_.empty();
+}
+
+template <typename BidirIt>
+bool ReadFilterer<BidirIt>::passes_core_filters(const AlignedRead::Core& core) const noexcept
+{
+    return std::all_of(std::cbegin(core_filters_), std::cend(core_filters_),
+                       [&core] (const auto filter) { return (*filter)(core); });
+}
+
 template <typename BidirIt>
 void ReadFilterer<BidirIt>::shrink_to_fit() noexcept
 {
     basic_filters_.shrink_to_fit();
     context_filters_.shrink_to_fit();
+    core_filters_.shrink_to_fit();
 }
 
 template <typename BidirIt>
@@ -99,9 +187,10 @@ BidirIt ReadFilterer<BidirIt>::remove(BidirIt first, BidirIt last) const
     if (first == last || num_filters() == 0) return last;
     
     if (!basic_filters_.empty()) {
+        BasicFilterPass pass {*this};
         last = std::remove_if(first, last,
-                              [this] (const AlignedRead& read) {
-                                  return !passes_all_basic_filters(read);
+                              [this, &pass] (const AlignedRead& read) {
+                                  return pass.find_failing_filter(read) < basic_filters_.size();
                               });
     }
     
@@ -118,11 +207,11 @@ BidirIt ReadFilterer<BidirIt>::partition(BidirIt first, BidirIt last) const
 {
     if (first == last || num_filters() == 0) return last;
     
-    const auto passes_basic_filters = [this] (const AlignedRead& read) {
-        return !passes_all_basic_filters(read);
-    };
-    
     if (!basic_filters_.empty()) {
+        BasicFilterPass pass {*this};
+        const auto passes_basic_filters = [this, &pass] (const AlignedRead& read) {
+            return pass.find_failing_filter(read) < basic_filters_.size();
+        };
         if (context_filters_.empty()) {
             last = std::partition(first, last, passes_basic_filters);
         } else {
@@ -157,13 +246,14 @@ BidirIt ReadFilterer<BidirIt>::remove(BidirIt first, BidirIt last,
     
     if (!basic_filters_.empty()) {
         std::vector<std::size_t> flat_counts(basic_filters_.size(), 0);
+        BasicFilterPass pass {*this};
         
         last = std::remove_if(first, last,
-                              [this, &flat_counts] (const AlignedRead& read) {
-                                  const auto it = find_failing_basic_filter(read);
+                              [&pass, &flat_counts] (const AlignedRead& read) {
+                                  const auto idx = pass.find_failing_filter(read);
                                   
-                                  if (it != std::cend(basic_filters_)) {
-                                      ++flat_counts[std::distance(std::cbegin(basic_filters_), it)];
+                                  if (idx < flat_counts.size()) {
+                                      ++flat_counts[idx];
                                       return true;
                                   }
                                   
@@ -210,13 +300,14 @@ BidirIt ReadFilterer<BidirIt>::partition(BidirIt first, BidirIt last,
     
     if (!basic_filters_.empty()) {
         std::vector<std::size_t> flat_counts(basic_filters_.size(), 0);
+        BasicFilterPass pass {*this};
         
         last = std::stable_partition(first, last,
-                      [this, &flat_counts] (const AlignedRead& read) {
-                          const auto it = find_failing_basic_filter(read);
+                      [&pass, &flat_counts] (const AlignedRead& read) {
+                          const auto idx = pass.find_failing_filter(read);
                           
-                          if (it != std::cend(basic_filters_)) {
-                              ++flat_counts[std::distance(std::cbegin(basic_filters_), it)];
+                          if (idx < flat_counts.size()) {
+                              ++flat_counts[idx];
                               return true;
                           }
                           
@@ -247,17 +338,83 @@ BidirIt ReadFilterer<BidirIt>::partition(BidirIt first, BidirIt last,
 // private member methods
 
 template <typename BidirIt>
-bool ReadFilterer<BidirIt>::passes_all_basic_filters(const AlignedRead& read) const noexcept
+typename ReadFilterer<BidirIt>::FilterOrder ReadFilterer<BidirIt>::order() const
+{
+    std::lock_guard<std::mutex> lock {scheduler_->mutex};
+    return scheduler_->order;
+}
+
+template <typename BidirIt>
+void ReadFilterer<BidirIt>::update(const std::vector<FilterStats>& stats, const std::size_t num_reads) const
+{
+    std::lock_guard<std::mutex> lock {scheduler_->mutex};
+    auto& totals = scheduler_->stats;
+    for (std::size_t i {0}; i < totals.size(); ++i) {
+        totals[i].num_evaluated += stats[i].num_evaluated;
+        totals[i].num_rejected  += stats[i].num_rejected;
+        totals[i].num_timed     += stats[i].num_timed;
+        totals[i].seconds       += stats[i].seconds;
+    }
+    scheduler_->num_reads_since_reorder += num_reads;
+    if (scheduler_->num_reads_since_reorder < reorderInterval) return;
+    // Running the filters in increasing order of cost / rejection rate minimises the expected cost per read
+    std::vector<double> scores(totals.size());
+    std::transform(std::cbegin(totals), std::cend(totals), std::begin(scores), [] (const FilterStats& filter) {
+        const auto cost = filter.num_timed > 0 ? filter.seconds / filter.num_timed : 0.0;
+        const auto rejection_rate = filter.num_evaluated > 0 ? double(filter.num_rejected) / filter.num_evaluated : 0.0;
+        return cost / (rejection_rate + 1e-6);
+    });
+    auto order = *scheduler_->order;
+    std::stable_sort(std::begin(order), std::end(order),
+                     [&scores] (auto lhs, auto rhs) { return scores[lhs] < scores[rhs]; });
+    scheduler_->order = std::make_shared<std::vector<std::size_t>>(std::move(order));
+    // Decay the stats so the order can follow changes in the reads
+    for (auto& filter : totals) {
+        filter.num_evaluated /= 2;
+        filter.num_rejected  /= 2;
+        filter.num_timed     /= 2;
+        filter.seconds       /= 2;
+    }
+    scheduler_->num_reads_since_reorder = 0;
+}
+
+template <typename BidirIt>
+ReadFilterer<BidirIt>::BasicFilterPass::BasicFilterPass(const ReadFilterer& filterer)
+: filterer_ {filterer}
+, order_ {filterer.order()}
+, stats_(filterer.basic_filters_.size())
+, num_reads_ {0}
+{}
+
+template <typename BidirIt>
+ReadFilterer<BidirIt>::BasicFilterPass::~BasicFilterPass()
 {
-    return std::all_of(std::cbegin(basic_filters_), std::cend(basic_filters_),
-                       [&read] (const auto& filter) { return (*filter)(read); });
+    filterer_.update(stats_, num_reads_);
 }
 
 template <typename BidirIt>
-auto ReadFilterer<BidirIt>::find_failing_basic_filter(const AlignedRead& read) const noexcept
+std::size_t ReadFilterer<BidirIt>::BasicFilterPass::find_failing_filter(const AlignedRead& read)
 {
-    return std::find_if_not(std::cbegin(basic_filters_), std::cend(basic_filters_),
-                            [&read] (const auto& filter) { return (*filter)(read); });
+    using Clock = std::chrono::steady_clock;
+    const bool timed {num_reads_++ % timingInterval == 0};
+    for (const auto idx : *order_) {
+        auto& stats = stats_[idx];
+        ++stats.num_evaluated;
+        bool passes;
+        if (timed) {
+            const auto start = Clock::now();
+            passes = (*filterer_.basic_filters_[idx])(read);
+            stats.seconds += std::chrono::duration<double> {Clock::now() - start}.count();
+            ++stats.num_timed;
+        } else {
+            passes = (*filterer_.basic_filters_[idx])(read);
+        }
+        if (!passes) {
+            ++stats.num_rejected;
+            return idx;
+        }
+    }
+    return stats_.size();
 }
 
 // non-member methods
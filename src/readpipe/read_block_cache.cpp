@@ -0,0 +1,62 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "read_block_cache.hpp"
+
+#include <utility>
+#include <algorithm>
+
+namespace octopus {
+
+ReadBlockCache::ReadBlockCache(const std::size_t max_blocks)
+: blocks_ {}
+, put_order_ {}
+, max_blocks_ {std::max(max_blocks, std::size_t {1})}
+, mutex_ {}
+{}
+
+ReadBlockCache::Block ReadBlockCache::take(const GenomicRegion& region)
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    const auto itr = blocks_.find(region);
+    if (itr == std::end(blocks_)) return nullptr;
+    auto result = std::move(itr->second);
+    blocks_.erase(itr);
+    return result;
+}
+
+void ReadBlockCache::put(const GenomicRegion& region, Block block)
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    const auto p = blocks_.emplace(region, std::move(block));
+    if (!p.second) {
+        blocks_.erase(p.first);
+        return;
+    }
+    put_order_.push_back(region);
+    // Regions in put_order_ may already have been taken, so only evict while over capacity
+    while (blocks_.size() > max_blocks_ && !put_order_.empty()) {
+        blocks_.erase(put_order_.front());
+        put_order_.pop_front();
+    }
+    if (put_order_.size() > 2 * max_blocks_) {
+        put_order_.erase(std::remove_if(std::begin(put_order_), std::end(put_order_),
+                                        [this] (const auto& region) { return blocks_.count(region) == 0; }),
+                         std::end(put_order_));
+    }
+}
+
+std::size_t ReadBlockCache::size() const noexcept
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    return blocks_.size();
+}
+
+void ReadBlockCache::clear() noexcept
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    blocks_.clear();
+    put_order_.clear();
+}
+
+} // namespace octopus
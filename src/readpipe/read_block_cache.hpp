@@ -0,0 +1,57 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef read_block_cache_hpp
+#define read_block_cache_hpp
+
+#include <map>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <cstddef>
+
+#include "config/common.hpp"
+#include "basics/genomic_region.hpp"
+
+namespace octopus {
+
+/*
+ ReadBlockCache is a thread safe store of processed read blocks keyed by region, through which
+ concurrent fetches of overlapping regions share the reads in their overlap. A block is put by the
+ first fetch to process it and taken, as an immutable view, by the next fetch that asks for the same
+ region, which evicts it. Blocks nobody takes are evicted oldest first once there are max_blocks.
+ */
+class ReadBlockCache
+{
+public:
+    using Block = std::shared_ptr<const ReadMap>;
+    
+    ReadBlockCache() = delete;
+    
+    ReadBlockCache(std::size_t max_blocks);
+    
+    ReadBlockCache(const ReadBlockCache&)            = delete;
+    ReadBlockCache& operator=(const ReadBlockCache&) = delete;
+    ReadBlockCache(ReadBlockCache&&)                 = delete;
+    ReadBlockCache& operator=(ReadBlockCache&&)      = delete;
+    
+    ~ReadBlockCache() = default;
+    
+    // Returns nullptr if there is no block for region
+    Block take(const GenomicRegion& region);
+    // If a block for region was put concurrently neither is kept, as both fetches have already processed it
+    void put(const GenomicRegion& region, Block block);
+    
+    std::size_t size() const noexcept;
+    void clear() noexcept;
+    
+private:
+    std::map<GenomicRegion, Block> blocks_;
+    std::deque<GenomicRegion> put_order_;
+    std::size_t max_blocks_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace octopus
+
+#endif
@@ -6,9 +6,13 @@
 #include <utility>
 #include <iterator>
 #include <algorithm>
+#include <future>
+#include <exception>
+#include <memory>
 #include <cassert>
 
 #include "utils/read_stats.hpp"
+#include "utils/stage_profiler.hpp"
 #include "utils/mappable_algorithms.hpp"
 
 namespace octopus {
@@ -27,6 +31,9 @@ ReadPipe::ReadPipe(const ReadManager& source, ReadTransformer transformer, ReadF
 , postfilter_transformer_ {}
 , downsampler_ {std::move(downsampler)}
 , samples_ {std::move(samples)}
+, transform_workers_ {}
+, fetch_edge_size_ {0}
+, fetch_edge_cache_ {}
 , debug_log_ {}
 {
     if (DEBUG_MODE) debug_log_ = logging::DebugLogger {};
@@ -41,6 +48,9 @@ ReadPipe::ReadPipe(const ReadManager& source, ReadTransformer prefilter_transfor
 , postfilter_transformer_ {std::move(postfilter_transformer)}
 , downsampler_ {std::move(downsampler)}
 , samples_ {std::move(samples)}
+, transform_workers_ {}
+, fetch_edge_size_ {0}
+, fetch_edge_cache_ {}
 , debug_log_ {}
 {
     if (DEBUG_MODE) debug_log_ = logging::DebugLogger {};
@@ -73,8 +83,29 @@ const std::vector<SampleName>& ReadPipe::samples() const noexcept
     return samples_;
 }
 
+void ReadPipe::set_num_transform_threads(const unsigned num_threads)
+{
+    if (num_threads > 1) {
+        transform_workers_ = std::make_shared<ThreadPool>(num_threads);
+    } else {
+        transform_workers_ = nullptr;
+    }
+}
+
+void ReadPipe::share_fetch_edges(const GenomicRegion::Size edge_size, const std::size_t max_blocks)
+{
+    fetch_edge_size_ = edge_size;
+    if (edge_size > 0) {
+        fetch_edge_cache_ = std::make_shared<ReadBlockCache>(max_blocks);
+    } else {
+        fetch_edge_cache_ = nullptr;
+    }
+}
+
 namespace {
 
+static constexpr unsigned streaming_coverage_headroom {2};
+
 template <typename Map>
 void sort_each(Map& reads)
 {
@@ -83,9 +114,11 @@ void sort_each(Map& reads)
     }
 }
 
-auto fetch_batch(const ReadManager& rm, const std::vector<SampleName>& samples, const GenomicRegion& region)
+auto fetch_batch(const ReadManager& rm, const std::vector<SampleName>& samples, const GenomicRegion& region,
+                 const ReadManager::ReadPrefilter& prefilter, const boost::optional<unsigned> max_coverage)
 {
-    auto result = rm.fetch_reads(samples, region);
+    profiling::StageTimer timer {profiling::Stage::read_fetch};
+    auto result = rm.fetch_reads(samples, region, prefilter, max_coverage);
     sort_each(result);
     return result;
 }
@@ -131,49 +164,59 @@ void shrink_to_fit(ReadMap& reads)
 ReadMap ReadPipe::fetch_reads(const GenomicRegion& region, boost::optional<Report&> report) const
 {
     using namespace readpipe;
+    if (can_share_fetch_edges(region)) return fetch_reads_sharing_edges(region, report);
     ReadMap result {samples_.size()};
     for (const auto& sample : samples_) {
         result.emplace(std::piecewise_construct, std::forward_as_tuple(sample), std::forward_as_tuple());
     }
+    ReadManager::ReadPrefilter prefilter {};
+    if (!debug_log_ && filterer_.has_core_filters()) {
+        // These reads would be removed by filterer_ anyway, so avoid decoding them. Not done when
+        // logging as filter counts would be wrong.
+        prefilter = [this] (const AlignedRead::Core& core) { return filterer_.passes_core_filters(core); };
+    }
+    boost::optional<unsigned> max_coverage {};
+    if (downsampler_) {
+        // Bound the reads decoded in very deep regions. The headroom leaves the downsampler enough
+        // reads to choose from, and to cover reads that are later filtered.
+        max_coverage = streaming_coverage_headroom * downsampler_->trigger_coverage();
+    }
     for (const auto& batch : batch_samples(samples_)) {
-        auto batch_reads = fetch_batch(source_, batch, region);
-        if (debug_log_) {
-            stream(*debug_log_) << "Fetched " << count_reads(batch_reads) << " unfiltered reads from " << region;
+        auto batch_reads = fetch_batch(source_, batch, region, prefilter, max_coverage);
+        if (!debug_log_) {
+            process(batch_reads, result, report);
+            continue;
         }
-        transform_reads(batch_reads, prefilter_transformer_);
-        if (debug_log_) {
-            SampleFilterCountMap<SampleName, decltype(filterer_)> filter_counts {};
-            filter_counts.reserve(samples_.size());
-            for (const auto& sample : samples_) {
-                filter_counts[sample].reserve(filterer_.num_filters());
-            }
-            erase_filtered_reads(batch_reads, filter(batch_reads, filterer_, filter_counts));
-            if (filterer_.num_filters() > 0) {
-                for (const auto& p : filter_counts) {
-                    stream(*debug_log_) << "In sample " << p.first;
-                    if (!p.second.empty()) {
-                        for (const auto& c : p.second) {
-                            stream(*debug_log_) << c.second << " failed the " << c.first << " filter";
-                        }
-                    } else {
-                        *debug_log_ << "No reads were filtered";
+        // Staged so the filter counts of each sample can be logged
+        stream(*debug_log_) << "Fetched " << count_reads(batch_reads) << " unfiltered reads from " << region;
+        transform(batch_reads, prefilter_transformer_);
+        SampleFilterCountMap<SampleName, decltype(filterer_)> filter_counts {};
+        filter_counts.reserve(samples_.size());
+        for (const auto& sample : samples_) {
+            filter_counts[sample].reserve(filterer_.num_filters());
+        }
+        erase_filtered_reads(batch_reads, filter(batch_reads, filterer_, filter_counts));
+        if (filterer_.num_filters() > 0) {
+            for (const auto& p : filter_counts) {
+                stream(*debug_log_) << "In sample " << p.first;
+                if (!p.second.empty()) {
+                    for (const auto& c : p.second) {
+                        stream(*debug_log_) << c.second << " failed the " << c.first << " filter";
                     }
+                } else {
+                    *debug_log_ << "No reads were filtered";
                 }
             }
-        } else {
-            erase_filtered_reads(batch_reads, filter(batch_reads, filterer_));
         }
         if (postfilter_transformer_) {
-            transform_reads(batch_reads, *postfilter_transformer_);
+            transform(batch_reads, *postfilter_transformer_);
         }
-        if (debug_log_) {
-            stream(*debug_log_) << "There are " << count_reads(batch_reads) << " reads in " << region
+        stream(*debug_log_) << "There are " << count_reads(batch_reads) << " reads in " << region
                             << " after filtering";
-        }
         if (downsampler_) {
             auto reads = make_mappable_map(std::move(batch_reads));
             auto downsample_reports = downsample(reads, *downsampler_);
-            if (debug_log_) stream(*debug_log_) << "Downsampling removed " << count_downsampled_reads(downsample_reports) << " reads from " << region;
+            stream(*debug_log_) << "Downsampling removed " << count_downsampled_reads(downsample_reports) << " reads from " << region;
             if (report) {
                 report->downsample_report = std::move(downsample_reports);
             }
@@ -186,6 +229,184 @@ ReadMap ReadPipe::fetch_reads(const GenomicRegion& region, boost::optional<Repor
     return result;
 }
 
+// private methods
+
+void ReadPipe::transform(ReadManager::SampleReadMap& reads, const ReadTransformer& transformer) const
+{
+    profiling::StageTimer timer {profiling::Stage::read_transform};
+    using readpipe::transform_reads;
+    if (!transform_workers_ || reads.size() < 2 || transformer.num_transforms() == 0) {
+        transform_reads(reads, transformer);
+        return;
+    }
+    std::vector<std::future<void>> tasks {};
+    tasks.reserve(reads.size() - 1);
+    auto first = std::begin(reads);
+    for (auto itr = std::next(first); itr != std::end(reads); ++itr) {
+        auto& sample_reads = itr->second;
+        tasks.push_back(transform_workers_->push([&sample_reads, &transformer] () { transform_reads(sample_reads, transformer); }));
+    }
+    std::exception_ptr error {};
+    try {
+        transform_reads(first->second, transformer);
+    } catch (...) {
+        error = std::current_exception();
+    }
+    // Wait for every task, even after an error, as they reference reads
+    for (auto& task : tasks) {
+        try {
+            task.get();
+        } catch (...) {
+            if (!error) error = std::current_exception();
+        }
+    }
+    if (error) std::rethrow_exception(error);
+}
+
+void ReadPipe::process(ReadManager::ReadContainer& reads, ReadMap::mapped_type& result,
+                       boost::optional<Downsampler::Report>& report, const bool downsample) const
+{
+    using namespace readpipe;
+    {
+        profiling::StageTimer timer {profiling::Stage::read_transform};
+        transform_reads(reads, prefilter_transformer_);
+    }
+    reads.erase(remove(reads, filterer_), std::end(reads));
+    if (postfilter_transformer_) {
+        profiling::StageTimer timer {profiling::Stage::read_transform};
+        transform_reads(reads, *postfilter_transformer_);
+    }
+    ReadMap::mapped_type sample_reads {std::make_move_iterator(std::begin(reads)), std::make_move_iterator(std::end(reads))};
+    reads.clear();
+    reads.shrink_to_fit();
+    if (downsampler_ && downsample) report = downsampler_->downsample(sample_reads);
+    if (result.empty()) {
+        result = std::move(sample_reads);
+    } else {
+        result.insert(std::make_move_iterator(std::begin(sample_reads)), std::make_move_iterator(std::end(sample_reads)));
+    }
+}
+
+void ReadPipe::process(ReadManager::SampleReadMap& reads, ReadMap& result, boost::optional<Report&> report,
+                       const bool downsample) const
+{
+    if (reads.empty()) return;
+    // Each task only touches its own sample's reads, result and report
+    std::vector<boost::optional<Downsampler::Report>> sample_reports(reads.size());
+    std::vector<std::future<void>> tasks {};
+    auto first = std::begin(reads);
+    if (transform_workers_) {
+        tasks.reserve(reads.size() - 1);
+        auto report_itr = std::next(std::begin(sample_reports));
+        for (auto itr = std::next(first); itr != std::end(reads); ++itr, ++report_itr) {
+            auto& sample_reads = itr->second;
+            auto& sample_result = result.at(itr->first);
+            auto& sample_report = *report_itr;
+            tasks.push_back(transform_workers_->push([&, this] () { process(sample_reads, sample_result, sample_report, downsample); }));
+        }
+    }
+    std::exception_ptr error {};
+    try {
+        process(first->second, result.at(first->first), sample_reports.front(), downsample);
+        if (!transform_workers_) {
+            auto report_itr = std::next(std::begin(sample_reports));
+            for (auto itr = std::next(first); itr != std::end(reads); ++itr, ++report_itr) {
+                process(itr->second, result.at(itr->first), *report_itr, downsample);
+            }
+        }
+    } catch (...) {
+        error = std::current_exception();
+    }
+    // Wait for every task, even after an error, as they reference reads
+    for (auto& task : tasks) {
+        try {
+            task.get();
+        } catch (...) {
+            if (!error) error = std::current_exception();
+        }
+    }
+    if (error) std::rethrow_exception(error);
+    if (report && downsampler_ && downsample) {
+        report->downsample_report.clear();
+        auto report_itr = std::begin(sample_reports);
+        for (const auto& p : reads) {
+            if (*report_itr) report->downsample_report.emplace(p.first, std::move(**report_itr));
+            ++report_itr;
+        }
+    }
+    reads.clear();
+}
+
+bool ReadPipe::can_share_fetch_edges(const GenomicRegion& region) const noexcept
+{
+    // Filter counts are only logged for whole fetches
+    return fetch_edge_cache_ && !debug_log_ && size(region) >= 2 * fetch_edge_size_;
+}
+
+namespace {
+
+template <typename UnaryPredicate>
+void erase_reads_if(ReadManager::SampleReadMap& reads, UnaryPredicate pred)
+{
+    for (auto& p : reads) {
+        p.second.erase(std::remove_if(std::begin(p.second), std::end(p.second), pred), std::end(p.second));
+    }
+}
+
+template <typename UnaryPredicate>
+void insert_block_if(const ReadMap& block, ReadMap& reads, UnaryPredicate pred)
+{
+    for (const auto& p : block) {
+        auto& sample_reads = reads.at(p.first);
+        for (const auto& read : p.second) {
+            if (pred(read)) sample_reads.insert(read);
+        }
+    }
+}
+
+} // namespace
+
+// Reads overlapping an edge block are either taken from the cache, or processed here and put in the
+// cache for the fetch on the other side of the edge. Reads overlapping both edges always come from the head.
+ReadMap ReadPipe::fetch_reads_sharing_edges(const GenomicRegion& region, boost::optional<Report&> report) const
+{
+    const auto head = head_region(region, fetch_edge_size_), tail = tail_region(region, fetch_edge_size_);
+    const auto head_block = fetch_edge_cache_->take(head), tail_block = fetch_edge_cache_->take(tail);
+    const GenomicRegion fetch_region {region.contig_name(), head_block ? head.end() : region.begin(),
+                                      tail_block ? tail.begin() : region.end()};
+    ReadMap result {samples_.size()};
+    for (const auto& sample : samples_) {
+        result.emplace(std::piecewise_construct, std::forward_as_tuple(sample), std::forward_as_tuple());
+    }
+    ReadManager::ReadPrefilter prefilter {};
+    if (filterer_.has_core_filters()) {
+        prefilter = [this] (const AlignedRead::Core& core) { return filterer_.passes_core_filters(core); };
+    }
+    boost::optional<unsigned> max_coverage {};
+    if (downsampler_) max_coverage = streaming_coverage_headroom * downsampler_->trigger_coverage();
+    for (const auto& batch : batch_samples(samples_)) {
+        auto batch_reads = fetch_batch(source_, batch, fetch_region, prefilter, max_coverage);
+        erase_reads_if(batch_reads, [&] (const auto& read) {
+            return overlaps(read, head) ? static_cast<bool>(head_block) : tail_block && overlaps(read, tail);
+        });
+        process(batch_reads, result, boost::none, false);
+    }
+    if (head_block) insert_block_if(*head_block, result, [] (const auto&) { return true; });
+    if (tail_block) insert_block_if(*tail_block, result, [&] (const auto& read) { return !overlaps(read, head); });
+    if (!head_block) fetch_edge_cache_->put(head, std::make_shared<const ReadMap>(copy_overlapped(result, head)));
+    if (!tail_block) fetch_edge_cache_->put(tail, std::make_shared<const ReadMap>(copy_overlapped(result, tail)));
+    if (downsampler_) {
+        profiling::StageTimer timer {profiling::Stage::read_transform};
+        if (report) report->downsample_report.clear();
+        for (auto& p : result) {
+            auto sample_report = downsampler_->downsample(p.second);
+            if (report) report->downsample_report.emplace(p.first, std::move(sample_report));
+        }
+    }
+    shrink_to_fit(result);
+    return result;
+}
+
 ReadMap ReadPipe::fetch_reads(const std::vector<GenomicRegion>& regions, boost::optional<Report&> report) const
 {
     assert(std::is_sorted(std::cbegin(regions), std::cend(regions)));
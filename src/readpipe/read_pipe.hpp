@@ -8,6 +8,7 @@
 #include <unordered_map>
 #include <cstddef>
 #include <functional>
+#include <memory>
 
 #include <boost/optional.hpp>
 
@@ -15,9 +16,11 @@
 #include "basics/genomic_region.hpp"
 #include "io/read/read_manager.hpp"
 #include "logging/logging.hpp"
+#include "utils/thread_pool.hpp"
 #include "filtering/read_filterer.hpp"
 #include "transformers/read_transformer.hpp"
 #include "downsampling/downsampler.hpp"
+#include "read_block_cache.hpp"
 
 namespace octopus {
 /*
@@ -69,6 +72,16 @@ public:
     unsigned num_samples() const noexcept;
     const std::vector<SampleName>& samples() const noexcept;
     
+    // Process each sample's reads on a separate thread. Each sample's reads are transformed, filtered,
+    // and downsampled independently, so samples do not wait on each other between stages.
+    // Zero or one threads processes in the calling thread.
+    void set_num_transform_threads(unsigned num_threads);
+    
+    // Share the processed reads overlapping the first and last edge_size bases of each fetched region
+    // with later fetches whose regions start or end on the same edge, as those of adjacent calling
+    // tasks do. Only the reads' downsampling is then repeated. Zero disables.
+    void share_fetch_edges(GenomicRegion::Size edge_size, std::size_t max_blocks = 1024);
+    
     ReadMap fetch_reads(const GenomicRegion& region, boost::optional<Report&> report = boost::none) const;
     ReadMap fetch_reads(const std::vector<GenomicRegion>& regions, boost::optional<Report&> report = boost::none) const;
     
@@ -81,7 +94,18 @@ private:
     boost::optional<ReadTransformer> postfilter_transformer_;
     boost::optional<Downsampler> downsampler_;
     std::vector<SampleName> samples_;
+    std::shared_ptr<ThreadPool> transform_workers_;
+    GenomicRegion::Size fetch_edge_size_;
+    std::shared_ptr<ReadBlockCache> fetch_edge_cache_;
     mutable boost::optional<logging::DebugLogger> debug_log_;
+    
+    void transform(ReadManager::SampleReadMap& reads, const ReadTransformer& transformer) const;
+    void process(ReadManager::ReadContainer& reads, ReadMap::mapped_type& result,
+                 boost::optional<Downsampler::Report>& report, bool downsample = true) const;
+    void process(ReadManager::SampleReadMap& reads, ReadMap& result, boost::optional<Report&> report,
+                 bool downsample = true) const;
+    bool can_share_fetch_edges(const GenomicRegion& region) const noexcept;
+    ReadMap fetch_reads_sharing_edges(const GenomicRegion& region, boost::optional<Report&> report) const;
 };
 
 } // namespace octopus
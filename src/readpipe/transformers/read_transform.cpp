@@ -10,6 +10,8 @@
 
 #include "utils/maths.hpp"
 #include "utils/sequence_utils.hpp"
+#include "utils/quality_kernels.hpp"
+#include "utils/read_mismatches.hpp"
 
 namespace octopus { namespace readpipe {
 
@@ -70,14 +72,11 @@ MaskLowQualityTails::MaskLowQualityTails(BaseQuality threshold) : threshold_ {th
 
 void MaskLowQualityTails::operator()(AlignedRead& read) const noexcept
 {
-    auto& qualities = read.base_qualities();
-    const auto is_low_quality = [this] (BaseQuality q) noexcept { return q < threshold_; };
+    const auto& qualities = read.base_qualities();
     if (is_forward_strand(read)) {
-        const auto first_high_quality = std::find_if_not(std::rbegin(qualities), std::rend(qualities), is_low_quality);
-        std::fill(std::rbegin(qualities), first_high_quality, 0);
+        zero_back_qualities(read, utils::count_trailing_less_than(qualities.data(), qualities.size(), threshold_));
     } else {
-        const auto first_high_quality = std::find_if_not(std::begin(qualities), std::end(qualities), is_low_quality);
-        std::fill(std::begin(qualities), first_high_quality, 0);
+        zero_front_qualities(read, utils::count_leading_less_than(qualities.data(), qualities.size(), threshold_));
     }
 }
 
@@ -108,22 +107,17 @@ void MaskSoftClippedBoundraryBases::operator()(AlignedRead& read) const noexcept
 
 namespace {
 
-template<typename InputIterator>
-void zero_if_less_than(InputIterator first, InputIterator last,
-                       typename std::iterator_traits<InputIterator>::value_type value) noexcept {
-    std::transform(first, last, first, [value] (auto v) noexcept { return v < value ? 0 : v; });
-}
-
 void mask_low_quality_front_bases(AlignedRead& read, std::size_t num_bases, AlignedRead::BaseQuality min_quality) noexcept
 {
     auto& qualities = read.base_qualities();
-    zero_if_less_than(std::begin(qualities), std::next(std::begin(qualities), std::min(num_bases, sequence_size(read))), min_quality);
+    utils::zero_bytes_less_than(qualities.data(), std::min(num_bases, qualities.size()), min_quality);
 }
 
 void mask_low_quality_back_bases(AlignedRead& read, std::size_t num_bases, AlignedRead::BaseQuality min_quality) noexcept
 {
     auto& qualities = read.base_qualities();
-    zero_if_less_than(std::rbegin(qualities), std::next(std::rbegin(qualities), std::min(num_bases, sequence_size(read))), min_quality);
+    num_bases = std::min(num_bases, qualities.size());
+    utils::zero_bytes_less_than(qualities.data() + (qualities.size() - num_bases), num_bases, min_quality);
 }
 
 } // namespace
@@ -390,6 +384,13 @@ void Mask3PrimeShiftedSoftClippedHeads::operator()(AlignedRead& read) const
     }
 }
 
+AnnotateReferenceMismatches::AnnotateReferenceMismatches(const ReferenceGenome& reference) : reference_ {reference} {}
+
+void AnnotateReferenceMismatches::operator()(AlignedRead& read) const
+{
+    read.set_reference_mismatches(find_reference_mismatches(read, reference_));
+}
+
 // template transforms
 
 void mask_adapter_contamination(AlignedRead& forward, AlignedRead& reverse) noexcept
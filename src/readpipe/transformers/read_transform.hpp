@@ -162,6 +162,18 @@ private:
     GenomicRegion::Size max_flank_search_;
 };
 
+// Not a transform as such, caches the read's reference mismatches so later stages do not need to
+// compare the read to the reference. Must come after any transform that changes read sequences.
+struct AnnotateReferenceMismatches
+{
+    AnnotateReferenceMismatches(const ReferenceGenome& reference);
+    
+    void operator()(AlignedRead& read) const;
+    
+private:
+    std::reference_wrapper<const ReferenceGenome> reference_;
+};
+
 using ReadReferenceVector = std::vector<std::reference_wrapper<AlignedRead>>;
 
 struct MaskTemplateAdapters
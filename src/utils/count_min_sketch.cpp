@@ -0,0 +1,73 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "count_min_sketch.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace octopus {
+
+namespace {
+
+std::size_t next_power_of_two(const std::size_t n) noexcept
+{
+    std::size_t result {1};
+    while (result < n) result <<= 1;
+    return result;
+}
+
+// Second hash for double hashing; odd so every row visits a different slot
+std::size_t step_of(std::uint64_t x) noexcept
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    return static_cast<std::size_t>(x) | 1u;
+}
+
+} // namespace
+
+CountMinSketch::CountMinSketch(const std::size_t width, const unsigned depth)
+: width_ {next_power_of_two(std::max(width, std::size_t {1}))}
+, depth_ {std::max(depth, 1u)}
+, counts_(width_ * depth_, 0)
+{}
+
+void CountMinSketch::add(const std::size_t hash) noexcept
+{
+    const auto step = step_of(hash);
+    for (unsigned row {0}; row < depth_; ++row) {
+        auto& count = counts_[index(hash, step, row)];
+        if (count < std::numeric_limits<CountType>::max()) ++count;
+    }
+}
+
+unsigned CountMinSketch::count(const std::size_t hash) const noexcept
+{
+    const auto step = step_of(hash);
+    unsigned result {std::numeric_limits<CountType>::max()};
+    for (unsigned row {0}; row < depth_; ++row) {
+        result = std::min(result, static_cast<unsigned>(counts_[index(hash, step, row)]));
+    }
+    return result;
+}
+
+std::size_t CountMinSketch::bytes() const noexcept
+{
+    return sizeof(CountMinSketch) + counts_.capacity() * sizeof(CountType);
+}
+
+void CountMinSketch::clear() noexcept
+{
+    std::fill(std::begin(counts_), std::end(counts_), 0);
+}
+
+// private methods
+
+std::size_t CountMinSketch::index(const std::size_t hash, const std::size_t step, const unsigned row) const noexcept
+{
+    return row * width_ + ((hash + row * step) & (width_ - 1));
+}
+
+} // namespace octopus
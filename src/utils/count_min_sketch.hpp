@@ -0,0 +1,49 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef count_min_sketch_hpp
+#define count_min_sketch_hpp
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace octopus {
+
+// Approximate counts of hashed items in fixed memory. Counts are never under estimated, and saturate
+// at the maximum of CountType.
+class CountMinSketch
+{
+public:
+    using CountType = std::uint16_t;
+    
+    CountMinSketch() = delete;
+    
+    // width is rounded up to a power of two
+    CountMinSketch(std::size_t width, unsigned depth = 4);
+    
+    CountMinSketch(const CountMinSketch&)            = default;
+    CountMinSketch& operator=(const CountMinSketch&) = default;
+    CountMinSketch(CountMinSketch&&)                 = default;
+    CountMinSketch& operator=(CountMinSketch&&)      = default;
+    
+    ~CountMinSketch() = default;
+    
+    void add(std::size_t hash) noexcept;
+    unsigned count(std::size_t hash) const noexcept;
+    
+    std::size_t bytes() const noexcept;
+    
+    void clear() noexcept;
+    
+private:
+    std::size_t width_;
+    unsigned depth_;
+    std::vector<CountType> counts_;
+    
+    std::size_t index(std::size_t hash, std::size_t step, unsigned row) const noexcept;
+};
+
+} // namespace octopus
+
+#endif
@@ -12,6 +12,9 @@
 #include <algorithm>
 #include <numeric>
 #include <stdexcept>
+#include <type_traits>
+#include <cstdint>
+#include <cmath>
 #include <cassert>
 
 #include <boost/optional.hpp>
@@ -24,6 +27,11 @@ namespace octopus {
 /**
  CoverageTracker provides an efficient method for tracking coverage statistics over a range
  of Mappable objects without having to store the entire collection.
+ 
+ Depths are stored as a difference array, so adding a region is amortised O(1) regardless of its
+ size. Depths and their prefix sums are rebuilt on the first query after a change, after which sum,
+ mean and stdev are O(1) for any region and median is found with a depth histogram. Queries may
+ therefore modify internal state, so a tracker must not be queried from several threads at once.
  */
 template <typename Region, typename T = unsigned>
 class CoverageTracker
@@ -32,6 +40,8 @@ public:
     using RegionType = Region;
     using DepthType  = T;
     
+    static_assert(std::is_integral<T>::value, "DepthType must be integral");
+    
     CoverageTracker() = default;
     
     CoverageTracker(const CoverageTracker&)            = default;
@@ -44,23 +54,23 @@ public:
     template <typename MappableType>
     void add(const MappableType& mappable);
     
-    bool any() const noexcept;
-    bool any(const Region& region) const noexcept;
+    bool any() const;
+    bool any(const Region& region) const;
     
-    std::size_t sum() const noexcept;
-    std::size_t sum(const Region& region) const noexcept;
+    std::size_t sum() const;
+    std::size_t sum(const Region& region) const;
     
-    DepthType max() const noexcept;
-    DepthType max(const Region& region) const noexcept;
+    DepthType max() const;
+    DepthType max(const Region& region) const;
     
-    DepthType min() const noexcept;
-    DepthType min(const Region& region) const noexcept;
+    DepthType min() const;
+    DepthType min(const Region& region) const;
     
-    double mean() const noexcept;
-    double mean(const Region& region) const noexcept;
+    double mean() const;
+    double mean(const Region& region) const;
     
-    double stdev() const noexcept;
-    double stdev(const Region& region) const noexcept;
+    double stdev() const;
+    double stdev(const Region& region) const;
     
     double median() const;
     double median(const Region& region) const;
@@ -73,17 +83,29 @@ public:
     bool is_empty() const noexcept;
     std::size_t num_tracked() const noexcept;
     void clear() noexcept;
+    // Discards the depths of all positions before region, so a tracker can follow a sliding window
+    void clear_before(const Region& region);
     
 private:
-    std::deque<DepthType> coverage_ = {};
+    using DifferenceType = std::make_signed_t<T>;
+    using IndexPair      = std::pair<std::size_t, std::size_t>;
+    
+    // Change in depth at each position of the encompassing region, plus one past its end
+    std::deque<DifferenceType> differences_ = {};
     Region encompassing_region_;
     std::size_t num_tracked_ = 0;
     
-    using Iterator     = typename decltype(coverage_)::const_iterator;
-    using IteratorPair = std::pair<Iterator, Iterator>;
+    mutable std::vector<DepthType> depths_ = {};
+    mutable std::vector<std::size_t> depth_sums_ = {}; // prefix sums of depths_
+    mutable std::vector<std::uint64_t> square_depth_sums_ = {};
+    mutable bool is_stale_ = false;
     
     void do_add(const Region& region);
-    IteratorPair range(const Region& region) const;
+    void update_depths() const;
+    IndexPair range(const Region& region) const;
+    double mean(IndexPair range) const;
+    double stdev(IndexPair range) const;
+    double median(IndexPair range, std::size_t num_zeros) const;
 };
 
 // non-member methods
@@ -122,6 +144,20 @@ std::vector<Region> get_covered_regions(const CoverageTracker<Region>& tracker)
     }
 }
 
+namespace detail {
+
+inline bool is_same_contig_helper(const ContigRegion& lhs, const ContigRegion& rhs) noexcept
+{
+    return true;
+}
+
+inline bool is_same_contig_helper(const GenomicRegion& lhs, const GenomicRegion& rhs) noexcept
+{
+    return is_same_contig(lhs, rhs);
+}
+
+} // namespace detail
+
 // public methods
 
 template <typename Region, typename T>
@@ -133,126 +169,127 @@ void CoverageTracker<Region, T>::add(const MappableType& mappable)
 }
 
 template <typename Region, typename T>
-bool CoverageTracker<Region, T>::any() const noexcept
+bool CoverageTracker<Region, T>::any() const
 {
-    return std::find_if(std::cbegin(coverage_), std::cend(coverage_),
-                        [] (auto depth) noexcept { return depth > 0; }) != std::cend(coverage_);
+    return sum() > 0;
 }
 
 template <typename Region, typename T>
-bool CoverageTracker<Region, T>::any(const Region& region) const noexcept
+bool CoverageTracker<Region, T>::any(const Region& region) const
 {
-    if (octopus::is_empty(region)) return false;
-    const auto p = range(region);
-    return std::find_if(p.first, p.second, [] (auto depth) noexcept { return depth > 0; }) != p.second;
+    return sum(region) > 0;
 }
 
 template <typename Region, typename T>
-std::size_t CoverageTracker<Region, T>::sum() const noexcept
+std::size_t CoverageTracker<Region, T>::sum() const
 {
-    return std::accumulate(std::cbegin(coverage_), std::cend(coverage_), std::size_t {0});
+    update_depths();
+    return depth_sums_.empty() ? 0 : depth_sums_.back();
 }
 
 template <typename Region, typename T>
-std::size_t CoverageTracker<Region, T>::sum(const Region& region) const noexcept
+std::size_t CoverageTracker<Region, T>::sum(const Region& region) const
 {
     if (octopus::is_empty(region)) return 0;
     const auto p = range(region);
-    return std::accumulate(p.first, p.second, std::size_t {0});
+    return depth_sums_[p.second] - depth_sums_[p.first];
 }
 
 template <typename Region, typename T>
-T CoverageTracker<Region, T>::max() const noexcept
+T CoverageTracker<Region, T>::max() const
 {
-    if (coverage_.empty()) return 0;
-    return *std::max_element(std::cbegin(coverage_), std::cend(coverage_));
+    update_depths();
+    if (depths_.empty()) return 0;
+    return *std::max_element(std::cbegin(depths_), std::cend(depths_));
 }
 
 template <typename Region, typename T>
-T CoverageTracker<Region, T>::max(const Region& region) const noexcept
+T CoverageTracker<Region, T>::max(const Region& region) const
 {
     if (octopus::is_empty(region)) return 0;
     const auto p = range(region);
     if (p.first == p.second) return 0;
-    return *std::max_element(p.first, p.second);
+    return *std::max_element(std::next(std::cbegin(depths_), p.first), std::next(std::cbegin(depths_), p.second));
 }
 
 template <typename Region, typename T>
-T CoverageTracker<Region, T>::min() const noexcept
+T CoverageTracker<Region, T>::min() const
 {
-    if (coverage_.empty()) return 0;
-    return *std::min_element(std::cbegin(coverage_), std::cend(coverage_));
+    update_depths();
+    if (depths_.empty()) return 0;
+    return *std::min_element(std::cbegin(depths_), std::cend(depths_));
 }
 
 template <typename Region, typename T>
-T CoverageTracker<Region, T>::min(const Region& region) const noexcept
+T CoverageTracker<Region, T>::min(const Region& region) const
 {
     if (octopus::is_empty(region)) return 0;
     const auto p = range(region);
     if (p.first == p.second) return 0;
-    return *std::min_element(p.first, p.second);
+    return *std::min_element(std::next(std::cbegin(depths_), p.first), std::next(std::cbegin(depths_), p.second));
 }
 
 template <typename Region, typename T>
-double CoverageTracker<Region, T>::mean() const noexcept
+double CoverageTracker<Region, T>::mean() const
 {
-    if (coverage_.empty()) return 0;
-    return maths::mean(coverage_);
+    update_depths();
+    return mean(IndexPair {0, depths_.size()});
 }
 
 template <typename Region, typename T>
-double CoverageTracker<Region, T>::mean(const Region& region) const noexcept
+double CoverageTracker<Region, T>::mean(const Region& region) const
 {
     if (octopus::is_empty(region)) return 0;
-    const auto p = range(region);
-    return maths::mean(p.first, p.second);
+    return mean(range(region));
 }
 
 template <typename Region, typename T>
-double CoverageTracker<Region, T>::stdev() const noexcept
+double CoverageTracker<Region, T>::stdev() const
 {
-    if (coverage_.empty()) return 0;
-    return maths::stdev(coverage_);
+    update_depths();
+    return stdev(IndexPair {0, depths_.size()});
 }
 
 template <typename Region, typename T>
-double CoverageTracker<Region, T>::stdev(const Region& region) const noexcept
+double CoverageTracker<Region, T>::stdev(const Region& region) const
 {
     if (octopus::is_empty(region)) return 0;
-    const auto p = range(region);
-    return maths::stdev(p.first, p.second);
+    return stdev(range(region));
 }
 
 template <typename Region, typename T>
 double CoverageTracker<Region, T>::median() const
 {
-    if (coverage_.empty()) return 0;
-    return maths::median(coverage_);
+    update_depths();
+    return median(IndexPair {0, depths_.size()}, 0);
 }
 
 template <typename Region, typename T>
 double CoverageTracker<Region, T>::median(const Region& region) const
 {
-    auto range_coverage = this->get(region);
-    if (range_coverage.empty()) return 0;
-    return maths::median(range_coverage);
+    if (octopus::is_empty(region)) return 0;
+    const auto p = range(region);
+    // Positions outside the encompassing region have zero depth
+    return median(p, size(region) - (p.second - p.first));
 }
 
 template <typename Region, typename T>
 template <typename OutputIt>
 OutputIt CoverageTracker<Region, T>::get(const Region& region, OutputIt result) const
 {
-    if (coverage_.empty()) {
+    update_depths();
+    if (depths_.empty()) {
         return std::fill_n(result, size(region), 0);
     }
     const auto p = range(region);
+    const auto first = std::next(std::cbegin(depths_), p.first), last = std::next(std::cbegin(depths_), p.second);
     if (contains(encompassing_region_, region)) {
-        return std::copy(p.first, p.second, result);
+        return std::copy(first, last, result);
     } else {
         using D = typename Region::Distance;
         const auto lhs_pad = std::max(begin_distance(region, encompassing_region_), D {0});
         result = std::fill_n(result, lhs_pad, 0);
-        result = std::copy(p.first, p.second, result);
+        result = std::copy(first, last, result);
         const auto rhs_pad = std::max(end_distance(encompassing_region_, region), D {0});
         return std::fill_n(result, rhs_pad, 0);
     }
@@ -291,33 +328,39 @@ std::size_t CoverageTracker<Region, T>::num_tracked() const noexcept
 template <typename Region, typename T>
 void CoverageTracker<Region, T>::clear() noexcept
 {
-    coverage_.clear();
-    coverage_.shrink_to_fit();
+    differences_.clear();
+    differences_.shrink_to_fit();
+    depths_.clear();
+    depth_sums_.clear();
+    square_depth_sums_.clear();
+    is_stale_ = false;
     num_tracked_ = 0;
 }
 
-// private methods
-
-namespace detail {
-
-inline bool is_same_contig_helper(const ContigRegion& lhs, const ContigRegion& rhs) noexcept
-{
-    return true;
-}
-
-inline bool is_same_contig_helper(const GenomicRegion& lhs, const GenomicRegion& rhs) noexcept
+template <typename Region, typename T>
+void CoverageTracker<Region, T>::clear_before(const Region& region)
 {
-    return is_same_contig(lhs, rhs);
+    if (differences_.empty() || !detail::is_same_contig_helper(region, encompassing_region_)
+        || is_before(encompassing_region_, region)) {
+        clear();
+    } else if (begins_before(encompassing_region_, region)) {
+        const auto first_kept = std::next(std::begin(differences_), begin_distance(encompassing_region_, region));
+        // The depth at the new first position is the sum of all the preceding differences
+        *first_kept = std::accumulate(std::begin(differences_), std::next(first_kept), DifferenceType {0});
+        differences_.erase(std::begin(differences_), first_kept);
+        encompassing_region_ = closed_region(region, encompassing_region_);
+        is_stale_ = true;
+    }
 }
 
-} // namespace detail
+// private methods
 
 template <typename Region, typename T>
 void CoverageTracker<Region, T>::do_add(const Region& region)
 {
     if (octopus::is_empty(region)) return;
     if (num_tracked_ == 0) {
-        coverage_.assign(size(region), 1);
+        differences_.assign(size(region) + 1, 0);
         encompassing_region_ = region;
     } else {
         if (!detail::is_same_contig_helper(region, encompassing_region_)) {
@@ -325,35 +368,97 @@ void CoverageTracker<Region, T>::do_add(const Region& region)
         }
         bool region_change {false};
         if (begins_before(region, encompassing_region_)) {
-            coverage_.insert(std::cbegin(coverage_), left_overhang_size(region, encompassing_region_), 0);
+            differences_.insert(std::cbegin(differences_), left_overhang_size(region, encompassing_region_), 0);
             region_change = true;
         }
         if (ends_before(encompassing_region_, region)) {
-            coverage_.insert(std::cend(coverage_), right_overhang_size(region, encompassing_region_), 0);
+            differences_.insert(std::cend(differences_), right_overhang_size(region, encompassing_region_), 0);
             region_change = true;
         }
         if (region_change) {
             encompassing_region_ = octopus::encompassing_region(encompassing_region_, region);
         }
-        const auto first = std::next(std::begin(coverage_), begin_distance(encompassing_region_, region));
-        assert(first < std::end(coverage_));
-        assert(std::next(first, size(region)) <= std::end(coverage_));
-        std::transform(first, std::next(first, size(region)), first, [] (auto count) noexcept { return count + 1; });
     }
+    const auto offset = static_cast<std::size_t>(begin_distance(encompassing_region_, region));
+    assert(offset + size(region) < differences_.size());
+    ++differences_[offset];
+    --differences_[offset + size(region)];
+    is_stale_ = true;
     ++num_tracked_;
 }
 
 template <typename Region, typename T>
-typename CoverageTracker<Region, T>::IteratorPair CoverageTracker<Region, T>::range(const Region& region) const
+void CoverageTracker<Region, T>::update_depths() const
 {
-    if (coverage_.empty() || !overlaps(region, encompassing_region_)) {
-        return {std::end(coverage_), std::end(coverage_)};
+    if (!is_stale_) return;
+    const auto num_positions = differences_.size() - 1;
+    depths_.resize(num_positions);
+    depth_sums_.resize(num_positions + 1);
+    square_depth_sums_.resize(num_positions + 1);
+    depth_sums_[0] = 0;
+    square_depth_sums_[0] = 0;
+    DifferenceType depth {0};
+    for (std::size_t i {0}; i < num_positions; ++i) {
+        depth += differences_[i];
+        assert(depth >= 0);
+        depths_[i] = static_cast<T>(depth);
+        depth_sums_[i + 1] = depth_sums_[i] + depths_[i];
+        square_depth_sums_[i + 1] = square_depth_sums_[i] + static_cast<std::uint64_t>(depths_[i]) * depths_[i];
     }
-    auto range_start_itr = std::begin(coverage_);
+    is_stale_ = false;
+}
+
+template <typename Region, typename T>
+typename CoverageTracker<Region, T>::IndexPair CoverageTracker<Region, T>::range(const Region& region) const
+{
+    update_depths();
+    if (depths_.empty() || !overlaps(region, encompassing_region_)) {
+        return {depths_.size(), depths_.size()};
+    }
+    std::size_t first {0};
     if (begins_before(encompassing_region_, region)) {
-        std::advance(range_start_itr, begin_distance(encompassing_region_, region));
+        first = begin_distance(encompassing_region_, region);
+    }
+    return {first, first + overlap_size(region, encompassing_region_)};
+}
+
+template <typename Region, typename T>
+double CoverageTracker<Region, T>::mean(const IndexPair range) const
+{
+    if (range.first == range.second) return 0;
+    return static_cast<double>(depth_sums_[range.second] - depth_sums_[range.first]) / (range.second - range.first);
+}
+
+template <typename Region, typename T>
+double CoverageTracker<Region, T>::stdev(const IndexPair range) const
+{
+    if (range.first == range.second) return 0;
+    const auto n = static_cast<double>(range.second - range.first);
+    const auto m = mean(range);
+    const auto square_mean = (square_depth_sums_[range.second] - square_depth_sums_[range.first]) / n;
+    return std::sqrt(std::max(square_mean - m * m, 0.0));
+}
+
+template <typename Region, typename T>
+double CoverageTracker<Region, T>::median(const IndexPair range, const std::size_t num_zeros) const
+{
+    const auto n = (range.second - range.first) + num_zeros;
+    if (n == 0) return 0;
+    const auto first = std::next(std::cbegin(depths_), range.first), last = std::next(std::cbegin(depths_), range.second);
+    const auto max_depth = first != last ? *std::max_element(first, last) : T {0};
+    std::vector<std::size_t> histogram(static_cast<std::size_t>(max_depth) + 1, 0);
+    histogram[0] = num_zeros;
+    std::for_each(first, last, [&] (const auto depth) { ++histogram[depth]; });
+    const auto nth_depth = [&] (const std::size_t n) {
+        std::size_t depth {0};
+        for (std::size_t num_seen {histogram[0]}; num_seen <= n; num_seen += histogram[++depth]);
+        return static_cast<double>(depth);
+    };
+    if (n % 2 == 1) {
+        return nth_depth(n / 2);
+    } else {
+        return (nth_depth(n / 2 - 1) + nth_depth(n / 2)) / 2;
     }
-    return {range_start_itr, std::next(range_start_itr, overlap_size(region, encompassing_region_))};
 }
 
 } // namespace octopus
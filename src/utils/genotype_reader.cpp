@@ -4,6 +4,8 @@
 #include "genotype_reader.hpp"
 
 #include <utility>
+#include <map>
+#include <memory>
 #include <functional>
 #include <iterator>
 #include <algorithm>
@@ -135,9 +137,8 @@ make_allele(const VcfRecord& call, VcfRecord::NucleotideSequence allele_sequence
     return ContigAllele {region, std::move(allele_sequence)};
 }
 
-auto extract_genotype(const VcfRecord& call, const SampleName& sample)
+auto extract_genotype(const VcfRecord& call, std::vector<VcfRecord::NucleotideSequence> genotype)
 {
-    auto genotype = get_genotype(call, sample);
     const auto ploidy = genotype.size();
     std::vector<boost::optional<ContigAllele>> result(ploidy, boost::none);
     if (ploidy == 0) return result;
@@ -279,15 +280,29 @@ auto wrap_calls(const std::vector<VcfRecord>& calls, const SampleName& sample)
     return result;
 }
 
-auto get_max_ploidy(const std::vector<CallWrapper>& calls, const SampleName& sample)
+// Samples with the same genotypes for the same calls and region share haplotypes
+using CallGenotypes = std::vector<std::pair<const VcfRecord*, std::vector<VcfRecord::NucleotideSequence>>>;
+using GenotypeCache = std::map<std::pair<GenomicRegion, CallGenotypes>, Genotype<Haplotype>>;
+
+auto get_genotypes(const std::vector<CallWrapper>& calls, const SampleName& sample)
 {
-    unsigned result {0};
+    CallGenotypes result {};
+    result.reserve(calls.size());
     for (const auto& call : calls) {
-        result = std::max(result, call.get().ploidy(sample));
+        result.emplace_back(std::addressof(call.get()), get_genotype(call.get(), sample));
     }
     return result;
 }
 
+auto get_max_ploidy(const CallGenotypes& genotypes)
+{
+    std::size_t result {0};
+    for (const auto& genotype : genotypes) {
+        result = std::max(result, genotype.second.size());
+    }
+    return static_cast<unsigned>(result);
+}
+
 auto make_genotype(std::vector<Haplotype::Builder>&& haplotypes)
 {
     Genotype<Haplotype> result {static_cast<unsigned>(haplotypes.size())};
@@ -300,14 +315,18 @@ auto make_genotype(std::vector<Haplotype::Builder>&& haplotypes)
 Genotype<Haplotype> extract_genotype(const std::vector<CallWrapper>& phased_calls,
                                      const GenomicRegion& region,
                                      const SampleName& sample,
-                                     const ReferenceGenome& reference)
+                                     const ReferenceGenome& reference,
+                                     GenotypeCache& cache)
 {
     assert(!phased_calls.empty());
     assert(contains(region, encompassing_region(phased_calls)));
-    const auto max_ploidy = get_max_ploidy(phased_calls, sample);
+    auto key = std::make_pair(region, get_genotypes(phased_calls, sample));
+    const auto cache_itr = cache.find(key);
+    if (cache_itr != std::cend(cache)) return cache_itr->second;
+    const auto max_ploidy = get_max_ploidy(key.second);
     std::vector<Haplotype::Builder> haplotypes(max_ploidy, Haplotype::Builder {region, reference});
-    for (const auto& call : phased_calls) {
-        auto genotype = extract_genotype(call.call, sample);
+    for (const auto& call_genotype : key.second) {
+        auto genotype = extract_genotype(*call_genotype.first, call_genotype.second);
         assert(genotype.size() <= max_ploidy);
         for (unsigned i {0}; i < genotype.size(); ++i) {
             if (genotype[i] && haplotypes[i].can_push_back(*genotype[i])) {
@@ -315,7 +334,9 @@ Genotype<Haplotype> extract_genotype(const std::vector<CallWrapper>& phased_call
             }
         }
     }
-    return make_genotype(std::move(haplotypes));
+    auto result = make_genotype(std::move(haplotypes));
+    cache.emplace(std::move(key), result);
+    return result;
 }
 
 } // namespace
@@ -327,13 +348,19 @@ GenotypeMap extract_genotypes(const std::vector<VcfRecord>& calls,
 {
     if (calls.empty()) return {};
     GenotypeMap result {samples.size()};
+    GenotypeCache cache {};
+    if (samples.size() > 1) {
+        // Haplotypes only fetch their reference flanks, so one fetch of the block lets the
+        // reference cache serve the rest
+        reference.fetch_sequence_view(call_region ? *call_region : encompassing_region(calls));
+    }
     for (const auto& sample : samples) {
         const auto wrapped_calls = segment_overlapped_copy(wrap_calls(calls, sample));
         if (wrapped_calls.size() == 1) {
             if (!call_region) {
                 call_region = encompassing_region(wrapped_calls.front());
             }
-            auto genotype = extract_genotype(wrapped_calls.front(), *call_region, sample, reference);
+            auto genotype = extract_genotype(wrapped_calls.front(), *call_region, sample, reference, cache);
             if (genotype.ploidy() > 0) result[sample] = {std::move(genotype)};
         } else { // wrapped_calls.size() > 1
             auto call_itr = std::cbegin(wrapped_calls);
@@ -343,12 +370,12 @@ GenotypeMap extract_genotypes(const std::vector<VcfRecord>& calls,
             } else {
                 region = left_overhang_region(call_itr->front(), std::next(call_itr)->front());
             }
-            auto genotype = extract_genotype(*call_itr, region, sample, reference);
+            auto genotype = extract_genotype(*call_itr, region, sample, reference, cache);
             if (genotype.ploidy() > 0) result[sample] = {std::move(genotype)};
             ++call_itr;
             for (auto penultimate = std::prev(std::cend(wrapped_calls)); call_itr != penultimate; ++call_itr) {
                 region = *intervening_region(std::prev(call_itr)->back(), std::next(call_itr)->front());
-                genotype = extract_genotype(*call_itr, region, sample, reference);
+                genotype = extract_genotype(*call_itr, region, sample, reference, cache);
                 if (genotype.ploidy() > 0) result.at(sample).insert(std::move(genotype));
             }
             if (call_region) {
@@ -356,7 +383,7 @@ GenotypeMap extract_genotypes(const std::vector<VcfRecord>& calls,
             } else {
                 region = right_overhang_region(call_itr->back(), std::prev(call_itr)->back());
             }
-            genotype = extract_genotype(*call_itr, region, sample, reference);
+            genotype = extract_genotype(*call_itr, region, sample, reference, cache);
             if (genotype.ploidy() > 0) result.at(sample).insert(std::move(genotype));
         }
     }
@@ -7,15 +7,24 @@
 #include <deque>
 #include <iterator>
 #include <algorithm>
+#include <numeric>
 #include <utility>
+#include <memory>
+#include <cmath>
 #include <cassert>
 #include <iostream>
+#include <fstream>
+#include <string>
+
+#include <boost/functional/hash.hpp>
+#include <boost/filesystem/operations.hpp>
 
 #include "mappable_algorithms.hpp"
 #include "maths.hpp"
 #include "append.hpp"
 #include "random_select.hpp"
 #include "read_stats.hpp"
+#include "thread_pool.hpp"
 
 namespace octopus {
 
@@ -47,27 +56,18 @@ auto choose_sample_region(const GenomicRegion& from, GenomicRegion::Size max_siz
     return GenomicRegion {from.contig_name(), dist(generator), from.end()};
 }
 
-auto draw_sample(const SampleName& sample, const InputRegionMap& regions,
-                 const ReadManager& source, const ReadSetProfileConfig& config)
+auto choose_draw_region(const InputRegionMap& regions, const ReadSetProfileConfig& config, const bool from_begin = false)
 {
     const auto contig_itr = random_select(std::cbegin(regions), std::cend(regions));
     assert(!contig_itr->second.empty());
     const auto region_itr = random_select(std::cbegin(contig_itr->second), std::cend(contig_itr->second));
-    const auto sample_region = choose_sample_region(*region_itr, config.max_sample_size);
-    auto test_region = source.find_covered_subregion(sample, sample_region, config.max_sample_size);
-    if (is_empty(test_region)) {
-        test_region = expand_rhs(test_region, 1);
-    }
-    return source.fetch_reads(sample, test_region);
+    return from_begin ? *region_itr : choose_sample_region(*region_itr, config.max_sample_size);
 }
 
-auto draw_sample_from_begin(const SampleName& sample, const InputRegionMap& regions,
-                            const ReadManager& source, const ReadSetProfileConfig& config)
+auto fetch_draw(const SampleName& sample, const GenomicRegion& region,
+                const ReadManager& source, const ReadSetProfileConfig& config)
 {
-    const auto contig_itr = random_select(std::cbegin(regions), std::cend(regions));
-    assert(!contig_itr->second.empty());
-    const auto region_itr = random_select(std::cbegin(contig_itr->second), std::cend(contig_itr->second));
-    auto test_region = source.find_covered_subregion(sample, *region_itr, config.max_sample_size);
+    auto test_region = source.find_covered_subregion(sample, region, config.max_sample_size);
     if (is_empty(test_region)) {
         test_region = expand_rhs(test_region, 1);
     }
@@ -81,26 +81,101 @@ bool all_empty(const ReadSetSamples& samples)
     return std::all_of(std::cbegin(samples), std::cend(samples), [] (const auto& reads) { return reads.empty(); });
 }
 
-auto draw_samples(const SampleName& sample, const InputRegionMap& regions,
-                  const ReadManager& source, const ReadSetProfileConfig& config)
+struct DrawSummary
+{
+    double depth_sum = 0, read_bytes_sum = 0;
+    std::size_t num_positions = 0, num_reads = 0;
+    
+    DrawSummary& operator+=(const DrawSummary& other) noexcept
+    {
+        depth_sum += other.depth_sum;
+        read_bytes_sum += other.read_bytes_sum;
+        num_positions += other.num_positions;
+        num_reads += other.num_reads;
+        return *this;
+    }
+};
+
+auto summarise(const ReadManager::ReadContainer& reads)
+{
+    DrawSummary result {};
+    if (!reads.empty()) {
+        const auto depths = calculate_positional_coverage(reads);
+        result.depth_sum = std::accumulate(std::cbegin(depths), std::cend(depths), 0.0);
+        result.num_positions = depths.size();
+        for (const auto& read : reads) result.read_bytes_sum += footprint(read).bytes();
+        result.num_reads = reads.size();
+    }
+    return result;
+}
+
+// The mean depth of each sample followed by the mean read size
+auto make_estimates(const std::vector<DrawSummary>& sample_summaries)
 {
-    ReadSetSamples result {};
-    result.reserve(config.max_samples_per_sample);
-    std::generate_n(std::back_inserter(result), config.max_samples_per_sample,
-                    [&] () { return draw_sample(sample, regions, source, config); });
-    if (all_empty(result)) {
-        result.back() = draw_sample_from_begin(sample, regions, source, config);
+    std::vector<double> result {};
+    result.reserve(sample_summaries.size() + 1);
+    DrawSummary total {};
+    for (const auto& summary : sample_summaries) {
+        result.push_back(summary.num_positions > 0 ? summary.depth_sum / summary.num_positions : 0.0);
+        total += summary;
     }
+    result.push_back(total.num_reads > 0 ? total.read_bytes_sum / total.num_reads : 0.0);
     return result;
 }
 
+bool has_converged(const std::vector<double>& previous, const std::vector<double>& current, const double tolerance)
+{
+    return std::equal(std::cbegin(previous), std::cend(previous), std::cbegin(current), std::cend(current),
+                      [=] (double lhs, double rhs) { return std::abs(lhs - rhs) <= tolerance * std::max(lhs, 1.0); });
+}
+
+// Draws are made in rounds, with all the draws in a round fetched concurrently. Sampling stops
+// once a round leaves the estimates of every sample's depth, and of read size, nearly unchanged.
 auto draw_samples(const std::vector<SampleName>& samples, const InputRegionMap& regions,
                   const ReadManager& source, const ReadSetProfileConfig& config)
 {
-    std::vector<ReadSetSamples> result {};
-    result.reserve(samples.size());
-    for (const auto& sample : samples) {
-        result.push_back(draw_samples(sample, regions, source, config));
+    std::vector<ReadSetSamples> result(samples.size());
+    for (auto& sample_draws : result) sample_draws.reserve(config.max_samples_per_sample);
+    std::unique_ptr<ThreadPool> workers {};
+    if (config.max_threads > 1 && samples.size() * config.max_samples_per_sample > 1) {
+        workers = std::make_unique<ThreadPool>(std::min(config.max_threads - 1, static_cast<unsigned>(samples.size() * config.max_samples_per_sample - 1)));
+    }
+    const auto max_draws_per_round = std::max(config.max_threads / static_cast<unsigned>(samples.size()), 1u);
+    std::vector<DrawSummary> sample_summaries(samples.size());
+    std::vector<double> previous_estimates {};
+    for (unsigned num_draws {0}; num_draws < config.max_samples_per_sample;) {
+        const auto round_draws = std::min(max_draws_per_round, config.max_samples_per_sample - num_draws);
+        // Regions are chosen serially so the draws do not depend on the number of threads
+        std::vector<std::pair<std::size_t, GenomicRegion>> round {};
+        round.reserve(samples.size() * round_draws);
+        for (std::size_t s {0}; s < samples.size(); ++s) {
+            for (unsigned d {0}; d < round_draws; ++d) {
+                round.emplace_back(s, choose_draw_region(regions, config));
+            }
+        }
+        std::vector<ReadManager::ReadContainer> round_reads(round.size());
+        std::vector<DrawSummary> round_summaries(round.size());
+        parallel_for(workers.get(), round.size(), [&] (const std::size_t i) {
+            round_reads[i] = fetch_draw(samples[round[i].first], round[i].second, source, config);
+            round_summaries[i] = summarise(round_reads[i]);
+        });
+        for (std::size_t i {0}; i < round.size(); ++i) {
+            result[round[i].first].push_back(std::move(round_reads[i]));
+            sample_summaries[round[i].first] += round_summaries[i];
+        }
+        num_draws += round_draws;
+        if (num_draws >= config.min_samples_per_sample) {
+            auto estimates = make_estimates(sample_summaries);
+            if (!previous_estimates.empty() && has_converged(previous_estimates, estimates, config.convergence_tolerance)) {
+                break;
+            }
+            previous_estimates = std::move(estimates);
+        }
+    }
+    for (std::size_t s {0}; s < samples.size(); ++s) {
+        if (!result[s].empty() && all_empty(result[s])) {
+            result[s].back() = fetch_draw(samples[s], choose_draw_region(regions, config, true), source, config);
+        }
     }
     return result;
 }
@@ -210,6 +285,138 @@ profile_reads(const std::vector<SampleName>& samples,
     return result;
 }
 
+namespace {
+
+constexpr const char* read_profile_cache_magic {"octopus_read_profile_v1"};
+
+// Changes if any read file, the samples, the regions, or the sampling parameters change
+std::size_t make_cache_key(const std::vector<SampleName>& samples, const InputRegionMap& input_regions,
+                           const ReadManager& source, const ReadSetProfileConfig& config)
+{
+    using boost::hash_combine;
+    std::size_t result {0};
+    for (const auto& path : source.paths()) {
+        hash_combine(result, path.string());
+        boost::system::error_code ec {};
+        hash_combine(result, boost::filesystem::file_size(path, ec));
+        hash_combine(result, boost::filesystem::last_write_time(path, ec));
+    }
+    for (const auto& sample : samples) hash_combine(result, sample);
+    for (const auto& p : input_regions) {
+        for (const auto& region : p.second) hash_combine(result, std::hash<GenomicRegion> {}(region));
+    }
+    hash_combine(result, config.max_samples_per_sample);
+    hash_combine(result, config.min_samples_per_sample);
+    hash_combine(result, config.max_sample_size);
+    hash_combine(result, config.convergence_tolerance);
+    return result;
+}
+
+template <typename T>
+void write_values(std::ostream& os, const std::vector<T>& values)
+{
+    os << values.size();
+    for (const auto& value : values) os << ' ' << value;
+    os << '\n';
+}
+
+template <typename T>
+void read_values(std::istream& is, std::vector<T>& values)
+{
+    std::size_t n {};
+    is >> n;
+    values.resize(n);
+    for (auto& value : values) is >> value;
+}
+
+void write_cache(const ReadSetProfile& profile, const std::size_t key, std::ostream& os)
+{
+    os << read_profile_cache_magic << ' ' << key << '\n';
+    os << profile.mean_read_bytes << ' ' << profile.read_bytes_stdev << '\n';
+    os << profile.mean_depth << ' ' << profile.median_depth << ' ' << profile.depth_stdev << ' '
+       << profile.median_positive_depth << ' ' << profile.mean_positive_depth << '\n';
+    write_values(os, profile.sample_mean_depth);
+    write_values(os, profile.sample_median_depth);
+    write_values(os, profile.sample_median_positive_depth);
+    write_values(os, profile.sample_mean_positive_depth);
+    write_values(os, profile.sample_depth_stdev);
+    os << profile.max_read_length << ' ' << profile.median_read_length << '\n';
+    os << static_cast<unsigned>(profile.max_mapping_quality) << ' '
+       << static_cast<unsigned>(profile.median_mapping_quality) << ' '
+       << static_cast<unsigned>(profile.rmq_mapping_quality) << '\n';
+}
+
+boost::optional<ReadSetProfile> read_cache(const std::size_t key, std::istream& is)
+{
+    std::string magic {};
+    std::size_t cached_key {};
+    is >> magic >> cached_key;
+    if (!is || magic != read_profile_cache_magic || cached_key != key) return boost::none;
+    ReadSetProfile result {};
+    is >> result.mean_read_bytes >> result.read_bytes_stdev;
+    is >> result.mean_depth >> result.median_depth >> result.depth_stdev
+       >> result.median_positive_depth >> result.mean_positive_depth;
+    read_values(is, result.sample_mean_depth);
+    read_values(is, result.sample_median_depth);
+    read_values(is, result.sample_median_positive_depth);
+    read_values(is, result.sample_mean_positive_depth);
+    read_values(is, result.sample_depth_stdev);
+    is >> result.max_read_length >> result.median_read_length;
+    unsigned max_mapping_quality {}, median_mapping_quality {}, rmq_mapping_quality {};
+    is >> max_mapping_quality >> median_mapping_quality >> rmq_mapping_quality;
+    if (!is) return boost::none;
+    result.max_mapping_quality = max_mapping_quality;
+    result.median_mapping_quality = median_mapping_quality;
+    result.rmq_mapping_quality = rmq_mapping_quality;
+    return result;
+}
+
+} // namespace
+
+boost::optional<ReadSetProfile>
+profile_reads(const std::vector<SampleName>& samples,
+              const InputRegionMap& input_regions,
+              const ReadManager& source,
+              const boost::filesystem::path& cache_file,
+              ReadSetProfileConfig config)
+{
+    const auto key = make_cache_key(samples, input_regions, source, config);
+    {
+        std::ifstream cache {cache_file.string()};
+        if (cache) {
+            auto result = read_cache(key, cache);
+            if (result && result->sample_mean_depth.size() == samples.size()) return result;
+        }
+    }
+    auto result = profile_reads(samples, input_regions, source, config);
+    if (result) {
+        // The cache is only an optimisation, so failing to write it (e.g. read-only input directory) is fine
+        const auto temp_file = cache_file.string() + ".tmp";
+        std::ofstream cache {temp_file};
+        if (cache) {
+            write_cache(*result, key, cache);
+            cache.close();
+            boost::system::error_code ec {};
+            if (cache) {
+                boost::filesystem::rename(temp_file, cache_file, ec);
+            } else {
+                boost::filesystem::remove(temp_file, ec);
+            }
+        }
+    }
+    return result;
+}
+
+boost::filesystem::path get_default_read_profile_cache(const ReadManager& source)
+{
+    auto paths = source.paths();
+    assert(!paths.empty());
+    std::sort(std::begin(paths), std::end(paths));
+    auto result = paths.front();
+    result += ".read_profile";
+    return result;
+}
+
 boost::optional<std::size_t>
 estimate_mean_read_size(const std::vector<SampleName>& samples,
                         const InputRegionMap& input_regions,
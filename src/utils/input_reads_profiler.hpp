@@ -9,6 +9,7 @@
 #include <iosfwd>
 
 #include <boost/optional.hpp>
+#include <boost/filesystem/path.hpp>
 
 #include "config/common.hpp"
 #include "basics/aligned_read.hpp"
@@ -20,7 +21,12 @@ namespace octopus {
 struct ReadSetProfileConfig
 {
     unsigned max_samples_per_sample = 10;
+    unsigned min_samples_per_sample = 3;
     unsigned max_sample_size = 100'000;
+    // Sampling stops early once the depth and read size estimates change by less than this fraction
+    double convergence_tolerance = 0.05;
+    // Sample regions are fetched concurrently by up to this many threads
+    unsigned max_threads = 1;
 };
 
 struct ReadSetProfile
@@ -39,6 +45,18 @@ profile_reads(const std::vector<SampleName>& samples,
               const ReadManager& source,
               ReadSetProfileConfig config = ReadSetProfileConfig {});
 
+// As above, but reuses the profile stored in cache_file if it was made from the same inputs,
+// otherwise profiles the reads and tries to store the result in cache_file
+boost::optional<ReadSetProfile>
+profile_reads(const std::vector<SampleName>& samples,
+              const InputRegionMap& input_regions,
+              const ReadManager& source,
+              const boost::filesystem::path& cache_file,
+              ReadSetProfileConfig config = ReadSetProfileConfig {});
+
+// Next to the first input read file
+boost::filesystem::path get_default_read_profile_cache(const ReadManager& source);
+
 boost::optional<std::size_t>
 estimate_mean_read_size(const std::vector<SampleName>& samples,
                         const InputRegionMap& input_regions,
@@ -0,0 +1,79 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef interval_kernels_hpp
+#define interval_kernels_hpp
+
+#include <cstddef>
+#include <cstdint>
+
+#include "sse2_neon.hpp"
+
+namespace octopus { namespace utils {
+
+// Kernels over intervals stored as separate arrays of int32 begins and ends. Overlap follows
+// ContigRegion: intervals overlap if they share a position, or if they touch and either is empty.
+// Each processes 4 intervals per step when SSE2 or NEON is available, finishing with a scalar tail.
+
+inline bool overlaps_interval(const std::int32_t begin, const std::int32_t end,
+                              const std::int32_t query_begin, const std::int32_t query_end) noexcept
+{
+    if (begin < query_end && end > query_begin) return true;
+    return (begin == end || query_begin == query_end) && begin <= query_end && end >= query_begin;
+}
+
+#ifdef OCTOPUS_SSE2_INTRINSICS
+namespace detail {
+
+// One bit per byte of the overlapping lanes, so 4 bits per interval
+inline unsigned overlapping_mask(const std::int32_t* begins, const std::int32_t* ends,
+                                 const __m128i query_begin, const __m128i query_end, const bool empty_query) noexcept
+{
+    const auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begins));
+    const auto e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ends));
+    const auto strict = _mm_and_si128(_mm_cmpgt_epi32(query_end, b), _mm_cmpgt_epi32(e, query_begin));
+    const auto apart = _mm_or_si128(_mm_cmpgt_epi32(b, query_end), _mm_cmpgt_epi32(query_begin, e));
+    const auto touching = empty_query ? _mm_set1_epi32(-1) : _mm_cmpeq_epi32(b, e);
+    const auto overlapping = _mm_or_si128(strict, _mm_andnot_si128(apart, touching));
+    return static_cast<unsigned>(_mm_movemask_epi8(overlapping));
+}
+
+} // namespace detail
+#endif
+
+// Index of the first interval in [0, n) overlapping the query, or n
+inline std::size_t find_first_overlapping(const std::int32_t* begins, const std::int32_t* ends, const std::size_t n,
+                                          const std::int32_t query_begin, const std::int32_t query_end) noexcept
+{
+    std::size_t i {0};
+#ifdef OCTOPUS_SSE2_INTRINSICS
+    const auto qb = _mm_set1_epi32(query_begin), qe = _mm_set1_epi32(query_end);
+    const bool empty_query {query_begin == query_end};
+    for (; i + 4 <= n; i += 4) {
+        const auto mask = detail::overlapping_mask(begins + i, ends + i, qb, qe, empty_query);
+        if (mask != 0) return i + __builtin_ctz(mask) / 4;
+    }
+#endif
+    for (; i < n; ++i) if (overlaps_interval(begins[i], ends[i], query_begin, query_end)) return i;
+    return n;
+}
+
+inline std::size_t count_overlapping(const std::int32_t* begins, const std::int32_t* ends, const std::size_t n,
+                                     const std::int32_t query_begin, const std::int32_t query_end) noexcept
+{
+    std::size_t i {0}, result {0};
+#ifdef OCTOPUS_SSE2_INTRINSICS
+    const auto qb = _mm_set1_epi32(query_begin), qe = _mm_set1_epi32(query_end);
+    const bool empty_query {query_begin == query_end};
+    for (; i + 4 <= n; i += 4) {
+        result += __builtin_popcount(detail::overlapping_mask(begins + i, ends + i, qb, qe, empty_query)) / 4;
+    }
+#endif
+    for (; i < n; ++i) result += overlaps_interval(begins[i], ends[i], query_begin, query_end);
+    return result;
+}
+
+} // namespace utils
+} // namespace octopus
+
+#endif
@@ -129,11 +129,12 @@ template <typename D>
 auto choose_medoid(const std::vector<std::size_t>& cluster,
                    const DistanceMatrix<D>& distances)
 {
-    std::size_t result {0};
+    assert(!cluster.empty());
+    std::size_t result {cluster.front()};
     D min_distance_sum {};
     for (auto idx : cluster) {
         auto distance_sum = sum(distances, cluster, idx);
-        if (idx == 0 || distance_sum < min_distance_sum) {
+        if (idx == cluster.front() || distance_sum < min_distance_sum) {
             result = idx;
             min_distance_sum = std::move(distance_sum);
         }
@@ -178,6 +179,89 @@ k_medoids(const ForwardIterator first_data_itr, const ForwardIterator last_data_
     return medoids;
 }
 
+namespace detail {
+
+template <typename RandomIt, typename BinaryFunction>
+auto assign_to_medoids(const RandomIt first_data_itr, const RandomIt last_data_itr,
+                       const MediodVector& medoids, std::vector<std::size_t>& assignments,
+                       const BinaryFunction& distance)
+{
+    using DistanceResultType = decltype(distance(*first_data_itr, *first_data_itr));
+    const auto N = static_cast<std::size_t>(std::distance(first_data_itr, last_data_itr));
+    assignments.resize(N);
+    DistanceResultType result {};
+    for (std::size_t point_idx {0}; point_idx < N; ++point_idx) {
+        std::size_t best_medoid {0};
+        auto min_distance = distance(first_data_itr[point_idx], first_data_itr[medoids[0]]);
+        for (std::size_t medoid_idx {1}; medoid_idx < medoids.size(); ++medoid_idx) {
+            auto medoid_distance = distance(first_data_itr[point_idx], first_data_itr[medoids[medoid_idx]]);
+            if (medoid_distance < min_distance) {
+                best_medoid = medoid_idx;
+                min_distance = std::move(medoid_distance);
+            }
+        }
+        assignments[point_idx] = best_medoid;
+        result += min_distance;
+    }
+    return result;
+}
+
+} // namespace detail
+
+// CLARA: k-medoids is run on random subsamples of the data and the medoids that best fit all of the data
+// are kept. Only subsample distance matrices are stored, so memory is linear rather than quadratic in the
+// data size. assignments gives the index of the medoid each point is closest to.
+template <typename RandomIt, typename BinaryFunction>
+auto
+clara(const RandomIt first_data_itr, const RandomIt last_data_itr,
+      const std::size_t k,
+      std::vector<std::size_t>& assignments,
+      BinaryFunction distance,
+      const std::size_t num_subsamples = 5,
+      std::size_t subsample_size = 0,
+      const std::size_t max_iterations = 100)
+{
+    using DistanceResultType = decltype(distance(*first_data_itr, *first_data_itr));
+    using ValueType = typename std::iterator_traits<RandomIt>::value_type;
+    const auto N = static_cast<std::size_t>(std::distance(first_data_itr, last_data_itr));
+    if (subsample_size == 0) subsample_size = 40 + 2 * k;
+    assignments.clear();
+    if (N == 0 || k == 0) return detail::MediodVector {};
+    if (N <= subsample_size) {
+        std::vector<std::vector<std::size_t>> clusters {};
+        auto result = k_medoids(first_data_itr, last_data_itr, k, clusters, distance, max_iterations);
+        detail::assign_to_medoids(first_data_itr, last_data_itr, result, assignments, distance);
+        return result;
+    }
+    static std::mt19937 generator {42};
+    std::vector<std::size_t> indices(N);
+    std::iota(std::begin(indices), std::end(indices), 0);
+    std::vector<ValueType> subsample {};
+    subsample.reserve(subsample_size);
+    detail::MediodVector result {};
+    std::vector<std::size_t> subsample_assignments {};
+    DistanceResultType min_cost {};
+    for (std::size_t n {0}; n < num_subsamples; ++n) {
+        // Partial Fisher-Yates shuffle; the sample is the first subsample_size indices
+        for (std::size_t i {0}; i < subsample_size; ++i) {
+            std::uniform_int_distribution<std::size_t> dist {i, N - 1};
+            std::swap(indices[i], indices[dist(generator)]);
+        }
+        subsample.clear();
+        for (std::size_t i {0}; i < subsample_size; ++i) subsample.push_back(first_data_itr[indices[i]]);
+        std::vector<std::vector<std::size_t>> clusters {};
+        auto medoids = k_medoids(std::cbegin(subsample), std::cend(subsample), k, clusters, distance, max_iterations);
+        for (auto& medoid : medoids) medoid = indices[medoid];
+        auto cost = detail::assign_to_medoids(first_data_itr, last_data_itr, medoids, subsample_assignments, distance);
+        if (n == 0 || cost < min_cost) {
+            result = std::move(medoids);
+            std::swap(assignments, subsample_assignments);
+            min_cost = std::move(cost);
+        }
+    }
+    return result;
+}
+
 template <typename ForwardIterator>
 auto
 k_medoids(ForwardIterator first, ForwardIterator last, const std::size_t k,
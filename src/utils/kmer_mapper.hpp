@@ -12,6 +12,8 @@
 #include <iterator>
 #include <algorithm>
 #include <numeric>
+#include <limits>
+#include <stdexcept>
 
 namespace octopus {
 
@@ -52,6 +54,21 @@ constexpr auto perfect_kmer_hash(InputIt first)
                            });
 }
 
+// Applies f(index, hash) to each k-mer in sequence, with the same hashes as perfect_kmer_hash
+template <unsigned char K, typename F>
+void for_each_kmer_hash(const std::string& sequence, F f)
+{
+    static_assert(K > 0 && K <= 16, "k-mer hashes must fit into 32 bits");
+    if (sequence.size() < K) return;
+    constexpr auto last_base_shift = 2 * (K - 1);
+    auto hash = perfect_kmer_hash<K>(std::cbegin(sequence));
+    f(std::size_t {0}, hash);
+    for (std::size_t index {1}; index <= sequence.size() - K; ++index) {
+        hash = (hash >> 2) | (static_cast<KmerHashType>(perfect_hash(sequence[index + K - 1])) << last_base_shift);
+        f(index, hash);
+    }
+}
+
 using KmerPerfectHashes = std::vector<KmerHashType>;
 
 template <unsigned char K>
@@ -63,47 +80,68 @@ auto compute_kmer_hashes(const std::string& sequence)
     
     KmerPerfectHashes result(sequence.size() - K + 1);
     
-    auto result_it = std::begin(result);
-    
-    for (auto it = std::cbegin(sequence); it != std::prev(std::cend(sequence), K - 1); ++it, ++result_it) {
-        *result_it = perfect_kmer_hash<K>(it);
-    }
+    for_each_kmer_hash<K>(sequence, [&result] (const std::size_t index, const KmerHashType hash) { result[index] = hash; });
     
     return result;
 }
 
-using KmerHashTable = std::pair<std::vector<std::vector<std::size_t>>, std::size_t>;
+// The target indices of each k-mer are stored contiguously, ordered by k-mer hash then index,
+// with the indices of k-mer hash h in [indices[bin_offsets[h]], indices[bin_offsets[h + 1]]).
+struct KmerHashTable
+{
+    using Index = std::uint32_t;
+    std::vector<Index> bin_offsets, indices;
+    std::size_t num_indices = 0;
+};
 
 template <unsigned char K>
 KmerHashTable init_kmer_hash_table()
 {
-    return std::make_pair(std::vector<std::vector<std::size_t>> {num_kmers(K), std::vector<std::size_t> {}}, 0);
+    KmerHashTable result {};
+    result.bin_offsets.assign(num_kmers(K) + 1, 0);
+    return result;
 }
 
 inline void clear_kmer_hash_table(KmerHashTable& table)
 {
-    for (auto& bin : table.first) bin.clear();
-    table.second = 0;
+    std::fill(std::begin(table.bin_offsets), std::end(table.bin_offsets), 0);
+    table.indices.clear();
+    table.num_indices = 0;
 }
 
+// Replaces the contents of result, reusing its storage
 template <unsigned char K>
 void populate_kmer_hash_table(const std::string& sequence, KmerHashTable& result)
 {
+    if (sequence.size() > std::numeric_limits<KmerHashTable::Index>::max()) {
+        throw std::length_error {"populate_kmer_hash_table: sequence is too long"};
+    }
+    
+    auto& bin_offsets = result.bin_offsets;
+    bin_offsets.assign(num_kmers(K) + 1, 0);
+    result.indices.clear();
+    result.num_indices = 0;
+    
     if (sequence.size() < K) {
         return;
     }
     
-    const auto last_index = sequence.size() - K;
+    // First count the k-mers in each bin, then use the bin starts as insertion cursors
+    for_each_kmer_hash<K>(sequence, [&bin_offsets] (std::size_t, const KmerHashType hash) { ++bin_offsets[hash + 1]; });
     
-    auto it = std::cbegin(sequence);
+    std::partial_sum(std::cbegin(bin_offsets), std::cend(bin_offsets), std::begin(bin_offsets));
     
-    for (std::size_t index {0}; index <= last_index; ++index, ++it) {
-        result.first[perfect_kmer_hash<K>(it)].push_back(index);
-    }
+    result.num_indices = sequence.size() - K + 1;
+    result.indices.resize(result.num_indices);
     
-    for (auto& bin : result.first) bin.shrink_to_fit();
+    auto& indices = result.indices;
+    for_each_kmer_hash<K>(sequence, [&] (const std::size_t index, const KmerHashType hash) {
+        indices[bin_offsets[hash]++] = static_cast<KmerHashTable::Index>(index);
+    });
     
-    result.second = sequence.size() - K + 1;
+    // Each cursor has moved to the start of the next bin
+    std::copy_backward(std::cbegin(bin_offsets), std::prev(std::cend(bin_offsets)), std::end(bin_offsets));
+    bin_offsets.front() = 0;
 }
 
 template <unsigned char K>
@@ -118,7 +156,13 @@ using MappedIndexCounts = std::vector<unsigned>;
 
 inline MappedIndexCounts init_mapping_counts(const KmerHashTable& target)
 {
-    return MappedIndexCounts(target.second, 0);
+    return MappedIndexCounts(target.num_indices, 0);
+}
+
+// As above, but reuses the storage of mapping_counts
+inline void init_mapping_counts(const KmerHashTable& target, MappedIndexCounts& mapping_counts)
+{
+    mapping_counts.assign(target.num_indices, 0);
 }
 
 inline void reset_mapping_counts(MappedIndexCounts& mapping_counts)
@@ -135,21 +179,26 @@ OutputIt map_query_to_target(const KmerPerfectHashes& query, const KmerHashTable
     std::size_t first_max_hit_index {0};
     unsigned num_max_hits {0};
     
+    const auto bin_offsets = target.bin_offsets.data();
+    const auto target_indices = target.indices.data();
+    
     for (std::size_t query_index {0}; query_index < query.size(); ++query_index) {
-        for (const auto target_index : target.first[query[query_index]]) {
-            if (target_index >= query_index) {
-                const auto mapping_begin = target_index - query_index;
+        const auto bin_end = target_indices + bin_offsets[query[query_index] + 1];
+        // Bins are sorted, so skip the target indices that precede the query k-mer
+        auto bin_itr = target_indices + bin_offsets[query[query_index]];
+        while (bin_itr != bin_end && *bin_itr < query_index) ++bin_itr;
+        for (; bin_itr != bin_end; ++bin_itr) {
+            const auto mapping_begin = *bin_itr - query_index;
+            const auto count = ++mapping_counts[mapping_begin];
+            if (count > max_hit_count) {
+                max_hit_count = count;
+                first_max_hit_index = mapping_begin;
+                num_max_hits = 1;
+            } else if (count == max_hit_count) {
+                ++num_max_hits;
                 
-                if (++mapping_counts[mapping_begin] > max_hit_count) {
-                    max_hit_count = mapping_counts[mapping_begin];
+                if (mapping_begin < first_max_hit_index) {
                     first_max_hit_index = mapping_begin;
-                    num_max_hits = 1;
-                } else if (mapping_counts[mapping_begin] == max_hit_count) {
-                    ++num_max_hits;
-                    
-                    if (mapping_begin < first_max_hit_index) {
-                        first_max_hit_index = mapping_begin;
-                    }
                 }
             }
         }
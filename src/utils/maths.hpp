@@ -5,6 +5,7 @@
 #define maths_hpp
 
 #include <vector>
+#include <array>
 #include <cstddef>
 #include <cmath>
 #include <numeric>
@@ -381,6 +382,26 @@ inline RealType fast_log_sum_exp(const std::array<RealType, 3>& logs) noexcept
     return fast_log_sum_exp(logs[0], logs[1], logs[2]);
 }
 
+template <typename RealType,
+          typename = std::enable_if_t<std::is_floating_point<RealType>::value>>
+inline RealType fast_log_sum_exp(const std::array<RealType, 4>& logs) noexcept
+{
+    const auto max = std::max(std::max(logs[0], logs[1]), std::max(logs[2], logs[3]));
+    return max + fast_log((fast_exp(logs[0] - max) + fast_exp(logs[1] - max)) + (fast_exp(logs[2] - max) + fast_exp(logs[3] - max)));
+}
+
+template <typename RealType, std::size_t N,
+          typename = std::enable_if_t<std::is_floating_point<RealType>::value>>
+inline RealType fast_log_sum_exp(const std::array<RealType, N>& logs) noexcept
+{
+    static_assert(N > 0, "N == 0");
+    auto max = logs[0];
+    for (std::size_t i {1}; i < N; ++i) max = std::max(max, logs[i]);
+    RealType sum {0};
+    for (std::size_t i {0}; i < N; ++i) sum += fast_exp(logs[i] - max);
+    return max + fast_log(sum);
+}
+
 template <typename Container>
 inline auto fast_log_sum_exp(const Container& values) noexcept
 {
@@ -0,0 +1,102 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "monotonic_arena.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <cstdint>
+
+namespace octopus {
+
+MonotonicArena::MonotonicArena(const std::size_t initial_block_size)
+: initial_block_size_ {std::max(initial_block_size, alignof(std::max_align_t))}
+, blocks_ {}
+, head_ {nullptr}
+, remaining_ {0}
+, bytes_allocated_ {0}
+{}
+
+void* MonotonicArena::allocate(const std::size_t bytes, const std::size_t alignment)
+{
+    auto padding = (alignment - reinterpret_cast<std::uintptr_t>(head_) % alignment) % alignment;
+    if (head_ == nullptr || padding + bytes > remaining_) {
+        add_block(bytes + alignment);
+        padding = (alignment - reinterpret_cast<std::uintptr_t>(head_) % alignment) % alignment;
+    }
+    auto result = head_ + padding;
+    head_ = result + bytes;
+    remaining_ -= padding + bytes;
+    bytes_allocated_ += bytes;
+    return result;
+}
+
+void MonotonicArena::release() noexcept
+{
+    if (blocks_.size() > 1) {
+        // Blocks grow geometrically so the last is the largest
+        std::iter_swap(std::begin(blocks_), std::prev(std::end(blocks_)));
+        blocks_.resize(1);
+    }
+    if (blocks_.empty()) {
+        head_ = nullptr;
+        remaining_ = 0;
+    } else {
+        head_ = blocks_.front().data.get();
+        remaining_ = blocks_.front().size;
+    }
+    bytes_allocated_ = 0;
+}
+
+std::size_t MonotonicArena::bytes_allocated() const noexcept
+{
+    return bytes_allocated_;
+}
+
+std::size_t MonotonicArena::capacity() const noexcept
+{
+    std::size_t result {0};
+    for (const auto& block : blocks_) result += block.size;
+    return result;
+}
+
+void MonotonicArena::add_block(const std::size_t min_bytes)
+{
+    const auto size = std::max(blocks_.empty() ? initial_block_size_ : 2 * blocks_.back().size, min_bytes);
+    blocks_.push_back({std::make_unique<char[]>(size), size});
+    head_ = blocks_.back().data.get();
+    remaining_ = size;
+}
+
+namespace {
+
+thread_local MonotonicArena* current_task_arena {nullptr};
+
+MonotonicArena& thread_arena()
+{
+    thread_local MonotonicArena result {};
+    return result;
+}
+
+} // namespace
+
+MonotonicArena* task_arena() noexcept
+{
+    return current_task_arena;
+}
+
+TaskArenaScope::TaskArenaScope()
+: is_outermost_ {current_task_arena == nullptr}
+{
+    if (is_outermost_) current_task_arena = &thread_arena();
+}
+
+TaskArenaScope::~TaskArenaScope()
+{
+    if (is_outermost_) {
+        current_task_arena->release();
+        current_task_arena = nullptr;
+    }
+}
+
+} // namespace octopus
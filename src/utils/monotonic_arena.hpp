@@ -0,0 +1,129 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef monotonic_arena_hpp
+#define monotonic_arena_hpp
+
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+namespace octopus {
+
+// Bump allocator for short lived task data. Deallocation is a no-op; memory is reclaimed all at once
+// by release, which keeps the largest block so the next task can reuse it without going to the
+// global allocator.
+class MonotonicArena
+{
+public:
+    static constexpr std::size_t defaultInitialBlockSize {64 * 1024};
+
+    MonotonicArena(std::size_t initial_block_size = defaultInitialBlockSize);
+
+    MonotonicArena(const MonotonicArena&)            = delete;
+    MonotonicArena& operator=(const MonotonicArena&) = delete;
+    MonotonicArena(MonotonicArena&&)                 = delete;
+    MonotonicArena& operator=(MonotonicArena&&)      = delete;
+
+    ~MonotonicArena() = default;
+
+    void* allocate(std::size_t bytes, std::size_t alignment = alignof(std::max_align_t));
+    void deallocate(void*, std::size_t) noexcept {}
+
+    // All memory allocated from the arena is invalidated
+    void release() noexcept;
+
+    std::size_t bytes_allocated() const noexcept;
+    std::size_t capacity() const noexcept;
+
+private:
+    struct Block
+    {
+        std::unique_ptr<char[]> data;
+        std::size_t size;
+    };
+
+    std::size_t initial_block_size_;
+    std::vector<Block> blocks_;
+    char* head_;
+    std::size_t remaining_, bytes_allocated_;
+
+    void add_block(std::size_t min_bytes);
+};
+
+// Allocates from an arena, or from the global allocator if the arena is null
+template <typename T>
+class ArenaAllocator
+{
+public:
+    using value_type = T;
+
+    ArenaAllocator(MonotonicArena* arena = nullptr) noexcept : arena_ {arena} {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena_ {other.arena()} {}
+
+    T* allocate(const std::size_t n)
+    {
+        if (arena_) {
+            return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+        } else {
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+    }
+    void deallocate(T* p, const std::size_t n) noexcept
+    {
+        if (arena_) {
+            arena_->deallocate(p, n * sizeof(T));
+        } else {
+            ::operator delete(p);
+        }
+    }
+
+    MonotonicArena* arena() const noexcept { return arena_; }
+
+private:
+    MonotonicArena* arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) noexcept
+{
+    return lhs.arena() == rhs.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+// The arena of the task running on the calling thread, or null if there is none
+MonotonicArena* task_arena() noexcept;
+
+// Gives the calling thread a task arena for the lifetime of the scope, and releases it on exit.
+// Nested scopes share the outermost arena. Anything allocated from the arena must be destroyed
+// before the outermost scope exits.
+class TaskArenaScope
+{
+public:
+    TaskArenaScope();
+
+    TaskArenaScope(const TaskArenaScope&)            = delete;
+    TaskArenaScope& operator=(const TaskArenaScope&) = delete;
+    TaskArenaScope(TaskArenaScope&&)                 = delete;
+    TaskArenaScope& operator=(TaskArenaScope&&)      = delete;
+
+    ~TaskArenaScope();
+
+private:
+    bool is_outermost_;
+};
+
+} // namespace octopus
+
+#endif
@@ -11,6 +11,8 @@
 #include <cstddef>
 #include <utility>
 #include <type_traits>
+#include <thread>
+#include <functional>
 
 #include "thread_pool.hpp"
 
@@ -18,21 +20,97 @@ namespace octopus {
 
 namespace detail {
 
+// Splits [0, n) into contiguous chunks and calls f(chunk, begin, end) for each one. The chunks are
+// run either on the pool or, without a pool, on one std::async thread per hardware thread.
+
+inline std::size_t num_chunks(const std::size_t n, const std::size_t chunk_size) noexcept
+{
+    return (n + chunk_size - 1) / chunk_size;
+}
+
+inline std::size_t default_chunk_size(const std::size_t n, const std::size_t num_threads) noexcept
+{
+    return std::max(n / (4 * num_threads), std::size_t {1});
+}
+
+inline std::size_t async_chunk_size(const std::size_t n) noexcept
+{
+    const auto num_threads = std::max(std::size_t {std::thread::hardware_concurrency()}, std::size_t {1});
+    return std::max((n + num_threads - 1) / num_threads, std::size_t {1});
+}
+
+inline std::size_t pool_chunk_size(const std::size_t n, const ThreadPool& pool, const std::size_t grain_size) noexcept
+{
+    return grain_size > 0 ? grain_size : default_chunk_size(n, pool.size() + 1);
+}
+
+template <typename F>
+void for_each_chunk(const std::size_t n, const std::size_t chunk_size, F&& f)
+{
+    std::vector<std::future<void>> futures {};
+    futures.reserve(num_chunks(n, chunk_size));
+    std::size_t chunk {1};
+    for (auto begin = chunk_size; begin < n; begin += chunk_size, ++chunk) {
+        futures.push_back(std::async(std::launch::async, [&f, chunk, begin, chunk_size, n] () {
+            f(chunk, begin, std::min(begin + chunk_size, n)); }));
+    }
+    if (n > 0) f(0, 0, std::min(chunk_size, n));
+    for (auto& future : futures) future.get();
+}
+
+template <typename F>
+void for_each_chunk(const std::size_t n, const std::size_t chunk_size, F&& f, ThreadPool& pool)
+{
+    parallel_for(&pool, num_chunks(n, chunk_size), [&f, chunk_size, n] (const std::size_t chunk) {
+        const auto begin = chunk * chunk_size;
+        f(chunk, begin, std::min(begin + chunk_size, n));
+    });
+}
+
+template <typename ChunkRunner, typename RandomIt, typename OutputIt, typename UnaryOp>
+OutputIt chunked_transform(RandomIt first, const std::size_t n, OutputIt result, UnaryOp& op,
+                           const std::size_t chunk_size, ChunkRunner&& run_chunks)
+{
+    using result_type = std::decay_t<decltype(op(first[0]))>;
+    std::vector<std::vector<result_type>> chunk_results(num_chunks(n, chunk_size));
+    run_chunks([&] (const std::size_t chunk, const std::size_t begin, const std::size_t end) {
+        auto& chunk_result = chunk_results[chunk];
+        chunk_result.reserve(end - begin);
+        for (auto i = begin; i < end; ++i) chunk_result.push_back(op(first[i]));
+    });
+    for (auto& chunk_result : chunk_results) {
+        result = std::move(std::begin(chunk_result), std::end(chunk_result), result);
+    }
+    return result;
+}
+
+template <typename ChunkRunner, typename RandomIt1, typename RandomIt2, typename OutputIt, typename BinaryOp>
+OutputIt chunked_transform(RandomIt1 first1, RandomIt2 first2, const std::size_t n, OutputIt result, BinaryOp& op,
+                           const std::size_t chunk_size, ChunkRunner&& run_chunks)
+{
+    using result_type = std::decay_t<decltype(op(first1[0], first2[0]))>;
+    std::vector<std::vector<result_type>> chunk_results(num_chunks(n, chunk_size));
+    run_chunks([&] (const std::size_t chunk, const std::size_t begin, const std::size_t end) {
+        auto& chunk_result = chunk_results[chunk];
+        chunk_result.reserve(end - begin);
+        for (auto i = begin; i < end; ++i) chunk_result.push_back(op(first1[i], first2[i]));
+    });
+    for (auto& chunk_result : chunk_results) {
+        result = std::move(std::begin(chunk_result), std::end(chunk_result), result);
+    }
+    return result;
+}
+
 template <typename InputIt,
           typename OutputIt,
           typename UnaryOp>
 OutputIt parallel_transform(InputIt first, InputIt last, OutputIt result, UnaryOp op,
                             std::random_access_iterator_tag)
 {
-    using value_type  = typename std::iterator_traits<InputIt>::value_type;
-    using result_type = std::result_of_t<UnaryOp(value_type)>;
-    std::vector<std::future<result_type>> results(std::distance(first, last));
-    std::transform(first, last, std::begin(results),
-                   [&op](const auto& value) {
-                       return std::async(std::launch::async, op, std::cref(value));
-                   });
-    return std::transform(std::begin(results), std::end(results), result,
-                          [](auto& f) { return f.get(); });
+    const auto n = static_cast<std::size_t>(std::distance(first, last));
+    const auto chunk_size = async_chunk_size(n);
+    return chunked_transform(first, n, result, op, chunk_size,
+                             [=] (auto&& f) { for_each_chunk(n, chunk_size, f); });
 }
 
 template <typename InputIt,
@@ -51,16 +129,10 @@ template <typename InputIt1,
 OutputIt parallel_transform(InputIt1 first1, InputIt1 last1, InputIt2 first2, OutputIt result, BinaryOp op,
                             std::random_access_iterator_tag, std::random_access_iterator_tag)
 {
-    using value_type1  = typename std::iterator_traits<InputIt1>::value_type;
-    using value_type2  = typename std::iterator_traits<InputIt2>::value_type;
-    using result_type = std::result_of_t<BinaryOp(value_type1, value_type2)>;
-    std::vector<std::future<result_type>> results(std::distance(first1, last1));
-    std::transform(first1, last1, first2, std::begin(results),
-                   [&op](const auto& a, const auto& b) {
-                       return std::async(std::launch::async, op, std::cref(a), std::cref(b));
-                   });
-    return std::transform(std::begin(results), std::end(results), result,
-                          [](auto& f) { return f.get(); });
+    const auto n = static_cast<std::size_t>(std::distance(first1, last1));
+    const auto chunk_size = async_chunk_size(n);
+    return chunked_transform(first1, first2, n, result, op, chunk_size,
+                             [=] (auto&& f) { for_each_chunk(n, chunk_size, f); });
 }
 
 template <typename InputIt1,
@@ -101,24 +173,19 @@ template <typename InputIt,
           typename OutputIt,
           typename UnaryOp>
 OutputIt transform(InputIt first, InputIt last, OutputIt result, UnaryOp op, ThreadPool& pool,
-                   std::random_access_iterator_tag)
+                   const std::size_t grain_size, std::random_access_iterator_tag)
 {
-    using value_type  = typename std::iterator_traits<InputIt>::value_type;
-    using result_type = std::result_of_t<UnaryOp(value_type)>;
-    std::vector<std::future<result_type>> results(std::distance(first, last));
-    std::transform(first, last, std::begin(results),
-                   [&op, &pool](const auto& value) {
-                       return pool.push(op, std::cref(value));
-                   });
-    return std::transform(std::begin(results), std::end(results), result,
-                          [](auto& f) { return f.get(); });
+    const auto n = static_cast<std::size_t>(std::distance(first, last));
+    const auto chunk_size = pool_chunk_size(n, pool, grain_size);
+    return chunked_transform(first, n, result, op, chunk_size,
+                             [&pool, n, chunk_size] (auto&& f) { for_each_chunk(n, chunk_size, f, pool); });
 }
 
 template <typename InputIt,
           typename OutputIt,
           typename UnaryOp>
-OutputIt transform(InputIt first, InputIt last, OutputIt result, UnaryOp op, ThreadPool& pool,
-                   std::input_iterator_tag)
+OutputIt transform(InputIt first, InputIt last, OutputIt result, UnaryOp op, ThreadPool&,
+                   std::size_t, std::input_iterator_tag)
 {
     return std::transform(first, last, result, std::move(op));
 }
@@ -128,38 +195,36 @@ template <typename InputIt1,
           typename OutputIt,
           typename BinaryOp>
 OutputIt transform(InputIt1 first1, InputIt1 last1, InputIt2 first2, OutputIt result, BinaryOp op, ThreadPool& pool,
-                   std::random_access_iterator_tag, std::random_access_iterator_tag)
+                   const std::size_t grain_size, std::random_access_iterator_tag, std::random_access_iterator_tag)
 {
-    using value_type1  = typename std::iterator_traits<InputIt1>::value_type;
-    using value_type2  = typename std::iterator_traits<InputIt2>::value_type;
-    using result_type = std::result_of_t<BinaryOp(value_type1, value_type2)>;
-    std::vector<std::future<result_type>> results(std::distance(first1, last1));
-    std::transform(first1, last1, first2, std::begin(results),
-                   [&op, &pool](const auto& a, const auto& b) {
-                       return pool.push(op, std::cref(a), std::cref(b));
-                   });
-    return std::transform(std::begin(results), std::end(results), result,
-                          [](auto& f) { return f.get(); });
+    const auto n = static_cast<std::size_t>(std::distance(first1, last1));
+    const auto chunk_size = pool_chunk_size(n, pool, grain_size);
+    return chunked_transform(first1, first2, n, result, op, chunk_size,
+                             [&pool, n, chunk_size] (auto&& f) { for_each_chunk(n, chunk_size, f, pool); });
 }
 
 template <typename InputIt1,
           typename InputIt2,
           typename OutputIt,
           typename BinaryOp>
-OutputIt transform(InputIt1 first1, InputIt1 last1, InputIt2 first2, OutputIt result, BinaryOp op, ThreadPool& pool,
-                   std::input_iterator_tag, std::input_iterator_tag)
+OutputIt transform(InputIt1 first1, InputIt1 last1, InputIt2 first2, OutputIt result, BinaryOp op, ThreadPool&,
+                   std::size_t, std::input_iterator_tag, std::input_iterator_tag)
 {
     return std::transform(first1, last1, first2, result, std::move(op));
 }
 
 } // namespace detail
 
+// The pool algorithms process contiguous chunks of grain_size elements per task (0 picks a size that
+// gives each thread a few chunks). The calling thread takes part, so they may be used from pool tasks.
+
 template <typename InputIt,
           typename OutputIt,
           typename UnaryOp>
-OutputIt transform(InputIt first, InputIt last, OutputIt result, UnaryOp op, ThreadPool& pool)
+OutputIt transform(InputIt first, InputIt last, OutputIt result, UnaryOp op, ThreadPool& pool,
+                   const std::size_t grain_size = 0)
 {
-    return detail::transform(first, last, result, std::move(op), pool,
+    return detail::transform(first, last, result, std::move(op), pool, grain_size,
                              typename std::iterator_traits<InputIt>::iterator_category {});
 }
 
@@ -167,13 +232,64 @@ template <typename InputIt1,
           typename InputIt2,
           typename OutputIt,
           typename BinaryOp>
-OutputIt transform(InputIt1 first1, InputIt1 last1, InputIt2 first2, OutputIt result, BinaryOp op, ThreadPool& pool)
+OutputIt transform(InputIt1 first1, InputIt1 last1, InputIt2 first2, OutputIt result, BinaryOp op, ThreadPool& pool,
+                   const std::size_t grain_size = 0)
 {
-    return detail::transform(first1, last1, first2, result, std::move(op), pool,
+    return detail::transform(first1, last1, first2, result, std::move(op), pool, grain_size,
                              typename std::iterator_traits<InputIt1>::iterator_category {},
                              typename std::iterator_traits<InputIt2>::iterator_category {});
 }
 
+template <typename RandomIt, typename UnaryFunction>
+UnaryFunction for_each(RandomIt first, RandomIt last, UnaryFunction f, ThreadPool& pool,
+                       const std::size_t grain_size = 0)
+{
+    const auto n = static_cast<std::size_t>(std::distance(first, last));
+    detail::for_each_chunk(n, detail::pool_chunk_size(n, pool, grain_size),
+                           [first, &f] (std::size_t, const std::size_t begin, const std::size_t end) {
+                               std::for_each(first + begin, first + end, std::ref(f));
+                           }, pool);
+    return f;
+}
+
+// op must be associative, as chunks are reduced separately and then combined in order
+template <typename RandomIt, typename T, typename BinaryOp>
+T reduce(RandomIt first, RandomIt last, T init, BinaryOp op, ThreadPool& pool,
+         const std::size_t grain_size = 0)
+{
+    const auto n = static_cast<std::size_t>(std::distance(first, last));
+    const auto chunk_size = detail::pool_chunk_size(n, pool, grain_size);
+    std::vector<std::vector<T>> partials(detail::num_chunks(n, chunk_size));
+    detail::for_each_chunk(n, chunk_size, [&] (const std::size_t chunk, const std::size_t begin, const std::size_t end) {
+        T partial = first[begin];
+        for (auto i = begin + 1; i < end; ++i) partial = op(std::move(partial), first[i]);
+        partials[chunk].push_back(std::move(partial));
+    }, pool);
+    for (auto& partial : partials) init = op(std::move(init), std::move(partial.front()));
+    return init;
+}
+
+// Sorts chunks in parallel and then merges pairs of adjacent runs, each round in parallel
+template <typename RandomIt, typename Compare>
+void sort(RandomIt first, RandomIt last, Compare comp, ThreadPool& pool, const std::size_t grain_size = 0)
+{
+    const auto n = static_cast<std::size_t>(std::distance(first, last));
+    const auto chunk_size = detail::pool_chunk_size(n, pool, grain_size);
+    if (chunk_size >= n) {
+        std::sort(first, last, comp);
+        return;
+    }
+    detail::for_each_chunk(n, chunk_size, [first, &comp] (std::size_t, const std::size_t begin, const std::size_t end) {
+        std::sort(first + begin, first + end, comp);
+    }, pool);
+    for (auto run_size = chunk_size; run_size < n; run_size *= 2) {
+        detail::for_each_chunk(n, 2 * run_size, [first, &comp, run_size] (std::size_t, const std::size_t begin, const std::size_t end) {
+            const auto mid = begin + run_size;
+            if (mid < end) std::inplace_merge(first + begin, first + mid, first + end, comp);
+        }, pool);
+    }
+}
+
 } // namespace octopus
 
 #endif
@@ -5,6 +5,9 @@
 
 #include <string>
 #include <sstream>
+#include <algorithm>
+#include <iterator>
+#include <cctype>
 
 #include <boost/filesystem/operations.hpp>
 
@@ -67,8 +70,23 @@ fs::path expand_user_path(const fs::path& path)
     return path;
 }
 
+bool is_url(const fs::path& path) noexcept
+{
+    const auto& str = path.string();
+    const auto scheme_end = str.find("://");
+    if (scheme_end == std::string::npos || scheme_end == 0) return false;
+    return std::all_of(std::cbegin(str), std::next(std::cbegin(str), scheme_end),
+                       [] (const unsigned char c) { return std::isalnum(c) || c == '+' || c == '-' || c == '.'; });
+}
+
+bool is_stdin(const fs::path& path) noexcept
+{
+    return path.string() == "-";
+}
+
 fs::path resolve_path(const fs::path& path, const fs::path& working_directory, const PathResolvePolicy policy)
 {
+    if (is_url(path) || is_stdin(path)) return path;
     if (is_shorthand_user_path(path)) {
         return expand_user_path(path); // must be a root path
     }
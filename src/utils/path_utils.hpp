@@ -19,6 +19,12 @@ bool is_shorthand_user_path(const fs::path& path) noexcept;
 
 fs::path expand_user_path(const fs::path& path);
 
+// True for paths with a URL scheme (e.g. s3://, gs://, https://), which are read through htslib
+bool is_url(const fs::path& path) noexcept;
+
+// True for "-", which names the standard input
+bool is_stdin(const fs::path& path) noexcept;
+
 fs::path resolve_path(const fs::path& path, const fs::path& working_directory,
                       PathResolvePolicy policy = PathResolvePolicy::prefer_working_directory);
 
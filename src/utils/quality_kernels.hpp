@@ -0,0 +1,105 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef quality_kernels_hpp
+#define quality_kernels_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+#include "sse2_neon.hpp"
+
+namespace octopus { namespace utils {
+
+// Byte-wise kernels for the per-base read transforms. Each processes 16 bytes per step when SSE2
+// or NEON is available, finishing with a scalar tail.
+
+inline void cap_bytes(std::uint8_t* first, const std::size_t n, const std::uint8_t max) noexcept
+{
+    std::size_t i {0};
+#ifdef OCTOPUS_SSE2_INTRINSICS
+    const auto cap = _mm_set1_epi8(static_cast<char>(max));
+    for (; i + 16 <= n; i += 16) {
+        auto* p = reinterpret_cast<__m128i*>(first + i);
+        _mm_storeu_si128(p, _mm_min_epu8(_mm_loadu_si128(p), cap));
+    }
+#endif
+    for (; i < n; ++i) first[i] = std::min(first[i], max);
+}
+
+inline void zero_bytes_less_than(std::uint8_t* first, const std::size_t n, const std::uint8_t value) noexcept
+{
+    std::size_t i {0};
+#ifdef OCTOPUS_SSE2_INTRINSICS
+    const auto threshold = _mm_set1_epi8(static_cast<char>(value));
+    for (; i + 16 <= n; i += 16) {
+        auto* p = reinterpret_cast<__m128i*>(first + i);
+        const auto x = _mm_loadu_si128(p);
+        const auto keep = _mm_cmpeq_epi8(_mm_max_epu8(x, threshold), x); // x >= value
+        _mm_storeu_si128(p, _mm_and_si128(x, keep));
+    }
+#endif
+    for (; i < n; ++i) if (first[i] < value) first[i] = 0;
+}
+
+#ifdef OCTOPUS_SSE2_INTRINSICS
+namespace detail {
+
+inline int greater_equal_mask(const std::uint8_t* first, const __m128i threshold) noexcept
+{
+    const auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(x, threshold), x));
+}
+
+} // namespace detail
+#endif
+
+// Length of the longest prefix with all values less than value
+inline std::size_t count_leading_less_than(const std::uint8_t* first, const std::size_t n, const std::uint8_t value) noexcept
+{
+    std::size_t i {0};
+#ifdef OCTOPUS_SSE2_INTRINSICS
+    const auto threshold = _mm_set1_epi8(static_cast<char>(value));
+    for (; i + 16 <= n; i += 16) {
+        const auto mask = detail::greater_equal_mask(first + i, threshold);
+        if (mask != 0) return i + __builtin_ctz(static_cast<unsigned>(mask));
+    }
+#endif
+    for (; i < n; ++i) if (first[i] >= value) return i;
+    return n;
+}
+
+// Length of the longest suffix with all values less than value
+inline std::size_t count_trailing_less_than(const std::uint8_t* first, const std::size_t n, const std::uint8_t value) noexcept
+{
+    std::size_t i {n};
+#ifdef OCTOPUS_SSE2_INTRINSICS
+    const auto threshold = _mm_set1_epi8(static_cast<char>(value));
+    for (; i >= 16; i -= 16) {
+        const auto mask = detail::greater_equal_mask(first + i - 16, threshold);
+        if (mask != 0) return n - (i - 16 + 31 - __builtin_clz(static_cast<unsigned>(mask))) - 1;
+    }
+#endif
+    for (; i > 0; --i) if (first[i - 1] >= value) return n - i;
+    return n;
+}
+
+inline bool has_lowercase(const char* first, const std::size_t n) noexcept
+{
+    std::size_t i {0};
+#ifdef OCTOPUS_SSE2_INTRINSICS
+    const auto lower = _mm_set1_epi8('a' - 1), upper = _mm_set1_epi8('z' + 1);
+    for (; i + 16 <= n; i += 16) {
+        const auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + i));
+        if (_mm_movemask_epi8(_mm_and_si128(_mm_cmpgt_epi8(x, lower), _mm_cmplt_epi8(x, upper))) != 0) return true;
+    }
+#endif
+    for (; i < n; ++i) if (first[i] >= 'a' && first[i] <= 'z') return true;
+    return false;
+}
+
+} // namespace utils
+} // namespace octopus
+
+#endif
@@ -5,6 +5,8 @@
 
 #include <cassert>
 
+#include <boost/functional/hash.hpp>
+
 namespace octopus {
 
 bool primary_segments_are_duplicates(const AlignedRead& lhs, const AlignedRead& rhs) noexcept
@@ -44,10 +46,18 @@ bool IsDuplicate::operator()(const AlignedRead& lhs, const AlignedRead& rhs) con
 
 namespace detail {
 
-bool NextSegmentLess::operator()(const AlignedRead& lhs, const AlignedRead& rhs) const noexcept
+std::size_t OtherSegmentHash::operator()(const AlignedRead& read) const noexcept
 {
-    assert(lhs.has_other_segment() && rhs.has_other_segment());
-    return lhs.next_segment().inferred_template_length() < rhs.next_segment().inferred_template_length();
+    using boost::hash_combine;
+    std::size_t result {0};
+    if (read.has_other_segment()) {
+        // The contig is left to the equality check as hashing it is relatively expensive
+        const auto& segment = read.next_segment();
+        hash_combine(result, segment.inferred_template_length());
+        hash_combine(result, segment.is_marked_reverse_mapped());
+        hash_combine(result, segment.is_marked_unmapped());
+    }
+    return result;
 }
 
 } // namespace
@@ -7,6 +7,9 @@
 #include <iterator>
 #include <algorithm>
 #include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstddef>
 
 #include "basics/aligned_read.hpp"
 
@@ -23,17 +26,25 @@ struct IsDuplicate
 
 namespace detail {
 
-template <typename Range>
-bool no_duplicates(const AlignedRead& read, const Range& reads) noexcept
+// Hash and equality of the other segment, for reads already known to have duplicate primary segments
+struct OtherSegmentHash
 {
-    return std::none_of(std::cbegin(reads), std::cend(reads), [&read] (auto other_itr) { return IsDuplicate{}(read, *other_itr); });
-}
+    std::size_t operator()(const AlignedRead& read) const noexcept;
+    template <typename Iterator>
+    std::size_t operator()(Iterator read_itr) const noexcept { return (*this)(*read_itr); }
+};
 
-struct NextSegmentLess
+struct OtherSegmentsAreDuplicates
 {
-    bool operator()(const AlignedRead& lhs, const AlignedRead& rhs) const noexcept;
+    template <typename Iterator>
+    bool operator()(Iterator lhs, Iterator rhs) const noexcept { return other_segments_are_duplicates(*lhs, *rhs); }
 };
 
+template <typename Iterator>
+using OtherSegmentSet = std::unordered_set<Iterator, OtherSegmentHash, OtherSegmentsAreDuplicates>;
+template <typename Iterator, typename T>
+using OtherSegmentMap = std::unordered_map<Iterator, T, OtherSegmentHash, OtherSegmentsAreDuplicates>;
+
 } // namespace detail
 
 template <typename ForwardIt>
@@ -41,33 +52,31 @@ std::vector<std::vector<ForwardIt>>
 find_duplicates(ForwardIt first, const ForwardIt last)
 {
     std::vector<std::vector<ForwardIt>> result {};
-    std::vector<ForwardIt> buffer {};
     // Recall that reads come sorted w.r.t operator< and it is therefore not guaranteed that 'duplicate'
     // reads (according to IsDuplicate) will be adjacent to one another. In particular, operator< only
     // guarantees that duplicate read segment described in the AlignedRead object will be adjacent.
+    // Reads with duplicate primary segments are therefore grouped by hashing their other segments,
+    // which is linear in the number of reads that start at the same position.
     const static auto are_primary_dups = [] (const auto& lhs, const auto& rhs) { return primary_segments_are_duplicates(lhs, rhs); };
+    detail::OtherSegmentMap<ForwardIt, std::size_t> group_indices {};
+    std::vector<std::vector<ForwardIt>> groups {};
     for (first = std::adjacent_find(first, last, are_primary_dups); first != last; first = std::adjacent_find(first, last, are_primary_dups)) {
-        buffer.reserve(8);
-        if (first->has_other_segment()) buffer.push_back(first);
-        if (std::next(first)->has_other_segment()) buffer.push_back(std::next(first));
         const AlignedRead& primary_dup_read {*first};
-        std::advance(first, 2);
         for (; first != last && primary_segments_are_duplicates(*first, primary_dup_read); ++first) {
-            if (first->has_other_segment()) buffer.push_back(first);
-        }
-        std::sort(buffer.begin(), buffer.end(), [] (ForwardIt lhs, ForwardIt rhs) { return detail::NextSegmentLess{}(*lhs, *rhs); });
-        const static auto are_dups = [] (ForwardIt lhs, ForwardIt rhs) { return are_duplicates(*lhs, *rhs); };
-        for (auto dup_itr = std::adjacent_find(buffer.cbegin(), buffer.cend(), are_dups); dup_itr != buffer.cend();
-                 dup_itr = std::adjacent_find(dup_itr, buffer.cend(), are_dups)) {
-            std::vector<ForwardIt> duplicates {dup_itr, std::next(dup_itr, 2)};
-            const AlignedRead& duplicate_read {**dup_itr};
-            std::advance(dup_itr, 2);
-            for (; dup_itr != buffer.cend() && are_duplicates(**dup_itr, duplicate_read); ++dup_itr) {
-                duplicates.push_back(*dup_itr);
+            if (first->has_other_segment()) {
+                const auto p = group_indices.emplace(first, groups.size());
+                if (p.second) {
+                    groups.push_back({first});
+                } else {
+                    groups[p.first->second].push_back(first);
+                }
             }
-            result.push_back(std::move(duplicates));
         }
-        buffer.clear();
+        for (auto& group : groups) {
+            if (group.size() > 1) result.push_back(std::move(group));
+        }
+        group_indices.clear();
+        groups.clear();
     }
     return result;
 }
@@ -78,17 +87,19 @@ ForwardIt remove_duplicates(ForwardIt first, ForwardIt last)
     // See comment in 'find_duplicates'
     first = std::adjacent_find(first, last, [] (const auto& lhs, const auto& rhs) { return primary_segments_are_duplicates(lhs, rhs); });
     if (first != last) {
-        std::vector<ForwardIt> buffer {first++};
-        buffer.reserve(100);
+        auto group_head = first++;
+        detail::OtherSegmentSet<ForwardIt> group {}; // only populated for groups with duplicate primary segments
         for (auto itr = first; itr != last; ++itr) {
-            if (primary_segments_are_duplicates(*itr, *buffer.front())) { // can check any read in buffer
-                if (detail::no_duplicates(*itr, buffer)) {
+            if (primary_segments_are_duplicates(*itr, *group_head)) {
+                if (group.empty()) group.insert(group_head);
+                if (group.count(itr) == 0) {
                     if (itr != first) *first = std::move(*itr);
-                    buffer.emplace_back(first++);
+                    group.insert(first++);
                 }
             } else {
                 if (itr != first) *first = std::move(*itr);
-                buffer.assign({first++});
+                group_head = first++;
+                if (!group.empty()) group.clear();
             }
         }
     }
@@ -0,0 +1,30 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "read_mismatches.hpp"
+
+#include "basics/cigar_string.hpp"
+
+namespace octopus {
+
+AlignedRead::MismatchVector find_reference_mismatches(const AlignedRead& read, const ReferenceGenome& reference)
+{
+    if (const auto mismatches = read.reference_mismatches()) return *mismatches;
+    AlignedRead::MismatchVector result {};
+    auto ref_index = mapped_begin(read);
+    std::size_t read_index {0};
+    for (const auto& op : read.cigar()) {
+        if (op.flag() == CigarOperation::Flag::alignmentMatch) {
+            const GenomicRegion region {contig_name(read), ref_index, ref_index + op.size()};
+            for_each_reference_mismatch(read, read_index, reference, region, [&] (const std::size_t i) {
+                result.push_back(static_cast<AlignedRead::MismatchVector::value_type>(read_index + i));
+            });
+        }
+        if (advances_sequence(op)) read_index += op.size();
+        // Consistent with the read scanners, which also step over padding on the reference
+        if (advances_reference(op) || op.flag() == CigarOperation::Flag::padding) ref_index += op.size();
+    }
+    return result;
+}
+
+} // namespace octopus
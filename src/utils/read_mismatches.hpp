@@ -0,0 +1,51 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef read_mismatches_hpp
+#define read_mismatches_hpp
+
+#include <cstddef>
+#include <algorithm>
+#include <iterator>
+
+#include "basics/genomic_region.hpp"
+#include "basics/aligned_read.hpp"
+#include "io/reference/reference_genome.hpp"
+#include "sequence_kernels.hpp"
+
+namespace octopus {
+
+AlignedRead::MismatchVector find_reference_mismatches(const AlignedRead& read, const ReferenceGenome& reference);
+
+// Calls f(i), in increasing order, for each i in [0, n) such that the read base at read_index + i mismatches
+// reference[i], where the n read bases from read_index are in an alignment match operation. Ns are ignored.
+// The read's cached reference mismatches are used if they are set.
+template <typename F>
+void for_each_reference_mismatch(const AlignedRead& read, const std::size_t read_index,
+                                 const char* reference, const std::size_t n, F f)
+{
+    if (const auto mismatches = read.reference_mismatches()) {
+        auto itr = std::lower_bound(std::cbegin(*mismatches), std::cend(*mismatches), read_index);
+        for (; itr != std::cend(*mismatches) && *itr < read_index + n; ++itr) f(*itr - read_index);
+    } else {
+        utils::for_each_mismatch(reference, read.sequence().data() + read_index, n, f);
+    }
+}
+
+// As above, where region is the reference region of the match operation. The reference is only
+// fetched if the read has no cached reference mismatches.
+template <typename F>
+void for_each_reference_mismatch(const AlignedRead& read, const std::size_t read_index,
+                                 const ReferenceGenome& reference, const GenomicRegion& region, F f)
+{
+    if (read.reference_mismatches()) {
+        for_each_reference_mismatch(read, read_index, nullptr, size(region), f);
+    } else {
+        const auto ref_segment = reference.fetch_sequence_view(region);
+        for_each_reference_mismatch(read, read_index, ref_segment.data(), ref_segment.size(), f);
+    }
+}
+
+} // namespace octopus
+
+#endif
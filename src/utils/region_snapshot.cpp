@@ -0,0 +1,382 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "region_snapshot.hpp"
+
+#include <fstream>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <algorithm>
+#include <iterator>
+#include <type_traits>
+
+#include <boost/filesystem/operations.hpp>
+
+#include "basics/aligned_read.hpp"
+#include "basics/cigar_string.hpp"
+#include "io/reference/reference_genome.hpp"
+#include "utils/mappable_algorithms.hpp"
+
+namespace octopus {
+
+namespace {
+
+// Layout: magic, then the fields of RegionSnapshot in declaration order. Strings and vectors are prefixed by
+// their size (u32, or u64 for read and candidate counts). Values are written in host byte order.
+constexpr char magic[8] = {'O', 'C', 'T', 'S', 'N', 'P', '1', '\0'};
+
+constexpr GenomicRegion::Size referencePadding {5'000};
+
+class SnapshotWriter
+{
+public:
+    SnapshotWriter(const boost::filesystem::path& path)
+    : path_ {path}
+    , out_ {path.string(), std::ios::binary | std::ios::trunc}
+    {
+        if (!out_) throw std::runtime_error {"RegionSnapshot: could not open " + path_.string()};
+    }
+
+    template <typename T>
+    void write(const T& value)
+    {
+        out_.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void write(const char* data, const std::size_t size)
+    {
+        out_.write(data, size);
+    }
+
+    void write(const std::string& str)
+    {
+        write(static_cast<std::uint32_t>(str.size()));
+        out_.write(str.data(), str.size());
+    }
+
+    void write(const GenomicRegion& region)
+    {
+        write(region.contig_name());
+        write(static_cast<std::uint32_t>(region.begin()));
+        write(static_cast<std::uint32_t>(region.end()));
+    }
+
+    void close()
+    {
+        out_.close();
+        if (!out_) throw std::runtime_error {"RegionSnapshot: could not write " + path_.string()};
+    }
+
+private:
+    boost::filesystem::path path_;
+    std::ofstream out_;
+};
+
+class SnapshotReader
+{
+public:
+    SnapshotReader(const boost::filesystem::path& path)
+    : path_ {path}
+    , in_ {path.string(), std::ios::binary}
+    {
+        if (!in_) throw std::runtime_error {"RegionSnapshot: could not open " + path_.string()};
+    }
+
+    template <typename T>
+    T read()
+    {
+        T result;
+        read(reinterpret_cast<char*>(&result), sizeof(T));
+        return result;
+    }
+
+    void read(char* data, const std::size_t size)
+    {
+        in_.read(data, size);
+        if (!in_) throw std::runtime_error {"RegionSnapshot: " + path_.string() + " is truncated"};
+    }
+
+    std::string read_string()
+    {
+        std::string result(read<std::uint32_t>(), '\0');
+        read(&result[0], result.size());
+        return result;
+    }
+
+    GenomicRegion read_region()
+    {
+        auto contig = read_string();
+        const auto begin = read<std::uint32_t>();
+        const auto end = read<std::uint32_t>();
+        if (end < begin) throw std::runtime_error {"RegionSnapshot: " + path_.string() + " is corrupted"};
+        return GenomicRegion {std::move(contig), begin, end};
+    }
+
+    const boost::filesystem::path& path() const noexcept { return path_; }
+
+private:
+    boost::filesystem::path path_;
+    std::ifstream in_;
+};
+
+std::uint16_t pack(const AlignedRead::Flags& flags) noexcept
+{
+    const bool bits[] {flags.multiple_segment_template, flags.all_segments_in_read_aligned, flags.unmapped,
+                       flags.reverse_mapped, flags.secondary_alignment, flags.qc_fail, flags.duplicate,
+                       flags.supplementary_alignment, flags.first_template_segment, flags.last_template_segment};
+    std::uint16_t result {0};
+    for (std::size_t i {0}; i < std::extent<decltype(bits)>::value; ++i) {
+        if (bits[i]) result |= 1u << i;
+    }
+    return result;
+}
+
+AlignedRead::Flags unpack_read_flags(const std::uint16_t bits) noexcept
+{
+    const auto is_set = [bits] (unsigned i) -> bool { return (bits >> i) & 1u; };
+    return {is_set(0), is_set(1), is_set(2), is_set(3), is_set(4), is_set(5), is_set(6), is_set(7), is_set(8), is_set(9)};
+}
+
+void write(const AlignedRead& read, SnapshotWriter& out)
+{
+    out.write(read.name());
+    out.write(mapped_region(read));
+    out.write(read.sequence());
+    out.write(static_cast<std::uint32_t>(read.base_qualities().size()));
+    out.write(reinterpret_cast<const char*>(read.base_qualities().data()), read.base_qualities().size());
+    out.write(to_string(read.cigar()));
+    out.write(read.mapping_quality());
+    out.write(pack(read.flags()));
+    out.write(read.read_group());
+    out.write(static_cast<std::uint8_t>(read.has_other_segment()));
+    if (read.has_other_segment()) {
+        const auto& segment = read.next_segment();
+        out.write(segment.contig_name());
+        out.write(static_cast<std::uint32_t>(segment.begin()));
+        out.write(static_cast<std::uint32_t>(segment.inferred_template_length()));
+        out.write(static_cast<std::uint8_t>(segment.is_marked_unmapped() | segment.is_marked_reverse_mapped() << 1));
+    }
+}
+
+AlignedRead read_aligned_read(SnapshotReader& in)
+{
+    auto name = in.read_string();
+    auto region = in.read_region();
+    auto sequence = in.read_string();
+    AlignedRead::BaseQualityVector qualities(in.read<std::uint32_t>());
+    in.read(reinterpret_cast<char*>(qualities.data()), qualities.size());
+    auto cigar = parse_cigar(in.read_string());
+    const auto mapping_quality = in.read<AlignedRead::MappingQuality>();
+    const auto flags = unpack_read_flags(in.read<std::uint16_t>());
+    auto read_group = in.read_string();
+    if (in.read<std::uint8_t>()) {
+        auto next_contig = in.read_string();
+        const auto next_begin = in.read<std::uint32_t>();
+        const auto template_length = in.read<std::uint32_t>();
+        const auto next_flags = in.read<std::uint8_t>();
+        return {std::move(name), std::move(region), std::move(sequence), std::move(qualities), std::move(cigar),
+                mapping_quality, flags, std::move(read_group), std::move(next_contig), next_begin, template_length,
+                AlignedRead::Segment::Flags {bool(next_flags & 1u), bool(next_flags & 2u)}};
+    }
+    return {std::move(name), std::move(region), std::move(sequence), std::move(qualities), std::move(cigar),
+            mapping_quality, flags, std::move(read_group)};
+}
+
+} // namespace
+
+RegionSnapshot make_region_snapshot(const GenomicRegion& call_region, const ReadMap& reads,
+                                    const MappableFlatSet<Variant>& candidates, const ReferenceGenome& reference,
+                                    std::string command_line)
+{
+    RegionSnapshot result {};
+    result.call_region = call_region;
+    auto inputs_region = call_region;
+    for (const auto& p : reads) {
+        result.samples.push_back(p.first);
+        if (!p.second.empty()) inputs_region = encompassing_region(inputs_region, encompassing_region(p.second));
+    }
+    if (!candidates.empty()) inputs_region = encompassing_region(inputs_region, encompassing_region(candidates));
+    result.contig_size = reference.contig_size(call_region.contig_name());
+    result.reference_region = GenomicRegion {inputs_region.contig_name(),
+                                             inputs_region.begin() > referencePadding ? inputs_region.begin() - referencePadding : 0,
+                                             std::min(inputs_region.end() + referencePadding, result.contig_size)};
+    result.reference_sequence = reference.fetch_sequence(result.reference_region);
+    result.reads = reads;
+    result.candidates.assign(std::cbegin(candidates), std::cend(candidates));
+    result.command_line = std::move(command_line);
+    return result;
+}
+
+void write_region_snapshot(const RegionSnapshot& snapshot, const boost::filesystem::path& path)
+{
+    // Write to a temporary so an interrupted write never leaves a partial snapshot in place
+    auto tmp_path = path;
+    tmp_path += ".tmp";
+    {
+        SnapshotWriter out {tmp_path};
+        out.write(magic, sizeof(magic));
+        out.write(snapshot.call_region);
+        out.write(snapshot.reference_region);
+        out.write(static_cast<std::uint32_t>(snapshot.contig_size));
+        out.write(snapshot.reference_sequence);
+        out.write(static_cast<std::uint32_t>(snapshot.samples.size()));
+        for (const auto& sample : snapshot.samples) {
+            out.write(sample);
+            const auto reads_itr = snapshot.reads.find(sample);
+            if (reads_itr != std::cend(snapshot.reads)) {
+                out.write(static_cast<std::uint64_t>(reads_itr->second.size()));
+                for (const auto& read : reads_itr->second) write(read, out);
+            } else {
+                out.write(std::uint64_t {0});
+            }
+        }
+        out.write(static_cast<std::uint64_t>(snapshot.candidates.size()));
+        for (const auto& candidate : snapshot.candidates) {
+            out.write(mapped_region(candidate));
+            out.write(ref_sequence(candidate));
+            out.write(alt_sequence(candidate));
+        }
+        out.write(snapshot.command_line);
+        out.close();
+    }
+    boost::filesystem::rename(tmp_path, path);
+}
+
+RegionSnapshot read_region_snapshot(const boost::filesystem::path& path)
+{
+    SnapshotReader in {path};
+    char file_magic[sizeof(magic)];
+    in.read(file_magic, sizeof(magic));
+    if (!std::equal(std::cbegin(magic), std::cend(magic), file_magic)) {
+        throw std::runtime_error {"RegionSnapshot: " + path.string() + " is not a region snapshot"};
+    }
+    RegionSnapshot result {};
+    result.call_region = in.read_region();
+    result.reference_region = in.read_region();
+    result.contig_size = in.read<std::uint32_t>();
+    result.reference_sequence = in.read_string();
+    if (result.reference_sequence.size() != size(result.reference_region)) {
+        throw std::runtime_error {"RegionSnapshot: " + path.string() + " is corrupted"};
+    }
+    const auto num_samples = in.read<std::uint32_t>();
+    result.samples.reserve(num_samples);
+    result.reads.reserve(num_samples);
+    for (std::uint32_t s {0}; s < num_samples; ++s) {
+        result.samples.push_back(in.read_string());
+        const auto num_reads = in.read<std::uint64_t>();
+        std::vector<AlignedRead> reads {};
+        reads.reserve(num_reads);
+        for (std::uint64_t i {0}; i < num_reads; ++i) {
+            reads.push_back(read_aligned_read(in));
+        }
+        result.reads.emplace(result.samples.back(), ReadMap::mapped_type {std::make_move_iterator(std::begin(reads)),
+                                                                          std::make_move_iterator(std::end(reads))});
+    }
+    const auto num_candidates = in.read<std::uint64_t>();
+    result.candidates.reserve(num_candidates);
+    for (std::uint64_t i {0}; i < num_candidates; ++i) {
+        auto region = in.read_region();
+        auto ref = in.read_string();
+        auto alt = in.read_string();
+        result.candidates.emplace_back(std::move(region), std::move(ref), std::move(alt));
+    }
+    result.command_line = in.read_string();
+    return result;
+}
+
+// SnapshotReference
+
+SnapshotReference::SnapshotReference(const RegionSnapshot& snapshot)
+: region_ {snapshot.reference_region}
+, contig_size_ {snapshot.contig_size}
+, sequence_ {snapshot.reference_sequence}
+{}
+
+std::unique_ptr<io::ReferenceReader> SnapshotReference::do_clone() const
+{
+    return std::make_unique<SnapshotReference>(*this);
+}
+
+bool SnapshotReference::do_is_open() const noexcept
+{
+    return true;
+}
+
+std::string SnapshotReference::do_fetch_reference_name() const
+{
+    return "snapshot";
+}
+
+std::vector<SnapshotReference::ContigName> SnapshotReference::do_fetch_contig_names() const
+{
+    return {region_.contig_name()};
+}
+
+SnapshotReference::GenomicSize SnapshotReference::do_fetch_contig_size(const ContigName& contig) const
+{
+    if (contig != region_.contig_name()) {
+        throw std::runtime_error {"SnapshotReference: contig " + contig + " is not in the snapshot"};
+    }
+    return contig_size_;
+}
+
+SnapshotReference::GeneticSequence SnapshotReference::do_fetch_sequence(const GenomicRegion& region) const
+{
+    if (!contains(region_, region)) {
+        throw std::runtime_error {"SnapshotReference: " + to_string(region) + " is outside the snapshot window "
+                                  + to_string(region_)};
+    }
+    return sequence_.substr(region.begin() - region_.begin(), size(region));
+}
+
+// capture
+
+namespace {
+
+struct SnapshotCapture
+{
+    std::vector<GenomicRegion> regions;
+    boost::filesystem::path directory;
+    std::string command_line;
+};
+
+// Set before calling starts and only read afterwards, so needs no synchronisation
+std::unique_ptr<SnapshotCapture> snapshot_capture {};
+
+} // namespace
+
+void capture_region_snapshots(std::vector<GenomicRegion> regions, boost::filesystem::path directory,
+                              std::string command_line)
+{
+    if (!boost::filesystem::exists(directory)) boost::filesystem::create_directories(directory);
+    snapshot_capture = std::make_unique<SnapshotCapture>(SnapshotCapture {std::move(regions), std::move(directory),
+                                                                          std::move(command_line)});
+}
+
+bool is_capturing_region_snapshots() noexcept
+{
+    return static_cast<bool>(snapshot_capture);
+}
+
+boost::optional<boost::filesystem::path> get_region_snapshot_path(const GenomicRegion& call_region)
+{
+    if (!snapshot_capture) return boost::none;
+    const auto& regions = snapshot_capture->regions;
+    if (std::none_of(std::cbegin(regions), std::cend(regions),
+                     [&] (const auto& region) { return is_same_contig(region, call_region) && overlaps(region, call_region); })) {
+        return boost::none;
+    }
+    auto file_name = call_region.contig_name() + '_' + std::to_string(call_region.begin()) + '-'
+                     + std::to_string(call_region.end()) + ".snapshot";
+    std::replace(std::begin(file_name), std::end(file_name), ':', '_');
+    return snapshot_capture->directory / file_name;
+}
+
+const std::string& get_region_snapshot_command_line() noexcept
+{
+    static const std::string empty {};
+    return snapshot_capture ? snapshot_capture->command_line : empty;
+}
+
+} // namespace octopus
@@ -0,0 +1,88 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef region_snapshot_hpp
+#define region_snapshot_hpp
+
+#include <vector>
+#include <string>
+#include <memory>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
+
+#include "config/common.hpp"
+#include "basics/genomic_region.hpp"
+#include "core/types/variant.hpp"
+#include "containers/mappable_flat_set.hpp"
+#include "io/reference/reference_reader.hpp"
+
+namespace octopus {
+
+class ReferenceGenome;
+
+/*
+ A RegionSnapshot is everything a caller consumed for one call region: the reads after the read pipe,
+ the final candidate variants, the reference around them, and the command line of the run. Snapshots
+ are small binary files, so a slow region can be replayed and profiled without the original inputs.
+ */
+struct RegionSnapshot
+{
+    GenomicRegion call_region;
+    GenomicRegion reference_region;
+    GenomicRegion::Size contig_size;
+    std::string reference_sequence;
+    std::vector<SampleName> samples;
+    ReadMap reads;
+    std::vector<Variant> candidates;
+    std::string command_line;
+};
+
+// The reference window covers the call region, reads and candidates, padded so callers can extend haplotypes
+RegionSnapshot make_region_snapshot(const GenomicRegion& call_region, const ReadMap& reads,
+                                    const MappableFlatSet<Variant>& candidates, const ReferenceGenome& reference,
+                                    std::string command_line);
+
+void write_region_snapshot(const RegionSnapshot& snapshot, const boost::filesystem::path& path);
+RegionSnapshot read_region_snapshot(const boost::filesystem::path& path);
+
+// Serves a snapshot's reference window. Requests outside the window are errors.
+class SnapshotReference : public io::ReferenceReader
+{
+public:
+    SnapshotReference() = delete;
+
+    SnapshotReference(const RegionSnapshot& snapshot);
+
+    SnapshotReference(const SnapshotReference&)            = default;
+    SnapshotReference& operator=(const SnapshotReference&) = default;
+    SnapshotReference(SnapshotReference&&)                 = default;
+    SnapshotReference& operator=(SnapshotReference&&)      = default;
+
+    ~SnapshotReference() override = default;
+
+private:
+    GenomicRegion region_;
+    GenomicSize contig_size_;
+    GeneticSequence sequence_;
+
+    std::unique_ptr<ReferenceReader> do_clone() const override;
+    bool do_is_open() const noexcept override;
+    std::string do_fetch_reference_name() const override;
+    std::vector<ContigName> do_fetch_contig_names() const override;
+    GenomicSize do_fetch_contig_size(const ContigName& contig) const override;
+    GeneticSequence do_fetch_sequence(const GenomicRegion& region) const override;
+};
+
+// Call regions overlapping any of regions are written to directory, one snapshot per call region.
+// Must be set before calling starts.
+void capture_region_snapshots(std::vector<GenomicRegion> regions, boost::filesystem::path directory,
+                              std::string command_line);
+bool is_capturing_region_snapshots() noexcept;
+// The file to write call_region's snapshot to, if it should be captured
+boost::optional<boost::filesystem::path> get_region_snapshot_path(const GenomicRegion& call_region);
+const std::string& get_region_snapshot_command_line() noexcept;
+
+} // namespace octopus
+
+#endif
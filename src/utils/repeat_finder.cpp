@@ -3,15 +3,130 @@
 
 #include "repeat_finder.hpp"
 
+#include <tuple>
+#include <cstdint>
+
+#include "utils/tandem_repeat_index.hpp"
+
 namespace octopus {
 
 std::vector<TandemRepeat>
 find_exact_tandem_repeats(const ReferenceGenome& reference, const GenomicRegion& region, unsigned max_period)
 {
+    const auto index = reference.tandem_repeat_index();
+    if (index && max_period <= index->max_period() && index->has_contig(region.contig_name())) {
+        return index->fetch(reference, region, max_period);
+    }
     auto sequence = reference.fetch_sequence(region);
     return find_exact_tandem_repeats(sequence, region, 1, max_period);
 }
 
+namespace {
+
+bool has_period(const std::string& sequence, const std::size_t pos, const std::size_t length, const std::size_t period) noexcept
+{
+    return std::equal(std::next(std::cbegin(sequence), pos + period), std::next(std::cbegin(sequence), pos + length),
+                      std::next(std::cbegin(sequence), pos));
+}
+
+bool has_smaller_period(const std::string& sequence, const std::size_t pos, const std::size_t length, const std::size_t period) noexcept
+{
+    for (std::size_t smaller_period {1}; smaller_period < period; ++smaller_period) {
+        if (has_period(sequence, pos, length, smaller_period)) return true;
+    }
+    return false;
+}
+
+void sort_by_position(std::vector<tandem::Repeat>& repeats)
+{
+    std::sort(std::begin(repeats), std::end(repeats),
+              [] (const auto& lhs, const auto& rhs) { return std::tie(lhs.pos, lhs.period) < std::tie(rhs.pos, rhs.period); });
+}
+
+bool crosses(const tandem::Repeat& repeat, const std::size_t pos) noexcept
+{
+    return repeat.pos < pos && pos < repeat.pos + repeat.length;
+}
+
+} // namespace
+
+std::vector<tandem::Repeat> find_maximal_repetitions(const std::string& sequence, const unsigned max_period)
+{
+    std::vector<tandem::Repeat> result {};
+    const auto n = sequence.size();
+    for (std::size_t period {1}; period <= max_period; ++period) {
+        for (std::size_t pos {0}; pos + period < n; ) {
+            if (sequence[pos] != sequence[pos + period]) {
+                ++pos;
+                continue;
+            }
+            auto last = pos + 1;
+            while (last + period < n && sequence[last] == sequence[last + period]) ++last;
+            // [pos, last + period) is a maximal run with period period
+            const auto length = last + period - pos;
+            if (length >= 2 * period && !has_smaller_period(sequence, pos, length, period)) {
+                result.emplace_back(static_cast<std::uint32_t>(pos), static_cast<std::uint32_t>(length),
+                                    static_cast<std::uint32_t>(period));
+            }
+            pos = last + 1;
+        }
+    }
+    sort_by_position(result);
+    return result;
+}
+
+// A run of sequence that does not cross the rescan window boundaries is either inside the window, or is in
+// a part of sequence shared with base_sequence and ends at least 2 * max_period bases before the differences,
+// so is also a run of base_sequence. A run of sequence crossing a boundary would include at least two periods
+// of shared sequence either side of the boundary, and so be part of a base run crossing the boundary too. The
+// window boundaries are therefore moved out until no base run crosses them.
+std::vector<tandem::Repeat>
+update_maximal_repetitions(const std::string& sequence, const std::string& base_sequence,
+                           const std::vector<tandem::Repeat>& base_repeats, const unsigned max_period)
+{
+    if (sequence == base_sequence) return base_repeats;
+    const auto max_shared = std::min(sequence.size(), base_sequence.size());
+    const auto prefix_size = static_cast<std::size_t>(std::distance(std::cbegin(sequence),
+                                                      std::mismatch(std::cbegin(sequence), std::next(std::cbegin(sequence), max_shared),
+                                                                    std::cbegin(base_sequence)).first));
+    const auto suffix_size = static_cast<std::size_t>(std::distance(std::crbegin(sequence),
+                                                      std::mismatch(std::crbegin(sequence), std::next(std::crbegin(sequence), max_shared - prefix_size),
+                                                                    std::crbegin(base_sequence)).first));
+    const std::size_t margin {2 * max_period};
+    std::size_t window_begin {prefix_size > margin ? prefix_size - margin : 0};
+    std::size_t base_window_end {std::min(base_sequence.size() - suffix_size + margin, base_sequence.size())};
+    for (bool moved {true}; moved; ) {
+        moved = false;
+        for (const auto& repeat : base_repeats) {
+            if (crosses(repeat, window_begin)) {
+                window_begin = repeat.pos;
+                moved = true;
+            }
+            if (crosses(repeat, base_window_end)) {
+                base_window_end = repeat.pos + repeat.length;
+                moved = true;
+            }
+        }
+    }
+    const auto window_end = base_window_end + sequence.size() - base_sequence.size();
+    std::vector<tandem::Repeat> result {};
+    result.reserve(base_repeats.size());
+    for (const auto& repeat : base_repeats) {
+        if (repeat.pos + repeat.length > window_begin) break;
+        result.push_back(repeat);
+    }
+    const std::string window {std::next(std::cbegin(sequence), window_begin), std::next(std::cbegin(sequence), window_end)};
+    for (const auto& repeat : find_maximal_repetitions(window, max_period)) {
+        result.emplace_back(static_cast<std::uint32_t>(repeat.pos + window_begin), repeat.length, repeat.period);
+    }
+    for (const auto& repeat : base_repeats) {
+        if (repeat.pos >= base_window_end) {
+            result.emplace_back(static_cast<std::uint32_t>(repeat.pos + window_end - base_window_end), repeat.length, repeat.period);
+        }
+    }
+    return result;
+}
+
 bool is_good_seed(const TandemRepeat& repeat, const InexactRepeatDefinition& repeat_def) noexcept
 {
     const auto repeat_length = region_size(repeat);
@@ -54,8 +169,7 @@ std::vector<GenomicRegion>
 find_repeat_regions(const ReferenceGenome& reference, const GenomicRegion& region,
                     const InexactRepeatDefinition repeat_def)
 {
-    auto sequence = reference.fetch_sequence(region);
-    auto seeds = find_exact_tandem_repeats(sequence, region, 1, repeat_def.max_exact_repeat_seed_period);
+    const auto seeds = find_exact_tandem_repeats(reference, region, repeat_def.max_exact_repeat_seed_period);
     return find_repeat_regions(seeds, region, repeat_def);
 }
 
@@ -5,6 +5,7 @@
 #define repeat_finder_hpp
 
 #include <vector>
+#include <string>
 #include <iterator>
 #include <algorithm>
 #include <cmath>
@@ -66,6 +67,17 @@ find_exact_tandem_repeats(const SequenceType& sequence, const GenomicRegion& reg
 std::vector<TandemRepeat>
 find_exact_tandem_repeats(const ReferenceGenome& reference, const GenomicRegion& region, unsigned max_period);
 
+// Returns the maximal repetitions (runs) of sequence with period <= max_period, sorted by position. Runs have
+// at least two periods and are reported once with their smallest period. This is a direct scan, which is faster
+// than tandem::extract_exact_tandem_repeats for small max_period and does not need a sentinel.
+std::vector<tandem::Repeat> find_maximal_repetitions(const std::string& sequence, unsigned max_period);
+
+// Returns find_maximal_repetitions(sequence, max_period) given base_repeats, the result for base_sequence.
+// Runs are local, so only a window around the bases where the sequences differ is scanned.
+std::vector<tandem::Repeat>
+update_maximal_repetitions(const std::string& sequence, const std::string& base_sequence,
+                           const std::vector<tandem::Repeat>& base_repeats, unsigned max_period);
+
 std::vector<GenomicRegion>
 find_repeat_regions(const std::vector<TandemRepeat>& repeats, const GenomicRegion& region,
                     const InexactRepeatDefinition repeat_def);
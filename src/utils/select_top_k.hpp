@@ -10,6 +10,8 @@
 #include <queue>
 #include <cstddef>
 #include <cmath>
+#include <limits>
+#include <utility>
 #include <cassert>
 
 namespace octopus {
@@ -142,6 +144,121 @@ select_top_k_tuples(const std::vector<std::vector<T>>& values, const std::size_t
     return result;
 }
 
+// Returns up to k tuples with the largest products of probabilities, one index from each row, in
+// descending order. Tuples are enumerated lazily best-first, so enumeration stops early once the
+// tuples found account for all but max_mass_loss of the total mass (the product of the row sums).
+// Rows are visited in order of how quickly their probabilities fall off, and each tuple is reached
+// from a single parent by one of three moves on its last non-zero rank (increment it, start the next
+// row, or shift it to the next row), none of which increases the product. So at most three candidates
+// are queued per tuple returned.
+template <typename T>
+IndexTupleVector
+select_top_k_probable_tuples(const std::vector<std::vector<T>>& probabilities, const std::size_t k,
+                             const T max_mass_loss = 0)
+{
+    IndexTupleVector result {};
+    if (k == 0 || probabilities.empty()) return result;
+    const auto num_rows = probabilities.size();
+    std::vector<std::vector<std::pair<T, Index>>> sorted {};  // log probabilities, descending
+    sorted.reserve(num_rows);
+    T total_log_mass {0};
+    for (const auto& row : probabilities) {
+        if (row.empty()) return result;
+        auto indexed = detail::index(row);
+        std::sort(std::begin(indexed), std::end(indexed), std::greater<> {});
+        const auto last_possible = std::find_if(std::next(std::begin(indexed)), std::end(indexed),
+                                                [] (const auto& p) { return !(p.first > 0); });
+        indexed.erase(last_possible, std::end(indexed));
+        T row_mass {0};
+        for (auto& p : indexed) {
+            row_mass += p.first;
+            p.first = std::log(p.first);
+        }
+        total_log_mass += std::log(row_mass);
+        sorted.push_back(std::move(indexed));
+    }
+    // Rows with one possible index are fixed, the rest are ordered by increasing loss of their second index
+    std::vector<Index> order {};
+    for (Index row {0}; row < num_rows; ++row) {
+        if (sorted[row].size() > 1) order.push_back(row);
+    }
+    const auto loss = [&] (const Index row) { return sorted[row][0].first - sorted[row][1].first; };
+    std::stable_sort(std::begin(order), std::end(order), [&] (Index lhs, Index rhs) { return loss(lhs) < loss(rhs); });
+    const auto log_probability = [&] (const std::size_t position, const Index rank) { return sorted[order[position]][rank].first; };
+    const auto num_positions = order.size();
+    enum class Move { increment, extend, shift };
+    struct Candidate
+    {
+        T log_probability;
+        std::size_t parent;
+        Move move;
+        bool operator<(const Candidate& other) const noexcept { return log_probability < other.log_probability; }
+    };
+    std::vector<std::vector<Index>> ranks {}; // of each tuple found, by position
+    std::vector<std::size_t> last_positions {};
+    std::priority_queue<Candidate> candidates {};
+    T root_log_probability {0};
+    for (const auto& row : sorted) root_log_probability += row.front().first;
+    ranks.emplace_back(num_positions, 0);
+    last_positions.push_back(0);
+    T mass {std::exp(root_log_probability - total_log_mass)};
+    const auto push_successors = [&] (const std::size_t tuple, const T tuple_log_probability) {
+        const auto& tuple_ranks = ranks[tuple];
+        if (num_positions == 0) return;
+        if (tuple == 0) {
+            candidates.push({tuple_log_probability - log_probability(0, 0) + log_probability(0, 1), tuple, Move::extend});
+            return;
+        }
+        const auto last = last_positions[tuple];
+        const auto rank = tuple_ranks[last];
+        if (rank + 1 < sorted[order[last]].size()) {
+            candidates.push({tuple_log_probability - log_probability(last, rank) + log_probability(last, rank + 1), tuple, Move::increment});
+        }
+        if (last + 1 < num_positions) {
+            const auto extended = tuple_log_probability - log_probability(last + 1, 0) + log_probability(last + 1, 1);
+            candidates.push({extended, tuple, Move::extend});
+            if (rank == 1) {
+                candidates.push({extended - log_probability(last, 1) + log_probability(last, 0), tuple, Move::shift});
+            }
+        }
+    };
+    push_successors(0, root_log_probability);
+    while (ranks.size() < k && mass < 1 - max_mass_loss && !candidates.empty()) {
+        const auto candidate = candidates.top();
+        candidates.pop();
+        auto tuple_ranks = ranks[candidate.parent];
+        auto last = last_positions[candidate.parent];
+        switch (candidate.move) {
+            case Move::increment:
+                ++tuple_ranks[last];
+                break;
+            case Move::extend:
+                if (candidate.parent != 0) ++last;
+                tuple_ranks[last] = 1;
+                break;
+            case Move::shift:
+                tuple_ranks[last] = 0;
+                tuple_ranks[++last] = 1;
+                break;
+        }
+        ranks.push_back(std::move(tuple_ranks));
+        last_positions.push_back(last);
+        mass += std::exp(candidate.log_probability - total_log_mass);
+        push_successors(ranks.size() - 1, candidate.log_probability);
+    }
+    result.reserve(ranks.size());
+    IndexTuple tuple(num_rows);
+    for (std::size_t row {0}; row < num_rows; ++row) tuple[row] = sorted[row].front().second;
+    for (auto& tuple_ranks : ranks) {
+        for (std::size_t position {0}; position < num_positions; ++position) {
+            tuple[order[position]] = sorted[order[position]][tuple_ranks[position]].second;
+        }
+        result.push_back(tuple);
+        std::vector<Index> {}.swap(tuple_ranks);
+    }
+    return result;
+}
+
 } // namespace octopus
 
 #endif
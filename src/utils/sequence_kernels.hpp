@@ -0,0 +1,190 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef sequence_kernels_hpp
+#define sequence_kernels_hpp
+
+#include <cstddef>
+#include <cstdint>
+
+#include "sse2_neon.hpp"
+
+namespace octopus { namespace utils {
+
+// Calls f(i), in increasing order, for each i in [0, n) such that lhs[i] != rhs[i] and neither is 'N'.
+// Compares 16 bases per step when SSE2 or NEON is available, finishing with a scalar tail.
+template <typename F>
+void for_each_mismatch(const char* lhs, const char* rhs, const std::size_t n, F f)
+{
+    std::size_t i {0};
+#ifdef OCTOPUS_SSE2_INTRINSICS
+    const auto n_base = _mm_set1_epi8('N');
+    for (; i + 16 <= n; i += 16) {
+        const auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lhs + i));
+        const auto y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rhs + i));
+        const auto ignore = _mm_or_si128(_mm_cmpeq_epi8(x, y), _mm_or_si128(_mm_cmpeq_epi8(x, n_base), _mm_cmpeq_epi8(y, n_base)));
+        auto mismatches = ~static_cast<unsigned>(_mm_movemask_epi8(ignore)) & 0xFFFFu;
+        while (mismatches != 0) {
+            f(i + __builtin_ctz(mismatches));
+            mismatches &= mismatches - 1;
+        }
+    }
+#endif
+    for (; i < n; ++i) {
+        if (lhs[i] != rhs[i] && lhs[i] != 'N' && rhs[i] != 'N') f(i);
+    }
+}
+
+// The kernels below also process 16 bases per step when SSE2 or NEON is available.
+
+inline void capitalise_bases(char* first, const std::size_t n) noexcept
+{
+    std::size_t i {0};
+#ifdef OCTOPUS_SSE2_INTRINSICS
+    const auto lower = _mm_set1_epi8('a' - 1), upper = _mm_set1_epi8('z' + 1), case_bit = _mm_set1_epi8(0x20);
+    for (; i + 16 <= n; i += 16) {
+        auto* p = reinterpret_cast<__m128i*>(first + i);
+        const auto x = _mm_loadu_si128(p);
+        const auto is_lower = _mm_and_si128(_mm_cmpgt_epi8(x, lower), _mm_cmplt_epi8(x, upper));
+        _mm_storeu_si128(p, _mm_andnot_si128(_mm_and_si128(is_lower, case_bit), x));
+    }
+#endif
+    for (; i < n; ++i) if (first[i] >= 'a' && first[i] <= 'z') first[i] -= 0x20;
+}
+
+inline bool contains_base(const char* first, const std::size_t n, const char base) noexcept
+{
+    std::size_t i {0};
+#ifdef OCTOPUS_SSE2_INTRINSICS
+    const auto b = _mm_set1_epi8(base);
+    for (; i + 16 <= n; i += 16) {
+        const auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, b)) != 0) return true;
+    }
+#endif
+    for (; i < n; ++i) if (first[i] == base) return true;
+    return false;
+}
+
+#ifdef OCTOPUS_SSE2_INTRINSICS
+namespace detail {
+
+inline __m128i canonical_dna_mask(const __m128i x, const bool allow_ns) noexcept
+{
+    auto result = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('A')), _mm_cmpeq_epi8(x, _mm_set1_epi8('C'))),
+                               _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('G')), _mm_cmpeq_epi8(x, _mm_set1_epi8('T'))));
+    if (allow_ns) result = _mm_or_si128(result, _mm_cmpeq_epi8(x, _mm_set1_epi8('N')));
+    return result;
+}
+
+} // namespace detail
+#endif
+
+// Length of the longest prefix of A, C, G and T bases, or also N if allow_ns
+inline std::size_t count_leading_canonical_dna(const char* first, const std::size_t n, const bool allow_ns = false) noexcept
+{
+    std::size_t i {0};
+#ifdef OCTOPUS_SSE2_INTRINSICS
+    for (; i + 16 <= n; i += 16) {
+        const auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + i));
+        const auto others = ~static_cast<unsigned>(_mm_movemask_epi8(detail::canonical_dna_mask(x, allow_ns))) & 0xFFFFu;
+        if (others != 0) return i + __builtin_ctz(others);
+    }
+#endif
+    for (; i < n; ++i) {
+        const auto base = first[i];
+        if (base != 'A' && base != 'C' && base != 'G' && base != 'T' && !(allow_ns && base == 'N')) return i;
+    }
+    return n;
+}
+
+inline std::size_t count_gc(const char* first, const std::size_t n) noexcept
+{
+    std::size_t result {0}, i {0};
+#ifdef OCTOPUS_SSE2_INTRINSICS
+    const auto c = _mm_set1_epi8('C'), g = _mm_set1_epi8('G');
+    for (; i + 16 <= n; i += 16) {
+        const auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + i));
+        result += __builtin_popcount(static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(x, c), _mm_cmpeq_epi8(x, g)))));
+    }
+#endif
+    for (; i < n; ++i) if (first[i] == 'C' || first[i] == 'G') ++result;
+    return result;
+}
+
+#ifdef OCTOPUS_SSE2_INTRINSICS
+namespace detail {
+
+inline __m128i reverse_bytes(__m128i x) noexcept
+{
+    const auto low_shorts = _mm_set_epi64x(0x0000FFFF0000FFFF, 0x0000FFFF0000FFFF);
+    x = _mm_or_si128(_mm_srli_si128(x, 8), _mm_slli_si128(x, 8));
+    x = _mm_or_si128(_mm_srli_epi64(x, 32), _mm_slli_epi64(x, 32));
+    x = _mm_or_si128(_mm_and_si128(_mm_srli_epi64(x, 16), low_shorts), _mm_slli_epi64(_mm_and_si128(x, low_shorts), 16));
+    return _mm_or_si128(_mm_srli_epi16(x, 8), _mm_slli_epi16(x, 8));
+}
+
+// Reverse complements 16 bases with compare and select if they are all A, C, G, T or N,
+// otherwise one base at a time with complement
+template <typename F>
+__m128i reverse_complement_block(const __m128i x, F complement) noexcept
+{
+    const auto reversed = reverse_bytes(x);
+    const auto a = _mm_cmpeq_epi8(reversed, _mm_set1_epi8('A')), c = _mm_cmpeq_epi8(reversed, _mm_set1_epi8('C'));
+    const auto g = _mm_cmpeq_epi8(reversed, _mm_set1_epi8('G')), t = _mm_cmpeq_epi8(reversed, _mm_set1_epi8('T'));
+    const auto n = _mm_cmpeq_epi8(reversed, _mm_set1_epi8('N'));
+    const auto known = _mm_or_si128(_mm_or_si128(_mm_or_si128(a, c), _mm_or_si128(g, t)), n);
+    if (_mm_movemask_epi8(known) == 0xFFFF) {
+        return _mm_or_si128(_mm_or_si128(_mm_or_si128(_mm_and_si128(a, _mm_set1_epi8('T')), _mm_and_si128(c, _mm_set1_epi8('G'))),
+                                         _mm_or_si128(_mm_and_si128(g, _mm_set1_epi8('C')), _mm_and_si128(t, _mm_set1_epi8('A')))),
+                            _mm_and_si128(n, _mm_set1_epi8('N')));
+    }
+    alignas(16) char bases[16];
+    _mm_store_si128(reinterpret_cast<__m128i*>(bases), reversed);
+    for (auto& base : bases) base = complement(base);
+    return _mm_load_si128(reinterpret_cast<const __m128i*>(bases));
+}
+
+} // namespace detail
+#endif
+
+// Writes the reverse complement of [first, first + n) to result, which must not overlap it.
+// complement is used for bases other than A, C, G, T and N.
+template <typename F>
+void reverse_complement_copy(const char* first, const std::size_t n, char* result, F complement)
+{
+    std::size_t i {0};
+#ifdef OCTOPUS_SSE2_INTRINSICS
+    for (; i + 16 <= n; i += 16) {
+        const auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + n - i - 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(result + i), detail::reverse_complement_block(x, complement));
+    }
+#endif
+    for (; i < n; ++i) result[i] = complement(first[n - i - 1]);
+}
+
+template <typename F>
+void reverse_complement(char* first, const std::size_t n, F complement)
+{
+    std::size_t i {0}, j {n}; // [i, j) is still to do
+#ifdef OCTOPUS_SSE2_INTRINSICS
+    for (; i + 32 <= j; i += 16, j -= 16) {
+        auto* lhs = reinterpret_cast<__m128i*>(first + i);
+        auto* rhs = reinterpret_cast<__m128i*>(first + j - 16);
+        const auto x = _mm_loadu_si128(lhs), y = _mm_loadu_si128(rhs);
+        _mm_storeu_si128(lhs, detail::reverse_complement_block(y, complement));
+        _mm_storeu_si128(rhs, detail::reverse_complement_block(x, complement));
+    }
+#endif
+    for (; i + 1 < j; ++i, --j) {
+        const auto base = complement(first[i]);
+        first[i] = complement(first[j - 1]);
+        first[j - 1] = base;
+    }
+    if (i + 1 == j) first[i] = complement(first[i]);
+}
+
+} // namespace utils
+} // namespace octopus
+
+#endif
@@ -6,6 +6,7 @@
 
 #include <vector>
 #include <array>
+#include <string>
 #include <unordered_map>
 #include <map>
 #include <cstddef>
@@ -13,6 +14,7 @@
 #include <algorithm>
 #include <functional>
 #include <random>
+#include <type_traits>
 
 #include <boost/optional.hpp>
 
@@ -21,6 +23,7 @@
 #include "basics/contig_region.hpp"
 #include "basics/genomic_region.hpp"
 #include "concepts/mappable.hpp"
+#include "sequence_kernels.hpp"
 
 namespace octopus { namespace utils {
 
@@ -84,25 +87,7 @@ static const std::array<std::vector<char>, 128> iupac_symbols
 
 inline constexpr char capitalise_base(const char base) noexcept
 {
-    switch (base) {
-        case 'a': return 'A';
-        case 'b': return 'B';
-        case 'c': return 'C';
-        case 'd': return 'C';
-        case 'g': return 'G';
-        case 'h': return 'H';
-        case 'k': return 'K';
-        case 't': return 'T';
-        case 'u': return 'U';
-        case 'm': return 'M';
-        case 'n': return 'N';
-        case 'r': return 'R';
-        case 's': return 'S';
-        case 'v': return 'V';
-        case 'w': return 'W';
-        case 'y': return 'Y';
-        default : return base;
-    }
+    return base >= 'a' && base <= 'z' ? base - ('a' - 'A') : base;
 }
 
 inline bool is_dna_nucleotide(const char b) noexcept
@@ -130,12 +115,42 @@ inline char disambiguate_iupac_base(const char base)
     return iupac_symbols[base].front();
 }
 
+// Contiguous char sequences go through the vectorised kernels in sequence_kernels.hpp
+template <typename SequenceType>
+struct is_contiguous_sequence
+: std::integral_constant<bool, std::is_same<SequenceType, std::string>::value
+                               || std::is_same<SequenceType, std::vector<char>>::value> {};
+
+template <typename SequenceType>
+bool has_ns(const SequenceType& sequence, std::true_type) noexcept
+{
+    return contains_base(sequence.data(), sequence.size(), 'N');
+}
+
+template <typename SequenceType>
+bool has_ns(const SequenceType& sequence, std::false_type) noexcept
+{
+    return std::find(std::cbegin(sequence), std::cend(sequence), 'N') != std::cend(sequence);
+}
+
+template <typename SequenceType>
+bool is_canonical_dna(const SequenceType& sequence, std::true_type) noexcept
+{
+    return count_leading_canonical_dna(sequence.data(), sequence.size()) == sequence.size();
+}
+
+template <typename SequenceType>
+bool is_canonical_dna(const SequenceType& sequence, std::false_type) noexcept
+{
+    return std::all_of(std::cbegin(sequence), std::cend(sequence), is_dna_nucleotide);
+}
+
 } // namespace detail
 
 template <typename SequenceType>
 bool has_ns(const SequenceType& sequence) noexcept
 {
-    return std::find(std::cbegin(sequence), std::cend(sequence), 'N') != std::cend(sequence);
+    return detail::has_ns(sequence, detail::is_contiguous_sequence<SequenceType> {});
 }
 
 template <typename SequenceType>
@@ -148,7 +163,7 @@ bool is_dna(const SequenceType& sequence) noexcept
 template <typename SequenceType>
 bool is_canonical_dna(const SequenceType& sequence) noexcept
 {
-    return std::all_of(std::cbegin(sequence), std::cend(sequence), detail::is_dna_nucleotide);
+    return detail::is_canonical_dna(sequence, detail::is_contiguous_sequence<SequenceType> {});
 }
 
 template <typename SequenceType>
@@ -202,11 +217,27 @@ SequenceType reverse_transcribe_copy(SequenceType rna_sequence)
     return rna_sequence;
 }
 
+namespace detail {
+
 template <typename SequenceType>
-void capitalise(SequenceType& sequence)
+void capitalise(SequenceType& sequence, std::true_type) noexcept
+{
+    if (!sequence.empty()) capitalise_bases(&sequence[0], sequence.size());
+}
+
+template <typename SequenceType>
+void capitalise(SequenceType& sequence, std::false_type)
 {
     std::transform(std::begin(sequence), std::end(sequence), std::begin(sequence),
-                   [] (auto base) { return detail::capitalise_base(base); });
+                   [] (auto base) { return capitalise_base(base); });
+}
+
+} // namespace detail
+
+template <typename SequenceType>
+void capitalise(SequenceType& sequence)
+{
+    detail::capitalise(sequence, detail::is_contiguous_sequence<SequenceType> {});
 }
 
 template <typename SequenceType>
@@ -231,18 +262,40 @@ typename Container::value_type random_member(const Container& values)
 
 } // namespace detail
 
+namespace detail {
+
+// Only the few non-canonical bases need the lookup
 template <typename SequenceType>
-void disambiguate_iupac_bases(SequenceType& sequence, const bool allow_ns = false)
+void disambiguate_iupac_bases(SequenceType& sequence, const bool allow_ns, std::true_type)
+{
+    const auto n = sequence.size();
+    for (auto i = count_leading_canonical_dna(sequence.data(), n, allow_ns); i < n;) {
+        sequence[i] = disambiguate_iupac_base(sequence[i]);
+        ++i;
+        i += count_leading_canonical_dna(sequence.data() + i, n - i, allow_ns);
+    }
+}
+
+template <typename SequenceType>
+void disambiguate_iupac_bases(SequenceType& sequence, const bool allow_ns, std::false_type)
 {
     if (allow_ns) {
         std::transform(std::begin(sequence), std::end(sequence), std::begin(sequence),
-                       [] (auto base) { return base == 'N' ? base : detail::disambiguate_iupac_base(base); });
+                       [] (auto base) { return base == 'N' ? base : disambiguate_iupac_base(base); });
     } else {
         std::transform(std::begin(sequence), std::end(sequence), std::begin(sequence),
-                       [] (auto base) { return detail::disambiguate_iupac_base(base); });
+                       [] (auto base) { return disambiguate_iupac_base(base); });
     }
 }
 
+} // namespace detail
+
+template <typename SequenceType>
+void disambiguate_iupac_bases(SequenceType& sequence, const bool allow_ns = false)
+{
+    detail::disambiguate_iupac_bases(sequence, allow_ns, detail::is_contiguous_sequence<SequenceType> {});
+}
+
 template <typename SequenceType>
 SequenceType disambiguate_iupac_bases_copy(const SequenceType& sequence, const bool allow_ns = false)
 {
@@ -279,12 +332,28 @@ OutputIt reverse_complement_copy(BidirIt first, BidirIt last, OutputIt result)
                           result, [] (const char base) { return complement(base); });
 }
 
+namespace detail {
+
+template <typename SequenceType>
+void reverse_complement_copy(const SequenceType& sequence, SequenceType& result, std::true_type)
+{
+    if (!sequence.empty()) utils::reverse_complement_copy(sequence.data(), sequence.size(), &result[0], complement);
+}
+
+template <typename SequenceType>
+void reverse_complement_copy(const SequenceType& sequence, SequenceType& result, std::false_type)
+{
+    utils::reverse_complement_copy(std::cbegin(sequence), std::cend(sequence), std::begin(result));
+}
+
+} // namespace detail
+
 template <typename SequenceType>
 SequenceType reverse_complement_copy(const SequenceType& sequence)
 {
     SequenceType result {};
     result.resize(sequence.size());
-    reverse_complement_copy(std::cbegin(sequence), std::cend(sequence), std::begin(result));
+    detail::reverse_complement_copy(sequence, result, detail::is_contiguous_sequence<SequenceType> {});
     return result;
 }
 
@@ -329,10 +398,26 @@ void reverse_complement(BidirIt first, BidirIt last)
     detail::reverse_complement(first, last, typename std::iterator_traits<BidirIt>::iterator_category {});
 }
 
+namespace detail {
+
+template <typename SequenceType>
+void reverse_complement(SequenceType& sequence, std::true_type)
+{
+    if (!sequence.empty()) utils::reverse_complement(&sequence[0], sequence.size(), complement);
+}
+
+template <typename SequenceType>
+void reverse_complement(SequenceType& sequence, std::false_type)
+{
+    utils::reverse_complement(std::begin(sequence), std::end(sequence));
+}
+
+} // namespace detail
+
 template <typename SequenceType>
 void reverse_complement(SequenceType& sequence)
 {
-    reverse_complement(std::begin(sequence), std::end(sequence));
+    detail::reverse_complement(sequence, detail::is_contiguous_sequence<SequenceType> {});
 }
 
 template <typename InputIt, typename BidirIt>
@@ -406,11 +491,27 @@ std::unordered_map<char, size_t> count_bases(const SequenceType& sequence)
     return result;
 }
 
+namespace detail {
+
+template <typename SequenceType>
+std::size_t count_gc(const SequenceType& sequence, std::true_type) noexcept
+{
+    return utils::count_gc(sequence.data(), sequence.size());
+}
+
+template <typename SequenceType>
+std::size_t count_gc(const SequenceType& sequence, std::false_type) noexcept
+{
+    return std::count_if(std::cbegin(sequence), std::cend(sequence),
+                         [] (const char base) { return base == 'G' || base == 'C'; });
+}
+
+} // namespace detail
+
 template <typename SequenceType>
 double gc_content(const SequenceType& sequence) noexcept
 {
-    const auto gc_count = std::count_if(std::cbegin(sequence), std::cend(sequence),
-                                        [] (const char base) { return base == 'G' || base == 'C'; });
+    const auto gc_count = detail::count_gc(sequence, detail::is_contiguous_sequence<SequenceType> {});
     return static_cast<double>(gc_count) / sequence.size();
 }
 
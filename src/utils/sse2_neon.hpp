@@ -0,0 +1,142 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef sse2_neon_hpp
+#define sse2_neon_hpp
+
+// Provides the SSE2 intrinsics used by the 128-bit kernels. On x86 these are the real intrinsics,
+// on AArch64 they are implemented with NEON (which every AArch64 core has), so the same kernel source
+// is vectorised on both. OCTOPUS_SSE2_INTRINSICS is defined if either is available.
+//
+// Only the subset of SSE2 used by octopus is implemented. Byte shifts (_mm_slli_si128, _mm_srli_si128)
+// require a count in [1, 15], and lane indices must be constants, as for the real intrinsics.
+
+#if defined(__SSE2__)
+
+#include <emmintrin.h>
+
+#define OCTOPUS_SSE2_INTRINSICS
+
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+
+#include <cstdint>
+
+#include <arm_neon.h>
+
+#define OCTOPUS_SSE2_INTRINSICS
+
+using __m128i = int64x2_t;
+
+#define OCTOPUS_NEON_S8(a)  vreinterpretq_s8_s64(a)
+#define OCTOPUS_NEON_U8(a)  vreinterpretq_u8_s64(a)
+#define OCTOPUS_NEON_S16(a) vreinterpretq_s16_s64(a)
+#define OCTOPUS_NEON_U16(a) vreinterpretq_u16_s64(a)
+#define OCTOPUS_NEON_S32(a) vreinterpretq_s32_s64(a)
+#define OCTOPUS_NEON_U64(a) vreinterpretq_u64_s64(a)
+
+#define _mm_extract_epi16(a, imm) static_cast<int>(vgetq_lane_u16(OCTOPUS_NEON_U16(a), (imm)))
+#define _mm_insert_epi16(a, x, imm) \
+    vreinterpretq_s64_s16(vsetq_lane_s16(static_cast<std::int16_t>(x), OCTOPUS_NEON_S16(a), (imm)))
+#define _mm_slli_si128(a, imm) vreinterpretq_s64_u8(vextq_u8(vdupq_n_u8(0), OCTOPUS_NEON_U8(a), 16 - (imm)))
+#define _mm_srli_si128(a, imm) vreinterpretq_s64_u8(vextq_u8(OCTOPUS_NEON_U8(a), vdupq_n_u8(0), (imm)))
+
+inline __m128i _mm_load_si128(const __m128i* p) noexcept { return vld1q_s64(reinterpret_cast<const std::int64_t*>(p)); }
+inline __m128i _mm_loadu_si128(const __m128i* p) noexcept { return vld1q_s64(reinterpret_cast<const std::int64_t*>(p)); }
+inline void _mm_store_si128(__m128i* p, const __m128i a) noexcept { vst1q_s64(reinterpret_cast<std::int64_t*>(p), a); }
+inline void _mm_storeu_si128(__m128i* p, const __m128i a) noexcept { vst1q_s64(reinterpret_cast<std::int64_t*>(p), a); }
+
+inline __m128i _mm_set1_epi8(const char x) noexcept { return vreinterpretq_s64_s8(vdupq_n_s8(static_cast<std::int8_t>(x))); }
+inline __m128i _mm_set1_epi16(const short x) noexcept { return vreinterpretq_s64_s16(vdupq_n_s16(x)); }
+inline __m128i _mm_set1_epi32(const int x) noexcept { return vreinterpretq_s64_s32(vdupq_n_s32(x)); }
+inline __m128i _mm_set_epi16(const short e7, const short e6, const short e5, const short e4,
+                             const short e3, const short e2, const short e1, const short e0) noexcept
+{
+    const std::int16_t values[8] {e0, e1, e2, e3, e4, e5, e6, e7};
+    return vreinterpretq_s64_s16(vld1q_s16(values));
+}
+inline __m128i _mm_set_epi64x(const long long e1, const long long e0) noexcept
+{
+    return vcombine_s64(vcreate_s64(static_cast<std::uint64_t>(e0)), vcreate_s64(static_cast<std::uint64_t>(e1)));
+}
+
+inline __m128i _mm_and_si128(const __m128i a, const __m128i b) noexcept { return vandq_s64(a, b); }
+inline __m128i _mm_andnot_si128(const __m128i a, const __m128i b) noexcept { return vbicq_s64(b, a); }
+inline __m128i _mm_or_si128(const __m128i a, const __m128i b) noexcept { return vorrq_s64(a, b); }
+
+inline __m128i _mm_add_epi16(const __m128i a, const __m128i b) noexcept
+{
+    return vreinterpretq_s64_s16(vaddq_s16(OCTOPUS_NEON_S16(a), OCTOPUS_NEON_S16(b)));
+}
+inline __m128i _mm_adds_epu8(const __m128i a, const __m128i b) noexcept
+{
+    return vreinterpretq_s64_u8(vqaddq_u8(OCTOPUS_NEON_U8(a), OCTOPUS_NEON_U8(b)));
+}
+inline __m128i _mm_min_epi16(const __m128i a, const __m128i b) noexcept
+{
+    return vreinterpretq_s64_s16(vminq_s16(OCTOPUS_NEON_S16(a), OCTOPUS_NEON_S16(b)));
+}
+inline __m128i _mm_min_epu8(const __m128i a, const __m128i b) noexcept
+{
+    return vreinterpretq_s64_u8(vminq_u8(OCTOPUS_NEON_U8(a), OCTOPUS_NEON_U8(b)));
+}
+inline __m128i _mm_max_epu8(const __m128i a, const __m128i b) noexcept
+{
+    return vreinterpretq_s64_u8(vmaxq_u8(OCTOPUS_NEON_U8(a), OCTOPUS_NEON_U8(b)));
+}
+
+inline __m128i _mm_cmpeq_epi8(const __m128i a, const __m128i b) noexcept
+{
+    return vreinterpretq_s64_u8(vceqq_s8(OCTOPUS_NEON_S8(a), OCTOPUS_NEON_S8(b)));
+}
+inline __m128i _mm_cmpgt_epi8(const __m128i a, const __m128i b) noexcept
+{
+    return vreinterpretq_s64_u8(vcgtq_s8(OCTOPUS_NEON_S8(a), OCTOPUS_NEON_S8(b)));
+}
+inline __m128i _mm_cmplt_epi8(const __m128i a, const __m128i b) noexcept
+{
+    return vreinterpretq_s64_u8(vcltq_s8(OCTOPUS_NEON_S8(a), OCTOPUS_NEON_S8(b)));
+}
+inline __m128i _mm_cmpeq_epi16(const __m128i a, const __m128i b) noexcept
+{
+    return vreinterpretq_s64_u16(vceqq_s16(OCTOPUS_NEON_S16(a), OCTOPUS_NEON_S16(b)));
+}
+inline __m128i _mm_cmpeq_epi32(const __m128i a, const __m128i b) noexcept
+{
+    return vreinterpretq_s64_u32(vceqq_s32(OCTOPUS_NEON_S32(a), OCTOPUS_NEON_S32(b)));
+}
+inline __m128i _mm_cmpgt_epi32(const __m128i a, const __m128i b) noexcept
+{
+    return vreinterpretq_s64_u32(vcgtq_s32(OCTOPUS_NEON_S32(a), OCTOPUS_NEON_S32(b)));
+}
+
+// Register shifts give zero for counts of at least the lane width, as SSE2 does
+inline __m128i _mm_slli_epi16(const __m128i a, const int count) noexcept
+{
+    return vreinterpretq_s64_u16(vshlq_u16(OCTOPUS_NEON_U16(a), vdupq_n_s16(static_cast<std::int16_t>(count))));
+}
+inline __m128i _mm_srli_epi16(const __m128i a, const int count) noexcept
+{
+    return vreinterpretq_s64_u16(vshlq_u16(OCTOPUS_NEON_U16(a), vdupq_n_s16(static_cast<std::int16_t>(-count))));
+}
+inline __m128i _mm_slli_epi64(const __m128i a, const int count) noexcept
+{
+    return vreinterpretq_s64_u64(vshlq_u64(OCTOPUS_NEON_U64(a), vdupq_n_s64(count)));
+}
+inline __m128i _mm_srli_epi64(const __m128i a, const int count) noexcept
+{
+    return vreinterpretq_s64_u64(vshlq_u64(OCTOPUS_NEON_U64(a), vdupq_n_s64(-count)));
+}
+
+// Gathers the top bit of each byte by repeatedly folding adjacent lanes together
+inline int _mm_movemask_epi8(const __m128i a) noexcept
+{
+    const auto bits = vreinterpretq_u16_u8(vshrq_n_u8(OCTOPUS_NEON_U8(a), 7));
+    const auto pairs = vreinterpretq_u32_u16(vsraq_n_u16(bits, bits, 7));
+    const auto quads = vreinterpretq_u64_u32(vsraq_n_u32(pairs, pairs, 14));
+    const auto octets = vreinterpretq_u8_u64(vsraq_n_u64(quads, quads, 28));
+    return static_cast<int>(vgetq_lane_u8(octets, 0)) | (static_cast<int>(vgetq_lane_u8(octets, 8)) << 8);
+}
+
+#endif
+
+#endif
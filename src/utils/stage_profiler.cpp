@@ -0,0 +1,304 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "stage_profiler.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <algorithm>
+#include <ostream>
+#include <fstream>
+#include <ctime>
+#include <sstream>
+#include <stdexcept>
+
+namespace octopus { namespace profiling {
+
+namespace {
+
+struct StageCounters
+{
+    std::atomic<std::uint64_t> count {0}, total_ns {0}, max_ns {0};
+    std::array<std::atomic<std::uint64_t>, num_histogram_bins> histogram {};
+};
+
+// Only the owning thread writes its counters, so updates are uncontended
+struct ThreadCounters
+{
+    std::array<StageCounters, num_stages> stages;
+    std::array<std::atomic<std::uint64_t>, num_events> events {};
+};
+
+std::atomic<bool> enabled {false};
+
+std::mutex registry_mutex {};
+std::vector<std::shared_ptr<ThreadCounters>> registry {};
+
+ThreadCounters& get_thread_counters()
+{
+    static thread_local std::shared_ptr<ThreadCounters> counters {};
+    if (!counters) {
+        counters = std::make_shared<ThreadCounters>();
+        std::lock_guard<std::mutex> lock {registry_mutex};
+        registry.push_back(counters);
+    }
+    return *counters;
+}
+
+std::atomic<bool> region_tracing {false};
+
+std::mutex region_trace_mutex {};
+std::unique_ptr<std::ofstream> region_trace_file {};
+
+thread_local RegionTrace* current_region_trace {nullptr};
+
+std::chrono::nanoseconds thread_cpu_time() noexcept
+{
+    timespec ts {};
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return std::chrono::nanoseconds::zero();
+    return std::chrono::seconds {ts.tv_sec} + std::chrono::nanoseconds {ts.tv_nsec};
+}
+
+double to_ms(const std::chrono::nanoseconds duration) noexcept
+{
+    return std::chrono::duration<double, std::milli> {duration}.count();
+}
+
+std::size_t histogram_bin(const std::chrono::nanoseconds duration) noexcept
+{
+    auto micros = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+    std::size_t result {0};
+    while (micros > 1 && result + 1 < num_histogram_bins) {
+        micros >>= 1;
+        ++result;
+    }
+    return result;
+}
+
+} // namespace
+
+void enable() noexcept
+{
+    enabled.store(true, std::memory_order_relaxed);
+}
+
+bool is_enabled() noexcept
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+void record(const Stage stage, const std::chrono::nanoseconds duration)
+{
+    auto& counters = get_thread_counters().stages[static_cast<std::size_t>(stage)];
+    const auto ns = static_cast<std::uint64_t>(std::max(duration.count(), decltype(duration.count()) {0}));
+    counters.count.fetch_add(1, std::memory_order_relaxed);
+    counters.total_ns.fetch_add(ns, std::memory_order_relaxed);
+    if (ns > counters.max_ns.load(std::memory_order_relaxed)) {
+        counters.max_ns.store(ns, std::memory_order_relaxed);
+    }
+    counters.histogram[histogram_bin(duration)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void count(const Event event, const std::uint64_t n) noexcept
+{
+    if (!is_enabled()) return;
+    try {
+        get_thread_counters().events[static_cast<std::size_t>(event)].fetch_add(n, std::memory_order_relaxed);
+    } catch (...) {}
+}
+
+StageTimer::StageTimer(const Stage stage) noexcept
+: stage_ {stage}
+, is_active_ {}
+, is_enabled_ {is_enabled()}
+, start_ {}
+{
+    is_active_ = is_enabled_ || current_region_trace;
+    if (is_active_) start_ = Clock::now();
+}
+
+StageTimer::~StageTimer()
+{
+    if (is_active_) {
+        const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_);
+        if (current_region_trace) {
+            current_region_trace->stage_times_[static_cast<std::size_t>(stage_)] += duration;
+        }
+        if (is_enabled_) {
+            try {
+                record(stage_, duration);
+            } catch (...) {}
+        }
+    }
+}
+
+void open_region_trace(const boost::filesystem::path& path)
+{
+    auto file = std::make_unique<std::ofstream>(path.string());
+    if (!*file) {
+        throw std::runtime_error {"open_region_trace: could not open " + path.string()};
+    }
+    *file << "region\twall_ms\tcpu_ms\treads\tcandidates\thaplotypes\tgenotypes\tpeak_memory_bytes";
+    for (std::size_t i {0}; i < num_stages; ++i) {
+        *file << '\t' << static_cast<Stage>(i) << "_ms";
+    }
+    *file << '\n';
+    std::lock_guard<std::mutex> lock {region_trace_mutex};
+    region_trace_file = std::move(file);
+    region_tracing.store(true, std::memory_order_relaxed);
+}
+
+bool is_region_tracing() noexcept
+{
+    return region_tracing.load(std::memory_order_relaxed);
+}
+
+RegionTrace::RegionTrace(const GenomicRegion& region)
+: region_ {}
+, is_active_ {is_region_tracing()}
+, parent_ {current_region_trace}
+, wall_start_ {}
+, cpu_start_ {}
+, stage_times_ {}
+, counts_ {}
+, peak_memory_ {0}
+{
+    if (is_active_) {
+        region_ = region;
+        stage_times_.fill(std::chrono::nanoseconds::zero());
+        wall_start_ = Clock::now();
+        cpu_start_ = thread_cpu_time();
+        current_region_trace = this;
+    }
+}
+
+RegionTrace::~RegionTrace()
+{
+    if (!is_active_) return;
+    current_region_trace = parent_;
+    const auto wall_time = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - wall_start_);
+    const auto cpu_time = thread_cpu_time() - cpu_start_;
+    try {
+        std::ostringstream ss {};
+        ss << region_ << '\t' << to_ms(wall_time) << '\t' << to_ms(cpu_time);
+        for (const auto n : counts_) ss << '\t' << n;
+        ss << '\t' << peak_memory_;
+        for (const auto t : stage_times_) ss << '\t' << to_ms(t);
+        ss << '\n';
+        std::lock_guard<std::mutex> lock {region_trace_mutex};
+        if (region_trace_file) *region_trace_file << ss.str();
+    } catch (...) {}
+}
+
+void RegionTrace::set_region(const GenomicRegion& region)
+{
+    if (is_active_) region_ = region;
+}
+
+void count(const RegionTrace::Counter counter, const std::size_t n) noexcept
+{
+    if (current_region_trace) current_region_trace->counts_[static_cast<std::size_t>(counter)] += n;
+}
+
+void note_memory(const std::size_t bytes) noexcept
+{
+    if (current_region_trace) {
+        current_region_trace->peak_memory_ = std::max(current_region_trace->peak_memory_, bytes);
+    }
+}
+
+std::vector<StageSummary> summarise()
+{
+    std::vector<StageSummary> result(num_stages);
+    for (std::size_t i {0}; i < num_stages; ++i) {
+        result[i].stage = static_cast<Stage>(i);
+        result[i].count = 0;
+        result[i].total = result[i].max = std::chrono::nanoseconds::zero();
+        result[i].histogram.fill(0);
+    }
+    std::lock_guard<std::mutex> lock {registry_mutex};
+    for (const auto& counters : registry) {
+        for (std::size_t i {0}; i < num_stages; ++i) {
+            const auto& stage_counters = counters->stages[i];
+            auto& summary = result[i];
+            summary.count += stage_counters.count.load(std::memory_order_relaxed);
+            summary.total += std::chrono::nanoseconds {stage_counters.total_ns.load(std::memory_order_relaxed)};
+            summary.max = std::max(summary.max, std::chrono::nanoseconds {stage_counters.max_ns.load(std::memory_order_relaxed)});
+            for (std::size_t bin {0}; bin < num_histogram_bins; ++bin) {
+                summary.histogram[bin] += stage_counters.histogram[bin].load(std::memory_order_relaxed);
+            }
+        }
+    }
+    return result;
+}
+
+std::array<std::uint64_t, num_events> summarise_events()
+{
+    std::array<std::uint64_t, num_events> result {};
+    std::lock_guard<std::mutex> lock {registry_mutex};
+    for (const auto& counters : registry) {
+        for (std::size_t i {0}; i < num_events; ++i) {
+            result[i] += counters->events[i].load(std::memory_order_relaxed);
+        }
+    }
+    return result;
+}
+
+void write_json(std::ostream& os)
+{
+    const auto summaries = summarise();
+    os << "{\n  \"stages\": [";
+    for (std::size_t i {0}; i < summaries.size(); ++i) {
+        const auto& summary = summaries[i];
+        if (i > 0) os << ',';
+        os << "\n    {\"name\": \"" << summary.stage << "\""
+           << ", \"count\": " << summary.count
+           << ", \"total_ns\": " << summary.total.count()
+           << ", \"max_ns\": " << summary.max.count()
+           << ", \"histogram_us_log2\": [";
+        for (std::size_t bin {0}; bin < num_histogram_bins; ++bin) {
+            if (bin > 0) os << ", ";
+            os << summary.histogram[bin];
+        }
+        os << "]}";
+    }
+    os << "\n  ],\n  \"events\": {";
+    const auto events = summarise_events();
+    for (std::size_t i {0}; i < num_events; ++i) {
+        if (i > 0) os << ',';
+        os << "\n    \"" << static_cast<Event>(i) << "\": " << events[i];
+    }
+    os << "\n  }\n}\n";
+}
+
+std::ostream& operator<<(std::ostream& os, const Stage stage)
+{
+    switch (stage) {
+        case Stage::read_fetch: os << "read_fetch"; break;
+        case Stage::read_transform: os << "read_transform"; break;
+        case Stage::candidate_generation: os << "candidate_generation"; break;
+        case Stage::assembly: os << "assembly"; break;
+        case Stage::haplotype_generation: os << "haplotype_generation"; break;
+        case Stage::likelihoods: os << "likelihoods"; break;
+        case Stage::latents: os << "latents"; break;
+        case Stage::calling: os << "calling"; break;
+        case Stage::phasing: os << "phasing"; break;
+        case Stage::output: os << "output"; break;
+    }
+    return os;
+}
+
+std::ostream& operator<<(std::ostream& os, const Event event)
+{
+    switch (event) {
+        case Event::hmm_int8: os << "hmm_int8"; break;
+        case Event::hmm_int8_saturated: os << "hmm_int8_saturated"; break;
+        case Event::hmm_int16: os << "hmm_int16"; break;
+        case Event::hmm_cuda: os << "hmm_cuda"; break;
+    }
+    return os;
+}
+
+} // namespace profiling
+} // namespace octopus
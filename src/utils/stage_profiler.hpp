@@ -0,0 +1,145 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef stage_profiler_hpp
+#define stage_profiler_hpp
+
+#include <array>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <iosfwd>
+
+#include <boost/filesystem/path.hpp>
+
+#include "basics/genomic_region.hpp"
+
+namespace octopus { namespace profiling {
+
+// Stages can nest, e.g. assembly is part of candidate generation
+enum class Stage
+{
+    read_fetch,
+    read_transform,
+    candidate_generation,
+    assembly,
+    haplotype_generation,
+    likelihoods,
+    latents,
+    calling,
+    phasing,
+    output
+};
+
+constexpr std::size_t num_stages {10};
+
+// Untimed events, e.g. which pair HMM precision tier scored an alignment
+enum class Event
+{
+    hmm_int8,
+    hmm_int8_saturated,
+    hmm_int16,
+    hmm_cuda
+};
+
+constexpr std::size_t num_events {4};
+
+// Bin i counts stage durations in [2^i, 2^(i+1)) microseconds, with bin 0 also counting anything shorter
+constexpr std::size_t num_histogram_bins {32};
+
+// Profiling is off until enabled, in which case timers do not read the clock
+void enable() noexcept;
+bool is_enabled() noexcept;
+
+void record(Stage stage, std::chrono::nanoseconds duration);
+
+// Adds n to the event counter of this thread. Does nothing unless profiling is enabled.
+void count(Event event, std::uint64_t n) noexcept;
+
+// Times the enclosing scope. Counters are thread local so timers can be used from any thread.
+class StageTimer
+{
+public:
+    explicit StageTimer(Stage stage) noexcept;
+
+    StageTimer(const StageTimer&)            = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+    StageTimer(StageTimer&&)                 = delete;
+    StageTimer& operator=(StageTimer&&)      = delete;
+
+    ~StageTimer();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    Stage stage_;
+    bool is_active_, is_enabled_;
+    Clock::time_point start_;
+};
+
+// Writes one line per traced region to path, replacing any existing file
+void open_region_trace(const boost::filesystem::path& path);
+bool is_region_tracing() noexcept;
+
+// Records the stage times, counts and memory estimate of work done by this thread while in scope,
+// and writes them to the region trace on destruction. Does nothing unless region tracing is open.
+class RegionTrace
+{
+public:
+    enum class Counter { reads, candidates, haplotypes, genotypes };
+
+    explicit RegionTrace(const GenomicRegion& region);
+
+    RegionTrace(const RegionTrace&)            = delete;
+    RegionTrace& operator=(const RegionTrace&) = delete;
+    RegionTrace(RegionTrace&&)                 = delete;
+    RegionTrace& operator=(RegionTrace&&)      = delete;
+
+    ~RegionTrace();
+
+    void set_region(const GenomicRegion& region);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    GenomicRegion region_;
+    bool is_active_;
+    RegionTrace* parent_;
+    Clock::time_point wall_start_;
+    std::chrono::nanoseconds cpu_start_;
+    std::array<std::chrono::nanoseconds, num_stages> stage_times_;
+    std::array<std::size_t, 4> counts_;
+    std::size_t peak_memory_;
+
+    friend class StageTimer;
+    friend void count(Counter, std::size_t) noexcept;
+    friend void note_memory(std::size_t) noexcept;
+};
+
+// Adds to the counters of this thread's active region trace, if any
+void count(RegionTrace::Counter counter, std::size_t n) noexcept;
+// Raises the peak memory estimate of this thread's active region trace, if any
+void note_memory(std::size_t bytes) noexcept;
+
+struct StageSummary
+{
+    Stage stage;
+    std::uint64_t count;
+    std::chrono::nanoseconds total, max;
+    std::array<std::uint64_t, num_histogram_bins> histogram;
+};
+
+// Aggregates the counters of every thread that has recorded a stage
+std::vector<StageSummary> summarise();
+std::array<std::uint64_t, num_events> summarise_events();
+
+void write_json(std::ostream& os);
+
+std::ostream& operator<<(std::ostream& os, Stage stage);
+std::ostream& operator<<(std::ostream& os, Event event);
+
+} // namespace profiling
+} // namespace octopus
+
+#endif
@@ -3,7 +3,19 @@
 
 #include "system_utils.hpp"
 
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+
 #include <sys/resource.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 namespace octopus {
 
@@ -14,4 +26,98 @@ std::size_t get_max_open_files()
     return lim.rlim_cur;
 }
 
+namespace {
+
+// Parses Linux cpulist format, e.g. "0-3,8-11"
+std::vector<unsigned> parse_cpu_list(const std::string& cpu_list)
+{
+    std::vector<unsigned> result {};
+    std::istringstream ss {cpu_list};
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty() || range == "\n") continue;
+        const auto dash_pos = range.find('-');
+        try {
+            const auto first = static_cast<unsigned>(std::stoul(range.substr(0, dash_pos)));
+            const auto last = dash_pos == std::string::npos ? first : static_cast<unsigned>(std::stoul(range.substr(dash_pos + 1)));
+            for (auto cpu = first; cpu <= last; ++cpu) result.push_back(cpu);
+        } catch (const std::logic_error&) {
+            return {};
+        }
+    }
+    return result;
+}
+
+std::vector<unsigned> get_all_cpus()
+{
+    std::vector<unsigned> result(std::max(std::thread::hardware_concurrency(), 1u));
+    for (unsigned cpu {0}; cpu < result.size(); ++cpu) result[cpu] = cpu;
+    return result;
+}
+
+} // namespace
+
+std::vector<std::vector<unsigned>> get_numa_node_cpus()
+{
+    std::vector<std::vector<unsigned>> result {};
+    for (unsigned node {0};; ++node) {
+        std::ifstream cpu_list_file {"/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"};
+        if (!cpu_list_file) break;
+        std::string cpu_list;
+        std::getline(cpu_list_file, cpu_list);
+        auto cpus = parse_cpu_list(cpu_list);
+        if (!cpus.empty()) result.push_back(std::move(cpus));
+    }
+    if (result.empty()) result.push_back(get_all_cpus());
+    return result;
+}
+
+std::vector<unsigned> assign_thread_cpus(const std::size_t num_threads)
+{
+    const auto nodes = get_numa_node_cpus();
+    std::vector<unsigned> result {};
+    result.reserve(num_threads);
+    for (std::size_t node {0}; node < nodes.size(); ++node) {
+        const auto node_begin = node * num_threads / nodes.size(), node_end = (node + 1) * num_threads / nodes.size();
+        const auto& cpus = nodes[node];
+        for (auto i = node_begin; i < node_end; ++i) {
+            result.push_back(cpus[(i - node_begin) % cpus.size()]);
+        }
+    }
+    return result;
+}
+
+bool pin_thread(std::thread& thread, const unsigned cpu)
+{
+#ifdef __linux__
+    if (cpu >= CPU_SETSIZE) return false;
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+    return pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &cpu_set) == 0;
+#else
+    return false;
+#endif
+}
+
+std::size_t get_resident_memory()
+{
+    std::ifstream statm {"/proc/self/statm"};
+    std::size_t total_pages {0}, resident_pages {0};
+    if (!(statm >> total_pages >> resident_pages)) return 0;
+    const auto page_size = sysconf(_SC_PAGESIZE);
+    return page_size > 0 ? resident_pages * static_cast<std::size_t>(page_size) : 0;
+}
+
+std::size_t get_peak_resident_memory()
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return static_cast<std::size_t>(usage.ru_maxrss); // bytes
+#else
+    return static_cast<std::size_t>(usage.ru_maxrss) * 1024; // kilobytes
+#endif
+}
+
 } // namespace octopus
@@ -5,11 +5,28 @@
 #define system_utils_hpp
 
 #include <cstddef>
+#include <vector>
+#include <thread>
 
 namespace octopus {
 
 std::size_t get_max_open_files();
 
+// The CPUs of each NUMA node. If the topology is unknown then all CPUs are assumed to be on one node.
+std::vector<std::vector<unsigned>> get_numa_node_cpus();
+
+// Assigns a CPU to each of num_threads threads. Threads are spread evenly over the NUMA nodes, and threads
+// with adjacent indices are placed on the same node where possible.
+std::vector<unsigned> assign_thread_cpus(std::size_t num_threads);
+
+// Returns false if the thread could not be pinned, e.g. if the platform does not support it
+bool pin_thread(std::thread& thread, unsigned cpu);
+
+// Resident set size of this process, or zero if it cannot be determined
+std::size_t get_resident_memory();
+// Largest resident set size of this process so far, or zero if it cannot be determined
+std::size_t get_peak_resident_memory();
+
 } // namespace octopus
 
 #endif
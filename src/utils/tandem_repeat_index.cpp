@@ -0,0 +1,201 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "tandem_repeat_index.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <fstream>
+#include <cstring>
+#include <stdexcept>
+
+#include <boost/filesystem/operations.hpp>
+
+#include "io/reference/reference_genome.hpp"
+#include "utils/repeat_finder.hpp"
+
+namespace octopus {
+
+namespace {
+
+// Layout: magic, max_period (u32), num_contigs (u32), then for each contig its name length (u32), name,
+// max record length (u32) and number of records (u64), then padding to a 4 byte boundary, and finally
+// every contig's records in directory order, each sorted by begin then length.
+constexpr char magic[8] = {'O', 'C', 'T', 'T', 'R', 'I', '1', '\0'};
+
+template <typename T>
+T read_value(const char*& data, const char* last, const std::string& path)
+{
+    if (static_cast<std::size_t>(last - data) < sizeof(T)) {
+        throw std::runtime_error {"TandemRepeatIndex: " + path + " is truncated"};
+    }
+    T result;
+    std::memcpy(&result, data, sizeof(T));
+    data += sizeof(T);
+    return result;
+}
+
+template <typename T>
+void write_value(std::ofstream& out, const T& value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+} // namespace
+
+TandemRepeatIndex::TandemRepeatIndex(const Path& index_path)
+: path_ {index_path}
+, file_ {index_path.string()}
+, max_period_ {}
+, contigs_ {}
+{
+    const auto first = file_.data();
+    const auto last = first + file_.size();
+    auto data = first;
+    if (file_.size() < sizeof(magic) || std::memcmp(data, magic, sizeof(magic)) != 0) {
+        throw std::runtime_error {"TandemRepeatIndex: " + path_.string() + " is not a tandem repeat index"};
+    }
+    data += sizeof(magic);
+    max_period_ = read_value<std::uint32_t>(data, last, path_.string());
+    const auto num_contigs = read_value<std::uint32_t>(data, last, path_.string());
+    std::vector<std::pair<GenomicRegion::ContigName, ContigRecords>> directory {};
+    directory.reserve(num_contigs);
+    std::size_t num_records {0};
+    for (std::uint32_t i {0}; i < num_contigs; ++i) {
+        const auto name_length = read_value<std::uint32_t>(data, last, path_.string());
+        if (static_cast<std::size_t>(last - data) < name_length) {
+            throw std::runtime_error {"TandemRepeatIndex: " + path_.string() + " is truncated"};
+        }
+        GenomicRegion::ContigName contig {data, data + name_length};
+        data += name_length;
+        const auto max_length = read_value<std::uint32_t>(data, last, path_.string());
+        const auto size = static_cast<std::size_t>(read_value<std::uint64_t>(data, last, path_.string()));
+        directory.push_back({std::move(contig), ContigRecords {nullptr, size, max_length}});
+        num_records += size;
+    }
+    data += (alignof(Record) - (data - first) % alignof(Record)) % alignof(Record);
+    if (data > last || static_cast<std::size_t>(last - data) < num_records * sizeof(Record)) {
+        throw std::runtime_error {"TandemRepeatIndex: " + path_.string() + " is truncated"};
+    }
+    // The mapping is page aligned, so records at an aligned offset can be read in place
+    auto records = reinterpret_cast<const Record*>(data);
+    contigs_.reserve(directory.size());
+    for (auto& p : directory) {
+        p.second.first = records;
+        records += p.second.size;
+        contigs_.emplace(std::move(p.first), p.second);
+    }
+}
+
+const TandemRepeatIndex::Path& TandemRepeatIndex::path() const noexcept
+{
+    return path_;
+}
+
+unsigned TandemRepeatIndex::max_period() const noexcept
+{
+    return max_period_;
+}
+
+bool TandemRepeatIndex::has_contig(const GenomicRegion::ContigName& contig) const noexcept
+{
+    return contigs_.count(contig) == 1;
+}
+
+std::vector<TandemRepeat>
+TandemRepeatIndex::fetch(const ReferenceGenome& reference, const GenomicRegion& region, const unsigned max_period) const
+{
+    if (max_period > max_period_) {
+        throw std::invalid_argument {"TandemRepeatIndex: requested period exceeds the indexed maximum"};
+    }
+    const auto contig_itr = contigs_.find(region.contig_name());
+    if (contig_itr == std::cend(contigs_)) return {};
+    const auto& contig = contig_itr->second;
+    const auto records_begin = contig.first, records_end = contig.first + contig.size;
+    // No record beginning before this can reach the region
+    const auto min_begin = region.begin() > contig.max_length ? region.begin() - contig.max_length : 0;
+    auto itr = std::lower_bound(records_begin, records_end, min_begin,
+                                [] (const Record& record, const GenomicRegion::Position pos) { return record.begin < pos; });
+    std::vector<TandemRepeat> result {};
+    std::string sequence {};
+    for (; itr != records_end && itr->begin < region.end(); ++itr) {
+        if (itr->period > max_period) continue;
+        const auto begin = std::max<GenomicRegion::Position>(itr->begin, region.begin());
+        const auto end = std::min<GenomicRegion::Position>(itr->begin + itr->length, region.end());
+        if (end <= begin || end - begin < 2 * itr->period) continue;
+        if (sequence.empty()) sequence = reference.fetch_sequence(region);
+        const auto motif_begin = std::next(std::cbegin(sequence), begin - region.begin());
+        result.emplace_back(GenomicRegion {region.contig_name(), begin, end},
+                            TandemRepeat::NucleotideSequence {motif_begin, std::next(motif_begin, itr->period)});
+    }
+    // Clipping can reorder repeats which begin before the region
+    std::sort(std::begin(result), std::end(result));
+    return result;
+}
+
+void build_tandem_repeat_index(const ReferenceGenome& reference, const TandemRepeatIndex::Path& index_path,
+                               const unsigned max_period, const GenomicRegion::Size block_size)
+{
+    using Record = TandemRepeatIndex::Record;
+    static constexpr GenomicRegion::Size block_overlap {10'000};
+    if (block_size == 0) {
+        throw std::invalid_argument {"build_tandem_repeat_index: block_size must be positive"};
+    }
+    const auto contigs = reference.contig_names();
+    std::vector<std::vector<Record>> contig_records(contigs.size());
+    std::vector<std::uint32_t> max_lengths(contigs.size(), 0);
+    for (std::size_t c {0}; c < contigs.size(); ++c) {
+        const auto contig_size = reference.contig_size(contigs[c]);
+        auto& records = contig_records[c];
+        for (GenomicRegion::Position block_begin {0}, block_end; block_begin < contig_size; block_begin = block_end) {
+            block_end = block_begin + std::min(block_size, contig_size - block_begin);
+            const GenomicRegion padded_block {contigs[c], block_begin > block_overlap ? block_begin - block_overlap : 0,
+                                              std::min(block_end + block_overlap, contig_size)};
+            auto sequence = reference.fetch_sequence(padded_block);
+            for (const auto& repeat : find_exact_tandem_repeats(sequence, padded_block, 1, max_period)) {
+                const auto& repeat_region = mapped_region(repeat);
+                // Each repeat is kept by the block its begin falls in, so none are written twice
+                if (repeat_region.begin() >= block_begin && repeat_region.begin() < block_end) {
+                    records.push_back({static_cast<std::uint32_t>(repeat_region.begin()),
+                                       static_cast<std::uint32_t>(region_size(repeat)),
+                                       static_cast<std::uint32_t>(repeat.period())});
+                    max_lengths[c] = std::max(max_lengths[c], records.back().length);
+                }
+            }
+        }
+        std::sort(std::begin(records), std::end(records), [] (const Record& lhs, const Record& rhs) {
+            return lhs.begin < rhs.begin || (lhs.begin == rhs.begin && lhs.length < rhs.length);
+        });
+    }
+    // Write to a temporary so an interrupted build never leaves a partial index in place
+    auto tmp_path = index_path;
+    tmp_path += ".tmp";
+    {
+        std::ofstream out {tmp_path.string(), std::ios::binary | std::ios::trunc};
+        if (!out) {
+            throw std::runtime_error {"build_tandem_repeat_index: could not open " + tmp_path.string()};
+        }
+        out.write(magic, sizeof(magic));
+        write_value(out, static_cast<std::uint32_t>(max_period));
+        write_value(out, static_cast<std::uint32_t>(contigs.size()));
+        std::size_t offset {sizeof(magic) + 2 * sizeof(std::uint32_t)};
+        for (std::size_t c {0}; c < contigs.size(); ++c) {
+            write_value(out, static_cast<std::uint32_t>(contigs[c].size()));
+            out.write(contigs[c].data(), contigs[c].size());
+            write_value(out, max_lengths[c]);
+            write_value(out, static_cast<std::uint64_t>(contig_records[c].size()));
+            offset += 2 * sizeof(std::uint32_t) + contigs[c].size() + sizeof(std::uint64_t);
+        }
+        const char padding[alignof(Record)] = {};
+        out.write(padding, (alignof(Record) - offset % alignof(Record)) % alignof(Record));
+        for (const auto& records : contig_records) {
+            out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(Record));
+        }
+        if (!out) {
+            throw std::runtime_error {"build_tandem_repeat_index: could not write " + tmp_path.string()};
+        }
+    }
+    boost::filesystem::rename(tmp_path, index_path);
+}
+
+} // namespace octopus
@@ -0,0 +1,83 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef tandem_repeat_index_hpp
+#define tandem_repeat_index_hpp
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include "basics/genomic_region.hpp"
+#include "basics/tandem_repeat.hpp"
+
+namespace octopus {
+
+class ReferenceGenome;
+
+/*
+ TandemRepeatIndex is a read-only, memory mapped table of the exact tandem repeats in a reference
+ genome, as found by find_exact_tandem_repeats. The index is built once with build_tandem_repeat_index
+ and then loaded by any number of threads or processes, which share the mapping through the page cache.
+
+ Lookups return the repeats overlapping a region clipped to that region, with repeats of fewer than two
+ periods after clipping removed, which is what scanning the region's sequence directly would find.
+ */
+class TandemRepeatIndex
+{
+public:
+    using Path = boost::filesystem::path;
+
+    TandemRepeatIndex() = delete;
+
+    TandemRepeatIndex(const Path& index_path);
+
+    TandemRepeatIndex(const TandemRepeatIndex&)            = default;
+    TandemRepeatIndex& operator=(const TandemRepeatIndex&) = default;
+    TandemRepeatIndex(TandemRepeatIndex&&)                 = default;
+    TandemRepeatIndex& operator=(TandemRepeatIndex&&)      = default;
+
+    ~TandemRepeatIndex() = default;
+
+    const Path& path() const noexcept;
+    unsigned max_period() const noexcept;
+    bool has_contig(const GenomicRegion::ContigName& contig) const noexcept;
+
+    // Only repeats with period <= max_period are returned, which must not exceed max_period()
+    std::vector<TandemRepeat> fetch(const ReferenceGenome& reference, const GenomicRegion& region,
+                                    unsigned max_period) const;
+
+private:
+    struct Record
+    {
+        std::uint32_t begin, length, period;
+    };
+
+    struct ContigRecords
+    {
+        const Record* first;
+        std::size_t size;
+        std::uint32_t max_length;
+    };
+
+    Path path_;
+    boost::iostreams::mapped_file_source file_;
+    unsigned max_period_;
+    std::unordered_map<GenomicRegion::ContigName, ContigRecords> contigs_;
+
+    friend void build_tandem_repeat_index(const ReferenceGenome&, const Path&, unsigned, GenomicRegion::Size);
+};
+
+// Scans the whole reference for exact tandem repeats with period <= max_period and writes them to index_path.
+// Contigs are scanned in blocks of block_size, and runs longer than the overlap between blocks may be truncated.
+void build_tandem_repeat_index(const ReferenceGenome& reference, const TandemRepeatIndex::Path& index_path,
+                               unsigned max_period = 6, GenomicRegion::Size block_size = 1'000'000);
+
+} // namespace octopus
+
+#endif
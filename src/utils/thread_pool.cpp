@@ -3,31 +3,44 @@
 
 #include "thread_pool.hpp"
 
+#include <iterator>
+
+#include "system_utils.hpp"
+
 namespace octopus {
 
+namespace {
+
+// Identifies the pool and queue of the current thread if it is a worker
+thread_local const ThreadPool* current_pool {nullptr};
+thread_local std::size_t current_worker {0};
+
+} // namespace
+
 ThreadPool::ThreadPool() : ThreadPool {0} {}
 
 ThreadPool::ThreadPool(const std::size_t n_threads)
 : stop_ {false}
 , n_idle_ {n_threads}
+, n_pending_ {0}
+, n_urgent_ {0}
 {
+    worker_tasks_.reserve(n_threads);
+    for (std::size_t i {0}; i < n_threads; ++i) {
+        worker_tasks_.push_back(std::make_unique<WorkerQueue>());
+    }
     workers_.reserve(n_threads);
     for (std::size_t i {0}; i < n_threads; ++i) {
-        workers_.emplace_back([this] {
-            std::function<void()> task;
-            while (true) {
-                std::unique_lock<std::mutex> lk {mutex_};
-                cv_.wait(lk, [this] () { return stop_ || !tasks_.empty(); });
-                if (stop_ && tasks_.empty()) return;
-                task = std::move(tasks_.front());
-                tasks_.pop();
-                --n_idle_;
-                lk.unlock();
-                task();
-                lk.lock();
-                ++n_idle_;
-            }
-        });
+        workers_.emplace_back([this, i] { run(i); });
+    }
+}
+
+ThreadPool::ThreadPool(const std::size_t n_threads, const std::vector<unsigned>& cpus)
+: ThreadPool {n_threads}
+{
+    if (cpus.empty()) return;
+    for (std::size_t i {0}; i < workers_.size(); ++i) {
+        pin_thread(workers_[i], cpus[i % cpus.size()]);
     }
 }
 
@@ -61,7 +74,139 @@ std::size_t ThreadPool::n_idle() const noexcept
 void ThreadPool::clear() noexcept
 {
     std::lock_guard<std::mutex> lk {mutex_};
-    while (!tasks_.empty()) tasks_.pop();
+    n_pending_ -= tasks_.size() + urgent_tasks_.size();
+    n_urgent_ = 0;
+    tasks_.clear();
+    urgent_tasks_.clear();
+    for (auto& queue : worker_tasks_) {
+        std::lock_guard<std::mutex> queue_lk {queue->mutex};
+        n_pending_ -= queue->tasks.size();
+        queue->tasks.clear();
+    }
+}
+
+// private methods
+
+// Requires mutex_
+void ThreadPool::push_locked(Task task, const Priority priority)
+{
+    if (priority == Priority::high) {
+        urgent_tasks_.push_back(std::move(task));
+        ++n_urgent_;
+    } else if (current_pool == this) {
+        auto& queue = *worker_tasks_[current_worker];
+        std::lock_guard<std::mutex> queue_lk {queue.mutex};
+        queue.tasks.push_back(std::move(task));
+    } else {
+        tasks_.push_back(std::move(task));
+    }
+    ++n_pending_;
+}
+
+void ThreadPool::enqueue(Task task, const Priority priority)
+{
+    {
+        std::lock_guard<std::mutex> lk {mutex_};
+        if (stop_) throw std::runtime_error {"ThreadPool: calling push on stopped pool"};
+        push_locked(std::move(task), priority);
+    }
+    cv_.notify_one();
+}
+
+void ThreadPool::enqueue(std::vector<Task> tasks, const Priority priority)
+{
+    {
+        std::lock_guard<std::mutex> lk {mutex_};
+        if (stop_) throw std::runtime_error {"ThreadPool: calling push on stopped pool"};
+        for (auto& task : tasks) push_locked(std::move(task), priority);
+    }
+    if (tasks.size() == 1) {
+        cv_.notify_one();
+    } else {
+        cv_.notify_all();
+    }
+}
+
+bool ThreadPool::try_pop_urgent(Task& task)
+{
+    if (n_urgent_ == 0) return false;
+    std::lock_guard<std::mutex> lk {mutex_};
+    if (urgent_tasks_.empty()) return false;
+    task = std::move(urgent_tasks_.front());
+    urgent_tasks_.pop_front();
+    --n_urgent_;
+    --n_pending_;
+    return true;
+}
+
+bool ThreadPool::try_pop(const std::size_t worker, Task& task)
+{
+    if (try_pop_urgent(task)) return true;
+    {
+        // Newest first, as its data is most likely to still be in cache
+        auto& queue = *worker_tasks_[worker];
+        std::lock_guard<std::mutex> queue_lk {queue.mutex};
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            --n_pending_;
+            return true;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lk {mutex_};
+        if (!tasks_.empty()) {
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+            --n_pending_;
+            return true;
+        }
+    }
+    return try_steal(worker, task);
+}
+
+bool ThreadPool::try_steal(const std::size_t worker, Task& task)
+{
+    for (std::size_t i {1}; i < worker_tasks_.size(); ++i) {
+        auto& victim = *worker_tasks_[(worker + i) % worker_tasks_.size()];
+        std::unique_lock<std::mutex> victim_lk {victim.mutex};
+        if (victim.tasks.empty()) continue;
+        const auto num_stolen = (victim.tasks.size() + 1) / 2;
+        const auto stolen_end = std::next(std::begin(victim.tasks), num_stolen);
+        std::deque<Task> stolen {std::make_move_iterator(std::begin(victim.tasks)), std::make_move_iterator(stolen_end)};
+        victim.tasks.erase(std::begin(victim.tasks), stolen_end);
+        --n_pending_;
+        victim_lk.unlock();
+        task = std::move(stolen.front());
+        stolen.pop_front();
+        if (!stolen.empty()) {
+            auto& queue = *worker_tasks_[worker];
+            std::lock_guard<std::mutex> queue_lk {queue.mutex};
+            queue.tasks.insert(std::begin(queue.tasks), std::make_move_iterator(std::begin(stolen)),
+                               std::make_move_iterator(std::end(stolen)));
+        }
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::run(const std::size_t worker)
+{
+    current_pool = this;
+    current_worker = worker;
+    Task task;
+    while (true) {
+        if (try_pop(worker, task)) {
+            --n_idle_;
+            task();
+            task.reset();
+            ++n_idle_;
+        } else {
+            std::unique_lock<std::mutex> lk {mutex_};
+            cv_.wait(lk, [this] () { return stop_ || n_pending_ > 0; });
+            if (stop_ && n_pending_ == 0) return;
+        }
+    }
 }
 
 } // namespace octopus
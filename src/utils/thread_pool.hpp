@@ -7,8 +7,9 @@
 #define thread_pool_hpp
 
 #include <cstddef>
+#include <new>
 #include <vector>
-#include <queue>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <thread>
@@ -19,14 +20,25 @@
 #include <type_traits>
 #include <utility>
 #include <exception>
+#include <algorithm>
 
 namespace octopus {
 
+// Each worker has its own task queue. Tasks pushed by a worker (i.e. nested tasks) go to its own
+// queue and are run newest first, while other tasks go to a shared queue. Workers with nothing to do
+// steal the oldest half of another worker's queue, so nested work is shared without oversubscribing.
+// Workers steal from the workers with the nearest indices first, so if workers are pinned to CPUs with
+// adjacent workers on the same NUMA node then stolen work tends to stay on the node. High priority tasks
+// go to a separate shared queue that every worker checks before its own.
 class ThreadPool
 {
 public:
+    enum class Priority { normal, high };
+    
     ThreadPool();
     explicit ThreadPool(std::size_t n_threads);
+    // Worker i is pinned to cpus[i % cpus.size()]
+    ThreadPool(std::size_t n_threads, const std::vector<unsigned>& cpus);
     
     ThreadPool(const ThreadPool&)             = delete;
     ThreadPool& operator=(const ThreadPool&)  = delete;
@@ -43,32 +55,232 @@ public:
     
     template <typename F, typename... Args>
     auto push(F&& f, Args&&... args) -> std::future<std::result_of_t<F(Args...)>>;
+    template <typename F, typename... Args>
+    auto push(Priority priority, F&& f, Args&&... args) -> std::future<std::result_of_t<F(Args...)>>;
+    
+    // Pushes f(i) for each i in [0, n) with a single lock and wake up. f is shared by the tasks.
+    template <typename F>
+    auto push_n(std::size_t n, F f, Priority priority = Priority::normal)
+    -> std::vector<std::future<std::result_of_t<F(std::size_t)>>>;
     
 private:
-    std::mutex mutex_;
+    // Move only type erased callable. Small callables (e.g. a packaged_task) are stored inline, so most
+    // tasks need no allocation beyond their shared state.
+    class Task
+    {
+    public:
+        Task() noexcept = default;
+        template <typename F, typename = std::enable_if_t<!std::is_same<std::decay_t<F>, Task>::value>,
+                  typename = decltype(std::declval<std::decay_t<F>&>()())>
+        Task(F&& f);
+        
+        Task(const Task&)            = delete;
+        Task& operator=(const Task&) = delete;
+        Task(Task&& other) noexcept;
+        Task& operator=(Task&& other) noexcept;
+        
+        ~Task() noexcept { reset(); }
+        
+        void operator()() { ops_->invoke(&storage_); }
+        void reset() noexcept;
+        
+    private:
+        static constexpr std::size_t inlineSize {48};
+        
+        struct Ops
+        {
+            void (*invoke)(void*);
+            void (*move)(void* src, void* dst) noexcept;
+            void (*destroy)(void*) noexcept;
+        };
+        
+        template <typename F> struct InlineOps;
+        template <typename F> struct HeapOps;
+        
+        std::aligned_storage_t<inlineSize, alignof(std::max_align_t)> storage_;
+        const Ops* ops_ = nullptr;
+    };
+    
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+    
+    std::mutex mutex_; // guards tasks_, urgent_tasks_, and n_pending_ updates that may wake workers
     std::condition_variable cv_;
     std::atomic<bool> stop_;
-    std::atomic<std::size_t> n_idle_;
+    std::atomic<std::size_t> n_idle_, n_pending_, n_urgent_;
     
     std::vector<std::thread> workers_;
-    std::queue<std::function<void()>> tasks_;
+    std::deque<Task> tasks_, urgent_tasks_;
+    std::vector<std::unique_ptr<WorkerQueue>> worker_tasks_;
+    
+    void enqueue(Task task, Priority priority);
+    void enqueue(std::vector<Task> tasks, Priority priority);
+    void push_locked(Task task, Priority priority);
+    bool try_pop_urgent(Task& task);
+    bool try_pop(std::size_t worker, Task& task);
+    bool try_steal(std::size_t worker, Task& task);
+    void run(std::size_t worker);
 };
 
+template <typename F>
+struct ThreadPool::Task::InlineOps
+{
+    static void invoke(void* p) { (*static_cast<F*>(p))(); }
+    static void move(void* src, void* dst) noexcept
+    {
+        ::new (dst) F {std::move(*static_cast<F*>(src))};
+        static_cast<F*>(src)->~F();
+    }
+    static void destroy(void* p) noexcept { static_cast<F*>(p)->~F(); }
+    static const Ops* get() noexcept
+    {
+        static const Ops result {invoke, move, destroy};
+        return &result;
+    }
+};
+
+template <typename F>
+struct ThreadPool::Task::HeapOps
+{
+    static F*& target(void* p) noexcept { return *static_cast<F**>(p); }
+    static void invoke(void* p) { (*target(p))(); }
+    static void move(void* src, void* dst) noexcept { ::new (dst) F* {target(src)}; }
+    static void destroy(void* p) noexcept { delete target(p); }
+    static const Ops* get() noexcept
+    {
+        static const Ops result {invoke, move, destroy};
+        return &result;
+    }
+};
+
+template <typename F, typename, typename>
+ThreadPool::Task::Task(F&& f)
+{
+    using Target = std::decay_t<F>;
+    if (sizeof(Target) <= inlineSize && alignof(Target) <= alignof(std::max_align_t)
+        && std::is_nothrow_move_constructible<Target>::value) {
+        ::new (&storage_) Target {std::forward<F>(f)};
+        ops_ = InlineOps<Target>::get();
+    } else {
+        ::new (&storage_) Target* {new Target {std::forward<F>(f)}};
+        ops_ = HeapOps<Target>::get();
+    }
+}
+
+inline ThreadPool::Task::Task(Task&& other) noexcept : ops_ {other.ops_}
+{
+    if (ops_) {
+        ops_->move(&other.storage_, &storage_);
+        other.ops_ = nullptr;
+    }
+}
+
+inline ThreadPool::Task& ThreadPool::Task::operator=(Task&& other) noexcept
+{
+    if (this != &other) {
+        reset();
+        if (other.ops_) {
+            other.ops_->move(&other.storage_, &storage_);
+            ops_ = other.ops_;
+            other.ops_ = nullptr;
+        }
+    }
+    return *this;
+}
+
+inline void ThreadPool::Task::reset() noexcept
+{
+    if (ops_) {
+        ops_->destroy(&storage_);
+        ops_ = nullptr;
+    }
+}
+
 template <typename F, typename... Args>
 auto ThreadPool::push(F&& f, Args&&... args) -> std::future<std::result_of_t<F(Args...)>>
+{
+    return push(Priority::normal, std::forward<F>(f), std::forward<Args>(args)...);
+}
+
+template <typename F, typename... Args>
+auto ThreadPool::push(const Priority priority, F&& f, Args&&... args) -> std::future<std::result_of_t<F(Args...)>>
 {
     using f_result_type = std::result_of_t<F(Args...)>;
-    auto task = std::make_shared<std::packaged_task<f_result_type()>>(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
-    auto result = task->get_future();
-    {
-        std::lock_guard<std::mutex> lk {mutex_};
-        if (stop_) throw std::runtime_error {"ThreadPool: calling push on stopped pool"};
-        tasks_.emplace([task] () { (*task)(); });
+    std::packaged_task<f_result_type()> task {std::bind(std::forward<F>(f), std::forward<Args>(args)...)};
+    auto result = task.get_future();
+    enqueue([task = std::move(task)] () mutable { task(); }, priority);
+    return result;
+}
+
+template <typename F>
+auto ThreadPool::push_n(const std::size_t n, F f, const Priority priority)
+-> std::vector<std::future<std::result_of_t<F(std::size_t)>>>
+{
+    using f_result_type = std::result_of_t<F(std::size_t)>;
+    std::vector<std::future<f_result_type>> result {};
+    if (n == 0) return result;
+    result.reserve(n);
+    std::vector<Task> tasks {};
+    tasks.reserve(n);
+    const auto shared_f = std::make_shared<const F>(std::move(f));
+    for (std::size_t i {0}; i < n; ++i) {
+        std::packaged_task<f_result_type()> task {[shared_f, i] () { return (*shared_f)(i); }};
+        result.push_back(task.get_future());
+        tasks.emplace_back([task = std::move(task)] () mutable { task(); });
     }
-    cv_.notify_one();
+    enqueue(std::move(tasks), priority);
     return result;
 }
 
+// Calls f(i) for each i in [0, n), sharing blocks of indices with any idle workers. The calling thread
+// always takes part, so this never waits on tasks still queued behind other work. Each index is
+// processed by exactly one thread, so results do not depend on the number of workers.
+template <typename F>
+void parallel_for(ThreadPool* workers, const std::size_t n, F f)
+{
+    const auto num_helpers = workers && n > 1 ? std::min(workers->n_idle(), n - 1) : std::size_t {0};
+    if (num_helpers == 0) {
+        for (std::size_t i {0}; i < n; ++i) f(i);
+        return;
+    }
+    struct State
+    {
+        std::atomic<std::size_t> next {0};
+        std::size_t num_done {0};
+        std::mutex mutex;
+        std::condition_variable done_cv;
+        std::exception_ptr error;
+    };
+    auto state = std::make_shared<State>();
+    const auto block_size = std::max(n / (4 * (num_helpers + 1)), std::size_t {1});
+    const auto work = [state, block_size, n, &f] () {
+        for (auto block_begin = state->next.fetch_add(block_size); block_begin < n;
+             block_begin = state->next.fetch_add(block_size)) {
+            const auto block_end = std::min(block_begin + block_size, n);
+            try {
+                for (auto i = block_begin; i < block_end; ++i) f(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock {state->mutex};
+                if (!state->error) state->error = std::current_exception();
+            }
+            {
+                std::lock_guard<std::mutex> lock {state->mutex};
+                state->num_done += block_end - block_begin;
+            }
+            state->done_cv.notify_all();
+        }
+    };
+    // The calling thread is blocked until the helpers finish, so they jump ahead of queued work
+    workers->push_n(num_helpers, [work] (std::size_t) { work(); }, ThreadPool::Priority::high);
+    work();
+    std::unique_lock<std::mutex> lock {state->mutex};
+    state->done_cv.wait(lock, [&] () { return state->num_done == n; });
+    if (state->error) std::rethrow_exception(state->error);
+}
+
 } // namespace octopus
 
 #endif
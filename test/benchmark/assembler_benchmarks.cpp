@@ -0,0 +1,104 @@
+// Copyright (c) 2017 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstddef>
+
+#include "core/tools/vargen/utils/assembler.hpp"
+#include "utils/kmer_mapper.hpp"
+
+#include "benchmark_utils.hpp"
+
+namespace octopus { namespace test {
+
+using coretools::Assembler;
+
+namespace {
+
+constexpr std::size_t read_length {150};
+
+// Reads tile the reference, with every other read carrying a SNV every 100bp so the graph has bubbles
+std::deque<std::string> make_reads(const std::string& reference, const std::size_t stride)
+{
+    const auto alt_reference = mutate(reference, 100);
+    std::deque<std::string> result {};
+    for (std::size_t pos {0}; pos + read_length <= reference.size(); pos += stride) {
+        const auto& source = result.size() % 2 == 0 ? reference : alt_reference;
+        result.push_back(source.substr(pos, read_length));
+    }
+    return result;
+}
+
+void BM_assembler_insert_reads(::benchmark::State& state)
+{
+    const unsigned kmer_size {static_cast<unsigned>(state.range(0))};
+    const auto reference = make_random_sequence(1000);
+    const auto reads = make_reads(reference, 5);
+    const std::deque<std::string> no_reads {};
+    for (auto _ : state) {
+        Assembler assembler {{kmer_size}, reference};
+        assembler.insert_reads(reads, no_reads);
+        ::benchmark::DoNotOptimize(assembler.num_kmers());
+    }
+    state.SetItemsProcessed(state.iterations() * reads.size());
+}
+
+void BM_assembler_extract_variants(::benchmark::State& state)
+{
+    const unsigned kmer_size {static_cast<unsigned>(state.range(0))};
+    const auto reference = make_random_sequence(1000);
+    const auto reads = make_reads(reference, 5);
+    const std::deque<std::string> no_reads {};
+    for (auto _ : state) {
+        state.PauseTiming();
+        Assembler assembler {{kmer_size}, reference};
+        assembler.insert_reads(reads, no_reads);
+        state.ResumeTiming();
+        assembler.try_recover_dangling_branches();
+        assembler.prune(2);
+        if (!assembler.is_acyclic()) assembler.remove_nonreference_cycles();
+        assembler.cleanup();
+        ::benchmark::DoNotOptimize(assembler.extract_variants(10, 2.0));
+    }
+}
+
+void BM_kmer_mapper(::benchmark::State& state)
+{
+    constexpr unsigned char kmer_size {8};
+    const auto target = make_random_sequence(static_cast<std::size_t>(state.range(0)));
+    const auto query = mutate(target.substr(target.size() / 2, read_length), 50);
+    const auto table = make_kmer_hash_table<kmer_size>(target);
+    const auto query_hashes = compute_kmer_hashes<kmer_size>(query);
+    MappedIndexCounts mapping_counts {};
+    std::vector<std::size_t> mapping_positions {};
+    for (auto _ : state) {
+        init_mapping_counts(table, mapping_counts);
+        map_query_to_target(query_hashes, table, mapping_counts, mapping_positions);
+        ::benchmark::DoNotOptimize(mapping_positions.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_kmer_hash_table(::benchmark::State& state)
+{
+    constexpr unsigned char kmer_size {8};
+    const auto target = make_random_sequence(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        ::benchmark::DoNotOptimize(make_kmer_hash_table<kmer_size>(target));
+    }
+    state.SetBytesProcessed(state.iterations() * target.size());
+}
+
+} // namespace
+
+BENCHMARK(BM_assembler_insert_reads)->Arg(15)->Arg(25)->Arg(35);
+BENCHMARK(BM_assembler_extract_variants)->Arg(15)->Arg(25)->Arg(35);
+BENCHMARK(BM_kmer_mapper)->Arg(500)->Arg(2000)->Arg(10000);
+BENCHMARK(BM_kmer_hash_table)->Arg(500)->Arg(2000)->Arg(10000);
+
+} // namespace test
+} // namespace octopus
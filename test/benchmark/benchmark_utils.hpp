@@ -4,21 +4,35 @@
 #ifndef Octopus_benchmark_utils_hpp
 #define Octopus_benchmark_utils_hpp
 
-#include <chrono>
+#include <string>
+#include <random>
+#include <cstddef>
 
-template <typename D = std::chrono::nanoseconds, typename F>
-D benchmark(F f, unsigned num_tests)
+namespace octopus { namespace test {
+
+// Benchmark inputs are seeded so runs are comparable
+inline std::string make_random_sequence(const std::size_t length, const unsigned seed = 0)
 {
-    D total {0};
-    
-    for (; num_tests > 0; --num_tests) {
-        const auto start = std::chrono::system_clock::now();
-        f();
-        const auto end = std::chrono::system_clock::now();
-        total += std::chrono::duration_cast<D>(end - start);
+    static constexpr char bases[] {"ACGT"};
+    std::mt19937 generator {seed};
+    std::uniform_int_distribution<int> base {0, 3};
+    std::string result(length, 'N');
+    for (auto& c : result) c = bases[base(generator)];
+    return result;
+}
+
+// Copies sequence with roughly one substitution per period bases
+inline std::string mutate(std::string sequence, const std::size_t period, const unsigned seed = 0)
+{
+    std::mt19937 generator {seed};
+    std::uniform_int_distribution<std::size_t> offset {0, period - 1};
+    for (std::size_t pos {offset(generator)}; pos < sequence.size(); pos += period) {
+        sequence[pos] = sequence[pos] == 'A' ? 'C' : 'A';
     }
-    
-    return D {total / num_tests};
+    return sequence;
 }
 
+} // namespace test
+} // namespace octopus
+
 #endif
@@ -0,0 +1,118 @@
+// Copyright (c) 2017 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#include "basics/genomic_region.hpp"
+#include "io/reference/reference_genome.hpp"
+#include "core/types/allele.hpp"
+#include "core/types/haplotype.hpp"
+#include "core/types/genotype.hpp"
+#include "core/tools/hapgen/haplotype_tree.hpp"
+#include "mock/mock_reference.hpp"
+
+namespace octopus { namespace test {
+
+using coretools::HaplotypeTree;
+
+namespace {
+
+const ReferenceGenome& get_reference()
+{
+    static const auto result = mock::make_reference();
+    return result;
+}
+
+// Biallelic SNVs every 20bp on a mock contig, reference allele first
+std::vector<Allele> make_snv_alleles(const ReferenceGenome& reference, const std::size_t num_sites)
+{
+    std::vector<Allele> result {};
+    result.reserve(2 * num_sites);
+    for (std::size_t site {0}; site < num_sites; ++site) {
+        const GenomicRegion region {"3", static_cast<GenomicRegion::Position>(100 + 20 * site),
+                                    static_cast<GenomicRegion::Position>(101 + 20 * site)};
+        const auto ref_sequence = reference.fetch_sequence(region);
+        result.emplace_back(region, ref_sequence);
+        result.emplace_back(region, ref_sequence == "A" ? "C" : "A");
+    }
+    return result;
+}
+
+std::vector<Haplotype> make_haplotypes(const ReferenceGenome& reference, const std::size_t num_haplotypes)
+{
+    const GenomicRegion region {"3", 100, 400};
+    const auto ref_sequence = reference.fetch_sequence(region);
+    std::vector<Haplotype> result {};
+    result.reserve(num_haplotypes);
+    for (std::size_t i {0}; i < num_haplotypes; ++i) {
+        auto sequence = ref_sequence;
+        sequence[i % sequence.size()] = sequence[i % sequence.size()] == 'A' ? 'C' : 'A';
+        result.emplace_back(region, std::move(sequence), reference);
+    }
+    return result;
+}
+
+void BM_haplotype_tree_extend(::benchmark::State& state)
+{
+    const auto& reference = get_reference();
+    const auto alleles = make_snv_alleles(reference, static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        HaplotypeTree tree {"3", reference};
+        for (const auto& allele : alleles) tree.extend(allele);
+        ::benchmark::DoNotOptimize(tree.num_haplotypes());
+    }
+}
+
+void BM_haplotype_tree_extract_haplotypes(::benchmark::State& state)
+{
+    const auto& reference = get_reference();
+    const auto alleles = make_snv_alleles(reference, static_cast<std::size_t>(state.range(0)));
+    HaplotypeTree tree {"3", reference};
+    for (const auto& allele : alleles) tree.extend(allele);
+    const auto region = tree.encompassing_region();
+    std::vector<Haplotype> haplotypes {};
+    for (auto _ : state) {
+        tree.extract_haplotypes(region, haplotypes);
+        ::benchmark::DoNotOptimize(haplotypes.data());
+    }
+    state.SetItemsProcessed(state.iterations() * tree.num_haplotypes());
+}
+
+void BM_generate_all_genotypes(::benchmark::State& state)
+{
+    const auto haplotypes = make_haplotypes(get_reference(), static_cast<std::size_t>(state.range(0)));
+    const auto ploidy = static_cast<unsigned>(state.range(1));
+    std::size_t num_genotypes {0};
+    for (auto _ : state) {
+        const auto genotypes = generate_all_genotypes(haplotypes, ploidy);
+        num_genotypes = genotypes.size();
+        ::benchmark::DoNotOptimize(genotypes.data());
+    }
+    state.SetItemsProcessed(state.iterations() * num_genotypes);
+}
+
+void BM_generate_all_genotype_indices(::benchmark::State& state)
+{
+    const auto haplotypes = make_haplotypes(get_reference(), static_cast<std::size_t>(state.range(0)));
+    const auto ploidy = static_cast<unsigned>(state.range(1));
+    std::vector<GenotypeIndex> indices {};
+    for (auto _ : state) {
+        const auto genotypes = generate_all_genotypes(haplotypes, ploidy, indices);
+        ::benchmark::DoNotOptimize(genotypes.data());
+    }
+    state.SetItemsProcessed(state.iterations() * indices.size());
+}
+
+} // namespace
+
+BENCHMARK(BM_haplotype_tree_extend)->Arg(4)->Arg(8)->Arg(12);
+BENCHMARK(BM_haplotype_tree_extract_haplotypes)->Arg(4)->Arg(8)->Arg(12);
+BENCHMARK(BM_generate_all_genotypes)->Args({16, 2})->Args({64, 2})->Args({16, 3})->Args({16, 4});
+BENCHMARK(BM_generate_all_genotype_indices)->Args({16, 2})->Args({64, 2})->Args({16, 3})->Args({16, 4});
+
+} // namespace test
+} // namespace octopus
@@ -0,0 +1,112 @@
+// Copyright (c) 2017 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "core/models/pairhmm/simd_pair_hmm.hpp"
+
+#include "benchmark_utils.hpp"
+
+namespace octopus { namespace test {
+
+namespace {
+
+struct AlignmentInputs
+{
+    std::string truth, target;
+    std::vector<std::int8_t> qualities, snv_priors, gap_open, gap_extend;
+};
+
+// target is a mutated copy of the middle of truth, so truth_len == target_len + 2 * band_size - 1
+AlignmentInputs make_alignment_inputs(const int target_len, const int band_size)
+{
+    AlignmentInputs result {};
+    result.truth = make_random_sequence(target_len + 2 * band_size - 1);
+    result.target = mutate(result.truth.substr(band_size, target_len), 50);
+    result.qualities.assign(target_len, 35);
+    result.snv_priors.assign(result.truth.size(), 40);
+    result.gap_open.assign(result.truth.size(), 45);
+    result.gap_extend.assign(result.truth.size(), 3);
+    return result;
+}
+
+void BM_pair_hmm_align(::benchmark::State& state)
+{
+    const auto target_len = static_cast<int>(state.range(0));
+    const auto inputs = make_alignment_inputs(target_len, hmm::simd::min_flank_pad());
+    const auto truth_len = static_cast<int>(inputs.truth.size());
+    for (auto _ : state) {
+        ::benchmark::DoNotOptimize(hmm::simd::align(inputs.truth.data(), inputs.target.data(), inputs.qualities.data(),
+                                                    truth_len, target_len, inputs.truth.data(), inputs.snv_priors.data(),
+                                                    inputs.gap_open.data(), inputs.gap_extend.data(), 2));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_pair_hmm_align_with_alignment(::benchmark::State& state)
+{
+    const auto target_len = static_cast<int>(state.range(0));
+    const auto inputs = make_alignment_inputs(target_len, hmm::simd::min_flank_pad());
+    const auto truth_len = static_cast<int>(inputs.truth.size());
+    const auto max_alignment_size = 2 * (target_len + hmm::simd::min_flank_pad()) + 1;
+    std::string aln1(max_alignment_size, '\0'), aln2(max_alignment_size, '\0');
+    int first_pos {};
+    for (auto _ : state) {
+        ::benchmark::DoNotOptimize(hmm::simd::align(inputs.truth.data(), inputs.target.data(), inputs.qualities.data(),
+                                                    truth_len, target_len, inputs.truth.data(), inputs.snv_priors.data(),
+                                                    inputs.gap_open.data(), inputs.gap_extend.data(), 2,
+                                                    &aln1[0], &aln2[0], first_pos));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_pair_hmm_banded_align(::benchmark::State& state)
+{
+    const auto band_size = static_cast<int>(state.range(0));
+    const int target_len {150};
+    const auto inputs = make_alignment_inputs(target_len, band_size);
+    const auto truth_len = static_cast<int>(inputs.truth.size());
+    for (auto _ : state) {
+        ::benchmark::DoNotOptimize(hmm::simd::align(band_size, inputs.truth.data(), inputs.target.data(), inputs.qualities.data(),
+                                                    truth_len, target_len, inputs.truth.data(), inputs.snv_priors.data(),
+                                                    inputs.gap_open.data(), inputs.gap_extend.data(), 2));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_pair_hmm_batched_align(::benchmark::State& state)
+{
+    const auto num_alignments = static_cast<int>(state.range(0));
+    const int target_len {150};
+    std::vector<AlignmentInputs> inputs {};
+    inputs.reserve(num_alignments);
+    std::vector<hmm::simd::BandedAlignment> alignments {};
+    alignments.reserve(num_alignments);
+    for (int i {0}; i < num_alignments; ++i) {
+        inputs.push_back(make_alignment_inputs(target_len, hmm::simd::min_flank_pad()));
+        inputs.back().target = mutate(inputs.back().target, 30, i);
+        const auto& input = inputs.back();
+        alignments.push_back({input.truth.data(), input.target.data(), input.qualities.data(), target_len,
+                              input.truth.data(), input.snv_priors.data(), input.gap_open.data(), input.gap_extend.data(), 2});
+    }
+    std::vector<int> scores(num_alignments);
+    for (auto _ : state) {
+        hmm::simd::align(alignments.data(), num_alignments, scores.data());
+        ::benchmark::DoNotOptimize(scores.data());
+    }
+    state.SetItemsProcessed(state.iterations() * num_alignments);
+}
+
+} // namespace
+
+BENCHMARK(BM_pair_hmm_align)->Arg(100)->Arg(150)->Arg(250);
+BENCHMARK(BM_pair_hmm_align_with_alignment)->Arg(100)->Arg(150)->Arg(250);
+BENCHMARK(BM_pair_hmm_banded_align)->Arg(8)->Arg(16)->Arg(32);
+BENCHMARK(BM_pair_hmm_batched_align)->Arg(1)->Arg(8)->Arg(64);
+
+} // namespace test
+} // namespace octopus
@@ -0,0 +1,102 @@
+// Copyright (c) 2017 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iterator>
+#include <memory>
+#include <cstdlib>
+
+#include "config/common.hpp"
+#include "config/option_parser.hpp"
+#include "config/option_collation.hpp"
+#include "io/reference/reference_genome.hpp"
+#include "io/read/read_manager.hpp"
+#include "readpipe/read_pipe.hpp"
+#include "core/callers/caller.hpp"
+#include "core/callers/caller_factory.hpp"
+#include "logging/progress_meter.hpp"
+#include "utils/region_snapshot.hpp"
+
+namespace octopus { namespace test {
+
+namespace {
+
+// Replays the region snapshot named by OCTOPUS_SNAPSHOT, as written by octopus --snapshot-region. Only
+// calling is run, with the options of the snapshotted run, on the snapshot's processed reads and candidates.
+constexpr const char* snapshotVariable {"OCTOPUS_SNAPSHOT"};
+
+std::vector<std::string> split_command_line(const std::string& command_line)
+{
+    std::istringstream ss {command_line};
+    return {std::istream_iterator<std::string> {ss}, std::istream_iterator<std::string> {}};
+}
+
+options::OptionMap parse_snapshot_options(const RegionSnapshot& snapshot)
+{
+    const auto arguments = split_command_line(snapshot.command_line);
+    std::vector<const char*> argv {};
+    argv.reserve(arguments.size());
+    for (const auto& argument : arguments) argv.push_back(argument.c_str());
+    return options::parse_options(static_cast<int>(argv.size()), argv.data());
+}
+
+InputRegionMap make_input_regions(const RegionSnapshot& snapshot)
+{
+    InputRegionMap result {};
+    result[snapshot.call_region.contig_name()].insert(snapshot.call_region);
+    return result;
+}
+
+struct SnapshotReplay
+{
+    SnapshotReplay(const char* snapshot_path)
+    : snapshot {read_region_snapshot(snapshot_path)}
+    , reference {std::make_unique<SnapshotReference>(snapshot)}
+    , read_manager {}
+    , options {parse_snapshot_options(snapshot)}
+    , read_pipe {options::make_read_pipe(read_manager, reference, snapshot.samples, options)}
+    , caller {options::make_caller_factory(reference, read_pipe, make_input_regions(snapshot), options)
+              .make(snapshot.call_region.contig_name())}
+    {}
+
+    RegionSnapshot snapshot;
+    ReferenceGenome reference;
+    ReadManager read_manager;
+    options::OptionMap options;
+    ReadPipe read_pipe;
+    std::unique_ptr<Caller> caller;
+};
+
+const SnapshotReplay& get_replay()
+{
+    static const SnapshotReplay result {std::getenv(snapshotVariable)};
+    return result;
+}
+
+void BM_replay_snapshot(::benchmark::State& state)
+{
+    const auto& replay = get_replay();
+    const auto& candidates = replay.snapshot.candidates;
+    std::size_t num_calls {0};
+    for (auto _ : state) {
+        state.PauseTiming();
+        ProgressMeter progress_meter {replay.snapshot.call_region};
+        MappableFlatSet<Variant> region_candidates {std::cbegin(candidates), std::cend(candidates)};
+        state.ResumeTiming();
+        num_calls = replay.caller->call(replay.snapshot.call_region, std::move(region_candidates),
+                                        replay.snapshot.reads, progress_meter).size();
+    }
+    state.counters["calls"] = num_calls;
+}
+
+const bool is_snapshot_registered {std::getenv(snapshotVariable) != nullptr
+    && ::benchmark::RegisterBenchmark("BM_replay_snapshot", BM_replay_snapshot)->Unit(::benchmark::kMillisecond) != nullptr};
+
+} // namespace
+
+} // namespace test
+} // namespace octopus
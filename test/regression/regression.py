@@ -1,3 +1,162 @@
 #!/usr/bin/env python3
 
+import os
+import os.path
+import sys
+import json
+import time
+import argparse
+import subprocess
+import tempfile
 
+default_datasets = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'datasets.json')
+
+def parse_region_size(region):
+    region = region.replace(',', '')
+    if ':' not in region:
+        raise ValueError('region ' + region + ' must have a position range')
+    positions = region.split(':')[1]
+    begin, end = positions.split('-')
+    return int(end) - int(begin)
+
+def read_bed_size(bed):
+    result = 0
+    with open(bed) as file:
+        for line in file:
+            fields = line.split()
+            if len(fields) >= 3 and not line.startswith(('#', 'track', 'browser')):
+                result += int(fields[2]) - int(fields[1])
+    return result
+
+def get_dataset_size(dataset, data_dir):
+    if 'regions_file' in dataset:
+        return read_bed_size(os.path.join(data_dir, dataset['regions_file']))
+    return sum(parse_region_size(region) for region in dataset['regions'])
+
+def make_octopus_command(octopus, dataset, data_dir, out_dir, threads):
+    result = [octopus,
+              '--reference', os.path.join(data_dir, dataset['reference']),
+              '--reads'] + [os.path.join(data_dir, reads) for reads in dataset['reads']]
+    if 'regions_file' in dataset:
+        result += ['--regions-file', os.path.join(data_dir, dataset['regions_file'])]
+    else:
+        result += ['--regions'] + dataset['regions']
+    result += ['--threads', str(threads),
+               '--output', os.path.join(out_dir, 'calls.vcf.gz'),
+               '--profile', os.path.join(out_dir, 'profile.json')]
+    return result + dataset['options']
+
+def run_and_measure(command, log):
+    """Returns the wall time in seconds and the peak resident memory in bytes of command"""
+    start = time.monotonic()
+    process = subprocess.Popen(command, stdout=log, stderr=subprocess.STDOUT)
+    _, status, usage = os.wait4(process.pid, 0)
+    wall_time = time.monotonic() - start
+    process.returncode = os.WEXITSTATUS(status) if os.WIFEXITED(status) else -os.WTERMSIG(status)
+    if process.returncode != 0:
+        raise RuntimeError('command failed with status ' + str(process.returncode) + ': ' + ' '.join(command))
+    return wall_time, usage.ru_maxrss * 1024 # ru_maxrss is in kilobytes on Linux
+
+def read_stage_breakdown(profile):
+    with open(profile) as file:
+        stages = json.load(file)['stages']
+    return {stage['name']: stage['total_ns'] / 1e9 for stage in stages if stage['count'] > 0}
+
+def benchmark_dataset(name, dataset, args):
+    size = get_dataset_size(dataset, args.data_dir)
+    best = None
+    for repeat in range(args.repeats):
+        with tempfile.TemporaryDirectory(prefix='octopus_' + name + '_') as out_dir:
+            command = make_octopus_command(args.octopus, dataset, args.data_dir, out_dir, args.threads)
+            with open(os.path.join(out_dir, 'log.txt'), 'w') as log:
+                try:
+                    wall_time, peak_rss = run_and_measure(command, log)
+                except RuntimeError:
+                    log.flush()
+                    with open(log.name) as failed_log:
+                        sys.stderr.write(failed_log.read())
+                    raise
+            stages = read_stage_breakdown(os.path.join(out_dir, 'profile.json'))
+        result = {'bp': size, 'seconds': wall_time, 'bp_per_second': size / wall_time,
+                  'peak_rss_bytes': peak_rss, 'stage_seconds': stages}
+        if best is None or result['seconds'] < best['seconds']:
+            best = result
+    return best
+
+def find_regressions(results, baseline, tolerance):
+    result = []
+    for name, current in results.items():
+        if name not in baseline:
+            continue
+        previous = baseline[name]
+        if current['bp_per_second'] < previous['bp_per_second'] * (1 - tolerance):
+            result.append('{}: throughput fell from {:.0f} to {:.0f} bp/s'.format(name, previous['bp_per_second'], current['bp_per_second']))
+        if current['peak_rss_bytes'] > previous['peak_rss_bytes'] * (1 + tolerance):
+            result.append('{}: peak RSS rose from {} to {} bytes'.format(name, previous['peak_rss_bytes'], current['peak_rss_bytes']))
+    return result
+
+def print_summary(results):
+    for name, result in results.items():
+        print('{}: {:.0f} bp/s, {:.1f} s, peak RSS {:.1f} MB'.format(name, result['bp_per_second'], result['seconds'],
+                                                                    result['peak_rss_bytes'] / 1e6))
+        total = sum(result['stage_seconds'].values())
+        for stage, seconds in sorted(result['stage_seconds'].items(), key=lambda item: -item[1]):
+            print('    {:<22}{:>10.2f} s{:>8.1%}'.format(stage, seconds, seconds / total if total > 0 else 0))
+
+def main(args):
+    with open(args.datasets) as file:
+        datasets = json.load(file)
+    names = args.only if args.only else list(datasets.keys())
+    unknown = [name for name in names if name not in datasets]
+    if unknown:
+        raise ValueError('unknown datasets: ' + ', '.join(unknown))
+    results = {name: benchmark_dataset(name, datasets[name], args) for name in names}
+    print_summary(results)
+    if args.output:
+        with open(args.output, 'w') as file:
+            json.dump(results, file, indent=2)
+    if args.baseline:
+        with open(args.baseline) as file:
+            regressions = find_regressions(results, json.load(file), args.tolerance)
+        for regression in regressions:
+            print('REGRESSION ' + regression)
+        if regressions:
+            sys.exit(1)
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Runs octopus on standard region sets and reports throughput, peak memory, and per-stage time')
+    parser.add_argument('--octopus',
+                        type=str,
+                        required=True,
+                        help='Octopus binary to benchmark')
+    parser.add_argument('--data-dir',
+                        type=str,
+                        required=True,
+                        help='Directory containing the dataset references, reads, and region files')
+    parser.add_argument('--datasets',
+                        type=str,
+                        default=default_datasets,
+                        help='JSON file describing the datasets')
+    parser.add_argument('--only',
+                        type=str,
+                        nargs='+',
+                        help='Only run the named datasets')
+    parser.add_argument('--threads',
+                        type=int,
+                        default=1,
+                        help='Threads given to octopus')
+    parser.add_argument('--repeats',
+                        type=int,
+                        default=1,
+                        help='Runs per dataset, the fastest is reported')
+    parser.add_argument('--output',
+                        type=str,
+                        help='Write results as JSON to this file, for use as a later baseline')
+    parser.add_argument('--baseline',
+                        type=str,
+                        help='Results JSON of a previous release to compare against')
+    parser.add_argument('--tolerance',
+                        type=float,
+                        default=0.1,
+                        help='Fractional slowdown or memory increase over the baseline treated as a regression')
+    main(parser.parse_args())
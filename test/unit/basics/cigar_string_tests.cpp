@@ -79,6 +79,29 @@ BOOST_AUTO_TEST_CASE(can_copy_parts_of_cigar)
     BOOST_CHECK_EQUAL(copy(cigar, 16, 7), parse_cigar("3I4M"));
 }
 
+BOOST_AUTO_TEST_CASE(cigar_operations_are_packed_as_in_bam)
+{
+    using CO   = CigarOperation;
+    using Flag = CO::Flag;
+    
+    BOOST_CHECK_EQUAL(sizeof(CO), 4);
+    BOOST_CHECK_EQUAL(CO(10, Flag::alignmentMatch).packed(), 10u << 4);
+    BOOST_CHECK_EQUAL(CO(3, Flag::deletion).packed(), 3u << 4 | 2);
+    BOOST_CHECK_EQUAL(CO(7, Flag::substitution).packed(), 7u << 4 | 8);
+    for (const auto flag : {Flag::alignmentMatch, Flag::sequenceMatch, Flag::substitution, Flag::insertion,
+                            Flag::deletion, Flag::softClipped, Flag::hardClipped, Flag::padding, Flag::skipped}) {
+        const CO op {CO::max_size(), flag};
+        BOOST_CHECK_EQUAL(op.flag(), flag);
+        BOOST_CHECK_EQUAL(op.size(), CO::max_size());
+        BOOST_CHECK_EQUAL(CO::unpack(op.packed()), op);
+    }
+    CO op {5, Flag::insertion};
+    op.set_flag(Flag::deletion);
+    op.set_size(6);
+    BOOST_CHECK_EQUAL(op, CO(6, Flag::deletion));
+    BOOST_CHECK(!is_valid(parse_cigar("5M3B")));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 BOOST_AUTO_TEST_SUITE_END()
     
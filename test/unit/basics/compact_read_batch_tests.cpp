@@ -0,0 +1,94 @@
+// Copyright (c) 2017 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <iterator>
+#include <string>
+#include <algorithm>
+
+#include "basics/genomic_region.hpp"
+#include "basics/cigar_string.hpp"
+#include "basics/aligned_read.hpp"
+#include "basics/compact_read_batch.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(basics)
+BOOST_AUTO_TEST_SUITE(compact_read_batch)
+
+namespace {
+
+std::vector<AlignedRead> make_mock_reads()
+{
+    AlignedRead::Flags reverse_flags {};
+    reverse_flags.reverse_mapped = true;
+    reverse_flags.duplicate = true;
+    return {
+        AlignedRead {"read1", GenomicRegion {"1", 100, 104}, "ACGT", AlignedRead::BaseQualityVector {1, 2, 3, 4},
+                     parse_cigar("4M"), 10, AlignedRead::Flags {}, "RG1", "1", 300, 204, AlignedRead::Segment::Flags {false, true}},
+        AlignedRead {"read2", GenomicRegion {"1", 102, 110}, "ACGTNACGT", AlignedRead::BaseQualityVector(9, 30),
+                     parse_cigar("2M1I1D5M1S"), 60, reverse_flags, "RG2"},
+        AlignedRead {"read3", GenomicRegion {"1", 150, 155}, "acgtA", AlignedRead::BaseQualityVector {0, 10, 20, 30, 40},
+                     parse_cigar("5M"), 0, AlignedRead::Flags {}, "RG1"}
+    };
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(decoded_reads_are_equal_to_the_originals)
+{
+    const auto reads = make_mock_reads();
+    const CompactReadBatch batch {std::cbegin(reads), std::cend(reads)};
+    BOOST_REQUIRE_EQUAL(batch.size(), reads.size());
+    for (std::size_t i {0}; i < reads.size(); ++i) {
+        BOOST_CHECK_EQUAL(batch.decode(i), reads[i]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(decode_overlapped_only_decodes_overlapping_reads)
+{
+    const auto reads = make_mock_reads();
+    const CompactReadBatch batch {std::cbegin(reads), std::cend(reads)};
+    std::vector<AlignedRead> overlapped {};
+    batch.decode_overlapped(GenomicRegion {"1", 103, 120}, std::back_inserter(overlapped));
+    BOOST_REQUIRE_EQUAL(overlapped.size(), 2);
+    BOOST_CHECK_EQUAL(overlapped[0], reads[0]);
+    BOOST_CHECK_EQUAL(overlapped[1], reads[1]);
+    overlapped.clear();
+    batch.decode_overlapped(GenomicRegion {"1", 110, 150}, std::back_inserter(overlapped));
+    BOOST_CHECK(overlapped.empty());
+    batch.decode_overlapped(GenomicRegion {"2", 100, 200}, std::back_inserter(overlapped));
+    BOOST_CHECK(overlapped.empty());
+}
+
+BOOST_AUTO_TEST_CASE(compressed_batches_decode_reads_in_every_block)
+{
+    std::vector<AlignedRead> reads {};
+    for (unsigned i {0}; i < 1500; ++i) {
+        const AlignedRead::NucleotideSequence sequence {i % 3 == 0 ? "ACGTNACGTA" : "ACGTRACGTA"};
+        AlignedRead::BaseQualityVector qualities(sequence.size(), i % 40);
+        reads.emplace_back("read" + std::to_string(i), GenomicRegion {"1", 100 + i, 110 + i}, sequence, std::move(qualities),
+                           parse_cigar("10M"), 60, AlignedRead::Flags {}, "RG1");
+    }
+    CompactReadBatch batch {std::cbegin(reads), std::cbegin(reads) + 1000, true};
+    std::for_each(std::cbegin(reads) + 1000, std::cend(reads), [&] (const auto& read) { batch.push_back(read); });
+    BOOST_REQUIRE_EQUAL(batch.size(), reads.size());
+    for (std::size_t i {0}; i < reads.size(); ++i) {
+        BOOST_CHECK_EQUAL(batch.decode(i), reads[i]);
+    }
+    std::vector<AlignedRead> overlapped {};
+    batch.decode_overlapped(GenomicRegion {"1", 600, 700}, std::back_inserter(overlapped));
+    BOOST_REQUIRE_EQUAL(overlapped.size(), 109);
+    BOOST_CHECK_EQUAL(overlapped.front(), reads[491]);
+    BOOST_CHECK_EQUAL(overlapped.back(), reads[599]);
+    batch.shrink_to_fit();
+    BOOST_CHECK_EQUAL(batch.decode(reads.size() - 1), reads.back());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
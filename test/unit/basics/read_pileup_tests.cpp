@@ -0,0 +1,62 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include "basics/genomic_region.hpp"
+#include "basics/cigar_string.hpp"
+#include "basics/aligned_read.hpp"
+#include "basics/read_pileup.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(basics)
+BOOST_AUTO_TEST_SUITE(read_pileup)
+
+AlignedRead make_mock_read(GenomicRegion region, std::string sequence, AlignedRead::BaseQualityVector qualities,
+                           const std::string& cigar)
+{
+    return AlignedRead {
+        "test", std::move(region), std::move(sequence), std::move(qualities),
+        parse_cigar(cigar), 10, AlignedRead::Flags {}, "1"
+    };
+}
+
+BOOST_AUTO_TEST_CASE(pileups_of_matched_reads_agree_with_copied_read_bases)
+{
+    const auto read = make_mock_read(GenomicRegion {"1", 10, 14}, "ACGT", {1, 2, 3, 4}, "4M");
+    const ReadContainer reads {read};
+    const GenomicRegion region {"1", 8, 16};
+    const auto pileups = make_pileups(reads, region);
+    BOOST_REQUIRE_EQUAL(pileups.size(), size(region));
+    for (const auto& pileup : pileups) {
+        const GenomicRegion position {"1", pileup.mapped_region()};
+        if (overlaps(read, position)) {
+            const auto sequence = copy_sequence(read, position);
+            BOOST_CHECK_EQUAL(pileup.depth(), 1);
+            BOOST_CHECK_EQUAL(pileup.depth(sequence), 1);
+            BOOST_CHECK(pileup.base_qualities(sequence) == copy_base_qualities(read, position));
+        } else {
+            BOOST_CHECK_EQUAL(pileup.depth(), 0);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(pileups_of_reads_with_indels_use_the_read_cigar)
+{
+    const auto read = make_mock_read(GenomicRegion {"1", 10, 15}, "ACGTTA", {1, 2, 3, 4, 5, 6}, "2M2I1M1D1M");
+    const ReadContainer reads {read};
+    const GenomicRegion region {"1", 10, 15};
+    const auto pileups = make_pileups(reads, region);
+    BOOST_REQUIRE_EQUAL(pileups.size(), size(region));
+    for (const auto& pileup : pileups) {
+        const GenomicRegion position {"1", pileup.mapped_region()};
+        BOOST_CHECK_EQUAL(pileup.depth(copy_sequence(read, position)), 1);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
@@ -9,6 +9,7 @@
 
 #include "basics/contig_region.hpp"
 #include "containers/mappable_flat_set.hpp"
+#include "containers/mappable_flat_multi_set.hpp"
 
 namespace octopus { namespace test {
 
@@ -291,6 +292,73 @@ BOOST_AUTO_TEST_CASE(erase_all_only_erases_given_elements_and_maintains_order)
     BOOST_CHECK(std::is_sorted(std::cbegin(set), std::cend(set)));
 }
 
+template <typename Container>
+std::vector<ContigRegion> brute_force_overlapped(const Container& mappables, const ContigRegion& region)
+{
+    std::vector<ContigRegion> result {};
+    std::copy_if(std::cbegin(mappables), std::cend(mappables), std::back_inserter(result),
+                 [&region] (const auto& m) { return overlaps(m, region); });
+    return result;
+}
+
+template <typename Container>
+void check_overlap_queries(const Container& mappables)
+{
+    for (ContigRegion::Position begin {0}; begin < 120; begin += 3) {
+        for (const ContigRegion::Size size : {0, 1, 5}) {
+            const ContigRegion region {begin, begin + size};
+            const auto overlapped = mappables.overlap_range(region);
+            const std::vector<ContigRegion> result {std::cbegin(overlapped), std::cend(overlapped)};
+            BOOST_CHECK(result == brute_force_overlapped(mappables, region));
+            BOOST_CHECK_EQUAL(mappables.count_overlapped(region), result.size());
+            BOOST_CHECK_EQUAL(mappables.has_overlapped(region), !result.empty());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(overlap_range_is_correct_with_long_elements)
+{
+    MappableFlatSet<ContigRegion> set {};
+    for (ContigRegion::Position pos {0}; pos < 100; pos += 2) {
+        set.emplace(pos, pos + 4);
+    }
+    set.emplace(10, 1000);
+    set.emplace(50, 50);
+    check_overlap_queries(set);
+    BOOST_CHECK_EQUAL(set.rightmost(), ContigRegion(10, 1000));
+    set.erase(ContigRegion {10, 1000});
+    check_overlap_queries(set);
+    set.emplace(0, 60);
+    set.erase(std::next(std::cbegin(set), 5), std::next(std::cbegin(set), 10));
+    check_overlap_queries(set);
+    
+    MappableFlatMultiSet<ContigRegion> multiset {std::cbegin(set), std::cend(set)};
+    multiset.emplace(30, 90);
+    multiset.emplace(30, 90);
+    check_overlap_queries(multiset);
+    multiset.erase(ContigRegion {30, 90});
+    check_overlap_queries(multiset);
+    multiset.erase(ContigRegion {0, 60});
+    check_overlap_queries(multiset);
+}
+
+BOOST_AUTO_TEST_CASE(overlap_queries_are_correct_with_empty_elements)
+{
+    MappableFlatMultiSet<ContigRegion> set {};
+    for (ContigRegion::Position pos {0}; pos < 110; pos += 3) {
+        set.emplace(pos, pos);
+        set.emplace(pos, pos + 7);
+        if (pos % 9 == 0) set.emplace(pos + 1, pos + 1);
+    }
+    check_overlap_queries(set);
+    set.emplace(20, 80);
+    set.emplace(45, 45);
+    check_overlap_queries(set);
+    BOOST_CHECK_EQUAL(set.count_overlapped(std::next(std::cbegin(set), 10), std::prev(std::cend(set), 10), ContigRegion {45, 45}),
+                      std::count_if(std::next(std::cbegin(set), 10), std::prev(std::cend(set), 10),
+                                    [] (const auto& region) { return overlaps(region, ContigRegion {45, 45}); }));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -0,0 +1,67 @@
+// Copyright (c) 2017 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <iterator>
+
+#include "containers/matrix_map.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(containers)
+BOOST_AUTO_TEST_SUITE(matrix_map)
+
+BOOST_AUTO_TEST_CASE(key_and_index_lookups_agree)
+{
+    const std::vector<int> columns {10, 20, 30};
+    MatrixMap<std::string, int, double> matrix {std::cbegin(columns), std::cend(columns)};
+    const std::vector<double> a {0.1, 0.2, 0.3}, b {0.4, 0.5, 0.6};
+    BOOST_REQUIRE(matrix.insert_at("a", std::cbegin(a), std::cend(a)));
+    BOOST_REQUIRE(matrix.insert_at("b", std::cbegin(b), std::cend(b)));
+    BOOST_CHECK(!matrix.insert_at("a", std::cbegin(b), std::cend(b)));
+    BOOST_REQUIRE_EQUAL(matrix.size1(), 2);
+    BOOST_REQUIRE_EQUAL(matrix.size2(), 3);
+    for (std::size_t i {0}; i < matrix.size1(); ++i) {
+        for (std::size_t j {0}; j < matrix.size2(); ++j) {
+            BOOST_CHECK_EQUAL(matrix.at(i, j), matrix(matrix.key1(i), matrix.key2(j)));
+            BOOST_CHECK_EQUAL(matrix.at(i, j), matrix[matrix.key1(i)][matrix.key2(j)]);
+        }
+    }
+    BOOST_CHECK_EQUAL(matrix("b", 30), 0.6);
+    BOOST_CHECK_EQUAL(matrix.index1("b"), 1);
+    BOOST_CHECK_EQUAL(matrix.index2(20), 1);
+    const auto row = matrix.values(0);
+    BOOST_CHECK_EQUAL_COLLECTIONS(std::cbegin(row), std::cend(row), std::cbegin(a), std::cend(a));
+}
+
+BOOST_AUTO_TEST_CASE(column_edits_keep_rows_aligned)
+{
+    const std::vector<int> columns {10, 20, 30};
+    MatrixMap<std::string, int, double> matrix {std::cbegin(columns), std::cend(columns)};
+    const std::vector<double> a {0.1, 0.2, 0.3}, b {0.4, 0.5, 0.6};
+    matrix.insert_at("a", std::cbegin(a), std::cend(a));
+    matrix.insert_at("b", std::cbegin(b), std::cend(b));
+    const std::vector<double> c {0.7, 0.8};
+    matrix.insert_each(40, std::cbegin(c), std::cend(c));
+    BOOST_CHECK_EQUAL(matrix("a", 40), 0.7);
+    BOOST_CHECK_EQUAL(matrix("b", 40), 0.8);
+    BOOST_REQUIRE(matrix.erase2(20));
+    BOOST_REQUIRE_EQUAL(matrix.size2(), 3);
+    BOOST_CHECK_EQUAL(matrix("a", 30), 0.3);
+    BOOST_CHECK_EQUAL(matrix("b", 40), 0.8);
+    BOOST_REQUIRE(matrix.erase1("a"));
+    BOOST_REQUIRE_EQUAL(matrix.size1(), 1);
+    BOOST_CHECK_EQUAL(matrix.index1("b"), 0);
+    BOOST_CHECK_EQUAL(matrix("b", 10), 0.4);
+    const auto copy = matrix;
+    BOOST_CHECK_EQUAL(copy("b", 30), 0.6);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
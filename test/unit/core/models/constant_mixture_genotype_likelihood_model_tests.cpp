@@ -0,0 +1,67 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <iterator>
+
+#include "basics/genomic_region.hpp"
+#include "core/types/haplotype.hpp"
+#include "core/types/genotype.hpp"
+#include "core/models/haplotype_likelihood_array.hpp"
+#include "core/models/genotype/constant_mixture_genotype_likelihood_model.hpp"
+#include "mock/mock_reference.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(core)
+BOOST_AUTO_TEST_SUITE(constant_mixture_genotype_likelihood_model)
+
+BOOST_AUTO_TEST_CASE(merged_samples_evaluate_as_concatenated_samples)
+{
+    const auto reference = mock::make_reference();
+    const std::vector<Haplotype> haplotypes {
+        {GenomicRegion {"3", 100, 120}, reference},
+        {GenomicRegion {"3", 101, 121}, reference},
+        {GenomicRegion {"3", 102, 122}, reference}
+    };
+    const std::vector<SampleName> samples {"A", "B", "C"};
+    const std::vector<std::size_t> num_reads {5, 0, 9};
+    HaplotypeLikelihoodArray likelihoods {3, samples}, concatenated_likelihoods {3, {"ABC"}};
+    double likelihood {-0.5};
+    for (const auto& haplotype : haplotypes) {
+        std::vector<double> concatenated {};
+        for (std::size_t s {0}; s < samples.size(); ++s) {
+            std::vector<double> sample_likelihoods(num_reads[s]);
+            for (auto& l : sample_likelihoods) {
+                l = likelihood;
+                likelihood = likelihood < -20 ? -0.5 : likelihood * 1.7;
+            }
+            likelihoods.insert(samples[s], haplotype, sample_likelihoods);
+            concatenated.insert(std::cend(concatenated), std::cbegin(sample_likelihoods), std::cend(sample_likelihoods));
+        }
+        concatenated_likelihoods.insert("ABC", haplotype, concatenated);
+    }
+    concatenated_likelihoods.prime("ABC");
+    const auto merged_likelihoods = merge_samples(samples, likelihoods);
+    BOOST_CHECK_EQUAL(merged_likelihoods.num_likelihoods(), concatenated_likelihoods.num_likelihoods("ABC"));
+    const model::ConstantMixtureGenotypeLikelihoodModel concatenated_model {concatenated_likelihoods};
+    const model::ConstantMixtureGenotypeLikelihoodModel merged_model {merged_likelihoods};
+    model::ConstantMixtureGenotypeLikelihoodModel indexed_merged_model {merged_likelihoods};
+    indexed_merged_model.prime(haplotypes);
+    for (unsigned i {0}; i < 3; ++i) {
+        for (unsigned j {i}; j < 3; ++j) {
+            const Genotype<Haplotype> genotype {haplotypes[i], haplotypes[j]};
+            const auto expected = concatenated_model.evaluate(genotype);
+            BOOST_CHECK_CLOSE(merged_model.evaluate(genotype), expected, 1e-9);
+            BOOST_CHECK_CLOSE(indexed_merged_model.evaluate(GenotypeIndex {i, j}), expected, 1e-9);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
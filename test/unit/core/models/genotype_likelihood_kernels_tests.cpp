@@ -0,0 +1,77 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <array>
+#include <random>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+#include <iterator>
+
+#include "core/models/genotype/genotype_likelihood_kernels.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(core)
+BOOST_AUTO_TEST_SUITE(genotype_likelihood_kernels)
+
+namespace {
+
+auto simulate_log_likelihoods(const std::size_t num_haplotypes, const std::size_t num_reads, const unsigned seed)
+{
+    std::mt19937 generator {seed};
+    std::exponential_distribution<double> mismatch_penalty {0.2};
+    std::vector<std::vector<double>> result(num_haplotypes, std::vector<double>(num_reads));
+    for (auto& row : result) {
+        std::generate(std::begin(row), std::end(row), [&] () { return -mismatch_penalty(generator); });
+    }
+    return result;
+}
+
+template <typename T>
+auto rows(const std::vector<std::vector<T>>& likelihoods, const std::vector<std::size_t>& genotype)
+{
+    std::vector<const T*> result {};
+    for (auto h : genotype) result.push_back(likelihoods[h].data());
+    return result;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(single_precision_likelihoods_give_concordant_genotype_likelihoods)
+{
+    const std::size_t num_haplotypes {6}, num_reads {2001};
+    const auto likelihoods = simulate_log_likelihoods(num_haplotypes, num_reads, 42);
+    std::vector<std::vector<float>> float_likelihoods {};
+    for (const auto& row : likelihoods) float_likelihoods.emplace_back(std::cbegin(row), std::cend(row));
+    std::vector<double> read_weights(num_reads);
+    for (std::size_t n {0}; n < num_reads; ++n) read_weights[n] = 1 + n % 3;
+    std::vector<std::vector<std::size_t>> genotypes {};
+    for (std::size_t i {0}; i < num_haplotypes; ++i) {
+        for (std::size_t j {i + 1}; j < num_haplotypes; ++j) genotypes.push_back({i, j});
+    }
+    const std::array<double, 2> weights {0.0, std::log(2.0)};
+    const std::array<const double*, 2> read_weight_options {nullptr, read_weights.data()};
+    for (const auto* read_weights_ptr : read_weight_options) {
+        std::vector<double> double_results {}, float_results {};
+        for (const auto& genotype : genotypes) {
+            const auto double_rows = rows(likelihoods, genotype);
+            const auto float_rows = rows(float_likelihoods, genotype);
+            double_results.push_back(model::kernels::sum_log_sum_exp(double_rows.data(), weights.data(), 2, num_reads, read_weights_ptr));
+            float_results.push_back(model::kernels::sum_log_sum_exp(float_rows.data(), weights.data(), 2, num_reads, read_weights_ptr));
+            // Only the stored likelihoods are rounded, so the error does not grow with the accumulation
+            BOOST_CHECK_CLOSE(float_results.back(), double_results.back(), 1e-5);
+        }
+        const auto max_idx = [] (const auto& values) { return std::distance(std::cbegin(values), std::max_element(std::cbegin(values), std::cend(values))); };
+        BOOST_CHECK_EQUAL(max_idx(float_results), max_idx(double_results));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
@@ -0,0 +1,49 @@
+// Copyright (c) 2017 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include "core/models/genotype_likelihood_table.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(core)
+BOOST_AUTO_TEST_SUITE(genotype_likelihood_table)
+
+BOOST_AUTO_TEST_CASE(erasing_haplotypes_only_invalidates_genotypes_containing_them)
+{
+    GenotypeLikelihoodTable table {100};
+    table.insert(0, {0, 0}, -1.0);
+    table.insert(0, {0, 1}, -2.0);
+    table.insert(0, {1, 2}, -3.0);
+    table.insert(1, {0, 2}, -4.0);
+    BOOST_CHECK_EQUAL(table.size(), 4);
+    table.erase_haplotypes({1});
+    BOOST_CHECK_EQUAL(table.size(), 2);
+    BOOST_REQUIRE(table.find(0, {0, 0}));
+    BOOST_CHECK_EQUAL(*table.find(0, {0, 0}), -1.0);
+    BOOST_CHECK(!table.find(0, {0, 1}));
+    BOOST_CHECK(!table.find(0, {1, 2}));
+    BOOST_REQUIRE(table.find(1, {0, 2}));
+    BOOST_CHECK(!table.find(0, {0, 2}));
+    table.clear();
+    BOOST_CHECK_EQUAL(table.size(), 0);
+    BOOST_CHECK(!table.find(1, {0, 2}));
+}
+
+BOOST_AUTO_TEST_CASE(entries_are_not_added_beyond_capacity)
+{
+    GenotypeLikelihoodTable table {2};
+    table.insert(0, {0}, -1.0);
+    table.insert(0, {1}, -1.0);
+    table.insert(0, {2}, -1.0);
+    BOOST_CHECK_EQUAL(table.size(), 2);
+    BOOST_CHECK(!table.find(0, {2}));
+    BOOST_CHECK(!GenotypeLikelihoodTable {}.find(0, {0}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
@@ -0,0 +1,78 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <cstddef>
+
+#include "core/models/genotype/hardy_weinberg_model.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(core)
+BOOST_AUTO_TEST_SUITE(hardy_weinberg_model)
+
+namespace {
+
+auto simulate_genotypes(const std::size_t num_genotypes, const unsigned ploidy, const unsigned num_haplotypes,
+                        std::mt19937& generator)
+{
+    std::uniform_int_distribution<unsigned> haplotype_dist {0, num_haplotypes - 1};
+    std::vector<GenotypeIndex> result(num_genotypes, GenotypeIndex(ploidy));
+    for (auto& genotype : result) {
+        std::generate(std::begin(genotype), std::end(genotype), [&] () { return haplotype_dist(generator); });
+    }
+    return result;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(packed_genotypes_evaluate_the_same_as_single_genotypes)
+{
+    std::mt19937 generator {3};
+    const unsigned num_haplotypes {7};
+    std::uniform_real_distribution<double> frequency_dist {0.01, 1};
+    for (const unsigned ploidy : {1, 2, 3, 4}) {
+        const auto genotypes = simulate_genotypes(50, ploidy, num_haplotypes, generator);
+        HardyWeinbergModel::HaplotypeFrequencyVector frequencies(num_haplotypes);
+        std::generate(std::begin(frequencies), std::end(frequencies), [&] () { return frequency_dist(generator); });
+        const auto norm = std::accumulate(std::cbegin(frequencies), std::cend(frequencies), 0.0);
+        for (auto& frequency : frequencies) frequency /= norm;
+        const HardyWeinbergModel model {frequencies};
+        std::vector<double> log_probabilities {};
+        model.evaluate(HardyWeinbergModel::pack(genotypes), log_probabilities);
+        BOOST_REQUIRE_EQUAL(log_probabilities.size(), genotypes.size());
+        for (std::size_t i {0}; i < genotypes.size(); ++i) {
+            BOOST_CHECK_CLOSE(log_probabilities[i], model.evaluate(genotypes[i]), 1e-9);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(joint_genotypes_are_evaluated_with_their_own_haplotype_frequencies)
+{
+    std::mt19937 generator {5};
+    const unsigned num_haplotypes {5};
+    for (const unsigned ploidy : {1, 2, 3}) {
+        const auto genotypes = simulate_genotypes(6, ploidy, num_haplotypes, generator);
+        HardyWeinbergModel::HaplotypeFrequencyVector frequencies(num_haplotypes);
+        for (const auto& genotype : genotypes) {
+            for (auto idx : genotype) frequencies[idx] += 1.0 / (ploidy * genotypes.size());
+        }
+        const HardyWeinbergModel empirical_model {frequencies};
+        double expected {0};
+        for (const auto& genotype : genotypes) expected += empirical_model.evaluate(genotype);
+        const HardyWeinbergModel model {};
+        BOOST_CHECK_CLOSE(model.evaluate(genotypes), expected, 1e-9);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
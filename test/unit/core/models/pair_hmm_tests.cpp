@@ -1,4 +1,122 @@
 // Copyright (c) 2017 Daniel Cooke
 // Use of this source code is governed by the MIT license that can be found in the LICENSE file.
 
-#include <stdio.h>
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "core/models/pairhmm/simd_pair_hmm.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(core)
+BOOST_AUTO_TEST_SUITE(pair_hmm)
+
+namespace {
+
+int banded_score(const std::string& core, const std::string& target, const int band_size)
+{
+    // the target is mapped to the start of core, which is padded enough for any band
+    const std::string pad(64, 'A');
+    const auto truth = pad + core + pad;
+    const std::vector<std::int8_t> qualities(target.size(), 40), snv_priors(truth.size(), 40),
+                                   gap_open(truth.size(), 45), gap_extend(truth.size(), 3);
+    const auto offset = pad.size() - band_size;
+    return hmm::simd::align(band_size, truth.data() + offset, target.data(), qualities.data(),
+                            static_cast<int>(target.size()) + 2 * band_size - 1, static_cast<int>(target.size()),
+                            truth.data() + offset, snv_priors.data() + offset,
+                            gap_open.data() + offset, gap_extend.data() + offset, 2);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(all_band_sizes_give_zero_penalty_to_exact_matches)
+{
+    const std::string target {"CGTACGTTGACCATGCAGTCGATCGGATCCAGT"};
+    for (const int band_size : {8, 16, 32}) {
+        BOOST_REQUIRE(hmm::simd::is_supported_band_size(band_size));
+        BOOST_CHECK_EQUAL(banded_score(target, target, band_size), 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(wider_bands_can_align_longer_deletions)
+{
+    const std::string lhs {"CGTACGTTGACCATGCAGTC"}, deleted {"TTGGCCAATTGC"}, rhs {"GATCGGATCCAGTCATGCAT"};
+    const auto target = lhs + rhs;
+    const auto truth = lhs + deleted + rhs;
+    const auto narrow_score = banded_score(truth, target, 8);
+    const auto wide_score = banded_score(truth, target, 16);
+    BOOST_CHECK_LT(wide_score, narrow_score);
+    BOOST_CHECK_EQUAL(banded_score(truth, target, 32), wide_score);
+}
+
+BOOST_AUTO_TEST_CASE(batched_alignment_is_equivalent_to_single_alignment)
+{
+    const std::string truth {"AAAAAAAACGTACGTTGACCATGCAGTCTTGGCCAATTGCGATCGGATCCAGTCATGCATAAAAAAAA"};
+    const std::vector<std::string> targets {
+        "CGTACGTTGACCATGCAGTCGATCGGATCCAGTCATGCAT",
+        "CGTACGTTGACGATGCAGTCTTGGCCAATTGCGATCGG",
+        "CGTACGTTCCATGCAGTCTTGGCCAATTGCGAT",
+        "GACCATGCAGTCTTGGCCAATTGCGATCGGAT",
+        "CGTACGTTGACCATGCAGTCTTGGCCAATTGCGATCGGATCCAGTCATGCAT"
+    };
+    const std::vector<std::int8_t> snv_priors(truth.size(), 40), gap_open(truth.size(), 45), gap_extend(truth.size(), 3);
+    std::vector<std::vector<std::int8_t>> qualities {};
+    std::vector<hmm::simd::BandedAlignment> alignments {};
+    for (const auto& target : targets) {
+        qualities.emplace_back(target.size(), 35);
+    }
+    for (std::size_t i {0}; i < targets.size(); ++i) {
+        alignments.push_back({truth.data(), targets[i].data(), qualities[i].data(), static_cast<int>(targets[i].size()),
+                              truth.data(), snv_priors.data(), gap_open.data(), gap_extend.data(), 2});
+    }
+    std::vector<int> scores(alignments.size());
+    hmm::simd::align(alignments.data(), static_cast<int>(alignments.size()), scores.data());
+    for (std::size_t i {0}; i < targets.size(); ++i) {
+        const auto target_len = static_cast<int>(targets[i].size());
+        const auto expected = hmm::simd::align(truth.data(), targets[i].data(), qualities[i].data(),
+                                               target_len + 2 * hmm::simd::min_flank_pad() - 1, target_len,
+                                               truth.data(), snv_priors.data(), gap_open.data(), gap_extend.data(), 2);
+        BOOST_CHECK_EQUAL(scores[i], expected);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(batched_alignment_rescores_alignments_that_saturate_8_bits)
+{
+    const std::string truth {"AAAAAAACGTACGTTGACCATGCAGTCTTGGCCAATTGCGATCGGATCCAGTCATGCATAAAAAAAA"};
+    const auto target_len = static_cast<int>(truth.size()) - 2 * hmm::simd::min_flank_pad() + 1;
+    const std::vector<std::int8_t> qualities(target_len, 35), snv_priors(truth.size(), 40),
+                                   gap_open(truth.size(), 45), gap_extend(truth.size(), 3);
+    std::vector<std::string> targets {};
+    for (int i {0}; i < 16; ++i) {
+        auto target = truth.substr(hmm::simd::min_flank_pad() - 1, target_len);
+        // every other target has enough mismatches to score over 255
+        for (int j {i % target_len}; j < target_len; j += i % 2 == 0 ? 4 : target_len) {
+            target[j] = target[j] == 'C' ? 'G' : 'C';
+        }
+        targets.push_back(target);
+    }
+    std::vector<hmm::simd::BandedAlignment> alignments {};
+    for (const auto& target : targets) {
+        alignments.push_back({truth.data(), target.data(), qualities.data(), target_len,
+                              truth.data(), snv_priors.data(), gap_open.data(), gap_extend.data(), 2});
+    }
+    std::vector<int> scores(alignments.size());
+    const auto tier_counts = hmm::simd::align(alignments.data(), static_cast<int>(alignments.size()), scores.data());
+    BOOST_CHECK_EQUAL(tier_counts.int8, 16);
+    BOOST_CHECK_EQUAL(tier_counts.int8_saturated, 8);
+    for (std::size_t i {0}; i < targets.size(); ++i) {
+        const auto expected = hmm::simd::align(truth.data(), targets[i].data(), qualities.data(),
+                                               static_cast<int>(truth.size()), target_len,
+                                               truth.data(), snv_priors.data(), gap_open.data(), gap_extend.data(), 2);
+        BOOST_CHECK_EQUAL(scores[i], expected);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
@@ -4,6 +4,9 @@
 #include <boost/test/unit_test.hpp>
 
 #include <exception>
+#include <deque>
+#include <functional>
+#include <sstream>
 
 #include "core/tools/vargen/utils/assembler.hpp"
 
@@ -72,6 +75,53 @@ BOOST_AUTO_TEST_CASE(assembler_throws_if_reference_sequence_is_inserted_twice)
     BOOST_CHECK_THROW(assembler.insert_reference(reference), std::exception);
 }
 
+BOOST_AUTO_TEST_CASE(inserting_reads_in_bulk_is_equivalent_to_inserting_reads_individually)
+{
+    const Assembler::NucleotideSequence reference {"ACGTTGCAAGGCTTACCGATCGGATACCTGAAGTCC"};
+    const std::deque<Assembler::NucleotideSequence> forward_reads {
+        "ACGTTGCAAGGCTTACCGAT", "TTGCAAGGATTACCGATCGG", "GCTTACCGANCGGATACCTG", "ACG"
+    };
+    const std::deque<Assembler::NucleotideSequence> reverse_reads {
+        "CCGATCGGATACCTGAAGTCC", "TTGCAAGGATTACCGATCGG"
+    };
+    
+    constexpr unsigned kmerSize {5};
+    
+    Assembler individual {{kmerSize}, reference}, bulk {{kmerSize}, reference};
+    
+    for (const auto& read : forward_reads) individual.insert_read(read, Assembler::Direction::forward);
+    for (const auto& read : reverse_reads) individual.insert_read(read, Assembler::Direction::reverse);
+    bulk.insert_reads(forward_reads, reverse_reads);
+    
+    BOOST_REQUIRE_EQUAL(individual.num_kmers(), bulk.num_kmers());
+    
+    std::ostringstream individual_dot {}, bulk_dot {};
+    individual.write_dot(individual_dot);
+    bulk.write_dot(bulk_dot);
+    
+    BOOST_CHECK_EQUAL(individual_dot.str(), bulk_dot.str());
+}
+
+BOOST_AUTO_TEST_CASE(assembler_footprint_grows_with_the_graph)
+{
+    const Assembler::NucleotideSequence reference {"ACGTTGCAAGGCTTACCGATCGGATACCTGAAGTCC"};
+    
+    constexpr unsigned kmerSize {5};
+    
+    Assembler assembler {{kmerSize}, reference};
+    
+    const auto reference_footprint = footprint(assembler);
+    
+    BOOST_CHECK(reference_footprint > MemoryFootprint {sizeof(Assembler)});
+    
+    assembler.insert_read("GCAAGGATTACCGATCG", Assembler::Direction::forward);
+    
+    BOOST_CHECK(footprint(assembler) > reference_footprint);
+    
+    assembler.clear();
+    
+    BOOST_CHECK(footprint(assembler) < reference_footprint);
+}
 
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,62 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <iterator>
+#include <functional>
+#include <cstddef>
+
+#include "core/types/genotype.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(core)
+BOOST_AUTO_TEST_SUITE(genotype_index)
+
+BOOST_AUTO_TEST_CASE(GenotypeIndexGenerator_enumerates_every_genotype_once_in_rank_order)
+{
+    for (unsigned ploidy {1}; ploidy <= 8; ++ploidy) {
+        for (unsigned num_elements {1}; num_elements <= 6; ++num_elements) {
+            std::set<GenotypeIndex> seen {};
+            std::size_t expected_rank {0};
+            for (GenotypeIndexGenerator generator {num_elements, ploidy}; !generator.done(); generator.next()) {
+                const auto& index = generator.index();
+                BOOST_REQUIRE_EQUAL(index.size(), ploidy);
+                BOOST_CHECK(std::is_sorted(std::cbegin(index), std::cend(index), std::greater<> {}));
+                BOOST_CHECK(index.front() < num_elements);
+                BOOST_CHECK_EQUAL(generator.rank(), expected_rank);
+                BOOST_CHECK_EQUAL(rank_genotype_index(index, num_elements), expected_rank);
+                BOOST_CHECK(unrank_genotype_index(expected_rank, num_elements, ploidy) == index);
+                seen.insert(index);
+                ++expected_rank;
+            }
+            BOOST_CHECK_EQUAL(seen.size(), expected_rank);
+            BOOST_CHECK_EQUAL(expected_rank, num_genotypes(num_elements, ploidy));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(GenotypeIndexGenerator_can_start_from_any_rank)
+{
+    const unsigned num_elements {5}, ploidy {6};
+    const auto all = generate_all_genotype_indices(num_elements, ploidy);
+    for (std::size_t first_rank {0}; first_rank <= all.size(); first_rank += 7) {
+        std::vector<GenotypeIndex> rest {};
+        for (GenotypeIndexGenerator generator {num_elements, ploidy, first_rank}; !generator.done(); generator.next()) {
+            rest.push_back(generator.index());
+        }
+        BOOST_CHECK(std::equal(std::cbegin(rest), std::cend(rest), std::next(std::cbegin(all), first_rank), std::cend(all)));
+    }
+    BOOST_CHECK((GenotypeIndexGenerator {num_elements, ploidy, all.size()}.done()));
+    BOOST_CHECK((GenotypeIndexGenerator {0, ploidy}.done()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
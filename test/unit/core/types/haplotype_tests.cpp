@@ -255,6 +255,29 @@ BOOST_AUTO_TEST_CASE(haplotype_equate_when_alleles_infer_same_sequence)
     BOOST_CHECK(hap3 == hap4);
 }
 
+BOOST_AUTO_TEST_CASE(remove_duplicates_keeps_one_haplotype_per_sequence)
+{
+    BOOST_REQUIRE(test_file_exists(human_reference_fasta));
+    const auto human = make_reference(human_reference_fasta);
+    const auto region = parse_region("16:9300000-9300100", human);
+    const Allele allele1 {parse_region("16:9300037-9300037", human), "TG"};
+    const Allele allele2 {parse_region("16:9300039-9300051", human), ""};
+    const Allele allele3 {parse_region("16:9300041-9300051", human), ""};
+    const Allele allele4 {parse_region("16:9300060-9300061", human), "A"};
+    const auto hap1 = make_haplotype(human, region, {allele3});
+    const auto hap2 = make_haplotype(human, region, {allele1, allele2});
+    const auto hap3 = make_haplotype(human, region, {allele4});
+    const Haplotype ref {region, human};
+    BOOST_CHECK(hap1.get_strong_hash() == hap2.get_strong_hash());
+    BOOST_CHECK(hap1.get_strong_hash() != hap3.get_strong_hash());
+    std::vector<Haplotype> haplotypes {hap2, hap3, ref, hap1, hap3};
+    BOOST_CHECK_EQUAL(remove_duplicates(haplotypes), 2);
+    BOOST_REQUIRE_EQUAL(haplotypes.size(), 3);
+    BOOST_CHECK(std::is_sorted(std::cbegin(haplotypes), std::cend(haplotypes)));
+    BOOST_CHECK(std::count(std::cbegin(haplotypes), std::cend(haplotypes), hap1) == 1);
+    BOOST_CHECK(have_same_alleles(*std::find(std::cbegin(haplotypes), std::cend(haplotypes), hap1), hap1));
+}
+
 BOOST_AUTO_TEST_CASE(haplotypes_behave_at_boundries)
 {
     BOOST_REQUIRE(test_file_exists(human_reference_fasta));
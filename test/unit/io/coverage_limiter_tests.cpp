@@ -0,0 +1,54 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include "io/read/coverage_limiter.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(io)
+BOOST_AUTO_TEST_SUITE(coverage_limiter)
+
+BOOST_AUTO_TEST_CASE(admitted_coverage_never_exceeds_limit)
+{
+    using Position = octopus::io::CoverageLimiter::Position;
+    std::vector<std::pair<Position, Position>> reads {};
+    for (Position begin {0}; begin < 500; ++begin) {
+        for (int i {0}; i < 20; ++i) reads.emplace_back(begin, begin + 50 + (begin + i) % 40);
+    }
+    octopus::io::CoverageLimiter limiter {30};
+    std::vector<unsigned> coverage(600, 0);
+    std::size_t num_admitted {0};
+    for (const auto& read : reads) {
+        if (limiter.admit(read.first, read.second)) {
+            for (auto pos = read.first; pos < read.second; ++pos) ++coverage[pos];
+            ++num_admitted;
+        }
+    }
+    BOOST_CHECK_LE(*std::max_element(std::cbegin(coverage), std::cend(coverage)), 30);
+    BOOST_CHECK_EQUAL(coverage[100], 30);
+    BOOST_CHECK_EQUAL(num_admitted + limiter.num_rejected(), reads.size());
+}
+
+BOOST_AUTO_TEST_CASE(reads_below_limit_are_all_admitted)
+{
+    octopus::io::CoverageLimiter limiter {2};
+    BOOST_CHECK(limiter.admit(0, 10));
+    BOOST_CHECK(limiter.admit(5, 15));
+    BOOST_CHECK(!limiter.admit(6, 16));
+    BOOST_CHECK(limiter.admit(10, 20));
+    BOOST_CHECK(limiter.admit(15, 15)); // empty reads still count one position
+    BOOST_CHECK(!limiter.admit(15, 30));
+    BOOST_CHECK_EQUAL(limiter.num_rejected(), 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
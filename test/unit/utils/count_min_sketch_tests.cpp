@@ -0,0 +1,52 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstddef>
+#include <limits>
+
+#include "utils/count_min_sketch.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(utils)
+BOOST_AUTO_TEST_SUITE(count_min_sketch)
+
+BOOST_AUTO_TEST_CASE(counts_are_never_under_estimated)
+{
+    CountMinSketch sketch {64};
+    for (std::size_t item {0}; item < 1000; ++item) {
+        for (std::size_t i {0}; i < item % 5; ++i) sketch.add(item);
+    }
+    for (std::size_t item {0}; item < 1000; ++item) {
+        BOOST_CHECK_GE(sketch.count(item), item % 5);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(sparse_counts_are_exact)
+{
+    CountMinSketch sketch {1024};
+    sketch.add(42);
+    sketch.add(42);
+    sketch.add(7);
+    BOOST_CHECK_EQUAL(sketch.count(42), 2);
+    BOOST_CHECK_EQUAL(sketch.count(7), 1);
+    BOOST_CHECK_EQUAL(sketch.count(99), 0);
+    sketch.clear();
+    BOOST_CHECK_EQUAL(sketch.count(42), 0);
+}
+
+BOOST_AUTO_TEST_CASE(counts_saturate)
+{
+    CountMinSketch sketch {16, 1};
+    const unsigned max_count {std::numeric_limits<CountMinSketch::CountType>::max()};
+    for (unsigned i {0}; i < max_count + 10; ++i) sketch.add(3);
+    BOOST_CHECK_EQUAL(sketch.count(3), max_count);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
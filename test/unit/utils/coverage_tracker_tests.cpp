@@ -0,0 +1,65 @@
+// Copyright (c) 2017 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <numeric>
+
+#include "basics/contig_region.hpp"
+#include "utils/coverage_tracker.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(utils)
+BOOST_AUTO_TEST_SUITE(coverage_tracker)
+
+BOOST_AUTO_TEST_CASE(clear_before_discards_depths_before_region)
+{
+    CoverageTracker<ContigRegion> tracker {};
+    tracker.add(ContigRegion {0, 10});
+    tracker.add(ContigRegion {5, 15});
+    tracker.add(ContigRegion {12, 20});
+    tracker.clear_before(ContigRegion {8, 30});
+    BOOST_REQUIRE(tracker.encompassing_region());
+    BOOST_CHECK_EQUAL(*tracker.encompassing_region(), (ContigRegion {8, 20}));
+    BOOST_CHECK_EQUAL(tracker.max(), 2);
+    BOOST_CHECK_EQUAL(tracker.sum(), 2 * 2 + 2 * 1 + 3 * 2 + 5 * 1);
+    const std::vector<unsigned> expected {0, 0, 2, 2, 1, 1};
+    BOOST_CHECK(tracker.get(ContigRegion {6, 12}) == expected);
+    tracker.add(ContigRegion {18, 22});
+    BOOST_CHECK_EQUAL(*tracker.encompassing_region(), (ContigRegion {8, 22}));
+    BOOST_CHECK_EQUAL(tracker.max(), 2);
+    tracker.clear_before(ContigRegion {30, 40});
+    BOOST_CHECK(tracker.is_empty());
+    BOOST_CHECK(!tracker.any());
+}
+
+BOOST_AUTO_TEST_CASE(region_statistics_match_depths)
+{
+    CoverageTracker<ContigRegion> tracker {};
+    tracker.add(ContigRegion {10, 20});
+    tracker.add(ContigRegion {15, 25});
+    tracker.add(ContigRegion {18, 19});
+    tracker.add(ContigRegion {0, 5});
+    const ContigRegion region {2, 30};
+    const auto depths = tracker.get(region);
+    BOOST_REQUIRE_EQUAL(depths.size(), size(region));
+    BOOST_CHECK_EQUAL(tracker.sum(region), std::accumulate(std::cbegin(depths), std::cend(depths), std::size_t {0}));
+    BOOST_CHECK_EQUAL(tracker.max(region), 3);
+    BOOST_CHECK_EQUAL(tracker.min(ContigRegion {10, 25}), 1);
+    BOOST_CHECK_CLOSE(tracker.mean(ContigRegion {14, 20}), (1 + 2 + 2 + 2 + 3 + 2) / 6.0, 1e-9);
+    BOOST_CHECK_CLOSE(tracker.median(region), maths::median(depths), 1e-9);
+    BOOST_CHECK_CLOSE(tracker.median(ContigRegion {10, 20}), 1.5, 1e-9);
+    BOOST_CHECK_CLOSE(tracker.stdev(ContigRegion {0, 25}), maths::stdev(tracker.get(ContigRegion {0, 25})), 1e-9);
+    BOOST_CHECK(!tracker.any(ContigRegion {6, 9}));
+    BOOST_CHECK(tracker.any(ContigRegion {6, 11}));
+    tracker.add(ContigRegion {25, 26});
+    BOOST_CHECK_EQUAL(tracker.sum(), 10 + 10 + 1 + 5 + 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
@@ -0,0 +1,76 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <vector>
+#include <numeric>
+
+#include "utils/monotonic_arena.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(utils)
+BOOST_AUTO_TEST_SUITE(monotonic_arena)
+
+BOOST_AUTO_TEST_CASE(arena_allocations_are_aligned)
+{
+    MonotonicArena arena {128};
+    for (std::size_t alignment : {1, 2, 4, 8, 16, 32, 64}) {
+        arena.allocate(3, 1);
+        const auto p = arena.allocate(100, alignment);
+        BOOST_CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(p) % alignment, 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(arena_release_keeps_storage_for_reuse)
+{
+    MonotonicArena arena {64};
+    for (int i {0}; i < 100; ++i) arena.allocate(48);
+    const auto capacity = arena.capacity();
+    BOOST_REQUIRE_GE(capacity, 4800);
+    arena.release();
+    BOOST_CHECK_EQUAL(arena.bytes_allocated(), 0);
+    BOOST_CHECK_GT(arena.capacity(), 0);
+    BOOST_CHECK_LE(arena.capacity(), capacity);
+    const auto retained = arena.capacity();
+    arena.allocate(retained / 2);
+    BOOST_CHECK_EQUAL(arena.capacity(), retained);
+}
+
+BOOST_AUTO_TEST_CASE(arena_allocator_works_with_standard_containers)
+{
+    MonotonicArena arena {};
+    ArenaVector<int> values {&arena};
+    for (int i {0}; i < 1000; ++i) values.push_back(i);
+    BOOST_CHECK_EQUAL(std::accumulate(values.cbegin(), values.cend(), 0), 499500);
+    BOOST_CHECK_GE(arena.bytes_allocated(), 1000 * sizeof(int));
+    ArenaVector<int> global_values {};
+    global_values.assign(values.cbegin(), values.cend());
+    BOOST_CHECK(global_values == values);
+}
+
+BOOST_AUTO_TEST_CASE(task_arena_is_only_available_within_the_outermost_scope)
+{
+    BOOST_CHECK(task_arena() == nullptr);
+    {
+        TaskArenaScope scope {};
+        const auto arena = task_arena();
+        BOOST_REQUIRE(arena != nullptr);
+        {
+            TaskArenaScope nested_scope {};
+            BOOST_CHECK(task_arena() == arena);
+            arena->allocate(100);
+        }
+        BOOST_CHECK(task_arena() == arena);
+        BOOST_CHECK_GE(arena->bytes_allocated(), 100);
+    }
+    BOOST_CHECK(task_arena() == nullptr);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
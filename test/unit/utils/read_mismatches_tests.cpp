@@ -0,0 +1,76 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <cstddef>
+
+#include "basics/genomic_region.hpp"
+#include "basics/aligned_read.hpp"
+#include "basics/cigar_string.hpp"
+#include "utils/read_mismatches.hpp"
+#include "mock/mock_reference.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(utils)
+BOOST_AUTO_TEST_SUITE(read_mismatches)
+
+namespace {
+
+char substitute(const char base)
+{
+    return base == 'A' ? 'C' : 'A';
+}
+
+// Mismatches at read indices 3 and 15, an N at 10, and an insertion at 12-13
+AlignedRead make_read(const ReferenceGenome& reference)
+{
+    const GenomicRegion region {"1", 100, 120};
+    const auto ref_sequence = reference.fetch_sequence(region);
+    auto sequence = ref_sequence.substr(0, 12) + "GG" + ref_sequence.substr(12);
+    sequence[3] = substitute(sequence[3]);
+    sequence[10] = 'N';
+    sequence[15] = substitute(sequence[15]);
+    return AlignedRead {"read", region, sequence, AlignedRead::BaseQualityVector(sequence.size(), 30),
+                        parse_cigar("12M2I8M"), 60, AlignedRead::Flags {}, "RG"};
+}
+
+auto visit_match_ranges(const AlignedRead& read, const ReferenceGenome& reference)
+{
+    std::vector<std::size_t> result {};
+    const GenomicRegion first_match {"1", 100, 112}, second_match {"1", 112, 120};
+    for_each_reference_mismatch(read, 0, reference, first_match, [&] (std::size_t i) { result.push_back(i); });
+    for_each_reference_mismatch(read, 14, reference, second_match, [&] (std::size_t i) { result.push_back(14 + i); });
+    return result;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(find_reference_mismatches_ignores_insertions_and_ns)
+{
+    const auto reference = mock::make_reference();
+    const auto read = make_read(reference);
+    const AlignedRead::MismatchVector expected {3, 15};
+    BOOST_CHECK(find_reference_mismatches(read, reference) == expected);
+}
+
+BOOST_AUTO_TEST_CASE(cached_mismatches_are_used_and_reset_by_sequence_changes)
+{
+    const auto reference = mock::make_reference();
+    auto read = make_read(reference);
+    BOOST_CHECK(read.reference_mismatches() == nullptr);
+    const auto uncached = visit_match_ranges(read, reference);
+    read.set_reference_mismatches(find_reference_mismatches(read, reference));
+    BOOST_REQUIRE(read.reference_mismatches() != nullptr);
+    BOOST_CHECK(visit_match_ranges(read, reference) == uncached);
+    read.sequence()[0] = substitute(read.sequence()[0]);
+    BOOST_CHECK(read.reference_mismatches() == nullptr);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
@@ -0,0 +1,93 @@
+// Copyright (c) 2017 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <string>
+#include <stdexcept>
+
+#include <boost/filesystem/operations.hpp>
+
+#include "config/common.hpp"
+#include "basics/genomic_region.hpp"
+#include "basics/aligned_read.hpp"
+#include "basics/cigar_string.hpp"
+#include "core/types/variant.hpp"
+#include "containers/mappable_flat_set.hpp"
+#include "utils/region_snapshot.hpp"
+#include "mock/mock_reference.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(utils)
+BOOST_AUTO_TEST_SUITE(region_snapshot)
+
+namespace {
+
+auto make_snapshot_path()
+{
+    return boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("%%%%-%%%%.snapshot");
+}
+
+AlignedRead make_read(const ReferenceGenome& reference, std::string name, const GenomicRegion& region, bool paired)
+{
+    auto sequence = reference.fetch_sequence(region);
+    AlignedRead::BaseQualityVector qualities(sequence.size(), 30);
+    AlignedRead::Flags flags {paired, paired, false, paired, false, false, false, false, paired, false};
+    auto cigar = parse_cigar(std::to_string(sequence.size()) + "M");
+    if (paired) {
+        return {std::move(name), region, std::move(sequence), std::move(qualities), std::move(cigar), 60, flags, "RG1",
+                region.contig_name(), region.begin() + 200, 300, AlignedRead::Segment::Flags {false, true}};
+    }
+    return {std::move(name), region, std::move(sequence), std::move(qualities), std::move(cigar), 20, flags, "RG2"};
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(snapshots_round_trip)
+{
+    const auto reference = mock::make_reference();
+    const GenomicRegion call_region {"3", 200, 400};
+    ReadMap reads {};
+    reads["NORMAL"].insert(make_read(reference, "read1", GenomicRegion {"3", 150, 250}, true));
+    reads["NORMAL"].insert(make_read(reference, "read2", GenomicRegion {"3", 300, 420}, false));
+    reads["TUMOUR"];
+    const auto ref_sequence = reference.fetch_sequence(GenomicRegion {"3", 210, 211});
+    MappableFlatSet<Variant> candidates {};
+    candidates.emplace(GenomicRegion {"3", 210, 211}, ref_sequence, ref_sequence == "A" ? "C" : "A");
+    candidates.emplace(GenomicRegion {"3", 300, 303}, reference.fetch_sequence(GenomicRegion {"3", 300, 303}), "");
+    const auto snapshot = make_region_snapshot(call_region, reads, candidates, reference, "octopus -R ref.fa -I reads.bam");
+    const auto snapshot_path = make_snapshot_path();
+    write_region_snapshot(snapshot, snapshot_path);
+    const auto replayed = read_region_snapshot(snapshot_path);
+    boost::filesystem::remove(snapshot_path);
+    BOOST_CHECK_EQUAL(replayed.call_region, call_region);
+    BOOST_CHECK_EQUAL(replayed.reference_region, snapshot.reference_region);
+    BOOST_CHECK_EQUAL(replayed.contig_size, reference.contig_size("3"));
+    BOOST_CHECK(replayed.samples == snapshot.samples);
+    BOOST_REQUIRE_EQUAL(replayed.reads.size(), 2);
+    BOOST_CHECK(replayed.reads.at("NORMAL") == reads.at("NORMAL"));
+    BOOST_CHECK(replayed.reads.at("TUMOUR").empty());
+    BOOST_CHECK(replayed.candidates == snapshot.candidates);
+    BOOST_CHECK_EQUAL(replayed.command_line, snapshot.command_line);
+    const ReferenceGenome replayed_reference {std::make_unique<SnapshotReference>(replayed)};
+    BOOST_CHECK_EQUAL(replayed_reference.fetch_sequence(call_region), reference.fetch_sequence(call_region));
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_references_only_serve_the_snapshot_window)
+{
+    const auto reference = mock::make_reference();
+    const GenomicRegion call_region {"3", 200, 400};
+    const auto snapshot = make_region_snapshot(call_region, ReadMap {}, MappableFlatSet<Variant> {}, reference, "");
+    const SnapshotReference snapshot_reference {snapshot};
+    BOOST_CHECK(contains(snapshot.reference_region, call_region));
+    BOOST_CHECK_EQUAL(snapshot_reference.fetch_sequence(snapshot.reference_region), snapshot.reference_sequence);
+    BOOST_CHECK_THROW(snapshot_reference.fetch_sequence(GenomicRegion {"2", 0, 10}), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
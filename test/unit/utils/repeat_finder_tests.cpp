@@ -0,0 +1,79 @@
+// Copyright (c) 2017 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <iterator>
+
+#include "utils/repeat_finder.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(utils)
+BOOST_AUTO_TEST_SUITE(repeat_finder)
+
+namespace {
+
+// Mostly short tandem repeats, so that edits often fall in or next to one
+std::string make_repetitive_sequence(const std::size_t size, std::mt19937& generator)
+{
+    static const std::string bases {"ACGT"};
+    std::uniform_int_distribution<std::size_t> base_dist {0, 3}, period_dist {1, 6}, copies_dist {1, 8};
+    std::string result {};
+    while (result.size() < size) {
+        std::string motif {};
+        std::generate_n(std::back_inserter(motif), period_dist(generator), [&] () { return bases[base_dist(generator)]; });
+        for (auto n = copies_dist(generator); n > 0; --n) result += motif;
+    }
+    result.resize(size);
+    return result;
+}
+
+std::string mutate(std::string sequence, std::mt19937& generator)
+{
+    const auto edit = make_repetitive_sequence(8, generator);
+    std::uniform_int_distribution<std::size_t> pos_dist {0, sequence.size() - 8}, size_dist {0, 8};
+    const auto pos = pos_dist(generator);
+    return sequence.replace(pos, size_dist(generator), edit, 0, size_dist(generator));
+}
+
+bool are_equal(const std::vector<tandem::Repeat>& lhs, const std::vector<tandem::Repeat>& rhs)
+{
+    return std::equal(std::cbegin(lhs), std::cend(lhs), std::cbegin(rhs), std::cend(rhs),
+                      [] (const auto& a, const auto& b) { return a == b && a.period == b.period; });
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(find_maximal_repetitions_reports_runs_once_with_smallest_period)
+{
+    const std::string sequence {"ACGTTTTACACACACGGATGATGATCACAC"};
+    const auto repeats = find_maximal_repetitions(sequence, 4);
+    const std::vector<tandem::Repeat> expected {
+        tandem::Repeat {3, 4, 1}, tandem::Repeat {7, 8, 2}, tandem::Repeat {15, 2, 1},
+        tandem::Repeat {16, 9, 3}, tandem::Repeat {25, 5, 2}
+    };
+    BOOST_CHECK(are_equal(repeats, expected));
+}
+
+BOOST_AUTO_TEST_CASE(updated_repeats_match_direct_search)
+{
+    std::mt19937 generator {42};
+    for (int i {0}; i < 500; ++i) {
+        const auto base = make_repetitive_sequence(300, generator);
+        auto sequence = mutate(base, generator);
+        if (i % 2 == 0) sequence = mutate(sequence, generator);
+        const auto base_repeats = find_maximal_repetitions(base, 5);
+        BOOST_CHECK(are_equal(update_maximal_repetitions(sequence, base, base_repeats, 5), find_maximal_repetitions(sequence, 5)));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
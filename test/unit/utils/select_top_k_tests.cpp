@@ -0,0 +1,80 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <functional>
+#include <set>
+#include <numeric>
+#include <cstddef>
+
+#include "utils/select_top_k.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(utils)
+BOOST_AUTO_TEST_SUITE(select_top_k)
+
+namespace {
+
+double product(const std::vector<std::vector<double>>& probabilities, const IndexTuple& tuple)
+{
+    double result {1};
+    for (std::size_t row {0}; row < tuple.size(); ++row) result *= probabilities[row][tuple[row]];
+    return result;
+}
+
+auto all_products(const std::vector<std::vector<double>>& probabilities)
+{
+    std::vector<double> result {1.0};
+    for (const auto& row : probabilities) {
+        std::vector<double> next {};
+        for (auto p : result) for (auto q : row) next.push_back(p * q);
+        result = std::move(next);
+    }
+    std::sort(std::begin(result), std::end(result), std::greater<> {});
+    return result;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(select_top_k_probable_tuples_finds_the_k_most_probable_tuples_in_order)
+{
+    std::mt19937 generator {7};
+    std::uniform_real_distribution<double> uniform {0, 1};
+    std::vector<std::vector<double>> probabilities(5, std::vector<double>(4));
+    for (auto& row : probabilities) {
+        std::generate(std::begin(row), std::end(row), [&] () { return uniform(generator); });
+        const auto sum = std::accumulate(std::cbegin(row), std::cend(row), 0.0);
+        for (auto& p : row) p /= sum;
+    }
+    probabilities[1] = {0.0, 1.0, 0.0, 0.0};
+    const auto expected = all_products(probabilities);
+    const std::size_t k {100};
+    const auto tuples = select_top_k_probable_tuples(probabilities, k);
+    BOOST_REQUIRE_EQUAL(tuples.size(), k);
+    BOOST_CHECK_EQUAL(std::set<IndexTuple>(std::cbegin(tuples), std::cend(tuples)).size(), k);
+    for (std::size_t i {0}; i < k; ++i) {
+        BOOST_CHECK_CLOSE(product(probabilities, tuples[i]), expected[i], 1e-9);
+    }
+    // Impossible tuples are never proposed
+    BOOST_CHECK_EQUAL(select_top_k_probable_tuples(probabilities, 10'000).size(), 4 * 4 * 4 * 4);
+}
+
+BOOST_AUTO_TEST_CASE(select_top_k_probable_tuples_stops_when_the_remaining_mass_is_small)
+{
+    const std::vector<std::vector<double>> probabilities(20, {0.999, 0.001});
+    const auto tuples = select_top_k_probable_tuples(probabilities, 1'000'000, 0.01);
+    // The all zero tuple has mass 0.98, and each tuple with a single one adds about 0.001
+    BOOST_CHECK_EQUAL(tuples.size(), 11);
+    BOOST_CHECK(tuples.front() == IndexTuple(20, 0));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
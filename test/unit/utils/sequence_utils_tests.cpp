@@ -0,0 +1,67 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <deque>
+#include <iterator>
+
+#include "utils/sequence_utils.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(utils)
+BOOST_AUTO_TEST_SUITE(sequence_utils)
+
+namespace {
+
+// Long enough to cover both vector steps and scalar tails, with a non-canonical base in the second block
+const std::string sequence {"ACGTNacgtnACGTTGCAACGTRGCAtgcaNNNNACGTACGTACGTACGTA"};
+
+// std::deque is not contiguous so takes the scalar paths
+using ScalarSequence = std::deque<char>;
+
+ScalarSequence to_scalar(const std::string& str)
+{
+    return ScalarSequence(std::cbegin(str), std::cend(str));
+}
+
+std::string to_string(const ScalarSequence& seq)
+{
+    return std::string(std::cbegin(seq), std::cend(seq));
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(vectorised_sequence_utils_agree_with_scalar_versions)
+{
+    for (std::size_t n {0}; n <= sequence.size(); ++n) {
+        const auto str = sequence.substr(0, n);
+        const auto scalar = to_scalar(str);
+        BOOST_CHECK_EQUAL(octopus::utils::has_ns(str), octopus::utils::has_ns(scalar));
+        BOOST_CHECK_EQUAL(octopus::utils::is_canonical_dna(str), octopus::utils::is_canonical_dna(scalar));
+        if (n > 0) BOOST_CHECK_EQUAL(octopus::utils::gc_content(str), octopus::utils::gc_content(scalar));
+        BOOST_CHECK_EQUAL(octopus::utils::capitalise_copy(str), to_string(octopus::utils::capitalise_copy(scalar)));
+        BOOST_CHECK_EQUAL(octopus::utils::reverse_complement_copy(str), to_string(octopus::utils::reverse_complement_copy(scalar)));
+        auto reversed = str;
+        octopus::utils::reverse_complement(reversed);
+        BOOST_CHECK_EQUAL(reversed, octopus::utils::reverse_complement_copy(str));
+        auto capitalised = octopus::utils::capitalise_copy(str);
+        auto scalar_capitalised = octopus::utils::capitalise_copy(scalar);
+        octopus::utils::disambiguate_iupac_bases(capitalised, true);
+        octopus::utils::disambiguate_iupac_bases(scalar_capitalised, true);
+        BOOST_CHECK_EQUAL(capitalised, to_string(scalar_capitalised));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(capitalise_capitalises_all_lowercase_letters)
+{
+    BOOST_CHECK_EQUAL(octopus::utils::capitalise_copy(std::string {"acgtnrdxACGT-*"}), "ACGTNRDXACGT-*");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
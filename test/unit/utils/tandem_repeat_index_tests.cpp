@@ -0,0 +1,85 @@
+// Copyright (c) 2017 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+
+#include <boost/filesystem/operations.hpp>
+
+#include "basics/genomic_region.hpp"
+#include "basics/tandem_repeat.hpp"
+#include "utils/repeat_finder.hpp"
+#include "utils/tandem_repeat_index.hpp"
+#include "mock/mock_reference.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(utils)
+BOOST_AUTO_TEST_SUITE(tandem_repeat_index)
+
+namespace {
+
+auto make_index_path()
+{
+    return boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("%%%%-%%%%.tri");
+}
+
+bool is_periodic(const TandemRepeat& repeat, const ReferenceGenome& reference)
+{
+    const auto sequence = reference.fetch_sequence(mapped_region(repeat));
+    for (std::size_t i {repeat.period()}; i < sequence.size(); ++i) {
+        if (sequence[i] != sequence[i - repeat.period()]) return false;
+    }
+    return sequence.compare(0, repeat.period(), repeat.motif()) == 0;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(whole_contig_lookups_match_direct_scans)
+{
+    const auto reference = mock::make_reference();
+    const auto index_path = make_index_path();
+    build_tandem_repeat_index(reference, index_path, 6);
+    const TandemRepeatIndex index {index_path};
+    BOOST_CHECK_EQUAL(index.max_period(), 6);
+    for (const auto& contig : reference.contig_names()) {
+        BOOST_REQUIRE(index.has_contig(contig));
+        const auto region = reference.contig_region(contig);
+        auto expected = find_exact_tandem_repeats(reference, region, 6);
+        std::sort(std::begin(expected), std::end(expected));
+        BOOST_CHECK(index.fetch(reference, region, 6) == expected);
+    }
+    boost::filesystem::remove(index_path);
+}
+
+BOOST_AUTO_TEST_CASE(lookups_are_clipped_to_the_region)
+{
+    auto reference = mock::make_reference();
+    const auto index_path = make_index_path();
+    build_tandem_repeat_index(reference, index_path, 6, 50);
+    reference.set_tandem_repeat_index(std::make_shared<const TandemRepeatIndex>(index_path));
+    for (const auto& contig : reference.contig_names()) {
+        const auto contig_size = reference.contig_size(contig);
+        for (GenomicRegion::Position begin {0}; begin < contig_size; begin += 37) {
+            const GenomicRegion region {contig, begin, std::min(begin + 100, contig_size)};
+            const auto repeats = find_exact_tandem_repeats(reference, region, 4);
+            BOOST_CHECK(std::is_sorted(std::cbegin(repeats), std::cend(repeats)));
+            for (const auto& repeat : repeats) {
+                BOOST_CHECK(contains(region, repeat));
+                BOOST_CHECK(repeat.period() <= 4);
+                BOOST_CHECK(region_size(repeat) >= 2 * repeat.period());
+                BOOST_CHECK(is_periodic(repeat, reference));
+            }
+        }
+    }
+    boost::filesystem::remove(index_path);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
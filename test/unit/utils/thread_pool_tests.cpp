@@ -0,0 +1,95 @@
+// Copyright (c) 2015-2019 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <array>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <iterator>
+#include <numeric>
+#include <random>
+#include <algorithm>
+#include <functional>
+
+#include "utils/thread_pool.hpp"
+#include "utils/parallel_transform.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(utils)
+BOOST_AUTO_TEST_SUITE(thread_pool)
+
+BOOST_AUTO_TEST_CASE(push_runs_small_and_large_tasks)
+{
+    ThreadPool pool {2};
+    auto small = pool.push([] (int x) { return 2 * x; }, 21);
+    std::array<char, 256> buffer {};
+    buffer.back() = 'x';
+    auto large = pool.push(ThreadPool::Priority::high, [buffer] () { return buffer.back(); });
+    BOOST_CHECK_EQUAL(small.get(), 42);
+    BOOST_CHECK_EQUAL(large.get(), 'x');
+}
+
+BOOST_AUTO_TEST_CASE(push_n_returns_results_in_index_order)
+{
+    ThreadPool pool {3};
+    auto results = pool.push_n(1000, [] (std::size_t i) { return std::to_string(i); });
+    BOOST_REQUIRE_EQUAL(results.size(), 1000);
+    for (std::size_t i {0}; i < results.size(); ++i) {
+        BOOST_CHECK_EQUAL(results[i].get(), std::to_string(i));
+    }
+    BOOST_CHECK(pool.push_n(0, [] (std::size_t i) { return i; }).empty());
+}
+
+BOOST_AUTO_TEST_CASE(parallel_for_visits_every_index_once)
+{
+    ThreadPool pool {4};
+    std::vector<std::atomic<int>> counts(10'000);
+    parallel_for(&pool, counts.size(), [&] (std::size_t i) { ++counts[i]; });
+    for (const auto& count : counts) {
+        BOOST_CHECK_EQUAL(count.load(), 1);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(chunked_algorithms_match_serial_algorithms)
+{
+    ThreadPool pool {3};
+    std::vector<int> values(10'001);
+    std::mt19937 generator {42};
+    std::uniform_int_distribution<int> distribution {-1000, 1000};
+    std::generate(std::begin(values), std::end(values), [&] () { return distribution(generator); });
+    for (const std::size_t grain_size : {0, 1, 7, 20'000}) {
+        std::vector<std::string> strings {};
+        octopus::transform(std::cbegin(values), std::cend(values), std::back_inserter(strings),
+                           [] (int x) { return std::to_string(x); }, pool, grain_size);
+        BOOST_REQUIRE_EQUAL(strings.size(), values.size());
+        for (std::size_t i {0}; i < values.size(); ++i) {
+            BOOST_CHECK_EQUAL(strings[i], std::to_string(values[i]));
+        }
+        auto doubled = values;
+        octopus::for_each(std::begin(doubled), std::end(doubled), [] (int& x) { x *= 2; }, pool, grain_size);
+        BOOST_CHECK(std::equal(std::cbegin(values), std::cend(values), std::cbegin(doubled),
+                               [] (int x, int y) { return 2 * x == y; }));
+        const auto sum = octopus::reduce(std::cbegin(values), std::cend(values), 10L, std::plus<> {}, pool, grain_size);
+        BOOST_CHECK_EQUAL(sum, std::accumulate(std::cbegin(values), std::cend(values), 10L));
+        auto sorted = values;
+        octopus::sort(std::begin(sorted), std::end(sorted), std::greater<> {}, pool, grain_size);
+        auto expected = values;
+        std::sort(std::begin(expected), std::end(expected), std::greater<> {});
+        BOOST_CHECK(sorted == expected);
+    }
+    std::vector<int> empty {};
+    BOOST_CHECK_EQUAL(octopus::reduce(std::cbegin(empty), std::cend(empty), 1, std::plus<> {}, pool), 1);
+    std::vector<int> squares {};
+    parallel_transform(std::cbegin(values), std::cend(values), std::back_inserter(squares), [] (int x) { return x * x; });
+    BOOST_REQUIRE_EQUAL(squares.size(), values.size());
+    BOOST_CHECK_EQUAL(squares.back(), values.back() * values.back());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus